@@ -28,6 +28,10 @@
 
 #include <sstream>
 #include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <ostream>
 
 namespace sigrok
 {
@@ -379,6 +383,88 @@ shared_ptr<Packet> Context::create_analog_packet(
 	return shared_ptr<Packet>{new Packet{nullptr, packet}, default_delete<Packet>{}};
 }
 
+void Context::create_logic_packets(
+	void *data_pointer, size_t data_length, unsigned int unit_size,
+	size_t packet_size, PacketBatchFunction function)
+{
+	if (unit_size == 0 || packet_size < unit_size)
+		throw Error(SR_ERR_ARG);
+
+	/* One packet for the whole batch, only its payload changes. */
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_packet packet;
+	logic.unitsize = unit_size;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	shared_ptr<Packet> wrapper{new Packet{nullptr, &packet},
+		default_delete<Packet>{}};
+
+	auto *data = static_cast<uint8_t *>(data_pointer);
+	packet_size -= packet_size % unit_size;
+	data_length -= data_length % unit_size;
+	for (size_t offset = 0; offset < data_length; offset += packet_size) {
+		logic.data = data + offset;
+		logic.length = min(packet_size, data_length - offset);
+		function(wrapper);
+	}
+}
+
+void Context::create_analog_packets(
+	vector<shared_ptr<Channel> > channels,
+	const float *data_pointer, size_t num_samples, const Quantity *mq,
+	const Unit *unit, vector<const QuantityFlag *> mqflags,
+	size_t packet_samples, PacketBatchFunction function)
+{
+	if (channels.empty() || packet_samples == 0)
+		throw Error(SR_ERR_ARG);
+
+	struct sr_datafeed_analog analog{};
+	struct sr_analog_meaning meaning{};
+	struct sr_analog_encoding encoding{};
+	struct sr_analog_spec spec{};
+	struct sr_datafeed_packet packet;
+
+	for (const auto &channel : channels)
+		meaning.channels = g_slist_append(meaning.channels, channel->_structure);
+	meaning.mq = static_cast<sr_mq>(mq->id());
+	meaning.unit = static_cast<sr_unit>(unit->id());
+	meaning.mqflags = static_cast<sr_mqflag>(QuantityFlag::mask_from_flags(move(mqflags)));
+
+	encoding.unitsize = sizeof(float);
+	encoding.is_signed = TRUE;
+	encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	encoding.is_bigendian = TRUE;
+#else
+	encoding.is_bigendian = FALSE;
+#endif
+	encoding.scale.p = 1;
+	encoding.scale.q = 1;
+	encoding.offset.p = 0;
+	encoding.offset.q = 1;
+
+	analog.meaning = &meaning;
+	analog.encoding = &encoding;
+	analog.spec = &spec;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+
+	try {
+		shared_ptr<Packet> wrapper{new Packet{nullptr, &packet},
+			default_delete<Packet>{}};
+		const size_t values = channels.size();
+		for (size_t sample = 0; sample < num_samples; sample += packet_samples) {
+			analog.data = const_cast<float *>(data_pointer + sample * values);
+			analog.num_samples = min(packet_samples, num_samples - sample);
+			function(wrapper);
+		}
+	} catch (...) {
+		g_slist_free(meaning.channels);
+		throw;
+	}
+	g_slist_free(meaning.channels);
+}
+
 shared_ptr<Packet> Context::create_end_packet()
 {
 	auto packet = g_new(struct sr_datafeed_packet, 1);
@@ -424,6 +510,37 @@ shared_ptr<Input> Context::open_stream(string header)
 		default_delete<Input>{}};
 }
 
+static vector<int> open_many(const vector<struct sr_dev_inst *> &structures,
+		int (*func)(GSList *devices, int *results))
+{
+	vector<int> results(structures.size(), SR_OK);
+	GSList *list = nullptr;
+
+	if (structures.empty())
+		return results;
+	for (auto it = structures.rbegin(); it != structures.rend(); ++it)
+		list = g_slist_prepend(list, *it);
+	func(list, results.data());
+	g_slist_free(list);
+	return results;
+}
+
+vector<int> Context::open_devices(vector<shared_ptr<Device>> devices)
+{
+	vector<struct sr_dev_inst *> structures;
+	for (const auto &device : devices)
+		structures.push_back(device->_structure);
+	return open_many(structures, sr_dev_open_many);
+}
+
+vector<int> Context::close_devices(vector<shared_ptr<Device>> devices)
+{
+	vector<struct sr_dev_inst *> structures;
+	for (const auto &device : devices)
+		structures.push_back(device->_structure);
+	return open_many(structures, sr_dev_close_many);
+}
+
 map<string, string> Context::serials(shared_ptr<Driver> driver) const
 {
 	GSList *serial_list = sr_serial_list(driver ? driver->_structure : nullptr);
@@ -898,15 +1015,69 @@ float TriggerMatch::value() const
 DatafeedCallbackData::DatafeedCallbackData(Session *session,
 		DatafeedCallbackFunction callback) :
 	_callback(move(callback)),
-	_session(session)
+	_session(session),
+	_sdi(nullptr),
+	_owned_device(nullptr)
 {
 }
 
+DatafeedCallbackData::DatafeedCallbackData(Session *session,
+		DatafeedViewCallbackFunction callback) :
+	_view_callback(move(callback)),
+	_session(session),
+	_sdi(nullptr),
+	_owned_device(nullptr)
+{
+}
+
+void DatafeedCallbackData::lookup_device(const struct sr_dev_inst *sdi)
+{
+	forget_device();
+
+	auto owned = _session->_owned_devices.find(sdi);
+	if (owned != _session->_owned_devices.end()) {
+		_owned_device = owned->second.get();
+	} else {
+		auto other = _session->_other_devices.find(sdi);
+		if (other == _session->_other_devices.end())
+			throw Error(SR_ERR_BUG);
+		_other_device = other->second;
+	}
+	_sdi = sdi;
+}
+
+void DatafeedCallbackData::forget_device()
+{
+	_sdi = nullptr;
+	_owned_device = nullptr;
+	_other_device.reset();
+}
+
 void DatafeedCallbackData::run(const struct sr_dev_inst *sdi,
 	const struct sr_datafeed_packet *pkt)
 {
-	auto device = _session->get_device(sdi);
-	shared_ptr<Packet> packet {new Packet{device, pkt}, default_delete<Packet>{}};
+	if (sdi != _sdi)
+		lookup_device(sdi);
+
+	if (_view_callback) {
+		Device *device = _owned_device ?
+			static_cast<Device *>(_owned_device) : _other_device.get();
+		_view_callback(device, PacketView{pkt});
+		return;
+	}
+
+	shared_ptr<Device> device;
+	if (_owned_device)
+		device = static_pointer_cast<Device>(
+			_owned_device->share_owned_by(_session->shared_from_this()));
+	else
+		device = _other_device;
+	/* Keep the data valid for as long as the callback holds the packet. */
+	struct sr_datafeed_packet *ref;
+	if (sr_packet_ref(pkt, &ref) != SR_OK)
+		ref = nullptr;
+	shared_ptr<Packet> packet {new Packet{device, ref ? ref : pkt, ref},
+		default_delete<Packet>{}};
 	_callback(move(device), move(packet));
 }
 
@@ -970,6 +1141,13 @@ void Session::add_device(shared_ptr<Device> device)
 	const auto dev_struct = device->_structure;
 	check(sr_session_dev_add(_structure, dev_struct));
 	_other_devices[dev_struct] = move(device);
+	forget_devices();
+}
+
+void Session::forget_devices()
+{
+	for (auto &cb_data : _datafeed_callbacks)
+		cb_data->forget_device();
 }
 
 vector<shared_ptr<Device>> Session::devices()
@@ -987,6 +1165,7 @@ vector<shared_ptr<Device>> Session::devices()
 
 void Session::remove_devices()
 {
+	forget_devices();
 	_other_devices.clear();
 	check(sr_session_dev_remove_all(_structure));
 }
@@ -1047,6 +1226,43 @@ void Session::add_datafeed_callback(DatafeedCallbackFunction callback)
 	_datafeed_callbacks.push_back(move(cb_data));
 }
 
+shared_ptr<PacketStream> Session::packet_stream(size_t depth)
+{
+	shared_ptr<PacketStream> stream{new PacketStream{depth},
+		default_delete<PacketStream>{}};
+	auto state = stream->_state;
+	add_datafeed_callback([state] (shared_ptr<Device> device,
+			shared_ptr<Packet> packet) {
+		const bool end = packet->type() == PacketType::END;
+		function<void()> notify;
+		{
+			unique_lock<mutex> lock{state->lock};
+			state->not_full.wait(lock, [&state] {
+				return state->closed || state->ended
+					|| state->queue.size() < state->depth;
+			});
+			if (state->closed || state->ended)
+				return;
+			state->queue.push_back({move(device), move(packet)});
+			state->ended = end;
+			swap(notify, state->notify);
+		}
+		state->not_empty.notify_all();
+		if (notify)
+			notify();
+	});
+	return stream;
+}
+
+void Session::add_datafeed_view_callback(DatafeedViewCallbackFunction callback)
+{
+	unique_ptr<DatafeedCallbackData> cb_data
+		{new DatafeedCallbackData{this, move(callback)}};
+	check(sr_session_datafeed_callback_add(_structure,
+			&datafeed_callback, cb_data.get()));
+	_datafeed_callbacks.push_back(move(cb_data));
+}
+
 void Session::remove_datafeed_callbacks()
 {
 	check(sr_session_datafeed_callback_remove_all(_structure));
@@ -1073,43 +1289,95 @@ string Session::filename() const
 	return _filename;
 }
 
+void Session::set_stats_enabled(bool enable)
+{
+	check(sr_session_stats_enable_set(_structure, enable));
+}
+
+SessionStats Session::stats(shared_ptr<Device> device) const
+{
+	struct sr_session_stats stats;
+	check(sr_session_stats_get(_structure,
+		device ? device->_structure : nullptr, &stats));
+
+	SessionStats result;
+	for (int i = 0; i < SR_STATS_PACKET_TYPES; i++) {
+		const PacketType *const type = PacketType::get(SR_DF_HEADER + i);
+		result.packets[type] = stats.packets[i];
+		result.bytes[type] = stats.bytes[i];
+	}
+	result.duration_us = stats.last_packet_us - stats.first_packet_us;
+	result.max_gap_us = stats.max_gap_us;
+	result.dropped_packets = stats.dropped_packets;
+	result.overruns = stats.overruns;
+	result.overrun_sample = stats.overrun_sample;
+	result.gaps = stats.gaps;
+	result.samples_lost = stats.samples_lost;
+	result.gap_sample = stats.gap_sample;
+	result.frames = stats.frames;
+	result.min_frame_gap_us = stats.min_frame_gap_us;
+	result.probes = stats.probes;
+	result.probe_total_us = stats.probe_total_us;
+	result.probe_max_us = stats.probe_max_us;
+	result.probe_histogram = vector<uint64_t>(stats.probe_hist,
+		stats.probe_hist + SR_STATS_LATENCY_BINS);
+	result.downloads = stats.downloads;
+	result.download_done = stats.download_done;
+	result.download_size = stats.download_size;
+	result.download_bytes = stats.download_bytes;
+	result.download_us = stats.download_us;
+	return result;
+}
+
+bool Session::latency_probe(shared_ptr<Packet> packet)
+{
+	const struct sr_dev_inst *const sdi =
+		packet->_device ? packet->_device->_structure : nullptr;
+	const int ret = sr_session_latency_probe(_structure, sdi,
+		packet->_structure);
+	if (ret == SR_ERR_NA)
+		return false;
+	check(ret);
+	return true;
+}
+
+vector<StageStats> Session::stage_stats() const
+{
+	GSList *stages;
+	check(sr_session_stage_stats_get(_structure, &stages));
+
+	vector<StageStats> result;
+	for (GSList *l = stages; l; l = l->next) {
+		auto *const stage = static_cast<struct sr_session_stage_stats *>(l->data);
+		result.push_back(StageStats{stage->name, stage->calls,
+			stage->bytes, stage->total_us, stage->max_us,
+			vector<uint64_t>(stage->latency_hist,
+				stage->latency_hist + SR_STATS_LATENCY_BINS)});
+	}
+	g_slist_free_full(stages, g_free);
+	return result;
+}
+
 shared_ptr<Context> Session::context()
 {
 	return _context;
 }
 
 Packet::Packet(shared_ptr<Device> device,
-	const struct sr_datafeed_packet *structure) :
+	const struct sr_datafeed_packet *structure,
+	struct sr_datafeed_packet *ref) :
 	_structure(structure),
+	_ref(ref),
 	_device(move(device))
 {
-	switch (structure->type)
-	{
-		case SR_DF_HEADER:
-			_payload.reset(new Header{
-				static_cast<const struct sr_datafeed_header *>(
-					structure->payload)});
-			break;
-		case SR_DF_META:
-			_payload.reset(new Meta{
-				static_cast<const struct sr_datafeed_meta *>(
-					structure->payload)});
-			break;
-		case SR_DF_LOGIC:
-			_payload.reset(new Logic{
-				static_cast<const struct sr_datafeed_logic *>(
-					structure->payload)});
-			break;
-		case SR_DF_ANALOG:
-			_payload.reset(new Analog{
-				static_cast<const struct sr_datafeed_analog *>(
-					structure->payload)});
-			break;
-	}
 }
 
 Packet::~Packet()
 {
+	/* Payload wrappers point into the packet, release them first. */
+	_payload.reset();
+	if (_ref)
+		sr_packet_unref(_ref);
 }
 
 const PacketType *Packet::type() const
@@ -1117,14 +1385,193 @@ const PacketType *Packet::type() const
 	return PacketType::get(_structure->type);
 }
 
+bool Packet::has_timestamp() const
+{
+	struct sr_datafeed_timestamp ts;
+	return sr_packet_timestamp_get(_structure, &ts) == SR_OK;
+}
+
+int64_t Packet::host_time_us() const
+{
+	struct sr_datafeed_timestamp ts;
+	check(sr_packet_timestamp_get(_structure, &ts));
+	return ts.host_us;
+}
+
+uint64_t Packet::sample_position() const
+{
+	struct sr_datafeed_timestamp ts;
+	check(sr_packet_timestamp_get(_structure, &ts));
+	return ts.sample_pos;
+}
+
+int64_t Packet::aligned_time_us() const
+{
+	struct sr_datafeed_timestamp ts;
+	check(sr_packet_timestamp_get(_structure, &ts));
+	return ts.aligned_us;
+}
+
 shared_ptr<PacketPayload> Packet::payload()
 {
+	/* Created on first use, many consumers only look at the type. */
+	if (!_payload) {
+		switch (_structure->type)
+		{
+			case SR_DF_HEADER:
+				_payload.reset(new Header{
+					static_cast<const struct sr_datafeed_header *>(
+						_structure->payload)});
+				break;
+			case SR_DF_META:
+				_payload.reset(new Meta{
+					static_cast<const struct sr_datafeed_meta *>(
+						_structure->payload)});
+				break;
+			case SR_DF_LOGIC:
+				_payload.reset(new Logic{
+					static_cast<const struct sr_datafeed_logic *>(
+						_structure->payload)});
+				break;
+			case SR_DF_ANALOG:
+				_payload.reset(new Analog{
+					static_cast<const struct sr_datafeed_analog *>(
+						_structure->payload)});
+				break;
+		}
+	}
 	if (_payload)
 		return _payload->share_owned_by(shared_from_this());
 	else
 		throw Error(SR_ERR_NA);
 }
 
+PacketView::PacketView(const struct sr_datafeed_packet *structure) :
+	_structure(structure)
+{
+}
+
+const PacketType *PacketView::type() const
+{
+	return PacketType::get(_structure->type);
+}
+
+const struct sr_datafeed_packet *PacketView::structure() const
+{
+	return _structure;
+}
+
+const void *PacketView::logic_data() const
+{
+	if (_structure->type != SR_DF_LOGIC)
+		return nullptr;
+	return static_cast<const struct sr_datafeed_logic *>(
+		_structure->payload)->data;
+}
+
+size_t PacketView::logic_length() const
+{
+	if (_structure->type != SR_DF_LOGIC)
+		return 0;
+	return static_cast<const struct sr_datafeed_logic *>(
+		_structure->payload)->length;
+}
+
+unsigned int PacketView::logic_unit_size() const
+{
+	if (_structure->type != SR_DF_LOGIC)
+		return 0;
+	return static_cast<const struct sr_datafeed_logic *>(
+		_structure->payload)->unitsize;
+}
+
+struct PacketStreamState
+{
+	mutable mutex lock;
+	condition_variable not_empty;
+	condition_variable not_full;
+	deque<StreamPacket> queue;
+	size_t depth;
+	bool ended = false;
+	bool closed = false;
+	function<void()> notify;
+};
+
+PacketStream::PacketStream(size_t depth) :
+	_state(make_shared<PacketStreamState>())
+{
+	_state->depth = depth ? depth : 1;
+}
+
+PacketStream::~PacketStream()
+{
+	close();
+}
+
+StreamPacket PacketStream::next()
+{
+	StreamPacket item;
+	{
+		unique_lock<mutex> lock{_state->lock};
+		_state->not_empty.wait(lock, [this] {
+			return !_state->queue.empty()
+				|| _state->ended || _state->closed;
+		});
+		if (_state->queue.empty())
+			return item;
+		item = move(_state->queue.front());
+		_state->queue.pop_front();
+	}
+	_state->not_full.notify_one();
+	return item;
+}
+
+bool PacketStream::try_next(StreamPacket &item)
+{
+	{
+		lock_guard<mutex> lock{_state->lock};
+		if (_state->queue.empty())
+			return false;
+		item = move(_state->queue.front());
+		_state->queue.pop_front();
+	}
+	_state->not_full.notify_one();
+	return true;
+}
+
+bool PacketStream::finished() const
+{
+	lock_guard<mutex> lock{_state->lock};
+	return _state->queue.empty() && (_state->ended || _state->closed);
+}
+
+void PacketStream::close()
+{
+	function<void()> notify;
+	{
+		lock_guard<mutex> lock{_state->lock};
+		_state->closed = true;
+		_state->queue.clear();
+		swap(notify, _state->notify);
+	}
+	_state->not_full.notify_all();
+	_state->not_empty.notify_all();
+	if (notify)
+		notify();
+}
+
+void PacketStream::notify(function<void()> function)
+{
+	{
+		lock_guard<mutex> lock{_state->lock};
+		if (_state->queue.empty() && !_state->ended && !_state->closed) {
+			_state->notify = move(function);
+			return;
+		}
+	}
+	function();
+}
+
 PacketPayload::PacketPayload()
 {
 }
@@ -1218,6 +1665,125 @@ unsigned int Logic::unit_size() const
 	return _structure->unitsize;
 }
 
+size_t Logic::num_samples() const
+{
+	return _structure->unitsize ? _structure->length / _structure->unitsize : 0;
+}
+
+/* Gather bit 0 of each of the eight bytes of x, byte 0 into bit 0. */
+static inline uint8_t gather_bits(uint64_t x)
+{
+	return (x & 0x0101010101010101ULL) * 0x0102040810204080ULL >> 56;
+}
+
+/* Pack 8 samples of a channel into a byte, padding with zeros. */
+static inline uint8_t pack_block(const uint8_t *src, size_t unit_size,
+	unsigned int bit, size_t count)
+{
+	uint64_t x = 0;
+
+	for (size_t j = 0; j < count; j++)
+		x |= uint64_t{src[j * unit_size]} << (8 * j);
+
+	return gather_bits(x >> bit);
+}
+
+/* Index of the lowest set bit of x, which must not be zero. */
+static inline unsigned int lowest_bit(uint64_t x)
+{
+#ifdef __GNUC__
+	return __builtin_ctzll(x);
+#else
+	unsigned int i = 0;
+	while (!(x & 1)) {
+		x >>= 1;
+		i++;
+	}
+	return i;
+#endif
+}
+
+void Logic::channel_bits(unsigned int channel, uint8_t *dest) const
+{
+	const size_t unit_size = _structure->unitsize;
+
+	if (channel >= unit_size * 8)
+		throw Error(SR_ERR_ARG);
+
+	const auto *src = static_cast<const uint8_t *>(_structure->data) + channel / 8;
+	const unsigned int bit = channel % 8;
+	const size_t samples = num_samples();
+	size_t i;
+
+	for (i = 0; i + 8 <= samples; i += 8, src += 8 * unit_size)
+		*dest++ = pack_block(src, unit_size, bit, 8);
+	if (i < samples)
+		*dest = pack_block(src, unit_size, bit, samples - i);
+}
+
+vector<uint8_t> Logic::channel_bits(unsigned int channel) const
+{
+	vector<uint8_t> result((num_samples() + 7) / 8);
+	channel_bits(channel, result.data());
+	return result;
+}
+
+void Logic::unpack_channels(const vector<unsigned int> &channels,
+	uint8_t *dest) const
+{
+	const size_t unit_size = _structure->unitsize;
+	const size_t samples = num_samples();
+	const auto *data = static_cast<const uint8_t *>(_structure->data);
+
+	for (auto channel : channels)
+		if (channel >= unit_size * 8)
+			throw Error(SR_ERR_ARG);
+
+	for (auto channel : channels) {
+		const uint8_t *src = data + channel / 8;
+		const unsigned int bit = channel % 8;
+		for (size_t i = 0; i < samples; i++, src += unit_size)
+			*dest++ = (*src >> bit) & 1;
+	}
+}
+
+vector<uint8_t> Logic::unpack_channels(const vector<unsigned int> &channels) const
+{
+	vector<uint8_t> result(channels.size() * num_samples());
+	unpack_channels(channels, result.data());
+	return result;
+}
+
+vector<uint64_t> Logic::edges(unsigned int channel) const
+{
+	vector<uint64_t> result;
+	const size_t samples = num_samples();
+
+	if (channel >= _structure->unitsize * 8)
+		throw Error(SR_ERR_ARG);
+	if (samples < 2)
+		return result;
+
+	/* Compare 64 samples at a time against their predecessors. */
+	vector<uint8_t> bits((samples + 63) / 64 * 8);
+	channel_bits(channel, bits.data());
+	uint64_t previous = bits[0] & 1;
+	for (size_t word = 0; word < bits.size() / 8; word++) {
+		uint64_t x = 0;
+		for (unsigned int j = 0; j < 8; j++)
+			x |= uint64_t{bits[word * 8 + j]} << (8 * j);
+		uint64_t changes = x ^ ((x << 1) | previous);
+		previous = x >> 63;
+		const size_t base = word * 64;
+		if (samples - base < 64)
+			changes &= (uint64_t{1} << (samples - base)) - 1;
+		for (; changes; changes &= changes - 1)
+			result.push_back(base + lowest_bit(changes));
+	}
+
+	return result;
+}
+
 Analog::Analog(const struct sr_datafeed_analog *structure) :
 	PacketPayload(),
 	_structure(structure)
@@ -1244,6 +1810,11 @@ void Analog::get_data_as_float(float *dest)
 	check(sr_analog_to_float(_structure, dest));
 }
 
+void Analog::get_data_as_double(double *dest)
+{
+	check(sr_analog_convert(_structure, SR_ANALOG_TYPE_DOUBLE, dest));
+}
+
 unsigned int Analog::num_samples() const
 {
 	return _structure->num_samples;
@@ -1251,12 +1822,13 @@ unsigned int Analog::num_samples() const
 
 vector<shared_ptr<Channel>> Analog::channels()
 {
-	vector<shared_ptr<Channel>> result;
-	for (auto l = _structure->meaning->channels; l; l = l->next) {
-		auto *const ch = static_cast<struct sr_channel *>(l->data);
-		result.push_back(_parent->_device->get_channel(ch));
+	if (_channels.empty()) {
+		for (auto l = _structure->meaning->channels; l; l = l->next) {
+			auto *const ch = static_cast<struct sr_channel *>(l->data);
+			_channels.push_back(_parent->_device->get_channel(ch));
+		}
 	}
-	return result;
+	return _channels;
 }
 
 unsigned int Analog::unitsize() const
@@ -1660,6 +2232,7 @@ Output::Output(string filename, shared_ptr<OutputFormat> format,
 
 Output::~Output()
 {
+	sr_output_sink_free(_sink);
 	check(sr_output_free(_structure));
 }
 
@@ -1681,6 +2254,60 @@ string Output::receive(shared_ptr<Packet> packet)
 	}
 }
 
+int Output::sink_callback(const uint8_t *data, size_t length, void *cb_data)
+{
+	auto *const output = static_cast<Output *>(cb_data);
+
+	try {
+		(*output->_sink_function)(
+			reinterpret_cast<const char *>(data), length);
+	} catch (...) {
+		output->_sink_error = current_exception();
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+void Output::receive(shared_ptr<Packet> packet,
+	function<void(const char *data, size_t length)> sink)
+{
+	/* The sink keeps its buffer across calls, only the target changes. */
+	if (!_sink) {
+		_sink = sr_output_sink_new_callback(&Output::sink_callback, this);
+		if (!_sink)
+			throw Error(SR_ERR_MALLOC);
+	}
+
+	_sink_function = &sink;
+	_sink_error = nullptr;
+	int ret = sr_output_send_sink(_structure, packet->_structure, _sink);
+	if (ret == SR_OK)
+		ret = sr_output_sink_flush(_sink);
+	_sink_function = nullptr;
+
+	if (_sink_error) {
+		auto error = _sink_error;
+		_sink_error = nullptr;
+		rethrow_exception(error);
+	}
+	check(ret);
+}
+
+void Output::receive(shared_ptr<Packet> packet, ostream &stream)
+{
+	receive(move(packet), [&stream] (const char *data, size_t length) {
+		stream.write(data, length);
+	});
+}
+
+void Output::receive(shared_ptr<Packet> packet, vector<char> &buffer)
+{
+	receive(move(packet), [&buffer] (const char *data, size_t length) {
+		buffer.insert(buffer.end(), data, data + length);
+	});
+}
+
 #include <enums.cpp>
 
 }
@@ -79,11 +79,18 @@ G_GNUC_BEGIN_IGNORE_DEPRECATIONS
 G_GNUC_END_IGNORE_DEPRECATIONS
 
 #include <functional>
+#include <iosfwd>
 #include <stdexcept>
 #include <memory>
 #include <vector>
 #include <map>
 #include <set>
+#if __cplusplus >= 202002L && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define SR_CXX_COROUTINES 1
+#endif
+#endif
 
 namespace sigrok
 {
@@ -109,6 +116,8 @@ class SR_API TriggerMatch;
 class SR_API TriggerMatchType;
 class SR_API ChannelType;
 class SR_API Packet;
+class SR_API PacketView;
+class SR_API PacketStream;
 class SR_API PacketPayload;
 class SR_API PacketType;
 class SR_API Quantity;
@@ -286,6 +295,35 @@ public:
 		std::vector<std::shared_ptr<Channel> > channels,
 		const float *data_pointer, unsigned int num_samples, const Quantity *mq,
 		const Unit *unit, std::vector<const QuantityFlag *> mqflags);
+	/** Function which gets the packets of a batch, see
+	 * create_logic_packets() and create_analog_packets(). The packet
+	 * is reused for the whole batch, and only valid during the call. */
+	typedef std::function<void(std::shared_ptr<Packet>)> PacketBatchFunction;
+	/** Split logic data into packets, and pass them to a function in turn.
+	 * @param data_pointer Logic data.
+	 * @param data_length Length of the data in bytes.
+	 * @param unit_size Size of each sample in bytes.
+	 * @param packet_size Maximum length of each packet's data in bytes,
+	 * rounded down to whole samples.
+	 * @param function Function to pass the packets to. */
+	void create_logic_packets(
+		void *data_pointer, size_t data_length, unsigned int unit_size,
+		size_t packet_size, PacketBatchFunction function);
+	/** Split analog data into packets, and pass them to a function in turn.
+	 * @param channels Channels of the data.
+	 * @param data_pointer Analog data, the values of all channels of a
+	 * sample next to each other.
+	 * @param num_samples Number of samples.
+	 * @param mq Measured quantity.
+	 * @param unit Unit of the values.
+	 * @param mqflags Measured quantity flags.
+	 * @param packet_samples Maximum number of samples in each packet.
+	 * @param function Function to pass the packets to. */
+	void create_analog_packets(
+		std::vector<std::shared_ptr<Channel> > channels,
+		const float *data_pointer, size_t num_samples, const Quantity *mq,
+		const Unit *unit, std::vector<const QuantityFlag *> mqflags,
+		size_t packet_samples, PacketBatchFunction function);
 	/** Create an end packet. */
 	std::shared_ptr<Packet> create_end_packet();
 	/** Load a saved session.
@@ -300,6 +338,18 @@ public:
 	/** Open an input stream based on header data.
 	 * @param header Initial data from stream. */
 	std::shared_ptr<Input> open_stream(std::string header);
+	/** Open several devices at the same time, see sr_dev_open_many().
+	 * @param devices Devices to open.
+	 * @return Result code (SR_OK etc.) of each device, in the order of
+	 * the devices. */
+	std::vector<int> open_devices(
+		std::vector<std::shared_ptr<Device> > devices);
+	/** Close several devices at the same time, see sr_dev_close_many().
+	 * @param devices Devices to close.
+	 * @return Result code (SR_OK etc.) of each device, in the order of
+	 * the devices. */
+	std::vector<int> close_devices(
+		std::vector<std::shared_ptr<Device> > devices);
 	std::map<std::string, std::string> serials(std::shared_ptr<Driver> driver) const;
 private:
 	struct sr_context *_structure;
@@ -408,6 +458,7 @@ protected:
 private:
 	std::map<std::string, std::unique_ptr<ChannelGroup> > _channel_groups;
 
+	friend class Context;
 	friend class Session;
 	friend class Channel;
 	friend class ChannelGroup;
@@ -578,6 +629,10 @@ typedef std::function<void()> SessionStoppedCallback;
 typedef std::function<void(std::shared_ptr<Device>, std::shared_ptr<Packet>)>
 	DatafeedCallbackFunction;
 
+/** Type of datafeed callback which gets packets as views, see PacketView */
+typedef std::function<void(Device *, const PacketView &)>
+	DatafeedViewCallbackFunction;
+
 /* Data required for C callback function to call a C++ datafeed callback */
 class SR_PRIV DatafeedCallbackData
 {
@@ -586,9 +641,18 @@ public:
 		const struct sr_datafeed_packet *pkt);
 private:
 	DatafeedCallbackFunction _callback;
+	DatafeedViewCallbackFunction _view_callback;
 	DatafeedCallbackData(Session *session,
 		DatafeedCallbackFunction callback);
+	DatafeedCallbackData(Session *session,
+		DatafeedViewCallbackFunction callback);
+	void lookup_device(const struct sr_dev_inst *sdi);
+	void forget_device();
 	Session *_session;
+	/* Device of the last packet, saves the lookup for the next one. */
+	const struct sr_dev_inst *_sdi;
+	SessionDevice *_owned_device;
+	std::shared_ptr<Device> _other_device;
 	friend class Session;
 };
 
@@ -603,9 +667,74 @@ private:
 	std::shared_ptr<Device> get_shared_from_this();
 
 	friend class Session;
+	friend class DatafeedCallbackData;
 	friend struct std::default_delete<SessionDevice>;
 };
 
+/** Datafeed throughput counters of a session or device */
+struct SR_API SessionStats
+{
+	/** Packets sent, by packet type. */
+	std::map<const PacketType *, uint64_t> packets;
+	/** Sample data bytes sent, by packet type. */
+	std::map<const PacketType *, uint64_t> bytes;
+	/** Time between the first and the last packet, in us. */
+	uint64_t duration_us;
+	/** Longest gap between two consecutive packets, in us. */
+	uint64_t max_gap_us;
+	/** Packets dropped because a consumer queue was full. */
+	uint64_t dropped_packets;
+	/** Number of consumer overruns reported by drivers. */
+	uint64_t overruns;
+	/** Sample position at which data was lost in the last overrun. */
+	uint64_t overrun_sample;
+	/** Gaps in the sample data reported by drivers. */
+	uint64_t gaps;
+	/** Samples lost in all gaps, as far as they are known. */
+	uint64_t samples_lost;
+	/** Sample position of the last gap. */
+	uint64_t gap_sample;
+	/** Number of frames. */
+	uint64_t frames;
+	/** Shortest time between the beginnings of two frames, in us. */
+	uint64_t min_frame_gap_us;
+	/** Latency probes which reached consumers. */
+	uint64_t probes;
+	/** Cumulative latency of the probes, in us. */
+	uint64_t probe_total_us;
+	/** Longest latency of a probe, in us. */
+	uint64_t probe_max_us;
+	/** Latency histogram of the probes, see struct sr_session_stats. */
+	std::vector<uint64_t> probe_histogram;
+	/** Sample memory readbacks which devices started. */
+	uint64_t downloads;
+	/** Bytes received in the current readback. */
+	uint64_t download_done;
+	/** Total size of the current readback, in bytes. */
+	uint64_t download_size;
+	/** Bytes received in all readbacks. */
+	uint64_t download_bytes;
+	/** Time spent on readbacks, in us. */
+	uint64_t download_us;
+};
+
+/** Timing of a transform or datafeed callback in a session */
+struct SR_API StageStats
+{
+	/** Transform module ID, or "callback N" for datafeed callbacks. */
+	std::string name;
+	/** Number of packets passed to this stage. */
+	uint64_t calls;
+	/** Sample data bytes passed to this stage. */
+	uint64_t bytes;
+	/** Cumulative time spent in this stage, in us. */
+	uint64_t total_us;
+	/** Longest time spent on a single packet, in us. */
+	uint64_t max_us;
+	/** Latency histogram, see struct sr_session_stage_stats. */
+	std::vector<uint64_t> latency_histogram;
+};
+
 /** A sigrok session */
 class SR_API Session : public UserOwned<Session>
 {
@@ -620,6 +749,16 @@ public:
 	/** Add a datafeed callback to this session.
 	 * @param callback Callback of the form callback(Device, Packet). */
 	void add_datafeed_callback(DatafeedCallbackFunction callback);
+	/** Get the datafeed as a stream of packets, which consumers pull
+	 * at their own pace, see PacketStream.
+	 * @param depth Number of packets the stream holds. When the stream
+	 * is full, the session waits for the consumer. */
+	std::shared_ptr<PacketStream> packet_stream(size_t depth = 64);
+	/** Add a datafeed callback which gets packets as views. This avoids
+	 * the allocations and reference counting of the Device and Packet
+	 * objects, for consumers which don't keep them past the call.
+	 * @param callback Callback of the form callback(Device *, PacketView). */
+	void add_datafeed_view_callback(DatafeedViewCallbackFunction callback);
 	/** Remove all datafeed callbacks from this session. */
 	void remove_datafeed_callbacks();
 	/** Start the session. */
@@ -641,11 +780,25 @@ public:
 	void set_trigger(std::shared_ptr<Trigger> trigger);
 	/** Get filename this session was loaded from. */
 	std::string filename() const;
+	/** Enable the accounting of packets and of datafeed stages.
+	 * @param enable Whether to account packets and stages. */
+	void set_stats_enabled(bool enable);
+	/** Get datafeed throughput counters.
+	 * @param device Device to get the counters of, or nullptr for
+	 * the whole session. */
+	SessionStats stats(std::shared_ptr<Device> device = nullptr) const;
+	/** Get timing statistics of the transforms and datafeed callbacks. */
+	std::vector<StageStats> stage_stats() const;
+	/** Account a latency probe which reached a datafeed consumer.
+	 * @param packet The received packet.
+	 * @return Whether the packet is a latency probe. */
+	bool latency_probe(std::shared_ptr<Packet> packet);
 private:
 	explicit Session(std::shared_ptr<Context> context);
 	Session(std::shared_ptr<Context> context, std::string filename);
 	~Session();
 	std::shared_ptr<Device> get_device(const struct sr_dev_inst *sdi);
+	void forget_devices();
 	struct sr_session *_structure;
 	const std::shared_ptr<Context> _context;
 	std::map<const struct sr_dev_inst *, std::unique_ptr<SessionDevice> > _owned_devices;
@@ -661,7 +814,14 @@ private:
 	friend struct std::default_delete<Session>;
 };
 
-/** A packet on the session datafeed */
+/** A packet on the session datafeed
+ *
+ * Packets passed to datafeed callbacks hold a reference to the packet's
+ * data, they and their payloads stay valid after the callback returned
+ * and can be handed to other threads. The data is shared with the
+ * driver where the driver allows that, and copied otherwise. Consumers
+ * which don't keep packets can avoid the copy with a view callback,
+ * see Session::add_datafeed_view_callback(). */
 class SR_API Packet : public UserOwned<Packet>
 {
 public:
@@ -669,11 +829,22 @@ public:
 	const PacketType *type() const;
 	/** Payload of this packet. */
 	std::shared_ptr<PacketPayload> payload();
+	/** Whether this packet carries a host timestamp. */
+	bool has_timestamp() const;
+	/** Monotonic host time at which the driver received the data, in us. */
+	int64_t host_time_us() const;
+	/** Number of samples the device sent before this packet. */
+	uint64_t sample_position() const;
+	/** Estimated host time of the first sample on the session's timebase, in us. */
+	int64_t aligned_time_us() const;
 private:
 	Packet(std::shared_ptr<Device> device,
-		const struct sr_datafeed_packet *structure);
+		const struct sr_datafeed_packet *structure,
+		struct sr_datafeed_packet *ref = nullptr);
 	~Packet();
 	const struct sr_datafeed_packet *_structure;
+	/* Reference from sr_packet_ref(), dropped with the wrapper. */
+	struct sr_datafeed_packet *_ref;
 	std::shared_ptr<Device> _device;
 	std::unique_ptr<PacketPayload> _payload;
 
@@ -688,6 +859,95 @@ private:
 	friend struct std::default_delete<Packet>;
 };
 
+/** A view on a packet on the session datafeed, only valid during the
+ * datafeed callback which it was passed to */
+class SR_API PacketView
+{
+public:
+	/** Type of this packet. */
+	const PacketType *type() const;
+	/** Underlying C packet structure. */
+	const struct sr_datafeed_packet *structure() const;
+	/** Logic data of a logic packet, nullptr for other packet types. */
+	const void *logic_data() const;
+	/** Logic data length in bytes, 0 for other packet types. */
+	size_t logic_length() const;
+	/** Size of each logic sample in bytes, 0 for other packet types. */
+	unsigned int logic_unit_size() const;
+private:
+	explicit PacketView(const struct sr_datafeed_packet *structure);
+	const struct sr_datafeed_packet *_structure;
+
+	friend class DatafeedCallbackData;
+};
+
+/** A packet of a PacketStream, and the device which sent it */
+struct SR_API StreamPacket
+{
+	std::shared_ptr<Device> device;
+	/** The packet, nullptr at the end of the stream. */
+	std::shared_ptr<Packet> packet;
+};
+
+struct PacketStreamState;
+
+/** A bounded queue of the packets of a session's datafeed
+ *
+ * The session thread puts packets in while Session::run() executes,
+ * consumers take them out from any thread. A full queue makes the
+ * session wait, which slows the device down as far as it supports
+ * flow control. The stream ends after the SR_DF_END packet of an
+ * acquisition, or when it gets closed. */
+class SR_API PacketStream : public UserOwned<PacketStream>
+{
+public:
+	/** Get the next packet, wait for one if none is queued. Returns an
+	 * item without packet at the end of the stream. */
+	StreamPacket next();
+	/** Get the next packet if one is queued.
+	 * @param item Receives the packet.
+	 * @return Whether a packet was taken from the queue. */
+	bool try_next(StreamPacket &item);
+	/** Whether the stream ended and all its packets were taken. */
+	bool finished() const;
+	/** End the stream, drop the queued packets, and let the session
+	 * continue without waiting for the consumer. */
+	void close();
+	/** Get notified once when a packet is available or the stream
+	 * ended. The function runs on the session thread, or right away
+	 * if that is the case already. */
+	void notify(std::function<void()> function);
+#ifdef SR_CXX_COROUTINES
+	/** Awaitable which resumes a coroutine with the next packet. The
+	 * coroutine resumes on the session thread. Supports one awaiting
+	 * consumer per stream. */
+	struct Awaiter
+	{
+		PacketStream *stream;
+		StreamPacket item;
+		bool await_ready() { return stream->try_next(item) || stream->finished(); }
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			stream->notify([handle] { handle.resume(); });
+		}
+		StreamPacket await_resume()
+		{
+			if (!item.packet)
+				stream->try_next(item);
+			return std::move(item);
+		}
+	};
+	Awaiter operator co_await() { return Awaiter{this, {}}; }
+#endif
+private:
+	explicit PacketStream(size_t depth);
+	~PacketStream();
+	std::shared_ptr<PacketStreamState> _state;
+
+	friend class Session;
+	friend struct std::default_delete<PacketStream>;
+};
+
 /** Abstract base class for datafeed packet payloads */
 class SR_API PacketPayload
 {
@@ -753,6 +1013,30 @@ public:
 	size_t data_length() const;
 	/* Size of each sample in bytes. */
 	unsigned int unit_size() const;
+	/** Number of samples. */
+	size_t num_samples() const;
+	/** Get the samples of one channel as packed bits.
+	 * @param channel Index of the channel's bit in the samples.
+	 * @return One bit per sample, the first sample in the least
+	 * significant bit of the first byte. */
+	std::vector<uint8_t> channel_bits(unsigned int channel) const;
+	/** Get the samples of one channel as packed bits.
+	 * @param channel Index of the channel's bit in the samples.
+	 * @param dest Buffer of (num_samples() + 7) / 8 bytes. */
+	void channel_bits(unsigned int channel, uint8_t *dest) const;
+	/** Get the samples of some channels, one byte of 0 or 1 per sample.
+	 * @param channels Indices of the channels' bits in the samples.
+	 * @return num_samples() bytes for each of the channels in turn. */
+	std::vector<uint8_t> unpack_channels(
+		const std::vector<unsigned int> &channels) const;
+	/** Get the samples of some channels, one byte of 0 or 1 per sample.
+	 * @param channels Indices of the channels' bits in the samples.
+	 * @param dest Buffer of channels.size() * num_samples() bytes. */
+	void unpack_channels(const std::vector<unsigned int> &channels,
+		uint8_t *dest) const;
+	/** Get the indices of the samples where a channel changes state.
+	 * @param channel Index of the channel's bit in the samples. */
+	std::vector<uint64_t> edges(unsigned int channel) const;
 private:
 	explicit Logic(const struct sr_datafeed_logic *structure);
 	~Logic();
@@ -778,6 +1062,11 @@ public:
 	 * The pointer must have space for num_samples() floats.
 	 */
 	void get_data_as_float(float *dest);
+	/**
+	 * Fills dest pointer with the analog data converted to double.
+	 * The pointer must have space for num_samples() doubles.
+	 */
+	void get_data_as_double(double *dest);
 	/** Number of samples in this packet. */
 	unsigned int num_samples() const;
 	/** Channels for which this packet contains data. */
@@ -842,6 +1131,8 @@ private:
 	std::shared_ptr<PacketPayload> share_owned_by(std::shared_ptr<Packet> parent);
 
 	const struct sr_datafeed_analog *_structure;
+	/* Looked up on first use of channels(). */
+	std::vector<std::shared_ptr<Channel> > _channels;
 
 	friend class Packet;
 };
@@ -1015,6 +1306,23 @@ public:
 	/** Update output with data from the given packet.
 	 * @param packet Packet to handle. */
 	std::string receive(std::shared_ptr<Packet> packet);
+	/** Update output with data from the given packet, and pass the
+	 * output to a function, possibly in several pieces.
+	 * @param packet Packet to handle.
+	 * @param sink Function to pass the output to. The data is only
+	 * valid during the call. */
+	void receive(std::shared_ptr<Packet> packet,
+		std::function<void(const char *data, size_t length)> sink);
+	/** Update output with data from the given packet, and write the
+	 * output to a stream.
+	 * @param packet Packet to handle.
+	 * @param stream Stream to write the output to. */
+	void receive(std::shared_ptr<Packet> packet, std::ostream &stream);
+	/** Update output with data from the given packet, and append the
+	 * output to a buffer.
+	 * @param packet Packet to handle.
+	 * @param buffer Buffer to append the output to. */
+	void receive(std::shared_ptr<Packet> packet, std::vector<char> &buffer);
 	/** Output format in use for this output */
 	std::shared_ptr<OutputFormat> format();
 private:
@@ -1029,6 +1337,12 @@ private:
 	const std::shared_ptr<OutputFormat> _format;
 	const std::shared_ptr<Device> _device;
 	const std::map<std::string, Glib::VariantBase> _options;
+	struct sr_output_sink *_sink = nullptr;
+	std::function<void(const char *, size_t)> *_sink_function = nullptr;
+	std::exception_ptr _sink_error;
+
+	static int sink_callback(const uint8_t *data, size_t length,
+		void *cb_data);
 
 	friend class OutputFormat;
 	friend struct std::default_delete<Output>;
@@ -372,6 +372,160 @@ typedef jobject jdatafeedcallback;
   }
 }
 
+/*
+ * Direct buffers over the data of Logic and Analog payloads. They wrap
+ * the packet's memory without a copy. Each buffer keeps the payload
+ * object, and so the packet's data, alive until the buffer got collected.
+ */
+
+%pragma(java) modulecode=%{
+  private static final java.lang.ref.ReferenceQueue<java.nio.Buffer>
+    buffer_queue = new java.lang.ref.ReferenceQueue<java.nio.Buffer>();
+  private static final java.util.Map<java.lang.ref.Reference<?>, Object>
+    buffer_owners = new java.util.concurrent.ConcurrentHashMap<
+      java.lang.ref.Reference<?>, Object>();
+
+  /* Keep owner reachable for as long as buffer is. */
+  static <T extends java.nio.Buffer> T retain_buffer(T buffer, Object owner)
+  {
+    java.lang.ref.Reference<?> ref;
+    while ((ref = buffer_queue.poll()) != null)
+      buffer_owners.remove(ref);
+    buffer_owners.put(new java.lang.ref.PhantomReference<java.nio.Buffer>(
+      buffer, buffer_queue), owner);
+    return buffer;
+  }
+%}
+
+%inline {
+typedef jobject jbytebuffer;
+typedef jobject jfloatbuffer;
+}
+
+%typemap(jni) jbytebuffer "jobject"
+%typemap(jtype) jbytebuffer "java.nio.ByteBuffer"
+%typemap(jstype) jbytebuffer "java.nio.ByteBuffer"
+%typemap(javaout) jbytebuffer { return $jnicall; }
+%typemap(out) jbytebuffer "$result = $1;"
+
+%typemap(jni) jfloatbuffer "jobject"
+%typemap(jtype) jfloatbuffer "java.nio.FloatBuffer"
+%typemap(jstype) jfloatbuffer "java.nio.FloatBuffer"
+%typemap(javain) jfloatbuffer "$javainput"
+%typemap(in) jfloatbuffer "$1 = $input;"
+
+%javamethodmodifiers sigrok::Logic::_data_buffer "private";
+%javamethodmodifiers sigrok::Analog::_data_buffer "private";
+%javamethodmodifiers sigrok::Analog::_data_as_float "private";
+
+%extend sigrok::Logic
+{
+  jbytebuffer _data_buffer(JNIEnv *env)
+  {
+    return env->NewDirectByteBuffer($self->data_pointer(),
+      $self->data_length());
+  }
+}
+
+%typemap(javacode) sigrok::Logic %{
+  /**
+   * Sample data as a read-only direct buffer over the packet's memory,
+   * unit_size() bytes per sample. Samples are little endian, channel 0
+   * is the least significant bit.
+   */
+  public java.nio.ByteBuffer data_buffer() {
+    return classes.retain_buffer(_data_buffer().asReadOnlyBuffer()
+      .order(java.nio.ByteOrder.LITTLE_ENDIAN), this);
+  }
+%}
+
+%extend sigrok::Analog
+{
+  jbytebuffer _data_buffer(JNIEnv *env)
+  {
+    return env->NewDirectByteBuffer($self->data_pointer(),
+      (jlong)$self->num_samples() * $self->channels().size()
+        * $self->unitsize());
+  }
+
+  /* Convert into a direct buffer in native order, at position pos. */
+  void _data_as_float(JNIEnv *env, jfloatbuffer dest, int pos)
+  {
+    size_t count = (size_t)$self->num_samples() * $self->channels().size();
+    float *data = (float *)env->GetDirectBufferAddress(dest);
+    if (!data || pos < 0 || env->GetDirectBufferCapacity(dest) < pos
+        || (size_t)(env->GetDirectBufferCapacity(dest) - pos) < count)
+      throw sigrok::Error(SR_ERR_ARG);
+    $self->get_data_as_float(data + pos);
+  }
+}
+
+%typemap(javacode) sigrok::Analog %{
+  /** Description of the raw sample data in data_buffer(). */
+  public static final class Encoding {
+    /** Size of a sample in bytes. */
+    public final int unit_size;
+    /** Samples use a signed data type. */
+    public final boolean is_signed;
+    /** Samples use float. */
+    public final boolean is_float;
+    /** Byte order of the samples. */
+    public final java.nio.ByteOrder order;
+    /** Scale and offset which turn samples into values. */
+    public final Rational scale, offset;
+
+    Encoding(Analog analog) {
+      unit_size = (int)analog.unitsize();
+      is_signed = analog.is_signed();
+      is_float = analog.is_float();
+      order = analog.is_bigendian() ? java.nio.ByteOrder.BIG_ENDIAN
+        : java.nio.ByteOrder.LITTLE_ENDIAN;
+      scale = analog.scale();
+      offset = analog.offset();
+    }
+  }
+
+  /** Encoding of the raw sample data. */
+  public Encoding encoding() {
+    return new Encoding(this);
+  }
+
+  /**
+   * Raw sample data as a read-only direct buffer over the packet's
+   * memory, in the byte order of the encoding. Holds num_samples()
+   * samples of each channel in turn.
+   */
+  public java.nio.ByteBuffer data_buffer() {
+    java.nio.ByteOrder order = is_bigendian() ?
+      java.nio.ByteOrder.BIG_ENDIAN : java.nio.ByteOrder.LITTLE_ENDIAN;
+    return classes.retain_buffer(_data_buffer().asReadOnlyBuffer()
+      .order(order), this);
+  }
+
+  /**
+   * Convert the samples of all channels to float values, into dest at
+   * its position. Advances the position past the values. Direct buffers
+   * in native order get written without a copy.
+   */
+  public void get_data_as_float(java.nio.FloatBuffer dest) {
+    int count = (int)num_samples() * (int)channels().size();
+    if (dest.remaining() < count)
+      throw new java.nio.BufferOverflowException();
+    if (!dest.isDirect() || dest.isReadOnly()
+        || dest.order() != java.nio.ByteOrder.nativeOrder()) {
+      java.nio.FloatBuffer temp = java.nio.ByteBuffer
+        .allocateDirect(count * 4)
+        .order(java.nio.ByteOrder.nativeOrder()).asFloatBuffer();
+      get_data_as_float(temp);
+      temp.flip();
+      dest.put(temp);
+      return;
+    }
+    _data_as_float(dest, dest.position());
+    dest.position(dest.position() + count);
+  }
+%}
+
 %include "doc.i"
 
 %define %enumextras(Class)
@@ -71,6 +71,59 @@ typedef guint pyg_flags_type;
 #define string_to_python PyString_FromString
 #endif
 
+/* Capsule which keeps a packet alive while NumPy arrays use its data. */
+static void packet_capsule_free(PyObject *capsule)
+{
+    delete static_cast<std::shared_ptr<sigrok::Packet> *>(
+        PyCapsule_GetPointer(capsule, "sigrok.Packet"));
+}
+
+/* Wrap packet data in a read-only NumPy array, without copying. */
+static PyObject *packet_array(std::shared_ptr<sigrok::Packet> packet,
+    int nd, npy_intp *dims, PyArray_Descr *descr, void *data)
+{
+    PyObject *array = PyArray_NewFromDescr(&PyArray_Type, descr, nd, dims,
+        NULL, data, NPY_ARRAY_CARRAY_RO, NULL);
+    if (!array || !packet)
+        return array;
+
+    PyObject *capsule = PyCapsule_New(
+        new std::shared_ptr<sigrok::Packet>(packet), "sigrok.Packet",
+        packet_capsule_free);
+    /* PyArray_SetBaseObject() steals the capsule, even upon failure. */
+    if (!capsule || PyArray_SetBaseObject((PyArrayObject *)array, capsule) < 0) {
+        Py_DECREF(array);
+        return NULL;
+    }
+
+    return array;
+}
+
+/* NumPy type of the raw sample data of an analog payload. */
+static PyArray_Descr *analog_descr(sigrok::Analog *analog)
+{
+    unsigned int unitsize = analog->unitsize();
+    int typenum;
+
+    if (analog->is_float())
+        typenum = unitsize == 8 ? NPY_FLOAT64 : NPY_FLOAT32;
+    else if (unitsize == 1)
+        typenum = analog->is_signed() ? NPY_INT8 : NPY_UINT8;
+    else if (unitsize == 2)
+        typenum = analog->is_signed() ? NPY_INT16 : NPY_UINT16;
+    else if (unitsize == 4)
+        typenum = analog->is_signed() ? NPY_INT32 : NPY_UINT32;
+    else
+        typenum = analog->is_signed() ? NPY_INT64 : NPY_UINT64;
+
+    PyArray_Descr *native = PyArray_DescrFromType(typenum);
+    PyArray_Descr *descr = PyArray_DescrNewByteorder(native,
+        analog->is_bigendian() ? NPY_BIG : NPY_LITTLE);
+    Py_DECREF(native);
+
+    return descr;
+}
+
 %}
 
 %init %{
@@ -401,6 +454,9 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
 /* Ignore these methods, we will override them below. */
 %ignore sigrok::Analog::data;
 %ignore sigrok::Logic::data;
+%ignore sigrok::Logic::channel_bits;
+%ignore sigrok::Logic::unpack_channels;
+%ignore sigrok::Logic::edges;
 %ignore sigrok::Driver::scan;
 %ignore sigrok::InputFormat::create_input;
 %ignore sigrok::OutputFormat::create_output;
@@ -458,8 +514,209 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
 }
 %enddef
 
+/* Run the session without holding the GIL, callbacks take it as needed. */
+%exception sigrok::Session::run {
+    PyThreadState *thread_state = PyEval_SaveThread();
+    try {
+        $action
+    } catch (sigrok::Error &e) {
+        PyEval_RestoreThread(thread_state);
+        SWIG_exception(swig_exception_code(e.result),
+            const_cast<char*>(e.what()));
+    }
+    PyEval_RestoreThread(thread_state);
+}
+
 %include "../../../swig/classes.i"
 
+%{
+/*
+ * Collects the samples of a session's datafeed, and passes them to a
+ * Python callback in batches. The collection runs without the GIL and
+ * without Python objects, the GIL is only taken once per batch.
+ */
+class DatafeedBatcher
+{
+public:
+    DatafeedBatcher(sigrok::Session *session, PyObject *callback,
+            size_t batch_samples, unsigned int window_ms) :
+        _session(session),
+        _callback(callback),
+        _batch_samples(batch_samples ? batch_samples : 1),
+        _window_us((gint64)window_ms * 1000)
+    {
+        Py_INCREF(_callback);
+    }
+
+    ~DatafeedBatcher()
+    {
+        const auto gstate = PyGILState_Ensure();
+        Py_DECREF(_callback);
+        PyGILState_Release(gstate);
+    }
+
+    void packet(sigrok::Device *device, const sigrok::PacketView &view)
+    {
+        const struct sr_datafeed_packet *pkt = view.structure();
+        Batch &batch = _batches[device];
+
+        if (pkt->type == SR_DF_LOGIC) {
+            if (batch.unitsize && batch.unitsize != view.logic_unit_size())
+                flush(device, batch);
+            batch.unitsize = view.logic_unit_size();
+            if (batch.logic.capacity() < _batch_samples * batch.unitsize)
+                batch.logic.reserve(_batch_samples * batch.unitsize);
+            auto data = static_cast<const uint8_t *>(view.logic_data());
+            batch.logic.insert(batch.logic.end(), data,
+                data + view.logic_length());
+            batch.num_samples = MAX(batch.num_samples,
+                batch.logic.size() / batch.unitsize);
+        } else if (pkt->type == SR_DF_ANALOG) {
+            /* The values are of the packet's first channel. */
+            auto analog = static_cast<const struct sr_datafeed_analog *>(
+                pkt->payload);
+            if (!analog->meaning || !analog->meaning->channels)
+                return;
+            auto ch = static_cast<struct sr_channel *>(
+                analog->meaning->channels->data);
+            auto &values = batch.analog[ch->name];
+            if (values.capacity() < _batch_samples)
+                values.reserve(_batch_samples);
+            size_t pos = values.size();
+            values.resize(pos + analog->num_samples);
+            if (sr_analog_to_float(analog, values.data() + pos) != SR_OK)
+                values.resize(pos);
+            batch.num_samples = MAX(batch.num_samples, values.size());
+        } else if (pkt->type == SR_DF_END) {
+            flush(device, batch);
+            return;
+        } else {
+            return;
+        }
+
+        if (!batch.start_time)
+            batch.start_time = g_get_monotonic_time();
+        if (batch.num_samples >= _batch_samples || (_window_us
+                && g_get_monotonic_time() - batch.start_time >= _window_us))
+            flush(device, batch);
+    }
+
+private:
+    struct Batch
+    {
+        unsigned int unitsize = 0;
+        std::vector<uint8_t> logic;
+        std::map<std::string, std::vector<float> > analog;
+        size_t num_samples = 0;
+        gint64 start_time = 0;
+    };
+
+    /* Pass a batch to the callback as (device, logic, analog). */
+    void flush(sigrok::Device *device, Batch &batch)
+    {
+        if (!batch.num_samples)
+            return;
+
+        const auto gstate = PyGILState_Ensure();
+
+        PyObject *logic_obj = Py_None;
+        Py_INCREF(logic_obj);
+        if (!batch.logic.empty()) {
+            npy_intp dims[2];
+            dims[0] = batch.logic.size() / batch.unitsize;
+            dims[1] = batch.unitsize;
+            Py_DECREF(logic_obj);
+            logic_obj = PyArray_SimpleNew(2, dims, NPY_UINT8);
+            if (logic_obj)
+                memcpy(PyArray_DATA((PyArrayObject *)logic_obj),
+                    batch.logic.data(), dims[0] * dims[1]);
+        }
+
+        PyObject *analog_obj = PyDict_New();
+        for (auto &entry : batch.analog) {
+            if (entry.second.empty())
+                continue;
+            npy_intp dims[1];
+            dims[0] = entry.second.size();
+            PyObject *array = PyArray_SimpleNew(1, dims, NPY_FLOAT32);
+            if (!array)
+                continue;
+            memcpy(PyArray_DATA((PyArrayObject *)array),
+                entry.second.data(), dims[0] * sizeof(float));
+            PyDict_SetItemString(analog_obj, entry.first.c_str(), array);
+            Py_DECREF(array);
+        }
+
+        PyObject *device_obj = Py_None;
+        Py_INCREF(device_obj);
+        for (auto &dev : _session->devices()) {
+            if (dev.get() != device)
+                continue;
+            Py_DECREF(device_obj);
+            device_obj = SWIG_NewPointerObj(
+                SWIG_as_voidptr(new std::shared_ptr<sigrok::Device>(dev)),
+                SWIGTYPE_p_std__shared_ptrT_sigrok__Device_t,
+                SWIG_POINTER_OWN);
+        }
+
+        PyObject *result = NULL;
+        if (logic_obj && analog_obj) {
+            auto arglist = Py_BuildValue("(OOO)", device_obj, logic_obj,
+                analog_obj);
+            result = PyEval_CallObject(_callback, arglist);
+            Py_XDECREF(arglist);
+        }
+        if (PyErr_Occurred())
+            PyErr_Print();
+
+        Py_XDECREF(result);
+        Py_XDECREF(device_obj);
+        Py_XDECREF(logic_obj);
+        Py_XDECREF(analog_obj);
+        PyGILState_Release(gstate);
+
+        /* Keep the memory, for the next batch. */
+        batch.logic.clear();
+        for (auto &entry : batch.analog)
+            entry.second.clear();
+        batch.num_samples = 0;
+        batch.start_time = 0;
+    }
+
+    sigrok::Session *_session;
+    PyObject *_callback;
+    size_t _batch_samples;
+    gint64 _window_us;
+    std::map<sigrok::Device *, Batch> _batches;
+};
+%}
+
+/*
+ * Receive the datafeed in batches of samples, see DatafeedBatcher. The
+ * callback gets (device, logic, analog): logic is a NumPy array of the
+ * logic samples with one row per sample (or None), analog is a dict of
+ * NumPy float32 arrays, by channel name. A batch is passed on when it
+ * holds batch_samples samples, when window_ms passed since its first
+ * sample (if not 0), and at the end of the acquisition.
+ */
+%extend sigrok::Session
+{
+    void add_datafeed_batch_callback(PyObject *callback,
+        unsigned int batch_samples = 65536, unsigned int window_ms = 0)
+    {
+        if (!PyCallable_Check(callback))
+            throw sigrok::Error(SR_ERR_ARG);
+
+        auto batcher = std::make_shared<DatafeedBatcher>($self, callback,
+            batch_samples, window_ms);
+        $self->add_datafeed_view_callback(
+            [batcher] (sigrok::Device *device,
+                    const sigrok::PacketView &view) {
+                batcher->packet(device, view);
+            });
+    }
+}
+
 /* Support Driver.scan() with keyword arguments. */
 %extend sigrok::Driver
 {
@@ -539,27 +796,73 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
     }
 }
 
-/* Return NumPy array from Analog::data(). */
+/*
+ * NumPy arrays of analog data. Analog.data holds the values as float32,
+ * Analog.data_float64 as float64, both converted unless the packet
+ * already holds native float32 values without scale and offset.
+ * Analog.raw_data holds the sample data as sent by the device, use
+ * Analog.scale and Analog.offset to interpret it.
+ *
+ * The arrays which reference the packet's data are read-only, and hold
+ * a reference to the packet.
+ */
 %extend sigrok::Analog
 {
     PyObject * _data()
     {
-        int nd = 2;
         npy_intp dims[2];
         dims[0] = $self->channels().size();
         dims[1] = $self->num_samples();
-        int typenum = NPY_FLOAT;
-        void *data = $self->data_pointer();
-        return PyArray_SimpleNewFromData(nd, dims, typenum, data);
+        auto scale = $self->scale();
+        auto offset = $self->offset();
+#ifdef WORDS_BIGENDIAN
+        bool native = $self->is_bigendian();
+#else
+        bool native = !$self->is_bigendian();
+#endif
+        if ($self->is_float() && $self->unitsize() == sizeof(float) && native
+                && scale->numerator() == (int64_t)scale->denominator()
+                && offset->numerator() == 0)
+            return packet_array($self->parent(), 2, dims,
+                PyArray_DescrFromType(NPY_FLOAT32), $self->data_pointer());
+
+        PyObject *array = PyArray_SimpleNew(2, dims, NPY_FLOAT32);
+        if (array)
+            $self->get_data_as_float(
+                (float *)PyArray_DATA((PyArrayObject *)array));
+        return array;
+    }
+
+    PyObject * _data_float64()
+    {
+        npy_intp dims[2];
+        dims[0] = $self->channels().size();
+        dims[1] = $self->num_samples();
+        PyObject *array = PyArray_SimpleNew(2, dims, NPY_FLOAT64);
+        if (array)
+            $self->get_data_as_double(
+                (double *)PyArray_DATA((PyArrayObject *)array));
+        return array;
+    }
+
+    PyObject * _raw_data()
+    {
+        npy_intp dims[2];
+        dims[0] = $self->channels().size();
+        dims[1] = $self->num_samples();
+        return packet_array($self->parent(), 2, dims, analog_descr($self),
+            $self->data_pointer());
     }
 
 %pythoncode
 {
     data = property(_data)
+    data_float64 = property(_data_float64)
+    raw_data = property(_raw_data)
 }
 }
 
-/* Return NumPy array from Logic::data(). */
+/* Return NumPy array from Logic::data(), it holds a reference to the packet. */
 %extend sigrok::Logic
 {
     PyObject * _data()
@@ -567,9 +870,89 @@ std::map<std::string, Glib::VariantBase> dict_to_map_options(PyObject *dict,
         npy_intp dims[2];
         dims[0] = $self->data_length() / $self->unit_size();
         dims[1] = $self->unit_size();
-        int typenum = NPY_UINT8;
-        void *data = $self->data_pointer();
-        return PyArray_SimpleNewFromData(2, dims, typenum, data);
+        return packet_array($self->parent(), 2, dims,
+            PyArray_DescrFromType(NPY_UINT8), $self->data_pointer());
+    }
+
+    /* Packed bits of one channel, the first sample in bit 0. */
+    PyObject * channel_bits(unsigned int channel)
+    {
+        npy_intp dims[1];
+        dims[0] = ($self->num_samples() + 7) / 8;
+        PyObject *array = PyArray_SimpleNew(1, dims, NPY_UINT8);
+        if (!array)
+            return nullptr;
+        try {
+            $self->channel_bits(channel,
+                (uint8_t *)PyArray_DATA((PyArrayObject *)array));
+        } catch (...) {
+            Py_DECREF(array);
+            throw;
+        }
+        return array;
+    }
+
+    /* Array of 0 and 1 per channel and sample, optionally into out. */
+    PyObject * unpack_channels(PyObject *channels, PyObject *out = Py_None)
+    {
+        std::vector<unsigned int> indices;
+        PyObject *seq = PySequence_Fast(channels, "channels must be a sequence");
+        if (!seq)
+            return nullptr;
+        for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); i++) {
+            long index = PyLong_AsLong(PySequence_Fast_GET_ITEM(seq, i));
+            if (index < 0) {
+                Py_DECREF(seq);
+                if (!PyErr_Occurred())
+                    PyErr_SetString(PyExc_ValueError, "invalid channel index");
+                return nullptr;
+            }
+            indices.push_back(index);
+        }
+        Py_DECREF(seq);
+
+        npy_intp dims[2];
+        dims[0] = indices.size();
+        dims[1] = $self->num_samples();
+        PyObject *array;
+        if (out == Py_None) {
+            array = PyArray_SimpleNew(2, dims, NPY_UINT8);
+            if (!array)
+                return nullptr;
+        } else {
+            PyArrayObject *a = (PyArrayObject *)out;
+            if (!PyArray_Check(out) || PyArray_TYPE(a) != NPY_UINT8
+                    || !PyArray_ISCARRAY(a)
+                    || PyArray_SIZE(a) != dims[0] * dims[1]) {
+                PyErr_SetString(PyExc_ValueError,
+                    "out must be a writable C contiguous uint8 array "
+                    "of len(channels) * num_samples elements");
+                return nullptr;
+            }
+            Py_INCREF(out);
+            array = out;
+        }
+        try {
+            $self->unpack_channels(indices,
+                (uint8_t *)PyArray_DATA((PyArrayObject *)array));
+        } catch (...) {
+            Py_DECREF(array);
+            throw;
+        }
+        return array;
+    }
+
+    /* Indices of the samples where a channel changes state. */
+    PyObject * edges(unsigned int channel)
+    {
+        auto edges = $self->edges(channel);
+        npy_intp dims[1];
+        dims[0] = edges.size();
+        PyObject *array = PyArray_SimpleNew(1, dims, NPY_UINT64);
+        if (array)
+            std::copy(edges.begin(), edges.end(),
+                (uint64_t *)PyArray_DATA((PyArrayObject *)array));
+        return array;
     }
 
 %pythoncode
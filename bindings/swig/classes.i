@@ -80,6 +80,17 @@ template< class T > class enable_shared_from_this;
 #define SR_PRIV
 
 %ignore sigrok::DatafeedCallbackData;
+%ignore sigrok::PacketView;
+%ignore sigrok::Session::add_datafeed_view_callback;
+%ignore sigrok::PacketStream;
+%ignore sigrok::StreamPacket;
+%ignore sigrok::Session::packet_stream;
+%ignore sigrok::Context::create_logic_packets;
+%ignore sigrok::Context::create_analog_packets;
+%ignore sigrok::Output::receive(std::shared_ptr<Packet>,
+    std::function<void(const char *, size_t)>);
+%ignore sigrok::Output::receive(std::shared_ptr<Packet>, std::ostream &);
+%ignore sigrok::Output::receive(std::shared_ptr<Packet>, std::vector<char> &);
 
 #ifndef SWIGJAVA
 
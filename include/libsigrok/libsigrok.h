@@ -169,16 +169,56 @@ enum sr_packettype {
 	SR_DF_TRIGGER,
 	/** Payload is struct sr_datafeed_logic. */
 	SR_DF_LOGIC,
-	/** Beginning of frame. No payload. */
+	/**
+	 * Beginning of frame. Payload is NULL, or struct sr_datafeed_frame
+	 * (since 0.6.0).
+	 */
 	SR_DF_FRAME_BEGIN,
 	/** End of frame. No payload. */
 	SR_DF_FRAME_END,
 	/** Payload is struct sr_datafeed_analog. */
 	SR_DF_ANALOG,
+	/** Payload is struct sr_datafeed_logic_rle. @since 0.6.0 */
+	SR_DF_LOGIC_RLE,
+	/** Payload is struct sr_datafeed_logic_planar. @since 0.6.0 */
+	SR_DF_LOGIC_PLANAR,
 
 	/* Update datafeed_dump() (session.c) upon changes! */
 };
 
+/**
+ * Bit for a packet type in datafeed subscription masks.
+ *
+ * @see sr_session_datafeed_subscribe().
+ * @since 0.6.0
+ */
+#define SR_DF_TYPE_MASK(type) (1U << ((type) - SR_DF_HEADER))
+
+/**
+ * Subscription mask for all packet types, except for SR_DF_LOGIC_RLE
+ * and SR_DF_LOGIC_PLANAR. Subscribers which don't ask for run-length
+ * encoded or planar logic data get it expanded into SR_DF_LOGIC packets.
+ *
+ * @since 0.6.0
+ */
+#define SR_DF_TYPE_MASK_ALL (~(SR_DF_TYPE_MASK(SR_DF_LOGIC_RLE) \
+	| SR_DF_TYPE_MASK(SR_DF_LOGIC_PLANAR)))
+
+/**
+ * Policy for full queues in threaded datafeed dispatch.
+ *
+ * @see sr_session_datafeed_dispatch_set().
+ * @since 0.6.0
+ */
+enum sr_datafeed_overflow {
+	/** Block the sender until the consumer has made room. */
+	SR_DF_OVERFLOW_BLOCK = 10000,
+	/** Drop the packet to be queued (logic and analog data only). */
+	SR_DF_OVERFLOW_DROP_NEWEST,
+	/** Stop the session and return an error to the sender. */
+	SR_DF_OVERFLOW_FAIL_SESSION,
+};
+
 /** Measured quantity, sr_analog_meaning.mq. */
 enum sr_mq {
 	SR_MQ_VOLTAGE = 10000,
@@ -482,6 +522,22 @@ struct sr_context;
  */
 struct sr_session;
 
+/**
+ * @struct sr_session_file
+ * Opaque structure representing a session file opened for random access.
+ *
+ * @see sr_session_file_open(), sr_session_file_close().
+ */
+struct sr_session_file;
+
+/**
+ * @struct sr_session_file_meta
+ * Opaque structure holding the parsed metadata of a session file.
+ *
+ * @see sr_session_file_meta_get(), sr_session_file_meta_unref().
+ */
+struct sr_session_file_meta;
+
 struct sr_rational {
 	/** Numerator of the rational number. */
 	int64_t p;
@@ -495,6 +551,29 @@ struct sr_datafeed_packet {
 	const void *payload;
 };
 
+/**
+ * Host timing of a logic or analog packet in a sigrok data feed.
+ *
+ * @see sr_packet_timestamp_get().
+ * @since 0.6.0
+ */
+struct sr_datafeed_timestamp {
+	/** Monotonic host time at which the driver received the data, in us. */
+	int64_t host_us;
+	/**
+	 * Number of samples which the device sent before this packet,
+	 * since its header. Analog packets count the samples of their
+	 * first channel.
+	 */
+	uint64_t sample_pos;
+	/**
+	 * Estimated monotonic host time of the packet's first sample, in
+	 * us. It's on the same timebase for all devices of a session, see
+	 * sr_session_clock_get().
+	 */
+	int64_t aligned_us;
+};
+
 /** Header of a sigrok data feed. */
 struct sr_datafeed_header {
 	int feed_version;
@@ -513,6 +592,63 @@ struct sr_datafeed_logic {
 	void *data;
 };
 
+/**
+ * Frame datafeed payload for type SR_DF_FRAME_BEGIN.
+ *
+ * @since 0.6.0
+ */
+struct sr_datafeed_frame {
+	/**
+	 * Position of the frame's first sample in the device's sample
+	 * stream, counting samples which were not sent as well.
+	 */
+	uint64_t sample_pos;
+};
+
+/**
+ * Run-length encoded logic datafeed payload for type SR_DF_LOGIC_RLE.
+ *
+ * Holds runs of identical samples. Run i consists of lengths[i] samples
+ * with the value at values + i * unitsize, in the same layout as the
+ * samples of struct sr_datafeed_logic.
+ *
+ * @since 0.6.0
+ */
+struct sr_datafeed_logic_rle {
+	/** Number of runs. */
+	uint64_t num_runs;
+	/** Size of a sample value in bytes. */
+	uint16_t unitsize;
+	/** Sample values of the runs, num_runs * unitsize bytes. */
+	void *values;
+	/** Number of samples in each run, all at least 1. */
+	uint64_t *lengths;
+};
+
+/**
+ * Planar logic datafeed payload for type SR_DF_LOGIC_PLANAR.
+ *
+ * Holds a bit plane per channel. The plane of the channel at bit i of
+ * the samples of struct sr_datafeed_logic starts at data + i * stride.
+ * Bit n % 8 of byte n / 8 of a plane holds sample n, bits past the
+ * last sample have no meaning.
+ *
+ * @since 0.6.0
+ */
+struct sr_datafeed_logic_planar {
+	/** Number of samples. */
+	uint64_t num_samples;
+	/** Size of a sample in interleaved layout, there are unitsize * 8 planes. */
+	uint16_t unitsize;
+	/**
+	 * Bytes from the start of a plane to the next, a multiple of 8
+	 * and at least (num_samples + 7) / 8.
+	 */
+	uint64_t stride;
+	/** The planes, unitsize * 8 * stride bytes. */
+	void *data;
+};
+
 /** Analog datafeed payload for type SR_DF_ANALOG. */
 struct sr_datafeed_analog {
 	void *data;
@@ -538,6 +674,37 @@ struct sr_analog_encoding {
 	struct sr_rational offset;
 };
 
+/** Result types of sr_analog_convert(). */
+enum sr_analog_type {
+	/** Raw codes as int16_t, no scale or offset applied. */
+	SR_ANALOG_TYPE_INT16 = 10000,
+	/** Raw codes as int32_t, no scale or offset applied. */
+	SR_ANALOG_TYPE_INT32,
+	/** Physical values as float. */
+	SR_ANALOG_TYPE_FLOAT,
+	/** Physical values as double. */
+	SR_ANALOG_TYPE_DOUBLE,
+};
+
+/**
+ * Raw sample data of an analog payload, from sr_analog_get_raw().
+ *
+ * Physical values are raw code * scale + offset.
+ */
+struct sr_analog_raw {
+	/** Sample data as sent by the device, not copied. */
+	const void *data;
+	/** Number of values, i.e. samples times channels. */
+	size_t count;
+	/** Size of one value in bytes. */
+	unsigned int unitsize;
+	gboolean is_signed;
+	gboolean is_float;
+	gboolean is_bigendian;
+	double scale;
+	double offset;
+};
+
 struct sr_analog_meaning {
 	enum sr_mq mq;
 	enum sr_unit unit;
@@ -555,6 +722,115 @@ struct sr_analog_spec {
 	int8_t spec_digits;
 };
 
+/** Number of packet types counted in struct sr_session_stats. */
+#define SR_STATS_PACKET_TYPES	(SR_DF_LOGIC_PLANAR - SR_DF_HEADER + 1)
+
+/** Number of bins in the latency histogram of struct sr_session_stage_stats. */
+#define SR_STATS_LATENCY_BINS	24
+
+/**
+ * Clock of a device in a session, estimated from the host times at
+ * which its data was received.
+ *
+ * @see sr_session_clock_get().
+ * @since 0.6.0
+ */
+struct sr_session_clock {
+	/** Samplerate of the device in Hz, as measured by the host clock. */
+	double samplerate;
+	/** Deviation from the nominal samplerate in ppm, 0 if the latter is unknown. */
+	double drift_ppm;
+	/** Estimated monotonic host time of the device's first sample, in us. */
+	int64_t offset_us;
+	/** Number of packets which the estimate is based on. */
+	uint64_t packets;
+};
+
+/**
+ * Datafeed throughput counters of a session, or of one of its devices.
+ *
+ * @see sr_session_stats_get().
+ * @since 0.6.0
+ */
+struct sr_session_stats {
+	/** Packets sent, indexed by packet type minus SR_DF_HEADER. */
+	uint64_t packets[SR_STATS_PACKET_TYPES];
+	/** Sample data bytes sent, indexed like @a packets. */
+	uint64_t bytes[SR_STATS_PACKET_TYPES];
+	/** Monotonic time of the first and of the last packet, in us. */
+	int64_t first_packet_us;
+	int64_t last_packet_us;
+	/** Longest gap between two consecutive packets, in us. */
+	uint64_t max_gap_us;
+	/** Packets dropped by threaded dispatch because a queue was full. */
+	uint64_t dropped_packets;
+	/** Number of consumer overruns reported by drivers. */
+	uint64_t overruns;
+	/** Sample position at which data was lost in the last overrun. */
+	uint64_t overrun_sample;
+	/** Gaps in the sample data reported by drivers, see SR_CONF_SAMPLES_LOST. */
+	uint64_t gaps;
+	/** Samples lost in all gaps, as far as they are known. */
+	uint64_t samples_lost;
+	/** Sample position of the last gap. */
+	uint64_t gap_sample;
+	/** Number of frames, and the shortest time between two of them. */
+	uint64_t frames;
+	uint64_t min_frame_gap_us;
+	/** Monotonic time of the last frame's beginning, in us. */
+	int64_t last_frame_us;
+	/** Latency probes which reached consumers, see sr_session_latency_probe(). */
+	uint64_t probes;
+	/** Cumulative and longest latency of the probes, in us. */
+	uint64_t probe_total_us;
+	uint64_t probe_max_us;
+	/**
+	 * Latency histogram of the probes, with the bins of
+	 * struct sr_session_stage_stats.
+	 */
+	uint64_t probe_hist[SR_STATS_LATENCY_BINS];
+	/** Readbacks of sample memory which devices started after a capture. */
+	uint64_t downloads;
+	/** Bytes received in the current readback, and its total size. */
+	uint64_t download_done;
+	uint64_t download_size;
+	/** Bytes received in all readbacks, and the time spent on them in us. */
+	uint64_t download_bytes;
+	uint64_t download_us;
+	/** Monotonic time of the last readback progress report, in us. */
+	int64_t download_last_us;
+	/** Periodic polls of devices, see sr_session_poll_add(). */
+	uint64_t polls;
+	/** Cumulative and largest time by which polls ran late, in us. */
+	uint64_t poll_late_total_us;
+	uint64_t poll_late_max_us;
+};
+
+/**
+ * Timing of one stage of the datafeed path, i.e. of a transform module
+ * or of a datafeed callback.
+ *
+ * @see sr_session_stage_stats_get().
+ * @since 0.6.0
+ */
+struct sr_session_stage_stats {
+	/** Transform module ID, or "callback N" for datafeed callbacks. */
+	char name[32];
+	/** Number of packets passed to this stage. */
+	uint64_t calls;
+	/** Sample data bytes passed to this stage. */
+	uint64_t bytes;
+	/** Cumulative and longest time spent in this stage, in us. */
+	uint64_t total_us;
+	uint64_t max_us;
+	/**
+	 * Latency histogram. Bin 0 counts runs which took less than 1 us,
+	 * bin n runs which took at least 2^(n-1) and less than 2^n us.
+	 * The last bin also counts all longer runs.
+	 */
+	uint64_t latency_hist[SR_STATS_LATENCY_BINS];
+};
+
 /** Generic option struct used by various subsystems. */
 struct sr_option {
 	/* Short name suitable for commandline usage, [a-z0-9-]. */
@@ -569,6 +845,28 @@ struct sr_option {
 	GSList *values;
 };
 
+/** Roles of threads, see sr_thread_affinity_set().
+ * @since 0.6.0
+ */
+enum sr_thread_role {
+	/** Threads which talk to devices: USB events, device workers. */
+	SR_THREAD_IO,
+	/** Threads which consume the data feed: callbacks, outputs. */
+	SR_THREAD_CONSUMER,
+};
+
+/** Scheduling policies of threads, see sr_thread_priority_set().
+ * @since 0.6.0
+ */
+enum sr_thread_sched {
+	/** The system's default, time sharing policy. */
+	SR_THREAD_SCHED_DEFAULT,
+	/** Realtime, first in first out (SCHED_FIFO). */
+	SR_THREAD_SCHED_FIFO,
+	/** Realtime, round robin (SCHED_RR). */
+	SR_THREAD_SCHED_RR,
+};
+
 /** Resource type.
  * @since 0.4.0
  */
@@ -592,14 +890,63 @@ struct sr_resource {
 enum sr_output_flag {
 	/** If set, this output module writes the output itself. */
 	SR_OUTPUT_INTERNAL_IO_HANDLING = 0x01,
+	/**
+	 * If set, this output module handles SR_DF_LOGIC_RLE packets.
+	 * Other modules get such packets as SR_DF_LOGIC packets.
+	 */
+	SR_OUTPUT_LOGIC_RLE = 0x02,
+	/**
+	 * If set, this output module handles SR_DF_LOGIC_PLANAR packets.
+	 * Other modules get such packets as SR_DF_LOGIC packets.
+	 */
+	SR_OUTPUT_LOGIC_PLANAR = 0x04,
+};
+
+/** Input module flags. */
+enum sr_input_flag {
+	/**
+	 * If set, this input module parses straight from a memory mapped
+	 * file (see sr_input_send_file()), without buffering a copy.
+	 */
+	SR_INPUT_MAPPED = 0x01,
+	/**
+	 * If set, this input module only handles text formats. Format
+	 * detection skips it for input which looks like binary data.
+	 */
+	SR_INPUT_TEXT = 0x02,
 };
 
 struct sr_input;
 struct sr_input_module;
 struct sr_output;
 struct sr_output_module;
+struct sr_output_sink;
+struct sr_shm_reader;
 struct sr_transform;
 struct sr_transform_module;
+struct sr_convert;
+
+/**
+ * Progress of a file conversion.
+ *
+ * @see sr_convert_progress_get().
+ * @since 0.6.0
+ */
+struct sr_convert_progress {
+	/** Bytes of the input file which were parsed, and its size. */
+	uint64_t bytes_read;
+	uint64_t bytes_total;
+	/** Logic and analog packets passed to the outputs, and their samples. */
+	uint64_t packets;
+	uint64_t samples;
+	/** Time since the conversion was started, in us. */
+	int64_t elapsed_us;
+	/** Throughput since the conversion was started. */
+	double bytes_per_second;
+	double samples_per_second;
+	/** Whether all stages have finished. */
+	gboolean done;
+};
 
 /** Constants for channel type. */
 enum sr_channeltype {
@@ -644,6 +991,19 @@ struct sr_config {
 	GVariant *data;
 };
 
+/** A configuration change, see sr_config_transaction_set(). */
+struct sr_config_change {
+	/** Channel group, or NULL. */
+	const struct sr_channel_group *cg;
+	/** Config key like SR_CONF_SAMPLERATE, etc. */
+	uint32_t key;
+	/** Key-specific data. */
+	GVariant *data;
+};
+
+/** Opaque structure collecting configuration changes. */
+struct sr_config_transaction;
+
 enum sr_keytype {
 	SR_KEY_CONFIG,
 	SR_KEY_MQ,
@@ -784,6 +1144,13 @@ enum sr_configkey {
 	 */
 	SR_CONF_FORCE_DETECT,
 
+	/**
+	 * Number of devices which a scan creates, for virtual devices
+	 * like the demo driver. The devices have the same channels.
+	 * @arg type: uint64
+	 */
+	SR_CONF_NUM_DEVICES,
+
 	/* Update sr_key_info_config[] (hwdriver.c) upon changes! */
 
 	/*--- Device (or channel group) configuration -----------------------*/
@@ -1083,6 +1450,14 @@ enum sr_configkey {
 	 */
 	SR_CONF_RESISTANCE_TARGET,
 
+	/**
+	 * Hysteresis of analog software triggers, in the unit of the
+	 * trigger channel. Edges only count after the signal was beyond
+	 * the trigger level by at least this much.
+	 * @arg type: double
+	 */
+	SR_CONF_TRIGGER_HYSTERESIS,
+
 	/* Update sr_key_info_config[] (hwdriver.c) upon changes! */
 
 	/*--- Special stuff -------------------------------------------------*/
@@ -1119,6 +1494,94 @@ enum sr_configkey {
 	/** Number of powerline cycles for ADC integration time. */
 	SR_CONF_ADC_POWERLINE_CYCLES,
 
+	/**
+	 * Bounds of the time span of sample data which one USB transfer
+	 * holds, in ms. The driver adapts within these bounds at runtime.
+	 * @arg type: uint64 range
+	 */
+	SR_CONF_USB_TRANSFER_MSEC,
+
+	/**
+	 * Bounds of the time span of sample data which all USB transfers
+	 * together hold, in ms.
+	 * @arg type: uint64 range
+	 */
+	SR_CONF_USB_BUFFER_MSEC,
+
+	/**
+	 * Generate data as fast as possible, instead of at the samplerate.
+	 * @arg type: boolean
+	 * @arg get: @b true if data generation is not paced
+	 */
+	SR_CONF_UNTHROTTLED,
+
+	/**
+	 * Interval between latency probes in the datafeed, in ms.
+	 * 0 disables the probes.
+	 * @arg type: uint64
+	 */
+	SR_CONF_LATENCY_PROBE_MSEC,
+
+	/**
+	 * Latency probe. Only sent in SR_DF_META packets, holds the
+	 * monotonic time the packet was generated at, in us.
+	 * @see sr_session_latency_probe().
+	 * @arg type: uint64
+	 */
+	SR_CONF_LATENCY_PROBE,
+
+	/**
+	 * Prefilter which was applied to the analog chunks of the
+	 * capturefile ("none", "shuffle" or "delta").
+	 * @arg type: string
+	 */
+	SR_CONF_CAPTURE_ANALOG_FILTER,
+
+	/**
+	 * Size of the blocks of sample data which a session file replay
+	 * reads and sends at a time, in bytes.
+	 * @arg type: uint64
+	 */
+	SR_CONF_REPLAY_CHUNK_SIZE,
+
+	/**
+	 * Number of blocks which a session file replay decompresses
+	 * ahead of the consumers, in a separate thread. 0 reads them
+	 * in the main loop.
+	 * @arg type: uint64
+	 */
+	SR_CONF_REPLAY_READ_AHEAD,
+
+	/**
+	 * Replay the logic data and all analog channels of a session file
+	 * in time order, block by block, instead of one after the other.
+	 * @arg type: boolean
+	 */
+	SR_CONF_REPLAY_INTERLEAVED,
+
+	/**
+	 * Number of bytes of the session file which get read ahead of the
+	 * decompressor, in a separate thread. 0 disables the prefetch.
+	 * @arg type: uint64
+	 */
+	SR_CONF_REPLAY_PREFETCH,
+
+	/**
+	 * Samples lost by the device. Only sent in SR_DF_META packets,
+	 * holds the number of samples which were sent before the gap and
+	 * the number of lost samples (0 if unknown).
+	 * @see sr_session_stats.
+	 * @arg type: uint64 range
+	 */
+	SR_CONF_SAMPLES_LOST,
+
+	/**
+	 * First frame of a session file which gets replayed. Files with
+	 * frames get replayed interleaved, with frame markers.
+	 * @arg type: uint64
+	 */
+	SR_CONF_REPLAY_FRAME,
+
 	/* Update sr_key_info_config[] (hwdriver.c) upon changes! */
 
 	/*--- Acquisition modes, sample limiting ----------------------------*/
@@ -1242,6 +1705,11 @@ struct sr_dev_driver {
 	/** Apply configuration settings to the device hardware.
 	 *  @see sr_config_commit().*/
 	int (*config_commit) (const struct sr_dev_inst *sdi);
+	/** Apply several configuration changes at once, optional.
+	 *  The changes have been checked already.
+	 *  @see sr_config_transaction_commit(). */
+	int (*config_set_batch) (const struct sr_dev_inst *sdi,
+			const struct sr_config_change *changes, size_t count);
 	/** List all possible values for a configuration key in a device instance.
 	 *  @see sr_config_list().
 	 */
@@ -1258,6 +1726,10 @@ struct sr_dev_driver {
 	int (*dev_acquisition_start) (const struct sr_dev_inst *sdi);
 	/** End data acquisition on the specified device. */
 	int (*dev_acquisition_stop) (struct sr_dev_inst *sdi);
+	/** Begin data acquisition again with the setup of the previous run,
+	 *  optional. SR_ERR_NA falls back to dev_acquisition_start().
+	 *  @see sr_session_rearm(). */
+	int (*dev_acquisition_rearm) (const struct sr_dev_inst *sdi);
 
 	/* Dynamic */
 	/** Device driver context, considered private. Initialized by init(). */
@@ -30,6 +30,10 @@
 
 SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 		float *buf);
+SR_API int sr_analog_convert(const struct sr_datafeed_analog *analog,
+		enum sr_analog_type type, void *outbuf);
+SR_API int sr_analog_get_raw(const struct sr_datafeed_analog *analog,
+		struct sr_analog_raw *raw);
 SR_API const char *sr_analog_si_prefix(float *value, int *digits);
 SR_API gboolean sr_analog_si_prefix_friendly(enum sr_unit unit);
 SR_API int sr_analog_unit_to_string(const struct sr_datafeed_analog *analog,
@@ -50,6 +54,20 @@ SR_API GSList *sr_buildinfo_libs_get(void);
 SR_API char *sr_buildinfo_host_get(void);
 SR_API char *sr_buildinfo_scpi_backends_get(void);
 
+/*--- memory.c --------------------------------------------------------------*/
+
+SR_API int sr_memory_budget_set(struct sr_context *ctx, uint64_t bytes);
+SR_API int sr_memory_budget_get(struct sr_context *ctx,
+		uint64_t *bytes, uint64_t *used);
+
+/*--- thread.c --------------------------------------------------------------*/
+
+SR_API int sr_thread_affinity_set(struct sr_context *ctx,
+		enum sr_thread_role role, const char *cpus);
+SR_API int sr_thread_priority_set(struct sr_context *ctx,
+		enum sr_thread_role role, enum sr_thread_sched sched, int priority);
+SR_API int sr_thread_numa_local_set(struct sr_context *ctx, gboolean enable);
+
 /*--- conversion.c ----------------------------------------------------------*/
 
 SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
@@ -57,6 +75,12 @@ SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
 SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
 		uint64_t count);
+SR_API int sr_a2l_threshold_multi(const struct sr_datafeed_analog **analogs,
+		size_t num_channels, const float *thresholds,
+		struct sr_datafeed_logic *logic);
+SR_API int sr_a2l_schmitt_trigger_multi(const struct sr_datafeed_analog **analogs,
+		size_t num_channels, const float *lo_thr, const float *hi_thr,
+		uint8_t *state, struct sr_datafeed_logic *logic);
 
 /*--- log.c -----------------------------------------------------------------*/
 
@@ -65,9 +89,13 @@ typedef int (*sr_log_callback)(void *cb_data, int loglevel,
 
 SR_API int sr_log_loglevel_set(int loglevel);
 SR_API int sr_log_loglevel_get(void);
+SR_API int sr_log_loglevel_set_module(const char *module, int loglevel);
+SR_API int sr_log_loglevel_get_module(const char *module);
+SR_API int sr_log_ratelimit_set(int per_second);
 SR_API int sr_log_callback_set(sr_log_callback cb, void *cb_data);
 SR_API int sr_log_callback_set_default(void);
 SR_API int sr_log_callback_get(sr_log_callback *cb, void **cb_data);
+SR_API int sr_log_async_set(gboolean enable);
 
 /*--- device.c --------------------------------------------------------------*/
 
@@ -84,6 +112,8 @@ SR_API GSList *sr_dev_list(const struct sr_dev_driver *driver);
 SR_API int sr_dev_clear(const struct sr_dev_driver *driver);
 SR_API int sr_dev_open(struct sr_dev_inst *sdi);
 SR_API int sr_dev_close(struct sr_dev_inst *sdi);
+SR_API int sr_dev_open_many(GSList *devices, int *results);
+SR_API int sr_dev_close_many(GSList *devices, int *results);
 
 SR_API struct sr_dev_driver *sr_dev_inst_driver_get(const struct sr_dev_inst *sdi);
 SR_API const char *sr_dev_inst_vendor_get(const struct sr_dev_inst *sdi);
@@ -101,10 +131,18 @@ SR_API int sr_dev_inst_channel_add(struct sr_dev_inst *sdi, int index, int type,
 /*--- hwdriver.c ------------------------------------------------------------*/
 
 SR_API struct sr_dev_driver **sr_driver_list(const struct sr_context *ctx);
+SR_API int sr_driver_list_select(struct sr_context *ctx,
+		const char *const *names);
+SR_API struct sr_dev_driver *sr_driver_get(struct sr_context *ctx,
+		const char *name);
 SR_API int sr_driver_init(struct sr_context *ctx,
 		struct sr_dev_driver *driver);
 SR_API GArray *sr_driver_scan_options_list(const struct sr_dev_driver *driver);
 SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options);
+typedef void (*sr_driver_scan_callback)(struct sr_dev_driver *driver,
+		GSList *devices, void *cb_data);
+SR_API int sr_driver_scan_all(struct sr_dev_driver **drivers, GSList *options,
+		sr_driver_scan_callback cb, void *cb_data);
 SR_API int sr_config_get(const struct sr_dev_driver *driver,
 		const struct sr_dev_inst *sdi,
 		const struct sr_channel_group *cg,
@@ -113,6 +151,21 @@ SR_API int sr_config_set(const struct sr_dev_inst *sdi,
 		const struct sr_channel_group *cg,
 		uint32_t key, GVariant *data);
 SR_API int sr_config_commit(const struct sr_dev_inst *sdi);
+SR_API struct sr_config_transaction *sr_config_transaction_new(
+		const struct sr_dev_inst *sdi);
+SR_API int sr_config_transaction_set(struct sr_config_transaction *txn,
+		const struct sr_channel_group *cg, uint32_t key, GVariant *data);
+SR_API int sr_config_transaction_commit(struct sr_config_transaction *txn);
+SR_API void sr_config_transaction_free(struct sr_config_transaction *txn);
+typedef void (*sr_config_notify_callback)(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, uint32_t key, GVariant *data,
+		void *cb_data);
+SR_API int sr_config_subscribe(const struct sr_dev_inst *sdi, uint32_t key,
+		sr_config_notify_callback cb, void *cb_data);
+SR_API int sr_config_unsubscribe(const struct sr_dev_inst *sdi,
+		sr_config_notify_callback cb, void *cb_data);
+SR_API int sr_config_get_cached(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, uint32_t key, GVariant **data);
 SR_API int sr_config_list(const struct sr_dev_driver *driver,
 		const struct sr_dev_inst *sdi,
 		const struct sr_channel_group *cg,
@@ -132,6 +185,41 @@ SR_API struct sr_trigger *sr_session_trigger_get(struct sr_session *session);
 SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 	struct sr_session **session);
 SR_API int sr_session_new(struct sr_context *ctx, struct sr_session **session);
+SR_API int sr_session_file_meta_get(struct sr_context *ctx,
+		const char *filename, struct sr_session_file_meta **meta);
+SR_API void sr_session_file_meta_unref(struct sr_session_file_meta *meta);
+SR_API int sr_session_file_meta_info(const struct sr_session_file_meta *meta,
+		uint64_t *samplerate, unsigned int *unitsize,
+		unsigned int *num_logic, unsigned int *num_analog,
+		uint64_t *num_samples);
+SR_API const char *sr_session_file_meta_channel_name(
+		const struct sr_session_file_meta *meta, unsigned int index);
+SR_API int sr_session_file_meta_gap(const struct sr_session_file_meta *meta,
+		unsigned int index, uint64_t *sample, uint64_t *count);
+SR_API int sr_session_file_meta_frame(const struct sr_session_file_meta *meta,
+		unsigned int index, uint64_t *sample, uint64_t *count,
+		int64_t *host_us);
+
+/* Random access to session files */
+SR_API int sr_session_file_open(const char *filename,
+		struct sr_session_file **file);
+SR_API void sr_session_file_close(struct sr_session_file *file);
+SR_API int sr_session_file_logic_info(struct sr_session_file *file,
+		uint64_t *samplerate, unsigned int *unitsize,
+		uint64_t *num_samples);
+SR_API int sr_session_file_read_logic(struct sr_session_file *file,
+		uint64_t start, uint64_t count, void *buf,
+		uint64_t *samples_read);
+SR_API int sr_session_file_read_analog(struct sr_session_file *file,
+		unsigned int channel, uint64_t start, uint64_t count,
+		float *buf, uint64_t *samples_read);
+SR_API int sr_session_file_read_logic_summary(struct sr_session_file *file,
+		uint64_t start, uint64_t count, uint64_t *block_size,
+		uint8_t *changed, uint32_t *transitions, uint64_t *num_blocks);
+SR_API int sr_session_file_read_analog_summary(struct sr_session_file *file,
+		unsigned int channel, uint64_t start, uint64_t count,
+		uint64_t *block_size, float *min, float *max,
+		uint64_t *num_blocks);
 SR_API int sr_session_destroy(struct sr_session *session);
 SR_API int sr_session_dev_remove_all(struct sr_session *session);
 SR_API int sr_session_dev_add(struct sr_session *session,
@@ -145,9 +233,34 @@ SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger
 SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session);
 SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 		sr_datafeed_callback cb, void *cb_data);
+SR_API int sr_session_datafeed_subscribe(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data, uint32_t type_mask,
+		GSList *channels);
+SR_API int sr_session_datafeed_dispatch_set(struct sr_session *session,
+		size_t queue_depth, int overflow);
+SR_API int sr_session_coalesce_set(struct sr_session *session,
+		uint32_t max_samples, unsigned int max_latency_ms);
+SR_API int sr_session_align_set(struct sr_session *session,
+		unsigned int max_latency_ms);
+SR_API int sr_session_clock_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, struct sr_session_clock *clock);
+SR_API int sr_session_device_threads_set(struct sr_session *session,
+		gboolean enable);
+SR_API int sr_session_stats_enable_set(struct sr_session *session,
+		gboolean enable);
+SR_API int sr_session_stats_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, struct sr_session_stats *stats);
+SR_API int sr_session_stage_stats_get(struct sr_session *session,
+		GSList **stages);
+SR_API int sr_session_latency_probe(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet);
+SR_API int sr_session_backpressure_set(struct sr_session *session,
+		unsigned int fill_percent);
 
 /* Session control */
 SR_API int sr_session_start(struct sr_session *session);
+SR_API int sr_session_rearm(struct sr_session *session);
 SR_API int sr_session_run(struct sr_session *session);
 SR_API int sr_session_stop(struct sr_session *session);
 SR_API int sr_session_is_running(struct sr_session *session);
@@ -157,6 +270,30 @@ SR_API int sr_session_stopped_callback_set(struct sr_session *session,
 SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		struct sr_datafeed_packet **copy);
 SR_API void sr_packet_free(struct sr_datafeed_packet *packet);
+SR_API int sr_packet_ref(const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_packet **ref);
+SR_API void sr_packet_unref(struct sr_datafeed_packet *packet);
+SR_API int sr_packet_timestamp_get(const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_timestamp *ts);
+
+/*--- logic_rle.c -----------------------------------------------------------*/
+
+SR_API int sr_logic_rle_encode(const struct sr_datafeed_logic *logic,
+		struct sr_datafeed_logic_rle **rle);
+SR_API uint64_t sr_logic_rle_num_samples(const struct sr_datafeed_logic_rle *rle);
+SR_API int sr_logic_rle_decode(const struct sr_datafeed_logic_rle *rle,
+		void *buf);
+SR_API void sr_logic_rle_free(struct sr_datafeed_logic_rle *rle);
+
+/*--- logic_planar.c --------------------------------------------------------*/
+
+SR_API int sr_logic_planar_encode(const struct sr_datafeed_logic *logic,
+		struct sr_datafeed_logic_planar **planar);
+SR_API int sr_logic_planar_decode(const struct sr_datafeed_logic_planar *planar,
+		void *buf);
+SR_API const uint8_t *sr_logic_planar_plane(
+		const struct sr_datafeed_logic_planar *planar, unsigned int index);
+SR_API void sr_logic_planar_free(struct sr_datafeed_logic_planar *planar);
 
 /*--- input/input.c ---------------------------------------------------------*/
 
@@ -176,6 +313,11 @@ SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in);
 SR_API const struct sr_input_module *sr_input_module_get(const struct sr_input *in);
 SR_API struct sr_dev_inst *sr_input_dev_inst_get(const struct sr_input *in);
 SR_API int sr_input_send(const struct sr_input *in, GString *buf);
+SR_API int sr_input_send_file(const struct sr_input *in,
+		const char *filename, gboolean *done);
+SR_API int sr_input_send_file_range(const struct sr_input *in,
+		const char *filename, uint64_t start, uint64_t count,
+		gboolean *done);
 SR_API int sr_input_end(const struct sr_input *in);
 SR_API int sr_input_reset(const struct sr_input *in);
 SR_API void sr_input_free(const struct sr_input *in);
@@ -198,7 +340,62 @@ SR_API gboolean sr_output_test_flag(const struct sr_output_module *omod,
 		uint64_t flag);
 SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out);
+SR_API int sr_output_send_sink(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_output_sink *sink);
 SR_API int sr_output_free(const struct sr_output *o);
+SR_API const struct sr_output *sr_output_new_async(
+		const struct sr_output_module *omod, GHashTable *params,
+		const struct sr_dev_inst *sdi, const char *filename,
+		struct sr_output_sink *sink, size_t queue_depth);
+
+typedef int (*sr_output_sink_callback)(const uint8_t *data, size_t len,
+		void *cb_data);
+
+SR_API struct sr_output_sink *sr_output_sink_new_fd(int fd);
+SR_API struct sr_output_sink *sr_output_sink_new_buffer(void);
+SR_API struct sr_output_sink *sr_output_sink_new_callback(
+		sr_output_sink_callback cb, void *cb_data);
+SR_API const uint8_t *sr_output_sink_buffer_get(
+		const struct sr_output_sink *sink, size_t *len);
+SR_API void sr_output_sink_buffer_clear(struct sr_output_sink *sink);
+SR_API int sr_output_sink_flush(struct sr_output_sink *sink);
+SR_API int sr_output_sink_free(struct sr_output_sink *sink);
+
+/*--- output/shmring.c ------------------------------------------------------*/
+
+SR_API int sr_shm_reader_open(const char *name, struct sr_shm_reader **reader);
+SR_API struct sr_dev_inst *sr_shm_reader_dev_inst_get(
+		const struct sr_shm_reader *reader);
+SR_API uint64_t sr_shm_reader_samplerate_get(const struct sr_shm_reader *reader);
+SR_API int sr_shm_reader_read(struct sr_shm_reader *reader,
+		const struct sr_datafeed_packet **packet);
+SR_API gboolean sr_shm_reader_closed(const struct sr_shm_reader *reader);
+SR_API void sr_shm_reader_close(struct sr_shm_reader *reader);
+
+/*--- convert.c -------------------------------------------------------------*/
+
+typedef void (*sr_convert_progress_callback)(
+		const struct sr_convert_progress *progress, void *cb_data);
+
+SR_API int sr_convert_new(struct sr_context *ctx, const struct sr_input *in,
+		struct sr_convert **conv);
+SR_API int sr_convert_transform_add(struct sr_convert *conv,
+		const struct sr_transform_module *tmod, GHashTable *options);
+SR_API int sr_convert_output_add(struct sr_convert *conv,
+		const struct sr_output_module *omod, GHashTable *options,
+		const char *filename, struct sr_output_sink *sink);
+SR_API int sr_convert_queue_depth_set(struct sr_convert *conv,
+		size_t queue_depth);
+SR_API int sr_convert_progress_callback_set(struct sr_convert *conv,
+		sr_convert_progress_callback cb, void *cb_data);
+SR_API int sr_convert_start(struct sr_convert *conv, const char *filename);
+SR_API int sr_convert_wait(struct sr_convert *conv);
+SR_API int sr_convert_run(struct sr_convert *conv, const char *filename);
+SR_API int sr_convert_cancel(struct sr_convert *conv);
+SR_API int sr_convert_progress_get(struct sr_convert *conv,
+		struct sr_convert_progress *progress);
+SR_API void sr_convert_free(struct sr_convert *conv);
 
 /*--- transform/transform.c -------------------------------------------------*/
 
@@ -212,6 +409,7 @@ SR_API void sr_transform_options_free(const struct sr_option **opts);
 SR_API const struct sr_transform *sr_transform_new(const struct sr_transform_module *tmod,
 		GHashTable *params, const struct sr_dev_inst *sdi);
 SR_API int sr_transform_free(const struct sr_transform *t);
+SR_API GSList *sr_transform_channels_get(const struct sr_transform *t);
 
 /*--- trigger.c -------------------------------------------------------------*/
 
@@ -241,6 +439,8 @@ SR_API int sr_resource_set_hooks(struct sr_context *ctx,
 		sr_resource_open_callback open_cb,
 		sr_resource_close_callback close_cb,
 		sr_resource_read_callback read_cb, void *cb_data);
+SR_API int sr_resource_preload(struct sr_context *ctx, int type,
+		const char *name);
 
 /*--- strutil.c -------------------------------------------------------------*/
 
@@ -158,26 +158,113 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
 }
 
 /**
- * Convert an analog datafeed payload to an array of floats.
+ * Send interleaved multi-channel analog data as per-channel packets.
  *
- * The caller must provide the #outbuf space for the conversion result,
- * and is expected to free allocated space after use.
+ * The data of all channels gets split in a single pass, and keeps its
+ * encoding. Receivers convert the values when they need to. Packets
+ * for a single channel are sent as is, without copying their data.
  *
- * @param[in] analog The analog payload to convert. Must not be NULL.
- *                   analog->data, analog->meaning, and analog->encoding
- *                   must not be NULL.
- * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ * @param[in] sdi The device instance to send the packets for.
+ * @param[in] analog The analog payload, with one value per channel in
+ *     the order of its channels list for each of its samples.
  *
  * @retval SR_OK Success.
- * @retval SR_ERR Unsupported encoding.
- * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_ARG Invalid arguments.
+ * @retval SR_ERR_MALLOC Memory allocation failure.
  *
- * @since 0.4.0
+ * @private
  */
-SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
-		float *outbuf)
+SR_PRIV int sr_analog_send_split(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_analog *analog)
 {
-	size_t count;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog ch_analog;
+	struct sr_analog_meaning ch_meaning;
+	GSList ch_list, *l;
+	size_t num_channels, unitsize, count, i, ch_idx;
+	const uint8_t *rdptr;
+	uint8_t *planes, *wrptr;
+	int ret;
+
+	if (!analog || !analog->meaning || !analog->encoding)
+		return SR_ERR_ARG;
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (!num_channels)
+		return SR_ERR_ARG;
+
+	memset(&packet, 0, sizeof(packet));
+	packet.type = SR_DF_ANALOG;
+	if (num_channels == 1 || !analog->num_samples) {
+		packet.payload = analog;
+		return sr_session_send(sdi, &packet);
+	}
+
+	/*
+	 * De-interleave into one plane per channel. Fixed size copies
+	 * for the common widths let compilers emit plain loads and
+	 * stores.
+	 */
+	unitsize = analog->encoding->unitsize;
+	count = analog->num_samples;
+	planes = g_try_malloc(num_channels * count * unitsize);
+	if (!planes)
+		return SR_ERR_MALLOC;
+	rdptr = analog->data;
+#define SPLIT(size) do { \
+		for (i = 0; i < count; i++) { \
+			for (ch_idx = 0; ch_idx < num_channels; ch_idx++) { \
+				wrptr = &planes[(ch_idx * count + i) * (size)]; \
+				memcpy(wrptr, rdptr, (size)); \
+				rdptr += (size); \
+			} \
+		} \
+	} while (0)
+	switch (unitsize) {
+	case 1:
+		SPLIT(1);
+		break;
+	case 2:
+		SPLIT(2);
+		break;
+	case 4:
+		SPLIT(4);
+		break;
+	case 8:
+		SPLIT(8);
+		break;
+	default:
+		SPLIT(unitsize);
+		break;
+	}
+#undef SPLIT
+
+	ch_analog = *analog;
+	ch_meaning = *analog->meaning;
+	ch_analog.meaning = &ch_meaning;
+	ch_meaning.channels = &ch_list;
+	packet.payload = &ch_analog;
+	ret = SR_OK;
+	for (l = analog->meaning->channels, ch_idx = 0; l; l = l->next, ch_idx++) {
+		ch_list.data = l->data;
+		ch_list.next = NULL;
+		ch_analog.data = &planes[ch_idx * count * unitsize];
+		ret = sr_session_send(sdi, &packet);
+		if (ret != SR_OK)
+			break;
+	}
+	g_free(planes);
+
+	return ret;
+}
+
+/*
+ * Convert analog data to physical values, into either of @a fbuf or
+ * @a dbuf. The other one is NULL.
+ */
+static int analog_to_real(const struct sr_datafeed_analog *analog,
+		float *fbuf, double *dbuf)
+{
+	size_t count, i;
 	gboolean host_bigendian;
 	gboolean input_float, input_signed, input_bigendian;
 	size_t input_unitsize;
@@ -186,11 +273,6 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	gboolean input_is_native;
 	char type_text[10];
 
-	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
-		return SR_ERR_ARG;
-	if (!outbuf)
-		return SR_ERR_ARG;
-
 	count = analog->num_samples * g_slist_length(analog->meaning->channels);
 
 	/*
@@ -228,16 +310,16 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	 * native format. Do apply scale/offset though when applicable
 	 * on our way out.
 	 */
-	input_is_native = input_float &&
-		input_unitsize == sizeof(outbuf[0]) &&
+	input_is_native = fbuf && input_float &&
+		input_unitsize == sizeof(fbuf[0]) &&
 		input_bigendian == host_bigendian;
 	if (input_is_native) {
-		memcpy(outbuf, data8, count * sizeof(outbuf[0]));
+		memcpy(fbuf, data8, count * sizeof(fbuf[0]));
 		if (scale != 1.0 || offset != 0.0) {
-			while (count--) {
-				*outbuf *= scale;
-				*outbuf += offset;
-				outbuf++;
+			/* Indexed loop without dependencies, vectorizes well. */
+			for (i = 0; i < count; i++) {
+				value = (float)(fbuf[i] * scale);
+				fbuf[i] = value + offset;
 			}
 		}
 		return SR_OK;
@@ -250,38 +332,38 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	 * Common scale/offset factors apply to all sample values.
 	 *
 	 * Do most internal calculations on double precision values.
-	 * Only trim the result data to single precision, since that's
-	 * the routine's result data type in its public API which needs
-	 * to be kept for compatibility. It remains an option for later
-	 * to add another public routine which returns double precision
-	 * result data, call sites could migrate at their own pace.
+	 * Only trim the result data to single precision when a float
+	 * result was asked for, sr_analog_convert() also provides double
+	 * precision result data.
 	 */
+	/*
+	 * Fused read, scale and offset loops for each supported type.
+	 * The readers are inline functions, and the loops are indexed
+	 * and without dependencies, so that compilers can vectorize them
+	 * including the byte swaps.
+	 */
+#define CONVERT(reader, size) do { \
+		if (fbuf) { \
+			for (i = 0; i < count; i++) \
+				fbuf[i] = reader(&data8[i * (size)]) * scale + offset; \
+		} else { \
+			for (i = 0; i < count; i++) \
+				dbuf[i] = reader(&data8[i * (size)]) * scale + offset; \
+		} \
+	} while (0)
+
 	if (input_float && input_unitsize == sizeof(float)) {
-		float (*reader)(const uint8_t **p);
 		if (input_bigendian)
-			reader = read_fltbe_inc;
+			CONVERT(read_fltbe, sizeof(float));
 		else
-			reader = read_fltle_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
+			CONVERT(read_fltle, sizeof(float));
 		return SR_OK;
 	}
 	if (input_float && input_unitsize == sizeof(double)) {
-		double (*reader)(const uint8_t **p);
 		if (input_bigendian)
-			reader = read_dblbe_inc;
+			CONVERT(read_dblbe, sizeof(double));
 		else
-			reader = read_dblle_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
+			CONVERT(read_dblle, sizeof(double));
 		return SR_OK;
 	}
 	if (input_float) {
@@ -293,83 +375,43 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	}
 
 	if (input_unitsize == sizeof(uint8_t) && input_signed) {
-		int8_t (*reader)(const uint8_t **p);
-		reader = read_i8_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
+		CONVERT(read_i8, sizeof(int8_t));
 		return SR_OK;
 	}
 	if (input_unitsize == sizeof(uint8_t)) {
-		uint8_t (*reader)(const uint8_t **p);
-		reader = read_u8_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
+		CONVERT(read_u8, sizeof(uint8_t));
 		return SR_OK;
 	}
 	if (input_unitsize == sizeof(uint16_t) && input_signed) {
-		int16_t (*reader)(const uint8_t **p);
 		if (input_bigendian)
-			reader = read_i16be_inc;
+			CONVERT(read_i16be, sizeof(int16_t));
 		else
-			reader = read_i16le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
+			CONVERT(read_i16le, sizeof(int16_t));
 		return SR_OK;
 	}
 	if (input_unitsize == sizeof(uint16_t)) {
-		uint16_t (*reader)(const uint8_t **p);
 		if (input_bigendian)
-			reader = read_u16be_inc;
+			CONVERT(read_u16be, sizeof(uint16_t));
 		else
-			reader = read_u16le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
+			CONVERT(read_u16le, sizeof(uint16_t));
 		return SR_OK;
 	}
 	if (input_unitsize == sizeof(uint32_t) && input_signed) {
-		int32_t (*reader)(const uint8_t **p);
 		if (input_bigendian)
-			reader = read_i32be_inc;
+			CONVERT(read_i32be, sizeof(int32_t));
 		else
-			reader = read_i32le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
+			CONVERT(read_i32le, sizeof(int32_t));
 		return SR_OK;
 	}
 	if (input_unitsize == sizeof(uint32_t)) {
-		uint32_t (*reader)(const uint8_t **p);
 		if (input_bigendian)
-			reader = read_u32be_inc;
+			CONVERT(read_u32be, sizeof(uint32_t));
 		else
-			reader = read_u32le_inc;
-		while (count--) {
-			value = reader(&data8);
-			value *= scale;
-			value += offset;
-			*outbuf++ = value;
-		}
+			CONVERT(read_u32le, sizeof(uint32_t));
 		return SR_OK;
 	}
+#undef CONVERT
+
 	snprintf(type_text, sizeof(type_text), "%c%zu%s",
 		input_float ? 'f' : input_signed ? 'i' : 'u',
 		input_unitsize * 8, input_bigendian ? "be" : "le");
@@ -378,6 +420,184 @@ SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 	return SR_ERR;
 }
 
+/**
+ * Convert an analog datafeed payload to an array of floats.
+ *
+ * The caller must provide the #outbuf space for the conversion result,
+ * and is expected to free allocated space after use.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
+		float *outbuf)
+{
+	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
+		return SR_ERR_ARG;
+	if (!outbuf)
+		return SR_ERR_ARG;
+
+	return analog_to_real(analog, outbuf, NULL);
+}
+
+/* Copy raw integer codes into a wider (or same width) native type. */
+static int analog_to_int(const struct sr_datafeed_analog *analog,
+		int16_t *buf16, int32_t *buf32)
+{
+	const struct sr_analog_encoding *enc;
+	const uint8_t *data8;
+	size_t count, i, max_size;
+
+	enc = analog->encoding;
+	count = analog->num_samples * g_slist_length(analog->meaning->channels);
+	data8 = analog->data;
+
+	/* Unsigned codes need one more bit in the signed target. */
+	max_size = buf16 ? sizeof(int16_t) : sizeof(int32_t);
+	if (enc->is_float || enc->unitsize > max_size
+			|| (enc->unitsize == max_size && !enc->is_signed)) {
+		sr_err("Analog codes of %s%d bits don't fit into int%zu.",
+			enc->is_float ? "float " : enc->is_signed ? "" : "unsigned ",
+			enc->unitsize * 8, max_size * 8);
+		return SR_ERR;
+	}
+
+#define CONVERT(reader, size) do { \
+		if (buf16) { \
+			for (i = 0; i < count; i++) \
+				buf16[i] = reader(&data8[i * (size)]); \
+		} else { \
+			for (i = 0; i < count; i++) \
+				buf32[i] = reader(&data8[i * (size)]); \
+		} \
+	} while (0)
+
+	switch (enc->unitsize) {
+	case sizeof(uint8_t):
+		if (enc->is_signed)
+			CONVERT(read_i8, sizeof(int8_t));
+		else
+			CONVERT(read_u8, sizeof(uint8_t));
+		break;
+	case sizeof(uint16_t):
+		if (enc->is_signed && enc->is_bigendian)
+			CONVERT(read_i16be, sizeof(int16_t));
+		else if (enc->is_signed)
+			CONVERT(read_i16le, sizeof(int16_t));
+		else if (enc->is_bigendian)
+			CONVERT(read_u16be, sizeof(uint16_t));
+		else
+			CONVERT(read_u16le, sizeof(uint16_t));
+		break;
+	case sizeof(uint32_t):
+		if (enc->is_bigendian)
+			CONVERT(read_i32be, sizeof(int32_t));
+		else
+			CONVERT(read_i32le, sizeof(int32_t));
+		break;
+	default:
+		sr_err("Unsupported analog code size %d.", enc->unitsize);
+		return SR_ERR;
+	}
+#undef CONVERT
+
+	return SR_OK;
+}
+
+/**
+ * Convert an analog datafeed payload to an array of a chosen type.
+ *
+ * For SR_ANALOG_TYPE_FLOAT and SR_ANALOG_TYPE_DOUBLE the result holds
+ * the physical values, like sr_analog_to_float() does. For the integer
+ * types the result holds the raw codes of the sample data in the host's
+ * native format, without scale and offset applied. Use
+ * sr_analog_get_raw() to get those. This keeps compact device data
+ * compact, e.g. 8-bit ADC codes as int16 instead of as float.
+ *
+ * @param[in] analog The analog payload to convert. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[in] type The type of the result.
+ * @param[out] outbuf Memory where to store the result. Must not be NULL,
+ *                    and must hold all values of the payload.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding, or the codes don't fit the type.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_convert(const struct sr_datafeed_analog *analog,
+		enum sr_analog_type type, void *outbuf)
+{
+	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
+		return SR_ERR_ARG;
+	if (!outbuf)
+		return SR_ERR_ARG;
+
+	switch (type) {
+	case SR_ANALOG_TYPE_INT16:
+		return analog_to_int(analog, outbuf, NULL);
+	case SR_ANALOG_TYPE_INT32:
+		return analog_to_int(analog, NULL, outbuf);
+	case SR_ANALOG_TYPE_FLOAT:
+		return analog_to_real(analog, outbuf, NULL);
+	case SR_ANALOG_TYPE_DOUBLE:
+		return analog_to_real(analog, NULL, outbuf);
+	default:
+		return SR_ERR_ARG;
+	}
+}
+
+/**
+ * Get the raw sample data of an analog datafeed payload.
+ *
+ * The raw data is not copied. It remains valid as long as the payload.
+ * Physical values are raw code * scale + offset.
+ *
+ * @param[in] analog The analog payload. Must not be NULL.
+ *                   analog->data, analog->meaning, and analog->encoding
+ *                   must not be NULL.
+ * @param[out] raw Where to store the description of the raw data.
+ *                 Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_analog_get_raw(const struct sr_datafeed_analog *analog,
+		struct sr_analog_raw *raw)
+{
+	const struct sr_analog_encoding *enc;
+
+	if (!analog || !analog->data || !analog->meaning || !analog->encoding)
+		return SR_ERR_ARG;
+	if (!raw)
+		return SR_ERR_ARG;
+
+	enc = analog->encoding;
+	raw->data = analog->data;
+	raw->count = analog->num_samples
+		* g_slist_length(analog->meaning->channels);
+	raw->unitsize = enc->unitsize;
+	raw->is_signed = enc->is_signed;
+	raw->is_float = enc->is_float;
+	raw->is_bigendian = enc->is_bigendian;
+	raw->scale = (double)enc->scale.p / enc->scale.q;
+	raw->offset = (double)enc->offset.p / enc->offset.q;
+
+	return SR_OK;
+}
+
 /**
  * Scale a float value to the appropriate SI prefix.
  *
@@ -211,7 +211,7 @@ SR_API char *sr_buildinfo_scpi_backends_get(void)
 
 	s = g_string_sized_new(200);
 
-	g_string_append_printf(s, "TCP, ");
+	g_string_append_printf(s, "TCP, HiSLIP, ");
 #if HAVE_RPC
 	g_string_append_printf(s, "RPC, ");
 #endif
@@ -282,102 +282,87 @@ static void print_resourcepaths(void)
 }
 
 /**
- * Sanity-check all libsigrok drivers.
+ * Sanity-check a libsigrok driver.
  *
- * @param[in] ctx Pointer to a libsigrok context struct. Must not be NULL.
+ * @param[in] driver The driver to check. Must not be NULL.
  *
- * @retval SR_OK All drivers are OK
- * @retval SR_ERR One or more drivers have issues.
- * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_OK The driver is OK.
+ * @retval SR_ERR The driver has issues.
+ *
+ * @private
  */
-static int sanity_check_all_drivers(const struct sr_context *ctx)
+SR_PRIV int sr_driver_sanity_check(const struct sr_dev_driver *driver)
 {
-	int i, errors, ret = SR_OK;
-	struct sr_dev_driver **drivers;
+	int errors;
 	const char *d;
 
-	if (!ctx)
-		return SR_ERR_ARG;
-
-	sr_spew("Sanity-checking all drivers.");
-
-	drivers = sr_driver_list(ctx);
-	for (i = 0; drivers[i]; i++) {
-		errors = 0;
-
-		d = (drivers[i]->name) ? drivers[i]->name : "NULL";
-
-		if (!drivers[i]->name) {
-			sr_err("No name in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (!drivers[i]->longname) {
-			sr_err("No longname in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (drivers[i]->api_version < 1) {
-			sr_err("API version in driver %d ('%s') < 1.", i, d);
-			errors++;
-		}
-		if (!drivers[i]->init) {
-			sr_err("No init in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (!drivers[i]->cleanup) {
-			sr_err("No cleanup in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (!drivers[i]->scan) {
-			sr_err("No scan in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (!drivers[i]->dev_list) {
-			sr_err("No dev_list in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (!drivers[i]->dev_clear) {
-			sr_err("No dev_clear in driver %d ('%s').", i, d);
-			errors++;
-		}
-		/* Note: config_get() is optional. */
-		if (!drivers[i]->config_set) {
-			sr_err("No config_set in driver %d ('%s').", i, d);
-			errors++;
-		}
-		/* Note: config_channel_set() is optional. */
-		/* Note: config_commit() is optional. */
-		if (!drivers[i]->config_list) {
-			sr_err("No config_list in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (!drivers[i]->dev_open) {
-			sr_err("No dev_open in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (!drivers[i]->dev_close) {
-			sr_err("No dev_close in driver %d ('%s').", i, d);
-			errors++;
-		}
-		if (!drivers[i]->dev_acquisition_start) {
-			sr_err("No dev_acquisition_start in driver %d ('%s').",
-			       i, d);
-			errors++;
-		}
-		if (!drivers[i]->dev_acquisition_stop) {
-			sr_err("No dev_acquisition_stop in driver %d ('%s').",
-			       i, d);
-			errors++;
-		}
-
-		/* Note: 'priv' is allowed to be NULL. */
+	errors = 0;
 
-		if (errors == 0)
-			continue;
+	d = (driver->name) ? driver->name : "NULL";
 
-		ret = SR_ERR;
+	if (!driver->name) {
+		sr_err("No name in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->longname) {
+		sr_err("No longname in driver '%s'.", d);
+		errors++;
+	}
+	if (driver->api_version < 1) {
+		sr_err("API version in driver '%s' < 1.", d);
+		errors++;
+	}
+	if (!driver->init) {
+		sr_err("No init in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->cleanup) {
+		sr_err("No cleanup in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->scan) {
+		sr_err("No scan in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->dev_list) {
+		sr_err("No dev_list in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->dev_clear) {
+		sr_err("No dev_clear in driver '%s'.", d);
+		errors++;
+	}
+	/* Note: config_get() is optional. */
+	if (!driver->config_set) {
+		sr_err("No config_set in driver '%s'.", d);
+		errors++;
+	}
+	/* Note: config_channel_set() is optional. */
+	/* Note: config_commit() is optional. */
+	if (!driver->config_list) {
+		sr_err("No config_list in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->dev_open) {
+		sr_err("No dev_open in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->dev_close) {
+		sr_err("No dev_close in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->dev_acquisition_start) {
+		sr_err("No dev_acquisition_start in driver '%s'.", d);
+		errors++;
+	}
+	if (!driver->dev_acquisition_stop) {
+		sr_err("No dev_acquisition_stop in driver '%s'.", d);
+		errors++;
 	}
 
-	return ret;
+	/* Note: 'priv' is allowed to be NULL. */
+
+	return (errors == 0) ? SR_OK : SR_ERR;
 }
 
 /**
@@ -563,13 +548,9 @@ SR_API int sr_init(struct sr_context **ctx)
 	}
 
 	context = g_malloc0(sizeof(struct sr_context));
+	g_mutex_init(&context->mem_mutex);
 
-	sr_drivers_init(context);
-
-	if (sanity_check_all_drivers(context) < 0) {
-		sr_err("Internal driver error(s), aborting.");
-		goto done;
-	}
+	/* The driver list gets built on first use, see sr_driver_list(). */
 
 	if (sanity_check_all_input_modules() < 0) {
 		sr_err("Internal input module error(s), aborting.");
@@ -601,6 +582,7 @@ SR_API int sr_init(struct sr_context **ctx)
 		ret = SR_ERR;
 		goto done;
 	}
+	usb_cache_init(context);
 #endif
 #ifdef HAVE_LIBHIDAPI
 	/*
@@ -617,12 +599,15 @@ SR_API int sr_init(struct sr_context **ctx)
 	}
 #endif
 	sr_resource_set_hooks(context, NULL, NULL, NULL, NULL);
+	sr_resource_preload_env(context);
 
 	*ctx = context;
 	context = NULL;
 	ret = SR_OK;
 
 done:
+	if (context)
+		g_mutex_clear(&context->mem_mutex);
 	g_free(context);
 	return ret;
 }
@@ -654,12 +639,23 @@ SR_API int sr_exit(struct sr_context *ctx)
 	hid_exit();
 #endif
 #ifdef HAVE_LIBUSB_1_0
+	if (ctx->ezusb_uploads)
+		g_hash_table_destroy(ctx->ezusb_uploads);
+	usb_cache_cleanup(ctx);
 	libusb_exit(ctx->libusb_ctx);
 #endif
+	sr_resource_cache_clear(ctx);
+	sr_sessionfile_cache_clear(ctx);
 
-	g_free(sr_driver_list(ctx));
+	g_free(ctx->driver_list);
+	g_strfreev(ctx->driver_names);
+	g_mutex_clear(&ctx->mem_mutex);
+	sr_thread_policy_clear(ctx);
 	g_free(ctx);
 
+	/* Drop idle sample buffers, buffers in use are not affected. */
+	sr_buffer_pool_trim(NULL);
+
 	return SR_OK;
 }
 
@@ -99,6 +99,28 @@
 /* Silence warning about (currently) unused routine. */
 #define WITH_WRITE_TYPE_HANDLE	0
 
+/*
+ * The ATT MTU to ask the peer for. Larger MTUs let devices send their
+ * data in fewer (and longer) notifications. 517 is the largest value
+ * which is useful, it fits 512 bytes of attribute data.
+ */
+#define BLE_ATT_MTU_DEFAULT	23
+#define BLE_ATT_MTU_WANTED	517
+
+/*
+ * Connection parameters to ask the controller for, in units of 1.25ms
+ * (intervals) and 10ms (supervision timeout). Short intervals reduce
+ * the latency of notifications. Peers may pick other values.
+ */
+#define BLE_CONN_INTERVAL_MIN	6
+#define BLE_CONN_INTERVAL_MAX	24
+#define BLE_CONN_LATENCY	0
+#define BLE_CONN_SUPERVISION	400
+#define BLE_CONN_UPDATE_TIMEOUT	1000	/* HCI command timeout in ms. */
+
+/* Most ATT messages to drain in one sr_bt_check_notify() call. */
+#define BLE_NOTIFY_BATCH_COUNT	32
+
 /* {{{ compat decls */
 /*
  * The availability of conversion helpers in <bluetooth/bluetooth.h>
@@ -242,6 +264,7 @@ struct sr_bt_desc {
 	/* Internal state. */
 	int devid;
 	int fd;
+	uint16_t att_mtu;
 	struct hci_filter orig_filter;
 };
 
@@ -268,6 +291,7 @@ SR_PRIV struct sr_bt_desc *sr_bt_desc_new(void)
 
 	desc->devid = -1;
 	desc->fd = -1;
+	desc->att_mtu = BLE_ATT_MTU_DEFAULT;
 
 	return desc;
 }
@@ -657,6 +681,49 @@ SR_PRIV int sr_bt_scan_bt(struct sr_bt_desc *desc, int duration)
 /* }}} scan */
 /* {{{ connect/disconnect */
 
+/*
+ * Ask the controller for short connection intervals. This is optional,
+ * it fails without the permission to send HCI commands, or when the
+ * peer rejects the parameters. Then the connection keeps its defaults.
+ */
+static void sr_bt_conn_params_update(struct sr_bt_desc *desc)
+{
+	struct l2cap_conninfo info;
+	socklen_t len;
+	bdaddr_t mac;
+	int id, dd, ret;
+
+	memset(&info, 0, sizeof(info));
+	len = sizeof(info);
+	ret = getsockopt(desc->fd, SOL_L2CAP, L2CAP_CONNINFO, &info, &len);
+	if (ret < 0) {
+		sr_dbg("Cannot get the connection handle.");
+		return;
+	}
+
+	if (desc->local_addr[0]) {
+		str2ba(desc->local_addr, &mac);
+		id = hci_get_route(&mac);
+	} else {
+		id = hci_get_route(NULL);
+	}
+	if (id < 0)
+		return;
+	dd = hci_open_dev(id);
+	if (dd < 0)
+		return;
+
+	ret = hci_le_conn_update(dd, htobs(info.hci_handle),
+		BLE_CONN_INTERVAL_MIN, BLE_CONN_INTERVAL_MAX,
+		BLE_CONN_LATENCY, BLE_CONN_SUPERVISION,
+		BLE_CONN_UPDATE_TIMEOUT);
+	if (ret < 0)
+		sr_dbg("Connection parameter update failed, keeping defaults.");
+	else
+		sr_dbg("Connection parameters updated.");
+	hci_close_dev(dd);
+}
+
 SR_PRIV int sr_bt_connect_ble(struct sr_bt_desc *desc)
 {
 	struct sockaddr_l2 sl2;
@@ -784,6 +851,8 @@ SR_PRIV int sr_bt_connect_ble(struct sr_bt_desc *desc)
 		return ret;
 	}
 
+	sr_bt_conn_params_update(desc);
+
 	return 0;
 }
 
@@ -890,6 +959,17 @@ SR_PRIV int sr_bt_start_notify(struct sr_bt_desc *desc)
 	if (sr_bt_check_socket_usable(desc) < 0)
 		return -2;
 
+	/*
+	 * Ask for a larger MTU. The request has a 16bit value where other
+	 * messages have their handle. The response gets handled when the
+	 * caller checks for notifications. Peers which don't support the
+	 * exchange keep the default MTU.
+	 */
+	wrlen = sr_bt_write_type_handle_bytes(desc, BLE_ATT_EXCHANGE_MTU_REQ,
+		BLE_ATT_MTU_WANTED, NULL, 0);
+	if (wrlen < 0)
+		sr_dbg("Cannot request an MTU of %d.", BLE_ATT_MTU_WANTED);
+
 	write_u16le(buf, desc->cccd_value);
 	wrlen = sr_bt_char_write_req(desc, desc->cccd_handle, buf, sizeof(buf));
 	if (wrlen != sizeof(buf))
@@ -898,27 +978,19 @@ SR_PRIV int sr_bt_start_notify(struct sr_bt_desc *desc)
 	return 0;
 }
 
-SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
+/*
+ * Handle one ATT message. The payload of notifications and indications
+ * gets appended to the batch, which the caller passes to the data
+ * callback. Returns 1 when the message was a notification/indication.
+ */
+static int sr_bt_handle_message(struct sr_bt_desc *desc,
+	const uint8_t *buf, ssize_t rdlen, GByteArray *batch)
 {
-	uint8_t buf[1024];
-	ssize_t rdlen;
 	uint8_t packet_type;
 	uint16_t packet_handle;
-	uint8_t *packet_data;
+	const uint8_t *packet_data;
 	size_t packet_dlen;
-
-	if (!desc)
-		return -1;
-
-	if (sr_bt_check_socket_usable(desc) < 0)
-		return -2;
-
-	/* Get another message from the Bluetooth socket. */
-	rdlen = sr_bt_read(desc, buf, sizeof(buf));
-	if (rdlen < 0)
-		return -2;
-	if (!rdlen)
-		return 0;
+	uint16_t mtu;
 
 	/* Get header fields and references to the payload data. */
 	packet_type = 0x00;
@@ -939,6 +1011,16 @@ SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
 		sr_spew("read() len %zd, type 0x%02x (%s)", rdlen, buf[0], "error response");
 		/* EMPTY */
 		break;
+	case BLE_ATT_EXCHANGE_MTU_RESP:
+		sr_spew("read() len %zd, type 0x%02x (%s)", rdlen, buf[0], "MTU response");
+		if (rdlen < 3)
+			return -4;
+		/* The response has the server's MTU where the handle would be. */
+		mtu = MIN(packet_handle, BLE_ATT_MTU_WANTED);
+		if (mtu > BLE_ATT_MTU_DEFAULT)
+			desc->att_mtu = mtu;
+		sr_dbg("ATT MTU is %u.", desc->att_mtu);
+		break;
 	case BLE_ATT_WRITE_RESP:
 		sr_spew("read() len %zd, type 0x%02x (%s)", rdlen, buf[0], "write response");
 		/* EMPTY */
@@ -950,18 +1032,16 @@ SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
 			return -4;
 		if (!packet_data)
 			return -4;
-		if (!desc->data_cb)
-			return 0;
-		return desc->data_cb(desc->data_cb_data, packet_data, packet_dlen);
+		g_byte_array_append(batch, packet_data, packet_dlen);
+		return 1;
 	case BLE_ATT_HANDLE_NOTIFICATION:
 		sr_spew("read() len %zd, type 0x%02x (%s)", rdlen, buf[0], "handle notification");
 		if (packet_handle != desc->read_handle)
 			return -4;
 		if (!packet_data)
 			return -4;
-		if (!desc->data_cb)
-			return 0;
-		return desc->data_cb(desc->data_cb_data, packet_data, packet_dlen);
+		g_byte_array_append(batch, packet_data, packet_dlen);
+		return 1;
 	default:
 		sr_spew("unsupported type 0x%02x", packet_type);
 		return -3;
@@ -970,6 +1050,63 @@ SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
 	return 0;
 }
 
+/*
+ * Drain the ATT messages which are pending on the socket (up to a limit)
+ * and pass the data of all their notifications to the data callback in
+ * one call. Devices with small MTUs send many short notifications, each
+ * of them would otherwise take a separate trip through the callback.
+ */
+SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc)
+{
+	uint8_t buf[1024];
+	GByteArray *batch;
+	ssize_t rdlen;
+	size_t count;
+	int ret, cb_ret;
+
+	if (!desc)
+		return -1;
+
+	if (sr_bt_check_socket_usable(desc) < 0)
+		return -2;
+
+	batch = g_byte_array_sized_new(sizeof(buf));
+	ret = 0;
+	for (count = 0; count < BLE_NOTIFY_BATCH_COUNT; count++) {
+		/* Get another message from the Bluetooth socket. */
+		rdlen = sr_bt_read(desc, buf, sizeof(buf));
+		if (rdlen < 0) {
+			ret = -2;
+			break;
+		}
+		if (!rdlen)
+			break;
+		ret = sr_bt_handle_message(desc, buf, rdlen, batch);
+		if (ret < 0)
+			break;
+		ret = 0;
+	}
+
+	/* Pass the data which was received before errors, too. */
+	if (batch->len && desc->data_cb) {
+		cb_ret = desc->data_cb(desc->data_cb_data,
+			batch->data, batch->len);
+		if (!ret)
+			ret = cb_ret;
+	}
+	g_byte_array_free(batch, TRUE);
+
+	return ret;
+}
+
+SR_PRIV int sr_bt_get_fd(struct sr_bt_desc *desc)
+{
+	if (!desc)
+		return -1;
+
+	return desc->fd;
+}
+
 /* }}} indication/notification */
 /* {{{ read/write */
 
@@ -0,0 +1,410 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "buffer-pool"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Pool of reusable sample buffers.
+ */
+
+/**
+ * @defgroup grp_buffer_pool Buffer pool
+ *
+ * Pool of reusable sample buffers.
+ *
+ * Drivers, input modules and transforms which allocate large sample
+ * buffers at a high rate can draw them from a pool, and return them
+ * there when done. Buffers are kept in power-of-two size classes, so
+ * that a released buffer can satisfy later requests of a similar size
+ * without going through the system allocator.
+ *
+ * Each buffer remembers the pool it was taken from. This way buffers
+ * can be handed over to refcounted packets with sr_buffer_pool_release()
+ * as the release callback, see sr_packet_wrap().
+ *
+ * @{
+ */
+
+/* Smallest and largest size class, as a power of two. */
+#define POOL_MIN_SHIFT		12
+#define POOL_MAX_SHIFT		26
+#define POOL_NUM_CLASSES	(POOL_MAX_SHIFT - POOL_MIN_SHIFT + 1)
+
+/* Room for the buffer header, keeps the payload cache line aligned. */
+#define POOL_HDR_SIZE		64
+
+#define POOL_HUGEPAGE_SIZE	(2 * 1024 * 1024)
+
+/* Upper limit of idle memory which the default pool keeps around. */
+#define POOL_DEFAULT_MAX_CACHED	(64 * 1024 * 1024)
+
+struct pool_buffer {
+	struct sr_buffer_pool *pool;
+	struct pool_buffer *next;
+	/* Usable size, and the size of the underlying allocation. */
+	size_t size;
+	size_t alloc_size;
+	/* Size class index, or -1 for oversized (uncached) buffers. */
+	int size_class;
+	gboolean is_mmap;
+};
+
+struct sr_buffer_pool {
+	GMutex mutex;
+	/* One reference for the owner, plus one per outstanding buffer. */
+	int refcount;
+	gboolean closed;
+	gboolean use_hugepages;
+	size_t max_cached;
+	struct pool_buffer *free_list[POOL_NUM_CLASSES];
+	struct sr_buffer_pool_stats stats;
+};
+
+static struct sr_buffer_pool *default_pool;
+
+static int size_class_get(size_t size)
+{
+	int shift;
+
+	for (shift = POOL_MIN_SHIFT; shift <= POOL_MAX_SHIFT; shift++) {
+		if (size <= ((size_t)1 << shift))
+			return shift - POOL_MIN_SHIFT;
+	}
+
+	return -1;
+}
+
+static struct pool_buffer *buffer_alloc(struct sr_buffer_pool *pool,
+		size_t size)
+{
+	struct pool_buffer *buf;
+	size_t alloc_size;
+	gboolean is_mmap;
+
+	alloc_size = POOL_HDR_SIZE + size;
+	buf = NULL;
+	is_mmap = FALSE;
+
+#if defined(HAVE_SYS_MMAN_H) && defined(MAP_HUGETLB)
+	if (pool->use_hugepages && alloc_size >= POOL_HUGEPAGE_SIZE) {
+		alloc_size += POOL_HUGEPAGE_SIZE - 1;
+		alloc_size -= alloc_size % POOL_HUGEPAGE_SIZE;
+		buf = mmap(NULL, alloc_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (buf == MAP_FAILED) {
+			sr_spew("No hugepages available, using malloc.");
+			buf = NULL;
+			alloc_size = POOL_HDR_SIZE + size;
+		} else {
+			is_mmap = TRUE;
+		}
+	}
+#endif
+	if (!buf)
+		buf = g_try_malloc(alloc_size);
+	if (!buf)
+		return NULL;
+
+	buf->pool = pool;
+	buf->next = NULL;
+	buf->size = size;
+	buf->alloc_size = alloc_size;
+	buf->is_mmap = is_mmap;
+
+	return buf;
+}
+
+static void buffer_free(struct pool_buffer *buf)
+{
+#if defined(HAVE_SYS_MMAN_H) && defined(MAP_HUGETLB)
+	if (buf->is_mmap) {
+		munmap(buf, buf->alloc_size);
+		return;
+	}
+#endif
+	g_free(buf);
+}
+
+static void buffer_free_list(struct pool_buffer *buf)
+{
+	struct pool_buffer *next;
+
+	while (buf) {
+		next = buf->next;
+		buffer_free(buf);
+		buf = next;
+	}
+}
+
+/* Detach all idle buffers. Must be called with the pool locked. */
+static struct pool_buffer *pool_take_cached(struct sr_buffer_pool *pool)
+{
+	struct pool_buffer *list, *buf;
+	int i;
+
+	list = NULL;
+	for (i = 0; i < POOL_NUM_CLASSES; i++) {
+		while ((buf = pool->free_list[i])) {
+			pool->free_list[i] = buf->next;
+			buf->next = list;
+			list = buf;
+		}
+	}
+	pool->stats.cached_bytes = 0;
+
+	return list;
+}
+
+static void pool_unref(struct sr_buffer_pool *pool)
+{
+	gboolean last;
+
+	g_mutex_lock(&pool->mutex);
+	last = (--pool->refcount == 0);
+	g_mutex_unlock(&pool->mutex);
+
+	if (!last)
+		return;
+
+	sr_dbg("Pool %p: %" PRIu64 " hits, %" PRIu64 " misses.", pool,
+		pool->stats.hits, pool->stats.misses);
+	g_mutex_clear(&pool->mutex);
+	g_free(pool);
+}
+
+/**
+ * Create a buffer pool.
+ *
+ * @param max_cached Maximum number of bytes kept in idle buffers.
+ * @param use_hugepages Back large buffers by hugepages where available.
+ *
+ * @return The new pool. Use sr_buffer_pool_free() to release it.
+ *
+ * @private
+ */
+SR_PRIV struct sr_buffer_pool *sr_buffer_pool_new(size_t max_cached,
+		gboolean use_hugepages)
+{
+	struct sr_buffer_pool *pool;
+
+	pool = g_malloc0(sizeof(*pool));
+	g_mutex_init(&pool->mutex);
+	pool->refcount = 1;
+	pool->max_cached = max_cached;
+	pool->use_hugepages = use_hugepages;
+
+	return pool;
+}
+
+/**
+ * Release a buffer pool.
+ *
+ * Idle buffers are freed right away. Buffers which are still in use
+ * remain valid, and are freed when they get released.
+ *
+ * @param pool The pool to release. Must not be the default pool.
+ *
+ * @private
+ */
+SR_PRIV void sr_buffer_pool_free(struct sr_buffer_pool *pool)
+{
+	struct pool_buffer *list;
+
+	if (!pool || pool == default_pool)
+		return;
+
+	g_mutex_lock(&pool->mutex);
+	pool->closed = TRUE;
+	list = pool_take_cached(pool);
+	g_mutex_unlock(&pool->mutex);
+
+	buffer_free_list(list);
+	pool_unref(pool);
+}
+
+/**
+ * Get the library wide default buffer pool.
+ *
+ * The default pool gets used when NULL is passed as the pool to
+ * sr_buffer_pool_alloc(). It lives for the lifetime of the library,
+ * so that buffers which are retained by consumers beyond the end of
+ * a session can always be returned to it.
+ *
+ * @private
+ */
+SR_PRIV struct sr_buffer_pool *sr_buffer_pool_default_get(void)
+{
+	static gsize initialized;
+
+	if (g_once_init_enter(&initialized)) {
+		default_pool = sr_buffer_pool_new(POOL_DEFAULT_MAX_CACHED, FALSE);
+		g_once_init_leave(&initialized, 1);
+	}
+
+	return default_pool;
+}
+
+/**
+ * Allocate a buffer from a pool.
+ *
+ * As with g_try_malloc(), the caller must check the result.
+ *
+ * @param pool The pool to allocate from, or NULL for the default pool.
+ * @param size The number of bytes to allocate.
+ *
+ * @return A buffer of at least @a size bytes, or NULL on failure.
+ *
+ * @private
+ */
+SR_PRIV void *sr_buffer_pool_alloc(struct sr_buffer_pool *pool, size_t size)
+{
+	struct pool_buffer *buf;
+	int size_class;
+
+	if (!pool)
+		pool = sr_buffer_pool_default_get();
+	size_class = size_class_get(size);
+
+	g_mutex_lock(&pool->mutex);
+	buf = NULL;
+	if (size_class >= 0 && (buf = pool->free_list[size_class])) {
+		pool->free_list[size_class] = buf->next;
+		pool->stats.cached_bytes -= buf->size;
+		pool->stats.hits++;
+	} else {
+		pool->stats.misses++;
+	}
+	pool->stats.outstanding++;
+	pool->refcount++;
+	g_mutex_unlock(&pool->mutex);
+
+	if (!buf) {
+		if (size_class >= 0)
+			size = (size_t)1 << (size_class + POOL_MIN_SHIFT);
+		buf = buffer_alloc(pool, size);
+		if (!buf) {
+			g_mutex_lock(&pool->mutex);
+			pool->stats.outstanding--;
+			g_mutex_unlock(&pool->mutex);
+			pool_unref(pool);
+			return NULL;
+		}
+		buf->size_class = size_class;
+		/* Have the pages on the NUMA node of the I/O thread. */
+		if (sr_thread_first_touch())
+			memset((uint8_t *)buf + POOL_HDR_SIZE, 0, buf->size);
+	}
+	buf->next = NULL;
+
+	return (uint8_t *)buf + POOL_HDR_SIZE;
+}
+
+/**
+ * Return a buffer to the pool it was allocated from.
+ *
+ * The signature matches GDestroyNotify, so that this can be used as
+ * the release callback of wrapped packets.
+ *
+ * @param data The buffer, as returned by sr_buffer_pool_alloc().
+ *             Can be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_buffer_pool_release(void *data)
+{
+	struct pool_buffer *buf;
+	struct sr_buffer_pool *pool;
+	gboolean keep;
+
+	if (!data)
+		return;
+
+	buf = (struct pool_buffer *)((uint8_t *)data - POOL_HDR_SIZE);
+	pool = buf->pool;
+
+	g_mutex_lock(&pool->mutex);
+	keep = !pool->closed && buf->size_class >= 0
+		&& pool->stats.cached_bytes + buf->size <= pool->max_cached;
+	if (keep) {
+		buf->next = pool->free_list[buf->size_class];
+		pool->free_list[buf->size_class] = buf;
+		pool->stats.cached_bytes += buf->size;
+	}
+	pool->stats.outstanding--;
+	g_mutex_unlock(&pool->mutex);
+
+	if (!keep)
+		buffer_free(buf);
+	pool_unref(pool);
+}
+
+/**
+ * Free all idle buffers of a pool.
+ *
+ * @param pool The pool to trim, or NULL for the default pool.
+ *
+ * @private
+ */
+SR_PRIV void sr_buffer_pool_trim(struct sr_buffer_pool *pool)
+{
+	struct pool_buffer *list;
+
+	if (!pool)
+		pool = sr_buffer_pool_default_get();
+
+	g_mutex_lock(&pool->mutex);
+	list = pool_take_cached(pool);
+	g_mutex_unlock(&pool->mutex);
+
+	buffer_free_list(list);
+}
+
+/**
+ * Get the usage statistics of a pool.
+ *
+ * @param pool The pool to query, or NULL for the default pool.
+ * @param stats Pointer to store the statistics at. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_buffer_pool_stats_get(struct sr_buffer_pool *pool,
+		struct sr_buffer_pool_stats *stats)
+{
+	if (!pool)
+		pool = sr_buffer_pool_default_get();
+
+	g_mutex_lock(&pool->mutex);
+	*stats = pool->stats;
+	g_mutex_unlock(&pool->mutex);
+}
+
+/** @} */
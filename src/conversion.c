@@ -23,6 +23,8 @@
  * Conversion helper functions.
  */
 
+#include <config.h>
+#include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -107,3 +109,247 @@ SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 
 	return SR_OK;
 }
+
+/*
+ * Get the single precision values of an analog packet. Converts into
+ * a newly allocated @a buf unless the data already is native floats.
+ */
+static const float *a2l_input(const struct sr_datafeed_analog *analog,
+		float **buf)
+{
+	const struct sr_analog_encoding *enc;
+	gboolean is_native;
+	size_t count;
+
+	enc = analog->encoding;
+#ifdef WORDS_BIGENDIAN
+	is_native = enc->is_bigendian;
+#else
+	is_native = !enc->is_bigendian;
+#endif
+	is_native &= enc->is_float && enc->unitsize == sizeof(float);
+	is_native &= enc->scale.p == (int64_t)enc->scale.q;
+	is_native &= enc->offset.p == 0;
+	*buf = NULL;
+	if (is_native)
+		return analog->data;
+
+	count = analog->num_samples * g_slist_length(analog->meaning->channels);
+	*buf = g_try_malloc(sizeof(float) * MAX(count, 1));
+	if (!*buf)
+		return NULL;
+	if (sr_analog_to_float(analog, *buf) != SR_OK) {
+		g_free(*buf);
+		*buf = NULL;
+		return NULL;
+	}
+
+	return *buf;
+}
+
+/* Set one bit in up to 64 consecutive packed logic samples. */
+static void a2l_scatter(uint8_t *out, size_t unitsize, uint8_t bit,
+		uint64_t mask, size_t n)
+{
+	size_t k;
+
+	if (!mask)
+		return;
+	for (k = 0; k < n; k++)
+		out[k * unitsize] |= ((mask >> k) & 1) << bit;
+}
+
+static int a2l_multi(const struct sr_datafeed_analog **analogs,
+		size_t num_channels, const float *lo_thr, const float *hi_thr,
+		uint8_t *state, struct sr_datafeed_logic *logic)
+{
+	const float *input;
+	float *buf;
+	uint8_t *out, bit;
+	uint64_t count, lo, hi, mask, s;
+	size_t ch, i, k, n, unitsize;
+
+	if (!analogs || !num_channels || !hi_thr || !logic || !logic->data)
+		return SR_ERR_ARG;
+	unitsize = logic->unitsize;
+	if (unitsize * 8 < num_channels)
+		return SR_ERR_ARG;
+	count = analogs[0]->num_samples;
+	for (ch = 0; ch < num_channels; ch++) {
+		if (analogs[ch]->num_samples != count)
+			return SR_ERR_ARG;
+	}
+
+	memset(logic->data, 0, count * unitsize);
+	logic->length = count * unitsize;
+
+	for (ch = 0; ch < num_channels; ch++) {
+		input = a2l_input(analogs[ch], &buf);
+		if (!input)
+			return SR_ERR;
+		out = (uint8_t *)logic->data + ch / 8;
+		bit = ch % 8;
+		s = state ? state[ch] & 1 : 0;
+
+		/*
+		 * Compare 64 samples at a time into bit masks. These loops
+		 * have no dependencies and vectorize. Only words which hold
+		 * a crossing need the sequential hysteresis resolution.
+		 */
+		for (i = 0; i < count; i += n) {
+			n = MIN(count - i, 64);
+			hi = lo = 0;
+			if (!lo_thr) {
+				for (k = 0; k < n; k++)
+					hi |= (uint64_t)(input[i + k] >= hi_thr[ch]) << k;
+				a2l_scatter(out + i * unitsize, unitsize, bit, hi, n);
+				continue;
+			}
+			/* Schmitt-trigger: Strictly above high, below low. */
+			for (k = 0; k < n; k++) {
+				hi |= (uint64_t)(input[i + k] > hi_thr[ch]) << k;
+				lo |= (uint64_t)(input[i + k] < lo_thr[ch]) << k;
+			}
+			if (!(hi | lo)) {
+				mask = s ? ~UINT64_C(0) : 0;
+			} else {
+				mask = 0;
+				for (k = 0; k < n; k++) {
+					if ((lo >> k) & 1)
+						s = 0;
+					else if ((hi >> k) & 1)
+						s = 1;
+					mask |= s << k;
+				}
+			}
+			a2l_scatter(out + i * unitsize, unitsize, bit, mask, n);
+		}
+
+		if (state)
+			state[ch] = s;
+		g_free(buf);
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Convert several analog channels to packed logic data by using fixed
+ * thresholds.
+ *
+ * Bit i of each logic sample holds the state of channel i.
+ *
+ * @param[in] analogs The analog input values, one single channel packet
+ *                    per channel.
+ *                    All packets must hold the same number of samples.
+ * @param[in] num_channels The number of channels.
+ * @param[in] thresholds The thresholds to use, one per channel.
+ * @param[in,out] logic The converted output values. logic->unitsize
+ *                      must hold num_channels bits, logic->data must
+ *                      provide space for all samples. logic->length
+ *                      is set upon return.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Conversion failure.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_threshold_multi(const struct sr_datafeed_analog **analogs,
+		size_t num_channels, const float *thresholds,
+		struct sr_datafeed_logic *logic)
+{
+	if (!thresholds)
+		return SR_ERR_ARG;
+
+	return a2l_multi(analogs, num_channels, NULL, thresholds, NULL, logic);
+}
+
+/**
+ * Convert several analog channels to packed logic data by using a
+ * Schmitt-trigger algorithm.
+ *
+ * Bit i of each logic sample holds the state of channel i.
+ *
+ * @param[in] analogs The analog input values, one single channel packet
+ *                    per channel.
+ *                    All packets must hold the same number of samples.
+ * @param[in] num_channels The number of channels.
+ * @param[in] lo_thr The low thresholds, one per channel.
+ * @param[in] hi_thr The high thresholds, one per channel.
+ * @param[in,out] state The internal converter states, one per channel.
+ *                      Like the state of sr_a2l_schmitt_trigger().
+ * @param[in,out] logic The converted output values. logic->unitsize
+ *                      must hold num_channels bits, logic->data must
+ *                      provide space for all samples. logic->length
+ *                      is set upon return.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Conversion failure.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_schmitt_trigger_multi(const struct sr_datafeed_analog **analogs,
+		size_t num_channels, const float *lo_thr, const float *hi_thr,
+		uint8_t *state, struct sr_datafeed_logic *logic)
+{
+	if (!lo_thr || !hi_thr || !state)
+		return SR_ERR_ARG;
+
+	return a2l_multi(analogs, num_channels, lo_thr, hi_thr, state, logic);
+}
+
+/* Gather byte b of up to 8 words into one word, word i into byte i. */
+static inline uint64_t gather_bytes(const uint64_t *words, size_t count,
+		unsigned int b)
+{
+	uint64_t x;
+	size_t i;
+
+	x = 0;
+	for (i = 0; i < count; i++)
+		x |= ((words[i] >> (8 * b)) & 0xff) << (8 * i);
+
+	return x;
+}
+
+/**
+ * Convert channel-major logic data to sample-major units.
+ *
+ * The input consists of blocks of num_words 64-bit words in host byte
+ * order, each word holds 64 consecutive samples of one channel, LSB
+ * first. Bit i of the output samples holds the value of word i of the
+ * block. Transposes 8x8 bit tiles instead of moving single bits.
+ *
+ * @param src The channel-major input data.
+ * @param num_blocks The number of blocks of 64 samples.
+ * @param num_words The number of words per block, at most 16.
+ * @param dst The output samples, 64 per block.
+ *
+ * @private
+ */
+SR_PRIV void sr_bits_transpose_u16(const uint64_t *src, size_t num_blocks,
+		size_t num_words, uint16_t *dst)
+{
+	uint64_t lo, hi;
+	size_t blk, count_lo, count_hi;
+	unsigned int b, k;
+
+	count_lo = MIN(num_words, 8);
+	count_hi = num_words - count_lo;
+	for (blk = 0; blk < num_blocks; blk++) {
+		for (b = 0; b < 8; b++) {
+			lo = sr_bits_transpose_8x8(gather_bytes(src, count_lo, b));
+			hi = 0;
+			if (count_hi)
+				hi = sr_bits_transpose_8x8(gather_bytes(src + 8,
+					count_hi, b));
+			for (k = 0; k < 8; k++) {
+				*dst++ = ((lo >> (8 * k)) & 0xff) |
+					(((hi >> (8 * k)) & 0xff) << 8);
+			}
+		}
+		src += num_words;
+	}
+}
@@ -0,0 +1,852 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "convert"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Conversion of files between formats.
+ */
+
+/**
+ * @defgroup grp_convert File conversion
+ *
+ * Conversion of files between formats.
+ *
+ * A conversion reads a file with an input module, runs the data through
+ * an optional chain of transform modules, and writes it with one or more
+ * output modules. The stages run in threads of their own, with bounded
+ * queues between them: the input module parses the next part of the
+ * file while the transform modules process the previous packets, and
+ * the output modules format and write theirs. A stage blocks while the
+ * queue of the next one is full, so that memory use stays bounded.
+ *
+ * Transform and output instances get created once the input module has
+ * identified the input, since they need its device instance.
+ *
+ * @{
+ */
+
+/** @cond PRIVATE */
+/* Bytes of the input file which get parsed at a time. */
+#define CONVERT_CHUNK_SIZE	(4 * 1024 * 1024)
+
+/* Default number of packets which the queues between stages hold. */
+#define DEFAULT_QUEUE_DEPTH	16
+
+struct convert_transform {
+	const struct sr_transform_module *tmod;
+	GHashTable *options;
+	const struct sr_transform *t;
+};
+
+struct convert_output {
+	const struct sr_output_module *omod;
+	GHashTable *options;
+	char *filename;
+	struct sr_output_sink *sink;
+	const struct sr_output *o;
+};
+
+struct sr_convert {
+	struct sr_context *ctx;
+	const struct sr_input *in;
+	struct sr_session *session;
+	size_t queue_depth;
+	GSList *transforms;
+	GSList *outputs;
+	sr_convert_progress_callback progress_cb;
+	void *progress_cb_data;
+
+	char *filename;
+	GThread *input_thread;
+	gint cancel;
+
+	/* Transform stage, its thread and packet queue. */
+	GThread *transform_thread;
+	GMutex mutex;
+	GCond cond;
+	struct sr_datafeed_packet **queue;
+	size_t queue_size, queue_head, queue_count;
+	gboolean quit;
+
+	/* First error of any stage, and the progress. Protected by mutex. */
+	int error;
+	struct sr_convert_progress progress;
+	int64_t start_us;
+};
+/** @endcond */
+
+static void convert_error(struct sr_convert *conv, int ret)
+{
+	g_mutex_lock(&conv->mutex);
+	if (conv->error == SR_OK)
+		conv->error = ret;
+	g_mutex_unlock(&conv->mutex);
+}
+
+static int convert_error_get(struct sr_convert *conv)
+{
+	int ret;
+
+	g_mutex_lock(&conv->mutex);
+	ret = conv->error;
+	g_mutex_unlock(&conv->mutex);
+
+	return ret;
+}
+
+static uint64_t packet_samples(const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		return logic->unitsize ? logic->length / logic->unitsize : 0;
+	case SR_DF_LOGIC_RLE:
+		return sr_logic_rle_num_samples(packet->payload);
+	case SR_DF_LOGIC_PLANAR:
+		return ((const struct sr_datafeed_logic_planar *)
+			packet->payload)->num_samples;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		return analog->num_samples;
+	default:
+		return 0;
+	}
+}
+
+/* Pass a packet to the outputs, which queue it for their threads. */
+static void outputs_send(struct sr_convert *conv,
+		const struct sr_datafeed_packet *packet)
+{
+	struct convert_output *cout;
+	uint64_t samples;
+	GSList *l;
+	int ret;
+
+	for (l = conv->outputs; l; l = l->next) {
+		cout = l->data;
+		ret = sr_output_send_sink(cout->o, packet, cout->sink);
+		if (ret != SR_OK)
+			convert_error(conv, ret);
+	}
+
+	samples = packet_samples(packet);
+	if (!samples)
+		return;
+	g_mutex_lock(&conv->mutex);
+	conv->progress.packets++;
+	conv->progress.samples += samples;
+	g_mutex_unlock(&conv->mutex);
+}
+
+/* Run a packet through the transforms, like session_send_packet(). */
+static struct sr_datafeed_packet *transforms_run(struct sr_convert *conv,
+		struct sr_datafeed_packet *packet)
+{
+	struct convert_transform *ct;
+	struct sr_transform *t;
+	struct sr_datafeed_packet *packet_out;
+	GSList *l;
+	int ret;
+
+	for (l = conv->transforms; l; l = l->next) {
+		ct = l->data;
+		t = (struct sr_transform *)ct->t;
+		/* Don't let in-place transforms modify shared sample data. */
+		if ((t->module->flags & SR_TRANSFORM_INPLACE)
+				&& sr_packet_is_shared(packet)) {
+			ret = sr_transform_packet_cow(t, packet, &packet);
+			if (ret != SR_OK) {
+				sr_err("Cannot copy packet for transform module.");
+				convert_error(conv, ret);
+				return NULL;
+			}
+		}
+		ret = t->module->receive(t, packet, &packet_out);
+		if (ret < 0) {
+			sr_err("Error while running transform module: %d.", ret);
+			convert_error(conv, SR_ERR);
+			return NULL;
+		}
+		if (!packet_out)
+			return NULL;
+		packet = packet_out;
+	}
+
+	return packet;
+}
+
+static gpointer transform_thread(gpointer data)
+{
+	struct sr_convert *conv;
+	struct sr_datafeed_packet *packet, *packet_out;
+
+	conv = data;
+	sr_thread_policy_apply(conv->ctx, SR_THREAD_CONSUMER);
+
+	g_mutex_lock(&conv->mutex);
+	while (TRUE) {
+		while (!conv->queue_count && !conv->quit)
+			g_cond_wait(&conv->cond, &conv->mutex);
+		/* Only terminate after the queue got drained. */
+		if (!conv->queue_count)
+			break;
+		packet = conv->queue[conv->queue_head];
+		conv->queue_head++;
+		conv->queue_head %= conv->queue_size;
+		conv->queue_count--;
+		g_cond_broadcast(&conv->cond);
+		g_mutex_unlock(&conv->mutex);
+
+		packet_out = transforms_run(conv, packet);
+		if (packet_out)
+			outputs_send(conv, packet_out);
+		sr_packet_unref(packet);
+
+		g_mutex_lock(&conv->mutex);
+	}
+	g_mutex_unlock(&conv->mutex);
+
+	return NULL;
+}
+
+/* Take a reference of a packet into the queue of the transform stage. */
+static void transform_queue(struct sr_convert *conv,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_datafeed_packet *ref;
+	int ret;
+
+	ret = sr_packet_ref(packet, &ref);
+	if (ret != SR_OK) {
+		convert_error(conv, ret);
+		return;
+	}
+
+	/* Block while the queue is full, that's the backpressure. */
+	g_mutex_lock(&conv->mutex);
+	while (conv->queue_count == conv->queue_size)
+		g_cond_wait(&conv->cond, &conv->mutex);
+	conv->queue[(conv->queue_head + conv->queue_count)
+		% conv->queue_size] = ref;
+	conv->queue_count++;
+	g_cond_broadcast(&conv->cond);
+	g_mutex_unlock(&conv->mutex);
+}
+
+/* Receives the input module's packets, in the input thread. */
+static void convert_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct sr_convert *conv;
+
+	(void)sdi;
+
+	conv = cb_data;
+	if (conv->transform_thread)
+		transform_queue(conv, packet);
+	else
+		outputs_send(conv, packet);
+}
+
+/* Create the transforms and outputs for the input's device instance. */
+static int convert_setup(struct sr_convert *conv)
+{
+	struct sr_dev_inst *sdi;
+	struct convert_transform *ct;
+	struct convert_output *cout;
+	GSList *l;
+	int ret;
+
+	sdi = sr_input_dev_inst_get(conv->in);
+	ret = sr_session_dev_add(conv->session, sdi);
+	if (ret != SR_OK)
+		return ret;
+
+	for (l = conv->transforms; l; l = l->next) {
+		ct = l->data;
+		ct->t = sr_transform_new(ct->tmod, ct->options, sdi);
+		if (!ct->t) {
+			sr_err("Cannot create transform '%s'.", ct->tmod->id);
+			return SR_ERR;
+		}
+		/* The transform stage runs them, not the input's thread. */
+		conv->session->transforms = g_slist_remove(
+			conv->session->transforms, ct->t);
+	}
+
+	for (l = conv->outputs; l; l = l->next) {
+		cout = l->data;
+		cout->o = sr_output_new_async(cout->omod, cout->options, sdi,
+			cout->filename, cout->sink, conv->queue_depth);
+		if (!cout->o) {
+			sr_err("Cannot create output '%s'.", cout->omod->id);
+			return SR_ERR;
+		}
+	}
+
+	if (conv->transforms) {
+		conv->queue_size = conv->queue_depth;
+		conv->queue = g_malloc0(conv->queue_size * sizeof(conv->queue[0]));
+		conv->transform_thread = g_thread_try_new("sr-transform",
+			transform_thread, conv, NULL);
+		if (!conv->transform_thread) {
+			sr_err("Cannot start the transform thread.");
+			return SR_ERR;
+		}
+	}
+
+	return sr_session_datafeed_callback_add(conv->session,
+		convert_datafeed, conv);
+}
+
+static void progress_get(struct sr_convert *conv,
+		struct sr_convert_progress *progress)
+{
+	g_mutex_lock(&conv->mutex);
+	*progress = conv->progress;
+	g_mutex_unlock(&conv->mutex);
+
+	if (!progress->done && conv->start_us)
+		progress->elapsed_us = g_get_monotonic_time() - conv->start_us;
+	if (progress->elapsed_us > 0) {
+		progress->bytes_per_second = progress->bytes_read
+			* 1e6 / progress->elapsed_us;
+		progress->samples_per_second = progress->samples
+			* 1e6 / progress->elapsed_us;
+	}
+}
+
+static void progress_update(struct sr_convert *conv, uint64_t bytes_read)
+{
+	struct sr_convert_progress progress;
+
+	g_mutex_lock(&conv->mutex);
+	conv->progress.bytes_read = bytes_read;
+	g_mutex_unlock(&conv->mutex);
+
+	if (!conv->progress_cb)
+		return;
+	progress_get(conv, &progress);
+	conv->progress_cb(&progress, conv->progress_cb_data);
+}
+
+/* Feed the file to the input module, like sr_input_send_file(). */
+static int convert_input(struct sr_convert *conv)
+{
+	struct sr_input *in;
+	GMappedFile *map;
+	GError *error;
+	GString *chunk;
+	const char *data;
+	size_t len, pos, count;
+	gboolean ready;
+	int ret;
+
+	in = (struct sr_input *)conv->in;	/* "un-const" */
+
+	error = NULL;
+	map = g_mapped_file_new(conv->filename, FALSE, &error);
+	if (!map) {
+		sr_err("Failed to map %s: %s", conv->filename, error->message);
+		g_error_free(error);
+		return SR_ERR_IO;
+	}
+	data = g_mapped_file_get_contents(map);
+	len = g_mapped_file_get_length(map);
+	g_mutex_lock(&conv->mutex);
+	conv->progress.bytes_total = len;
+	g_mutex_unlock(&conv->mutex);
+
+	ret = SR_OK;
+	ready = FALSE;
+	chunk = NULL;
+	pos = 0;
+	while (pos < len && ret == SR_OK && !g_atomic_int_get(&conv->cancel)) {
+		if (ready && (in->module->flags & SR_INPUT_MAPPED)) {
+			ret = in->module->receive_mapped(in, data + pos,
+				len - pos);
+			pos = len;
+		} else {
+			count = MIN(CONVERT_CHUNK_SIZE, len - pos);
+			if (!chunk)
+				chunk = g_string_sized_new(count);
+			g_string_truncate(chunk, 0);
+			g_string_append_len(chunk, data + pos, count);
+			pos += count;
+			ret = sr_input_send(in, chunk);
+		}
+		if (ret == SR_OK && !ready && sr_input_dev_inst_get(in)) {
+			ready = TRUE;
+			ret = convert_setup(conv);
+		}
+		if (ret == SR_OK)
+			ret = convert_error_get(conv);
+		progress_update(conv, pos);
+	}
+	if (chunk)
+		g_string_free(chunk, TRUE);
+	g_mapped_file_unref(map);
+
+	if (ret != SR_OK || g_atomic_int_get(&conv->cancel))
+		return ret;
+	if (!ready) {
+		sr_err("Cannot identify the input data in %s.", conv->filename);
+		return SR_ERR_DATA;
+	}
+
+	return sr_input_end(in);
+}
+
+/* Drain the transform stage and the outputs, stop their threads. */
+static int convert_finish(struct sr_convert *conv)
+{
+	struct convert_output *cout;
+	GSList *l;
+	int ret;
+
+	if (conv->transform_thread) {
+		g_mutex_lock(&conv->mutex);
+		conv->quit = TRUE;
+		g_cond_broadcast(&conv->cond);
+		g_mutex_unlock(&conv->mutex);
+		g_thread_join(conv->transform_thread);
+		conv->transform_thread = NULL;
+	}
+
+	ret = SR_OK;
+	for (l = conv->outputs; l; l = l->next) {
+		cout = l->data;
+		if (cout->o && ret == SR_OK)
+			ret = sr_output_free(cout->o);
+		else if (cout->o)
+			sr_output_free(cout->o);
+		cout->o = NULL;
+	}
+
+	return ret;
+}
+
+static gpointer input_thread(gpointer data)
+{
+	struct sr_convert *conv;
+	int ret, finish_ret;
+
+	conv = data;
+	sr_thread_policy_apply(conv->ctx, SR_THREAD_IO);
+
+	ret = convert_input(conv);
+	finish_ret = convert_finish(conv);
+	convert_error(conv, ret != SR_OK ? ret : finish_ret);
+
+	g_mutex_lock(&conv->mutex);
+	conv->progress.elapsed_us = g_get_monotonic_time() - conv->start_us;
+	conv->progress.done = TRUE;
+	g_mutex_unlock(&conv->mutex);
+	if (conv->progress_cb)
+		progress_update(conv, conv->progress.bytes_read);
+
+	return NULL;
+}
+
+static void convert_transform_free(void *data)
+{
+	struct convert_transform *ct;
+
+	ct = data;
+	if (ct->t)
+		sr_transform_free(ct->t);
+	if (ct->options)
+		g_hash_table_unref(ct->options);
+	g_free(ct);
+}
+
+static void convert_output_free(void *data)
+{
+	struct convert_output *cout;
+
+	cout = data;
+	if (cout->o)
+		sr_output_free(cout->o);
+	if (cout->options)
+		g_hash_table_unref(cout->options);
+	g_free(cout->filename);
+	g_free(cout);
+}
+
+/**
+ * Create a new conversion.
+ *
+ * @param ctx The libsigrok context. Must not be NULL.
+ * @param in The input instance which reads the file, see sr_input_new()
+ *           and sr_input_scan_file(). Must not be NULL. The caller keeps
+ *           ownership, it must remain valid until the conversion got
+ *           freed.
+ * @param conv Pointer to store the new conversion at. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_convert_new(struct sr_context *ctx, const struct sr_input *in,
+		struct sr_convert **conv)
+{
+	struct sr_convert *c;
+	int ret;
+
+	if (!ctx || !in || !conv)
+		return SR_ERR_ARG;
+
+	c = g_malloc0(sizeof(*c));
+	ret = sr_session_new(ctx, &c->session);
+	if (ret != SR_OK) {
+		g_free(c);
+		return ret;
+	}
+	c->ctx = ctx;
+	c->in = in;
+	c->queue_depth = DEFAULT_QUEUE_DEPTH;
+	g_mutex_init(&c->mutex);
+	g_cond_init(&c->cond);
+	*conv = c;
+
+	return SR_OK;
+}
+
+/**
+ * Add a transform module to a conversion.
+ *
+ * Transforms get applied in the order in which they were added, all
+ * of them in one thread.
+ *
+ * @param conv The conversion. Must not be NULL, and not be started.
+ * @param tmod The transform module. Must not be NULL.
+ * @param options Module options, see sr_transform_new(). Can be NULL.
+ *                The table gets referenced.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The conversion was started.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_convert_transform_add(struct sr_convert *conv,
+		const struct sr_transform_module *tmod, GHashTable *options)
+{
+	struct convert_transform *ct;
+
+	if (!conv || !tmod)
+		return SR_ERR_ARG;
+	if (conv->filename)
+		return SR_ERR;
+
+	ct = g_malloc0(sizeof(*ct));
+	ct->tmod = tmod;
+	ct->options = options ? g_hash_table_ref(options) : NULL;
+	conv->transforms = g_slist_append(conv->transforms, ct);
+
+	return SR_OK;
+}
+
+/**
+ * Add an output module to a conversion.
+ *
+ * Each output formats and writes its data in a thread of its own, see
+ * sr_output_new_async().
+ *
+ * @param conv The conversion. Must not be NULL, and not be started.
+ * @param omod The output module. Must not be NULL.
+ * @param options Module options, see sr_output_new(). Can be NULL.
+ *                The table gets referenced.
+ * @param filename The file name, for modules which write files of their
+ *                 own. Can be NULL.
+ * @param sink The sink for the output. Must not be NULL. Must remain
+ *             valid until the conversion got freed.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The conversion was started.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_convert_output_add(struct sr_convert *conv,
+		const struct sr_output_module *omod, GHashTable *options,
+		const char *filename, struct sr_output_sink *sink)
+{
+	struct convert_output *cout;
+
+	if (!conv || !omod || !sink)
+		return SR_ERR_ARG;
+	if (conv->filename)
+		return SR_ERR;
+
+	cout = g_malloc0(sizeof(*cout));
+	cout->omod = omod;
+	cout->options = options ? g_hash_table_ref(options) : NULL;
+	cout->filename = g_strdup(filename);
+	cout->sink = sink;
+	conv->outputs = g_slist_append(conv->outputs, cout);
+
+	return SR_OK;
+}
+
+/**
+ * Set the depth of the queues between the stages of a conversion.
+ *
+ * Deeper queues even out stages whose speed varies, at the expense of
+ * memory: each queued packet holds a copy of its sample data.
+ *
+ * @param conv The conversion. Must not be NULL, and not be started.
+ * @param queue_depth Number of packets each queue holds, 0 for a default.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The conversion was started.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_convert_queue_depth_set(struct sr_convert *conv,
+		size_t queue_depth)
+{
+	if (!conv)
+		return SR_ERR_ARG;
+	if (conv->filename)
+		return SR_ERR;
+
+	conv->queue_depth = queue_depth ? queue_depth : DEFAULT_QUEUE_DEPTH;
+
+	return SR_OK;
+}
+
+/**
+ * Set a callback which reports the progress of a conversion.
+ *
+ * The callback runs in the input thread, after each part of the file
+ * which the input module parsed, and once more when the conversion is
+ * done. It should return quickly, since parsing waits for it.
+ *
+ * @param conv The conversion. Must not be NULL, and not be started.
+ * @param cb The callback, or NULL for none.
+ * @param cb_data Opaque pointer passed to the callback.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The conversion was started.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_convert_progress_callback_set(struct sr_convert *conv,
+		sr_convert_progress_callback cb, void *cb_data)
+{
+	if (!conv)
+		return SR_ERR_ARG;
+	if (conv->filename)
+		return SR_ERR;
+
+	conv->progress_cb = cb;
+	conv->progress_cb_data = cb_data;
+
+	return SR_OK;
+}
+
+/**
+ * Start a conversion.
+ *
+ * The file gets converted in the background, see sr_convert_wait().
+ * A conversion can only be started once.
+ *
+ * @param conv The conversion. Must not be NULL.
+ * @param filename The name of the file to convert. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or no outputs were added.
+ * @retval SR_ERR The conversion was started before, or the thread
+ *                could not be started.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_convert_start(struct sr_convert *conv, const char *filename)
+{
+	if (!conv || !filename)
+		return SR_ERR_ARG;
+	if (!conv->outputs) {
+		sr_err("A conversion needs at least one output.");
+		return SR_ERR_ARG;
+	}
+	if (conv->filename)
+		return SR_ERR;
+
+	conv->filename = g_strdup(filename);
+	conv->start_us = g_get_monotonic_time();
+	conv->input_thread = g_thread_try_new("sr-convert",
+		input_thread, conv, NULL);
+	if (!conv->input_thread) {
+		sr_err("Cannot start the conversion thread.");
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Wait for a conversion to finish.
+ *
+ * All stages have processed all of their data when this returns, and
+ * the outputs' sinks have been flushed.
+ *
+ * @param conv The conversion. Must not be NULL.
+ *
+ * @retval SR_OK Success, or the conversion was cancelled.
+ * @retval SR_ERR_ARG Invalid argument, or the conversion was not started.
+ * @retval other The first error of the input, a transform or an output.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_convert_wait(struct sr_convert *conv)
+{
+	if (!conv || !conv->filename)
+		return SR_ERR_ARG;
+
+	if (conv->input_thread) {
+		g_thread_join(conv->input_thread);
+		conv->input_thread = NULL;
+	}
+
+	return convert_error_get(conv);
+}
+
+/**
+ * Convert a file, and wait for the conversion to finish.
+ *
+ * This is sr_convert_start() followed by sr_convert_wait().
+ *
+ * @param conv The conversion. Must not be NULL.
+ * @param filename The name of the file to convert. Must not be NULL.
+ *
+ * @return See sr_convert_start() and sr_convert_wait().
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_convert_run(struct sr_convert *conv, const char *filename)
+{
+	int ret;
+
+	ret = sr_convert_start(conv, filename);
+	if (ret != SR_OK)
+		return ret;
+
+	return sr_convert_wait(conv);
+}
+
+/**
+ * Cancel a conversion.
+ *
+ * The input module stops parsing, after the part of the file which it
+ * is processing. The packets which it already sent still get written,
+ * but the outputs don't receive an SR_DF_END packet. Call
+ * sr_convert_wait() to wait for the stages to stop.
+ *
+ * @param conv The conversion. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_convert_cancel(struct sr_convert *conv)
+{
+	if (!conv)
+		return SR_ERR_ARG;
+
+	g_atomic_int_set(&conv->cancel, 1);
+
+	return SR_OK;
+}
+
+/**
+ * Get the progress of a conversion.
+ *
+ * Input modules which parse the file in place (SR_INPUT_MAPPED) get
+ * the remainder of the file at once, after they identified the input.
+ * For them the number of bytes read only advances at the end, while
+ * the number of samples advances as the data gets written.
+ *
+ * @param conv The conversion. Must not be NULL.
+ * @param progress Pointer to store the progress at. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_convert_progress_get(struct sr_convert *conv,
+		struct sr_convert_progress *progress)
+{
+	if (!conv || !progress)
+		return SR_ERR_ARG;
+
+	progress_get(conv, progress);
+
+	return SR_OK;
+}
+
+/**
+ * Free a conversion.
+ *
+ * A conversion which is still running gets cancelled first, see
+ * sr_convert_cancel().
+ *
+ * @param conv The conversion. Can be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_convert_free(struct sr_convert *conv)
+{
+	if (!conv)
+		return;
+
+	if (conv->input_thread) {
+		sr_convert_cancel(conv);
+		sr_convert_wait(conv);
+	}
+	g_slist_free_full(conv->outputs, convert_output_free);
+	g_slist_free_full(conv->transforms, convert_transform_free);
+	sr_session_destroy(conv->session);
+	g_free(conv->queue);
+	g_free(conv->filename);
+	g_mutex_clear(&conv->mutex);
+	g_cond_clear(&conv->cond);
+	g_free(conv);
+}
+
+/** @} */
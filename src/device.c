@@ -71,6 +71,7 @@ SR_PRIV struct sr_channel *sr_channel_new(struct sr_dev_inst *sdi,
 		ch->name = g_strdup(name);
 
 	sdi->channels = g_slist_append(sdi->channels, ch);
+	sr_dev_channels_changed(sdi);
 
 	return ch;
 }
@@ -151,6 +152,10 @@ SR_API int sr_dev_channel_enable(struct sr_channel *channel, gboolean state)
 	sdi = channel->sdi;
 	was_enabled = channel->enabled;
 	channel->enabled = state;
+	if (!state != !was_enabled && sdi) {
+		sr_dev_channels_changed(sdi);
+		sr_dev_rearm_invalidate(sdi);
+	}
 	if (!state != !was_enabled && sdi->driver
 			&& sdi->driver->config_channel_set) {
 		ret = sdi->driver->config_channel_set(
@@ -170,26 +175,135 @@ SR_API int sr_dev_channel_enable(struct sr_channel *channel, gboolean state)
  *                Must not be NULL.
  * @param[in] cur_channel The current channel.
  *
- * @return A pointer to the next enabled channel of this device.
+ * @return A pointer to the next enabled channel of this device, NULL if
+ *         none is enabled.
  *
  * @private
  */
 SR_PRIV struct sr_channel *sr_next_enabled_channel(const struct sr_dev_inst *sdi,
 		struct sr_channel *cur_channel)
 {
-	struct sr_channel *next_channel;
+	struct sr_channel *const *channels;
+	size_t count, start, i;
+
+	channels = sr_dev_channel_array(sdi, SR_CHANNELS_ALL, &count);
+	if (!count)
+		return NULL;
+
+	for (start = 0; start < count; start++) {
+		if (channels[start] == cur_channel)
+			break;
+	}
+	if (start == count)
+		start = count - 1;
+
+	for (i = 1; i <= count; i++) {
+		if (channels[(start + i) % count]->enabled)
+			return channels[(start + i) % count];
+	}
+
+	return NULL;
+}
+
+/** @cond PRIVATE */
+struct sr_dev_channel_cache {
+	/* The list which the arrays were built from. */
+	GSList *list;
+	gboolean valid;
+	GPtrArray *sets[SR_CHANNEL_SETS];
+};
+/** @endcond */
+
+static void channel_cache_build(struct sr_dev_inst *sdi)
+{
+	struct sr_dev_channel_cache *cache;
+	struct sr_channel *ch;
 	GSList *l;
+	size_t i;
+
+	cache = sdi->channel_cache;
+	if (!cache) {
+		cache = g_malloc0(sizeof(*cache));
+		for (i = 0; i < SR_CHANNEL_SETS; i++)
+			cache->sets[i] = g_ptr_array_new();
+		sdi->channel_cache = cache;
+	}
+	for (i = 0; i < SR_CHANNEL_SETS; i++)
+		g_ptr_array_set_size(cache->sets[i], 0);
 
-	next_channel = cur_channel;
-	do {
-		l = g_slist_find(sdi->channels, next_channel);
-		if (l && l->next)
-			next_channel = l->next->data;
-		else
-			next_channel = sdi->channels->data;
-	} while (!next_channel->enabled);
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		g_ptr_array_add(cache->sets[SR_CHANNELS_ALL], ch);
+		if (ch->type == SR_CHANNEL_LOGIC)
+			g_ptr_array_add(cache->sets[SR_CHANNELS_LOGIC], ch);
+		else if (ch->type == SR_CHANNEL_ANALOG)
+			g_ptr_array_add(cache->sets[SR_CHANNELS_ANALOG], ch);
+		if (!ch->enabled)
+			continue;
+		g_ptr_array_add(cache->sets[SR_CHANNELS_ENABLED], ch);
+		if (ch->type == SR_CHANNEL_LOGIC)
+			g_ptr_array_add(cache->sets[SR_CHANNELS_ENABLED_LOGIC], ch);
+		else if (ch->type == SR_CHANNEL_ANALOG)
+			g_ptr_array_add(cache->sets[SR_CHANNELS_ENABLED_ANALOG], ch);
+	}
 
-	return next_channel;
+	cache->list = sdi->channels;
+	cache->valid = TRUE;
+}
+
+/**
+ * Get a subset of a device's channels as an array.
+ *
+ * The arrays are built on first use and kept until the device's
+ * channels change, so that code which runs per packet or per sample
+ * needn't walk the channel list. They hold the channels in the order
+ * of the list.
+ *
+ * @param[in] sdi The device instance.
+ * @param[in] set The subset of channels.
+ * @param[out] count The number of channels in the array.
+ *
+ * @return The array, valid until the device's channels change.
+ *
+ * @private
+ */
+SR_PRIV struct sr_channel *const *sr_dev_channel_array(
+		const struct sr_dev_inst *sdi, enum sr_channel_set set,
+		size_t *count)
+{
+	struct sr_dev_channel_cache *cache;
+
+	*count = 0;
+	if (!sdi || set >= SR_CHANNEL_SETS)
+		return NULL;
+
+	/* Replacing the whole list is detected without notification. */
+	cache = sdi->channel_cache;
+	if (!cache || !cache->valid || cache->list != sdi->channels)
+		channel_cache_build((struct sr_dev_inst *)sdi);
+	cache = sdi->channel_cache;
+
+	*count = cache->sets[set]->len;
+
+	return (struct sr_channel *const *)cache->sets[set]->pdata;
+}
+
+/**
+ * Drop a device's channel arrays after its channels changed.
+ *
+ * Must be called whenever channels get added to or removed from
+ * the device, or get enabled or disabled, unless the whole list
+ * gets replaced.
+ *
+ * @param[in] sdi The device instance.
+ *
+ * @private
+ */
+SR_PRIV void sr_dev_channels_changed(struct sr_dev_inst *sdi)
+{
+	if (sdi && sdi->channel_cache)
+		sdi->channel_cache->valid = FALSE;
+	sr_config_lists_invalidate(sdi);
 }
 
 /**
@@ -450,6 +564,7 @@ SR_PRIV void sr_dev_inst_free(struct sr_dev_inst *sdi)
 	struct sr_channel *ch;
 	struct sr_channel_group *cg;
 	GSList *l;
+	size_t i;
 
 	if (!sdi)
 		return;
@@ -460,6 +575,16 @@ SR_PRIV void sr_dev_inst_free(struct sr_dev_inst *sdi)
 	}
 	g_slist_free(sdi->channels);
 
+	if (sdi->channel_cache) {
+		for (i = 0; i < SR_CHANNEL_SETS; i++)
+			g_ptr_array_free(sdi->channel_cache->sets[i], TRUE);
+		g_free(sdi->channel_cache);
+	}
+
+	sr_session_meta_cache_free(sdi);
+	sr_config_state_free(sdi);
+	sr_session_packet_clock_free(sdi);
+
 	for (l = sdi->channel_groups; l; l = l->next) {
 		cg = l->data;
 		g_free(cg->name);
@@ -683,6 +808,7 @@ SR_API int sr_dev_open(struct sr_dev_inst *sdi)
 
 	if (ret == SR_OK)
 		sdi->status = SR_ST_ACTIVE;
+	sr_config_lists_invalidate(sdi);
 
 	return ret;
 }
@@ -718,12 +844,168 @@ SR_API int sr_dev_close(struct sr_dev_inst *sdi)
 	}
 
 	sdi->status = SR_ST_INACTIVE;
+	sdi->armed = FALSE;
+	sr_config_lists_invalidate(sdi);
 
 	sr_dbg("%s: Closing device instance.", sdi->driver->name);
 
 	return sdi->driver->dev_close(sdi);
 }
 
+/** @cond PRIVATE */
+/* Most groups of devices which sr_dev_open_many() opens at a time. */
+#define OPEN_THREADS 8
+/** @endcond */
+
+struct open_many_ctx {
+	struct sr_dev_inst **devs;
+	int *results;
+	gboolean open;
+};
+
+/*
+ * Serial, SCPI and Modbus devices talk through connections of their
+ * own, they open alone. Devices of other drivers (USB devices mostly)
+ * open one after the other per driver, since their drivers share state
+ * like firmware uploads and the waits for the renumeration.
+ */
+static gboolean open_many_alone(const struct sr_dev_inst *sdi)
+{
+	return sdi->inst_type == SR_INST_SERIAL
+		|| sdi->inst_type == SR_INST_SCPI
+		|| sdi->inst_type == SR_INST_MODBUS;
+}
+
+/* Open or close the devices of a group one after the other. */
+static void open_many_run(gpointer data, gpointer user_data)
+{
+	struct open_many_ctx *ctx;
+	GSList *indices, *l;
+	guint i;
+
+	indices = data;
+	ctx = user_data;
+	for (l = indices; l; l = l->next) {
+		i = GPOINTER_TO_UINT(l->data);
+		if (ctx->open)
+			ctx->results[i] = sr_dev_open(ctx->devs[i]);
+		else
+			ctx->results[i] = sr_dev_close(ctx->devs[i]);
+	}
+	g_slist_free(indices);
+}
+
+static int open_many(GSList *devices, int *results, gboolean open)
+{
+	struct open_many_ctx ctx;
+	struct sr_dev_inst *sdi;
+	GHashTable *groups;
+	GSList *jobs, *l;
+	GThreadPool *pool;
+	guint i, count;
+	int ret;
+
+	count = g_slist_length(devices);
+	ctx.devs = g_malloc0_n(count, sizeof(*ctx.devs));
+	ctx.results = g_malloc0_n(count, sizeof(*ctx.results));
+	ctx.open = open;
+
+	/* Group the devices by driver, keep the order within groups. */
+	groups = g_hash_table_new(NULL, NULL);
+	jobs = NULL;
+	for (l = devices, i = 0; l; l = l->next, i++) {
+		ctx.devs[i] = sdi = l->data;
+		if (!sdi || !sdi->driver) {
+			ctx.results[i] = SR_ERR_ARG;
+		} else if (open_many_alone(sdi)) {
+			jobs = g_slist_append(jobs,
+				g_slist_append(NULL, GUINT_TO_POINTER(i)));
+		} else {
+			g_hash_table_insert(groups, sdi->driver, g_slist_append(
+				g_hash_table_lookup(groups, sdi->driver),
+				GUINT_TO_POINTER(i)));
+		}
+	}
+	jobs = g_slist_concat(jobs, g_hash_table_get_values(groups));
+	g_hash_table_destroy(groups);
+
+	pool = g_thread_pool_new(open_many_run, &ctx, OPEN_THREADS, FALSE, NULL);
+	for (l = jobs; l; l = l->next) {
+		if (!pool || !g_thread_pool_push(pool, l->data, NULL))
+			open_many_run(l->data, &ctx);
+	}
+	if (pool)
+		g_thread_pool_free(pool, FALSE, TRUE);
+	g_slist_free(jobs);
+
+	ret = SR_OK;
+	for (i = 0; i < count; i++) {
+		if (results)
+			results[i] = ctx.results[i];
+		if (ret == SR_OK)
+			ret = ctx.results[i];
+	}
+	g_free(ctx.devs);
+	g_free(ctx.results);
+
+	return ret;
+}
+
+/**
+ * Open several device instances at the same time.
+ *
+ * This does what sr_dev_open() does for each of the devices, on a pool
+ * of threads. Opening many devices then takes about as long as the
+ * slowest of them, instead of the sum of all of them.
+ *
+ * Devices which talk through connections of their own (serial, SCPI
+ * and Modbus devices) open independently. The devices of other drivers,
+ * which usually are USB devices, open one after the other per driver.
+ * This function returns when all the devices have been opened, or
+ * failed to open.
+ *
+ * @param devices List of struct sr_dev_inst pointers. Must not be NULL.
+ * @param results Array to store the result of sr_dev_open() for each
+ *                device at, in the order of @a devices. Can be NULL.
+ *
+ * @retval SR_OK All devices were opened.
+ * @return Otherwise the result of the first device in the list which
+ *         failed to open. Other devices may have been opened.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_dev_open_many(GSList *devices, int *results)
+{
+	if (!devices)
+		return SR_ERR_ARG;
+
+	return open_many(devices, results, TRUE);
+}
+
+/**
+ * Close several device instances at the same time.
+ *
+ * This does what sr_dev_close() does for each of the devices, grouped
+ * as with sr_dev_open_many().
+ *
+ * @param devices List of struct sr_dev_inst pointers. Must not be NULL.
+ * @param results Array to store the result of sr_dev_close() for each
+ *                device at, in the order of @a devices. Can be NULL.
+ *
+ * @retval SR_OK All devices were closed.
+ * @return Otherwise the result of the first device in the list which
+ *         failed to close. All devices are inactive afterwards.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_dev_close_many(GSList *devices, int *results)
+{
+	if (!devices)
+		return SR_ERR_ARG;
+
+	return open_many(devices, results, FALSE);
+}
+
 /**
  * Queries a device instances' driver.
  *
@@ -843,7 +1125,7 @@ SR_API const char *sr_dev_inst_connid_get(const struct sr_dev_inst *sdi)
 		drvc = sdi->driver->context;
 		usb = sdi->conn;
 
-		if ((cnt = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist)) < 0) {
+		if ((cnt = usb_get_device_list(drvc->sr_ctx, &devlist)) < 0) {
 			sr_err("Failed to retrieve device list: %s.",
 			       libusb_error_name(cnt));
 			return NULL;
@@ -856,7 +1138,7 @@ SR_API const char *sr_dev_inst_connid_get(const struct sr_dev_inst *sdi)
 			if (b != usb->bus || a != usb->address)
 				continue;
 
-			if (usb_get_port_path(devlist[i], conn_id_usb, sizeof(conn_id_usb)) < 0)
+			if (usb_get_port_path(drvc->sr_ctx, devlist[i], conn_id_usb, sizeof(conn_id_usb)) < 0)
 				continue;
 
 			((struct sr_dev_inst *)sdi)->connection_id = g_strdup(conn_id_usb);
@@ -210,40 +210,47 @@ SR_PRIV gboolean sr_brymen_bm82x_packet_valid(const uint8_t *buf)
  * indicators exist for main and secondary displays in different locations.
  */
 
-static char brymen_bm52x_parse_digit(uint8_t b)
-{
-	switch (b & ~0x10) {
+/* Characters of segment patterns, the 0x10 bit is not a segment. */
+static const uint8_t digit_table[256] = {
 	/* Sign. */
-	case 0x40: /* ------g */ return '-';
+	SR_SEG7_ENTRY(0x40, '-'), /* ------g */
 	/* Decimal digits. */
-	case 0xaf: /* abcdef- */ return '0';
-	case 0xa0: /* -bc---- */ return '1';
-	case 0xcb: /* ab-de-g */ return '2';
-	case 0xe9: /* abcd--g */ return '3';
-	case 0xe4: /* -bc--fg */ return '4';
-	case 0x6d: /* a-cd-fg */ return '5';
-	case 0x6f: /* a-cdefg */ return '6';
-	case 0xa8: /* abc---- */ return '7';
-	case 0xef: /* abcdefg */ return '8';
-	case 0xed: /* abcd-fg */ return '9';
+	SR_SEG7_ENTRY(0xaf, '0'), /* abcdef- */
+	SR_SEG7_ENTRY(0xa0, '1'), /* -bc---- */
+	SR_SEG7_ENTRY(0xcb, '2'), /* ab-de-g */
+	SR_SEG7_ENTRY(0xe9, '3'), /* abcd--g */
+	SR_SEG7_ENTRY(0xe4, '4'), /* -bc--fg */
+	SR_SEG7_ENTRY(0x6d, '5'), /* a-cd-fg */
+	SR_SEG7_ENTRY(0x6f, '6'), /* a-cdefg */
+	SR_SEG7_ENTRY(0xa8, '7'), /* abc---- */
+	SR_SEG7_ENTRY(0xef, '8'), /* abcdefg */
+	SR_SEG7_ENTRY(0xed, '9'), /* abcd-fg */
 	/* Temperature units. */
-	case 0x0f: /* a--def- */ return 'C';
-	case 0x4e: /* a---efg */ return 'F';
+	SR_SEG7_ENTRY(0x0f, 'C'), /* a--def- */
+	SR_SEG7_ENTRY(0x4e, 'F'), /* a---efg */
 	/* OL condition, and diode and "Auto" modes. */
-	case 0x07: /* ---def- */ return 'L';
-	case 0xe3: /* -bcde-g */ return 'd';
-	case 0x20: /* --c---- */ return 'i';
-	case 0x63: /* --cde-g */ return 'o';
-	case 0xee: /* abc-efg */ return 'A';
-	case 0x23: /* --cde-- */ return 'u';
-	case 0x47: /* ---defg */ return 't';
+	SR_SEG7_ENTRY(0x07, 'L'), /* ---def- */
+	SR_SEG7_ENTRY(0xe3, 'd'), /* -bcde-g */
+	SR_SEG7_ENTRY(0x20, 'i'), /* --c---- */
+	SR_SEG7_ENTRY(0x63, 'o'), /* --cde-g */
+	SR_SEG7_ENTRY(0xee, 'A'), /* abc-efg */
+	SR_SEG7_ENTRY(0x23, 'u'), /* --cde-- */
+	SR_SEG7_ENTRY(0x47, 't'), /* ---defg */
 	/* Blank digit. */
-	case 0x00: /* ------- */ return '\0';
-	/* Invalid or unknown segment combination. */
-	default:
+	SR_SEG7_ENTRY(0x00, '\0'), /* ------- */
+};
+
+static char brymen_bm52x_parse_digit(uint8_t b)
+{
+	int c;
+
+	c = sr_seg7_lookup(digit_table, b & ~0x10);
+	if (c < 0) {
 		sr_warn("Unknown encoding for digit: 0x%02x.", b);
 		return '\0';
 	}
+
+	return c;
 }
 
 static int brymen_bm52x_parse_digits(const uint8_t *pkt, size_t pktlen,
@@ -74,37 +74,44 @@ SR_PRIV gboolean sr_brymen_bm86x_packet_valid(const uint8_t *buf)
  * contains indicators, the value's digits start at the second byte.
  */
 
-static char brymen_bm86x_parse_digit(uint8_t b)
-{
-	switch (b >> 1) {
+/* Characters of segment patterns, shifted right by one bit. */
+static const uint8_t digit_table[128] = {
 	/* Sign. */
-	case 0x20: return '-';
+	SR_SEG7_ENTRY(0x20, '-'),
 	/* Decimal digits. */
-	case 0x5f: return '0';
-	case 0x50: return '1';
-	case 0x6d: return '2';
-	case 0x7c: return '3';
-	case 0x72: return '4';
-	case 0x3e: return '5';
-	case 0x3f: return '6';
-	case 0x54: return '7';
-	case 0x7f: return '8';
-	case 0x7e: return '9';
+	SR_SEG7_ENTRY(0x5f, '0'),
+	SR_SEG7_ENTRY(0x50, '1'),
+	SR_SEG7_ENTRY(0x6d, '2'),
+	SR_SEG7_ENTRY(0x7c, '3'),
+	SR_SEG7_ENTRY(0x72, '4'),
+	SR_SEG7_ENTRY(0x3e, '5'),
+	SR_SEG7_ENTRY(0x3f, '6'),
+	SR_SEG7_ENTRY(0x54, '7'),
+	SR_SEG7_ENTRY(0x7f, '8'),
+	SR_SEG7_ENTRY(0x7e, '9'),
 	/* Temperature units. */
-	case 0x0f: return 'C';
-	case 0x27: return 'F';
+	SR_SEG7_ENTRY(0x0f, 'C'),
+	SR_SEG7_ENTRY(0x27, 'F'),
 	/* OL condition, and diode mode. */
-	case 0x0b: return 'L';
-	case 0x79: return 'd';
-	case 0x10: return 'i';
-	case 0x39: return 'o';
+	SR_SEG7_ENTRY(0x0b, 'L'),
+	SR_SEG7_ENTRY(0x79, 'd'),
+	SR_SEG7_ENTRY(0x10, 'i'),
+	SR_SEG7_ENTRY(0x39, 'o'),
 	/* Blank digit. */
-	case 0x00: return '\0';
-	/* Invalid or unknown segment combination. */
-	default:
+	SR_SEG7_ENTRY(0x00, '\0'),
+};
+
+static char brymen_bm86x_parse_digit(uint8_t b)
+{
+	int c;
+
+	c = sr_seg7_lookup(digit_table, b >> 1);
+	if (c < 0) {
 		sr_warn("Unknown encoding for digit: 0x%02x.", b);
 		return '\0';
 	}
+
+	return c;
 }
 
 static int brymen_bm86x_parse_digits(const uint8_t *pkt, size_t pktlen,
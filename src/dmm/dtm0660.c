@@ -39,33 +39,29 @@
 
 #define LOG_PREFIX "dtm0660"
 
+/* Digit values of the display's segment patterns. */
+static const uint8_t digit_table[256] = {
+	SR_SEG7_ENTRY(0xeb, 0),
+	SR_SEG7_ENTRY(0x0a, 1),
+	SR_SEG7_ENTRY(0xad, 2),
+	SR_SEG7_ENTRY(0x8f, 3),
+	SR_SEG7_ENTRY(0x4e, 4),
+	SR_SEG7_ENTRY(0xc7, 5),
+	SR_SEG7_ENTRY(0xe7, 6),
+	SR_SEG7_ENTRY(0x8a, 7),
+	SR_SEG7_ENTRY(0xef, 8),
+	SR_SEG7_ENTRY(0xcf, 9),
+};
+
 static int parse_digit(uint8_t b)
 {
-	switch (b) {
-	case 0xeb:
-		return 0;
-	case 0x0a:
-		return 1;
-	case 0xad:
-		return 2;
-	case 0x8f:
-		return 3;
-	case 0x4e:
-		return 4;
-	case 0xc7:
-		return 5;
-	case 0xe7:
-		return 6;
-	case 0x8a:
-		return 7;
-	case 0xef:
-		return 8;
-	case 0xcf:
-		return 9;
-	default:
+	int digit;
+
+	digit = sr_seg7_lookup(digit_table, b);
+	if (digit < 0)
 		sr_dbg("Invalid digit byte: 0x%02x.", b);
-		return -1;
-	}
+
+	return digit;
 }
 
 static gboolean sync_nibbles_valid(const uint8_t *buf)
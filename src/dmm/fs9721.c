@@ -40,33 +40,29 @@
 
 #define LOG_PREFIX "fs9721"
 
+/* Digit values of the display's segment patterns. */
+static const uint8_t digit_table[256] = {
+	SR_SEG7_ENTRY(0x7d, 0),
+	SR_SEG7_ENTRY(0x05, 1),
+	SR_SEG7_ENTRY(0x5b, 2),
+	SR_SEG7_ENTRY(0x1f, 3),
+	SR_SEG7_ENTRY(0x27, 4),
+	SR_SEG7_ENTRY(0x3e, 5),
+	SR_SEG7_ENTRY(0x7e, 6),
+	SR_SEG7_ENTRY(0x15, 7),
+	SR_SEG7_ENTRY(0x7f, 8),
+	SR_SEG7_ENTRY(0x3f, 9),
+};
+
 static int parse_digit(uint8_t b)
 {
-	switch (b) {
-	case 0x7d:
-		return 0;
-	case 0x05:
-		return 1;
-	case 0x5b:
-		return 2;
-	case 0x1f:
-		return 3;
-	case 0x27:
-		return 4;
-	case 0x3e:
-		return 5;
-	case 0x7e:
-		return 6;
-	case 0x15:
-		return 7;
-	case 0x7f:
-		return 8;
-	case 0x3f:
-		return 9;
-	default:
+	int digit;
+
+	digit = sr_seg7_lookup(digit_table, b);
+	if (digit < 0)
 		sr_dbg("Invalid digit byte: 0x%02x.", b);
-		return -1;
-	}
+
+	return digit;
 }
 
 static gboolean sync_nibbles_valid(const uint8_t *buf)
@@ -76,36 +76,31 @@ static int parse_digit(uint16_t b)
 	}
 }
 
+/* Second display digit values of segment patterns (blank reads as 0). */
+static const uint8_t digit2_table[256] = {
+	SR_SEG7_ENTRY(0x00, 0),
+	SR_SEG7_ENTRY(0x7D, 0),
+	SR_SEG7_ENTRY(0x05, 1),
+	SR_SEG7_ENTRY(0x1B, 2),
+	SR_SEG7_ENTRY(0x1F, 3),
+	SR_SEG7_ENTRY(0x27, 4),
+	SR_SEG7_ENTRY(0x3E, 5),
+	SR_SEG7_ENTRY(0x7E, 6),
+	SR_SEG7_ENTRY(0x15, 7),
+	SR_SEG7_ENTRY(0x7F, 8),
+	SR_SEG7_ENTRY(0x3F, 9),
+};
+
 /* Parse second display. */
 static int parse_digit2(uint16_t b)
 {
-	switch (b) {
-	case 0x00:
-		return 0;
-	case 0x7D:
-		return 0;
-	case 0x05:
-		return 1;
-	case 0x1B:
-		return 2;
-	case 0x1F:
-		return 3;
-	case 0x27:
-		return 4;
-	case 0x3E:
-		return 5;
-	case 0x7E:
-		return 6;
-	case 0x15:
-		return 7;
-	case 0x7F:
-		return 8;
-	case 0x3F:
-		return 9;
-	default:
+	int digit;
+
+	digit = (b <= 0xff) ? sr_seg7_lookup(digit2_table, b) : -1;
+	if (digit < 0)
 		sr_dbg("Invalid second display digit word: 0x%04x.", b);
-		return -1;
-	}
+
+	return digit;
 }
 
 static void parse_flags(const uint8_t *buf, struct ms8250d_info *info)
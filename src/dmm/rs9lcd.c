@@ -221,37 +221,35 @@ SR_PRIV gboolean sr_rs9lcd_packet_valid(const uint8_t *buf)
 	return TRUE;
 }
 
+/* Digit values of segment patterns, without the decimal point. */
+static const uint8_t digit_table[256] = {
+	SR_SEG7_ENTRY(0x00, 0),
+	SR_SEG7_ENTRY(LCD_0, 0),
+	SR_SEG7_ENTRY(LCD_1, 1),
+	SR_SEG7_ENTRY(LCD_2, 2),
+	SR_SEG7_ENTRY(LCD_3, 3),
+	SR_SEG7_ENTRY(LCD_4, 4),
+	SR_SEG7_ENTRY(LCD_5, 5),
+	SR_SEG7_ENTRY(LCD_6, 6),
+	SR_SEG7_ENTRY(LCD_7, 7),
+	SR_SEG7_ENTRY(LCD_8, 8),
+	SR_SEG7_ENTRY(LCD_9, 9),
+};
+
 static uint8_t decode_digit(uint8_t raw_digit)
 {
-	/* Take out the decimal point, so we can use a simple switch(). */
+	int digit;
+
+	/* Take out the decimal point, the table has no entries for it. */
 	raw_digit &= ~DP_MASK;
 
-	switch (raw_digit) {
-	case 0x00:
-	case LCD_0:
-		return 0;
-	case LCD_1:
-		return 1;
-	case LCD_2:
-		return 2;
-	case LCD_3:
-		return 3;
-	case LCD_4:
-		return 4;
-	case LCD_5:
-		return 5;
-	case LCD_6:
-		return 6;
-	case LCD_7:
-		return 7;
-	case LCD_8:
-		return 8;
-	case LCD_9:
-		return 9;
-	default:
+	digit = sr_seg7_lookup(digit_table, raw_digit);
+	if (digit < 0) {
 		sr_dbg("Invalid digit byte: 0x%02x.", raw_digit);
 		return 0xff;
 	}
+
+	return digit;
 }
 
 static double lcd_to_double(const struct rs9lcd_packet *rs_packet, int type,
@@ -20,6 +20,7 @@
  */
 
 #include <config.h>
+#include <string.h>
 #include <glib.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -34,8 +35,29 @@
 SR_PRIV extern const struct sr_dev_driver *sr_driver_list__start[];
 SR_PRIV extern const struct sr_dev_driver *sr_driver_list__stop[];
 
+/* Check whether a driver is in the context's selection, if it has one. */
+static gboolean driver_selected(const struct sr_context *ctx,
+		const struct sr_dev_driver *driver)
+{
+	gchar **name;
+
+	if (!ctx->driver_names)
+		return TRUE;
+
+	for (name = ctx->driver_names; *name; name++) {
+		if (!strcmp(*name, driver->name))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 /**
- * Initialize the driver list in a fresh libsigrok context.
+ * Initialize the driver list in a libsigrok context.
+ *
+ * The list holds the drivers which pass the sanity check and, when the
+ * context has a selection of drivers (see sr_driver_list_select()),
+ * are part of that selection.
  *
  * @param ctx Pointer to a libsigrok context struct. Must not be NULL.
  *
@@ -48,8 +70,14 @@ SR_API void sr_drivers_init(struct sr_context *ctx)
 	array = g_array_new(TRUE, FALSE, sizeof(struct sr_dev_driver *));
 #ifdef HAVE_DRIVERS
 	for (const struct sr_dev_driver **drivers = sr_driver_list__start + 1;
-	     drivers < sr_driver_list__stop; drivers++)
+	     drivers < sr_driver_list__stop; drivers++) {
+		/* The check logs the driver's issues. */
+		if (sr_driver_sanity_check(*drivers) != SR_OK)
+			continue;
+		if (!driver_selected(ctx, *drivers))
+			continue;
 		g_array_append_val(array, *drivers);
+	}
 #endif
 	ctx->driver_list = (struct sr_dev_driver **)array->data;
 	g_array_free(array, FALSE);
@@ -35,6 +35,9 @@
 
 #define FW_CHUNKSIZE (4 * 1024)
 
+/* Time for a device to renumerate after firmware upload. */
+#define EZUSB_RENUM_WINDOW_US (3 * 1000 * 1000)
+
 SR_PRIV int ezusb_reset(struct libusb_device_handle *hdl, int set_clear)
 {
 	int ret;
@@ -56,57 +59,145 @@ SR_PRIV int ezusb_install_firmware(struct sr_context *ctx,
 				   libusb_device_handle *hdl,
 				   const char *name)
 {
-	unsigned char *firmware;
+	GBytes *fw;
+	const unsigned char *firmware;
 	size_t length, offset, chunksize;
-	int ret, result;
+	int ret;
 
 	/* Max size is 64 kiB since the value field of the setup packet,
 	 * which holds the firmware offset, is only 16 bit wide.
 	 */
-	firmware = sr_resource_load(ctx, SR_RESOURCE_FIRMWARE,
-			name, &length, 1 << 16);
-	if (!firmware)
+	fw = sr_resource_load_cached(ctx, SR_RESOURCE_FIRMWARE, name, 1 << 16);
+	if (!fw)
 		return SR_ERR;
+	firmware = g_bytes_get_data(fw, &length);
 
 	sr_info("Uploading firmware '%s'.", name);
 
-	result = SR_OK;
 	offset = 0;
 	while (offset < length) {
 		chunksize = MIN(length - offset, FW_CHUNKSIZE);
 
 		ret = libusb_control_transfer(hdl, LIBUSB_REQUEST_TYPE_VENDOR |
 					      LIBUSB_ENDPOINT_OUT, 0xa0, offset,
-					      0x0000, firmware + offset,
+					      0x0000, (unsigned char *)firmware + offset,
 					      chunksize, 100);
 		if (ret < 0) {
 			sr_err("Unable to send firmware to device: %s.",
 					libusb_error_name(ret));
-			g_free(firmware);
+			g_bytes_unref(fw);
 			return SR_ERR;
 		}
 		sr_info("Uploaded %zu bytes.", chunksize);
 		offset += chunksize;
 	}
-	g_free(firmware);
+	g_bytes_unref(fw);
 
 	sr_info("Firmware upload done.");
 
-	return result;
+	return SR_OK;
+}
+
+/*
+ * Uploads get recorded per enumeration of a device, by its port path
+ * and bus address, with a fingerprint of the firmware image. A device
+ * which still shows up unconfigured at the same address shortly after
+ * an upload of the same image has not renumerated yet. Uploading again
+ * would only restart the device and its renumeration.
+ */
+struct ezusb_upload {
+	char *checksum;
+	int64_t time;
+};
+
+static void ezusb_upload_free(void *data)
+{
+	struct ezusb_upload *upload;
+
+	upload = data;
+	g_free(upload->checksum);
+	g_free(upload);
+}
+
+static char *ezusb_upload_key(struct sr_context *ctx, libusb_device *dev)
+{
+	char port[64];
+
+	if (usb_get_port_path(ctx, dev, port, sizeof(port)) != SR_OK)
+		return NULL;
+
+	return g_strdup_printf("%s@%d", port, libusb_get_device_address(dev));
+}
+
+static char *ezusb_fw_checksum(struct sr_context *ctx, const char *name)
+{
+	GBytes *fw;
+	char *checksum;
+
+	fw = sr_resource_load_cached(ctx, SR_RESOURCE_FIRMWARE, name, 1 << 16);
+	if (!fw)
+		return NULL;
+	checksum = g_compute_checksum_for_bytes(G_CHECKSUM_SHA256, fw);
+	g_bytes_unref(fw);
+
+	return checksum;
+}
+
+static gboolean ezusb_upload_pending(struct sr_context *ctx,
+		const char *key, const char *checksum)
+{
+	struct ezusb_upload *upload;
+
+	if (!ctx->ezusb_uploads || !key)
+		return FALSE;
+
+	upload = g_hash_table_lookup(ctx->ezusb_uploads, key);
+	if (!upload || strcmp(upload->checksum, checksum))
+		return FALSE;
+
+	return g_get_monotonic_time() - upload->time < EZUSB_RENUM_WINDOW_US;
+}
+
+static void ezusb_upload_record(struct sr_context *ctx,
+		char *key, char *checksum)
+{
+	struct ezusb_upload *upload;
+
+	if (!ctx->ezusb_uploads)
+		ctx->ezusb_uploads = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, ezusb_upload_free);
+
+	upload = g_malloc0(sizeof(*upload));
+	upload->checksum = checksum;
+	upload->time = g_get_monotonic_time();
+	g_hash_table_replace(ctx->ezusb_uploads, key, upload);
 }
 
 SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
 				  int configuration, const char *name)
 {
 	struct libusb_device_handle *hdl;
+	char *key, *checksum;
 	int ret;
 
+	checksum = ezusb_fw_checksum(ctx, name);
+	if (!checksum)
+		return SR_ERR;
+	key = ezusb_upload_key(ctx, dev);
+	if (ezusb_upload_pending(ctx, key, checksum)) {
+		sr_info("Firmware '%s' already uploaded to device on %s, "
+			"skipping upload.", name, key);
+		g_free(key);
+		g_free(checksum);
+		return SR_OK;
+	}
+
 	sr_info("uploading firmware to device on %d.%d",
 		libusb_get_bus_number(dev), libusb_get_device_address(dev));
 
 	if ((ret = libusb_open(dev, &hdl)) < 0) {
 		sr_err("failed to open device: %s.", libusb_error_name(ret));
-		return SR_ERR;
+		goto err_free;
 	}
 
 /*
@@ -118,7 +209,7 @@ SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
 		if ((ret = libusb_detach_kernel_driver(hdl, 0)) < 0) {
 			sr_err("failed to detach kernel driver: %s",
 					libusb_error_name(ret));
-			return SR_ERR;
+			goto err_close;
 		}
 	}
 #endif
@@ -126,19 +217,31 @@ SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
 	if ((ret = libusb_set_configuration(hdl, configuration)) < 0) {
 		sr_err("Unable to set configuration: %s",
 				libusb_error_name(ret));
-		return SR_ERR;
+		goto err_close;
 	}
 
 	if ((ezusb_reset(hdl, 1)) < 0)
-		return SR_ERR;
+		goto err_close;
 
 	if (ezusb_install_firmware(ctx, hdl, name) < 0)
-		return SR_ERR;
+		goto err_close;
 
 	if ((ezusb_reset(hdl, 0)) < 0)
-		return SR_ERR;
+		goto err_close;
 
 	libusb_close(hdl);
 
+	if (key)
+		ezusb_upload_record(ctx, key, checksum);
+	else
+		g_free(checksum);
+
 	return SR_OK;
+
+err_close:
+	libusb_close(hdl);
+err_free:
+	g_free(key);
+	g_free(checksum);
+	return SR_ERR;
 }
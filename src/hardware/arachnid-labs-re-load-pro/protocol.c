@@ -281,16 +281,16 @@ static void handle_packet(const struct sr_dev_inst *sdi)
 	if (g_str_has_prefix((const char *)devc->buf, "overtemp")) {
 		sr_warn("Overtemperature condition!");
 		devc->otp_active = TRUE;
-		sr_session_send_meta(sdi, SR_CONF_OVER_TEMPERATURE_PROTECTION_ACTIVE,
-			g_variant_new_boolean(TRUE));
+		sr_session_send_meta_boolean(sdi, SR_CONF_OVER_TEMPERATURE_PROTECTION_ACTIVE,
+			TRUE);
 		return;
 	}
 
 	if (g_str_has_prefix((const char *)devc->buf, "undervolt")) {
 		sr_warn("Undervoltage condition!");
 		devc->uvc_active = TRUE;
-		sr_session_send_meta(sdi, SR_CONF_UNDER_VOLTAGE_CONDITION_ACTIVE,
-			g_variant_new_boolean(TRUE));
+		sr_session_send_meta_boolean(sdi, SR_CONF_UNDER_VOLTAGE_CONDITION_ACTIVE,
+			TRUE);
 		return;
 	}
 
@@ -304,8 +304,8 @@ static void handle_packet(const struct sr_dev_inst *sdi)
 		devc->current_limit = g_ascii_strtod(tokens[1], NULL) / 1000;
 		g_strfreev(tokens);
 		g_cond_signal(&devc->current_limit_cond);
-		sr_session_send_meta(sdi, SR_CONF_CURRENT_LIMIT,
-			g_variant_new_double(devc->current_limit));
+		sr_session_send_meta_double(sdi, SR_CONF_CURRENT_LIMIT,
+			devc->current_limit);
 		return;
 	}
 
@@ -315,14 +315,14 @@ static void handle_packet(const struct sr_dev_inst *sdi)
 		g_strfreev(tokens);
 		g_cond_signal(&devc->uvc_threshold_cond);
 		if (devc->uvc_threshold == .0) {
-			sr_session_send_meta(sdi, SR_CONF_UNDER_VOLTAGE_CONDITION,
-				g_variant_new_boolean(FALSE));
+			sr_session_send_meta_boolean(sdi, SR_CONF_UNDER_VOLTAGE_CONDITION,
+				FALSE);
 		} else {
-			sr_session_send_meta(sdi, SR_CONF_UNDER_VOLTAGE_CONDITION,
-				g_variant_new_boolean(TRUE));
-			sr_session_send_meta(sdi,
+			sr_session_send_meta_boolean(sdi, SR_CONF_UNDER_VOLTAGE_CONDITION,
+				TRUE);
+			sr_session_send_meta_double(sdi,
 				SR_CONF_UNDER_VOLTAGE_CONDITION_THRESHOLD,
-				g_variant_new_double(devc->uvc_threshold));
+				devc->uvc_threshold);
 		}
 		return;
 	}
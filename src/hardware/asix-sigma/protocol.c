@@ -1390,12 +1390,50 @@ static void rewind_trig_arm_pos(struct dev_context *devc, size_t count)
 	}
 }
 
+/*
+ * Read the DRAM lines of the capture in chunks, ahead of interpretation.
+ * Runs while the main thread interprets the previously read chunk. The
+ * FTDI connection is not used by the main thread during download.
+ */
+static gpointer fetch_thread_run(gpointer data)
+{
+	struct dev_context *devc;
+	struct sigma_sample_interp *interp;
+	struct sigma_fetch_chunk *chunk;
+	size_t line, remain, count;
+
+	devc = data;
+	interp = &devc->interp;
+
+	line = interp->start.line;
+	remain = interp->fetch.lines_total;
+	while (remain && !g_atomic_int_get(&interp->fetch.stop)) {
+		chunk = g_async_queue_pop(interp->fetch.free_chunks);
+		if (g_atomic_int_get(&interp->fetch.stop)) {
+			g_async_queue_push(interp->fetch.free_chunks, chunk);
+			break;
+		}
+		count = MIN(remain, interp->fetch.lines_per_read);
+		chunk->count = count;
+		chunk->ret = sigma_read_dram(devc, line, count,
+			(uint8_t *)chunk->lines);
+		g_async_queue_push(interp->fetch.rcvd_chunks, chunk);
+		if (chunk->ret != SR_OK)
+			break;
+		line = (line + count) % ROW_COUNT;
+		remain -= count;
+	}
+
+	return NULL;
+}
+
 static int alloc_sample_buffer(struct dev_context *devc,
 	size_t stop_pos, size_t trig_pos, uint8_t mode)
 {
 	struct sigma_sample_interp *interp;
+	struct sigma_fetch_chunk *chunk;
 	gboolean wrapped;
-	size_t alloc_size;
+	size_t alloc_size, i;
 
 	interp = &devc->interp;
 
@@ -1447,25 +1485,41 @@ static int alloc_sample_buffer(struct dev_context *devc,
 	interp->fetch.lines_total %= ROW_COUNT;
 	interp->fetch.lines_done = 0;
 
-	/* Arrange for chunked download, N lines per USB request. */
+	/*
+	 * Arrange for chunked download, N lines per USB request. Have
+	 * a thread read the next chunk while the previous one gets
+	 * interpreted.
+	 */
 	interp->fetch.lines_per_read = 32;
-	alloc_size = sizeof(devc->interp.fetch.rcvd_lines[0]);
-	alloc_size *= devc->interp.fetch.lines_per_read;
-	devc->interp.fetch.rcvd_lines = g_try_malloc0(alloc_size);
-	if (!devc->interp.fetch.rcvd_lines)
-		return SR_ERR_MALLOC;
+	alloc_size = sizeof(interp->fetch.chunks[0].lines[0]);
+	alloc_size *= interp->fetch.lines_per_read;
+	for (i = 0; i < ARRAY_SIZE(interp->fetch.chunks); i++) {
+		chunk = &interp->fetch.chunks[i];
+		chunk->lines = g_try_malloc0(alloc_size);
+		if (!chunk->lines)
+			return SR_ERR_MALLOC;
+	}
+	interp->fetch.free_chunks = g_async_queue_new();
+	interp->fetch.rcvd_chunks = g_async_queue_new();
+	for (i = 0; i < ARRAY_SIZE(interp->fetch.chunks); i++)
+		g_async_queue_push(interp->fetch.free_chunks,
+			&interp->fetch.chunks[i]);
+	interp->fetch.stop = 0;
+	interp->fetch.thread = g_thread_try_new("sigma-fetch",
+		fetch_thread_run, devc, NULL);
+	if (!interp->fetch.thread)
+		return SR_ERR;
 
 	return SR_OK;
 }
 
-static uint16_t sigma_deinterlace_data_4x4(uint16_t indata, int idx);
-static uint16_t sigma_deinterlace_data_2x8(uint16_t indata, int idx);
+static uint16_t sigma_deinterlace_data_4x4(uint16_t indata);
+static uint16_t sigma_deinterlace_data_2x8(uint16_t indata);
 
 static int fetch_sample_buffer(struct dev_context *devc)
 {
 	struct sigma_sample_interp *interp;
-	size_t count;
-	int ret;
+	struct sigma_fetch_chunk *chunk;
 	const uint8_t *rdptr;
 	uint16_t ts, data;
 
@@ -1476,16 +1530,16 @@ static int fetch_sample_buffer(struct dev_context *devc)
 		interp->iter = interp->start;
 	}
 
-	/* Get another set of DRAM lines in one read call. */
-	count = interp->fetch.lines_total - interp->fetch.lines_done;
-	if (count > interp->fetch.lines_per_read)
-		count = interp->fetch.lines_per_read;
-	ret = sigma_read_dram(devc, interp->iter.line, count,
-		(uint8_t *)interp->fetch.rcvd_lines);
-	if (ret != SR_OK)
-		return ret;
-	interp->fetch.lines_rcvd = count;
-	interp->fetch.curr_line = &interp->fetch.rcvd_lines[0];
+	/* Hand back the previous set, get the next set of DRAM lines. */
+	if (interp->fetch.curr_chunk)
+		g_async_queue_push(interp->fetch.free_chunks,
+			interp->fetch.curr_chunk);
+	chunk = g_async_queue_pop(interp->fetch.rcvd_chunks);
+	interp->fetch.curr_chunk = chunk;
+	if (chunk->ret != SR_OK)
+		return chunk->ret;
+	interp->fetch.lines_rcvd = chunk->count;
+	interp->fetch.curr_line = &chunk->lines[0];
 
 	/* First invocation? Get initial timestamp and sample data. */
 	if (!interp->fetch.lines_done) {
@@ -1493,9 +1547,9 @@ static int fetch_sample_buffer(struct dev_context *devc)
 		ts = read_u16le_inc(&rdptr);
 		data = read_u16le_inc(&rdptr);
 		if (interp->samples_per_event == 4) {
-			data = sigma_deinterlace_data_4x4(data, 0);
+			data = sigma_deinterlace_data_4x4(data) & 0xf;
 		} else if (interp->samples_per_event == 2) {
-			data = sigma_deinterlace_data_2x8(data, 0);
+			data = sigma_deinterlace_data_2x8(data) & 0xff;
 		}
 		interp->last.ts = ts;
 		interp->last.sample = data;
@@ -1506,9 +1560,47 @@ static int fetch_sample_buffer(struct dev_context *devc)
 
 static void free_sample_buffer(struct dev_context *devc)
 {
-	g_free(devc->interp.fetch.rcvd_lines);
-	devc->interp.fetch.rcvd_lines = NULL;
-	devc->interp.fetch.lines_per_read = 0;
+	struct sigma_sample_interp *interp;
+	struct sigma_fetch_chunk *chunk;
+	size_t i;
+
+	interp = &devc->interp;
+
+	/*
+	 * Stop the read thread. Return all chunks to it, it checks for
+	 * the stop request after getting and after passing a chunk.
+	 */
+	if (interp->fetch.thread) {
+		g_atomic_int_set(&interp->fetch.stop, 1);
+		if (interp->fetch.curr_chunk)
+			g_async_queue_push(interp->fetch.free_chunks,
+				interp->fetch.curr_chunk);
+		while ((chunk = g_async_queue_try_pop(interp->fetch.rcvd_chunks)))
+			g_async_queue_push(interp->fetch.free_chunks, chunk);
+		g_thread_join(interp->fetch.thread);
+		interp->fetch.thread = NULL;
+	}
+	interp->fetch.curr_chunk = NULL;
+	if (interp->fetch.free_chunks) {
+		g_async_queue_unref(interp->fetch.free_chunks);
+		interp->fetch.free_chunks = NULL;
+	}
+	if (interp->fetch.rcvd_chunks) {
+		g_async_queue_unref(interp->fetch.rcvd_chunks);
+		interp->fetch.rcvd_chunks = NULL;
+	}
+	for (i = 0; i < ARRAY_SIZE(interp->fetch.chunks); i++) {
+		g_free(interp->fetch.chunks[i].lines);
+		interp->fetch.chunks[i].lines = NULL;
+	}
+	interp->fetch.lines_per_read = 0;
+}
+
+/* Release download resources when acquisition stops during download. */
+SR_PRIV void sigma_abort_download(struct dev_context *devc)
+{
+	free_sample_buffer(devc);
+	free_submit_buffer(devc);
 }
 
 /*
@@ -1811,41 +1903,40 @@ static uint16_t sigma_dram_cluster_data(struct sigma_dram_cluster *cl, int idx)
 /*
  * Deinterlace sample data that was retrieved at 100MHz samplerate.
  * One 16bit item contains two samples of 8bits each. The bits of
- * multiple samples are interleaved.
+ * multiple samples are interleaved. Returns the first sample in the
+ * low byte and the second sample in the high byte, separating the
+ * bits by swapping groups of bits instead of moving single bits.
  */
-static uint16_t sigma_deinterlace_data_2x8(uint16_t indata, int idx)
+static uint16_t sigma_deinterlace_data_2x8(uint16_t indata)
 {
-	uint16_t outdata;
-
-	indata >>= idx;
-	outdata = 0;
-	outdata |= (indata >> (0 * 2 - 0)) & (1 << 0);
-	outdata |= (indata >> (1 * 2 - 1)) & (1 << 1);
-	outdata |= (indata >> (2 * 2 - 2)) & (1 << 2);
-	outdata |= (indata >> (3 * 2 - 3)) & (1 << 3);
-	outdata |= (indata >> (4 * 2 - 4)) & (1 << 4);
-	outdata |= (indata >> (5 * 2 - 5)) & (1 << 5);
-	outdata |= (indata >> (6 * 2 - 6)) & (1 << 6);
-	outdata |= (indata >> (7 * 2 - 7)) & (1 << 7);
-	return outdata;
+	uint16_t t;
+
+	t = (indata ^ (indata >> 1)) & 0x2222;
+	indata ^= t ^ (t << 1);
+	t = (indata ^ (indata >> 2)) & 0x0c0c;
+	indata ^= t ^ (t << 2);
+	t = (indata ^ (indata >> 4)) & 0x00f0;
+	indata ^= t ^ (t << 4);
+
+	return indata;
 }
 
 /*
  * Deinterlace sample data that was retrieved at 200MHz samplerate.
  * One 16bit item contains four samples of 4bits each. The bits of
- * multiple samples are interleaved.
+ * multiple samples are interleaved. Returns sample N in bits 4N to
+ * 4N+3, it's a transpose of a 4x4 bit matrix.
  */
-static uint16_t sigma_deinterlace_data_4x4(uint16_t indata, int idx)
+static uint16_t sigma_deinterlace_data_4x4(uint16_t indata)
 {
-	uint16_t outdata;
-
-	indata >>= idx;
-	outdata = 0;
-	outdata |= (indata >> (0 * 4 - 0)) & (1 << 0);
-	outdata |= (indata >> (1 * 4 - 1)) & (1 << 1);
-	outdata |= (indata >> (2 * 4 - 2)) & (1 << 2);
-	outdata |= (indata >> (3 * 4 - 3)) & (1 << 3);
-	return outdata;
+	uint16_t t;
+
+	t = (indata ^ (indata >> 3)) & 0x0a0a;
+	indata ^= t ^ (t << 3);
+	t = (indata ^ (indata >> 6)) & 0x00cc;
+	indata ^= t ^ (t << 6);
+
+	return indata;
 }
 
 static void sigma_decode_dram_cluster(struct dev_context *devc,
@@ -1855,6 +1946,7 @@ static void sigma_decode_dram_cluster(struct dev_context *devc,
 	uint16_t tsdiff, ts, sample, item16;
 	size_t count;
 	size_t evt;
+	unsigned int idx;
 
 	/*
 	 * If this cluster is not adjacent to the previously received
@@ -1886,25 +1978,19 @@ static void sigma_decode_dram_cluster(struct dev_context *devc,
 	for (evt = 0; evt < events_in_cluster; evt++) {
 		item16 = sigma_dram_cluster_data(dram_cluster, evt);
 		if (devc->interp.samples_per_event == 4) {
-			sample = sigma_deinterlace_data_4x4(item16, 0);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 1);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 2);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_4x4(item16, 3);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
+			item16 = sigma_deinterlace_data_4x4(item16);
+			for (idx = 0; idx < 4; idx++) {
+				sample = (item16 >> (4 * idx)) & 0xf;
+				check_and_submit_sample(devc, sample, 1);
+				devc->interp.last.sample = sample;
+			}
 		} else if (devc->interp.samples_per_event == 2) {
-			sample = sigma_deinterlace_data_2x8(item16, 0);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
-			sample = sigma_deinterlace_data_2x8(item16, 1);
-			check_and_submit_sample(devc, sample, 1);
-			devc->interp.last.sample = sample;
+			item16 = sigma_deinterlace_data_2x8(item16);
+			for (idx = 0; idx < 2; idx++) {
+				sample = (item16 >> (8 * idx)) & 0xff;
+				check_and_submit_sample(devc, sample, 1);
+				devc->interp.last.sample = sample;
+			}
 		} else {
 			sample = item16;
 			check_and_submit_sample(devc, sample, 1);
@@ -2029,15 +2115,18 @@ static int download_capture(struct sr_dev_inst *sdi)
 			triggerpos = ~0;
 
 		ret = alloc_sample_buffer(devc, stoppos, triggerpos, modestatus);
-		if (ret != SR_OK)
+		if (ret != SR_OK) {
+			sigma_abort_download(devc);
 			return FALSE;
+		}
 
 		ret = alloc_submit_buffer(sdi);
-		if (ret != SR_OK)
-			return FALSE;
-		ret = setup_submit_limit(devc);
-		if (ret != SR_OK)
+		if (ret == SR_OK)
+			ret = setup_submit_limit(devc);
+		if (ret != SR_OK) {
+			sigma_abort_download(devc);
 			return FALSE;
+		}
 	}
 
 	/*
@@ -2055,8 +2144,10 @@ static int download_capture(struct sr_dev_inst *sdi)
 
 		/* Read another chunk of sample memory (several lines). */
 		ret = fetch_sample_buffer(devc);
-		if (ret != SR_OK)
+		if (ret != SR_OK) {
+			sigma_abort_download(devc);
 			return FALSE;
+		}
 
 		/* Process lines of sample data. Last line may be short. */
 		while (interp->fetch.lines_rcvd--) {
@@ -244,6 +244,9 @@ enum trgsel_selcode_t {
 #define CLUSTERS_PER_ROW	(ROW_LENGTH_U16 / (1 + EVENTS_PER_CLUSTER))
 #define EVENTS_PER_ROW		(CLUSTERS_PER_ROW * EVENTS_PER_CLUSTER)
 
+/* Sample memory download buffers, one gets read while one gets decoded. */
+#define FETCH_CHUNK_COUNT	2
+
 struct sigma_dram_line {
 	struct sigma_dram_cluster {
 		uint16_t timestamp;
@@ -366,8 +369,16 @@ struct dev_context {
 			size_t lines_total, lines_done;
 			size_t lines_per_read; /* USB transfer limit */
 			size_t lines_rcvd;
-			struct sigma_dram_line *rcvd_lines;
 			struct sigma_dram_line *curr_line;
+			/* Reads run in a thread, ahead of interpretation. */
+			struct sigma_fetch_chunk {
+				struct sigma_dram_line *lines;
+				size_t count;
+				int ret;
+			} chunks[FETCH_CHUNK_COUNT], *curr_chunk;
+			GAsyncQueue *free_chunks, *rcvd_chunks;
+			GThread *thread;
+			gint stop;
 		} fetch;
 		struct {
 			gboolean armed;
@@ -415,6 +426,7 @@ SR_PRIV GVariant *sigma_get_samplerates_list(void);
 /* Preparation of data acquisition, spec conversion, hardware configuration. */
 SR_PRIV int sigma_set_samplerate(const struct sr_dev_inst *sdi);
 SR_PRIV int sigma_set_acquire_timeout(struct dev_context *devc);
+SR_PRIV void sigma_abort_download(struct dev_context *devc);
 SR_PRIV int sigma_convert_trigger(const struct sr_dev_inst *sdi);
 SR_PRIV int sigma_build_basic_trigger(struct dev_context *devc,
 	struct triggerlut *lut);
@@ -32,6 +32,17 @@ static const uint32_t devopts[] = {
 	SR_CONF_LIMIT_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
+	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
+	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_TRIGGER_HYSTERESIS | SR_CONF_GET | SR_CONF_SET,
+};
+
+static const int32_t trigger_matches[] = {
+	SR_TRIGGER_RISING,
+	SR_TRIGGER_FALLING,
+	SR_TRIGGER_EDGE,
+	SR_TRIGGER_OVER,
+	SR_TRIGGER_UNDER,
 };
 
 /*
@@ -150,6 +161,12 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_SAMPLERATE:
 		*data = g_variant_new_uint64(devc->samplerate);
 		break;
+	case SR_CONF_CAPTURE_RATIO:
+		*data = g_variant_new_uint64(devc->capture_ratio);
+		break;
+	case SR_CONF_TRIGGER_HYSTERESIS:
+		*data = g_variant_new_double(devc->trigger_hysteresis);
+		break;
 	case SR_CONF_PROBE_FACTOR:
 		if (!cg)
 			return SR_ERR_CHANNEL_GROUP;
@@ -192,6 +209,12 @@ static int config_set(uint32_t key, GVariant *data,
 		devc->samplerate = samplerate;
 		bl_acme_maybe_set_update_interval(sdi, samplerate);
 		break;
+	case SR_CONF_CAPTURE_RATIO:
+		devc->capture_ratio = g_variant_get_uint64(data);
+		break;
+	case SR_CONF_TRIGGER_HYSTERESIS:
+		devc->trigger_hysteresis = g_variant_get_double(data);
+		break;
 	case SR_CONF_PROBE_FACTOR:
 		if (!cg)
 			return SR_ERR_CHANNEL_GROUP;
@@ -220,6 +243,9 @@ static int config_list(uint32_t key, GVariant **data,
 		case SR_CONF_SAMPLERATE:
 			*data = std_gvar_samplerates_steps(ARRAY_AND_SIZE(samplerates));
 			break;
+		case SR_CONF_TRIGGER_MATCH:
+			*data = std_gvar_array_i32(ARRAY_AND_SIZE(trigger_matches));
+			break;
 		default:
 			return SR_ERR_NA;
 		}
@@ -254,12 +280,19 @@ static void dev_acquisition_close(const struct sr_dev_inst *sdi)
 
 static int dev_acquisition_open(const struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc;
 	GSList *chl;
 	struct sr_channel *ch;
 
+	devc = sdi->priv;
+	devc->batch_size = devc->samplerate / BATCH_RATE_HZ;
+	devc->batch_size = MAX(devc->batch_size, 1);
+	devc->batch_size = MIN(devc->batch_size, MAX_BATCH_SAMPLES);
+	devc->batch_count = 0;
+
 	for (chl = sdi->channels; chl; chl = chl->next) {
 		ch = chl->data;
-		if (bl_acme_open_channel(ch)) {
+		if (bl_acme_open_channel(ch, devc->batch_size)) {
 			sr_err("Error opening channel %s", ch->name);
 			dev_acquisition_close(sdi);
 			return SR_ERR;
@@ -272,6 +305,8 @@ static int dev_acquisition_open(const struct sr_dev_inst *sdi)
 static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
+	struct sr_trigger *trigger;
+	int pre_trigger_samples;
 	struct itimerspec tspec = {
 		.it_interval = { 0, 0 },
 		.it_value = { 0, 0 }
@@ -282,9 +317,28 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	devc = sdi->priv;
 	devc->samples_missed = 0;
+
+	/* The frame of the trigger begins with the pre-trigger samples. */
+	devc->trigger_fired = TRUE;
+	if ((trigger = sr_session_trigger_get(sdi->session))) {
+		pre_trigger_samples = 0;
+		if (devc->limits.limit_samples)
+			pre_trigger_samples = (devc->capture_ratio *
+				devc->limits.limit_samples) / 100;
+		devc->sta = soft_trigger_analog_new(sdi, trigger,
+			pre_trigger_samples, devc->trigger_hysteresis, TRUE);
+		if (!devc->sta) {
+			dev_acquisition_close(sdi);
+			return SR_ERR;
+		}
+		devc->trigger_fired = FALSE;
+	}
+
 	devc->timer_fd = timerfd_create(CLOCK_MONOTONIC, 0);
 	if (devc->timer_fd < 0) {
 		sr_err("Error creating timer fd");
+		soft_trigger_analog_free(devc->sta);
+		devc->sta = NULL;
 		return SR_ERR;
 	}
 
@@ -295,6 +349,8 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	if (timerfd_settime(devc->timer_fd, 0, &tspec, NULL)) {
 		sr_err("Failed to set timer");
 		close(devc->timer_fd);
+		soft_trigger_analog_free(devc->sta);
+		devc->sta = NULL;
 		return SR_ERR;
 	}
 
@@ -326,6 +382,9 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 
 	std_session_send_df_end(sdi);
 
+	soft_trigger_analog_free(devc->sta);
+	devc->sta = NULL;
+
 	if (devc->samples_missed > 0)
 		sr_warn("%" PRIu64 " samples missed", devc->samples_missed);
 
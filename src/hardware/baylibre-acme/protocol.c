@@ -52,7 +52,11 @@ struct channel_priv {
 	int ch_type;
 	int fd;
 	int digits;
+	/* Factor from the sysfs value to the sample's unit. */
+	float scale;
 	float val;
+	/* Samples of the current batch. */
+	float *samples;
 	struct channel_group_priv *probe;
 };
 
@@ -259,6 +263,7 @@ static void append_channel(struct sr_dev_inst *sdi, struct sr_channel_group *cg,
 
 	cp = g_malloc0(sizeof(struct channel_priv));
 	cp->ch_type = type;
+	cp->fd = -1;
 	cp->probe = cg->priv;
 
 	ch = sr_channel_new(sdi, devc->num_channels++,
@@ -637,26 +642,24 @@ static float read_sample(struct sr_channel *ch)
 	struct channel_priv *chp;
 	char buf[16];
 	ssize_t len;
-	int fd;
 
 	chp = ch->priv;
-	fd = chp->fd;
-
-	lseek(fd, 0, SEEK_SET);
 
-	len = read(fd, buf, sizeof(buf));
+	/* Positioned read, sysfs attributes always start at offset 0. */
+	len = pread(chp->fd, buf, sizeof(buf) - 1, 0);
 	if (len < 0) {
 		sr_err("Error reading from channel %s (hwmon: %d): %s",
 			ch->name, chp->probe->hwmon_num, g_strerror(errno));
 		ch->enabled = FALSE;
+		sr_dev_channels_changed(ch->sdi);
 		return -1.0;
 	}
+	buf[len] = '\0';
 
-	chp->digits = type_digits(chp->ch_type);
-	return strtol(buf, NULL, 10) * powf(10, -chp->digits);
+	return strtol(buf, NULL, 10) * chp->scale;
 }
 
-SR_PRIV int bl_acme_open_channel(struct sr_channel *ch)
+SR_PRIV int bl_acme_open_channel(struct sr_channel *ch, size_t batch_size)
 {
 	struct channel_priv *chp;
 	char path[64];
@@ -683,10 +686,14 @@ SR_PRIV int bl_acme_open_channel(struct sr_channel *ch)
 	if (fd < 0) {
 		sr_err("Error opening %s: %s", path, g_strerror(errno));
 		ch->enabled = FALSE;
+		sr_dev_channels_changed(ch->sdi);
 		return SR_ERR;
 	}
 
 	chp->fd = fd;
+	chp->digits = type_digits(chp->ch_type);
+	chp->scale = powf(10, -chp->digits);
+	chp->samples = g_malloc(batch_size * sizeof(float));
 
 	return 0;
 }
@@ -696,24 +703,123 @@ SR_PRIV void bl_acme_close_channel(struct sr_channel *ch)
 	struct channel_priv *chp;
 
 	chp = ch->priv;
-	close(chp->fd);
+	if (chp->fd >= 0)
+		close(chp->fd);
 	chp->fd = -1;
+	g_free(chp->samples);
+	chp->samples = NULL;
 }
 
-SR_PRIV int bl_acme_receive_data(int fd, int revents, void *cb_data)
-{
-	uint64_t nrexpiration;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_analog analog;
+/* Per channel packet parts, see send_batch(). */
+struct batch_packet {
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
+	GSList chonly;
+};
+
+/*
+ * Send the samples of the current batch as a frame, one packet per
+ * channel. While the soft trigger waits, only the batch in which it
+ * fires gets sent, from the pre-trigger samples onwards.
+ */
+static int send_batch(const struct sr_dev_inst *sdi)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog *analog;
+	struct batch_packet *parts;
+	struct sr_channel *ch;
+	struct channel_priv *chp;
+	struct dev_context *devc;
+	GSList *chl;
+	uint64_t room, sent, post;
+	size_t i, n;
+	int offset, pre_trigger_samples, ret;
+
+	devc = sdi->priv;
+	if (!devc->batch_count)
+		return SR_OK;
+
+	/* Due to different units used in each channel, they get a packet each. */
+	analog = g_new0(struct sr_datafeed_analog, devc->num_channels);
+	parts = g_new0(struct batch_packet, devc->num_channels);
+	n = 0;
+	for (chl = sdi->channels; chl; chl = chl->next) {
+		ch = chl->data;
+		chp = ch->priv;
+
+		if (!ch->enabled || !chp->samples)
+			continue;
+		sr_analog_init(&analog[n], &parts[n].encoding,
+			&parts[n].meaning, &parts[n].spec, 0);
+		parts[n].chonly.next = NULL;
+		parts[n].chonly.data = ch;
+		analog[n].num_samples = devc->batch_count;
+		analog[n].meaning->channels = &parts[n].chonly;
+		analog[n].meaning->mq = channel_to_mq(ch);
+		analog[n].meaning->unit = channel_to_unit(ch);
+		analog[n].encoding->digits  = chp->digits;
+		analog[n].spec->spec_digits = chp->digits;
+		analog[n].data = chp->samples;
+		n++;
+	}
+
+	ret = SR_OK;
+	offset = 0;
+	sent = 0;
+	if (!devc->trigger_fired && n) {
+		offset = soft_trigger_analog_check(devc->sta, NULL, analog, n,
+			&pre_trigger_samples);
+		if (offset < -1) {
+			sr_err("Analog soft trigger failed: %d.", offset);
+			ret = offset;
+			goto out;
+		}
+		if (offset < 0)
+			goto out;
+		devc->trigger_fired = TRUE;
+		sent = pre_trigger_samples;
+	} else {
+		std_session_send_df_frame_begin(sdi);
+	}
+
+	post = devc->batch_count - offset;
+	if (devc->sta) {
+		room = UINT64_MAX;
+		if (devc->limits.limit_samples)
+			room = devc->limits.limit_samples - devc->limits.samples_read;
+		post = (room > sent) ? MIN(post, room - sent) : 0;
+		sr_sw_limits_update_samples_read(&devc->limits, sent + post);
+	}
+
+	packet.type = SR_DF_ANALOG;
+	for (i = 0; i < n; i++) {
+		analog[i].data = (float *)analog[i].data + offset;
+		analog[i].num_samples = post;
+		packet.payload = &analog[i];
+		if (post)
+			sr_session_send(sdi, &packet);
+	}
+
+	std_session_send_df_frame_end(sdi);
+
+out:
+	g_free(parts);
+	g_free(analog);
+	devc->batch_count = 0;
+
+	return ret;
+}
+
+SR_PRIV int bl_acme_receive_data(int fd, int revents, void *cb_data)
+{
+	uint64_t nrexpiration;
 	struct sr_dev_inst *sdi;
 	struct sr_channel *ch;
 	struct channel_priv *chp;
 	struct dev_context *devc;
-	GSList *chl, chonly;
-	unsigned i;
+	GSList *chl;
+	uint64_t i;
 
 	(void)fd;
 	(void)revents;
@@ -726,10 +832,6 @@ SR_PRIV int bl_acme_receive_data(int fd, int revents, void *cb_data)
 	if (!devc)
 		return TRUE;
 
-	packet.type = SR_DF_ANALOG;
-	packet.payload = &analog;
-	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
-
 	if (read(devc->timer_fd, &nrexpiration, sizeof(nrexpiration)) < 0) {
 		sr_warn("Failed to read timer information");
 		return TRUE;
@@ -759,42 +861,34 @@ SR_PRIV int bl_acme_receive_data(int fd, int revents, void *cb_data)
 	 * accuracy.
 	 */
 	for (i = 0; i < nrexpiration; i++) {
-		std_session_send_df_frame_begin(sdi);
-
-		/*
-		 * Due to different units used in each channel we're sending
-		 * samples one-by-one.
-		 */
+		/* Read all channels for this tick, then collect the values. */
 		for (chl = sdi->channels; chl; chl = chl->next) {
 			ch = chl->data;
 			chp = ch->priv;
 
-			if (!ch->enabled)
+			if (!ch->enabled || !chp->samples)
 				continue;
-			chonly.next = NULL;
-			chonly.data = ch;
-			analog.num_samples = 1;
-			analog.meaning->channels = &chonly;
-			analog.meaning->mq = channel_to_mq(chl->data);
-			analog.meaning->unit = channel_to_unit(ch);
-
 			if (i < 1)
 				chp->val = read_sample(ch);
-
-			analog.encoding->digits  = chp->digits;
-			analog.spec->spec_digits = chp->digits;
-			analog.data = &chp->val;
-			sr_session_send(sdi, &packet);
+			chp->samples[devc->batch_count] = chp->val;
+		}
+		devc->batch_count++;
+		/* With a soft trigger, send_batch() counts what got sent. */
+		if (!devc->sta)
+			sr_sw_limits_update_samples_read(&devc->limits, 1);
+
+		if (sr_sw_limits_check(&devc->limits)) {
+			send_batch(sdi);
+			sr_dev_acquisition_stop(sdi);
+			return TRUE;
+		}
+		if (devc->batch_count == devc->batch_size) {
+			if (send_batch(sdi) != SR_OK
+					|| sr_sw_limits_check(&devc->limits)) {
+				sr_dev_acquisition_stop(sdi);
+				return TRUE;
+			}
 		}
-
-		std_session_send_df_frame_end(sdi);
-	}
-
-	sr_sw_limits_update_samples_read(&devc->limits, 1);
-
-	if (sr_sw_limits_check(&devc->limits)) {
-		sr_dev_acquisition_stop(sdi);
-		return TRUE;
 	}
 
 	return TRUE;
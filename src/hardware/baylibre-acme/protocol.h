@@ -49,6 +49,13 @@ enum probe_type {
 	PROBE_TEMP,
 };
 
+/*
+ * Samples are sent in packets of up to this many per channel. Batches
+ * cover about 1/BATCH_RATE_HZ seconds, so that low rates stay live.
+ */
+#define MAX_BATCH_SAMPLES	1024
+#define BATCH_RATE_HZ		20
+
 struct dev_context {
 	uint64_t samplerate;
 	struct sr_sw_limits limits;
@@ -57,6 +64,15 @@ struct dev_context {
 	uint64_t samples_missed;
 	int timer_fd;
 	GIOChannel *channel;
+
+	/* Samples per batch, and the number collected so far. */
+	size_t batch_size;
+	size_t batch_count;
+
+	uint64_t capture_ratio;
+	float trigger_hysteresis;
+	struct soft_trigger_analog *sta;
+	gboolean trigger_fired;
 };
 
 SR_PRIV uint8_t bl_acme_get_enrg_addr(int index);
@@ -86,7 +102,7 @@ SR_PRIV int bl_acme_set_power_off(const struct sr_channel_group *cg,
 
 SR_PRIV int bl_acme_receive_data(int fd, int revents, void *cb_data);
 
-SR_PRIV int bl_acme_open_channel(struct sr_channel *ch);
+SR_PRIV int bl_acme_open_channel(struct sr_channel *ch, size_t batch_size);
 
 SR_PRIV void bl_acme_close_channel(struct sr_channel *ch);
 #endif
@@ -110,7 +110,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	/* Default non-zero values (if any) */
 	devc->fd = -1;
 	devc->limit_samples = 10000000;
-	devc->tcp_buffer = 0;
+	devc->tcp_packet_size = TCP_PACKET_SIZE;
 
 	if (!conn) {
 		devc->beaglelogic = &beaglelogic_native_ops;
@@ -120,6 +120,16 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		devc->beaglelogic = &beaglelogic_tcp_ops;
 		devc->address = g_strdup(params[1]);
 		devc->port = g_strdup(params[2]);
+		/* Optional target packet size: tcp-raw/<host>/<port>/<bytes>. */
+		if (params[3] && (sr_atoi(params[3], &i) != SR_OK
+				|| i < TCP_PACKET_SIZE_MIN
+				|| i > TCP_PACKET_SIZE_MAX)) {
+			sr_err("Invalid packet size '%s'.", params[3]);
+			g_strfreev(params);
+			goto err_free;
+		}
+		if (params[3])
+			devc->tcp_packet_size = i;
 		g_strfreev(params);
 
 		if (devc->beaglelogic->open(devc) != SR_OK)
@@ -186,8 +196,6 @@ static int dev_open(struct sr_dev_inst *sdi)
 			devc->beaglelogic->close(devc);
 			return SR_ERR;
 		}
-	} else {
-		devc->tcp_buffer = g_malloc(TCP_BUFFER_SIZE);
 	}
 
 	return SR_OK;
@@ -207,7 +215,6 @@ static int dev_close(struct sr_dev_inst *sdi)
 
 static void clear_helper(struct dev_context *devc)
 {
-	g_free(devc->tcp_buffer);
 	g_free(devc->address);
 	g_free(devc->port);
 }
@@ -351,10 +358,11 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		sr_session_source_add_pollfd(sdi->session, &devc->pollfd,
 			BUFUNIT_TIMEOUT_MS(devc), beaglelogic_native_receive_data,
 			(void *)sdi);
+	else if (beaglelogic_tcp_rx_start(devc) == SR_OK)
+		sr_session_source_add(sdi->session, -1, 0, 10,
+			beaglelogic_tcp_receive_data, (void *)sdi);
 	else
-		sr_session_source_add_pollfd(sdi->session, &devc->pollfd,
-			BUFUNIT_TIMEOUT_MS(devc), beaglelogic_tcp_receive_data,
-			(void *)sdi);
+		return SR_ERR;
 
 	return SR_OK;
 }
@@ -366,14 +374,15 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	/* Execute a stop on BeagleLogic */
 	devc->beaglelogic->stop(devc);
 
-	/* Flush the cache */
-	if (devc->beaglelogic == &beaglelogic_native_ops)
+	/* Flush the cache, remove session source and send EOT packet */
+	if (devc->beaglelogic == &beaglelogic_native_ops) {
 		lseek(devc->fd, 0, SEEK_SET);
-	else
+		sr_session_source_remove_pollfd(sdi->session, &devc->pollfd);
+	} else {
+		beaglelogic_tcp_rx_stop(devc);
 		beaglelogic_tcp_drain(devc);
-
-	/* Remove session source and send EOT packet */
-	sr_session_source_remove_pollfd(sdi->session, &devc->pollfd);
+		sr_session_source_remove(sdi->session, -1);
+	}
 	std_session_send_df_end(sdi);
 
 	return SR_OK;
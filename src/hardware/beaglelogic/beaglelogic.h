@@ -128,5 +128,11 @@ SR_PRIV extern const struct beaglelogic_ops beaglelogic_tcp_ops;
 
 SR_PRIV int beaglelogic_tcp_detect(struct dev_context *devc);
 SR_PRIV int beaglelogic_tcp_drain(struct dev_context *devc);
+SR_PRIV int beaglelogic_tcp_rx_start(struct dev_context *devc);
+SR_PRIV void beaglelogic_tcp_rx_stop(struct dev_context *devc);
+SR_PRIV const uint8_t *beaglelogic_tcp_rx_peek(struct dev_context *devc,
+	uint32_t *len);
+SR_PRIV void beaglelogic_tcp_rx_release(struct dev_context *devc);
+SR_PRIV int beaglelogic_tcp_rx_status(struct dev_context *devc);
 
 #endif
@@ -46,7 +46,7 @@ static int beaglelogic_tcp_open(struct dev_context *devc)
 {
 	struct addrinfo hints;
 	struct addrinfo *results, *res;
-	int err;
+	int err, bufsize;
 
 	memset(&hints, 0, sizeof(hints));
 	hints.ai_family = AF_UNSPEC;
@@ -81,6 +81,16 @@ static int beaglelogic_tcp_open(struct dev_context *devc)
 		return SR_ERR;
 	}
 
+	/*
+	 * A large receive buffer keeps the TCP window open while the
+	 * session is busy, the kernel may clamp the size. Not fatal.
+	 */
+	bufsize = TCP_SOCKET_BUFFER_SIZE;
+	if (setsockopt(devc->socket, SOL_SOCKET, SO_RCVBUF,
+			(const void *)&bufsize, sizeof(bufsize)) < 0)
+		sr_dbg("Cannot set socket receive buffer: %s",
+			g_strerror(errno));
+
 	return SR_OK;
 }
 
@@ -165,6 +175,186 @@ SR_PRIV int beaglelogic_tcp_drain(struct dev_context *devc)
 	return SR_OK;
 }
 
+/* Wait for socket input, up to the given number of milliseconds. */
+static int beaglelogic_tcp_wait(struct dev_context *devc, int timeout_ms)
+{
+	fd_set rset;
+	struct timeval tv;
+
+	FD_ZERO(&rset);
+	FD_SET(devc->socket, &rset);
+	tv.tv_sec = 0;
+	tv.tv_usec = timeout_ms * 1000;
+
+	return select(devc->socket + 1, &rset, NULL, NULL, &tv);
+}
+
+/*
+ * Receive sample data into the free buffers of the ring. A buffer is
+ * handed to the session when it is full, or when the connection went
+ * idle for a moment, so that low samplerates don't see a delay.
+ */
+static gpointer beaglelogic_tcp_rx_thread(gpointer data)
+{
+	struct dev_context *devc;
+	unsigned char *buf;
+	uint32_t fill;
+	size_t idx;
+	int ret, len, status;
+
+	devc = data;
+	status = SR_OK;
+
+	while (status == SR_OK) {
+		g_mutex_lock(&devc->tcp_rx_mutex);
+		while (devc->tcp_rx_running && devc->tcp_rx_count == TCP_RX_BUFFERS)
+			g_cond_wait(&devc->tcp_rx_cond, &devc->tcp_rx_mutex);
+		idx = (devc->tcp_rx_head + devc->tcp_rx_count) % TCP_RX_BUFFERS;
+		g_mutex_unlock(&devc->tcp_rx_mutex);
+		if (!g_atomic_int_get(&devc->tcp_rx_running))
+			break;
+
+		buf = devc->tcp_rx_buf[idx];
+		fill = 0;
+		while (fill < devc->tcp_packet_size
+				&& g_atomic_int_get(&devc->tcp_rx_running)) {
+			ret = beaglelogic_tcp_wait(devc, 20);
+			if (ret < 0 && errno != EINTR) {
+				sr_err("Select error: %s", g_strerror(errno));
+				status = SR_ERR_IO;
+				break;
+			}
+			if (ret <= 0) {
+				if (fill)
+					break;
+				continue;
+			}
+			len = recv(devc->socket, (char *)buf + fill,
+				devc->tcp_packet_size - fill, 0);
+			if (len < 0) {
+				sr_err("Receive error: %s", g_strerror(errno));
+				status = SR_ERR_IO;
+				break;
+			}
+			if (len == 0) {
+				sr_dbg("Connection closed by the server.");
+				status = SR_ERR_NA;
+				break;
+			}
+			fill += len;
+		}
+
+		g_mutex_lock(&devc->tcp_rx_mutex);
+		if (fill) {
+			devc->tcp_rx_len[idx] = fill;
+			devc->tcp_rx_count++;
+		}
+		devc->tcp_rx_status = status;
+		g_mutex_unlock(&devc->tcp_rx_mutex);
+	}
+
+	return NULL;
+}
+
+/* Start receiving sample data in a separate thread. */
+SR_PRIV int beaglelogic_tcp_rx_start(struct dev_context *devc)
+{
+	size_t i;
+
+	if (!devc->tcp_packet_size)
+		devc->tcp_packet_size = TCP_PACKET_SIZE;
+	for (i = 0; i < TCP_RX_BUFFERS; i++) {
+		devc->tcp_rx_buf[i] = g_try_malloc(devc->tcp_packet_size);
+		if (!devc->tcp_rx_buf[i]) {
+			sr_err("Cannot allocate receive buffers.");
+			beaglelogic_tcp_rx_stop(devc);
+			return SR_ERR_MALLOC;
+		}
+	}
+	devc->tcp_rx_head = 0;
+	devc->tcp_rx_count = 0;
+	devc->tcp_rx_status = SR_OK;
+	devc->tcp_rx_running = TRUE;
+	g_mutex_init(&devc->tcp_rx_mutex);
+	g_cond_init(&devc->tcp_rx_cond);
+
+	devc->tcp_rx_thread = g_thread_try_new("beaglelogic-rx",
+		beaglelogic_tcp_rx_thread, devc, NULL);
+	if (!devc->tcp_rx_thread) {
+		sr_err("Cannot start the receive thread.");
+		beaglelogic_tcp_rx_stop(devc);
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/* Stop the receive thread, discard data which was not sent yet. */
+SR_PRIV void beaglelogic_tcp_rx_stop(struct dev_context *devc)
+{
+	size_t i;
+
+	if (devc->tcp_rx_thread) {
+		g_mutex_lock(&devc->tcp_rx_mutex);
+		devc->tcp_rx_running = FALSE;
+		g_cond_signal(&devc->tcp_rx_cond);
+		g_mutex_unlock(&devc->tcp_rx_mutex);
+		g_thread_join(devc->tcp_rx_thread);
+		devc->tcp_rx_thread = NULL;
+		g_cond_clear(&devc->tcp_rx_cond);
+		g_mutex_clear(&devc->tcp_rx_mutex);
+	}
+	devc->tcp_rx_running = FALSE;
+
+	for (i = 0; i < TCP_RX_BUFFERS; i++) {
+		g_free(devc->tcp_rx_buf[i]);
+		devc->tcp_rx_buf[i] = NULL;
+	}
+	devc->tcp_rx_count = 0;
+}
+
+/* Get the oldest buffer which holds data, or NULL when there is none. */
+SR_PRIV const uint8_t *beaglelogic_tcp_rx_peek(struct dev_context *devc,
+	uint32_t *len)
+{
+	size_t count;
+
+	g_mutex_lock(&devc->tcp_rx_mutex);
+	count = devc->tcp_rx_count;
+	g_mutex_unlock(&devc->tcp_rx_mutex);
+	if (!count)
+		return NULL;
+
+	*len = devc->tcp_rx_len[devc->tcp_rx_head];
+
+	return devc->tcp_rx_buf[devc->tcp_rx_head];
+}
+
+/* Return the buffer of beaglelogic_tcp_rx_peek() to the thread. */
+SR_PRIV void beaglelogic_tcp_rx_release(struct dev_context *devc)
+{
+	g_mutex_lock(&devc->tcp_rx_mutex);
+	devc->tcp_rx_head = (devc->tcp_rx_head + 1) % TCP_RX_BUFFERS;
+	devc->tcp_rx_count--;
+	g_cond_signal(&devc->tcp_rx_cond);
+	g_mutex_unlock(&devc->tcp_rx_mutex);
+}
+
+/*
+ * Get the receive thread's status: SR_OK while it runs, SR_ERR_NA
+ * when the server closed the connection, or an error code.
+ */
+SR_PRIV int beaglelogic_tcp_rx_status(struct dev_context *devc)
+{
+	int status;
+
+	g_mutex_lock(&devc->tcp_rx_mutex);
+	status = devc->tcp_rx_status;
+	g_mutex_unlock(&devc->tcp_rx_mutex);
+
+	return status;
+}
+
 static int beaglelogic_tcp_get_string(struct dev_context *devc, const char *cmd,
 				      char **tcp_resp)
 {
@@ -117,6 +117,11 @@ SR_PRIV int beaglelogic_native_receive_data(int fd, int revents, void *cb_data)
 	return TRUE;
 }
 
+/*
+ * Sample data gets received by a separate thread, into packet sized
+ * buffers. This callback sends all the buffers which were filled since
+ * it last ran.
+ */
 SR_PRIV int beaglelogic_tcp_receive_data(int fd, int revents, void *cb_data)
 {
 	const struct sr_dev_inst *sdi;
@@ -124,36 +129,30 @@ SR_PRIV int beaglelogic_tcp_receive_data(int fd, int revents, void *cb_data)
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
 
-	int len;
+	const uint8_t *buf;
 	int pre_trigger_samples;
 	int trigger_offset;
 	uint32_t packetsize;
 	uint64_t bytes_remaining;
+	gboolean done;
+
+	(void)fd;
+	(void)revents;
 
 	if (!(sdi = cb_data) || !(devc = sdi->priv))
 		return TRUE;
 
-	packetsize = TCP_BUFFER_SIZE;
 	logic.unitsize = SAMPLEUNIT_TO_BYTES(devc->sampleunit);
+	done = FALSE;
 
-	if (revents == G_IO_IN) {
-		sr_info("In callback G_IO_IN");
-
-		len = recv(fd, devc->tcp_buffer, TCP_BUFFER_SIZE, 0);
-		if (len < 0) {
-			sr_err("Receive error: %s", g_strerror(errno));
-			return SR_ERR;
-		}
-
-		packetsize = len;
-
+	while (!done && (buf = beaglelogic_tcp_rx_peek(devc, &packetsize))) {
 		bytes_remaining = (devc->limit_samples * logic.unitsize) -
 				devc->bytes_read;
 
 		/* Configure data packet */
 		packet.type = SR_DF_LOGIC;
 		packet.payload = &logic;
-		logic.data = devc->tcp_buffer;
+		logic.data = (void *)buf;
 		logic.length = MIN(packetsize, bytes_remaining);
 
 		if (devc->trigger_fired) {
@@ -168,7 +167,7 @@ SR_PRIV int beaglelogic_tcp_receive_data(int fd, int revents, void *cb_data)
 				trigger_offset *= logic.unitsize;
 				logic.length = MIN(packetsize - trigger_offset,
 						bytes_remaining);
-				logic.data += trigger_offset;
+				logic.data = (uint8_t *)logic.data + trigger_offset;
 
 				sr_session_send(sdi, &packet);
 
@@ -176,6 +175,8 @@ SR_PRIV int beaglelogic_tcp_receive_data(int fd, int revents, void *cb_data)
 			}
 		}
 
+		beaglelogic_tcp_rx_release(devc);
+
 		/* Update byte count and offset (roll over if needed) */
 		devc->bytes_read += logic.length;
 		if ((devc->offset += packetsize) >= devc->buffersize) {
@@ -184,21 +185,28 @@ SR_PRIV int beaglelogic_tcp_receive_data(int fd, int revents, void *cb_data)
 			if (devc->triggerflags == BL_TRIGGERFLAGS_CONTINUOUS)
 				devc->offset = 0;
 			else
-				packetsize = 0;
+				done = TRUE;
 		}
+		if (devc->bytes_read >= devc->limit_samples * logic.unitsize)
+			done = TRUE;
 	}
 
+	/* Connection closed or failed, after all data was sent. */
+	if (!done && beaglelogic_tcp_rx_status(devc) != SR_OK
+			&& !beaglelogic_tcp_rx_peek(devc, &packetsize))
+		done = TRUE;
+
 	/* EOF Received or we have reached the limit */
-	if (devc->bytes_read >= devc->limit_samples * logic.unitsize ||
-			packetsize == 0) {
+	if (done) {
 		/* Send EOA Packet, stop polling */
 		std_session_send_df_end(sdi);
+		beaglelogic_tcp_rx_stop(devc);
 		devc->beaglelogic->stop(devc);
 
 		/* Drain the receive buffer */
 		beaglelogic_tcp_drain(devc);
 
-		sr_session_source_remove_pollfd(sdi->session, &devc->pollfd);
+		sr_session_source_remove(sdi->session, -1);
 	}
 
 	return TRUE;
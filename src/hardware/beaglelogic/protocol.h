@@ -32,7 +32,14 @@
 
 #define SAMPLEUNIT_TO_BYTES(x)	((x) == 1 ? 1 : 2)
 
-#define TCP_BUFFER_SIZE         (128 * 1024)
+/* Default size of the logic packets of TCP captures, and its bounds. */
+#define TCP_PACKET_SIZE         (1024 * 1024)
+#define TCP_PACKET_SIZE_MIN     (4 * 1024)
+#define TCP_PACKET_SIZE_MAX     (16 * 1024 * 1024)
+/* Number of packet buffers between the receive thread and the session. */
+#define TCP_RX_BUFFERS          8
+/* Kernel socket receive buffer, to ride out session stalls. */
+#define TCP_SOCKET_BUFFER_SIZE  (4 * 1024 * 1024)
 
 /** Private, per-device-instance driver context. */
 struct dev_context {
@@ -47,7 +54,22 @@ struct dev_context {
 	char *port;
 	int socket;
 	unsigned int read_timeout;
-	unsigned char *tcp_buffer;
+	uint32_t tcp_packet_size;
+
+	/*
+	 * TCP receive thread, fills a ring of packet sized buffers which
+	 * the session callback sends. Buffers from tcp_rx_head on, and
+	 * tcp_rx_count of them, hold data.
+	 */
+	GThread *tcp_rx_thread;
+	GMutex tcp_rx_mutex;
+	GCond tcp_rx_cond;
+	unsigned char *tcp_rx_buf[TCP_RX_BUFFERS];
+	uint32_t tcp_rx_len[TCP_RX_BUFFERS];
+	size_t tcp_rx_head;
+	size_t tcp_rx_count;
+	gboolean tcp_rx_running;
+	int tcp_rx_status;
 
 	/* Acquisition settings: see beaglelogic.h */
 	uint64_t cur_samplerate;
@@ -73,7 +73,7 @@ static int add_device(int model, struct libusb_device_descriptor *des,
 	devc->cur_samplerate = 0; /* Set later (different for LA8/LA16). */
 	devc->limit_msec = 0;
 	devc->limit_samples = 0;
-	memset(devc->mangled_buf, 0, BS);
+	memset(devc->mangled_buf, 0, sizeof(devc->mangled_buf));
 	devc->final_buf = NULL;
 	devc->trigger_pattern = 0x0000; /* Irrelevant, see trigger_mask. */
 	devc->trigger_mask = 0x0000; /* All channels: "don't care". */
@@ -151,7 +151,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		conn_devices = NULL;
 
 	devices = NULL;
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	usb_get_device_list(drvc->sr_ctx, &devlist);
 
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
@@ -194,7 +194,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 		libusb_close(hdl);
 
-		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+		if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 			continue;
 
 		if (!strcmp(product, "ChronoVu LA8"))
@@ -255,6 +255,14 @@ static int dev_open(struct sr_dev_inst *sdi)
 		goto err_ftdi_free;
 	}
 
+	/* Use USB transfers as large as our reads. */
+	if ((ret = ftdi_read_data_set_chunksize(devc->ftdic,
+			sizeof(devc->mangled_buf))) < 0) {
+		sr_err("Failed to set FTDI read data chunk size (%d): %s.",
+		       ret, ftdi_get_error_string(devc->ftdic));
+		goto err_ftdi_free;
+	}
+
 	g_usleep(100 * 1000);
 
 	return SR_OK;
@@ -392,7 +400,7 @@ static int receive_data(int fd, int revents, void *cb_data)
 		return FALSE;
 	}
 
-	/* Get one block of data. */
+	/* Get READ_BLOCKS blocks of data. */
 	if ((ret = cv_read_block(devc)) < 0) {
 		sr_err("Failed to read data block: %d.", ret);
 		sr_dev_acquisition_stop(sdi);
@@ -400,10 +408,10 @@ static int receive_data(int fd, int revents, void *cb_data)
 	}
 
 	/* We need to get exactly NUM_BLOCKS blocks (i.e. 8MB) of data. */
-	if (devc->block_counter != (NUM_BLOCKS - 1)) {
-		devc->block_counter++;
+	devc->block_counter += READ_BLOCKS;
+	sr_session_download_progress(sdi, devc->block_counter * BS, SDRAM_SIZE);
+	if (devc->block_counter != NUM_BLOCKS)
 		return TRUE;
-	}
 
 	sr_dbg("Sampling finished, sending data to session bus now.");
 
@@ -481,6 +489,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 			g_get_monotonic_time() + (10 * G_TIME_SPAN_SECOND);
 	devc->block_counter = 0;
 	devc->trigger_found = 0;
+	sr_session_download_progress(sdi, 0, SDRAM_SIZE);
 
 	/* Hook up a dummy handler to receive data from the device. */
 	sr_session_source_add(sdi->session, -1, 0, 0, receive_data, (void *)sdi);
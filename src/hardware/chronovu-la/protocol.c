@@ -348,7 +348,7 @@ SR_PRIV int cv_set_samplerate(const struct sr_dev_inst *sdi, uint64_t samplerate
 }
 
 /**
- * Get a block of data from the device.
+ * Get READ_BLOCKS blocks of data from the device.
  *
  * @param devc The struct containing private per-device-instance data. Must not
  *             be NULL. devc->ftdic must not be NULL either.
@@ -357,38 +357,53 @@ SR_PRIV int cv_set_samplerate(const struct sr_dev_inst *sdi, uint64_t samplerate
  */
 SR_PRIV int cv_read_block(struct dev_context *devc)
 {
-	int i, byte_offset, m, mi, p, q, index, bytes_read;
+	int i, byte_offset, m, mi, p, q, index, bytes_read, ret;
+	const int size = sizeof(devc->mangled_buf);
 	gint64 now;
 
 	/* Note: Caller checked that devc and devc->ftdic != NULL. */
 
-	sr_spew("Reading block %d.", devc->block_counter);
+	sr_spew("Reading blocks %d-%d.", devc->block_counter,
+		devc->block_counter + READ_BLOCKS - 1);
 
-	bytes_read = cv_read(devc, devc->mangled_buf, BS);
+	bytes_read = cv_read(devc, devc->mangled_buf, size);
 
 	/* If first block read got 0 bytes, retry until success or timeout. */
 	if ((bytes_read == 0) && (devc->block_counter == 0)) {
 		do {
 			sr_spew("Reading block 0 (again).");
 			/* Note: If bytes_read < 0 cv_read() will log errors. */
-			bytes_read = cv_read(devc, devc->mangled_buf, BS);
+			bytes_read = cv_read(devc, devc->mangled_buf, size);
 			now = g_get_monotonic_time();
 		} while ((devc->done > now) && (bytes_read == 0));
 	}
 
+	/* Once data flows, pick up the rest of a partial read. */
+	while (bytes_read > 0 && bytes_read < size) {
+		ret = cv_read(devc, devc->mangled_buf + bytes_read,
+			size - bytes_read);
+		if (ret <= 0)
+			break;
+		bytes_read += ret;
+	}
+
 	/* Check if block read was successful or a timeout occurred. */
-	if (bytes_read != BS) {
+	if (bytes_read != size) {
 		sr_err("Trigger timed out. Bytes read: %d.", bytes_read);
 		(void) reset_device(devc); /* Ignore errors. */
 		return SR_ERR;
 	}
 
-	/* De-mangle the data. */
-	sr_spew("Demangling block %d.", devc->block_counter);
+	/*
+	 * De-mangle the data. The blocks of one read never cross a
+	 * 1MB boundary, so 'm' is the same for all of them.
+	 */
+	sr_spew("Demangling blocks %d-%d.", devc->block_counter,
+		devc->block_counter + READ_BLOCKS - 1);
 	byte_offset = devc->block_counter * BS;
 	m = byte_offset / (1024 * 1024);
 	mi = m * (1024 * 1024);
-	for (i = 0; i < BS; i++) {
+	for (i = 0; i < size; i++) {
 		if (devc->prof->model == CHRONOVU_LA8) {
 			p = i & (1 << 0);
 			index = m * 2 + (((byte_offset + i) - mi) / 2) * 16;
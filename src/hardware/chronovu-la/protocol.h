@@ -35,6 +35,7 @@
 
 #define BS				4096 /* Block size */
 #define NUM_BLOCKS			2048 /* Number of blocks */
+#define READ_BLOCKS			16 /* Blocks per read */
 
 enum {
 	CHRONOVU_LA8,
@@ -61,8 +62,9 @@ struct dev_context {
 	/**
 	 * A buffer containing some (mangled) samples from the device.
 	 * Format: Pretty mangled-up (due to hardware reasons), see code.
+	 * Holds READ_BLOCKS blocks.
 	 */
-	uint8_t mangled_buf[BS];
+	uint8_t mangled_buf[READ_BLOCKS * BS];
 
 	/**
 	 * An 8MB buffer where we'll store the de-mangled samples.
@@ -100,7 +102,7 @@ struct dev_context {
 	/** Used for keeping track how much time has passed. */
 	gint64 done;
 
-	/** Counter/index for the data block to be read. */
+	/** Counter/index for the (first) data block to be read. */
 	int block_counter;
 
 	/** The divcount value (determines the sample period). */
@@ -51,6 +51,8 @@ static const uint32_t scanopts[] = {
 	SR_CONF_NUM_LOGIC_CHANNELS,
 	SR_CONF_NUM_ANALOG_CHANNELS,
 	SR_CONF_LIMIT_FRAMES,
+	SR_CONF_NUM_DEVICES,
+	SR_CONF_SAMPLERATE,
 };
 
 static const uint32_t drvopts[] = {
@@ -69,6 +71,9 @@ static const uint32_t devopts[] = {
 	SR_CONF_AVG_SAMPLES | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_TRIGGER_HYSTERESIS | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_UNTHROTTLED | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_LATENCY_PROBE_MSEC | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t devopts_cg_logic[] = {
@@ -93,6 +98,8 @@ static const int32_t trigger_matches[] = {
 	SR_TRIGGER_RISING,
 	SR_TRIGGER_FALLING,
 	SR_TRIGGER_EDGE,
+	SR_TRIGGER_OVER,
+	SR_TRIGGER_UNDER,
 };
 
 static const uint64_t samplerates[] = {
@@ -101,49 +108,35 @@ static const uint64_t samplerates[] = {
 	SR_HZ(1),
 };
 
-static GSList *scan(struct sr_dev_driver *di, GSList *options)
+static struct sr_dev_inst *dev_new(int num_logic_channels,
+		int num_analog_channels, uint64_t limit_frames,
+		uint64_t samplerate)
 {
 	struct dev_context *devc;
 	struct sr_dev_inst *sdi;
 	struct sr_channel *ch;
 	struct sr_channel_group *cg, *acg;
-	struct sr_config *src;
 	struct analog_gen *ag;
-	GSList *l;
-	int num_logic_channels, num_analog_channels, pattern, i;
-	uint64_t limit_frames;
+	int pattern, i;
 	char channel_name[16];
 
-	num_logic_channels = DEFAULT_NUM_LOGIC_CHANNELS;
-	num_analog_channels = DEFAULT_NUM_ANALOG_CHANNELS;
-	limit_frames = DEFAULT_LIMIT_FRAMES;
-	for (l = options; l; l = l->next) {
-		src = l->data;
-		switch (src->key) {
-		case SR_CONF_NUM_LOGIC_CHANNELS:
-			num_logic_channels = g_variant_get_int32(src->data);
-			break;
-		case SR_CONF_NUM_ANALOG_CHANNELS:
-			num_analog_channels = g_variant_get_int32(src->data);
-			break;
-		case SR_CONF_LIMIT_FRAMES:
-			limit_frames = g_variant_get_uint64(src->data);
-			break;
-		}
-	}
-
 	sdi = g_malloc0(sizeof(struct sr_dev_inst));
 	sdi->status = SR_ST_INACTIVE;
 	sdi->model = g_strdup("Demo device");
 
 	devc = g_malloc0(sizeof(struct dev_context));
-	devc->cur_samplerate = SR_KHZ(200);
+	devc->cur_samplerate = samplerate;
 	devc->num_logic_channels = num_logic_channels;
 	devc->logic_unitsize = (devc->num_logic_channels + 7) / 8;
-	devc->all_logic_channels_mask = 1UL << 0;
-	devc->all_logic_channels_mask <<= devc->num_logic_channels;
-	devc->all_logic_channels_mask--;
+	if (devc->num_logic_channels >= 64)
+		devc->all_logic_channels_mask = UINT64_MAX;
+	else
+		devc->all_logic_channels_mask =
+			(UINT64_C(1) << devc->num_logic_channels) - 1;
 	devc->logic_pattern = DEFAULT_LOGIC_PATTERN;
+	devc->logic_bufsize = MAX(LOGIC_BUFSIZE,
+		LOGIC_MIN_SAMPLES * devc->logic_unitsize);
+	devc->logic_data = g_malloc(devc->logic_bufsize);
 	devc->num_analog_channels = num_analog_channels;
 	devc->limit_frames = limit_frames;
 	devc->capture_ratio = 20;
@@ -163,6 +156,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	/* Analog channels, channel groups and pattern generators. */
 	devc->ch_ag = g_hash_table_new(g_direct_hash, g_direct_equal);
+	devc->analog_gens = g_ptr_array_sized_new(MAX(num_analog_channels, 0));
 	if (num_analog_channels > 0) {
 		/*
 		 * Have the waveform for analog patterns pre-generated. It's
@@ -190,11 +184,11 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 			sdi->channel_groups = g_slist_append(sdi->channel_groups, cg);
 
 			/* Every channel gets a generator struct. */
-			ag = g_malloc(sizeof(struct analog_gen));
+			ag = g_malloc0(sizeof(struct analog_gen));
 			ag->ch = ch;
 			ag->mq = SR_MQ_VOLTAGE;
 			ag->mq_flags = SR_MQFLAG_DC;
-			ag->unit = SR_UNIT_VOLT;
+			ag->unit = demo_mq_unit(ag->mq);
 			ag->amplitude = DEFAULT_ANALOG_AMPLITUDE;
 			ag->offset = DEFAULT_ANALOG_OFFSET;
 			sr_analog_init(&ag->packet, &ag->encoding, &ag->meaning, &ag->spec, 2);
@@ -204,11 +198,11 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 			ag->packet.meaning->unit = ag->unit;
 			ag->packet.encoding->digits = DEFAULT_ANALOG_ENCODING_DIGITS;
 			ag->packet.spec->spec_digits = DEFAULT_ANALOG_SPEC_DIGITS;
-			ag->packet.data = devc->analog_patterns[pattern];
 			ag->pattern = pattern;
 			ag->avg_val = 0.0f;
 			ag->num_avgs = 0;
 			g_hash_table_insert(devc->ch_ag, ch, ag);
+			g_ptr_array_add(devc->analog_gens, ag);
 
 			if (++pattern == ARRAY_SIZE(analog_pattern_str))
 				pattern = 0;
@@ -217,20 +211,75 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	sdi->priv = devc;
 
-	return std_scan_complete(di, g_slist_append(NULL, sdi));
+	return sdi;
+}
+
+static GSList *scan(struct sr_dev_driver *di, GSList *options)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_config *src;
+	GSList *l, *devices;
+	int num_logic_channels, num_analog_channels;
+	uint64_t limit_frames, num_devices, samplerate, i;
+
+	num_logic_channels = DEFAULT_NUM_LOGIC_CHANNELS;
+	num_analog_channels = DEFAULT_NUM_ANALOG_CHANNELS;
+	limit_frames = DEFAULT_LIMIT_FRAMES;
+	num_devices = DEFAULT_NUM_DEVICES;
+	samplerate = SR_KHZ(200);
+	for (l = options; l; l = l->next) {
+		src = l->data;
+		switch (src->key) {
+		case SR_CONF_NUM_LOGIC_CHANNELS:
+			num_logic_channels = g_variant_get_int32(src->data);
+			break;
+		case SR_CONF_NUM_ANALOG_CHANNELS:
+			num_analog_channels = g_variant_get_int32(src->data);
+			break;
+		case SR_CONF_LIMIT_FRAMES:
+			limit_frames = g_variant_get_uint64(src->data);
+			break;
+		case SR_CONF_NUM_DEVICES:
+			num_devices = g_variant_get_uint64(src->data);
+			break;
+		case SR_CONF_SAMPLERATE:
+			samplerate = g_variant_get_uint64(src->data);
+			break;
+		}
+	}
+
+	/*
+	 * Several devices have the same topology, their samplerates and
+	 * other settings can be changed one by one afterwards. Names tell
+	 * them apart.
+	 */
+	devices = NULL;
+	for (i = 0; i < num_devices; i++) {
+		sdi = dev_new(num_logic_channels, num_analog_channels,
+			limit_frames, samplerate);
+		if (num_devices > 1)
+			sdi->connection_id = g_strdup_printf("demo%" PRIu64, i);
+		devices = g_slist_append(devices, sdi);
+	}
+
+	return std_scan_complete(di, devices);
 }
 
 static void clear_helper(struct dev_context *devc)
 {
-	GHashTableIter iter;
-	void *value;
+	struct analog_gen *ag;
+	guint i;
 
 	demo_free_analog_pattern(devc);
+	g_free(devc->logic_data);
 
 	/* Analog generators. */
-	g_hash_table_iter_init(&iter, devc->ch_ag);
-	while (g_hash_table_iter_next(&iter, NULL, &value))
-		g_free(value);
+	for (i = 0; i < devc->analog_gens->len; i++) {
+		ag = devc->analog_gens->pdata[i];
+		g_free(ag->data);
+		g_free(ag);
+	}
+	g_ptr_array_free(devc->analog_gens, TRUE);
 	g_hash_table_unref(devc->ch_ag);
 }
 
@@ -321,6 +370,15 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_RATIO:
 		*data = g_variant_new_uint64(devc->capture_ratio);
 		break;
+	case SR_CONF_TRIGGER_HYSTERESIS:
+		*data = g_variant_new_double(devc->trigger_hysteresis);
+		break;
+	case SR_CONF_UNTHROTTLED:
+		*data = g_variant_new_boolean(devc->unthrottled);
+		break;
+	case SR_CONF_LATENCY_PROBE_MSEC:
+		*data = g_variant_new_uint64(devc->latency_probe_msec);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -373,6 +431,8 @@ static int config_set(uint32_t key, GVariant *data,
 			ag = g_hash_table_lookup(devc->ch_ag, ch);
 			mq_tuple_child = g_variant_get_child_value(data, 0);
 			ag->mq = g_variant_get_uint32(mq_tuple_child);
+			ag->unit = demo_mq_unit(ag->mq);
+			g_variant_unref(mq_tuple_child);
 			mq_tuple_child = g_variant_get_child_value(data, 1);
 			ag->mq_flags = g_variant_get_uint64(mq_tuple_child);
 			g_variant_unref(mq_tuple_child);
@@ -393,11 +453,6 @@ static int config_set(uint32_t key, GVariant *data,
 				sr_dbg("Setting logic pattern to %s",
 						logic_pattern_str[logic_pattern]);
 				devc->logic_pattern = logic_pattern;
-				/* Might as well do this now, these are static. */
-				if (logic_pattern == PATTERN_ALL_LOW)
-					memset(devc->logic_data, 0x00, LOGIC_BUFSIZE);
-				else if (logic_pattern == PATTERN_ALL_HIGH)
-					memset(devc->logic_data, 0xff, LOGIC_BUFSIZE);
 			} else if (ch->type == SR_CHANNEL_ANALOG) {
 				if (analog_pattern == -1)
 					return SR_ERR_ARG;
@@ -434,6 +489,15 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_CAPTURE_RATIO:
 		devc->capture_ratio = g_variant_get_uint64(data);
 		break;
+	case SR_CONF_TRIGGER_HYSTERESIS:
+		devc->trigger_hysteresis = g_variant_get_double(data);
+		break;
+	case SR_CONF_UNTHROTTLED:
+		devc->unthrottled = g_variant_get_boolean(data);
+		break;
+	case SR_CONF_LATENCY_PROBE_MSEC:
+		devc->latency_probe_msec = g_variant_get_uint64(data);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -507,9 +571,38 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	devc = sdi->priv;
 	devc->sent_samples = 0;
 	devc->sent_frame_samples = 0;
+	devc->analog_pos = 0;
 
 	/* Setup triggers */
-	if ((trigger = sr_session_trigger_get(sdi->session))) {
+	trigger = sr_session_trigger_get(sdi->session);
+	if (soft_trigger_analog_wanted(trigger)) {
+		int pre_trigger_samples = 0;
+		if (devc->avg) {
+			sr_err("Analog triggers don't work with averaging.");
+			return SR_ERR_NA;
+		}
+		if (devc->limit_samples > 0)
+			pre_trigger_samples = (devc->capture_ratio * devc->limit_samples) / 100;
+		else if (devc->limit_frames > 0)
+			pre_trigger_samples = (devc->capture_ratio * SAMPLES_PER_FRAME) / 100;
+		devc->sta = soft_trigger_analog_new(sdi, trigger, pre_trigger_samples,
+			devc->trigger_hysteresis, devc->limit_frames > 0);
+		if (!devc->sta)
+			return SR_ERR;
+		devc->trigger_packets = g_new0(struct sr_datafeed_analog,
+			MAX(devc->analog_gens->len, 1));
+
+		/*
+		 * Disable all logic channels, their data is generated in
+		 * chunks of other sizes than the analog data which the
+		 * trigger checks.
+		 */
+		for (l = sdi->channels; l; l = l->next) {
+			ch = l->data;
+			if (ch->type == SR_CHANNEL_LOGIC)
+				ch->enabled = FALSE;
+		}
+	} else if (trigger) {
 		int pre_trigger_samples = 0;
 		if (devc->limit_samples > 0)
 			pre_trigger_samples = (devc->capture_ratio * devc->limit_samples) / 100;
@@ -567,18 +660,26 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		devc->first_partial_logic_index,
 		devc->first_partial_logic_mask);
 
-	sr_session_source_add(sdi->session, -1, 0, 100,
+	devc->step = 0;
+	demo_prepare_logic_page(devc);
+
+	/* Without pacing, generate data whenever the main loop is idle. */
+	sr_session_source_add(sdi->session, -1, 0, devc->unthrottled ? 0 : 100,
 			demo_prepare_data, (struct sr_dev_inst *)sdi);
 
 	std_session_send_df_header(sdi);
 
-	if (devc->limit_frames > 0)
+	/* With an analog trigger, frames begin with the trigger. */
+	if (devc->limit_frames > 0 && !devc->sta)
 		std_session_send_df_frame_begin(sdi);
 
 	/* We use this timestamp to decide how many more samples to send. */
 	devc->start_us = g_get_monotonic_time();
 	devc->spent_us = 0;
-	devc->step = 0;
+	devc->stats_start_us = devc->start_us;
+	devc->stats_cb_us = 0;
+	devc->stats_cb_count = 0;
+	devc->next_probe_us = devc->start_us;
 
 	return SR_OK;
 }
@@ -586,11 +687,12 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
+	int64_t elapsed_us;
 
 	sr_session_source_remove(sdi->session, -1);
 
 	devc = sdi->priv;
-	if (devc->limit_frames > 0)
+	if (devc->limit_frames > 0 && (!devc->sta || devc->trigger_fired))
 		std_session_send_df_frame_end(sdi);
 
 	std_session_send_df_end(sdi);
@@ -599,6 +701,19 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 		soft_trigger_logic_free(devc->stl);
 		devc->stl = NULL;
 	}
+	soft_trigger_analog_free(devc->sta);
+	devc->sta = NULL;
+	g_free(devc->trigger_packets);
+	devc->trigger_packets = NULL;
+	demo_free_logic_page(devc);
+
+	elapsed_us = MAX(g_get_monotonic_time() - devc->stats_start_us, 1);
+	sr_info("Sent %" PRIu64 " samples in %.3f s (%.3f MS/s), "
+		"%" PRIu64 " callbacks took %.3f s (%.1f%%).",
+		devc->sent_samples, elapsed_us / 1e6,
+		(double)devc->sent_samples / elapsed_us,
+		devc->stats_cb_count, devc->stats_cb_us / 1e6,
+		100.0 * devc->stats_cb_us / elapsed_us);
 
 	return SR_OK;
 }
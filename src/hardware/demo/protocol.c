@@ -173,9 +173,18 @@ static const uint8_t pattern_squid[128][128 / 8] = {
 	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, },
 };
 
-SR_PRIV void demo_generate_analog_pattern(struct dev_context *devc)
+/*
+ * The analog patterns only depend on the position within their period,
+ * not on a device's settings. They get generated once, and are shared
+ * read-only by the channels of all demo devices.
+ */
+G_LOCK_DEFINE_STATIC(analog_patterns);
+static struct analog_pattern *analog_patterns[ARRAY_SIZE(analog_pattern_str)];
+static unsigned int analog_patterns_refs;
+
+static void generate_analog_patterns(void)
 {
-	double t, frequency;
+	double t;
 	float amplitude, offset;
 	struct analog_pattern *pattern;
 	unsigned int num_samples, i;
@@ -183,7 +192,6 @@ SR_PRIV void demo_generate_analog_pattern(struct dev_context *devc)
 	int last_end;
 
 	num_samples = ANALOG_BUFSIZE / sizeof(float);
-	frequency = (double) devc->cur_samplerate / ANALOG_SAMPLES_PER_PERIOD;
 	amplitude = DEFAULT_ANALOG_AMPLITUDE;
 	offset = DEFAULT_ANALOG_OFFSET;
 
@@ -207,7 +215,7 @@ SR_PRIV void demo_generate_analog_pattern(struct dev_context *devc)
 		pattern->data[i] = value + offset;
 	}
 	pattern->num_samples = last_end;
-	devc->analog_patterns[PATTERN_SQUARE] = pattern;
+	analog_patterns[PATTERN_SQUARE] = pattern;
 
 	/* Readjusting num_samples for all other patterns. */
 	while (num_samples % ANALOG_SAMPLES_PER_PERIOD != 0)
@@ -217,48 +225,126 @@ SR_PRIV void demo_generate_analog_pattern(struct dev_context *devc)
 	sr_dbg("Generating %s pattern.", analog_pattern_str[PATTERN_SINE]);
 	pattern = g_malloc(sizeof(struct analog_pattern));
 	for (i = 0; i < num_samples; i++) {
-		t = (double) i / (double) devc->cur_samplerate;
-		pattern->data[i] = sin(2 * G_PI * frequency * t) * amplitude + offset;
+		t = (double) i / ANALOG_SAMPLES_PER_PERIOD;
+		pattern->data[i] = sin(2 * G_PI * t) * amplitude + offset;
 	}
 	pattern->num_samples = last_end;
-	devc->analog_patterns[PATTERN_SINE] = pattern;
+	analog_patterns[PATTERN_SINE] = pattern;
 
 	/* PATTERN_TRIANGLE: */
 	sr_dbg("Generating %s pattern.", analog_pattern_str[PATTERN_TRIANGLE]);
 	pattern = g_malloc(sizeof(struct analog_pattern));
 	for (i = 0; i < num_samples; i++) {
-		t = (double) i / (double) devc->cur_samplerate;
-		pattern->data[i] = (2 / G_PI) * asin(sin(2 * G_PI * frequency * t)) *
+		t = (double) i / ANALOG_SAMPLES_PER_PERIOD;
+		pattern->data[i] = (2 / G_PI) * asin(sin(2 * G_PI * t)) *
 			amplitude + offset;
 	}
 	pattern->num_samples = last_end;
-	devc->analog_patterns[PATTERN_TRIANGLE] = pattern;
+	analog_patterns[PATTERN_TRIANGLE] = pattern;
 
 	/* PATTERN_SAWTOOTH: */
 	sr_dbg("Generating %s pattern.", analog_pattern_str[PATTERN_SAWTOOTH]);
 	pattern = g_malloc(sizeof(struct analog_pattern));
 	for (i = 0; i < num_samples; i++) {
-		t = (double) i / (double) devc->cur_samplerate;
-		pattern->data[i] = 2 * ((t * frequency) - floor(0.5f + t * frequency)) *
+		t = (double) i / ANALOG_SAMPLES_PER_PERIOD;
+		pattern->data[i] = 2 * (t - floor(0.5f + t)) *
 			amplitude + offset;
 	}
 	pattern->num_samples = last_end;
-	devc->analog_patterns[PATTERN_SAWTOOTH] = pattern;
+	analog_patterns[PATTERN_SAWTOOTH] = pattern;
 
 	/* PATTERN_ANALOG_RANDOM */
 	/* Data not filled here, will be generated in send_analog_packet(). */
 	pattern = g_malloc(sizeof(struct analog_pattern));
 	pattern->num_samples = last_end;
-	devc->analog_patterns[PATTERN_ANALOG_RANDOM] = pattern;
+	analog_patterns[PATTERN_ANALOG_RANDOM] = pattern;
+}
+
+/* Take a reference to the shared analog patterns. */
+SR_PRIV void demo_generate_analog_pattern(struct dev_context *devc)
+{
+	size_t i;
+
+	G_LOCK(analog_patterns);
+	if (!analog_patterns_refs++)
+		generate_analog_patterns();
+	for (i = 0; i < ARRAY_SIZE(analog_patterns); i++)
+		devc->analog_patterns[i] = analog_patterns[i];
+	G_UNLOCK(analog_patterns);
 }
 
 SR_PRIV void demo_free_analog_pattern(struct dev_context *devc)
 {
-	g_free(devc->analog_patterns[PATTERN_SQUARE]);
-	g_free(devc->analog_patterns[PATTERN_SINE]);
-	g_free(devc->analog_patterns[PATTERN_TRIANGLE]);
-	g_free(devc->analog_patterns[PATTERN_SAWTOOTH]);
-	g_free(devc->analog_patterns[PATTERN_ANALOG_RANDOM]);
+	size_t i;
+
+	if (!devc->analog_patterns[PATTERN_SQUARE])
+		return;
+
+	G_LOCK(analog_patterns);
+	if (!--analog_patterns_refs) {
+		for (i = 0; i < ARRAY_SIZE(analog_patterns); i++) {
+			g_free(analog_patterns[i]);
+			analog_patterns[i] = NULL;
+		}
+	}
+	G_UNLOCK(analog_patterns);
+	memset(devc->analog_patterns, 0, sizeof(devc->analog_patterns));
+}
+
+/* The unit of a measured quantity. */
+SR_PRIV enum sr_unit demo_mq_unit(enum sr_mq mq)
+{
+	switch (mq) {
+	case SR_MQ_VOLTAGE:
+		return SR_UNIT_VOLT;
+	case SR_MQ_CURRENT:
+		return SR_UNIT_AMPERE;
+	case SR_MQ_RESISTANCE:
+	case SR_MQ_CONTINUITY:
+	case SR_MQ_PARALLEL_RESISTANCE:
+	case SR_MQ_SERIES_RESISTANCE:
+		return SR_UNIT_OHM;
+	case SR_MQ_CAPACITANCE:
+	case SR_MQ_PARALLEL_CAPACITANCE:
+	case SR_MQ_SERIES_CAPACITANCE:
+		return SR_UNIT_FARAD;
+	case SR_MQ_TEMPERATURE:
+		return SR_UNIT_CELSIUS;
+	case SR_MQ_FREQUENCY:
+		return SR_UNIT_HERTZ;
+	case SR_MQ_DUTY_CYCLE:
+	case SR_MQ_PULSE_WIDTH:
+		return SR_UNIT_PERCENTAGE;
+	case SR_MQ_CONDUCTANCE:
+		return SR_UNIT_SIEMENS;
+	case SR_MQ_POWER:
+		return SR_UNIT_WATT;
+	case SR_MQ_SOUND_PRESSURE_LEVEL:
+		return SR_UNIT_DECIBEL_SPL;
+	case SR_MQ_CARBON_MONOXIDE:
+		return SR_UNIT_CONCENTRATION;
+	case SR_MQ_RELATIVE_HUMIDITY:
+		return SR_UNIT_HUMIDITY_293K;
+	case SR_MQ_TIME:
+		return SR_UNIT_SECOND;
+	case SR_MQ_WIND_SPEED:
+		return SR_UNIT_METER_SECOND;
+	case SR_MQ_PRESSURE:
+		return SR_UNIT_HECTOPASCAL;
+	case SR_MQ_PARALLEL_INDUCTANCE:
+	case SR_MQ_SERIES_INDUCTANCE:
+		return SR_UNIT_HENRY;
+	case SR_MQ_PHASE_ANGLE:
+		return SR_UNIT_DEGREE;
+	case SR_MQ_COUNT:
+		return SR_UNIT_PIECE;
+	case SR_MQ_APPARENT_POWER:
+		return SR_UNIT_VOLT_AMPERE;
+	case SR_MQ_MASS:
+		return SR_UNIT_GRAM;
+	default:
+		return SR_UNIT_UNITLESS;
+	}
 }
 
 static uint64_t encode_number_to_gray(uint64_t nr)
@@ -274,9 +360,9 @@ static void set_logic_data(uint64_t bits, uint8_t *data, size_t len)
 	}
 }
 
-static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
+static void logic_generator(struct dev_context *devc, uint8_t *data,
+		uint64_t size)
 {
-	struct dev_context *devc;
 	uint64_t i, j;
 	uint8_t pat;
 	uint8_t *sample;
@@ -284,35 +370,33 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 	size_t col_count, col_height;
 	uint64_t gray;
 
-	devc = sdi->priv;
-
 	switch (devc->logic_pattern) {
 	case PATTERN_SIGROK:
-		memset(devc->logic_data, 0x00, size);
+		memset(data, 0x00, size);
 		for (i = 0; i < size; i += devc->logic_unitsize) {
 			for (j = 0; j < devc->logic_unitsize; j++) {
 				pat = pattern_sigrok[(devc->step + j) % sizeof(pattern_sigrok)] >> 1;
-				devc->logic_data[i + j] = ~pat;
+				data[i + j] = ~pat;
 			}
 			devc->step++;
 		}
 		break;
 	case PATTERN_RANDOM:
 		for (i = 0; i < size; i++)
-			devc->logic_data[i] = (uint8_t)(rand() & 0xff);
+			data[i] = (uint8_t)(rand() & 0xff);
 		break;
 	case PATTERN_INC:
-		for (i = 0; i < size; i++) {
+		for (i = 0; i < size; i += devc->logic_unitsize) {
 			for (j = 0; j < devc->logic_unitsize; j++)
-				devc->logic_data[i + j] = devc->step;
+				data[i + j] = devc->step;
 			devc->step++;
 		}
 		break;
 	case PATTERN_WALKING_ONE:
 		/* j contains the value of the highest bit */
-		j = 1 << (devc->num_logic_channels - 1);
+		j = UINT64_C(1) << (MIN(devc->num_logic_channels, 64) - 1);
 		for (i = 0; i < size; i++) {
-			devc->logic_data[i] = devc->step;
+			data[i] = devc->step;
 			if (devc->step == 0)
 				devc->step = 1;
 			else
@@ -325,9 +409,9 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 	case PATTERN_WALKING_ZERO:
 		/* Same as walking one, only with inverted output */
 		/* j contains the value of the highest bit */
-		j = 1 << (devc->num_logic_channels - 1);
+		j = UINT64_C(1) << (MIN(devc->num_logic_channels, 64) - 1);
 		for (i = 0; i < size; i++) {
-			devc->logic_data[i] = ~devc->step;
+			data[i] = ~devc->step;
 			if (devc->step == 0)
 				devc->step = 1;
 			else
@@ -338,15 +422,17 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 		}
 		break;
 	case PATTERN_ALL_LOW:
+		memset(data, 0x00, size);
+		break;
 	case PATTERN_ALL_HIGH:
-		/* These were set when the pattern mode was selected. */
+		memset(data, 0xff, size);
 		break;
 	case PATTERN_SQUID:
-		memset(devc->logic_data, 0x00, size);
+		memset(data, 0x00, size);
 		col_count = ARRAY_SIZE(pattern_squid);
 		col_height = ARRAY_SIZE(pattern_squid[0]);
 		for (i = 0; i < size; i += devc->logic_unitsize) {
-			sample = &devc->logic_data[i];
+			sample = &data[i];
 			image_col = pattern_squid[devc->step];
 			for (j = 0; j < devc->logic_unitsize; j++) {
 				pat = image_col[j % col_height];
@@ -362,7 +448,7 @@ static void logic_generator(struct sr_dev_inst *sdi, uint64_t size)
 			devc->step &= devc->all_logic_channels_mask;
 			gray = encode_number_to_gray(devc->step);
 			gray &= devc->all_logic_channels_mask;
-			set_logic_data(gray, &devc->logic_data[i], devc->logic_unitsize);
+			set_logic_data(gray, &data[i], devc->logic_unitsize);
 		}
 		break;
 	default:
@@ -399,18 +485,166 @@ static void logic_fixup_feed(struct dev_context *devc,
 	}
 }
 
+static uint64_t gcd(uint64_t a, uint64_t b)
+{
+	uint64_t t;
+
+	while (b) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+/*
+ * Get the number of samples after which the logic pattern repeats,
+ * or 0 when it doesn't repeat within LOGIC_PAGE_MAX_PERIOD samples.
+ */
+static uint64_t logic_pattern_period(const struct dev_context *devc)
+{
+	uint64_t period;
+
+	switch (devc->logic_pattern) {
+	case PATTERN_SIGROK:
+		return sizeof(pattern_sigrok);
+	case PATTERN_INC:
+		return 256;
+	case PATTERN_WALKING_ONE:
+	case PATTERN_WALKING_ZERO:
+		/* These walk across bytes, not samples. */
+		period = MIN(devc->num_logic_channels, 64) + 1;
+		return period / gcd(period, devc->logic_unitsize);
+	case PATTERN_ALL_LOW:
+	case PATTERN_ALL_HIGH:
+		return 1;
+	case PATTERN_SQUID:
+		return ARRAY_SIZE(pattern_squid);
+	case PATTERN_GRAYCODE:
+		if (devc->all_logic_channels_mask >= LOGIC_PAGE_MAX_PERIOD)
+			return 0;
+		return devc->all_logic_channels_mask + 1;
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Precompute a page of logic data for periodic patterns: one period,
+ * plus the size of a packet. Packets then get sent from the page by
+ * reference, instead of generating their data over and over.
+ */
+SR_PRIV void demo_prepare_logic_page(struct dev_context *devc)
+{
+	struct sr_datafeed_logic logic;
+	uint64_t period, page_samples, offset, chunk;
+
+	demo_free_logic_page(devc);
+
+	period = logic_pattern_period(devc);
+	if (!period)
+		return;
+
+	page_samples = period + LOGIC_PAGE_CHUNK / devc->logic_unitsize;
+	devc->logic_page = g_try_malloc(page_samples * devc->logic_unitsize);
+	if (!devc->logic_page)
+		return;
+	devc->logic_page_period = period;
+	devc->logic_page_pos = 0;
+
+	chunk = (devc->logic_bufsize / devc->logic_unitsize) * devc->logic_unitsize;
+	for (offset = 0; offset < page_samples * devc->logic_unitsize; offset += chunk) {
+		logic_generator(devc, devc->logic_page + offset,
+			MIN(chunk, page_samples * devc->logic_unitsize - offset));
+	}
+
+	logic.length = page_samples * devc->logic_unitsize;
+	logic.unitsize = devc->logic_unitsize;
+	logic.data = devc->logic_page;
+	logic_fixup_feed(devc, &logic);
+
+	sr_dbg("Precomputed logic pattern %d, period %" PRIu64 " samples.",
+		devc->logic_pattern, period);
+}
+
+SR_PRIV void demo_free_logic_page(struct dev_context *devc)
+{
+	g_free(devc->logic_page);
+	devc->logic_page = NULL;
+	devc->logic_page_period = 0;
+}
+
+/*
+ * Point a generator's packet at its next samples, from the pattern or
+ * with amplitude and offset applied. Returns the number of samples, the
+ * same for all generators at the same position.
+ */
+static uint64_t analog_gen_fill(struct analog_gen *ag,
+		struct dev_context *devc, uint64_t analog_pos,
+		uint64_t analog_todo)
+{
+	const struct analog_pattern *pattern;
+	uint64_t sending_now;
+	int ag_pattern_pos;
+	unsigned int i;
+	float amplitude, offset;
+	float *data;
+
+	pattern = devc->analog_patterns[ag->pattern];
+
+	/* The channel list stays the one of the channel's group. */
+	ag->packet.meaning->mq = ag->mq;
+	ag->packet.meaning->mqflags = ag->mq_flags;
+	ag->packet.meaning->unit = ag->unit;
+
+	ag_pattern_pos = analog_pos % pattern->num_samples;
+	sending_now = MIN(analog_todo, pattern->num_samples - ag_pattern_pos);
+	if (ag->amplitude != DEFAULT_ANALOG_AMPLITUDE ||
+		ag->offset != DEFAULT_ANALOG_OFFSET ||
+		ag->pattern == PATTERN_ANALOG_RANDOM) {
+		/*
+		 * Amplitude or offset changed (or we are generating
+		 * random data), modify each sample.
+		 */
+		if (ag->pattern == PATTERN_ANALOG_RANDOM) {
+			amplitude = ag->amplitude / 500.0;
+			offset = ag->offset - DEFAULT_ANALOG_OFFSET - ag->amplitude;
+		} else {
+			amplitude = ag->amplitude / DEFAULT_ANALOG_AMPLITUDE;
+			offset = ag->offset - DEFAULT_ANALOG_OFFSET;
+		}
+		/* The patterns are shared, modify a copy. */
+		if (!ag->data)
+			ag->data = g_malloc(sizeof(pattern->data));
+		data = ag->data;
+		for (i = 0; i < sending_now; i++) {
+			if (ag->pattern == PATTERN_ANALOG_RANDOM)
+				data[i] = (rand() % 1000) * amplitude + offset;
+			else
+				data[i] = pattern->data[ag_pattern_pos + i] * amplitude + offset;
+		}
+		ag->packet.data = data;
+	} else {
+		/* Amplitude and offset unchanged, use the fast way. */
+		ag->packet.data = (float *)pattern->data + ag_pattern_pos;
+	}
+	ag->packet.num_samples = sending_now;
+
+	return sending_now;
+}
+
 static void send_analog_packet(struct analog_gen *ag,
 		struct sr_dev_inst *sdi, uint64_t *analog_sent,
 		uint64_t analog_pos, uint64_t analog_todo)
 {
 	struct sr_datafeed_packet packet;
 	struct dev_context *devc;
-	struct analog_pattern *pattern;
+	const struct analog_pattern *pattern;
 	uint64_t sending_now, to_avg;
 	int ag_pattern_pos;
 	unsigned int i;
 	float amplitude, offset, value;
-	float *data;
 
 	if (!ag->ch || !ag->ch->enabled)
 		return;
@@ -419,116 +653,17 @@ static void send_analog_packet(struct analog_gen *ag,
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &ag->packet;
 
-	pattern = devc->analog_patterns[ag->pattern];
-
-	ag->packet.meaning->channels = g_slist_append(NULL, ag->ch);
-	ag->packet.meaning->mq = ag->mq;
-	ag->packet.meaning->mqflags = ag->mq_flags;
-
-	/* Set a unit for the given quantity. */
-	if (ag->mq == SR_MQ_VOLTAGE)
-		ag->packet.meaning->unit = SR_UNIT_VOLT;
-	else if (ag->mq == SR_MQ_CURRENT)
-		ag->packet.meaning->unit = SR_UNIT_AMPERE;
-	else if (ag->mq == SR_MQ_RESISTANCE)
-		ag->packet.meaning->unit = SR_UNIT_OHM;
-	else if (ag->mq == SR_MQ_CAPACITANCE)
-		ag->packet.meaning->unit = SR_UNIT_FARAD;
-	else if (ag->mq == SR_MQ_TEMPERATURE)
-		ag->packet.meaning->unit = SR_UNIT_CELSIUS;
-	else if (ag->mq == SR_MQ_FREQUENCY)
-		ag->packet.meaning->unit = SR_UNIT_HERTZ;
-	else if (ag->mq == SR_MQ_DUTY_CYCLE)
-		ag->packet.meaning->unit = SR_UNIT_PERCENTAGE;
-	else if (ag->mq == SR_MQ_CONTINUITY)
-		ag->packet.meaning->unit = SR_UNIT_OHM;
-	else if (ag->mq == SR_MQ_PULSE_WIDTH)
-		ag->packet.meaning->unit = SR_UNIT_PERCENTAGE;
-	else if (ag->mq == SR_MQ_CONDUCTANCE)
-		ag->packet.meaning->unit = SR_UNIT_SIEMENS;
-	else if (ag->mq == SR_MQ_POWER)
-		ag->packet.meaning->unit = SR_UNIT_WATT;
-	else if (ag->mq == SR_MQ_GAIN)
-		ag->packet.meaning->unit = SR_UNIT_UNITLESS;
-	else if (ag->mq == SR_MQ_SOUND_PRESSURE_LEVEL)
-		ag->packet.meaning->unit = SR_UNIT_DECIBEL_SPL;
-	else if (ag->mq == SR_MQ_CARBON_MONOXIDE)
-		ag->packet.meaning->unit = SR_UNIT_CONCENTRATION;
-	else if (ag->mq == SR_MQ_RELATIVE_HUMIDITY)
-		ag->packet.meaning->unit = SR_UNIT_HUMIDITY_293K;
-	else if (ag->mq == SR_MQ_TIME)
-		ag->packet.meaning->unit = SR_UNIT_SECOND;
-	else if (ag->mq == SR_MQ_WIND_SPEED)
-		ag->packet.meaning->unit = SR_UNIT_METER_SECOND;
-	else if (ag->mq == SR_MQ_PRESSURE)
-		ag->packet.meaning->unit = SR_UNIT_HECTOPASCAL;
-	else if (ag->mq == SR_MQ_PARALLEL_INDUCTANCE)
-		ag->packet.meaning->unit = SR_UNIT_HENRY;
-	else if (ag->mq == SR_MQ_PARALLEL_CAPACITANCE)
-		ag->packet.meaning->unit = SR_UNIT_FARAD;
-	else if (ag->mq == SR_MQ_PARALLEL_RESISTANCE)
-		ag->packet.meaning->unit = SR_UNIT_OHM;
-	else if (ag->mq == SR_MQ_SERIES_INDUCTANCE)
-		ag->packet.meaning->unit = SR_UNIT_HENRY;
-	else if (ag->mq == SR_MQ_SERIES_CAPACITANCE)
-		ag->packet.meaning->unit = SR_UNIT_FARAD;
-	else if (ag->mq == SR_MQ_SERIES_RESISTANCE)
-		ag->packet.meaning->unit = SR_UNIT_OHM;
-	else if (ag->mq == SR_MQ_DISSIPATION_FACTOR)
-		ag->packet.meaning->unit = SR_UNIT_UNITLESS;
-	else if (ag->mq == SR_MQ_QUALITY_FACTOR)
-		ag->packet.meaning->unit = SR_UNIT_UNITLESS;
-	else if (ag->mq == SR_MQ_PHASE_ANGLE)
-		ag->packet.meaning->unit = SR_UNIT_DEGREE;
-	else if (ag->mq == SR_MQ_DIFFERENCE)
-		ag->packet.meaning->unit = SR_UNIT_UNITLESS;
-	else if (ag->mq == SR_MQ_COUNT)
-		ag->packet.meaning->unit = SR_UNIT_PIECE;
-	else if (ag->mq == SR_MQ_POWER_FACTOR)
-		ag->packet.meaning->unit = SR_UNIT_UNITLESS;
-	else if (ag->mq == SR_MQ_APPARENT_POWER)
-		ag->packet.meaning->unit = SR_UNIT_VOLT_AMPERE;
-	else if (ag->mq == SR_MQ_MASS)
-		ag->packet.meaning->unit = SR_UNIT_GRAM;
-	else if (ag->mq == SR_MQ_HARMONIC_RATIO)
-		ag->packet.meaning->unit = SR_UNIT_UNITLESS;
-	else
-		ag->packet.meaning->unit = SR_UNIT_UNITLESS;
-
 	if (!devc->avg) {
-		ag_pattern_pos = analog_pos % pattern->num_samples;
-		sending_now = MIN(analog_todo, pattern->num_samples - ag_pattern_pos);
-		if (ag->amplitude != DEFAULT_ANALOG_AMPLITUDE ||
-			ag->offset != DEFAULT_ANALOG_OFFSET ||
-			ag->pattern == PATTERN_ANALOG_RANDOM) {
-			/*
-			 * Amplitude or offset changed (or we are generating
-			 * random data), modify each sample.
-			 */
-			if (ag->pattern == PATTERN_ANALOG_RANDOM) {
-				amplitude = ag->amplitude / 500.0;
-				offset = ag->offset - DEFAULT_ANALOG_OFFSET - ag->amplitude;
-			} else {
-				amplitude = ag->amplitude / DEFAULT_ANALOG_AMPLITUDE;
-				offset = ag->offset - DEFAULT_ANALOG_OFFSET;
-			}
-			data = ag->packet.data;
-			for (i = 0; i < sending_now; i++) {
-				if (ag->pattern == PATTERN_ANALOG_RANDOM)
-					data[i] = (rand() % 1000) * amplitude + offset;
-				else
-					data[i] = pattern->data[ag_pattern_pos + i] * amplitude + offset;
-			}
-		} else {
-			/* Amplitude and offset unchanged, use the fast way. */
-			ag->packet.data = pattern->data + ag_pattern_pos;
-		}
-		ag->packet.num_samples = sending_now;
+		sending_now = analog_gen_fill(ag, devc, analog_pos, analog_todo);
 		sr_session_send(sdi, &packet);
 
 		/* Whichever channel group gets there first. */
 		*analog_sent = MAX(*analog_sent, sending_now);
 	} else {
+		pattern = devc->analog_patterns[ag->pattern];
+		ag->packet.meaning->mq = ag->mq;
+		ag->packet.meaning->mqflags = ag->mq_flags;
+		ag->packet.meaning->unit = ag->unit;
 		ag_pattern_pos = analog_pos % pattern->num_samples;
 		to_avg = MIN(analog_todo, pattern->num_samples - ag_pattern_pos);
 		if (ag->pattern == PATTERN_ANALOG_RANDOM) {
@@ -572,20 +707,83 @@ do_send:
 	}
 }
 
+/*
+ * Generate the next samples of all enabled analog channels and check
+ * them for the analog trigger. Returns the number of samples which got
+ * generated. When the trigger fires, the pre-trigger samples and up to
+ * @a room samples in total get sent, their number is in @a sent.
+ */
+static uint64_t analog_trigger_check(struct sr_dev_inst *sdi,
+		uint64_t analog_pos, uint64_t analog_todo, uint64_t room,
+		uint64_t *sent)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct analog_gen *ag;
+	uint64_t num_samples, post;
+	int num_channels, offset, pre_trigger_samples;
+	guint i;
+
+	devc = sdi->priv;
+	*sent = 0;
+
+	num_samples = analog_todo;
+	num_channels = 0;
+	for (i = 0; i < devc->analog_gens->len; i++) {
+		ag = devc->analog_gens->pdata[i];
+		if (!ag->ch || !ag->ch->enabled)
+			continue;
+		num_samples = analog_gen_fill(ag, devc, analog_pos, analog_todo);
+		devc->trigger_packets[num_channels++] = ag->packet;
+	}
+	if (!num_channels)
+		return num_samples;
+
+	offset = soft_trigger_analog_check(devc->sta, NULL,
+		devc->trigger_packets, num_channels, &pre_trigger_samples);
+	if (offset < -1) {
+		sr_err("Analog trigger check failed: %d.", offset);
+		sr_dev_acquisition_stop(sdi);
+		return analog_todo;
+	}
+	if (offset < 0)
+		return num_samples;
+
+	devc->trigger_fired = TRUE;
+	post = num_samples - offset;
+	if (room < pre_trigger_samples + post)
+		post = room > (uint64_t)pre_trigger_samples
+			? room - pre_trigger_samples : 0;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	for (i = 0; post && (int)i < num_channels; i++) {
+		analog = devc->trigger_packets[i];
+		analog.data = (float *)analog.data + offset;
+		analog.num_samples = post;
+		sr_session_send(sdi, &packet);
+	}
+	*sent = pre_trigger_samples + post;
+
+	return num_samples;
+}
+
 /* Callback handling data */
-SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
+static int prepare_data(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
 	struct analog_gen *ag;
-	GHashTableIter iter;
-	void *value;
+	guint i;
 	uint64_t samples_todo, logic_done, analog_done, analog_sent, sending_now;
-	int64_t elapsed_us, limit_us, todo_us;
+	uint64_t room, sent;
+	int64_t elapsed_us, limit_us, todo_us, now_us;
 	int64_t trigger_offset;
 	int pre_trigger_samples;
+	gboolean analog_waiting;
+	uint8_t *data;
 
 	(void)fd;
 	(void)revents;
@@ -601,8 +799,25 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 		return G_SOURCE_CONTINUE;
 	}
 
-	/* What time span should we send samples for? */
-	elapsed_us = g_get_monotonic_time() - devc->start_us;
+	/*
+	 * Hold the generated time base while the consumers report
+	 * backpressure, so that they see a lower rate instead of
+	 * a burst of samples when they catch up.
+	 */
+	if (sr_session_backpressure_get(sdi->session) >= SR_BACKPRESSURE_HIGH) {
+		devc->start_us = g_get_monotonic_time() - devc->spent_us;
+		return G_SOURCE_CONTINUE;
+	}
+
+	/*
+	 * What time span should we send samples for? Without pacing,
+	 * the time span of a fixed number of samples gets sent.
+	 */
+	if (devc->unthrottled)
+		elapsed_us = devc->spent_us + UNTHROTTLED_SAMPLES
+			* G_USEC_PER_SEC / devc->cur_samplerate;
+	else
+		elapsed_us = g_get_monotonic_time() - devc->start_us;
 	limit_us = 1000 * devc->limit_msec;
 	if (limit_us > 0 && limit_us < elapsed_us)
 		todo_us = MAX(0, limit_us - devc->spent_us);
@@ -637,6 +852,17 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	 */
 	todo_us = samples_todo * G_USEC_PER_SEC / devc->cur_samplerate;
 
+	/* Timestamp the data which is about to get generated. */
+	if (devc->latency_probe_msec) {
+		now_us = g_get_monotonic_time();
+		if (now_us >= devc->next_probe_us) {
+			sr_session_send_meta(sdi, SR_CONF_LATENCY_PROBE,
+				g_variant_new_uint64(now_us));
+			devc->next_probe_us = now_us
+				+ 1000 * devc->latency_probe_msec;
+		}
+	}
+
 	logic_done = devc->num_logic_channels > 0 ? 0 : samples_todo;
 	if (!devc->enabled_logic_channels)
 		logic_done = samples_todo;
@@ -645,16 +871,35 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 	if (!devc->enabled_analog_channels)
 		analog_done = samples_todo;
 
+	/* Samples the analog trigger may send, pre-trigger ones included. */
+	analog_waiting = devc->sta && !devc->trigger_fired;
+	room = UINT64_MAX;
+	if (devc->limit_samples)
+		room = devc->limit_samples - devc->sent_samples;
+	if (devc->limit_frames)
+		room = MIN(room, SAMPLES_PER_FRAME - devc->sent_frame_samples);
+	sent = 0;
+
 	while (logic_done < samples_todo || analog_done < samples_todo) {
 		/* Logic */
-		if (logic_done < samples_todo) {
+		if (logic_done < samples_todo && devc->logic_page) {
+			sending_now = MIN(samples_todo - logic_done,
+					LOGIC_PAGE_CHUNK / devc->logic_unitsize);
+			data = devc->logic_page
+				+ devc->logic_page_pos * devc->logic_unitsize;
+			devc->logic_page_pos += sending_now;
+			devc->logic_page_pos %= devc->logic_page_period;
+		} else if (logic_done < samples_todo) {
 			sending_now = MIN(samples_todo - logic_done,
-					LOGIC_BUFSIZE / devc->logic_unitsize);
-			logic_generator(sdi, sending_now * devc->logic_unitsize);
+					devc->logic_bufsize / devc->logic_unitsize);
+			data = devc->logic_data;
+			logic_generator(devc, data, sending_now * devc->logic_unitsize);
+		}
+		if (logic_done < samples_todo) {
 			/* Check for trigger and send pre-trigger data if needed */
 			if (devc->stl && (!devc->trigger_fired)) {
 				trigger_offset = soft_trigger_logic_check(devc->stl,
-						devc->logic_data, sending_now * devc->logic_unitsize,
+						data, sending_now * devc->logic_unitsize,
 						&pre_trigger_samples);
 				if (trigger_offset > -1) {
 					devc->trigger_fired = TRUE;
@@ -672,8 +917,9 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 				if (devc->trigger_fired && (trigger_offset < (int)sending_now)) {
 					/* Send after-trigger data */
 					logic.length = (sending_now - trigger_offset) * devc->logic_unitsize;
-					logic.data = devc->logic_data + trigger_offset * devc->logic_unitsize;
-					logic_fixup_feed(devc, &logic);
+					logic.data = data + trigger_offset * devc->logic_unitsize;
+					if (!devc->logic_page)
+						logic_fixup_feed(devc, &logic);
 					sr_session_send(sdi, &packet);
 					logic_done += sending_now - trigger_offset;
 					/* End acquisition */
@@ -687,30 +933,40 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 			} else if (!devc->stl) {
 				/* No trigger defined, send logic samples */
 				logic.length = sending_now * devc->logic_unitsize;
-				logic.data = devc->logic_data;
-				logic_fixup_feed(devc, &logic);
+				logic.data = data;
+				if (!devc->logic_page)
+					logic_fixup_feed(devc, &logic);
 				sr_session_send(sdi, &packet);
 				logic_done += sending_now;
 			}
 		}
 
-		/* Analog, one channel at a time */
-		if (analog_done < samples_todo) {
+		/* Analog, all channels at once until the trigger fires. */
+		if (analog_done < samples_todo && analog_waiting) {
+			analog_done += analog_trigger_check(sdi,
+				devc->analog_pos + analog_done,
+				samples_todo - analog_done, room, &sent);
+			if (devc->trigger_fired)
+				break;
+		} else if (analog_done < samples_todo) {
+			/* One channel at a time */
 			analog_sent = 0;
 
-			g_hash_table_iter_init(&iter, devc->ch_ag);
-			while (g_hash_table_iter_next(&iter, NULL, &value)) {
-				send_analog_packet(value, sdi, &analog_sent,
-						devc->sent_samples + analog_done,
+			for (i = 0; i < devc->analog_gens->len; i++) {
+				send_analog_packet(devc->analog_gens->pdata[i],
+						sdi, &analog_sent,
+						devc->analog_pos + analog_done,
 						samples_todo - analog_done);
 			}
 			analog_done += analog_sent;
 		}
 	}
 
-	uint64_t min = MIN(logic_done, analog_done);
-	devc->sent_samples += min;
-	devc->sent_frame_samples += min;
+	if (!analog_waiting)
+		sent = MIN(logic_done, analog_done);
+	devc->analog_pos += analog_done;
+	devc->sent_samples += sent;
+	devc->sent_frame_samples += sent;
 	devc->spent_us += todo_us;
 
 	if (devc->limit_frames && devc->sent_frame_samples >= SAMPLES_PER_FRAME) {
@@ -720,6 +976,10 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 		if (!devc->limit_frames) {
 			sr_dbg("Requested number of frames reached.");
 			sr_dev_acquisition_stop(sdi);
+		} else if (devc->sta) {
+			/* The next frame begins with the next trigger. */
+			devc->trigger_fired = FALSE;
+			soft_trigger_analog_rearm(devc->sta);
 		}
 	}
 
@@ -728,9 +988,8 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 
 		/* If we're averaging everything - now is the time to send data */
 		if (devc->avg && devc->avg_samples == 0) {
-			g_hash_table_iter_init(&iter, devc->ch_ag);
-			while (g_hash_table_iter_next(&iter, NULL, &value)) {
-				ag = value;
+			for (i = 0; i < devc->analog_gens->len; i++) {
+				ag = devc->analog_gens->pdata[i];
 				packet.type = SR_DF_ANALOG;
 				packet.payload = &ag->packet;
 				ag->packet.data = &ag->avg_val;
@@ -740,10 +999,28 @@ SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
 		}
 		sr_dbg("Requested number of samples reached.");
 		sr_dev_acquisition_stop(sdi);
-	} else if (devc->limit_frames) {
+	} else if (devc->limit_frames && !devc->sta) {
 		if (devc->sent_frame_samples == 0)
 			std_session_send_df_frame_begin(sdi);
 	}
 
 	return G_SOURCE_CONTINUE;
 }
+
+SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	int64_t start_us;
+	int ret;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+
+	start_us = g_get_monotonic_time();
+	ret = prepare_data(fd, revents, cb_data);
+	devc->stats_cb_us += g_get_monotonic_time() - start_us;
+	devc->stats_cb_count++;
+
+	return ret;
+}
@@ -32,11 +32,21 @@
 
 /* The size in bytes of chunks to send through the session bus. */
 #define LOGIC_BUFSIZE			4096
+/* Fewest samples per chunk, for wide logic buses. */
+#define LOGIC_MIN_SAMPLES		256
+/* The size in bytes of chunks to send from a precomputed logic page. */
+#define LOGIC_PAGE_CHUNK		(64 * 1024)
+/* Longest logic pattern period to precompute, in samples. */
+#define LOGIC_PAGE_MAX_PERIOD		65536
+/* Number of samples per round when generating without pacing. */
+#define UNTHROTTLED_SAMPLES		(1024 * 1024)
 /* Size of the analog pattern space per channel. */
 #define ANALOG_BUFSIZE			4096
 /* This is a development feature: it starts a new frame every n samples. */
 #define SAMPLES_PER_FRAME		1000UL
 #define DEFAULT_LIMIT_FRAMES		0
+/* Number of devices which a scan creates. */
+#define DEFAULT_NUM_DEVICES		1
 
 #define DEFAULT_ANALOG_ENCODING_DIGITS	4
 #define DEFAULT_ANALOG_SPEC_DIGITS		4
@@ -118,6 +128,7 @@ struct dev_context {
 	uint64_t limit_frames;
 	uint64_t sent_samples;
 	uint64_t sent_frame_samples; /* Number of samples that were sent for current frame. */
+	uint64_t analog_pos; /* Position of the analog generators. */
 	int64_t start_us;
 	int64_t spent_us;
 	uint64_t step;
@@ -127,11 +138,20 @@ struct dev_context {
 	uint64_t all_logic_channels_mask;
 	/* There is only ever one logic channel group, so its pattern goes here. */
 	enum logic_pattern_type logic_pattern;
-	uint8_t logic_data[LOGIC_BUFSIZE];
+	/* LOGIC_BUFSIZE bytes, or LOGIC_MIN_SAMPLES for wide buses. */
+	uint8_t *logic_data;
+	size_t logic_bufsize;
+	/* Precomputed data of periodic patterns, see demo_prepare_logic_page(). */
+	uint8_t *logic_page;
+	uint64_t logic_page_period;
+	uint64_t logic_page_pos;
 	/* Analog */
-	struct analog_pattern *analog_patterns[ARRAY_SIZE(analog_pattern_str)];
+	/* Shared by all devices, see demo_generate_analog_pattern(). */
+	const struct analog_pattern *analog_patterns[ARRAY_SIZE(analog_pattern_str)];
 	int32_t num_analog_channels;
 	GHashTable *ch_ag;
+	/* The generators of ch_ag, in the order of their channels. */
+	GPtrArray *analog_gens;
 	gboolean avg; /* True if averaging is enabled */
 	uint64_t avg_samples;
 	size_t enabled_logic_channels;
@@ -142,6 +162,19 @@ struct dev_context {
 	uint64_t capture_ratio;
 	gboolean trigger_fired;
 	struct soft_trigger_logic *stl;
+	struct soft_trigger_analog *sta;
+	float trigger_hysteresis;
+	/* Packets of all enabled analog channels, for the analog trigger. */
+	struct sr_datafeed_analog *trigger_packets;
+	/* Generate as fast as possible, instead of at the samplerate. */
+	gboolean unthrottled;
+	/* Interval between latency probes, and time of the next one. */
+	uint64_t latency_probe_msec;
+	int64_t next_probe_us;
+	/* Statistics of the current acquisition. */
+	int64_t stats_start_us;
+	int64_t stats_cb_us;
+	uint64_t stats_cb_count;
 };
 
 struct analog_gen {
@@ -156,12 +189,17 @@ struct analog_gen {
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
+	/* Samples with amplitude and offset applied, allocated on demand. */
+	float *data;
 	float avg_val; /* Average value */
 	unsigned int num_avgs; /* Number of samples averaged */
 };
 
+SR_PRIV enum sr_unit demo_mq_unit(enum sr_mq mq);
 SR_PRIV void demo_generate_analog_pattern(struct dev_context *devc);
 SR_PRIV void demo_free_analog_pattern(struct dev_context *devc);
+SR_PRIV void demo_prepare_logic_page(struct dev_context *devc);
+SR_PRIV void demo_free_logic_page(struct dev_context *devc);
 SR_PRIV int demo_prepare_data(int fd, int revents, void *cb_data);
 
 #endif
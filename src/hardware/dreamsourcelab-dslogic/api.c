@@ -156,7 +156,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	/* Find all DSLogic compatible devices and upload firmware to them. */
 	devices = NULL;
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -216,7 +216,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 		libusb_close(hdl);
 
-		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+		if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 			continue;
 
 		prof = NULL;
@@ -257,7 +257,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 		devc->samplerates = samplerates;
 		devc->num_samplerates = ARRAY_SIZE(samplerates);
-		has_firmware = usb_match_manuf_prod(devlist[i], "DreamSourceLab", "USB-based Instrument");
+		has_firmware = usb_match_manuf_prod(drvc->sr_ctx, devlist[i], "DreamSourceLab", "USB-based Instrument");
 
 		if (has_firmware) {
 			/* Already has the firmware, so fix the new address. */
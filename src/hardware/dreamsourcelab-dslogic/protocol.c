@@ -21,6 +21,7 @@
 #include <config.h>
 #include <math.h>
 #include <stdbool.h>
+#include <string.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 #include "protocol.h"
@@ -138,6 +139,8 @@ struct fpga_config {
  */
 #define FW_BUFSIZE (1024 * 1024)
 
+#define FW_MAX_SIZE (16 * 1024 * 1024)
+
 #define FPGA_UPLOAD_DELAY (10 * 1000)
 
 #define USB_TIMEOUT (3 * 1000)
@@ -223,14 +226,11 @@ static int command_stop_acquisition(const struct sr_dev_inst *sdi)
 SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 {
 	const char *name = NULL;
-	uint64_t sum;
-	struct sr_resource bitstream;
+	GBytes *bitstream;
 	struct drv_context *drvc;
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	unsigned char *buf;
-	ssize_t chunksize;
-	int transferred;
+	libusb_device *dev;
 	int result, ret;
 	const uint8_t cmd[3] = {0, 0, 0};
 
@@ -256,58 +256,43 @@ SR_PRIV int dslogic_fpga_firmware_upload(const struct sr_dev_inst *sdi)
 		return SR_ERR;
 	}
 
+	dev = libusb_get_device(usb->devhdl);
+	if (usb_fpga_loaded(drvc->sr_ctx, dev, name)) {
+		sr_dbg("FPGA firmware '%s' is loaded already.", name);
+		return SR_OK;
+	}
+
 	sr_dbg("Uploading FPGA firmware '%s'.", name);
 
-	result = sr_resource_open(drvc->sr_ctx, &bitstream,
-			SR_RESOURCE_FIRMWARE, name);
-	if (result != SR_OK)
-		return result;
+	bitstream = sr_resource_load_cached(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
+			name, FW_MAX_SIZE);
+	if (!bitstream)
+		return SR_ERR;
 
 	/* Tell the device firmware is coming. */
+	usb_fpga_loaded_set(drvc->sr_ctx, dev, NULL);
 	if ((ret = libusb_control_transfer(usb->devhdl, LIBUSB_REQUEST_TYPE_VENDOR |
 			LIBUSB_ENDPOINT_OUT, DS_CMD_CONFIG, 0x0000, 0x0000,
 			(unsigned char *)&cmd, sizeof(cmd), USB_TIMEOUT)) < 0) {
 		sr_err("Failed to upload FPGA firmware: %s.", libusb_error_name(ret));
-		sr_resource_close(drvc->sr_ctx, &bitstream);
+		g_bytes_unref(bitstream);
 		return SR_ERR;
 	}
 
 	/* Give the FX2 time to get ready for FPGA firmware upload. */
 	g_usleep(FPGA_UPLOAD_DELAY);
 
-	buf = g_malloc(FW_BUFSIZE);
-	sum = 0;
-	result = SR_OK;
-	while (1) {
-		chunksize = sr_resource_read(drvc->sr_ctx, &bitstream,
-				buf, FW_BUFSIZE);
-		if (chunksize < 0)
-			result = SR_ERR;
-		if (chunksize <= 0)
-			break;
-
-		if ((ret = libusb_bulk_transfer(usb->devhdl, 2 | LIBUSB_ENDPOINT_OUT,
-				buf, chunksize, &transferred, USB_TIMEOUT)) < 0) {
-			sr_err("Unable to configure FPGA firmware: %s.",
-					libusb_error_name(ret));
-			result = SR_ERR;
-			break;
-		}
-		sum += transferred;
-		sr_spew("Uploaded %" PRIu64 "/%" PRIu64 " bytes.",
-			sum, bitstream.size);
-
-		if (transferred != chunksize) {
-			sr_err("Short transfer while uploading FPGA firmware.");
-			result = SR_ERR;
-			break;
-		}
-	}
-	g_free(buf);
-	sr_resource_close(drvc->sr_ctx, &bitstream);
+	result = usb_bulk_upload(drvc->sr_ctx, usb, 2 | LIBUSB_ENDPOINT_OUT,
+			g_bytes_get_data(bitstream, NULL),
+			g_bytes_get_size(bitstream), FW_BUFSIZE, USB_TIMEOUT);
+	g_bytes_unref(bitstream);
 
-	if (result == SR_OK)
+	if (result == SR_OK) {
+		usb_fpga_loaded_set(drvc->sr_ctx, dev, name);
 		sr_dbg("FPGA firmware upload done.");
+	} else {
+		sr_err("Unable to configure FPGA firmware.");
+	}
 
 	return result;
 }
@@ -551,7 +536,7 @@ SR_PRIV int dslogic_dev_open(struct sr_dev_inst *sdi, struct sr_dev_driver *di)
 	devc = sdi->priv;
 	usb = sdi->conn;
 
-	device_count = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	device_count = usb_get_device_list(drvc->sr_ctx, &devlist);
 	if (device_count < 0) {
 		sr_err("Failed to get device list: %s.",
 		       libusb_error_name(device_count));
@@ -568,7 +553,7 @@ SR_PRIV int dslogic_dev_open(struct sr_dev_inst *sdi, struct sr_dev_driver *di)
 		if ((sdi->status == SR_ST_INITIALIZING) ||
 				(sdi->status == SR_ST_INACTIVE)) {
 			/* Check device by its physical USB bus/port address. */
-			if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+			if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 				continue;
 
 			if (strcmp(sdi->connection_id, connection_id))
@@ -656,6 +641,7 @@ SR_PRIV struct dev_context *dslogic_dev_new(void)
 	devc->capture_ratio = 0;
 	devc->continuous_mode = FALSE;
 	devc->clock_edge = DS_EDGE_RISING;
+	usb_stream_init(&devc->stream, 10, 100, NUM_SIMUL_TRANSFERS);
 
 	return devc;
 }
@@ -696,7 +682,7 @@ static void free_transfer(struct libusb_transfer *transfer)
 	sdi = transfer->user_data;
 	devc = sdi->priv;
 
-	g_free(transfer->buffer);
+	usb_transfer_buf_free(transfer->buffer);
 	transfer->buffer = NULL;
 	libusb_free_transfer(transfer);
 
@@ -716,6 +702,7 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 {
 	int ret;
 
+	sr_trace2(usb_transfer_submit, transfer->user_data, transfer->length);
 	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
 		return;
 
@@ -724,28 +711,39 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 
 }
 
-static void deinterleave_buffer(const uint8_t *src, size_t length,
+SR_PRIV void dslogic_deinterleave_buffer(const uint8_t *src, size_t length,
 	uint16_t *dst_ptr, size_t channel_count, uint16_t channel_mask)
 {
-	uint16_t sample;
-
-	for (const uint64_t *src_ptr = (uint64_t*)src;
-		src_ptr < (uint64_t*)(src + length);
-		src_ptr += channel_count) {
-		for (int bit = 0; bit != 64; bit++) {
-			const uint64_t *word_ptr = src_ptr;
-			sample = 0;
-			for (unsigned int channel = 0; channel != 16;
-				channel++) {
-				const uint16_t m = channel_mask >> channel;
-				if (!m)
-					break;
-				if ((m & 1) && ((*word_ptr++ >> bit) & UINT64_C(1)))
-					sample |= 1 << channel;
-			}
-			*dst_ptr++ = sample;
+	uint16_t map_lo[256], map_hi[256];
+	size_t num_samples, i;
+	unsigned int channel, k, v;
+
+	/*
+	 * The device only sends the enabled channels. Transpose them to
+	 * packed samples, the k-th enabled channel ends up in bit k.
+	 */
+	num_samples = 64 * (length / (channel_count * sizeof(uint64_t)));
+	sr_bits_transpose_u16((const uint64_t *)src,
+		num_samples / 64, channel_count, dst_ptr);
+	if (channel_mask == (1U << channel_count) - 1)
+		return;
+
+	/* Move the packed bits to their channels' positions. */
+	memset(map_lo, 0, sizeof(map_lo));
+	memset(map_hi, 0, sizeof(map_hi));
+	for (channel = 0, k = 0; channel < 16; channel++) {
+		if (!(channel_mask & (1U << channel)))
+			continue;
+		for (v = 0; v < 256; v++) {
+			if (k < 8 && (v & (1U << k)))
+				map_lo[v] |= 1U << channel;
+			if (k >= 8 && (v & (1U << (k - 8))))
+				map_hi[v] |= 1U << channel;
 		}
+		k++;
 	}
+	for (i = 0; i < num_samples; i++)
+		dst_ptr[i] = map_lo[dst_ptr[i] & 0xff] | map_hi[dst_ptr[i] >> 8];
 }
 
 static void send_data(struct sr_dev_inst *sdi,
@@ -779,6 +777,10 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 	unsigned int num_samples;
 	int trigger_offset;
 
+	sr_trace3(usb_transfer_done, sdi, transfer->status,
+		transfer->actual_length);
+	sr_session_receive_time_set(sdi, g_get_monotonic_time());
+
 	/*
 	 * If acquisition has already ended, just free any queued up
 	 * transfer that come in.
@@ -810,9 +812,12 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		devc->empty_transfer_count++;
 		if (devc->empty_transfer_count > MAX_EMPTY_TRANSFERS) {
 			/*
-			 * The FX2 gave up. End the acquisition, the frontend
-			 * will work out that the samplecount is short.
+			 * The FX2 gave up. Report the missing samples and end
+			 * the acquisition.
 			 */
+			sr_session_samples_lost(sdi, devc->sent_samples,
+				devc->limit_samples > devc->sent_samples ?
+				devc->limit_samples - devc->sent_samples : 0);
 			abort_acquisition(devc);
 			free_transfer(transfer);
 		} else {
@@ -842,7 +847,7 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		 */
 		if (transfer->actual_length % (DSLOGIC_ATOMIC_BYTES * channel_count) != 0)
 			sr_err("Invalid transfer length!");
-		deinterleave_buffer(transfer->buffer, transfer->actual_length,
+		dslogic_deinterleave_buffer(transfer->buffer, transfer->actual_length,
 			devc->deinterleave_buffer, channel_count, channel_mask);
 
 		/* Send the incoming transfer to the session bus. */
@@ -905,52 +910,25 @@ static size_t to_bytes_per_ms(const struct sr_dev_inst *sdi)
 	return 35000000 / (1000 * 10);
 }
 
-static size_t get_buffer_size(const struct sr_dev_inst *sdi)
-{
-	/*
-	 * The buffer should be large enough to hold 10ms of data and
-	 * a multiple of the size of a data atom.
-	 */
-	const size_t block_size = enabled_channel_count(sdi) * 512;
-	const size_t s = 10 * to_bytes_per_ms(sdi);
-	if (!block_size)
-		return s;
-	return ((s + block_size - 1) / block_size) * block_size;
-}
-
-static unsigned int get_number_of_transfers(const struct sr_dev_inst *sdi)
-{
-	/* Total buffer size should be able to hold about 100ms of data. */
-	const unsigned int s = get_buffer_size(sdi);
-	const unsigned int n = (100 * to_bytes_per_ms(sdi) + s - 1) / s;
-	return (n > NUM_SIMUL_TRANSFERS) ? NUM_SIMUL_TRANSFERS : n;
-}
-
-static unsigned int get_timeout(const struct sr_dev_inst *sdi)
-{
-	const size_t total_size = get_buffer_size(sdi) *
-		get_number_of_transfers(sdi);
-	const unsigned int timeout = total_size / to_bytes_per_ms(sdi);
-	return timeout + timeout / 4; /* Leave a headroom of 25% percent. */
-}
-
 static int start_transfers(const struct sr_dev_inst *sdi)
 {
 	const size_t channel_count = enabled_channel_count(sdi);
-	const size_t size = get_buffer_size(sdi);
-	const unsigned int num_transfers = get_number_of_transfers(sdi);
-	const unsigned int timeout = get_timeout(sdi);
 
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
 	struct libusb_transfer *transfer;
-	unsigned int i;
+	unsigned int i, num_transfers, timeout;
 	int ret;
 	unsigned char *buf;
+	size_t size;
 
 	devc = sdi->priv;
 	usb = sdi->conn;
 
+	size = devc->stream.alloc_size;
+	num_transfers = devc->stream.num_transfers;
+	timeout = usb_stream_timeout(&devc->stream);
+
 	devc->sent_samples = 0;
 	devc->acq_aborted = FALSE;
 	devc->empty_transfer_count = 0;
@@ -973,7 +951,7 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 
 	devc->num_transfers = num_transfers;
 	for (i = 0; i < num_transfers; i++) {
-		if (!(buf = g_try_malloc(size))) {
+		if (!(buf = usb_transfer_buf_alloc(usb->devhdl, size))) {
 			sr_err("USB transfer buffer malloc failed.");
 			return SR_ERR_MALLOC;
 		}
@@ -986,7 +964,7 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 			sr_err("Failed to submit transfer: %s.",
 			       libusb_error_name(ret));
 			libusb_free_transfer(transfer);
-			g_free(buf);
+			usb_transfer_buf_free(buf);
 			abort_acquisition(devc);
 			return SR_ERR;
 		}
@@ -1028,8 +1006,6 @@ static void LIBUSB_CALL trigger_receive(struct libusb_transfer *transfer)
 
 SR_PRIV int dslogic_acquisition_start(const struct sr_dev_inst *sdi)
 {
-	const unsigned int timeout = get_timeout(sdi);
-
 	struct sr_dev_driver *di;
 	struct drv_context *drvc;
 	struct dev_context *devc;
@@ -1048,7 +1024,14 @@ SR_PRIV int dslogic_acquisition_start(const struct sr_dev_inst *sdi)
 	devc->empty_transfer_count = 0;
 	devc->acq_aborted = FALSE;
 
-	usb_source_add(sdi->session, devc->ctx, timeout, receive_data, drvc);
+	/*
+	 * Transfers hold about 10ms of data and a multiple of the size
+	 * of a data atom, all of them together about 100ms.
+	 */
+	usb_stream_start(&devc->stream, to_bytes_per_ms(sdi),
+		enabled_channel_count(sdi) * 512);
+	usb_source_add(sdi->session, devc->ctx,
+		usb_stream_timeout(&devc->stream), receive_data, drvc);
 
 	if ((ret = command_stop_acquisition(sdi)) != SR_OK)
 		return ret;
@@ -128,6 +128,7 @@ struct dev_context {
 	int submitted_transfers;
 	int empty_transfer_count;
 
+	struct usb_stream stream;
 	unsigned int num_transfers;
 	struct libusb_transfer **transfers;
 	struct sr_context *ctx;
@@ -148,5 +149,7 @@ SR_PRIV int dslogic_dev_open(struct sr_dev_inst *sdi, struct sr_dev_driver *di);
 SR_PRIV struct dev_context *dslogic_dev_new(void);
 SR_PRIV int dslogic_acquisition_start(const struct sr_dev_inst *sdi);
 SR_PRIV int dslogic_acquisition_stop(struct sr_dev_inst *sdi);
+SR_PRIV void dslogic_deinterleave_buffer(const uint8_t *src, size_t length,
+	uint16_t *dst_ptr, size_t channel_count, uint16_t channel_mask);
 
 #endif
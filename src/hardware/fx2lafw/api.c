@@ -131,6 +131,9 @@ static const uint32_t devopts[] = {
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_TRIGGER_HYSTERESIS | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_TRANSFER_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_BUFFER_MSEC | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const int32_t trigger_matches[] = {
@@ -139,6 +142,8 @@ static const int32_t trigger_matches[] = {
 	SR_TRIGGER_RISING,
 	SR_TRIGGER_FALLING,
 	SR_TRIGGER_EDGE,
+	SR_TRIGGER_OVER,
+	SR_TRIGGER_UNDER,
 };
 
 static const uint64_t samplerates[] = {
@@ -189,11 +194,11 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	gboolean has_firmware;
 	struct libusb_device_descriptor des;
 	libusb_device **devlist;
-	struct libusb_device_handle *hdl;
-	int ret, i, j;
+	struct usb_dev_strings strings;
+	int i, j;
 	int num_logic_channels = 0, num_analog_channels = 0;
 	const char *conn;
-	char manufacturer[64], product[64], serial_num[64], connection_id[64];
+	char connection_id[64];
 	char channel_name[16];
 
 	drvc = di->context;
@@ -214,7 +219,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	/* Find all fx2lafw compatible devices and upload firmware to them. */
 	devices = NULL;
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -235,46 +240,14 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		if (!is_plausible(&des))
 			continue;
 
-		if ((ret = libusb_open(devlist[i], &hdl)) < 0) {
-			sr_warn("Failed to open potential device with "
-				"VID:PID %04x:%04x: %s.", des.idVendor,
-				des.idProduct, libusb_error_name(ret));
+		if (usb_get_strings(drvc->sr_ctx, devlist[i], &strings) != SR_OK) {
+			sr_warn("Failed to get string descriptors of potential "
+				"device with VID:PID %04x:%04x.", des.idVendor,
+				des.idProduct);
 			continue;
 		}
 
-		if (des.iManufacturer == 0) {
-			manufacturer[0] = '\0';
-		} else if ((ret = libusb_get_string_descriptor_ascii(hdl,
-				des.iManufacturer, (unsigned char *) manufacturer,
-				sizeof(manufacturer))) < 0) {
-			sr_warn("Failed to get manufacturer string descriptor: %s.",
-				libusb_error_name(ret));
-			continue;
-		}
-
-		if (des.iProduct == 0) {
-			product[0] = '\0';
-		} else if ((ret = libusb_get_string_descriptor_ascii(hdl,
-				des.iProduct, (unsigned char *) product,
-				sizeof(product))) < 0) {
-			sr_warn("Failed to get product string descriptor: %s.",
-				libusb_error_name(ret));
-			continue;
-		}
-
-		if (des.iSerialNumber == 0) {
-			serial_num[0] = '\0';
-		} else if ((ret = libusb_get_string_descriptor_ascii(hdl,
-				des.iSerialNumber, (unsigned char *) serial_num,
-				sizeof(serial_num))) < 0) {
-			sr_warn("Failed to get serial number string descriptor: %s.",
-				libusb_error_name(ret));
-			continue;
-		}
-
-		libusb_close(hdl);
-
-		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+		if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 			continue;
 
 		prof = NULL;
@@ -282,9 +255,9 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 			if (des.idVendor == supported_fx2[j].vid &&
 					des.idProduct == supported_fx2[j].pid &&
 					(!supported_fx2[j].usb_manufacturer ||
-					 !strcmp(manufacturer, supported_fx2[j].usb_manufacturer)) &&
+					 !strcmp(strings.manufacturer, supported_fx2[j].usb_manufacturer)) &&
 					(!supported_fx2[j].usb_product ||
-					 !strcmp(product, supported_fx2[j].usb_product))) {
+					 !strcmp(strings.product, supported_fx2[j].usb_product))) {
 				prof = &supported_fx2[j];
 				break;
 			}
@@ -298,7 +271,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		sdi->vendor = g_strdup(prof->vendor);
 		sdi->model = g_strdup(prof->model);
 		sdi->version = g_strdup(prof->model_version);
-		sdi->serial_num = g_strdup(serial_num);
+		sdi->serial_num = g_strdup(strings.serial_num);
 		sdi->connection_id = g_strdup(connection_id);
 
 		/* Fill in channellist according to this device's profile. */
@@ -335,7 +308,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 		devc->samplerates = samplerates;
 		devc->num_samplerates = ARRAY_SIZE(samplerates);
-		has_firmware = usb_match_manuf_prod(devlist[i],
+		has_firmware = usb_match_manuf_prod(drvc->sr_ctx, devlist[i],
 				"sigrok", "fx2lafw");
 
 		if (has_firmware) {
@@ -461,6 +434,7 @@ static int dev_close(struct sr_dev_inst *sdi)
 
 	sr_info("Closing device on %d.%d (logical) / %s (physical) interface %d.",
 		usb->bus, usb->address, sdi->connection_id, USB_INTERFACE);
+	fx2lafw_free_acquisition(sdi->priv);
 	libusb_release_interface(usb->devhdl, USB_INTERFACE);
 	libusb_close(usb->devhdl);
 	usb->devhdl = NULL;
@@ -504,6 +478,12 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_RATIO:
 		*data = g_variant_new_uint64(devc->capture_ratio);
 		break;
+	case SR_CONF_TRIGGER_HYSTERESIS:
+		*data = g_variant_new_double(devc->trigger_hysteresis);
+		break;
+	case SR_CONF_USB_TRANSFER_MSEC:
+	case SR_CONF_USB_BUFFER_MSEC:
+		return usb_stream_config_get(&devc->stream, key, data);
 	default:
 		return SR_ERR_NA;
 	}
@@ -539,6 +519,12 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_CAPTURE_RATIO:
 		devc->capture_ratio = g_variant_get_uint64(data);
 		break;
+	case SR_CONF_TRIGGER_HYSTERESIS:
+		devc->trigger_hysteresis = g_variant_get_double(data);
+		break;
+	case SR_CONF_USB_TRANSFER_MSEC:
+	case SR_CONF_USB_BUFFER_MSEC:
+		return usb_stream_config_set(&devc->stream, key, data);
 	default:
 		return SR_ERR_NA;
 	}
@@ -597,6 +583,7 @@ static struct sr_dev_driver fx2lafw_driver_info = {
 	.dev_close = dev_close,
 	.dev_acquisition_start = fx2lafw_start_acquisition,
 	.dev_acquisition_stop = dev_acquisition_stop,
+	.dev_acquisition_rearm = fx2lafw_rearm_acquisition,
 	.context = NULL,
 };
 SR_REGISTER_DEV_DRIVER(fx2lafw_driver_info);
@@ -155,7 +155,7 @@ SR_PRIV int fx2lafw_dev_open(struct sr_dev_inst *sdi, struct sr_dev_driver *di)
 	devc = sdi->priv;
 	usb = sdi->conn;
 
-	device_count = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	device_count = usb_get_device_list(drvc->sr_ctx, &devlist);
 	if (device_count < 0) {
 		sr_err("Failed to get device list: %s.",
 		       libusb_error_name(device_count));
@@ -174,7 +174,7 @@ SR_PRIV int fx2lafw_dev_open(struct sr_dev_inst *sdi, struct sr_dev_driver *di)
 			/*
 			 * Check device by its physical USB bus/port address.
 			 */
-			if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+			if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 				continue;
 
 			if (strcmp(sdi->connection_id, connection_id))
@@ -263,6 +263,8 @@ SR_PRIV struct dev_context *fx2lafw_dev_new(void)
 	devc->sample_wide = FALSE;
 	devc->num_frames = 0;
 	devc->stl = NULL;
+	devc->sta = NULL;
+	usb_stream_init(&devc->stream, 10, 500, NUM_SIMUL_TRANSFERS);
 
 	return devc;
 }
@@ -288,42 +290,55 @@ static void finish_acquisition(struct sr_dev_inst *sdi)
 	std_session_send_df_end(sdi);
 
 	usb_source_remove(sdi->session, devc->ctx);
+	usb_stream_stop(&devc->stream);
 
-	devc->num_transfers = 0;
-	g_free(devc->transfers);
+	/*
+	 * The transfers, the deinterlace buffers and the trigger are kept
+	 * for a re-arm, see fx2lafw_free_acquisition().
+	 */
+}
 
-	/* Free the deinterlace buffers if we had them. */
-	if (g_slist_length(devc->enabled_analog_channels) > 0) {
-		g_free(devc->logic_buffer);
-		g_free(devc->analog_buffer);
+/*
+ * Free the transfers, buffers and the trigger which the last acquisition
+ * left for a re-arm.
+ */
+SR_PRIV void fx2lafw_free_acquisition(struct dev_context *devc)
+{
+	unsigned int i;
+
+	for (i = 0; i < devc->num_transfers; i++) {
+		if (!devc->transfers[i])
+			continue;
+		usb_transfer_buf_free(devc->transfers[i]->buffer);
+		libusb_free_transfer(devc->transfers[i]);
 	}
+	g_free(devc->transfers);
+	devc->transfers = NULL;
+	devc->num_transfers = 0;
+	devc->transfer_size = 0;
+
+	g_free(devc->logic_buffer);
+	g_free(devc->analog_buffer);
+	devc->logic_buffer = NULL;
+	devc->analog_buffer = NULL;
 
 	if (devc->stl) {
 		soft_trigger_logic_free(devc->stl);
 		devc->stl = NULL;
 	}
+	soft_trigger_analog_free(devc->sta);
+	devc->sta = NULL;
 }
 
-static void free_transfer(struct libusb_transfer *transfer)
+/* The transfer is back from the device, and stays idle in the pool. */
+static void release_transfer(struct libusb_transfer *transfer)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	unsigned int i;
 
 	sdi = transfer->user_data;
 	devc = sdi->priv;
 
-	g_free(transfer->buffer);
-	transfer->buffer = NULL;
-	libusb_free_transfer(transfer);
-
-	for (i = 0; i < devc->num_transfers; i++) {
-		if (devc->transfers[i] == transfer) {
-			devc->transfers[i] = NULL;
-			break;
-		}
-	}
-
 	devc->submitted_transfers--;
 	if (devc->submitted_transfers == 0)
 		finish_acquisition(sdi);
@@ -333,64 +348,136 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 {
 	int ret;
 
+	sr_trace2(usb_transfer_submit, transfer->user_data, transfer->length);
 	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
 		return;
 
 	sr_err("%s: %s", __func__, libusb_error_name(ret));
-	free_transfer(transfer);
+	release_transfer(transfer);
 
 }
 
-static void mso_send_data_proc(struct sr_dev_inst *sdi,
-	uint8_t *data, size_t length, size_t sample_width)
+/*
+ * Split interleaved logic and analog bytes into a logic and an analog
+ * payload, this vectorizes. The analog payload carries the ADC codes
+ * as they are. The scale and offset rescale to -10V - +10V from 0-255,
+ * i.e. (code - 128) / 12.8.
+ */
+static void mso_split(struct dev_context *devc, const uint8_t *data,
+	size_t length, uint8_t *logic_buffer, uint8_t *analog_buffer,
+	struct sr_datafeed_logic *logic, struct sr_datafeed_analog *analog,
+	struct sr_analog_encoding *encoding, struct sr_analog_meaning *meaning,
+	struct sr_analog_spec *spec)
 {
 	size_t i;
+
+	length /= 2;
+	for (i = 0; i < length; i++) {
+		logic_buffer[i] = data[i * 2];
+		analog_buffer[i] = data[i * 2 + 1];
+	}
+
+	logic->length = length;
+	logic->unitsize = 1;
+	logic->data = logic_buffer;
+
+	sr_analog_init(analog, encoding, meaning, spec, 2);
+	analog->meaning->channels = devc->enabled_analog_channels;
+	analog->meaning->mq = SR_MQ_VOLTAGE;
+	analog->meaning->unit = SR_UNIT_VOLT;
+	analog->meaning->mqflags = 0 /* SR_MQFLAG_DC */;
+	analog->num_samples = length;
+	analog->data = analog_buffer;
+	analog->encoding->unitsize = sizeof(analog_buffer[0]);
+	analog->encoding->is_signed = FALSE;
+	analog->encoding->is_float = FALSE;
+	analog->encoding->is_bigendian = FALSE;
+	sr_rational_set(&analog->encoding->scale, 5, 64);
+	sr_rational_set(&analog->encoding->offset, -10, 1);
+}
+
+/* Send a packet, handing its pool buffer over when there is one. */
+static void mso_send_packet(struct sr_dev_inst *sdi,
+	const struct sr_datafeed_packet *packet, void *buffer)
+{
+	struct sr_datafeed_packet *wrapped;
+
+	if (buffer && sr_packet_wrap(packet, sr_buffer_pool_release, buffer,
+			&wrapped) == SR_OK) {
+		sr_session_send(sdi, wrapped);
+		sr_packet_unref(wrapped);
+		return;
+	}
+	sr_session_send(sdi, packet);
+	sr_buffer_pool_release(buffer);
+}
+
+/*
+ * The split moves all samples anyway, so it goes to pool buffers which
+ * the packets own. Consumers then retain them without another copy.
+ * The fixed buffers of the acquisition are a fallback.
+ */
+SR_PRIV void fx2lafw_mso_send_data_proc(struct sr_dev_inst *sdi,
+	uint8_t *data, size_t length, size_t sample_width)
+{
 	struct dev_context *devc;
+	struct sr_datafeed_logic logic;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
+	uint8_t *logic_buffer, *analog_buffer;
 
 	(void)sample_width;
 
 	devc = sdi->priv;
 
-	length /= 2;
-
-	/* Send the logic */
-	for (i = 0; i < length; i++) {
-		devc->logic_buffer[i] = data[i * 2];
-		/* Rescale to -10V - +10V from 0-255. */
-		devc->analog_buffer[i] = (data[i * 2 + 1] - 128.0f) / 12.8f;
-	};
+	logic_buffer = sr_buffer_pool_alloc(NULL, length / 2);
+	analog_buffer = sr_buffer_pool_alloc(NULL, length / 2);
+	if (!logic_buffer || !analog_buffer) {
+		sr_buffer_pool_release(logic_buffer);
+		sr_buffer_pool_release(analog_buffer);
+		logic_buffer = analog_buffer = NULL;
+	}
 
-	const struct sr_datafeed_logic logic = {
-		.length = length,
-		.unitsize = 1,
-		.data = devc->logic_buffer
-	};
+	mso_split(devc, data, length,
+		logic_buffer ? logic_buffer : devc->logic_buffer,
+		analog_buffer ? analog_buffer : devc->analog_buffer,
+		&logic, &analog, &encoding, &meaning, &spec);
 
 	const struct sr_datafeed_packet logic_packet = {
 		.type = SR_DF_LOGIC,
 		.payload = &logic
 	};
 
-	sr_session_send(sdi, &logic_packet);
-
-	sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
-	analog.meaning->channels = devc->enabled_analog_channels;
-	analog.meaning->mq = SR_MQ_VOLTAGE;
-	analog.meaning->unit = SR_UNIT_VOLT;
-	analog.meaning->mqflags = 0 /* SR_MQFLAG_DC */;
-	analog.num_samples = length;
-	analog.data = devc->analog_buffer;
+	mso_send_packet(sdi, &logic_packet, logic_buffer);
 
 	const struct sr_datafeed_packet analog_packet = {
 		.type = SR_DF_ANALOG,
 		.payload = &analog
 	};
 
-	sr_session_send(sdi, &analog_packet);
+	mso_send_packet(sdi, &analog_packet, analog_buffer);
+}
+
+/*
+ * Check interleaved MSO data for the analog soft trigger. Returns the
+ * trigger's sample offset like soft_trigger_logic_check() does.
+ */
+static int mso_trigger_check(struct dev_context *devc, const uint8_t *data,
+	size_t length, int *pre_trigger_samples)
+{
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+
+	mso_split(devc, data, length, devc->logic_buffer, devc->analog_buffer,
+		&logic, &analog, &encoding, &meaning, &spec);
+
+	return soft_trigger_analog_check(devc->sta, &logic, &analog, 1,
+		pre_trigger_samples);
 }
 
 static void la_send_data_proc(struct sr_dev_inst *sdi,
@@ -418,20 +505,29 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 	unsigned int num_samples;
 	int trigger_offset, cur_sample_count, unitsize, processed_samples;
 	int pre_trigger_samples;
+	int64_t start_us;
+
+	/* Completions from the USB event thread run in the main loop. */
+	if (usb_transfer_defer(transfer, receive_transfer))
+		return;
 
 	sdi = transfer->user_data;
 	devc = sdi->priv;
+	start_us = g_get_monotonic_time();
+	sr_trace3(usb_transfer_done, sdi, transfer->status,
+		transfer->actual_length);
+	sr_session_receive_time_set(sdi, start_us);
 
 	/*
 	 * If acquisition has already ended, just free any queued up
 	 * transfer that come in.
 	 */
 	if (devc->acq_aborted) {
-		free_transfer(transfer);
+		release_transfer(transfer);
 		return;
 	}
 
-	sr_dbg("receive_transfer(): status %s received %d bytes.",
+	sr_dbg_ratelimited("receive_transfer(): status %s received %d bytes.",
 		libusb_error_name(transfer->status), transfer->actual_length);
 
 	/* Save incoming transfer before reusing the transfer struct. */
@@ -442,7 +538,7 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 	switch (transfer->status) {
 	case LIBUSB_TRANSFER_NO_DEVICE:
 		fx2lafw_abort_acquisition(devc);
-		free_transfer(transfer);
+		release_transfer(transfer);
 		return;
 	case LIBUSB_TRANSFER_COMPLETED:
 	case LIBUSB_TRANSFER_TIMED_OUT: /* We may have received some data though. */
@@ -456,11 +552,18 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		devc->empty_transfer_count++;
 		if (devc->empty_transfer_count > MAX_EMPTY_TRANSFERS) {
 			/*
-			 * The FX2 gave up. End the acquisition, the frontend
-			 * will work out that the samplecount is short.
+			 * The FX2 gave up. Report the missing samples and end
+			 * the acquisition. If the consumers fell behind, that's
+			 * the likely cause.
 			 */
+			if (devc->consumer_slow)
+				sr_session_overrun(sdi, devc->sent_samples);
+			if (devc->trigger_fired)
+				sr_session_samples_lost(sdi, devc->sent_samples,
+					devc->limit_samples > devc->sent_samples ?
+					devc->limit_samples - devc->sent_samples : 0);
 			fx2lafw_abort_acquisition(devc);
-			free_transfer(transfer);
+			release_transfer(transfer);
 		} else {
 			resubmit_transfer(transfer);
 		}
@@ -469,6 +572,12 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		devc->empty_transfer_count = 0;
 	}
 
+	if (sr_session_backpressure_get(sdi->session) >= SR_BACKPRESSURE_HIGH) {
+		if (!devc->consumer_slow)
+			sr_warn("Consumers fall behind, device may overrun.");
+		devc->consumer_slow = TRUE;
+	}
+
 check_trigger:
 	if (devc->trigger_fired) {
 		if (!devc->limit_samples || devc->sent_samples < devc->limit_samples) {
@@ -483,12 +592,26 @@ check_trigger:
 			processed_samples += num_samples;
 		}
 	} else {
-		trigger_offset = soft_trigger_logic_check(devc->stl,
-			transfer->buffer + processed_samples * unitsize,
-			transfer->actual_length - processed_samples * unitsize,
-			&pre_trigger_samples);
+		if (devc->sta)
+			trigger_offset = mso_trigger_check(devc,
+				transfer->buffer + processed_samples * unitsize,
+				transfer->actual_length - processed_samples * unitsize,
+				&pre_trigger_samples);
+		else
+			trigger_offset = soft_trigger_logic_check(devc->stl,
+				transfer->buffer + processed_samples * unitsize,
+				transfer->actual_length - processed_samples * unitsize,
+				&pre_trigger_samples);
+		if (trigger_offset < -1) {
+			sr_err("Soft trigger failed: %d.", trigger_offset);
+			fx2lafw_abort_acquisition(devc);
+			release_transfer(transfer);
+			return;
+		}
 		if (trigger_offset > -1) {
-			std_session_send_df_frame_begin(sdi);
+			std_session_send_df_frame_begin_pos(sdi, devc->stream_pos
+				+ processed_samples + trigger_offset
+				- pre_trigger_samples);
 			devc->sent_samples += pre_trigger_samples;
 			num_samples = cur_sample_count - processed_samples - trigger_offset;
 			if (devc->limit_samples &&
@@ -518,21 +641,29 @@ check_trigger:
 		/* There may be another trigger in the remaining data, go back and check for it */
 		if (processed_samples < cur_sample_count) {
 			/* Reset the trigger stage */
-			if (devc->stl)
-				devc->stl->cur_stage = 0;
+			if (devc->sta)
+				soft_trigger_analog_rearm(devc->sta);
+			else if (devc->stl)
+				soft_trigger_logic_rearm(devc->stl);
 			else {
-				std_session_send_df_frame_begin(sdi);
+				std_session_send_df_frame_begin_pos(sdi,
+					devc->stream_pos + processed_samples);
 				devc->trigger_fired = TRUE;
 			}
 			if (!final_frame)
 				goto check_trigger;
 		}
 	}
+	devc->stream_pos += cur_sample_count;
+
 	if (frame_ended && final_frame) {
 		fx2lafw_abort_acquisition(devc);
-		free_transfer(transfer);
-	} else
+		release_transfer(transfer);
+	} else {
+		transfer->length = usb_stream_completed(&devc->stream,
+			start_us);
 		resubmit_transfer(transfer);
+	}
 }
 
 static int configure_channels(const struct sr_dev_inst *sdi)
@@ -569,48 +700,11 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-static unsigned int to_bytes_per_ms(unsigned int samplerate)
+static size_t to_bytes_per_ms(unsigned int samplerate)
 {
 	return samplerate / 1000;
 }
 
-static size_t get_buffer_size(struct dev_context *devc)
-{
-	size_t s;
-
-	/*
-	 * The buffer should be large enough to hold 10ms of data and
-	 * a multiple of 512.
-	 */
-	s = 10 * to_bytes_per_ms(devc->cur_samplerate);
-	return (s + 511) & ~511;
-}
-
-static unsigned int get_number_of_transfers(struct dev_context *devc)
-{
-	unsigned int n;
-
-	/* Total buffer size should be able to hold about 500ms of data. */
-	n = (500 * to_bytes_per_ms(devc->cur_samplerate) /
-		get_buffer_size(devc));
-
-	if (n > NUM_SIMUL_TRANSFERS)
-		return NUM_SIMUL_TRANSFERS;
-
-	return n;
-}
-
-static unsigned int get_timeout(struct dev_context *devc)
-{
-	size_t total_size;
-	unsigned int timeout;
-
-	total_size = get_buffer_size(devc) *
-			get_number_of_transfers(devc);
-	timeout = total_size / to_bytes_per_ms(devc->cur_samplerate);
-	return timeout + timeout / 4; /* Leave a headroom of 25% percent. */
-}
-
 static int receive_data(int fd, int revents, void *cb_data)
 {
 	struct timeval tv;
@@ -645,61 +739,79 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 	devc->acq_aborted = FALSE;
 	devc->empty_transfer_count = 0;
 
+	/* A re-arm finds the trigger compiled by the previous run. */
 	if ((trigger = sr_session_trigger_get(sdi->session))) {
 		int pre_trigger_samples = 0;
 		if (devc->limit_samples > 0)
 			pre_trigger_samples = (devc->capture_ratio * devc->limit_samples) / 100;
-		devc->stl = soft_trigger_logic_new(sdi, trigger, pre_trigger_samples);
-		if (!devc->stl)
+		/* Analog matches need the MSO data path, see below. */
+		if (devc->sta)
+			soft_trigger_analog_reset(devc->sta);
+		else if (devc->stl)
+			soft_trigger_logic_reset(devc->stl);
+		else if (devc->enabled_analog_channels
+				&& soft_trigger_analog_wanted(trigger))
+			devc->sta = soft_trigger_analog_new(sdi, trigger,
+				pre_trigger_samples, devc->trigger_hysteresis,
+				FALSE);
+		else
+			devc->stl = soft_trigger_logic_new(sdi, trigger, pre_trigger_samples);
+		if (!devc->stl && !devc->sta)
 			return SR_ERR_MALLOC;
 		devc->trigger_fired = FALSE;
 	} else {
-		std_session_send_df_frame_begin(sdi);
+		std_session_send_df_frame_begin_pos(sdi, 0);
 		devc->trigger_fired = TRUE;
 	}
 
-	num_transfers = get_number_of_transfers(devc);
-
-	size = get_buffer_size(devc);
+	num_transfers = devc->stream.num_transfers;
+	size = devc->stream.alloc_size;
 	devc->submitted_transfers = 0;
 
-	devc->transfers = g_try_malloc0(sizeof(*devc->transfers) * num_transfers);
+	/* A re-arm finds the transfers of the previous run in the pool. */
 	if (!devc->transfers) {
-		sr_err("USB transfers malloc failed.");
-		return SR_ERR_MALLOC;
+		devc->transfers = g_try_malloc0(sizeof(*devc->transfers) * num_transfers);
+		if (!devc->transfers) {
+			sr_err("USB transfers malloc failed.");
+			return SR_ERR_MALLOC;
+		}
+		devc->num_transfers = num_transfers;
+		devc->transfer_size = size;
+		for (i = 0; i < num_transfers; i++) {
+			if (!(buf = usb_transfer_buf_alloc(usb->devhdl, size))) {
+				sr_err("USB transfer buffer malloc failed.");
+				return SR_ERR_MALLOC;
+			}
+			transfer = libusb_alloc_transfer(0);
+			libusb_fill_bulk_transfer(transfer, usb->devhdl,
+					2 | LIBUSB_ENDPOINT_IN, buf, 0,
+					receive_transfer, (void *)sdi, 0);
+			devc->transfers[i] = transfer;
+		}
 	}
 
-	timeout = get_timeout(devc);
-	devc->num_transfers = num_transfers;
+	timeout = usb_stream_timeout(&devc->stream);
 	for (i = 0; i < num_transfers; i++) {
-		if (!(buf = g_try_malloc(size))) {
-			sr_err("USB transfer buffer malloc failed.");
-			return SR_ERR_MALLOC;
-		}
-		transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(transfer, usb->devhdl,
-				2 | LIBUSB_ENDPOINT_IN, buf, size,
-				receive_transfer, (void *)sdi, timeout);
+		transfer = devc->transfers[i];
+		transfer->length = devc->stream.length;
+		transfer->timeout = timeout;
 		sr_info("submitting transfer: %d", i);
 		if ((ret = libusb_submit_transfer(transfer)) != 0) {
 			sr_err("Failed to submit transfer: %s.",
 			       libusb_error_name(ret));
-			libusb_free_transfer(transfer);
-			g_free(buf);
 			fx2lafw_abort_acquisition(devc);
 			return SR_ERR;
 		}
-		devc->transfers[i] = transfer;
 		devc->submitted_transfers++;
 	}
 
 	/*
 	 * If this device has analog channels and at least one of them is
-	 * enabled, use mso_send_data_proc() to properly handle the analog
-	 * data. Otherwise use la_send_data_proc().
+	 * enabled, use fx2lafw_mso_send_data_proc() to properly handle the
+	 * analog data. Otherwise use la_send_data_proc().
 	 */
 	if (g_slist_length(devc->enabled_analog_channels) > 0)
-		devc->send_data_proc = mso_send_data_proc;
+		devc->send_data_proc = fx2lafw_mso_send_data_proc;
 	else
 		devc->send_data_proc = la_send_data_proc;
 
@@ -708,7 +820,7 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi)
+static int acquisition_start(const struct sr_dev_inst *sdi, gboolean rearm)
 {
 	struct sr_dev_driver *di;
 	struct drv_context *drvc;
@@ -720,29 +832,46 @@ SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi)
 	drvc = di->context;
 	devc = sdi->priv;
 
+	if (rearm) {
+		if (!devc->transfers)
+			return SR_ERR_NA;
+		/* The transfer sizing may have adapted to the host's load. */
+		usb_stream_start(&devc->stream,
+			to_bytes_per_ms(devc->cur_samplerate), 512);
+		if (devc->stream.num_transfers != devc->num_transfers
+				|| devc->stream.alloc_size != devc->transfer_size)
+			return SR_ERR_NA;
+	} else {
+		fx2lafw_free_acquisition(devc);
+		if (configure_channels(sdi) != SR_OK) {
+			sr_err("Failed to configure channels.");
+			return SR_ERR;
+		}
+		usb_stream_start(&devc->stream,
+			to_bytes_per_ms(devc->cur_samplerate), 512);
+	}
+
 	devc->ctx = drvc->sr_ctx;
 	devc->num_frames = 0;
 	devc->sent_samples = 0;
+	devc->stream_pos = 0;
 	devc->empty_transfer_count = 0;
+	devc->consumer_slow = FALSE;
 	devc->acq_aborted = FALSE;
 
-	if (configure_channels(sdi) != SR_OK) {
-		sr_err("Failed to configure channels.");
-		return SR_ERR;
-	}
-
-	timeout = get_timeout(devc);
-	usb_source_add(sdi->session, devc->ctx, timeout, receive_data, drvc);
+	timeout = usb_stream_timeout(&devc->stream);
+	usb_source_add_deferred(sdi->session, devc->ctx, timeout,
+		receive_data, drvc);
 
-	size = get_buffer_size(devc);
+	size = devc->stream.alloc_size;
 	/* Prepare for analog sampling. */
-	if (g_slist_length(devc->enabled_analog_channels) > 0) {
+	if (!rearm && g_slist_length(devc->enabled_analog_channels) > 0) {
 		/* We need a buffer half the size of a transfer. */
 		devc->logic_buffer = g_try_malloc(size / 2);
-		devc->analog_buffer = g_try_malloc(
-			sizeof(float) * size / 2);
+		devc->analog_buffer = g_try_malloc(size / 2);
 	}
-	start_transfers(sdi);
+	if ((ret = start_transfers(sdi)) != SR_OK)
+		return ret;
 	if ((ret = command_start_acquisition(sdi)) != SR_OK) {
 		fx2lafw_abort_acquisition(devc);
 		return ret;
@@ -750,3 +879,17 @@ SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi)
 
 	return SR_OK;
 }
+
+SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi)
+{
+	return acquisition_start(sdi, FALSE);
+}
+
+/*
+ * Start again with the channel setup, the transfers and the trigger of
+ * the previous run. Nothing of these changed, see sr_session_rearm().
+ */
+SR_PRIV int fx2lafw_rearm_acquisition(const struct sr_dev_inst *sdi)
+{
+	return acquisition_start(sdi, TRUE);
+}
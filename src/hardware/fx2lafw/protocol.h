@@ -105,29 +105,43 @@ struct dev_context {
 	uint64_t limit_frames;
 	uint64_t limit_samples;
 	uint64_t capture_ratio;
+	float trigger_hysteresis;
 
 	gboolean trigger_fired;
 	gboolean acq_aborted;
 	gboolean sample_wide;
 	struct soft_trigger_logic *stl;
+	struct soft_trigger_analog *sta;
 
 	uint64_t num_frames;
 	uint64_t sent_samples;
+	/* Samples received from the device during this run. */
+	uint64_t stream_pos;
 	int submitted_transfers;
 	int empty_transfer_count;
+	/* Whether the consumers reported backpressure during this run. */
+	gboolean consumer_slow;
 
+	/* Transfer sizing, adapts to the host's load. */
+	struct usb_stream stream;
+	/* Transfers, kept from one run to the next for a re-arm. */
 	unsigned int num_transfers;
+	size_t transfer_size;
 	struct libusb_transfer **transfers;
 	struct sr_context *ctx;
 	void (*send_data_proc)(struct sr_dev_inst *sdi,
 		uint8_t *data, size_t length, size_t sample_width);
 	uint8_t *logic_buffer;
-	float *analog_buffer;
+	uint8_t *analog_buffer;
 };
 
 SR_PRIV int fx2lafw_dev_open(struct sr_dev_inst *sdi, struct sr_dev_driver *di);
 SR_PRIV struct dev_context *fx2lafw_dev_new(void);
 SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi);
+SR_PRIV int fx2lafw_rearm_acquisition(const struct sr_dev_inst *sdi);
+SR_PRIV void fx2lafw_free_acquisition(struct dev_context *devc);
 SR_PRIV void fx2lafw_abort_acquisition(struct dev_context *devc);
+SR_PRIV void fx2lafw_mso_send_data_proc(struct sr_dev_inst *sdi,
+	uint8_t *data, size_t length, size_t sample_width);
 
 #endif
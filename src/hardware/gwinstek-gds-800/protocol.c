@@ -24,60 +24,123 @@
 #define ANALOG_CHANNELS 2
 #define VERTICAL_DIVISIONS 10
 
-static int read_data(struct sr_dev_inst *sdi,
-		struct sr_scpi_dev_inst *scpi, struct dev_context *devc,
-		int data_size)
+/*
+ * Convert the samples of a waveform block as its data arrives, so that
+ * the conversion overlaps the transfer. Samples are big endian 16 bit
+ * values.
+ */
+static int convert_data(const uint8_t *data, size_t len, void *cb_data)
 {
-	int len;
+	struct dev_context *devc;
+	const uint8_t *raw;
+	size_t i, count;
 
-	len = sr_scpi_read_data(scpi,
-		&devc->rcv_buffer[devc->cur_rcv_buffer_position],
-		data_size - devc->cur_rcv_buffer_position);
-	if (len < 0) {
-		sr_err("Read data error.");
-		sr_dev_acquisition_stop(sdi);
-		devc->cur_rcv_buffer_position = 0;
-		return SR_ERR;
-	}
+	(void)data;
 
-	devc->cur_rcv_buffer_position += len;
+	devc = cb_data;
+	devc->rcv_count += len;
+	if (devc->rcv_count <= BLOCK_HEADER_SIZE)
+		return SR_OK;
 
-	/* Handle the case where sr_scpi_read_data stopped at the newline. */
-	if (len < data_size && sr_scpi_read_complete(scpi)) {
-		devc->rcv_buffer[devc->cur_rcv_buffer_position] = '\n';
-		devc->cur_rcv_buffer_position++;
-	}
+	count = MIN((devc->rcv_count - BLOCK_HEADER_SIZE) / 2, MAX_SAMPLES);
+	raw = &devc->rcv_buffer[BLOCK_HEADER_SIZE];
+	for (i = devc->num_converted; i < count; i++)
+		devc->samples[i] = RB16S(&raw[i * 2]) * devc->volts_per_bit;
+	devc->num_converted = count;
 
-	if (devc->cur_rcv_buffer_position < data_size)
-		return SR_ERR; /* Not finished yet. */
-	else if (devc->cur_rcv_buffer_position == data_size) {
-		 devc->cur_rcv_buffer_position = 0;
-		return SR_OK;
-	} else {
-		sr_err("Too many bytes read.");
-		sr_dev_acquisition_stop(sdi);
-		devc->cur_rcv_buffer_position = 0;
+	return SR_OK;
+}
+
+/* Get the scale of a channel, before its waveform gets requested. */
+static int get_channel_scale(struct sr_scpi_dev_inst *scpi,
+		struct dev_context *devc)
+{
+	char command[32];
+	char *response, *end_ptr;
+	float volts_per_division, vbitlog;
+
+	snprintf(command, sizeof(command), ":CHAN%d:SCAL?",
+			devc->cur_acq_channel + 1);
+	if (sr_scpi_get_string(scpi, command, &response) != SR_OK) {
+		sr_err("Failed to get volts per division.");
 		return SR_ERR;
 	}
+	volts_per_division = g_ascii_strtod(response, &end_ptr);
+	if (!strcmp(end_ptr, "mV"))
+		volts_per_division *= 1.e-3;
+	g_free(response);
+
+	devc->volts_per_bit = volts_per_division * VERTICAL_DIVISIONS / 256.0;
+	vbitlog = log10f(devc->volts_per_bit);
+	devc->digits = -(int)vbitlog + (vbitlog < 0.0);
+
+	return SR_OK;
 }
 
-SR_PRIV int gwinstek_gds_800_receive_data(int fd, int revents, void *cb_data)
+/*
+ * Read a channel's waveform block into the preallocated receive buffer,
+ * converting the samples as they arrive, and send them.
+ */
+static int read_channel_data(struct sr_dev_inst *sdi,
+		struct sr_scpi_dev_inst *scpi, struct dev_context *devc)
 {
-	struct sr_dev_inst *sdi;
-	struct sr_scpi_dev_inst *scpi;
-	struct dev_context *devc;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
-	char command[32];
-	char *response;
-	float volts_per_division;
-	int num_samples, i;
-	float samples[MAX_SAMPLES];
+	uint8_t *buf;
+	size_t size;
 	uint32_t sample_rate;
-	char *end_ptr;
+	int ret;
+
+	devc->rcv_count = 0;
+	devc->num_converted = 0;
+	buf = devc->rcv_buffer;
+	size = sizeof(devc->rcv_buffer);
+	ret = sr_scpi_read_block(scpi, NULL, &buf, &size, convert_data, devc);
+	if (ret != SR_OK || size < BLOCK_HEADER_SIZE) {
+		sr_err("Read data error.");
+		return SR_ERR;
+	}
+
+	/*
+	 * Contrary to the documentation, this field is
+	 * transfered with most significant byte first!
+	 */
+	sample_rate = RB32(devc->rcv_buffer);
+	memcpy(&devc->sample_rate, &sample_rate, sizeof(float));
+
+	if (!devc->df_started) {
+		std_session_send_df_header(sdi);
+		std_session_send_df_frame_begin(sdi);
+		devc->df_started = TRUE;
+	}
+
+	sr_spew("Received %zu number of samples from channel "
+		"%d.", devc->num_converted, devc->cur_acq_channel + 1);
+
+	/* Fill frame. */
+	sr_analog_init(&analog, &encoding, &meaning, &spec, devc->digits);
+	analog.meaning->channels = g_slist_append(NULL, g_slist_nth_data(sdi->channels, devc->cur_acq_channel));
+	analog.num_samples = devc->num_converted;
+	analog.data = devc->samples;
+	analog.meaning->mq = SR_MQ_VOLTAGE;
+	analog.meaning->unit = SR_UNIT_VOLT;
+	analog.meaning->mqflags = 0;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	sr_session_send(sdi, &packet);
+	g_slist_free(analog.meaning->channels);
+
+	return SR_OK;
+}
+
+SR_PRIV int gwinstek_gds_800_receive_data(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_scpi_dev_inst *scpi;
+	struct dev_context *devc;
 
 	(void)fd;
 
@@ -115,143 +178,33 @@ SR_PRIV int gwinstek_gds_800_receive_data(int fd, int revents, void *cb_data)
 		break;
 	case START_TRANSFER_OF_CHANNEL_DATA:
 		if (((struct sr_channel *)g_slist_nth_data(sdi->channels, devc->cur_acq_channel))->enabled) {
-			if (sr_scpi_send(scpi, ":ACQ%d:MEM?", devc->cur_acq_channel+1) != SR_OK) {
-				sr_err("Failed to acquire memory.");
+			/* Fetch data needed for conversion from device. */
+			if (get_channel_scale(scpi, devc) != SR_OK) {
 				sr_dev_acquisition_stop(sdi);
 				return TRUE;
 			}
-			if (sr_scpi_read_begin(scpi) != SR_OK) {
-				sr_err("Could not begin reading SCPI response.");
+			if (sr_scpi_send(scpi, ":ACQ%d:MEM?", devc->cur_acq_channel+1) != SR_OK) {
+				sr_err("Failed to acquire memory.");
 				sr_dev_acquisition_stop(sdi);
 				return TRUE;
 			}
-			devc->state = WAIT_FOR_TRANSFER_OF_BEGIN_TRANSMISSION_COMPLETE;
-			devc->cur_rcv_buffer_position = 0;
-		} else {
-			/* All channels acquired. */
-			if (devc->cur_acq_channel == ANALOG_CHANNELS - 1) {
-				sr_spew("All channels acquired.");
-
-				if (devc->cur_acq_frame == devc->frame_limit - 1) {
-					/* All frames accquired. */
-					sr_spew("All frames acquired.");
-
-					sr_dev_acquisition_stop(sdi);
-					return TRUE;
-				} else {
-					/* Start acquiring next frame. */
-					if (devc->df_started) {
-						std_session_send_df_frame_end(sdi);
-						std_session_send_df_frame_begin(sdi);
-					}
-
-					devc->cur_acq_frame++;
-					devc->state = START_ACQUISITION;
-				}
-			} else {
-				/* Start acquiring next channel. */
-				devc->cur_acq_channel++;
-			}
-		}
-		break;
-	case WAIT_FOR_TRANSFER_OF_BEGIN_TRANSMISSION_COMPLETE:
-		if (read_data(sdi, scpi, devc, 1) < 0)
-			break;
-		if (devc->rcv_buffer[0] == '#')
-			devc->state = WAIT_FOR_TRANSFER_OF_DATA_SIZE_DIGIT_COMPLETE;
-		break;
-	case WAIT_FOR_TRANSFER_OF_DATA_SIZE_DIGIT_COMPLETE:
-		if (read_data(sdi, scpi, devc, 1) < 0)
-			break;
-		if (devc->rcv_buffer[0] != '4' &&
-			devc->rcv_buffer[0] != '5' &&
-			devc->rcv_buffer[0] != '6') {
-			sr_err("Data size digits is not 4, 5 or 6 but "
-			       "'%c'.", devc->rcv_buffer[0]);
-			sr_dev_acquisition_stop(sdi);
-			return TRUE;
-		} else {
-			devc->data_size_digits = devc->rcv_buffer[0] - '0';
-			devc->state = WAIT_FOR_TRANSFER_OF_DATA_SIZE_COMPLETE;
-		}
-		break;
-	case WAIT_FOR_TRANSFER_OF_DATA_SIZE_COMPLETE:
-		if (read_data(sdi, scpi, devc, devc->data_size_digits) < 0)
-			break;
-		devc->rcv_buffer[devc->data_size_digits] = 0;
-		if (sr_atoi(devc->rcv_buffer, &devc->data_size) != SR_OK) {
-			sr_err("Could not parse data size '%s'", devc->rcv_buffer);
-			sr_dev_acquisition_stop(sdi);
-			return TRUE;
-		} else
-			devc->state = WAIT_FOR_TRANSFER_OF_SAMPLE_RATE_COMPLETE;
-		break;
-	case WAIT_FOR_TRANSFER_OF_SAMPLE_RATE_COMPLETE:
-		if (read_data(sdi, scpi, devc, sizeof(float)) < 0)
+			devc->state = WAIT_FOR_TRANSFER_OF_CHANNEL_DATA_COMPLETE;
 			break;
-		/*
-		 * Contrary to the documentation, this field is
-		 * transfered with most significant byte first!
-		 */
-		sample_rate = RB32(devc->rcv_buffer);
-		memcpy(&devc->sample_rate, &sample_rate, sizeof(float));
-		devc->state = WAIT_FOR_TRANSFER_OF_CHANNEL_INDICATOR_COMPLETE;
-
-		if (!devc->df_started) {
-			std_session_send_df_header(sdi);
-			std_session_send_df_frame_begin(sdi);
-			devc->df_started = TRUE;
 		}
-		break;
-	case WAIT_FOR_TRANSFER_OF_CHANNEL_INDICATOR_COMPLETE:
-		if (read_data(sdi, scpi, devc, 1) == SR_OK)
-			devc->state = WAIT_FOR_TRANSFER_OF_RESERVED_DATA_COMPLETE;
-		break;
-	case WAIT_FOR_TRANSFER_OF_RESERVED_DATA_COMPLETE:
-		if (read_data(sdi, scpi, devc, 3) == SR_OK)
-			devc->state = WAIT_FOR_TRANSFER_OF_CHANNEL_DATA_COMPLETE;
-		break;
+		/* FALLTHROUGH */
 	case WAIT_FOR_TRANSFER_OF_CHANNEL_DATA_COMPLETE:
-		if (read_data(sdi, scpi, devc, devc->data_size - 8) < 0)
-			break;
-
-		/* Fetch data needed for conversion from device. */
-		snprintf(command, sizeof(command), ":CHAN%d:SCAL?",
-				devc->cur_acq_channel + 1);
-		if (sr_scpi_get_string(scpi, command, &response) != SR_OK) {
-			sr_err("Failed to get volts per division.");
-			sr_dev_acquisition_stop(sdi);
-			return TRUE;
+		if (devc->state == WAIT_FOR_TRANSFER_OF_CHANNEL_DATA_COMPLETE) {
+			/*
+			 * The first data arrives when the acquisition
+			 * completed, which can take a while.
+			 */
+			if (revents != G_IO_IN)
+				break;
+			if (read_channel_data(sdi, scpi, devc) != SR_OK) {
+				sr_dev_acquisition_stop(sdi);
+				return TRUE;
+			}
 		}
-		volts_per_division = g_ascii_strtod(response, &end_ptr);
-		if (!strcmp(end_ptr, "mV"))
-			volts_per_division *= 1.e-3;
-		g_free(response);
-
-		num_samples = (devc->data_size - 8) / 2;
-		sr_spew("Received %d number of samples from channel "
-			"%d.", num_samples, devc->cur_acq_channel + 1);
-
-		float vbit = volts_per_division * VERTICAL_DIVISIONS / 256.0;
-		float vbitlog = log10f(vbit);
-		int digits = -(int)vbitlog + (vbitlog < 0.0);
-
-		/* Convert data. */
-		for (i = 0; i < num_samples; i++)
-			samples[i] = ((float) ((int16_t) (RB16(&devc->rcv_buffer[i*2])))) * vbit;
-
-		/* Fill frame. */
-		sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
-		analog.meaning->channels = g_slist_append(NULL, g_slist_nth_data(sdi->channels, devc->cur_acq_channel));
-		analog.num_samples = num_samples;
-		analog.data = samples;
-		analog.meaning->mq = SR_MQ_VOLTAGE;
-		analog.meaning->unit = SR_UNIT_VOLT;
-		analog.meaning->mqflags = 0;
-		packet.type = SR_DF_ANALOG;
-		packet.payload = &analog;
-		sr_session_send(sdi, &packet);
-		g_slist_free(analog.meaning->channels);
 
 		/* All channels acquired. */
 		if (devc->cur_acq_channel == ANALOG_CHANNELS - 1) {
@@ -275,7 +228,6 @@ SR_PRIV int gwinstek_gds_800_receive_data(int fd, int revents, void *cb_data)
 			/* Start acquiring next channel. */
 			devc->state = START_TRANSFER_OF_CHANNEL_DATA;
 			devc->cur_acq_channel++;
-			return TRUE;
 		}
 		break;
 	}
@@ -29,18 +29,14 @@
 #define LOG_PREFIX "gwinstek-gds-800"
 
 #define MAX_SAMPLES 125000
-#define MAX_RCV_BUFFER_SIZE (MAX_SAMPLES * 2)
+/* Sample rate (4), channel indicator (1), reserved (3), then samples. */
+#define BLOCK_HEADER_SIZE 8
+#define MAX_RCV_BUFFER_SIZE (BLOCK_HEADER_SIZE + MAX_SAMPLES * 2)
 
 enum gds_state
 {
 	START_ACQUISITION,
 	START_TRANSFER_OF_CHANNEL_DATA,
-	WAIT_FOR_TRANSFER_OF_BEGIN_TRANSMISSION_COMPLETE,
-	WAIT_FOR_TRANSFER_OF_DATA_SIZE_DIGIT_COMPLETE,
-	WAIT_FOR_TRANSFER_OF_DATA_SIZE_COMPLETE,
-	WAIT_FOR_TRANSFER_OF_SAMPLE_RATE_COMPLETE,
-	WAIT_FOR_TRANSFER_OF_CHANNEL_INDICATOR_COMPLETE,
-	WAIT_FOR_TRANSFER_OF_RESERVED_DATA_COMPLETE,
 	WAIT_FOR_TRANSFER_OF_CHANNEL_DATA_COMPLETE,
 };
 
@@ -49,10 +45,13 @@ struct dev_context {
 	uint64_t cur_acq_frame;
 	uint64_t frame_limit;
 	int cur_acq_channel;
-	int cur_rcv_buffer_position;
-	char rcv_buffer[MAX_RCV_BUFFER_SIZE];
-	int data_size_digits;
-	int data_size;
+	uint8_t rcv_buffer[MAX_RCV_BUFFER_SIZE];
+	/* Bytes of the block received so far, samples converted from them. */
+	size_t rcv_count;
+	size_t num_converted;
+	float samples[MAX_SAMPLES];
+	float volts_per_bit;
+	int digits;
 	float sample_rate;
 	gboolean df_started;
 };
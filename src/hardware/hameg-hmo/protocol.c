@@ -800,24 +800,19 @@ static void scope_state_dump(const struct scope_config *config,
 			state->horiz_triggerpos);
 }
 
-static int scope_state_get_array_option(struct sr_scpi_dev_inst *scpi,
-		const char *command, const char *(*array)[], unsigned int n, int *result)
+static int scope_state_get_array_option(const char *resp,
+		const char *(*array)[], unsigned int n, int *result)
 {
-	char *tmp;
 	int idx;
 
-	if (sr_scpi_get_string(scpi, command, &tmp) != SR_OK)
+	if (!resp)
 		return SR_ERR;
 
-	if ((idx = std_str_idx_s(tmp, *array, n)) < 0) {
-		g_free(tmp);
+	if ((idx = std_str_idx_s(resp, *array, n)) < 0)
 		return SR_ERR_ARG;
-	}
 
 	*result = idx;
 
-	g_free(tmp);
-
 	return SR_OK;
 }
 
@@ -866,77 +861,92 @@ static struct sr_channel *get_channel_by_index_and_type(GSList *channel_lhead,
 	return 0;
 }
 
+/* Queries per analog channel, in the order of analog_channel_state_get(). */
+enum {
+	ANALOG_QUERY_STATE,
+	ANALOG_QUERY_SCALE,
+	ANALOG_QUERY_OFFSET,
+	ANALOG_QUERY_COUPLING,
+	ANALOG_QUERY_PROBE_UNIT,
+	ANALOG_QUERIES,
+};
+
 static int analog_channel_state_get(struct sr_dev_inst *sdi,
 				    const struct scope_config *config,
 				    struct scope_state *state)
 {
 	unsigned int i, j;
-	char command[MAX_COMMAND_SIZE];
-	char *tmp_str;
+	int idx, coupling, ret;
+	const char *resp;
 	struct sr_channel *ch;
-	struct sr_scpi_dev_inst *scpi = sdi->conn;
+	struct sr_scpi_batch *batch;
 
+	/* Query all the channels in few round trips. */
+	batch = sr_scpi_batch_new(sdi->conn);
 	for (i = 0; i < config->analog_channels; i++) {
-		g_snprintf(command, sizeof(command),
-			   (*config->scpi_dialect)[SCPI_CMD_GET_ANALOG_CHAN_STATE],
-			   i + 1);
+		sr_scpi_batch_add(batch,
+			(*config->scpi_dialect)[SCPI_CMD_GET_ANALOG_CHAN_STATE],
+			i + 1);
+		sr_scpi_batch_add(batch,
+			(*config->scpi_dialect)[SCPI_CMD_GET_VERTICAL_SCALE],
+			i + 1);
+		sr_scpi_batch_add(batch,
+			(*config->scpi_dialect)[SCPI_CMD_GET_VERTICAL_OFFSET],
+			i + 1);
+		sr_scpi_batch_add(batch,
+			(*config->scpi_dialect)[SCPI_CMD_GET_COUPLING],
+			i + 1);
+		sr_scpi_batch_add(batch,
+			(*config->scpi_dialect)[SCPI_CMD_GET_PROBE_UNIT],
+			i + 1);
+	}
+	if (sr_scpi_batch_run(batch) != SR_OK) {
+		sr_scpi_batch_free(batch);
+		return SR_ERR;
+	}
 
-		if (sr_scpi_get_bool(scpi, command,
-				     &state->analog_channels[i].state) != SR_OK)
-			return SR_ERR;
+	ret = SR_OK;
+	for (i = 0; i < config->analog_channels && ret == SR_OK; i++) {
+		idx = i * ANALOG_QUERIES;
+		ret = SR_ERR;
+
+		if (sr_scpi_batch_get_bool(batch, idx + ANALOG_QUERY_STATE,
+				&state->analog_channels[i].state) != SR_OK)
+			break;
 
 		ch = get_channel_by_index_and_type(sdi->channels, i, SR_CHANNEL_ANALOG);
 		if (ch)
 			ch->enabled = state->analog_channels[i].state;
 
-		g_snprintf(command, sizeof(command),
-			   (*config->scpi_dialect)[SCPI_CMD_GET_VERTICAL_SCALE],
-			   i + 1);
-
-		if (sr_scpi_get_string(scpi, command, &tmp_str) != SR_OK)
-			return SR_ERR;
-
-		if (array_float_get(tmp_str, ARRAY_AND_SIZE(vdivs), &j) != SR_OK) {
-			g_free(tmp_str);
+		resp = sr_scpi_batch_get_string(batch, idx + ANALOG_QUERY_SCALE);
+		if (array_float_get((char *)resp, ARRAY_AND_SIZE(vdivs), &j) != SR_OK) {
 			sr_err("Could not determine array index for vertical div scale.");
-			return SR_ERR;
+			break;
 		}
-
-		g_free(tmp_str);
 		state->analog_channels[i].vdiv = j;
 
-		g_snprintf(command, sizeof(command),
-			   (*config->scpi_dialect)[SCPI_CMD_GET_VERTICAL_OFFSET],
-			   i + 1);
-
-		if (sr_scpi_get_float(scpi, command,
-				     &state->analog_channels[i].vertical_offset) != SR_OK)
-			return SR_ERR;
-
-		g_snprintf(command, sizeof(command),
-			   (*config->scpi_dialect)[SCPI_CMD_GET_COUPLING],
-			   i + 1);
-
-		if (scope_state_get_array_option(scpi, command, config->coupling_options,
-					 config->num_coupling_options,
-					 &state->analog_channels[i].coupling) != SR_OK)
-			return SR_ERR;
-
-		g_snprintf(command, sizeof(command),
-			   (*config->scpi_dialect)[SCPI_CMD_GET_PROBE_UNIT],
-			   i + 1);
+		if (sr_scpi_batch_get_float(batch, idx + ANALOG_QUERY_OFFSET,
+				&state->analog_channels[i].vertical_offset) != SR_OK)
+			break;
 
-		if (sr_scpi_get_string(scpi, command, &tmp_str) != SR_OK)
-			return SR_ERR;
+		resp = sr_scpi_batch_get_string(batch, idx + ANALOG_QUERY_COUPLING);
+		coupling = std_str_idx_s(resp, *config->coupling_options,
+			config->num_coupling_options);
+		if (coupling < 0)
+			break;
+		state->analog_channels[i].coupling = coupling;
 
-		if (tmp_str[0] == 'A')
+		resp = sr_scpi_batch_get_string(batch, idx + ANALOG_QUERY_PROBE_UNIT);
+		if (resp[0] == 'A')
 			state->analog_channels[i].probe_unit = 'A';
 		else
 			state->analog_channels[i].probe_unit = 'V';
-		g_free(tmp_str);
+
+		ret = SR_OK;
 	}
+	sr_scpi_batch_free(batch);
 
-	return SR_OK;
+	return ret;
 }
 
 static int digital_channel_state_get(struct sr_dev_inst *sdi,
@@ -945,24 +955,34 @@ static int digital_channel_state_get(struct sr_dev_inst *sdi,
 {
 	unsigned int i, idx;
 	int result = SR_ERR;
+	int level_idx[MAX_DIGITAL_GROUP_COUNT];
 	char *logic_threshold_short[MAX_NUM_LOGIC_THRESHOLD_ENTRIES];
-	char command[MAX_COMMAND_SIZE];
+	const char *resp, *threshold;
 	struct sr_channel *ch;
 	struct sr_scpi_dev_inst *scpi = sdi->conn;
+	struct sr_scpi_batch *batch, *levels = NULL;
+
+	batch = sr_scpi_batch_new(scpi);
+	for (i = 0; i < config->digital_channels; i++)
+		sr_scpi_batch_add(batch,
+			(*config->scpi_dialect)[SCPI_CMD_GET_DIG_CHAN_STATE], i);
+	if (sr_scpi_batch_run(batch) != SR_OK) {
+		sr_scpi_batch_free(batch);
+		return SR_ERR;
+	}
 
 	for (i = 0; i < config->digital_channels; i++) {
-		g_snprintf(command, sizeof(command),
-			   (*config->scpi_dialect)[SCPI_CMD_GET_DIG_CHAN_STATE],
-			   i);
-
-		if (sr_scpi_get_bool(scpi, command,
-				     &state->digital_channels[i]) != SR_OK)
+		if (sr_scpi_batch_get_bool(batch, i,
+				&state->digital_channels[i]) != SR_OK) {
+			sr_scpi_batch_free(batch);
 			return SR_ERR;
+		}
 
 		ch = get_channel_by_index_and_type(sdi->channels, i, SR_CHANNEL_LOGIC);
 		if (ch)
 			ch->enabled = state->digital_channels[i];
 	}
+	sr_scpi_batch_free(batch);
 
 	/* According to the SCPI standard, on models that support multiple
 	 * user-defined logic threshold settings the response to the command
@@ -980,60 +1000,77 @@ static int digital_channel_state_get(struct sr_dev_inst *sdi,
 				  (*config->logic_threshold)[i], strlen((*config->logic_threshold)[i]));
 	}
 
+	/* Query the state and threshold of all the pods. */
+	batch = sr_scpi_batch_new(scpi);
 	for (i = 0; i < config->digital_pods; i++) {
-		g_snprintf(command, sizeof(command),
-			   (*config->scpi_dialect)[SCPI_CMD_GET_DIG_POD_STATE],
-			   i + 1);
-
-		if (sr_scpi_get_bool(scpi, command,
-				     &state->digital_pods[i].state) != SR_OK)
-			goto exit;
-
 		/* Check if the threshold command is based on the POD or digital channel index. */
 		if (config->logic_threshold_for_pod)
 			idx = i + 1;
 		else
 			idx = i * DIGITAL_CHANNELS_PER_POD;
 
-		g_snprintf(command, sizeof(command),
-			   (*config->scpi_dialect)[SCPI_CMD_GET_DIG_POD_THRESHOLD],
-			   idx);
+		sr_scpi_batch_add(batch,
+			(*config->scpi_dialect)[SCPI_CMD_GET_DIG_POD_STATE], i + 1);
+		sr_scpi_batch_add(batch,
+			(*config->scpi_dialect)[SCPI_CMD_GET_DIG_POD_THRESHOLD], idx);
+	}
+	if (sr_scpi_batch_run(batch) != SR_OK)
+		goto exit;
+
+	/* Get the levels of user-defined or custom thresholds in one more batch. */
+	levels = sr_scpi_batch_new(scpi);
+	for (i = 0; i < config->digital_pods; i++) {
+		level_idx[i] = -1;
+
+		if (sr_scpi_batch_get_bool(batch, 2 * i,
+				&state->digital_pods[i].state) != SR_OK)
+			goto exit;
 
 		/* Check for both standard and shortened responses. */
-		if (scope_state_get_array_option(scpi, command, config->logic_threshold,
+		resp = sr_scpi_batch_get_string(batch, 2 * i + 1);
+		if (scope_state_get_array_option(resp, config->logic_threshold,
 						 config->num_logic_threshold,
 						 &state->digital_pods[i].threshold) != SR_OK)
-			if (scope_state_get_array_option(scpi, command, (const char * (*)[]) &logic_threshold_short,
+			if (scope_state_get_array_option(resp, (const char * (*)[]) &logic_threshold_short,
 							 config->num_logic_threshold,
 							 &state->digital_pods[i].threshold) != SR_OK)
 				goto exit;
 
-		/* If used-defined or custom threshold is active, get the level. */
-		if (!strcmp("USER1", (*config->logic_threshold)[state->digital_pods[i].threshold]))
-			g_snprintf(command, sizeof(command),
-				   (*config->scpi_dialect)[SCPI_CMD_GET_DIG_POD_USER_THRESHOLD],
-				   idx, 1); /* USER1 logic threshold setting. */
-		else if (!strcmp("USER2", (*config->logic_threshold)[state->digital_pods[i].threshold]))
-			g_snprintf(command, sizeof(command),
-				   (*config->scpi_dialect)[SCPI_CMD_GET_DIG_POD_USER_THRESHOLD],
-				   idx, 2); /* USER2 for custom logic_threshold setting. */
-		else if (!strcmp("USER", (*config->logic_threshold)[state->digital_pods[i].threshold]) ||
-			 !strcmp("MAN", (*config->logic_threshold)[state->digital_pods[i].threshold]))
-			g_snprintf(command, sizeof(command),
-				   (*config->scpi_dialect)[SCPI_CMD_GET_DIG_POD_USER_THRESHOLD],
-				   idx); /* USER or MAN for custom logic_threshold setting. */
-		if (!strcmp("USER1", (*config->logic_threshold)[state->digital_pods[i].threshold]) ||
-		    !strcmp("USER2", (*config->logic_threshold)[state->digital_pods[i].threshold]) ||
-		    !strcmp("USER", (*config->logic_threshold)[state->digital_pods[i].threshold]) ||
-		    !strcmp("MAN", (*config->logic_threshold)[state->digital_pods[i].threshold]))
-			if (sr_scpi_get_float(scpi, command,
-			    &state->digital_pods[i].user_threshold) != SR_OK)
-				goto exit;
+		if (config->logic_threshold_for_pod)
+			idx = i + 1;
+		else
+			idx = i * DIGITAL_CHANNELS_PER_POD;
+
+		threshold = (*config->logic_threshold)[state->digital_pods[i].threshold];
+		if (!strcmp("USER1", threshold))
+			level_idx[i] = sr_scpi_batch_add(levels,
+				(*config->scpi_dialect)[SCPI_CMD_GET_DIG_POD_USER_THRESHOLD],
+				idx, 1); /* USER1 logic threshold setting. */
+		else if (!strcmp("USER2", threshold))
+			level_idx[i] = sr_scpi_batch_add(levels,
+				(*config->scpi_dialect)[SCPI_CMD_GET_DIG_POD_USER_THRESHOLD],
+				idx, 2); /* USER2 for custom logic_threshold setting. */
+		else if (!strcmp("USER", threshold) || !strcmp("MAN", threshold))
+			level_idx[i] = sr_scpi_batch_add(levels,
+				(*config->scpi_dialect)[SCPI_CMD_GET_DIG_POD_USER_THRESHOLD],
+				idx); /* USER or MAN for custom logic_threshold setting. */
+	}
+	if (sr_scpi_batch_run(levels) != SR_OK)
+		goto exit;
+
+	for (i = 0; i < config->digital_pods; i++) {
+		if (level_idx[i] < 0)
+			continue;
+		if (sr_scpi_batch_get_float(levels, level_idx[i],
+				&state->digital_pods[i].user_threshold) != SR_OK)
+			goto exit;
 	}
 
 	result = SR_OK;
 
 exit:
+	sr_scpi_batch_free(levels);
+	sr_scpi_batch_free(batch);
 	for (i = 0; i < config->num_logic_threshold; i++)
 		g_free(logic_threshold_short[i]);
 
@@ -1061,50 +1098,43 @@ SR_PRIV int hmo_update_sample_rate(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-SR_PRIV int hmo_scope_state_get(struct sr_dev_inst *sdi)
+/* Queries of the scope state besides the channels, in the order of scope_state_parse(). */
+static const int state_queries[] = {
+	SCPI_CMD_GET_TIMEBASE,
+	SCPI_CMD_GET_HORIZONTAL_DIV,
+	SCPI_CMD_GET_HORIZ_TRIGGERPOS,
+	SCPI_CMD_GET_TRIGGER_SOURCE,
+	SCPI_CMD_GET_TRIGGER_SLOPE,
+	SCPI_CMD_GET_TRIGGER_PATTERN,
+	SCPI_CMD_GET_HIGH_RESOLUTION,
+	SCPI_CMD_GET_PEAK_DETECTION,
+	SCPI_CMD_GET_SAMPLE_RATE,
+};
+
+static int scope_state_parse(struct sr_scpi_batch *batch,
+			     const struct scope_config *config,
+			     struct scope_state *state)
 {
-	struct dev_context *devc;
-	struct scope_state *state;
-	const struct scope_config *config;
+	const char *resp;
+	char *tmp_str;
 	float tmp_float;
 	unsigned int i;
-	char *tmp_str;
-
-	devc = sdi->priv;
-	config = devc->model_config;
-	state = devc->model_state;
-
-	sr_info("Fetching scope state");
-
-	if (analog_channel_state_get(sdi, config, state) != SR_OK)
-		return SR_ERR;
-
-	if (digital_channel_state_get(sdi, config, state) != SR_OK)
-		return SR_ERR;
-
-	if (sr_scpi_get_string(sdi->conn,
-			(*config->scpi_dialect)[SCPI_CMD_GET_TIMEBASE],
-			&tmp_str) != SR_OK)
-		return SR_ERR;
+	int idx;
 
-	if (array_float_get(tmp_str, ARRAY_AND_SIZE(timebases), &i) != SR_OK) {
-		g_free(tmp_str);
+	idx = 0;
+	resp = sr_scpi_batch_get_string(batch, idx++);
+	if (!resp || array_float_get((char *)resp, ARRAY_AND_SIZE(timebases), &i) != SR_OK) {
 		sr_err("Could not determine array index for time base.");
 		return SR_ERR;
 	}
-	g_free(tmp_str);
-
 	state->timebase = i;
 
 	/* Determine the number of horizontal (x) divisions. */
-	if (sr_scpi_get_int(sdi->conn,
-	    (*config->scpi_dialect)[SCPI_CMD_GET_HORIZONTAL_DIV],
-	    (int *)&config->num_xdivs) != SR_OK)
+	resp = sr_scpi_batch_get_string(batch, idx++);
+	if (!resp || sr_atoi(resp, (int *)&config->num_xdivs) != SR_OK)
 		return SR_ERR;
 
-	if (sr_scpi_get_float(sdi->conn,
-			(*config->scpi_dialect)[SCPI_CMD_GET_HORIZ_TRIGGERPOS],
-			&tmp_float) != SR_OK)
+	if (sr_scpi_batch_get_float(batch, idx++, &tmp_float) != SR_OK)
 		return SR_ERR;
 	state->horiz_triggerpos = tmp_float /
 		(((double) (*config->timebases)[state->timebase][0] /
@@ -1112,48 +1142,72 @@ SR_PRIV int hmo_scope_state_get(struct sr_dev_inst *sdi)
 	state->horiz_triggerpos -= 0.5;
 	state->horiz_triggerpos *= -1;
 
-	if (scope_state_get_array_option(sdi->conn,
-			(*config->scpi_dialect)[SCPI_CMD_GET_TRIGGER_SOURCE],
+	if (scope_state_get_array_option(sr_scpi_batch_get_string(batch, idx++),
 			config->trigger_sources, config->num_trigger_sources,
 			&state->trigger_source) != SR_OK)
 		return SR_ERR;
 
-	if (scope_state_get_array_option(sdi->conn,
-			(*config->scpi_dialect)[SCPI_CMD_GET_TRIGGER_SLOPE],
+	if (scope_state_get_array_option(sr_scpi_batch_get_string(batch, idx++),
 			config->trigger_slopes, config->num_trigger_slopes,
 			&state->trigger_slope) != SR_OK)
 		return SR_ERR;
 
-	if (sr_scpi_get_string(sdi->conn,
-			       (*config->scpi_dialect)[SCPI_CMD_GET_TRIGGER_PATTERN],
-			       &tmp_str) != SR_OK)
+	if (!(resp = sr_scpi_batch_get_string(batch, idx++)))
 		return SR_ERR;
+	tmp_str = g_strdup(resp);
 	strncpy(state->trigger_pattern,
 		sr_scpi_unquote_string(tmp_str),
 		MAX_ANALOG_CHANNEL_COUNT + MAX_DIGITAL_CHANNEL_COUNT);
 	g_free(tmp_str);
 
-	if (sr_scpi_get_string(sdi->conn,
-			     (*config->scpi_dialect)[SCPI_CMD_GET_HIGH_RESOLUTION],
-			     &tmp_str) != SR_OK)
+	if (!(resp = sr_scpi_batch_get_string(batch, idx++)))
 		return SR_ERR;
-	if (!strcmp("OFF", tmp_str))
-		state->high_resolution = FALSE;
-	else
-		state->high_resolution = TRUE;
-	g_free(tmp_str);
+	state->high_resolution = strcmp("OFF", resp) != 0;
 
-	if (sr_scpi_get_string(sdi->conn,
-			     (*config->scpi_dialect)[SCPI_CMD_GET_PEAK_DETECTION],
-			     &tmp_str) != SR_OK)
+	if (!(resp = sr_scpi_batch_get_string(batch, idx++)))
+		return SR_ERR;
+	state->peak_detection = strcmp("OFF", resp) != 0;
+
+	if (sr_scpi_batch_get_float(batch, idx++, &tmp_float) != SR_OK)
+		return SR_ERR;
+	state->sample_rate = tmp_float;
+
+	return SR_OK;
+}
+
+SR_PRIV int hmo_scope_state_get(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct scope_state *state;
+	const struct scope_config *config;
+	struct sr_scpi_batch *batch;
+	unsigned int i;
+	int ret;
+
+	devc = sdi->priv;
+	config = devc->model_config;
+	state = devc->model_state;
+
+	sr_info("Fetching scope state");
+
+	if (analog_channel_state_get(sdi, config, state) != SR_OK)
+		return SR_ERR;
+
+	if (digital_channel_state_get(sdi, config, state) != SR_OK)
 		return SR_ERR;
-	if (!strcmp("OFF", tmp_str))
-		state->peak_detection = FALSE;
-	else
-		state->peak_detection = TRUE;
-	g_free(tmp_str);
 
-	if (hmo_update_sample_rate(sdi) != SR_OK)
+	/* Query the horizontal, trigger and acquisition settings together. */
+	batch = sr_scpi_batch_new(sdi->conn);
+	for (i = 0; i < ARRAY_SIZE(state_queries); i++)
+		sr_scpi_batch_add(batch,
+			(*config->scpi_dialect)[state_queries[i]]);
+	if (sr_scpi_batch_run(batch) != SR_OK) {
+		sr_scpi_batch_free(batch);
+		return SR_ERR;
+	}
+	ret = scope_state_parse(batch, config, state);
+	sr_scpi_batch_free(batch);
+	if (ret != SR_OK)
 		return SR_ERR;
 
 	sr_info("Fetching finished.");
@@ -200,7 +200,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	else
 		conn_devices = NULL;
 
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			struct sr_usb_dev_inst *usb = NULL;
@@ -222,7 +222,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		    des.idProduct != H4032L_USB_PRODUCT)
 			continue;
 
-		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+		if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 			continue;
 
 		sdi = g_malloc0(sizeof(struct sr_dev_inst));
@@ -605,6 +605,16 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	return h4032l_stop(sdi);
 }
 
+static void clear_helper(struct dev_context *devc)
+{
+	g_free(devc->data_buf);
+}
+
+static int dev_clear(const struct sr_dev_driver *di)
+{
+	return std_dev_clear_with_callback(di, (std_dev_clear_callback)clear_helper);
+}
+
 static struct sr_dev_driver hantek_4032l_driver_info = {
 	.name = "hantek-4032l",
 	.longname = "Hantek 4032L",
@@ -613,7 +623,7 @@ static struct sr_dev_driver hantek_4032l_driver_info = {
 	.cleanup = std_cleanup,
 	.scan = scan,
 	.dev_list = std_dev_list,
-	.dev_clear = std_dev_clear,
+	.dev_clear = dev_clear,
 	.config_get = config_get,
 	.config_set = config_set,
 	.config_list = config_list,
@@ -71,11 +71,7 @@ static void free_transfer(struct libusb_transfer *transfer)
 	struct dev_context *devc = sdi->priv;
 	unsigned int i;
 
-	if ((transfer->buffer != (unsigned char *)&devc->cmd_pkt) &&
-	    (transfer->buffer != devc->buf)) {
-		g_free(transfer->buffer);
-	}
-
+	/* All transfer buffers are owned by the device context. */
 	transfer->buffer = NULL;
 	libusb_free_transfer(transfer);
 
@@ -191,14 +187,19 @@ void LIBUSB_CALL h4032l_data_transfer_callback(struct libusb_transfer *transfer)
 
 	/* Close data receiving. */
 	if (devc->remaining_samples == 0) {
-		if (buf[num_samples] != H4032L_END_PACKET_MAGIC)
+		if (num_samples < max_samples &&
+		    buf[num_samples] != H4032L_END_PACKET_MAGIC)
 			sr_err("Mismatch magic number of end poll.");
 
 		abort_acquisition(devc);
 		free_transfer(transfer);
 	} else {
-		if (((devc->submitted_transfers - 1) * H4032L_DATA_BUFFER_SIZE) <
-		    (int32_t)(devc->remaining_samples * sizeof(uint32_t)))
+		/*
+		 * Only keep as many transfers in flight as are needed
+		 * for the rest of the capture (plus the end packet).
+		 */
+		if ((devc->submitted_transfers - 1) * (uint64_t)devc->transfer_size <
+		    (uint64_t)devc->remaining_samples * sizeof(uint32_t))
 			resubmit_transfer(transfer);
 		else
 			free_transfer(transfer);
@@ -359,7 +360,8 @@ SR_PRIV int h4032l_start_data_transfers(const struct sr_dev_inst *sdi)
 	struct dev_context *devc = sdi->priv;
 	struct sr_usb_dev_inst *usb = sdi->conn;
 	struct libusb_transfer *transfer;
-	uint8_t *buf;
+	uint64_t remaining_size;
+	size_t transfer_size, buf_size;
 	unsigned int num_transfers;
 	unsigned int i;
 	int ret;
@@ -367,25 +369,45 @@ SR_PRIV int h4032l_start_data_transfers(const struct sr_dev_inst *sdi)
 	devc->submitted_transfers = 0;
 
 	/*
-	 * Set number of data transfers regarding to size of buffer.
-	 * FPGA version 0 can't transfer multiple transfers at once.
+	 * FPGA version 0 can't transfer multiple transfers at once, so
+	 * stick with a single small transfer. Newer versions get a deep
+	 * queue of large transfers, sized to the rest of the capture,
+	 * which keeps the bus busy while completed buffers are sent.
 	 */
-	if ((num_transfers = MIN(devc->remaining_samples * sizeof(uint32_t) /
-	    H4032L_DATA_BUFFER_SIZE, devc->fpga_version ?
-	    H4032L_DATA_TRANSFER_MAX_NUM : 1)) == 0)
+	remaining_size = (uint64_t)devc->remaining_samples * sizeof(uint32_t);
+	if (devc->fpga_version) {
+		transfer_size = H4032L_DATA_TRANSFER_SIZE;
+		num_transfers = MIN((remaining_size + transfer_size - 1) /
+			transfer_size, H4032L_DATA_TRANSFER_MAX_NUM);
+	} else {
+		transfer_size = H4032L_DATA_BUFFER_SIZE;
 		num_transfers = 1;
+	}
+	if (num_transfers == 0)
+		num_transfers = 1;
+
+	/*
+	 * The transfer buffers are allocated once and reused by every
+	 * following acquisition, they only get reallocated on growth.
+	 */
+	buf_size = num_transfers * transfer_size;
+	if (devc->data_buf_size < buf_size) {
+		g_free(devc->data_buf);
+		devc->data_buf = g_malloc(buf_size);
+		devc->data_buf_size = buf_size;
+	}
+	devc->transfer_size = transfer_size;
 
 	g_free(devc->transfers);
-	devc->transfers = g_malloc(sizeof(*devc->transfers) * num_transfers);
+	devc->transfers = g_malloc0(sizeof(*devc->transfers) * num_transfers);
 	devc->num_transfers = num_transfers;
 
 	for (i = 0; i < num_transfers; i++) {
-		buf = g_malloc(H4032L_DATA_BUFFER_SIZE);
 		transfer = libusb_alloc_transfer(0);
 
 		libusb_fill_bulk_transfer(transfer, usb->devhdl,
 			6 | LIBUSB_ENDPOINT_IN,
-			buf, H4032L_DATA_BUFFER_SIZE,
+			devc->data_buf + i * transfer_size, transfer_size,
 			h4032l_data_transfer_callback,
 			(void *)sdi, H4032L_USB_TIMEOUT);
 
@@ -394,7 +416,6 @@ SR_PRIV int h4032l_start_data_transfers(const struct sr_dev_inst *sdi)
 			sr_err("Failed to submit transfer: %s.",
 			       libusb_error_name(ret));
 			libusb_free_transfer(transfer);
-			g_free(buf);
 			abort_acquisition(devc);
 			return SR_ERR;
 		}
@@ -468,7 +489,7 @@ SR_PRIV int h4032l_dev_open(struct sr_dev_inst *sdi)
 	int ret = SR_ERR, i, device_count;
 	char connection_id[64];
 
-	device_count = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	device_count = usb_get_device_list(drvc->sr_ctx, &devlist);
 	if (device_count < 0) {
 		sr_err("Failed to get device list: %s.",
 		       libusb_error_name(device_count));
@@ -485,7 +506,7 @@ SR_PRIV int h4032l_dev_open(struct sr_dev_inst *sdi)
 		if ((sdi->status == SR_ST_INITIALIZING) ||
 		    (sdi->status == SR_ST_INACTIVE)) {
 			/* Check device by its physical USB bus/port address. */
-			if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+			if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 				continue;
 
 			if (strcmp(sdi->connection_id, connection_id))
@@ -34,6 +34,7 @@
 #define H4032L_USB_PRODUCT 0x4032
 
 #define H4032L_DATA_BUFFER_SIZE (2 * 1024)
+#define H4032L_DATA_TRANSFER_SIZE (64 * 1024)
 #define H4032L_DATA_TRANSFER_MAX_NUM 32
 
 #define H4043L_NUM_SAMPLES_MIN (2 * 1024)
@@ -163,6 +164,9 @@ struct dev_context {
 	struct h4032l_cmd_pkt cmd_pkt;
 	unsigned int num_transfers;
 	struct libusb_transfer **transfers;
+	size_t transfer_size;
+	uint8_t *data_buf;
+	size_t data_buf_size;
 	uint8_t buf[512];
 	uint64_t capture_ratio;
 	uint32_t trigger_pos;
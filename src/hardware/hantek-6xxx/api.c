@@ -40,6 +40,11 @@ static const uint32_t devopts[] = {
 	SR_CONF_LIMIT_MSEC | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_NUM_VDIV | SR_CONF_GET,
+	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
+	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_TRIGGER_HYSTERESIS | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_TRANSFER_MSEC | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_BUFFER_MSEC | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const uint32_t devopts_cg[] = {
@@ -47,6 +52,14 @@ static const uint32_t devopts_cg[] = {
 	SR_CONF_VDIV | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 };
 
+static const int32_t trigger_matches[] = {
+	SR_TRIGGER_RISING,
+	SR_TRIGGER_FALLING,
+	SR_TRIGGER_EDGE,
+	SR_TRIGGER_OVER,
+	SR_TRIGGER_UNDER,
+};
+
 static const char *channel_names[] = {
 	"CH1", "CH2",
 };
@@ -162,6 +175,7 @@ static struct sr_dev_inst *hantek_6xxx_dev_new(const struct hantek_6xxx_profile
 	devc->profile = prof;
 	devc->dev_state = IDLE;
 	devc->samplerate = DEFAULT_SAMPLERATE;
+	usb_stream_init(&devc->stream, 20, 500, NUM_STREAM_TRANSFERS);
 
 	sdi->priv = devc;
 
@@ -234,7 +248,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		conn_devices = NULL;
 
 	/* Find all Hantek 60xx devices and upload firmware to all of them. */
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -252,7 +266,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 		libusb_get_device_descriptor(devlist[i], &des);
 
-		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+		if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 			continue;
 
 		prof = NULL;
@@ -389,6 +403,15 @@ static int config_get(uint32_t key, GVariant **data,
 		case SR_CONF_LIMIT_SAMPLES:
 			*data = g_variant_new_uint64(devc->limit_samples);
 			break;
+		case SR_CONF_CAPTURE_RATIO:
+			*data = g_variant_new_uint64(devc->capture_ratio);
+			break;
+		case SR_CONF_TRIGGER_HYSTERESIS:
+			*data = g_variant_new_double(devc->trigger_hysteresis);
+			break;
+		case SR_CONF_USB_TRANSFER_MSEC:
+		case SR_CONF_USB_BUFFER_MSEC:
+			return usb_stream_config_get(&devc->stream, key, data);
 		case SR_CONF_CONN:
 			if (!sdi->conn)
 				return SR_ERR_ARG;
@@ -443,6 +466,15 @@ static int config_set(uint32_t key, GVariant *data,
 		case SR_CONF_LIMIT_SAMPLES:
 			devc->limit_samples = g_variant_get_uint64(data);
 			break;
+		case SR_CONF_CAPTURE_RATIO:
+			devc->capture_ratio = g_variant_get_uint64(data);
+			break;
+		case SR_CONF_TRIGGER_HYSTERESIS:
+			devc->trigger_hysteresis = g_variant_get_double(data);
+			break;
+		case SR_CONF_USB_TRANSFER_MSEC:
+		case SR_CONF_USB_BUFFER_MSEC:
+			return usb_stream_config_set(&devc->stream, key, data);
 		default:
 			return SR_ERR_NA;
 		}
@@ -490,6 +522,9 @@ static int config_list(uint32_t key, GVariant **data,
 		case SR_CONF_SAMPLERATE:
 			*data = std_gvar_samplerates(ARRAY_AND_SIZE(samplerates));
 			break;
+		case SR_CONF_TRIGGER_MATCH:
+			*data = std_gvar_array_i32(ARRAY_AND_SIZE(trigger_matches));
+			break;
 		default:
 			return SR_ERR_NA;
 		}
@@ -516,155 +551,289 @@ static int config_list(uint32_t key, GVariant **data,
 	return SR_OK;
 }
 
-/* Minimise data amount for limit_samples and limit_msec limits. */
-static uint32_t data_amount(const struct sr_dev_inst *sdi)
+/*
+ * Send a chunk of samples, up to the sample limit. While a soft trigger
+ * is waiting, nothing but the pre-trigger samples and the data from the
+ * trigger position onwards go out. Returns the number of samples sent.
+ */
+static uint64_t send_chunk(struct sr_dev_inst *sdi, const uint8_t *buf,
+		size_t num_samples)
 {
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog[NUM_CHANNELS];
+	struct sr_analog_encoding encoding[NUM_CHANNELS];
+	struct sr_analog_meaning meaning[NUM_CHANNELS];
+	struct sr_analog_spec spec[NUM_CHANNELS];
+	GSList chonly[NUM_CHANNELS];
 	struct dev_context *devc = sdi->priv;
-	uint32_t data_left, data_left_2, i;
-	int32_t time_left;
-
-	if (devc->limit_msec) {
-		time_left = devc->limit_msec - (g_get_monotonic_time() - devc->aq_started) / 1000;
-		data_left = devc->samplerate * MAX(time_left, 0) * NUM_CHANNELS / 1000;
-	} else if (devc->limit_samples) {
-		data_left = (devc->limit_samples - devc->samp_received) * NUM_CHANNELS;
-	} else {
-		data_left = devc->samplerate * NUM_CHANNELS;
+	const uint64_t *vdiv;
+	const GSList *l;
+	uint64_t room, sent, post;
+	float vdivlog;
+	int ch, n, digits, offset, pre_trigger_samples;
+	uint8_t *data;
+	size_t i;
+
+	/*
+	 * Voltage values are encoded as a value 0-255, where the value
+	 * is a point in the range represented by the vdiv setting. There
+	 * are 10 vertical divs, so e.g. 500mV/div represents 5V
+	 * peak-to-peak where 0 = -2.5V and 255 = +2.5V. Send the ADC
+	 * codes as they are, the encoding's scale and offset express
+	 * the range.
+	 *
+	 * The device always sends data for both channels. If a channel
+	 * is disabled, it contains a copy of the enabled channel's data.
+	 * However, we only send the requested channels to the bus.
+	 */
+	n = 0;
+	for (ch = 0, l = devc->enabled_channels; ch < NUM_CHANNELS && l;
+			ch++, l = l->next) {
+		if (!devc->ch_enabled[ch])
+			continue;
+
+		sr_analog_init(&analog[n], &encoding[n], &meaning[n], &spec[n], 0);
+		data = devc->conv_buffer + n * (devc->stream.alloc_size / NUM_CHANNELS);
+		for (i = 0; i < num_samples; i++)
+			data[i] = buf[i * NUM_CHANNELS + ch];
+		analog[n].data = data;
+		analog[n].num_samples = num_samples;
+		analog[n].meaning->mq = SR_MQ_VOLTAGE;
+		analog[n].meaning->unit = SR_UNIT_VOLT;
+		analog[n].meaning->mqflags = 0;
+		chonly[n].data = l->data;
+		chonly[n].next = NULL;
+		analog[n].meaning->channels = &chonly[n];
+
+		analog[n].encoding->unitsize = sizeof(devc->conv_buffer[0]);
+		analog[n].encoding->is_signed = FALSE;
+		analog[n].encoding->is_float = FALSE;
+		analog[n].encoding->is_bigendian = FALSE;
+		vdiv = devc->vdivs[devc->voltage[ch]];
+		sr_rational_set(&analog[n].encoding->scale,
+			VDIV_MULTIPLIER * vdiv[0], 255 * vdiv[1]);
+		sr_rational_set(&analog[n].encoding->offset,
+			-(int64_t)(VDIV_MULTIPLIER * vdiv[0]), 2 * vdiv[1]);
+
+		vdivlog = log10f(RANGE(ch) / 255);
+		digits = -(int)vdivlog + (vdivlog < 0.0);
+		analog[n].encoding->digits = digits;
+		analog[n].spec->spec_digits = digits;
+		n++;
+	}
+	if (!n)
+		return 0;
+
+	room = UINT64_MAX;
+	if (devc->limit_samples)
+		room = devc->limit_samples - devc->samp_received;
+
+	offset = 0;
+	sent = 0;
+	if (!devc->trigger_fired) {
+		offset = soft_trigger_analog_check(devc->sta, NULL, analog, n,
+			&pre_trigger_samples);
+		if (offset < -1) {
+			sr_err("Analog soft trigger failed: %d.", offset);
+			sr_dev_acquisition_stop(sdi);
+			return 0;
+		}
+		if (offset < 0)
+			return 0;
+		devc->trigger_fired = TRUE;
+		sent = pre_trigger_samples;
+	}
+	if (room <= sent)
+		return sent;
+	post = MIN(num_samples - offset, room - sent);
+
+	packet.type = SR_DF_ANALOG;
+	for (i = 0; i < (size_t)n; i++) {
+		analog[i].data = (uint8_t *)analog[i].data + offset;
+		analog[i].num_samples = post;
+		packet.payload = &analog[i];
+		sr_session_send(sdi, &packet);
 	}
 
-	/* Round up to nearest power of two. */
-	for (i = MIN_PACKET_SIZE; i < data_left; i *= 2)
-		;
-	data_left_2 = i;
+	return sent + post;
+}
 
-	sr_spew("data_amount: %u (rounded to power of 2: %u)", data_left, data_left_2);
+static void free_transfer(struct libusb_transfer *transfer)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	unsigned int i;
+
+	sdi = transfer->user_data;
+	devc = sdi->priv;
 
-	return data_left_2;
+	for (i = 0; i < devc->num_transfers; i++) {
+		if (devc->transfers[i] == transfer)
+			devc->transfers[i] = NULL;
+	}
+	usb_transfer_buf_free(transfer->buffer);
+	libusb_free_transfer(transfer);
 }
 
-static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
-		int num_samples)
+static void abort_transfers(struct dev_context *devc)
 {
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_analog analog;
-	struct sr_analog_encoding encoding;
-	struct sr_analog_meaning meaning;
-	struct sr_analog_spec spec;
-	struct dev_context *devc = sdi->priv;
-	GSList *channels = devc->enabled_channels;
+	unsigned int i;
 
-	const float ch_bit[] = { RANGE(0) / 255, RANGE(1) / 255 };
-	const float ch_center[] = { RANGE(0) / 2, RANGE(1) / 2 };
+	for (i = 0; i < devc->num_transfers; i++) {
+		if (devc->transfers[i])
+			libusb_cancel_transfer(devc->transfers[i]);
+	}
+}
 
-	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
+static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer);
 
-	packet.type = SR_DF_ANALOG;
-	packet.payload = &analog;
+/*
+ * Queue up a set of transfers, which get resubmitted as they complete.
+ * Their number and length follow from the samplerate and the stream
+ * parameters, see usb_stream_start().
+ */
+static int start_transfers(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	struct libusb_transfer *transfer;
+	unsigned int i, timeout;
+	uint8_t *buf;
+	int ret;
+
+	devc = sdi->priv;
+	usb = sdi->conn;
 
-	analog.num_samples = num_samples;
-	analog.meaning->mq = SR_MQ_VOLTAGE;
-	analog.meaning->unit = SR_UNIT_VOLT;
-	analog.meaning->mqflags = 0;
+	usb_stream_start(&devc->stream,
+		devc->samplerate * NUM_CHANNELS / 1000, MIN_PACKET_SIZE);
+	timeout = usb_stream_timeout(&devc->stream);
 
-	analog.data = g_try_malloc(num_samples * sizeof(float));
-	if (!analog.data) {
+	devc->num_transfers = devc->stream.num_transfers;
+	devc->transfers = g_new0(struct libusb_transfer *, devc->num_transfers);
+	/* One conversion buffer per channel, see send_chunk(). */
+	devc->conv_buffer = g_try_malloc(devc->stream.alloc_size);
+	if (!devc->conv_buffer) {
 		sr_err("Analog data buffer malloc failed.");
-		devc->dev_state = STOPPING;
-		return;
+		return SR_ERR_MALLOC;
 	}
 
-	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
-		if (!devc->ch_enabled[ch])
-			continue;
-
-		float vdivlog = log10f(ch_bit[ch]);
-		int digits = -(int)vdivlog + (vdivlog < 0.0);
-		analog.encoding->digits = digits;
-		analog.spec->spec_digits = digits;
-		analog.meaning->channels = g_slist_append(NULL, channels->data);
-
-		for (int i = 0; i < num_samples; i++) {
-			/*
-			 * The device always sends data for both channels. If a channel
-			 * is disabled, it contains a copy of the enabled channel's
-			 * data. However, we only send the requested channels to
-			 * the bus.
-			 *
-			 * Voltage values are encoded as a value 0-255, where the
-			 * value is a point in the range represented by the vdiv
-			 * setting. There are 10 vertical divs, so e.g. 500mV/div
-			 * represents 5V peak-to-peak where 0 = -2.5V and 255 = +2.5V.
-			 */
-			((float *)analog.data)[i] = ch_bit[ch] * *(buf + i * 2 + ch) - ch_center[ch];
+	for (i = 0; i < devc->num_transfers; i++) {
+		buf = usb_transfer_buf_alloc(usb->devhdl, devc->stream.alloc_size);
+		if (!buf) {
+			sr_err("Failed to malloc USB endpoint buffer.");
+			return SR_ERR_MALLOC;
 		}
-
-		sr_session_send(sdi, &packet);
-		g_slist_free(analog.meaning->channels);
-
-		channels = channels->next;
+		transfer = libusb_alloc_transfer(0);
+		libusb_fill_bulk_transfer(transfer, usb->devhdl, HANTEK_EP_IN,
+			buf, devc->stream.length, receive_transfer,
+			(void *)sdi, timeout);
+		if ((ret = libusb_submit_transfer(transfer)) != 0) {
+			sr_err("Failed to submit transfer: %s.",
+				libusb_error_name(ret));
+			libusb_free_transfer(transfer);
+			usb_transfer_buf_free(buf);
+			return SR_ERR;
+		}
+		devc->transfers[i] = transfer;
+		devc->submitted_transfers++;
 	}
-	g_free(analog.data);
+
+	return SR_OK;
 }
 
 /*
  * Called by libusb (as triggered by handle_event()) when a transfer comes in.
- * Only channel data comes in asynchronously, and all transfers for this are
- * queued up beforehand, so this just needs to chuck the incoming data onto
- * the libsigrok session bus.
+ * Only channel data comes in, through a set of transfers which get
+ * resubmitted until the acquisition stops.
  */
 static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
+	uint64_t samples_received;
+	int64_t start_us;
+	int ret;
 
 	sdi = transfer->user_data;
 	devc = sdi->priv;
 
+	start_us = g_get_monotonic_time();
+	devc->submitted_transfers--;
+
 	if (devc->dev_state == FLUSH) {
-		g_free(transfer->buffer);
-		libusb_free_transfer(transfer);
+		free_transfer(transfer);
 		devc->dev_state = CAPTURE;
 		devc->aq_started = g_get_monotonic_time();
-		read_channel(sdi, data_amount(sdi));
+		if (start_transfers(sdi) != SR_OK) {
+			devc->dev_state = STOPPING;
+			abort_transfers(devc);
+		}
 		return;
 	}
 
-	if (devc->dev_state != CAPTURE)
+	if (devc->dev_state != CAPTURE) {
+		free_transfer(transfer);
 		return;
+	}
 
-	sr_spew("receive_transfer(): calculated samplerate == %" PRIu64 "ks/s",
-		(uint64_t)(transfer->actual_length * 1000 /
-		(g_get_monotonic_time() - devc->read_start_ts + 1) /
-		NUM_CHANNELS));
+	switch (transfer->status) {
+	case LIBUSB_TRANSFER_COMPLETED:
+	case LIBUSB_TRANSFER_TIMED_OUT: /* We may have received some data though. */
+		break;
+	default:
+		sr_err("Transfer failed: %s.", libusb_error_name(transfer->status));
+		free_transfer(transfer);
+		sr_dev_acquisition_stop(sdi);
+		return;
+	}
+
+	/*
+	 * No transfer was queued while this one got handled. The device
+	 * has little buffer memory of its own, samples were likely lost.
+	 */
+	if (!devc->submitted_transfers) {
+		if (!devc->dropouts++)
+			sr_warn("Transfers ran out, sample data may be missing.");
+	}
 
 	sr_spew("receive_transfer(): status %s received %d bytes.",
 		libusb_error_name(transfer->status), transfer->actual_length);
 
-	if (transfer->actual_length == 0)
-		/* Nothing to send to the bus. */
+	samples_received = transfer->actual_length / NUM_CHANNELS;
+	if (samples_received)
+		devc->samp_received += send_chunk(sdi, transfer->buffer,
+			samples_received);
+	if (devc->dev_state != CAPTURE) {
+		free_transfer(transfer);
 		return;
-
-	unsigned samples_received = transfer->actual_length / NUM_CHANNELS;
-	send_chunk(sdi, transfer->buffer, samples_received);
-	devc->samp_received += samples_received;
-
-	g_free(transfer->buffer);
-	libusb_free_transfer(transfer);
+	}
 
 	if (devc->limit_samples && devc->samp_received >= devc->limit_samples) {
 		sr_info("Requested number of samples reached, stopping. %"
 			PRIu64 " <= %" PRIu64, devc->limit_samples,
 			devc->samp_received);
+		free_transfer(transfer);
 		sr_dev_acquisition_stop(sdi);
-	} else if (devc->limit_msec && (g_get_monotonic_time() -
+		return;
+	}
+	if (devc->limit_msec && (g_get_monotonic_time() -
 			devc->aq_started) / 1000 >= devc->limit_msec) {
 		sr_info("Requested time limit reached, stopping. %d <= %d",
 			(uint32_t)devc->limit_msec,
 			(uint32_t)(g_get_monotonic_time() - devc->aq_started) / 1000);
+		free_transfer(transfer);
 		sr_dev_acquisition_stop(sdi);
-	} else {
-		read_channel(sdi, data_amount(sdi));
+		return;
+	}
+
+	transfer->length = usb_stream_completed(&devc->stream, start_us);
+	if ((ret = libusb_submit_transfer(transfer)) != 0) {
+		sr_err("Failed to resubmit transfer: %s.", libusb_error_name(ret));
+		free_transfer(transfer);
+		sr_dev_acquisition_stop(sdi);
+		return;
 	}
+	devc->submitted_transfers++;
 }
 
 static int read_channel(const struct sr_dev_inst *sdi, uint32_t amount)
@@ -674,8 +843,9 @@ static int read_channel(const struct sr_dev_inst *sdi, uint32_t amount)
 
 	devc = sdi->priv;
 
-	amount = MIN(amount, MAX_PACKET_SIZE);
 	ret = hantek_6xxx_get_channeldata(sdi, receive_transfer, amount);
+	if (ret == SR_OK)
+		devc->submitted_transfers++;
 	devc->read_start_ts = g_get_monotonic_time();
 
 	return ret;
@@ -701,15 +871,24 @@ static int handle_event(int fd, int revents, void *cb_data)
 	tv.tv_sec = tv.tv_usec = 0;
 	libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
 
-	if (devc->dev_state == STOPPING) {
-		/* We've been told to wind up the acquisition. */
+	/* Wind up the acquisition after the transfers were cancelled. */
+	if (devc->dev_state == STOPPING && !devc->submitted_transfers) {
 		sr_dbg("Stopping acquisition.");
 
 		hantek_6xxx_stop_data_collecting(sdi);
-		/*
-		 * TODO: Doesn't really cancel pending transfers so they might
-		 * come in after SR_DF_END is sent.
-		 */
+		usb_stream_stop(&devc->stream);
+		if (devc->dropouts)
+			sr_warn("Transfers ran out %" PRIu64 " times.",
+				devc->dropouts);
+
+		g_free(devc->transfers);
+		devc->transfers = NULL;
+		devc->num_transfers = 0;
+		g_free(devc->conv_buffer);
+		devc->conv_buffer = NULL;
+		soft_trigger_analog_free(devc->sta);
+		devc->sta = NULL;
+
 		usb_source_remove(sdi->session, drvc->sr_ctx);
 
 		std_session_send_df_end(sdi);
@@ -725,6 +904,8 @@ static int handle_event(int fd, int revents, void *cb_data)
 static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
+	struct sr_trigger *trigger;
+	int pre_trigger_samples;
 	struct sr_dev_driver *di = sdi->driver;
 	struct drv_context *drvc = di->context;
 
@@ -738,9 +919,24 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	if (hantek_6xxx_init(sdi) != SR_OK)
 		return SR_ERR;
 
+	devc->trigger_fired = TRUE;
+	if ((trigger = sr_session_trigger_get(sdi->session))) {
+		pre_trigger_samples = 0;
+		if (devc->limit_samples)
+			pre_trigger_samples = (devc->capture_ratio *
+				devc->limit_samples) / 100;
+		devc->sta = soft_trigger_analog_new(sdi, trigger,
+			pre_trigger_samples, devc->trigger_hysteresis, FALSE);
+		if (!devc->sta)
+			return SR_ERR;
+		devc->trigger_fired = FALSE;
+	}
+
 	std_session_send_df_header(sdi);
 
 	devc->samp_received = 0;
+	devc->dropouts = 0;
+	devc->submitted_transfers = 0;
 	devc->dev_state = FLUSH;
 
 	usb_source_add(sdi->session, drvc->sr_ctx, TICK,
@@ -758,7 +954,10 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	struct dev_context *devc;
 
 	devc = sdi->priv;
+	if (devc->dev_state == IDLE)
+		return SR_OK;
 	devc->dev_state = STOPPING;
+	abort_transfers(devc);
 
 	return SR_OK;
 }
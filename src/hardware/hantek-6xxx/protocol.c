@@ -33,7 +33,7 @@ SR_PRIV int hantek_6xxx_open(struct sr_dev_inst *sdi)
 	devc = sdi->priv;
 	usb = sdi->conn;
 
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		libusb_get_device_descriptor(devlist[i], &des);
 
@@ -46,7 +46,7 @@ SR_PRIV int hantek_6xxx_open(struct sr_dev_inst *sdi)
 			/*
 			 * Check device by its physical USB bus/port address.
 			 */
-			if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+			if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 				continue;
 
 			if (strcmp(sdi->connection_id, connection_id))
@@ -113,7 +113,7 @@ SR_PRIV int hantek_6xxx_get_channeldata(const struct sr_dev_inst *sdi,
 
 	usb = sdi->conn;
 
-	if (!(buf = g_try_malloc(data_amount))) {
+	if (!(buf = usb_transfer_buf_alloc(usb->devhdl, data_amount))) {
 		sr_err("Failed to malloc USB endpoint buffer.");
 		return SR_ERR_MALLOC;
 	}
@@ -125,7 +125,7 @@ SR_PRIV int hantek_6xxx_get_channeldata(const struct sr_dev_inst *sdi,
 			libusb_error_name(ret));
 		/* TODO: Free them all. */
 		libusb_free_transfer(transfer);
-		g_free(buf);
+		usb_transfer_buf_free(buf);
 		return SR_ERR;
 	}
 
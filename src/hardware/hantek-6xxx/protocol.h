@@ -68,11 +68,9 @@
 #define FLUSH_PACKET_SIZE	1024
 
 #define MIN_PACKET_SIZE		512
-#ifdef _WIN32
-#define MAX_PACKET_SIZE		(2 * 1024 * 1024)
-#else
-#define MAX_PACKET_SIZE		(12 * 1024 * 1024)
-#endif
+
+/* Upper bound for the number of queued streaming transfers. */
+#define NUM_STREAM_TRANSFERS	32
 
 #define HANTEK_EP_IN		0x86
 #define USB_INTERFACE		0
@@ -133,6 +131,13 @@ struct dev_context {
 
 	uint64_t read_start_ts;
 
+	struct usb_stream stream;
+	struct libusb_transfer **transfers;
+	unsigned int num_transfers;
+	unsigned int submitted_transfers;
+	uint8_t *conv_buffer;
+	uint64_t dropouts;
+
 	gboolean ch_enabled[NUM_CHANNELS];
 	int voltage[NUM_CHANNELS];
 	int coupling[NUM_CHANNELS];
@@ -145,6 +150,10 @@ struct dev_context {
 
 	uint64_t limit_msec;
 	uint64_t limit_samples;
+	uint64_t capture_ratio;
+	float trigger_hysteresis;
+	struct soft_trigger_analog *sta;
+	gboolean trigger_fired;
 };
 
 SR_PRIV int hantek_6xxx_open(struct sr_dev_inst *sdi);
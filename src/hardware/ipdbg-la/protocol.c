@@ -37,6 +37,9 @@
 
 #define BUFFER_SIZE 4
 
+/* Most sample data that gets received per main loop callback. */
+#define RECEIVE_BUDGET (4 * 1024 * 1024)
+
 /* Top-level command opcodes */
 #define CMD_SET_TRIGGER            0x00
 #define CMD_CFG_TRIGGER            0xF0
@@ -297,6 +300,10 @@ SR_PRIV int ipdbg_la_receive_data(int fd, int revents, void *cb_data)
 	struct ipdbg_la_tcp *tcp = sdi->conn;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	uint8_t discard[4096], *dst;
+	uint64_t total, keep;
+	size_t len, budget;
+	int recd;
 
 	if (!devc->raw_sample_buf) {
 		devc->raw_sample_buf =
@@ -307,26 +314,32 @@ SR_PRIV int ipdbg_la_receive_data(int fd, int revents, void *cb_data)
 		}
 	}
 
-	if (devc->num_transfers <
-		(devc->limit_samples_max * devc->data_width_bytes)) {
-		const size_t bufsize = 1024;
-		uint8_t buffer[bufsize];
-
-		const int recd = ipdbg_la_tcp_receive(tcp, buffer, bufsize);
-		if ( recd > 0) {
-			int num_move = (((devc->num_transfers + recd) <=
-							 (devc->limit_samples * devc->data_width_bytes))
-			?
-				recd
-			:
-				(int)((devc->limit_samples * devc->data_width_bytes) -
-						devc->num_transfers));
-			if ( num_move > 0 )
-				memcpy(&(devc->raw_sample_buf[devc->num_transfers]),
-						buffer, num_move);
-			devc->num_transfers += recd;
+	/*
+	 * Receive as much as is available, straight into the sample
+	 * buffer, in large blocks. Bytes beyond the sample limit (the
+	 * device always sends its full memory) get discarded. Limit the
+	 * amount per callback, to keep the main loop responsive.
+	 */
+	total = devc->limit_samples_max * devc->data_width_bytes;
+	keep = devc->limit_samples * devc->data_width_bytes;
+	budget = RECEIVE_BUDGET;
+	while (devc->num_transfers < total && budget > 0) {
+		if (devc->num_transfers < keep) {
+			dst = &devc->raw_sample_buf[devc->num_transfers];
+			len = keep - devc->num_transfers;
+		} else {
+			dst = discard;
+			len = MIN(sizeof(discard), total - devc->num_transfers);
 		}
-	} else {
+		len = MIN(len, budget);
+		recd = ipdbg_la_tcp_receive(tcp, dst, len);
+		if (recd <= 0)
+			break;
+		devc->num_transfers += recd;
+		budget -= recd;
+	}
+
+	if (devc->num_transfers >= total) {
 		if (devc->delay_value > 0) {
 			/* There are pre-trigger samples, send those first. */
 			packet.type = SR_DF_LOGIC;
@@ -199,39 +199,39 @@ SR_PRIV void itech_it8500_status_change(const struct sr_dev_inst *sdi,
 	old_bit = old_os & OS_OUT_FLAG;
 	new_bit = new_os & OS_OUT_FLAG;
 	if (old_bit != new_bit)
-		sr_session_send_meta(sdi,
+		sr_session_send_meta_boolean(sdi,
 			SR_CONF_ENABLED,
-			g_variant_new_boolean(new_bit));
+			new_bit);
 
 	/* Check if OVP status has changed. */
 	old_bit = old_ds & DS_OV_FLAG;
 	new_bit = new_ds & DS_OV_FLAG;
 	if (old_bit != new_bit)
-		sr_session_send_meta(sdi,
+		sr_session_send_meta_boolean(sdi,
 			SR_CONF_OVER_VOLTAGE_PROTECTION_ACTIVE,
-			g_variant_new_boolean(new_bit));
+			new_bit);
 
 	/* Check if OCP status has changed. */
 	old_bit = old_ds & DS_OC_FLAG;
 	new_bit = new_ds & DS_OC_FLAG;
 	if (old_bit != new_bit)
-		sr_session_send_meta(sdi,
+		sr_session_send_meta_boolean(sdi,
 			SR_CONF_OVER_CURRENT_PROTECTION_ACTIVE,
-			g_variant_new_boolean(new_bit));
+			new_bit);
 
 	/* Check if OTP status has changed. */
 	old_bit = old_ds & DS_OT_FLAG;
 	new_bit = new_ds & DS_OT_FLAG;
 	if (old_bit != new_bit)
-		sr_session_send_meta(sdi,
+		sr_session_send_meta_boolean(sdi,
 			SR_CONF_OVER_TEMPERATURE_PROTECTION_ACTIVE,
-			g_variant_new_boolean(new_bit));
+			new_bit);
 
 	/* Check if operating mode has changed. */
 	if (old_m != new_m) {
 		mode = itech_it8500_mode_to_string(new_m);
-		sr_session_send_meta(sdi, SR_CONF_REGULATION,
-			g_variant_new_string(mode));
+		sr_session_send_meta_string(sdi, SR_CONF_REGULATION,
+			mode);
 	}
 }
 
@@ -162,7 +162,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	/* Find all LA2016 devices and upload firmware to them. */
 	devices = NULL;
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -181,7 +181,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 		libusb_get_device_descriptor(devlist[i], &des);
 
-		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+		if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 			continue;
 
 		if (des.idVendor != LA2016_VID || des.idProduct != LA2016_PID)
@@ -250,7 +250,7 @@ static int la2016_dev_open(struct sr_dev_inst *sdi)
 	usb = sdi->conn;
 	ret = SR_ERR;
 
-	device_count = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	device_count = usb_get_device_list(drvc->sr_ctx, &devlist);
 	if (device_count < 0) {
 		sr_err("Failed to get device list: %s.", libusb_error_name(device_count));
 		return SR_ERR;
@@ -266,7 +266,7 @@ static int la2016_dev_open(struct sr_dev_inst *sdi)
 			/*
 			 * Check device by its physical USB bus/port address.
 			 */
-			if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+			if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 				continue;
 
 			if (strcmp(sdi->connection_id, connection_id))
@@ -539,67 +539,96 @@ static int config_list(uint32_t key, GVariant **data,
 	return SR_OK;
 }
 
-static void send_chunk(struct sr_dev_inst *sdi,
+static struct la2016_block *block_new(void)
+{
+	struct la2016_block *block;
+
+	block = g_malloc(sizeof(*block));
+	block->data = g_malloc(LA2016_BLOCK_SAMPLES * sizeof(uint16_t));
+	block->num_samples = 0;
+	block->trigger = FALSE;
+
+	return block;
+}
+
+static void block_free(struct la2016_block *block)
+{
+	g_free(block->data);
+	g_free(block);
+}
+
+/* Hand the decoded samples to the main loop, optionally the trigger. */
+static void block_push(struct dev_context *devc, gboolean trigger)
+{
+	struct la2016_block *block;
+
+	block = devc->block;
+	if (!block) {
+		if (!trigger)
+			return;
+		block = block_new();
+	}
+	block->trigger = trigger;
+	g_async_queue_push(devc->block_queue, block);
+	devc->block = NULL;
+}
+
+static void block_append(struct dev_context *devc,
+	uint16_t state, unsigned int count)
+{
+	struct la2016_block *block;
+	uint8_t *wp;
+	size_t n;
+
+	while (count) {
+		if (!devc->block)
+			devc->block = block_new();
+		block = devc->block;
+		n = MIN(count, LA2016_BLOCK_SAMPLES - block->num_samples);
+		wp = block->data + block->num_samples * sizeof(uint16_t);
+		block->num_samples += n;
+		count -= n;
+		while (n--)
+			write_u16le_inc(&wp, state);
+		if (block->num_samples == LA2016_BLOCK_SAMPLES)
+			block_push(devc, FALSE);
+	}
+}
+
+/* Runs in the decode thread, the main loop sends the blocks. */
+static void decode_chunk(struct sr_dev_inst *sdi,
 	const uint8_t *packets, unsigned int num_tfers)
 {
 	struct dev_context *devc;
-	struct sr_datafeed_logic logic;
-	struct sr_datafeed_packet sr_packet;
-	unsigned int max_samples, n_samples, total_samples, free_n_samples;
-	unsigned int i, j, k;
-	int do_signal_trigger;
-	uint16_t *wp;
+	unsigned int total_samples;
+	unsigned int i, k;
 	const uint8_t *rp;
 	uint16_t state;
 	uint8_t repetitions;
 
 	devc = sdi->priv;
 
-	logic.unitsize = 2;
-	logic.data = devc->convbuffer;
-
-	sr_packet.type = SR_DF_LOGIC;
-	sr_packet.payload = &logic;
-
-	max_samples = devc->convbuffer_size / 2;
-	n_samples = 0;
-	wp = (uint16_t *)devc->convbuffer;
 	total_samples = 0;
-	do_signal_trigger = 0;
 
 	if (devc->had_triggers_configured && devc->reading_behind_trigger == 0 && devc->info.n_rep_packets_before_trigger == 0) {
-		std_session_send_df_trigger(sdi);
+		block_push(devc, TRUE);
 		devc->reading_behind_trigger = 1;
 	}
 
 	rp = packets;
 	for (i = 0; i < num_tfers; i++) {
 		for (k = 0; k < NUM_PACKETS_IN_CHUNK; k++) {
-			free_n_samples = max_samples - n_samples;
-			if (free_n_samples < 256 || do_signal_trigger) {
-				logic.length = n_samples * 2;
-				sr_session_send(sdi, &sr_packet);
-				n_samples = 0;
-				wp = (uint16_t *)devc->convbuffer;
-				if (do_signal_trigger) {
-					std_session_send_df_trigger(sdi);
-					do_signal_trigger = 0;
-				}
-			}
-
 			state = read_u16le_inc(&rp);
 			repetitions = read_u8_inc(&rp);
-			for (j = 0; j < repetitions; j++)
-				*wp++ = state;
+			block_append(devc, state, repetitions);
 
-			n_samples += repetitions;
 			total_samples += repetitions;
 			devc->total_samples += repetitions;
 			if (!devc->reading_behind_trigger) {
 				devc->n_reps_until_trigger--;
 				if (devc->n_reps_until_trigger == 0) {
 					devc->reading_behind_trigger = 1;
-					do_signal_trigger = 1;
+					block_push(devc, TRUE);
 					sr_dbg("  here is trigger position after %" PRIu64 " samples, %.6fms",
 					       devc->total_samples,
 					       (double)devc->total_samples / devc->cur_samplerate * 1e3);
@@ -608,14 +637,73 @@ static void send_chunk(struct sr_dev_inst *sdi,
 		}
 		(void)read_u8_inc(&rp); /* Skip sequence number. */
 	}
-	if (n_samples) {
-		logic.length = n_samples * 2;
-		sr_session_send(sdi, &sr_packet);
-		if (do_signal_trigger) {
-			std_session_send_df_trigger(sdi);
+	sr_dbg("decode_chunk done after %d samples", total_samples);
+}
+
+/*
+ * Decode received bulk data off the USB callbacks, so that the next
+ * reads get submitted without waiting for the decoder. The decoded
+ * blocks go back to the main loop, which sends them to the session.
+ */
+static gpointer decode_thread_run(gpointer data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct la2016_chunk *chunk;
+	int64_t start_us;
+
+	sdi = data;
+	devc = sdi->priv;
+	sr_thread_policy_apply(sr_dev_inst_context(sdi), SR_THREAD_IO);
+
+	while ((chunk = g_async_queue_pop(devc->decode_queue))->buf) {
+		start_us = g_get_monotonic_time();
+		decode_chunk(sdi, chunk->buf, chunk->length / TRANSFER_PACKET_LENGTH);
+		devc->decode_us += g_get_monotonic_time() - start_us;
+		g_async_queue_push(devc->free_queue, chunk->buf);
+		g_free(chunk);
+	}
+	g_free(chunk);
+	block_push(devc, FALSE);
+
+	return NULL;
+}
+
+/* Send the blocks which the decode thread queued, in the main loop. */
+static int send_blocks(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct la2016_block *block;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	int ret;
+
+	devc = sdi->priv;
+
+	ret = SR_OK;
+	while ((block = g_async_queue_try_pop(devc->block_queue))) {
+		if (block->num_samples && ret == SR_OK) {
+			logic.length = block->num_samples * sizeof(uint16_t);
+			logic.unitsize = sizeof(uint16_t);
+			logic.data = block->data;
+			packet.type = SR_DF_LOGIC;
+			packet.payload = &logic;
+			ret = sr_session_send(sdi, &packet);
 		}
+		if (block->trigger && ret == SR_OK)
+			ret = std_session_send_df_trigger(sdi);
+		block_free(block);
 	}
-	sr_dbg("send_chunk done after %d samples", total_samples);
+
+	return ret;
+}
+
+static void decode_thread_stop(struct dev_context *devc)
+{
+	struct la2016_chunk *chunk;
+
+	chunk = g_malloc0(sizeof(*chunk));
+	g_async_queue_push(devc->decode_queue, chunk);
 }
 
 static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
@@ -623,6 +711,8 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
+	struct la2016_chunk *chunk;
+	unsigned int i, to_read;
 	int ret;
 
 	sdi = transfer->user_data;
@@ -634,18 +724,28 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 
 	if (transfer->status == LIBUSB_TRANSFER_TIMED_OUT) {
 		sr_err("bulk transfer timeout!");
-		devc->transfer_finished = 1;
+		devc->transfer_error = TRUE;
+	} else if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		devc->transfer_error = TRUE;
 	}
-	send_chunk(sdi, transfer->buffer, transfer->actual_length / TRANSFER_PACKET_LENGTH);
 
-	devc->n_bytes_to_read -= transfer->actual_length;
-	if (devc->n_bytes_to_read) {
-		uint32_t to_read = devc->n_bytes_to_read;
-		/* determine read size for the next usb transfer */
-		if (to_read >= LA2016_USB_BUFSZ)
-			to_read = LA2016_USB_BUFSZ;
-		else /* last transfer, make read size some multiple of LA2016_EP6_PKTSZ */
-			to_read = (to_read + (LA2016_EP6_PKTSZ-1)) & ~(LA2016_EP6_PKTSZ-1);
+	/* Hand the data to the decoder, continue with another buffer. */
+	if (transfer->actual_length && !devc->acq_aborted) {
+		chunk = g_malloc(sizeof(*chunk));
+		chunk->buf = transfer->buffer;
+		chunk->length = transfer->actual_length;
+		g_async_queue_push(devc->decode_queue, chunk);
+		transfer->buffer = g_async_queue_try_pop(devc->free_queue);
+		if (!transfer->buffer)
+			transfer->buffer = usb_transfer_buf_alloc(usb->devhdl,
+				devc->transfer_buf_size);
+	}
+	devc->n_bytes_to_read -= MIN((unsigned int)transfer->actual_length,
+		devc->n_bytes_to_read);
+
+	if (devc->n_bytes_to_submit && transfer->buffer &&
+			!devc->transfer_error && !devc->acq_aborted) {
+		to_read = la2016_next_read_size(devc);
 		libusb_fill_bulk_transfer(
 			transfer, usb->devhdl,
 			0x86, transfer->buffer, to_read,
@@ -654,16 +754,81 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		if ((ret = libusb_submit_transfer(transfer)) == 0)
 			return;
 		sr_err("Failed to submit further transfer: %s.", libusb_error_name(ret));
+		devc->transfer_error = TRUE;
 	}
 
-	g_free(transfer->buffer);
+	for (i = 0; i < LA2016_NUM_TRANSFERS; i++) {
+		if (devc->transfers[i] == transfer)
+			devc->transfers[i] = NULL;
+	}
+	usb_transfer_buf_free(transfer->buffer);
 	libusb_free_transfer(transfer);
-	devc->transfer_finished = 1;
+	if (--devc->n_transfers_active == 0) {
+		devc->usb_done_us = g_get_monotonic_time();
+		decode_thread_stop(devc);
+		devc->transfer_finished = 1;
+	}
+}
+
+static int start_retrieval(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+
+	devc->decode_queue = g_async_queue_new();
+	devc->free_queue = g_async_queue_new();
+	devc->block_queue = g_async_queue_new();
+	devc->decode_thread = g_thread_try_new("la2016-decode",
+		decode_thread_run, sdi, NULL);
+	if (!devc->decode_thread) {
+		sr_err("Failed to start decode thread.");
+		return SR_ERR;
+	}
+
+	if (la2016_start_retrieval(sdi, receive_transfer) != SR_OK) {
+		decode_thread_stop(devc);
+		return SR_ERR;
+	}
+	if (!devc->n_transfers_active) {
+		/* Nothing to read. */
+		decode_thread_stop(devc);
+		devc->transfer_finished = 1;
+	}
+
+	return SR_OK;
+}
+
+static void finish_retrieval(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	uint8_t *buf;
+
+	devc = sdi->priv;
+
+	g_thread_join(devc->decode_thread);
+	devc->decode_thread = NULL;
+	send_blocks(sdi);
+	g_async_queue_unref(devc->block_queue);
+	devc->block_queue = NULL;
+
+	while ((buf = g_async_queue_try_pop(devc->free_queue)))
+		usb_transfer_buf_free(buf);
+	g_async_queue_unref(devc->free_queue);
+	devc->free_queue = NULL;
+	g_async_queue_unref(devc->decode_queue);
+	devc->decode_queue = NULL;
+
+	if (devc->usb_done_us) {
+		sr_info("Retrieval took %.3f s on USB, %.3f s for decoding.",
+			(devc->usb_done_us - devc->retrieval_start_us) / 1e6,
+			devc->decode_us / 1e6);
+	}
 }
 
 static int handle_event(int fd, int revents, void *cb_data)
 {
-	const struct sr_dev_inst *sdi;
+	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	struct drv_context *drvc;
 	struct timeval tv;
@@ -685,21 +850,23 @@ static int handle_event(int fd, int revents, void *cb_data)
 		devc->reading_behind_trigger = 0;
 		devc->total_samples = 0;
 		/* we can start retrieving data! */
-		if (la2016_start_retrieval(sdi, receive_transfer) != SR_OK) {
+		std_session_send_df_frame_begin(sdi);
+		if (start_retrieval(sdi) != SR_OK) {
 			sr_err("failed to start retrieval!");
 			return FALSE;
 		}
 		sr_dbg("retrieval is started...");
-		std_session_send_df_frame_begin(sdi);
 
 		return TRUE;
 	}
 
 	tv.tv_sec = tv.tv_usec = 0;
 	libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
+	send_blocks(sdi);
 
 	if (devc->transfer_finished) {
 		sr_dbg("transfer is finished!");
+		finish_retrieval(sdi);
 		std_session_send_df_frame_end(sdi);
 
 		usb_source_remove(sdi->session, drvc->sr_ctx);
@@ -707,11 +874,6 @@ static int handle_event(int fd, int revents, void *cb_data)
 
 		la2016_stop_acquisition(sdi);
 
-		g_free(devc->convbuffer);
-		devc->convbuffer = NULL;
-
-		devc->transfer = NULL;
-
 		sr_dbg("transfer is now finished");
 	}
 
@@ -720,8 +882,13 @@ static int handle_event(int fd, int revents, void *cb_data)
 
 static void abort_acquisition(struct dev_context *devc)
 {
-	if (devc->transfer)
-		libusb_cancel_transfer(devc->transfer);
+	unsigned int i;
+
+	devc->acq_aborted = TRUE;
+	for (i = 0; i < LA2016_NUM_TRANSFERS; i++) {
+		if (devc->transfers[i])
+			libusb_cancel_transfer(devc->transfers[i]);
+	}
 }
 
 static int configure_channels(const struct sr_dev_inst *sdi)
@@ -759,17 +926,10 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		return SR_ERR;
 	}
 
-	devc->convbuffer_size = 4 * 1024 * 1024;
-	if (!(devc->convbuffer = g_try_malloc(devc->convbuffer_size))) {
-		sr_err("Conversion buffer malloc failed.");
-		return SR_ERR_MALLOC;
-	}
+	devc->acq_aborted = FALSE;
 
-	if ((ret = la2016_setup_acquisition(sdi)) != SR_OK) {
-		g_free(devc->convbuffer);
-		devc->convbuffer = NULL;
+	if ((ret = la2016_setup_acquisition(sdi)) != SR_OK)
 		return ret;
-	}
 
 	devc->ctx = drvc->sr_ctx;
 
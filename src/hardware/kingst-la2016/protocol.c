@@ -38,6 +38,8 @@
 #define FPGA_FW_LA2016A	"kingst-la2016a1-fpga.bitstream"
 #define FPGA_FW_LA1016	"kingst-la1016-fpga.bitstream"
 #define FPGA_FW_LA1016A	"kingst-la1016a1-fpga.bitstream"
+#define FPGA_FW_MAX_SIZE	(1024 * 1024)
+#define FPGA_UPLOAD_CHUNK_SIZE	(16 * 1024)
 
 #define MAX_SAMPLE_RATE_LA2016	SR_MHZ(200)
 #define MAX_SAMPLE_RATE_LA1016	SR_MHZ(100)
@@ -117,18 +119,30 @@ static int ctrl_out(const struct sr_dev_inst *sdi,
 	return SR_OK;
 }
 
+static int enable_fpga(const struct sr_dev_inst *sdi)
+{
+	int ret;
+
+	if ((ret = ctrl_out(sdi, CMD_FPGA_ENABLE, 0x01, 0, NULL, 0)) != SR_OK) {
+		sr_err("failed enable fpga");
+		return ret;
+	}
+
+	g_usleep(40000);
+	return SR_OK;
+}
+
 static int upload_fpga_bitstream(const struct sr_dev_inst *sdi, const char *bitstream_fname)
 {
 	struct dev_context *devc;
 	struct drv_context *drvc;
 	struct sr_usb_dev_inst *usb;
-	struct sr_resource bitstream;
+	GBytes *bitstream;
 	uint8_t buffer[sizeof(uint32_t)];
 	uint8_t *wrptr;
+	uint8_t *image;
 	uint8_t cmd_resp;
-	uint8_t block[4096];
-	int len, act_len;
-	unsigned int pos;
+	size_t size, image_size;
 	int ret;
 	unsigned int zero_pad_to = 0x2c000;
 
@@ -138,57 +152,37 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi, const char *bits
 
 	sr_info("Uploading FPGA bitstream '%s'.", bitstream_fname);
 
-	ret = sr_resource_open(drvc->sr_ctx, &bitstream, SR_RESOURCE_FIRMWARE, bitstream_fname);
-	if (ret != SR_OK) {
+	bitstream = sr_resource_load_cached(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
+		bitstream_fname, FPGA_FW_MAX_SIZE);
+	if (!bitstream) {
 		sr_err("could not find fpga firmware %s!", bitstream_fname);
-		return ret;
+		return SR_ERR;
 	}
+	size = g_bytes_get_size(bitstream);
 
-	devc->bitstream_size = (uint32_t)bitstream.size;
+	// the device expects zero's after the bitstream, until zero_pad_to
+	image_size = MAX(size, zero_pad_to);
+	image = g_malloc0(image_size);
+	memcpy(image, g_bytes_get_data(bitstream, NULL), size);
+	g_bytes_unref(bitstream);
+
+	devc->bitstream_size = (uint32_t)size;
 	wrptr = buffer;
 	write_u32le_inc(&wrptr, devc->bitstream_size);
 	if ((ret = ctrl_out(sdi, CMD_FPGA_INIT, 0x00, 0, buffer, wrptr - buffer)) != SR_OK) {
 		sr_err("failed to give upload init command");
-		sr_resource_close(drvc->sr_ctx, &bitstream);
+		g_free(image);
 		return ret;
 	}
 
-	pos = 0;
-	while (1) {
-		if (pos < bitstream.size) {
-			len = (int)sr_resource_read(drvc->sr_ctx, &bitstream, &block, sizeof(block));
-			if (len < 0) {
-				sr_err("failed to read from fpga bitstream!");
-				sr_resource_close(drvc->sr_ctx, &bitstream);
-				return SR_ERR;
-			}
-		} else {
-			// fill with zero's until zero_pad_to
-			len = zero_pad_to - pos;
-			if ((unsigned)len > sizeof(block))
-				len = sizeof(block);
-			memset(&block, 0, len);
-		}
-		if (len == 0)
-			break;
-
-		ret = libusb_bulk_transfer(usb->devhdl, 2, (unsigned char*)&block[0], len, &act_len, DEFAULT_TIMEOUT_MS);
-		if (ret != 0) {
-			sr_dbg("failed to write fpga bitstream block at %#x len %d: %s.", pos, (int)len, libusb_error_name(ret));
-			ret = SR_ERR;
-			break;
-		}
-		if (act_len != len) {
-			sr_dbg("failed to write fpga bitstream block at %#x len %d: act_len is %d.", pos, (int)len, act_len);
-			ret = SR_ERR;
-			break;
-		}
-		pos += len;
-	}
-	sr_resource_close(drvc->sr_ctx, &bitstream);
-	if (ret != 0)
+	ret = usb_bulk_upload(drvc->sr_ctx, usb, 2, image, image_size,
+		FPGA_UPLOAD_CHUNK_SIZE, DEFAULT_TIMEOUT_MS);
+	g_free(image);
+	if (ret != SR_OK) {
+		sr_dbg("failed to write fpga bitstream");
 		return ret;
-	sr_info("FPGA bitstream upload (%" PRIu64 " bytes) done.", bitstream.size);
+	}
+	sr_info("FPGA bitstream upload (%zu bytes) done.", size);
 
 	if ((ret = ctrl_in(sdi, CMD_FPGA_INIT, 0x00, 0, &cmd_resp, sizeof(cmd_resp))) != SR_OK) {
 		sr_err("failed to read response after FPGA bitstream upload");
@@ -201,13 +195,7 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi, const char *bits
 
 	g_usleep(30000);
 
-	if ((ret = ctrl_out(sdi, CMD_FPGA_ENABLE, 0x01, 0, NULL, 0)) != SR_OK) {
-		sr_err("failed enable fpga");
-		return ret;
-	}
-
-	g_usleep(40000);
-	return SR_OK;
+	return enable_fpga(sdi);
 }
 
 static int set_threshold_voltage(const struct sr_dev_inst *sdi, float voltage)
@@ -579,6 +567,37 @@ static uint16_t run_state(const struct sr_dev_inst *sdi)
 	return state;
 }
 
+/*
+ * The FPGA keeps its bitstream while the device is powered. A device
+ * which got this bitstream before, and which runs fine after enabling
+ * the FPGA again, need not get it once more.
+ */
+static int load_fpga_bitstream(const struct sr_dev_inst *sdi, const char *bitstream_fname)
+{
+	struct drv_context *drvc;
+	struct sr_usb_dev_inst *usb;
+	libusb_device *dev;
+	int ret;
+
+	drvc = sdi->driver->context;
+	usb = sdi->conn;
+	dev = libusb_get_device(usb->devhdl);
+
+	if (usb_fpga_loaded(drvc->sr_ctx, dev, bitstream_fname)) {
+		if (enable_fpga(sdi) == SR_OK && run_state(sdi) == 0x85e9) {
+			sr_info("FPGA bitstream '%s' is loaded already.", bitstream_fname);
+			return SR_OK;
+		}
+	}
+
+	usb_fpga_loaded_set(drvc->sr_ctx, dev, NULL);
+	if ((ret = upload_fpga_bitstream(sdi, bitstream_fname)) != SR_OK)
+		return ret;
+	usb_fpga_loaded_set(drvc->sr_ctx, dev, bitstream_fname);
+
+	return SR_OK;
+}
+
 static int set_run_mode(const struct sr_dev_inst *sdi, uint8_t fast_blinking)
 {
 	int ret;
@@ -690,6 +709,8 @@ SR_PRIV int la2016_start_retrieval(const struct sr_dev_inst *sdi, libusb_transfe
 	uint8_t *wrptr;
 	uint32_t to_read;
 	uint8_t *buffer;
+	struct libusb_transfer *transfer;
+	unsigned int i;
 
 	devc = sdi->priv;
 	usb = sdi->conn;
@@ -722,33 +743,68 @@ SR_PRIV int la2016_start_retrieval(const struct sr_dev_inst *sdi, libusb_transfe
 		return ret;
 	}
 
-	to_read = devc->n_bytes_to_read;
 	/* choose a buffer size for all of the usb transfers */
+	to_read = devc->n_bytes_to_read;
 	if (to_read >= LA2016_USB_BUFSZ)
-		to_read = LA2016_USB_BUFSZ; /* multiple transfers */
-	else /* one transfer, make buffer size some multiple of LA2016_EP6_PKTSZ */
+		to_read = LA2016_USB_BUFSZ;
+	else
 		to_read = (to_read + (LA2016_EP6_PKTSZ-1)) & ~(LA2016_EP6_PKTSZ-1);
-	buffer = g_try_malloc(to_read);
-	if (!buffer) {
-		sr_err("Failed to allocate %d bytes for bulk transfer", to_read);
-		return SR_ERR_MALLOC;
-	}
-
-	devc->transfer = libusb_alloc_transfer(0);
-	libusb_fill_bulk_transfer(
-		devc->transfer, usb->devhdl,
-		0x86, buffer, to_read,
-		cb, (void *)sdi, DEFAULT_TIMEOUT_MS);
-
-	if ((ret = libusb_submit_transfer(devc->transfer)) != 0) {
-		sr_err("Failed to submit transfer: %s.", libusb_error_name(ret));
-		libusb_free_transfer(devc->transfer);
-		devc->transfer = NULL;
-		g_free(buffer);
-		return SR_ERR;
+	devc->transfer_buf_size = to_read;
+	devc->n_bytes_to_submit = devc->n_bytes_to_read;
+	devc->n_transfers_active = 0;
+	devc->transfer_error = FALSE;
+	devc->retrieval_start_us = g_get_monotonic_time();
+	devc->usb_done_us = 0;
+	devc->decode_us = 0;
+
+	/* Keep several reads in flight, the device queues them up. */
+	for (i = 0; i < LA2016_NUM_TRANSFERS && devc->n_bytes_to_submit; i++) {
+		buffer = usb_transfer_buf_alloc(usb->devhdl,
+			devc->transfer_buf_size);
+		if (!buffer) {
+			sr_err("Failed to allocate %d bytes for bulk transfer",
+				devc->transfer_buf_size);
+			ret = SR_ERR_MALLOC;
+			break;
+		}
+		to_read = la2016_next_read_size(devc);
+		transfer = libusb_alloc_transfer(0);
+		libusb_fill_bulk_transfer(
+			transfer, usb->devhdl,
+			0x86, buffer, to_read,
+			cb, (void *)sdi, DEFAULT_TIMEOUT_MS);
+
+		if ((ret = libusb_submit_transfer(transfer)) != 0) {
+			sr_err("Failed to submit transfer: %s.", libusb_error_name(ret));
+			libusb_free_transfer(transfer);
+			usb_transfer_buf_free(buffer);
+			ret = SR_ERR;
+			break;
+		}
+		devc->transfers[i] = transfer;
+		devc->n_transfers_active++;
+		ret = SR_OK;
 	}
 
-	return SR_OK;
+	return devc->n_transfers_active ? SR_OK : ret;
+}
+
+/*
+ * Get the size of the next bulk read, and account for it. Reads are
+ * full buffers, the last one some multiple of LA2016_EP6_PKTSZ.
+ */
+SR_PRIV unsigned int la2016_next_read_size(struct dev_context *devc)
+{
+	unsigned int to_read;
+
+	to_read = devc->n_bytes_to_submit;
+	if (to_read >= LA2016_USB_BUFSZ)
+		to_read = LA2016_USB_BUFSZ; /* multiple transfers */
+	else
+		to_read = (to_read + (LA2016_EP6_PKTSZ-1)) & ~(LA2016_EP6_PKTSZ-1);
+	devc->n_bytes_to_submit -= MIN(to_read, devc->n_bytes_to_submit);
+
+	return to_read;
 }
 
 SR_PRIV int la2016_init_device(const struct sr_dev_inst *sdi)
@@ -830,19 +886,19 @@ SR_PRIV int la2016_init_device(const struct sr_dev_inst *sdi)
 	/* select the correct fpga bitstream for this device */
 	switch (magic) {
 	case 2:
-		ret = upload_fpga_bitstream(sdi, FPGA_FW_LA2016);
+		ret = load_fpga_bitstream(sdi, FPGA_FW_LA2016);
 		devc->max_samplerate = MAX_SAMPLE_RATE_LA2016;
 		break;
 	case 3:
-		ret = upload_fpga_bitstream(sdi, FPGA_FW_LA1016);
+		ret = load_fpga_bitstream(sdi, FPGA_FW_LA1016);
 		devc->max_samplerate = MAX_SAMPLE_RATE_LA1016;
 		break;
 	case 8:
-		ret = upload_fpga_bitstream(sdi, FPGA_FW_LA2016A);
+		ret = load_fpga_bitstream(sdi, FPGA_FW_LA2016A);
 		devc->max_samplerate = MAX_SAMPLE_RATE_LA2016;
 		break;
 	case 9:
-		ret = upload_fpga_bitstream(sdi, FPGA_FW_LA1016A);
+		ret = load_fpga_bitstream(sdi, FPGA_FW_LA1016A);
 		devc->max_samplerate = MAX_SAMPLE_RATE_LA1016;
 		break;
 	default:
@@ -46,6 +46,7 @@
  */
 #define LA2016_EP6_PKTSZ	512 /* endpoint 6 max packet size */
 #define LA2016_USB_BUFSZ	(256 * 2 * LA2016_EP6_PKTSZ) /* 256KB buffer */
+#define LA2016_NUM_TRANSFERS	4 /* bulk reads in flight */
 
 #define MAX_RENUM_DELAY_MS	3000
 #define DEFAULT_TIMEOUT_MS      200
@@ -114,9 +115,43 @@ struct dev_context {
 	uint64_t total_samples;
 	uint32_t read_pos;
 
-	unsigned int convbuffer_size;
-	uint8_t *convbuffer;
-	struct libusb_transfer *transfer;
+	/*
+	 * Readout pipeline: Bulk reads hand their buffers to the decode
+	 * thread, which returns them for the next reads. The decoded
+	 * blocks get sent from the main loop.
+	 */
+	struct libusb_transfer *transfers[LA2016_NUM_TRANSFERS];
+	unsigned int n_transfers_active;
+	unsigned int n_bytes_to_submit;
+	unsigned int transfer_buf_size;
+	gboolean transfer_error;
+	gboolean acq_aborted;
+	GAsyncQueue *decode_queue;
+	GAsyncQueue *free_queue;
+	GAsyncQueue *block_queue;
+	/* The block which the decode thread fills. */
+	struct la2016_block *block;
+	GThread *decode_thread;
+	/* Timing of the readout, for the log. */
+	int64_t retrieval_start_us;
+	int64_t usb_done_us;
+	int64_t decode_us;
+};
+
+/* 4MiB worth of 16-bit samples between packets. */
+#define LA2016_BLOCK_SAMPLES (2 * 1024 * 1024)
+
+/* Decoded samples, and whether the trigger follows them. */
+struct la2016_block {
+	uint8_t *data;
+	size_t num_samples;
+	gboolean trigger;
+};
+
+/* A received bulk transfer buffer, NULL buf to end the decode thread. */
+struct la2016_chunk {
+	uint8_t *buf;
+	unsigned int length;
 };
 
 SR_PRIV int la2016_upload_firmware(struct sr_context *sr_ctx, libusb_device *dev, uint16_t product_id);
@@ -126,6 +161,7 @@ SR_PRIV int la2016_stop_acquisition(const struct sr_dev_inst *sdi);
 SR_PRIV int la2016_abort_acquisition(const struct sr_dev_inst *sdi);
 SR_PRIV int la2016_has_triggered(const struct sr_dev_inst *sdi);
 SR_PRIV int la2016_start_retrieval(const struct sr_dev_inst *sdi, libusb_transfer_cb_fn cb);
+SR_PRIV unsigned int la2016_next_read_size(struct dev_context *devc);
 SR_PRIV int la2016_init_device(const struct sr_dev_inst *sdi);
 SR_PRIV int la2016_deinit_device(const struct sr_dev_inst *sdi);
 
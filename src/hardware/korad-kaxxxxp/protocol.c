@@ -462,28 +462,28 @@ SR_PRIV int korad_kaxxxxp_receive_data(int fd, int revents, void *cb_data)
 		sr_sw_limits_update_samples_read(&devc->limits, 1);
 	} else if (devc->acquisition_target == KAXXXXP_STATUS) {
 		if (devc->cc_mode_1_changed) {
-			sr_session_send_meta(sdi, SR_CONF_REGULATION,
-				g_variant_new_string((devc->cc_mode[0]) ? "CC" : "CV"));
+			sr_session_send_meta_string(sdi, SR_CONF_REGULATION,
+				(devc->cc_mode[0]) ? "CC" : "CV");
 			devc->cc_mode_1_changed = FALSE;
 		}
 		if (devc->cc_mode_2_changed) {
-			sr_session_send_meta(sdi, SR_CONF_REGULATION,
-				g_variant_new_string((devc->cc_mode[1]) ? "CC" : "CV"));
+			sr_session_send_meta_string(sdi, SR_CONF_REGULATION,
+				(devc->cc_mode[1]) ? "CC" : "CV");
 			devc->cc_mode_2_changed = FALSE;
 		}
 		if (devc->output_enabled_changed) {
-			sr_session_send_meta(sdi, SR_CONF_ENABLED,
-				g_variant_new_boolean(devc->output_enabled));
+			sr_session_send_meta_boolean(sdi, SR_CONF_ENABLED,
+				devc->output_enabled);
 			devc->output_enabled_changed = FALSE;
 		}
 		if (devc->ocp_enabled_changed) {
-			sr_session_send_meta(sdi, SR_CONF_OVER_CURRENT_PROTECTION_ENABLED,
-				g_variant_new_boolean(devc->ocp_enabled));
+			sr_session_send_meta_boolean(sdi, SR_CONF_OVER_CURRENT_PROTECTION_ENABLED,
+				devc->ocp_enabled);
 			devc->ocp_enabled_changed = FALSE;
 		}
 		if (devc->ovp_enabled_changed) {
-			sr_session_send_meta(sdi, SR_CONF_OVER_VOLTAGE_PROTECTION_ENABLED,
-				g_variant_new_boolean(devc->ovp_enabled));
+			sr_session_send_meta_boolean(sdi, SR_CONF_OVER_VOLTAGE_PROTECTION_ENABLED,
+				devc->ovp_enabled);
 			devc->ovp_enabled_changed = FALSE;
 		}
 	}
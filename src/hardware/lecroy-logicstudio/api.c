@@ -126,7 +126,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	devices = NULL;
 
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	usb_get_device_list(drvc->sr_ctx, &devlist);
 
 	for (i = 0; devlist[i]; i++) {
 		libusb_get_device_descriptor(devlist[i], &des);
@@ -134,7 +134,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		if (des.idVendor != LOGICSTUDIO16_VID)
 			continue;
 
-		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+		if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 			continue;
 
 		usb = NULL;
@@ -202,7 +202,7 @@ static int open_device(struct sr_dev_inst *sdi)
 
 	is_opened = FALSE;
 
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	usb_get_device_list(drvc->sr_ctx, &devlist);
 
 	for (i = 0; devlist[i]; i++) {
 		libusb_get_device_descriptor(devlist[i], &des);
@@ -211,7 +211,7 @@ static int open_device(struct sr_dev_inst *sdi)
 			des.idProduct != LOGICSTUDIO16_PID_HAVE_FIRMWARE)
 			continue;
 
-		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+		if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 			continue;
 
 		/*
@@ -429,25 +429,6 @@ static int config_commit(const struct sr_dev_inst *sdi)
 	return lls_setup_acquisition(sdi);
 }
 
-static int receive_usb_data(int fd, int revents, void *cb_data)
-{
-	struct drv_context *drvc;
-	struct timeval tv;
-
-	(void)fd;
-	(void)revents;
-
-	drvc = (struct drv_context *)cb_data;
-
-	tv.tv_sec = 0;
-	tv.tv_usec = 0;
-
-	libusb_handle_events_timeout_completed(drvc->sr_ctx->libusb_ctx,
-		&tv, NULL);
-
-	return TRUE;
-}
-
 static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 {
 	struct drv_context *drvc;
@@ -461,7 +442,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	std_session_send_df_header(sdi);
 
 	return usb_source_add(sdi->session, drvc->sr_ctx, 100,
-		receive_usb_data, drvc);
+		lls_handle_events, (void *)sdi);
 }
 
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
@@ -256,10 +256,16 @@ static void LIBUSB_CALL handle_fetch_samples_done(struct libusb_transfer *xfer)
 
 	libusb_free_transfer(xfer);
 
+	/*
+	 * Ask for the whole sample buffer at once, libusb splits this up
+	 * into overlapping requests by itself.
+	 */
 	libusb_fill_bulk_transfer(devc->bulk_xfer, usb->devhdl, EP_BULK,
-		devc->fetched_samples, 17 << 10,
+		devc->fetched_samples, SAMPLE_BUF_SIZE,
 		recv_bulk_transfer, (void *)sdi, USB_TIMEOUT_MS);
 
+	sr_session_download_progress(sdi, 0, SAMPLE_BUF_SIZE);
+
 	libusb_submit_transfer(devc->bulk_xfer);
 }
 
@@ -1002,31 +1008,47 @@ static void LIBUSB_CALL recv_bulk_transfer(struct libusb_transfer *xfer)
 {
 	const struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	struct drv_context *drvc;
-	uint32_t bytes_left, length;
-	uint16_t read_offset, trigger_offset;
 
 	sdi = xfer->user_data;
 
 	if (!sdi)
 		return;
 
-	drvc = sdi->driver->context;
 	devc = sdi->priv;
 
 	devc->total_received_sample_bytes += xfer->actual_length;
 
+	sr_session_download_progress(sdi, devc->total_received_sample_bytes,
+		SAMPLE_BUF_SIZE);
+
 	if (devc->total_received_sample_bytes < SAMPLE_BUF_SIZE) {
 		xfer->buffer = devc->fetched_samples
 			+ devc->total_received_sample_bytes;
 
-		xfer->length = MIN(16 << 10,
-			SAMPLE_BUF_SIZE - devc->total_received_sample_bytes);
+		xfer->length = SAMPLE_BUF_SIZE
+			- devc->total_received_sample_bytes;
 
 		libusb_submit_transfer(xfer);
 		return;
 	}
 
+	/*
+	 * Leave reordering and sending the samples to lls_handle_events(),
+	 * so this doesn't happen from within libusb's event handling.
+	 */
+	devc->samples_fetched = TRUE;
+}
+
+static void send_fetched_samples(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct drv_context *drvc;
+	uint32_t bytes_left, length;
+	uint16_t read_offset, trigger_offset;
+
+	drvc = sdi->driver->context;
+	devc = sdi->priv;
+
 	usb_source_remove(sdi->session, drvc->sr_ctx);
 
 	read_offset = sample_to_byte_offset(devc, devc->earliest_sample);
@@ -1088,6 +1110,34 @@ static void LIBUSB_CALL recv_bulk_transfer(struct libusb_transfer *xfer)
 	std_session_send_df_end(sdi);
 }
 
+SR_PRIV int lls_handle_events(int fd, int revents, void *cb_data)
+{
+	const struct sr_dev_inst *sdi;
+	struct drv_context *drvc;
+	struct dev_context *devc;
+	struct timeval tv;
+
+	(void)fd;
+	(void)revents;
+
+	sdi = cb_data;
+	drvc = sdi->driver->context;
+	devc = sdi->priv;
+
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+
+	libusb_handle_events_timeout_completed(drvc->sr_ctx->libusb_ctx,
+		&tv, NULL);
+
+	if (devc->samples_fetched) {
+		devc->samples_fetched = FALSE;
+		send_fetched_samples(sdi);
+	}
+
+	return TRUE;
+}
+
 static uint32_t transform_sample_count(struct dev_context *devc,
 	uint32_t samples)
 {
@@ -1109,6 +1159,7 @@ SR_PRIV int lls_start_acquisition(const struct sr_dev_inst *sdi)
 	devc = sdi->priv;
 
 	devc->abort_acquisition = FALSE;
+	devc->samples_fetched = FALSE;
 
 	libusb_fill_interrupt_transfer(devc->intr_xfer, usb->devhdl, EP_INTR,
 		devc->intr_buf, INTR_BUF_SIZE,
@@ -80,6 +80,9 @@ struct dev_context {
 	gboolean want_trigger;
 	gboolean abort_acquisition;
 
+	/** Set once all of the sample buffer has been received. */
+	gboolean samples_fetched;
+
 	/**
 	 * These two magic values are required in order to fix a sample
 	 * buffer corruption. Before the first acquisition is run, they
@@ -102,5 +105,6 @@ SR_PRIV uint64_t lls_get_samplerate(const struct sr_dev_inst *sdi);
 SR_PRIV int lls_setup_acquisition(const struct sr_dev_inst *sdi);
 SR_PRIV int lls_start_acquisition(const struct sr_dev_inst *sdi);
 SR_PRIV int lls_stop_acquisition(const struct sr_dev_inst *sdi);
+SR_PRIV int lls_handle_events(int fd, int revents, void *cb_data);
 
 #endif
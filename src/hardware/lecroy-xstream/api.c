@@ -107,6 +107,7 @@ static void clear_helper(struct dev_context *devc)
 {
 	lecroy_xstream_state_free(devc->model_state);
 	g_free(devc->analog_groups);
+	g_free(devc->buffer);
 }
 
 static int dev_clear(const struct sr_dev_driver *di)
@@ -268,51 +268,45 @@ static int array_float_get(gchar *value, const uint64_t array[][2],
 	return SR_ERR;
 }
 
-static int analog_channel_state_get(struct sr_scpi_dev_inst *scpi,
+/* Queries per analog channel, in the order of analog_channel_state_get(). */
+enum {
+	ANALOG_QUERY_TRACE,
+	ANALOG_QUERY_VDIV,
+	ANALOG_QUERY_OFFSET,
+	ANALOG_QUERY_COUPLING,
+	ANALOG_QUERIES,
+};
+
+static int analog_channel_state_get(struct sr_scpi_batch *batch,
 		const struct scope_config *config, struct scope_state *state)
 {
 	unsigned int i, j;
-	char command[MAX_COMMAND_SIZE];
-	char *tmp_str;
+	int idx;
+	const char *resp;
 
 	for (i = 0; i < config->analog_channels; i++) {
-		g_snprintf(command, sizeof(command), "C%d:TRACE?", i + 1);
+		idx = i * ANALOG_QUERIES;
 
-		if (sr_scpi_get_bool(scpi, command,
+		if (sr_scpi_batch_get_bool(batch, idx + ANALOG_QUERY_TRACE,
 				&state->analog_channels[i].state) != SR_OK)
 			return SR_ERR;
 
-		g_snprintf(command, sizeof(command), "C%d:VDIV?", i + 1);
-
-		if (sr_scpi_get_string(scpi, command, &tmp_str) != SR_OK)
-			return SR_ERR;
-
-		if (array_float_get(tmp_str, ARRAY_AND_SIZE(vdivs), &j) != SR_OK) {
-			g_free(tmp_str);
+		resp = sr_scpi_batch_get_string(batch, idx + ANALOG_QUERY_VDIV);
+		if (!resp || array_float_get((gchar *)resp, ARRAY_AND_SIZE(vdivs), &j) != SR_OK) {
 			sr_err("Could not determine array index for vertical div scale.");
 			return SR_ERR;
 		}
-
-		g_free(tmp_str);
 		state->analog_channels[i].vdiv = j;
 
-		g_snprintf(command, sizeof(command), "C%d:OFFSET?", i + 1);
-
-		if (sr_scpi_get_float(scpi, command, &state->analog_channels[i].vertical_offset) != SR_OK)
+		if (sr_scpi_batch_get_float(batch, idx + ANALOG_QUERY_OFFSET,
+				&state->analog_channels[i].vertical_offset) != SR_OK)
 			return SR_ERR;
 
-		g_snprintf(command, sizeof(command), "C%d:COUPLING?", i + 1);
-
-		if (sr_scpi_get_string(scpi, command, &tmp_str) != SR_OK)
-			return SR_ERR;
-
-
-		if (scope_state_get_array_option(tmp_str, config->coupling_options,
-				 config->num_coupling_options,
-				 &state->analog_channels[i].coupling) != SR_OK)
+		if (scope_state_get_array_option(
+				sr_scpi_batch_get_string(batch, idx + ANALOG_QUERY_COUPLING),
+				config->coupling_options, config->num_coupling_options,
+				&state->analog_channels[i].coupling) != SR_OK)
 			return SR_ERR;
-
-		g_free(tmp_str);
 	}
 
 	return SR_OK;
@@ -391,7 +385,10 @@ SR_PRIV int lecroy_xstream_state_get(struct sr_dev_inst *sdi)
 	struct dev_context *devc;
 	struct scope_state *state;
 	const struct scope_config *config;
+	struct sr_scpi_batch *batch;
 	unsigned int i;
+	int idx;
+	const char *resp;
 	char *tmp_str, *tmp_str2, *tmpp, *p, *key;
 	char command[MAX_COMMAND_SIZE];
 	char *trig_source = NULL;
@@ -402,21 +399,43 @@ SR_PRIV int lecroy_xstream_state_get(struct sr_dev_inst *sdi)
 
 	sr_info("Fetching scope state");
 
-	if (analog_channel_state_get(sdi->conn, config, state) != SR_OK)
+	/* Query the channels, the timebase and the trigger in one go. */
+	batch = sr_scpi_batch_new(sdi->conn);
+	for (i = 0; i < config->analog_channels; i++) {
+		sr_scpi_batch_add(batch, "C%d:TRACE?", i + 1);
+		sr_scpi_batch_add(batch, "C%d:VDIV?", i + 1);
+		sr_scpi_batch_add(batch, "C%d:OFFSET?", i + 1);
+		sr_scpi_batch_add(batch, "C%d:COUPLING?", i + 1);
+	}
+	idx = sr_scpi_batch_add(batch, "TIME_DIV?");
+	sr_scpi_batch_add(batch, "TRIG_DELAY?");
+	sr_scpi_batch_add(batch, "TRIG_SELECT?");
+	if (sr_scpi_batch_run(batch) != SR_OK) {
+		sr_scpi_batch_free(batch);
 		return SR_ERR;
+	}
 
-	if (sr_scpi_get_string(sdi->conn, "TIME_DIV?", &tmp_str) != SR_OK)
+	if (analog_channel_state_get(batch, config, state) != SR_OK) {
+		sr_scpi_batch_free(batch);
 		return SR_ERR;
+	}
 
-	if (array_float_get(tmp_str, ARRAY_AND_SIZE(timebases), &i) != SR_OK) {
-		g_free(tmp_str);
+	resp = sr_scpi_batch_get_string(batch, idx);
+	if (!resp || array_float_get((gchar *)resp, ARRAY_AND_SIZE(timebases), &i) != SR_OK) {
+		sr_scpi_batch_free(batch);
 		sr_err("Could not determine array index for timbase scale.");
 		return SR_ERR;
 	}
-	g_free(tmp_str);
 	state->timebase = i;
 
-	if (sr_scpi_get_string(sdi->conn, "TRIG_SELECT?", &tmp_str) != SR_OK)
+	if (sr_scpi_batch_get_float(batch, idx + 1, &state->horiz_triggerpos) != SR_OK) {
+		sr_scpi_batch_free(batch);
+		return SR_ERR;
+	}
+
+	tmp_str = g_strdup(sr_scpi_batch_get_string(batch, idx + 2));
+	sr_scpi_batch_free(batch);
+	if (!tmp_str)
 		return SR_ERR;
 
 	key = tmpp = NULL;
@@ -435,25 +454,26 @@ SR_PRIV int lecroy_xstream_state_get(struct sr_dev_inst *sdi)
 		}
 		i++;
 	}
-	g_free(tmp_str);
 
 	if (!trig_source || scope_state_get_array_option(trig_source,
 			config->trigger_sources, config->num_trigger_sources,
-			&state->trigger_source) != SR_OK)
+			&state->trigger_source) != SR_OK) {
+		g_free(tmp_str);
 		return SR_ERR;
+	}
 
 	g_snprintf(command, sizeof(command), "%s:TRIG_SLOPE?", trig_source);
+	g_free(tmp_str);
 	if (sr_scpi_get_string(sdi->conn, command, &tmp_str) != SR_OK)
 		return SR_ERR;
 
 	if (scope_state_get_array_option(tmp_str, config->trigger_slopes,
-			config->num_trigger_slopes, &state->trigger_slope) != SR_OK)
+			config->num_trigger_slopes, &state->trigger_slope) != SR_OK) {
+		g_free(tmp_str);
 		return SR_ERR;
+	}
 	g_free(tmp_str);
 
-	if (sr_scpi_get_float(sdi->conn, "TRIG_DELAY?", &state->horiz_triggerpos) != SR_OK)
-		return SR_ERR;
-
 	sr_info("Fetching finished.");
 
 	scope_state_dump(config, state);
@@ -544,39 +564,49 @@ SR_PRIV int lecroy_xstream_init_device(struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-static int lecroy_waveform_2_x_to_analog(GByteArray *data,
+/* Express a gain or offset as a rational, with about 9 significant digits. */
+static void float_to_rational(struct sr_rational *r, double value)
+{
+	uint64_t q;
+
+	for (q = 1; q < UINT64_C(1000000000000000); q *= 10)
+		if (fabs(value * q) >= 1e9)
+			break;
+
+	sr_rational_set(r, (int64_t)llround(value * q), q);
+}
+
+/*
+ * The samples get sent in their native 16 bit encoding, with the gain
+ * and offset of the wave descriptor as the scale and offset. This saves
+ * the conversion to float and its buffer.
+ */
+static int lecroy_waveform_2_x_to_analog(const uint8_t *data, size_t size,
 		struct lecroy_wavedesc *desc, struct sr_datafeed_analog *analog)
 {
 	struct sr_analog_encoding *encoding = analog->encoding;
 	struct sr_analog_meaning *meaning = analog->meaning;
 	struct sr_analog_spec *spec = analog->spec;
-	float *data_float;
-	int16_t *waveform_data;
-	unsigned int i, num_samples;
+	size_t start, num_samples;
 
-	data_float = g_malloc(desc->version_2_x.wave_array_count * sizeof(float));
 	num_samples = desc->version_2_x.wave_array_count;
+	start = (size_t)desc->version_2_x.wave_descriptor_length
+		+ desc->version_2_x.user_text_len;
+	if (start > size || num_samples > (size - start) / sizeof(int16_t)) {
+		sr_err("Waveform of %zu samples exceeds the received data.",
+			num_samples);
+		return SR_ERR_DATA;
+	}
 
-	waveform_data = (int16_t*)(data->data +
-		+ desc->version_2_x.wave_descriptor_length
-		+ desc->version_2_x.user_text_len);
-
-	for (i = 0; i < num_samples; i++)
-		data_float[i] = (float)waveform_data[i]
-			* desc->version_2_x.vertical_gain
-			+ desc->version_2_x.vertical_offset;
-
-	analog->data = data_float;
+	analog->data = (void *)&data[start];
 	analog->num_samples = num_samples;
 
-	encoding->unitsize = sizeof(float);
+	encoding->unitsize = sizeof(int16_t);
 	encoding->is_signed = TRUE;
-	encoding->is_float = TRUE;
+	encoding->is_float = FALSE;
 	encoding->is_bigendian = FALSE;
-	encoding->scale.p = 1;
-	encoding->scale.q = 1;
-	encoding->offset.p = 0;
-	encoding->offset.q = 1;
+	float_to_rational(&encoding->scale, desc->version_2_x.vertical_gain);
+	float_to_rational(&encoding->offset, desc->version_2_x.vertical_offset);
 
 	encoding->digits = 6;
 	encoding->is_digits_decimal = FALSE;
@@ -596,19 +626,19 @@ static int lecroy_waveform_2_x_to_analog(GByteArray *data,
 	return SR_OK;
 }
 
-static int lecroy_waveform_to_analog(GByteArray *data,
+static int lecroy_waveform_to_analog(const uint8_t *data, size_t size,
 		struct sr_datafeed_analog *analog)
 {
 	struct lecroy_wavedesc *desc;
 
-	if (data->len < sizeof(struct lecroy_wavedesc))
+	if (size < sizeof(struct lecroy_wavedesc))
 		return SR_ERR;
 
-	desc = (struct lecroy_wavedesc*)data->data;
+	desc = (struct lecroy_wavedesc*)data;
 
 	if (!strncmp(desc->template_name, "LECROY_2_2", 16) ||
 	    !strncmp(desc->template_name, "LECROY_2_3", 16)) {
-		return lecroy_waveform_2_x_to_analog(data, desc, analog);
+		return lecroy_waveform_2_x_to_analog(data, size, desc, analog);
 	}
 
 	sr_err("Waveformat template '%.16s' not supported.", desc->template_name);
@@ -623,11 +653,12 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	struct dev_context *devc;
 	struct scope_state *state;
 	struct sr_datafeed_packet packet;
-	GByteArray *data;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
+	size_t size;
+	gboolean last_channel;
 
 	(void)fd;
 	(void)revents;
@@ -644,24 +675,19 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	if (ch->type != SR_CHANNEL_ANALOG)
 		return SR_ERR;
 
-	data = NULL;
-	if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
-		if (data)
-			g_byte_array_free(data, TRUE);
+	/* The buffer is kept for the next waveforms. */
+	if (sr_scpi_read_block_reuse(sdi->conn, NULL, &devc->buffer,
+			&devc->buffer_size, &size) != SR_OK)
 		return TRUE;
-	}
 
 	analog.encoding = &encoding;
 	analog.meaning = &meaning;
 	analog.spec = &spec;
 
-	if (lecroy_waveform_to_analog(data, &analog) != SR_OK)
+	if (lecroy_waveform_to_analog(devc->buffer, size, &analog) != SR_OK)
 		return SR_ERR;
 
 	if (analog.num_samples == 0) {
-		g_free(analog.data);
-		g_byte_array_free(data, TRUE);
-
 		/* No data available, we have to acquire data first. */
 		g_snprintf(command, sizeof(command), "ARM;WAIT;*OPC;C%d:WAVEFORM?", ch->index + 1);
 		sr_scpi_send(sdi->conn, command);
@@ -671,11 +697,8 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	} else {
 		/* Update sample rate if needed. */
 		if (state->sample_rate == 0)
-			if (lecroy_xstream_update_sample_rate(sdi, analog.num_samples) != SR_OK) {
-				g_free(analog.data);
-				g_byte_array_free(data, TRUE);
+			if (lecroy_xstream_update_sample_rate(sdi, analog.num_samples) != SR_OK)
 				return SR_ERR;
-			}
 	}
 
 	/*
@@ -685,27 +708,28 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	if (devc->current_channel == devc->enabled_channels)
 		std_session_send_df_frame_begin(sdi);
 
+	/*
+	 * Request the next enabled channel before the data gets sent, so
+	 * that the device prepares its waveform meanwhile.
+	 */
+	last_channel = !devc->current_channel->next;
+	if (!last_channel) {
+		devc->current_channel = devc->current_channel->next;
+		lecroy_xstream_request_data(sdi);
+	}
+
 	meaning.channels = g_slist_append(NULL, ch);
 	packet.payload = &analog;
 	packet.type = SR_DF_ANALOG;
 	sr_session_send(sdi, &packet);
-
-	g_byte_array_free(data, TRUE);
-	data = NULL;
-
 	g_slist_free(meaning.channels);
-	g_free(analog.data);
 
 	/*
-	 * Advance to the next enabled channel. When data for all enabled
-	 * channels was received, then flush potentially queued logic data,
-	 * and send the "frame end" packet.
+	 * When data for all enabled channels was received, send the
+	 * "frame end" packet.
 	 */
-	if (devc->current_channel->next) {
-		devc->current_channel = devc->current_channel->next;
-		lecroy_xstream_request_data(sdi);
+	if (!last_channel)
 		return TRUE;
-	}
 
 	std_session_send_df_frame_end(sdi);
 
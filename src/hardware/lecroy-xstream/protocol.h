@@ -88,6 +88,10 @@ struct dev_context {
 	uint64_t num_frames;
 
 	uint64_t frame_limit;
+
+	/* Receive buffer for the waveforms, reused across acquisitions. */
+	uint8_t *buffer;
+	size_t buffer_size;
 };
 
 SR_PRIV int lecroy_xstream_init_device(struct sr_dev_inst *sdi);
@@ -198,6 +198,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 static int dev_open(struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc = sdi->priv;
 	struct sr_modbus_dev_inst *modbus = sdi->conn;
 
 	if (sr_modbus_open(modbus) < 0)
@@ -205,6 +206,11 @@ static int dev_open(struct sr_dev_inst *sdi)
 
 	maynuo_m97_set_bit(modbus, PC1, 1);
 
+	/* The U and I registers are adjacent, one request reads both. */
+	devc->batch = sr_modbus_batch_new(modbus, 0);
+	sr_modbus_batch_add(devc->batch, U, 2, &devc->registers[0]);
+	sr_modbus_batch_add(devc->batch, I, 2, &devc->registers[2]);
+
 	return SR_OK;
 }
 
@@ -220,12 +226,13 @@ static int dev_close(struct sr_dev_inst *sdi)
 
 	devc = sdi->priv;
 
-	if (devc->expecting_registers) {
+	if (devc->reply_pending) {
 		/* Wait for the last data that was requested from the device. */
-		uint16_t registers[devc->expecting_registers];
-		sr_modbus_read_holding_registers(modbus, -1,
-			devc->expecting_registers, registers);
+		sr_modbus_batch_receive(devc->batch);
+		devc->reply_pending = FALSE;
 	}
+	sr_modbus_batch_free(devc->batch);
+	devc->batch = NULL;
 
 	maynuo_m97_set_bit(modbus, PC1, 0);
 
@@ -150,14 +150,14 @@ static void maynuo_m97_session_send_value(const struct sr_dev_inst *sdi, struct
 SR_PRIV int maynuo_m97_capture_start(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
-	struct sr_modbus_dev_inst *modbus;
 	int ret;
 
-	modbus = sdi->conn;
 	devc = sdi->priv;
 
-	if ((ret = sr_modbus_read_holding_registers(modbus, U, 4, NULL)) == SR_OK)
-		devc->expecting_registers = 4;
+	if ((ret = sr_modbus_batch_rewind(devc->batch)) != SR_OK)
+		return ret;
+	if ((ret = sr_modbus_batch_send(devc->batch)) == SR_OK)
+		devc->reply_pending = TRUE;
 	return ret;
 }
 
@@ -165,8 +165,7 @@ SR_PRIV int maynuo_m97_receive_data(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	struct sr_modbus_dev_inst *modbus;
-	uint16_t registers[4];
+	int ret;
 
 	(void)fd;
 	(void)revents;
@@ -174,22 +173,33 @@ SR_PRIV int maynuo_m97_receive_data(int fd, int revents, void *cb_data)
 	if (!(sdi = cb_data))
 		return TRUE;
 
-	modbus = sdi->conn;
 	devc = sdi->priv;
 
-	devc->expecting_registers = 0;
-	if (sr_modbus_read_holding_registers(modbus, -1, 4, registers) == SR_OK) {
-		std_session_send_df_frame_begin(sdi);
-
-		maynuo_m97_session_send_value(sdi, sdi->channels->data,
-		                              RBFL(registers + 0),
-		                              SR_MQ_VOLTAGE, SR_UNIT_VOLT, 3);
-		maynuo_m97_session_send_value(sdi, sdi->channels->next->data,
-		                              RBFL(registers + 2),
-		                              SR_MQ_CURRENT, SR_UNIT_AMPERE, 4);
-
-		std_session_send_df_frame_end(sdi);
-		sr_sw_limits_update_samples_read(&devc->limits, 1);
+	ret = sr_modbus_batch_receive(devc->batch);
+	/* The request waits for a shared bus, check again next time. */
+	if (ret == SR_ERR_NA)
+		return TRUE;
+	devc->reply_pending = FALSE;
+	if (ret == SR_OK) {
+		ret = sr_modbus_batch_send(devc->batch);
+		if (ret == SR_OK) {
+			/* Wait for the rest of the batch. */
+			devc->reply_pending = TRUE;
+			return TRUE;
+		}
+		if (ret == SR_ERR_NA) {
+			std_session_send_df_frame_begin(sdi);
+
+			maynuo_m97_session_send_value(sdi, sdi->channels->data,
+			                              RBFL(devc->registers + 0),
+			                              SR_MQ_VOLTAGE, SR_UNIT_VOLT, 3);
+			maynuo_m97_session_send_value(sdi, sdi->channels->next->data,
+			                              RBFL(devc->registers + 2),
+			                              SR_MQ_CURRENT, SR_UNIT_AMPERE, 4);
+
+			std_session_send_df_frame_end(sdi);
+			sr_sw_limits_update_samples_read(&devc->limits, 1);
+		}
 	}
 
 	if (sr_sw_limits_check(&devc->limits)) {
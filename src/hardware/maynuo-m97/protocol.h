@@ -37,7 +37,10 @@ struct maynuo_m97_model {
 struct dev_context {
 	const struct maynuo_m97_model *model;
 	struct sr_sw_limits limits;
-	int expecting_registers;
+	/* Reads U and I, see maynuo_m97_capture_start(). */
+	struct sr_modbus_batch *batch;
+	uint16_t registers[4];
+	gboolean reply_pending;
 };
 
 enum maynuo_m97_coil {
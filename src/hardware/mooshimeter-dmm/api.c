@@ -218,8 +218,8 @@ static int set_channel2_buffer(const struct sr_dev_inst *sdi)
 static void autorange_channel1_current(const struct sr_dev_inst *sdi,
 	float value)
 {
-	mooshimeter_dmm_set_autorange(sdi, "CH1:RANGE_I",
-		"CH1:MAPPING:CURRENT", value);
+	mooshimeter_dmm_set_autorange(sdi, TREE_PATH_CH1_RANGE_I,
+		TREE_PATH_CH1_MAPPING_CURRENT, value);
 }
 
 static int configure_channel1_current(const struct sr_dev_inst *sdi,
@@ -256,8 +256,8 @@ static int configure_channel1_current(const struct sr_dev_inst *sdi,
 static void autorange_channel1_temperature(const struct sr_dev_inst *sdi,
 	float value)
 {
-	mooshimeter_dmm_set_autorange(sdi, "CH1:RANGE_I",
-		"CH1:MAPPING:TEMP", value);
+	mooshimeter_dmm_set_autorange(sdi, TREE_PATH_CH1_RANGE_I,
+		TREE_PATH_CH1_MAPPING_TEMP, value);
 }
 
 static int configure_channel1_temperature(const struct sr_dev_inst *sdi,
@@ -294,8 +294,8 @@ static int configure_channel1_temperature(const struct sr_dev_inst *sdi,
 static void autorange_channel1_auxv(const struct sr_dev_inst *sdi,
 	float value)
 {
-	mooshimeter_dmm_set_autorange(sdi, "CH1:RANGE_I",
-		"SHARED:AUX_V", value);
+	mooshimeter_dmm_set_autorange(sdi, TREE_PATH_CH1_RANGE_I,
+		TREE_PATH_SHARED_AUX_V, value);
 }
 
 static int configure_channel1_auxv(const struct sr_dev_inst *sdi,
@@ -336,8 +336,8 @@ static int configure_channel1_auxv(const struct sr_dev_inst *sdi,
 static void autorange_channel1_resistance(const struct sr_dev_inst *sdi,
 	float value)
 {
-	mooshimeter_dmm_set_autorange(sdi, "CH1:RANGE_I",
-		"SHARED:RESISTANCE", value);
+	mooshimeter_dmm_set_autorange(sdi, TREE_PATH_CH1_RANGE_I,
+		TREE_PATH_SHARED_RESISTANCE, value);
 }
 
 static int configure_channel1_resistance(const struct sr_dev_inst *sdi,
@@ -378,8 +378,8 @@ static int configure_channel1_resistance(const struct sr_dev_inst *sdi,
 static void autorange_channel1_diode(const struct sr_dev_inst *sdi,
 	float value)
 {
-	mooshimeter_dmm_set_autorange(sdi, "CH1:RANGE_I",
-		"SHARED:DIODE", value);
+	mooshimeter_dmm_set_autorange(sdi, TREE_PATH_CH1_RANGE_I,
+		TREE_PATH_SHARED_DIODE, value);
 }
 
 static int configure_channel1_diode(const struct sr_dev_inst *sdi,
@@ -420,8 +420,8 @@ static int configure_channel1_diode(const struct sr_dev_inst *sdi,
 static void autorange_channel2_voltage(const struct sr_dev_inst *sdi,
 	float value)
 {
-	mooshimeter_dmm_set_autorange(sdi, "CH2:RANGE_I",
-		"CH2:MAPPING:VOLTAGE", value);
+	mooshimeter_dmm_set_autorange(sdi, TREE_PATH_CH2_RANGE_I,
+		TREE_PATH_CH2_MAPPING_VOLTAGE, value);
 }
 
 static int configure_channel2_voltage(const struct sr_dev_inst *sdi,
@@ -458,8 +458,8 @@ static int configure_channel2_voltage(const struct sr_dev_inst *sdi,
 static void autorange_channel2_temperature(const struct sr_dev_inst *sdi,
 	float value)
 {
-	mooshimeter_dmm_set_autorange(sdi, "CH2:RANGE_I",
-		"CH2:MAPPING:TEMP", value);
+	mooshimeter_dmm_set_autorange(sdi, TREE_PATH_CH2_RANGE_I,
+		TREE_PATH_CH2_MAPPING_TEMP, value);
 }
 
 static int configure_channel2_temperature(const struct sr_dev_inst *sdi,
@@ -496,8 +496,8 @@ static int configure_channel2_temperature(const struct sr_dev_inst *sdi,
 static void autorange_channel2_auxv(const struct sr_dev_inst *sdi,
 	float value)
 {
-	mooshimeter_dmm_set_autorange(sdi, "CH2:RANGE_I",
-		"SHARED:AUX_V", value);
+	mooshimeter_dmm_set_autorange(sdi, TREE_PATH_CH2_RANGE_I,
+		TREE_PATH_SHARED_AUX_V, value);
 }
 
 static int configure_channel2_auxv(const struct sr_dev_inst *sdi,
@@ -538,8 +538,8 @@ static int configure_channel2_auxv(const struct sr_dev_inst *sdi,
 static void autorange_channel2_resistance(const struct sr_dev_inst *sdi,
 	float value)
 {
-	mooshimeter_dmm_set_autorange(sdi, "CH2:RANGE_I",
-		"SHARED:RESISTANCE", value);
+	mooshimeter_dmm_set_autorange(sdi, TREE_PATH_CH2_RANGE_I,
+		TREE_PATH_SHARED_RESISTANCE, value);
 }
 
 static int configure_channel2_resistance(const struct sr_dev_inst *sdi,
@@ -580,8 +580,8 @@ static int configure_channel2_resistance(const struct sr_dev_inst *sdi,
 static void autorange_channel2_diode(const struct sr_dev_inst *sdi,
 	float value)
 {
-	mooshimeter_dmm_set_autorange(sdi, "CH2:RANGE_I",
-		"SHARED:DIODE", value);
+	mooshimeter_dmm_set_autorange(sdi, TREE_PATH_CH2_RANGE_I,
+		TREE_PATH_SHARED_DIODE, value);
 }
 
 static int configure_channel2_diode(const struct sr_dev_inst *sdi,
@@ -314,67 +314,79 @@ static int lookup_chooser_index(struct dev_context *devc, const char *path)
 	return (int)node->index_in_parent;
 }
 
-static gboolean update_tree_data(struct config_tree_node *node,
-	GByteArray *contents)
+/*
+ * Take the update of a node from the received data, at the current
+ * offset. The offset advances before the node's update callback runs,
+ * which in turn can process received data.
+ */
+static gboolean update_tree_data(struct packet_rx *rx,
+	struct config_tree_node *node)
 {
-	guint len;
+	const uint8_t *data;
+	size_t avail, len;
+
+	data = rx->contents->data + rx->offset;
+	avail = rx->contents->len - rx->offset;
 	switch (node->type) {
 	case TREE_NODE_DATATYPE_PLAIN:
 	case TREE_NODE_DATATYPE_LINK:
 		sr_err("Update for dataless node.");
-		g_byte_array_remove_range(contents, 0, 2);
+		rx->offset += 2;
 		return TRUE;
 	case TREE_NODE_DATATYPE_CHOOSER:
 	case TREE_NODE_DATATYPE_U8:
-		node->value.i = R8(contents->data + 1);
-		g_byte_array_remove_range(contents, 0, 2);
+		node->value.i = R8(data + 1);
+		len = 2;
 		break;
 	case TREE_NODE_DATATYPE_U16:
-		if (contents->len < 3)
+		if (avail < 3)
 			return FALSE;
-		node->value.i = RL16(contents->data + 1);
-		g_byte_array_remove_range(contents, 0, 3);
+		node->value.i = RL16(data + 1);
+		len = 3;
 		break;
 	case TREE_NODE_DATATYPE_U32:
-		if (contents->len < 5)
+		if (avail < 5)
 			return FALSE;
-		node->value.i = RL32(contents->data + 1);
-		g_byte_array_remove_range(contents, 0, 5);
+		node->value.i = RL32(data + 1);
+		len = 5;
 		break;
 	case TREE_NODE_DATATYPE_S8:
-		node->value.i = (int8_t)R8(contents->data + 1);
-		g_byte_array_remove_range(contents, 0, 2);
+		node->value.i = (int8_t)R8(data + 1);
+		len = 2;
 		break;
 	case TREE_NODE_DATATYPE_S16:
-		if (contents->len < 3)
+		if (avail < 3)
 			return FALSE;
-		node->value.i = RL16S(contents->data + 1);
-		g_byte_array_remove_range(contents, 0, 3);
+		node->value.i = RL16S(data + 1);
+		len = 3;
 		break;
 	case TREE_NODE_DATATYPE_S32:
-		if (contents->len < 5)
+		if (avail < 5)
 			return FALSE;
-		node->value.i = RL32S(contents->data + 1);
-		g_byte_array_remove_range(contents, 0, 5);
+		node->value.i = RL32S(data + 1);
+		len = 5;
 		break;
 	case TREE_NODE_DATATYPE_STRING:
 	case TREE_NODE_DATATYPE_BINARY:
-		if (contents->len < 3)
+		if (avail < 3)
 			return FALSE;
-		len = RL16(contents->data + 1);
-		if (contents->len < 3 + len)
+		len = RL16(data + 1);
+		if (avail < 3 + len)
 			return FALSE;
 		g_byte_array_set_size(node->value.b, len);
-		memcpy(node->value.b->data, contents->data + 3, len);
-		g_byte_array_remove_range(contents, 0, 3 + len);
+		memcpy(node->value.b->data, data + 3, len);
+		len += 3;
 		break;
 	case TREE_NODE_DATATYPE_FLOAT:
-		if (contents->len < 5)
+		if (avail < 5)
 			return FALSE;
-		node->value.f = RLFL(contents->data + 1);
-		g_byte_array_remove_range(contents, 0, 5);
+		node->value.f = RLFL(data + 1);
+		len = 5;
 		break;
+	default:
+		return FALSE;
 	}
+	rx->offset += len;
 
 	node->update_number++;
 
@@ -435,28 +447,36 @@ static gboolean incoming_frame(struct packet_rx *rx,
 	}
 }
 
+/*
+ * Process all complete updates in the received data. The outermost call
+ * drops the processed bytes afterwards, at once. Nested calls (from
+ * update callbacks which wait for responses) continue at the offset.
+ */
 static void consume_packets(struct dev_context *devc)
 {
-	uint8_t id;
+	struct packet_rx *rx = &devc->rx;
 	struct config_tree_node *target;
+	uint8_t id;
 
-	if (devc->rx.contents->len < 2)
-		return;
+	rx->depth++;
+	while (rx->contents && rx->contents->len - rx->offset >= 2) {
+		id = rx->contents->data[rx->offset];
+		id &= 0x7F;
+		target = devc->tree_id_lookup[id];
 
-	id = devc->rx.contents->data[0];
-	id &= 0x7F;
-	target = devc->tree_id_lookup[id];
+		if (!target) {
+			sr_err("Command %hhu code does not map to a known node.", id);
+			rx->offset++;
+			continue;
+		}
 
-	if (!target) {
-		sr_err("Command %hhu code does not map to a known node.", id);
-		g_byte_array_remove_index(devc->rx.contents, 0);
-		return consume_packets(devc);
+		if (!update_tree_data(rx, target))
+			break;
+	}
+	if (!--rx->depth && rx->contents && rx->offset) {
+		g_byte_array_remove_range(rx->contents, 0, rx->offset);
+		rx->offset = 0;
 	}
-
-	if (!update_tree_data(target, devc->rx.contents))
-		return;
-
-	return consume_packets(devc);
 }
 
 static int notify_cb(void *cb_data, uint8_t *data, size_t dlen)
@@ -645,6 +665,53 @@ static void chX_value_update(struct config_tree_node *node,
 		sr_dev_acquisition_stop(sdi);
 }
 
+/*
+ * Decode the samples of a buffer notification, all at once. Samples are
+ * little endian two's complement numbers of bits_per_sample bits, in
+ * whole bytes each.
+ */
+static void decode_buffer(const uint8_t *raw, size_t count,
+	uint32_t bytes_per_sample, uint32_t bits_per_sample, float scalar,
+	float *values, float *maximum)
+{
+	uint32_t sign_bit, value_mask, unscaled;
+	float value, max;
+	size_t i;
+
+	sign_bit = 1UL << (bits_per_sample - 1);
+	value_mask = sign_bit | (sign_bit - 1);
+	max = 0;
+
+#define DECODE_LOOP(read) \
+	for (i = 0; i < count; i++, raw += bytes_per_sample) { \
+		unscaled = (read) & value_mask; \
+		unscaled = (unscaled ^ sign_bit) - sign_bit; \
+		value = (float)(int32_t)unscaled * scalar; \
+		values[i] = value; \
+		if (fabsf(value) > max) \
+			max = fabsf(value); \
+	}
+
+	switch (bytes_per_sample) {
+	case 1:
+		DECODE_LOOP(R8(raw));
+		break;
+	case 2:
+		DECODE_LOOP(RL16(raw));
+		break;
+	case 3:
+		DECODE_LOOP(read_u24le(raw));
+		break;
+	case 4:
+		DECODE_LOOP(RL32(raw));
+		break;
+	}
+
+#undef DECODE_LOOP
+
+	*maximum = max;
+}
+
 static void chX_buffer_update(struct config_tree_node *node,
 	struct sr_dev_inst *sdi, int channel)
 {
@@ -655,13 +722,7 @@ static void chX_buffer_update(struct config_tree_node *node,
 	const uint8_t *raw;
 	size_t size;
 	size_t number_of_samples;
-	int32_t unscaled = 0;
-	int32_t sign_bit;
-	int32_t sign_mask;
-	float converted_value = 0;
 	float maximum_value = 0;
-	float *values;
-	float *output_value;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
@@ -676,7 +737,7 @@ static void chX_buffer_update(struct config_tree_node *node,
 		return;
 	}
 
-	if (!bits_per_sample)
+	if (!bits_per_sample || bits_per_sample > 32)
 		return;
 	if (node->type != TREE_NODE_DATATYPE_BINARY)
 		return;
@@ -688,61 +749,33 @@ static void chX_buffer_update(struct config_tree_node *node,
 	bytes_per_sample = bits_per_sample / 8;
 	if (bits_per_sample % 8 != 0)
 		bytes_per_sample++;
-	if (bytes_per_sample > 4)
-		return;
 	number_of_samples = size / bytes_per_sample;
 	if (!number_of_samples)
 		return;
 
-	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
+	/* The conversion buffer is kept, notifications come in a stream. */
+	if (devc->buffer_values_size < number_of_samples) {
+		g_free(devc->buffer_values);
+		devc->buffer_values = g_malloc(number_of_samples * sizeof(float));
+		devc->buffer_values_size = number_of_samples;
+	}
 
-	values = g_new0(float, number_of_samples);
-	output_value = values;
+	sr_spew("Received buffer for channel %d with %u bytes (%u samples).",
+		channel, (unsigned int)size, (unsigned int)number_of_samples);
 
+	decode_buffer(raw, number_of_samples, bytes_per_sample,
+		bits_per_sample, output_scalar, devc->buffer_values,
+		&maximum_value);
+
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
 	memcpy(analog.meaning, &devc->channel_meaning[channel],
 		sizeof(struct sr_analog_meaning));
 	analog.num_samples = number_of_samples;
-	analog.data = output_value;
+	analog.data = devc->buffer_values;
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
-
-	sr_spew("Received buffer for channel %d with %u bytes (%u samples).",
-		channel, (unsigned int)size, (unsigned int)number_of_samples);
-
-	sign_bit = 1 << (bits_per_sample - 1);
-	sign_mask = sign_bit - 1;
-	for (; size >= bytes_per_sample; size -= bytes_per_sample,
-		raw += bytes_per_sample, output_value++) {
-		switch (bytes_per_sample) {
-		case 1:
-			unscaled = R8(raw);
-			break;
-		case 2:
-			unscaled = RL16(raw);
-			break;
-		case 3:
-			unscaled = ((uint32_t)raw[0]) |
-				(((uint32_t)raw[1]) << 8) |
-				(((uint32_t)raw[2]) << 16);
-			break;
-		case 4:
-			unscaled = RL32(raw);
-			break;
-		default:
-			break;
-		}
-
-		unscaled = (unscaled & sign_mask) - (unscaled & sign_bit);
-		converted_value = (float)unscaled * output_scalar;
-		*output_value = converted_value;
-		if (fabsf(converted_value) > maximum_value)
-			maximum_value = fabsf(maximum_value);
-	}
-
 	sr_session_send(sdi, &packet);
 
-	g_free(values);
-
 	if (devc->channel_autorange[channel])
 		(*devc->channel_autorange[channel])(sdi, maximum_value);
 
@@ -795,7 +828,7 @@ static void ch1_buffer_lsb2native_update(struct config_tree_node *node,
 {
 	const struct sr_dev_inst *sdi = param;
 	struct dev_context *devc = sdi->priv;
-	if (node->type != TREE_NODE_DATATYPE_BINARY)
+	if (node->type != TREE_NODE_DATATYPE_FLOAT)
 		return;
 	devc->buffer_lsb2native[0] = node->value.f;
 }
@@ -805,7 +838,7 @@ static void ch2_buffer_lsb2native_update(struct config_tree_node *node,
 {
 	const struct sr_dev_inst *sdi = param;
 	struct dev_context *devc = sdi->priv;
-	if (node->type != TREE_NODE_DATATYPE_BINARY)
+	if (node->type != TREE_NODE_DATATYPE_FLOAT)
 		return;
 	devc->buffer_lsb2native[1] = node->value.f;
 }
@@ -911,6 +944,8 @@ static int deserialize_tree(struct dev_context *devc,
 		return SR_ERR_DATA;
 
 	if (tree_node_has_id(node)) {
+		if (*id >= (int)G_N_ELEMENTS(devc->tree_id_lookup))
+			return SR_ERR_DATA;
 		node->id = *id;
 		(*id)++;
 		devc->tree_id_lookup[node->id] = node;
@@ -967,81 +1002,67 @@ static int wait_for_update(const struct sr_dev_inst *sdi,
 	return SR_ERR_TIMEOUT;
 }
 
+static const char *tree_paths[TREE_PATH_COUNT] = {
+	[TREE_PATH_CH1_VALUE] = "CH1:VALUE",
+	[TREE_PATH_CH1_BUF] = "CH1:BUF",
+	[TREE_PATH_CH1_BUF_BPS] = "CH1:BUF_BPS",
+	[TREE_PATH_CH1_BUF_LSB2NATIVE] = "CH1:BUF_LSB2NATIVE",
+	[TREE_PATH_CH1_RANGE_I] = "CH1:RANGE_I",
+	[TREE_PATH_CH1_MAPPING_CURRENT] = "CH1:MAPPING:CURRENT",
+	[TREE_PATH_CH1_MAPPING_TEMP] = "CH1:MAPPING:TEMP",
+	[TREE_PATH_CH2_VALUE] = "CH2:VALUE",
+	[TREE_PATH_CH2_BUF] = "CH2:BUF",
+	[TREE_PATH_CH2_BUF_BPS] = "CH2:BUF_BPS",
+	[TREE_PATH_CH2_BUF_LSB2NATIVE] = "CH2:BUF_LSB2NATIVE",
+	[TREE_PATH_CH2_RANGE_I] = "CH2:RANGE_I",
+	[TREE_PATH_CH2_MAPPING_VOLTAGE] = "CH2:MAPPING:VOLTAGE",
+	[TREE_PATH_CH2_MAPPING_TEMP] = "CH2:MAPPING:TEMP",
+	[TREE_PATH_SHARED_AUX_V] = "SHARED:AUX_V",
+	[TREE_PATH_SHARED_RESISTANCE] = "SHARED:RESISTANCE",
+	[TREE_PATH_SHARED_DIODE] = "SHARED:DIODE",
+	[TREE_PATH_REAL_PWR] = "REAL_PWR",
+	[TREE_PATH_PCB_VERSION] = "PCB_VERSION",
+};
+
+static const struct {
+	enum tree_path path;
+	void (*on_update)(struct config_tree_node *node, void *param);
+	const char *desc;
+} update_handlers[] = {
+	{ TREE_PATH_CH1_VALUE, ch1_value_update, "channel 1 values" },
+	{ TREE_PATH_CH1_BUF, ch1_buffer_update, "channel 1 buffer" },
+	{ TREE_PATH_CH1_BUF_BPS, ch1_buffer_bps_update, "channel 1 buffer BPS" },
+	{ TREE_PATH_CH1_BUF_LSB2NATIVE, ch1_buffer_lsb2native_update,
+		"channel 1 buffer conversion factor" },
+	{ TREE_PATH_CH2_VALUE, ch2_value_update, "channel 2 values" },
+	{ TREE_PATH_CH2_BUF, ch2_buffer_update, "channel 2 buffer" },
+	{ TREE_PATH_CH2_BUF_BPS, ch2_buffer_bps_update, "channel 2 buffer BPS" },
+	{ TREE_PATH_CH2_BUF_LSB2NATIVE, ch2_buffer_lsb2native_update,
+		"channel 2 buffer conversion factor" },
+	{ TREE_PATH_REAL_PWR, power_value_update, "real power" },
+};
+
+/*
+ * Resolve the nodes which acquisitions use, so that neither received
+ * updates nor autoranging need to walk the tree by name.
+ */
 static void install_update_handlers(struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc = sdi->priv;
 	struct config_tree_node *target;
+	size_t i;
 
-	target = lookup_tree_path(devc, "CH1:VALUE");
-	if (target) {
-		target->on_update = ch1_value_update;
-		target->on_update_param = sdi;
-	} else {
-		sr_warn("No tree path for channel 1 values.");
-	}
-
-	target = lookup_tree_path(devc, "CH1:BUF");
-	if (target) {
-		target->on_update = ch1_buffer_update;
-		target->on_update_param = sdi;
-	} else {
-		sr_warn("No tree path for channel 1 buffer.");
-	}
-
-	target = lookup_tree_path(devc, "CH1:BUF_BPS");
-	if (target) {
-		target->on_update = ch1_buffer_bps_update;
-		target->on_update_param = sdi;
-	} else {
-		sr_warn("No tree path for channel 1 buffer BPS.");
-	}
-
-	target = lookup_tree_path(devc, "CH1:BUF_LSB2NATIVE");
-	if (target) {
-		target->on_update = ch1_buffer_lsb2native_update;
-		target->on_update_param = sdi;
-	} else {
-		sr_warn("No tree path for channel 1 buffer conversion factor.");
-	}
-
-	target = lookup_tree_path(devc, "CH2:VALUE");
-	if (target) {
-		target->on_update = ch2_value_update;
-		target->on_update_param = sdi;
-	} else {
-		sr_warn("No tree path for channel 2 values.");
-	}
+	for (i = 0; i < TREE_PATH_COUNT; i++)
+		devc->tree_nodes[i] = lookup_tree_path(devc, tree_paths[i]);
 
-	target = lookup_tree_path(devc, "CH2:BUF");
-	if (target) {
-		target->on_update = ch2_buffer_update;
-		target->on_update_param = sdi;
-	} else {
-		sr_warn("No tree path for channel 2 buffer.");
-	}
-
-	target = lookup_tree_path(devc, "CH2:BUF_BPS");
-	if (target) {
-		target->on_update = ch2_buffer_bps_update;
-		target->on_update_param = sdi;
-	} else {
-		sr_warn("No tree path for channel 2 buffer BPS.");
-	}
-
-	target = lookup_tree_path(devc, "CH2:BUF_LSB2NATIVE");
-	if (target) {
-		target->on_update = ch2_buffer_lsb2native_update;
-		target->on_update_param = sdi;
-	} else {
-		sr_warn("No tree path for channel 2 buffer conversion factor.");
-	}
-
-	target = lookup_tree_path(devc, "REAL_PWR");
-	if (target) {
-		target->on_update = power_value_update;
+	for (i = 0; i < G_N_ELEMENTS(update_handlers); i++) {
+		target = devc->tree_nodes[update_handlers[i].path];
+		if (!target) {
+			sr_warn("No tree path for %s.", update_handlers[i].desc);
+			continue;
+		}
+		target->on_update = update_handlers[i].on_update;
 		target->on_update_param = sdi;
-	} else {
-		sr_warn("No tree path for real power.");
 	}
 }
 
@@ -1135,23 +1156,6 @@ static void startup_send_tree_crc(struct startup_context *ctx)
 	set_tree_integer(ctx->sdi, target, ctx->crc);
 }
 
-static uint32_t crc32(const uint8_t *ptr, size_t size)
-{
-	uint32_t result = 0xFFFFFFFF;
-	uint32_t t;
-	for (; size; size--, ptr++) {
-		result ^= *ptr;
-		for (int i = 0; i < 8; i++) {
-			t = result & 1;
-			result >>= 1;
-			if (t)
-				result ^= 0xEDB88320;
-		}
-	}
-
-	return ~result;
-}
-
 static void startup_tree_updated(struct config_tree_node *node, void *param)
 {
 	struct startup_context *ctx = param;
@@ -1169,7 +1173,7 @@ static void startup_tree_updated(struct config_tree_node *node, void *param)
 	size_t size;
 	struct config_tree_node *target;
 
-	ctx->crc = crc32(node->value.b->data, node->value.b->len);
+	ctx->crc = sr_crc32(0, node->value.b->data, node->value.b->len);
 
 	tree_data = g_byte_array_new();
 	g_byte_array_set_size(tree_data, 4096);
@@ -1212,6 +1216,7 @@ static void startup_tree_updated(struct config_tree_node *node, void *param)
 	release_tree_node(&devc->tree_root);
 	memset(&devc->tree_root, 0, sizeof(struct config_tree_node));
 	memset(devc->tree_id_lookup, 0, sizeof(devc->tree_id_lookup));
+	memset(devc->tree_nodes, 0, sizeof(devc->tree_nodes));
 
 	id = 0;
 	data = tree_data->data;
@@ -1251,6 +1256,7 @@ SR_PRIV int mooshimeter_dmm_open(const struct sr_dev_inst *sdi)
 	release_tree_node(&devc->tree_root);
 	memset(&devc->tree_root, 0, sizeof(struct config_tree_node));
 	memset(devc->tree_id_lookup, 0, sizeof(devc->tree_id_lookup));
+	memset(devc->tree_nodes, 0, sizeof(devc->tree_nodes));
 
 	g_slist_free_full(devc->rx.reorder_buffer, release_rx_buffer);
 	devc->rx.reorder_buffer = NULL;
@@ -1258,6 +1264,7 @@ SR_PRIV int mooshimeter_dmm_open(const struct sr_dev_inst *sdi)
 		devc->rx.contents->len = 0;
 	else
 		devc->rx.contents = g_byte_array_new();
+	devc->rx.offset = 0;
 	devc->rx.sequence_number = -1;
 	devc->tx.sequence_number = 0;
 
@@ -1301,12 +1308,18 @@ SR_PRIV int mooshimeter_dmm_close(const struct sr_dev_inst *sdi)
 	release_tree_node(&devc->tree_root);
 	memset(&devc->tree_root, 0, sizeof(struct config_tree_node));
 	memset(devc->tree_id_lookup, 0, sizeof(devc->tree_id_lookup));
+	memset(devc->tree_nodes, 0, sizeof(devc->tree_nodes));
 
 	g_slist_free_full(devc->rx.reorder_buffer, release_rx_buffer);
 	devc->rx.reorder_buffer = NULL;
 	if (devc->rx.contents)
 		g_byte_array_free(devc->rx.contents, TRUE);
 	devc->rx.contents = NULL;
+	devc->rx.offset = 0;
+
+	g_free(devc->buffer_values);
+	devc->buffer_values = NULL;
+	devc->buffer_values_size = 0;
 
 	return SR_OK;
 }
@@ -1358,23 +1371,16 @@ SR_PRIV int mooshimeter_dmm_set_integer(const struct sr_dev_inst *sdi,
 	return wait_for_update(sdi, target, original_update_number);
 }
 
-static struct config_tree_node *select_next_largest_in_tree(
-	struct dev_context *devc,
-	const char *parent, float number)
+static struct config_tree_node *select_next_largest_choice(
+	struct config_tree_node *choice_parent, float number)
 {
 	float node_value;
 	float distance;
 	float best_distance = 0;
-	struct config_tree_node *choice_parent;
 	struct config_tree_node *selected_choice = NULL;
 
-	choice_parent = lookup_tree_path(devc, parent);
-	if (!choice_parent) {
-		sr_err("Tree path %s not found.", parent);
-		return NULL;
-	}
 	if (!choice_parent->count_children) {
-		sr_err("Tree path %s has no children.", parent);
+		sr_err("Tree path %s has no children.", choice_parent->name);
 		return NULL;
 	}
 
@@ -1408,6 +1414,21 @@ static struct config_tree_node *select_next_largest_in_tree(
 	return selected_choice;
 }
 
+static struct config_tree_node *select_next_largest_in_tree(
+	struct dev_context *devc,
+	const char *parent, float number)
+{
+	struct config_tree_node *choice_parent;
+
+	choice_parent = lookup_tree_path(devc, parent);
+	if (!choice_parent) {
+		sr_err("Tree path %s not found.", parent);
+		return NULL;
+	}
+
+	return select_next_largest_choice(choice_parent, number);
+}
+
 SR_PRIV int mooshimeter_dmm_set_larger_number(const struct sr_dev_inst *sdi,
 	const char *path, const char *parent, float number)
 {
@@ -1437,29 +1458,34 @@ SR_PRIV int mooshimeter_dmm_set_larger_number(const struct sr_dev_inst *sdi,
 }
 
 SR_PRIV gboolean mooshimeter_dmm_set_autorange(const struct sr_dev_inst *sdi,
-	const char *path, const char *parent, float latest)
+	enum tree_path path, enum tree_path parent, float latest)
 {
 	struct dev_context *devc = sdi->priv;
 	struct config_tree_node *selected_choice;
 	struct config_tree_node *target;
 
-	selected_choice = select_next_largest_in_tree(devc, parent,
+	if (!devc->tree_nodes[parent]) {
+		sr_err("Tree path %s not found.", tree_paths[parent]);
+		return FALSE;
+	}
+	selected_choice = select_next_largest_choice(devc->tree_nodes[parent],
 		fabsf(latest));
 	if (!selected_choice) {
-		sr_err("No choice available for %f at %s.", latest, parent);
+		sr_err("No choice available for %f at %s.", latest,
+			tree_paths[parent]);
 		return FALSE;
 	}
 
-	target = lookup_tree_path(devc, path);
+	target = devc->tree_nodes[path];
 	if (!target) {
-		sr_err("Tree path %s not found.", path);
+		sr_err("Tree path %s not found.", tree_paths[path]);
 		return FALSE;
 	}
 
 	if (get_tree_integer(target) == (int)selected_choice->index_in_parent)
 		return FALSE;
 
-	sr_spew("Changing autorange %s to index %d for %g.", path,
+	sr_spew("Changing autorange %s to index %d for %g.", tree_paths[path],
 		(int)selected_choice->index_in_parent, latest);
 
 	set_tree_integer(sdi, target, selected_choice->index_in_parent);
@@ -1557,7 +1583,7 @@ SR_PRIV int mooshimeter_dmm_heartbeat(int fd, int revents, void *cb_data)
 	if (!(devc = sdi->priv))
 		return TRUE;
 
-	target = lookup_tree_path(devc, "PCB_VERSION");
+	target = devc->tree_nodes[TREE_PATH_PCB_VERSION];
 	if (!target) {
 		sr_err("Tree for PCB_VERSION not found.");
 		return FALSE;
@@ -31,6 +31,9 @@ struct packet_rx {
 	int sequence_number;
 	GSList *reorder_buffer;
 	GByteArray *contents;
+	/* Bytes of contents which were processed, and nesting thereof. */
+	size_t offset;
+	int depth;
 };
 
 struct packet_tx {
@@ -74,13 +77,43 @@ struct config_tree_node {
 	void *on_update_param;
 };
 
+/*
+ * Tree nodes which acquisitions use. They get resolved once, when the
+ * startup handshake completed.
+ */
+enum tree_path {
+	TREE_PATH_CH1_VALUE,
+	TREE_PATH_CH1_BUF,
+	TREE_PATH_CH1_BUF_BPS,
+	TREE_PATH_CH1_BUF_LSB2NATIVE,
+	TREE_PATH_CH1_RANGE_I,
+	TREE_PATH_CH1_MAPPING_CURRENT,
+	TREE_PATH_CH1_MAPPING_TEMP,
+	TREE_PATH_CH2_VALUE,
+	TREE_PATH_CH2_BUF,
+	TREE_PATH_CH2_BUF_BPS,
+	TREE_PATH_CH2_BUF_LSB2NATIVE,
+	TREE_PATH_CH2_RANGE_I,
+	TREE_PATH_CH2_MAPPING_VOLTAGE,
+	TREE_PATH_CH2_MAPPING_TEMP,
+	TREE_PATH_SHARED_AUX_V,
+	TREE_PATH_SHARED_RESISTANCE,
+	TREE_PATH_SHARED_DIODE,
+	TREE_PATH_REAL_PWR,
+	TREE_PATH_PCB_VERSION,
+	TREE_PATH_COUNT,
+};
+
 struct dev_context {
 	struct packet_rx rx;
 	struct packet_tx tx;
 	struct config_tree_node tree_root;
-	struct config_tree_node *tree_id_lookup[0x7F];
+	struct config_tree_node *tree_id_lookup[0x80];
+	struct config_tree_node *tree_nodes[TREE_PATH_COUNT];
 	uint32_t buffer_bps[2];
 	float buffer_lsb2native[2];
+	float *buffer_values;
+	size_t buffer_values_size;
 
 	void (*channel_autorange[3])(const struct sr_dev_inst *sdi, float value);
 
@@ -95,7 +128,7 @@ SR_PRIV int mooshimeter_dmm_close(const struct sr_dev_inst *sdi);
 SR_PRIV int mooshimeter_dmm_set_chooser(const struct sr_dev_inst *sdi, const char *path, const char *choice);
 SR_PRIV int mooshimeter_dmm_set_integer(const struct sr_dev_inst *sdi, const char *path, int value);
 SR_PRIV int mooshimeter_dmm_set_larger_number(const struct sr_dev_inst *sdi, const char *path, const char *parent, float number);
-SR_PRIV gboolean mooshimeter_dmm_set_autorange(const struct sr_dev_inst *sdi, const char *path, const char *parent, float latest);
+SR_PRIV gboolean mooshimeter_dmm_set_autorange(const struct sr_dev_inst *sdi, enum tree_path path, enum tree_path parent, float latest);
 SR_PRIV int mooshimeter_dmm_get_chosen_number(const struct sr_dev_inst *sdi, const char *path, const char *parent, float *number);
 SR_PRIV int mooshimeter_dmm_get_available_number_choices(const struct sr_dev_inst *sdi, const char *path, float **numbers, size_t *count);
 SR_PRIV int mooshimeter_dmm_poll(int fd, int revents, void *cb_data);
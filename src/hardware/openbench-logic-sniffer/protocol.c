@@ -375,17 +375,243 @@ SR_PRIV void abort_acquisition(const struct sr_dev_inst *sdi)
 	std_session_send_df_end(sdi);
 }
 
-SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
+/*
+ * Send the samples of an RLE capture, from the runs which the device
+ * sent. Only the runs at either end of the range get trimmed.
+ */
+static void send_runs(const struct sr_dev_inst *sdi, uint64_t first,
+		uint64_t count)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic_rle rle;
+	const uint64_t *lengths;
+	uint64_t pos, skip, remain;
+	guint begin, i, num_runs;
+
+	devc = sdi->priv;
+	lengths = (const uint64_t *)devc->rle_lengths->data;
+	num_runs = devc->rle_lengths->len;
+
+	/* Find the run which holds the range's first sample. */
+	pos = 0;
+	for (i = 0; i < num_runs && pos + lengths[i] <= first; i++)
+		pos += lengths[i];
+	if (i == num_runs)
+		return;
+	begin = i;
+	skip = first - pos;
+
+	/* Find the run which holds the range's last sample. */
+	remain = skip + count;
+	for (; i < num_runs - 1 && remain > lengths[i]; i++)
+		remain -= lengths[i];
+	remain = MIN(remain, lengths[i]);
+
+	rle.num_runs = i - begin + 1;
+	rle.unitsize = 4;
+	rle.values = devc->rle_values->data + begin * 4;
+	rle.lengths = g_malloc(rle.num_runs * sizeof(rle.lengths[0]));
+	memcpy(rle.lengths, lengths + begin,
+		rle.num_runs * sizeof(rle.lengths[0]));
+	rle.lengths[rle.num_runs - 1] = remain;
+	rle.lengths[0] -= skip;
+
+	packet.type = SR_DF_LOGIC_RLE;
+	packet.payload = &rle;
+	sr_session_send(sdi, &packet);
+	g_free(rle.lengths);
+}
+
+/*
+ * Send samples first to first + count - 1 of the capture. Captures
+ * which the device has run-length encoded are passed on in that form,
+ * to keep idle stretches cheap for the consumers.
+ */
+static void send_samples(const struct sr_dev_inst *sdi, uint64_t first,
+		uint64_t count)
 {
 	struct dev_context *devc;
-	struct sr_dev_inst *sdi;
-	struct sr_serial_dev_inst *serial;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+
+	devc = sdi->priv;
+
+	if (!count)
+		return;
+
+	if (devc->capture_flags & CAPTURE_FLAG_RLE) {
+		send_runs(sdi, first, count);
+		return;
+	}
+
+	logic.length = count * 4;
+	logic.unitsize = 4;
+	logic.data = devc->raw_sample_buf +
+		(devc->limit_samples - devc->num_samples + first) * 4;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	sr_session_send(sdi, &packet);
+}
+
+/* Put the runs of an RLE capture into the order of time. */
+static void reverse_runs(struct dev_context *devc)
+{
+	uint64_t *lengths, length;
+	uint8_t *values, value[4];
+	guint i, j;
+
+	if (!devc->rle_lengths->len)
+		return;
+
+	lengths = (uint64_t *)devc->rle_lengths->data;
+	values = (uint8_t *)devc->rle_values->data;
+	for (i = 0, j = devc->rle_lengths->len - 1; i < j; i++, j--) {
+		length = lengths[i];
+		lengths[i] = lengths[j];
+		lengths[j] = length;
+		memcpy(value, values + i * 4, 4);
+		memcpy(values + i * 4, values + j * 4, 4);
+		memcpy(values + j * 4, value, 4);
+	}
+}
+
+/* Record a run of an RLE capture, merging it with an equal neighbour. */
+static void add_run(struct dev_context *devc, const uint8_t *sample,
+		uint64_t length)
+{
+	GArray *values, *lengths;
+
+	values = devc->rle_values;
+	lengths = devc->rle_lengths;
+	if (lengths->len && !memcmp(values->data + (values->len - 1) * 4,
+			sample, 4)) {
+		g_array_index(lengths, uint64_t, lengths->len - 1) += length;
+		return;
+	}
+
+	g_array_append_vals(values, sample, 1);
+	g_array_append_val(lengths, length);
+}
+
+/*
+ * Fill a number of samples with the same (4 byte) value. Copies ever
+ * larger chunks of what's been written already, so that long runs
+ * cost a few memcpy() calls instead of one per sample.
+ */
+static void fill_samples(uint8_t *dst, const uint8_t *sample, size_t count)
+{
+	size_t done, chunk;
+
+	if (!count)
+		return;
+
+	memcpy(dst, sample, 4);
+	done = 1;
+	while (done < count) {
+		chunk = MIN(done, count - done);
+		memcpy(dst + done * 4, dst, chunk * 4);
+		done += chunk;
+	}
+}
+
+/* Feed one received byte to the sample reassembly. */
+static void ols_receive_byte(struct dev_context *devc, unsigned char byte,
+		int num_changroups)
+{
 	uint32_t sample;
-	int num_changroups, offset, j;
+	int offset, j;
+	unsigned int i;
+
+	devc->sample[devc->num_bytes++] = byte;
+	if (devc->num_bytes != num_changroups)
+		return;
+
+	devc->cnt_samples++;
+	devc->cnt_samples_rle++;
+	/*
+	 * Got a full sample. Convert from the OLS's little-endian
+	 * sample to the local format.
+	 */
+	sample = devc->sample[0] | (devc->sample[1] << 8) |
+		 (devc->sample[2] << 16) |
+		 (devc->sample[3] << 24);
+	sr_spew("Received sample 0x%.*x.", devc->num_bytes * 2, sample);
+	if (devc->capture_flags & CAPTURE_FLAG_RLE) {
+		/*
+		 * In RLE mode the high bit of the sample is the
+		 * "count" flag, meaning this sample is the number
+		 * of times the previous sample occurred.
+		 */
+		if (devc->sample[devc->num_bytes - 1] & 0x80) {
+			/* Clear the high bit. */
+			sample &= ~(0x80 << (devc->num_bytes - 1) * 8);
+			devc->rle_count = sample;
+			devc->cnt_samples_rle += devc->rle_count;
+			sr_spew("RLE count: %u.", devc->rle_count);
+			devc->num_bytes = 0;
+			return;
+		}
+	}
+	devc->num_samples += devc->rle_count + 1;
+	if (devc->num_samples > devc->limit_samples) {
+		/* Save us from overrunning the buffer. */
+		devc->rle_count -= devc->num_samples - devc->limit_samples;
+		devc->num_samples = devc->limit_samples;
+	}
+
+	if (num_changroups < 4) {
+		/*
+		 * Some channel groups may have been turned
+		 * off, to speed up transfer between the
+		 * hardware and the PC. Expand that here before
+		 * submitting it over the session bus --
+		 * whatever is listening on the bus will be
+		 * expecting a full 32-bit sample, based on
+		 * the number of channels.
+		 */
+		j = 0;
+		uint8_t tmp_sample[4] = { 0, 0, 0, 0 };
+		for (i = 0; i < 4; i++) {
+			if (((devc->capture_flags >> 2) & (1 << i)) == 0) {
+				/*
+				 * This channel group was
+				 * enabled, copy from received
+				 * sample.
+				 */
+				tmp_sample[i] = devc->sample[j++];
+			}
+		}
+		memcpy(devc->sample, tmp_sample, 4);
+	}
+
+	/*
+	 * the OLS sends its sample buffer backwards.
+	 * store it in reverse order here, so we can dump
+	 * this on the session bus later. RLE captures keep
+	 * the runs as they are.
+	 */
+	if (devc->capture_flags & CAPTURE_FLAG_RLE) {
+		add_run(devc, devc->sample, devc->rle_count + 1);
+	} else {
+		offset = (devc->limit_samples - devc->num_samples) * 4;
+		fill_samples(devc->raw_sample_buf + offset, devc->sample,
+			devc->rle_count + 1);
+	}
+	memset(devc->sample, 0, 4);
+	devc->num_bytes = 0;
+	devc->rle_count = 0;
+}
+
+SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
+{
+	struct dev_context *devc;
+	struct sr_dev_inst *sdi;
+	struct sr_serial_dev_inst *serial;
+	unsigned char buf[OLS_READ_BLOCK_SIZE];
+	int num_changroups, len;
 	unsigned int i;
-	unsigned char byte;
 
 	(void)fd;
 
@@ -399,13 +625,19 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 	}
 
 	if (devc->num_transfers++ == 0) {
-		devc->raw_sample_buf = g_try_malloc(devc->limit_samples * 4);
-		if (!devc->raw_sample_buf) {
-			sr_err("Sample buffer malloc failed.");
-			return FALSE;
+		if (devc->capture_flags & CAPTURE_FLAG_RLE) {
+			devc->rle_values = g_array_new(FALSE, FALSE, 4);
+			devc->rle_lengths = g_array_new(FALSE, FALSE,
+				sizeof(uint64_t));
+		} else {
+			devc->raw_sample_buf = g_try_malloc(devc->limit_samples * 4);
+			if (!devc->raw_sample_buf) {
+				sr_err("Sample buffer malloc failed.");
+				return FALSE;
+			}
+			/* fill with 1010... for debugging */
+			memset(devc->raw_sample_buf, 0x82, devc->limit_samples * 4);
 		}
-		/* fill with 1010... for debugging */
-		memset(devc->raw_sample_buf, 0x82, devc->limit_samples * 4);
 	}
 
 	num_changroups = 0;
@@ -416,98 +648,16 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 	}
 
 	if (revents == G_IO_IN && devc->num_samples < devc->limit_samples) {
-		if (serial_read_nonblocking(serial, &byte, 1) != 1)
+		len = serial_read_nonblocking(serial, buf, sizeof(buf));
+		if (len < 1)
 			return FALSE;
-		devc->cnt_bytes++;
+		devc->cnt_bytes += len;
 
-		/* Ignore it if we've read enough. */
-		if (devc->num_samples >= devc->limit_samples)
-			return TRUE;
-
-		devc->sample[devc->num_bytes++] = byte;
-		sr_spew("Received byte 0x%.2x.", byte);
-		if (devc->num_bytes == num_changroups) {
-			devc->cnt_samples++;
-			devc->cnt_samples_rle++;
-			/*
-			 * Got a full sample. Convert from the OLS's little-endian
-			 * sample to the local format.
-			 */
-			sample = devc->sample[0] | (devc->sample[1] << 8) |
-				 (devc->sample[2] << 16) |
-				 (devc->sample[3] << 24);
-			sr_dbg("Received sample 0x%.*x.", devc->num_bytes * 2,
-			       sample);
-			if (devc->capture_flags & CAPTURE_FLAG_RLE) {
-				/*
-				 * In RLE mode the high bit of the sample is the
-				 * "count" flag, meaning this sample is the number
-				 * of times the previous sample occurred.
-				 */
-				if (devc->sample[devc->num_bytes - 1] & 0x80) {
-					/* Clear the high bit. */
-					sample &= ~(0x80 << (devc->num_bytes -
-							     1) * 8);
-					devc->rle_count = sample;
-					devc->cnt_samples_rle +=
-						devc->rle_count;
-					sr_dbg("RLE count: %u.",
-					       devc->rle_count);
-					devc->num_bytes = 0;
-					return TRUE;
-				}
-			}
-			devc->num_samples += devc->rle_count + 1;
-			if (devc->num_samples > devc->limit_samples) {
-				/* Save us from overrunning the buffer. */
-				devc->rle_count -=
-					devc->num_samples - devc->limit_samples;
-				devc->num_samples = devc->limit_samples;
-			}
-
-			if (num_changroups < 4) {
-				/*
-				 * Some channel groups may have been turned
-				 * off, to speed up transfer between the
-				 * hardware and the PC. Expand that here before
-				 * submitting it over the session bus --
-				 * whatever is listening on the bus will be
-				 * expecting a full 32-bit sample, based on
-				 * the number of channels.
-				 */
-				j = 0;
-				uint8_t tmp_sample[4] = { 0, 0, 0, 0 };
-				for (i = 0; i < 4; i++) {
-					if (((devc->capture_flags >> 2) &
-					     (1 << i)) == 0) {
-						/*
-						 * This channel group was
-						 * enabled, copy from received
-						 * sample.
-						 */
-						tmp_sample[i] =
-							devc->sample[j++];
-					}
-				}
-				memcpy(devc->sample, tmp_sample, 4);
-				sr_spew("Expanded sample: 0x%.2hhx%.2hhx%.2hhx%.2hhx ",
-					devc->sample[3], devc->sample[2],
-					devc->sample[1], devc->sample[0]);
-			}
-
-			/*
-			 * the OLS sends its sample buffer backwards.
-			 * store it in reverse order here, so we can dump
-			 * this on the session bus later.
-			 */
-			offset = (devc->limit_samples - devc->num_samples) * 4;
-			for (i = 0; i <= devc->rle_count; i++) {
-				memcpy(devc->raw_sample_buf + offset + (i * 4),
-				       devc->sample, 4);
-			}
-			memset(devc->sample, 0, 4);
-			devc->num_bytes = 0;
-			devc->rle_count = 0;
+		/* Ignore what's left once we've read enough. */
+		for (i = 0; i < (unsigned int)len; i++) {
+			if (devc->num_samples >= devc->limit_samples)
+				break;
+			ols_receive_byte(devc, buf[i], num_changroups);
 		}
 	} else {
 		/*
@@ -518,6 +668,8 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 		sr_dbg("Received %d bytes, %d samples, %d decompressed samples.",
 		       devc->cnt_bytes, devc->cnt_samples,
 		       devc->cnt_samples_rle);
+		if (devc->rle_lengths)
+			reverse_runs(devc);
 		if (devc->trigger_at_smpl != OLS_NO_TRIGGER) {
 			/*
 			 * A trigger was set up, so we need to tell the frontend
@@ -525,15 +677,7 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 			 */
 			if (devc->trigger_at_smpl > 0) {
 				/* There are pre-trigger samples, send those first. */
-				packet.type = SR_DF_LOGIC;
-				packet.payload = &logic;
-				logic.length = devc->trigger_at_smpl * 4;
-				logic.unitsize = 4;
-				logic.data = devc->raw_sample_buf +
-					     (devc->limit_samples -
-					      devc->num_samples) *
-						     4;
-				sr_session_send(sdi, &packet);
+				send_samples(sdi, 0, devc->trigger_at_smpl);
 			}
 
 			/* Send the trigger. */
@@ -545,18 +689,16 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 							      OLS_NO_TRIGGER ?
 							    0 :
 							    devc->trigger_at_smpl;
-		packet.type = SR_DF_LOGIC;
-		packet.payload = &logic;
-		logic.length =
-			(devc->num_samples - num_pre_trigger_samples) * 4;
-		logic.unitsize = 4;
-		logic.data = devc->raw_sample_buf +
-			     (num_pre_trigger_samples + devc->limit_samples -
-			      devc->num_samples) *
-				     4;
-		sr_session_send(sdi, &packet);
+		send_samples(sdi, num_pre_trigger_samples,
+			     devc->num_samples - num_pre_trigger_samples);
 
 		g_free(devc->raw_sample_buf);
+		devc->raw_sample_buf = NULL;
+		if (devc->rle_lengths) {
+			g_array_free(devc->rle_values, TRUE);
+			g_array_free(devc->rle_lengths, TRUE);
+			devc->rle_values = devc->rle_lengths = NULL;
+		}
 
 		serial_flush(serial);
 		abort_acquisition(sdi);
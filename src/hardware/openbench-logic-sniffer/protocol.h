@@ -32,6 +32,8 @@
 #define CLOCK_RATE                   SR_MHZ(100)
 #define MIN_NUM_SAMPLES              4
 #define DEFAULT_SAMPLERATE           SR_KHZ(200)
+/* Most bytes which get read from the serial port per callback. */
+#define OLS_READ_BLOCK_SIZE          4096
 
 /* Command opcodes */
 #define CMD_RESET                     0x00
@@ -124,6 +126,9 @@ struct dev_context {
 	unsigned int rle_count;
 	unsigned char sample[4];
 	unsigned char *raw_sample_buf;
+	/* Runs of RLE captures, in the (reversed) order of reception. */
+	GArray *rle_values;
+	GArray *rle_lengths;
 };
 
 SR_PRIV extern const char *ols_channel_names[];
@@ -245,6 +245,7 @@ static int dev_open(struct sr_dev_inst *sdi)
 
 static int dev_close(struct sr_dev_inst *sdi)
 {
+	struct dev_context *devc;
 	struct sr_modbus_dev_inst *modbus;
 	struct rdtech_dps_state state;
 
@@ -257,6 +258,10 @@ static int dev_close(struct sr_dev_inst *sdi)
 	state.mask |= STATE_LOCK;
 	(void)rdtech_dps_set_state(sdi, &state);
 
+	devc = sdi->priv;
+	sr_modbus_batch_free(devc->batch);
+	devc->batch = NULL;
+
 	return sr_modbus_close(modbus);
 }
 
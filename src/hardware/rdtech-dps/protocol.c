@@ -118,6 +118,43 @@ static int rdtech_dps_read_holding_registers(struct sr_modbus_dev_inst *modbus,
 	return ret;
 }
 
+/*
+ * Read the state registers, that is the live values and the protection
+ * thresholds, in one batch. Retries failed attempts like the above.
+ * The batch is kept until the device gets closed.
+ */
+static int rdtech_dps_read_state_registers(const struct sr_dev_inst *sdi,
+	int address, int nb_registers, int thr_address)
+{
+	struct dev_context *devc;
+	size_t retries;
+	int ret;
+
+	devc = sdi->priv;
+
+	g_mutex_lock(&devc->rw_mutex);
+	if (!devc->batch) {
+		devc->batch = sr_modbus_batch_new(sdi->conn, 0);
+		sr_modbus_batch_add(devc->batch,
+			address, nb_registers, &devc->registers[0]);
+		sr_modbus_batch_add(devc->batch,
+			thr_address, 2, &devc->registers[nb_registers]);
+	}
+
+	retries = 3;
+	while (retries--) {
+		ret = sr_modbus_batch_rewind(devc->batch);
+		if (ret != SR_OK)
+			break;
+		ret = sr_modbus_batch_run(devc->batch);
+		if (ret == SR_OK)
+			break;
+	}
+	g_mutex_unlock(&devc->rw_mutex);
+
+	return ret;
+}
+
 /* Set one 16bit register. LE format for DPS devices. */
 static int rdtech_dps_set_reg(const struct sr_dev_inst *sdi,
 	uint16_t address, uint16_t value)
@@ -257,9 +294,7 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 	struct rdtech_dps_state *state, enum rdtech_dps_state_context reason)
 {
 	struct dev_context *devc;
-	struct sr_modbus_dev_inst *modbus;
 	gboolean get_config, get_init_state, get_curr_meas;
-	uint16_t registers[12];
 	int ret;
 	const uint8_t *rdptr;
 	uint16_t uset_raw, iset_raw, uout_raw, iout_raw, power_raw;
@@ -273,7 +308,6 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 	if (!sdi || !sdi->priv || !sdi->conn)
 		return SR_ERR_ARG;
 	devc = sdi->priv;
-	modbus = sdi->conn;
 	if (!state)
 		return SR_ERR_ARG;
 
@@ -311,22 +345,21 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 	switch (devc->model->model_type) {
 	case MODEL_DPS:
 		/*
-		 * Transfer a chunk of registers in a single call. It's
+		 * Transfer the live values and the protection thresholds
+		 * in a single batch, then interpret them. It's
 		 * unfortunate that the model dependency and the sparse
 		 * register map force us to open code addresses, sizes,
 		 * and the sequence of the registers and how to interpret
 		 * their bit fields. But then this is not too unusual for
 		 * a hardware specific device driver ...
 		 */
-		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			REG_DPS_USET, 10, registers);
-		g_mutex_unlock(&devc->rw_mutex);
+		ret = rdtech_dps_read_state_registers(sdi,
+			REG_DPS_USET, 10, PRE_DPS_OVPSET);
 		if (ret != SR_OK)
 			return ret;
 
 		/* Interpret the registers' values. */
-		rdptr = (const void *)registers;
+		rdptr = (const void *)devc->registers;
 		uset_raw = read_u16le_inc(&rdptr);
 		volt_target = uset_raw / devc->voltage_multiplier;
 		iset_raw = read_u16le_inc(&rdptr);
@@ -348,16 +381,7 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		out_state = read_u16le_inc(&rdptr); /* ENABLE */
 		is_out_enabled = out_state != 0;
 
-		/* Transfer another chunk of registers in a single call. */
-		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			PRE_DPS_OVPSET, 2, registers);
-		g_mutex_unlock(&devc->rw_mutex);
-		if (ret != SR_OK)
-			return ret;
-
 		/* Interpret the second registers chunk's values. */
-		rdptr = (const void *)registers;
 		ovpset_raw = read_u16le_inc(&rdptr); /* PRE OVPSET */
 		ovp_threshold = ovpset_raw * devc->voltage_multiplier;
 		ocpset_raw = read_u16le_inc(&rdptr); /* PRE OCPSET */
@@ -366,16 +390,14 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		break;
 
 	case MODEL_RD:
-		/* Retrieve a set of adjacent registers. */
-		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			REG_RD_VOLT_TGT, 11, registers);
-		g_mutex_unlock(&devc->rw_mutex);
+		/* Retrieve the live values and the thresholds. */
+		ret = rdtech_dps_read_state_registers(sdi,
+			REG_RD_VOLT_TGT, 11, REG_RD_OVP_THR);
 		if (ret != SR_OK)
 			return ret;
 
 		/* Interpret the registers' raw content. */
-		rdptr = (const void *)registers;
+		rdptr = (const void *)devc->registers;
 		uset_raw = read_u16be_inc(&rdptr); /* USET */
 		volt_target = uset_raw / devc->voltage_multiplier;
 		iset_raw = read_u16be_inc(&rdptr); /* ISET */
@@ -397,16 +419,7 @@ SR_PRIV int rdtech_dps_get_state(const struct sr_dev_inst *sdi,
 		out_state = read_u16be_inc(&rdptr); /* ENABLE */
 		is_out_enabled = out_state != 0;
 
-		/* Retrieve a set of adjacent registers. */
-		g_mutex_lock(&devc->rw_mutex);
-		ret = rdtech_dps_read_holding_registers(modbus,
-			REG_RD_OVP_THR, 2, registers);
-		g_mutex_unlock(&devc->rw_mutex);
-		if (ret != SR_OK)
-			return ret;
-
-		/* Interpret the registers' raw content. */
-		rdptr = (const void *)registers;
+		/* Interpret the thresholds' raw content. */
 		ovpset_raw = read_u16be_inc(&rdptr); /* OVP THR */
 		ovp_threshold = ovpset_raw / devc->voltage_multiplier;
 		ocpset_raw = read_u16be_inc(&rdptr); /* OCP THR */
@@ -647,26 +660,26 @@ SR_PRIV int rdtech_dps_receive_data(int fd, int revents, void *cb_data)
 
 	/* Check for state changes. */
 	if (devc->curr_ovp_state != state.protect_ovp) {
-		(void)sr_session_send_meta(sdi,
+		(void)sr_session_send_meta_boolean(sdi,
 			SR_CONF_OVER_VOLTAGE_PROTECTION_ACTIVE,
-			g_variant_new_boolean(state.protect_ovp));
+			state.protect_ovp);
 		devc->curr_ovp_state = state.protect_ovp;
 	}
 	if (devc->curr_ocp_state != state.protect_ocp) {
-		(void)sr_session_send_meta(sdi,
+		(void)sr_session_send_meta_boolean(sdi,
 			SR_CONF_OVER_CURRENT_PROTECTION_ACTIVE,
-			g_variant_new_boolean(state.protect_ocp));
+			state.protect_ocp);
 		devc->curr_ocp_state = state.protect_ocp;
 	}
 	if (devc->curr_cc_state != state.regulation_cc) {
 		regulation_text = state.regulation_cc ? "CC" : "CV";
-		(void)sr_session_send_meta(sdi, SR_CONF_REGULATION,
-			g_variant_new_string(regulation_text));
+		(void)sr_session_send_meta_string(sdi, SR_CONF_REGULATION,
+			regulation_text);
 		devc->curr_cc_state = state.regulation_cc;
 	}
 	if (devc->curr_out_state != state.output_enabled) {
-		(void)sr_session_send_meta(sdi, SR_CONF_ENABLED,
-			g_variant_new_boolean(state.output_enabled));
+		(void)sr_session_send_meta_boolean(sdi, SR_CONF_ENABLED,
+			state.output_enabled);
 		devc->curr_out_state = state.output_enabled;
 	}
 
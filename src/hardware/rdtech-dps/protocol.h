@@ -55,6 +55,9 @@ struct dev_context {
 	double voltage_multiplier;
 	struct sr_sw_limits limits;
 	GMutex rw_mutex;
+	/* Reads the state registers, see rdtech_dps_get_state(). */
+	struct sr_modbus_batch *batch;
+	uint16_t registers[13];
 	gboolean curr_ovp_state;
 	gboolean curr_ocp_state;
 	gboolean curr_cc_state;
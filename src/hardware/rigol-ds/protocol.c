@@ -605,9 +605,10 @@ static int rigol_ds_read_header(struct sr_dev_inst *sdi)
 	return ret;
 }
 
-SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
+/* Convert and send the samples of a channel in the receive buffer. */
+static void rigol_ds_send_data(const struct sr_dev_inst *sdi,
+		struct sr_channel *ch, int len)
 {
-	struct sr_dev_inst *sdi;
 	struct sr_scpi_dev_inst *scpi;
 	struct dev_context *devc;
 	struct sr_datafeed_packet packet;
@@ -617,7 +618,62 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	struct sr_analog_spec spec;
 	struct sr_datafeed_logic logic;
 	double vdiv, offset, origin;
-	int len, i, vref;
+	float lut[256];
+	int i, vref;
+
+	devc = sdi->priv;
+
+	/* The samples arrived with the last read of the data block. */
+	scpi = sdi->conn;
+	sr_session_receive_time_set(sdi, scpi->read_us);
+
+	if (ch->type == SR_CHANNEL_ANALOG) {
+		vref = devc->vert_reference[ch->index];
+		vdiv = devc->vert_inc[ch->index];
+		origin = devc->vert_origin[ch->index];
+		offset = devc->vert_offset[ch->index];
+		/* Samples are 8 bits wide, convert them by table lookup. */
+		if (devc->model->series->protocol >= PROTOCOL_V3)
+			for (i = 0; i < 256; i++)
+				lut[i] = (i - vref - origin) * vdiv;
+		else
+			for (i = 0; i < 256; i++)
+				lut[i] = (128 - i) * vdiv - offset;
+		for (i = 0; i < len; i++)
+			devc->data[i] = lut[devc->buffer[i]];
+		float vdivlog = log10f(vdiv);
+		int digits = -(int)vdivlog + (vdivlog < 0.0);
+		sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
+		analog.meaning->channels = g_slist_append(NULL, ch);
+		analog.num_samples = len;
+		analog.data = devc->data;
+		analog.meaning->mq = SR_MQ_VOLTAGE;
+		analog.meaning->unit = SR_UNIT_VOLT;
+		analog.meaning->mqflags = 0;
+		packet.type = SR_DF_ANALOG;
+		packet.payload = &analog;
+		sr_session_send(sdi, &packet);
+		g_slist_free(analog.meaning->channels);
+	} else {
+		logic.length = len;
+		// TODO: For the MSO1000Z series, we need a way to express that
+		// this data is in fact just for a single channel, with the valid
+		// data for that channel in the LSB of each byte.
+		logic.unitsize = devc->model->series->protocol >= PROTOCOL_V4 ? 1 : 2;
+		logic.data = devc->buffer;
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		sr_session_send(sdi, &packet);
+	}
+}
+
+SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_scpi_dev_inst *scpi;
+	struct dev_context *devc;
+	int len;
+	char linefeed;
 	struct sr_channel *ch;
 	gsize expected_data_bytes;
 
@@ -738,47 +794,11 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 
 	devc->num_block_read += len;
 
-	if (ch->type == SR_CHANNEL_ANALOG) {
-		vref = devc->vert_reference[ch->index];
-		vdiv = devc->vert_inc[ch->index];
-		origin = devc->vert_origin[ch->index];
-		offset = devc->vert_offset[ch->index];
-		if (devc->model->series->protocol >= PROTOCOL_V3)
-			for (i = 0; i < len; i++)
-				devc->data[i] = ((int)devc->buffer[i] - vref - origin) * vdiv;
-		else
-			for (i = 0; i < len; i++)
-				devc->data[i] = (128 - devc->buffer[i]) * vdiv - offset;
-		float vdivlog = log10f(vdiv);
-		int digits = -(int)vdivlog + (vdivlog < 0.0);
-		sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
-		analog.meaning->channels = g_slist_append(NULL, ch);
-		analog.num_samples = len;
-		analog.data = devc->data;
-		analog.meaning->mq = SR_MQ_VOLTAGE;
-		analog.meaning->unit = SR_UNIT_VOLT;
-		analog.meaning->mqflags = 0;
-		packet.type = SR_DF_ANALOG;
-		packet.payload = &analog;
-		sr_session_send(sdi, &packet);
-		g_slist_free(analog.meaning->channels);
-	} else {
-		logic.length = len;
-		// TODO: For the MSO1000Z series, we need a way to express that
-		// this data is in fact just for a single channel, with the valid
-		// data for that channel in the LSB of each byte.
-		logic.unitsize = devc->model->series->protocol >= PROTOCOL_V4 ? 1 : 2;
-		logic.data = devc->buffer;
-		packet.type = SR_DF_LOGIC;
-		packet.payload = &logic;
-		sr_session_send(sdi, &packet);
-	}
-
 	if (devc->num_block_read == devc->num_block_bytes) {
 		sr_dbg("Block has been completed");
 		if (devc->model->series->protocol >= PROTOCOL_V3) {
 			/* Discard the terminating linefeed */
-			sr_scpi_read_data(scpi, (char *)devc->buffer, 1);
+			sr_scpi_read_data(scpi, &linefeed, 1);
 		}
 		if (devc->format == FORMAT_IEEE488_2) {
 			/* Prepare for possible next block */
@@ -798,9 +818,11 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 
 	devc->num_channel_bytes += len;
 
-	if (devc->num_channel_bytes < expected_data_bytes)
+	if (devc->num_channel_bytes < expected_data_bytes) {
 		/* Don't have the full data for this channel yet, re-run. */
+		rigol_ds_send_data(sdi, ch, len);
 		return TRUE;
+	}
 
 	/* End of data for this channel. */
 	if (devc->model->series->protocol == PROTOCOL_V3) {
@@ -815,10 +837,18 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	}
 
 	if (devc->channel_entry->next) {
-		/* We got the frame for this channel, now get the next channel. */
+		/*
+		 * We got the frame for this channel, now get the next channel.
+		 * Request it before the last data of this channel gets sent,
+		 * so that the scope prepares (and for older protocols already
+		 * transmits) the next waveform during the conversion.
+		 */
 		devc->channel_entry = devc->channel_entry->next;
 		rigol_ds_channel_start(sdi);
+		rigol_ds_send_data(sdi, ch, len);
 	} else {
+		rigol_ds_send_data(sdi, ch, len);
+
 		/* Done with this frame. */
 		std_session_send_df_frame_end(sdi);
 
@@ -60,17 +60,20 @@ static const uint64_t samplerates[] = {
 static int upload_firmware(struct sr_context *ctx, libusb_device *dev, const char *name)
 {
 	struct libusb_device_handle *hdl = NULL;
-	unsigned char *firmware = NULL;
+	GBytes *bytes;
+	unsigned char *firmware;
 	int ret = SR_ERR;
 	size_t fw_size, fw_offset = 0;
 	uint32_t part_address = 0;
 	uint16_t part_size = 0;
 	uint8_t part_final = 0;
 
-	firmware = sr_resource_load(ctx, SR_RESOURCE_FIRMWARE,
-				    name, &fw_size, 256 * 1024);
-	if (!firmware)
-		goto out;
+	bytes = sr_resource_load_cached(ctx, SR_RESOURCE_FIRMWARE,
+					name, 256 * 1024);
+	if (!bytes)
+		return SR_ERR;
+	/* Control transfers to the device only read the buffer. */
+	firmware = (unsigned char *)g_bytes_get_data(bytes, &fw_size);
 
 	sr_info("Uploading firmware '%s'.", name);
 
@@ -121,7 +124,7 @@ static int upload_firmware(struct sr_context *ctx, libusb_device *dev, const cha
 	if (hdl)
 		libusb_close(hdl);
 
-	g_free(firmware);
+	g_bytes_unref(bytes);
 
 	return ret;
 }
@@ -190,7 +193,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		}
 	}
 
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (unsigned int i = 0; devlist[i]; i++) {
 		libusb_get_device_descriptor(devlist[i], &des);
 
@@ -214,7 +217,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		/* Give the device some time to come back and scan again */
 		libusb_free_device_list(devlist, 1);
 		g_usleep(500 * 1000);
-		libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+		usb_get_device_list(drvc->sr_ctx, &devlist);
 	}
 	if (conn)
 		conn_devices = sr_usb_find(drvc->sr_ctx->libusb_ctx, conn);
@@ -240,7 +243,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		if (des.idVendor != 0x21a9 || des.idProduct != 0x1006)
 			continue;
 
-		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+		if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 			continue;
 
 		sdi = g_malloc0(sizeof(struct sr_dev_inst));
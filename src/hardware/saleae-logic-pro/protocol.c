@@ -492,17 +492,19 @@ static int upload_bitstream(const struct sr_dev_inst *sdi,
 			    const char *name)
 {
 	struct drv_context *drvc = sdi->driver->context;
-	unsigned char *bitstream = NULL;
+	GBytes *bytes;
+	const uint8_t *bitstream;
 	uint8_t req[2];
 	uint8_t rsp[1];
 	uint8_t reg_val;
 	int ret = SR_ERR;
 	size_t bs_size, bs_offset = 0, bs_part_size;
 
-	bitstream = sr_resource_load(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
-				     name, &bs_size, 512 * 1024);
-	if (!bitstream)
-		goto out;
+	bytes = sr_resource_load_cached(drvc->sr_ctx, SR_RESOURCE_FIRMWARE,
+					name, 512 * 1024);
+	if (!bytes)
+		return SR_ERR;
+	bitstream = g_bytes_get_data(bytes, &bs_size);
 
 	sr_info("Uploading bitstream '%s'.", name);
 
@@ -511,7 +513,7 @@ static int upload_bitstream(const struct sr_dev_inst *sdi,
 
 	ret = transact(sdi, req, sizeof(req), rsp, sizeof(rsp));
 	if (ret != SR_OK)
-		return ret;
+		goto out;
 	if (rsp[0] != 0x00) {
 		sr_err("Failed to start bitstream upload (0x%02x).", rsp[0]);
 		ret = SR_ERR;
@@ -543,7 +545,7 @@ static int upload_bitstream(const struct sr_dev_inst *sdi,
 	}
 
  out:
-	g_free(bitstream);
+	g_bytes_unref(bytes);
 
 	return ret;
 }
@@ -797,6 +799,8 @@ SR_PRIV int saleae_logic_pro_start(const struct sr_dev_inst *sdi)
 
 	devc->conv_size = 0;
 	devc->batch_index = 0;
+	memset(devc->conv_lo, 0, sizeof(devc->conv_lo));
+	memset(devc->conv_hi, 0, sizeof(devc->conv_hi));
 
 	write_reg(sdi, 0x00, 0x01);
 
@@ -845,41 +849,56 @@ static void saleae_logic_pro_send_data(const struct sr_dev_inst *sdi,
  * One batch from the device consists of 32 samples per active digital channel.
  * This stream of batches is packed into USB packets with 16384 bytes each.
  */
-static void saleae_logic_pro_convert_data(const struct sr_dev_inst *sdi,
+/* Spread the bits of a byte to the LSBs of 8 bytes, MSB first. */
+static inline uint64_t spread_bits(uint8_t x)
+{
+	return ((x * UINT64_C(0x8040201008040201)) &
+		UINT64_C(0x8080808080808080)) >> 7;
+}
+
+/*
+ * The device sends one 32-bit word per enabled channel for each batch of
+ * 32 samples, the first sample in the MSB. The batch gets accumulated
+ * 8 samples at a time, the low and high bytes of 8 samples in one word
+ * each, without testing individual bits.
+ */
+SR_PRIV void saleae_logic_pro_convert_data(const struct sr_dev_inst *sdi,
 					 const uint32_t *src, size_t srccnt)
 {
 	struct dev_context *devc = sdi->priv;
-	uint8_t *dst = devc->conv_buffer;
+	uint16_t *dst = (uint16_t *)devc->conv_buffer;
 	uint32_t samples;
-	uint16_t channel_mask;
-	unsigned int sample_index, batch_index;
-	uint16_t *dst_batch;
+	uint64_t mask_lo, mask_hi, bits;
+	unsigned int batch_index, group, k;
 
-	/* Copy partial batch to the beginning. */
-	memcpy(dst, dst + devc->conv_size, CONV_BATCH_SIZE);
 	/* Reset converted size. */
 	devc->conv_size = 0;
 
 	batch_index = devc->batch_index;
 	while (srccnt--) {
 		samples = *src++;
-		dst_batch = (uint16_t*)dst;
-
-		/* First index of the batch. */
-		if (batch_index == 0)
-			memset(dst, 0, CONV_BATCH_SIZE);
 
 		/* Convert one channel. */
-		channel_mask = devc->dig_channel_masks[batch_index];
-		for (sample_index = 0; sample_index <= 31; sample_index++)
-			if ((samples >> (31 - sample_index)) & 1)
-				dst_batch[sample_index] |= channel_mask;
+		mask_lo = devc->dig_channel_masks[batch_index] & 0xff;
+		mask_hi = devc->dig_channel_masks[batch_index] >> 8;
+		for (group = 0; group < 4; group++) {
+			bits = spread_bits(samples >> (24 - 8 * group));
+			devc->conv_lo[group] |= bits * mask_lo;
+			devc->conv_hi[group] |= bits * mask_hi;
+		}
 
 		/* Last index of the batch. */
 		if (++batch_index == devc->dig_channel_cnt) {
+			for (group = 0; group < 4; group++) {
+				for (k = 0; k < 8; k++) {
+					*dst++ = ((devc->conv_lo[group] >> (8 * k)) & 0xff) |
+						(((devc->conv_hi[group] >> (8 * k)) & 0xff) << 8);
+				}
+				devc->conv_lo[group] = 0;
+				devc->conv_hi[group] = 0;
+			}
 			devc->conv_size += CONV_BATCH_SIZE;
 			batch_index = 0;
-			dst += CONV_BATCH_SIZE;
 		}
 	}
 	devc->batch_index = batch_index;
@@ -891,6 +910,10 @@ SR_PRIV void LIBUSB_CALL saleae_logic_pro_receive_data(struct libusb_transfer *t
 	struct dev_context *devc = sdi->priv;
 	int ret;
 
+	sr_trace3(usb_transfer_done, sdi, transfer->status,
+		transfer->actual_length);
+	sr_session_receive_time_set(sdi, g_get_monotonic_time());
+
 	switch (transfer->status) {
 	case LIBUSB_TRANSFER_NO_DEVICE:
 		sr_dbg("FIXME no device");
@@ -906,6 +929,7 @@ SR_PRIV void LIBUSB_CALL saleae_logic_pro_receive_data(struct libusb_transfer *t
 	saleae_logic_pro_convert_data(sdi, (uint32_t*)transfer->buffer, 16 * 1024 / 4);
 	saleae_logic_pro_send_data(sdi, devc->conv_buffer, devc->conv_size, 2);
 
+	sr_trace2(usb_transfer_submit, sdi, transfer->length);
 	if ((ret = libusb_submit_transfer(transfer)) != LIBUSB_SUCCESS)
 		sr_dbg("FIXME resubmit failed");
 }
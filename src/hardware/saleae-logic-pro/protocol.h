@@ -31,8 +31,8 @@
 #define CONV_BATCH_SIZE (2 * 32)
 
 /*
- * One packet + one partial conversion: Worst case is only one active
- * channel converted to 2 bytes per sample, with 8 * 16384 samples per packet.
+ * One packet: Worst case is only one active channel converted to
+ * 2 bytes per sample, with 8 * 16384 samples per packet.
  */
 #define CONV_BUFFER_SIZE (2 * 8 * 16384 + CONV_BATCH_SIZE)
 
@@ -51,12 +51,17 @@ struct dev_context {
 	uint8_t *conv_buffer;
 	unsigned int conv_size;
 	unsigned int batch_index;
+	/* Partial batch, low and high bytes of 8 samples per word. */
+	uint64_t conv_lo[4];
+	uint64_t conv_hi[4];
 };
 
 SR_PRIV int saleae_logic_pro_init(const struct sr_dev_inst *sdi);
 SR_PRIV int saleae_logic_pro_prepare(const struct sr_dev_inst *sdi);
 SR_PRIV int saleae_logic_pro_start(const struct sr_dev_inst *sdi);
 SR_PRIV int saleae_logic_pro_stop(const struct sr_dev_inst *sdi);
+SR_PRIV void saleae_logic_pro_convert_data(const struct sr_dev_inst *sdi,
+		const uint32_t *src, size_t srccnt);
 SR_PRIV void LIBUSB_CALL saleae_logic_pro_receive_data(struct libusb_transfer *transfer);
 
 #endif
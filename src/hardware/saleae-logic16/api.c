@@ -101,43 +101,6 @@ static const uint64_t samplerates[] = {
 	SR_MHZ(100),
 };
 
-static gboolean check_conf_profile(libusb_device *dev)
-{
-	struct libusb_device_descriptor des;
-	struct libusb_device_handle *hdl;
-	gboolean ret;
-	unsigned char strdesc[64];
-
-	hdl = NULL;
-	ret = FALSE;
-	while (!ret) {
-		/* Assume the FW has not been loaded, unless proven wrong. */
-		libusb_get_device_descriptor(dev, &des);
-
-		if (libusb_open(dev, &hdl) != 0)
-			break;
-
-		if (libusb_get_string_descriptor_ascii(hdl,
-		    des.iManufacturer, strdesc, sizeof(strdesc)) < 0)
-			break;
-		if (strcmp((const char *)strdesc, "Saleae LLC"))
-			break;
-
-		if (libusb_get_string_descriptor_ascii(hdl,
-		    des.iProduct, strdesc, sizeof(strdesc)) < 0)
-			break;
-		if (strcmp((const char *)strdesc, "Logic S/16"))
-			break;
-
-		/* If we made it here, it must be a configured Logic16. */
-		ret = TRUE;
-	}
-	if (hdl)
-		libusb_close(hdl);
-
-	return ret;
-}
-
 static GSList *scan(struct sr_dev_driver *di, GSList *options)
 {
 	struct drv_context *drvc;
@@ -170,7 +133,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 	/* Find all Logic16 devices and upload firmware to them. */
 	devices = NULL;
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	usb_get_device_list(drvc->sr_ctx, &devlist);
 	for (i = 0; devlist[i]; i++) {
 		if (conn) {
 			usb = NULL;
@@ -188,7 +151,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 		libusb_get_device_descriptor(devlist[i], &des);
 
-		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+		if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 			continue;
 
 		if (des.idVendor != LOGIC16_VID || des.idProduct != LOGIC16_PID)
@@ -209,7 +172,8 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 		sdi->priv = devc;
 		devices = g_slist_append(devices, sdi);
 
-		if (check_conf_profile(devlist[i])) {
+		if (usb_match_manuf_prod(drvc->sr_ctx, devlist[i],
+		    "Saleae LLC", "Logic S/16")) {
 			/* Already has the firmware, so fix the new address. */
 			sr_dbg("Found a Logic16 device.");
 			sdi->status = SR_ST_INACTIVE;
@@ -250,7 +214,7 @@ static int logic16_dev_open(struct sr_dev_inst *sdi)
 	drvc = di->context;
 	usb = sdi->conn;
 
-	device_count = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	device_count = usb_get_device_list(drvc->sr_ctx, &devlist);
 	if (device_count < 0) {
 		sr_err("Failed to get device list: %s.",
 		       libusb_error_name(device_count));
@@ -268,7 +232,7 @@ static int logic16_dev_open(struct sr_dev_inst *sdi)
 			/*
 			 * Check device by its physical USB bus/port address.
 			 */
-			if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+			if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 				continue;
 
 			if (strcmp(sdi->connection_id, connection_id))
@@ -559,12 +523,13 @@ static unsigned int get_timeout(struct dev_context *devc)
 	return timeout + timeout / 4; /* Leave a headroom of 25% percent. */
 }
 
-static int configure_channels(const struct sr_dev_inst *sdi)
+SR_PRIV int logic16_configure_channels(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_channel *ch;
 	GSList *l;
 	uint16_t channel_bit;
+	int g, v, j;
 
 	devc = sdi->priv;
 
@@ -591,6 +556,18 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 		devc->channel_masks[devc->num_channels++] = channel_bit;
 	}
 
+	/* Map bit j of group g to the output bit of channel 8 * g + j. */
+	for (g = 0; g < 2; g++) {
+		for (v = 0; v < 256; v++) {
+			devc->channel_lut[g][v] = 0;
+			for (j = 0; j < 8; j++) {
+				if ((v & (1 << j)) && 8 * g + j < devc->num_channels)
+					devc->channel_lut[g][v] |=
+						devc->channel_masks[8 * g + j];
+			}
+		}
+	}
+
 	return SR_OK;
 }
 
@@ -639,7 +616,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	usb = sdi->conn;
 
 	/* Configures devc->cur_channels. */
-	if (configure_channels(sdi) != SR_OK) {
+	if (logic16_configure_channels(sdi) != SR_OK) {
 		sr_err("Failed to configure channels.");
 		return SR_ERR;
 	}
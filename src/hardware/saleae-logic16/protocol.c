@@ -33,6 +33,10 @@
 
 #define FPGA_FIRMWARE_18	"saleae-logic16-fpga-18.bitstream"
 #define FPGA_FIRMWARE_33	"saleae-logic16-fpga-33.bitstream"
+#define FPGA_FIRMWARE_MAX_SIZE	(1024 * 1024)
+
+/* Bitstream bytes per upload command, behind the command's two byte header. */
+#define FPGA_UPLOAD_DATA_SIZE	62
 
 #define MAX_SAMPLE_RATE		SR_MHZ(100)
 #define MAX_SAMPLE_RATE_X_CH	SR_MHZ(300)
@@ -457,20 +461,59 @@ static int configure_led(const struct sr_dev_inst *sdi)
 	return set_led_mode(sdi, 1, 6250, 0, 1);
 }
 
+/*
+ * Upload commands are encrypted individually, and go to EP1 as they are.
+ * Build all of them upfront, so that they can be sent back to back.
+ */
+static int upload_fpga_commands(const struct sr_dev_inst *sdi, GBytes *bitstream)
+{
+	struct drv_context *drvc;
+	const uint8_t *data;
+	uint8_t *commands, *wrptr;
+	uint8_t command[64];
+	size_t size, pos, chunksize;
+	int ret;
+
+	drvc = sdi->driver->context;
+	data = g_bytes_get_data(bitstream, &size);
+
+	command[0] = COMMAND_FPGA_UPLOAD_INIT;
+	if ((ret = do_ep1_command(sdi, command, 1, NULL, 0)) != SR_OK)
+		return ret;
+
+	commands = g_malloc((size / FPGA_UPLOAD_DATA_SIZE + 1) * sizeof(command));
+	wrptr = commands;
+	for (pos = 0; pos < size; pos += chunksize) {
+		chunksize = MIN(size - pos, FPGA_UPLOAD_DATA_SIZE);
+		command[0] = COMMAND_FPGA_UPLOAD_SEND_DATA;
+		command[1] = chunksize;
+		memcpy(&command[2], data + pos, chunksize);
+		encrypt(wrptr, command, chunksize + 2);
+		wrptr += chunksize + 2;
+	}
+
+	/* One command per transfer, the device takes them packet by packet. */
+	ret = usb_bulk_upload(drvc->sr_ctx, sdi->conn, 1, commands,
+		wrptr - commands, sizeof(command), 1000);
+	g_free(commands);
+
+	return ret;
+}
+
 static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 				 enum voltage_range vrange)
 {
-	uint64_t sum;
-	struct sr_resource bitstream;
+	GBytes *bitstream;
 	struct dev_context *devc;
 	struct drv_context *drvc;
+	struct sr_usb_dev_inst *usb;
+	libusb_device *dev;
 	const char *name;
-	ssize_t chunksize;
 	int ret;
-	uint8_t command[64];
 
 	devc = sdi->priv;
 	drvc = sdi->driver->context;
+	usb = sdi->conn;
 
 	if (devc->cur_voltage_range == vrange)
 		return SR_OK;
@@ -488,41 +531,28 @@ static int upload_fpga_bitstream(const struct sr_dev_inst *sdi,
 			return SR_ERR;
 		}
 
-		sr_info("Uploading FPGA bitstream '%s'.", name);
-		ret = sr_resource_open(drvc->sr_ctx, &bitstream,
-				SR_RESOURCE_FIRMWARE, name);
-		if (ret != SR_OK)
-			return ret;
-
-		command[0] = COMMAND_FPGA_UPLOAD_INIT;
-		if ((ret = do_ep1_command(sdi, command, 1, NULL, 0)) != SR_OK) {
-			sr_resource_close(drvc->sr_ctx, &bitstream);
-			return ret;
-		}
-
-		sum = 0;
-		while (1) {
-			chunksize = sr_resource_read(drvc->sr_ctx, &bitstream,
-					&command[2], sizeof(command) - 2);
-			if (chunksize < 0) {
-				sr_resource_close(drvc->sr_ctx, &bitstream);
+		dev = libusb_get_device(usb->devhdl);
+		if (usb_fpga_loaded(drvc->sr_ctx, dev, name)) {
+			sr_info("FPGA bitstream '%s' is loaded already.", name);
+		} else {
+			sr_info("Uploading FPGA bitstream '%s'.", name);
+			bitstream = sr_resource_load_cached(drvc->sr_ctx,
+					SR_RESOURCE_FIRMWARE, name,
+					FPGA_FIRMWARE_MAX_SIZE);
+			if (!bitstream)
 				return SR_ERR;
-			}
-			if (chunksize == 0)
-				break;
-			command[0] = COMMAND_FPGA_UPLOAD_SEND_DATA;
-			command[1] = chunksize;
 
-			ret = do_ep1_command(sdi, command, chunksize + 2,
-					NULL, 0);
+			usb_fpga_loaded_set(drvc->sr_ctx, dev, NULL);
+			ret = upload_fpga_commands(sdi, bitstream);
 			if (ret != SR_OK) {
-				sr_resource_close(drvc->sr_ctx, &bitstream);
+				g_bytes_unref(bitstream);
 				return ret;
 			}
-			sum += chunksize;
+			usb_fpga_loaded_set(drvc->sr_ctx, dev, name);
+			sr_info("FPGA bitstream upload (%zu bytes) done.",
+				g_bytes_get_size(bitstream));
+			g_bytes_unref(bitstream);
 		}
-		sr_resource_close(drvc->sr_ctx, &bitstream);
-		sr_info("FPGA bitstream upload (%" PRIu64 " bytes) done.", sum);
 	}
 
 	/* This needs to be called before accessing any FPGA registers. */
@@ -794,6 +824,7 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 {
 	int ret;
 
+	sr_trace2(usb_transfer_submit, transfer->user_data, transfer->length);
 	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
 		return;
 
@@ -803,7 +834,49 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 	sr_err("%s: %s", __func__, libusb_error_name(ret));
 }
 
-static size_t convert_sample_data(struct dev_context *devc,
+/* Gather byte b of up to 8 little endian channel words, word i into byte i. */
+static inline uint64_t gather_channel_bytes(const uint8_t *src, int count,
+		int b)
+{
+	uint64_t x;
+	int i;
+
+	x = 0;
+	for (i = 0; i < count; i++)
+		x |= (uint64_t)src[2 * i + b] << (8 * i);
+
+	return x;
+}
+
+/*
+ * Convert a complete block of one word per channel into 16 samples.
+ * The words hold the first sample in their MSB. Each byte of the words
+ * of 8 channels is transposed as one 8x8 bit matrix, the lookup tables
+ * place the channels' bits into the output samples.
+ */
+static void convert_block(const struct dev_context *devc,
+		uint16_t *dest, const uint8_t *src)
+{
+	uint64_t lo, hi;
+	int count_lo, count_hi, b, k;
+
+	count_lo = MIN(devc->num_channels, 8);
+	count_hi = devc->num_channels - count_lo;
+	for (b = 0; b < 2; b++) {
+		lo = sr_bits_transpose_8x8(gather_channel_bytes(src, count_lo, b));
+		hi = 0;
+		if (count_hi)
+			hi = sr_bits_transpose_8x8(gather_channel_bytes(src + 16,
+				count_hi, b));
+		for (k = 0; k < 8; k++) {
+			dest[15 - 8 * b - k] =
+				devc->channel_lut[0][(lo >> (8 * k)) & 0xff] |
+				devc->channel_lut[1][(hi >> (8 * k)) & 0xff];
+		}
+	}
+}
+
+SR_PRIV size_t logic16_convert_sample_data(struct dev_context *devc,
 		uint8_t *dest, size_t destcnt, const uint8_t *src, size_t srccnt)
 {
 	uint16_t *channel_data;
@@ -816,9 +889,22 @@ static size_t convert_sample_data(struct dev_context *devc,
 	channel_data = devc->channel_data;
 	cur_channel = devc->cur_channel;
 
-	while (srccnt--) {
+	while (srccnt) {
+		/* Convert complete blocks without staging their bits. */
+		if (cur_channel == 0 && srccnt >= (size_t)devc->num_channels
+				&& destcnt >= 16 * 2) {
+			convert_block(devc, (uint16_t *)dest, src);
+			src += 2 * devc->num_channels;
+			srccnt -= devc->num_channels;
+			dest += 16 * 2;
+			ret += 16;
+			destcnt -= 16 * 2;
+			continue;
+		}
+
 		sample = src[0] | (src[1] << 8);
 		src += 2;
+		srccnt--;
 
 		channel_mask = devc->channel_masks[cur_channel];
 
@@ -858,6 +944,9 @@ SR_PRIV void LIBUSB_CALL logic16_receive_transfer(struct libusb_transfer *transf
 
 	sdi = transfer->user_data;
 	devc = sdi->priv;
+	sr_trace3(usb_transfer_done, sdi, transfer->status,
+		transfer->actual_length);
+	sr_session_receive_time_set(sdi, g_get_monotonic_time());
 
 	/*
 	 * If acquisition has already ended, just free any queued up
@@ -896,9 +985,12 @@ SR_PRIV void LIBUSB_CALL logic16_receive_transfer(struct libusb_transfer *transf
 		devc->empty_transfer_count++;
 		if (devc->empty_transfer_count > MAX_EMPTY_TRANSFERS) {
 			/*
-			 * The FX2 gave up. End the acquisition, the frontend
-			 * will work out that the samplecount is short.
+			 * The FX2 gave up, most likely the FIFO overflowed.
+			 * Report the missing samples and end the acquisition.
 			 */
+			sr_session_samples_lost(sdi, devc->sent_samples,
+				devc->limit_samples > (uint64_t)devc->sent_samples ?
+				devc->limit_samples - devc->sent_samples : 0);
 			devc->sent_samples = -2;
 			free_transfer(transfer);
 		} else {
@@ -909,7 +1001,7 @@ SR_PRIV void LIBUSB_CALL logic16_receive_transfer(struct libusb_transfer *transf
 		devc->empty_transfer_count = 0;
 	}
 
-	new_samples = convert_sample_data(devc, devc->convbuffer,
+	new_samples = logic16_convert_sample_data(devc, devc->convbuffer,
 			devc->convbuffer_size, transfer->buffer, transfer->actual_length);
 
 	if (new_samples <= 0) {
@@ -80,6 +80,8 @@ struct dev_context {
 	int num_channels;
 	int cur_channel;
 	uint16_t channel_masks[16];
+	/* Output bits of transposed bytes, per group of 8 channels. */
+	uint16_t channel_lut[2][256];
 	uint16_t channel_data[16];
 	uint8_t *convbuffer;
 	size_t convbuffer_size;
@@ -100,6 +102,9 @@ SR_PRIV int logic16_setup_acquisition(const struct sr_dev_inst *sdi,
 SR_PRIV int logic16_start_acquisition(const struct sr_dev_inst *sdi);
 SR_PRIV int logic16_abort_acquisition(const struct sr_dev_inst *sdi);
 SR_PRIV int logic16_init_device(const struct sr_dev_inst *sdi);
+SR_PRIV int logic16_configure_channels(const struct sr_dev_inst *sdi);
+SR_PRIV size_t logic16_convert_sample_data(struct dev_context *devc,
+		uint8_t *dest, size_t destcnt, const uint8_t *src, size_t srccnt);
 SR_PRIV void LIBUSB_CALL logic16_receive_transfer(struct libusb_transfer *transfer);
 
 #endif
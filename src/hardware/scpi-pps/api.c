@@ -280,6 +280,13 @@ static int dev_open(struct sr_dev_inst *sdi)
 
 	devc = sdi->priv;
 
+	/*
+	 * Set-points can only change through our own commands while the
+	 * device is in remote mode, keep their query responses.
+	 */
+	sr_scpi_cache_enable(scpi);
+	sr_scpi_cache_flush(scpi);
+
 	/* Don't send SCPI_CMD_REMOTE for HP 66xxB using SCPI over GPIB. */
 	if (!(devc->device->dialect == SCPI_DIALECT_HP_66XXB &&
 			scpi->transport == SCPI_TRANSPORT_LIBGPIB))
@@ -719,6 +726,37 @@ static int config_set(uint32_t key, GVariant *data,
 	return ret;
 }
 
+/*
+ * Apply the changes of a transaction one channel group after the other,
+ * so that each channel gets selected only once. The changes of a group
+ * keep their order.
+ */
+static int config_set_batch(const struct sr_dev_inst *sdi,
+	const struct sr_config_change *changes, size_t count)
+{
+	const struct sr_channel_group *cg;
+	gboolean *done;
+	size_t i, j;
+	int ret;
+
+	done = g_malloc0_n(count, sizeof(*done));
+	ret = SR_OK;
+	for (i = 0; i < count && ret == SR_OK; i++) {
+		if (done[i])
+			continue;
+		cg = changes[i].cg;
+		for (j = i; j < count && ret == SR_OK; j++) {
+			if (done[j] || changes[j].cg != cg)
+				continue;
+			ret = config_set(changes[j].key, changes[j].data, sdi, cg);
+			done[j] = TRUE;
+		}
+	}
+	g_free(done);
+
+	return ret;
+}
+
 static int config_list(uint32_t key, GVariant **data,
 	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
 {
@@ -853,6 +891,7 @@ static struct sr_dev_driver scpi_pps_driver_info = {
 	.dev_clear = dev_clear,
 	.config_get = config_get,
 	.config_set = config_set,
+	.config_set_batch = config_set_batch,
 	.config_list = config_list,
 	.dev_open = dev_open,
 	.dev_close = dev_close,
@@ -872,6 +911,7 @@ static struct sr_dev_driver hp_ib_pps_driver_info = {
 	.dev_clear = dev_clear,
 	.config_get = config_get,
 	.config_set = config_set,
+	.config_set_batch = config_set_batch,
 	.config_list = config_list,
 	.dev_open = dev_open,
 	.dev_close = dev_close,
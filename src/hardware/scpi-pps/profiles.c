@@ -490,6 +490,7 @@ static const struct scpi_command rigol_dp700_cmd[] = {
 	{ SCPI_CMD_GET_MEAS_VOLTAGE, ":MEAS:VOLT?" },
 	{ SCPI_CMD_GET_MEAS_CURRENT, ":MEAS:CURR?" },
 	{ SCPI_CMD_GET_MEAS_POWER, ":MEAS:POWE?" },
+	{ SCPI_CMD_GET_MEAS_ALL, ":MEAS:ALL?" },
 	{ SCPI_CMD_GET_VOLTAGE_TARGET, ":SOUR:VOLT?" },
 	{ SCPI_CMD_SET_VOLTAGE_TARGET, ":SOUR:VOLT %.6f" },
 	{ SCPI_CMD_GET_CURRENT_LIMIT, ":SOUR:CURR?" },
@@ -567,16 +568,17 @@ static const struct channel_group_spec rigol_dp830_cg[] = {
 static const struct scpi_command rigol_dp800_cmd[] = {
 	{ SCPI_CMD_REMOTE, "SYST:REMOTE" },
 	{ SCPI_CMD_LOCAL, "SYST:LOCAL" },
-	{ SCPI_CMD_BEEPER, "SYST:BEEP:STAT?" },
+	{ SCPI_CMD_BEEPER, "SYST:BEEP:STAT?", SCPI_CMD_CACHED },
 	{ SCPI_CMD_BEEPER_ENABLE, "SYST:BEEP:STAT ON" },
 	{ SCPI_CMD_BEEPER_DISABLE, "SYST:BEEP:STAT OFF" },
 	{ SCPI_CMD_SELECT_CHANNEL, ":INST:NSEL %s" },
 	{ SCPI_CMD_GET_MEAS_VOLTAGE, ":MEAS:VOLT?" },
 	{ SCPI_CMD_GET_MEAS_CURRENT, ":MEAS:CURR?" },
 	{ SCPI_CMD_GET_MEAS_POWER, ":MEAS:POWE?" },
-	{ SCPI_CMD_GET_VOLTAGE_TARGET, ":SOUR:VOLT?" },
+	{ SCPI_CMD_GET_MEAS_ALL, ":MEAS:ALL? CH%s" },
+	{ SCPI_CMD_GET_VOLTAGE_TARGET, ":SOUR:VOLT?", SCPI_CMD_CACHED },
 	{ SCPI_CMD_SET_VOLTAGE_TARGET, ":SOUR:VOLT %.6f" },
-	{ SCPI_CMD_GET_CURRENT_LIMIT, ":SOUR:CURR?" },
+	{ SCPI_CMD_GET_CURRENT_LIMIT, ":SOUR:CURR?", SCPI_CMD_CACHED },
 	{ SCPI_CMD_SET_CURRENT_LIMIT, ":SOUR:CURR %.6f" },
 	{ SCPI_CMD_GET_OUTPUT_ENABLED, ":OUTP?" },
 	{ SCPI_CMD_SET_OUTPUT_ENABLE, ":OUTP ON" },
@@ -589,13 +591,13 @@ static const struct scpi_command rigol_dp800_cmd[] = {
 	{ SCPI_CMD_SET_OVER_VOLTAGE_PROTECTION_ENABLE, ":OUTP:OVP ON" },
 	{ SCPI_CMD_SET_OVER_VOLTAGE_PROTECTION_DISABLE, ":OUTP:OVP OFF" },
 	{ SCPI_CMD_GET_OVER_VOLTAGE_PROTECTION_ACTIVE, ":OUTP:OVP:QUES?" },
-	{ SCPI_CMD_GET_OVER_VOLTAGE_PROTECTION_THRESHOLD, ":OUTP:OVP:VAL?" },
+	{ SCPI_CMD_GET_OVER_VOLTAGE_PROTECTION_THRESHOLD, ":OUTP:OVP:VAL?", SCPI_CMD_CACHED },
 	{ SCPI_CMD_SET_OVER_VOLTAGE_PROTECTION_THRESHOLD, ":OUTP:OVP:VAL %.6f" },
 	{ SCPI_CMD_GET_OVER_CURRENT_PROTECTION_ENABLED, ":OUTP:OCP?" },
 	{ SCPI_CMD_SET_OVER_CURRENT_PROTECTION_ENABLE, ":OUTP:OCP:STAT ON" },
 	{ SCPI_CMD_SET_OVER_CURRENT_PROTECTION_DISABLE, ":OUTP:OCP:STAT OFF" },
 	{ SCPI_CMD_GET_OVER_CURRENT_PROTECTION_ACTIVE, ":OUTP:OCP:QUES?" },
-	{ SCPI_CMD_GET_OVER_CURRENT_PROTECTION_THRESHOLD, ":OUTP:OCP:VAL?" },
+	{ SCPI_CMD_GET_OVER_CURRENT_PROTECTION_THRESHOLD, ":OUTP:OCP:VAL?", SCPI_CMD_CACHED },
 	{ SCPI_CMD_SET_OVER_CURRENT_PROTECTION_THRESHOLD, ":OUTP:OCP:VAL %.6f" },
 	ALL_ZERO
 };
@@ -692,18 +694,18 @@ static int hp_6630a_update_status(const struct sr_dev_inst *sdi)
 
 	/* OVP */
 	if (fault & (1 << 3))
-		sr_session_send_meta(sdi, SR_CONF_OVER_VOLTAGE_PROTECTION_ACTIVE,
-			g_variant_new_boolean(fault & (1 << 3)));
+		sr_session_send_meta_boolean(sdi, SR_CONF_OVER_VOLTAGE_PROTECTION_ACTIVE,
+			fault & (1 << 3));
 
 	/* OCP */
 	if (fault & (1 << 6))
-		sr_session_send_meta(sdi, SR_CONF_OVER_CURRENT_PROTECTION_ACTIVE,
-			g_variant_new_boolean(fault & (1 << 6)));
+		sr_session_send_meta_boolean(sdi, SR_CONF_OVER_CURRENT_PROTECTION_ACTIVE,
+			fault & (1 << 6));
 
 	/* OTP */
 	if (fault & (1 << 4))
-		sr_session_send_meta(sdi, SR_CONF_OVER_TEMPERATURE_PROTECTION_ACTIVE,
-			g_variant_new_boolean(fault & (1 << 4)));
+		sr_session_send_meta_boolean(sdi, SR_CONF_OVER_TEMPERATURE_PROTECTION_ACTIVE,
+			fault & (1 << 4));
 
 	/* CV */
 	cv = (fault & (1 << 0));
@@ -735,8 +737,8 @@ static int hp_6630a_update_status(const struct sr_dev_inst *sdi)
 				cv, cc_pos, cc_neg, unreg);
 			return FALSE;
 		}
-		sr_session_send_meta(sdi, SR_CONF_REGULATION,
-			g_variant_new_string(regulation));
+		sr_session_send_meta_string(sdi, SR_CONF_REGULATION,
+			regulation);
 	}
 
 	return SR_OK;
@@ -929,18 +931,18 @@ static int hp_6630b_update_status(const struct sr_dev_inst *sdi)
 
 		/* OVP */
 		if (ques_even & (1 << 0))
-			sr_session_send_meta(sdi, SR_CONF_OVER_VOLTAGE_PROTECTION_ACTIVE,
-				g_variant_new_boolean(ques_cond & (1 << 0)));
+			sr_session_send_meta_boolean(sdi, SR_CONF_OVER_VOLTAGE_PROTECTION_ACTIVE,
+				ques_cond & (1 << 0));
 
 		/* OCP */
 		if (ques_even & (1 << 1))
-			sr_session_send_meta(sdi, SR_CONF_OVER_CURRENT_PROTECTION_ACTIVE,
-				g_variant_new_boolean(ques_cond & (1 << 1)));
+			sr_session_send_meta_boolean(sdi, SR_CONF_OVER_CURRENT_PROTECTION_ACTIVE,
+				ques_cond & (1 << 1));
 
 		/* OTP */
 		if (ques_even & (1 << 4))
-			sr_session_send_meta(sdi, SR_CONF_OVER_TEMPERATURE_PROTECTION_ACTIVE,
-				g_variant_new_boolean(ques_cond & (1 << 4)));
+			sr_session_send_meta_boolean(sdi, SR_CONF_OVER_TEMPERATURE_PROTECTION_ACTIVE,
+				ques_cond & (1 << 4));
 
 		/* UNREG */
 		unreg = (ques_cond & (1 << 10));
@@ -955,8 +957,8 @@ static int hp_6630b_update_status(const struct sr_dev_inst *sdi)
 		ret = sr_scpi_get_bool(scpi, "OUTP:STAT?", &output_enabled);
 		if (ret != SR_OK)
 			return ret;
-		sr_session_send_meta(sdi, SR_CONF_ENABLED,
-			g_variant_new_boolean(output_enabled));
+		sr_session_send_meta_boolean(sdi, SR_CONF_ENABLED,
+			output_enabled);
 	}
 
 	/* Operation status summary bit */
@@ -1000,8 +1002,8 @@ static int hp_6630b_update_status(const struct sr_dev_inst *sdi)
 				cv, cc_pos, cc_neg, unreg);
 			return FALSE;
 		}
-		sr_session_send_meta(sdi, SR_CONF_REGULATION,
-			g_variant_new_string(regulation));
+		sr_session_send_meta_string(sdi, SR_CONF_REGULATION,
+			regulation);
 	}
 
 	return SR_OK;
@@ -1370,7 +1372,7 @@ SR_PRIV const struct scpi_pps pps_profiles[] = {
 	},
 
 	/* Chroma 61604 */
-	{ "Chroma", "61604", SCPI_DIALECT_UNKNOWN, 0,
+	{ "Chroma", "61604", SCPI_DIALECT_UNKNOWN, PPS_MEAS_BATCH,
 		ARRAY_AND_SIZE(chroma_61604_devopts),
 		ARRAY_AND_SIZE(chroma_61604_devopts_cg),
 		ARRAY_AND_SIZE(chroma_61604_ch),
@@ -1382,7 +1384,7 @@ SR_PRIV const struct scpi_pps pps_profiles[] = {
 	},
 
 	/* Chroma 62000 series */
-	{ "Chroma", "620[0-9]{2}P-[0-9]{2,3}-[0-9]{1,3}", SCPI_DIALECT_UNKNOWN, 0,
+	{ "Chroma", "620[0-9]{2}P-[0-9]{2,3}-[0-9]{1,3}", SCPI_DIALECT_UNKNOWN, PPS_MEAS_BATCH,
 		ARRAY_AND_SIZE(chroma_62000_devopts),
 		ARRAY_AND_SIZE(chroma_62000_devopts_cg),
 		NULL, 0,
@@ -25,6 +25,235 @@
 #include "scpi.h"
 #include "protocol.h"
 
+/* Returns the query for a quantity, 0 if the driver can't measure it. */
+static int meas_command(enum sr_mq mq)
+{
+	switch (mq) {
+	case SR_MQ_VOLTAGE:
+		return SCPI_CMD_GET_MEAS_VOLTAGE;
+	case SR_MQ_CURRENT:
+		return SCPI_CMD_GET_MEAS_CURRENT;
+	case SR_MQ_POWER:
+		return SCPI_CMD_GET_MEAS_POWER;
+	case SR_MQ_FREQUENCY:
+		return SCPI_CMD_GET_MEAS_FREQUENCY;
+	default:
+		return 0;
+	}
+}
+
+/* Position of a quantity in the response to SCPI_CMD_GET_MEAS_ALL. */
+static int meas_all_field(enum sr_mq mq)
+{
+	switch (mq) {
+	case SR_MQ_VOLTAGE:
+		return 0;
+	case SR_MQ_CURRENT:
+		return 1;
+	case SR_MQ_POWER:
+		return 2;
+	default:
+		return -1;
+	}
+}
+
+static const struct channel_spec *channel_spec_get(
+		const struct dev_context *devc, const struct pps_channel *pch)
+{
+	if (devc->channels) {
+		/* Dynamically-probed devices. */
+		return &devc->channels[pch->hw_output_idx];
+	}
+
+	/* Statically-configured devices. */
+	return &devc->device->channels[pch->hw_output_idx];
+}
+
+/*
+ * Get the unit of a quantity, and the limits of the channel for it
+ * (min, max, programming resolution, spec digits, encoding digits).
+ */
+static const double *channel_spec_limits(const struct channel_spec *ch_spec,
+		enum sr_mq mq, enum sr_unit *unit)
+{
+	switch (mq) {
+	case SR_MQ_VOLTAGE:
+		*unit = SR_UNIT_VOLT;
+		return ch_spec->voltage;
+	case SR_MQ_CURRENT:
+		*unit = SR_UNIT_AMPERE;
+		return ch_spec->current;
+	case SR_MQ_POWER:
+		*unit = SR_UNIT_WATT;
+		return ch_spec->power;
+	default:
+		*unit = SR_UNIT_HERTZ;
+		return ch_spec->frequency;
+	}
+}
+
+static void acquisition_sample_done(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+
+	devc = sdi->priv;
+	sr_sw_limits_update_samples_read(&devc->limits, 1);
+
+	/* Stop if limits have been hit. */
+	if (sr_sw_limits_check(&devc->limits))
+		sr_dev_acquisition_stop(sdi);
+}
+
+/*
+ * Send the readings of one poll. Channels with the same quantity share
+ * a packet, in the order of the device's channels.
+ */
+static void meas_send(const struct sr_dev_inst *sdi,
+		struct sr_channel **channels, const float *values, size_t count)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct pps_channel *pch, *pch_other;
+	const double *limits;
+	gboolean *sent;
+	float *data;
+	size_t i, j, num;
+
+	devc = sdi->priv;
+	sent = g_malloc0(count * sizeof(*sent));
+	data = g_malloc(count * sizeof(*data));
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	for (i = 0; i < count; i++) {
+		if (sent[i])
+			continue;
+		pch = channels[i]->priv;
+		sr_analog_init(&analog, &encoding, &meaning, &spec, 0);
+		meaning.mq = pch->mq;
+		meaning.mqflags = pch->mqflags;
+		num = 0;
+		for (j = i; j < count; j++) {
+			pch_other = channels[j]->priv;
+			if (sent[j] || pch_other->mq != pch->mq
+					|| pch_other->mqflags != pch->mqflags)
+				continue;
+			limits = channel_spec_limits(channel_spec_get(devc,
+				pch_other), pch->mq, &meaning.unit);
+			/* Keep the precision of the most precise channel. */
+			if (!num || limits[4] > encoding.digits)
+				encoding.digits = limits[4];
+			if (!num || limits[3] > spec.spec_digits)
+				spec.spec_digits = limits[3];
+			meaning.channels = g_slist_append(meaning.channels,
+				channels[j]);
+			data[num++] = values[j];
+			sent[j] = TRUE;
+		}
+		analog.num_samples = 1;
+		analog.data = data;
+		sr_session_send(sdi, &packet);
+		g_slist_free(meaning.channels);
+	}
+	g_free(data);
+	g_free(sent);
+}
+
+/*
+ * Poll all the enabled channels in one go: their queries get combined
+ * into one program message, saving the round trips of querying them one
+ * per callback. Profiles which provide SCPI_CMD_GET_MEAS_ALL get one query
+ * per channel group, otherwise the measurement queries need to address
+ * their channel without SCPI_CMD_SELECT_CHANNEL, see PPS_MEAS_BATCH.
+ */
+static int receive_data_batched(struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	const struct scpi_command *cmds;
+	struct sr_scpi_batch *batch;
+	struct sr_channel *ch, **channels;
+	struct pps_channel *pch, *pch_other;
+	const char *meas_all, *resp;
+	gchar **fields;
+	GSList *l;
+	float *values;
+	int *idx;
+	size_t count, num, i, j;
+	int field, ret;
+
+	devc = sdi->priv;
+	cmds = devc->device->commands;
+	meas_all = sr_scpi_cmd_get(cmds, SCPI_CMD_GET_MEAS_ALL);
+
+	if (devc->device->update_status)
+		devc->device->update_status(sdi);
+
+	count = g_slist_length(sdi->channels);
+	channels = g_malloc(count * sizeof(*channels));
+	idx = g_malloc(count * sizeof(*idx));
+	values = g_malloc(count * sizeof(*values));
+	batch = sr_scpi_batch_new(sdi->conn);
+	num = 0;
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!ch->enabled)
+			continue;
+		pch = ch->priv;
+		if (meas_all) {
+			if (meas_all_field(pch->mq) < 0)
+				continue;
+			/* Channels of the same output share the query. */
+			for (j = 0; j < num; j++) {
+				pch_other = channels[j]->priv;
+				if (!g_strcmp0(pch_other->hwname, pch->hwname))
+					break;
+			}
+			idx[num] = j < num ? idx[j] :
+				sr_scpi_batch_add(batch, meas_all, pch->hwname);
+		} else {
+			if (!sr_scpi_cmd_get(cmds, meas_command(pch->mq)))
+				continue;
+			idx[num] = sr_scpi_batch_add(batch, "%s",
+				sr_scpi_cmd_get(cmds, meas_command(pch->mq)));
+		}
+		channels[num++] = ch;
+	}
+
+	ret = num ? sr_scpi_batch_run(batch) : SR_OK;
+	for (i = 0; ret == SR_OK && i < num; i++) {
+		pch = channels[i]->priv;
+		if (!meas_all) {
+			ret = sr_scpi_batch_get_float(batch, idx[i], &values[i]);
+			continue;
+		}
+		resp = sr_scpi_batch_get_string(batch, idx[i]);
+		fields = g_strsplit(resp ? resp : "", ",", 0);
+		field = meas_all_field(pch->mq);
+		if ((int)g_strv_length(fields) <= field
+				|| sr_atof_ascii(g_strstrip(fields[field]),
+					&values[i]) != SR_OK) {
+			sr_err("Unexpected measurement response '%s'.",
+				resp ? resp : "");
+			ret = SR_ERR_DATA;
+		}
+		g_strfreev(fields);
+	}
+	sr_scpi_batch_free(batch);
+
+	if (ret == SR_OK && num) {
+		meas_send(sdi, channels, values, num);
+		acquisition_sample_done(sdi);
+	}
+	g_free(values);
+	g_free(idx);
+	g_free(channels);
+
+	return ret == SR_OK ? TRUE : ret;
+}
+
 SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 {
 	struct dev_context *devc;
@@ -39,10 +268,10 @@ SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 	const char *channel_group_name;
 	struct pps_channel *pch;
 	const struct channel_spec *ch_spec;
+	const double *limits;
 	int ret;
 	float f;
 	GVariant *gvdata;
-	const GVariantType *gvtype;
 	int cmd;
 
 	(void)fd;
@@ -57,6 +286,11 @@ SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 	if (!(device = devc->device))
 		return TRUE;
 
+	if (sr_scpi_cmd_get(device->commands, SCPI_CMD_GET_MEAS_ALL)
+			|| ((device->features & PPS_MEAS_BATCH)
+			&& g_slist_length(sdi->channel_groups) <= 1))
+		return receive_data_batched(sdi);
+
 	pch = devc->cur_acquisition_channel->priv;
 
 	channel_group_cmd = 0;
@@ -75,35 +309,17 @@ SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 		device->update_status(sdi);
 	}
 
-	if (pch->mq == SR_MQ_VOLTAGE) {
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_MEAS_VOLTAGE;
-	} else if (pch->mq == SR_MQ_FREQUENCY) {
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_MEAS_FREQUENCY;
-	} else if (pch->mq == SR_MQ_CURRENT) {
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_MEAS_CURRENT;
-	} else if (pch->mq == SR_MQ_POWER) {
-		gvtype = G_VARIANT_TYPE_DOUBLE;
-		cmd = SCPI_CMD_GET_MEAS_POWER;
-	} else {
+	if (!(cmd = meas_command(pch->mq)))
 		return SR_ERR;
-	}
 
 	ret = sr_scpi_cmd_resp(sdi, devc->device->commands,
-		channel_group_cmd, channel_group_name, &gvdata, gvtype, cmd);
+		channel_group_cmd, channel_group_name, &gvdata,
+		G_VARIANT_TYPE_DOUBLE, cmd);
 
 	if (ret != SR_OK)
 		return ret;
 
-	if (devc->channels) {
-		/* Dynamically-probed devices. */
-		ch_spec = &devc->channels[pch->hw_output_idx];
-	} else {
-		/* Statically-configured devices. */
-		ch_spec = &devc->device->channels[pch->hw_output_idx];
-	}
+	ch_spec = channel_spec_get(devc, pch);
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
 	/* Note: digits/spec_digits will be overridden later. */
@@ -112,23 +328,9 @@ SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 	analog.num_samples = 1;
 	analog.meaning->mq = pch->mq;
 	analog.meaning->mqflags = pch->mqflags;
-	if (pch->mq == SR_MQ_VOLTAGE) {
-		analog.meaning->unit = SR_UNIT_VOLT;
-		analog.encoding->digits = ch_spec->voltage[4];
-		analog.spec->spec_digits = ch_spec->voltage[3];
-	} else if (pch->mq == SR_MQ_CURRENT) {
-		analog.meaning->unit = SR_UNIT_AMPERE;
-		analog.encoding->digits = ch_spec->current[4];
-		analog.spec->spec_digits = ch_spec->current[3];
-	} else if (pch->mq == SR_MQ_POWER) {
-		analog.meaning->unit = SR_UNIT_WATT;
-		analog.encoding->digits = ch_spec->power[4];
-		analog.spec->spec_digits = ch_spec->power[3];
-	} else if (pch->mq == SR_MQ_FREQUENCY) {
-		analog.meaning->unit = SR_UNIT_HERTZ;
-		analog.encoding->digits = ch_spec->frequency[4];
-		analog.spec->spec_digits = ch_spec->frequency[3];
-	}
+	limits = channel_spec_limits(ch_spec, pch->mq, &analog.meaning->unit);
+	analog.encoding->digits = limits[4];
+	analog.spec->spec_digits = limits[3];
 	f = (float)g_variant_get_double(gvdata);
 	g_variant_unref(gvdata);
 	analog.data = &f;
@@ -143,10 +345,8 @@ SR_PRIV int scpi_pps_receive_data(int fd, int revents, void *cb_data)
 
 	if (devc->cur_acquisition_channel == sr_next_enabled_channel(sdi, NULL))
 		/* First enabled channel, so each channel has been sampled */
-		sr_sw_limits_update_samples_read(&devc->limits, 1);
-
-	/* Stop if limits have been hit. */
-	if (sr_sw_limits_check(&devc->limits))
+		acquisition_sample_done(sdi);
+	else if (sr_sw_limits_check(&devc->limits))
 		sr_dev_acquisition_stop(sdi);
 
 	return TRUE;
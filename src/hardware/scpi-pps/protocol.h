@@ -66,6 +66,8 @@ enum pps_scpi_cmds {
 	SCPI_CMD_GET_OVER_CURRENT_PROTECTION_ACTIVE,
 	SCPI_CMD_GET_OVER_CURRENT_PROTECTION_THRESHOLD,
 	SCPI_CMD_SET_OVER_CURRENT_PROTECTION_THRESHOLD,
+	/* Voltage, current and power of a channel, as a comma separated list. */
+	SCPI_CMD_GET_MEAS_ALL,
 };
 
 /* Defines the SCPI dialect */
@@ -89,6 +91,8 @@ enum pps_features {
 	PPS_INDEPENDENT   = (1 << 3),
 	PPS_SERIES        = (1 << 4),
 	PPS_PARALLEL      = (1 << 5),
+	/* Measurement queries can be combined into one program message. */
+	PPS_MEAS_BATCH    = (1 << 6),
 };
 
 struct scpi_pps {
@@ -138,6 +138,58 @@ SR_PRIV int req_packet(struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
+/* Number of packets with the same last byte, to use it as a sync hint. */
+#define SYNC_LEARN_PACKETS 4
+
+/*
+ * Learn the last byte of fixed size packets. Most protocols end their
+ * packets in a constant like CR or LF. Protocols without such a byte
+ * never get a hint.
+ */
+static void sync_learn(struct dev_context *devc, const uint8_t *pkt,
+	size_t pkt_size)
+{
+	if (devc->sync_count && pkt[pkt_size - 1] == devc->sync_end) {
+		devc->sync_count++;
+		return;
+	}
+	devc->sync_end = pkt[pkt_size - 1];
+	devc->sync_count = 1;
+}
+
+/*
+ * Get the next offset which can hold a packet while searching. With a
+ * sync hint, offsets where the packet's end doesn't match get skipped.
+ * The hint gets dropped when it didn't lead to a packet for a whole
+ * buffer of data.
+ */
+static size_t sync_next_pos(struct dev_context *devc, size_t pkt_size,
+	size_t pos)
+{
+	const uint8_t *end;
+	size_t first, next;
+
+	if (devc->sync_count < SYNC_LEARN_PACKETS)
+		return pos;
+	if (devc->sync_skipped > DMM_BUFSIZE) {
+		sr_dbg("Sync hint found no packets, dropping it.");
+		devc->sync_count = 0;
+		return pos;
+	}
+
+	first = pos + pkt_size - 1;
+	if (first >= devc->buflen)
+		return pos;
+	end = memchr(&devc->buf[first], devc->sync_end, devc->buflen - first);
+	if (end)
+		next = end - devc->buf - (pkt_size - 1);
+	else
+		next = devc->buflen - (pkt_size - 1);
+	devc->sync_skipped += next - pos;
+
+	return next;
+}
+
 static void handle_new_data(struct sr_dev_inst *sdi, void *info)
 {
 	struct dmm_info *dmm;
@@ -193,10 +245,13 @@ static void handle_new_data(struct sr_dev_inst *sdi, void *info)
 		} else if (dmm->packet_valid) {
 			if (!dmm->packet_valid(check_ptr)) {
 				sr_dbg("Not a valid packet, searching.");
-				check_pos++;
+				check_pos = sync_next_pos(devc, dmm->packet_size,
+					check_pos + 1);
 				continue;
 			}
 			pkt_size = dmm->packet_size;
+			sync_learn(devc, check_ptr, pkt_size);
+			devc->sync_skipped = 0;
 		}
 
 		/* Process the package. */
@@ -231,6 +286,7 @@ static void handle_new_data(struct sr_dev_inst *sdi, void *info)
 	if (devc->buflen == sizeof(devc->buf)) {
 		sr_info("Drop unprocessed RX data, try to re-sync to stream.");
 		devc->buflen = 0;
+		devc->sync_count = 0;
 	}
 }
 
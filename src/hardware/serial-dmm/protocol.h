@@ -88,6 +88,16 @@ struct dev_context {
 	uint8_t buf[DMM_BUFSIZE];
 	size_t buflen;
 
+	/*
+	 * Last byte of the recent fixed size packets, and the number of
+	 * packets in a row which ended in it. Used to skip ahead when
+	 * re-synchronizing to the stream.
+	 */
+	uint8_t sync_end;
+	size_t sync_count;
+	/* Bytes skipped by the hint since the last valid packet. */
+	size_t sync_skipped;
+
 	/**
 	 * The timestamp [µs] to send the next request.
 	 * Used only if device needs polling.
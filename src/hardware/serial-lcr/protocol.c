@@ -39,14 +39,14 @@ static void send_frame_start(struct sr_dev_inst *sdi)
 	freq = info->output_freq;
 	if (freq != devc->output_freq) {
 		devc->output_freq = freq;
-		sr_session_send_meta(sdi, SR_CONF_OUTPUT_FREQUENCY,
-			g_variant_new_double(freq));
+		sr_session_send_meta_double(sdi, SR_CONF_OUTPUT_FREQUENCY,
+			freq);
 	}
 	model = info->circuit_model;
 	if (model && model != devc->circuit_model) {
 		devc->circuit_model = model;
-		sr_session_send_meta(sdi, SR_CONF_EQUIV_CIRCUIT_MODEL,
-			g_variant_new_string(model));
+		sr_session_send_meta_string(sdi, SR_CONF_EQUIV_CIRCUIT_MODEL,
+			model);
 	}
 
 	/* Data is about to get sent. Start a new frame. */
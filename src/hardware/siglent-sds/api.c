@@ -234,12 +234,19 @@ static struct sr_dev_driver siglent_sds_driver_info;
 static void clear_helper(void *priv)
 {
 	struct dev_context *devc;
+	size_t i;
 
 	devc = priv;
 	if (!devc)
 		return;
 	g_free(devc->analog_groups);
 	g_free(devc->enabled_channels);
+	g_free(devc->buffer);
+	g_free(devc->data);
+	if (devc->dig_buffer)
+		g_array_free(devc->dig_buffer, TRUE);
+	for (i = 0; i < MAX_DIGITAL_CHANNELS; i++)
+		g_free(devc->dig_data[i]);
 }
 
 static int dev_clear(const struct sr_dev_driver *di)
@@ -271,7 +271,6 @@ SR_PRIV int siglent_sds_channel_start(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_channel *ch;
-	const char *s;
 
 	if (!(devc = sdi->priv))
 		return SR_ERR;
@@ -280,198 +279,195 @@ SR_PRIV int siglent_sds_channel_start(const struct sr_dev_inst *sdi)
 
 	sr_dbg("Start reading data from channel %s.", ch->name);
 
-	switch (devc->model->series->protocol) {
-	case NON_SPO_MODEL:
-	case SPO_MODEL:
-		s = (ch->type == SR_CHANNEL_LOGIC) ? "D%d:WF?" : "C%d:WF? ALL";
-		if (sr_scpi_send(sdi->conn, s, ch->index + 1) != SR_OK)
+	/*
+	 * The digital channels get queried together when their data is
+	 * read, and sr_scpi_read_block() begins the read of the reply.
+	 */
+	if (ch->type == SR_CHANNEL_ANALOG) {
+		if (sr_scpi_send(sdi->conn, "C%d:WF? ALL", ch->index + 1) != SR_OK)
 			return SR_ERR;
-		siglent_sds_set_wait_event(devc, WAIT_NONE);
-		break;
-	case ESERIES:
-		if (ch->type == SR_CHANNEL_ANALOG) {
-			if (sr_scpi_send(sdi->conn, "C%d:WF? ALL",
-				ch->index + 1) != SR_OK)
-				return SR_ERR;
-		}
-		siglent_sds_set_wait_event(devc, WAIT_NONE);
-		if (sr_scpi_read_begin(sdi->conn) != SR_OK)
-			return TRUE;
-		siglent_sds_set_wait_event(devc, WAIT_BLOCK);
-		break;
 	}
+	siglent_sds_set_wait_event(devc, WAIT_NONE);
 
 	devc->num_channel_bytes = 0;
 	devc->num_header_bytes = 0;
-	devc->num_block_bytes = 0;
 
 	return SR_OK;
 }
 
-/* Read the header of a data block. */
-static int siglent_sds_read_header(struct sr_dev_inst *sdi)
+/*
+ * Read the waveform of an analog channel, which comes as one block with
+ * the wave descriptor and the samples, directly into the acquisition
+ * buffer. Then convert and send the samples.
+ */
+static int siglent_sds_get_analog(const struct sr_dev_inst *sdi,
+		struct sr_channel *ch)
 {
 	struct sr_scpi_dev_inst *scpi = sdi->conn;
 	struct dev_context *devc = sdi->priv;
-	char *buf = (char *)devc->buffer;
-	int ret, desc_length;
-	int block_offset = 15; /* Offset for descriptor block. */
-	long data_length = 0;
-
-	/* Read header from device. */
-	ret = sr_scpi_read_data(scpi, buf, SIGLENT_HEADER_SIZE);
-	if (ret < SIGLENT_HEADER_SIZE) {
-		sr_err("Read error while reading data header.");
-		return SR_ERR;
-	}
-	sr_dbg("Device returned %i bytes.", ret);
-	devc->num_header_bytes += ret;
-	buf += block_offset; /* Skip to start descriptor block. */
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	uint8_t *buf;
+	size_t size, len, i;
+	uint32_t desc_length, data_length;
+	float vdiv, offset, voltage, vdivlog, lut[256];
+	int digits, ret;
+
+	buf = devc->buffer;
+	size = devc->model->series->buffer_samples;
+	ret = sr_scpi_read_block(scpi, NULL, &buf, &size, NULL, NULL);
+	if (ret != SR_OK)
+		return ret;
 
 	/* Parse WaveDescriptor header. */
-	memcpy(&desc_length, buf + 36, 4); /* Descriptor block length */
-	memcpy(&data_length, buf + 60, 4); /* Data block length */
+	if (size < 64) {
+		sr_err("Received short wave descriptor.");
+		return SR_ERR_DATA;
+	}
+	desc_length = RL32(buf + 36); /* Descriptor block length */
+	data_length = RL32(buf + 60); /* Data block length */
+	if (desc_length > size) {
+		sr_err("Received invalid wave descriptor.");
+		return SR_ERR_DATA;
+	}
+	len = MIN(data_length, size - desc_length);
+	sr_dbg("Received waveform: %zu of %" PRIu32 " samples.",
+		len, data_length);
+
+	/* Samples are signed 8 bit values, convert them by table lookup. */
+	vdiv = devc->vdiv[ch->index];
+	offset = devc->vert_offset[ch->index];
+	for (i = 0; i < 256; i++) {
+		voltage = (float)(int8_t)i / 25;
+		lut[i] = (vdiv * voltage) - offset;
+	}
+	buf += desc_length;
+	for (i = 0; i < len; i++)
+		devc->data[i] = lut[buf[i]];
+
+	vdivlog = log10f(vdiv);
+	digits = -(int) vdivlog + (vdivlog < 0.0);
+	sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
+	analog.meaning->channels = g_slist_append(NULL, ch);
+	analog.num_samples = len;
+	analog.data = devc->data;
+	analog.meaning->mq = SR_MQ_VOLTAGE;
+	analog.meaning->unit = SR_UNIT_VOLT;
+	analog.meaning->mqflags = 0;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	sr_session_send(sdi, &packet);
+	g_slist_free(analog.meaning->channels);
 
-	devc->block_header_size = desc_length + 15;
-	devc->num_samples = data_length;
+	return SR_OK;
+}
 
-	sr_dbg("Received data block header: '%s' -> block length %d.", buf, ret);
+/* Blocks of 64 samples which get transposed at a time. */
+#define DIGITAL_CHUNK_BLOCKS 64
 
-	return ret;
+/* Get 64 samples of a channel, zero for disabled channels. */
+static uint64_t digital_word(const uint8_t *data, size_t offset,
+		size_t num_bytes)
+{
+	uint64_t word;
+	size_t b;
+
+	if (!data)
+		return 0;
+	if (offset + 8 <= num_bytes)
+		return RL64(&data[offset]);
+
+	word = 0;
+	for (b = 0; offset + b < num_bytes; b++)
+		word |= (uint64_t)data[offset + b] << (8 * b);
+
+	return word;
 }
 
-static int siglent_sds_get_digital(const struct sr_dev_inst *sdi, struct sr_channel *ch)
+/*
+ * Read the data of all enabled digital channels, and transpose it into
+ * samples of 16 bits. The device sends each channel separately, with 8
+ * samples per byte, LSB first.
+ */
+static int siglent_sds_get_digital(const struct sr_dev_inst *sdi)
 {
 	struct sr_scpi_dev_inst *scpi = sdi->conn;
 	struct dev_context *devc = sdi->priv;
-	GArray *tmp_samplebuf; /* Temp buffer while iterating over the scope samples */
-	char *buf = (char *)devc->buffer; /* Buffer from scope */
-	uint8_t tmp_value; /* Holding temp value from data */
-	GArray *data_low_channels, *data_high_channels, *buffdata;
+	struct sr_channel *ch;
 	GSList *l;
-	gboolean low_channels; /* Lower channels enabled */
-	gboolean high_channels; /* Higher channels enabled */
-	int len, channel_index;
-	uint64_t samples_index;
-
-	len = 0;
-	channel_index = 0;
-	low_channels = FALSE;
-	high_channels = FALSE;
-	data_low_channels = g_array_new(FALSE, TRUE, sizeof(uint8_t));
-	data_high_channels = g_array_new(FALSE, TRUE, sizeof(uint8_t));
+	const uint8_t *data[MAX_DIGITAL_CHANNELS];
+	uint64_t words[DIGITAL_CHUNK_BLOCKS * MAX_DIGITAL_CHANNELS];
+	uint16_t tail[64], *samples;
+	char command[32];
+	size_t size, num_samples, num_bytes, num_words, num_blocks;
+	size_t blk, count, i, k;
+	int ret;
 
+	memset(data, 0, sizeof(data));
+	num_samples = devc->memory_depth_digital;
+	num_words = 0;
+	ret = SR_OK;
 	for (l = sdi->channels; l; l = l->next) {
 		ch = l->data;
-		samples_index = 0;
-		if (ch->type == SR_CHANNEL_LOGIC) {
-			if (ch->enabled) {
-				if (sr_scpi_send(sdi->conn, "D%d:WF? DAT2", ch->index) != SR_OK)
-					return SR_ERR;
-				if (sr_scpi_read_begin(scpi) != SR_OK)
-					return TRUE;
-				len = sr_scpi_read_data(scpi, buf, -1);
-				if (len < 0)
-					return TRUE;
-				len -= 15;
-				buffdata = g_array_sized_new(FALSE, FALSE, sizeof(uint8_t), len);
-				buf += 15; /* Skipping the data header. */
-				g_array_append_vals(buffdata, buf, len);
-				tmp_samplebuf = g_array_sized_new(FALSE, FALSE, sizeof(uint8_t), len); /* New temp buffer. */
-				for (uint64_t cur_sample_index = 0; cur_sample_index < devc->memory_depth_digital; cur_sample_index++) {
-					char sample = (char)g_array_index(buffdata, uint8_t, cur_sample_index);
-					for (int ii = 0; ii < 8; ii++, sample >>= 1) {
-						if (ch->index < 8) {
-							channel_index = ch->index;
-							if (data_low_channels->len <= samples_index) {
-								tmp_value = 0; /* New sample. */
-								low_channels = TRUE; /* We have at least one enabled low channel. */
-							} else {
-								/* Get previous stored sample from low channel buffer. */
-								tmp_value = g_array_index(data_low_channels, uint8_t, samples_index);
-							}
-						} else {
-							channel_index = ch->index - 8;
-							if (data_high_channels->len <= samples_index) {
-								tmp_value = 0; /* New sample. */
-								high_channels = TRUE; /* We have at least one enabled high channel. */
-							} else {
-								/* Get previous stored sample from high channel buffer. */
-								tmp_value = g_array_index(data_high_channels, uint8_t, samples_index);
-							}
-						}
-						/* Check if the current scope sample bit is set. */
-						if (sample & 0x1)
-							tmp_value |= 1UL << channel_index; /* Set current scope sample bit based on channel index. */
-						g_array_append_val(tmp_samplebuf, tmp_value);
-						samples_index++;
-					}
-				}
-
-				/* Clear the buffers to prepare for the new samples */
-				if (ch->index < 8) {
-					g_array_free(data_low_channels, FALSE);
-					data_low_channels = g_array_new(FALSE, FALSE, sizeof(uint8_t));
-				} else {
-					g_array_free(data_high_channels, FALSE);
-					data_high_channels = g_array_new(FALSE, FALSE, sizeof(uint8_t));
-				}
-
-				/* Storing the converted temp values from the the scope into the buffers. */
-				for (uint64_t index = 0; index < tmp_samplebuf->len; index++) {
-					uint8_t value = g_array_index(tmp_samplebuf, uint8_t, index);
-					if (ch->index < 8)
-						g_array_append_val(data_low_channels, value);
-					else
-						g_array_append_val(data_high_channels, value);
-				}
-				g_array_free(tmp_samplebuf, TRUE);
-				g_array_free(buffdata, TRUE);
-			}
-		}
+		if (ch->type != SR_CHANNEL_LOGIC || !ch->enabled)
+			continue;
+		g_snprintf(command, sizeof(command), "D%d:WF? DAT2", ch->index);
+		ret = sr_scpi_read_block_reuse(scpi, command,
+			&devc->dig_data[ch->index], &devc->dig_data_size[ch->index],
+			&size);
+		if (ret != SR_OK)
+			break;
+		data[ch->index] = devc->dig_data[ch->index];
+		num_samples = MIN(num_samples, size * 8);
+		num_words = MAX(num_words, (size_t)ch->index + 1);
 	}
 
-	/* Combining the lower and higher channel buffers into one buffer for sigrok. */
-	devc->dig_buffer = g_array_new(FALSE, FALSE, sizeof(uint8_t));
-	for (uint64_t index = 0; index < devc->memory_depth_digital; index++) {
-		uint8_t value;
-		if (low_channels) {
-			value = g_array_index(data_low_channels, uint8_t, index);
-			g_array_append_val(devc->dig_buffer, value);
-		} else {
-			value = 0;
-			g_array_append_val(devc->dig_buffer, value);
-		}
-		if (high_channels) {
-			value = g_array_index(data_high_channels, uint8_t, index);
-			g_array_append_val(devc->dig_buffer, value);
-		} else {
-			value = 0;
-			g_array_append_val(devc->dig_buffer, value);
+	/* The sample buffer is kept, it only grows for larger depths. */
+	if (!devc->dig_buffer)
+		devc->dig_buffer = g_array_sized_new(FALSE, FALSE,
+			sizeof(uint16_t), devc->memory_depth_digital);
+	g_array_set_size(devc->dig_buffer, 0);
+	if (ret == SR_OK && num_words) {
+		g_array_set_size(devc->dig_buffer, num_samples);
+		samples = (uint16_t *)devc->dig_buffer->data;
+		num_bytes = (num_samples + 7) / 8;
+		num_blocks = (num_samples + 63) / 64;
+		for (blk = 0; blk < num_blocks; blk += count) {
+			/* Gather the channels' words, zero for disabled ones. */
+			count = MIN(num_blocks - blk, DIGITAL_CHUNK_BLOCKS);
+			for (i = 0; i < count; i++)
+				for (k = 0; k < num_words; k++)
+					words[i * num_words + k] = digital_word(data[k],
+						8 * (blk + i), num_bytes);
+			if (64 * (blk + count) <= num_samples) {
+				sr_bits_transpose_u16(words, count, num_words,
+					&samples[64 * blk]);
+				continue;
+			}
+			/* The last block is partial. */
+			sr_bits_transpose_u16(words, count - 1, num_words,
+				&samples[64 * blk]);
+			sr_bits_transpose_u16(&words[(count - 1) * num_words], 1,
+				num_words, tail);
+			memcpy(&samples[64 * (blk + count - 1)], tail,
+				(num_samples - 64 * (blk + count - 1)) * sizeof(uint16_t));
 		}
 	}
 
-	g_array_free(data_low_channels, TRUE);
-	g_array_free(data_high_channels, TRUE);
-
-	return len;
+	return ret;
 }
 
 SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
-	struct sr_scpi_dev_inst *scpi;
 	struct dev_context *devc;
 	struct sr_datafeed_packet packet;
-	struct sr_datafeed_analog analog;
-	struct sr_analog_encoding encoding;
-	struct sr_analog_meaning meaning;
-	struct sr_analog_spec spec;
 	struct sr_datafeed_logic logic;
 	struct sr_channel *ch;
-	int len, i;
 	float wait;
-	gboolean read_complete = FALSE;
 
 	(void)fd;
 
@@ -481,8 +477,6 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 	if (!(devc = sdi->priv))
 		return TRUE;
 
-	scpi = sdi->conn;
-
 	if (!(revents == G_IO_IN || revents == 0))
 		return TRUE;
 
@@ -511,146 +505,54 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 	}
 
 	ch = devc->channel_entry->data;
-	len = 0;
 
 	if (ch->type == SR_CHANNEL_ANALOG) {
-		if (devc->num_block_bytes == 0) {
-			/* Wait for the device to fill its output buffers. */
-			switch (devc->model->series->protocol) {
-			case NON_SPO_MODEL:
-			case SPO_MODEL:
-				/* The older models need more time to prepare the the output buffers due to CPU speed. */
-				wait = (devc->memory_depth_analog * 2.5);
-				sr_dbg("Waiting %.f0 ms for device to prepare the output buffers", wait / 1000);
-				g_usleep(wait);
-				if (sr_scpi_read_begin(scpi) != SR_OK)
-					return TRUE;
-				break;
-			case ESERIES:
-				/* The newer models (ending with the E) have faster CPUs but still need time when a slow timebase is selected. */
-				if (sr_scpi_read_begin(scpi) != SR_OK)
-					return TRUE;
-				wait = ((devc->timebase * devc->model->series->num_horizontal_divs) * 100000);
-				sr_dbg("Waiting %.f0 ms for device to prepare the output buffers", wait / 1000);
-				g_usleep(wait);
-				break;
-			}
+		/* Wait for the device to fill its output buffers. */
+		switch (devc->model->series->protocol) {
+		case NON_SPO_MODEL:
+		case SPO_MODEL:
+			/* The older models need more time to prepare the the output buffers due to CPU speed. */
+			wait = (devc->memory_depth_analog * 2.5);
+			break;
+		case ESERIES:
+		default:
+			/* The newer models (ending with the E) have faster CPUs but still need time when a slow timebase is selected. */
+			wait = ((devc->timebase * devc->model->series->num_horizontal_divs) * 100000);
+			break;
+		}
+		sr_dbg("Waiting %.f0 ms for device to prepare the output buffers", wait / 1000);
+		g_usleep(wait);
 
-			sr_dbg("New block with header expected.");
-			len = siglent_sds_read_header(sdi);
-			if (len == 0)
-				/* Still reading the header. */
-				return TRUE;
-			if (len == -1) {
-				sr_err("Read error, aborting capture.");
-				std_session_send_df_frame_end(sdi);
-				sdi->driver->dev_acquisition_stop(sdi);
-				return TRUE;
-			}
-			devc->num_block_bytes = len;
-			devc->num_block_read = 0;
+		if (siglent_sds_get_analog(sdi, ch) != SR_OK) {
+			sr_err("Read error, aborting capture.");
+			std_session_send_df_frame_end(sdi);
+			sdi->driver->dev_acquisition_stop(sdi);
+			return TRUE;
+		}
 
-			if (len == -1) {
-				sr_err("Read error, aborting capture.");
-				std_session_send_df_frame_end(sdi);
+		if (devc->channel_entry->next) {
+			/* We got the frame for this channel, now get the next channel. */
+			devc->channel_entry = devc->channel_entry->next;
+			siglent_sds_channel_start(sdi);
+		} else {
+			/* Done with this frame. */
+			std_session_send_df_frame_end(sdi);
+			if (++devc->num_frames == devc->limit_frames) {
+				/* Last frame, stop capture. */
 				sdi->driver->dev_acquisition_stop(sdi);
-				return TRUE;
-			}
-
-			do {
-				read_complete = FALSE;
-				if (devc->num_block_bytes > devc->num_samples) {
-					/* We received all data as one block. */
-					/* Offset the data block buffer past the IEEE header and description header. */
-					devc->buffer += devc->block_header_size;
-					len = devc->num_samples;
-				} else {
-					sr_dbg("Requesting: %" PRIu64 " bytes.", devc->num_samples - devc->num_block_bytes);
-					len = sr_scpi_read_data(scpi, (char *)devc->buffer, devc->num_samples-devc->num_block_bytes);
-					if (len == -1) {
-						sr_err("Read error, aborting capture.");
-						std_session_send_df_frame_end(sdi);
-						sdi->driver->dev_acquisition_stop(sdi);
-						return TRUE;
-					}
-					devc->num_block_read++;
-					devc->num_block_bytes += len;
-				}
-				sr_dbg("Received block: %i, %d bytes.", devc->num_block_read, len);
-				if (ch->type == SR_CHANNEL_ANALOG) {
-					float vdiv = devc->vdiv[ch->index];
-					float offset = devc->vert_offset[ch->index];
-					GArray *float_data;
-					static GArray *data;
-					float voltage, vdivlog;
-					int digits;
-
-					data = g_array_sized_new(FALSE, FALSE, sizeof(uint8_t), len);
-					g_array_append_vals(data, devc->buffer, len);
-					float_data = g_array_new(FALSE, FALSE, sizeof(float));
-					for (i = 0; i < len; i++) {
-						voltage = (float)g_array_index(data, int8_t, i) / 25;
-						voltage = ((vdiv * voltage) - offset);
-						g_array_append_val(float_data, voltage);
-					}
-					vdivlog = log10f(vdiv);
-					digits = -(int) vdivlog + (vdivlog < 0.0);
-					sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
-					analog.meaning->channels = g_slist_append(NULL, ch);
-					analog.num_samples = float_data->len;
-					analog.data = (float *)float_data->data;
-					analog.meaning->mq = SR_MQ_VOLTAGE;
-					analog.meaning->unit = SR_UNIT_VOLT;
-					analog.meaning->mqflags = 0;
-					packet.type = SR_DF_ANALOG;
-					packet.payload = &analog;
-					sr_session_send(sdi, &packet);
-					g_slist_free(analog.meaning->channels);
-					g_array_free(data, TRUE);
-				}
-				len = 0;
-				if (devc->num_samples == (devc->num_block_bytes - SIGLENT_HEADER_SIZE)) {
-					sr_dbg("Transfer has been completed.");
-					devc->num_header_bytes = 0;
-					devc->num_block_bytes = 0;
-					read_complete = TRUE;
-					if (!sr_scpi_read_complete(scpi)) {
-						sr_err("Read should have been completed.");
-						std_session_send_df_frame_end(sdi);
-						sdi->driver->dev_acquisition_stop(sdi);
-						return TRUE;
-					}
-					devc->num_block_read = 0;
-				} else {
-					sr_dbg("%" PRIu64 " of %" PRIu64 " block bytes read.",
-						devc->num_block_bytes, devc->num_samples);
-				}
-			} while (!read_complete);
-
-			if (devc->channel_entry->next) {
-				/* We got the frame for this channel, now get the next channel. */
-				devc->channel_entry = devc->channel_entry->next;
-				siglent_sds_channel_start(sdi);
 			} else {
-				/* Done with this frame. */
-				std_session_send_df_frame_end(sdi);
-				if (++devc->num_frames == devc->limit_frames) {
-					/* Last frame, stop capture. */
-					sdi->driver->dev_acquisition_stop(sdi);
-				} else {
-					/* Get the next frame, starting with the first channel. */
-					devc->channel_entry = devc->enabled_channels;
-					siglent_sds_capture_start(sdi);
-
-					/* Start of next frame. */
-					std_session_send_df_frame_begin(sdi);
-				}
+				/* Get the next frame, starting with the first channel. */
+				devc->channel_entry = devc->enabled_channels;
+				siglent_sds_capture_start(sdi);
+
+				/* Start of next frame. */
+				std_session_send_df_frame_begin(sdi);
 			}
 		}
 	} else {
-		if (!siglent_sds_get_digital(sdi, ch))
+		if (siglent_sds_get_digital(sdi) != SR_OK)
 			return TRUE;
-		logic.length = devc->dig_buffer->len;
+		logic.length = devc->dig_buffer->len * sizeof(uint16_t);
 		logic.unitsize = 2;
 		logic.data = devc->dig_buffer->data;
 		packet.type = SR_DF_LOGIC;
@@ -110,10 +110,8 @@ struct dev_context {
 	enum data_source data_source;
 	uint64_t analog_frame_size;
 	uint64_t digital_frame_size;
-	uint64_t num_samples;
 	uint64_t memory_depth_analog;
 	uint64_t memory_depth_digital;
-	long block_header_size;
 	float samplerate;
 
 	/* Device settings */
@@ -141,10 +139,6 @@ struct dev_context {
 	uint64_t num_channel_bytes;
 	/* Number of bytes of block header read. */
 	uint64_t num_header_bytes;
-	/* Number of data blocks bytes already read. */
-	uint64_t num_block_bytes;
-	/* Number of data blocks read. */
-	int num_block_read;
 	/* What to wait for in *_receive. */
 	enum wait_events wait_event;
 	/* Trigger/block copying/stop waiting status. */
@@ -153,6 +147,9 @@ struct dev_context {
 	unsigned char *buffer;
 	float *data;
 	GArray *dig_buffer;
+	/* Raw data of the digital channels, kept for the next reads. */
+	uint8_t *dig_data[MAX_DIGITAL_CHANNELS];
+	size_t dig_data_size[MAX_DIGITAL_CHANNELS];
 };
 
 SR_PRIV int siglent_sds_config_set(const struct sr_dev_inst *sdi,
@@ -59,6 +59,12 @@ struct sr_usb_dev_inst;
  */
 #define MAX_ACQ_RECV_LEN32	(2 * 512 / 4)
 
+/* Number of USB in transfers used round-robin during acquisition. The
+ * response to the next read request gets received into one while the
+ * previous one is being decoded.
+ */
+#define NUM_ACQ_XFER_IN		2
+
 /* Maximum length of a register read/write sequence.
  */
 #define MAX_REG_SEQ_LEN		8
@@ -110,12 +116,15 @@ struct acquisition_state {
 	uint64_t sample;	/* last sample read from capture memory */
 	uint64_t run_len;	/* remaining run length of current sample */
 
-	struct libusb_transfer *xfer_in;	/* USB in transfer record */
+	struct libusb_transfer *xfer_in;	/* USB in transfer being handled */
 	struct libusb_transfer *xfer_out;	/* USB out transfer record */
+	struct libusb_transfer *xfer_in_ring[NUM_ACQ_XFER_IN];
+	unsigned int xfer_in_next;	/* index of next in transfer to submit */
 
 	unsigned int mem_addr_fill;	/* capture memory fill level */
 	unsigned int mem_addr_done;	/* next address to be processed */
 	unsigned int mem_addr_next;	/* start address for next async read */
+	unsigned int mem_addr_rcvd;	/* end address of received data */
 	unsigned int mem_addr_stop;	/* end of memory range to be read */
 	unsigned int in_index;		/* position in read transfer buffer */
 	unsigned int out_index;		/* position in logic packet buffer */
@@ -128,8 +137,12 @@ struct acquisition_state {
 	unsigned int reg_seq_pos;	/* index of next register/value pair */
 	unsigned int reg_seq_len;	/* length of register/value sequence */
 
+	int64_t read_start_us;	/* monotonic time of first read request */
+	int64_t decode_us;	/* time spent decoding read responses */
+
 	struct regval reg_sequence[MAX_REG_SEQ_LEN];	/* register buffer */
-	uint32_t xfer_buf_in[MAX_ACQ_RECV_LEN32];	/* USB in buffer */
+	uint32_t *xfer_buf_in;				/* current USB in buffer */
+	uint32_t xfer_bufs_in[NUM_ACQ_XFER_IN][MAX_ACQ_RECV_LEN32];
 	uint16_t xfer_buf_out[MAX_ACQ_SEND_LEN16];	/* USB out buffer */
 	uint8_t out_packet[PACKET_SIZE];		/* logic payload */
 };
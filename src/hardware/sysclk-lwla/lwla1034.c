@@ -195,7 +195,7 @@ static void read_response(struct acquisition_state *acq)
 	unsigned int words_left, max_samples, run_samples, wi, ri, si;
 
 	/* Number of 36-bit words remaining in the transfer buffer. */
-	words_left = MIN(acq->mem_addr_next, acq->mem_addr_stop)
+	words_left = MIN(acq->mem_addr_rcvd, acq->mem_addr_stop)
 			- acq->mem_addr_done;
 
 	for (wi = 0;; wi++) {
@@ -527,7 +527,7 @@ static int handle_response(const struct sr_dev_inst *sdi)
 	case STATE_READ_REQUEST:
 		/* Expect a multiple of 8 36-bit words packed into 9 32-bit
 		 * words. */
-		expect_len = (acq->mem_addr_next - acq->mem_addr_done
+		expect_len = (acq->mem_addr_rcvd - acq->mem_addr_done
 			+ acq->in_index + 7) / 8 * 9 * sizeof(acq->xfer_buf_in[0]);
 
 		if (acq->xfer_in->actual_length != expect_len) {
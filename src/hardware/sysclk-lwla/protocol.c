@@ -39,6 +39,20 @@ static int submit_transfer(struct dev_context *devc,
 	return SR_OK;
 }
 
+/* Submit the next in transfer of the ring, to receive a response. */
+static int submit_transfer_in(struct dev_context *devc)
+{
+	struct acquisition_state *acq;
+	struct libusb_transfer *xfer;
+
+	acq = devc->acquisition;
+
+	xfer = acq->xfer_in_ring[acq->xfer_in_next];
+	acq->xfer_in_next = (acq->xfer_in_next + 1) % NUM_ACQ_XFER_IN;
+
+	return submit_transfer(devc, xfer);
+}
+
 /* Set up transfer for the next register in a write sequence. */
 static void next_reg_write(struct acquisition_state *acq)
 {
@@ -115,7 +129,19 @@ static int submit_request(const struct sr_dev_inst *sdi,
 			next_reg_write(acq);
 	}
 
-	return submit_transfer(devc, acq->xfer_out);
+	ret = submit_transfer(devc, acq->xfer_out);
+	if (ret != SR_OK)
+		return ret;
+
+	/*
+	 * Have the response to a memory read received without waiting
+	 * for the request's completion. The response goes to another
+	 * buffer than the one which may still be getting decoded.
+	 */
+	if (state == STATE_READ_REQUEST)
+		return submit_transfer_in(devc);
+
+	return SR_OK;
 }
 
 /* Evaluate and act on the response to a capture status request. */
@@ -172,7 +198,10 @@ static void handle_length_response(const struct sr_dev_inst *sdi)
 	acq->run_len = 0;
 	acq->samples_done = 0;
 	acq->mem_addr_done = acq->mem_addr_next;
+	acq->mem_addr_rcvd = acq->mem_addr_next;
 	acq->out_index = 0;
+	acq->read_start_us = g_get_monotonic_time();
+	acq->decode_us = 0;
 
 	if (acq->mem_addr_next >= acq->mem_addr_stop) {
 		submit_request(sdi, STATE_READ_FINISH);
@@ -192,6 +221,8 @@ static void handle_read_response(const struct sr_dev_inst *sdi)
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
 	unsigned int end_addr;
+	gboolean read_more;
+	int64_t decode_start_us, read_us;
 
 	devc = sdi->priv;
 	acq = devc->acquisition;
@@ -202,13 +233,27 @@ static void handle_read_response(const struct sr_dev_inst *sdi)
 	logic.unitsize = (devc->model->num_channels + 7) / 8;
 	logic.data = acq->out_packet;
 
-	end_addr = MIN(acq->mem_addr_next, acq->mem_addr_stop);
+	acq->mem_addr_rcvd = acq->mem_addr_next;
+	end_addr = MIN(acq->mem_addr_rcvd, acq->mem_addr_stop);
 	acq->in_index = 0;
 
+	/*
+	 * Request the next block before decoding this one, so that the
+	 * device keeps sending while the host decodes. Should the sample
+	 * limit be reached while decoding, the next response gets
+	 * discarded upon reception.
+	 */
+	read_more = !devc->cancel_requested
+			&& acq->samples_done < acq->samples_max
+			&& acq->mem_addr_next < acq->mem_addr_stop;
+	if (read_more)
+		submit_request(sdi, STATE_READ_REQUEST);
+
 	/*
 	 * Repeatedly call the model-specific read response handler until
 	 * all data received in the transfer has been accounted for.
 	 */
+	decode_start_us = g_get_monotonic_time();
 	while (!devc->cancel_requested
 			&& (acq->run_len > 0 || acq->mem_addr_done < end_addr)
 			&& acq->samples_done < acq->samples_max) {
@@ -224,14 +269,11 @@ static void handle_read_response(const struct sr_dev_inst *sdi)
 			acq->out_index = 0;
 		}
 	}
+	acq->decode_us += g_get_monotonic_time() - decode_start_us;
 
-	if (!devc->cancel_requested
-			&& acq->samples_done < acq->samples_max
-			&& acq->mem_addr_next < acq->mem_addr_stop) {
-		/* Request the next block. */
-		submit_request(sdi, STATE_READ_REQUEST);
+	/* The next block's response continues from here. */
+	if (read_more)
 		return;
-	}
 
 	/* Send partially filled packet as it is the last one. */
 	if (!devc->cancel_requested && acq->out_index > 0) {
@@ -239,6 +281,11 @@ static void handle_read_response(const struct sr_dev_inst *sdi)
 		sr_session_send(sdi, &packet);
 		acq->out_index = 0;
 	}
+
+	read_us = g_get_monotonic_time() - acq->read_start_us;
+	sr_dbg("Read %" PRIu64 " samples in %.3f ms, %.3f ms of which decoding.",
+	       acq->samples_done, read_us / 1e3, acq->decode_us / 1e3);
+
 	submit_request(sdi, STATE_READ_FINISH);
 }
 
@@ -247,6 +294,7 @@ static void clear_acquisition_state(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct acquisition_state *acq;
+	unsigned int i;
 
 	devc = sdi->priv;
 	acq = devc->acquisition;
@@ -255,7 +303,8 @@ static void clear_acquisition_state(const struct sr_dev_inst *sdi)
 
 	if (acq) {
 		libusb_free_transfer(acq->xfer_out);
-		libusb_free_transfer(acq->xfer_in);
+		for (i = 0; i < NUM_ACQ_XFER_IN; i++)
+			libusb_free_transfer(acq->xfer_in_ring[i]);
 		g_free(acq);
 	}
 }
@@ -329,9 +378,11 @@ static void LIBUSB_CALL transfer_out_completed(struct libusb_transfer *transfer)
 		return;
 	}
 
-	/* If this was a read request, wait for the response. */
+	/* If this was a read request, wait for the response. Memory
+	 * reads have had it submitted along with the request. */
 	if ((devc->state & STATE_EXPECT_RESPONSE) != 0) {
-		submit_transfer(devc, acq->xfer_in);
+		if (devc->state != STATE_READ_REQUEST)
+			submit_transfer_in(devc);
 		return;
 	}
 	if (acq->reg_seq_pos < acq->reg_seq_len)
@@ -386,6 +437,9 @@ static void LIBUSB_CALL transfer_in_completed(struct libusb_transfer *transfer)
 	devc = sdi->priv;
 	acq = devc->acquisition;
 
+	acq->xfer_in = transfer;
+	acq->xfer_buf_in = (uint32_t *)transfer->buffer;
+
 	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
 		sr_err("Transfer from device failed (state %d): %s.",
 		       devc->state, libusb_error_name(transfer->status));
@@ -442,6 +496,7 @@ static int init_acquisition_state(const struct sr_dev_inst *sdi)
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
 	struct acquisition_state *acq;
+	unsigned int i;
 
 	devc = sdi->priv;
 	usb = sdi->conn;
@@ -459,28 +514,38 @@ static int init_acquisition_state(const struct sr_dev_inst *sdi)
 	if (!acq)
 		return SR_ERR_MALLOC;
 
-	acq->xfer_in = libusb_alloc_transfer(0);
-	if (!acq->xfer_in) {
-		g_free(acq);
-		return SR_ERR_MALLOC;
-	}
 	acq->xfer_out = libusb_alloc_transfer(0);
 	if (!acq->xfer_out) {
-		libusb_free_transfer(acq->xfer_in);
 		g_free(acq);
 		return SR_ERR_MALLOC;
 	}
+	for (i = 0; i < NUM_ACQ_XFER_IN; i++) {
+		acq->xfer_in_ring[i] = libusb_alloc_transfer(0);
+		if (!acq->xfer_in_ring[i]) {
+			while (i--)
+				libusb_free_transfer(acq->xfer_in_ring[i]);
+			libusb_free_transfer(acq->xfer_out);
+			g_free(acq);
+			return SR_ERR_MALLOC;
+		}
+	}
 
 	libusb_fill_bulk_transfer(acq->xfer_out, usb->devhdl, EP_COMMAND,
 				  (unsigned char *)acq->xfer_buf_out, 0,
 				  &transfer_out_completed,
 				  (struct sr_dev_inst *)sdi, USB_TIMEOUT_MS);
 
-	libusb_fill_bulk_transfer(acq->xfer_in, usb->devhdl, EP_REPLY,
-				  (unsigned char *)acq->xfer_buf_in,
-				  sizeof(acq->xfer_buf_in),
-				  &transfer_in_completed,
-				  (struct sr_dev_inst *)sdi, USB_TIMEOUT_MS);
+	for (i = 0; i < NUM_ACQ_XFER_IN; i++) {
+		libusb_fill_bulk_transfer(acq->xfer_in_ring[i], usb->devhdl,
+					  EP_REPLY,
+					  (unsigned char *)acq->xfer_bufs_in[i],
+					  sizeof(acq->xfer_bufs_in[i]),
+					  &transfer_in_completed,
+					  (struct sr_dev_inst *)sdi,
+					  USB_TIMEOUT_MS);
+	}
+	acq->xfer_in = acq->xfer_in_ring[0];
+	acq->xfer_buf_in = acq->xfer_bufs_in[0];
 
 	if (devc->limit_msec > 0) {
 		acq->duration_max = devc->limit_msec;
@@ -683,6 +683,47 @@ SR_PRIV int sla5032_apply_fpga_config(const struct sr_dev_inst *sdi)
 	return ret;
 }
 
+/*
+ * Check a transfer for the trigger, on the run-length encoded samples.
+ * Returns the offset (in samples) of the trigger, -1 if not triggered,
+ * or a negative error code.
+ */
+static int64_t check_trigger(struct dev_context *devc,
+		const uint8_t *rle_buf, int rle_samples_count)
+{
+	struct sr_datafeed_logic_rle rle;
+	uint32_t *values;
+	uint64_t *lengths;
+	int64_t offset;
+	int i;
+
+	values = g_try_malloc(MAX(rle_samples_count, 1) * sizeof(*values));
+	lengths = g_try_malloc(MAX(rle_samples_count, 1) * sizeof(*lengths));
+	if (!values || !lengths) {
+		sr_dbg("memory allocation error.");
+		g_free(values);
+		g_free(lengths);
+		return SR_ERR_MALLOC;
+	}
+
+	for (i = 0; i < rle_samples_count; i++) {
+		values[i] = RL32(rle_buf);
+		lengths[i] = RL16(rle_buf + sizeof(uint32_t)) + 1;
+		rle_buf += sizeof(uint32_t) + sizeof(uint16_t);
+	}
+
+	rle.num_runs = rle_samples_count;
+	rle.unitsize = sizeof(uint32_t);
+	rle.values = values;
+	rle.lengths = lengths;
+	offset = soft_trigger_logic_check_rle(devc->stl, &rle, NULL);
+
+	g_free(values);
+	g_free(lengths);
+
+	return offset;
+}
+
 /* Callback handling data */
 static int la_prepare_data(int fd, int revents, void *cb_data)
 {
@@ -698,7 +739,7 @@ static int la_prepare_data(int fd, int revents, void *cb_data)
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
 	uint32_t value;
-	int trigger_offset;
+	int64_t trigger_offset;
 
 	enum {
 		RLE_SAMPLE_SIZE = sizeof(uint32_t) + sizeof(uint16_t),
@@ -791,6 +832,23 @@ static int la_prepare_data(int fd, int revents, void *cb_data)
 			return G_SOURCE_CONTINUE;
 		}
 
+		if (!devc->trigger_fired) {
+			trigger_offset = check_trigger(devc, rle_buf,
+				rle_samples_count);
+			if (trigger_offset < 0) {
+				if (trigger_offset != -1) {
+					sla5032_write_reg14_zero(usb);
+					g_free(rle_buf);
+					sr_dev_acquisition_stop(sdi);
+					return G_SOURCE_CONTINUE;
+				}
+				continue;
+			}
+			devc->trigger_fired = TRUE;
+		} else {
+			trigger_offset = 0;
+		}
+
 		/* Decode RLE */
 		samples = g_try_malloc(samples_count * sizeof(uint32_t));
 		if (!samples) {
@@ -821,31 +879,14 @@ static int la_prepare_data(int fd, int revents, void *cb_data)
 			}
 		}
 
-		if (devc->trigger_fired) {
-			/* Send the incoming transfer to the session bus. */
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
+		/* Send the incoming transfer to the session bus. */
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
 
-			logic.length = samples_count * sizeof(uint32_t);
-			logic.unitsize = sizeof(uint32_t);
-			logic.data = samples;
-			sr_session_send(sdi, &packet);
-		} else {
-			trigger_offset = soft_trigger_logic_check(devc->stl,
-				samples, samples_count * sizeof(uint32_t), NULL);
-			if (trigger_offset > -1) {
-				packet.type = SR_DF_LOGIC;
-				packet.payload = &logic;
-				int num_samples = samples_count - trigger_offset;
-
-				logic.length = num_samples * sizeof(uint32_t);
-				logic.unitsize = sizeof(uint32_t);
-				logic.data = samples + trigger_offset * sizeof(uint32_t);
-				sr_session_send(sdi, &packet);
-
-				devc->trigger_fired = TRUE;
-			}
-		}
+		logic.length = (samples_count - trigger_offset) * sizeof(uint32_t);
+		logic.unitsize = sizeof(uint32_t);
+		logic.data = samples + trigger_offset * sizeof(uint32_t);
+		sr_session_send(sdi, &packet);
 
 		g_free(samples);
 	} while (rle_samples_count == RLE_SAMPLES_COUNT);
@@ -186,26 +186,6 @@ SR_PRIV gboolean testo_check_packet_prefix(unsigned char *buf, int len)
 	return TRUE;
 }
 
-SR_PRIV uint16_t crc16_mcrf4xx(uint16_t crc, uint8_t *data, size_t len)
-{
-	int i;
-
-	if (!data || !len)
-		return crc;
-
-	while (len--) {
-		crc ^= *data++;
-		for (i = 0; i < 8; i++) {
-			if (crc & 1)
-				crc = (crc >> 1) ^ 0x8408;
-			else
-				crc = (crc >> 1);
-		}
-	}
-
-	return crc;
-}
-
 static float binary32_le_to_float(unsigned char *buf)
 {
 	GFloatIEEE754 f;
@@ -137,16 +137,14 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	std_session_send_df_header(sdi);
 
-	sr_session_source_add(sdi->session, -1, 0, 10,
+	return sr_session_poll_add(sdi, 10, 5,
 			uni_t_dmm_receive_data, (void *)sdi);
-
-	return SR_OK;
 }
 
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
 	std_session_send_df_end(sdi);
-	sr_session_source_remove(sdi->session, -1);
+	sr_session_poll_remove(sdi);
 
 	return SR_OK;
 }
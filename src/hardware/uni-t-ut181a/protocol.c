@@ -1232,6 +1232,37 @@ SR_PRIV int ut181a_send_cmd_get_rec_samples(struct sr_serial_dev_inst *serial, s
 	return ut181a_send_frame(serial, cmd, sizeof(cmd));
 }
 
+/*
+ * Keep "get recording samples" requests outstanding, up to the current
+ * depth. The meter answers in order, with a chunk of samples for each
+ * request. The chunk size is unknown before the first response, so the
+ * first request goes out alone. Later requests assume that all chunks
+ * but the last have that size.
+ */
+SR_PRIV int ut181a_send_rec_requests(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_serial_dev_inst *serial;
+	int ret;
+
+	devc = sdi->priv;
+	serial = sdi->conn;
+	while (devc->info.rec_data.req_count < devc->info.rec_data.req_depth
+			&& devc->info.rec_data.samples_req < devc->info.rec_data.samples_total) {
+		ret = ut181a_send_cmd_get_rec_samples(serial,
+			devc->info.rec_data.rec_idx, devc->info.rec_data.samples_req);
+		if (ret < 0)
+			return ret;
+		devc->info.rec_data.req_offs[devc->info.rec_data.req_count++] =
+			devc->info.rec_data.samples_req;
+		if (!devc->info.rec_data.chunk_size)
+			break;
+		devc->info.rec_data.samples_req += devc->info.rec_data.chunk_size;
+	}
+
+	return SR_OK;
+}
+
 /* TODO
  * Construct and transmit "record on/off" command. Requires a caption,
  * an interval, and a duration to start a recording. Recordings can get
@@ -1376,8 +1407,8 @@ static void ut181a_cond_stop_acquisition(struct sr_dev_inst *sdi)
 static int ut181a_feed_send_rate(struct sr_dev_inst *sdi, int interval)
 {
 #if 1
-	return sr_session_send_meta(sdi,
-		SR_CONF_SAMPLE_INTERVAL, g_variant_new_uint64(interval));
+	return sr_session_send_meta_uint64(sdi,
+		SR_CONF_SAMPLE_INTERVAL, interval);
 #else
 	uint64_t rate;
 
@@ -1391,8 +1422,8 @@ static int ut181a_feed_send_rate(struct sr_dev_inst *sdi, int interval)
 	(void)interval;
 	rate = 0;
 
-	return sr_session_send_meta(sdi,
-		SR_CONF_SAMPLERATE, g_variant_new_uint64(rate));
+	return sr_session_send_meta_uint64(sdi,
+		SR_CONF_SAMPLERATE, rate);
 #endif
 }
 
@@ -1518,6 +1549,40 @@ static int ut181a_feedbuff_send_feed(struct feed_buffer *buff,
 	return ret;
 }
 
+/**
+ * Send several values of equal precision to the session, in one packet.
+ */
+static int ut181a_feedbuff_send_values(struct feed_buffer *buff,
+	struct sr_dev_inst *sdi, float *values, size_t count, int digits)
+{
+	struct dev_context *devc;
+	uint64_t remain;
+	int ret;
+
+	if (!buff || !sdi || !count)
+		return SR_ERR_ARG;
+
+	/* Don't exceed a sample count limit within the packet. */
+	devc = sdi->priv;
+	if (devc && devc->limits.limit_samples) {
+		remain = devc->limits.limit_samples;
+		remain -= MIN(remain, devc->limits.samples_read);
+		count = MIN(count, remain);
+		if (!count)
+			return SR_OK;
+	}
+
+	buff->analog.encoding->digits = digits;
+	buff->analog.spec->spec_digits = digits;
+	buff->analog.num_samples = count;
+	buff->analog.data = values;
+	ret = ut181a_feedbuff_send_feed(buff, sdi, count);
+	buff->analog.num_samples = 1;
+	buff->analog.data = &buff->main_value;
+
+	return ret;
+}
+
 /**
  * Release previously allocated resources in the feed buffer.
  */
@@ -1744,6 +1809,9 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 	const struct mqopt_item *mqitem;
 	int ret;
 	uint8_t v8; uint16_t v16; uint32_t v32; float vf;
+	float rec_values[UINT8_MAX];
+	size_t rec_off, rec_skip, rec_len, idx;
+	int rec_digits;
 
 	/*
 	 * Cope with different calling contexts. The packet parser can
@@ -2549,10 +2617,23 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 			break;
 		if (!devc || devc->disable_feed || !info)
 			break;
+		if (!info->rec_data.req_count)
+			break;
 		ret = ut181a_feedbuff_initialize(&feedbuff);
 		ret = ut181a_feedbuff_setup_channel(&feedbuff, UT181A_CH_MAIN, sdi);
 		ret = ut181a_feedbuff_setup_unit(&feedbuff, devc->last_data.unit_text);
 
+		/*
+		 * The chunk answers the oldest outstanding request. Skip
+		 * samples which were received before. Drop the chunk when
+		 * it starts past the samples which are still missing, an
+		 * earlier chunk was shorter than expected then.
+		 */
+		rec_off = info->rec_data.req_offs[0];
+		info->rec_data.req_count--;
+		memmove(&info->rec_data.req_offs[0], &info->rec_data.req_offs[1],
+			info->rec_data.req_count * sizeof(info->rec_data.req_offs[0]));
+
 		/*
 		 * Record data:
 		 * - u8 sample count for this data chunk, then the
@@ -2564,39 +2645,74 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 		ret = consume_u8(&info->rec_data.samples_chunk, &payload, &pl_dlen);
 		if (ret != SR_OK)
 			return SR_ERR_DATA;
-		info->rec_data.samples_curr += info->rec_data.samples_chunk;
-		while (info->rec_data.samples_chunk--) {
-			/*
-			 * Implementation detail: Consume all received
-			 * data, yet skip processing when a limit was
-			 * reached and previously terminated acquisition.
-			 */
+		rec_skip = info->rec_data.samples_curr - MIN(rec_off,
+			info->rec_data.samples_curr);
+		if (rec_off > info->rec_data.samples_curr)
+			rec_skip = info->rec_data.samples_chunk;
+
+		/*
+		 * Consume all received data, yet skip processing when a
+		 * limit was reached and previously terminated acquisition.
+		 * Each run of samples with equal precision goes to the
+		 * session in one packet.
+		 */
+		rec_len = 0;
+		rec_digits = 0;
+		for (idx = 0; idx < info->rec_data.samples_chunk; idx++) {
 			ret = SR_OK;
 			ret |= consume_flt(&vf, &payload, &pl_dlen);
 			ret |= consume_u8(&v8, &payload, &pl_dlen);
 			ret |= consume_u32(&v32, &payload, &pl_dlen);
 			if (ret != SR_OK)
 				return SR_ERR_DATA;
-
-			if (sdi->status != SR_ST_ACTIVE)
+			if (idx < rec_skip)
 				continue;
 
-			ret = ut181a_feedbuff_start_frame(sdi);
-			if (ret != SR_OK)
-				return SR_ERR_DATA;
-
 			ret = SR_OK;
 			ret |= ut181a_get_value_params(&value, vf, v8);
 			ret |= ut181a_feedbuff_setup_value(&feedbuff, &value);
-			ret |= ut181a_feedbuff_send_feed(&feedbuff, sdi, 1);
 			if (ret != SR_OK)
 				return SR_ERR_DATA;
-
-			ret = ut181a_feedbuff_count_frame(sdi);
+			if (rec_len && feedbuff.analog.encoding->digits != rec_digits) {
+				ret = ut181a_feedbuff_send_values(&feedbuff, sdi,
+					rec_values, rec_len, rec_digits);
+				if (ret != SR_OK)
+					return SR_ERR_DATA;
+				rec_len = 0;
+			}
+			rec_digits = feedbuff.analog.encoding->digits;
+			rec_values[rec_len++] = feedbuff.main_value;
+		}
+		if (rec_len) {
+			ret = ut181a_feedbuff_send_values(&feedbuff, sdi,
+				rec_values, rec_len, rec_digits);
 			if (ret != SR_OK)
 				return SR_ERR_DATA;
 		}
 		ret = ut181a_feedbuff_cleanup(&feedbuff);
+
+		/*
+		 * Learn the chunk size from the first chunk. Fall back
+		 * to one request at a time when a chunk other than the
+		 * last one is shorter, requests then resume right after
+		 * the samples which were received.
+		 */
+		if (rec_off <= info->rec_data.samples_curr) {
+			info->rec_data.samples_curr = MAX(info->rec_data.samples_curr,
+				rec_off + info->rec_data.samples_chunk);
+		}
+		if (!info->rec_data.chunk_size) {
+			info->rec_data.chunk_size = info->rec_data.samples_chunk;
+			info->rec_data.samples_req = info->rec_data.samples_curr;
+			info->rec_data.req_depth = REC_REQ_DEPTH;
+		} else if (info->rec_data.req_depth > 1
+				&& info->rec_data.samples_chunk < info->rec_data.chunk_size
+				&& info->rec_data.samples_curr < info->rec_data.samples_total) {
+			sr_dbg("Short chunk of record data, no more pipelining.");
+			info->rec_data.req_depth = 1;
+		}
+		if (info->rec_data.req_depth == 1)
+			info->rec_data.samples_req = info->rec_data.samples_curr;
 		break;
 
 	case RSP_TYPE_REPLY_DATA:
@@ -2672,14 +2788,15 @@ static int process_packet(struct sr_dev_inst *sdi, uint8_t *pkt, size_t len)
 			/*
 			 * The sample count was incremented above during
 			 * reception, because of variable length chunks
-			 * of sample data.
+			 * of sample data. An empty chunk ends the download
+			 * as well, the meter has no more samples then.
 			 */
-			if (info->rec_data.samples_curr >= info->rec_data.samples_total) {
+			if (info->rec_data.samples_curr >= info->rec_data.samples_total
+					|| !info->rec_data.samples_chunk) {
 				ut181a_cond_stop_acquisition(sdi);
 				break;
 			}
-			ret = ut181a_send_cmd_get_rec_samples(serial,
-				info->rec_data.rec_idx, info->rec_data.samples_curr);
+			ret = ut181a_send_rec_requests(sdi);
 			if (ret < 0)
 				ut181a_cond_stop_acquisition(sdi);
 			break;
@@ -2698,7 +2815,8 @@ static int process_buffer(struct sr_dev_inst *sdi)
 	struct dev_context *devc;
 	uint8_t *pkt;
 	uint16_t v16;
-	size_t pkt_len, remain, idx;
+	size_t pkt_len, remain, idx, done;
+	gboolean need_data;
 	int ret;
 
 	devc = sdi->priv;
@@ -2722,13 +2840,21 @@ static int process_buffer(struct sr_dev_inst *sdi)
 	 * number of bytes according to length. The frame ends there, the
 	 * checksum field is covered by the length value. packet processing
 	 * will verify the checksum.
+	 *
+	 * All complete packets in the buffer get processed before the
+	 * remaining data moves to the start of the buffer, just once.
+	 * Downloads of recordings receive several packets at a time.
 	 */
-	pkt = &devc->recv_buff[0];
+	done = 0;
+	need_data = FALSE;
 	do {
+		pkt = &devc->recv_buff[done];
+		remain = devc->recv_count - done;
 		/* Search for (the start of) a valid packet. */
-		if (devc->recv_count < 2 * sizeof(uint16_t)) {
+		if (remain < 2 * sizeof(uint16_t)) {
 			/* Need more RX data for magic and length. */
-			return SR_OK;
+			need_data = TRUE;
+			break;
 		}
 		v16 = RL16(&pkt[0]);
 		if (v16 != FRAME_MAGIC) {
@@ -2755,9 +2881,10 @@ static int process_buffer(struct sr_dev_inst *sdi)
 			}
 			break;
 		}
-		if (pkt_len > devc->recv_count) {
+		if (pkt_len > remain) {
 			/* Need more RX data to complete the frame. */
-			return SR_OK;
+			need_data = TRUE;
+			break;
 		}
 
 		/* Process the packet which completed reception. */
@@ -2775,12 +2902,16 @@ static int process_buffer(struct sr_dev_inst *sdi)
 			}
 			break;
 		}
-		remain = devc->recv_count - pkt_len;
-		if (remain)
-			memmove(&pkt[0], &pkt[pkt_len], remain);
-		devc->recv_count -= pkt_len;
+		done += pkt_len;
 	} while (1);
-	if (devc->recv_count < 2 * sizeof(uint16_t)) {
+	if (done) {
+		remain = devc->recv_count - done;
+		if (remain)
+			memmove(&devc->recv_buff[0], &devc->recv_buff[done], remain);
+		devc->recv_count = remain;
+	}
+	pkt = &devc->recv_buff[0];
+	if (need_data || devc->recv_count < 2 * sizeof(uint16_t)) {
 		/* Assume incomplete reception. Re-check later. */
 		return SR_OK;
 	}
@@ -39,12 +39,14 @@
  * can span up to 256 items which each occupy 9 bytes, plus some header
  * before the items array. Be generous and prepare to receive several
  * frames in a row, e.g. when synchronizing to the packet stream at the
- * start of a session or after communication failure.
+ * start of a session or after communication failure. Downloads of
+ * recordings keep several chunk requests outstanding, so that several
+ * chunks of record data can arrive in a row, too.
  *
  * The largest frame we expect to transmit is a "start record" command.
  * Which contains 18 bytes of payload (plus 6 bytes of frame envelope).
  */
-#define RECV_BUFF_SIZE 4096
+#define RECV_BUFF_SIZE 8192
 #define SEND_BUFF_SIZE 32
 #define SEND_TO_MS 100
 
@@ -67,6 +69,12 @@
 #define MAX_REC_COUNT 20
 #define MAX_REC_NAMELEN 12
 
+/*
+ * Number of "get recording samples" requests which may be outstanding
+ * during downloads of recordings. The meter answers them in order.
+ */
+#define REC_REQ_DEPTH 4
+
 #define MAX_RANGE_INDEX 8
 
 /* Literals look weird as numbers. LE format makes them readable on the wire. */
@@ -356,6 +364,12 @@ struct ut181a_info {
 		size_t samples_total;
 		size_t samples_curr;
 		uint8_t samples_chunk;
+		/* Outstanding requests, their sample offsets, oldest first. */
+		size_t req_offs[REC_REQ_DEPTH];
+		size_t req_count;
+		size_t req_depth;
+		size_t samples_req;
+		size_t chunk_size;
 	} rec_data;
 	struct {
 		enum ut181_cmd_code code;
@@ -421,6 +435,7 @@ SR_PRIV int ut181a_send_cmd_get_saved_value(struct sr_serial_dev_inst *serial, s
 SR_PRIV int ut181a_send_cmd_get_recs_count(struct sr_serial_dev_inst *serial);
 SR_PRIV int ut181a_send_cmd_get_rec_info(struct sr_serial_dev_inst *serial, size_t idx);
 SR_PRIV int ut181a_send_cmd_get_rec_samples(struct sr_serial_dev_inst *serial, size_t idx, size_t off);
+SR_PRIV int ut181a_send_rec_requests(const struct sr_dev_inst *sdi);
 
 SR_PRIV int ut181a_configure_waitfor(struct dev_context *devc,
 	gboolean want_code, enum ut181_cmd_code want_data,
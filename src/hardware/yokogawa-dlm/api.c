@@ -125,6 +125,9 @@ static void clear_helper(struct dev_context *devc)
 	dlm_scope_state_destroy(devc->model_state);
 	g_free(devc->analog_groups);
 	g_free(devc->digital_groups);
+	if (devc->block_data)
+		g_array_free(devc->block_data, TRUE);
+	g_free(devc->float_buffer);
 }
 
 static int dev_clear(const struct sr_dev_driver *di)
@@ -535,6 +538,10 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	devc->num_frames = 0;
 	g_slist_free(devc->enabled_channels);
 	devc->enabled_channels = NULL;
+	if (devc->block_data) {
+		g_array_free(devc->block_data, TRUE);
+		devc->block_data = NULL;
+	}
 
 	sr_scpi_source_remove(sdi->session, sdi->conn);
 
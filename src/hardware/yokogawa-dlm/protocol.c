@@ -863,32 +863,38 @@ SR_PRIV int dlm_channel_data_request(const struct sr_dev_inst *sdi)
 }
 
 /**
- * Reads and removes the block data header from a given data input.
+ * Reads the block data header from a given data input, and skips it.
  * Format is #ndddd... with n being the number of decimal digits d.
  * The string dddd... contains the decimal-encoded length of the data.
  * Example: #9000000013 would yield a length of 13 bytes.
  *
  * @param data The input data.
+ * @param offset The read offset into the data, advanced past the header.
  * @param len The determined input data length.
  */
-static int dlm_block_data_header_process(GArray *data, int *len)
+static int dlm_block_data_header_process(GArray *data, size_t *offset,
+		int *len)
 {
+	const gchar *p;
 	int i, n;
 	gchar s[20];
 
-	if (g_array_index(data, gchar, 0) != '#')
+	p = (const gchar *)data->data + *offset;
+	if (data->len - *offset < 2 || p[0] != '#')
 		return SR_ERR;
 
-	n = (uint8_t)(g_array_index(data, gchar, 1) - '0');
+	n = (uint8_t)(p[1] - '0');
+	if (n >= (int)sizeof(s) || data->len - *offset < 2 + (size_t)n)
+		return SR_ERR;
 
 	for (i = 0; i < n; i++)
-		s[i] = g_array_index(data, gchar, 2 + i);
+		s[i] = p[2 + i];
 	s[i] = 0;
 
 	if (sr_atoi(s, len) != SR_OK)
 		return SR_ERR;
 
-	g_array_remove_range(data, 0, 2 + n);
+	*offset += 2 + n;
 
 	return SR_OK;
 }
@@ -897,18 +903,20 @@ static int dlm_block_data_header_process(GArray *data, int *len)
  * Turns raw sample data into voltages and sends them off to the session bus.
  *
  * @param data The raw sample data.
+ * @param offset The read offset into the data, advanced past the samples.
  * @ch_state Pointer to the state of the channel whose data we're processing.
  * @sdi The device instance.
  *
  * @return SR_ERR when data is trucated, SR_OK otherwise.
  */
-static int dlm_analog_samples_send(GArray *data,
+static int dlm_analog_samples_send(GArray *data, size_t *offset,
 		struct analog_channel_state *ch_state,
 		struct sr_dev_inst *sdi)
 {
 	uint32_t i, samples;
-	float voltage, range, offset;
-	GArray *float_data;
+	float scale, range, offset_volts;
+	const int8_t *raw;
+	float *float_data;
 	struct dev_context *devc;
 	struct scope_state *model_state;
 	struct sr_channel *ch;
@@ -923,31 +931,37 @@ static int dlm_analog_samples_send(GArray *data,
 	samples = model_state->samples_per_frame;
 	ch = devc->current_channel->data;
 
-	if (data->len < samples * sizeof(uint8_t)) {
+	if (data->len - *offset < samples * sizeof(uint8_t)) {
 		sr_err("Truncated waveform data packet received.");
 		return SR_ERR;
 	}
 
 	range = ch_state->waveform_range;
-	offset = ch_state->waveform_offset;
+	offset_volts = ch_state->waveform_offset;
+
+	/* The buffer only grows, frames usually keep their size. */
+	if (devc->float_buffer_size < samples) {
+		g_free(devc->float_buffer);
+		devc->float_buffer = g_malloc(samples * sizeof(float));
+		devc->float_buffer_size = samples;
+	}
+	float_data = devc->float_buffer;
 
 	/*
 	 * Convert byte sample to voltage according to
 	 * page 269 of the Communication Interface User's Manual.
+	 * A plain multiply-add loop, which compilers vectorize.
 	 */
-	float_data = g_array_new(FALSE, FALSE, sizeof(float));
-	for (i = 0; i < samples; i++) {
-		voltage = (float)g_array_index(data, int8_t, i);
-		voltage = (range * voltage /
-				DLM_DIVISION_FOR_BYTE_FORMAT) + offset;
-		g_array_append_val(float_data, voltage);
-	}
+	raw = (const int8_t *)(data->data + *offset);
+	scale = range / DLM_DIVISION_FOR_BYTE_FORMAT;
+	for (i = 0; i < samples; i++)
+		float_data[i] = scale * raw[i] + offset_volts;
 
 	/* TODO: Use proper 'digits' value for this device (and its modes). */
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
 	analog.meaning->channels = g_slist_append(NULL, ch);
-	analog.num_samples = float_data->len;
-	analog.data = (float*)float_data->data;
+	analog.num_samples = samples;
+	analog.data = float_data;
 	analog.meaning->mq = SR_MQ_VOLTAGE;
 	analog.meaning->unit = SR_UNIT_VOLT;
 	analog.meaning->mqflags = 0;
@@ -956,8 +970,7 @@ static int dlm_analog_samples_send(GArray *data,
 	sr_session_send(sdi, &packet);
 	g_slist_free(analog.meaning->channels);
 
-	g_array_free(float_data, TRUE);
-	g_array_remove_range(data, 0, samples * sizeof(uint8_t));
+	*offset += samples * sizeof(uint8_t);
 
 	return SR_OK;
 }
@@ -966,12 +979,12 @@ static int dlm_analog_samples_send(GArray *data,
  * Sends logic sample data off to the session bus.
  *
  * @param data The raw sample data.
- * @ch_state Pointer to the state of the channel whose data we're processing.
+ * @param offset The read offset into the data, advanced past the samples.
  * @sdi The device instance.
  *
  * @return SR_ERR when data is trucated, SR_OK otherwise.
  */
-static int dlm_digital_samples_send(GArray *data,
+static int dlm_digital_samples_send(GArray *data, size_t *offset,
 		struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
@@ -984,19 +997,19 @@ static int dlm_digital_samples_send(GArray *data,
 	model_state = devc->model_state;
 	samples = model_state->samples_per_frame;
 
-	if (data->len < samples * sizeof(uint8_t)) {
+	if (data->len - *offset < samples * sizeof(uint8_t)) {
 		sr_err("Truncated waveform data packet received.");
 		return SR_ERR;
 	}
 
 	logic.length = samples;
 	logic.unitsize = 1;
-	logic.data = data->data;
+	logic.data = data->data + *offset;
 	packet.type = SR_DF_LOGIC;
 	packet.payload = &logic;
 	sr_session_send(sdi, &packet);
 
-	g_array_remove_range(data, 0, samples * sizeof(uint8_t));
+	*offset += samples * sizeof(uint8_t);
 
 	return SR_OK;
 }
@@ -1019,7 +1032,8 @@ SR_PRIV int dlm_data_receive(int fd, int revents, void *cb_data)
 	struct dev_context *devc;
 	struct sr_channel *ch;
 	int chunk_len, num_bytes;
-	static GArray *data = NULL;
+	size_t offset;
+	GArray *data;
 
 	(void)fd;
 	(void)revents;
@@ -1038,23 +1052,27 @@ SR_PRIV int dlm_data_receive(int fd, int revents, void *cb_data)
 		return TRUE;
 
 	/* Check if a new query response is coming our way. */
-	if (!data) {
+	if (!devc->block_data) {
 		if (sr_scpi_read_begin(sdi->conn) == SR_OK)
 			/* The 16 here accounts for the header and EOL. */
-			data = g_array_sized_new(FALSE, FALSE, sizeof(uint8_t),
-					16 + model_state->samples_per_frame);
+			devc->block_data = g_array_sized_new(FALSE, FALSE,
+				sizeof(uint8_t),
+				16 + model_state->samples_per_frame);
 		else
 			return TRUE;
 	}
+	data = devc->block_data;
 
-	/* Store incoming data. */
-	chunk_len = sr_scpi_read_data(sdi->conn, devc->receive_buffer,
+	/* Store incoming data, read directly into the response's buffer. */
+	offset = data->len;
+	g_array_set_size(data, offset + RECEIVE_BUFFER_SIZE);
+	chunk_len = sr_scpi_read_data(sdi->conn, data->data + offset,
 			RECEIVE_BUFFER_SIZE);
 	if (chunk_len < 0) {
 		sr_err("Error while reading data: %d", chunk_len);
 		goto fail;
 	}
-	g_array_append_vals(data, devc->receive_buffer, chunk_len);
+	g_array_set_size(data, offset + chunk_len);
 
 	/* Read the entire query response before processing. */
 	if (!sr_scpi_read_complete(sdi->conn))
@@ -1067,7 +1085,8 @@ SR_PRIV int dlm_data_receive(int fd, int revents, void *cb_data)
 	if (devc->current_channel == devc->enabled_channels)
 		std_session_send_df_frame_begin(sdi);
 
-	if (dlm_block_data_header_process(data, &num_bytes) != SR_OK) {
+	offset = 0;
+	if (dlm_block_data_header_process(data, &offset, &num_bytes) != SR_OK) {
 		sr_err("Encountered malformed block data header.");
 		goto fail;
 	}
@@ -1079,6 +1098,7 @@ SR_PRIV int dlm_data_receive(int fd, int revents, void *cb_data)
 		/* Don't care about return value here. */
 		dlm_acquisition_stop(sdi->conn);
 		g_array_free(data, TRUE);
+		devc->block_data = NULL;
 		dlm_channel_data_request(sdi);
 		return TRUE;
 	}
@@ -1086,13 +1106,13 @@ SR_PRIV int dlm_data_receive(int fd, int revents, void *cb_data)
 	ch = devc->current_channel->data;
 	switch (ch->type) {
 	case SR_CHANNEL_ANALOG:
-		if (dlm_analog_samples_send(data,
+		if (dlm_analog_samples_send(data, &offset,
 				&model_state->analog_states[ch->index],
 				sdi) != SR_OK)
 			goto fail;
 		break;
 	case SR_CHANNEL_LOGIC:
-		if (dlm_digital_samples_send(data, sdi) != SR_OK)
+		if (dlm_digital_samples_send(data, &offset, sdi) != SR_OK)
 			goto fail;
 		break;
 	default:
@@ -1101,7 +1121,7 @@ SR_PRIV int dlm_data_receive(int fd, int revents, void *cb_data)
 	}
 
 	g_array_free(data, TRUE);
-	data = NULL;
+	devc->block_data = NULL;
 
 	/*
 	 * Signal the end of this frame if this was the last enabled channel
@@ -1128,9 +1148,9 @@ SR_PRIV int dlm_data_receive(int fd, int revents, void *cb_data)
 	return TRUE;
 
 fail:
-	if (data) {
-		g_array_free(data, TRUE);
-		data = NULL;
+	if (devc->block_data) {
+		g_array_free(devc->block_data, TRUE);
+		devc->block_data = NULL;
 	}
 
 	return FALSE;
@@ -109,7 +109,11 @@ struct dev_context {
 
 	uint64_t frame_limit;
 
-	char receive_buffer[RECEIVE_BUFFER_SIZE];
+	/* The query response which is being received. */
+	GArray *block_data;
+	/* Converted analog samples, reused across frames. */
+	float *float_buffer;
+	size_t float_buffer_size;
 	gboolean data_pending;
 };
 
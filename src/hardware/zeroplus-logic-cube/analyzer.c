@@ -426,6 +426,20 @@ SR_PRIV int analyzer_read_data(libusb_device_handle *devh, void *buffer,
 	return gl_read_bulk(devh, buffer, size);
 }
 
+SR_PRIV int analyzer_request_data(libusb_device_handle *devh,
+		unsigned int size)
+{
+	return gl_request_bulk(devh, size);
+}
+
+SR_PRIV void analyzer_fill_data_transfer(struct libusb_transfer *transfer,
+		libusb_device_handle *devh, void *buffer, unsigned int size,
+		libusb_transfer_cb_fn callback, void *user_data)
+{
+	gl_fill_bulk_transfer(transfer, devh, buffer, size,
+			      callback, user_data);
+}
+
 SR_PRIV void analyzer_read_stop(libusb_device_handle *devh)
 {
 	analyzer_write_status(devh, 3, STATUS_FLAG_20);
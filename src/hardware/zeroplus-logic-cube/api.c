@@ -23,7 +23,6 @@
 #define USB_INTERFACE			0
 #define USB_CONFIGURATION		1
 #define NUM_TRIGGER_STAGES		4
-#define PACKET_SIZE			2048	/* ?? */
 
 //#define ZP_EXPERIMENTAL
 
@@ -179,7 +178,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	devices = NULL;
 
 	/* Find all ZEROPLUS analyzers and add them to device list. */
-	libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist); /* TODO: Errors. */
+	usb_get_device_list(drvc->sr_ctx, &devlist); /* TODO: Errors. */
 
 	for (i = 0; devlist[i]; i++) {
 		libusb_get_device_descriptor(devlist[i], &des);
@@ -199,7 +198,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 
 		libusb_close(hdl);
 
-		if (usb_get_port_path(devlist[i], connection_id, sizeof(connection_id)) < 0)
+		if (usb_get_port_path(drvc->sr_ctx, devlist[i], connection_id, sizeof(connection_id)) < 0)
 			continue;
 
 		prof = NULL;
@@ -434,17 +433,11 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 {
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
-	unsigned int samples_read;
-	int res;
-	unsigned int packet_num, n;
-	unsigned char *buf;
+	unsigned int n;
 	unsigned int status;
 	unsigned int stop_address;
 	unsigned int now_address;
 	unsigned int trigger_address;
-	unsigned int trigger_offset;
 	unsigned int triggerbar;
 	unsigned int ramsize_trigger;
 	unsigned int memory_size;
@@ -497,8 +490,6 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 		return SR_OK;
 	}
 
-	buf = g_malloc(PACKET_SIZE);
-
 	/* Check if the trigger is in the samples we are throwing away */
 	trigger_now = now_address == trigger_address ||
 		((now_address + 1) % memory_size) == trigger_address;
@@ -510,8 +501,6 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	if (!now_address)
 		status &= ~STATUS_READY;
 
-	analyzer_read_start(usb->devhdl);
-
 	/* Calculate how much data to discard */
 	discard = 0;
 	if (status & STATUS_READY) {
@@ -536,82 +525,27 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	/* Calculate how far in the trigger is */
 	if (trigger_now)
-		trigger_offset = 0;
+		devc->trigger_offset = 0;
 	else
-		trigger_offset = (trigger_address - now_address) % memory_size;
+		devc->trigger_offset =
+			(trigger_address - now_address) % memory_size;
 
 	/* Recalculate the number of samples available */
-	valid_samples = (stop_address - now_address) % memory_size;
-
-	/* Send the incoming transfer to the session bus. */
-	samples_read = 0;
-	for (packet_num = 0; packet_num < n / PACKET_SIZE; packet_num++) {
-		unsigned int len;
-		unsigned int buf_offset;
-
-		res = analyzer_read_data(usb->devhdl, buf, PACKET_SIZE);
-		if (res != PACKET_SIZE)
-			sr_warn("Tried to read %d bytes, actually read %d.",
-				PACKET_SIZE, res);
-
-		if (discard >= PACKET_SIZE / 4) {
-			discard -= PACKET_SIZE / 4;
-			continue;
-		}
-
-		len = PACKET_SIZE - discard * 4;
-		buf_offset = discard * 4;
-		discard = 0;
+	devc->valid_samples = (stop_address - now_address) % memory_size;
+	devc->discard = discard;
 
-		/* Check if we've read all the samples */
-		if (samples_read + len / 4 >= valid_samples)
-			len = (valid_samples - samples_read) * 4;
-		if (!len)
-			break;
-
-		if (samples_read < trigger_offset &&
-		    samples_read + len / 4 > trigger_offset) {
-			/* Send out samples remaining before trigger */
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = (trigger_offset - samples_read) * 4;
-			logic.unitsize = 4;
-			logic.data = buf + buf_offset;
-			sr_session_send(sdi, &packet);
-			len -= logic.length;
-			samples_read += logic.length / 4;
-			buf_offset += logic.length;
-		}
-
-		if (samples_read == trigger_offset)
-			std_session_send_df_trigger(sdi);
-
-		/* Send out data (or data after trigger) */
-		packet.type = SR_DF_LOGIC;
-		packet.payload = &logic;
-		logic.length = len;
-		logic.unitsize = 4;
-		logic.data = buf + buf_offset;
-		sr_session_send(sdi, &packet);
-		samples_read += len / 4;
-	}
-	analyzer_read_stop(usb->devhdl);
-	g_free(buf);
-
-	std_session_send_df_end(sdi);
-
-	return SR_OK;
+	/* Read back the sample memory, and send it to the session bus. */
+	return zp_start_readout(sdi, n);
 }
 
 static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 {
 	struct sr_usb_dev_inst *usb;
 
-	std_session_send_df_end(sdi);
+	zp_abort_readout(sdi);
 
 	usb = sdi->conn;
 	analyzer_reset(usb->devhdl);
-	/* TODO: Need to cancel and free any queued up transfers. */
 
 	return SR_OK;
 }
@@ -124,3 +124,234 @@ SR_PRIV void set_triggerbar(struct dev_context *devc)
 	sr_dbg("ramsize_triggerbar_address = %d(0x%x)",
 	       ramsize_trigger, ramsize_trigger);
 }
+
+static void process_data(const struct sr_dev_inst *sdi,
+	unsigned char *buf, unsigned int length)
+{
+	struct dev_context *devc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	unsigned int count, pre_trigger;
+
+	devc = sdi->priv;
+
+	count = length / 4;
+	if (devc->discard >= count) {
+		devc->discard -= count;
+		return;
+	}
+	buf += devc->discard * 4;
+	count -= devc->discard;
+	devc->discard = 0;
+
+	/* Check if we've read all the samples. */
+	if (devc->samples_read + count >= devc->valid_samples) {
+		count = devc->valid_samples - devc->samples_read;
+		devc->read_done = TRUE;
+	}
+	if (!count)
+		return;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = 4;
+
+	if (devc->samples_read < devc->trigger_offset &&
+	    devc->samples_read + count > devc->trigger_offset) {
+		/* Send out samples remaining before trigger. */
+		pre_trigger = devc->trigger_offset - devc->samples_read;
+		logic.length = pre_trigger * 4;
+		logic.data = buf;
+		sr_session_send(sdi, &packet);
+		buf += logic.length;
+		count -= pre_trigger;
+		devc->samples_read += pre_trigger;
+	}
+
+	if (devc->samples_read == devc->trigger_offset)
+		std_session_send_df_trigger(sdi);
+
+	/* Send out data (or data after trigger). */
+	logic.length = count * 4;
+	logic.data = buf;
+	sr_session_send(sdi, &packet);
+	devc->samples_read += count;
+}
+
+static void finish_readout(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct drv_context *drvc;
+	struct sr_usb_dev_inst *usb;
+	unsigned int i;
+
+	devc = sdi->priv;
+	drvc = sdi->driver->context;
+	usb = sdi->conn;
+
+	analyzer_read_stop(usb->devhdl);
+
+	for (i = 0; i < NUM_READ_TRANSFERS; i++) {
+		libusb_free_transfer(devc->transfers[i]);
+		devc->transfers[i] = NULL;
+	}
+	g_free(devc->read_buf);
+	devc->read_buf = NULL;
+
+	usb_source_remove(sdi->session, drvc->sr_ctx);
+	std_session_send_df_end(sdi);
+}
+
+static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer);
+
+/*
+ * Announce the next window of sample memory to the device, and queue
+ * all of its transfers at once, so that the device can keep sending
+ * while earlier buffers are being passed on to the session.
+ */
+static int submit_window(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	struct sr_usb_dev_inst *usb;
+	unsigned int window_size, size, i;
+	int ret;
+
+	devc = sdi->priv;
+	usb = sdi->conn;
+
+	window_size = MIN(devc->read_left,
+		NUM_READ_TRANSFERS * READ_TRANSFER_SIZE);
+	if (analyzer_request_data(usb->devhdl, window_size) < 0)
+		return SR_ERR_IO;
+	devc->read_left -= window_size;
+
+	devc->window_transfers = 0;
+	for (i = 0; i < NUM_READ_TRANSFERS && window_size; i++) {
+		size = MIN(window_size, READ_TRANSFER_SIZE);
+		analyzer_fill_data_transfer(devc->transfers[i], usb->devhdl,
+			devc->read_buf + i * READ_TRANSFER_SIZE, size,
+			receive_transfer, (void *)sdi);
+		ret = libusb_submit_transfer(devc->transfers[i]);
+		if (ret != 0) {
+			sr_err("Failed to submit transfer: %s.",
+			       libusb_error_name(ret));
+			return SR_ERR_IO;
+		}
+		devc->submitted_transfers++;
+		devc->window_transfers++;
+		window_size -= size;
+	}
+
+	return SR_OK;
+}
+
+static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
+{
+	const struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	devc->submitted_transfers--;
+	devc->window_transfers--;
+
+	if (!devc->read_aborted && !devc->read_done) {
+		if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+			sr_err("Data transfer failed: %d.", transfer->status);
+			zp_abort_readout(sdi);
+		} else {
+			if (transfer->actual_length != transfer->length)
+				sr_warn("Tried to read %d bytes, actually read %d.",
+					transfer->length, transfer->actual_length);
+			process_data(sdi, transfer->buffer,
+				transfer->actual_length);
+		}
+	}
+
+	if (!devc->read_aborted && !devc->read_done &&
+	    !devc->window_transfers) {
+		if (!devc->read_left)
+			devc->read_done = TRUE;
+		else if (submit_window(sdi) != SR_OK)
+			zp_abort_readout(sdi);
+	}
+
+	if (!devc->submitted_transfers)
+		finish_readout(sdi);
+}
+
+static int receive_data(int fd, int revents, void *cb_data)
+{
+	struct drv_context *drvc;
+	struct timeval tv;
+
+	(void)fd;
+	(void)revents;
+
+	drvc = cb_data;
+
+	tv.tv_sec = tv.tv_usec = 0;
+	libusb_handle_events_timeout(drvc->sr_ctx->libusb_ctx, &tv);
+
+	return TRUE;
+}
+
+/*
+ * Read back read_size bytes of sample memory with asynchronous
+ * transfers, driven from the session's event loop. The discard,
+ * valid_samples and trigger_offset fields must have been set up by
+ * the caller. The end of the acquisition is sent once all transfers
+ * have come back.
+ */
+SR_PRIV int zp_start_readout(const struct sr_dev_inst *sdi,
+	unsigned int read_size)
+{
+	struct dev_context *devc;
+	struct drv_context *drvc;
+	struct sr_usb_dev_inst *usb;
+	unsigned int i;
+
+	devc = sdi->priv;
+	drvc = sdi->driver->context;
+	usb = sdi->conn;
+
+	devc->read_buf = g_malloc(NUM_READ_TRANSFERS * READ_TRANSFER_SIZE);
+	for (i = 0; i < NUM_READ_TRANSFERS; i++)
+		devc->transfers[i] = libusb_alloc_transfer(0);
+	devc->submitted_transfers = 0;
+	devc->read_left = read_size;
+	devc->samples_read = 0;
+	devc->read_done = FALSE;
+	devc->read_aborted = FALSE;
+
+	usb_source_add(sdi->session, drvc->sr_ctx, 100, receive_data, drvc);
+
+	analyzer_read_start(usb->devhdl);
+
+	if (submit_window(sdi) != SR_OK)
+		zp_abort_readout(sdi);
+
+	/* Nothing in flight, so no callback is going to wrap up. */
+	if (!devc->submitted_transfers)
+		finish_readout(sdi);
+
+	return SR_OK;
+}
+
+SR_PRIV void zp_abort_readout(const struct sr_dev_inst *sdi)
+{
+	struct dev_context *devc;
+	unsigned int i;
+
+	devc = sdi->priv;
+
+	if (!devc->read_buf || devc->read_aborted)
+		return;
+	devc->read_aborted = TRUE;
+
+	for (i = 0; i < NUM_READ_TRANSFERS; i++) {
+		if (devc->transfers[i])
+			libusb_cancel_transfer(devc->transfers[i]);
+	}
+}
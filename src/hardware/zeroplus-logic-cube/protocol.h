@@ -30,6 +30,9 @@
 
 #define LOG_PREFIX "zeroplus-logic-cube"
 
+#define NUM_READ_TRANSFERS	8
+#define READ_TRANSFER_SIZE	(16 * 1024)
+
 struct dev_context {
 	uint64_t cur_samplerate;
 	uint64_t max_samplerate;
@@ -45,6 +48,19 @@ struct dev_context {
 	uint64_t capture_ratio;
 	double cur_threshold;
 	const struct zp_model *prof;
+
+	/* Sample memory readout. */
+	struct libusb_transfer *transfers[NUM_READ_TRANSFERS];
+	unsigned char *read_buf;
+	unsigned int submitted_transfers;
+	unsigned int window_transfers;
+	unsigned int read_left;
+	unsigned int discard;
+	unsigned int valid_samples;
+	unsigned int samples_read;
+	unsigned int trigger_offset;
+	gboolean read_done;
+	gboolean read_aborted;
 };
 
 SR_PRIV unsigned int get_memory_size(int type);
@@ -52,5 +68,8 @@ SR_PRIV int zp_set_samplerate(struct dev_context *devc, uint64_t samplerate);
 SR_PRIV int set_limit_samples(struct dev_context *devc, uint64_t samples);
 SR_PRIV int set_voltage_threshold(struct dev_context *devc, double thresh);
 SR_PRIV void set_triggerbar(struct dev_context *devc);
+SR_PRIV int zp_start_readout(const struct sr_dev_inst *sdi,
+	unsigned int read_size);
+SR_PRIV void zp_abort_readout(const struct sr_dev_inst *sdi);
 
 #endif
@@ -74,6 +74,8 @@ static struct sr_key_info sr_key_info_config[] = {
 		"Modbus slave address", NULL},
 	{SR_CONF_FORCE_DETECT, SR_T_STRING, "force_detect",
 		"Forced detection", NULL},
+	{SR_CONF_NUM_DEVICES, SR_T_UINT64, "devices",
+		"Number of devices", NULL},
 
 	/* Device (or channel group) configuration */
 	{SR_CONF_SAMPLERATE, SR_T_UINT64, "samplerate",
@@ -212,6 +214,8 @@ static struct sr_key_info sr_key_info_config[] = {
 		"Power Target", NULL},
 	{SR_CONF_RESISTANCE_TARGET, SR_T_FLOAT, "resistance_target",
 		"Resistance Target", NULL},
+	{SR_CONF_TRIGGER_HYSTERESIS, SR_T_FLOAT, "triggerhysteresis",
+		"Trigger hysteresis", NULL},
 
 	/* Special stuff */
 	{SR_CONF_SESSIONFILE, SR_T_STRING, "sessionfile",
@@ -228,6 +232,30 @@ static struct sr_key_info sr_key_info_config[] = {
 		"Probe factor", NULL},
 	{SR_CONF_ADC_POWERLINE_CYCLES, SR_T_FLOAT, "nplc",
 		"Number of ADC powerline cycles", NULL},
+	{SR_CONF_USB_TRANSFER_MSEC, SR_T_UINT64_RANGE, "usb_transfer_msec",
+		"USB transfer duration", NULL},
+	{SR_CONF_USB_BUFFER_MSEC, SR_T_UINT64_RANGE, "usb_buffer_msec",
+		"USB buffering duration", NULL},
+	{SR_CONF_UNTHROTTLED, SR_T_BOOL, "unthrottled",
+		"Unthrottled", NULL},
+	{SR_CONF_LATENCY_PROBE_MSEC, SR_T_UINT64, "latency_probe_msec",
+		"Latency probe interval", NULL},
+	{SR_CONF_LATENCY_PROBE, SR_T_UINT64, "latency_probe",
+		"Latency probe", NULL},
+	{SR_CONF_CAPTURE_ANALOG_FILTER, SR_T_STRING, "capture_analog_filter",
+		"Capture analog filter", NULL},
+	{SR_CONF_REPLAY_CHUNK_SIZE, SR_T_UINT64, "replay_chunk_size",
+		"Replay chunk size", NULL},
+	{SR_CONF_REPLAY_READ_AHEAD, SR_T_UINT64, "replay_read_ahead",
+		"Replay read-ahead", NULL},
+	{SR_CONF_REPLAY_INTERLEAVED, SR_T_BOOL, "replay_interleaved",
+		"Interleaved replay", NULL},
+	{SR_CONF_REPLAY_PREFETCH, SR_T_UINT64, "replay_prefetch",
+		"Replay prefetch", NULL},
+	{SR_CONF_SAMPLES_LOST, SR_T_UINT64_RANGE, "samples_lost",
+		"Samples lost", NULL},
+	{SR_CONF_REPLAY_FRAME, SR_T_UINT64, "replay_frame",
+		"Replay start frame", NULL},
 
 	/* Acquisition modes, sample limiting */
 	{SR_CONF_LIMIT_MSEC, SR_T_UINT64, "limit_time",
@@ -378,6 +406,20 @@ SR_PRIV int sr_variant_type_check(uint32_t key, GVariant *value)
 	return SR_OK;
 }
 
+/* Check whether a driver is in the context's (current) driver list. */
+static gboolean driver_in_list(const struct sr_context *ctx,
+		const struct sr_dev_driver *driver)
+{
+	int i;
+
+	for (i = 0; ctx->driver_list[i]; i++) {
+		if (ctx->driver_list[i] == driver)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 /**
  * Return the list of supported hardware drivers.
  *
@@ -387,6 +429,9 @@ SR_PRIV int sr_variant_type_check(uint32_t key, GVariant *value)
  * @retval Other Pointer to the NULL-terminated list of hardware drivers.
  *               The user should NOT g_free() this list, sr_exit() will do that.
  *
+ * The list gets built when it is first asked for, and only holds the drivers
+ * selected with sr_driver_list_select(), if any were.
+ *
  * @since 0.4.0
  */
 SR_API struct sr_dev_driver **sr_driver_list(const struct sr_context *ctx)
@@ -394,15 +439,100 @@ SR_API struct sr_dev_driver **sr_driver_list(const struct sr_context *ctx)
 	if (!ctx)
 		return NULL;
 
+	/* Building the list on first use doesn't change the context's state. */
+	if (!ctx->driver_list)
+		sr_drivers_init((struct sr_context *)ctx);
+
 	return ctx->driver_list;
 }
 
+/**
+ * Restrict the hardware drivers of a context to a set of drivers.
+ *
+ * Later calls to sr_driver_list() only return the drivers with the given
+ * names. Tools which need few drivers, or none, don't pay for the others.
+ * Drivers dropped from the list are cleaned up if they were initialized,
+ * which invalidates their device instances.
+ *
+ * @param[in] ctx Pointer to a libsigrok context struct. Must not be NULL.
+ * @param[in] names NULL-terminated array of driver names, or NULL to use
+ *                  all drivers again. Names of unknown drivers are ignored.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_driver_list_select(struct sr_context *ctx,
+		const char *const *names)
+{
+	struct sr_dev_driver **drivers;
+	gchar **old_names;
+	int i;
+
+	if (!ctx)
+		return SR_ERR_ARG;
+
+	old_names = ctx->driver_names;
+	ctx->driver_names = g_strdupv((gchar **)names);
+	g_strfreev(old_names);
+
+	if (!(drivers = ctx->driver_list))
+		return SR_OK;
+	ctx->driver_list = NULL;
+	sr_drivers_init(ctx);
+
+	/* Clean up the initialized drivers which are not in the new list. */
+	for (i = 0; drivers[i]; i++) {
+		if (drivers[i]->context && !driver_in_list(ctx, drivers[i])) {
+			drivers[i]->cleanup(drivers[i]);
+			drivers[i]->context = NULL;
+		}
+	}
+	g_free(drivers);
+
+	return SR_OK;
+}
+
+/**
+ * Find a hardware driver by name, and initialize it on first use.
+ *
+ * @param[in] ctx Pointer to a libsigrok context struct. Must not be NULL.
+ * @param[in] name The name of the driver. Must not be NULL.
+ *
+ * @return The initialized driver, or NULL if there is no driver with that
+ *         name in the context's list, or it failed to initialize.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_dev_driver *sr_driver_get(struct sr_context *ctx,
+		const char *name)
+{
+	struct sr_dev_driver **drivers;
+	int i;
+
+	if (!ctx || !name)
+		return NULL;
+
+	drivers = sr_driver_list(ctx);
+	for (i = 0; drivers[i]; i++) {
+		if (strcmp(drivers[i]->name, name))
+			continue;
+		if (sr_driver_init(ctx, drivers[i]) != SR_OK)
+			return NULL;
+		return drivers[i];
+	}
+
+	return NULL;
+}
+
 /**
  * Initialize a hardware driver.
  *
  * This usually involves memory allocations and variable initializations
  * within the driver, but _not_ scanning for attached devices.
- * The API call sr_driver_scan() is used for that.
+ * The API call sr_driver_scan() is used for that. Initializing a driver
+ * which is already initialized does nothing.
  *
  * @param ctx A libsigrok context object allocated by a previous call to
  *            sr_init(). Must not be NULL.
@@ -430,6 +560,9 @@ SR_API int sr_driver_init(struct sr_context *ctx, struct sr_dev_driver *driver)
 		return SR_ERR_ARG;
 	}
 
+	if (driver->context)
+		return SR_OK;
+
 	/* No log message here, too verbose and not very useful. */
 
 	if ((ret = driver->init(driver, ctx)) < 0)
@@ -570,6 +703,161 @@ SR_API GSList *sr_driver_scan(struct sr_dev_driver *driver, GSList *options)
 	return l;
 }
 
+/** @cond PRIVATE */
+/* Most groups of drivers which sr_driver_scan_all() scans at a time. */
+#define SCAN_THREADS 8
+/** @endcond */
+
+/* Transports of drivers which must not scan at the same time. */
+enum scan_group {
+	SCAN_GROUP_NONE,
+	SCAN_GROUP_CONN,
+	SCAN_GROUP_USB,
+};
+
+struct scan_all_ctx {
+	GSList *options;
+	sr_driver_scan_callback cb;
+	void *cb_data;
+	GMutex cb_mutex;
+};
+
+/*
+ * Find the group of a driver. All drivers target the same port when a
+ * conn option was given. Otherwise, the drivers with a conn option but
+ * no serialcomm are taken to be USB drivers, which can share VID:PID
+ * pairs and upload firmware to the devices they probe. Serial and SCPI
+ * drivers don't group, their automatic probes lock the ports (see
+ * std_probe_ports()).
+ */
+static enum scan_group scan_group_get(const struct sr_dev_driver *driver,
+		gboolean have_conn)
+{
+	GArray *opts;
+	gboolean conn, serialcomm;
+	guint i;
+
+	if (have_conn)
+		return SCAN_GROUP_CONN;
+
+	conn = serialcomm = FALSE;
+	if (!(opts = sr_driver_scan_options_list(driver)))
+		return SCAN_GROUP_NONE;
+	for (i = 0; i < opts->len; i++) {
+		if (g_array_index(opts, uint32_t, i) == SR_CONF_CONN)
+			conn = TRUE;
+		else if (g_array_index(opts, uint32_t, i) == SR_CONF_SERIALCOMM)
+			serialcomm = TRUE;
+	}
+	g_array_free(opts, TRUE);
+
+	return (conn && !serialcomm) ? SCAN_GROUP_USB : SCAN_GROUP_NONE;
+}
+
+/* Scan the drivers of a group one after the other. */
+static void scan_group_run(gpointer data, gpointer user_data)
+{
+	struct scan_all_ctx *ctx;
+	struct sr_dev_driver *driver;
+	GSList *drivers, *l, *devices;
+
+	drivers = data;
+	ctx = user_data;
+	for (l = drivers; l; l = l->next) {
+		driver = l->data;
+		devices = sr_driver_scan(driver, ctx->options);
+		g_mutex_lock(&ctx->cb_mutex);
+		ctx->cb(driver, devices, ctx->cb_data);
+		g_mutex_unlock(&ctx->cb_mutex);
+	}
+	g_slist_free(drivers);
+}
+
+/**
+ * Tell several hardware drivers to scan for devices, at the same time.
+ *
+ * This does what sr_driver_scan() does for each of the drivers, on a
+ * pool of threads. Whole scans take about as long as the slowest driver
+ * then, instead of the sum of all of them.
+ *
+ * Drivers which could get in each other's way scan one after the other:
+ * all drivers when the options contain a connection, and otherwise the
+ * USB drivers (the drivers which take a connection but no serial
+ * parameters).
+ *
+ * The callback gets called for each driver when its scan is complete,
+ * from the thread that scanned, but never for two drivers at the same
+ * time. This function returns when all the drivers have been scanned.
+ *
+ * @param drivers NULL terminated array of drivers, like the one returned
+ *                by sr_driver_list(). The drivers must have been
+ *                initialized with sr_driver_init(). Must not be NULL.
+ * @param options A list of 'struct sr_hwopt' options to pass to the
+ *                drivers' scanners. Can be NULL/empty.
+ * @param cb Callback which gets the driver and the list of devices it
+ *           found, as with sr_driver_scan(). The callback must free the
+ *           list with g_slist_free(). Must not be NULL.
+ * @param cb_data Opaque data for the callback.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_driver_scan_all(struct sr_dev_driver **drivers, GSList *options,
+		sr_driver_scan_callback cb, void *cb_data)
+{
+	struct scan_all_ctx ctx;
+	GSList *groups[SCAN_GROUP_USB + 1], *jobs, *l;
+	GThreadPool *pool;
+	gboolean have_conn;
+	enum scan_group group;
+	int i;
+
+	if (!drivers || !cb) {
+		sr_err("Invalid drivers or callback, can't scan for devices.");
+		return SR_ERR_ARG;
+	}
+
+	have_conn = FALSE;
+	for (l = options; l; l = l->next) {
+		if (((struct sr_config *)l->data)->key == SR_CONF_CONN)
+			have_conn = TRUE;
+	}
+
+	/* Ungrouped drivers scan alone, the others in their group. */
+	memset(groups, 0, sizeof(groups));
+	jobs = NULL;
+	for (i = 0; drivers[i]; i++) {
+		group = scan_group_get(drivers[i], have_conn);
+		if (group == SCAN_GROUP_NONE)
+			jobs = g_slist_append(jobs, g_slist_append(NULL, drivers[i]));
+		else
+			groups[group] = g_slist_append(groups[group], drivers[i]);
+	}
+	for (i = SCAN_GROUP_CONN; i <= SCAN_GROUP_USB; i++) {
+		if (groups[i])
+			jobs = g_slist_append(jobs, groups[i]);
+	}
+
+	ctx.options = options;
+	ctx.cb = cb;
+	ctx.cb_data = cb_data;
+	g_mutex_init(&ctx.cb_mutex);
+
+	pool = g_thread_pool_new(scan_group_run, &ctx, SCAN_THREADS, FALSE, NULL);
+	for (l = jobs; l; l = l->next) {
+		if (!pool || !g_thread_pool_push(pool, l->data, NULL))
+			scan_group_run(l->data, &ctx);
+	}
+	if (pool)
+		g_thread_pool_free(pool, FALSE, TRUE);
+	g_slist_free(jobs);
+	g_mutex_clear(&ctx.cb_mutex);
+
+	return SR_OK;
+}
+
 /**
  * Call driver cleanup function for all drivers.
  *
@@ -585,10 +873,15 @@ SR_PRIV void sr_hw_cleanup_all(const struct sr_context *ctx)
 	if (!ctx)
 		return;
 
+	/* Nothing to do if no driver was ever asked for. */
+	if (!(drivers = ctx->driver_list))
+		return;
+
 	sr_dbg("Cleaning up all drivers.");
 
-	drivers = sr_driver_list(ctx);
 	for (i = 0; drivers[i]; i++) {
+		if (!drivers[i]->context)
+			continue;
 		if (drivers[i]->cleanup)
 			drivers[i]->cleanup(drivers[i]);
 		drivers[i]->context = NULL;
@@ -638,6 +931,8 @@ SR_PRIV void sr_config_free(struct sr_config *src)
 /** @private */
 SR_PRIV int sr_dev_acquisition_start(struct sr_dev_inst *sdi)
 {
+	int ret;
+
 	if (!sdi || !sdi->driver) {
 		sr_err("%s: Invalid arguments.", __func__);
 		return SR_ERR_ARG;
@@ -651,7 +946,68 @@ SR_PRIV int sr_dev_acquisition_start(struct sr_dev_inst *sdi)
 
 	sr_dbg("%s: Starting acquisition.", sdi->driver->name);
 
-	return sdi->driver->dev_acquisition_start(sdi);
+	/* Changes while the acquisition runs clear the flag again. */
+	sdi->armed = TRUE;
+	ret = sdi->driver->dev_acquisition_start(sdi);
+	if (ret != SR_OK)
+		sdi->armed = FALSE;
+
+	return ret;
+}
+
+/**
+ * Start acquisition again, reusing the driver's setup of the previous run.
+ *
+ * This is cheaper than sr_dev_acquisition_start() for drivers which
+ * implement dev_acquisition_rearm(), as long as the configuration, the
+ * channels and the session's trigger did not change since the previous
+ * acquisition started. Otherwise this falls back to a full start.
+ *
+ * @private
+ */
+SR_PRIV int sr_dev_acquisition_rearm(struct sr_dev_inst *sdi)
+{
+	int ret;
+
+	if (!sdi || !sdi->driver) {
+		sr_err("%s: Invalid arguments.", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (sdi->status != SR_ST_ACTIVE) {
+		sr_err("%s: Device instance not active, can't start.",
+			sdi->driver->name);
+		return SR_ERR_DEV_CLOSED;
+	}
+
+	if (!sdi->armed || !sdi->driver->dev_acquisition_rearm)
+		return sr_dev_acquisition_start(sdi);
+
+	sr_dbg("%s: Re-arming acquisition.", sdi->driver->name);
+
+	ret = sdi->driver->dev_acquisition_rearm(sdi);
+	if (ret == SR_ERR_NA)
+		return sr_dev_acquisition_start(sdi);
+	if (ret != SR_OK)
+		sdi->armed = FALSE;
+
+	return ret;
+}
+
+/**
+ * Have the next acquisition of a device start from scratch.
+ *
+ * This gets called for changes which the setup of the previous run
+ * does not cover, see sr_dev_acquisition_rearm().
+ *
+ * @param sdi The device instance. Can be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_dev_rearm_invalidate(const struct sr_dev_inst *sdi)
+{
+	if (sdi)
+		((struct sr_dev_inst *)sdi)->armed = FALSE;
 }
 
 /** @private */
@@ -695,29 +1051,27 @@ static void log_key(const struct sr_dev_inst *sdi,
 	g_free(tmp_str);
 }
 
-static int check_key(const struct sr_dev_driver *driver,
-		const struct sr_dev_inst *sdi, const struct sr_channel_group *cg,
-		uint32_t key, unsigned int op, GVariant *data)
+static const char *check_key_suffix(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg)
+{
+	if (sdi && cg)
+		return " for this device instance and channel group";
+	else if (sdi)
+		return " for this device instance";
+	else
+		return "";
+}
+
+/* Check the value, and find the key in the published options. */
+static int check_key_opts(const struct sr_key_info *srci, uint32_t key,
+		unsigned int op, GVariant *data, GVariant *gvar_opts,
+		const char *suffix)
 {
-	const struct sr_key_info *srci;
 	gsize num_opts, i;
-	GVariant *gvar_opts;
 	const uint32_t *opts;
 	uint32_t pub_opt;
-	const char *suffix;
 	const char *opstr;
 
-	if (sdi && cg)
-		suffix = " for this device instance and channel group";
-	else if (sdi)
-		suffix = " for this device instance";
-	else
-		suffix = "";
-
-	if (!(srci = sr_key_info_get(SR_KEY_CONFIG, key))) {
-		sr_err("Invalid key %d.", key);
-		return SR_ERR_ARG;
-	}
 	opstr = op == SR_CONF_GET ? "get" : op == SR_CONF_SET ? "set" : "list";
 
 	switch (key) {
@@ -743,11 +1097,6 @@ static int check_key(const struct sr_dev_driver *driver,
 		break;
 	}
 
-	if (sr_config_list(driver, sdi, cg, SR_CONF_DEVICE_OPTIONS, &gvar_opts) != SR_OK) {
-		/* Driver publishes no options. */
-		sr_err("No options available%s.", suffix);
-		return SR_ERR_ARG;
-	}
 	opts = g_variant_get_fixed_array(gvar_opts, &num_opts, sizeof(uint32_t));
 	pub_opt = 0;
 	for (i = 0; i < num_opts; i++) {
@@ -756,7 +1105,6 @@ static int check_key(const struct sr_dev_driver *driver,
 			break;
 		}
 	}
-	g_variant_unref(gvar_opts);
 	if (!pub_opt) {
 		sr_err("Option '%s' not available%s.", srci->id, suffix);
 		return SR_ERR_ARG;
@@ -770,6 +1118,33 @@ static int check_key(const struct sr_dev_driver *driver,
 	return SR_OK;
 }
 
+static int check_key(const struct sr_dev_driver *driver,
+		const struct sr_dev_inst *sdi, const struct sr_channel_group *cg,
+		uint32_t key, unsigned int op, GVariant *data)
+{
+	const struct sr_key_info *srci;
+	GVariant *gvar_opts;
+	const char *suffix;
+	int ret;
+
+	suffix = check_key_suffix(sdi, cg);
+
+	if (!(srci = sr_key_info_get(SR_KEY_CONFIG, key))) {
+		sr_err("Invalid key %d.", key);
+		return SR_ERR_ARG;
+	}
+
+	if (sr_config_list(driver, sdi, cg, SR_CONF_DEVICE_OPTIONS, &gvar_opts) != SR_OK) {
+		/* Driver publishes no options. */
+		sr_err("No options available%s.", suffix);
+		return SR_ERR_ARG;
+	}
+	ret = check_key_opts(srci, key, op, data, gvar_opts, suffix);
+	g_variant_unref(gvar_opts);
+
+	return ret;
+}
+
 /**
  * Query value of a configuration key at the given driver or device instance.
  *
@@ -821,6 +1196,8 @@ SR_API int sr_config_get(const struct sr_dev_driver *driver,
 		/* Got a floating reference from the driver. Sink it here,
 		 * caller will need to unref when done with it. */
 		g_variant_ref_sink(*data);
+		if (sdi)
+			sr_config_publish(sdi, cg, key, *data);
 	}
 
 	if (ret == SR_ERR_CHANNEL_GROUP)
@@ -871,6 +1248,8 @@ SR_API int sr_config_set(const struct sr_dev_inst *sdi,
 	else if ((ret = sr_variant_type_check(key, data)) == SR_OK) {
 		log_key(sdi, cg, key, SR_CONF_SET, data);
 		ret = sdi->driver->config_set(key, data, sdi, cg);
+		if (ret == SR_OK)
+			sr_config_publish(sdi, cg, key, data);
 	}
 
 	g_variant_unref(data);
@@ -906,6 +1285,615 @@ SR_API int sr_config_commit(const struct sr_dev_inst *sdi)
 	} else
 		ret = sdi->driver->config_commit(sdi);
 
+	if (sdi && ret == SR_OK)
+		sr_config_lists_invalidate(sdi);
+
+	return ret;
+}
+
+/** @cond PRIVATE */
+struct sr_config_transaction {
+	const struct sr_dev_inst *sdi;
+	/* Pending changes, struct sr_config_change. */
+	GArray *changes;
+};
+/** @endcond */
+
+static void transaction_clear(struct sr_config_transaction *txn)
+{
+	struct sr_config_change *change;
+	guint i;
+
+	for (i = 0; i < txn->changes->len; i++) {
+		change = &g_array_index(txn->changes, struct sr_config_change, i);
+		g_variant_unref(change->data);
+	}
+	g_array_set_size(txn->changes, 0);
+}
+
+/* Validate all changes, listing each channel group's options once. */
+static int transaction_check(struct sr_config_transaction *txn)
+{
+	const struct sr_dev_inst *sdi;
+	const struct sr_channel_group *cg;
+	const struct sr_config_change *change, *other;
+	const struct sr_key_info *srci;
+	GVariant **gvar_opts;
+	const char *suffix;
+	guint i, j;
+	int ret;
+
+	sdi = txn->sdi;
+	gvar_opts = g_malloc0_n(txn->changes->len, sizeof(*gvar_opts));
+	ret = SR_OK;
+	for (i = 0; i < txn->changes->len && ret == SR_OK; i++) {
+		change = &g_array_index(txn->changes, struct sr_config_change, i);
+		cg = change->cg;
+		suffix = check_key_suffix(sdi, cg);
+		if (!(srci = sr_key_info_get(SR_KEY_CONFIG, change->key))) {
+			sr_err("Invalid key %d.", change->key);
+			ret = SR_ERR_ARG;
+			break;
+		}
+		if (sr_variant_type_check(change->key, change->data) != SR_OK) {
+			ret = SR_ERR_ARG;
+			break;
+		}
+		/* Reuse the options of an earlier change to the same group. */
+		for (j = 0; j < i; j++) {
+			other = &g_array_index(txn->changes, struct sr_config_change, j);
+			if (other->cg == cg && gvar_opts[j])
+				break;
+		}
+		if (j < i) {
+			gvar_opts[i] = g_variant_ref(gvar_opts[j]);
+		} else if (sr_config_list(sdi->driver, sdi, cg,
+				SR_CONF_DEVICE_OPTIONS, &gvar_opts[i]) != SR_OK) {
+			sr_err("No options available%s.", suffix);
+			gvar_opts[i] = NULL;
+			ret = SR_ERR_ARG;
+			break;
+		}
+		ret = check_key_opts(srci, change->key, SR_CONF_SET,
+			change->data, gvar_opts[i], suffix);
+	}
+	for (i = 0; i < txn->changes->len; i++) {
+		if (gvar_opts[i])
+			g_variant_unref(gvar_opts[i]);
+	}
+	g_free(gvar_opts);
+
+	return ret;
+}
+
+/**
+ * Start a transaction of configuration changes to a device instance.
+ *
+ * Changes get collected with sr_config_transaction_set(), and applied
+ * together by sr_config_transaction_commit(). Drivers which support it
+ * get all changes at once, and can apply them to the hardware in one
+ * go, e.g. with one batch of SCPI commands.
+ *
+ * @param sdi The device instance. Must not be NULL.
+ *
+ * @return The transaction, NULL upon invalid arguments. Release it with
+ *         sr_config_transaction_free().
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_config_transaction *sr_config_transaction_new(
+		const struct sr_dev_inst *sdi)
+{
+	struct sr_config_transaction *txn;
+
+	if (!sdi || !sdi->driver)
+		return NULL;
+
+	txn = g_malloc0(sizeof(*txn));
+	txn->sdi = sdi;
+	txn->changes = g_array_new(FALSE, FALSE, sizeof(struct sr_config_change));
+
+	return txn;
+}
+
+/**
+ * Add a configuration change to a transaction.
+ *
+ * The change is checked and applied by sr_config_transaction_commit().
+ * A later change of the same key and channel group replaces an
+ * earlier one.
+ *
+ * @param txn The transaction.
+ * @param cg The channel group, or NULL.
+ * @param key The configuration key (SR_CONF_*).
+ * @param data The new value for the key. A floating reference can be
+ *        passed in; its refcount will be sunk and unreferenced after use.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_config_transaction_set(struct sr_config_transaction *txn,
+		const struct sr_channel_group *cg, uint32_t key, GVariant *data)
+{
+	struct sr_config_change *change, new_change;
+	guint i;
+
+	if (!data)
+		return SR_ERR_ARG;
+	g_variant_ref_sink(data);
+	if (!txn) {
+		g_variant_unref(data);
+		return SR_ERR_ARG;
+	}
+
+	for (i = 0; i < txn->changes->len; i++) {
+		change = &g_array_index(txn->changes, struct sr_config_change, i);
+		if (change->cg == cg && change->key == key) {
+			g_variant_unref(change->data);
+			change->data = data;
+			return SR_OK;
+		}
+	}
+
+	new_change.cg = cg;
+	new_change.key = key;
+	new_change.data = data;
+	g_array_append_val(txn->changes, new_change);
+
+	return SR_OK;
+}
+
+/**
+ * Check and apply the changes of a transaction, then commit the device's
+ * configuration, see sr_config_commit().
+ *
+ * All changes are checked before any of them gets applied. Drivers with
+ * a config_set_batch() callback get them all at once, for the others
+ * they are applied one by one. The transaction is empty afterwards, and
+ * can be reused.
+ *
+ * @param txn The transaction.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or a change is not applicable.
+ *         No change was applied.
+ * @retval SR_ERR_DEV_CLOSED The device instance is not active.
+ * @retval other Error code of the driver. Changes before the failing
+ *         one may have been applied.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_config_transaction_commit(struct sr_config_transaction *txn)
+{
+	const struct sr_dev_inst *sdi;
+	const struct sr_config_change *changes;
+	guint i;
+	int ret;
+
+	if (!txn)
+		return SR_ERR_ARG;
+
+	sdi = txn->sdi;
+	if (!sdi->priv || !sdi->driver->config_set) {
+		ret = SR_ERR_ARG;
+	} else if (sdi->status != SR_ST_ACTIVE) {
+		sr_err("%s: Device instance not active, can't set config.",
+			sdi->driver->name);
+		ret = SR_ERR_DEV_CLOSED;
+	} else {
+		ret = transaction_check(txn);
+	}
+	if (ret != SR_OK) {
+		transaction_clear(txn);
+		return ret;
+	}
+
+	changes = (const struct sr_config_change *)txn->changes->data;
+	for (i = 0; i < txn->changes->len; i++)
+		log_key(sdi, changes[i].cg, changes[i].key, SR_CONF_SET,
+			changes[i].data);
+
+	if (!txn->changes->len) {
+		ret = SR_OK;
+	} else if (sdi->driver->config_set_batch) {
+		ret = sdi->driver->config_set_batch(sdi, changes,
+			txn->changes->len);
+	} else {
+		for (i = 0; i < txn->changes->len && ret == SR_OK; i++)
+			ret = sdi->driver->config_set(changes[i].key,
+				changes[i].data, sdi, changes[i].cg);
+	}
+	for (i = 0; i < txn->changes->len && ret == SR_OK; i++)
+		sr_config_publish(sdi, changes[i].cg, changes[i].key,
+			changes[i].data);
+	transaction_clear(txn);
+
+	if (ret == SR_ERR_CHANNEL_GROUP)
+		sr_err("%s: No channel group specified.", sdi->driver->name);
+	if (ret != SR_OK)
+		return ret;
+
+	return sr_config_commit(sdi);
+}
+
+/**
+ * Release a transaction, discarding changes which were not committed.
+ *
+ * @param txn The transaction. If NULL, the function will do nothing.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_config_transaction_free(struct sr_config_transaction *txn)
+{
+	if (!txn)
+		return;
+
+	transaction_clear(txn);
+	g_array_free(txn->changes, TRUE);
+	g_free(txn);
+}
+
+/** @cond PRIVATE */
+/* The last known value of a key, see sr_config_get_cached(). */
+struct config_value {
+	const struct sr_channel_group *cg;
+	uint32_t key;
+	GVariant *data;
+};
+
+struct config_subscriber {
+	uint32_t key;
+	sr_config_notify_callback cb;
+	void *cb_data;
+};
+
+/* Known configuration values of a device, and who wants to hear of them. */
+struct sr_dev_config_state {
+	GArray *values;
+	/* Results of config_list(), see sr_config_list(). */
+	GArray *lists;
+	/* Bumped when the lists get dropped. */
+	unsigned int lists_gen;
+	GSList *subscribers;
+};
+/** @endcond */
+
+/* Protects the configuration states of all devices. */
+static GMutex config_state_mutex;
+
+/* Call with the mutex held. */
+static struct sr_dev_config_state *config_state_get(
+		const struct sr_dev_inst *sdi)
+{
+	struct sr_dev_config_state *state;
+
+	if (!(state = sdi->config_state)) {
+		state = g_malloc0(sizeof(*state));
+		state->values = g_array_new(FALSE, FALSE,
+			sizeof(struct config_value));
+		state->lists = g_array_new(FALSE, FALSE,
+			sizeof(struct config_value));
+		((struct sr_dev_inst *)sdi)->config_state = state;
+	}
+
+	return state;
+}
+
+static void config_values_clear(GArray *values)
+{
+	guint i;
+
+	for (i = 0; i < values->len; i++)
+		g_variant_unref(g_array_index(values,
+			struct config_value, i).data);
+	g_array_set_size(values, 0);
+}
+
+/* Call with the mutex held. */
+static void config_lists_clear(struct sr_dev_config_state *state)
+{
+	config_values_clear(state->lists);
+	state->lists_gen++;
+}
+
+/* Call with the mutex held. */
+static struct config_value *config_value_find(GArray *values,
+		const struct sr_channel_group *cg, uint32_t key)
+{
+	struct config_value *value;
+	guint i;
+
+	for (i = 0; i < values->len; i++) {
+		value = &g_array_index(values, struct config_value, i);
+		if (value->cg == cg && value->key == key)
+			return value;
+	}
+
+	return NULL;
+}
+
+/**
+ * Publish the current value of a configuration key of a device.
+ *
+ * Drivers call this when they learn about a value without being asked,
+ * e.g. from the status responses during an acquisition. The core also
+ * publishes the values which pass through sr_config_get(),
+ * sr_config_set() and SR_DF_META packets. Subscribers get notified
+ * when the value differs from the last known one, from the calling
+ * thread.
+ *
+ * @param sdi The device instance. Must not be NULL.
+ * @param cg The channel group, or NULL.
+ * @param key The configuration key (SR_CONF_*).
+ * @param data The value. A floating reference can be passed in; its
+ *        refcount will be sunk and unreferenced after use.
+ *
+ * @private
+ */
+SR_PRIV void sr_config_publish(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, uint32_t key, GVariant *data)
+{
+	struct sr_dev_config_state *state;
+	struct config_value *value, new_value;
+	struct config_subscriber *sub;
+	GArray *notify;
+	GSList *l;
+	guint i;
+
+	g_variant_ref_sink(data);
+
+	g_mutex_lock(&config_state_mutex);
+	state = config_state_get(sdi);
+	value = config_value_find(state->values, cg, key);
+	if (value && g_variant_equal(value->data, data)) {
+		g_mutex_unlock(&config_state_mutex);
+		g_variant_unref(data);
+		return;
+	}
+	if (value) {
+		g_variant_unref(value->data);
+		value->data = g_variant_ref(data);
+	} else {
+		new_value.cg = cg;
+		new_value.key = key;
+		new_value.data = g_variant_ref(data);
+		g_array_append_val(state->values, new_value);
+	}
+	/* The change may affect what else can be set. */
+	config_lists_clear(state);
+	sr_dev_rearm_invalidate(sdi);
+	/* Notify without the mutex, callbacks may query the state. */
+	notify = NULL;
+	for (l = state->subscribers; l; l = l->next) {
+		sub = l->data;
+		if (sub->key && sub->key != key)
+			continue;
+		if (!notify)
+			notify = g_array_new(FALSE, FALSE, sizeof(*sub));
+		g_array_append_val(notify, *sub);
+	}
+	g_mutex_unlock(&config_state_mutex);
+
+	for (i = 0; notify && i < notify->len; i++) {
+		sub = &g_array_index(notify, struct config_subscriber, i);
+		sub->cb(sdi, cg, key, data, sub->cb_data);
+	}
+	if (notify)
+		g_array_free(notify, TRUE);
+	g_variant_unref(data);
+}
+
+/**
+ * Release the configuration state of a device.
+ *
+ * @param sdi The device instance. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_config_state_free(struct sr_dev_inst *sdi)
+{
+	struct sr_dev_config_state *state;
+
+	if (!(state = sdi->config_state))
+		return;
+
+	config_values_clear(state->values);
+	config_values_clear(state->lists);
+	g_array_free(state->values, TRUE);
+	g_array_free(state->lists, TRUE);
+	g_slist_free_full(state->subscribers, g_free);
+	g_free(state);
+	sdi->config_state = NULL;
+}
+
+/**
+ * Drop the lists of values which sr_config_list() cached for a device.
+ *
+ * The core calls this when the device gets opened or closed, when its
+ * channels change, and when configuration values change. Drivers call
+ * it when lists change for other reasons.
+ *
+ * @param sdi The device instance. Can be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_config_lists_invalidate(const struct sr_dev_inst *sdi)
+{
+	if (!sdi)
+		return;
+
+	g_mutex_lock(&config_state_mutex);
+	if (sdi->config_state)
+		config_lists_clear(sdi->config_state);
+	g_mutex_unlock(&config_state_mutex);
+}
+
+/* Look up a cached list, or get the generation to store one with. */
+static GVariant *config_list_cached(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, uint32_t key,
+		unsigned int *gen)
+{
+	struct sr_dev_config_state *state;
+	struct config_value *value;
+	GVariant *data;
+
+	g_mutex_lock(&config_state_mutex);
+	state = config_state_get(sdi);
+	value = config_value_find(state->lists, cg, key);
+	data = value ? g_variant_ref(value->data) : NULL;
+	*gen = state->lists_gen;
+	g_mutex_unlock(&config_state_mutex);
+
+	return data;
+}
+
+/* Cache a list, unless the lists got dropped while the driver built it. */
+static void config_list_store(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, uint32_t key,
+		GVariant *data, unsigned int gen)
+{
+	struct sr_dev_config_state *state;
+	struct config_value new_value;
+
+	g_mutex_lock(&config_state_mutex);
+	state = config_state_get(sdi);
+	if (state->lists_gen == gen
+			&& !config_value_find(state->lists, cg, key)) {
+		new_value.cg = cg;
+		new_value.key = key;
+		new_value.data = g_variant_ref(data);
+		g_array_append_val(state->lists, new_value);
+	}
+	g_mutex_unlock(&config_state_mutex);
+}
+
+/**
+ * Get notified about changes of a device's configuration.
+ *
+ * Instead of polling sr_config_get(), which for many devices is a round
+ * trip to the hardware, frontends can subscribe to the values which
+ * drivers and frontends publish. The callback gets invoked whenever a
+ * value differs from the last known one, from the thread which learned
+ * about it, e.g. the session thread during an acquisition. The last
+ * known values are available from sr_config_get_cached().
+ *
+ * @param sdi The device instance. Must not be NULL.
+ * @param key The configuration key (SR_CONF_*) to subscribe to, or 0
+ *            for all keys.
+ * @param cb The callback. Must not be NULL.
+ * @param cb_data Data for the callback. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_config_subscribe(const struct sr_dev_inst *sdi, uint32_t key,
+		sr_config_notify_callback cb, void *cb_data)
+{
+	struct sr_dev_config_state *state;
+	struct config_subscriber *sub;
+
+	if (!sdi || !cb)
+		return SR_ERR_ARG;
+
+	sub = g_malloc0(sizeof(*sub));
+	sub->key = key;
+	sub->cb = cb;
+	sub->cb_data = cb_data;
+
+	g_mutex_lock(&config_state_mutex);
+	state = config_state_get(sdi);
+	state->subscribers = g_slist_append(state->subscribers, sub);
+	g_mutex_unlock(&config_state_mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Cancel subscriptions to the configuration of a device.
+ *
+ * All subscriptions with the callback and callback data get cancelled.
+ * Notifications which are in progress in other threads may still
+ * invoke the callback after this returns.
+ *
+ * @param sdi The device instance. Must not be NULL.
+ * @param cb The callback which was passed to sr_config_subscribe().
+ * @param cb_data The callback data which was passed to sr_config_subscribe().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument, or no such subscription.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_config_unsubscribe(const struct sr_dev_inst *sdi,
+		sr_config_notify_callback cb, void *cb_data)
+{
+	struct sr_dev_config_state *state;
+	struct config_subscriber *sub;
+	GSList *l, *next;
+	int ret;
+
+	if (!sdi || !cb)
+		return SR_ERR_ARG;
+
+	ret = SR_ERR_ARG;
+	g_mutex_lock(&config_state_mutex);
+	state = sdi->config_state;
+	for (l = state ? state->subscribers : NULL; l; l = next) {
+		next = l->next;
+		sub = l->data;
+		if (sub->cb != cb || sub->cb_data != cb_data)
+			continue;
+		state->subscribers = g_slist_delete_link(state->subscribers, l);
+		g_free(sub);
+		ret = SR_OK;
+	}
+	g_mutex_unlock(&config_state_mutex);
+
+	return ret;
+}
+
+/**
+ * Get the last known value of a configuration key of a device.
+ *
+ * Other than sr_config_get(), this doesn't ask the driver. The value
+ * is the one which was last published, see sr_config_subscribe().
+ *
+ * @param sdi The device instance. Must not be NULL.
+ * @param cg The channel group, or NULL.
+ * @param key The configuration key (SR_CONF_*).
+ * @param data Pointer to a GVariant where the value will be stored.
+ *        Must not be NULL. The caller is given ownership of the GVariant
+ *        and must thus decrease the refcount after use.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The value is not known.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_config_get_cached(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, uint32_t key, GVariant **data)
+{
+	struct config_value *value;
+	int ret;
+
+	if (!sdi || !data)
+		return SR_ERR_ARG;
+
+	ret = SR_ERR_NA;
+	g_mutex_lock(&config_state_mutex);
+	if (sdi->config_state
+			&& (value = config_value_find(sdi->config_state->values,
+				cg, key))) {
+		*data = g_variant_ref(value->data);
+		ret = SR_OK;
+	}
+	g_mutex_unlock(&config_state_mutex);
+
 	return ret;
 }
 
@@ -930,6 +1918,11 @@ SR_API int sr_config_commit(const struct sr_dev_inst *sdi)
  *                returns an error code, the field should be considered
  *                unused, and should not be unreferenced.
  *
+ * The lists of device instances are cached, further calls return a
+ * reference to the same GVariant. The cache is dropped when the device
+ * is opened or closed, when its channels change, and when a
+ * configuration value changes.
+ *
  * @retval SR_OK Success.
  * @retval SR_ERR Error.
  * @retval SR_ERR_ARG The driver doesn't know that key, but this is not to be
@@ -943,8 +1936,12 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
 		const struct sr_channel_group *cg,
 		uint32_t key, GVariant **data)
 {
+	unsigned int gen;
+	gboolean cached;
 	int ret;
 
+	gen = 0;
+
 	if (!driver || !data)
 		return SR_ERR;
 
@@ -982,9 +1979,15 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
 		return SR_ERR_ARG;
 	}
 
+	cached = sdi && sdi->driver == driver;
+	if (cached && (*data = config_list_cached(sdi, cg, key, &gen)))
+		return SR_OK;
+
 	if ((ret = driver->config_list(key, data, sdi, cg)) == SR_OK) {
 		log_key(sdi, cg, key, SR_CONF_LIST, *data);
 		g_variant_ref_sink(*data);
+		if (cached)
+			config_list_store(sdi, cg, key, *data, gen);
 	}
 
 	if (ret == SR_ERR_CHANNEL_GROUP)
@@ -66,61 +66,155 @@ static int init(struct sr_input *in, GHashTable *options)
 	return SR_OK;
 }
 
-static int process_buffer(struct sr_input *in)
+static void send_header(struct sr_input *in)
 {
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
 	struct context *inc;
-	gsize chunk_size, i;
-	int chunk;
 
 	inc = in->priv;
 	if (!inc->started) {
 		std_session_send_df_header(in->sdi);
 
 		if (inc->samplerate) {
-			(void)sr_session_send_meta(in->sdi, SR_CONF_SAMPLERATE,
-				g_variant_new_uint64(inc->samplerate));
+			(void)sr_session_send_meta_uint64(in->sdi, SR_CONF_SAMPLERATE,
+				inc->samplerate);
 		}
 
 		inc->started = TRUE;
 	}
+}
+
+/*
+ * Send the caller's data in place, cut off at a multiple of unitsize.
+ * Returns the number of bytes which were sent.
+ */
+static gsize send_samples(struct sr_input *in, const char *data, gsize len)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct context *inc;
+	gsize chunk_size, i;
+	int chunk;
+
+	inc = in->priv;
+	send_header(in);
 
 	packet.type = SR_DF_LOGIC;
 	packet.payload = &logic;
 	logic.unitsize = inc->unitsize;
 
 	/* Cut off at multiple of unitsize. */
-	chunk_size = in->buf->len / logic.unitsize * logic.unitsize;
+	chunk_size = len / logic.unitsize * logic.unitsize;
 
 	for (i = 0; i < chunk_size; i += chunk) {
-		logic.data = in->buf->str + i;
+		logic.data = (void *)(data + i);
 		chunk = MIN(CHUNK_SIZE, chunk_size - i);
 		chunk /= logic.unitsize;
 		chunk *= logic.unitsize;
 		logic.length = chunk;
 		sr_session_send(in->sdi, &packet);
 	}
-	g_string_erase(in->buf, 0, chunk_size);
+
+	return chunk_size;
+}
+
+static int process_buffer(struct sr_input *in)
+{
+	gsize sent;
+
+	sent = send_samples(in, in->buf->str, in->buf->len);
+	g_string_erase(in->buf, 0, sent);
 
 	return SR_OK;
 }
 
-static int receive(struct sr_input *in, GString *buf)
+/*
+ * Complete a sample set which previous input left in the buffer, and
+ * send it. Returns the number of bytes which were taken from the data.
+ */
+static gsize complete_buffer(struct sr_input *in, const char *data, gsize len)
 {
-	int ret;
+	struct context *inc;
+	gsize count;
 
-	g_string_append_len(in->buf, buf->str, buf->len);
+	inc = in->priv;
+	if (!in->buf->len)
+		return 0;
+	count = inc->unitsize - in->buf->len % inc->unitsize;
+	count = MIN(count, len);
+	g_string_append_len(in->buf, data, count);
+	process_buffer(in);
+
+	return count;
+}
+
+static int receive(struct sr_input *in, GString *buf)
+{
+	const char *data;
+	gsize len, count;
 
 	if (!in->sdi_ready) {
+		g_string_append_len(in->buf, buf->str, buf->len);
 		/* sdi is ready, notify frontend. */
 		in->sdi_ready = TRUE;
 		return SR_OK;
 	}
 
-	ret = process_buffer(in);
+	/*
+	 * Send sample data from the caller's buffer where possible.
+	 * Only keep an incomplete trailing sample set.
+	 */
+	data = buf->str;
+	len = buf->len;
+	count = complete_buffer(in, data, len);
+	data += count;
+	len -= count;
+	if (!in->buf->len) {
+		count = send_samples(in, data, len);
+		data += count;
+		len -= count;
+	}
+	g_string_append_len(in->buf, data, len);
+
+	return SR_OK;
+}
 
-	return ret;
+/*
+ * Memory mapped input is sent in place, the packets point into the
+ * file's mapping. Nothing gets copied except data which receive() has
+ * buffered before.
+ */
+static int receive_mapped(struct sr_input *in, const char *data, size_t len)
+{
+	gsize count;
+
+	process_buffer(in);
+	count = complete_buffer(in, data, len);
+	data += count;
+	len -= count;
+	count = send_samples(in, data, len);
+	data += count;
+	len -= count;
+	g_string_append_len(in->buf, data, len);
+
+	return SR_OK;
+}
+
+/* Sample sets are at fixed positions, seeking is a multiplication. */
+static int receive_range(struct sr_input *in, const char *data, size_t len,
+	uint64_t start, uint64_t count)
+{
+	struct context *inc;
+	uint64_t total;
+
+	inc = in->priv;
+	g_string_truncate(in->buf, 0);
+
+	total = len / inc->unitsize;
+	start = MIN(start, total);
+	count = MIN(count, total - start);
+	send_samples(in, data + start * inc->unitsize, count * inc->unitsize);
+
+	return SR_OK;
 }
 
 static int end(struct sr_input *in)
@@ -171,9 +265,12 @@ SR_PRIV struct sr_input_module input_binary = {
 	.name = "Binary",
 	.desc = "Raw binary logic data",
 	.exts = NULL,
+	.flags = SR_INPUT_MAPPED,
 	.options = get_options,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = receive_mapped,
+	.receive_range = receive_range,
 	.end = end,
 	.reset = reset,
 };
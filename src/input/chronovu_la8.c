@@ -143,8 +143,8 @@ static int process_buffer(struct sr_input *in)
 		std_session_send_df_header(in->sdi);
 
 		if (inc->samplerate) {
-			(void)sr_session_send_meta(in->sdi, SR_CONF_SAMPLERATE,
-				g_variant_new_uint64(inc->samplerate));
+			(void)sr_session_send_meta_uint64(in->sdi, SR_CONF_SAMPLERATE,
+				inc->samplerate);
 		}
 
 		inc->samples_remain = CHRONOVU_LA8_DATASIZE;
@@ -33,6 +33,7 @@
 #define LOG_PREFIX "input/csv"
 
 #define CHUNK_SIZE	(4 * 1024 * 1024)
+#define PARSE_BLOCK_SIZE	(16 * 1024 * 1024)
 
 /*
  * The CSV input module has the following options:
@@ -91,6 +92,10 @@
  *     up to the end of the current text line. Can be empty to disable
  *     comment support. Defaults to semicolon.
  *
+ * threads: Specifies the number of threads which parse the text lines of
+ *     memory mapped input files. Defaults to 0, which parses in the
+ *     caller's thread. Samples are still sent in input order.
+ *
  * Typical examples of using these options:
  * - ... -I csv:column_formats=*l ...
  *   All columns are single-bit logic data. Identical to the previous
@@ -220,6 +225,10 @@ struct context {
 	GString *comment;
 	char *termination;
 
+	/* Columns of the current text line, split in place. */
+	char **columns;
+	size_t columns_alloced;
+
 	/* Format specs for input columns, and processing state. */
 	size_t column_seen_count;
 	const char *column_formats;
@@ -250,12 +259,35 @@ struct context {
 	int *analog_datafeed_digits;
 	GSList **analog_datafeed_channels;
 
-	/* Current line number. */
+	/* Current line number, scratch copy of the line (mapped input). */
 	size_t line_number;
+	GString *line;
 
 	/* List of previously created sigrok channels. */
 	GSList *prev_sr_channels;
 	GSList **prev_df_channels;
+
+	/* Workers which parse blocks of mapped input, blocks in flight. */
+	size_t threads;
+	GThreadPool *pool;
+	GQueue jobs;
+};
+
+/*
+ * A block of mapped input for a worker. The worker parses into its own
+ * copy of the context, which has sample buffers for all of the block's
+ * text lines (logic sample sets, and one plane per analog channel).
+ */
+struct csv_job {
+	const char *data;
+	size_t len;
+	size_t lines;
+	struct context ctx;
+	GString *line;
+	int ret;
+	gboolean done;
+	GMutex mutex;
+	GCond cond;
 };
 
 /*
@@ -279,8 +311,8 @@ static int flush_samplerate(const struct sr_input *in)
 	if (!inc->calc_samplerate && inc->samplerate)
 		inc->calc_samplerate = inc->samplerate;
 	if (inc->calc_samplerate && !inc->samplerate_sent) {
-		(void)sr_session_send_meta(in->sdi, SR_CONF_SAMPLERATE,
-			g_variant_new_uint64(inc->calc_samplerate));
+		(void)sr_session_send_meta_uint64(in->sdi, SR_CONF_SAMPLERATE,
+			inc->calc_samplerate);
 		inc->samplerate_sent = TRUE;
 	}
 
@@ -752,26 +784,44 @@ static void strip_comment(char *buf, const GString *prefix)
  * @param[in] buf	The input text line to split.
  * @param[in] inc	The input module's context.
  *
- * @returns An array of strings, representing the columns' text.
+ * @returns The number of columns.
  *
  * This routine splits a text line on previously determined separators.
+ * The text gets split in place, trailing whitespace of columns gets
+ * removed. The NULL terminated list of columns in inc->columns is valid
+ * until the next call, its memory gets re-used across text lines.
  */
-static char **split_line(char *buf, struct context *inc)
+static size_t split_line(char *buf, struct context *inc)
 {
-	char **fields, *f;
-	size_t l;
-
-	fields = g_strsplit(buf, inc->delimiter->str, 0);
-	if (!fields)
-		return NULL;
-
-	l = g_strv_length(fields);
-	while (l--) {
-		f = fields[l];
-		g_strchomp(f);
-	}
-
-	return fields;
+	const char *delim;
+	size_t delim_len, count;
+	char *col, *next, *end;
+
+	delim = inc->delimiter->str;
+	delim_len = inc->delimiter->len;
+	count = 0;
+	col = buf;
+	do {
+		if (count + 1 >= inc->columns_alloced) {
+			inc->columns_alloced = 2 * inc->columns_alloced + 16;
+			inc->columns = g_realloc(inc->columns,
+				inc->columns_alloced * sizeof(inc->columns[0]));
+		}
+		if (delim_len == 1)
+			next = strchr(col, delim[0]);
+		else
+			next = strstr(col, delim);
+		end = next ? next : col + strlen(col);
+		while (end > col && g_ascii_isspace(end[-1]))
+			end--;
+		*end = '\0';
+		inc->columns[count++] = col;
+		if (next)
+			col = next + delim_len;
+	} while (next);
+	inc->columns[count] = NULL;
+
+	return count;
 }
 
 /**
@@ -1215,6 +1265,7 @@ static int init(struct sr_input *in, GHashTable *options)
 	inc->samplerate = g_variant_get_uint64(g_hash_table_lookup(options, "samplerate"));
 	first_column = g_variant_get_uint32(g_hash_table_lookup(options, "first_column"));
 	inc->use_header = g_variant_get_boolean(g_hash_table_lookup(options, "header"));
+	inc->threads = g_variant_get_uint32(g_hash_table_lookup(options, "threads"));
 	inc->start_line = g_variant_get_uint32(g_hash_table_lookup(options, "start_line"));
 	if (inc->start_line < 1) {
 		sr_err("Invalid start line %zu.", inc->start_line);
@@ -1349,11 +1400,10 @@ static int initial_parse(const struct sr_input *in, GString *buf)
 	size_t num_columns;
 	size_t line_number, line_idx;
 	int ret;
-	char **lines, *line, **columns;
+	char **lines, *line;
 
 	ret = SR_OK;
 	inc = in->priv;
-	columns = NULL;
 
 	/* Search for the first line to process (header or data). */
 	line_number = 0;
@@ -1387,19 +1437,13 @@ static int initial_parse(const struct sr_input *in, GString *buf)
 	}
 
 	/* Get the number of columns in the line. */
-	columns = split_line(line, inc);
-	if (!columns) {
-		sr_err("Error while parsing line %zu.", line_number);
-		ret = SR_ERR;
-		goto out;
-	}
-	num_columns = g_strv_length(columns);
+	num_columns = split_line(line, inc);
 	if (!num_columns) {
 		sr_err("Error while parsing line %zu.", line_number);
 		ret = SR_ERR;
 		goto out;
 	}
-	sr_dbg("Got %zu columns in text line: %s.", num_columns, line);
+	sr_dbg("Got %zu columns in text line %zu.", num_columns, line_number);
 
 	/*
 	 * Interpret the user provided column format specs. This might
@@ -1411,7 +1455,8 @@ static int initial_parse(const struct sr_input *in, GString *buf)
 	 * Check the then created channels for consistency across .reset
 	 * and .receive sequences (file re-load).
 	 */
-	ret = make_column_details_from_format(in, inc->column_formats, columns);
+	ret = make_column_details_from_format(in, inc->column_formats,
+		inc->columns);
 	if (ret != SR_OK) {
 		sr_err("Cannot parse columns format using line %zu.", line_number);
 		goto out;
@@ -1464,8 +1509,6 @@ static int initial_parse(const struct sr_input *in, GString *buf)
 	}
 
 out:
-	if (columns)
-		g_strfreev(columns);
 	g_strfreev(lines);
 
 	return ret;
@@ -1529,16 +1572,103 @@ static int initial_receive(const struct sr_input *in)
 	return ret;
 }
 
-static int process_buffer(struct sr_input *in, gboolean is_eof)
+/*
+ * Parse one text line of input data into the current sample set. Does
+ * not queue the sample set, is_data tells whether the line had one.
+ */
+static int parse_line(struct context *inc, char *line, gboolean *is_data)
 {
-	struct context *inc;
 	gsize num_columns;
-	size_t line_idx, col_idx, col_nr;
+	size_t col_idx, col_nr;
 	const struct column_details *details;
 	col_parse_cb parse_func;
 	int ret;
+	char *column;
+
+	*is_data = FALSE;
+	inc->line_number++;
+	if (inc->line_number < inc->start_line) {
+		sr_spew("Line %zu skipped (before start).", inc->line_number);
+		return SR_OK;
+	}
+	if (line[0] == '\0') {
+		sr_spew("Blank line %zu skipped.", inc->line_number);
+		return SR_OK;
+	}
+
+	/* Remove trailing comment. */
+	strip_comment(line, inc->comment);
+	if (line[0] == '\0') {
+		sr_spew("Comment-only line %zu skipped.", inc->line_number);
+		return SR_OK;
+	}
+
+	/* Skip the header line, its content was used as the channel names. */
+	if (inc->use_header && !inc->header_seen) {
+		sr_spew("Header line %zu skipped.", inc->line_number);
+		inc->header_seen = TRUE;
+		return SR_OK;
+	}
+
+	/* Split the line into columns, check for minimum length. */
+	num_columns = split_line(line, inc);
+	if (num_columns < inc->column_want_count) {
+		sr_err("Insufficient column count %zu in line %zu.",
+			num_columns, inc->line_number);
+		return SR_ERR;
+	}
+
+	/* Have the columns of the current text line processed. */
+	clear_logic_samples(inc);
+	clear_analog_samples(inc);
+	for (col_idx = 0; col_idx < inc->column_want_count; col_idx++) {
+		column = inc->columns[col_idx];
+		col_nr = col_idx + 1;
+		details = lookup_column_details(inc, col_nr);
+		if (!details || !details->text_format)
+			continue;
+		parse_func = col_parse_funcs[details->text_format];
+		if (!parse_func)
+			continue;
+		ret = parse_func(column, inc, details);
+		if (ret != SR_OK)
+			return SR_ERR;
+	}
+	*is_data = TRUE;
+
+	return SR_OK;
+}
+
+/* Process one text line of input data. */
+static int process_line(struct sr_input *in, char *line)
+{
+	struct context *inc;
+	gboolean is_data;
+	int ret;
+
+	inc = in->priv;
+	ret = parse_line(inc, line, &is_data);
+	if (ret != SR_OK || !is_data)
+		return ret;
+
+	/* Send sample data to the session bus (buffered). */
+	ret = queue_logic_samples(in);
+	ret += queue_analog_samples(in);
+	if (ret != SR_OK) {
+		sr_err("Sending samples failed.");
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+static int process_buffer(struct sr_input *in, gboolean is_eof)
+{
+	struct context *inc;
+	size_t term_len;
+	int ret;
 	char *processed_up_to;
-	char **lines, *line, **columns, *column;
+	char *line, *next;
 
 	inc = in->priv;
 	if (!inc->started) {
@@ -1572,83 +1702,20 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 		processed_up_to += strlen(inc->termination);
 	}
 
-	/* Split input text lines and process their columns. */
+	/* Split input text lines in place and process their columns. */
 	ret = SR_OK;
-	lines = g_strsplit(in->buf->str, inc->termination, 0);
-	for (line_idx = 0; (line = lines[line_idx]); line_idx++) {
-		inc->line_number++;
-		if (inc->line_number < inc->start_line) {
-			sr_spew("Line %zu skipped (before start).", inc->line_number);
-			continue;
-		}
-		if (line[0] == '\0') {
-			sr_spew("Blank line %zu skipped.", inc->line_number);
-			continue;
-		}
-
-		/* Remove trailing comment. */
-		strip_comment(line, inc->comment);
-		if (line[0] == '\0') {
-			sr_spew("Comment-only line %zu skipped.", inc->line_number);
-			continue;
+	term_len = strlen(inc->termination);
+	line = in->buf->str[0] ? in->buf->str : NULL;
+	while (line) {
+		next = strstr(line, inc->termination);
+		if (next) {
+			*next = '\0';
+			next += term_len;
 		}
-
-		/* Skip the header line, its content was used as the channel names. */
-		if (inc->use_header && !inc->header_seen) {
-			sr_spew("Header line %zu skipped.", inc->line_number);
-			inc->header_seen = TRUE;
-			continue;
-		}
-
-		/* Split the line into columns, check for minimum length. */
-		columns = split_line(line, inc);
-		if (!columns) {
-			sr_err("Error while parsing line %zu.", inc->line_number);
-			g_strfreev(lines);
-			return SR_ERR;
-		}
-		num_columns = g_strv_length(columns);
-		if (num_columns < inc->column_want_count) {
-			sr_err("Insufficient column count %zu in line %zu.",
-				num_columns, inc->line_number);
-			g_strfreev(columns);
-			g_strfreev(lines);
-			return SR_ERR;
-		}
-
-		/* Have the columns of the current text line processed. */
-		clear_logic_samples(inc);
-		clear_analog_samples(inc);
-		for (col_idx = 0; col_idx < inc->column_want_count; col_idx++) {
-			column = columns[col_idx];
-			col_nr = col_idx + 1;
-			details = lookup_column_details(inc, col_nr);
-			if (!details || !details->text_format)
-				continue;
-			parse_func = col_parse_funcs[details->text_format];
-			if (!parse_func)
-				continue;
-			ret = parse_func(column, inc, details);
-			if (ret != SR_OK) {
-				g_strfreev(columns);
-				g_strfreev(lines);
-				return SR_ERR;
-			}
-		}
-
-		/* Send sample data to the session bus (buffered). */
-		ret = queue_logic_samples(in);
-		ret += queue_analog_samples(in);
-		if (ret != SR_OK) {
-			sr_err("Sending samples failed.");
-			g_strfreev(columns);
-			g_strfreev(lines);
-			return SR_ERR;
-		}
-
-		g_strfreev(columns);
+		if ((ret = process_line(in, line)) != SR_OK)
+			break;
+		line = next;
 	}
-	g_strfreev(lines);
 	g_string_erase(in->buf, 0, processed_up_to - in->buf->str);
 
 	return ret;
@@ -1680,6 +1747,318 @@ static int receive(struct sr_input *in, GString *buf)
 	return ret;
 }
 
+/*
+ * Get the next text line of a read-only buffer. Only the current line
+ * gets copied, the parser modifies the text. The buffer ends on a line
+ * boundary, so a last line without a termination is complete, too.
+ */
+static char *next_mapped_line(const struct context *inc, GString *line,
+	const char **data, size_t *len)
+{
+	const char *eol;
+	size_t count;
+
+	if (!*len)
+		return NULL;
+	eol = g_strstr_len(*data, *len, inc->termination);
+	count = eol ? (size_t)(eol - *data) : *len;
+	g_string_truncate(line, 0);
+	g_string_append_len(line, *data, count);
+	if (eol)
+		count += strlen(inc->termination);
+	*data += count;
+	*len -= count;
+
+	return line->str;
+}
+
+static int process_mapped_lines(struct sr_input *in,
+	const char *data, size_t len)
+{
+	struct context *inc;
+	char *line;
+	int ret;
+
+	inc = in->priv;
+	if (!inc->line)
+		inc->line = g_string_sized_new(256);
+	while ((line = next_mapped_line(inc, inc->line, &data, &len))) {
+		if ((ret = process_line(in, line)) != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+/* Get the length of the block which ends on the next line boundary. */
+static size_t mapped_block_length(const struct context *inc,
+	const char *data, size_t len)
+{
+	const char *eol;
+
+	if (len <= PARSE_BLOCK_SIZE)
+		return len;
+	eol = g_strstr_len(data + PARSE_BLOCK_SIZE, len - PARSE_BLOCK_SIZE,
+		inc->termination);
+	if (!eol)
+		return len;
+
+	return eol - data + strlen(inc->termination);
+}
+
+static void parse_job_run(void *data, void *user_data)
+{
+	struct csv_job *job;
+	struct context *ctx;
+	const char *rdptr;
+	size_t len;
+	char *line;
+	gboolean is_data;
+	int ret;
+
+	job = data;
+	(void)user_data;
+
+	ctx = &job->ctx;
+	rdptr = job->data;
+	len = job->len;
+	ret = SR_OK;
+	while ((line = next_mapped_line(ctx, job->line, &rdptr, &len))) {
+		ret = parse_line(ctx, line, &is_data);
+		if (ret != SR_OK)
+			break;
+		if (!is_data)
+			continue;
+		if (ctx->logic_channels)
+			ctx->datafeed_buf_fill += ctx->sample_unit_size;
+		if (ctx->analog_channels)
+			ctx->analog_datafeed_buf_fill++;
+	}
+	job->ret = ret;
+
+	g_mutex_lock(&job->mutex);
+	job->done = TRUE;
+	g_cond_signal(&job->cond);
+	g_mutex_unlock(&job->mutex);
+}
+
+static struct csv_job *parse_job_new(const struct context *inc,
+	const char *data, size_t len)
+{
+	struct csv_job *job;
+	struct context *ctx;
+	const char *p, *end;
+	char term_last;
+	size_t rows;
+
+	job = g_malloc0(sizeof(*job));
+	job->data = data;
+	job->len = len;
+
+	/* Count text lines, to size the buffers and to number lines. */
+	rows = 0;
+	term_last = inc->termination[strlen(inc->termination) - 1];
+	end = data + len;
+	for (p = data; (p = memchr(p, term_last, end - p)); p++)
+		rows++;
+	job->lines = rows;
+	if (len && end[-1] != term_last)
+		job->lines++;
+	rows++;
+
+	ctx = &job->ctx;
+	*ctx = *inc;
+	ctx->columns = NULL;
+	ctx->columns_alloced = 0;
+	ctx->line = NULL;
+	ctx->pool = NULL;
+	if (inc->logic_channels) {
+		ctx->datafeed_buf_size = rows * inc->sample_unit_size;
+		ctx->datafeed_buffer = g_malloc(ctx->datafeed_buf_size);
+		ctx->datafeed_buf_fill = 0;
+	}
+	if (inc->analog_channels) {
+		ctx->analog_datafeed_buf_size = rows;
+		ctx->analog_datafeed_buffer = g_malloc0(rows *
+			inc->analog_channels * sizeof(ctx->analog_datafeed_buffer[0]));
+		ctx->analog_datafeed_buf_fill = 0;
+	}
+	job->line = g_string_sized_new(256);
+	g_mutex_init(&job->mutex);
+	g_cond_init(&job->cond);
+
+	return job;
+}
+
+static void parse_job_wait(struct csv_job *job)
+{
+	g_mutex_lock(&job->mutex);
+	while (!job->done)
+		g_cond_wait(&job->cond, &job->mutex);
+	g_mutex_unlock(&job->mutex);
+}
+
+static void parse_job_free(struct csv_job *job)
+{
+	parse_job_wait(job);
+	g_mutex_clear(&job->mutex);
+	g_cond_clear(&job->cond);
+	g_free(job->ctx.columns);
+	g_free(job->ctx.datafeed_buffer);
+	g_free(job->ctx.analog_datafeed_buffer);
+	g_string_free(job->line, TRUE);
+	g_free(job);
+}
+
+/* Queue a worker's sample sets in input data order. */
+static int parse_job_apply(struct sr_input *in, struct csv_job *job)
+{
+	struct context *inc, *ctx;
+	size_t done, count, ch_idx;
+	csv_analog_t *src, *dst;
+	int ret;
+
+	inc = in->priv;
+	ctx = &job->ctx;
+
+	done = 0;
+	while (done < ctx->datafeed_buf_fill) {
+		count = inc->datafeed_buf_size - inc->datafeed_buf_fill;
+		count = MIN(count, ctx->datafeed_buf_fill - done);
+		memcpy(&inc->datafeed_buffer[inc->datafeed_buf_fill],
+			&ctx->datafeed_buffer[done], count);
+		inc->datafeed_buf_fill += count;
+		done += count;
+		if (inc->datafeed_buf_fill == inc->datafeed_buf_size) {
+			ret = flush_logic_samples(in);
+			if (ret != SR_OK)
+				return ret;
+		}
+	}
+
+	done = 0;
+	while (done < ctx->analog_datafeed_buf_fill) {
+		count = inc->analog_datafeed_buf_size - inc->analog_datafeed_buf_fill;
+		count = MIN(count, ctx->analog_datafeed_buf_fill - done);
+		for (ch_idx = 0; ch_idx < inc->analog_channels; ch_idx++) {
+			src = &ctx->analog_datafeed_buffer[ch_idx * ctx->analog_datafeed_buf_size];
+			dst = &inc->analog_datafeed_buffer[ch_idx * inc->analog_datafeed_buf_size];
+			memcpy(&dst[inc->analog_datafeed_buf_fill], &src[done],
+				count * sizeof(src[0]));
+		}
+		inc->analog_datafeed_buf_fill += count;
+		done += count;
+		if (inc->analog_datafeed_buf_fill == inc->analog_datafeed_buf_size) {
+			ret = flush_analog_samples(in);
+			if (ret != SR_OK)
+				return ret;
+		}
+	}
+
+	inc->line_number = ctx->line_number;
+
+	return SR_OK;
+}
+
+/*
+ * Have workers parse blocks of mapped input in parallel, and queue
+ * their sample sets in input data order. Keep a few more blocks in
+ * flight than there are workers, which bounds memory consumption.
+ * Workers get the line number where their block starts, so that
+ * diagnostics match those of sequential processing.
+ */
+static int parse_parallel(struct sr_input *in, const char *data, size_t len)
+{
+	struct context *inc;
+	struct csv_job *job;
+	size_t max_jobs, line_number;
+	int ret;
+
+	inc = in->priv;
+
+	if (!inc->pool) {
+		inc->pool = g_thread_pool_new(parse_job_run, NULL,
+			inc->threads, FALSE, NULL);
+		g_queue_init(&inc->jobs);
+	}
+	max_jobs = 2 * inc->threads;
+
+	ret = SR_OK;
+	line_number = inc->line_number;
+	while (len || !g_queue_is_empty(&inc->jobs)) {
+		while (len && g_queue_get_length(&inc->jobs) < max_jobs) {
+			job = parse_job_new(inc, data,
+				mapped_block_length(inc, data, len));
+			job->ctx.line_number = line_number;
+			line_number += job->lines;
+			data += job->len;
+			len -= job->len;
+			g_queue_push_tail(&inc->jobs, job);
+			g_thread_pool_push(inc->pool, job, NULL);
+		}
+		job = g_queue_pop_head(&inc->jobs);
+		parse_job_wait(job);
+		ret = job->ret;
+		if (ret == SR_OK)
+			ret = parse_job_apply(in, job);
+		parse_job_free(job);
+		if (ret != SR_OK)
+			break;
+	}
+
+	/* Wait for and discard the remaining blocks after errors. */
+	while ((job = g_queue_pop_head(&inc->jobs)))
+		parse_job_free(job);
+
+	return ret;
+}
+
+static int receive_mapped(struct sr_input *in, const char *data, size_t len)
+{
+	struct context *inc;
+	const char *eol;
+	size_t term_len, count;
+	int ret;
+
+	inc = in->priv;
+	term_len = strlen(inc->termination);
+
+	/* Complete and process the text which receive() has buffered. */
+	if (in->buf->len) {
+		eol = g_strstr_len(data, len, inc->termination);
+		count = eol ? (size_t)(eol - data) + term_len : len;
+		g_string_append_len(in->buf, data, count);
+		data += count;
+		len -= count;
+		if ((ret = process_buffer(in, FALSE)) != SR_OK)
+			return ret;
+	}
+	if (!inc->started) {
+		std_session_send_df_header(in->sdi);
+		inc->started = TRUE;
+	}
+	if (!inc->threads)
+		return process_mapped_lines(in, data, len);
+
+	/*
+	 * Process the first block sequentially. This skips lines before
+	 * the start line and the header line, and lets timestamps
+	 * determine the samplerate. Have workers process the remainder
+	 * when this is complete.
+	 */
+	count = mapped_block_length(inc, data, len);
+	if ((ret = process_mapped_lines(in, data, count)) != SR_OK)
+		return ret;
+	data += count;
+	len -= count;
+	if (inc->line_number < inc->start_line)
+		return process_mapped_lines(in, data, len);
+	if (inc->use_header && !inc->header_seen)
+		return process_mapped_lines(in, data, len);
+
+	return parse_parallel(in, data, len);
+}
+
 static int end(struct sr_input *in)
 {
 	struct context *inc;
@@ -1716,6 +2095,15 @@ static void cleanup(struct sr_input *in)
 
 	g_free(inc->termination);
 	inc->termination = NULL;
+	g_free(inc->columns);
+	inc->columns = NULL;
+	inc->columns_alloced = 0;
+	if (inc->pool)
+		g_thread_pool_free(inc->pool, FALSE, TRUE);
+	inc->pool = NULL;
+	if (inc->line)
+		g_string_free(inc->line, TRUE);
+	inc->line = NULL;
 	g_free(inc->datafeed_buffer);
 	inc->datafeed_buffer = NULL;
 	g_free(inc->analog_datafeed_buffer);
@@ -1738,6 +2126,7 @@ static void cleanup(struct sr_input *in)
 	inc->use_header = save_ctx.use_header;
 	inc->prev_sr_channels = save_ctx.prev_sr_channels;
 	inc->prev_df_channels = save_ctx.prev_df_channels;
+	inc->threads = save_ctx.threads;
 }
 
 static int reset(struct sr_input *in)
@@ -1763,6 +2152,7 @@ enum option_index {
 	OPT_SAMPLERATE,
 	OPT_COL_SEP,
 	OPT_COMMENT,
+	OPT_THREADS,
 	OPT_MAX,
 };
 
@@ -1817,6 +2207,11 @@ static struct sr_option options[] = {
 		"The text which starts comments at the end of text lines, semicolon by default.",
 		NULL, NULL,
 	},
+	[OPT_THREADS] = {
+		"threads", "Parser threads",
+		"Number of threads which parse text lines of memory mapped input files (0 = parse in the caller's thread).",
+		NULL, NULL,
+	},
 	[OPT_MAX] = ALL_ZERO,
 };
 
@@ -1840,6 +2235,7 @@ static const struct sr_option *get_options(void)
 		options[OPT_SAMPLERATE].def = g_variant_ref_sink(g_variant_new_uint64(0));
 		options[OPT_COL_SEP].def = g_variant_ref_sink(g_variant_new_string(","));
 		options[OPT_COMMENT].def = g_variant_ref_sink(g_variant_new_string(";"));
+		options[OPT_THREADS].def = g_variant_ref_sink(g_variant_new_uint32(0));
 	}
 
 	return options;
@@ -1851,10 +2247,12 @@ SR_PRIV struct sr_input_module input_csv = {
 	.desc = "Comma-separated values",
 	.exts = (const char*[]){"csv", NULL},
 	.metadata = { SR_INPUT_META_FILENAME, SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED },
+	.flags = SR_INPUT_MAPPED | SR_INPUT_TEXT,
 	.options = get_options,
 	.format_match = format_match,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = receive_mapped,
 	.end = end,
 	.cleanup = cleanup,
 	.reset = reset,
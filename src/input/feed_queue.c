@@ -21,12 +21,68 @@
 #include "libsigrok-internal.h"
 #include <string.h>
 
+/*
+ * Latency bound for queues of slow sources: Flush when the oldest queued
+ * sample exceeds the maximum age, even when the queue is not full yet.
+ * Gets checked upon submission, and by a timer in the session's main
+ * context for sources which stall.
+ */
+struct feed_queue_deadline {
+	int64_t max_age_us;
+	int64_t first_us;
+	struct sr_session *session;
+};
+
+static void deadline_start(struct feed_queue_deadline *d, size_t fill_count)
+{
+	if (d->max_age_us && !fill_count)
+		d->first_us = g_get_monotonic_time();
+}
+
+static gboolean deadline_due(const struct feed_queue_deadline *d)
+{
+	if (!d->max_age_us)
+		return FALSE;
+
+	return g_get_monotonic_time() - d->first_us >= d->max_age_us;
+}
+
+static int deadline_set(struct feed_queue_deadline *d, void *key,
+	struct sr_dev_inst *sdi, uint64_t max_age_ms,
+	sr_receive_data_callback cb)
+{
+	int ret;
+
+	if (d->session)
+		sr_session_source_remove_internal(d->session, key);
+	d->session = NULL;
+	d->max_age_us = 1000 * (int64_t)max_age_ms;
+	if (!max_age_ms || !sdi || !sdi->session)
+		return SR_OK;
+
+	ret = sr_session_fd_source_add(sdi->session, key, -1, 0,
+		MAX(max_age_ms / 2, 1), cb, key);
+	if (ret != SR_OK)
+		return ret;
+	d->session = sdi->session;
+
+	return SR_OK;
+}
+
+static void deadline_free(struct feed_queue_deadline *d, void *key)
+{
+	if (d->session)
+		sr_session_source_remove_internal(d->session, key);
+	d->session = NULL;
+}
+
 struct feed_queue_logic {
 	struct sr_dev_inst *sdi;
 	size_t unit_size;
 	size_t alloc_count;
 	size_t fill_count;
 	uint8_t *data_bytes;
+	struct feed_queue_deadline deadline;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
 };
@@ -56,28 +112,140 @@ SR_API struct feed_queue_logic *feed_queue_logic_alloc(struct sr_dev_inst *sdi,
 	return q;
 }
 
+/* Repeat one sample value, the run is a multiple of the unit size. */
+static void fill_pattern(uint8_t *wrptr, const uint8_t *data,
+	size_t unit_size, size_t count)
+{
+	size_t done, total, chunk;
+
+	if (unit_size == 1) {
+		memset(wrptr, data[0], count);
+		return;
+	}
+
+	/* Double the already written part until the run is complete. */
+	total = count * unit_size;
+	memcpy(wrptr, data, unit_size);
+	done = unit_size;
+	while (done < total) {
+		chunk = MIN(done, total - done);
+		memcpy(&wrptr[done], wrptr, chunk);
+		done += chunk;
+	}
+}
+
 SR_API int feed_queue_logic_submit(struct feed_queue_logic *q,
 	const uint8_t *data, size_t count)
 {
 	uint8_t *wrptr;
+	size_t chunk;
 	int ret;
 
-	wrptr = &q->data_bytes[q->fill_count * q->unit_size];
-	while (count--) {
-		memcpy(wrptr, data, q->unit_size);
-		wrptr += q->unit_size;
-		q->fill_count++;
+	while (count) {
 		if (q->fill_count == q->alloc_count) {
 			ret = feed_queue_logic_flush(q);
 			if (ret != SR_OK)
 				return ret;
-			wrptr = &q->data_bytes[0];
 		}
+		chunk = MIN(count, q->alloc_count - q->fill_count);
+		wrptr = &q->data_bytes[q->fill_count * q->unit_size];
+		fill_pattern(wrptr, data, q->unit_size, chunk);
+		ret = feed_queue_logic_commit(q, chunk);
+		if (ret != SR_OK)
+			return ret;
+		count -= chunk;
 	}
 
 	return SR_OK;
 }
 
+SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
+	const uint8_t *data, size_t count)
+{
+	uint8_t *wrptr;
+	size_t chunk;
+	int ret;
+
+	while (count) {
+		if (q->fill_count == q->alloc_count) {
+			ret = feed_queue_logic_flush(q);
+			if (ret != SR_OK)
+				return ret;
+		}
+		chunk = MIN(count, q->alloc_count - q->fill_count);
+		wrptr = &q->data_bytes[q->fill_count * q->unit_size];
+		memcpy(wrptr, data, chunk * q->unit_size);
+		data += chunk * q->unit_size;
+		ret = feed_queue_logic_commit(q, chunk);
+		if (ret != SR_OK)
+			return ret;
+		count -= chunk;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Get space for up to *count samples in the queue's buffer, for callers
+ * which decode directly into it. Upon return *count holds the number of
+ * samples which fit, which is at least one. Call feed_queue_logic_commit()
+ * with the number of samples which were actually written. Returns NULL
+ * when a pending flush fails.
+ */
+SR_API uint8_t *feed_queue_logic_reserve(struct feed_queue_logic *q,
+	size_t *count)
+{
+	size_t space;
+
+	if (q->fill_count == q->alloc_count) {
+		if (feed_queue_logic_flush(q) != SR_OK)
+			return NULL;
+	}
+	space = q->alloc_count - q->fill_count;
+	if (*count > space)
+		*count = space;
+
+	return &q->data_bytes[q->fill_count * q->unit_size];
+}
+
+SR_API int feed_queue_logic_commit(struct feed_queue_logic *q, size_t count)
+{
+	if (count > q->alloc_count - q->fill_count)
+		return SR_ERR_ARG;
+
+	deadline_start(&q->deadline, q->fill_count);
+	q->fill_count += count;
+	if (q->fill_count == q->alloc_count || deadline_due(&q->deadline))
+		return feed_queue_logic_flush(q);
+
+	return SR_OK;
+}
+
+static int feed_queue_logic_timer(int fd, int revents, void *cb_data)
+{
+	struct feed_queue_logic *q;
+
+	(void)fd;
+	(void)revents;
+
+	q = cb_data;
+	if (q->fill_count && deadline_due(&q->deadline))
+		(void)feed_queue_logic_flush(q);
+
+	return TRUE;
+}
+
+/*
+ * Bound the latency of queued samples to max_age_ms, zero disables.
+ * The queue must be freed before its device's session then.
+ */
+SR_API int feed_queue_logic_set_max_age(struct feed_queue_logic *q,
+	uint64_t max_age_ms)
+{
+	return deadline_set(&q->deadline, q, q->sdi, max_age_ms,
+		feed_queue_logic_timer);
+}
+
 SR_API int feed_queue_logic_flush(struct feed_queue_logic *q)
 {
 	int ret;
@@ -100,6 +268,7 @@ SR_API void feed_queue_logic_free(struct feed_queue_logic *q)
 	if (!q)
 		return;
 
+	deadline_free(&q->deadline, q);
 	g_free(q->data_bytes);
 	g_free(q);
 }
@@ -108,8 +277,11 @@ struct feed_queue_analog {
 	struct sr_dev_inst *sdi;
 	size_t alloc_count;
 	size_t fill_count;
-	float *data_values;
+	size_t num_channels;
+	size_t frame_size;
+	uint8_t *data_bytes;
 	int digits;
+	struct feed_queue_deadline deadline;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
@@ -122,41 +294,184 @@ SR_API struct feed_queue_analog *feed_queue_analog_alloc(struct sr_dev_inst *sdi
 	size_t sample_count, int digits, struct sr_channel *ch)
 {
 	struct feed_queue_analog *q;
+	GSList *channels;
+
+	channels = g_slist_append(NULL, ch);
+	q = feed_queue_analog_alloc_multi(sdi, sample_count, digits,
+		channels, NULL);
+	g_slist_free(channels);
+
+	return q;
+}
+
+/*
+ * Queue frames of all the given channels, which get sent in common
+ * packets with interleaved values. The optional encoding describes
+ * native sample data which is not float, its digits field is ignored.
+ */
+SR_API struct feed_queue_analog *feed_queue_analog_alloc_multi(
+	struct sr_dev_inst *sdi, size_t sample_count, int digits,
+	GSList *channels, const struct sr_analog_encoding *encoding)
+{
+	struct feed_queue_analog *q;
+
+	if (!channels || !sample_count)
+		return NULL;
 
 	q = g_malloc0(sizeof(*q));
 	q->sdi = sdi;
 	q->alloc_count = sample_count;
-	q->data_values = g_try_malloc(q->alloc_count * sizeof(float));
-	if (!q->data_values) {
-		g_free(q);
-		return NULL;
-	}
 	q->digits = digits;
-	q->channels = g_slist_append(NULL, ch);
+	q->channels = g_slist_copy(channels);
+	q->num_channels = g_slist_length(q->channels);
 
 	memset(&q->packet, 0, sizeof(q->packet));
 	sr_analog_init(&q->analog, &q->encoding, &q->meaning, &q->spec, digits);
 	q->packet.type = SR_DF_ANALOG;
 	q->packet.payload = &q->analog;
 	q->encoding.is_signed = TRUE;
+	if (encoding) {
+		q->encoding = *encoding;
+		q->encoding.digits = digits;
+	}
 	q->meaning.channels = q->channels;
-	q->analog.data = q->data_values;
+
+	q->frame_size = q->num_channels * q->encoding.unitsize;
+	q->data_bytes = g_try_malloc(q->alloc_count * q->frame_size);
+	if (!q->data_bytes) {
+		g_slist_free(q->channels);
+		g_free(q);
+		return NULL;
+	}
+	q->analog.data = q->data_bytes;
 
 	return q;
 }
 
+static int feed_queue_analog_commit(struct feed_queue_analog *q, size_t count)
+{
+	deadline_start(&q->deadline, q->fill_count);
+	q->fill_count += count;
+	if (q->fill_count == q->alloc_count || deadline_due(&q->deadline))
+		return feed_queue_analog_flush(q);
+
+	return SR_OK;
+}
+
+static int feed_queue_analog_timer(int fd, int revents, void *cb_data)
+{
+	struct feed_queue_analog *q;
+
+	(void)fd;
+	(void)revents;
+
+	q = cb_data;
+	if (q->fill_count && deadline_due(&q->deadline))
+		(void)feed_queue_analog_flush(q);
+
+	return TRUE;
+}
+
+/* Like feed_queue_logic_set_max_age(). */
+SR_API int feed_queue_analog_set_max_age(struct feed_queue_analog *q,
+	uint64_t max_age_ms)
+{
+	return deadline_set(&q->deadline, q, q->sdi, max_age_ms,
+		feed_queue_analog_timer);
+}
+
 SR_API int feed_queue_analog_submit(struct feed_queue_analog *q,
 	float data, size_t count)
 {
+	float *values;
+	size_t chunk, i;
 	int ret;
 
-	while (count--) {
-		q->data_values[q->fill_count++] = data;
+	/* Single float values only apply to single float channels. */
+	if (q->num_channels != 1 || !q->encoding.is_float ||
+			q->encoding.unitsize != sizeof(float))
+		return SR_ERR_ARG;
+
+	values = (float *)q->data_bytes;
+	while (count) {
 		if (q->fill_count == q->alloc_count) {
 			ret = feed_queue_analog_flush(q);
 			if (ret != SR_OK)
 				return ret;
 		}
+		chunk = MIN(count, q->alloc_count - q->fill_count);
+		for (i = 0; i < chunk; i++)
+			values[q->fill_count + i] = data;
+		ret = feed_queue_analog_commit(q, chunk);
+		if (ret != SR_OK)
+			return ret;
+		count -= chunk;
+	}
+
+	return SR_OK;
+}
+
+/* Submit count frames, each holding the values of all channels. */
+SR_API int feed_queue_analog_submit_interleaved(struct feed_queue_analog *q,
+	const void *data, size_t count)
+{
+	const uint8_t *rdptr;
+	size_t chunk;
+	int ret;
+
+	rdptr = data;
+	while (count) {
+		if (q->fill_count == q->alloc_count) {
+			ret = feed_queue_analog_flush(q);
+			if (ret != SR_OK)
+				return ret;
+		}
+		chunk = MIN(count, q->alloc_count - q->fill_count);
+		memcpy(&q->data_bytes[q->fill_count * q->frame_size],
+			rdptr, chunk * q->frame_size);
+		rdptr += chunk * q->frame_size;
+		ret = feed_queue_analog_commit(q, chunk);
+		if (ret != SR_OK)
+			return ret;
+		count -= chunk;
+	}
+
+	return SR_OK;
+}
+
+/* Submit count values for each channel, from one array per channel. */
+SR_API int feed_queue_analog_submit_planar(struct feed_queue_analog *q,
+	const void *const *data, size_t count)
+{
+	const uint8_t *rdptr;
+	uint8_t *wrptr;
+	size_t unit_size, done, chunk, ch, i;
+	int ret;
+
+	unit_size = q->encoding.unitsize;
+	done = 0;
+	while (count) {
+		if (q->fill_count == q->alloc_count) {
+			ret = feed_queue_analog_flush(q);
+			if (ret != SR_OK)
+				return ret;
+		}
+		chunk = MIN(count, q->alloc_count - q->fill_count);
+		for (ch = 0; ch < q->num_channels; ch++) {
+			rdptr = (const uint8_t *)data[ch] + done * unit_size;
+			wrptr = &q->data_bytes[q->fill_count * q->frame_size];
+			wrptr += ch * unit_size;
+			for (i = 0; i < chunk; i++) {
+				memcpy(wrptr, rdptr, unit_size);
+				rdptr += unit_size;
+				wrptr += q->frame_size;
+			}
+		}
+		ret = feed_queue_analog_commit(q, chunk);
+		if (ret != SR_OK)
+			return ret;
+		done += chunk;
+		count -= chunk;
 	}
 
 	return SR_OK;
@@ -184,7 +499,8 @@ SR_API void feed_queue_analog_free(struct feed_queue_analog *q)
 	if (!q)
 		return;
 
-	g_free(q->data_values);
+	deadline_free(&q->deadline, q);
+	g_free(q->data_bytes);
 	g_slist_free(q->channels);
 	g_free(q);
 }
@@ -67,6 +67,7 @@ extern SR_PRIV struct sr_input_module input_chronovu_la8;
 extern SR_PRIV struct sr_input_module input_csv;
 extern SR_PRIV struct sr_input_module input_binary;
 extern SR_PRIV struct sr_input_module input_trace32_ad;
+extern SR_PRIV struct sr_input_module input_srnet;
 extern SR_PRIV struct sr_input_module input_vcd;
 extern SR_PRIV struct sr_input_module input_wav;
 extern SR_PRIV struct sr_input_module input_raw_analog;
@@ -80,6 +81,7 @@ static const struct sr_input_module *input_module_list[] = {
 	&input_chronovu_la8,
 	&input_csv,
 	&input_trace32_ad,
+	&input_srnet,
 	&input_vcd,
 	&input_wav,
 	&input_raw_analog,
@@ -340,6 +342,124 @@ static gboolean check_required_metadata(const uint8_t *metadata, uint8_t *avail)
 	return TRUE;
 }
 
+/*
+ * Cheap classification of the input data, which is done once before
+ * the modules get to run their (potentially expensive) format checks.
+ * Like other tools do, take NUL bytes near the start as an indication
+ * of binary data.
+ */
+#define TEXT_CHECK_SIZE	8000
+
+static gboolean header_is_text(const GString *header)
+{
+	if (!header || !header->str)
+		return TRUE;
+
+	return !memchr(header->str, '\0', MIN(header->len, TEXT_CHECK_SIZE));
+}
+
+static gboolean module_has_ext(const struct sr_input_module *imod,
+		const char *filename)
+{
+	const char *ext;
+	size_t i;
+
+	if (!filename || !imod->exts)
+		return FALSE;
+	ext = strrchr(filename, '.');
+	if (!ext || !*++ext)
+		return FALSE;
+	for (i = 0; imod->exts[i]; i++) {
+		if (g_ascii_strcasecmp(imod->exts[i], ext) == 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* The order in which format_match() of input modules gets tried. */
+enum match_rank {
+	RANK_EXTENSION,	/* Filename has one of the module's extensions. */
+	RANK_DEFAULT,	/* No hints, the check is expected to be cheap. */
+	RANK_TEXT,	/* Text content checks, which tend to be expensive. */
+	RANK_COUNT,
+	RANK_SKIP = RANK_COUNT,
+};
+
+/*
+ * Run the modules' format checks on the given metadata, and return the
+ * module with the best confidence. Modules get tried in the order of
+ * enum match_rank, and the search stops at the first definite match
+ * (a confidence of 1). Ties are resolved in the order of the module
+ * list, which keeps the result independent of the order of trying.
+ */
+static const struct sr_input_module *find_module(GHashTable *meta,
+		uint8_t *avail_metadata)
+{
+	const struct sr_input_module *imod, *best_imod;
+	enum match_rank rank, module_rank[G_N_ELEMENTS(input_module_list)];
+	const char *filename;
+	gboolean is_text;
+	unsigned int conf, best_conf;
+	size_t i, best_idx;
+	int ret;
+
+	filename = g_hash_table_lookup(meta,
+		GINT_TO_POINTER(SR_INPUT_META_FILENAME));
+	is_text = header_is_text(g_hash_table_lookup(meta,
+		GINT_TO_POINTER(SR_INPUT_META_HEADER)));
+
+	for (i = 0; (imod = input_module_list[i]); i++) {
+		if (!imod->metadata[0]) {
+			/* Module has no metadata for matching so will take
+			 * any input. No point in letting it try to match. */
+			module_rank[i] = RANK_SKIP;
+		} else if (!check_required_metadata(imod->metadata, avail_metadata)) {
+			/* Cannot satisfy this module's requirements. */
+			module_rank[i] = RANK_SKIP;
+		} else if (module_has_ext(imod, filename)) {
+			module_rank[i] = RANK_EXTENSION;
+		} else if (!(imod->flags & SR_INPUT_TEXT)) {
+			module_rank[i] = RANK_DEFAULT;
+		} else if (is_text) {
+			module_rank[i] = RANK_TEXT;
+		} else {
+			/* Text format, but binary input data. */
+			module_rank[i] = RANK_SKIP;
+		}
+	}
+
+	best_imod = NULL;
+	best_conf = ~0;
+	best_idx = 0;
+	for (rank = 0; rank < RANK_COUNT && best_conf > 1; rank++) {
+		for (i = 0; (imod = input_module_list[i]); i++) {
+			if (module_rank[i] != rank)
+				continue;
+			sr_dbg("Trying module %s.", imod->id);
+			ret = imod->format_match(meta, &conf);
+			if (ret == SR_ERR) {
+				/* Module didn't recognize this buffer. */
+				continue;
+			} else if (ret != SR_OK) {
+				/* Module recognized this buffer, but cannot handle it. */
+				continue;
+			}
+			/* Found a matching module. */
+			sr_dbg("Module %s matched, confidence %u.", imod->id, conf);
+			if (conf > best_conf || (conf == best_conf && i > best_idx))
+				continue;
+			best_imod = imod;
+			best_conf = conf;
+			best_idx = i;
+			if (best_conf <= 1)
+				break;
+		}
+	}
+
+	return best_imod;
+}
+
 /**
  * Try to find an input module that can parse the given buffer.
  *
@@ -353,6 +473,8 @@ static gboolean check_required_metadata(const uint8_t *metadata, uint8_t *avail)
  * Otherwise, *in contains NULL. When multiple input moduless claim
  * support for the format, the one with highest confidence takes
  * precedence. Applications will see at most one input module spec.
+ * Text format modules are skipped for binary input data, and the
+ * search stops at the first definite match.
  *
  * If an instance is created, it has the given buffer used for scanning
  * already submitted to it, to be processed before more data is sent.
@@ -363,66 +485,22 @@ static gboolean check_required_metadata(const uint8_t *metadata, uint8_t *avail)
  */
 SR_API int sr_input_scan_buffer(GString *buf, const struct sr_input **in)
 {
-	const struct sr_input_module *imod, *best_imod;
+	const struct sr_input_module *imod;
 	GHashTable *meta;
-	unsigned int m, i;
-	unsigned int conf, best_conf;
-	int ret;
-	uint8_t mitem, avail_metadata[8];
+	uint8_t avail_metadata[8];
 
 	/* No more metadata to be had from a buffer. */
 	avail_metadata[0] = SR_INPUT_META_HEADER;
 	avail_metadata[1] = 0;
 
 	*in = NULL;
-	best_imod = NULL;
-	best_conf = ~0;
-	for (i = 0; input_module_list[i]; i++) {
-		imod = input_module_list[i];
-		if (!imod->metadata[0]) {
-			/* Module has no metadata for matching so will take
-			 * any input. No point in letting it try to match. */
-			continue;
-		}
-		if (!check_required_metadata(imod->metadata, avail_metadata))
-			/* Cannot satisfy this module's requirements. */
-			continue;
-
-		meta = g_hash_table_new(NULL, NULL);
-		for (m = 0; m < sizeof(imod->metadata); m++) {
-			mitem = imod->metadata[m] & ~SR_INPUT_META_REQUIRED;
-			if (mitem == SR_INPUT_META_HEADER)
-				g_hash_table_insert(meta, GINT_TO_POINTER(mitem), buf);
-		}
-		if (g_hash_table_size(meta) == 0) {
-			/* No metadata for this module, so nothing to match. */
-			g_hash_table_destroy(meta);
-			continue;
-		}
-		sr_spew("Trying module %s.", imod->id);
-		ret = imod->format_match(meta, &conf);
-		g_hash_table_destroy(meta);
-		if (ret == SR_ERR_DATA) {
-			/* Module recognized this buffer, but cannot handle it. */
-			continue;
-		} else if (ret == SR_ERR) {
-			/* Module didn't recognize this buffer. */
-			continue;
-		} else if (ret != SR_OK) {
-			/* Can be SR_ERR_NA. */
-			continue;
-		}
-
-		/* Found a matching module. */
-		sr_spew("Module %s matched, confidence %u.", imod->id, conf);
-		if (conf >= best_conf)
-			continue;
-		best_imod = imod;
-		best_conf = conf;
-	}
+	meta = g_hash_table_new(NULL, NULL);
+	g_hash_table_insert(meta, GINT_TO_POINTER(SR_INPUT_META_HEADER), buf);
+	imod = find_module(meta, avail_metadata);
+	g_hash_table_destroy(meta);
 
-	if (best_imod) {
-		*in = sr_input_new(best_imod, NULL);
+	if (imod) {
+		*in = sr_input_new(imod, NULL);
 		g_string_insert_len((*in)->buf, 0, buf->str, buf->len);
 		return SR_OK;
 	}
@@ -443,13 +521,11 @@ SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in)
 {
 	int64_t filesize;
 	FILE *stream;
-	const struct sr_input_module *imod, *best_imod;
+	const struct sr_input_module *best_imod;
 	GHashTable *meta;
 	GString *header;
 	size_t count;
-	unsigned int midx, i;
-	unsigned int conf, best_conf;
-	int ret;
+	unsigned int midx;
 	uint8_t avail_metadata[8];
 
 	*in = NULL;
@@ -495,36 +571,7 @@ SR_API int sr_input_scan_file(const char *filename, const struct sr_input **in)
 	avail_metadata[midx] = 0;
 	/* TODO: MIME type */
 
-	best_imod = NULL;
-	best_conf = ~0;
-	for (i = 0; input_module_list[i]; i++) {
-		imod = input_module_list[i];
-		if (!imod->metadata[0]) {
-			/* Module has no metadata for matching so will take
-			 * any input. No point in letting it try to match. */
-			continue;
-		}
-		if (!check_required_metadata(imod->metadata, avail_metadata))
-			/* Cannot satisfy this module's requirements. */
-			continue;
-
-		sr_dbg("Trying module %s.", imod->id);
-
-		ret = imod->format_match(meta, &conf);
-		if (ret == SR_ERR) {
-			/* Module didn't recognize this buffer. */
-			continue;
-		} else if (ret != SR_OK) {
-			/* Module recognized this buffer, but cannot handle it. */
-			continue;
-		}
-		/* Found a matching module. */
-		sr_dbg("Module %s matched, confidence %u.", imod->id, conf);
-		if (conf >= best_conf)
-			continue;
-		best_imod = imod;
-		best_conf = conf;
-	}
+	best_imod = find_module(meta, avail_metadata);
 	g_hash_table_destroy(meta);
 	g_string_free(header, TRUE);
 
@@ -593,6 +640,174 @@ SR_API int sr_input_send(const struct sr_input *in, GString *buf)
 	return in->module->receive((struct sr_input *)in, buf);
 }
 
+/**
+ * Send the contents of a file to the specified input instance.
+ *
+ * The file gets mapped into memory instead of being read. Input modules
+ * with the SR_INPUT_MAPPED flag parse straight from the mapping, other
+ * modules receive the data in chunks, as with sr_input_send().
+ *
+ * Like sr_input_send(), this returns the moment the device instance has
+ * become ready, so the caller can examine it and set up the session.
+ * Calling it again continues where it stopped, until *done gets set.
+ * Call sr_input_end() after that.
+ *
+ * @param in The input instance.
+ * @param filename The name of the file. Must not change between calls
+ *                 for the same file.
+ * @param done Set to TRUE once all of the file was sent.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid arguments.
+ * @retval SR_ERR_IO The file cannot be mapped.
+ * @retval other Error code of the input module.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_send_file(const struct sr_input *in_ro,
+		const char *filename, gboolean *done)
+{
+	struct sr_input *in;
+	GError *error;
+	GString *chunk;
+	const char *data;
+	size_t len, count;
+	gboolean was_ready;
+	int ret;
+
+	in = (struct sr_input *)in_ro;	/* "un-const" */
+	if (!in || !filename || !done)
+		return SR_ERR_ARG;
+	*done = FALSE;
+
+	if (!in->map) {
+		error = NULL;
+		in->map = g_mapped_file_new(filename, FALSE, &error);
+		if (!in->map) {
+			sr_err("Failed to map %s: %s", filename, error->message);
+			g_error_free(error);
+			return SR_ERR_IO;
+		}
+		in->map_pos = 0;
+	}
+	data = g_mapped_file_get_contents(in->map);
+	len = g_mapped_file_get_length(in->map);
+
+	ret = SR_OK;
+	chunk = NULL;
+	while (in->map_pos < len && ret == SR_OK) {
+		if (in->sdi_ready && (in->module->flags & SR_INPUT_MAPPED)) {
+			sr_spew("Sending %zu mapped bytes to %s module.",
+				len - in->map_pos, in->module->id);
+			ret = in->module->receive_mapped(in, data + in->map_pos,
+				len - in->map_pos);
+			in->map_pos = len;
+			break;
+		}
+
+		/* Modules identify the input from copied chunks. */
+		count = MIN(CHUNK_SIZE, len - in->map_pos);
+		if (!chunk)
+			chunk = g_string_sized_new(count);
+		g_string_truncate(chunk, 0);
+		g_string_append_len(chunk, data + in->map_pos, count);
+		in->map_pos += count;
+		was_ready = in->sdi_ready;
+		ret = sr_input_send(in, chunk);
+		if (!was_ready && in->sdi_ready)
+			break;
+	}
+	if (chunk)
+		g_string_free(chunk, TRUE);
+
+	if (ret == SR_OK && in->map_pos >= len) {
+		*done = TRUE;
+		g_mapped_file_unref(in->map);
+		in->map = NULL;
+		in->map_pos = 0;
+	}
+
+	return ret;
+}
+
+/**
+ * Send a range of samples from a file to the specified input instance.
+ *
+ * This lets applications page through huge files, without parsing all
+ * of the data before the region of interest. Input modules keep what
+ * they learned about sample positions in the file across calls (and
+ * across sr_input_reset()), so that later seeks get cheaper. Timestamps
+ * translate to sample numbers by means of the input's samplerate.
+ *
+ * Like sr_input_send_file(), this returns the moment the device
+ * instance has become ready. Call it again to send the range, which
+ * sets *done. Call sr_input_end() after that. To import another range,
+ * call sr_input_reset() and repeat.
+ *
+ * @param in The input instance.
+ * @param filename The name of the file. Must not change between calls
+ *                 for the same file.
+ * @param start The number of the first sample to send.
+ * @param count The number of samples to send. Ranges get limited to
+ *              the end of the input.
+ * @param done Set to TRUE once the range was sent.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid arguments.
+ * @retval SR_ERR_NA The input module does not support sample ranges.
+ * @retval SR_ERR_IO The file cannot be mapped.
+ * @retval other Error code of the input module.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_input_send_file_range(const struct sr_input *in_ro,
+		const char *filename, uint64_t start, uint64_t count,
+		gboolean *done)
+{
+	struct sr_input *in;
+	GError *error;
+	int ret;
+
+	in = (struct sr_input *)in_ro;	/* "un-const" */
+	if (!in || !filename || !done)
+		return SR_ERR_ARG;
+	*done = FALSE;
+	if (!in->module->receive_range)
+		return SR_ERR_NA;
+
+	/* Have the module identify the input first. */
+	if (!in->sdi_ready) {
+		ret = sr_input_send_file(in, filename, done);
+		*done = FALSE;
+		if (ret != SR_OK || in->sdi_ready)
+			return ret;
+		sr_err("Cannot identify the input data in %s.", filename);
+		return SR_ERR_DATA;
+	}
+
+	if (!in->map) {
+		error = NULL;
+		in->map = g_mapped_file_new(filename, FALSE, &error);
+		if (!in->map) {
+			sr_err("Failed to map %s: %s", filename, error->message);
+			g_error_free(error);
+			return SR_ERR_IO;
+		}
+	}
+
+	sr_spew("Sending samples %" PRIu64 " (+%" PRIu64 ") to %s module.",
+		start, count, in->module->id);
+	ret = in->module->receive_range(in, g_mapped_file_get_contents(in->map),
+		g_mapped_file_get_length(in->map), start, count);
+	g_mapped_file_unref(in->map);
+	in->map = NULL;
+	in->map_pos = 0;
+	if (ret == SR_OK)
+		*done = TRUE;
+
+	return ret;
+}
+
 /**
  * Signal the input module no more data will come.
  *
@@ -657,6 +872,10 @@ SR_API int sr_input_reset(const struct sr_input *in_ro)
 	if (in->buf)
 		g_string_truncate(in->buf, 0);
 	in->sdi_ready = FALSE;
+	if (in->map)
+		g_mapped_file_unref(in->map);
+	in->map = NULL;
+	in->map_pos = 0;
 
 	return rc;
 }
@@ -691,6 +910,8 @@ SR_API void sr_input_free(const struct sr_input *in)
 			" unprocessed bytes at free time.", in->buf->len);
 	}
 	g_string_free(in->buf, TRUE);
+	if (in->map)
+		g_mapped_file_unref(in->map);
 	g_free(in->priv);
 	g_free((gpointer)in);
 }
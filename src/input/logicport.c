@@ -131,9 +131,8 @@ struct context {
 	GSList *signal_groups;
 	GSList *channels;
 	size_t unitsize;
-	size_t samples_per_chunk;
-	size_t samples_in_buffer;
-	uint8_t *feed_buffer;
+	size_t packet_size;
+	struct feed_queue_logic *feed_logic;
 };
 
 static struct signal_group_desc *alloc_signal_group(const char *name)
@@ -824,30 +823,28 @@ static int create_channels_groups(struct sr_input *in)
 static int create_feed_buffer(struct sr_input *in)
 {
 	struct context *inc;
+	size_t count;
 
 	inc = in->priv;
 
 	inc->unitsize = (inc->channel_count + 7) / 8;
-	inc->samples_per_chunk = CHUNK_SIZE / inc->unitsize;
-	inc->samples_in_buffer = 0;
-	inc->feed_buffer = g_malloc0(inc->samples_per_chunk * inc->unitsize);
-	if (!inc->feed_buffer)
+	count = inc->packet_size;
+	if (!count)
+		count = CHUNK_SIZE / inc->unitsize;
+	inc->feed_logic = feed_queue_logic_alloc(in->sdi, count, inc->unitsize);
+	if (!inc->feed_logic)
 		return SR_ERR_MALLOC;
 
 	return SR_OK;
 }
 
-/* Send all accumulated sample data values to the session. */
-static int send_buffer(struct sr_input *in)
+/* Send the header and the samplerate (once) before sample data. */
+static int send_feed_header(struct sr_input *in)
 {
 	struct context *inc;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
 	int rc;
 
 	inc = in->priv;
-	if (!inc->samples_in_buffer)
-		return SR_OK;
 
 	if (!inc->header_sent) {
 		rc = std_session_send_df_header(in->sdi);
@@ -857,84 +854,43 @@ static int send_buffer(struct sr_input *in)
 	}
 
 	if (inc->sample_rate && !inc->rate_sent) {
-		rc = sr_session_send_meta(in->sdi, SR_CONF_SAMPLERATE,
-			g_variant_new_uint64(inc->sample_rate));
+		rc = sr_session_send_meta_uint64(in->sdi, SR_CONF_SAMPLERATE,
+			inc->sample_rate);
 		if (rc)
 			return rc;
 		inc->rate_sent = TRUE;
 	}
 
-	packet.type = SR_DF_LOGIC;
-	packet.payload = &logic;
-	logic.unitsize = inc->unitsize;
-	logic.data = inc->feed_buffer;
-	logic.length = inc->unitsize * inc->samples_in_buffer;
-	rc = sr_session_send(in->sdi, &packet);
-
-	inc->samples_in_buffer = 0;
-
-	if (rc)
-		return rc;
-
 	return SR_OK;
 }
 
 /*
- * Add N copies of the current sample to the buffer. Send the buffer to
- * the session feed when a maximum amount of data was collected.
+ * Pass on previously received samples to the session. Sample lines
+ * come with repeat counts, which the feed queue expands as runs.
  */
-static int add_samples(struct sr_input *in, uint64_t samples, size_t count)
-{
-	struct context *inc;
-	uint8_t sample_buffer[sizeof(uint64_t)];
-	size_t idx;
-	size_t copy_count;
-	uint8_t *p;
-	int rc;
-
-	inc = in->priv;
-	for (idx = 0; idx < inc->unitsize; idx++) {
-		sample_buffer[idx] = samples & 0xff;
-		samples >>= 8;
-	}
-	while (count) {
-		copy_count = inc->samples_per_chunk - inc->samples_in_buffer;
-		if (copy_count > count)
-			copy_count = count;
-		count -= copy_count;
-
-		p = inc->feed_buffer + inc->samples_in_buffer * inc->unitsize;
-		while (copy_count-- > 0) {
-			memcpy(p, sample_buffer, inc->unitsize);
-			p += inc->unitsize;
-			inc->samples_in_buffer++;
-		}
-
-		if (inc->samples_in_buffer == inc->samples_per_chunk) {
-			rc = send_buffer(in);
-			if (rc)
-				return rc;
-		}
-	}
-
-	return SR_OK;
-}
-
-/* Pass on previously received samples to the session. */
 static int process_queued_samples(struct sr_input *in)
 {
 	struct context *inc;
 	struct sample_data_entry *entry;
 	uint64_t sample_bits;
+	uint8_t sample_buffer[sizeof(uint64_t)];
 	int rc;
 
 	inc = in->priv;
+	if (inc->sample_lines_fed == inc->sample_lines_total)
+		return SR_OK;
+	rc = send_feed_header(in);
+	if (rc)
+		return rc;
+
 	while (inc->sample_lines_fed < inc->sample_lines_total) {
 		entry = &inc->sample_data_queue[inc->sample_lines_fed++];
 		sample_bits = entry->bits;
 		sample_bits ^= inc->wires_inverted;
 		sample_bits &= inc->wires_enabled;
-		rc = add_samples(in, sample_bits, entry->repeat);
+		write_u64le(sample_buffer, sample_bits);
+		rc = feed_queue_logic_submit(inc->feed_logic,
+			sample_buffer, entry->repeat);
 		if (rc)
 			return rc;
 	}
@@ -1051,12 +1007,12 @@ static int init(struct sr_input *in, GHashTable *options)
 {
 	struct context *inc;
 
-	(void)options;
-
 	in->sdi = g_malloc0(sizeof(*in->sdi));
 	inc = g_malloc0(sizeof(*inc));
 	in->priv = inc;
 
+	inc->packet_size = g_variant_get_uint32(g_hash_table_lookup(options, "packetsize"));
+
 	return SR_OK;
 }
 
@@ -1102,6 +1058,7 @@ static int end(struct sr_input *in)
 	/* Nothing to do here if we never started feeding the session. */
 	if (!in->sdi_ready)
 		return SR_OK;
+	inc = in->priv;
 
 	/*
 	 * Process sample data that may not have been forwarded before.
@@ -1110,12 +1067,11 @@ static int end(struct sr_input *in)
 	rc = process_queued_samples(in);
 	if (rc)
 		return rc;
-	rc = send_buffer(in);
+	rc = feed_queue_logic_flush(inc->feed_logic);
 	if (rc)
 		return rc;
 
 	/* End the session feed if one was started. */
-	inc = in->priv;
 	if (inc->header_sent) {
 		rc = std_session_send_df_end(in->sdi);
 		inc->header_sent = FALSE;
@@ -1127,7 +1083,7 @@ static int end(struct sr_input *in)
 static void cleanup(struct sr_input *in)
 {
 	struct context *inc;
-	size_t idx;
+	size_t idx, packet_size;
 
 	if (!in)
 		return;
@@ -1150,8 +1106,10 @@ static void cleanup(struct sr_input *in)
 		g_free(inc->signal_names[idx]);
 	g_slist_free_full(inc->signal_groups, sg_free);
 	g_slist_free_full(inc->channels, g_free);
-	g_free(inc->feed_buffer);
+	feed_queue_logic_free(inc->feed_logic);
+	packet_size = inc->packet_size;
 	memset(inc, 0, sizeof(*inc));
+	inc->packet_size = packet_size;
 }
 
 static int reset(struct sr_input *in)
@@ -1177,11 +1135,15 @@ static int reset(struct sr_input *in)
 }
 
 static struct sr_option options[] = {
+	{ "packetsize", "Packet size (samples)", "Number of samples per packet which gets sent to the session (0 = automatic)", NULL, NULL },
 	ALL_ZERO,
 };
 
 static const struct sr_option *get_options(void)
 {
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_uint32(0));
+
 	return options;
 }
 
@@ -1191,6 +1153,7 @@ SR_PRIV struct sr_input_module input_logicport = {
 	.desc = "Intronix LA1034 LogicPort project",
 	.exts = (const char *[]){ "lpf", NULL },
 	.metadata = { SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED },
+	.flags = SR_INPUT_TEXT,
 	.options = get_options,
 	.format_match = format_match,
 	.init = init,
@@ -40,7 +40,6 @@ struct context {
 	int fmt_index;
 	uint64_t samplerate;
 	int samplesize;
-	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
@@ -93,9 +92,6 @@ static int parse_format_string(const char *format)
 
 static void init_context(struct context *inc, const struct sample_format *fmt, GSList *channels)
 {
-	inc->packet.type = SR_DF_ANALOG;
-	inc->packet.payload = &inc->analog;
-
 	inc->analog.data = NULL;
 	inc->analog.num_samples = 0;
 	inc->analog.encoding = &inc->encoding;
@@ -162,8 +158,8 @@ static int process_buffer(struct sr_input *in)
 		std_session_send_df_header(in->sdi);
 
 		if (inc->samplerate) {
-			(void)sr_session_send_meta(in->sdi, SR_CONF_SAMPLERATE,
-				g_variant_new_uint64(inc->samplerate));
+			(void)sr_session_send_meta_uint64(in->sdi, SR_CONF_SAMPLERATE,
+				inc->samplerate);
 		}
 
 		inc->started = TRUE;
@@ -176,7 +172,7 @@ static int process_buffer(struct sr_input *in)
 
 	while ((offset + chunk_size) < in->buf->len) {
 		inc->analog.data = in->buf->str + offset;
-		sr_session_send(in->sdi, &inc->packet);
+		sr_analog_send_split(in->sdi, &inc->analog);
 		offset += chunk_size;
 	}
 
@@ -184,7 +180,7 @@ static int process_buffer(struct sr_input *in)
 	chunk_size = inc->analog.num_samples * inc->samplesize;
 	if (chunk_size > 0) {
 		inc->analog.data = in->buf->str + offset;
-		sr_session_send(in->sdi, &inc->packet);
+		sr_analog_send_split(in->sdi, &inc->analog);
 		offset += chunk_size;
 	}
 
@@ -336,8 +336,8 @@ static int flush_feed_buffer(struct sr_input *in)
 
 	/* Automatically send the samplerate (when available). */
 	if (inc->logic_state.sample_rate && !inc->module_state.rate_sent) {
-		rc = sr_session_send_meta(in->sdi, SR_CONF_SAMPLERATE,
-			g_variant_new_uint64(inc->logic_state.sample_rate));
+		rc = sr_session_send_meta_uint64(in->sdi, SR_CONF_SAMPLERATE,
+			inc->logic_state.sample_rate);
 		inc->module_state.rate_sent = TRUE;
 	}
 
@@ -374,28 +374,47 @@ static int flush_feed_buffer(struct sr_input *in)
 	return sr_session_send(in->sdi, &packet);
 }
 
+/*
+ * Add a run of identical sample sets. Writes the first sample set, and
+ * replicates it in place to fill the run (doubling the copied amount
+ * with every step), up to the end of the feed buffer.
+ */
 static int addto_feed_buffer_logic(struct sr_input *in,
 	uint64_t data, size_t count)
 {
 	struct context *inc;
+	uint8_t *start;
+	size_t unit_size, space, run, done, copy;
 
 	inc = in->priv;
 
 	if (inc->feed.is_analog)
 		return SR_ERR_ARG;
 
-	while (count--) {
-		if (inc->feed.unit_size == sizeof(uint64_t))
-			write_u64le_inc(&inc->feed.write_pos, data);
-		else if (inc->feed.unit_size == sizeof(uint32_t))
-			write_u32le_inc(&inc->feed.write_pos, data);
-		else if (inc->feed.unit_size == sizeof(uint16_t))
-			write_u16le_inc(&inc->feed.write_pos, data);
-		else if (inc->feed.unit_size == sizeof(uint8_t))
-			write_u8_inc(&inc->feed.write_pos, data);
+	unit_size = inc->feed.unit_size;
+	while (count) {
+		start = inc->feed.write_pos;
+		if (unit_size == sizeof(uint64_t))
+			write_u64le(start, data);
+		else if (unit_size == sizeof(uint32_t))
+			write_u32le(start, data);
+		else if (unit_size == sizeof(uint16_t))
+			write_u16le(start, data);
+		else if (unit_size == sizeof(uint8_t))
+			write_u8(start, data);
 		else
 			return SR_ERR_BUG;
-		inc->feed.samples_in_buffer++;
+		space = inc->feed.samples_per_chunk - inc->feed.samples_in_buffer;
+		run = MIN(count, space);
+		done = 1;
+		while (done < run) {
+			copy = MIN(done, run - done);
+			memcpy(&start[done * unit_size], start, copy * unit_size);
+			done += copy;
+		}
+		inc->feed.write_pos = &start[run * unit_size];
+		inc->feed.samples_in_buffer += run;
+		count -= run;
 		if (inc->feed.samples_in_buffer == inc->feed.samples_per_chunk)
 			flush_feed_buffer(in);
 	}
@@ -428,6 +447,49 @@ static int addto_feed_buffer_analog(struct sr_input *in,
 	return SR_OK;
 }
 
+/*
+ * Add a block of little endian single precision floats from the input
+ * file. A mere copy on little endian hosts.
+ */
+static int addto_feed_buffer_analog_block(struct sr_input *in,
+	const uint8_t *data, size_t count)
+{
+	struct context *inc;
+	size_t space, chunk;
+
+	inc = in->priv;
+
+	if (!inc->feed.is_analog)
+		return SR_ERR_ARG;
+	if (sizeof(inc->feed.buffer_analog[0]) != sizeof(float))
+		return SR_ERR_BUG;
+
+	while (count) {
+		space = inc->feed.samples_per_chunk - inc->feed.samples_in_buffer;
+		chunk = MIN(count, space);
+#ifdef WORDS_BIGENDIAN
+		{
+			size_t idx;
+
+			for (idx = 0; idx < chunk; idx++) {
+				write_fltle_inc(&inc->feed.write_pos,
+					read_fltle_inc(&data));
+			}
+		}
+#else
+		memcpy(inc->feed.write_pos, data, chunk * sizeof(float));
+		inc->feed.write_pos += chunk * sizeof(float);
+		data += chunk * sizeof(float);
+#endif
+		inc->feed.samples_in_buffer += chunk;
+		count -= chunk;
+		if (inc->feed.samples_in_buffer == inc->feed.samples_per_chunk)
+			flush_feed_buffer(in);
+	}
+
+	return SR_OK;
+}
+
 static enum logic_format check_format(const uint8_t *data, size_t dlen)
 {
 	const char *s;
@@ -789,6 +851,9 @@ static int parse_next_item(struct sr_input *in,
 		return SR_OK;
 	case STAGE_L1A_NEW_CHANNEL:
 		/* Just select the channel. Don't consume any data. */
+		rc = flush_feed_buffer(in);
+		if (rc)
+			return rc;
 		rc = setup_feed_buffer_channel(in, inc->logic_state.l1a.current_channel_idx);
 		if (rc)
 			return rc;
@@ -802,7 +867,7 @@ static int parse_next_item(struct sr_input *in,
 		if (rc)
 			return rc;
 		inc->logic_state.l1a.current_per_channel++;
-		if (inc->logic_state.l1a.current_channel_idx == inc->logic_state.l1a.samples_per_channel)
+		if (inc->logic_state.l1a.current_per_channel == inc->logic_state.l1a.samples_per_channel)
 			inc->logic_state.stage = STAGE_L1A_NEW_CHANNEL;
 		return SR_OK;
 	case STAGE_L2D_CHANGE_VALUE:
@@ -829,6 +894,7 @@ static int parse_next_item(struct sr_input *in,
 			rc = setup_feed_buffer_channel(in, 0);
 			if (rc)
 				return rc;
+			inc->logic_state.stage = STAGE_L2A_EVERY_VALUE;
 			count = 1;
 		} else {
 			count = inc->logic_state.l2a.down_sample;
@@ -845,6 +911,74 @@ static int parse_next_item(struct sr_input *in,
 	/* UNREACH */
 }
 
+/*
+ * Process many sample data items at once where the current stage
+ * allows: Logic2 transitions become runs of logic samples, and blocks
+ * of analog floats get copied. Returns the number of consumed bytes
+ * in 'used', which is zero when the item based path needs to run.
+ */
+static int parse_bulk_items(struct sr_input *in,
+	const uint8_t *buff, size_t blen, size_t *used)
+{
+	struct context *inc;
+	const uint8_t *pos;
+	size_t count, idx;
+	uint64_t run;
+	double next_time, diff_time;
+	int rc;
+
+	inc = in->priv;
+	*used = 0;
+
+	switch (inc->logic_state.stage) {
+	case STAGE_L2D_CHANGE_VALUE:
+		count = blen / sizeof(double);
+		pos = buff;
+		for (idx = 0; idx < count; idx++) {
+			next_time = read_dblle_inc(&pos);
+			diff_time = next_time - inc->feed.last.time;
+			if (inc->logic_state.l2d.min_time_step > diff_time)
+				inc->logic_state.l2d.min_time_step = diff_time;
+			diff_time /= inc->logic_state.l2d.sample_period;
+			diff_time += 0.5;
+			run = (uint64_t)diff_time;
+			if (run) {
+				rc = addto_feed_buffer_logic(in,
+					inc->feed.last.digital, run);
+				if (rc)
+					return rc;
+				inc->feed.last.time = next_time;
+			}
+			inc->feed.last.digital = 1 - inc->feed.last.digital;
+		}
+		*used = count * sizeof(double);
+		return SR_OK;
+	case STAGE_L1A_SAMPLE:
+		count = blen / sizeof(float);
+		run = inc->logic_state.l1a.samples_per_channel;
+		run -= inc->logic_state.l1a.current_per_channel;
+		if (count > run)
+			count = run;
+		rc = addto_feed_buffer_analog_block(in, buff, count);
+		if (rc)
+			return rc;
+		inc->logic_state.l1a.current_per_channel += count;
+		if (inc->logic_state.l1a.current_per_channel == inc->logic_state.l1a.samples_per_channel)
+			inc->logic_state.stage = STAGE_L1A_NEW_CHANNEL;
+		*used = count * sizeof(float);
+		return SR_OK;
+	case STAGE_L2A_EVERY_VALUE:
+		count = blen / sizeof(float);
+		rc = addto_feed_buffer_analog_block(in, buff, count);
+		if (rc)
+			return rc;
+		*used = count * sizeof(float);
+		return SR_OK;
+	default:
+		return SR_OK;
+	}
+}
+
 static int parse_samples(struct sr_input *in)
 {
 	const uint8_t *buff, *start;
@@ -857,7 +991,14 @@ static int parse_samples(struct sr_input *in)
 	start = (const uint8_t *)in->buf->str;
 	buff = start;
 	blen = in->buf->len;
-	while (have_next_item(in, buff, blen, &curr, &next)) {
+	while (TRUE) {
+		rc = parse_bulk_items(in, buff, blen, &len);
+		if (rc)
+			return rc;
+		buff += len;
+		blen -= len;
+		if (!have_next_item(in, buff, blen, &curr, &next))
+			break;
 		len = next - curr;
 		rc = parse_next_item(in, curr, len);
 		if (rc)
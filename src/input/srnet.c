@@ -0,0 +1,516 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Replays a datafeed stream of the "srnet" output module. The channels
+ * of the virtual device are taken from the stream's first HEADER frame,
+ * everything after it is sent to the session as it arrives. See
+ * src/output/srnet.c for the payload layout.
+ */
+
+#include <config.h>
+#include <string.h>
+#ifdef HAVE_LIBLZ4
+#include <lz4.h>
+#endif
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "input/srnet"
+
+#define START_SIZE (SRNET_MAGIC_SIZE + sizeof(uint32_t))
+/* Refuse frames which would make us buffer absurd amounts of data. */
+#define MAX_PAYLOAD (256 * 1024 * 1024)
+
+struct context {
+	gboolean create_channels;
+	gboolean got_start;
+	gboolean started;
+	/* The stream's first HEADER, to be sent once the frontend is ready. */
+	gboolean header_pending;
+	struct sr_datafeed_header header;
+	uint8_t *lz4_buf;
+	size_t lz4_size;
+};
+
+#define NEED(p, end, n) \
+	do { if ((uint64_t)((end) - (p)) < (uint64_t)(n)) return SR_ERR_DATA; } while (0)
+
+static int format_match(GHashTable *metadata, unsigned int *confidence)
+{
+	GString *buf;
+
+	buf = g_hash_table_lookup(metadata, GINT_TO_POINTER(SR_INPUT_META_HEADER));
+	if (!buf || buf->len < START_SIZE)
+		return SR_ERR;
+	if (memcmp(buf->str, SRNET_MAGIC, SRNET_MAGIC_SIZE))
+		return SR_ERR;
+	if (RL32(buf->str + SRNET_MAGIC_SIZE) != SRNET_VERSION)
+		return SR_ERR_DATA;
+
+	*confidence = 1;
+
+	return SR_OK;
+}
+
+static int init(struct sr_input *in, GHashTable *options)
+{
+	struct context *inc;
+
+	(void)options;
+
+	in->sdi = g_malloc0(sizeof(struct sr_dev_inst));
+	in->priv = inc = g_malloc0(sizeof(struct context));
+	inc->create_channels = TRUE;
+
+	return SR_OK;
+}
+
+static struct sr_channel *find_channel(const struct sr_dev_inst *sdi, int index)
+{
+	struct sr_channel *ch;
+	GSList *l;
+
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->index == index)
+			return ch;
+	}
+
+	return NULL;
+}
+
+static int parse_header(struct sr_input *in, const uint8_t *p,
+	const uint8_t *end, struct sr_datafeed_header *header)
+{
+	struct context *inc;
+	uint32_t num_channels, index, type, enabled, len, i;
+	char *name;
+
+	inc = in->priv;
+	NEED(p, end, 24);
+	header->feed_version = read_u32le_inc(&p);
+	header->starttime.tv_sec = read_u64le_inc(&p);
+	header->starttime.tv_usec = read_u64le_inc(&p);
+	num_channels = read_u32le_inc(&p);
+
+	for (i = 0; i < num_channels; i++) {
+		NEED(p, end, 16);
+		index = read_u32le_inc(&p);
+		type = read_u32le_inc(&p);
+		enabled = read_u32le_inc(&p);
+		len = read_u32le_inc(&p);
+		NEED(p, end, len);
+		if (inc->create_channels) {
+			if (type != SR_CHANNEL_LOGIC && type != SR_CHANNEL_ANALOG)
+				return SR_ERR_DATA;
+			name = g_strndup((const char *)p, len);
+			sr_channel_new(in->sdi, index, type, enabled, name);
+			g_free(name);
+		}
+		p += len;
+	}
+	inc->create_channels = FALSE;
+
+	return SR_OK;
+}
+
+static int send_meta(struct sr_input *in, const uint8_t *p, const uint8_t *end)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+	GVariant *data, *swapped;
+	GBytes *bytes;
+	uint32_t count, key, len, i;
+	char *type;
+	int ret;
+
+	NEED(p, end, 4);
+	count = read_u32le_inc(&p);
+	meta.config = NULL;
+	ret = SR_OK;
+	for (i = 0; i < count && ret == SR_OK; i++) {
+		ret = SR_ERR_DATA;
+		if (end - p < 8)
+			break;
+		key = read_u32le_inc(&p);
+		len = read_u32le_inc(&p);
+		if ((size_t)(end - p) < (size_t)len + 4)
+			break;
+		type = g_strndup((const char *)p, len);
+		p += len;
+		len = read_u32le_inc(&p);
+		if ((size_t)(end - p) < len || !g_variant_type_string_is_valid(type)) {
+			g_free(type);
+			break;
+		}
+		bytes = g_bytes_new(p, len);
+		data = g_variant_ref_sink(g_variant_new_from_bytes(
+			G_VARIANT_TYPE(type), bytes, FALSE));
+		g_bytes_unref(bytes);
+		g_free(type);
+		p += len;
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+		swapped = g_variant_byteswap(data);
+		g_variant_unref(data);
+		data = swapped;
+#else
+		(void)swapped;
+#endif
+		/* Consumers rely on the types which the keys document. */
+		if (sr_variant_type_check(key, data) != SR_OK) {
+			g_variant_unref(data);
+			break;
+		}
+		meta.config = g_slist_append(meta.config, sr_config_new(key, data));
+		g_variant_unref(data);
+		ret = SR_OK;
+	}
+
+	if (ret == SR_OK) {
+		packet.type = SR_DF_META;
+		packet.payload = &meta;
+		ret = sr_session_send(in->sdi, &packet);
+	}
+	g_slist_free_full(meta.config, (GDestroyNotify)sr_config_free);
+
+	return ret;
+}
+
+static int send_logic(struct sr_input *in, const uint8_t *p, const uint8_t *end)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+
+	NEED(p, end, 4);
+	logic.unitsize = read_u32le_inc(&p);
+	logic.length = end - p;
+	if (!logic.unitsize || logic.length % logic.unitsize)
+		return SR_ERR_DATA;
+	logic.data = (void *)p;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	return sr_session_send(in->sdi, &packet);
+}
+
+static int send_analog(struct sr_input *in, const uint8_t *p, const uint8_t *end)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_channel *ch;
+	GSList *channels;
+	uint32_t num_samples, num_channels, mq, unit, i;
+	uint64_t mqflags, total, n;
+	int digits, spec_digits, ret;
+	float *fdata;
+
+	NEED(p, end, 32);
+	num_samples = read_u32le_inc(&p);
+	num_channels = read_u32le_inc(&p);
+	mq = read_u32le_inc(&p);
+	unit = read_u32le_inc(&p);
+	mqflags = read_u64le_inc(&p);
+	digits = read_i32le_inc(&p);
+	spec_digits = read_i32le_inc(&p);
+	total = (uint64_t)num_samples * num_channels;
+	if (total > MAX_PAYLOAD / sizeof(float))
+		return SR_ERR_DATA;
+	NEED(p, end, 4 * (uint64_t)num_channels + sizeof(float) * total);
+
+	channels = NULL;
+	for (i = 0; i < num_channels; i++) {
+		ch = find_channel(in->sdi, read_u32le_inc(&p));
+		if (!ch || ch->type != SR_CHANNEL_ANALOG) {
+			g_slist_free(channels);
+			return SR_ERR_DATA;
+		}
+		channels = g_slist_append(channels, ch);
+	}
+	fdata = g_malloc(sizeof(float) * MAX(total, 1));
+	for (n = 0; n < total; n++)
+		fdata[n] = read_fltle_inc(&p);
+
+	sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
+	spec.spec_digits = spec_digits;
+	analog.num_samples = num_samples;
+	analog.data = fdata;
+	meaning.mq = mq;
+	meaning.unit = unit;
+	meaning.mqflags = mqflags;
+	meaning.channels = channels;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	ret = sr_session_send(in->sdi, &packet);
+	g_free(fdata);
+	g_slist_free(channels);
+
+	return ret;
+}
+
+static int send_frame(struct sr_input *in, int type,
+	const uint8_t *p, const uint8_t *end)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_header header;
+	int ret;
+
+	packet.payload = NULL;
+	switch (type) {
+	case SRNET_HEADER:
+		if ((ret = parse_header(in, p, end, &header)) != SR_OK)
+			return ret;
+		packet.type = SR_DF_HEADER;
+		packet.payload = &header;
+		break;
+	case SRNET_META:
+		return send_meta(in, p, end);
+	case SRNET_LOGIC:
+		return send_logic(in, p, end);
+	case SRNET_ANALOG:
+		return send_analog(in, p, end);
+	case SRNET_TRIGGER:
+		packet.type = SR_DF_TRIGGER;
+		break;
+	case SRNET_FRAME_BEGIN:
+		if (end - p >= 8)
+			return std_session_send_df_frame_begin_pos(in->sdi, RL64(p));
+		packet.type = SR_DF_FRAME_BEGIN;
+		break;
+	case SRNET_FRAME_END:
+		packet.type = SR_DF_FRAME_END;
+		break;
+	case SRNET_END:
+		packet.type = SR_DF_END;
+		break;
+	default:
+		/* Unknown frames are skipped, for newer senders. */
+		sr_dbg("Skipping unknown frame type %d.", type);
+		return SR_OK;
+	}
+	if (packet.type == SR_DF_HEADER)
+		((struct context *)in->priv)->started = TRUE;
+	else if (packet.type == SR_DF_END)
+		((struct context *)in->priv)->started = FALSE;
+
+	return sr_session_send(in->sdi, &packet);
+}
+
+/*
+ * Find the next complete frame in the buffer, starting at *offset.
+ * Returns SR_ERR_NA when the frame is still incomplete.
+ */
+static int next_frame(struct sr_input *in, size_t *offset, int *type,
+	const uint8_t **payload, size_t *len)
+{
+	struct context *inc;
+	const uint8_t *hdr;
+	size_t size, raw_size;
+
+	inc = in->priv;
+	if (in->buf->len - *offset < SRNET_FRAME_HEADER_SIZE)
+		return SR_ERR_NA;
+	hdr = (const uint8_t *)in->buf->str + *offset;
+	size = RL32(&hdr[4]);
+	raw_size = RL32(&hdr[8]);
+	if (size > MAX_PAYLOAD || raw_size > MAX_PAYLOAD) {
+		sr_err("Frame of %zu bytes is too large.", MAX(size, raw_size));
+		return SR_ERR_DATA;
+	}
+	if (in->buf->len - *offset - SRNET_FRAME_HEADER_SIZE < size)
+		return SR_ERR_NA;
+
+	*type = hdr[0];
+	*payload = hdr + SRNET_FRAME_HEADER_SIZE;
+	*len = size;
+	*offset += SRNET_FRAME_HEADER_SIZE + size;
+	if (!(hdr[1] & SRNET_FLAG_LZ4))
+		return SR_OK;
+
+#ifdef HAVE_LIBLZ4
+	if (raw_size > inc->lz4_size) {
+		g_free(inc->lz4_buf);
+		inc->lz4_buf = g_malloc(raw_size);
+		inc->lz4_size = raw_size;
+	}
+	if (LZ4_decompress_safe((const char *)*payload, (char *)inc->lz4_buf,
+			size, raw_size) != (int)raw_size) {
+		sr_err("Cannot decompress a frame.");
+		return SR_ERR_DATA;
+	}
+	*payload = inc->lz4_buf;
+	*len = raw_size;
+
+	return SR_OK;
+#else
+	(void)inc;
+	sr_err("LZ4 compressed streams are not supported by this build.");
+
+	return SR_ERR_DATA;
+#endif
+}
+
+static int process_buffer(struct sr_input *in)
+{
+	struct sr_datafeed_packet packet;
+	struct context *inc;
+	const uint8_t *payload;
+	size_t offset, len;
+	int type, ret;
+
+	inc = in->priv;
+	if (inc->header_pending) {
+		inc->header_pending = FALSE;
+		inc->started = TRUE;
+		packet.type = SR_DF_HEADER;
+		packet.payload = &inc->header;
+		if ((ret = sr_session_send(in->sdi, &packet)) != SR_OK)
+			return ret;
+	}
+
+	offset = 0;
+	while ((ret = next_frame(in, &offset, &type, &payload, &len)) == SR_OK) {
+		if ((ret = send_frame(in, type, payload, payload + len)) != SR_OK)
+			break;
+	}
+	g_string_erase(in->buf, 0, offset);
+	if (ret == SR_ERR_DATA)
+		sr_err("Invalid frame in the stream.");
+
+	return ret == SR_ERR_NA ? SR_OK : ret;
+}
+
+/* Check the stream start, and take the channels from the first frame. */
+static int parse_start(struct sr_input *in)
+{
+	struct context *inc;
+	const uint8_t *payload;
+	size_t offset, len;
+	int type, ret;
+
+	inc = in->priv;
+	if (!inc->got_start) {
+		if (in->buf->len < START_SIZE)
+			return SR_ERR_NA;
+		if (memcmp(in->buf->str, SRNET_MAGIC, SRNET_MAGIC_SIZE)
+				|| RL32(in->buf->str + SRNET_MAGIC_SIZE) != SRNET_VERSION) {
+			sr_err("Not an srnet stream, or an unsupported version.");
+			return SR_ERR_DATA;
+		}
+		g_string_erase(in->buf, 0, START_SIZE);
+		inc->got_start = TRUE;
+	}
+
+	offset = 0;
+	if ((ret = next_frame(in, &offset, &type, &payload, &len)) != SR_OK)
+		return ret;
+	if (type != SRNET_HEADER) {
+		sr_err("The stream does not start with a header.");
+		return SR_ERR_DATA;
+	}
+	ret = parse_header(in, payload, payload + len, &inc->header);
+	g_string_erase(in->buf, 0, offset);
+	if (ret != SR_OK)
+		return ret;
+	inc->header_pending = TRUE;
+
+	return SR_OK;
+}
+
+static int receive(struct sr_input *in, GString *buf)
+{
+	int ret;
+
+	g_string_append_len(in->buf, buf->str, buf->len);
+
+	if (!in->sdi_ready) {
+		if ((ret = parse_start(in)) == SR_ERR_NA)
+			/* Not enough data yet. */
+			return SR_OK;
+		else if (ret != SR_OK)
+			return ret;
+
+		/* sdi is ready, notify frontend. */
+		in->sdi_ready = TRUE;
+		return SR_OK;
+	}
+
+	return process_buffer(in);
+}
+
+static int end(struct sr_input *in)
+{
+	struct context *inc;
+	int ret;
+
+	if (in->sdi_ready)
+		ret = process_buffer(in);
+	else
+		ret = SR_OK;
+
+	inc = in->priv;
+	if (in->buf->len)
+		sr_warn("Stream ends with an incomplete frame.");
+	/* Streams which got cut off still get terminated. */
+	if (inc->started)
+		std_session_send_df_end(in->sdi);
+	inc->started = FALSE;
+
+	return ret;
+}
+
+static void cleanup(struct sr_input *in)
+{
+	struct context *inc;
+
+	inc = in->priv;
+	g_free(inc->lz4_buf);
+	inc->lz4_buf = NULL;
+	inc->lz4_size = 0;
+}
+
+static int reset(struct sr_input *in)
+{
+	struct context *inc;
+
+	inc = in->priv;
+	cleanup(in);
+	memset(inc, 0, sizeof(*inc));
+	g_string_truncate(in->buf, 0);
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_input_module input_srnet = {
+	.id = "srnet",
+	.name = "srnet",
+	.desc = "Binary datafeed stream of the srnet output",
+	.exts = (const char*[]){"srnet", NULL},
+	.metadata = { SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED },
+	.format_match = format_match,
+	.init = init,
+	.receive = receive,
+	.end = end,
+	.cleanup = cleanup,
+	.reset = reset,
+};
@@ -30,6 +30,11 @@
  * saved using /QuickCompress, /Compress or /ZIP.
  * As a workaround you may load the file in PowerView
  * using I.LOAD / IPROBE.LOAD and re-save using /NoCompress.
+ *
+ * Records get decoded straight into the session feed's buffer, and the
+ * time gaps between records are filled by repeating their sample sets.
+ * The packetsize option sets the number of samples per packet which is
+ * sent to the session.
  */
 
 #include <config.h>
@@ -100,7 +105,8 @@ struct context {
 	int32_t last_record;
 	uint64_t samplerate;
 	double timestamp_scale;
-	GString *out_buf;
+	size_t unitsize;
+	struct feed_queue_logic *feed_logic;
 };
 
 static int process_header(GString *buf, struct context *inc);
@@ -155,6 +161,7 @@ static int init(struct sr_input *in, GHashTable *options)
 	struct context *inc;
 	int pod;
 	char id[17];
+	size_t packet_size;
 
 	in->sdi = g_malloc0(sizeof(struct sr_dev_inst));
 	in->priv = g_malloc0(sizeof(struct context));
@@ -182,7 +189,17 @@ static int init(struct sr_input *in, GHashTable *options)
 		return SR_ERR;
 	}
 
-	inc->out_buf = g_string_sized_new(CHUNK_SIZE);
+	inc->unitsize = (g_slist_length(in->sdi->channels) + 7) / 8;
+	packet_size = g_variant_get_uint32(g_hash_table_lookup(options, "packetsize"));
+	if (!packet_size)
+		packet_size = CHUNK_SIZE / inc->unitsize;
+	inc->feed_logic = feed_queue_logic_alloc(in->sdi, packet_size, inc->unitsize);
+	if (!inc->feed_logic) {
+		sr_err("Cannot allocate buffers.");
+		g_free(in->priv);
+		g_free(in->sdi);
+		return SR_ERR_MALLOC;
+	}
 
 	return SR_OK;
 }
@@ -410,43 +427,22 @@ static void send_metadata(struct sr_input *in)
 	struct context *inc;
 
 	inc = in->priv;
-	(void)sr_session_send_meta(in->sdi, SR_CONF_SAMPLERATE,
-		g_variant_new_uint64(inc->samplerate));
+	(void)sr_session_send_meta_uint64(in->sdi, SR_CONF_SAMPLERATE,
+		inc->samplerate);
 	inc->meta_sent = TRUE;
 }
 
-static void flush_output_buffer(struct sr_input *in)
-{
-	struct context *inc;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
-
-	inc = in->priv;
-
-	if (inc->out_buf->len) {
-		packet.type = SR_DF_LOGIC;
-		packet.payload = &logic;
-		logic.unitsize = (g_slist_length(in->sdi->channels) + 7) / 8;
-		logic.data = inc->out_buf->str;
-		logic.length = inc->out_buf->len;
-		sr_session_send(in->sdi, &packet);
-
-		g_string_truncate(inc->out_buf, 0);
-	}
-}
-
-static void process_record_pi(struct sr_input *in, gsize start)
+/*
+ * Decode a PowerIntegrator record into one sample set. Each enabled pod
+ * contributes 17 bits (16 data bits and its clock), in pod order.
+ */
+static void decode_record_pi(const struct context *inc, const uint8_t *rec,
+	uint8_t *wrptr)
 {
-	struct context *inc;
-	uint64_t timestamp, next_timestamp;
-	uint32_t pod_data;
-	char single_payload[12 * 3];
-	GString *buf;
-	int i, pod_count, clk_offset, packet_count, pod;
-	int payload_bit, payload_len, value;
-
-	inc = in->priv;
-	buf = in->buf;
+	uint64_t bits;
+	uint32_t pod_data, clk_data;
+	size_t bit_count;
+	int pod_count, clk_offset, pod;
 
 	/*
 	 * 0x00 u8  timestamp
@@ -470,9 +466,6 @@ static void process_record_pi(struct sr_input *in, gsize start)
 	 * 0x2B/1A u8 ??
 	 * 0x2C/1B u8 ??
 	 */
-
-	timestamp = RL64(buf->str + start);
-
 	if (inc->record_mode == AD_MODE_500MHZ) {
 		pod_count = 6;
 		clk_offset = 0x18;
@@ -481,166 +474,135 @@ static void process_record_pi(struct sr_input *in, gsize start)
 		clk_offset = 0x28;
 	}
 
-	payload_bit = 0;
-	payload_len = 0;
-	single_payload[0] = 0;
-
+	bits = 0;
+	bit_count = 0;
 	for (pod = 0; pod < pod_count; pod++) {
 		if (!inc->pod_status[pod])
 			continue;
-
-		switch (pod) {
-		case 0: /* A */
-			pod_data = RL16(buf->str + start + 0x08);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 1) << 16;
-			break;
-		case 1: /* B */
-			pod_data = RL16(buf->str + start + 0x0A);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 2) << 15;
-			break;
-		case 2: /* C */
-			pod_data = RL16(buf->str + start + 0x0C);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 4) << 14;
-			break;
-		case 3: /* D */
-			pod_data = RL16(buf->str + start + 0x0E);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 8) << 13;
-			break;
-		case 4: /* E */
-			pod_data = RL16(buf->str + start + 0x10);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 16) << 12;
-			break;
-		case 5: /* F */
-			pod_data = RL16(buf->str + start + 0x12);
-			pod_data |= (RL16(buf->str + start + clk_offset) & 32) << 11;
-			break;
-		case 6: /* J */
-			pod_data = RL16(buf->str + start + 0x18);
-			pod_data |= (RL16(buf->str + start + 0x29) & 1) << 16;
-			break;
-		case 7: /* K */
-			pod_data = RL16(buf->str + start + 0x1A);
-			pod_data |= (RL16(buf->str + start + 0x29) & 2) << 15;
-			break;
-		case 8: /* L */
-			pod_data = RL16(buf->str + start + 0x1C);
-			pod_data |= (RL16(buf->str + start + 0x29) & 4) << 14;
-			break;
-		case 9: /* M */
-			pod_data = RL16(buf->str + start + 0x1E);
-			pod_data |= (RL16(buf->str + start + 0x29) & 8) << 13;
-			break;
-		case 10: /* N */
-			pod_data = RL16(buf->str + start + 0x20);
-			pod_data |= (RL16(buf->str + start + 0x29) & 16) << 12;
-			break;
-		case 11: /* O */
-			pod_data = RL16(buf->str + start + 0x22);
-			pod_data |= (RL16(buf->str + start + 0x29) & 32) << 11;
-			break;
-		default:
-			pod_data = 0;
-			sr_err("Don't know how to obtain data for pod %d.", pod);
+		if (pod < 6) {
+			pod_data = RL16(rec + 0x08 + 2 * pod);
+			clk_data = RL16(rec + clk_offset) >> pod;
+		} else {
+			pod_data = RL16(rec + 0x18 + 2 * (pod - 6));
+			clk_data = RL16(rec + 0x29) >> (pod - 6);
 		}
-
-		for (i = 0; i < 17; i++) {
-			value = (pod_data >> i) & 1;
-			single_payload[payload_len] |= value << payload_bit;
-
-			payload_bit++;
-			if (payload_bit > 7) {
-				payload_bit = 0;
-				payload_len++;
-				single_payload[payload_len] = 0;
-			}
+		pod_data |= (clk_data & 1) << 16;
+
+		bits |= (uint64_t)pod_data << bit_count;
+		bit_count += 17;
+		while (bit_count >= 8) {
+			*wrptr++ = bits & 0xff;
+			bits >>= 8;
+			bit_count -= 8;
 		}
 	}
+	if (bit_count)
+		*wrptr = bits & 0xff;
+}
 
-	/* Make sure that payload_len accounts for any incomplete bytes used. */
-	if (payload_bit)
-		payload_len++;
-
-	i = (g_slist_length(in->sdi->channels) + 7) / 8;
-	if (payload_len != i) {
-		sr_err("Payload unit size is %d but should be %d!", payload_len, i);
-		return;
-	}
+/* Decode an IProbe record into one sample set. */
+static void decode_record_iprobe(const struct context *inc, const uint8_t *rec,
+	uint8_t *wrptr)
+{
+	(void)inc;
 
-	if (timestamp == inc->trigger_timestamp && !inc->trigger_sent) {
-		sr_dbg("Trigger @%lf s, record #%d.",
-			timestamp * TIMESTAMP_RESOLUTION, inc->cur_record);
-		std_session_send_df_trigger(in->sdi);
-		inc->trigger_sent = TRUE;
-	}
+	/*
+	 * 0x00 u64 timestamp
+	 * 0x08 u16 IP15..0
+	 * 0x0A u8  CLK
+	 */
+	wrptr[0] = R8(rec + 0x08);
+	wrptr[1] = R8(rec + 0x09);
+	wrptr[2] = R8(rec + 0x0A) & 1;
+}
 
-	/* Is this the last record in the file? */
-	if (inc->cur_record == inc->record_count - 1) {
-		/* It is, so send the last sample data only once. */
-		g_string_append_len(inc->out_buf, single_payload, payload_len);
-	} else {
-		/* It's not, so fill the time gap by sending lots of data. */
-		next_timestamp = RL64(buf->str + start + inc->record_size);
-		packet_count = (int)(next_timestamp - timestamp) / inc->timestamp_scale;
+/* Number of bytes which the records' sample sets occupy. */
+static size_t record_payload_size(const struct context *inc)
+{
+	size_t bit_count;
+	int pod_count, pod;
 
-		/* Make sure we send at least one data set. */
-		if (packet_count == 0)
-			packet_count = 1;
+	if (inc->device == AD_DEVICE_IPROBE)
+		return 3;
 
-		for (i = 0; i < packet_count; i++)
-			g_string_append_len(inc->out_buf, single_payload, payload_len);
+	pod_count = (inc->record_mode == AD_MODE_500MHZ) ? 6 : 12;
+	bit_count = 0;
+	for (pod = 0; pod < pod_count; pod++) {
+		if (inc->pod_status[pod])
+			bit_count += 17;
 	}
 
-	if (inc->out_buf->len >= CHUNK_SIZE)
-		flush_output_buffer(in);
+	return (bit_count + 7) / 8;
 }
 
-static void process_record_iprobe(struct sr_input *in, gsize start)
+/*
+ * Decode a record straight into the feed queue's buffer, and repeat its
+ * sample set to fill the time gap up to the next record.
+ */
+static int process_record(struct sr_input *in, const uint8_t *rec)
 {
 	struct context *inc;
-	uint64_t timestamp, next_timestamp;
-	char single_payload[3];
-	int i, payload_len, packet_count;
+	uint64_t timestamp, next_timestamp, run;
+	uint8_t sample[(MAX_POD_COUNT * 17 + 7) / 8];
+	uint8_t *wrptr;
+	size_t count, done, total, chunk;
+	int ret;
 
 	inc = in->priv;
 
-	/*
-	 * 0x00 u64 timestamp
-	 * 0x08 u16 IP15..0
-	 * 0x0A u8  CLK
-	 */
-
-	timestamp = RL64(in->buf->str + start);
-	single_payload[0] = R8(in->buf->str + start + 0x08);
-	single_payload[1] = R8(in->buf->str + start + 0x09);
-	single_payload[2] = R8(in->buf->str + start + 0x0A) & 1;
-	payload_len = 3;
-
+	timestamp = RL64(rec);
 	if (timestamp == inc->trigger_timestamp && !inc->trigger_sent) {
 		sr_dbg("Trigger @%lf s, record #%d.",
 			timestamp * TIMESTAMP_RESOLUTION, inc->cur_record);
+		ret = feed_queue_logic_flush(inc->feed_logic);
+		if (ret != SR_OK)
+			return ret;
 		std_session_send_df_trigger(in->sdi);
 		inc->trigger_sent = TRUE;
 	}
 
-	/* Is this the last record in the file? */
-	if (inc->cur_record == inc->record_count - 1) {
-		/* It is, so send the last sample data only once. */
-		g_string_append_len(inc->out_buf, single_payload, payload_len);
-	} else {
-		/* It's not, so fill the time gap by sending lots of data. */
-		next_timestamp = RL64(in->buf->str + start + inc->record_size);
-		packet_count = (int)(next_timestamp - timestamp) / inc->timestamp_scale;
-
+	/* Send the last record's sample data only once. */
+	run = 1;
+	if (inc->cur_record != inc->record_count - 1) {
+		/* It's not the last, so fill the time gap. */
+		next_timestamp = RL64(rec + inc->record_size);
+		run = (next_timestamp - timestamp) / inc->timestamp_scale;
 		/* Make sure we send at least one data set. */
-		if (packet_count == 0)
-			packet_count = 1;
+		if (!run)
+			run = 1;
+	}
 
-		for (i = 0; i < packet_count; i++)
-			g_string_append_len(inc->out_buf, single_payload, payload_len);
+	count = MIN(run, SIZE_MAX);
+	wrptr = feed_queue_logic_reserve(inc->feed_logic, &count);
+	if (!wrptr)
+		return SR_ERR;
+	if (inc->device == AD_DEVICE_PI)
+		decode_record_pi(inc, rec, wrptr);
+	else
+		decode_record_iprobe(inc, rec, wrptr);
+	memcpy(sample, wrptr, inc->unitsize);
+
+	/* Double the already written part until the run is complete. */
+	total = count * inc->unitsize;
+	done = inc->unitsize;
+	while (done < total) {
+		chunk = MIN(done, total - done);
+		memcpy(&wrptr[done], wrptr, chunk);
+		done += chunk;
+	}
+	ret = feed_queue_logic_commit(inc->feed_logic, count);
+	if (ret != SR_OK)
+		return ret;
+	run -= count;
+	while (run) {
+		count = MIN(run, SIZE_MAX);
+		ret = feed_queue_logic_submit(inc->feed_logic, sample, count);
+		if (ret != SR_OK)
+			return ret;
+		run -= count;
 	}
 
-	if (inc->out_buf->len >= CHUNK_SIZE)
-		flush_output_buffer(in);
+	return SR_OK;
 }
 
 static void process_practice_token(struct sr_input *in, char *cmd_token)
@@ -755,6 +717,7 @@ static void process_practice(struct sr_input *in)
 static int process_buffer(struct sr_input *in)
 {
 	struct context *inc;
+	const uint8_t *rec;
 	int i, chunk_size, res;
 
 	inc = in->priv;
@@ -772,24 +735,27 @@ static int process_buffer(struct sr_input *in)
 	}
 
 	if (!inc->records_read) {
+		if (inc->device != AD_DEVICE_PI && inc->device != AD_DEVICE_IPROBE) {
+			sr_err("Trying to process records for unknown device!");
+			return SR_ERR;
+		}
+		if (record_payload_size(inc) != inc->unitsize) {
+			sr_err("Payload unit size is %zu but should be %zu!",
+				record_payload_size(inc), inc->unitsize);
+			return SR_ERR_DATA;
+		}
+
 		/* Cut off at a multiple of the record size. */
 		chunk_size = ((in->buf->len) / inc->record_size) * inc->record_size;
 
 		/* There needs to be at least one more record process_record() can peek into. */
 		chunk_size -= inc->record_size;
 
+		rec = (const uint8_t *)in->buf->str;
 		for (i = 0; (i < chunk_size) && (!inc->records_read); i += inc->record_size) {
-			switch (inc->device) {
-			case AD_DEVICE_PI:
-				process_record_pi(in, i);
-				break;
-			case AD_DEVICE_IPROBE:
-				process_record_iprobe(in, i);
-				break;
-			default:
-				sr_err("Trying to process records for unknown device!");
-				return SR_ERR;
-			}
+			res = process_record(in, &rec[i]);
+			if (res != SR_OK)
+				return res;
 
 			inc->cur_record++;
 			if (inc->cur_record == inc->record_count)
@@ -832,14 +798,23 @@ static int end(struct sr_input *in)
 	else
 		ret = SR_OK;
 
-	flush_output_buffer(in);
-
-	if (inc->meta_sent)
+	if (inc->meta_sent) {
+		feed_queue_logic_flush(inc->feed_logic);
 		std_session_send_df_end(in->sdi);
+	}
 
 	return ret;
 }
 
+static void cleanup(struct sr_input *in)
+{
+	struct context *inc;
+
+	inc = in->priv;
+	feed_queue_logic_free(inc->feed_logic);
+	inc->feed_logic = NULL;
+}
+
 static int reset(struct sr_input *in)
 {
 	struct context *inc = in->priv;
@@ -872,6 +847,7 @@ static struct sr_option options[] = {
 	{ "podO", "Import pod O", "Create channels and data for pod O", NULL, NULL },
 
 	{ "samplerate", "Reduced sample rate (MHz)", "Reduce the original sample rate of 12.8 GHz to the specified sample rate in MHz", NULL, NULL },
+	{ "packetsize", "Packet size (samples)", "Number of samples per packet which gets sent to the session (0 = automatic)", NULL, NULL },
 
 	ALL_ZERO
 };
@@ -892,6 +868,7 @@ static const struct sr_option *get_options(void)
 		options[10].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
 		options[11].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
 		options[12].def = g_variant_ref_sink(g_variant_new_uint32(DEFAULT_SAMPLERATE));
+		options[13].def = g_variant_ref_sink(g_variant_new_uint32(0));
 	}
 
 	return options;
@@ -908,5 +885,6 @@ SR_PRIV struct sr_input_module input_trace32_ad = {
 	.init = init,
 	.receive = receive,
 	.end = end,
+	.cleanup = cleanup,
 	.reset = reset,
 };
@@ -66,7 +66,13 @@
  * glib routines where they would hurt performance. Lots of memory
  * allocations increase execution time not by percents but by huge
  * factors. This motivated this module's custom code for splitting
- * words on text lines, and pooling previously allocated buffers.
+ * words on text lines in place, and the hash table lookup of signal
+ * identifiers for every value change.
+ *
+ * Sample ranges of mapped input get imported by parsing from the closest
+ * preceding entry of a sparse index. Entries hold the parser state at
+ * a timestamp line, and get recorded as parsing proceeds through input
+ * which the index does not cover yet.
  *
  * TODO (in arbitrary order)
  * - Map VCD scopes to sigrok channel groups?
@@ -118,8 +124,18 @@
 #define LOG_PREFIX "input/vcd"
 
 #define CHUNK_SIZE (4 * 1024 * 1024)
+#define PARSE_CHUNK_SIZE (16 * 1024 * 1024)
+#define INDEX_STEP (1024 * 1024)
 #define SCOPE_SEP '.'
 
+/* State of the data section parser, one per thread. */
+struct vcd_parse {
+	gboolean skip_until_end;
+	gboolean ignore_end_keyword;
+	uint8_t *bits; /* Text to number conversion. */
+	GByteArray *changes; /* Recorded changes, NULL to apply them. */
+};
+
 struct context {
 	struct vcd_user_opt {
 		size_t maxchannels; /* sigrok channels (output) */
@@ -127,6 +143,7 @@ struct context {
 		uint64_t compress;
 		uint64_t skip_starttime;
 		gboolean skip_specified;
+		size_t threads;
 	} options;
 	gboolean use_skip;
 	gboolean started;
@@ -134,10 +151,10 @@ struct context {
 	uint64_t prev_timestamp;
 	uint64_t samplerate;
 	size_t vcdsignals; /* VCD signals (input) */
-	GSList *ignored_signals;
+	GHashTable *signals; /* identifier -> struct vcd_channel */
+	GHashTable *ignored_signals; /* set of identifiers */
 	gboolean data_after_timestamp;
-	gboolean ignore_end_keyword;
-	gboolean skip_until_end;
+	struct vcd_parse parse;
 	GSList *channels;
 	size_t unit_size;
 	size_t logic_count;
@@ -147,16 +164,26 @@ struct context {
 	struct {
 		size_t max_bits;
 		size_t unit_size;
-		uint8_t *value;
-		size_t sig_count;
 	} conv_bits;
 	GString *scope_prefix;
+	/* Text line copied out of a read-only mapped buffer. */
+	GString *line;
 	struct feed_queue_logic *feed_logic;
-	struct split_state {
-		size_t alloced;
-		char **words;
-		gboolean in_use;
-	} split;
+	/* Workers which parse chunks of mapped input, chunks in flight. */
+	GThreadPool *pool;
+	GQueue jobs;
+	/* Sample range of sr_input_send_file_range(), and the position. */
+	struct vcd_range {
+		gboolean active;
+		uint64_t start, end;
+		uint64_t pos;
+	} range;
+	/* Seek index of mapped input, kept across resets. */
+	struct vcd_index {
+		size_t data_len;
+		size_t data_offset;
+		GArray *entries;
+	} index;
 	struct ts_stats {
 		size_t total_ts_seen;
 		uint64_t last_ts_value;
@@ -187,6 +214,55 @@ struct vcd_channel {
 	size_t range_lower, range_upper;
 	int submit_digits;
 	struct feed_queue_analog *feed_analog;
+	/* Next declaration which uses the same identifier. */
+	struct vcd_channel *next_alias;
+};
+
+/*
+ * Value changes which a worker has recorded, to get applied in input
+ * data order. Bit vector changes are followed by their bit values.
+ */
+enum vcd_change_type {
+	VCD_CHANGE_TIME,
+	VCD_CHANGE_BITS,
+	VCD_CHANGE_REAL,
+};
+
+struct vcd_change {
+	enum vcd_change_type type;
+	struct vcd_channel *vcd_ch;
+	union {
+		uint64_t timestamp;
+		size_t bit_count;
+		float real_val;
+	} u;
+};
+
+/*
+ * Parser state before a timestamp line of mapped input. Parsing can
+ * resume there after the state got restored.
+ */
+struct vcd_index_entry {
+	size_t offset;
+	uint64_t pos;
+	uint64_t prev_timestamp;
+	uint64_t skip_starttime;
+	gboolean use_skip;
+	gboolean data_after_timestamp;
+	uint8_t *logic;
+	float *floats;
+};
+
+/* A chunk of mapped input for a worker, and the worker's results. */
+struct vcd_job {
+	const char *data;
+	size_t len;
+	struct vcd_parse parse;
+	GString *line;
+	int ret;
+	gboolean done;
+	GMutex mutex;
+	GCond cond;
 };
 
 static void free_channel(void *data)
@@ -538,10 +614,8 @@ static gboolean parse_section(GString *buf, char **name, char **contents)
  * The repeated memory allocation is acceptable for small workloads like
  * parsing the header sections. But the heavy lifting for sample data is
  * done by DIY code to speedup execution. The use of glib routines would
- * severely hurt throughput. Allocated memory gets re-used while a strict
- * ping-pong pattern is assumed (each text line of input data enters and
- * leaves in a strict symmetrical manner, due to the organization of the
- * receive() routine and parse calls).
+ * severely hurt throughput. Words of the data section get split in place
+ * and in a single pass, one word at a time, as the parser consumes them.
  */
 
 /* Remove empty parts from an array returned by g_strsplit(). */
@@ -563,107 +637,34 @@ static void remove_empty_parts(gchar **parts)
 	*dest = NULL;
 }
 
-static char **split_text_line(struct context *inc, char *text, size_t *count)
+/*
+ * Get the next space separated word from a text line. Terminates the
+ * word in place, and advances the caller's text position past it.
+ * Returns NULL when the text line is exhausted.
+ */
+static char *next_text_word(char **text)
 {
-	struct split_state *state;
-	size_t counted, alloced, wanted;
-	char **words, *p, **new_words;
+	char *p, *word;
 
-	state = &inc->split;
+	p = *text;
 
-	if (count)
-		*count = 0;
-
-	if (state->in_use) {
-		sr_dbg("coding error, split() called while \"in use\".");
+	/* Skip leading spaces. */
+	while (g_ascii_isspace(*p))
+		p++;
+	if (!*p) {
+		*text = p;
 		return NULL;
 	}
 
-	/*
-	 * Seed allocation when invoked for the first time. Assume
-	 * simple logic data, start with a few words per line. Will
-	 * automatically adjust with subsequent use.
-	 */
-	if (!state->alloced) {
-		alloced = 20;
-		words = g_malloc(sizeof(words[0]) * alloced);
-		if (!words)
-			return NULL;
-		state->alloced = alloced;
-		state->words = words;
-	}
-
-	/* Start with most recently allocated word list space. */
-	alloced = state->alloced;
-	words = state->words;
-	counted = 0;
-
-	/* As long as more input text remains ... */
-	p = text;
-	while (*p) {
-		/* Resize word list if needed. Just double the size. */
-		if (counted + 1 >= alloced) {
-			wanted = 2 * alloced;
-			new_words = g_realloc(words, sizeof(words[0]) * wanted);
-			if (!new_words) {
-				return NULL;
-			}
-			words = new_words;
-			alloced = wanted;
-			state->words = words;
-			state->alloced = alloced;
-		}
-
-		/* Skip leading spaces. */
-		while (g_ascii_isspace(*p))
-			p++;
-		if (!*p)
-			break;
-
-		/* Add found word to word list. */
-		words[counted++] = p;
-
-		/* Find end of the word. Terminate loop upon EOS. */
-		while (*p && !g_ascii_isspace(*p))
-			p++;
-		if (!*p)
-			break;
-
-		/* More text follows. Terminate the word. */
+	/* Find end of the word. Terminate it when more text follows. */
+	word = p;
+	while (*p && !g_ascii_isspace(*p))
+		p++;
+	if (*p)
 		*p++ = '\0';
-	}
-
-	/*
-	 * NULL terminate the word list. Provide its length so that
-	 * calling code need not re-iterate the list to get the count.
-	 */
-	words[counted] = NULL;
-	if (count)
-		*count = counted;
-	state->in_use = TRUE;
-
-	return words;
-}
-
-static void free_text_split(struct context *inc, char **words)
-{
-	struct split_state *state;
+	*text = p;
 
-	state = &inc->split;
-
-	if (words && words != state->words) {
-		sr_dbg("coding error, free() arg differs from split() result.");
-	}
-
-	/* "Double free" finally releases the memory. */
-	if (!state->in_use) {
-		g_free(state->words);
-		state->words = NULL;
-		state->alloced = 0;
-	}
-
-	/* Mark as no longer in use. */
-	state->in_use = FALSE;
+	return word;
 }
 
 static gboolean have_header(GString *buf)
@@ -815,6 +816,27 @@ static int parse_scope(struct context *inc, char *contents, gboolean is_up)
  * @param[in] inc Input module context.
  * @param[in] contents Input text, content of $var section.
  */
+/*
+ * Register a signal for the lookup of its identifier. Several $var
+ * declarations may use the same identifier, these get chained in the
+ * order of their declaration.
+ */
+static void add_signal(struct context *inc, struct vcd_channel *vcd_ch)
+{
+	struct vcd_channel *alias;
+
+	if (!inc->signals)
+		inc->signals = g_hash_table_new(g_str_hash, g_str_equal);
+	alias = g_hash_table_lookup(inc->signals, vcd_ch->identifier);
+	if (!alias) {
+		g_hash_table_insert(inc->signals, vcd_ch->identifier, vcd_ch);
+		return;
+	}
+	while (alias->next_alias)
+		alias = alias->next_alias;
+	alias->next_alias = vcd_ch;
+}
+
 static int parse_header_var(struct context *inc, char *contents)
 {
 	char **parts;
@@ -891,8 +913,10 @@ static int parse_header_var(struct context *inc, char *contents)
 	if (inc->options.maxchannels && next_size > inc->options.maxchannels) {
 		sr_warn("Skipping '%s%s', exceeds requested channel count %zu.",
 			ref, idx ? idx : "", inc->options.maxchannels);
-		inc->ignored_signals = g_slist_append(inc->ignored_signals,
-			g_strdup(id));
+		if (!inc->ignored_signals)
+			inc->ignored_signals = g_hash_table_new_full(g_str_hash,
+				g_str_equal, g_free, NULL);
+		g_hash_table_add(inc->ignored_signals, g_strdup(id));
 		g_strfreev(parts);
 		return SR_OK;
 	}
@@ -922,6 +946,7 @@ static int parse_header_var(struct context *inc, char *contents)
 		vcd_ch->type == SR_CHANNEL_ANALOG ? "A" : "L",
 		vcd_ch->array_index);
 	inc->channels = g_slist_append(inc->channels, vcd_ch);
+	add_signal(inc, vcd_ch);
 	g_strfreev(parts);
 
 	return SR_OK;
@@ -1256,8 +1281,8 @@ done_section:
 	 */
 	size = (inc->conv_bits.max_bits + 7) / 8;
 	inc->conv_bits.unit_size = size;
-	inc->conv_bits.value = g_malloc0(size);
-	if (!inc->conv_bits.value)
+	inc->parse.bits = g_malloc0(size);
+	if (!inc->parse.bits)
 		return SR_ERR_MALLOC;
 
 	size = (inc->logic_count + 7) / 8;
@@ -1291,9 +1316,20 @@ static void add_samples(const struct sr_input *in, size_t count, gboolean flush)
 	struct vcd_channel *vcd_ch;
 	struct feed_queue_analog *q;
 	float value;
+	uint64_t first, last;
 
 	inc = in->priv;
 
+	/* Only send what's within the range, when one was requested. */
+	if (inc->range.active) {
+		first = MAX(inc->range.pos, inc->range.start);
+		last = MIN(inc->range.pos + count, inc->range.end);
+		inc->range.pos += count;
+		count = last > first ? last - first : 0;
+		if (!count && !flush)
+			return;
+	}
+
 	if (inc->logic_count) {
 		feed_queue_logic_submit(inc->feed_logic,
 			inc->current_logic, count);
@@ -1314,17 +1350,21 @@ static void add_samples(const struct sr_input *in, size_t count, gboolean flush)
 	}
 }
 
-static gint vcd_compare_id(gconstpointer a, gconstpointer b)
+static struct vcd_channel *lookup_signal(struct context *inc,
+	const char *id)
 {
-	return strcmp((const char *)a, (const char *)b);
+	if (!inc->signals)
+		return NULL;
+
+	return g_hash_table_lookup(inc->signals, id);
 }
 
 static gboolean is_ignored(struct context *inc, const char *id)
 {
-	GSList *ignored;
+	if (!inc->ignored_signals)
+		return FALSE;
 
-	ignored = g_slist_find_custom(inc->ignored_signals, id, vcd_compare_id);
-	return ignored != NULL;
+	return g_hash_table_contains(inc->ignored_signals, id);
 }
 
 /*
@@ -1358,13 +1398,11 @@ static float get_int_val(uint8_t *in_bits_data, size_t in_bits_count)
  * and parsed value. Multi-bit VCD values will affect several sigrok
  * channels. One VCD signal name can translate to several sigrok channels.
  */
-static void process_bits(struct context *inc, char *identifier,
+static void process_bits(struct context *inc, struct vcd_channel *vcd_ch,
 	uint8_t *in_bits_data, size_t in_bits_count)
 {
 	size_t size;
 	gboolean have_int;
-	GSList *l;
-	struct vcd_channel *vcd_ch;
 	float int_val;
 	size_t bit_idx;
 	uint8_t *in_bit_ptr, in_bit_mask;
@@ -1374,10 +1412,7 @@ static void process_bits(struct context *inc, char *identifier,
 	size = 0;
 	have_int = FALSE;
 	int_val = 0;
-	for (l = inc->channels; l; l = l->next) {
-		vcd_ch = l->data;
-		if (g_strcmp0(identifier, vcd_ch->identifier) != 0)
-			continue;
+	for (; vcd_ch; vcd_ch = vcd_ch->next_alias) {
 		if (vcd_ch->type == SR_CHANNEL_ANALOG) {
 			/* Special case for 'integer' VCD signal types. */
 			size = vcd_ch->size; /* Flag for "VCD signal found". */
@@ -1392,7 +1427,7 @@ static void process_bits(struct context *inc, char *identifier,
 			continue;
 		sr_spew("Processing %s data, id '%s', ch %zu sz %zu",
 			(size == 1) ? "bit" : "vector",
-			identifier, vcd_ch->array_index, vcd_ch->size);
+			vcd_ch->identifier, vcd_ch->array_index, vcd_ch->size);
 
 		/* Found our (logic) channel. Setup in/out bit positions. */
 		size = vcd_ch->size;
@@ -1433,36 +1468,82 @@ static void process_bits(struct context *inc, char *identifier,
 			}
 		}
 	}
-	if (!size && !is_ignored(inc, identifier))
-		sr_warn("VCD signal not found for ID '%s'.", identifier);
 }
 
 /*
  * Set an analog channel's value from a floating point number. One
  * VCD signal name can translate to several sigrok channels.
  */
-static void process_real(struct context *inc, char *identifier, float real_val)
+static void process_real(struct context *inc, struct vcd_channel *vcd_ch,
+	float real_val)
 {
-	gboolean found;
-	GSList *l;
-	struct vcd_channel *vcd_ch;
-
-	found = FALSE;
-	for (l = inc->channels; l; l = l->next) {
-		vcd_ch = l->data;
+	for (; vcd_ch; vcd_ch = vcd_ch->next_alias) {
 		if (vcd_ch->type != SR_CHANNEL_ANALOG)
 			continue;
-		if (g_strcmp0(identifier, vcd_ch->identifier) != 0)
-			continue;
 
 		/* Found our (analog) channel. */
-		found = TRUE;
 		sr_spew("Processing real data, id '%s', ch %zu, val %.16g",
-			identifier, vcd_ch->array_index, real_val);
+			vcd_ch->identifier, vcd_ch->array_index, real_val);
 		inc->current_floats[vcd_ch->array_index] = real_val;
 	}
-	if (!found && !is_ignored(inc, identifier))
+}
+
+/*
+ * Look up the signal of a value change. Either apply the change, or
+ * record it when the parser runs in a worker. Changes get applied in
+ * input data order, after the worker is done.
+ */
+static struct vcd_channel *change_signal(struct context *inc,
+	const char *identifier)
+{
+	struct vcd_channel *vcd_ch;
+
+	vcd_ch = lookup_signal(inc, identifier);
+	if (!vcd_ch && !is_ignored(inc, identifier))
 		sr_warn("VCD signal not found for ID '%s'.", identifier);
+
+	return vcd_ch;
+}
+
+static void change_bits(struct context *inc, struct vcd_parse *ps,
+	const char *identifier, uint8_t *bits, size_t bit_count)
+{
+	struct vcd_channel *vcd_ch;
+	struct vcd_change change;
+
+	vcd_ch = change_signal(inc, identifier);
+	if (!vcd_ch)
+		return;
+	if (!ps->changes) {
+		process_bits(inc, vcd_ch, bits, bit_count);
+		return;
+	}
+	memset(&change, 0, sizeof(change));
+	change.type = VCD_CHANGE_BITS;
+	change.vcd_ch = vcd_ch;
+	change.u.bit_count = bit_count;
+	g_byte_array_append(ps->changes, (const guint8 *)&change, sizeof(change));
+	g_byte_array_append(ps->changes, bits, (bit_count + 7) / 8);
+}
+
+static void change_real(struct context *inc, struct vcd_parse *ps,
+	const char *identifier, float real_val)
+{
+	struct vcd_channel *vcd_ch;
+	struct vcd_change change;
+
+	vcd_ch = change_signal(inc, identifier);
+	if (!vcd_ch)
+		return;
+	if (!ps->changes) {
+		process_real(inc, vcd_ch, real_val);
+		return;
+	}
+	memset(&change, 0, sizeof(change));
+	change.type = VCD_CHANGE_REAL;
+	change.vcd_ch = vcd_ch;
+	change.u.real_val = real_val;
+	g_byte_array_append(ps->changes, (const guint8 *)&change, sizeof(change));
 }
 
 /*
@@ -1510,46 +1591,116 @@ static uint8_t vcd_char_to_value(char bit_char, int *warn)
 	return ~0;
 }
 
+/*
+ * Numbers prefixed by '#' are timestamps, which translate to sigrok
+ * sample numbers. Apply optional downsampling, and apply the 'skip'
+ * logic. Check the recent timestamp for plausibility. Submit the
+ * corresponding number of samples of previously accumulated data
+ * values to the session feed.
+ */
+static int process_timestamp(const struct sr_input *in, uint64_t timestamp)
+{
+	struct context *inc;
+	int ret;
+	size_t count;
+
+	inc = in->priv;
+
+	ret = ts_stats_check(&inc->ts_stats, timestamp);
+	if (ret != SR_OK)
+		return ret;
+	if (inc->options.downsample > 1) {
+		timestamp /= inc->options.downsample;
+		sr_spew("Downsampled timestamp: %" PRIu64, timestamp);
+	}
+
+	/*
+	 * Skip < 0 => skip until first timestamp.
+	 * Skip = 0 => don't skip
+	 * Skip > 0 => skip until timestamp >= skip.
+	 */
+	if (inc->options.skip_specified && !inc->use_skip) {
+		sr_dbg("Seeding skip from user spec %" PRIu64,
+			inc->options.skip_starttime);
+		inc->prev_timestamp = inc->options.skip_starttime;
+		inc->use_skip = TRUE;
+	}
+	if (!inc->use_skip) {
+		sr_dbg("Seeding skip from first timestamp");
+		inc->options.skip_starttime = timestamp;
+		inc->prev_timestamp = timestamp;
+		inc->use_skip = TRUE;
+		return SR_OK;
+	}
+	if (inc->options.skip_starttime && timestamp < inc->options.skip_starttime) {
+		sr_spew("Timestamp skipped, before user spec");
+		inc->prev_timestamp = inc->options.skip_starttime;
+		return SR_OK;
+	}
+	if (timestamp == inc->prev_timestamp) {
+		/*
+		 * Ignore repeated timestamps (e.g. sigrok outputs
+		 * these). Can also happen when downsampling makes
+		 * distinct input values end up at the same scaled
+		 * down value. Also transparently covers the initial
+		 * timestamp.
+		 */
+		sr_spew("Timestamp is identical to previous timestamp");
+		return SR_OK;
+	}
+	if (timestamp < inc->prev_timestamp) {
+		sr_err("Invalid timestamp: %" PRIu64 " (leap backwards).", timestamp);
+		return SR_ERR_DATA;
+	}
+	if (inc->options.compress) {
+		/* Compress long idle periods */
+		count = timestamp - inc->prev_timestamp;
+		if (count > inc->options.compress) {
+			sr_dbg("Long idle period, compressing");
+			count = timestamp - inc->options.compress;
+			inc->prev_timestamp = count;
+		}
+	}
+
+	/* Generate samples from prev_timestamp up to timestamp - 1. */
+	count = timestamp - inc->prev_timestamp;
+	sr_spew("Got a new timestamp, feeding %zu samples", count);
+	add_samples(in, count, FALSE);
+	inc->prev_timestamp = timestamp;
+	inc->data_after_timestamp = FALSE;
+
+	return SR_OK;
+}
+
 /* Parse one text line of the data section. */
-static int parse_textline(const struct sr_input *in, char *lines)
+static int parse_textline(const struct sr_input *in, struct vcd_parse *ps,
+	char *lines)
 {
 	struct context *inc;
 	int ret;
-	char **words;
-	size_t word_count, word_idx;
-	char *curr_word, *next_word, curr_first;
+	char *text, *curr_word, curr_first;
 	gboolean is_timestamp, is_section, is_real, is_multibit, is_singlebit;
 	uint64_t timestamp;
 	char *identifier, *endptr;
-	size_t count;
+	struct vcd_change change;
 
 	inc = in->priv;
 
 	/*
-	 * Split the caller's text lines into a list of space separated
-	 * words. Note that some of the branches consume the very next
-	 * words as well, and assume that both adjacent words will be
-	 * available when the first word is seen. This constraint applies
-	 * to bit vector data, multi-bit integers and real (float) data,
-	 * as well as single-bit data with whitespace before its
+	 * Split the caller's text lines into space separated words, in
+	 * place while they get consumed. Note that some of the branches
+	 * consume the very next word as well, and assume that it will
+	 * be available when the first word is seen. This constraint
+	 * applies to bit vector data, multi-bit integers and real (float)
+	 * data, as well as single-bit data with whitespace before its
 	 * identifier (if that's valid in VCD, we'd accept it here).
 	 * The fact that callers always pass complete text lines should
 	 * make this assumption acceptable.
 	 */
 	ret = SR_OK;
-	words = split_text_line(inc, lines, &word_count);
-	for (word_idx = 0; word_idx < word_count; word_idx++) {
-		/*
-		 * Make the next two words available, to simpilify code
-		 * paths below. The second word is optional here.
-		 */
-		curr_word = words[word_idx];
-		if (!curr_word && !curr_word[0])
-			continue;
+	text = lines;
+	while ((curr_word = next_text_word(&text))) {
 		curr_first = g_ascii_tolower(curr_word[0]);
-		next_word = words[word_idx + 1];
-		if (next_word && !next_word[0])
-			next_word = NULL;
 
 		/*
 		 * Optionally skip some sections that can be interleaved
@@ -1559,20 +1710,20 @@ static int parse_textline(const struct sr_input *in, char *lines)
 		 * this case, for improved robustness (still reject files
 		 * which happen to use invalid syntax).
 		 */
-		if (inc->skip_until_end) {
+		if (ps->skip_until_end) {
 			if (strcmp(curr_word, "$end") == 0) {
 				/* Done with unhandled/unknown section. */
 				sr_dbg("done skipping until $end");
-				inc->skip_until_end = FALSE;
+				ps->skip_until_end = FALSE;
 			} else {
 				sr_spew("skipping word: %s", curr_word);
 			}
 			continue;
 		}
-		if (inc->ignore_end_keyword) {
+		if (ps->ignore_end_keyword) {
 			if (strcmp(curr_word, "$end") == 0) {
 				sr_dbg("done ignoring $end keyword");
-				inc->ignore_end_keyword = FALSE;
+				ps->ignore_end_keyword = FALSE;
 				continue;
 			}
 		}
@@ -1595,22 +1746,18 @@ static int parse_textline(const struct sr_input *in, char *lines)
 			if (inspect_data) {
 				/* Ignore keywords, yet parse contents. */
 				sr_dbg("%s section, will parse content", curr_word);
-				inc->ignore_end_keyword = TRUE;
+				ps->ignore_end_keyword = TRUE;
 			} else {
 				/* Ignore section from here up to $end. */
 				sr_dbg("%s section, will skip until $end", curr_word);
-				inc->skip_until_end = TRUE;
+				ps->skip_until_end = TRUE;
 			}
 			continue;
 		}
 
 		/*
-		 * Numbers prefixed by '#' are timestamps, which translate
-		 * to sigrok sample numbers. Apply optional downsampling,
-		 * and apply the 'skip' logic. Check the recent timestamp
-		 * for plausibility. Submit the corresponding number of
-		 * samples of previously accumulated data values to the
-		 * session feed.
+		 * Numbers prefixed by '#' are timestamps. Workers record
+		 * them, and they get processed in input data order.
 		 */
 		is_timestamp = curr_first == '#' && g_ascii_isdigit(curr_word[1]);
 		if (is_timestamp) {
@@ -1622,73 +1769,21 @@ static int parse_textline(const struct sr_input *in, char *lines)
 				break;
 			}
 			sr_spew("Got timestamp: %" PRIu64, timestamp);
-			ret = ts_stats_check(&inc->ts_stats, timestamp);
-			if (ret != SR_OK)
-				break;
-			if (inc->options.downsample > 1) {
-				timestamp /= inc->options.downsample;
-				sr_spew("Downsampled timestamp: %" PRIu64, timestamp);
-			}
-
-			/*
-			 * Skip < 0 => skip until first timestamp.
-			 * Skip = 0 => don't skip
-			 * Skip > 0 => skip until timestamp >= skip.
-			 */
-			if (inc->options.skip_specified && !inc->use_skip) {
-				sr_dbg("Seeding skip from user spec %" PRIu64,
-					inc->options.skip_starttime);
-				inc->prev_timestamp = inc->options.skip_starttime;
-				inc->use_skip = TRUE;
-			}
-			if (!inc->use_skip) {
-				sr_dbg("Seeding skip from first timestamp");
-				inc->options.skip_starttime = timestamp;
-				inc->prev_timestamp = timestamp;
-				inc->use_skip = TRUE;
-				continue;
-			}
-			if (inc->options.skip_starttime && timestamp < inc->options.skip_starttime) {
-				sr_spew("Timestamp skipped, before user spec");
-				inc->prev_timestamp = inc->options.skip_starttime;
-				continue;
-			}
-			if (timestamp == inc->prev_timestamp) {
-				/*
-				 * Ignore repeated timestamps (e.g. sigrok
-				 * outputs these). Can also happen when
-				 * downsampling makes distinct input values
-				 * end up at the same scaled down value.
-				 * Also transparently covers the initial
-				 * timestamp.
-				 */
-				sr_spew("Timestamp is identical to previous timestamp");
+			if (ps->changes) {
+				memset(&change, 0, sizeof(change));
+				change.type = VCD_CHANGE_TIME;
+				change.u.timestamp = timestamp;
+				g_byte_array_append(ps->changes,
+					(const guint8 *)&change, sizeof(change));
 				continue;
 			}
-			if (timestamp < inc->prev_timestamp) {
-				sr_err("Invalid timestamp: %" PRIu64 " (leap backwards).", timestamp);
-				ret = SR_ERR_DATA;
+			ret = process_timestamp(in, timestamp);
+			if (ret != SR_OK)
 				break;
-			}
-			if (inc->options.compress) {
-				/* Compress long idle periods */
-				count = timestamp - inc->prev_timestamp;
-				if (count > inc->options.compress) {
-					sr_dbg("Long idle period, compressing");
-					count = timestamp - inc->options.compress;
-					inc->prev_timestamp = count;
-				}
-			}
-
-			/* Generate samples from prev_timestamp up to timestamp - 1. */
-			count = timestamp - inc->prev_timestamp;
-			sr_spew("Got a new timestamp, feeding %zu samples", count);
-			add_samples(in, count, FALSE);
-			inc->prev_timestamp = timestamp;
-			inc->data_after_timestamp = FALSE;
 			continue;
 		}
-		inc->data_after_timestamp = TRUE;
+		if (!ps->changes)
+			inc->data_after_timestamp = TRUE;
 
 		/*
 		 * Data values come in different formats, are associated
@@ -1730,8 +1825,7 @@ static int parse_textline(const struct sr_input *in, char *lines)
 			float real_val;
 
 			real_text = &curr_word[1];
-			identifier = next_word;
-			word_idx++;
+			identifier = next_text_word(&text);
 			if (!*real_text || !identifier || !*identifier) {
 				sr_err("Unexpected real format.");
 				ret = SR_ERR_DATA;
@@ -1744,12 +1838,12 @@ static int parse_textline(const struct sr_input *in, char *lines)
 				ret = SR_ERR_DATA;
 				break;
 			}
-			process_real(inc, identifier, real_val);
+			change_real(inc, ps, identifier, real_val);
 			continue;
 		}
 		if (is_multibit) {
 			char *bits_text_start;
-			size_t bit_count;
+			size_t bit_count, sig_count;
 			char *bits_text, bit_char;
 			uint8_t bit_value;
 			uint8_t *value_ptr, value_mask;
@@ -1765,8 +1859,7 @@ static int parse_textline(const struct sr_input *in, char *lines)
 			 * we may never unify code paths at all here.
 			 */
 			bits_text = &curr_word[1];
-			identifier = next_word;
-			word_idx++;
+			identifier = next_text_word(&text);
 
 			if (!*bits_text || !identifier || !*identifier) {
 				sr_err("Unexpected integer/vector format.");
@@ -1799,12 +1892,12 @@ static int parse_textline(const struct sr_input *in, char *lines)
 				ret = SR_ERR_DATA;
 				break;
 			}
-			memset(inc->conv_bits.value, 0, inc->conv_bits.unit_size);
-			value_ptr = &inc->conv_bits.value[0];
+			memset(ps->bits, 0, inc->conv_bits.unit_size);
+			value_ptr = &ps->bits[0];
 			value_mask = 1 << 0;
-			inc->conv_bits.sig_count = 0;
+			sig_count = 0;
 			while (bits_text > bits_text_start) {
-				inc->conv_bits.sig_count++;
+				sig_count++;
 				bit_char = *(--bits_text);
 				bit_value = vcd_char_to_value(bit_char, NULL);
 				if (bit_value == 0) {
@@ -1812,7 +1905,7 @@ static int parse_textline(const struct sr_input *in, char *lines)
 				} else if (bit_value == 1) {
 					*value_ptr |= value_mask;
 				} else {
-					inc->conv_bits.sig_count = 0;
+					sig_count = 0;
 					break;
 				}
 				value_mask <<= 1;
@@ -1821,21 +1914,20 @@ static int parse_textline(const struct sr_input *in, char *lines)
 					value_mask = 1 << 0;
 				}
 			}
-			if (!inc->conv_bits.sig_count) {
+			if (!sig_count) {
 				sr_err("Unexpected vector format: %s",
 					bits_text_start);
 				ret = SR_ERR_DATA;
 				break;
 			}
 			if (sr_log_loglevel_get() >= SR_LOG_SPEW) {
-				bits_val_text = sr_hexdump_new(inc->conv_bits.value,
-					value_ptr - inc->conv_bits.value + 1);
+				bits_val_text = sr_hexdump_new(ps->bits,
+					value_ptr - ps->bits + 1);
 				sr_spew("Vector value: %s.", bits_val_text->str);
 				sr_hexdump_free(bits_val_text);
 			}
 
-			process_bits(inc, identifier,
-				inc->conv_bits.value, inc->conv_bits.sig_count);
+			change_bits(inc, ps, identifier, ps->bits, sig_count);
 			continue;
 		}
 		if (is_singlebit) {
@@ -1851,10 +1943,8 @@ static int parse_textline(const struct sr_input *in, char *lines)
 				break;
 			}
 			identifier = ++bits_text;
-			if (!*identifier) {
-				identifier = next_word;
-				word_idx++;
-			}
+			if (!*identifier)
+				identifier = next_text_word(&text);
 			if (!identifier || !*identifier) {
 				sr_err("Identifier missing.");
 				ret = SR_ERR_DATA;
@@ -1868,8 +1958,8 @@ static int parse_textline(const struct sr_input *in, char *lines)
 				ret = SR_ERR_DATA;
 				break;
 			}
-			inc->conv_bits.value[0] = bit_value;
-			process_bits(inc, identifier, inc->conv_bits.value, 1);
+			ps->bits[0] = bit_value;
+			change_bits(inc, ps, identifier, ps->bits, 1);
 			continue;
 		}
 
@@ -1878,23 +1968,18 @@ static int parse_textline(const struct sr_input *in, char *lines)
 		ret = SR_ERR_DATA;
 		break;
 	}
-	free_text_split(inc, words);
 
 	return ret;
 }
 
-static int process_buffer(struct sr_input *in, gboolean is_eof)
+/* Send feed header and samplerate (once) before sample data. */
+static void send_feed_header(struct sr_input *in)
 {
 	struct context *inc;
 	uint64_t samplerate;
 	GVariant *gvar;
-	int ret;
-	char *rdptr, *endptr, *trimptr;
-	size_t rdlen;
 
 	inc = in->priv;
-
-	/* Send feed header and samplerate (once) before sample data. */
 	if (!inc->started) {
 		std_session_send_df_header(in->sdi);
 
@@ -1906,6 +1991,15 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 
 		inc->started = TRUE;
 	}
+}
+
+static int process_buffer(struct sr_input *in, gboolean is_eof)
+{
+	int ret;
+	char *rdptr, *endptr, *trimptr;
+	size_t rdlen;
+
+	send_feed_header(in);
 
 	/*
 	 * Workaround broken generators which output incomplete text
@@ -1933,7 +2027,7 @@ static int process_buffer(struct sr_input *in, gboolean is_eof)
 			rdptr = endptr;
 			continue;
 		}
-		ret = parse_textline(in, rdptr);
+		ret = parse_textline(in, &inc->parse, rdptr);
 		rdptr = endptr;
 		if (ret != SR_OK)
 			break;
@@ -1990,6 +2084,9 @@ static int init(struct sr_input *in, GHashTable *options)
 	inc->options.compress = g_variant_get_uint64(data);
 	inc->options.compress /= inc->options.downsample;
 
+	data = g_hash_table_lookup(options, "threads");
+	inc->options.threads = g_variant_get_uint32(data);
+
 	data = g_hash_table_lookup(options, "skip");
 	if (data) {
 		inc->options.skip_specified = TRUE;
@@ -2039,6 +2136,399 @@ static int receive(struct sr_input *in, GString *buf)
 	return ret;
 }
 
+/*
+ * Parse the text lines of a read-only buffer. Only the current line
+ * gets copied, the parser modifies the text. The buffer ends on a line
+ * boundary, so a last line without a line feed is complete, too.
+ */
+static int parse_textlines(const struct sr_input *in, struct vcd_parse *ps,
+	GString *line, const char *data, size_t len)
+{
+	const char *eol, *start, *stop;
+	size_t count;
+	int ret;
+
+	while (len) {
+		eol = memchr(data, '\n', len);
+		count = eol ? (size_t)(eol - data) : len;
+		start = data;
+		stop = data + count;
+		if (eol)
+			count++;
+		data += count;
+		len -= count;
+		while (start < stop && g_ascii_isspace(*start))
+			start++;
+		while (stop > start && g_ascii_isspace(stop[-1]))
+			stop--;
+		if (start == stop)
+			continue;
+		g_string_truncate(line, 0);
+		g_string_append_len(line, start, stop - start);
+		if ((ret = parse_textline(in, ps, line->str)) != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+static void parse_job_run(void *data, void *user_data)
+{
+	struct vcd_job *job;
+	const struct sr_input *in;
+
+	job = data;
+	in = user_data;
+
+	job->ret = parse_textlines(in, &job->parse, job->line,
+		job->data, job->len);
+
+	g_mutex_lock(&job->mutex);
+	job->done = TRUE;
+	g_cond_signal(&job->cond);
+	g_mutex_unlock(&job->mutex);
+}
+
+static void parse_job_free(struct vcd_job *job)
+{
+	g_mutex_lock(&job->mutex);
+	while (!job->done)
+		g_cond_wait(&job->cond, &job->mutex);
+	g_mutex_unlock(&job->mutex);
+
+	g_mutex_clear(&job->mutex);
+	g_cond_clear(&job->cond);
+	g_free(job->parse.bits);
+	g_byte_array_free(job->parse.changes, TRUE);
+	g_string_free(job->line, TRUE);
+	g_free(job);
+}
+
+/* Apply the changes which a worker has recorded, in input data order. */
+static int parse_job_apply(const struct sr_input *in, struct vcd_job *job)
+{
+	struct context *inc;
+	const guint8 *rdptr, *endptr;
+	struct vcd_change change;
+	int ret;
+
+	inc = in->priv;
+
+	rdptr = job->parse.changes->data;
+	endptr = rdptr + job->parse.changes->len;
+	while (rdptr < endptr) {
+		memcpy(&change, rdptr, sizeof(change));
+		rdptr += sizeof(change);
+		switch (change.type) {
+		case VCD_CHANGE_TIME:
+			ret = process_timestamp(in, change.u.timestamp);
+			if (ret != SR_OK)
+				return ret;
+			break;
+		case VCD_CHANGE_BITS:
+			process_bits(inc, change.vcd_ch,
+				(uint8_t *)rdptr, change.u.bit_count);
+			rdptr += (change.u.bit_count + 7) / 8;
+			inc->data_after_timestamp = TRUE;
+			break;
+		case VCD_CHANGE_REAL:
+			process_real(inc, change.vcd_ch, change.u.real_val);
+			inc->data_after_timestamp = TRUE;
+			break;
+		}
+	}
+
+	/* Section state at the chunk's end carries over. */
+	inc->parse.skip_until_end = job->parse.skip_until_end;
+	inc->parse.ignore_end_keyword = job->parse.ignore_end_keyword;
+
+	return SR_OK;
+}
+
+/*
+ * Split off the next chunk of mapped input for a worker. Chunks end
+ * before a text line which starts with a timestamp, so that workers
+ * can start from a known state. A chunk which starts in the middle
+ * of a $dumpvars section cannot happen then, as long as such sections
+ * do not hold timestamps. Only the first chunk gets the parser's
+ * current section state.
+ */
+static struct vcd_job *parse_job_new(const struct sr_input *in,
+	const char *data, size_t len, gboolean first)
+{
+	struct context *inc;
+	struct vcd_job *job;
+	const char *p, *end;
+
+	inc = in->priv;
+
+	job = g_malloc0(sizeof(*job));
+	job->data = data;
+	job->len = len;
+	end = data + len;
+	if (len > PARSE_CHUNK_SIZE) {
+		p = data + PARSE_CHUNK_SIZE;
+		while ((p = memchr(p, '\n', end - p))) {
+			p++;
+			if (p < end && *p == '#') {
+				job->len = p - data;
+				break;
+			}
+		}
+	}
+	if (first) {
+		job->parse.skip_until_end = inc->parse.skip_until_end;
+		job->parse.ignore_end_keyword = inc->parse.ignore_end_keyword;
+	}
+	job->parse.bits = g_malloc0(inc->conv_bits.unit_size);
+	job->parse.changes = g_byte_array_sized_new(job->len / 2);
+	job->line = g_string_sized_new(256);
+	g_mutex_init(&job->mutex);
+	g_cond_init(&job->cond);
+
+	return job;
+}
+
+/*
+ * Have workers parse chunks of mapped input in parallel, and apply
+ * their results in input data order. Keep a few more chunks in flight
+ * than there are workers, which bounds memory consumption.
+ */
+static int parse_parallel(struct sr_input *in, const char *data, size_t len)
+{
+	struct context *inc;
+	struct vcd_job *job;
+	size_t max_jobs;
+	gboolean first;
+	int ret;
+
+	inc = in->priv;
+
+	if (!inc->pool) {
+		inc->pool = g_thread_pool_new(parse_job_run, in,
+			inc->options.threads, FALSE, NULL);
+		g_queue_init(&inc->jobs);
+	}
+	max_jobs = 2 * inc->options.threads;
+
+	ret = SR_OK;
+	first = TRUE;
+	while (len || !g_queue_is_empty(&inc->jobs)) {
+		while (len && g_queue_get_length(&inc->jobs) < max_jobs) {
+			job = parse_job_new(in, data, len, first);
+			first = FALSE;
+			data += job->len;
+			len -= job->len;
+			g_queue_push_tail(&inc->jobs, job);
+			g_thread_pool_push(inc->pool, job, NULL);
+		}
+		job = g_queue_pop_head(&inc->jobs);
+		g_mutex_lock(&job->mutex);
+		while (!job->done)
+			g_cond_wait(&job->cond, &job->mutex);
+		g_mutex_unlock(&job->mutex);
+		ret = job->ret;
+		if (ret == SR_OK)
+			ret = parse_job_apply(in, job);
+		parse_job_free(job);
+		if (ret != SR_OK)
+			break;
+	}
+
+	/* Wait for and discard the remaining chunks after errors. */
+	while ((job = g_queue_pop_head(&inc->jobs)))
+		parse_job_free(job);
+
+	return ret;
+}
+
+static int receive_mapped(struct sr_input *in, const char *data, size_t len)
+{
+	struct context *inc;
+	const char *eol;
+	size_t count;
+	int ret;
+
+	inc = in->priv;
+
+	/* Complete and process the text which receive() has buffered. */
+	if (in->buf->len) {
+		eol = memchr(data, '\n', len);
+		count = eol ? (size_t)(eol - data) + 1 : len;
+		g_string_append_len(in->buf, data, count);
+		data += count;
+		len -= count;
+		if ((ret = process_buffer(in, FALSE)) != SR_OK)
+			return ret;
+	}
+	send_feed_header(in);
+
+	if (inc->options.threads && len > PARSE_CHUNK_SIZE)
+		return parse_parallel(in, data, len);
+
+	if (!inc->line)
+		inc->line = g_string_sized_new(256);
+
+	return parse_textlines(in, &inc->parse, inc->line, data, len);
+}
+
+static void index_entry_clear(void *data)
+{
+	struct vcd_index_entry *entry;
+
+	entry = data;
+	g_free(entry->logic);
+	g_free(entry->floats);
+}
+
+static void index_free(struct context *inc)
+{
+	if (inc->index.entries)
+		g_array_free(inc->index.entries, TRUE);
+	memset(&inc->index, 0, sizeof(inc->index));
+}
+
+/*
+ * Lookup (and keep) where the data section of mapped input starts. The
+ * index is assumed to be valid for input of the same size. Users must
+ * not switch files for an input instance without creating it again.
+ */
+static int index_prep(struct context *inc, const char *data, size_t len)
+{
+	const char *pos;
+
+	if (inc->index.entries && inc->index.data_len == len)
+		return SR_OK;
+	index_free(inc);
+
+	pos = g_strstr_len(data, len, "$enddefinitions");
+	if (pos) {
+		pos += strlen("$enddefinitions");
+		pos = g_strstr_len(pos, len - (pos - data), "$end");
+	}
+	if (!pos) {
+		sr_err("Cannot find the end of the header.");
+		return SR_ERR_DATA;
+	}
+
+	inc->index.data_len = len;
+	inc->index.data_offset = pos + strlen("$end") - data;
+	inc->index.entries = g_array_new(FALSE, FALSE,
+		sizeof(struct vcd_index_entry));
+	g_array_set_clear_func(inc->index.entries, index_entry_clear);
+
+	return SR_OK;
+}
+
+/* Record the parser state before the timestamp line at the offset. */
+static void index_add(struct context *inc, size_t offset)
+{
+	struct vcd_index_entry entry;
+
+	entry.offset = offset;
+	entry.pos = inc->range.pos;
+	entry.prev_timestamp = inc->prev_timestamp;
+	entry.skip_starttime = inc->options.skip_starttime;
+	entry.use_skip = inc->use_skip;
+	entry.data_after_timestamp = inc->data_after_timestamp;
+	entry.logic = g_memdup(inc->current_logic, inc->unit_size);
+	entry.floats = g_memdup(inc->current_floats,
+		sizeof(inc->current_floats[0]) * inc->analog_count);
+	g_array_append_val(inc->index.entries, entry);
+}
+
+/*
+ * Restore the parser state of the last index entry before the sample
+ * position. Returns the offset where to resume parsing.
+ */
+static size_t index_seek(struct context *inc, uint64_t sample)
+{
+	struct vcd_index_entry *entry;
+	size_t lo, hi, mid;
+
+	inc->range.pos = 0;
+	lo = 0;
+	hi = inc->index.entries->len;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		entry = &g_array_index(inc->index.entries,
+			struct vcd_index_entry, mid);
+		if (entry->pos <= sample)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (!lo)
+		return inc->index.data_offset;
+
+	entry = &g_array_index(inc->index.entries, struct vcd_index_entry, lo - 1);
+	inc->range.pos = entry->pos;
+	inc->prev_timestamp = entry->prev_timestamp;
+	inc->options.skip_starttime = entry->skip_starttime;
+	inc->use_skip = entry->use_skip;
+	inc->data_after_timestamp = entry->data_after_timestamp;
+	memcpy(inc->current_logic, entry->logic, inc->unit_size);
+	memcpy(inc->current_floats, entry->floats,
+		sizeof(inc->current_floats[0]) * inc->analog_count);
+
+	return entry->offset;
+}
+
+/*
+ * Parse from the nearest index entry before the range, without sending
+ * samples before the range start. Extend the index while parsing input
+ * which it does not cover yet. Stop at the end of the range.
+ */
+static int receive_range(struct sr_input *in, const char *data, size_t len,
+	uint64_t start, uint64_t count)
+{
+	struct context *inc;
+	struct vcd_index_entry *last;
+	const char *eol, *line;
+	size_t offset, next_index, line_len;
+	int ret;
+
+	inc = in->priv;
+	g_string_truncate(in->buf, 0);
+
+	if ((ret = index_prep(inc, data, len)) != SR_OK)
+		return ret;
+	offset = index_seek(inc, start);
+	next_index = inc->index.data_offset;
+	if (inc->index.entries->len) {
+		last = &g_array_index(inc->index.entries,
+			struct vcd_index_entry, inc->index.entries->len - 1);
+		next_index = last->offset + INDEX_STEP;
+	}
+
+	inc->range.active = TRUE;
+	inc->range.start = start;
+	inc->range.end = start + MIN(count, UINT64_MAX - start);
+	inc->parse.skip_until_end = FALSE;
+	inc->parse.ignore_end_keyword = FALSE;
+	send_feed_header(in);
+
+	if (!inc->line)
+		inc->line = g_string_sized_new(256);
+	ret = SR_OK;
+	while (offset < len && inc->range.pos < inc->range.end) {
+		line = data + offset;
+		eol = memchr(line, '\n', len - offset);
+		line_len = eol ? (size_t)(eol - line) + 1 : len - offset;
+		if (*line == '#' && offset >= next_index &&
+				!inc->parse.skip_until_end) {
+			index_add(inc, offset);
+			next_index = offset + INDEX_STEP;
+		}
+		offset += line_len;
+		ret = parse_textlines(in, &inc->parse, inc->line, line, line_len);
+		if (ret != SR_OK)
+			break;
+	}
+
+	return ret;
+}
+
 static int end(struct sr_input *in)
 {
 	struct context *inc;
@@ -2075,21 +2565,31 @@ static void cleanup(struct sr_input *in)
 
 	keep_header_for_reread(in);
 
+	if (inc->pool)
+		g_thread_pool_free(inc->pool, FALSE, TRUE);
+	inc->pool = NULL;
+	if (inc->signals)
+		g_hash_table_destroy(inc->signals);
+	inc->signals = NULL;
 	g_slist_free_full(inc->channels, free_channel);
 	inc->channels = NULL;
 	feed_queue_logic_free(inc->feed_logic);
 	inc->feed_logic = NULL;
-	g_free(inc->conv_bits.value);
-	inc->conv_bits.value = NULL;
+	g_free(inc->parse.bits);
+	inc->parse.bits = NULL;
 	g_free(inc->current_logic);
 	inc->current_logic = NULL;
 	g_free(inc->current_floats);
 	inc->current_floats = NULL;
 	g_string_free(inc->scope_prefix, TRUE);
 	inc->scope_prefix = NULL;
-	g_slist_free_full(inc->ignored_signals, g_free);
+	if (inc->line)
+		g_string_free(inc->line, TRUE);
+	inc->line = NULL;
+	if (inc->ignored_signals)
+		g_hash_table_destroy(inc->ignored_signals);
 	inc->ignored_signals = NULL;
-	free_text_split(inc, NULL);
+	index_free(inc);
 }
 
 static int reset(struct sr_input *in)
@@ -2097,10 +2597,13 @@ static int reset(struct sr_input *in)
 	struct context *inc;
 	struct vcd_user_opt save;
 	struct vcd_prev prev;
+	struct vcd_index index;
 
 	inc = in->priv;
 
-	/* Relase previously allocated resources. */
+	/* Relase previously allocated resources. Keep the seek index. */
+	index = inc->index;
+	memset(&inc->index, 0, sizeof(inc->index));
 	cleanup(in);
 	g_string_truncate(in->buf, 0);
 
@@ -2110,6 +2613,7 @@ static int reset(struct sr_input *in)
 	memset(inc, 0, sizeof(*inc));
 	inc->options = save;
 	inc->prev = prev;
+	inc->index = index;
 	inc->scope_prefix = g_string_new("\0");
 
 	return SR_OK;
@@ -2120,6 +2624,7 @@ enum vcd_option_t {
 	OPT_DOWN_SAMPLE,
 	OPT_SKIP_COUNT,
 	OPT_COMPRESS,
+	OPT_THREADS,
 	OPT_MAX,
 };
 
@@ -2147,6 +2652,11 @@ static struct sr_option options[] = {
 		"Compress idle periods which are longer than the specified number of timescale ticks.",
 		NULL, NULL,
 	},
+	[OPT_THREADS] = {
+		"threads", "Parser threads",
+		"Number of threads which parse value changes of memory mapped input files (0 = parse in the caller's thread).",
+		NULL, NULL,
+	},
 	[OPT_MAX] = ALL_ZERO,
 };
 
@@ -2157,6 +2667,7 @@ static const struct sr_option *get_options(void)
 		options[OPT_DOWN_SAMPLE].def = g_variant_ref_sink(g_variant_new_uint64(1));
 		options[OPT_SKIP_COUNT].def = g_variant_ref_sink(g_variant_new_uint64(~UINT64_C(0)));
 		options[OPT_COMPRESS].def = g_variant_ref_sink(g_variant_new_uint64(0));
+		options[OPT_THREADS].def = g_variant_ref_sink(g_variant_new_uint32(0));
 	}
 
 	return options;
@@ -2168,10 +2679,13 @@ SR_PRIV struct sr_input_module input_vcd = {
 	.desc = "Value Change Dump data",
 	.exts = (const char*[]){"vcd", NULL},
 	.metadata = { SR_INPUT_META_HEADER | SR_INPUT_META_REQUIRED },
+	.flags = SR_INPUT_MAPPED | SR_INPUT_TEXT,
 	.options = get_options,
 	.format_match = format_match,
 	.init = init,
 	.receive = receive,
+	.receive_mapped = receive_mapped,
+	.receive_range = receive_range,
 	.end = end,
 	.cleanup = cleanup,
 	.reset = reset,
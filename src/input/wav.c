@@ -164,23 +164,23 @@ static int init(struct sr_input *in, GHashTable *options)
 	return SR_OK;
 }
 
-static int find_data_chunk(GString *buf, int initial_offset)
+static int find_data_chunk(const char *data, size_t len, int initial_offset)
 {
 	unsigned int offset, i;
 
 	offset = initial_offset;
-	while (offset < MIN(MAX_DATA_CHUNK_OFFSET, buf->len)) {
-		if (!memcmp(buf->str + offset, "data", 4))
+	while (offset < MIN(MAX_DATA_CHUNK_OFFSET, len)) {
+		if (!memcmp(data + offset, "data", 4))
 			/* Skip into the samples. */
 			return offset + 8;
 		for (i = 0; i < 4; i++) {
-			if (!isalnum(buf->str[offset + i])
-					&& !isblank(buf->str[offset + i]))
+			if (!isalnum(data[offset + i])
+					&& !isblank(data[offset + i]))
 				/* Doesn't look like a chunk ID. */
 				return -1;
 		}
 		/* Skip past this chunk. */
-		offset += 8 + RL32(buf->str + offset + 4);
+		offset += 8 + RL32(data + offset + 4);
 	}
 
 	if (offset > MAX_DATA_CHUNK_OFFSET)
@@ -189,85 +189,97 @@ static int find_data_chunk(GString *buf, int initial_offset)
 	return offset;
 }
 
-static void send_chunk(const struct sr_input *in, int offset, int num_samples)
+static void send_chunk(const struct sr_input *in, const char *data, int num_samples)
 {
-	struct sr_datafeed_packet packet;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
 	struct context *inc;
-	float *fdata;
-	int total_samples, samplenum;
-	char *s, *d;
 
 	inc = in->priv;
 
-	total_samples = num_samples * inc->num_channels;
-	fdata = g_malloc0(total_samples * sizeof(float));
-	s = in->buf->str + offset;
-	d = (char *)fdata;
-
-	for (samplenum = 0; samplenum < total_samples; samplenum++) {
-		if (inc->fmt_code == WAVE_FORMAT_PCM_) {
-			switch (inc->unitsize) {
-			case 1:
-				/* 8-bit PCM samples are unsigned. */
-				fdata[samplenum] = *(uint8_t*)(s) / (float)255;
-				break;
-			case 2:
-				fdata[samplenum] = RL16S(s) / (float)INT16_MAX;
-				break;
-			case 4:
-				fdata[samplenum] = RL32S(s) / (float)INT32_MAX;
-				break;
-			}
-		} else {
-			/* BINARY32 float */
-#ifdef WORDS_BIGENDIAN
-			int i;
-			for (i = 0; i < inc->unitsize; i++)
-				d[i] = s[inc->unitsize - 1 - i];
-#else
-			memcpy(d, s, inc->unitsize);
-#endif
-		}
-		s += inc->unitsize;
-		d += inc->unitsize;
-	}
-
+	/*
+	 * Pass the samples in their file encoding. Receivers convert
+	 * them to float when (and only if) they need to.
+	 */
 	/* TODO: Use proper 'digits' value for this device (and its modes). */
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
-	packet.type = SR_DF_ANALOG;
-	packet.payload = &analog;
+	encoding.unitsize = inc->unitsize;
+	encoding.is_bigendian = FALSE;
+	if (inc->fmt_code == WAVE_FORMAT_PCM_) {
+		encoding.is_float = FALSE;
+		switch (inc->unitsize) {
+		case 1:
+			/* 8-bit PCM samples are unsigned. */
+			encoding.is_signed = FALSE;
+			sr_rational_set(&encoding.scale, 1, UINT8_MAX);
+			break;
+		case 2:
+			encoding.is_signed = TRUE;
+			sr_rational_set(&encoding.scale, 1, INT16_MAX);
+			break;
+		case 4:
+			encoding.is_signed = TRUE;
+			sr_rational_set(&encoding.scale, 1, INT32_MAX);
+			break;
+		}
+	} else {
+		/* BINARY32 float */
+		encoding.is_float = TRUE;
+		encoding.is_signed = TRUE;
+	}
 	analog.num_samples = num_samples;
-	analog.data = fdata;
+	analog.data = (void *)data;
 	analog.meaning->channels = in->sdi->channels;
 	analog.meaning->mq = 0;
 	analog.meaning->mqflags = 0;
 	analog.meaning->unit = 0;
-	sr_session_send(in->sdi, &packet);
-	g_free(fdata);
+	sr_analog_send_split(in->sdi, &analog);
 }
 
-static int process_buffer(struct sr_input *in)
+static void send_header(const struct sr_input *in)
 {
 	struct context *inc;
-	int offset, chunk_samples, total_samples, processed, max_chunk_samples;
-	int num_samples, i;
 
 	inc = in->priv;
 	if (!inc->started) {
 		std_session_send_df_header(in->sdi);
-		(void)sr_session_send_meta(in->sdi, SR_CONF_SAMPLERATE,
-			g_variant_new_uint64(inc->samplerate));
+		(void)sr_session_send_meta_uint64(in->sdi, SR_CONF_SAMPLERATE,
+			inc->samplerate);
 		inc->started = TRUE;
 	}
+}
+
+/* Send samples in chunks of at most CHUNK_SIZE bytes. */
+static void send_samples(const struct sr_input *in, const char *data,
+	uint64_t total_samples)
+{
+	struct context *inc;
+	uint64_t max_chunk_samples, num_samples;
+
+	inc = in->priv;
+	max_chunk_samples = CHUNK_SIZE / inc->samplesize;
+	while (total_samples) {
+		num_samples = MIN(total_samples, max_chunk_samples);
+		send_chunk(in, data, num_samples);
+		data += num_samples * inc->samplesize;
+		total_samples -= num_samples;
+	}
+}
+
+static int process_buffer(struct sr_input *in)
+{
+	struct context *inc;
+	int offset, chunk_samples, i;
+
+	inc = in->priv;
+	send_header(in);
 
 	if (!inc->found_data) {
 		/* Skip past size of 'fmt ' chunk. */
 		i = 20 + RL32(in->buf->str + 16);
-		offset = find_data_chunk(in->buf, i);
+		offset = find_data_chunk(in->buf->str, in->buf->len, i);
 		if (offset < 0) {
 			if (in->buf->len > MAX_DATA_CHUNK_OFFSET) {
 				sr_err("Couldn't find data chunk.");
@@ -280,19 +292,8 @@ static int process_buffer(struct sr_input *in)
 
 	/* Round off up to the last channels * unitsize boundary. */
 	chunk_samples = (in->buf->len - offset) / inc->samplesize;
-	max_chunk_samples = CHUNK_SIZE / inc->samplesize;
-	processed = 0;
-	total_samples = chunk_samples;
-	while (processed < total_samples) {
-		if (chunk_samples > max_chunk_samples)
-			num_samples = max_chunk_samples;
-		else
-			num_samples = chunk_samples;
-		send_chunk(in, offset, num_samples);
-		offset += num_samples * inc->samplesize;
-		chunk_samples -= num_samples;
-		processed += num_samples;
-	}
+	send_samples(in, in->buf->str + offset, chunk_samples);
+	offset += chunk_samples * inc->samplesize;
 
 	if ((unsigned int)offset < in->buf->len) {
 		/*
@@ -349,6 +350,34 @@ static int receive(struct sr_input *in, GString *buf)
 	return ret;
 }
 
+/* Samples are at fixed positions after the data chunk's header. */
+static int receive_range(struct sr_input *in, const char *data, size_t len,
+	uint64_t start, uint64_t count)
+{
+	struct context *inc;
+	uint64_t total;
+	int offset;
+
+	inc = in->priv;
+	g_string_truncate(in->buf, 0);
+
+	/* Skip past size of 'fmt ' chunk. */
+	offset = find_data_chunk(data, len, 20 + RL32(data + 16));
+	if (offset < 0 || (size_t)offset > len) {
+		sr_err("Couldn't find data chunk.");
+		return SR_ERR;
+	}
+	inc->found_data = TRUE;
+	send_header(in);
+
+	total = (len - offset) / inc->samplesize;
+	start = MIN(start, total);
+	count = MIN(count, total - start);
+	send_samples(in, data + offset + start * inc->samplesize, count);
+
+	return SR_OK;
+}
+
 static int end(struct sr_input *in)
 {
 	struct context *inc;
@@ -389,6 +418,7 @@ SR_PRIV struct sr_input_module input_wav = {
 	.format_match = format_match,
 	.init = init,
 	.receive = receive,
+	.receive_range = receive_range,
 	.end = end,
 	.reset = reset,
 };
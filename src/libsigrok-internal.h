@@ -36,6 +36,9 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#ifdef HAVE_TRACEPOINTS
+#include <sys/sdt.h>
+#endif
 
 struct zip;
 struct zip_stat;
@@ -447,6 +450,19 @@ static inline void write_u16le(uint8_t *p, uint16_t x)
 }
 #define WL16(p, x) write_u16le((uint8_t *)(p), (uint16_t)(x))
 
+/**
+ * Write a 24 bits unsigned integer to memory stored as little endian.
+ * @param p a pointer to the output memory
+ * @param x the input unsigned integer
+ */
+static inline void write_u24le(uint8_t *p, uint32_t x)
+{
+	p[0] = x & 0xff; x >>= 8;
+	p[1] = x & 0xff; x >>= 8;
+	p[2] = x & 0xff; x >>= 8;
+}
+#define WL24(p, x) write_u24le((uint8_t *)(p), (uint32_t)(x))
+
 /**
  * Write a 32 bits unsigned integer to memory stored as big endian.
  * @param p a pointer to the output memory
@@ -1066,16 +1082,41 @@ static inline void write_dblle_inc(uint8_t **p, double x)
 	SR_REGISTER_DEV_DRIVER_LIST(name##_list, &name);
 
 SR_API void sr_drivers_init(struct sr_context *context);
+SR_PRIV int sr_driver_sanity_check(const struct sr_dev_driver *driver);
 
 struct sr_context {
+	/* Built on first use, see sr_driver_list(). */
 	struct sr_dev_driver **driver_list;
+	/* Names of the drivers to use, NULL for all of them. */
+	gchar **driver_names;
 #ifdef HAVE_LIBUSB_1_0
 	libusb_context *libusb_ctx;
+	/* Optional libusb event handling thread, see usb_source_add_deferred(). */
+	struct usb_event_thread *usb_event_thread;
+	/* Properties of connected devices, see usb_get_device_list(). */
+	struct usb_dev_cache *usb_cache;
+	/* Recent firmware uploads, see ezusb_upload_firmware(). */
+	GHashTable *ezusb_uploads;
 #endif
 	sr_resource_open_callback resource_open_cb;
 	sr_resource_close_callback resource_close_cb;
 	sr_resource_read_callback resource_read_cb;
 	void *resource_cb_data;
+	/* Loaded resources, see sr_resource_load_cached(). */
+	GHashTable *resource_cache;
+	/* Parsed session file metadata, see sr_session_file_meta_get(). */
+	GHashTable *sessionfile_cache;
+	/* Memory budget of buffering modules, see sr_mem_reserve(). */
+	GMutex mem_mutex;
+	uint64_t mem_budget;
+	uint64_t mem_used;
+	/* Placement of threads by role, see sr_thread_policy_apply(). */
+	struct sr_thread_policy {
+		GArray *cpus;
+		enum sr_thread_sched sched;
+		int priority;
+	} thread_policy[2];
+	gboolean thread_numa_local;
 };
 
 /** Input module metadata keys. */
@@ -1100,6 +1141,9 @@ struct sr_input {
 	GString *buf;
 	struct sr_dev_inst *sdi;
 	gboolean sdi_ready;
+	/** The mapped file of sr_input_send_file(), and the position in it. */
+	GMappedFile *map;
+	size_t map_pos;
 	void *priv;
 };
 
@@ -1147,6 +1191,13 @@ struct sr_input_module {
 	 */
 	const uint8_t metadata[8];
 
+	/**
+	 * Bitfield containing flags that describe certain properties
+	 * this input module may or may not have.
+	 * @see sr_input_flag
+	 */
+	const uint64_t flags;
+
 	/**
 	 * Returns a NULL-terminated list of options this module can take.
 	 * Can be NULL, if the module has no options.
@@ -1174,6 +1225,8 @@ struct sr_input_module {
 	 * and the application can pick the best match, or try fallbacks
 	 * in case of errors. This approach also copes with formats that
 	 * are unreliable to detect in the absence of magic signatures.
+	 * A confidence of 1 is a definite match (typically on magic
+	 * signatures), format detection need not try other modules then.
 	 */
 	int (*format_match) (GHashTable *metadata, unsigned int *confidence);
 
@@ -1202,6 +1255,37 @@ struct sr_input_module {
 	 */
 	int (*receive) (struct sr_input *in, GString *buf);
 
+	/**
+	 * Send the complete rest of the input to the specified input
+	 * instance, as one contiguous read-only buffer.
+	 *
+	 * Only used for modules with the SR_INPUT_MAPPED flag, after
+	 * receive() has made the device instance ready. Data which
+	 * receive() buffered in in->buf precedes the given data. The
+	 * buffer stays valid until the call returns.
+	 *
+	 * @retval SR_OK Success
+	 * @retval other Negative error code.
+	 */
+	int (*receive_mapped) (struct sr_input *in, const char *data, size_t len);
+
+	/**
+	 * Send a range of samples from the complete input, which is
+	 * given as one contiguous read-only buffer.
+	 *
+	 * Optional. Called after receive() has made the device instance
+	 * ready. Sends the feed header (once), then the samples from
+	 * @a start up to @a start + @a count, limited to the end of the
+	 * input. Data which receive() buffered in in->buf is dropped.
+	 * Modules may keep an index of sample positions in the buffer
+	 * across calls and resets, to speed up subsequent seeks.
+	 *
+	 * @retval SR_OK Success
+	 * @retval other Negative error code.
+	 */
+	int (*receive_range) (struct sr_input *in, const char *data, size_t len,
+		uint64_t start, uint64_t count);
+
 	/**
 	 * Signal the input module no more data will come.
 	 *
@@ -1259,6 +1343,9 @@ struct sr_output {
 	 * there, and only flush it when it reaches a certain size.
 	 */
 	void *priv;
+
+	/** Worker thread state, see sr_output_new_async(). */
+	struct output_worker *worker;
 };
 
 /** Output module driver. */
@@ -1341,6 +1428,24 @@ struct sr_output_module {
 	int (*receive) (const struct sr_output *o,
 			const struct sr_datafeed_packet *packet, GString **out);
 
+	/**
+	 * Alternative to receive(), which appends the output to a sink.
+	 * Modules get the sink's reusable text buffer with
+	 * sr_output_sink_string(), or pass larger blocks of data with
+	 * sr_output_sink_append(). Modules which only implement this
+	 * function still work with sr_output_send().
+	 *
+	 * @param o Pointer to the respective 'struct sr_output'.
+	 * @param packet The complete packet.
+	 * @param sink The sink which receives the output.
+	 *
+	 * @retval SR_OK Success
+	 * @retval other Negative error code.
+	 */
+	int (*receive_sink) (const struct sr_output *o,
+			const struct sr_datafeed_packet *packet,
+			struct sr_output_sink *sink);
+
 	/**
 	 * This function is called after the caller is finished using
 	 * the output module, and can be used to free any internal
@@ -1368,6 +1473,32 @@ struct sr_transform {
 	 * state between calls into its callback functions.
 	 */
 	void *priv;
+
+	/** Timing statistics, maintained by the session. */
+	struct sr_session_stage_stats stats;
+
+	/** Output buffer which is reused across packets. */
+	void *out_buf;
+	size_t out_size;
+	/** Output packet, see sr_transform_packet_cow(). */
+	struct sr_datafeed_packet out_packet;
+	struct sr_datafeed_logic out_logic;
+	struct sr_datafeed_logic_rle out_rle;
+	struct sr_datafeed_logic_planar out_planar;
+	struct sr_datafeed_analog out_analog;
+	struct sr_analog_encoding out_encoding;
+	struct sr_analog_meaning out_meaning;
+	struct sr_analog_spec out_spec;
+};
+
+/** Flags of transform modules, sr_transform_module.flags. */
+enum sr_transform_flags {
+	/**
+	 * receive() only modifies the sample data and the encoding of the
+	 * packet it is passed, and returns that same packet. The session
+	 * then passes a private copy of the packet if it is shared.
+	 */
+	SR_TRANSFORM_INPLACE = 1 << 0,
 };
 
 struct sr_transform_module {
@@ -1391,6 +1522,9 @@ struct sr_transform_module {
 	 */
 	const char *desc;
 
+	/** Bitwise OR of enum sr_transform_flags values. */
+	uint32_t flags;
+
 	/**
 	 * Returns a NULL-terminated list of options this transform module
 	 * can take. Can be NULL, if the transform module has no options.
@@ -1428,6 +1562,13 @@ struct sr_transform_module {
 			struct sr_datafeed_packet *packet_in,
 			struct sr_datafeed_packet **packet_out);
 
+	/**
+	 * Returns the logic channels of the output, in the order of their
+	 * bits in the samples, see sr_transform_channels_get(). Can be
+	 * NULL, if the module keeps the layout of the logic data.
+	 */
+	GSList *(*channels) (const struct sr_transform *t);
+
 	/**
 	 * This function is called after the caller is finished using
 	 * the transform module, and can be used to free any internal
@@ -1470,7 +1611,10 @@ struct sr_serial_dev_inst {
 		int parity_bits;
 		int stop_bits;
 	} comm_params;
-	GString *rcv_buffer;
+	struct ser_rx_ring *rcv_buffer;
+	/** Data which serial_readline() received past the line it returned. */
+	uint8_t *line_buf;
+	size_t line_len;
 	serial_rx_chunk_callback rx_chunk_cb_func;
 	void *rx_chunk_cb_data;
 #ifdef HAVE_LIBSERIALPORT
@@ -1492,6 +1636,15 @@ struct sr_serial_dev_inst {
 	const char *hid_path;
 	hid_device *hid_dev;
 	GSList *hid_source_args;
+	/** Background reception into rcv_buffer, see ser_hid_open(). */
+	GThread *hid_rx_thread;
+	gint hid_rx_running;
+	gint hid_rx_error;
+	/** Keeps chip requests (flush, drain) from the RX thread's reads. */
+	GMutex hid_io_mutex;
+	/** Wakes up readers which wait for RX data. */
+	GMutex hid_rx_mutex;
+	GCond hid_rx_cond;
 #endif
 #ifdef HAVE_BLUETOOTH
 	enum ser_bt_conn_t {
@@ -1536,16 +1689,66 @@ struct drv_context {
  */
 SR_PRIV int sr_log(int loglevel, const char *format, ...)
 		__attribute__((__format__ (__gnu_printf__, 2, 3)));
+SR_PRIV int sr_log_module(int loglevel, const char *module,
+		const char *format, ...)
+		__attribute__((__format__ (__gnu_printf__, 3, 4)));
 #else
 SR_PRIV int sr_log(int loglevel, const char *format, ...) G_GNUC_PRINTF(2, 3);
+SR_PRIV int sr_log_module(int loglevel, const char *module,
+		const char *format, ...) G_GNUC_PRINTF(3, 4);
 #endif
 
 /* Message logging helpers with subsystem-specific prefix string. */
-#define sr_spew(...)	sr_log(SR_LOG_SPEW, LOG_PREFIX ": " __VA_ARGS__)
-#define sr_dbg(...)	sr_log(SR_LOG_DBG,  LOG_PREFIX ": " __VA_ARGS__)
-#define sr_info(...)	sr_log(SR_LOG_INFO, LOG_PREFIX ": " __VA_ARGS__)
-#define sr_warn(...)	sr_log(SR_LOG_WARN, LOG_PREFIX ": " __VA_ARGS__)
-#define sr_err(...)	sr_log(SR_LOG_ERR,  LOG_PREFIX ": " __VA_ARGS__)
+#define sr_spew(...)	sr_log_module(SR_LOG_SPEW, LOG_PREFIX, LOG_PREFIX ": " __VA_ARGS__)
+#define sr_dbg(...)	sr_log_module(SR_LOG_DBG,  LOG_PREFIX, LOG_PREFIX ": " __VA_ARGS__)
+#define sr_info(...)	sr_log_module(SR_LOG_INFO, LOG_PREFIX, LOG_PREFIX ": " __VA_ARGS__)
+#define sr_warn(...)	sr_log_module(SR_LOG_WARN, LOG_PREFIX, LOG_PREFIX ": " __VA_ARGS__)
+#define sr_err(...)	sr_log_module(SR_LOG_ERR,  LOG_PREFIX, LOG_PREFIX ": " __VA_ARGS__)
+
+/* Default of sr_log_ratelimit_set(), messages per second and call site. */
+#define SR_LOG_RATELIMIT_DEFAULT	10
+
+/* State of a rate limited call site, see sr_log_ratelimit_check(). */
+struct sr_log_ratelimit {
+	gint64 window_start;
+	int count;
+	int suppressed;
+};
+
+SR_PRIV gboolean sr_log_ratelimit_check(struct sr_log_ratelimit *state,
+		int loglevel, const char *module);
+
+/*
+ * Message logging helpers for messages which can occur at high rates,
+ * like those of every USB transfer. Each call site logs at most the
+ * number of messages per second which sr_log_ratelimit_set() allows.
+ */
+#define sr_log_ratelimited(level, ...) do { \
+	static struct sr_log_ratelimit sr_log_rl_state__; \
+	if (sr_log_ratelimit_check(&sr_log_rl_state__, level, LOG_PREFIX)) \
+		sr_log_module(level, LOG_PREFIX, LOG_PREFIX ": " __VA_ARGS__); \
+} while (0)
+#define sr_spew_ratelimited(...)	sr_log_ratelimited(SR_LOG_SPEW, __VA_ARGS__)
+#define sr_dbg_ratelimited(...)	sr_log_ratelimited(SR_LOG_DBG, __VA_ARGS__)
+#define sr_warn_ratelimited(...)	sr_log_ratelimited(SR_LOG_WARN, __VA_ARGS__)
+
+/*
+ * Static tracepoints (USDT) of the "libsigrok" provider, which tools
+ * like bpftrace or perf can attach to, e.g. "usdt:libsigrok:send_entry".
+ * They are compiled in with --enable-tracepoints, and expand to nothing
+ * otherwise, their arguments don't get evaluated then.
+ */
+#ifdef HAVE_TRACEPOINTS
+#define sr_trace1(name, a)		DTRACE_PROBE1(libsigrok, name, a)
+#define sr_trace2(name, a, b)		DTRACE_PROBE2(libsigrok, name, a, b)
+#define sr_trace3(name, a, b, c)	DTRACE_PROBE3(libsigrok, name, a, b, c)
+#define sr_trace4(name, a, b, c, d)	DTRACE_PROBE4(libsigrok, name, a, b, c, d)
+#else
+#define sr_trace1(name, a)		do { } while (0)
+#define sr_trace2(name, a, b)		do { } while (0)
+#define sr_trace3(name, a, b, c)	do { } while (0)
+#define sr_trace4(name, a, b, c, d)	do { } while (0)
+#endif
 
 /*--- device.c --------------------------------------------------------------*/
 
@@ -1573,6 +1776,27 @@ SR_PRIV struct sr_channel *sr_next_enabled_channel(const struct sr_dev_inst *sdi
 SR_PRIV gboolean sr_channels_differ(struct sr_channel *ch1, struct sr_channel *ch2);
 SR_PRIV gboolean sr_channel_lists_differ(GSList *l1, GSList *l2);
 
+/** Subsets of a device's channels, see sr_dev_channel_array(). */
+enum sr_channel_set {
+	SR_CHANNELS_ALL,
+	SR_CHANNELS_LOGIC,
+	SR_CHANNELS_ANALOG,
+	SR_CHANNELS_ENABLED,
+	SR_CHANNELS_ENABLED_LOGIC,
+	SR_CHANNELS_ENABLED_ANALOG,
+	SR_CHANNEL_SETS,
+};
+
+struct sr_dev_channel_cache;
+struct sr_dev_meta_cache;
+struct sr_dev_config_state;
+struct sr_dev_packet_clock;
+
+SR_PRIV struct sr_channel *const *sr_dev_channel_array(
+		const struct sr_dev_inst *sdi, enum sr_channel_set set,
+		size_t *count);
+SR_PRIV void sr_dev_channels_changed(struct sr_dev_inst *sdi);
+
 /** Device instance data */
 struct sr_dev_inst {
 	/** Device driver. */
@@ -1601,6 +1825,17 @@ struct sr_dev_inst {
 	void *priv;
 	/** Session to which this device is currently assigned. */
 	struct sr_session *session;
+	/** Arrays of the channels, see sr_dev_channel_array(). */
+	struct sr_dev_channel_cache *channel_cache;
+	/** Meta values sent last, see sr_session_send_meta_uint64(). */
+	struct sr_dev_meta_cache *meta_cache;
+	/** Timing of the data packets, see sr_session_receive_time_set(). */
+	struct sr_dev_packet_clock *packet_clock;
+	/** Last known configuration values, see sr_config_publish(). */
+	struct sr_dev_config_state *config_state;
+	/** Whether nothing changed since the last acquisition started,
+	 *  see sr_dev_acquisition_rearm(). */
+	gboolean armed;
 };
 
 /* Generic device instances */
@@ -1656,7 +1891,13 @@ SR_PRIV void sr_hw_cleanup_all(const struct sr_context *ctx);
 SR_PRIV struct sr_config *sr_config_new(uint32_t key, GVariant *data);
 SR_PRIV void sr_config_free(struct sr_config *src);
 SR_PRIV int sr_dev_acquisition_start(struct sr_dev_inst *sdi);
+SR_PRIV int sr_dev_acquisition_rearm(struct sr_dev_inst *sdi);
+SR_PRIV void sr_dev_rearm_invalidate(const struct sr_dev_inst *sdi);
 SR_PRIV int sr_dev_acquisition_stop(struct sr_dev_inst *sdi);
+SR_PRIV void sr_config_publish(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, uint32_t key, GVariant *data);
+SR_PRIV void sr_config_lists_invalidate(const struct sr_dev_inst *sdi);
+SR_PRIV void sr_config_state_free(struct sr_dev_inst *sdi);
 
 /*--- session.c -------------------------------------------------------------*/
 
@@ -1669,6 +1910,36 @@ struct sr_session {
 	GSList *owned_devs;
 	/** List of struct datafeed_callback pointers. */
 	GSList *datafeed_callbacks;
+	/** Per-callback queue depth for threaded dispatch, 0 if disabled. */
+	size_t df_queue_depth;
+	/** Overflow policy for threaded dispatch (enum sr_datafeed_overflow). */
+	int df_overflow;
+	/** Whether a queue overflow has failed the current session run. */
+	gboolean df_failed;
+	/** Coalesce analog packets up to this many samples, if > 1. */
+	uint32_t coalesce_max_samples;
+	/** Latency deadline for coalesced samples, 0 for none. */
+	int64_t coalesce_latency_us;
+	/** Coalescing buffers, keyed by struct sr_channel pointer. */
+	GHashTable *coalesce_bufs;
+	/** Timer source which enforces the coalescing deadline. */
+	GSource *coalesce_timer;
+	/** Maximum time to hold back packets for merging, 0 if disabled. */
+	int64_t align_latency_us;
+	/** Held back packets (struct align_item), sorted by aligned time. */
+	GQueue align_queue;
+	/** Timer source which enforces the merging deadline. */
+	GSource *align_timer;
+	/** Whether packets and stages get accounted (atomic). */
+	gint stats_enabled;
+	/** Mutex protecting the statistics below, and those of the stages. */
+	GMutex stats_mutex;
+	/** Datafeed statistics of the whole session. */
+	struct sr_session_stats stats;
+	/** Per-device statistics, keyed by struct sr_dev_inst pointer. */
+	GHashTable *dev_stats;
+	/** Backpressure reported by consumers, in percent (atomic). */
+	gint backpressure;
 	GSList *transforms;
 	struct sr_trigger *trigger;
 
@@ -1677,13 +1948,28 @@ struct sr_session {
 	/** User data to be passed to the session stop callback. */
 	void *stopped_cb_data;
 
-	/** Mutex protecting the main context pointer. */
+	/** Mutex protecting the main context pointer, the workers, the
+	 *  event sources and the fd multiplexer. */
 	GMutex main_mutex;
 	/** Context of the session main loop. */
 	GMainContext *main_context;
+	/** Whether each device runs its event sources in a thread of its own. */
+	gboolean dev_threads;
+	/** List of struct dev_worker pointers, while the session runs. */
+	GSList *dev_workers;
+	/** Serializes sr_session_send() calls from device threads. */
+	GRecMutex send_mutex;
 
 	/** Registered event sources for this session. */
 	GHashTable *event_sources;
+	/** Whether fd sources share one epoll instance ($SIGROK_SESSION_EPOLL). */
+	gboolean fd_mux_wanted;
+	/** Multiplexer of the fd sources' descriptors, if any. */
+	struct fd_mux *fd_mux;
+	/** List of struct poll_source pointers, see sr_session_poll_add(). */
+	GSList *polls;
+	/** Time at which the first poll of the main loop runs out of slack. */
+	int64_t poll_wake_us;
 	/** Session main loop. */
 	GMainLoop *main_loop;
 	/** ID of idle source for dispatching the session stop notification. */
@@ -1715,11 +2001,40 @@ SR_PRIV int sr_session_source_remove_pollfd(struct sr_session *session,
 		GPollFD *pollfd);
 SR_PRIV int sr_session_source_remove_channel(struct sr_session *session,
 		GIOChannel *channel);
+SR_PRIV int sr_session_poll_add(const struct sr_dev_inst *sdi,
+		int interval_ms, int slack_ms, sr_receive_data_callback cb,
+		void *cb_data);
+SR_PRIV int sr_session_poll_remove(const struct sr_dev_inst *sdi);
 
 SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 		uint32_t key, GVariant *var);
+SR_PRIV int sr_session_send_meta_boolean(const struct sr_dev_inst *sdi,
+		uint32_t key, gboolean value);
+SR_PRIV int sr_session_send_meta_uint64(const struct sr_dev_inst *sdi,
+		uint32_t key, uint64_t value);
+SR_PRIV int sr_session_send_meta_double(const struct sr_dev_inst *sdi,
+		uint32_t key, double value);
+SR_PRIV int sr_session_send_meta_string(const struct sr_dev_inst *sdi,
+		uint32_t key, const char *value);
+SR_PRIV void sr_session_meta_cache_free(struct sr_dev_inst *sdi);
+SR_PRIV void sr_session_receive_time_set(const struct sr_dev_inst *sdi,
+		int64_t host_us);
+SR_PRIV void sr_session_packet_clock_free(struct sr_dev_inst *sdi);
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet);
+SR_PRIV int sr_packet_wrap(const struct sr_datafeed_packet *packet,
+		GDestroyNotify release, void *release_data,
+		struct sr_datafeed_packet **wrapped);
+SR_PRIV gboolean sr_packet_is_shared(const struct sr_datafeed_packet *packet);
+/** Backpressure level (percent) at which drivers should throttle. */
+#define SR_BACKPRESSURE_HIGH 75
+SR_PRIV unsigned int sr_session_backpressure_get(struct sr_session *session);
+SR_PRIV void sr_session_overrun(const struct sr_dev_inst *sdi,
+		uint64_t sample_pos);
+SR_PRIV int sr_session_samples_lost(const struct sr_dev_inst *sdi,
+		uint64_t sample_pos, uint64_t count);
+SR_PRIV void sr_session_download_progress(const struct sr_dev_inst *sdi,
+		uint64_t done, uint64_t size);
 SR_PRIV int sr_sessionfile_check(const char *filename);
 SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename,
 		struct sr_session **session);
@@ -1732,9 +2047,195 @@ SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename,
 SR_PRIV void sr_zip_discard(struct zip *archive);
 #endif
 
+SR_PRIV struct zip *sr_sessionfile_open(const char *filename,
+		uint64_t prefetch, int *zep);
 SR_PRIV GKeyFile *sr_sessionfile_read_metadata(struct zip *archive,
 			const struct zip_stat *entry);
 
+/** One archive member which holds sample data. */
+struct sr_sessionfile_chunk {
+	char *name;
+	uint64_t first;
+	uint64_t count;
+};
+
+/** A frame of a session file, as the srzip output lists it. */
+struct sr_sessionfile_frame {
+	uint64_t first;
+	uint64_t count;
+	/* Host time of the frame's first data, in us since the epoch. */
+	int64_t host_us;
+};
+
+/** A device section of the session metadata. */
+struct sr_sessionfile_device {
+	char *capturefile;
+	uint64_t samplerate;
+	int unitsize;
+	int total_logic;
+	int total_analog;
+	char *analog_filter;
+	uint64_t summary_block;
+	int summary_levels;
+	/*
+	 * Frames are stored as differences to the previous frame, with a
+	 * full frame at this interval. 0 if all frames are stored in full.
+	 */
+	uint32_t frame_delta;
+	/* Channel names by channel index, NULL for unnamed channels. */
+	char **names;
+	/* Sample position and lost sample count of each gap, or NULL. */
+	GArray *gaps;
+};
+
+struct sr_session_file_meta {
+	gint ref_count;
+	/* Size and modification time of the file when it got parsed. */
+	goffset size;
+	gint64 mtime;
+	GArray *devices;
+	/* Chunk arrays of the capture files, by base name. */
+	GHashTable *captures;
+	/* Frames of the capture, NULL if the file has no frame list. */
+	GArray *frames;
+};
+
+SR_PRIV int sr_sessionfile_meta_read(struct zip *archive,
+		struct sr_session_file_meta **meta);
+SR_PRIV void sr_sessionfile_chunks_free(void *data);
+SR_PRIV void sr_sessionfile_cache_clear(struct sr_context *ctx);
+
+/** Prefilters of analog chunks in session files. */
+enum {
+	SR_SESSIONFILE_FILTER_NONE,
+	SR_SESSIONFILE_FILTER_SHUFFLE,
+	SR_SESSIONFILE_FILTER_DELTA,
+};
+
+/* Number of summary levels, and the block size ratio between them. */
+#define SR_SESSIONFILE_SUMMARY_LEVELS 4
+#define SR_SESSIONFILE_SUMMARY_FACTOR 16
+
+SR_PRIV int sr_sessionfile_filter_from_name(const char *name);
+SR_PRIV void sr_sessionfile_filter_apply(int filter, const float *in,
+		uint8_t *out, size_t count);
+SR_PRIV void sr_sessionfile_filter_revert(int filter, uint8_t *in,
+		float *out, size_t count);
+SR_PRIV void sr_sessionfile_xor(uint8_t *buf, const uint8_t *ref, size_t len);
+
+/*--- output/output.c -------------------------------------------------------*/
+
+SR_PRIV GString *sr_output_sink_string(struct sr_output_sink *sink);
+SR_PRIV int sr_output_sink_append(struct sr_output_sink *sink,
+		const void *data, size_t len);
+
+/*--- output/srnet.c, input/srnet.c -----------------------------------------*/
+
+/*
+ * Binary framing of the datafeed, for streaming it to a remote host.
+ * The stream starts with SRNET_MAGIC and a u32 version, followed by
+ * frames of a SRNET_FRAME_HEADER_SIZE header (u8 type, u8 flags,
+ * u16 reserved, u32 payload length, u32 uncompressed payload length)
+ * and the payload. All numbers are little endian.
+ */
+#define SRNET_MAGIC "SRNETSTM"
+#define SRNET_MAGIC_SIZE 8
+#define SRNET_VERSION 1
+#define SRNET_FRAME_HEADER_SIZE 12
+/* The payload is LZ4 compressed. */
+#define SRNET_FLAG_LZ4 (1 << 0)
+
+enum srnet_frame_type {
+	SRNET_HEADER = 1,
+	SRNET_META,
+	SRNET_LOGIC,
+	SRNET_ANALOG,
+	SRNET_TRIGGER,
+	SRNET_FRAME_BEGIN,
+	SRNET_FRAME_END,
+	SRNET_END,
+};
+
+/*--- transform/transform.c -------------------------------------------------*/
+
+SR_PRIV void *sr_transform_buf_get(struct sr_transform *t, size_t size);
+SR_PRIV int sr_transform_packet_cow(struct sr_transform *t,
+		const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_packet **copy);
+
+/*--- buffer_pool.c ---------------------------------------------------------*/
+
+struct sr_buffer_pool;
+
+struct sr_buffer_pool_stats {
+	/** Allocations which were satisfied from an idle buffer. */
+	uint64_t hits;
+	/** Allocations which needed a new buffer. */
+	uint64_t misses;
+	/** Number of buffers currently handed out. */
+	uint64_t outstanding;
+	/** Number of bytes in idle buffers. */
+	size_t cached_bytes;
+};
+
+SR_PRIV struct sr_buffer_pool *sr_buffer_pool_new(size_t max_cached,
+		gboolean use_hugepages);
+SR_PRIV void sr_buffer_pool_free(struct sr_buffer_pool *pool);
+SR_PRIV struct sr_buffer_pool *sr_buffer_pool_default_get(void);
+SR_PRIV void *sr_buffer_pool_alloc(struct sr_buffer_pool *pool, size_t size);
+SR_PRIV void sr_buffer_pool_release(void *data);
+SR_PRIV void sr_buffer_pool_trim(struct sr_buffer_pool *pool);
+SR_PRIV void sr_buffer_pool_stats_get(struct sr_buffer_pool *pool,
+		struct sr_buffer_pool_stats *stats);
+
+/*--- logic_kernels.c -------------------------------------------------------*/
+
+/**
+ * Loops over logic samples, see sr_logic_kernels_get(). All of them
+ * take the unit size of the samples, which the specialized variants
+ * ignore.
+ */
+struct sr_logic_kernels {
+	/** The unit size the variants are specialized for, 0 if generic. */
+	size_t unitsize;
+	/** Store one channel's bit of @a count samples, as 0 or 1 each. */
+	void (*extract)(const uint8_t *data, size_t unitsize, size_t count,
+		unsigned int channel, uint8_t *out);
+	/** Count the samples at the start of the data which equal @a ref. */
+	size_t (*unchanged)(const uint8_t *data, size_t unitsize, size_t count,
+		const uint8_t *ref);
+};
+
+SR_PRIV const struct sr_logic_kernels *sr_logic_kernels_get(size_t unitsize);
+
+/*--- logic_planar.c --------------------------------------------------------*/
+
+SR_PRIV void sr_logic_planar_decode_range(
+		const struct sr_datafeed_logic_planar *planar,
+		uint64_t first, uint64_t count, void *buf);
+
+/*--- memory.c --------------------------------------------------------------*/
+
+struct sr_spill;
+
+SR_PRIV struct sr_context *sr_dev_inst_context(const struct sr_dev_inst *sdi);
+SR_PRIV gboolean sr_mem_reserve(struct sr_context *ctx, size_t size);
+SR_PRIV void sr_mem_release(struct sr_context *ctx, size_t size);
+SR_PRIV struct sr_spill *sr_spill_new(struct sr_context *ctx, size_t size);
+SR_PRIV void sr_spill_free(struct sr_spill *sp);
+SR_PRIV uint8_t *sr_spill_data(struct sr_spill *sp);
+SR_PRIV int sr_spill_write(struct sr_spill *sp, uint64_t offset,
+		const void *buf, size_t len);
+SR_PRIV int sr_spill_read(struct sr_spill *sp, uint64_t offset,
+		void *buf, size_t len);
+
+/*--- thread.c --------------------------------------------------------------*/
+
+SR_PRIV void sr_thread_policy_apply(struct sr_context *ctx,
+		enum sr_thread_role role);
+SR_PRIV gboolean sr_thread_first_touch(void);
+SR_PRIV void sr_thread_policy_clear(struct sr_context *ctx);
+
 /*--- analog.c --------------------------------------------------------------*/
 
 SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
@@ -1742,6 +2243,28 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
                            struct sr_analog_meaning *meaning,
                            struct sr_analog_spec *spec,
                            int digits);
+SR_PRIV int sr_analog_send_split(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_analog *analog);
+
+/*--- conversion.c ----------------------------------------------------------*/
+
+/* Transpose an 8x8 bit matrix, byte i holds row i, LSB first. */
+static inline uint64_t sr_bits_transpose_8x8(uint64_t x)
+{
+	uint64_t t;
+
+	t = (x ^ (x >> 7)) & UINT64_C(0x00aa00aa00aa00aa);
+	x ^= t ^ (t << 7);
+	t = (x ^ (x >> 14)) & UINT64_C(0x0000cccc0000cccc);
+	x ^= t ^ (t << 14);
+	t = (x ^ (x >> 28)) & UINT64_C(0x00000000f0f0f0f0);
+	x ^= t ^ (t << 28);
+
+	return x;
+}
+
+SR_PRIV void sr_bits_transpose_u16(const uint64_t *src, size_t num_blocks,
+		size_t num_words, uint16_t *dst);
 
 /*--- std.c -----------------------------------------------------------------*/
 
@@ -1762,6 +2285,8 @@ SR_PRIV int std_session_send_df_header(const struct sr_dev_inst *sdi);
 SR_PRIV int std_session_send_df_end(const struct sr_dev_inst *sdi);
 SR_PRIV int std_session_send_df_trigger(const struct sr_dev_inst *sdi);
 SR_PRIV int std_session_send_df_frame_begin(const struct sr_dev_inst *sdi);
+SR_PRIV int std_session_send_df_frame_begin_pos(const struct sr_dev_inst *sdi,
+		uint64_t sample_pos);
 SR_PRIV int std_session_send_df_frame_end(const struct sr_dev_inst *sdi);
 SR_PRIV int std_dev_clear_with_callback(const struct sr_dev_driver *driver,
 		std_dev_clear_callback clear_private);
@@ -1769,6 +2294,9 @@ SR_PRIV int std_dev_clear(const struct sr_dev_driver *driver);
 SR_PRIV GSList *std_dev_list(const struct sr_dev_driver *di);
 SR_PRIV int std_serial_dev_close(struct sr_dev_inst *sdi);
 SR_PRIV GSList *std_scan_complete(struct sr_dev_driver *di, GSList *devices);
+typedef void *(*std_probe_port_callback)(const char *port, void *cb_data);
+SR_PRIV GSList *std_probe_ports(GSList *ports, std_probe_port_callback probe,
+	void *cb_data);
 
 SR_PRIV int std_opts_config_list(uint32_t key, GVariant **data,
 	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg,
@@ -1833,6 +2361,10 @@ SR_PRIV gssize sr_resource_read(struct sr_context *ctx,
 SR_PRIV void *sr_resource_load(struct sr_context *ctx, int type,
 		const char *name, size_t *size, size_t max_size)
 		G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+SR_PRIV GBytes *sr_resource_load_cached(struct sr_context *ctx, int type,
+		const char *name, size_t max_size) G_GNUC_WARN_UNUSED_RESULT;
+SR_PRIV void sr_resource_cache_clear(struct sr_context *ctx);
+SR_PRIV void sr_resource_preload_env(struct sr_context *ctx);
 
 /*--- strutil.c -------------------------------------------------------------*/
 
@@ -1851,15 +2383,25 @@ SR_PRIV void sr_hexdump_free(GString *s);
 
 /*--- soft-trigger.c --------------------------------------------------------*/
 
+struct soft_trigger_stage;
+
 struct soft_trigger_logic {
 	const struct sr_dev_inst *sdi;
 	const struct sr_trigger *trigger;
 	int count;
 	int unitsize;
 	int cur_stage;
+	/** Trigger stages, compiled into masks of unitsize width. */
+	struct soft_trigger_stage *stages;
+	int num_stages;
+	size_t num_words;
+	gboolean has_edges;
+	/** Skip ahead to candidate samples, see scan_candidate(). */
+	gboolean fast_scan;
 	uint8_t *prev_sample;
-	uint8_t *pre_trigger_buffer;
-	uint8_t *pre_trigger_head;
+	/** Pre-trigger circular buffer, charged to the memory budget. */
+	struct sr_spill *pre_trigger_buffer;
+	int pre_trigger_head;
 	int pre_trigger_size;
 	int pre_trigger_fill;
 };
@@ -1869,8 +2411,50 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
 		int pre_trigger_samples);
 SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *st);
+SR_PRIV void soft_trigger_logic_rearm(struct soft_trigger_logic *st);
+SR_PRIV void soft_trigger_logic_reset(struct soft_trigger_logic *st);
 SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *st, uint8_t *buf,
 		int len, int *pre_trigger_samples);
+SR_PRIV int64_t soft_trigger_logic_check_rle(struct soft_trigger_logic *st,
+		const struct sr_datafeed_logic_rle *rle, int *pre_trigger_samples);
+
+struct soft_trigger_analog {
+	const struct sr_dev_inst *sdi;
+	/** The channel to trigger on. */
+	const struct sr_channel *channel;
+	gboolean has_rising, has_falling;
+	float rising, falling;
+	/** Levels match within (level_over, level_under), or outside. */
+	gboolean has_level, level_outside;
+	float level_over, level_under;
+	float hysteresis;
+	gboolean armed_rising, armed_falling;
+	/** Send a frame begin ahead of the pre-trigger samples. */
+	gboolean frames;
+	/** The trigger channel's samples, when they need conversion. */
+	float *values;
+	size_t values_size;
+	/** Pre-trigger sample buffers, logic first (if any), all in step. */
+	gboolean has_logic;
+	int num_buffers;
+	struct sr_spill **pre_trigger_buffers;
+	int *unitsizes;
+	int pre_trigger_samples;
+	int pre_trigger_head;
+	int pre_trigger_fill;
+};
+
+SR_PRIV gboolean soft_trigger_analog_wanted(const struct sr_trigger *trigger);
+SR_PRIV struct soft_trigger_analog *soft_trigger_analog_new(
+		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		int pre_trigger_samples, float hysteresis, gboolean frames);
+SR_PRIV void soft_trigger_analog_free(struct soft_trigger_analog *sta);
+SR_PRIV void soft_trigger_analog_rearm(struct soft_trigger_analog *sta);
+SR_PRIV void soft_trigger_analog_reset(struct soft_trigger_analog *sta);
+SR_PRIV int soft_trigger_analog_check(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_logic *logic,
+		const struct sr_datafeed_analog *analog, int num_channels,
+		int *pre_trigger_samples);
 
 /*--- serial.c --------------------------------------------------------------*/
 
@@ -1893,6 +2477,8 @@ SR_PRIV int serial_close(struct sr_serial_dev_inst *serial);
 SR_PRIV int serial_flush(struct sr_serial_dev_inst *serial);
 SR_PRIV int serial_drain(struct sr_serial_dev_inst *serial);
 SR_PRIV size_t serial_has_receive_data(struct sr_serial_dev_inst *serial);
+SR_PRIV int serial_wait_receive_data(struct sr_serial_dev_inst *serial,
+		unsigned int timeout_ms);
 SR_PRIV int serial_write_blocking(struct sr_serial_dev_inst *serial,
 		const void *buf, size_t count, unsigned int timeout_ms);
 SR_PRIV int serial_write_nonblocking(struct sr_serial_dev_inst *serial,
@@ -1926,6 +2512,30 @@ SR_PRIV int serial_source_remove(struct sr_session *session,
 SR_PRIV GSList *sr_serial_find_usb(uint16_t vendor_id, uint16_t product_id);
 SR_PRIV int serial_timeout(struct sr_serial_dev_inst *port, int num_bytes);
 
+/** Default capacity of the RX queue of transports which need one. */
+#define SER_RX_RING_SIZE	(64 * 1024)
+
+/**
+ * RX data queue with a fixed capacity. Read and write positions are
+ * free running counters, the capacity is a power of two. One producer
+ * and one consumer can use the queue without locks.
+ */
+struct ser_rx_ring {
+	uint8_t *data;
+	size_t size;
+	volatile gint head;
+	volatile gint tail;
+};
+
+SR_PRIV struct ser_rx_ring *ser_rx_ring_new(size_t size);
+SR_PRIV void ser_rx_ring_free(struct ser_rx_ring *ring);
+SR_PRIV size_t ser_rx_ring_used(struct ser_rx_ring *ring);
+SR_PRIV size_t ser_rx_ring_write_span(struct ser_rx_ring *ring, uint8_t **ptr);
+SR_PRIV void ser_rx_ring_commit(struct ser_rx_ring *ring, size_t len);
+SR_PRIV size_t ser_rx_ring_read_span(struct ser_rx_ring *ring,
+		const uint8_t **ptr);
+SR_PRIV void ser_rx_ring_consume(struct ser_rx_ring *ring, size_t len);
+
 SR_PRIV void sr_ser_discard_queued_data(struct sr_serial_dev_inst *serial);
 SR_PRIV size_t sr_ser_has_queued_data(struct sr_serial_dev_inst *serial);
 SR_PRIV void sr_ser_queue_rx_data(struct sr_serial_dev_inst *serial,
@@ -1961,6 +2571,8 @@ struct ser_lib_functions {
 	int (*get_frame_format)(struct sr_serial_dev_inst *serial,
 			int *baud, int *bits);
 	size_t (*get_rx_avail)(struct sr_serial_dev_inst *serial);
+	int (*wait_rx)(struct sr_serial_dev_inst *serial,
+			unsigned int timeout_ms);
 };
 extern SR_PRIV struct ser_lib_functions *ser_lib_funcs_libsp;
 SR_PRIV int ser_name_is_hid(struct sr_serial_dev_inst *serial);
@@ -2033,6 +2645,7 @@ SR_PRIV ssize_t sr_bt_write(struct sr_bt_desc *desc,
 
 SR_PRIV int sr_bt_start_notify(struct sr_bt_desc *desc);
 SR_PRIV int sr_bt_check_notify(struct sr_bt_desc *desc);
+SR_PRIV int sr_bt_get_fd(struct sr_bt_desc *desc);
 #endif
 
 /*--- ezusb.c ---------------------------------------------------------------*/
@@ -2053,10 +2666,73 @@ SR_PRIV int sr_usb_open(libusb_context *usb_ctx, struct sr_usb_dev_inst *usb);
 SR_PRIV void sr_usb_close(struct sr_usb_dev_inst *usb);
 SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
 		int timeout, sr_receive_data_callback cb, void *cb_data);
+SR_PRIV int usb_source_add_deferred(struct sr_session *session,
+		struct sr_context *ctx, int timeout,
+		sr_receive_data_callback cb, void *cb_data);
+SR_PRIV gboolean usb_transfer_defer(struct libusb_transfer *transfer,
+		libusb_transfer_cb_fn cb);
 SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx);
-SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len);
-SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
-		const char *manufacturer, const char *product);
+/** Descriptor strings of a USB device, see usb_get_strings(). */
+struct usb_dev_strings {
+	char manufacturer[64];
+	char product[64];
+	char serial_num[64];
+};
+
+SR_PRIV void usb_cache_init(struct sr_context *ctx);
+SR_PRIV void usb_cache_cleanup(struct sr_context *ctx);
+SR_PRIV ssize_t usb_get_device_list(struct sr_context *ctx,
+		libusb_device ***list);
+SR_PRIV int usb_get_port_path(struct sr_context *ctx, libusb_device *dev,
+		char *path, int path_len);
+SR_PRIV int usb_get_strings(struct sr_context *ctx, libusb_device *dev,
+		struct usb_dev_strings *strings);
+SR_PRIV gboolean usb_match_manuf_prod(struct sr_context *ctx,
+		libusb_device *dev, const char *manufacturer, const char *product);
+SR_PRIV gboolean usb_fpga_loaded(struct sr_context *ctx, libusb_device *dev,
+		const char *name);
+SR_PRIV void usb_fpga_loaded_set(struct sr_context *ctx, libusb_device *dev,
+		const char *name);
+SR_PRIV int usb_bulk_upload(struct sr_context *ctx,
+		struct sr_usb_dev_inst *usb, unsigned char endpoint,
+		const uint8_t *data, size_t length, size_t chunk_size,
+		unsigned int timeout);
+
+/** Sizing of streaming bulk transfers, see usb_stream_init(). */
+struct usb_stream {
+	/* Bounds of the time spans of one and of all transfers, in ms. */
+	uint64_t transfer_ms_min, transfer_ms_max;
+	uint64_t buffer_ms_min, buffer_ms_max;
+	unsigned int max_transfers;
+	/* Current time spans, these carry over to the next acquisition. */
+	uint64_t transfer_ms;
+	uint64_t buffer_ms;
+	/* Sizes for the current acquisition, from usb_stream_start(). */
+	size_t bytes_per_ms;
+	size_t block_size;
+	size_t alloc_size;
+	size_t length;
+	unsigned int num_transfers;
+	/* Completion measurements. */
+	int64_t duty_permille;
+	int64_t last_us;
+	gboolean late;
+};
+
+SR_PRIV void usb_stream_init(struct usb_stream *st, uint64_t transfer_ms,
+		uint64_t buffer_ms, unsigned int max_transfers);
+SR_PRIV int usb_stream_config_get(const struct usb_stream *st, uint32_t key,
+		GVariant **data);
+SR_PRIV int usb_stream_config_set(struct usb_stream *st, uint32_t key,
+		GVariant *data);
+SR_PRIV void usb_stream_start(struct usb_stream *st, size_t bytes_per_ms,
+		size_t block_size);
+SR_PRIV unsigned int usb_stream_timeout(const struct usb_stream *st);
+SR_PRIV size_t usb_stream_completed(struct usb_stream *st, int64_t start_us);
+SR_PRIV void usb_stream_stop(struct usb_stream *st);
+SR_PRIV uint8_t *usb_transfer_buf_alloc(libusb_device_handle *devhdl,
+		size_t size);
+SR_PRIV void usb_transfer_buf_free(uint8_t *buf);
 #endif
 
 /*--- binary_helpers.c ------------------------------------------------------*/
@@ -2143,6 +2819,34 @@ SR_PRIV int bv_send_analog_channel(const struct sr_dev_inst *sdi, struct sr_chan
  */
 SR_PRIV uint16_t sr_crc16(uint16_t crc, const uint8_t *buffer, int len);
 
+/**
+ * Calculate a CRC16 checksum using the 0x1021 polynomial (reflected).
+ *
+ * This CRC16 flavor is also known as CRC16-MCRF4XX, it is CRC16-CCITT
+ * in LSB first order.
+ *
+ * @param crc Initial value (typically 0xffff)
+ * @param buffer Input buffer
+ * @param len Buffer length
+ * @return Checksum
+ */
+SR_PRIV uint16_t sr_crc16_mcrf4xx(uint16_t crc, const uint8_t *buffer,
+		size_t len);
+
+/**
+ * Calculate a CRC32 checksum using the 0x04c11db7 polynomial.
+ *
+ * This is the CRC32 of IEEE 802.3 and zlib. The pre and post inversion
+ * is part of the calculation, checksums of consecutive buffers can be
+ * chained by passing the previous result.
+ *
+ * @param crc Initial value (0, or the checksum of the preceding data)
+ * @param buffer Input buffer
+ * @param len Buffer length
+ * @return Checksum
+ */
+SR_PRIV uint32_t sr_crc32(uint32_t crc, const uint8_t *buffer, size_t len);
+
 /*--- modbus/modbus.c -------------------------------------------------------*/
 
 struct sr_modbus_dev_inst {
@@ -2166,6 +2870,9 @@ struct sr_modbus_dev_inst {
 	void *priv;
 };
 
+/* Coalesced holding register reads, see sr_modbus_batch_new(). */
+struct sr_modbus_batch;
+
 SR_PRIV GSList *sr_modbus_scan(struct drv_context *drvc, GSList *options,
 		struct sr_dev_inst *(*probe_device)(struct sr_modbus_dev_inst *modbus));
 SR_PRIV struct sr_modbus_dev_inst *modbus_dev_inst_new(const char *resource,
@@ -2188,6 +2895,15 @@ SR_PRIV int sr_modbus_read_coils(struct sr_modbus_dev_inst *modbus,
 SR_PRIV int sr_modbus_read_holding_registers(struct sr_modbus_dev_inst *modbus,
                                              int address, int nb_registers,
                                              uint16_t *registers);
+SR_PRIV struct sr_modbus_batch *sr_modbus_batch_new(
+		struct sr_modbus_dev_inst *modbus, int max_gap);
+SR_PRIV void sr_modbus_batch_free(struct sr_modbus_batch *batch);
+SR_PRIV int sr_modbus_batch_add(struct sr_modbus_batch *batch,
+		int address, int nb_registers, uint16_t *registers);
+SR_PRIV int sr_modbus_batch_send(struct sr_modbus_batch *batch);
+SR_PRIV int sr_modbus_batch_receive(struct sr_modbus_batch *batch);
+SR_PRIV int sr_modbus_batch_run(struct sr_modbus_batch *batch);
+SR_PRIV int sr_modbus_batch_rewind(struct sr_modbus_batch *batch);
 SR_PRIV int sr_modbus_write_coil(struct sr_modbus_dev_inst *modbus,
                                  int address, int value);
 SR_PRIV int sr_modbus_write_multiple_registers(struct sr_modbus_dev_inst*modbus,
@@ -2196,6 +2912,27 @@ SR_PRIV int sr_modbus_write_multiple_registers(struct sr_modbus_dev_inst*modbus,
 SR_PRIV int sr_modbus_close(struct sr_modbus_dev_inst *modbus);
 SR_PRIV void sr_modbus_free(struct sr_modbus_dev_inst *modbus);
 
+/*--- 7-segment displays, for the dmm/ parsers ------------------------------*/
+
+/*
+ * Parsers decode display digits with a per chip table which maps the
+ * segment pattern byte to the digit's value (or character). The table
+ * gets built at compile time, entries hold the value plus one, so that
+ * unlisted (zero initialized) patterns are invalid:
+ *
+ *   static const uint8_t digits[256] = {
+ *           SR_SEG7_ENTRY(0x7d, 0), SR_SEG7_ENTRY(0x05, 1), ...
+ *   };
+ *   value = sr_seg7_lookup(digits, b);
+ */
+#define SR_SEG7_ENTRY(pattern, value)	[(uint8_t)(pattern)] = (value) + 1
+
+/* Returns the value of a segment pattern, or -1 when it is invalid. */
+static inline int sr_seg7_lookup(const uint8_t *table, uint8_t pattern)
+{
+	return (int)table[pattern] - 1;
+}
+
 /*--- dmm/es519xx.c ---------------------------------------------------------*/
 
 /**
@@ -2687,14 +3424,30 @@ SR_API struct feed_queue_logic *feed_queue_logic_alloc(
 	size_t sample_count, size_t unit_size);
 SR_API int feed_queue_logic_submit(struct feed_queue_logic *q,
 	const uint8_t *data, size_t count);
+SR_API int feed_queue_logic_submit_many(struct feed_queue_logic *q,
+	const uint8_t *data, size_t count);
+SR_API uint8_t *feed_queue_logic_reserve(struct feed_queue_logic *q,
+	size_t *count);
+SR_API int feed_queue_logic_commit(struct feed_queue_logic *q, size_t count);
+SR_API int feed_queue_logic_set_max_age(struct feed_queue_logic *q,
+	uint64_t max_age_ms);
 SR_API int feed_queue_logic_flush(struct feed_queue_logic *q);
 SR_API void feed_queue_logic_free(struct feed_queue_logic *q);
 
 SR_API struct feed_queue_analog *feed_queue_analog_alloc(
 	struct sr_dev_inst *sdi,
 	size_t sample_count, int digits, struct sr_channel *ch);
+SR_API struct feed_queue_analog *feed_queue_analog_alloc_multi(
+	struct sr_dev_inst *sdi, size_t sample_count, int digits,
+	GSList *channels, const struct sr_analog_encoding *encoding);
 SR_API int feed_queue_analog_submit(struct feed_queue_analog *q,
 	float data, size_t count);
+SR_API int feed_queue_analog_submit_interleaved(struct feed_queue_analog *q,
+	const void *data, size_t count);
+SR_API int feed_queue_analog_submit_planar(struct feed_queue_analog *q,
+	const void *const *data, size_t count);
+SR_API int feed_queue_analog_set_max_age(struct feed_queue_analog *q,
+	uint64_t max_age_ms);
 SR_API int feed_queue_analog_flush(struct feed_queue_analog *q);
 SR_API void feed_queue_analog_free(struct feed_queue_analog *q);
 
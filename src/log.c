@@ -20,6 +20,7 @@
 #include <config.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 #include <glib/gprintf.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -63,6 +64,68 @@ static void *sr_log_cb_data = NULL;
 /** @endcond */
 static int64_t sr_log_start_time = 0;
 
+/** @cond PRIVATE */
+/* Message slots of the asynchronous mode, must be a power of two. */
+#define LOG_ASYNC_SLOTS		1024
+/* Longer messages get truncated. */
+#define LOG_ASYNC_SLOT_SIZE	256
+/* How long the writer thread sleeps when there are no messages. */
+#define LOG_ASYNC_IDLE_US	(10 * 1000)
+/** @endcond */
+
+/*
+ * Asynchronous mode of the default log callback: a bounded queue which
+ * any number of threads format messages into, and one writer thread
+ * which takes them out. Each slot's sequence number tells whose turn
+ * it is: a producer may fill slot (pos % SLOTS) when seq == pos, the
+ * writer may take it when seq == pos + 1. No locks, producers never
+ * wait, they drop messages when the queue is full.
+ */
+struct log_slot {
+	gint seq;
+	char text[LOG_ASYNC_SLOT_SIZE];
+};
+
+static struct log_slot log_slots[LOG_ASYNC_SLOTS];
+static gint log_enqueue_pos;
+static gint log_dequeue_pos;
+static gint log_async_enabled;
+static gint log_async_dropped;
+static GThread *log_async_thread;
+
+/** @cond PRIVATE */
+#define LOG_MODULES_MAX		32
+#define LOG_MODULE_NAME_MAX	32
+/** @endcond */
+
+/*
+ * Loglevel overrides of modules (LOG_PREFIX strings). Messages of higher
+ * loglevels than all overrides and the global loglevel get dropped with
+ * a single comparison, 'max_loglevel' is the highest of them.
+ */
+struct log_module_level {
+	char module[LOG_MODULE_NAME_MAX];
+	int loglevel;
+};
+
+static struct log_module_level module_levels[LOG_MODULES_MAX];
+static int num_module_levels;
+static int max_loglevel = SR_LOG_WARN;
+G_LOCK_DEFINE_STATIC(module_levels);
+
+/* Messages per second and call site of the rate limited helpers. */
+static int ratelimit_per_second = SR_LOG_RATELIMIT_DEFAULT;
+
+static void max_loglevel_update(void)
+{
+	int i, level;
+
+	level = cur_loglevel;
+	for (i = 0; i < num_module_levels; i++)
+		level = MAX(level, module_levels[i].loglevel);
+	max_loglevel = level;
+}
+
 /**
  * Set the libsigrok loglevel.
  *
@@ -90,7 +153,10 @@ SR_API int sr_log_loglevel_set(int loglevel)
 	if (loglevel >= LOGLEVEL_TIMESTAMP && sr_log_start_time == 0)
 		sr_log_start_time = g_get_monotonic_time();
 
+	G_LOCK(module_levels);
 	cur_loglevel = loglevel;
+	max_loglevel_update();
+	G_UNLOCK(module_levels);
 
 	sr_dbg("libsigrok loglevel set to %d.", loglevel);
 
@@ -109,6 +175,116 @@ SR_API int sr_log_loglevel_get(void)
 	return cur_loglevel;
 }
 
+/**
+ * Set the loglevel of a libsigrok module.
+ *
+ * Modules are the subsystems and drivers which prefix their messages
+ * with their name, like "fx2lafw" or "session". Their loglevel takes
+ * precedence over the global loglevel, which allows debugging a single
+ * module without the output of all the others.
+ *
+ * @param module The name of the module. Must not be NULL.
+ * @param loglevel The loglevel to set (SR_LOG_NONE, SR_LOG_ERR, SR_LOG_WARN,
+ *                 SR_LOG_INFO, SR_LOG_DBG, or SR_LOG_SPEW), or -1 to make
+ *                 the module use the global loglevel again.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid module name or loglevel.
+ * @retval SR_ERR Too many modules have loglevels.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_log_loglevel_set_module(const char *module, int loglevel)
+{
+	int i;
+
+	if (!module || !*module || strlen(module) >= LOG_MODULE_NAME_MAX)
+		return SR_ERR_ARG;
+	if (loglevel < -1 || loglevel > SR_LOG_SPEW)
+		return SR_ERR_ARG;
+
+	if (loglevel >= LOGLEVEL_TIMESTAMP && sr_log_start_time == 0)
+		sr_log_start_time = g_get_monotonic_time();
+
+	G_LOCK(module_levels);
+	for (i = 0; i < num_module_levels; i++) {
+		if (!strcmp(module_levels[i].module, module))
+			break;
+	}
+	if (loglevel < 0) {
+		if (i < num_module_levels)
+			module_levels[i] = module_levels[--num_module_levels];
+	} else {
+		if (i == LOG_MODULES_MAX) {
+			G_UNLOCK(module_levels);
+			return SR_ERR;
+		}
+		if (i == num_module_levels)
+			num_module_levels++;
+		g_strlcpy(module_levels[i].module, module, LOG_MODULE_NAME_MAX);
+		module_levels[i].loglevel = loglevel;
+	}
+	max_loglevel_update();
+	G_UNLOCK(module_levels);
+
+	return SR_OK;
+}
+
+/**
+ * Get the loglevel of a libsigrok module.
+ *
+ * @param module The name of the module. Must not be NULL.
+ *
+ * @return The module's loglevel, which is the global loglevel when no
+ *         loglevel was set for the module.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_log_loglevel_get_module(const char *module)
+{
+	int i, loglevel;
+
+	loglevel = cur_loglevel;
+	if (!module)
+		return loglevel;
+
+	G_LOCK(module_levels);
+	for (i = 0; i < num_module_levels; i++) {
+		if (!strcmp(module_levels[i].module, module)) {
+			loglevel = module_levels[i].loglevel;
+			break;
+		}
+	}
+	G_UNLOCK(module_levels);
+
+	return loglevel;
+}
+
+/**
+ * Set the limit of the rate limited log messages.
+ *
+ * Some messages can occur at high rates, like those of every USB
+ * transfer. They get limited to a number of messages per second, for
+ * each place in the code. The number of suppressed messages gets logged
+ * when a message passes the limit again.
+ *
+ * @param per_second The number of messages per second, or 0 to not limit
+ *                   the messages at all. The default is 10.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_log_ratelimit_set(int per_second)
+{
+	if (per_second < 0)
+		return SR_ERR_ARG;
+
+	g_atomic_int_set(&ratelimit_per_second, per_second);
+
+	return SR_OK;
+}
+
 /**
  * Set the libsigrok log callback to the specified function.
  *
@@ -182,6 +358,166 @@ SR_API int sr_log_callback_get(sr_log_callback *cb, void **cb_data)
 	return SR_OK;
 }
 
+/* Format the message prefix (with a timestamp at higher loglevels). */
+static int log_prefix_format(char *buf, size_t size)
+{
+	uint64_t elapsed_us, minutes;
+	unsigned int rest_us, seconds, microseconds;
+
+	if (cur_loglevel < LOGLEVEL_TIMESTAMP)
+		return g_snprintf(buf, size, "sr: ");
+
+	elapsed_us = g_get_monotonic_time() - sr_log_start_time;
+
+	minutes = elapsed_us / G_TIME_SPAN_MINUTE;
+	rest_us = elapsed_us % G_TIME_SPAN_MINUTE;
+	seconds = rest_us / G_TIME_SPAN_SECOND;
+	microseconds = rest_us % G_TIME_SPAN_SECOND;
+
+	return g_snprintf(buf, size, "sr: [%.2" PRIu64 ":%.2u.%.6u] ",
+			minutes, seconds, microseconds);
+}
+
+/* Queue a message for the writer thread, or drop it if the queue is full. */
+static int log_async_queue(const char *format, va_list args)
+{
+	struct log_slot *slot;
+	guint pos, seq;
+	gint diff;
+	char *p, *q;
+	int len;
+
+	pos = g_atomic_int_get(&log_enqueue_pos);
+	while (TRUE) {
+		slot = &log_slots[pos & (LOG_ASYNC_SLOTS - 1)];
+		seq = g_atomic_int_get(&slot->seq);
+		diff = (gint)(seq - pos);
+		if (diff == 0) {
+			if (g_atomic_int_compare_and_exchange(&log_enqueue_pos,
+					pos, pos + 1))
+				break;
+		} else if (diff < 0) {
+			g_atomic_int_inc(&log_async_dropped);
+			return SR_OK;
+		}
+		pos = g_atomic_int_get(&log_enqueue_pos);
+	}
+
+	len = log_prefix_format(slot->text, sizeof(slot->text));
+	if (len >= 0 && len < (int)sizeof(slot->text))
+		g_vsnprintf(&slot->text[len], sizeof(slot->text) - len,
+			format, args);
+
+	/* Strip unwanted newlines. */
+	for (p = q = slot->text; *p; p++) {
+		if (*p != '\n')
+			*q++ = *p;
+	}
+	*q = '\0';
+
+	g_atomic_int_set(&slot->seq, pos + 1);
+
+	return SR_OK;
+}
+
+/* Write queued messages, returns the number of messages written. */
+static size_t log_async_write(void)
+{
+	struct log_slot *slot;
+	guint pos;
+	size_t count;
+	gint dropped;
+
+	count = 0;
+	pos = g_atomic_int_get(&log_dequeue_pos);
+	while (TRUE) {
+		slot = &log_slots[pos & (LOG_ASYNC_SLOTS - 1)];
+		if ((guint)g_atomic_int_get(&slot->seq) != pos + 1)
+			break;
+		fputs(slot->text, stderr);
+		fputc('\n', stderr);
+		g_atomic_int_set(&slot->seq, pos + LOG_ASYNC_SLOTS);
+		pos++;
+		count++;
+	}
+	g_atomic_int_set(&log_dequeue_pos, pos);
+
+	dropped = g_atomic_int_and(&log_async_dropped, 0);
+	if (dropped)
+		fprintf(stderr, "sr: %d log messages dropped.\n", dropped);
+
+	if (count || dropped)
+		fflush(stderr);
+
+	return count;
+}
+
+static gpointer log_async_thread_func(gpointer data)
+{
+	(void)data;
+
+	while (g_atomic_int_get(&log_async_enabled)) {
+		if (!log_async_write())
+			g_usleep(LOG_ASYNC_IDLE_US);
+	}
+	log_async_write();
+
+	return NULL;
+}
+
+/**
+ * Enable or disable the asynchronous mode of the default log callback.
+ *
+ * In asynchronous mode, the default log callback formats messages into
+ * a queue, and a background thread writes them to stderr. Logging then
+ * costs little time on the calling thread (e.g. in USB transfer
+ * callbacks), so that debug output can stay enabled during acquisitions.
+ * Messages are dropped (and counted) instead of blocking the caller when
+ * the queue is full, and get truncated to 255 characters.
+ *
+ * Disabling the mode writes the messages which are queued. Log callbacks
+ * set with sr_log_callback_set() are not affected.
+ *
+ * @param enable TRUE to enable, FALSE to disable the asynchronous mode.
+ *
+ * @return SR_OK upon success, SR_ERR if the thread can't be started.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_log_async_set(gboolean enable)
+{
+	GThread *thread;
+	guint i, pos;
+
+	if (!enable) {
+		if (!g_atomic_int_compare_and_exchange(&log_async_enabled, 1, 0))
+			return SR_OK;
+		g_thread_join(log_async_thread);
+		log_async_thread = NULL;
+		return SR_OK;
+	}
+
+	if (log_async_thread)
+		return SR_OK;
+
+	/* Continue at the writer's position, any earlier slots are done. */
+	pos = g_atomic_int_get(&log_dequeue_pos);
+	for (i = 0; i < LOG_ASYNC_SLOTS; i++)
+		g_atomic_int_set(&log_slots[(pos + i) & (LOG_ASYNC_SLOTS - 1)].seq,
+			pos + i);
+	g_atomic_int_set(&log_enqueue_pos, pos);
+
+	g_atomic_int_set(&log_async_enabled, 1);
+	thread = g_thread_try_new("sr-log", log_async_thread_func, NULL, NULL);
+	if (!thread) {
+		g_atomic_int_set(&log_async_enabled, 0);
+		return SR_ERR;
+	}
+	log_async_thread = thread;
+
+	return SR_OK;
+}
+
 static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args)
 {
 	uint64_t elapsed_us, minutes;
@@ -194,6 +530,9 @@ static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args
 
 	(void)loglevel;
 
+	if (g_atomic_int_get(&log_async_enabled))
+		return log_async_queue(format, args);
+
 	if (cur_loglevel >= LOGLEVEL_TIMESTAMP) {
 		elapsed_us = g_get_monotonic_time() - sr_log_start_time;
 
@@ -231,6 +570,90 @@ static int sr_logv(void *cb_data, int loglevel, const char *format, va_list args
 	return SR_OK;
 }
 
+/* Check whether messages of a module's loglevel get shown. */
+static gboolean module_loglevel_check(int loglevel, const char *module)
+{
+	int i, module_loglevel;
+
+	if (loglevel > max_loglevel)
+		return FALSE;
+	if (!num_module_levels)
+		return loglevel <= cur_loglevel;
+
+	module_loglevel = cur_loglevel;
+	G_LOCK(module_levels);
+	for (i = 0; i < num_module_levels; i++) {
+		if (!strcmp(module_levels[i].module, module)) {
+			module_loglevel = module_levels[i].loglevel;
+			break;
+		}
+	}
+	G_UNLOCK(module_levels);
+
+	return loglevel <= module_loglevel;
+}
+
+/** @private */
+SR_PRIV int sr_log_module(int loglevel, const char *module,
+		const char *format, ...)
+{
+	int ret;
+	va_list args;
+
+	/* Check the levels before the message gets formatted. */
+	if (!module_loglevel_check(loglevel, module))
+		return SR_OK;
+
+	va_start(args, format);
+	ret = sr_log_cb(sr_log_cb_data, loglevel, format, args);
+	va_end(args);
+
+	return ret;
+}
+
+/**
+ * Check whether a rate limited message may get logged. The limit applies
+ * to the messages of one call site, which 'state' belongs to.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_log_ratelimit_check(struct sr_log_ratelimit *state,
+		int loglevel, const char *module)
+{
+	gint64 now;
+	int limit, suppressed;
+
+	if (!module_loglevel_check(loglevel, module))
+		return FALSE;
+
+	limit = g_atomic_int_get(&ratelimit_per_second);
+	if (!limit)
+		return TRUE;
+
+	/*
+	 * Races of threads which log at the same place only make the
+	 * counts inaccurate, which is acceptable for log messages.
+	 */
+	now = g_get_monotonic_time();
+	if (now - state->window_start >= G_TIME_SPAN_SECOND) {
+		suppressed = state->suppressed;
+		state->window_start = now;
+		state->count = 0;
+		state->suppressed = 0;
+		if (suppressed)
+			sr_log_module(loglevel, module,
+				"%s: %d similar messages suppressed.",
+				module, suppressed);
+	}
+	if (state->count >= limit) {
+		state->suppressed++;
+		return FALSE;
+	}
+	state->count++;
+
+	return TRUE;
+}
+
 /** @private */
 SR_PRIV int sr_log(int loglevel, const char *format, ...)
 {
@@ -0,0 +1,149 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "logic-kernels"
+/** @endcond */
+
+/*
+ * Loops over logic samples, specialized by unit size.
+ *
+ * The bodies below are inlined into one variant per common unit size,
+ * where the unit size is a constant. Compilers then keep the samples in
+ * registers, and vectorize the strided accesses. Other unit sizes take
+ * the generic variant. Modules look up the variants once per stream,
+ * with sr_logic_kernels_get().
+ */
+
+static inline void extract_body(const uint8_t *data, size_t unitsize,
+		size_t count, unsigned int channel, uint8_t *out)
+{
+	unsigned int shift;
+	size_t i;
+
+	data += channel / 8;
+	shift = channel % 8;
+	for (i = 0; i < count; i++)
+		out[i] = (data[i * unitsize] >> shift) & 1;
+}
+
+/*
+ * Unit sizes which divide a machine word get compared a word (several
+ * samples) at a time, the remainder a sample at a time.
+ */
+static inline size_t unchanged_body(const uint8_t *data, size_t unitsize,
+		size_t count, const uint8_t *ref)
+{
+	uint64_t pattern, word;
+	size_t i, n, len;
+
+	i = 0;
+	if (sizeof(pattern) % unitsize == 0) {
+		for (n = 0; n < sizeof(pattern); n += unitsize)
+			memcpy((uint8_t *)&pattern + n, ref, unitsize);
+		len = count * unitsize;
+		for (n = 0; n + sizeof(word) <= len; n += sizeof(word)) {
+			memcpy(&word, data + n, sizeof(word));
+			if (word != pattern)
+				break;
+		}
+		i = n / unitsize;
+	}
+	while (i < count && !memcmp(data + i * unitsize, ref, unitsize))
+		i++;
+
+	return i;
+}
+
+#define LOGIC_KERNELS(name, size) \
+	static void extract_##name(const uint8_t *data, size_t unitsize, \
+			size_t count, unsigned int channel, uint8_t *out) \
+	{ \
+		(void)unitsize; \
+		extract_body(data, size, count, channel, out); \
+	} \
+	static size_t unchanged_##name(const uint8_t *data, size_t unitsize, \
+			size_t count, const uint8_t *ref) \
+	{ \
+		(void)unitsize; \
+		return unchanged_body(data, size, count, ref); \
+	}
+
+LOGIC_KERNELS(1, 1)
+LOGIC_KERNELS(2, 2)
+LOGIC_KERNELS(4, 4)
+LOGIC_KERNELS(8, 8)
+
+static void extract_generic(const uint8_t *data, size_t unitsize,
+		size_t count, unsigned int channel, uint8_t *out)
+{
+	extract_body(data, unitsize, count, channel, out);
+}
+
+static size_t unchanged_generic(const uint8_t *data, size_t unitsize,
+		size_t count, const uint8_t *ref)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		if (memcmp(data + i * unitsize, ref, unitsize))
+			break;
+	}
+
+	return i;
+}
+
+static const struct sr_logic_kernels kernels[] = {
+	{ 1, extract_1, unchanged_1 },
+	{ 2, extract_2, unchanged_2 },
+	{ 4, extract_4, unchanged_4 },
+	{ 8, extract_8, unchanged_8 },
+};
+
+static const struct sr_logic_kernels kernels_generic = {
+	0, extract_generic, unchanged_generic,
+};
+
+/**
+ * Get the logic kernels for a unit size.
+ *
+ * @param unitsize The unit size of the samples, in bytes.
+ *
+ * @return The kernels. Their unitsize is zero for the generic variant,
+ *         which works for all unit sizes.
+ *
+ * @private
+ */
+SR_PRIV const struct sr_logic_kernels *sr_logic_kernels_get(size_t unitsize)
+{
+	size_t i;
+
+	for (i = 0; i < G_N_ELEMENTS(kernels); i++) {
+		if (kernels[i].unitsize == unitsize)
+			return &kernels[i];
+	}
+
+	return &kernels_generic;
+}
@@ -0,0 +1,232 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "logic-planar"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Planar logic data.
+ */
+
+/**
+ * @defgroup grp_logic_planar Planar logic data
+ *
+ * Conversion between interleaved and planar logic data.
+ *
+ * The samples of struct sr_datafeed_logic interleave all channels, so
+ * that consumers of a few channels of a wide capture still read every
+ * byte of it. SR_DF_LOGIC_PLANAR packets hold a bit plane per channel
+ * instead, consumers only read the planes of the channels they need.
+ *
+ * The conversions transpose tiles of 8 samples by 8 channels at once.
+ *
+ * @{
+ */
+
+/* Get 8 bits of a plane from bit @a pos on, without reading past it. */
+static inline uint8_t plane_byte(const uint8_t *plane, uint64_t stride,
+		uint64_t pos)
+{
+	uint64_t i;
+	unsigned int shift;
+
+	i = pos / 8;
+	shift = pos % 8;
+	if (!shift)
+		return plane[i];
+	if (i + 1 >= stride)
+		return plane[i] >> shift;
+
+	return (plane[i] >> shift) | (plane[i + 1] << (8 - shift));
+}
+
+/**
+ * Convert logic data to the planar layout.
+ *
+ * @param logic The logic data to convert. Must not be NULL.
+ * @param planar Pointer to store the newly allocated planar data at.
+ *               Must not be NULL. Free it with sr_logic_planar_free().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_MALLOC Not enough memory for the planes.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_planar_encode(const struct sr_datafeed_logic *logic,
+		struct sr_datafeed_logic_planar **planar)
+{
+	struct sr_datafeed_logic_planar *out;
+	const uint8_t *data;
+	uint8_t *planes;
+	uint64_t num_samples, tile, x, count, k;
+	unsigned int b, j;
+	uint16_t unitsize;
+
+	if (!logic || !planar || !logic->unitsize)
+		return SR_ERR_ARG;
+
+	unitsize = logic->unitsize;
+	num_samples = logic->length / unitsize;
+	data = logic->data;
+
+	out = g_malloc0(sizeof(*out));
+	out->num_samples = num_samples;
+	out->unitsize = unitsize;
+	/* Whole words per plane, so that consumers can read words. */
+	out->stride = MAX((num_samples + 63) / 64, 1) * sizeof(uint64_t);
+	out->data = g_try_malloc0(out->stride * unitsize * 8);
+	if (!out->data) {
+		g_free(out);
+		return SR_ERR_MALLOC;
+	}
+	planes = out->data;
+
+	/*
+	 * Byte k of a tile holds byte b of sample k, transposed byte j
+	 * holds channel 8 * b + j of the samples.
+	 */
+	for (tile = 0; tile < num_samples; tile += 8) {
+		count = MIN(num_samples - tile, 8);
+		for (b = 0; b < unitsize; b++) {
+			x = 0;
+			for (k = 0; k < count; k++)
+				x |= (uint64_t)data[(tile + k) * unitsize + b] << (8 * k);
+			x = sr_bits_transpose_8x8(x);
+			for (j = 0; j < 8; j++)
+				planes[(8 * b + j) * out->stride + tile / 8] = x >> (8 * j);
+		}
+	}
+
+	*planar = out;
+
+	return SR_OK;
+}
+
+/**
+ * Convert a range of planar logic data to the interleaved layout.
+ *
+ * @param planar The planar data. Must not be NULL.
+ * @param first The number of the first sample to convert.
+ * @param count The number of samples to convert, the range must be
+ *              within the data.
+ * @param buf Buffer to write the samples to, count * planar->unitsize
+ *            bytes. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_logic_planar_decode_range(
+		const struct sr_datafeed_logic_planar *planar,
+		uint64_t first, uint64_t count, void *buf)
+{
+	const uint8_t *planes;
+	uint8_t *out;
+	uint64_t tile, x, n, k;
+	unsigned int b, j;
+	uint16_t unitsize;
+
+	planes = planar->data;
+	unitsize = planar->unitsize;
+	out = buf;
+	for (tile = 0; tile < count; tile += 8) {
+		n = MIN(count - tile, 8);
+		for (b = 0; b < unitsize; b++) {
+			x = 0;
+			for (j = 0; j < 8; j++)
+				x |= (uint64_t)plane_byte(planes
+					+ (8 * b + j) * planar->stride,
+					planar->stride, first + tile) << (8 * j);
+			x = sr_bits_transpose_8x8(x);
+			for (k = 0; k < n; k++)
+				out[(tile + k) * unitsize + b] = x >> (8 * k);
+		}
+	}
+}
+
+/**
+ * Convert planar logic data to the interleaved layout.
+ *
+ * @param planar The planar data. Must not be NULL.
+ * @param buf Buffer to write the samples to. Must not be NULL, and
+ *            must hold planar->num_samples * planar->unitsize bytes.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_planar_decode(const struct sr_datafeed_logic_planar *planar,
+		void *buf)
+{
+	if (!planar || !buf)
+		return SR_ERR_ARG;
+
+	sr_logic_planar_decode_range(planar, 0, planar->num_samples, buf);
+
+	return SR_OK;
+}
+
+/**
+ * Get the bit plane of a channel.
+ *
+ * @param planar The planar data. Must not be NULL.
+ * @param index The index of the logic channel, i.e. its bit position
+ *              in the interleaved layout.
+ *
+ * @return The plane, bit n % 8 of byte n / 8 holds sample n. NULL if
+ *         the data has no plane for the channel.
+ *
+ * @since 0.6.0
+ */
+SR_API const uint8_t *sr_logic_planar_plane(
+		const struct sr_datafeed_logic_planar *planar, unsigned int index)
+{
+	if (!planar || index >= planar->unitsize * 8U)
+		return NULL;
+
+	return (const uint8_t *)planar->data + index * planar->stride;
+}
+
+/**
+ * Free planar logic data.
+ *
+ * @param planar The data to free, as returned by sr_logic_planar_encode().
+ *               Can be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_logic_planar_free(struct sr_datafeed_logic_planar *planar)
+{
+	if (!planar)
+		return;
+
+	g_free(planar->data);
+	g_free(planar);
+}
+
+/** @} */
@@ -0,0 +1,184 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "logic-rle"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Run-length encoded logic data.
+ */
+
+/**
+ * @defgroup grp_logic_rle Run-length encoded logic data
+ *
+ * Conversion between dense and run-length encoded logic data.
+ *
+ * Logic captures are often idle for long stretches. Devices which
+ * compress their data this way send SR_DF_LOGIC_RLE packets, which
+ * only hold the sample values at changes and the number of samples
+ * each value lasts for.
+ *
+ * @{
+ */
+
+/**
+ * Run-length encode logic data.
+ *
+ * @param logic The logic data to encode. Must not be NULL.
+ * @param rle Pointer to store the newly allocated encoded data at.
+ *            Must not be NULL. Free it with sr_logic_rle_free().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_rle_encode(const struct sr_datafeed_logic *logic,
+		struct sr_datafeed_logic_rle **rle)
+{
+	const struct sr_logic_kernels *kernels;
+	struct sr_datafeed_logic_rle *out;
+	const uint8_t *data, *value;
+	uint64_t i, num_samples, num_runs, run, length;
+	uint16_t unitsize;
+
+	if (!logic || !rle || !logic->unitsize)
+		return SR_ERR_ARG;
+
+	unitsize = logic->unitsize;
+	num_samples = logic->length / unitsize;
+	data = logic->data;
+	kernels = sr_logic_kernels_get(unitsize);
+
+	/* Count the runs first, so that the arrays fit exactly. */
+	num_runs = 0;
+	for (i = 0; i < num_samples; i += length) {
+		value = data + i * unitsize;
+		length = 1 + kernels->unchanged(value + unitsize, unitsize,
+			num_samples - i - 1, value);
+		num_runs++;
+	}
+
+	out = g_malloc0(sizeof(*out));
+	out->unitsize = unitsize;
+	out->num_runs = num_runs;
+	out->values = g_malloc(MAX(num_runs, 1) * unitsize);
+	out->lengths = g_malloc(MAX(num_runs, 1) * sizeof(out->lengths[0]));
+
+	run = 0;
+	for (i = 0; i < num_samples; i += length) {
+		value = data + i * unitsize;
+		length = 1 + kernels->unchanged(value + unitsize, unitsize,
+			num_samples - i - 1, value);
+		memcpy((uint8_t *)out->values + run * unitsize, value, unitsize);
+		out->lengths[run++] = length;
+	}
+
+	*rle = out;
+
+	return SR_OK;
+}
+
+/**
+ * Get the number of samples in run-length encoded logic data.
+ *
+ * @param rle The encoded data. Must not be NULL.
+ *
+ * @return The number of samples after decoding.
+ *
+ * @since 0.6.0
+ */
+SR_API uint64_t sr_logic_rle_num_samples(const struct sr_datafeed_logic_rle *rle)
+{
+	uint64_t i, num_samples;
+
+	num_samples = 0;
+	for (i = 0; i < rle->num_runs; i++)
+		num_samples += rle->lengths[i];
+
+	return num_samples;
+}
+
+/**
+ * Decode run-length encoded logic data.
+ *
+ * @param rle The encoded data. Must not be NULL.
+ * @param buf Buffer to write the samples to. Must not be NULL, and
+ *            must hold sr_logic_rle_num_samples() * rle->unitsize bytes.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_logic_rle_decode(const struct sr_datafeed_logic_rle *rle,
+		void *buf)
+{
+	const uint8_t *value;
+	uint8_t *out;
+	uint64_t i, j;
+
+	if (!rle || !buf)
+		return SR_ERR_ARG;
+
+	out = buf;
+	for (i = 0; i < rle->num_runs; i++) {
+		value = (const uint8_t *)rle->values + i * rle->unitsize;
+		if (rle->unitsize == 1) {
+			memset(out, *value, rle->lengths[i]);
+			out += rle->lengths[i];
+			continue;
+		}
+		for (j = 0; j < rle->lengths[i]; j++) {
+			memcpy(out, value, rle->unitsize);
+			out += rle->unitsize;
+		}
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Free run-length encoded logic data.
+ *
+ * @param rle The data to free, as returned by sr_logic_rle_encode().
+ *            Can be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_logic_rle_free(struct sr_datafeed_logic_rle *rle)
+{
+	if (!rle)
+		return;
+
+	g_free(rle->values);
+	g_free(rle->lengths);
+	g_free(rle);
+}
+
+/** @} */
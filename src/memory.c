@@ -0,0 +1,409 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "memory"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Memory budget of a libsigrok context.
+ */
+
+/**
+ * @defgroup grp_memory Memory budget
+ *
+ * Memory budget of a libsigrok context.
+ *
+ * Modules which buffer an amount of data that is not bounded by the
+ * size of a packet (pre-trigger buffers, queues of output modules)
+ * charge their buffers against the budget of the context. When the
+ * budget is exhausted, they keep the data in temporary files instead.
+ * A long capture then gets slower rather than running out of memory.
+ *
+ * The budget is unlimited by default.
+ *
+ * @{
+ */
+
+/**
+ * A byte store which lives in memory while the budget allows, and in
+ * a temporary file otherwise.
+ */
+struct sr_spill {
+	struct sr_context *ctx;
+	/* The store's content when it is in memory, NULL otherwise. */
+	uint8_t *data;
+	/* Bytes allocated in memory, they are charged to the budget. */
+	size_t alloc_size;
+	/* The temporary file, created when the budget got exhausted. */
+	char *name;
+	FILE *file;
+	uint64_t file_size;
+};
+
+/**
+ * Set the memory budget of a context.
+ *
+ * The budget applies to buffers which get allocated after the call.
+ * Memory which already is in use stays where it is, even if it
+ * exceeds the new budget.
+ *
+ * @param ctx The context. Must not be NULL.
+ * @param bytes The number of bytes which buffers may use, 0 for no limit.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_memory_budget_set(struct sr_context *ctx, uint64_t bytes)
+{
+	if (!ctx)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&ctx->mem_mutex);
+	ctx->mem_budget = bytes;
+	g_mutex_unlock(&ctx->mem_mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Get the memory budget of a context, and how much of it is in use.
+ *
+ * @param ctx The context. Must not be NULL.
+ * @param bytes Pointer to store the budget at, 0 for no limit. Can be NULL.
+ * @param used Pointer to store the number of bytes in use at. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_memory_budget_get(struct sr_context *ctx,
+		uint64_t *bytes, uint64_t *used)
+{
+	if (!ctx)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&ctx->mem_mutex);
+	if (bytes)
+		*bytes = ctx->mem_budget;
+	if (used)
+		*used = ctx->mem_used;
+	g_mutex_unlock(&ctx->mem_mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Get the context a device's session lives in.
+ *
+ * @param sdi The device. Can be NULL.
+ *
+ * @return The context, or NULL if the device is not part of a session.
+ *
+ * @private
+ */
+SR_PRIV struct sr_context *sr_dev_inst_context(const struct sr_dev_inst *sdi)
+{
+	if (!sdi || !sdi->session)
+		return NULL;
+
+	return sdi->session->ctx;
+}
+
+/**
+ * Charge memory to the budget of a context.
+ *
+ * @param ctx The context. Without a context the budget is unlimited.
+ * @param size The number of bytes the caller is about to allocate.
+ *
+ * @return TRUE if the budget allows for the memory, which then is
+ *         charged. FALSE if the caller should do without it.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_mem_reserve(struct sr_context *ctx, size_t size)
+{
+	gboolean ok;
+
+	if (!ctx)
+		return TRUE;
+
+	g_mutex_lock(&ctx->mem_mutex);
+	ok = !ctx->mem_budget || (ctx->mem_used <= ctx->mem_budget
+		&& size <= ctx->mem_budget - ctx->mem_used);
+	if (ok)
+		ctx->mem_used += size;
+	g_mutex_unlock(&ctx->mem_mutex);
+
+	return ok;
+}
+
+/**
+ * Return memory to the budget of a context.
+ *
+ * @param ctx The context. Can be NULL.
+ * @param size The number of bytes which sr_mem_reserve() had charged.
+ *
+ * @private
+ */
+SR_PRIV void sr_mem_release(struct sr_context *ctx, size_t size)
+{
+	if (!ctx)
+		return;
+
+	g_mutex_lock(&ctx->mem_mutex);
+	ctx->mem_used -= MIN(size, ctx->mem_used);
+	g_mutex_unlock(&ctx->mem_mutex);
+}
+
+/* Move the content to a temporary file, release the memory. */
+static int spill_to_file(struct sr_spill *sp)
+{
+	GError *error;
+	int fd;
+
+	error = NULL;
+	fd = g_file_open_tmp("sigrok-XXXXXX", &sp->name, &error);
+	if (fd < 0) {
+		sr_err("Failed to create a temporary file: %s", error->message);
+		g_error_free(error);
+		return SR_ERR_IO;
+	}
+	sp->file = fdopen(fd, "w+b");
+	if (!sp->file) {
+		sr_err("Failed to open '%s': %s", sp->name, g_strerror(errno));
+		g_close(fd, NULL);
+		return SR_ERR_IO;
+	}
+	if (sp->alloc_size && fwrite(sp->data, 1, sp->alloc_size,
+			sp->file) != sp->alloc_size) {
+		sr_err("Failed to write '%s': %s", sp->name, g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	sr_dbg("Memory budget exhausted, using '%s'.", sp->name);
+	sp->file_size = sp->alloc_size;
+
+	g_free(sp->data);
+	sp->data = NULL;
+	sr_mem_release(sp->ctx, sp->alloc_size);
+	sp->alloc_size = 0;
+
+	return SR_OK;
+}
+
+static gboolean spill_seek(struct sr_spill *sp, uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(sp->file, offset, SEEK_SET) == 0;
+#else
+	return fseeko(sp->file, offset, SEEK_SET) == 0;
+#endif
+}
+
+/*
+ * Make the store hold at least @a size bytes while it is in memory.
+ * Stores which already have content double, so that appending costs
+ * few reallocations.
+ */
+static int spill_grow(struct sr_spill *sp, size_t size)
+{
+	size_t grow;
+	uint8_t *data;
+
+	if (!sp->file && size > sp->alloc_size) {
+		grow = MAX(size - sp->alloc_size, sp->alloc_size);
+		data = NULL;
+		if (sr_mem_reserve(sp->ctx, grow)) {
+			data = g_try_realloc(sp->data, sp->alloc_size + grow);
+			if (!data)
+				sr_mem_release(sp->ctx, grow);
+		}
+		if (!data)
+			return spill_to_file(sp);
+		memset(data + sp->alloc_size, 0, grow);
+		sp->data = data;
+		sp->alloc_size += grow;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Create a spill store.
+ *
+ * @param ctx The context whose budget the store is charged to. Can be NULL.
+ * @param size The number of bytes to allocate upfront, all of them zero.
+ *
+ * @return The new store, or NULL when no temporary file could be created.
+ *
+ * @private
+ */
+SR_PRIV struct sr_spill *sr_spill_new(struct sr_context *ctx, size_t size)
+{
+	struct sr_spill *sp;
+
+	sp = g_malloc0(sizeof(*sp));
+	sp->ctx = ctx;
+	if (size && spill_grow(sp, size) != SR_OK) {
+		sr_spill_free(sp);
+		return NULL;
+	}
+
+	return sp;
+}
+
+/**
+ * Release a spill store, and remove its temporary file.
+ *
+ * @param sp The store. Can be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_spill_free(struct sr_spill *sp)
+{
+	if (!sp)
+		return;
+
+	if (sp->file)
+		fclose(sp->file);
+	if (sp->name) {
+		g_unlink(sp->name);
+		g_free(sp->name);
+	}
+	g_free(sp->data);
+	sr_mem_release(sp->ctx, sp->alloc_size);
+	g_free(sp);
+}
+
+/**
+ * Get the content of a spill store which lives in memory.
+ *
+ * Callers can use the memory directly, this avoids copies through
+ * sr_spill_read(). The pointer is valid until the next write.
+ *
+ * @param sp The store. Must not be NULL.
+ *
+ * @return The content, or NULL if the store lives in a file.
+ *
+ * @private
+ */
+SR_PRIV uint8_t *sr_spill_data(struct sr_spill *sp)
+{
+	return sp->data;
+}
+
+/**
+ * Write to a spill store, the store grows as needed.
+ *
+ * @param sp The store. Must not be NULL.
+ * @param offset The position to write at.
+ * @param buf The data.
+ * @param len The number of bytes to write.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_IO The temporary file could not be written.
+ *
+ * @private
+ */
+SR_PRIV int sr_spill_write(struct sr_spill *sp, uint64_t offset,
+		const void *buf, size_t len)
+{
+	int ret;
+
+	if (!len)
+		return SR_OK;
+
+	if (!sp->file) {
+		if (offset + len <= G_MAXSIZE)
+			ret = spill_grow(sp, offset + len);
+		else
+			ret = spill_to_file(sp);
+		if (ret != SR_OK)
+			return ret;
+	}
+	if (sp->data) {
+		memcpy(sp->data + offset, buf, len);
+		return SR_OK;
+	}
+
+	if (!spill_seek(sp, offset) || fwrite(buf, 1, len, sp->file) != len) {
+		sr_err("Failed to write '%s': %s", sp->name, g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	sp->file_size = MAX(sp->file_size, offset + len);
+
+	return SR_OK;
+}
+
+/**
+ * Read from a spill store.
+ *
+ * Bytes which never got written read as zero.
+ *
+ * @param sp The store. Must not be NULL.
+ * @param offset The position to read from.
+ * @param buf The buffer to read into.
+ * @param len The number of bytes to read.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_IO The temporary file could not be read.
+ *
+ * @private
+ */
+SR_PRIV int sr_spill_read(struct sr_spill *sp, uint64_t offset,
+		void *buf, size_t len)
+{
+	size_t avail;
+
+	if (sp->data) {
+		avail = offset < sp->alloc_size ? sp->alloc_size - offset : 0;
+		avail = MIN(avail, len);
+		memcpy(buf, sp->data + offset, avail);
+	} else if (sp->file) {
+		avail = offset < sp->file_size ? sp->file_size - offset : 0;
+		avail = MIN(avail, len);
+		if (avail && (!spill_seek(sp, offset)
+				|| fread(buf, 1, avail, sp->file) != avail)) {
+			sr_err("Failed to read '%s': %s", sp->name,
+				g_strerror(errno));
+			return SR_ERR_IO;
+		}
+	} else {
+		avail = 0;
+	}
+	memset((uint8_t *)buf + avail, 0, len - avail);
+
+	return SR_OK;
+}
+
+/** @} */
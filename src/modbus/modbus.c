@@ -243,7 +243,8 @@ SR_PRIV int sr_modbus_request(struct sr_modbus_dev_inst *modbus,
  * @param reply Buffer to store the received Modbus reply.
  * @param reply_size The size of the reply buffer.
  *
- * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments, or
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments,
+ *         SR_ERR_NA when the request still waits for a shared bus, or
  *         SR_ERR on failure.
  */
 SR_PRIV int sr_modbus_reply(struct sr_modbus_dev_inst *modbus,
@@ -478,6 +479,302 @@ SR_PRIV int sr_modbus_read_holding_registers(struct sr_modbus_dev_inst *modbus,
 	return SR_OK;
 }
 
+/** @cond PRIVATE */
+/* Most registers which one read holding registers request can return. */
+#define MODBUS_MAX_READ_REGISTERS 125
+/** @endcond */
+
+struct modbus_batch_range {
+	int address;
+	int nb_registers;
+	uint16_t *registers;
+};
+
+struct modbus_batch_request {
+	int address;
+	int nb_registers;
+	/* Ranges of the batch which this request covers. */
+	guint first_range;
+	guint nb_ranges;
+};
+
+struct sr_modbus_batch {
+	struct sr_modbus_dev_inst *modbus;
+	int max_gap;
+	GArray *ranges;
+	GArray *requests;
+	/* Index of the next request to send, or to receive the reply of. */
+	guint next;
+	gboolean in_flight;
+	uint16_t buffer[MODBUS_MAX_READ_REGISTERS];
+};
+
+/**
+ * Create a batch of Modbus holding register reads.
+ *
+ * Callers add the register ranges which they are interested in, in any
+ * order. Before the first request gets sent, the ranges get sorted and
+ * coalesced into the fewest read holding registers requests of up to
+ * 125 registers each. Ranges which overlap or which are separated by at
+ * most max_gap unused registers share a request. Each register value
+ * gets copied to the caller's buffer in the same raw (big endian) form
+ * as sr_modbus_read_holding_registers() returns it.
+ *
+ * Only use a non-zero max_gap when the device accepts reads of the
+ * registers in between, some devices reply with an exception for
+ * unmapped addresses.
+ *
+ * @param modbus Previously initialized Modbus device structure.
+ * @param max_gap The number of unused registers which may get read to
+ *                merge two ranges into one request.
+ *
+ * @return The new batch, release it with sr_modbus_batch_free().
+ */
+SR_PRIV struct sr_modbus_batch *sr_modbus_batch_new(
+		struct sr_modbus_dev_inst *modbus, int max_gap)
+{
+	struct sr_modbus_batch *batch;
+
+	batch = g_malloc0(sizeof(*batch));
+	batch->modbus = modbus;
+	batch->max_gap = MAX(max_gap, 0);
+	batch->ranges = g_array_new(FALSE, FALSE,
+		sizeof(struct modbus_batch_range));
+	batch->requests = g_array_new(FALSE, FALSE,
+		sizeof(struct modbus_batch_request));
+
+	return batch;
+}
+
+/**
+ * Free a batch of Modbus holding register reads.
+ *
+ * @param batch The batch to free. Can be NULL.
+ */
+SR_PRIV void sr_modbus_batch_free(struct sr_modbus_batch *batch)
+{
+	if (!batch)
+		return;
+
+	g_array_free(batch->ranges, TRUE);
+	g_array_free(batch->requests, TRUE);
+	g_free(batch);
+}
+
+/**
+ * Add a range of holding registers to a batch.
+ *
+ * Ranges can only get added before the batch is sent.
+ *
+ * @param batch The batch.
+ * @param address The Modbus address of the first register of the range.
+ * @param nb_registers The number of registers in the range, at most 125.
+ * @param registers Buffer which receives the registers' values, it must
+ *                  stay valid until the batch was received.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments.
+ */
+SR_PRIV int sr_modbus_batch_add(struct sr_modbus_batch *batch,
+		int address, int nb_registers, uint16_t *registers)
+{
+	struct modbus_batch_range range;
+
+	if (!batch || !registers || batch->requests->len)
+		return SR_ERR_ARG;
+	if (address < 0 || nb_registers < 1
+	    || nb_registers > MODBUS_MAX_READ_REGISTERS
+	    || address + nb_registers > 0x10000)
+		return SR_ERR_ARG;
+
+	range.address = address;
+	range.nb_registers = nb_registers;
+	range.registers = registers;
+	g_array_append_val(batch->ranges, range);
+
+	return SR_OK;
+}
+
+static gint batch_range_cmp(gconstpointer a, gconstpointer b)
+{
+	const struct modbus_batch_range *ra, *rb;
+
+	ra = a;
+	rb = b;
+	if (ra->address != rb->address)
+		return ra->address < rb->address ? -1 : 1;
+
+	return ra->nb_registers - rb->nb_registers;
+}
+
+/* Sort the ranges, and merge them into as few requests as possible. */
+static void batch_plan(struct sr_modbus_batch *batch)
+{
+	struct modbus_batch_range *range;
+	struct modbus_batch_request req;
+	int end, range_end;
+	guint i;
+
+	g_array_sort(batch->ranges, batch_range_cmp);
+
+	memset(&req, 0, sizeof(req));
+	end = 0;
+	for (i = 0; i < batch->ranges->len; i++) {
+		range = &g_array_index(batch->ranges, struct modbus_batch_range, i);
+		range_end = range->address + range->nb_registers;
+		if (i > 0 && range->address <= end + batch->max_gap
+		    && MAX(end, range_end) - req.address <= MODBUS_MAX_READ_REGISTERS) {
+			end = MAX(end, range_end);
+			req.nb_registers = end - req.address;
+			req.nb_ranges++;
+			continue;
+		}
+		if (i > 0)
+			g_array_append_val(batch->requests, req);
+		req.address = range->address;
+		req.nb_registers = range->nb_registers;
+		req.first_range = i;
+		req.nb_ranges = 1;
+		end = range_end;
+	}
+	if (batch->ranges->len)
+		g_array_append_val(batch->requests, req);
+
+	sr_spew("Batch of %u register ranges takes %u requests.",
+		batch->ranges->len, batch->requests->len);
+}
+
+/**
+ * Send the next read request of a batch.
+ *
+ * This is the asynchronous part of sr_modbus_batch_run(), the caller
+ * is free to do other work, like serving another device, until it gets
+ * the reply with sr_modbus_batch_receive(). Other requests must not be
+ * sent to the device meanwhile.
+ *
+ * @param batch The batch.
+ *
+ * @retval SR_OK A request was sent.
+ * @retval SR_ERR_NA All the requests of the batch were sent already.
+ * @retval SR_ERR_ARG The reply to a previous request is outstanding.
+ * @retval SR_ERR Sending failed.
+ */
+SR_PRIV int sr_modbus_batch_send(struct sr_modbus_batch *batch)
+{
+	struct modbus_batch_request *req;
+	int ret;
+
+	if (!batch || batch->in_flight)
+		return SR_ERR_ARG;
+
+	if (!batch->requests->len)
+		batch_plan(batch);
+	if (batch->next >= batch->requests->len)
+		return SR_ERR_NA;
+
+	req = &g_array_index(batch->requests, struct modbus_batch_request,
+		batch->next);
+	ret = sr_modbus_read_holding_registers(batch->modbus,
+		req->address, req->nb_registers, NULL);
+	if (ret != SR_OK)
+		return SR_ERR;
+	batch->in_flight = TRUE;
+
+	return SR_OK;
+}
+
+/**
+ * Receive the reply to the request of a batch which was sent last, and
+ * distribute the registers' values to the ranges which it covers.
+ *
+ * @param batch The batch.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG when no request awaits its
+ *         reply, SR_ERR_NA when the request still waits for a shared bus
+ *         and the caller should try again later, SR_ERR_DATA upon invalid
+ *         data, or SR_ERR on failure.
+ */
+SR_PRIV int sr_modbus_batch_receive(struct sr_modbus_batch *batch)
+{
+	struct modbus_batch_request *req;
+	struct modbus_batch_range *range;
+	guint i;
+	int ret;
+
+	if (!batch || !batch->in_flight)
+		return SR_ERR_ARG;
+
+	req = &g_array_index(batch->requests, struct modbus_batch_request,
+		batch->next);
+	ret = sr_modbus_read_holding_registers(batch->modbus,
+		-1, req->nb_registers, batch->buffer);
+	if (ret == SR_ERR_NA)
+		return ret;
+	batch->in_flight = FALSE;
+	batch->next++;
+	if (ret != SR_OK)
+		return ret;
+
+	for (i = req->first_range; i < req->first_range + req->nb_ranges; i++) {
+		range = &g_array_index(batch->ranges, struct modbus_batch_range, i);
+		memcpy(range->registers,
+			&batch->buffer[range->address - req->address],
+			2 * range->nb_registers);
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Read all the register ranges of a batch.
+ *
+ * The requests get issued back to back, each one as soon as the reply
+ * to the previous one was received.
+ *
+ * @param batch The batch.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG upon invalid arguments,
+ *         SR_ERR_TIMEOUT when another device holds a shared bus,
+ *         SR_ERR_DATA upon invalid data, or SR_ERR on failure.
+ */
+SR_PRIV int sr_modbus_batch_run(struct sr_modbus_batch *batch)
+{
+	int ret;
+
+	while ((ret = sr_modbus_batch_send(batch)) == SR_OK) {
+		ret = sr_modbus_batch_receive(batch);
+		if (ret == SR_ERR_NA) {
+			/* No waiting for a busy bus, a new request replaces it. */
+			batch->in_flight = FALSE;
+			return SR_ERR_TIMEOUT;
+		}
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	return ret == SR_ERR_NA ? SR_OK : ret;
+}
+
+/**
+ * Rewind a batch, so that its requests get sent once more.
+ *
+ * The ranges and the requests which they were coalesced into are kept,
+ * this is how drivers poll the same registers over and over again.
+ *
+ * @param batch The batch.
+ *
+ * @return SR_OK upon success, SR_ERR_ARG when the reply to a request
+ *         is outstanding.
+ */
+SR_PRIV int sr_modbus_batch_rewind(struct sr_modbus_batch *batch)
+{
+	if (!batch || batch->in_flight)
+		return SR_ERR_ARG;
+
+	batch->next = 0;
+
+	return SR_OK;
+}
+
 /**
  * Send a Modbus write coil command.
  *
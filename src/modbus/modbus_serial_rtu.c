@@ -30,12 +30,205 @@
 
 #define BUFFER_SIZE 1024
 
+/* Time after which an unanswered request no longer blocks the bus. */
+#define BUS_REPLY_TIMEOUT_MS 1000
+
+/*
+ * Several slaves on one RS-485 bus share the serial port. The first
+ * device instance which gets opened opens the port, the others take a
+ * reference. A request gets the bus until its reply got received or
+ * timed out. Requests which find the bus busy get queued, first come
+ * first served, and go out when the bus gets released. Sending never
+ * waits for the bus, that would stall the session's main loop.
+ */
+struct modbus_rtu_bus {
+	char *port;
+	struct sr_serial_dev_inst *serial;
+	int refcount;
+	GMutex mutex;
+	/* Devices with a queued request, first come first served. */
+	GQueue waiters;
+	/* Device which awaits the reply to its request, and until when. */
+	void *owner;
+	gint64 owner_deadline;
+	/* End of the last frame on the bus, and the interframe delay. */
+	gint64 last_frame;
+	gint64 frame_gap_us;
+};
+
+static GSList *buses;
+G_LOCK_DEFINE_STATIC(buses);
+
 struct modbus_serial_rtu {
+	char *port;
+	char *serialcomm;
+	struct modbus_rtu_bus *bus;
 	struct sr_serial_dev_inst *serial;
 	uint8_t slave_addr;
 	uint16_t crc;
+	gboolean timer_source;
+	/* Frame of a request which waits for the bus. */
+	uint8_t *pending;
+	size_t pending_size;
 };
 
+/*
+ * RTU frames are separated by at least 3.5 character times of silence,
+ * or 1.75ms at bitrates above 19200.
+ */
+static gint64 bus_frame_gap_us(const struct sr_serial_dev_inst *serial)
+{
+	int bitrate;
+
+	bitrate = serial->comm_params.bit_rate;
+	if (bitrate <= 0 || bitrate > 19200)
+		return 1750;
+
+	return (gint64)35 * 11 * 100000 / bitrate;
+}
+
+static struct modbus_rtu_bus *bus_get(const char *port, const char *serialcomm)
+{
+	struct modbus_rtu_bus *bus;
+	GSList *l;
+
+	G_LOCK(buses);
+	for (l = buses; l; l = l->next) {
+		bus = l->data;
+		if (strcmp(bus->port, port) != 0)
+			continue;
+		if (serialcomm && g_strcmp0(bus->serial->serialcomm, serialcomm)) {
+			sr_err("Bus %s is open with serialcomm %s, not %s.",
+				port, bus->serial->serialcomm, serialcomm);
+			G_UNLOCK(buses);
+			return NULL;
+		}
+		bus->refcount++;
+		G_UNLOCK(buses);
+		sr_dbg("Sharing bus %s, %d devices.", port, bus->refcount);
+		return bus;
+	}
+
+	bus = g_malloc0(sizeof(*bus));
+	bus->serial = sr_serial_dev_inst_new(port, serialcomm);
+	if (serial_open(bus->serial, SERIAL_RDWR) != SR_OK) {
+		G_UNLOCK(buses);
+		sr_serial_dev_inst_free(bus->serial);
+		g_free(bus);
+		return NULL;
+	}
+	bus->port = g_strdup(port);
+	bus->refcount = 1;
+	g_mutex_init(&bus->mutex);
+	g_queue_init(&bus->waiters);
+	bus->frame_gap_us = bus_frame_gap_us(bus->serial);
+	buses = g_slist_prepend(buses, bus);
+	G_UNLOCK(buses);
+
+	return bus;
+}
+
+static int bus_put(struct modbus_rtu_bus *bus)
+{
+	int ret;
+
+	G_LOCK(buses);
+	if (--bus->refcount > 0) {
+		G_UNLOCK(buses);
+		return SR_OK;
+	}
+	buses = g_slist_remove(buses, bus);
+	G_UNLOCK(buses);
+
+	ret = serial_close(bus->serial);
+	sr_serial_dev_inst_free(bus->serial);
+	g_queue_clear(&bus->waiters);
+	g_mutex_clear(&bus->mutex);
+	g_free(bus->port);
+	g_free(bus);
+
+	return ret;
+}
+
+/* Put a request on the wire, the bus is free. Called with the bus locked. */
+static int bus_transmit(struct modbus_serial_rtu *modbus,
+		const uint8_t *frame, size_t frame_size)
+{
+	struct modbus_rtu_bus *bus;
+	gint64 delay;
+
+	bus = modbus->bus;
+
+	delay = bus->last_frame + bus->frame_gap_us - g_get_monotonic_time();
+	if (delay > 0)
+		g_usleep(delay);
+	if (serial_write_blocking(bus->serial, frame, frame_size, 0) < 0)
+		return SR_ERR;
+
+	bus->owner = modbus;
+	bus->owner_deadline = g_get_monotonic_time()
+		+ BUS_REPLY_TIMEOUT_MS * 1000;
+
+	return SR_OK;
+}
+
+/*
+ * Release the bus from an unanswered request which timed out, and
+ * discard its late reply. Called with the bus locked.
+ */
+static void bus_expire(struct modbus_rtu_bus *bus)
+{
+	if (!bus->owner || g_get_monotonic_time() < bus->owner_deadline)
+		return;
+
+	sr_warn("No reply from slave %d, releasing the bus.",
+		((struct modbus_serial_rtu *)bus->owner)->slave_addr);
+	bus->owner = NULL;
+	serial_flush(bus->serial);
+}
+
+/* Send queued requests while the bus is free. Called with the bus locked. */
+static void bus_next(struct modbus_rtu_bus *bus)
+{
+	struct modbus_serial_rtu *modbus;
+	int ret;
+
+	while (!bus->owner && (modbus = g_queue_pop_head(&bus->waiters))) {
+		ret = bus_transmit(modbus, modbus->pending, modbus->pending_size);
+		if (ret != SR_OK)
+			sr_err("Failed to send the queued request to slave %d.",
+				modbus->slave_addr);
+		g_free(modbus->pending);
+		modbus->pending = NULL;
+	}
+}
+
+/* Withdraw a request which still waits for the bus. Called with the bus locked. */
+static void bus_withdraw(struct modbus_serial_rtu *modbus)
+{
+	if (!modbus->pending)
+		return;
+
+	g_queue_remove(&modbus->bus->waiters, modbus);
+	g_free(modbus->pending);
+	modbus->pending = NULL;
+}
+
+static void bus_release(struct modbus_serial_rtu *modbus)
+{
+	struct modbus_rtu_bus *bus;
+
+	bus = modbus->bus;
+
+	g_mutex_lock(&bus->mutex);
+	if (bus->owner == modbus) {
+		bus->owner = NULL;
+		bus->last_frame = g_get_monotonic_time();
+		bus_next(bus);
+	}
+	g_mutex_unlock(&bus->mutex);
+}
+
 static int modbus_serial_rtu_dev_inst_new(void *priv, const char *resource,
 		char **params, const char *serialcomm, int modbusaddr)
 {
@@ -43,7 +236,8 @@ static int modbus_serial_rtu_dev_inst_new(void *priv, const char *resource,
 
 	(void)params;
 
-	modbus->serial = sr_serial_dev_inst_new(resource, serialcomm);
+	modbus->port = g_strdup(resource);
+	modbus->serialcomm = g_strdup(serialcomm);
 	modbus->slave_addr = modbusaddr;
 
 	return SR_OK;
@@ -52,10 +246,14 @@ static int modbus_serial_rtu_dev_inst_new(void *priv, const char *resource,
 static int modbus_serial_rtu_open(void *priv)
 {
 	struct modbus_serial_rtu *modbus = priv;
-	struct sr_serial_dev_inst *serial = modbus->serial;
 
-	if (serial_open(serial, SERIAL_RDWR) != SR_OK)
+	if (modbus->bus)
+		return SR_OK;
+
+	modbus->bus = bus_get(modbus->port, modbus->serialcomm);
+	if (!modbus->bus)
 		return SR_ERR;
+	modbus->serial = modbus->bus->serial;
 
 	return SR_OK;
 }
@@ -66,6 +264,15 @@ static int modbus_serial_rtu_source_add(struct sr_session *session, void *priv,
 	struct modbus_serial_rtu *modbus = priv;
 	struct sr_serial_dev_inst *serial = modbus->serial;
 
+	/*
+	 * Input on a shared bus can be meant for any of its devices,
+	 * each of them polls for its replies with a timer instead.
+	 */
+	modbus->timer_source = modbus->bus->refcount > 1;
+	if (modbus->timer_source)
+		return sr_session_fd_source_add(session, modbus, -1, 0,
+			timeout > 0 ? timeout : 10, cb, cb_data);
+
 	return serial_source_add(session, serial, events, timeout, cb, cb_data);
 }
 
@@ -75,49 +282,90 @@ static int modbus_serial_rtu_source_remove(struct sr_session *session,
 	struct modbus_serial_rtu *modbus = priv;
 	struct sr_serial_dev_inst *serial = modbus->serial;
 
+	if (modbus->timer_source)
+		return sr_session_source_remove_internal(session, modbus);
+
 	return serial_source_remove(session, serial);
 }
 
+/*
+ * Send a request, or queue it while another slave's request has the
+ * bus. On a shared bus, reading the reply to a queued request returns
+ * SR_ERR_NA until the request went out, see below.
+ */
 static int modbus_serial_rtu_send(void *priv,
 		const uint8_t *buffer, int buffer_size)
 {
-	int result;
 	struct modbus_serial_rtu *modbus = priv;
-	struct sr_serial_dev_inst *serial = modbus->serial;
-	uint8_t slave_addr = modbus->slave_addr;
+	struct modbus_rtu_bus *bus = modbus->bus;
+	uint8_t *frame;
+	size_t frame_size;
 	uint16_t crc;
+	int ret;
 
-	result = serial_write_blocking(serial, &slave_addr, sizeof(slave_addr), 0);
-	if (result < 0)
-		return SR_ERR;
-
-	result = serial_write_blocking(serial, buffer, buffer_size, 0);
-	if (result < 0)
-		return SR_ERR;
-
-	crc = sr_crc16(SR_CRC16_DEFAULT_INIT, &slave_addr, sizeof(slave_addr));
-	crc = sr_crc16(crc, buffer, buffer_size);
-
-	result = serial_write_blocking(serial, &crc, sizeof(crc), 0);
-	if (result < 0)
-		return SR_ERR;
+	frame_size = 1 + buffer_size + sizeof(crc);
+	frame = g_malloc(frame_size);
+	frame[0] = modbus->slave_addr;
+	memcpy(frame + 1, buffer, buffer_size);
+	crc = sr_crc16(SR_CRC16_DEFAULT_INIT, frame, 1 + buffer_size);
+	memcpy(frame + 1 + buffer_size, &crc, sizeof(crc));
+
+	g_mutex_lock(&bus->mutex);
+	bus_expire(bus);
+	/* A new request replaces one which still waits for the bus. */
+	bus_withdraw(modbus);
+	if (bus->owner && bus->owner != modbus) {
+		sr_spew("Bus busy, queueing the request to slave %d.",
+			modbus->slave_addr);
+		modbus->pending = frame;
+		modbus->pending_size = frame_size;
+		g_queue_push_tail(&bus->waiters, modbus);
+		g_mutex_unlock(&bus->mutex);
+		return SR_OK;
+	}
+	/* The reply to a previous request of the device is stale now. */
+	if (bus->owner == modbus)
+		serial_flush(bus->serial);
+	ret = bus_transmit(modbus, frame, frame_size);
+	g_mutex_unlock(&bus->mutex);
+	g_free(frame);
 
-	return SR_OK;
+	return ret;
 }
 
 static int modbus_serial_rtu_read_begin(void *priv, uint8_t *function_code)
 {
 	struct modbus_serial_rtu *modbus = priv;
+	struct modbus_rtu_bus *bus = modbus->bus;
+	gboolean queued, owned;
 	uint8_t slave_addr;
 	int ret;
 
+	g_mutex_lock(&bus->mutex);
+	bus_expire(bus);
+	bus_next(bus);
+	queued = modbus->pending != NULL;
+	owned = bus->owner == modbus;
+	g_mutex_unlock(&bus->mutex);
+
+	if (queued)
+		return SR_ERR_NA;
+	if (!owned) {
+		sr_err("Request to slave %d was dropped.", modbus->slave_addr);
+		return SR_ERR;
+	}
+
 	ret = serial_read_blocking(modbus->serial, &slave_addr, 1, 500);
-	if (ret != 1 || slave_addr != modbus->slave_addr)
+	if (ret != 1 || slave_addr != modbus->slave_addr) {
+		bus_release(modbus);
 		return SR_ERR;
+	}
 
 	ret = serial_read_blocking(modbus->serial, function_code, 1, 100);
-	if (ret != 1)
+	if (ret != 1) {
+		bus_release(modbus);
 		return SR_ERR;
+	}
 
 	modbus->crc = sr_crc16(SR_CRC16_DEFAULT_INIT, &slave_addr, sizeof(slave_addr));
 	modbus->crc = sr_crc16(modbus->crc, function_code, 1);
@@ -144,6 +392,7 @@ static int modbus_serial_rtu_read_end(void *priv)
 	int ret;
 
 	ret = serial_read_blocking(modbus->serial, &crc, sizeof(crc), 100);
+	bus_release(modbus);
 	if (ret != 2)
 		return SR_ERR;
 
@@ -158,15 +407,30 @@ static int modbus_serial_rtu_read_end(void *priv)
 static int modbus_serial_rtu_close(void *priv)
 {
 	struct modbus_serial_rtu *modbus = priv;
+	struct modbus_rtu_bus *bus;
+
+	bus = modbus->bus;
+	if (!bus)
+		return SR_OK;
+
+	g_mutex_lock(&bus->mutex);
+	bus_withdraw(modbus);
+	g_mutex_unlock(&bus->mutex);
+	bus_release(modbus);
+	modbus->bus = NULL;
+	modbus->serial = NULL;
 
-	return serial_close(modbus->serial);
+	return bus_put(bus);
 }
 
 static void modbus_serial_rtu_free(void *priv)
 {
 	struct modbus_serial_rtu *modbus = priv;
 
-	sr_serial_dev_inst_free(modbus->serial);
+	if (modbus->bus)
+		modbus_serial_rtu_close(modbus);
+	g_free(modbus->port);
+	g_free(modbus->serialcomm);
 }
 
 SR_PRIV const struct sr_modbus_dev_inst modbus_serial_rtu_dev = {
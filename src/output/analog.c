@@ -34,6 +34,15 @@ struct context {
 	GPtrArray *channellist;
 	int digits;
 	float *fdata;
+	struct channel_prefix *prefixes;
+	size_t prefixes_size;
+};
+
+/* The SI prefix of a channel's values in the current packet. */
+struct channel_prefix {
+	const char *prefix;
+	float scale;
+	int digits;
 };
 
 enum {
@@ -72,6 +81,84 @@ static int init(struct sr_output *o, GHashTable *options)
 	return SR_OK;
 }
 
+/*
+ * Pick one SI prefix per channel and packet, the one which suits the
+ * channel's largest value. All values of the channel then get scaled
+ * alike, at the same absolute resolution.
+ */
+static void prefixes_select(struct channel_prefix *prefixes,
+		const float *fdata, unsigned int num_samples, int num_channels,
+		int digits, gboolean si_friendly)
+{
+	struct channel_prefix *cp;
+	float max, value;
+	unsigned int i;
+	int c;
+
+	for (c = 0; c < num_channels; c++) {
+		cp = &prefixes[c];
+		cp->prefix = "";
+		cp->scale = 1;
+		cp->digits = digits;
+		if (!si_friendly)
+			continue;
+		max = NAN;
+		for (i = 0; i < num_samples; i++) {
+			value = fabsf(fdata[i * num_channels + c]);
+			if (!isnan(value) && !(value <= max))
+				max = value;
+		}
+		cp->prefix = sr_analog_si_prefix(&max, &cp->digits);
+		cp->scale = powf(10, digits - cp->digits);
+	}
+}
+
+/*
+ * Append a value in the "%.*f" format, with an ASCII decimal point.
+ * Values with an unambiguous rounding get converted here, everything
+ * else takes the generic path.
+ */
+static void append_fixed(GString *s, float value, int digits)
+{
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+	};
+	char buf[64], fmt[8], *p, *end;
+	double v, scaled, frac;
+	uint64_t num;
+	int i;
+
+	v = value;
+	if (digits >= (int)G_N_ELEMENTS(pow10) || !isfinite(v))
+		goto fallback;
+	scaled = fabs(v) * pow10[digits];
+	if (scaled >= 1e15)
+		goto fallback;
+	frac = scaled - floor(scaled);
+	if (fabs(frac - 0.5) < 1e-6)
+		goto fallback;
+	num = (uint64_t)floor(scaled) + (frac > 0.5);
+
+	/* Print the digits backwards, at least one before the dot. */
+	end = &buf[sizeof(buf)];
+	p = end;
+	for (i = 0; i <= digits || num; i++) {
+		if (i == digits && digits)
+			*--p = '.';
+		*--p = '0' + num % 10;
+		num /= 10;
+	}
+	if (signbit(v))
+		*--p = '-';
+	g_string_append_len(s, p, end - p);
+	return;
+
+fallback:
+	g_snprintf(fmt, sizeof(fmt), "%%.%df", digits);
+	g_ascii_formatd(buf, sizeof(buf), fmt, v);
+	g_string_append(s, buf);
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
 		GString **out)
 {
@@ -81,11 +168,13 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_config *src;
 	const struct sr_key_info *srci;
 	struct sr_channel *ch;
+	struct channel_prefix *cp;
 	GSList *l;
 	float *fdata;
 	unsigned int i;
-	int num_channels, c, ret, digits, actual_digits;
-	char *number, *suffix;
+	int num_channels, c, ret, digits;
+	gboolean si_friendly;
+	char *suffix;
 
 	*out = NULL;
 	if (!o || !o->sdi)
@@ -134,6 +223,12 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		ctx->fdata = fdata;
 		if ((ret = sr_analog_to_float(analog, fdata)) != SR_OK)
 			return ret;
+		if (ctx->prefixes_size < (size_t)num_channels) {
+			g_free(ctx->prefixes);
+			ctx->prefixes = g_malloc_n(num_channels,
+				sizeof(*ctx->prefixes));
+			ctx->prefixes_size = num_channels;
+		}
 		*out = g_string_sized_new(512);
 		if (ctx->digits == DIGITS_ALL)
 			digits = analog->encoding->digits;
@@ -141,24 +236,22 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			digits = analog->spec->spec_digits;
 		if (!analog->encoding->is_digits_decimal)
 			digits = copysign(ceil(abs(digits) * BIN_TO_DEC_DIGITS), digits);
-		gboolean si_friendly = sr_analog_si_prefix_friendly(analog->meaning->unit);
+		si_friendly = sr_analog_si_prefix_friendly(analog->meaning->unit);
+		prefixes_select(ctx->prefixes, fdata, analog->num_samples,
+			num_channels, digits, si_friendly);
 		sr_analog_unit_to_string(analog, &suffix);
 		for (i = 0; i < analog->num_samples; i++) {
 			for (l = analog->meaning->channels, c = 0; l; l = l->next, c++) {
-				float value = fdata[i * num_channels + c];
-				const char *prefix = "";
-				actual_digits = digits;
-				if (si_friendly)
-					prefix = sr_analog_si_prefix(&value, &actual_digits);
 				ch = l->data;
-				g_string_append_printf(*out, "%s: ", ch->name);
-				number = g_strdup_printf("%.*f", MAX(actual_digits, 0), value);
-				g_string_append(*out, number);
-				g_free(number);
-				g_string_append(*out, " ");
-				g_string_append(*out, prefix);
+				cp = &ctx->prefixes[c];
+				g_string_append(*out, ch->name);
+				g_string_append(*out, ": ");
+				append_fixed(*out, fdata[i * num_channels + c] * cp->scale,
+					MAX(cp->digits, 0));
+				g_string_append_c(*out, ' ');
+				g_string_append(*out, cp->prefix);
 				g_string_append(*out, suffix);
-				g_string_append(*out, "\n");
+				g_string_append_c(*out, '\n');
 			}
 		}
 		g_free(suffix);
@@ -204,6 +297,7 @@ static int cleanup(struct sr_output *o)
 		options[0].values = NULL;
 	}
 	g_free(ctx->fdata);
+	g_free(ctx->prefixes);
 	g_free(ctx);
 	o->priv = NULL;
 
@@ -0,0 +1,664 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Apache Arrow output, as an IPC stream or (when available) a Parquet file.
+ *
+ * Every analog channel becomes a float32 column. Logic data becomes
+ * either one unsigned integer column "logic" holding the packed samples,
+ * or one boolean (bit packed) column per logic channel. Samples are
+ * collected into record batches of "batch_size" rows. Columns which
+ * received fewer samples at the end of the capture are padded with nulls.
+ * The samplerate is stored in the schema metadata.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <arrow-glib/arrow-glib.h>
+#ifdef HAVE_LIBPARQUET_GLIB
+#include <parquet-glib/parquet-glib.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/arrow"
+
+#define DEFAULT_BATCH_SIZE (64 * 1024)
+
+enum column_type {
+	COLUMN_LOGIC,
+	COLUMN_BIT,
+	COLUMN_ANALOG,
+};
+
+struct column {
+	enum column_type type;
+	char *name;
+	/* Bit position of a COLUMN_BIT column. */
+	int bit;
+	/* The analog channel of a COLUMN_ANALOG column. */
+	struct sr_channel *ch;
+	/* Values which were received but not written yet. */
+	GArray *values;
+};
+
+struct context {
+	gboolean parquet;
+	uint64_t samplerate;
+	uint64_t batch_size;
+	/* Bytes per value of the COLUMN_LOGIC column. */
+	size_t logic_size;
+	size_t num_columns;
+	struct column *columns;
+	gboolean *is_valids;
+	GArrowSchema *schema;
+	GArrowOutputStream *stream;
+	GArrowRecordBatchWriter *writer;
+#ifdef HAVE_LIBPARQUET_GLIB
+	GParquetArrowFileWriter *pq_writer;
+#endif
+	gboolean failed;
+};
+
+static int check_error(GError *error, const char *what)
+{
+	if (!error)
+		return SR_OK;
+	sr_err("Cannot %s: %s.", what, error->message);
+	g_error_free(error);
+
+	return SR_ERR_IO;
+}
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	struct column *col;
+	GVariant *gvar;
+	GSList *l;
+	const char *format, *logic;
+	size_t num_logic, num_analog, logic_size, i;
+
+	if (!o->filename || o->filename[0] == '\0') {
+		sr_info("arrow output module requires a file name, cannot save.");
+		return SR_ERR_ARG;
+	}
+
+	format = g_variant_get_string(g_hash_table_lookup(options, "format"), NULL);
+	logic = g_variant_get_string(g_hash_table_lookup(options, "logic"), NULL);
+
+	num_logic = num_analog = logic_size = 0;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!ch->enabled)
+			continue;
+		if (ch->type == SR_CHANNEL_LOGIC) {
+			num_logic++;
+			logic_size = MAX(logic_size, (size_t)ch->index / 8 + 1);
+		} else if (ch->type == SR_CHANNEL_ANALOG) {
+			num_analog++;
+		}
+	}
+	/* Round up to the next unsigned integer type. */
+	if (logic_size > 4)
+		logic_size = 8;
+	else if (logic_size > 2)
+		logic_size = 4;
+	if (logic_size > 8 && !strcmp(logic, "uint")) {
+		sr_err("Too many logic channels for a uint column, use 'bits'.");
+		return SR_ERR_ARG;
+	}
+
+	ctx = g_malloc0(sizeof(*ctx));
+	o->priv = ctx;
+	ctx->parquet = !strcmp(format, "parquet");
+	ctx->batch_size = g_variant_get_uint64(
+		g_hash_table_lookup(options, "batch_size"));
+	if (!ctx->batch_size)
+		ctx->batch_size = DEFAULT_BATCH_SIZE;
+	ctx->logic_size = logic_size;
+
+	if (!strcmp(logic, "uint"))
+		ctx->num_columns = (num_logic ? 1 : 0) + num_analog;
+	else
+		ctx->num_columns = num_logic + num_analog;
+	ctx->columns = g_malloc0(sizeof(ctx->columns[0]) * MAX(ctx->num_columns, 1));
+	ctx->is_valids = g_malloc(sizeof(gboolean) * ctx->batch_size);
+
+	col = ctx->columns;
+	if (num_logic && !strcmp(logic, "uint")) {
+		col->type = COLUMN_LOGIC;
+		col->name = g_strdup("logic");
+		col->values = g_array_sized_new(FALSE, TRUE, logic_size, ctx->batch_size);
+		col++;
+	}
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!ch->enabled)
+			continue;
+		if (ch->type == SR_CHANNEL_LOGIC && !strcmp(logic, "bits")) {
+			col->type = COLUMN_BIT;
+			col->bit = ch->index;
+			col->values = g_array_sized_new(FALSE, TRUE,
+				sizeof(gboolean), ctx->batch_size);
+		} else if (ch->type == SR_CHANNEL_ANALOG) {
+			col->type = COLUMN_ANALOG;
+			col->ch = ch;
+			col->values = g_array_sized_new(FALSE, TRUE,
+				sizeof(gfloat), ctx->batch_size);
+		} else {
+			continue;
+		}
+		col->name = g_strdup(ch->name);
+		col++;
+	}
+	for (i = 0; i < ctx->batch_size; i++)
+		ctx->is_valids[i] = TRUE;
+
+	if (sr_config_get(o->sdi->driver, o->sdi, NULL, SR_CONF_SAMPLERATE,
+			&gvar) == SR_OK) {
+		ctx->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+
+	return SR_OK;
+}
+
+static GArrowDataType *column_data_type(const struct context *ctx,
+	const struct column *col)
+{
+	if (col->type == COLUMN_ANALOG)
+		return GARROW_DATA_TYPE(garrow_float_data_type_new());
+	if (col->type == COLUMN_BIT)
+		return GARROW_DATA_TYPE(garrow_boolean_data_type_new());
+
+	switch (ctx->logic_size) {
+	case 1:
+		return GARROW_DATA_TYPE(garrow_uint8_data_type_new());
+	case 2:
+		return GARROW_DATA_TYPE(garrow_uint16_data_type_new());
+	case 4:
+		return GARROW_DATA_TYPE(garrow_uint32_data_type_new());
+	default:
+		return GARROW_DATA_TYPE(garrow_uint64_data_type_new());
+	}
+}
+
+/* Create the schema and the writer, once the samplerate is known. */
+static int open_writer(const struct sr_output *o)
+{
+	struct context *ctx;
+	GArrowDataType *type;
+	GArrowSchema *schema;
+	GHashTable *metadata;
+	GList *fields;
+	GError *error;
+	size_t i;
+	char *rate;
+
+	ctx = o->priv;
+
+	fields = NULL;
+	for (i = 0; i < ctx->num_columns; i++) {
+		type = column_data_type(ctx, &ctx->columns[i]);
+		fields = g_list_append(fields,
+			garrow_field_new(ctx->columns[i].name, type));
+		g_object_unref(type);
+	}
+	schema = garrow_schema_new(fields);
+	g_list_free_full(fields, g_object_unref);
+
+	metadata = g_hash_table_new(g_str_hash, g_str_equal);
+	rate = g_strdup_printf("%" PRIu64, ctx->samplerate);
+	g_hash_table_insert(metadata, "samplerate", rate);
+	ctx->schema = garrow_schema_with_metadata(schema, metadata);
+	g_hash_table_destroy(metadata);
+	g_free(rate);
+	g_object_unref(schema);
+
+	error = NULL;
+#ifdef HAVE_LIBPARQUET_GLIB
+	if (ctx->parquet) {
+		ctx->pq_writer = gparquet_arrow_file_writer_new_path(ctx->schema,
+			o->filename, NULL, &error);
+		return check_error(error, "create the Parquet file");
+	}
+#endif
+	ctx->stream = GARROW_OUTPUT_STREAM(garrow_file_output_stream_new(
+		o->filename, FALSE, &error));
+	if (check_error(error, "create the output file") != SR_OK)
+		return SR_ERR_IO;
+	ctx->writer = GARROW_RECORD_BATCH_WRITER(
+		garrow_record_batch_stream_writer_new(ctx->stream,
+			ctx->schema, &error));
+
+	return check_error(error, "create the Arrow stream writer");
+}
+
+static GArrowArray *build_array(const struct context *ctx,
+	const struct column *col, size_t rows, size_t valid, GError **error)
+{
+	GArrowArrayBuilder *builder;
+	GArrowArray *array;
+	const gboolean *is_valids;
+	gint64 is_valids_len;
+
+	/* Short columns get padded with nulls. */
+	is_valids = NULL;
+	is_valids_len = 0;
+	if (valid < rows) {
+		memset(ctx->is_valids + valid, 0, sizeof(gboolean) * (rows - valid));
+		is_valids = ctx->is_valids;
+		is_valids_len = rows;
+	}
+
+	if (col->type == COLUMN_ANALOG) {
+		builder = GARROW_ARRAY_BUILDER(garrow_float_array_builder_new());
+		garrow_float_array_builder_append_values(
+			GARROW_FLOAT_ARRAY_BUILDER(builder),
+			(const gfloat *)col->values->data, rows,
+			is_valids, is_valids_len, error);
+	} else if (col->type == COLUMN_BIT) {
+		builder = GARROW_ARRAY_BUILDER(garrow_boolean_array_builder_new());
+		garrow_boolean_array_builder_append_values(
+			GARROW_BOOLEAN_ARRAY_BUILDER(builder),
+			(const gboolean *)col->values->data, rows,
+			is_valids, is_valids_len, error);
+	} else if (ctx->logic_size == 1) {
+		builder = GARROW_ARRAY_BUILDER(garrow_uint8_array_builder_new());
+		garrow_uint8_array_builder_append_values(
+			GARROW_UINT8_ARRAY_BUILDER(builder),
+			(const guint8 *)col->values->data, rows,
+			is_valids, is_valids_len, error);
+	} else if (ctx->logic_size == 2) {
+		builder = GARROW_ARRAY_BUILDER(garrow_uint16_array_builder_new());
+		garrow_uint16_array_builder_append_values(
+			GARROW_UINT16_ARRAY_BUILDER(builder),
+			(const guint16 *)col->values->data, rows,
+			is_valids, is_valids_len, error);
+	} else if (ctx->logic_size == 4) {
+		builder = GARROW_ARRAY_BUILDER(garrow_uint32_array_builder_new());
+		garrow_uint32_array_builder_append_values(
+			GARROW_UINT32_ARRAY_BUILDER(builder),
+			(const guint32 *)col->values->data, rows,
+			is_valids, is_valids_len, error);
+	} else {
+		builder = GARROW_ARRAY_BUILDER(garrow_uint64_array_builder_new());
+		garrow_uint64_array_builder_append_values(
+			GARROW_UINT64_ARRAY_BUILDER(builder),
+			(const guint64 *)col->values->data, rows,
+			is_valids, is_valids_len, error);
+	}
+
+	array = NULL;
+	if (!*error)
+		array = garrow_array_builder_finish(builder, error);
+	g_object_unref(builder);
+	while (valid < rows)
+		ctx->is_valids[valid++] = TRUE;
+
+	return array;
+}
+
+/* Write the first rows of every column as one record batch. */
+static int write_batch(const struct sr_output *o, size_t rows)
+{
+	struct context *ctx;
+	struct column *col;
+	GArrowRecordBatch *batch;
+	GArrowArray *array;
+	GList *arrays;
+	GError *error;
+	size_t i, valid;
+	int ret;
+
+	ctx = o->priv;
+	if (!ctx->schema && (ret = open_writer(o)) != SR_OK)
+		return ret;
+
+	error = NULL;
+	arrays = NULL;
+	for (i = 0; i < ctx->num_columns; i++) {
+		col = &ctx->columns[i];
+		valid = MIN(rows, col->values->len);
+		if (valid < rows)
+			g_array_set_size(col->values, rows);
+		array = build_array(ctx, col, rows, valid, &error);
+		if (!array)
+			break;
+		arrays = g_list_append(arrays, array);
+		g_array_remove_range(col->values, 0, rows);
+	}
+	if (error) {
+		g_list_free_full(arrays, g_object_unref);
+		return check_error(error, "build the column arrays");
+	}
+
+	batch = garrow_record_batch_new(ctx->schema, rows, arrays, &error);
+	g_list_free_full(arrays, g_object_unref);
+	if (check_error(error, "create a record batch") != SR_OK)
+		return SR_ERR_IO;
+
+#ifdef HAVE_LIBPARQUET_GLIB
+	if (ctx->parquet) {
+		GArrowTable *table;
+
+		table = garrow_table_new_record_batches(ctx->schema, &batch, 1, &error);
+		if (!error) {
+			gparquet_arrow_file_writer_write_table(ctx->pq_writer,
+				table, rows, &error);
+			g_object_unref(table);
+		}
+		g_object_unref(batch);
+		return check_error(error, "write to the Parquet file");
+	}
+#endif
+	garrow_record_batch_writer_write_record_batch(ctx->writer, batch, &error);
+	g_object_unref(batch);
+
+	return check_error(error, "write a record batch");
+}
+
+/* Write all batches which every column has complete data for. */
+static int write_batches(const struct sr_output *o)
+{
+	struct context *ctx;
+	size_t i, avail;
+	int ret;
+
+	ctx = o->priv;
+	while (ctx->num_columns) {
+		avail = ctx->columns[0].values->len;
+		for (i = 1; i < ctx->num_columns; i++)
+			avail = MIN(avail, ctx->columns[i].values->len);
+		if (avail < ctx->batch_size)
+			break;
+		if ((ret = write_batch(o, ctx->batch_size)) != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+static void process_logic(struct context *ctx,
+	const struct sr_datafeed_logic *logic)
+{
+	struct column *col;
+	const uint8_t *src;
+	gboolean *bits;
+	uint8_t *dst;
+	size_t num_samples, copy, byte, len, i, j;
+	uint8_t mask;
+
+	if (!logic->unitsize)
+		return;
+	num_samples = logic->length / logic->unitsize;
+
+	for (i = 0; i < ctx->num_columns; i++) {
+		col = &ctx->columns[i];
+		len = col->values->len;
+		if (col->type == COLUMN_LOGIC) {
+			g_array_set_size(col->values, len + num_samples);
+			dst = (uint8_t *)col->values->data + len * ctx->logic_size;
+			if (logic->unitsize == ctx->logic_size
+					&& G_BYTE_ORDER == G_LITTLE_ENDIAN) {
+				memcpy(dst, logic->data, logic->length);
+				continue;
+			}
+			/* Widen the samples to host order integers. */
+			copy = MIN(logic->unitsize, ctx->logic_size);
+			src = logic->data;
+			for (j = 0; j < num_samples; j++) {
+				uint64_t value = 0;
+				for (byte = copy; byte--; )
+					value = (value << 8) | src[byte];
+				switch (ctx->logic_size) {
+				case 1:
+					*dst = value;
+					break;
+				case 2:
+					*(guint16 *)dst = value;
+					break;
+				case 4:
+					*(guint32 *)dst = value;
+					break;
+				default:
+					*(guint64 *)dst = value;
+					break;
+				}
+				dst += ctx->logic_size;
+				src += logic->unitsize;
+			}
+		} else if (col->type == COLUMN_BIT) {
+			g_array_set_size(col->values, len + num_samples);
+			bits = (gboolean *)col->values->data + len;
+			byte = col->bit / 8;
+			mask = 1 << (col->bit % 8);
+			if (byte >= logic->unitsize)
+				continue;
+			src = (const uint8_t *)logic->data + byte;
+			for (j = 0; j < num_samples; j++, src += logic->unitsize)
+				bits[j] = (*src & mask) ? TRUE : FALSE;
+		}
+	}
+}
+
+static int process_analog(struct context *ctx,
+	const struct sr_datafeed_analog *analog)
+{
+	struct column *col;
+	float *fdata, *dst;
+	GSList *l;
+	size_t num_channels, len, i, j, k;
+	int ret;
+
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (!num_channels || !analog->num_samples)
+		return SR_OK;
+	fdata = g_try_malloc(sizeof(float) * analog->num_samples * num_channels);
+	if (!fdata)
+		return SR_ERR_MALLOC;
+	if ((ret = sr_analog_to_float(analog, fdata)) != SR_OK) {
+		g_free(fdata);
+		return ret;
+	}
+
+	for (l = analog->meaning->channels, j = 0; l; l = l->next, j++) {
+		for (k = 0; k < ctx->num_columns; k++) {
+			col = &ctx->columns[k];
+			if (col->ch != l->data)
+				continue;
+			len = col->values->len;
+			g_array_set_size(col->values, len + analog->num_samples);
+			dst = (float *)col->values->data + len;
+			for (i = 0; i < analog->num_samples; i++)
+				dst[i] = fdata[i * num_channels + j];
+			break;
+		}
+	}
+	g_free(fdata);
+
+	return SR_OK;
+}
+
+/* Write the remaining rows, and finish the file. */
+static int finish(const struct sr_output *o)
+{
+	struct context *ctx;
+	GError *error;
+	size_t rows, i;
+	int ret;
+
+	ctx = o->priv;
+	if ((ret = write_batches(o)) != SR_OK)
+		return ret;
+	for (;;) {
+		rows = 0;
+		for (i = 0; i < ctx->num_columns; i++)
+			rows = MAX(rows, ctx->columns[i].values->len);
+		if (!rows)
+			break;
+		if ((ret = write_batch(o, MIN(rows, ctx->batch_size))) != SR_OK)
+			return ret;
+	}
+
+	error = NULL;
+#ifdef HAVE_LIBPARQUET_GLIB
+	if (ctx->pq_writer) {
+		gparquet_arrow_file_writer_close(ctx->pq_writer, &error);
+		g_clear_object(&ctx->pq_writer);
+		return check_error(error, "close the Parquet file");
+	}
+#endif
+	if (ctx->writer) {
+		garrow_record_batch_writer_close(ctx->writer, &error);
+		g_clear_object(&ctx->writer);
+		if ((ret = check_error(error, "close the Arrow stream")) != SR_OK)
+			return ret;
+	}
+	if (ctx->stream) {
+		garrow_file_close(GARROW_FILE(ctx->stream), &error);
+		g_clear_object(&ctx->stream);
+		ret = check_error(error, "close the output file");
+	}
+
+	return ret;
+}
+
+static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
+		GString **out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_config *src;
+	GSList *l;
+	int ret;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(ctx = o->priv))
+		return SR_ERR_ARG;
+	if (ctx->failed)
+		return SR_ERR_IO;
+
+	ret = SR_OK;
+	switch (packet->type) {
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key == SR_CONF_SAMPLERATE)
+				ctx->samplerate = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_LOGIC:
+		process_logic(ctx, packet->payload);
+		ret = write_batches(o);
+		break;
+	case SR_DF_ANALOG:
+		ret = process_analog(ctx, packet->payload);
+		if (ret == SR_OK)
+			ret = write_batches(o);
+		break;
+	case SR_DF_END:
+		ret = finish(o);
+		break;
+	}
+	if (ret != SR_OK)
+		ctx->failed = TRUE;
+
+	return ret;
+}
+
+static struct sr_option options[] = {
+	{ "format", "Format", "File format", NULL, NULL },
+	{ "logic", "Logic columns", "Packed 'uint' column, or one boolean column per channel ('bits')", NULL, NULL },
+	{ "batch_size", "Batch size", "Number of rows per record batch", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	GSList *l;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string("arrow"));
+		l = NULL;
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("arrow")));
+#ifdef HAVE_LIBPARQUET_GLIB
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("parquet")));
+#endif
+		options[0].values = l;
+		options[1].def = g_variant_ref_sink(g_variant_new_string("uint"));
+		l = NULL;
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("uint")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("bits")));
+		options[1].values = l;
+		options[2].def = g_variant_ref_sink(g_variant_new_uint64(DEFAULT_BATCH_SIZE));
+	}
+
+	return options;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct context *ctx;
+	size_t i;
+
+	if (!o || !(ctx = o->priv))
+		return SR_OK;
+
+	/* Close a file whose capture did not end properly. */
+#ifdef HAVE_LIBPARQUET_GLIB
+	if (ctx->pq_writer)
+		gparquet_arrow_file_writer_close(ctx->pq_writer, NULL);
+	g_clear_object(&ctx->pq_writer);
+#endif
+	if (ctx->writer)
+		garrow_record_batch_writer_close(ctx->writer, NULL);
+	g_clear_object(&ctx->writer);
+	if (ctx->stream)
+		garrow_file_close(GARROW_FILE(ctx->stream), NULL);
+	g_clear_object(&ctx->stream);
+	g_clear_object(&ctx->schema);
+
+	for (i = 0; i < ctx->num_columns; i++) {
+		g_free(ctx->columns[i].name);
+		g_array_free(ctx->columns[i].values, TRUE);
+	}
+	g_free(ctx->columns);
+	g_free(ctx->is_valids);
+	g_free(ctx);
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_output_module output_arrow = {
+	.id = "arrow",
+	.name = "Apache Arrow",
+	.desc = "Apache Arrow IPC stream or Parquet file",
+	.exts = (const char*[]){"arrows", "parquet", NULL},
+	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING,
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
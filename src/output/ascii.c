@@ -172,27 +172,76 @@ static void maybe_add_trigger(struct context *ctx, GString *out)
 		offset + 1, "^", offset);
 }
 
-static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
-		GString **out)
+/*
+ * Append the samples of one channel to its line. The edge detection
+ * compares against the preceding sample, which is the packet's previous
+ * sample for the first one.
+ */
+static void append_channel(struct context *ctx, size_t ch,
+	const uint8_t *data, const uint8_t *prev, size_t unitsize, size_t count)
+{
+	const uint8_t *p;
+	unsigned int shift;
+	uint8_t curbit, prevbit;
+	size_t charidx, cnt, bytepos;
+	GString *line;
+	size_t len;
+	char *q;
+
+	/* Write to the line's buffer directly. */
+	line = ctx->lines[ch];
+	len = line->len;
+	g_string_set_size(line, len + count);
+	q = line->str + len;
+
+	bytepos = ctx->channel_index[ch] / 8;
+	shift = ctx->channel_index[ch] % 8;
+	p = data + bytepos;
+	prevbit = (prev[bytepos] >> shift) & 1;
+	cnt = ctx->spl_cnt;
+	while (count--) {
+		curbit = (*p >> shift) & 1;
+		charidx = curbit;
+		if (ctx->edges && ++cnt > 1 && curbit != prevbit)
+			charidx += 2;
+		*q++ = ctx->charset[charidx];
+		prevbit = curbit;
+		p += unitsize;
+	}
+}
+
+static void flush_lines(struct context *ctx, GString *out)
+{
+	size_t j;
+
+	for (j = 0; j < ctx->num_enabled_channels; j++) {
+		g_string_append_len(out, ctx->lines[j]->str, ctx->lines[j]->len);
+		g_string_append_c(out, '\n');
+		/* Start the next line after the "name:" prefix. */
+		g_string_truncate(ctx->lines[j], ctx->max_namelen + 1);
+	}
+	maybe_add_trigger(ctx, out);
+}
+
+static int receive_sink(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_output_sink *sink)
 {
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_config *src;
 	GSList *l;
 	struct context *ctx;
-	size_t idx, i, j;
-	size_t num_samples;
-	const uint8_t *curr_sample;
-	size_t bytepos;
-	uint8_t bitmask, curbit, prevbit;
-	char c;
-	size_t charidx;
-
-	*out = NULL;
+	size_t i, j;
+	size_t num_samples, count, size, len;
+	const uint8_t *data, *prev;
+	GString *out, *header;
+
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 	if (!(ctx = o->priv))
 		return SR_ERR_ARG;
+	out = sr_output_sink_string(sink);
 
 	switch (packet->type) {
 	case SR_DF_META:
@@ -209,57 +258,54 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		break;
 	case SR_DF_LOGIC:
 		if (!ctx->header_done) {
-			*out = gen_header(o);
+			header = gen_header(o);
+			g_string_append_len(out, header->str, header->len);
+			g_string_free(header, TRUE);
 			ctx->header_done = TRUE;
-		} else {
-			*out = g_string_sized_new(512);
 		}
 
 		logic = packet->payload;
 		num_samples = logic->length / logic->unitsize;
-		curr_sample = logic->data;
-		while (num_samples--) {
-			ctx->spl_cnt++;
-			for (j = 0; j < ctx->num_enabled_channels; j++) {
-				idx = ctx->channel_index[j];
-				bytepos = idx / 8;
-				bitmask = 1U << (idx % 8);
-				curbit = curr_sample[bytepos] & bitmask;
-				prevbit = ctx->prev_sample[bytepos] & bitmask;
-
-				charidx = curbit ? 1 : 0;
-				if (ctx->edges && ctx->spl_cnt > 1) {
-					if (curbit != prevbit)
-						charidx += 2;
-				}
-				c = ctx->charset[charidx];
-				g_string_append_c(ctx->lines[j], c);
-
-				if (ctx->spl_cnt == ctx->spl) {
-					/* Flush line buffers. */
-					g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
-					g_string_append_c(*out, '\n');
-					if (j + 1 == ctx->num_enabled_channels)
-						maybe_add_trigger(ctx, *out);
-					g_string_printf(ctx->lines[j], "%s:", ctx->aligned_names[j]);
-				}
-			}
-			if (ctx->spl_cnt == ctx->spl)
-				/* Line buffers were already flushed. */
+		data = logic->data;
+		prev = ctx->prev_sample;
+
+		/* Reserve space for all the lines which this packet completes. */
+		if (ctx->spl) {
+			size = (ctx->spl_cnt + num_samples) / ctx->spl + 1;
+			size *= ctx->num_enabled_channels * (ctx->max_namelen + ctx->spl + 2);
+			len = out->len;
+			g_string_set_size(out, len + size);
+			g_string_set_size(out, len);
+		}
+
+		/* Work on one line's worth of samples, a channel at a time. */
+		while (num_samples) {
+			count = num_samples;
+			if (ctx->spl)
+				count = MIN(count, ctx->spl - ctx->spl_cnt);
+			for (j = 0; j < ctx->num_enabled_channels; j++)
+				append_channel(ctx, j, data, prev, logic->unitsize, count);
+			ctx->spl_cnt += count;
+			data += count * logic->unitsize;
+			prev = data - logic->unitsize;
+			num_samples -= count;
+			if (ctx->spl_cnt == ctx->spl) {
+				/* Flush line buffers. */
+				flush_lines(ctx, out);
 				ctx->spl_cnt = 0;
-			memcpy(ctx->prev_sample, curr_sample, logic->unitsize);
-			curr_sample += logic->unitsize;
+			}
 		}
+		if (data != logic->data)
+			memcpy(ctx->prev_sample, prev, logic->unitsize);
 		break;
 	case SR_DF_END:
 		if (ctx->spl_cnt) {
 			/* Line buffers need flushing. */
-			*out = g_string_sized_new(512);
 			for (i = 0; i < ctx->num_enabled_channels; i++) {
-				g_string_append_len(*out, ctx->lines[i]->str, ctx->lines[i]->len);
-				g_string_append_c(*out, '\n');
+				g_string_append_len(out, ctx->lines[i]->str, ctx->lines[i]->len);
+				g_string_append_c(out, '\n');
 			}
-			maybe_add_trigger(ctx, *out);
+			maybe_add_trigger(ctx, out);
 		}
 		break;
 	}
@@ -319,6 +365,6 @@ SR_PRIV struct sr_output_module output_ascii = {
 	.flags = 0,
 	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.receive_sink = receive_sink,
 	.cleanup = cleanup,
 };
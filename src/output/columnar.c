@@ -0,0 +1,610 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Columnar binary output, for random access by mapping the file.
+ *
+ * Samples are stored in planes: one plane for the logic channels, using
+ * the packed logic samples, and one plane per analog channel, using
+ * 32-bit floats. Planes are cut into blocks of a fixed number of
+ * samples. All planes' parts of a block are stored next to each other,
+ * so every block has the same size, and block k of a plane is found at
+ * header size + k * block size + plane offset. The last block is padded
+ * with zeros. All numbers are little endian.
+ *
+ * Header, at offset 0:
+ *    0  char[8]  magic "SRCOLUMN"
+ *    8  u32      format version, 1
+ *   12  u32      header size, the offset of the first block (page aligned)
+ *   16  u64      samplerate in Hz, 0 when unknown
+ *   24  u64      samples per block
+ *   32  u64      block size in bytes
+ *   40  u64      total number of samples
+ *   48  u64      number of blocks
+ *   56  u64      offset of the block index
+ *   64  u32      number of planes
+ *   68  u32      number of channels
+ *   72           plane table, 16 bytes per plane:
+ *                u32 type (1 logic, 2 analog), u32 bytes per sample,
+ *                u64 offset of the plane within a block
+ *                channel table, 48 bytes per channel:
+ *                u32 plane, u32 bit position (logic), char[40] name
+ *
+ * Block index, one record per block:
+ *        u64 first sample number, u64 number of samples in the block
+ *        16 bytes per plane: for logic planes the u64 number of
+ *        transitions (samples which differ from their predecessor) and
+ *        the u64 mask of toggled channels 0 to 63, for analog planes
+ *        the f32 minimum and maximum, and 8 reserved bytes.
+ *
+ * The sizes and the index offset get written when the capture ends.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/columnar"
+
+#define FORMAT_VERSION 1
+#define HEADER_ALIGN 4096
+#define PLANE_ENTRY_SIZE 16
+#define CHANNEL_ENTRY_SIZE 48
+#define CHANNEL_NAME_SIZE 40
+#define INDEX_PLANE_SIZE 16
+
+#define DEFAULT_BLOCK_SAMPLES (64 * 1024)
+
+enum plane_type {
+	PLANE_LOGIC = 1,
+	PLANE_ANALOG = 2,
+};
+
+struct plane {
+	enum plane_type type;
+	size_t sample_size;
+	size_t offset;
+	/* The analog channel, NULL for the logic plane. */
+	struct sr_channel *ch;
+	/* Samples which were received but not written yet. */
+	GByteArray *pending;
+	size_t pending_samples;
+	/* Last sample of the previous block, for transition counts. */
+	uint8_t *last;
+	gboolean has_last;
+};
+
+struct context {
+	FILE *file;
+	uint64_t samplerate;
+	uint64_t block_samples;
+	size_t block_size;
+	size_t header_size;
+	size_t num_planes;
+	struct plane *planes;
+	uint8_t *block;
+	GByteArray *index;
+	uint64_t num_samples;
+	uint64_t num_blocks;
+	gboolean finished;
+};
+
+static void put_u32(GByteArray *a, uint32_t v)
+{
+	uint8_t buf[sizeof(v)];
+
+	WL32(buf, v);
+	g_byte_array_append(a, buf, sizeof(buf));
+}
+
+static void put_u64(GByteArray *a, uint64_t v)
+{
+	uint8_t buf[sizeof(v)];
+
+	write_u64le(buf, v);
+	g_byte_array_append(a, buf, sizeof(buf));
+}
+
+static void put_float(GByteArray *a, float v)
+{
+	uint32_t bits;
+
+	memcpy(&bits, &v, sizeof(bits));
+	put_u32(a, bits);
+}
+
+static GByteArray *gen_header(const struct sr_output *o)
+{
+	struct context *ctx;
+	struct plane *plane;
+	struct sr_channel *ch;
+	GByteArray *hdr;
+	GSList *l;
+	uint32_t num_channels;
+	size_t i;
+	char name[CHANNEL_NAME_SIZE];
+
+	ctx = o->priv;
+
+	num_channels = 0;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->enabled)
+			num_channels++;
+	}
+
+	hdr = g_byte_array_new();
+	g_byte_array_append(hdr, (const guint8 *)"SRCOLUMN", 8);
+	put_u32(hdr, FORMAT_VERSION);
+	put_u32(hdr, ctx->header_size);
+	put_u64(hdr, ctx->samplerate);
+	put_u64(hdr, ctx->block_samples);
+	put_u64(hdr, ctx->block_size);
+	put_u64(hdr, ctx->num_samples);
+	put_u64(hdr, ctx->num_blocks);
+	put_u64(hdr, ctx->header_size + ctx->num_blocks * ctx->block_size);
+	put_u32(hdr, ctx->num_planes);
+	put_u32(hdr, num_channels);
+
+	for (i = 0; i < ctx->num_planes; i++) {
+		plane = &ctx->planes[i];
+		put_u32(hdr, plane->type);
+		put_u32(hdr, plane->sample_size);
+		put_u64(hdr, plane->offset);
+	}
+
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!ch->enabled)
+			continue;
+		for (i = 0; i < ctx->num_planes; i++) {
+			plane = &ctx->planes[i];
+			if (plane->type == PLANE_LOGIC && ch->type == SR_CHANNEL_LOGIC)
+				break;
+			if (plane->ch == ch)
+				break;
+		}
+		put_u32(hdr, i);
+		put_u32(hdr, ch->type == SR_CHANNEL_LOGIC ? ch->index : 0);
+		memset(name, 0, sizeof(name));
+		g_strlcpy(name, ch->name, sizeof(name));
+		g_byte_array_append(hdr, (const guint8 *)name, sizeof(name));
+	}
+
+	/* Page align the first block. */
+	g_byte_array_set_size(hdr, ctx->header_size);
+
+	return hdr;
+}
+
+static int cleanup(struct sr_output *o);
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	struct plane *plane;
+	GByteArray *hdr;
+	GVariant *gvar;
+	GSList *l;
+	size_t num_analog, num_channels, logic_size, i;
+	int ret;
+
+	if (!o->filename || o->filename[0] == '\0') {
+		sr_info("columnar output module requires a file name, cannot save.");
+		return SR_ERR_ARG;
+	}
+
+	/* The logic plane holds all logic channels, up to the highest. */
+	num_analog = num_channels = logic_size = 0;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!ch->enabled)
+			continue;
+		num_channels++;
+		if (ch->type == SR_CHANNEL_LOGIC)
+			logic_size = MAX(logic_size, (size_t)ch->index / 8 + 1);
+		else if (ch->type == SR_CHANNEL_ANALOG)
+			num_analog++;
+	}
+
+	ctx = g_malloc0(sizeof(*ctx));
+	o->priv = ctx;
+	ctx->block_samples = g_variant_get_uint64(
+		g_hash_table_lookup(options, "block_size"));
+	if (!ctx->block_samples) {
+		sr_err("The block size must not be zero.");
+		cleanup(o);
+		return SR_ERR_ARG;
+	}
+	ctx->num_planes = (logic_size ? 1 : 0) + num_analog;
+	ctx->planes = g_malloc0(sizeof(ctx->planes[0]) * MAX(ctx->num_planes, 1));
+	plane = ctx->planes;
+	if (logic_size) {
+		plane->type = PLANE_LOGIC;
+		plane->sample_size = logic_size;
+		plane++;
+	}
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (!ch->enabled || ch->type != SR_CHANNEL_ANALOG)
+			continue;
+		plane->type = PLANE_ANALOG;
+		plane->sample_size = sizeof(float);
+		plane->ch = ch;
+		plane++;
+	}
+	for (i = 0; i < ctx->num_planes; i++) {
+		plane = &ctx->planes[i];
+		plane->offset = ctx->block_size;
+		plane->pending = g_byte_array_new();
+		plane->last = g_malloc0(plane->sample_size);
+		ctx->block_size += plane->sample_size * ctx->block_samples;
+	}
+	ctx->block = g_malloc0(MAX(ctx->block_size, 1));
+	ctx->index = g_byte_array_new();
+
+	ctx->header_size = 72 + PLANE_ENTRY_SIZE * ctx->num_planes
+		+ CHANNEL_ENTRY_SIZE * num_channels;
+	ctx->header_size += HEADER_ALIGN - 1;
+	ctx->header_size -= ctx->header_size % HEADER_ALIGN;
+
+	if (sr_config_get(o->sdi->driver, o->sdi, NULL, SR_CONF_SAMPLERATE,
+			&gvar) == SR_OK) {
+		ctx->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+
+	ctx->file = g_fopen(o->filename, "wb");
+	if (!ctx->file) {
+		sr_err("Cannot create '%s': %s.", o->filename, g_strerror(errno));
+		cleanup(o);
+		return SR_ERR_IO;
+	}
+	hdr = gen_header(o);
+	ret = fwrite(hdr->data, hdr->len, 1, ctx->file) == 1 ? SR_OK : SR_ERR_IO;
+	g_byte_array_free(hdr, TRUE);
+	if (ret != SR_OK) {
+		sr_err("Cannot write the header: %s.", g_strerror(errno));
+		ctx->finished = TRUE;
+		cleanup(o);
+	}
+
+	return ret;
+}
+
+/* Append the block's index record for a plane. */
+static void index_plane(struct context *ctx, struct plane *plane,
+	const uint8_t *data, size_t count)
+{
+	uint64_t transitions, toggled, diff;
+	const uint8_t *prev;
+	float *values, min, max;
+	size_t i, j;
+
+	if (plane->type == PLANE_ANALOG) {
+		values = (float *)data;
+		min = INFINITY;
+		max = -INFINITY;
+		for (i = 0; i < count; i++) {
+			min = fminf(min, values[i]);
+			max = fmaxf(max, values[i]);
+		}
+		put_float(ctx->index, min);
+		put_float(ctx->index, max);
+		put_u64(ctx->index, 0);
+		return;
+	}
+
+	transitions = toggled = 0;
+	prev = plane->has_last ? plane->last : NULL;
+	for (i = 0; i < count; i++, data += plane->sample_size) {
+		if (prev && memcmp(prev, data, plane->sample_size)) {
+			transitions++;
+			diff = 0;
+			for (j = 0; j < MIN(plane->sample_size, 8); j++)
+				diff |= (uint64_t)(prev[j] ^ data[j]) << (8 * j);
+			toggled |= diff;
+		}
+		prev = data;
+	}
+	if (count) {
+		memcpy(plane->last, prev, plane->sample_size);
+		plane->has_last = TRUE;
+	}
+	put_u64(ctx->index, transitions);
+	put_u64(ctx->index, toggled);
+}
+
+/*
+ * Write one block of up to block_samples samples, planes with fewer
+ * pending samples get padded with zeros.
+ */
+static int write_block(struct context *ctx, size_t count)
+{
+	struct plane *plane;
+	uint8_t *dst;
+	size_t i, n, len;
+
+	put_u64(ctx->index, ctx->num_samples);
+	put_u64(ctx->index, count);
+
+	memset(ctx->block, 0, ctx->block_size);
+	for (i = 0; i < ctx->num_planes; i++) {
+		plane = &ctx->planes[i];
+		dst = ctx->block + plane->offset;
+		n = MIN(count, plane->pending_samples);
+		len = n * plane->sample_size;
+		memcpy(dst, plane->pending->data, len);
+		g_byte_array_remove_range(plane->pending, 0, len);
+		plane->pending_samples -= n;
+		index_plane(ctx, plane, dst, n);
+	}
+
+	if (fwrite(ctx->block, ctx->block_size, 1, ctx->file) != 1) {
+		sr_err("Cannot write block: %s.", g_strerror(errno));
+		return SR_ERR_IO;
+	}
+	ctx->num_samples += count;
+	ctx->num_blocks++;
+
+	return SR_OK;
+}
+
+/* Write all blocks which every plane has complete data for. */
+static int write_blocks(struct context *ctx)
+{
+	size_t i, avail;
+	int ret;
+
+	while (ctx->num_planes) {
+		avail = ctx->planes[0].pending_samples;
+		for (i = 1; i < ctx->num_planes; i++)
+			avail = MIN(avail, ctx->planes[i].pending_samples);
+		if (avail < ctx->block_samples)
+			break;
+		ret = write_block(ctx, ctx->block_samples);
+		if (ret != SR_OK)
+			return ret;
+	}
+
+	return SR_OK;
+}
+
+/* Write the remaining samples, the index, and the final header. */
+static int finish(const struct sr_output *o)
+{
+	struct context *ctx;
+	GByteArray *hdr;
+	size_t i, count;
+	int ret;
+
+	ctx = o->priv;
+	if (ctx->finished)
+		return SR_OK;
+	ctx->finished = TRUE;
+
+	ret = write_blocks(ctx);
+	while (ret == SR_OK) {
+		count = 0;
+		for (i = 0; i < ctx->num_planes; i++)
+			count = MAX(count, ctx->planes[i].pending_samples);
+		if (!count)
+			break;
+		ret = write_block(ctx, MIN(count, ctx->block_samples));
+	}
+	if (ret != SR_OK)
+		return ret;
+
+	if (fwrite(ctx->index->data, 1, ctx->index->len, ctx->file)
+			!= ctx->index->len)
+		return SR_ERR_IO;
+
+	hdr = gen_header(o);
+	ret = SR_OK;
+	if (fseek(ctx->file, 0, SEEK_SET) != 0
+			|| fwrite(hdr->data, hdr->len, 1, ctx->file) != 1
+			|| fflush(ctx->file) != 0)
+		ret = SR_ERR_IO;
+	g_byte_array_free(hdr, TRUE);
+	if (ret != SR_OK)
+		sr_err("Cannot write the header: %s.", g_strerror(errno));
+
+	return ret;
+}
+
+static void process_logic(struct context *ctx,
+	const struct sr_datafeed_logic *logic)
+{
+	struct plane *plane;
+	const uint8_t *src;
+	size_t num_samples, copy, i, len;
+
+	plane = &ctx->planes[0];
+	if (!ctx->num_planes || plane->type != PLANE_LOGIC || !logic->unitsize)
+		return;
+
+	num_samples = logic->length / logic->unitsize;
+	if (logic->unitsize == plane->sample_size) {
+		g_byte_array_append(plane->pending, logic->data,
+			num_samples * logic->unitsize);
+	} else {
+		/* Pick the plane's bytes of each sample, zero pad the rest. */
+		len = plane->pending->len;
+		g_byte_array_set_size(plane->pending,
+			len + num_samples * plane->sample_size);
+		memset(plane->pending->data + len, 0,
+			num_samples * plane->sample_size);
+		copy = MIN(logic->unitsize, plane->sample_size);
+		src = logic->data;
+		for (i = 0; i < num_samples; i++) {
+			memcpy(plane->pending->data + len, src, copy);
+			len += plane->sample_size;
+			src += logic->unitsize;
+		}
+	}
+	plane->pending_samples += num_samples;
+}
+
+static int process_analog(struct context *ctx,
+	const struct sr_datafeed_analog *analog)
+{
+	struct plane *plane;
+	struct sr_channel *ch;
+	float *fdata, *dst;
+	GSList *l;
+	size_t num_channels, i, j, k, len;
+	int ret;
+
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (!num_channels || !analog->num_samples)
+		return SR_OK;
+	fdata = g_try_malloc(sizeof(float) * analog->num_samples * num_channels);
+	if (!fdata)
+		return SR_ERR_MALLOC;
+	ret = sr_analog_to_float(analog, fdata);
+	if (ret != SR_OK) {
+		g_free(fdata);
+		return ret;
+	}
+
+	for (l = analog->meaning->channels, j = 0; l; l = l->next, j++) {
+		ch = l->data;
+		for (k = 0; k < ctx->num_planes; k++) {
+			plane = &ctx->planes[k];
+			if (plane->ch != ch)
+				continue;
+			len = plane->pending->len;
+			g_byte_array_set_size(plane->pending,
+				len + analog->num_samples * sizeof(float));
+			dst = (float *)(plane->pending->data + len);
+			for (i = 0; i < analog->num_samples; i++)
+				dst[i] = fdata[i * num_channels + j];
+			plane->pending_samples += analog->num_samples;
+			break;
+		}
+	}
+	g_free(fdata);
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
+		GString **out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_config *src;
+	GSList *l;
+	int ret;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(ctx = o->priv))
+		return SR_ERR_ARG;
+	if (ctx->finished)
+		return SR_OK;
+
+	ret = SR_OK;
+	switch (packet->type) {
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key != SR_CONF_SAMPLERATE)
+				continue;
+			ctx->samplerate = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_LOGIC:
+		process_logic(ctx, packet->payload);
+		ret = write_blocks(ctx);
+		break;
+	case SR_DF_ANALOG:
+		ret = process_analog(ctx, packet->payload);
+		if (ret == SR_OK)
+			ret = write_blocks(ctx);
+		break;
+	case SR_DF_END:
+		ret = finish(o);
+		break;
+	}
+
+	return ret;
+}
+
+static struct sr_option options[] = {
+	{ "block_size", "Block size", "Number of samples per block", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(DEFAULT_BLOCK_SAMPLES));
+
+	return options;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct context *ctx;
+	size_t i;
+	int ret;
+
+	if (!o || !(ctx = o->priv))
+		return SR_OK;
+
+	ret = SR_OK;
+	if (ctx->file) {
+		ret = finish(o);
+		if (fclose(ctx->file) != 0 && ret == SR_OK)
+			ret = SR_ERR_IO;
+	}
+	for (i = 0; i < ctx->num_planes; i++) {
+		if (ctx->planes[i].pending)
+			g_byte_array_free(ctx->planes[i].pending, TRUE);
+		g_free(ctx->planes[i].last);
+	}
+	g_free(ctx->planes);
+	g_free(ctx->block);
+	if (ctx->index)
+		g_byte_array_free(ctx->index, TRUE);
+	g_free(ctx);
+	o->priv = NULL;
+
+	return ret;
+}
+
+SR_PRIV struct sr_output_module output_columnar = {
+	.id = "columnar",
+	.name = "Columnar",
+	.desc = "Columnar binary planes with a block index",
+	.exts = (const char*[]){"srcol", NULL},
+	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING,
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -97,8 +97,16 @@ struct context {
 	uint64_t sample_scale;
 	uint64_t out_sample_count;
 	uint8_t *previous_sample;
+	/* Staged values of a frame, buffers are kept across frames. */
 	float *analog_samples;
 	uint8_t *logic_samples;
+	size_t analog_samples_size, logic_samples_size;
+	gboolean have_analog, have_logic;
+	float *fdata;
+	size_t fdata_size;
+	/* Bit positions of the enabled logic channels. */
+	size_t *logic_index;
+	size_t value_len, record_len;
 	const char *xlabel;	/* Don't free: will point to a static string. */
 	const char *title;	/* Don't free: will point into the driver struct. */
 
@@ -116,7 +124,7 @@ struct context {
 
 static int init(struct sr_output *o, GHashTable *options)
 {
-	unsigned int i, analog_channels, logic_channels;
+	unsigned int i, j, analog_channels, logic_channels;
 	struct context *ctx;
 	struct sr_channel *ch;
 	const char *label_string;
@@ -154,6 +162,9 @@ static int init(struct sr_output *o, GHashTable *options)
 	if (*ctx->gnuplot && strlen(ctx->value) > 1)
 		sr_warn("gnuplot doesn't support multichar value separators.");
 
+	ctx->value_len = strlen(ctx->value);
+	ctx->record_len = strlen(ctx->record);
+
 	if ((ctx->label_did = ctx->label_do = g_strcmp0(label_string, "off") != 0))
 		ctx->label_names = g_strcmp0(label_string, "units") != 0;
 
@@ -186,9 +197,12 @@ static int init(struct sr_output *o, GHashTable *options)
 	}
 	ctx->channels = g_malloc(sizeof(struct ctx_channel)
 		* (ctx->num_analog_channels + ctx->num_logic_channels));
+	ctx->logic_index = g_malloc0(sizeof(ctx->logic_index[0])
+		* (ctx->num_logic_channels + 1));
 
 	/* Once more to map the enabled channels. */
 	ctx->channel_count = g_slist_length(o->sdi->channels);
+	j = 0;
 	for (i = 0, l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
 		if (ch->enabled) {
@@ -203,6 +217,8 @@ static int init(struct sr_output *o, GHashTable *options)
 			}
 			if (ctx->label_do && ctx->label_names)
 				ctx->channels[i].label = ch->name;
+			if (ch->type == SR_CHANNEL_LOGIC)
+				ctx->logic_index[j++] = ch->index;
 			ctx->channels[i++].ch = ch;
 		}
 	}
@@ -319,15 +335,20 @@ static void process_analog(struct context *ctx,
 	int ret;
 	size_t num_rcvd_ch, num_have_ch;
 	size_t idx_have, idx_smpl, idx_rcvd;
-	size_t idx_send;
+	size_t idx_send, size;
 	struct sr_analog_meaning *meaning;
 	GSList *l;
-	float *fdata = NULL;
+	float *fdata, *dst;
 	struct sr_channel *ch;
 
-	if (!ctx->analog_samples) {
-		ctx->analog_samples = g_malloc(analog->num_samples
-			* sizeof(float) * ctx->num_analog_channels);
+	if (!ctx->have_analog) {
+		size = analog->num_samples * ctx->num_analog_channels;
+		if (size > ctx->analog_samples_size) {
+			g_free(ctx->analog_samples);
+			ctx->analog_samples = g_malloc(size * sizeof(float));
+			ctx->analog_samples_size = size;
+		}
+		ctx->have_analog = TRUE;
 		if (!ctx->num_samples)
 			ctx->num_samples = analog->num_samples;
 	}
@@ -339,7 +360,13 @@ static void process_analog(struct context *ctx,
 	num_rcvd_ch = g_slist_length(meaning->channels);
 	ctx->channels_seen += num_rcvd_ch;
 	sr_dbg("Processing packet of %zu analog channels", num_rcvd_ch);
-	fdata = g_malloc(analog->num_samples * num_rcvd_ch * sizeof(float));
+	size = analog->num_samples * num_rcvd_ch;
+	if (size > ctx->fdata_size) {
+		g_free(ctx->fdata);
+		ctx->fdata = g_malloc(size * sizeof(float));
+		ctx->fdata_size = size;
+	}
+	fdata = ctx->fdata;
 	if ((ret = sr_analog_to_float(analog, fdata)) != SR_OK)
 		sr_warn("Problems converting data to floating point values.");
 
@@ -359,31 +386,42 @@ static void process_analog(struct context *ctx,
 				sr_analog_unit_to_string(analog,
 					&ctx->channels[idx_have].label);
 			}
-			for (idx_smpl = 0; idx_smpl < analog->num_samples; idx_smpl++)
-				ctx->analog_samples[idx_smpl * ctx->num_analog_channels + idx_send] = fdata[idx_smpl * num_rcvd_ch + idx_rcvd];
+			dst = &ctx->analog_samples[idx_send];
+			for (idx_smpl = 0; idx_smpl < analog->num_samples; idx_smpl++) {
+				*dst = fdata[idx_smpl * num_rcvd_ch + idx_rcvd];
+				dst += ctx->num_analog_channels;
+			}
 			break;
 		}
 		idx_send++;
 	}
-	g_free(fdata);
 }
 
 /*
  * We treat logic packets the same as analog packets, though it's not
  * strictly required. This allows us to process mixed signals properly.
+ * The staged values already are the '0' and '1' output characters.
  */
 static void process_logic(struct context *ctx,
 			  const struct sr_datafeed_logic *logic)
 {
+	static const uint8_t bit_chars[2] = { '0', '1' };
 	unsigned int i, j, ch, num_samples;
-	int idx;
-	uint8_t *sample;
+	size_t idx, size;
+	const uint8_t *sample;
+	uint8_t *dst;
 
 	num_samples = logic->length / logic->unitsize;
 	ctx->channels_seen += ctx->logic_channel_count;
 	sr_dbg("Logic packet had %d channels", logic->unitsize * 8);
-	if (!ctx->logic_samples) {
-		ctx->logic_samples = g_malloc(num_samples * ctx->num_logic_channels);
+	if (!ctx->have_logic) {
+		size = num_samples * ctx->num_logic_channels;
+		if (size > ctx->logic_samples_size) {
+			g_free(ctx->logic_samples);
+			ctx->logic_samples = g_malloc(size);
+			ctx->logic_samples_size = size;
+		}
+		ctx->have_logic = TRUE;
 		if (!ctx->num_samples)
 			ctx->num_samples = num_samples;
 	}
@@ -391,18 +429,104 @@ static void process_logic(struct context *ctx,
 		sr_warn("Expecting %u samples, got %u",
 			ctx->num_samples, num_samples);
 
-	for (j = ch = 0; ch < ctx->num_logic_channels; j++) {
-		if (ctx->channels[j].ch->type == SR_CHANNEL_LOGIC) {
-			for (i = 0; i < num_samples; i++) {
-				sample = logic->data + i * logic->unitsize;
-				idx = ctx->channels[j].ch->index;
-				if (ctx->label_do && !ctx->label_names)
-					ctx->channels[j].label = "logic";
-				ctx->logic_samples[i * ctx->num_logic_channels + ch] = sample[idx / 8] & (1 << (idx % 8));
-			}
+	if (ctx->label_do && !ctx->label_names) {
+		for (j = ch = 0; ch < ctx->num_logic_channels; j++) {
+			if (ctx->channels[j].ch->type != SR_CHANNEL_LOGIC)
+				continue;
+			ctx->channels[j].label = "logic";
 			ch++;
 		}
 	}
+
+	sample = logic->data;
+	dst = ctx->logic_samples;
+	for (i = 0; i < num_samples; i++) {
+		for (ch = 0; ch < ctx->num_logic_channels; ch++) {
+			idx = ctx->logic_index[ch];
+			*dst++ = bit_chars[(sample[idx / 8] >> (idx % 8)) & 1];
+		}
+		sample += logic->unitsize;
+	}
+}
+
+/* Append an unsigned decimal number without going through printf. */
+static void append_u64(GString *s, uint64_t value)
+{
+	char buf[20], *p;
+
+	p = &buf[sizeof(buf)];
+	do {
+		*--p = '0' + value % 10;
+		value /= 10;
+	} while (value);
+	g_string_append_len(s, p, &buf[sizeof(buf)] - p);
+}
+
+/*
+ * Append an analog value in the "%g" format. Values in the fixed point
+ * range of that format with an unambiguous rounding get converted here,
+ * everything else takes the generic path.
+ */
+static void append_float(GString *s, float value)
+{
+	static const double pow10[] = {
+		1e-4, 1e-3, 1e-2, 1e-1, 1e0, 1e1, 1e2, 1e3, 1e4, 1e5,
+		1e6, 1e7, 1e8, 1e9,
+	};
+	char buf[G_ASCII_DTOSTR_BUF_SIZE], *p, *end, *dot;
+	double v, scaled, frac;
+	uint64_t digits;
+	int exp, prec, i;
+
+	v = value;
+	if (v == 0) {
+		g_string_append(s, signbit(v) ? "-0" : "0");
+		return;
+	}
+	if (!isfinite(v) || fabs(v) < 1e-4 || fabs(v) >= 999999.5)
+		goto fallback;
+
+	/* Six significant digits, find the exponent of the leading one. */
+	v = fabs(v);
+	for (exp = -4; exp < 5 && v >= pow10[exp + 5]; exp++)
+		;
+	prec = 5 - exp;
+	scaled = v * pow10[prec + 4];
+	frac = scaled - floor(scaled);
+	if (fabs(frac - 0.5) < 1e-6)
+		goto fallback;
+	digits = (uint64_t)floor(scaled) + (frac > 0.5);
+	if (digits >= 1000000) {
+		digits /= 10;
+		prec--;
+	}
+
+	/* Print the digits backwards, at least one before the dot. */
+	end = &buf[sizeof(buf)];
+	p = end;
+	for (i = 0; i <= prec || digits; i++) {
+		if (i == prec && prec)
+			*--p = '.';
+		*--p = '0' + digits % 10;
+		digits /= 10;
+	}
+	if (value < 0)
+		*--p = '-';
+
+	/* Drop trailing zeros of the fraction, and a dangling dot. */
+	dot = prec ? end - prec - 1 : NULL;
+	if (dot) {
+		while (end > dot + 1 && end[-1] == '0')
+			end--;
+		if (end == dot + 1)
+			end = dot;
+	}
+	g_string_append_len(s, p, end - p);
+	return;
+
+fallback:
+	g_ascii_formatd(buf, sizeof(buf), "%g", value);
+	g_string_append(s, buf);
 }
 
 static void dump_saved_values(struct context *ctx, GString **out)
@@ -412,10 +536,11 @@ static void dump_saved_values(struct context *ctx, GString **out)
 	uint64_t sample_time_u64;
 	float *analog_sample, value;
 	uint8_t *logic_sample;
+	size_t row_size, row_start, len;
 
 	/* If we haven't seen samples we're expecting, skip them. */
-	if ((ctx->num_analog_channels && !ctx->analog_samples) ||
-	    (ctx->num_logic_channels && !ctx->logic_samples)) {
+	if ((ctx->num_analog_channels && !ctx->have_analog) ||
+	    (ctx->num_logic_channels && !ctx->have_logic)) {
 		sr_warn("Discarding partial packet");
 	} else {
 		sr_info("Dumping %u samples", ctx->num_samples);
@@ -451,6 +576,16 @@ static void dump_saved_values(struct context *ctx, GString **out)
 		if (ctx->dedup && !ctx->previous_sample)
 			ctx->previous_sample = g_malloc0(analog_size + ctx->num_logic_channels);
 
+		/* Reserve the output buffer upfront, based on a row's size. */
+		row_size = ctx->record_len;
+		row_size += (ctx->time ? 20 : 0) + ctx->value_len;
+		row_size += ctx->num_logic_channels * (1 + ctx->value_len);
+		row_size += ctx->num_analog_channels * (14 + ctx->value_len);
+		row_size += ctx->do_trigger ? 1 + ctx->value_len : 0;
+		len = (*out)->len;
+		g_string_set_size(*out, len + row_size * ctx->num_samples);
+		g_string_set_size(*out, len);
+
 		for (i = 0; i < ctx->num_samples; i++) {
 			analog_sample =
 			    &ctx->analog_samples[i * ctx->num_analog_channels];
@@ -473,29 +608,31 @@ static void dump_saved_values(struct context *ctx, GString **out)
 				       analog_sample, analog_size);
 			}
 
+			/* Separators go between the values of a row. */
+			row_start = (*out)->len;
 			if (ctx->time && !ctx->sample_rate) {
-				g_string_append_printf(*out, "0%s", ctx->value);
+				g_string_append_c(*out, '0');
 			} else if (ctx->time) {
 				sample_time_dbl = ctx->out_sample_count++;
 				sample_time_dbl /= ctx->sample_rate;
 				sample_time_dbl *= ctx->sample_scale;
 				sample_time_u64 = sample_time_dbl;
-				g_string_append_printf(*out, "%" PRIu64 "%s",
-					sample_time_u64, ctx->value);
+				append_u64(*out, sample_time_u64);
 			}
 
 			for (j = 0; j < num_channels; j++) {
+				if ((*out)->len != row_start)
+					g_string_append_len(*out, ctx->value,
+						ctx->value_len);
 				if (ctx->channels[j].ch->type == SR_CHANNEL_ANALOG) {
-					value = ctx->analog_samples[i * ctx->num_analog_channels + j];
+					value = *analog_sample++;
 					ctx->channels[j].max =
 					    fmax(value, ctx->channels[j].max);
 					ctx->channels[j].min =
 					    fmin(value, ctx->channels[j].min);
-					g_string_append_printf(*out, "%g%s",
-						value, ctx->value);
+					append_float(*out, value);
 				} else if (ctx->channels[j].ch->type == SR_CHANNEL_LOGIC) {
-					g_string_append_printf(*out, "%c%s",
-							       ctx->logic_samples[i * ctx->num_logic_channels + j] ? '1' : '0', ctx->value);
+					g_string_append_c(*out, *logic_sample++);
 				} else {
 					sr_warn("Unexpected channel type: %d",
 						ctx->channels[i].ch->type);
@@ -503,24 +640,23 @@ static void dump_saved_values(struct context *ctx, GString **out)
 			}
 
 			if (ctx->do_trigger) {
-				g_string_append_printf(*out, "%d%s",
-					ctx->trigger, ctx->value);
+				if ((*out)->len != row_start)
+					g_string_append_len(*out, ctx->value,
+						ctx->value_len);
+				g_string_append_c(*out, ctx->trigger ? '1' : '0');
 				ctx->trigger = FALSE;
 			}
-			g_string_truncate(*out, (*out)->len - 1);
-			g_string_append(*out, ctx->record);
+			g_string_append_len(*out, ctx->record, ctx->record_len);
 		}
 	}
 
-	/* Discard all of the working space. */
+	/* Discard the working state, keep the buffers for the next frame. */
 	g_free(ctx->previous_sample);
-	g_free(ctx->analog_samples);
-	g_free(ctx->logic_samples);
 	ctx->channels_seen = 0;
 	ctx->num_samples = 0;
 	ctx->previous_sample = NULL;
-	ctx->analog_samples = NULL;
-	ctx->logic_samples = NULL;
+	ctx->have_analog = FALSE;
+	ctx->have_logic = FALSE;
 }
 
 static void save_gnuplot(struct context *ctx)
@@ -729,6 +865,10 @@ static int cleanup(struct sr_output *o)
 		g_free((gpointer)ctx->gnuplot);
 		g_free((gpointer)ctx->value);
 		g_free(ctx->previous_sample);
+		g_free(ctx->analog_samples);
+		g_free(ctx->logic_samples);
+		g_free(ctx->fdata);
+		g_free(ctx->logic_index);
 		g_free(ctx->channels);
 		g_free(o->priv);
 		o->priv = NULL;
@@ -41,6 +41,9 @@ struct context {
 	uint8_t *sample_buf;
 	gboolean header_done;
 	GString **lines;
+	size_t line_size;
+	/* Text of all byte values, "xx " each. */
+	char hex_text[256 * 3];
 };
 
 static int init(struct sr_output *o, GHashTable *options)
@@ -71,6 +74,22 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->lines = g_malloc(sizeof(GString *) * ctx->num_enabled_channels);
 	ctx->sample_buf = g_malloc(ctx->num_enabled_channels);
 
+	for (i = 0; i < 256; i++) {
+		ctx->hex_text[i * 3 + 0] = "0123456789abcdef"[i >> 4];
+		ctx->hex_text[i * 3 + 1] = "0123456789abcdef"[i & 0xf];
+		ctx->hex_text[i * 3 + 2] = ' ';
+	}
+
+	/* Name, separator, two digits and a space per byte, newline. */
+	ctx->line_size = 0;
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC || !ch->enabled)
+			continue;
+		ctx->line_size = MAX(ctx->line_size, strlen(ch->name));
+	}
+	ctx->line_size += 2 + (ctx->spl / 8 + 1) * 3;
+
 	j = 0;
 	for (i = 0, l = o->sdi->channels; l; l = l->next, i++) {
 		ch = l->data;
@@ -80,7 +99,7 @@ static int init(struct sr_output *o, GHashTable *options)
 			continue;
 		ctx->channel_index[j] = ch->index;
 		ctx->channel_names[j] = ch->name;
-		ctx->lines[j] = g_string_sized_new(80);
+		ctx->lines[j] = g_string_sized_new(ctx->line_size);
 		ctx->sample_buf[j] = 0;
 		g_string_printf(ctx->lines[j], "%s:", ch->name);
 		j++;
@@ -121,23 +140,80 @@ static GString *gen_header(const struct sr_output *o)
 	return header;
 }
 
-static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
-		GString **out)
+/* Append the bits of one channel, completed bytes go to its line. */
+static void append_channel(struct context *ctx, unsigned int ch,
+	const uint8_t *data, size_t unitsize, size_t count)
+{
+	const struct sr_logic_kernels *kernels;
+	uint8_t bits[256];
+	uint8_t buf;
+	size_t i, n;
+	int cnt;
+
+	kernels = sr_logic_kernels_get(unitsize);
+	buf = ctx->sample_buf[ch];
+	cnt = ctx->spl_cnt;
+	while (count) {
+		n = MIN(count, sizeof(bits));
+		kernels->extract(data, unitsize, n, ctx->channel_index[ch], bits);
+		for (i = 0; i < n; i++) {
+			buf = (buf << 1) | bits[i];
+			if ((++cnt & 7) == 0) {
+				/* Buffered a byte's worth, output hex. */
+				g_string_append_len(ctx->lines[ch],
+					&ctx->hex_text[buf * 3], 3);
+				buf = 0;
+			}
+		}
+		data += n * unitsize;
+		count -= n;
+	}
+	ctx->sample_buf[ch] = buf;
+}
+
+static void flush_lines(struct context *ctx, GString *out)
+{
+	unsigned int j;
+	int offset;
+
+	for (j = 0; j < ctx->num_enabled_channels; j++) {
+		g_string_append_len(out, ctx->lines[j]->str, ctx->lines[j]->len);
+		g_string_append_c(out, '\n');
+		/* Start the next line after the "name:" prefix. */
+		g_string_truncate(ctx->lines[j], strlen(ctx->channel_names[j]) + 1);
+	}
+	if (ctx->trigger > -1) {
+		/*
+		 * Sample data lines have one character per nibble,
+		 * plus one separator per byte. Align trigger marker
+		 * to this layout.
+		 */
+		offset = ctx->trigger / 4 + ctx->trigger / 8;
+		g_string_append_printf(out, "T:%*s^ %d\n", offset, "", ctx->trigger);
+		ctx->trigger = -1;
+	}
+}
+
+static int receive_sink(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_output_sink *sink)
 {
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
 	const struct sr_config *src;
 	GSList *l;
 	struct context *ctx;
-	int idx, pos, offset;
+	const uint8_t *data;
+	size_t num_samples, count, size, len;
 	uint64_t i, j;
-	gchar *p;
+	uint8_t byte;
+	GString *out, *header;
 
-	*out = NULL;
 	if (!o || !o->sdi)
 		return SR_ERR_ARG;
 	if (!(ctx = o->priv))
 		return SR_ERR_ARG;
+	out = sr_output_sink_string(sink);
 
 	switch (packet->type) {
 	case SR_DF_META:
@@ -154,60 +230,53 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		break;
 	case SR_DF_LOGIC:
 		if (!ctx->header_done) {
-			*out = gen_header(o);
+			header = gen_header(o);
+			g_string_append_len(out, header->str, header->len);
+			g_string_free(header, TRUE);
 			ctx->header_done = TRUE;
-		} else
-			*out = g_string_sized_new(512);
+		}
 
 		logic = packet->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			ctx->spl_cnt++;
-			pos = ctx->spl_cnt & 7;
-			for (j = 0; j < ctx->num_enabled_channels; j++) {
-				idx = ctx->channel_index[j];
-				p = logic->data + i + idx / 8;
-				ctx->sample_buf[j] <<= 1;
-				if (*p & (1 << (idx % 8)))
-					ctx->sample_buf[j] |= 1;
-				if (ctx->spl_cnt && pos == 0) {
-					/* Buffered a byte's worth, output hex. */
-					g_string_append_printf(ctx->lines[j], "%.2x ",
-							ctx->sample_buf[j]);
-					ctx->sample_buf[j] = 0;
-				}
+		data = logic->data;
+		num_samples = logic->length / logic->unitsize;
 
-				if (ctx->spl_cnt == ctx->spl) {
-					/* Flush line buffers. */
-					g_string_append_len(*out, ctx->lines[j]->str, ctx->lines[j]->len);
-					g_string_append_c(*out, '\n');
-					if (j == ctx->num_enabled_channels - 1 && ctx->trigger > -1) {
-						/*
-						 * Sample data lines have one character per nibble,
-						 * plus one separator per byte. Align trigger marker
-						 * to this layout.
-						 */
-						offset = ctx->trigger / 4 + ctx->trigger / 8;
-						g_string_append_printf(*out, "T:%*s^ %d\n", offset, "", ctx->trigger);
-						ctx->trigger = -1;
-					}
-					g_string_printf(ctx->lines[j], "%s:", ctx->channel_names[j]);
-				}
-			}
-			if (ctx->spl_cnt == ctx->spl)
-				/* Line buffers were already flushed. */
+		/* Reserve space for all the lines which this packet completes. */
+		if (ctx->spl) {
+			size = (ctx->spl_cnt + num_samples) / ctx->spl + 1;
+			size *= ctx->num_enabled_channels * (ctx->line_size + 1);
+			len = out->len;
+			g_string_set_size(out, len + size);
+			g_string_set_size(out, len);
+		}
+
+		/* Work on one line's worth of samples, a channel at a time. */
+		while (num_samples) {
+			count = num_samples;
+			if (ctx->spl)
+				count = MIN(count, (size_t)(ctx->spl - ctx->spl_cnt));
+			for (j = 0; j < ctx->num_enabled_channels; j++)
+				append_channel(ctx, j, data, logic->unitsize, count);
+			ctx->spl_cnt += count;
+			data += count * logic->unitsize;
+			num_samples -= count;
+			if (ctx->spl_cnt == ctx->spl) {
+				/* Flush line buffers. */
+				flush_lines(ctx, out);
 				ctx->spl_cnt = 0;
+			}
 		}
 		break;
 	case SR_DF_END:
 		if (ctx->spl_cnt) {
 			/* Line buffers need flushing. */
-			*out = g_string_sized_new(512);
 			for (i = 0; i < ctx->num_enabled_channels; i++) {
-				if (ctx->spl_cnt & 7)
-					g_string_append_printf(ctx->lines[i], "%.2x ",
-							ctx->sample_buf[i] << (8 - (ctx->spl_cnt & 7)));
-				g_string_append_len(*out, ctx->lines[i]->str, ctx->lines[i]->len);
-				g_string_append_c(*out, '\n');
+				if (ctx->spl_cnt & 7) {
+					byte = ctx->sample_buf[i] << (8 - (ctx->spl_cnt & 7));
+					g_string_append_len(ctx->lines[i],
+						&ctx->hex_text[byte * 3], 3);
+				}
+				g_string_append_len(out, ctx->lines[i]->str, ctx->lines[i]->len);
+				g_string_append_c(out, '\n');
 			}
 		}
 		break;
@@ -262,6 +331,6 @@ SR_PRIV struct sr_output_module output_hex = {
 	.flags = 0,
 	.options = get_options,
 	.init = init,
-	.receive = receive,
+	.receive_sink = receive_sink,
 	.cleanup = cleanup,
 };
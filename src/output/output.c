@@ -18,12 +18,55 @@
  */
 
 #include <config.h>
+#include <errno.h>
 #include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
 /** @cond PRIVATE */
 #define LOG_PREFIX "output"
+
+/* Sinks collect output text up to this size before writing it. */
+#define SINK_FLUSH_SIZE (64 * 1024)
+
+/* Default number of packets which asynchronous outputs queue. */
+#define DEFAULT_QUEUE_DEPTH 16
+
+enum sink_type {
+	SINK_FD,
+	SINK_BUFFER,
+	SINK_CALLBACK,
+};
+
+struct sr_output_sink {
+	enum sink_type type;
+	int fd;
+	sr_output_sink_callback cb;
+	void *cb_data;
+	/* Pending output, reused across packets. */
+	GString *buf;
+};
+
+/* Worker thread and packet queue of an asynchronous output. */
+struct output_worker {
+	struct sr_output_sink *sink;
+	GThread *thread;
+	GMutex mutex;
+	GCond cond;
+	struct sr_datafeed_packet **queue;
+	size_t queue_size, queue_head, queue_count;
+	gboolean quit;
+	/* First error of the module or the sink, reported to the caller. */
+	int error;
+};
 /** @endcond */
 
 /**
@@ -49,6 +92,13 @@
  * Output modules generate a newly allocated GString. The caller is then
  * expected to free this with g_string_free() when finished with it.
  *
+ * Alternatively output can go to a sink, see sr_output_send_sink().
+ * Sinks write to a file descriptor, call a callback, or collect the
+ * output in memory, through one reusable buffer.
+ *
+ * Outputs created by sr_output_new_async() format and write their data
+ * in a separate thread, so that they don't block the datafeed.
+ *
  * @{
  */
 
@@ -61,11 +111,19 @@ extern SR_PRIV struct sr_output_module output_vcd;
 extern SR_PRIV struct sr_output_module output_ols;
 extern SR_PRIV struct sr_output_module output_chronovu_la8;
 extern SR_PRIV struct sr_output_module output_csv;
+extern SR_PRIV struct sr_output_module output_columnar;
 extern SR_PRIV struct sr_output_module output_analog;
+extern SR_PRIV struct sr_output_module output_srnet;
+#ifdef HAVE_SHM_OPEN
+extern SR_PRIV struct sr_output_module output_shmring;
+#endif
 extern SR_PRIV struct sr_output_module output_srzip;
 extern SR_PRIV struct sr_output_module output_wav;
 extern SR_PRIV struct sr_output_module output_wavedrom;
 extern SR_PRIV struct sr_output_module output_null;
+#ifdef HAVE_LIBARROW_GLIB
+extern SR_PRIV struct sr_output_module output_arrow;
+#endif
 /** @endcond */
 
 static const struct sr_output_module *output_module_list[] = {
@@ -79,8 +137,16 @@ static const struct sr_output_module *output_module_list[] = {
 	&output_chronovu_la8,
 	&output_analog,
 	&output_srzip,
+	&output_srnet,
+#ifdef HAVE_SHM_OPEN
+	&output_shmring,
+#endif
+	&output_columnar,
 	&output_wav,
 	&output_wavedrom,
+#ifdef HAVE_LIBARROW_GLIB
+	&output_arrow,
+#endif
 	&output_null,
 	NULL,
 };
@@ -271,7 +337,7 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 	gpointer key, value;
 	int i;
 
-	op = g_malloc(sizeof(struct sr_output));
+	op = g_malloc0(sizeof(struct sr_output));
 	op->module = omod;
 	op->sdi = sdi;
 	op->filename = g_strdup(filename);
@@ -325,20 +391,250 @@ SR_API const struct sr_output *sr_output_new(const struct sr_output_module *omod
 	return op;
 }
 
+/* Get a dense copy of RLE or planar logic data, for modules which need that. */
+static int expand_logic(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_packet *dense, struct sr_datafeed_logic *logic)
+{
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_datafeed_logic_planar *planar;
+
+	if (packet->type == SR_DF_LOGIC_RLE
+			&& !(o->module->flags & SR_OUTPUT_LOGIC_RLE)) {
+		rle = packet->payload;
+		logic->unitsize = rle->unitsize;
+		logic->length = sr_logic_rle_num_samples(rle) * rle->unitsize;
+		logic->data = g_try_malloc(MAX(logic->length, 1));
+		if (!logic->data)
+			return SR_ERR_MALLOC;
+		sr_logic_rle_decode(rle, logic->data);
+	} else if (packet->type == SR_DF_LOGIC_PLANAR
+			&& !(o->module->flags & SR_OUTPUT_LOGIC_PLANAR)) {
+		planar = packet->payload;
+		logic->unitsize = planar->unitsize;
+		logic->length = planar->num_samples * planar->unitsize;
+		logic->data = g_try_malloc(MAX(logic->length, 1));
+		if (!logic->data)
+			return SR_ERR_MALLOC;
+		sr_logic_planar_decode(planar, logic->data);
+	} else {
+		return SR_OK;
+	}
+	dense->type = SR_DF_LOGIC;
+	dense->payload = logic;
+
+	return SR_OK;
+}
+
+/* Pass the output for a packet to a sink, in the caller's thread. */
+static int output_send_sink(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_output_sink *sink)
+{
+	struct sr_datafeed_packet dense;
+	struct sr_datafeed_logic logic;
+	GString *out;
+	int ret;
+
+	dense = *packet;
+	logic.data = NULL;
+	ret = expand_logic(o, packet, &dense, &logic);
+	if (ret != SR_OK)
+		return ret;
+
+	if (o->module->receive_sink) {
+		ret = o->module->receive_sink(o, &dense, sink);
+		/* Write the output, once enough of it is pending. */
+		if (ret == SR_OK)
+			ret = sr_output_sink_append(sink, NULL, 0);
+	} else {
+		out = NULL;
+		ret = o->module->receive(o, &dense, &out);
+		if (ret == SR_OK && out)
+			ret = sr_output_sink_append(sink, out->str, out->len);
+		if (out)
+			g_string_free(out, TRUE);
+	}
+	g_free(logic.data);
+
+	return ret;
+}
+
+/* Take a reference of a packet into the queue of an asynchronous output. */
+static int output_queue(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet)
+{
+	struct output_worker *worker;
+	struct sr_datafeed_packet *ref;
+	int ret;
+
+	worker = o->worker;
+	ret = sr_packet_ref(packet, &ref);
+	if (ret != SR_OK)
+		return ret;
+
+	/* Block while the queue is full, that's the backpressure. */
+	g_mutex_lock(&worker->mutex);
+	while (worker->queue_count == worker->queue_size)
+		g_cond_wait(&worker->cond, &worker->mutex);
+	worker->queue[(worker->queue_head + worker->queue_count)
+		% worker->queue_size] = ref;
+	worker->queue_count++;
+	g_cond_broadcast(&worker->cond);
+	ret = worker->error;
+	g_mutex_unlock(&worker->mutex);
+
+	return ret;
+}
+
+static gpointer output_thread(gpointer data)
+{
+	const struct sr_output *o;
+	struct output_worker *worker;
+	struct sr_datafeed_packet *packet;
+	int ret;
+
+	o = data;
+	worker = o->worker;
+	sr_thread_policy_apply(sr_dev_inst_context(o->sdi), SR_THREAD_CONSUMER);
+
+	g_mutex_lock(&worker->mutex);
+	while (TRUE) {
+		while (!worker->queue_count && !worker->quit)
+			g_cond_wait(&worker->cond, &worker->mutex);
+		/* Only terminate after the queue got drained. */
+		if (!worker->queue_count)
+			break;
+		packet = worker->queue[worker->queue_head];
+		worker->queue_head++;
+		worker->queue_head %= worker->queue_size;
+		worker->queue_count--;
+		g_cond_broadcast(&worker->cond);
+		g_mutex_unlock(&worker->mutex);
+
+		ret = output_send_sink(o, packet, worker->sink);
+		if (ret == SR_OK && packet->type == SR_DF_END)
+			ret = sr_output_sink_flush(worker->sink);
+		sr_packet_unref(packet);
+
+		g_mutex_lock(&worker->mutex);
+		if (ret != SR_OK && worker->error == SR_OK)
+			worker->error = ret;
+	}
+	g_mutex_unlock(&worker->mutex);
+
+	return NULL;
+}
+
+/* Drain the queue, stop the thread, return the first error seen. */
+static int output_worker_stop(struct output_worker *worker)
+{
+	int ret;
+
+	g_mutex_lock(&worker->mutex);
+	worker->quit = TRUE;
+	g_cond_broadcast(&worker->cond);
+	g_mutex_unlock(&worker->mutex);
+	g_thread_join(worker->thread);
+
+	ret = worker->error;
+	if (ret == SR_OK)
+		ret = sr_output_sink_flush(worker->sink);
+	g_free(worker->queue);
+	g_mutex_clear(&worker->mutex);
+	g_cond_clear(&worker->cond);
+	g_free(worker);
+
+	return ret;
+}
+
 /**
  * Send a packet to the specified output instance.
  *
  * The instance's output is returned as a newly allocated GString,
  * which must be freed by the caller.
  *
+ * SR_DF_LOGIC_RLE and SR_DF_LOGIC_PLANAR packets get expanded into
+ * SR_DF_LOGIC packets for output modules which don't have the
+ * SR_OUTPUT_LOGIC_RLE or SR_OUTPUT_LOGIC_PLANAR flag set.
+ *
+ * Asynchronous outputs queue the packet and always return NULL, their
+ * output goes to the sink which they were created with.
+ *
  * @since 0.4.0
  */
 SR_API int sr_output_send(const struct sr_output *o,
 		const struct sr_datafeed_packet *packet, GString **out)
 {
-	return o->module->receive(o, packet, out);
+	struct sr_datafeed_packet dense;
+	struct sr_datafeed_logic logic;
+	struct sr_output_sink sink;
+	int ret;
+
+	*out = NULL;
+	if (o->worker)
+		return output_queue(o, packet);
+
+	dense = *packet;
+	logic.data = NULL;
+	ret = expand_logic(o, packet, &dense, &logic);
+	if (ret != SR_OK)
+		return ret;
+
+	if (o->module->receive) {
+		ret = o->module->receive(o, &dense, out);
+	} else {
+		/* Collect the output of sink based modules in memory. */
+		memset(&sink, 0, sizeof(sink));
+		sink.type = SINK_BUFFER;
+		sink.buf = g_string_sized_new(512);
+		ret = o->module->receive_sink(o, &dense, &sink);
+		if (sink.buf->len)
+			*out = sink.buf;
+		else
+			g_string_free(sink.buf, TRUE);
+	}
+	g_free(logic.data);
+
+	return ret;
 }
 
+/**
+ * Send a packet to the specified output instance, and pass the
+ * resulting output to a sink.
+ *
+ * Modules which support sinks append to the sink's buffer directly,
+ * the output of other modules gets copied there. Output is passed on
+ * by the sink whenever enough of it was collected, or when the sink
+ * gets flushed.
+ *
+ * Asynchronous outputs queue the packet, and pass their output to the
+ * sink which they were created with instead.
+ *
+ * @param o The output instance.
+ * @param packet The packet.
+ * @param sink The sink to pass the output to.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other Error code of the module or the sink.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_send_sink(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet,
+		struct sr_output_sink *sink)
+{
+	if (!o || !packet || !sink)
+		return SR_ERR_ARG;
+
+	if (o->worker)
+		return output_queue(o, packet);
+
+	return output_send_sink(o, packet, sink);
+}
+
+
 /**
  * Free the specified output instance and all associated resources.
  *
@@ -346,18 +642,354 @@ SR_API int sr_output_send(const struct sr_output *o,
  */
 SR_API int sr_output_free(const struct sr_output *o)
 {
-	int ret;
+	int ret, cleanup_ret;
 
 	if (!o)
 		return SR_ERR_ARG;
 
 	ret = SR_OK;
-	if (o->module->cleanup)
-		ret = o->module->cleanup((struct sr_output *)o);
+	if (o->worker)
+		ret = output_worker_stop(o->worker);
+	if (o->module->cleanup) {
+		cleanup_ret = o->module->cleanup((struct sr_output *)o);
+		if (ret == SR_OK)
+			ret = cleanup_ret;
+	}
 	g_free((char *)o->filename);
 	g_free((gpointer)o);
 
 	return ret;
 }
 
+/**
+ * Create a new output instance, which formats and writes its data in
+ * a separate thread.
+ *
+ * Packets which get sent to the instance are referenced, see
+ * sr_packet_ref(), and queued. Senders block while the queue is full.
+ * The output goes to @a sink, which is flushed after each SR_DF_END
+ * packet. sr_output_free() processes all queued packets before the
+ * instance is released.
+ *
+ * Errors of the module or the sink get reported by the subsequent
+ * sr_output_send() calls, and by sr_output_free().
+ *
+ * @param omod The output module.
+ * @param params Module options, see sr_output_new().
+ * @param sdi The device instance.
+ * @param filename The file name, can be NULL.
+ * @param sink The sink for the output. Must remain valid until the
+ *             instance got freed.
+ * @param queue_depth Maximum number of queued packets, 0 for a default.
+ *
+ * @return The new instance, or NULL on errors.
+ *
+ * @since 0.6.0
+ */
+SR_API const struct sr_output *sr_output_new_async(
+		const struct sr_output_module *omod, GHashTable *params,
+		const struct sr_dev_inst *sdi, const char *filename,
+		struct sr_output_sink *sink, size_t queue_depth)
+{
+	struct sr_output *op;
+	struct output_worker *worker;
+
+	if (!omod || !sink)
+		return NULL;
+
+	op = (struct sr_output *)sr_output_new(omod, params, sdi, filename);
+	if (!op)
+		return NULL;
+
+	worker = g_malloc0(sizeof(*worker));
+	worker->sink = sink;
+	worker->queue_size = queue_depth ? queue_depth : DEFAULT_QUEUE_DEPTH;
+	worker->queue = g_malloc0(worker->queue_size * sizeof(worker->queue[0]));
+	g_mutex_init(&worker->mutex);
+	g_cond_init(&worker->cond);
+	op->worker = worker;
+	worker->thread = g_thread_try_new("sr-output", output_thread, op, NULL);
+	if (!worker->thread) {
+		sr_err("Cannot start the output thread.");
+		op->worker = NULL;
+		g_free(worker->queue);
+		g_mutex_clear(&worker->mutex);
+		g_cond_clear(&worker->cond);
+		g_free(worker);
+		sr_output_free(op);
+		return NULL;
+	}
+
+	return op;
+}
+
+/* Write all of the data to a file descriptor, in one or two pieces. */
+static int sink_write_fd(int fd, const uint8_t *a, size_t alen,
+		const uint8_t *b, size_t blen)
+{
+#ifdef HAVE_SYS_UIO_H
+	struct iovec iov[2];
+	int iovcnt;
+#endif
+	ssize_t ret;
+
+#ifdef HAVE_SYS_UIO_H
+	while (alen + blen) {
+		iovcnt = 0;
+		if (alen) {
+			iov[iovcnt].iov_base = (void *)a;
+			iov[iovcnt++].iov_len = alen;
+		}
+		if (blen) {
+			iov[iovcnt].iov_base = (void *)b;
+			iov[iovcnt++].iov_len = blen;
+		}
+		ret = writev(fd, iov, iovcnt);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			goto fail;
+		if ((size_t)ret < alen) {
+			a += ret;
+			alen -= ret;
+			continue;
+		}
+		ret -= alen;
+		alen = 0;
+		b += ret;
+		blen -= ret;
+	}
+#else
+	while (alen) {
+		ret = write(fd, a, alen);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			goto fail;
+		a += ret;
+		alen -= ret;
+	}
+	while (blen) {
+		ret = write(fd, b, blen);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			goto fail;
+		b += ret;
+		blen -= ret;
+	}
+#endif
+
+	return SR_OK;
+
+fail:
+	sr_err("Cannot write output data: %s.", g_strerror(errno));
+	return SR_ERR_IO;
+}
+
+/* Pass the pending buffer, followed by more data, to the destination. */
+static int sink_write(struct sr_output_sink *sink,
+		const uint8_t *data, size_t len)
+{
+	int ret;
+
+	ret = SR_OK;
+	switch (sink->type) {
+	case SINK_FD:
+		ret = sink_write_fd(sink->fd, (const uint8_t *)sink->buf->str,
+			sink->buf->len, data, len);
+		break;
+	case SINK_CALLBACK:
+		if (sink->buf->len)
+			ret = sink->cb((const uint8_t *)sink->buf->str,
+				sink->buf->len, sink->cb_data);
+		if (ret == SR_OK && len)
+			ret = sink->cb(data, len, sink->cb_data);
+		break;
+	case SINK_BUFFER:
+		g_string_append_len(sink->buf, (const char *)data, len);
+		return SR_OK;
+	}
+	g_string_truncate(sink->buf, 0);
+
+	return ret;
+}
+
+static struct sr_output_sink *sink_new(enum sink_type type)
+{
+	struct sr_output_sink *sink;
+
+	sink = g_malloc0(sizeof(*sink));
+	sink->type = type;
+	sink->fd = -1;
+	sink->buf = g_string_sized_new(SINK_FLUSH_SIZE);
+
+	return sink;
+}
+
+/**
+ * Get the text buffer of a sink, which output modules append to.
+ *
+ * @private
+ */
+SR_PRIV GString *sr_output_sink_string(struct sr_output_sink *sink)
+{
+	return sink->buf;
+}
+
+/**
+ * Append data to a sink. Large blocks get written along with the
+ * pending buffer, without copying them. Collected output is written
+ * when enough of it is pending.
+ *
+ * @private
+ */
+SR_PRIV int sr_output_sink_append(struct sr_output_sink *sink,
+		const void *data, size_t len)
+{
+	if (sink->type == SINK_BUFFER || len < SINK_FLUSH_SIZE) {
+		g_string_append_len(sink->buf, data, len);
+		if (sink->type == SINK_BUFFER || sink->buf->len < SINK_FLUSH_SIZE)
+			return SR_OK;
+		return sink_write(sink, NULL, 0);
+	}
+
+	return sink_write(sink, data, len);
+}
+
+/**
+ * Create an output sink which writes to a file descriptor.
+ *
+ * The file descriptor is not closed when the sink gets freed.
+ *
+ * @param fd The file descriptor, open for writing.
+ *
+ * @return The new sink, or NULL for an invalid file descriptor.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_output_sink *sr_output_sink_new_fd(int fd)
+{
+	struct sr_output_sink *sink;
+
+	if (fd < 0)
+		return NULL;
+
+	sink = sink_new(SINK_FD);
+	sink->fd = fd;
+
+	return sink;
+}
+
+/**
+ * Create an output sink which collects all output in memory.
+ *
+ * @see sr_output_sink_buffer_get()
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_output_sink *sr_output_sink_new_buffer(void)
+{
+	return sink_new(SINK_BUFFER);
+}
+
+/**
+ * Create an output sink which passes the output to a callback.
+ *
+ * The callback returns SR_OK, or an error code which is passed on to
+ * the caller of sr_output_send_sink() or sr_output_sink_flush().
+ *
+ * @param cb The callback.
+ * @param cb_data Opaque pointer passed to the callback.
+ *
+ * @return The new sink, or NULL for a NULL callback.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_output_sink *sr_output_sink_new_callback(
+		sr_output_sink_callback cb, void *cb_data)
+{
+	struct sr_output_sink *sink;
+
+	if (!cb)
+		return NULL;
+
+	sink = sink_new(SINK_CALLBACK);
+	sink->cb = cb;
+	sink->cb_data = cb_data;
+
+	return sink;
+}
+
+/**
+ * Get the output which a memory sink has collected.
+ *
+ * @param sink The sink.
+ * @param len Where to store the length of the output.
+ *
+ * @return The output data, which remains owned by the sink and valid
+ *         until more output is sent to it. NULL for other sink types.
+ *
+ * @since 0.6.0
+ */
+SR_API const uint8_t *sr_output_sink_buffer_get(
+		const struct sr_output_sink *sink, size_t *len)
+{
+	if (!sink || sink->type != SINK_BUFFER || !len)
+		return NULL;
+
+	*len = sink->buf->len;
+
+	return (const uint8_t *)sink->buf->str;
+}
+
+/**
+ * Discard the output which a memory sink has collected.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_output_sink_buffer_clear(struct sr_output_sink *sink)
+{
+	if (!sink || sink->type != SINK_BUFFER)
+		return;
+
+	g_string_truncate(sink->buf, 0);
+}
+
+/**
+ * Pass all pending output of a sink to its destination.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_sink_flush(struct sr_output_sink *sink)
+{
+	if (!sink)
+		return SR_ERR_ARG;
+	if (sink->type == SINK_BUFFER || !sink->buf->len)
+		return SR_OK;
+
+	return sink_write(sink, NULL, 0);
+}
+
+/**
+ * Flush and free an output sink.
+ *
+ * @return The result of flushing the sink.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_output_sink_free(struct sr_output_sink *sink)
+{
+	int ret;
+
+	if (!sink)
+		return SR_ERR_ARG;
+
+	ret = sr_output_sink_flush(sink);
+	g_string_free(sink->buf, TRUE);
+	g_free(sink);
+
+	return ret;
+}
+
 /** @} */
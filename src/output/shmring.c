@@ -0,0 +1,862 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Shared memory ring output, and the reader API for it.
+ *
+ * The output module publishes the datafeed into a POSIX shared memory
+ * object. It starts with a header describing the channels, followed by
+ * a ring of records. The producer never waits for readers: any number of
+ * readers follow the ring on their own, and notice when the producer
+ * overwrote data they had not read yet.
+ *
+ * Positions in the ring are absolute byte counts. Before writing a
+ * record the producer advances 'reserve' to the record's end, after
+ * writing it advances 'commit'. A reader copies a record below 'commit',
+ * then checks that 'reserve' did not advance into it meanwhile, much
+ * like a seqlock. Records never wrap around the end of the ring.
+ *
+ * Record payloads, in host byte order:
+ *   HEADER: i32 feed version, i32 reserved, i64 seconds, i64 microseconds
+ *   META:   u32 key, u32 reserved, u64 value (integer keys only)
+ *   LOGIC:  u32 unit size, u32 reserved, samples
+ *   ANALOG: u32 number of samples, u32 number of channels, i32 mq,
+ *           i32 unit, u64 mqflags, i32 digits, i32 spec digits,
+ *           i32 index per channel (padded to 8 bytes), float samples
+ *   FRAME_BEGIN: empty, or u64 sample position
+ *   others: empty
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <string.h>
+#ifdef HAVE_SHM_OPEN
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/shmring"
+
+#define RING_MAGIC "SRSHMRNG"
+#define RING_VERSION 1
+#define DEFAULT_NAME "/sigrok"
+#define DEFAULT_SIZE (64 * 1024 * 1024)
+#define MIN_SIZE (64 * 1024)
+#define PAGE_ALIGN 4096
+#define CHANNEL_NAME_SIZE 36
+/* Records never get larger than this part of the ring. */
+#define MAX_RECORD_PART 4
+
+#define ALIGN8(x) (((x) + 7) & ~(uint64_t)7)
+
+#ifdef HAVE_SHM_OPEN
+
+struct ring_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint64_t data_size;
+	/* End of the record which is being written. */
+	uint64_t reserve;
+	/* End of the last complete record. */
+	uint64_t commit;
+	/* Start of the last complete record, where late readers start. */
+	uint64_t last_record;
+	uint64_t samplerate;
+	uint32_t num_channels;
+	uint32_t closed;
+	uint64_t reserved[2];
+};
+
+struct ring_channel {
+	int32_t index;
+	int32_t type;
+	int32_t enabled;
+	char name[CHANNEL_NAME_SIZE];
+};
+
+struct ring_record {
+	/* SR_DF_* packet type, 0 for padding up to the end of the ring. */
+	uint32_t type;
+	uint32_t length;
+	/* Absolute ring position of this record, for validation. */
+	uint64_t pos;
+};
+
+struct ring_analog {
+	uint32_t num_samples;
+	uint32_t num_channels;
+	int32_t mq;
+	int32_t unit;
+	uint64_t mqflags;
+	int32_t digits;
+	int32_t spec_digits;
+};
+
+struct ring_piece {
+	const void *data;
+	size_t len;
+};
+
+struct context {
+	char *name;
+	int fd;
+	size_t map_size;
+	struct ring_header *hdr;
+	uint8_t *ring;
+	uint64_t mask;
+	uint64_t pos;
+	size_t max_payload;
+};
+
+static uint64_t ring_load(const uint64_t *p)
+{
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static void ring_store(uint64_t *p, uint64_t v)
+{
+	__atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct context *ctx;
+	struct ring_channel *rch;
+	struct sr_channel *ch;
+	GVariant *gvar;
+	GSList *l;
+	const char *name;
+	uint64_t size;
+	size_t header_size, num_channels;
+	void *map;
+
+	name = g_variant_get_string(g_hash_table_lookup(options, "name"), NULL);
+	size = g_variant_get_uint64(g_hash_table_lookup(options, "size"));
+	if (!name || name[0] != '/') {
+		sr_err("The shared memory name must start with a '/'.");
+		return SR_ERR_ARG;
+	}
+	/* Power of two ring sizes allow for masking positions. */
+	size = MAX(size, MIN_SIZE);
+	if (size & (size - 1))
+		size = (uint64_t)1 << g_bit_storage(size);
+
+	num_channels = g_slist_length(o->sdi->channels);
+	header_size = sizeof(struct ring_header)
+		+ num_channels * sizeof(struct ring_channel);
+	header_size = (header_size + PAGE_ALIGN - 1) / PAGE_ALIGN * PAGE_ALIGN;
+
+	ctx = g_malloc0(sizeof(*ctx));
+	ctx->map_size = header_size + size;
+	ctx->fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0600);
+	if (ctx->fd < 0 || ftruncate(ctx->fd, ctx->map_size) != 0) {
+		sr_err("Cannot create shared memory '%s': %s.", name,
+			g_strerror(errno));
+		if (ctx->fd >= 0) {
+			close(ctx->fd);
+			shm_unlink(name);
+		}
+		g_free(ctx);
+		return SR_ERR_IO;
+	}
+	map = mmap(NULL, ctx->map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		ctx->fd, 0);
+	if (map == MAP_FAILED) {
+		sr_err("Cannot map shared memory '%s': %s.", name,
+			g_strerror(errno));
+		close(ctx->fd);
+		shm_unlink(name);
+		g_free(ctx);
+		return SR_ERR_IO;
+	}
+	ctx->name = g_strdup(name);
+	ctx->hdr = map;
+	ctx->ring = (uint8_t *)map + header_size;
+	ctx->mask = size - 1;
+	ctx->max_payload = size / MAX_RECORD_PART - sizeof(struct ring_record);
+	o->priv = ctx;
+
+	ctx->hdr->version = RING_VERSION;
+	ctx->hdr->header_size = header_size;
+	ctx->hdr->data_size = size;
+	ctx->hdr->num_channels = num_channels;
+	if (sr_config_get(o->sdi->driver, o->sdi, NULL, SR_CONF_SAMPLERATE,
+			&gvar) == SR_OK) {
+		ctx->hdr->samplerate = g_variant_get_uint64(gvar);
+		g_variant_unref(gvar);
+	}
+	rch = (struct ring_channel *)(ctx->hdr + 1);
+	for (l = o->sdi->channels; l; l = l->next, rch++) {
+		ch = l->data;
+		rch->index = ch->index;
+		rch->type = ch->type;
+		rch->enabled = ch->enabled;
+		g_strlcpy(rch->name, ch->name, sizeof(rch->name));
+	}
+	/* The magic goes last, readers may attach from now on. */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(ctx->hdr->magic, RING_MAGIC, sizeof(ctx->hdr->magic));
+
+	return SR_OK;
+}
+
+/* Publish one record, made of the given pieces. */
+static void write_record(struct context *ctx, uint32_t type,
+	const struct ring_piece *pieces, size_t num_pieces)
+{
+	struct ring_record *rec;
+	uint64_t len, size, off, pad;
+	uint8_t *dst;
+	size_t i;
+
+	len = 0;
+	for (i = 0; i < num_pieces; i++)
+		len += pieces[i].len;
+	size = sizeof(*rec) + ALIGN8(len);
+
+	/* Pad up to the end of the ring, if the record does not fit. */
+	off = ctx->pos & ctx->mask;
+	pad = ctx->mask + 1 - off;
+	if (pad < size) {
+		ring_store(&ctx->hdr->reserve, ctx->pos + pad);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		if (pad >= sizeof(*rec)) {
+			rec = (struct ring_record *)(ctx->ring + off);
+			rec->type = 0;
+			rec->length = pad - sizeof(*rec);
+			rec->pos = ctx->pos;
+		}
+		ctx->pos += pad;
+		ring_store(&ctx->hdr->commit, ctx->pos);
+		off = 0;
+	}
+
+	ring_store(&ctx->hdr->reserve, ctx->pos + size);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	rec = (struct ring_record *)(ctx->ring + off);
+	rec->type = type;
+	rec->length = len;
+	rec->pos = ctx->pos;
+	dst = (uint8_t *)(rec + 1);
+	for (i = 0; i < num_pieces; i++) {
+		memcpy(dst, pieces[i].data, pieces[i].len);
+		dst += pieces[i].len;
+	}
+	ring_store(&ctx->hdr->last_record, ctx->pos);
+	ctx->pos += size;
+	ring_store(&ctx->hdr->commit, ctx->pos);
+}
+
+static void write_logic(struct context *ctx,
+	const struct sr_datafeed_logic *logic)
+{
+	struct ring_piece pieces[2];
+	uint32_t head[2];
+	const uint8_t *data;
+	size_t len, max, n;
+
+	if (!logic->unitsize)
+		return;
+	head[0] = logic->unitsize;
+	head[1] = 0;
+	max = ctx->max_payload - sizeof(head);
+	max -= max % logic->unitsize;
+	data = logic->data;
+	len = logic->length - logic->length % logic->unitsize;
+	while (len) {
+		n = MIN(len, max);
+		pieces[0].data = head;
+		pieces[0].len = sizeof(head);
+		pieces[1].data = data;
+		pieces[1].len = n;
+		write_record(ctx, SR_DF_LOGIC, pieces, 2);
+		data += n;
+		len -= n;
+	}
+}
+
+static int write_analog(struct context *ctx,
+	const struct sr_datafeed_analog *analog)
+{
+	struct ring_piece pieces[3];
+	struct ring_analog head;
+	struct sr_channel *ch;
+	int32_t *indices;
+	float *fdata;
+	GSList *l;
+	size_t num_channels, indices_len, chunk, done, n, i;
+	int ret;
+
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (!num_channels || !analog->num_samples)
+		return SR_OK;
+	fdata = g_try_malloc(sizeof(float) * analog->num_samples * num_channels);
+	if (!fdata)
+		return SR_ERR_MALLOC;
+	if ((ret = sr_analog_to_float(analog, fdata)) != SR_OK) {
+		g_free(fdata);
+		return ret;
+	}
+
+	indices_len = ALIGN8(sizeof(int32_t) * num_channels);
+	indices = g_malloc0(indices_len);
+	for (l = analog->meaning->channels, i = 0; l; l = l->next, i++) {
+		ch = l->data;
+		indices[i] = ch->index;
+	}
+
+	memset(&head, 0, sizeof(head));
+	head.num_channels = num_channels;
+	head.mq = analog->meaning->mq;
+	head.unit = analog->meaning->unit;
+	head.mqflags = analog->meaning->mqflags;
+	head.digits = analog->encoding->digits;
+	head.spec_digits = analog->spec->spec_digits;
+
+	chunk = (ctx->max_payload - sizeof(head) - indices_len)
+		/ (sizeof(float) * num_channels);
+	chunk = MAX(chunk, 1);
+	for (done = 0; done < analog->num_samples; done += n) {
+		n = MIN(chunk, analog->num_samples - done);
+		head.num_samples = n;
+		pieces[0].data = &head;
+		pieces[0].len = sizeof(head);
+		pieces[1].data = indices;
+		pieces[1].len = indices_len;
+		pieces[2].data = fdata + done * num_channels;
+		pieces[2].len = sizeof(float) * n * num_channels;
+		write_record(ctx, SR_DF_ANALOG, pieces, 3);
+	}
+	g_free(indices);
+	g_free(fdata);
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
+		GString **out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_header *header;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_datafeed_frame *frame;
+	const struct sr_config *src;
+	struct ring_piece piece;
+	int64_t head[3];
+	uint64_t item[2];
+	GSList *l;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(ctx = o->priv))
+		return SR_ERR_ARG;
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		header = packet->payload;
+		head[0] = header->feed_version;
+		head[1] = header->starttime.tv_sec;
+		head[2] = header->starttime.tv_usec;
+		piece.data = head;
+		piece.len = sizeof(head);
+		write_record(ctx, packet->type, &piece, 1);
+		break;
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (!g_variant_is_of_type(src->data, G_VARIANT_TYPE_UINT64))
+				continue;
+			item[0] = src->key;
+			item[1] = g_variant_get_uint64(src->data);
+			if (src->key == SR_CONF_SAMPLERATE)
+				ring_store(&ctx->hdr->samplerate, item[1]);
+			piece.data = item;
+			piece.len = sizeof(item);
+			write_record(ctx, packet->type, &piece, 1);
+		}
+		break;
+	case SR_DF_LOGIC:
+		write_logic(ctx, packet->payload);
+		break;
+	case SR_DF_ANALOG:
+		return write_analog(ctx, packet->payload);
+	case SR_DF_FRAME_BEGIN:
+		if ((frame = packet->payload)) {
+			piece.data = &frame->sample_pos;
+			piece.len = sizeof(frame->sample_pos);
+			write_record(ctx, packet->type, &piece, 1);
+			break;
+		}
+		/* Fall through. */
+	case SR_DF_TRIGGER:
+	case SR_DF_FRAME_END:
+	case SR_DF_END:
+		write_record(ctx, packet->type, NULL, 0);
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct context *ctx;
+
+	if (!o || !(ctx = o->priv))
+		return SR_OK;
+
+	/* Attached readers keep their mapping, new ones cannot attach. */
+	__atomic_store_n(&ctx->hdr->closed, 1, __ATOMIC_RELEASE);
+	munmap(ctx->hdr, ctx->map_size);
+	close(ctx->fd);
+	shm_unlink(ctx->name);
+	g_free(ctx->name);
+	g_free(ctx);
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "name", "Name", "Name of the shared memory object, starting with '/'", NULL, NULL },
+	{ "size", "Size", "Size of the ring in bytes, rounded up to a power of two", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string(DEFAULT_NAME));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint64(DEFAULT_SIZE));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_output_module output_shmring = {
+	.id = "shmring",
+	.name = "Shared memory ring",
+	.desc = "Shared memory ring buffer for readers on the same host",
+	.exts = NULL,
+	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING,
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
+
+/** @cond PRIVATE */
+struct sr_shm_reader {
+	int fd;
+	size_t map_size;
+	const struct ring_header *hdr;
+	const uint8_t *ring;
+	uint64_t mask;
+	uint64_t pos;
+	struct sr_dev_inst *sdi;
+	/* The last packet, valid until the next read. */
+	uint8_t *buf;
+	size_t buf_size;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_header header;
+	struct sr_datafeed_meta meta;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_frame frame;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+};
+/** @endcond */
+
+#endif
+
+/**
+ * @addtogroup grp_output
+ *
+ * @{
+ */
+
+/**
+ * Attach to the shared memory ring of a "shmring" output.
+ *
+ * The reader starts at the most recent packet. Reading does not involve
+ * any system calls.
+ *
+ * @param name The shared memory name which the output was created with.
+ * @param reader A pointer which will point to the new reader.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid arguments.
+ * @retval SR_ERR_IO There is no ring of that name.
+ * @retval SR_ERR_DATA The shared memory is not a ring, or not ready yet.
+ * @retval SR_ERR_NA Shared memory is not supported on this platform.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_shm_reader_open(const char *name, struct sr_shm_reader **reader)
+{
+#ifdef HAVE_SHM_OPEN
+	struct sr_shm_reader *r;
+	const struct ring_channel *rch;
+	struct ring_header hdr;
+	struct stat st;
+	char chname[CHANNEL_NAME_SIZE + 1];
+	void *map;
+	uint32_t i;
+
+	if (!name || !reader)
+		return SR_ERR_ARG;
+	*reader = NULL;
+
+	r = g_malloc0(sizeof(*r));
+	r->fd = shm_open(name, O_RDONLY, 0);
+	if (r->fd < 0 || fstat(r->fd, &st) != 0
+			|| (size_t)st.st_size < sizeof(hdr)) {
+		sr_err("Cannot open shared memory '%s': %s.", name,
+			g_strerror(errno));
+		if (r->fd >= 0)
+			close(r->fd);
+		g_free(r);
+		return SR_ERR_IO;
+	}
+	r->map_size = st.st_size;
+	map = mmap(NULL, r->map_size, PROT_READ, MAP_SHARED, r->fd, 0);
+	if (map == MAP_FAILED) {
+		sr_err("Cannot map shared memory '%s': %s.", name,
+			g_strerror(errno));
+		close(r->fd);
+		g_free(r);
+		return SR_ERR_IO;
+	}
+	r->hdr = map;
+
+	memcpy(&hdr, r->hdr, sizeof(hdr));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (memcmp(hdr.magic, RING_MAGIC, sizeof(hdr.magic))
+			|| hdr.version != RING_VERSION
+			|| hdr.header_size + hdr.data_size != r->map_size
+			|| hdr.header_size < sizeof(hdr)
+				+ hdr.num_channels * sizeof(*rch)) {
+		sr_err("Shared memory '%s' is not a sigrok ring.", name);
+		munmap(map, r->map_size);
+		close(r->fd);
+		g_free(r);
+		return SR_ERR_DATA;
+	}
+	r->ring = (const uint8_t *)map + hdr.header_size;
+	r->mask = hdr.data_size - 1;
+	r->pos = ring_load(&r->hdr->last_record);
+
+	r->sdi = g_malloc0(sizeof(*r->sdi));
+	rch = (const struct ring_channel *)(r->hdr + 1);
+	for (i = 0; i < hdr.num_channels; i++, rch++) {
+		memcpy(chname, rch->name, CHANNEL_NAME_SIZE);
+		chname[CHANNEL_NAME_SIZE] = '\0';
+		sr_channel_new(r->sdi, rch->index, rch->type, rch->enabled,
+			chname);
+	}
+	*reader = r;
+
+	return SR_OK;
+#else
+	(void)name;
+	(void)reader;
+
+	return SR_ERR_NA;
+#endif
+}
+
+/**
+ * Get the device instance which holds the ring's channels.
+ *
+ * The analog packets of sr_shm_reader_read() refer to its channels.
+ *
+ * @param reader The reader.
+ *
+ * @return The device instance, owned by the reader.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_dev_inst *sr_shm_reader_dev_inst_get(
+		const struct sr_shm_reader *reader)
+{
+#ifdef HAVE_SHM_OPEN
+	return reader ? reader->sdi : NULL;
+#else
+	(void)reader;
+
+	return NULL;
+#endif
+}
+
+/**
+ * Get the ring's most recent samplerate.
+ *
+ * @param reader The reader.
+ *
+ * @return The samplerate in Hz, 0 when not known.
+ *
+ * @since 0.6.0
+ */
+SR_API uint64_t sr_shm_reader_samplerate_get(const struct sr_shm_reader *reader)
+{
+#ifdef HAVE_SHM_OPEN
+	return reader ? ring_load(&reader->hdr->samplerate) : 0;
+#else
+	(void)reader;
+
+	return 0;
+#endif
+}
+
+#ifdef HAVE_SHM_OPEN
+static void reader_resync(struct sr_shm_reader *r)
+{
+	sr_warn("The reader fell behind, packets got lost.");
+	r->pos = ring_load(&r->hdr->last_record);
+}
+
+static int reader_decode(struct sr_shm_reader *r, uint32_t type, size_t len)
+{
+	const struct ring_analog *head;
+	const int32_t *indices;
+	const uint64_t *item;
+	const int64_t *hdr;
+	GSList *l;
+	uint32_t i;
+
+	memset(&r->packet, 0, sizeof(r->packet));
+	r->packet.type = type;
+	switch (type) {
+	case SR_DF_HEADER:
+		if (len < 3 * sizeof(int64_t))
+			return SR_ERR_DATA;
+		hdr = (const int64_t *)r->buf;
+		r->header.feed_version = hdr[0];
+		r->header.starttime.tv_sec = hdr[1];
+		r->header.starttime.tv_usec = hdr[2];
+		r->packet.payload = &r->header;
+		break;
+	case SR_DF_META:
+		if (len < 2 * sizeof(uint64_t))
+			return SR_ERR_DATA;
+		item = (const uint64_t *)r->buf;
+		r->meta.config = g_slist_append(NULL, sr_config_new(item[0],
+			g_variant_new_uint64(item[1])));
+		r->packet.payload = &r->meta;
+		break;
+	case SR_DF_LOGIC:
+		if (len < 8 || !*(const uint32_t *)r->buf)
+			return SR_ERR_DATA;
+		r->logic.unitsize = *(const uint32_t *)r->buf;
+		r->logic.length = len - 8;
+		r->logic.data = r->buf + 8;
+		r->packet.payload = &r->logic;
+		break;
+	case SR_DF_ANALOG:
+		head = (const struct ring_analog *)r->buf;
+		if (len < sizeof(*head) || len < sizeof(*head)
+				+ ALIGN8(sizeof(int32_t) * head->num_channels)
+				+ sizeof(float) * (uint64_t)head->num_samples
+					* head->num_channels)
+			return SR_ERR_DATA;
+		sr_analog_init(&r->analog, &r->encoding, &r->meaning, &r->spec,
+			head->digits);
+		r->spec.spec_digits = head->spec_digits;
+		r->meaning.mq = head->mq;
+		r->meaning.unit = head->unit;
+		r->meaning.mqflags = head->mqflags;
+		indices = (const int32_t *)(head + 1);
+		for (i = 0; i < head->num_channels; i++) {
+			for (l = r->sdi->channels; l; l = l->next) {
+				if (((struct sr_channel *)l->data)->index == indices[i])
+					break;
+			}
+			if (!l)
+				return SR_ERR_DATA;
+			r->meaning.channels = g_slist_append(r->meaning.channels,
+				l->data);
+		}
+		r->analog.num_samples = head->num_samples;
+		r->analog.data = (uint8_t *)indices
+			+ ALIGN8(sizeof(int32_t) * head->num_channels);
+		r->packet.payload = &r->analog;
+		break;
+	case SR_DF_FRAME_BEGIN:
+		if (len >= sizeof(uint64_t)) {
+			r->frame.sample_pos = *(const uint64_t *)r->buf;
+			r->packet.payload = &r->frame;
+		}
+		break;
+	}
+
+	return SR_OK;
+}
+
+static void reader_release(struct sr_shm_reader *r)
+{
+	g_slist_free_full(r->meta.config, (GDestroyNotify)sr_config_free);
+	r->meta.config = NULL;
+	g_slist_free(r->meaning.channels);
+	r->meaning.channels = NULL;
+}
+#endif
+
+/**
+ * Read the next packet from the ring.
+ *
+ * @param reader The reader.
+ * @param packet A pointer which will point to the packet. The packet and
+ *               its payload belong to the reader, and stay valid until
+ *               the next call.
+ *
+ * @retval SR_OK A packet was read.
+ * @retval SR_ERR_NA No packet is available yet.
+ * @retval SR_ERR_DATA The producer overwrote packets which were not read
+ *         yet. The reader continues at the most recent packet.
+ * @retval SR_ERR_ARG Invalid arguments.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_shm_reader_read(struct sr_shm_reader *reader,
+		const struct sr_datafeed_packet **packet)
+{
+#ifdef HAVE_SHM_OPEN
+	struct sr_shm_reader *r;
+	struct ring_record rec;
+	uint64_t commit, size, off, space;
+	int ret;
+
+	if (!reader || !packet)
+		return SR_ERR_ARG;
+	r = reader;
+	*packet = NULL;
+	reader_release(r);
+
+	for (;;) {
+		commit = ring_load(&r->hdr->commit);
+		if (r->pos == commit)
+			return SR_ERR_NA;
+		if (commit - r->pos > r->mask + 1) {
+			reader_resync(r);
+			return SR_ERR_DATA;
+		}
+
+		off = r->pos & r->mask;
+		space = r->mask + 1 - off;
+		if (space < sizeof(rec)) {
+			/* Implicit padding at the end of the ring. */
+			r->pos += space;
+			continue;
+		}
+		memcpy(&rec, r->ring + off, sizeof(rec));
+		size = sizeof(rec) + ALIGN8(rec.length);
+		if (rec.pos != r->pos || size > space) {
+			reader_resync(r);
+			return SR_ERR_DATA;
+		}
+		if (rec.length > r->buf_size) {
+			g_free(r->buf);
+			r->buf_size = ALIGN8(rec.length);
+			r->buf = g_malloc(r->buf_size);
+		}
+		memcpy(r->buf, r->ring + off + sizeof(rec), rec.length);
+
+		/* The copy is only good when it was not overwritten meanwhile. */
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&r->hdr->reserve, __ATOMIC_RELAXED) - r->pos
+				> r->mask + 1) {
+			reader_resync(r);
+			return SR_ERR_DATA;
+		}
+		r->pos += size;
+		if (rec.type == 0)
+			continue;
+
+		if ((ret = reader_decode(r, rec.type, rec.length)) != SR_OK) {
+			reader_release(r);
+			return ret;
+		}
+		*packet = &r->packet;
+
+		return SR_OK;
+	}
+#else
+	(void)reader;
+	(void)packet;
+
+	return SR_ERR_NA;
+#endif
+}
+
+/**
+ * Check whether the producer of the ring has finished.
+ *
+ * Packets before that may still be available for reading.
+ *
+ * @param reader The reader.
+ *
+ * @return TRUE when the output which writes into the ring was freed.
+ *
+ * @since 0.6.0
+ */
+SR_API gboolean sr_shm_reader_closed(const struct sr_shm_reader *reader)
+{
+#ifdef HAVE_SHM_OPEN
+	return reader ? __atomic_load_n(&reader->hdr->closed,
+		__ATOMIC_ACQUIRE) != 0 : TRUE;
+#else
+	(void)reader;
+
+	return TRUE;
+#endif
+}
+
+/**
+ * Detach from the ring, and free the reader.
+ *
+ * @param reader The reader.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_shm_reader_close(struct sr_shm_reader *reader)
+{
+#ifdef HAVE_SHM_OPEN
+	if (!reader)
+		return;
+
+	reader_release(reader);
+	munmap((void *)reader->hdr, reader->map_size);
+	close(reader->fd);
+	sr_dev_inst_free(reader->sdi);
+	g_free(reader->buf);
+	g_free(reader);
+#else
+	(void)reader;
+#endif
+}
+
+/** @} */
@@ -0,0 +1,570 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Streams the datafeed in the binary framing which the "srnet" input
+ * module reads back (see libsigrok-internal.h for the frame header).
+ *
+ * Without a "host" the stream is returned as the module's text, so it
+ * can be written to a file or piped into a network tool. With a "host"
+ * the module connects there by TCP, or sends one UDP datagram per frame
+ * (which works for multicast groups, too).
+ *
+ * Frame payloads:
+ *   HEADER:      u32 feed version, u64 start time seconds, u64 start time
+ *                microseconds, u32 number of channels, then per channel
+ *                u32 index, u32 type, u32 enabled, u32 name length, name
+ *   META:        u32 number of items, then per item u32 key, u32 type
+ *                string length, type string, u32 data length, serialized
+ *                little endian GVariant data
+ *   LOGIC:       u32 unit size, samples
+ *   ANALOG:      u32 number of samples, u32 number of channels, u32 mq,
+ *                u32 unit, u64 mqflags, i32 digits, i32 spec digits,
+ *                u32 index per channel, interleaved float32 samples
+ *   FRAME_BEGIN: empty, or u64 sample position
+ *   others:      empty
+ *
+ * Consecutive logic packets get batched into frames of up to "batch_size"
+ * bytes. Frames may be LZ4 compressed, when that pays off.
+ */
+
+#include <config.h>
+#ifdef _WIN32
+#define _WIN32_WINNT 0x0501
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#endif
+#ifdef HAVE_LIBLZ4
+#include <lz4.h>
+#endif
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "output/srnet"
+
+#define DEFAULT_PORT 5555
+#define DEFAULT_BATCH_SIZE (64 * 1024)
+#define MIN_BATCH_SIZE 4096
+/* Largest UDP payload, minus the frame header. */
+#define UDP_MAX_PAYLOAD (65507 - SRNET_FRAME_HEADER_SIZE)
+/* Fixed part of an ANALOG payload. */
+#define ANALOG_HEADER_SIZE 32
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+struct context {
+	int socket;
+	gboolean udp;
+	gboolean compress;
+	size_t max_payload;
+	/* Pending LOGIC payload, unit size followed by the samples. */
+	GByteArray *logic;
+	uint16_t logic_unitsize;
+	GByteArray *payload;
+	GString *tx;
+	uint8_t *lz4_buf;
+	size_t lz4_size;
+};
+
+static void put_u32(GByteArray *a, uint32_t v)
+{
+	uint8_t buf[sizeof(v)];
+
+	WL32(buf, v);
+	g_byte_array_append(a, buf, sizeof(buf));
+}
+
+static void put_u64(GByteArray *a, uint64_t v)
+{
+	uint8_t buf[sizeof(v)];
+
+	WL64(buf, v);
+	g_byte_array_append(a, buf, sizeof(buf));
+}
+
+static void put_string(GByteArray *a, const char *s)
+{
+	size_t len;
+
+	len = s ? strlen(s) : 0;
+	put_u32(a, len);
+	g_byte_array_append(a, (const guint8 *)s, len);
+}
+
+static int send_all(int fd, const void *data, size_t len)
+{
+	const char *p;
+	ssize_t ret;
+
+	p = data;
+	while (len) {
+		ret = send(fd, p, len, MSG_NOSIGNAL);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			sr_err("Cannot send the stream: %s.", g_strerror(errno));
+			return SR_ERR_IO;
+		}
+		p += ret;
+		len -= ret;
+	}
+
+	return SR_OK;
+}
+
+static int connect_host(struct context *ctx, const char *host, uint32_t port)
+{
+	struct addrinfo hints, *results, *res;
+	char service[16];
+	int err;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = ctx->udp ? SOCK_DGRAM : SOCK_STREAM;
+	hints.ai_protocol = ctx->udp ? IPPROTO_UDP : IPPROTO_TCP;
+	snprintf(service, sizeof(service), "%" PRIu32, port);
+
+	err = getaddrinfo(host, service, &hints, &results);
+	if (err) {
+		sr_err("Address lookup failed: %s:%s: %s", host, service,
+			gai_strerror(err));
+		return SR_ERR;
+	}
+
+	/* A connected UDP socket sends all datagrams to that address. */
+	for (res = results; res; res = res->ai_next) {
+		if ((ctx->socket = socket(res->ai_family, res->ai_socktype,
+				res->ai_protocol)) < 0)
+			continue;
+		if (connect(ctx->socket, res->ai_addr, res->ai_addrlen) != 0) {
+			close(ctx->socket);
+			ctx->socket = -1;
+			continue;
+		}
+		break;
+	}
+	freeaddrinfo(results);
+
+	if (ctx->socket < 0) {
+		sr_err("Failed to connect to %s:%s: %s", host, service,
+			g_strerror(errno));
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+static int emit_frame(struct context *ctx, enum srnet_frame_type type,
+	const uint8_t *data, size_t len)
+{
+	uint8_t hdr[SRNET_FRAME_HEADER_SIZE];
+	const uint8_t *body;
+	size_t body_len;
+	uint8_t flags;
+	int ret;
+
+	body = data;
+	body_len = len;
+	flags = 0;
+#ifdef HAVE_LIBLZ4
+	if (ctx->compress && len) {
+		size_t bound;
+		int clen;
+
+		bound = LZ4_compressBound(len);
+		if (bound > ctx->lz4_size) {
+			g_free(ctx->lz4_buf);
+			ctx->lz4_buf = g_malloc(bound);
+			ctx->lz4_size = bound;
+		}
+		clen = LZ4_compress_default((const char *)data,
+			(char *)ctx->lz4_buf, len, bound);
+		/* Only keep compressed payloads which got smaller. */
+		if (clen > 0 && (size_t)clen < len) {
+			body = ctx->lz4_buf;
+			body_len = clen;
+			flags |= SRNET_FLAG_LZ4;
+		}
+	}
+#endif
+
+	hdr[0] = type;
+	hdr[1] = flags;
+	hdr[2] = hdr[3] = 0;
+	WL32(&hdr[4], body_len);
+	WL32(&hdr[8], len);
+
+	if (!ctx->udp) {
+		g_string_append_len(ctx->tx, (const char *)hdr, sizeof(hdr));
+		g_string_append_len(ctx->tx, (const char *)body, body_len);
+		return SR_OK;
+	}
+
+	/* One frame per datagram. */
+	g_string_truncate(ctx->tx, 0);
+	g_string_append_len(ctx->tx, (const char *)hdr, sizeof(hdr));
+	g_string_append_len(ctx->tx, (const char *)body, body_len);
+	ret = send_all(ctx->socket, ctx->tx->str, ctx->tx->len);
+	g_string_truncate(ctx->tx, 0);
+
+	return ret;
+}
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct context *ctx;
+	const char *host, *transport;
+	uint8_t start[SRNET_MAGIC_SIZE + sizeof(uint32_t)];
+	uint64_t batch_size;
+	uint32_t port;
+	int ret;
+
+	host = g_variant_get_string(g_hash_table_lookup(options, "host"), NULL);
+	port = g_variant_get_uint32(g_hash_table_lookup(options, "port"));
+	transport = g_variant_get_string(g_hash_table_lookup(options, "transport"), NULL);
+	batch_size = g_variant_get_uint64(g_hash_table_lookup(options, "batch_size"));
+
+	ctx = g_malloc0(sizeof(*ctx));
+	o->priv = ctx;
+	ctx->socket = -1;
+	ctx->udp = !strcmp(transport, "udp");
+	ctx->compress = g_variant_get_boolean(g_hash_table_lookup(options, "compress"));
+	ctx->logic = g_byte_array_new();
+	ctx->payload = g_byte_array_new();
+	ctx->tx = g_string_sized_new(DEFAULT_BATCH_SIZE);
+
+	ctx->max_payload = MAX(batch_size, MIN_BATCH_SIZE);
+	if (ctx->udp)
+		ctx->max_payload = MIN(ctx->max_payload, UDP_MAX_PAYLOAD);
+
+	ret = SR_OK;
+#ifndef HAVE_LIBLZ4
+	if (ctx->compress) {
+		sr_err("LZ4 compression is not supported by this build.");
+		ret = SR_ERR_ARG;
+	}
+#endif
+	if (ret == SR_OK && ctx->udp && !*host) {
+		sr_err("The UDP transport requires a host.");
+		ret = SR_ERR_ARG;
+	}
+	if (ret == SR_OK && *host)
+		ret = connect_host(ctx, host, port);
+	if (ret != SR_OK) {
+		o->module->cleanup(o);
+		return ret;
+	}
+
+	memcpy(start, SRNET_MAGIC, SRNET_MAGIC_SIZE);
+	WL32(&start[SRNET_MAGIC_SIZE], SRNET_VERSION);
+	if (ctx->udp)
+		return send_all(ctx->socket, start, sizeof(start));
+	g_string_append_len(ctx->tx, (const char *)start, sizeof(start));
+
+	return SR_OK;
+}
+
+static int flush_logic(struct context *ctx)
+{
+	int ret;
+
+	if (!ctx->logic->len)
+		return SR_OK;
+	ret = emit_frame(ctx, SRNET_LOGIC, ctx->logic->data, ctx->logic->len);
+	g_byte_array_set_size(ctx->logic, 0);
+
+	return ret;
+}
+
+static int add_logic(struct context *ctx, const struct sr_datafeed_logic *logic)
+{
+	const uint8_t *data;
+	size_t len, max, n;
+	int ret;
+
+	if (!logic->unitsize)
+		return SR_OK;
+	if (ctx->logic->len && ctx->logic_unitsize != logic->unitsize) {
+		if ((ret = flush_logic(ctx)) != SR_OK)
+			return ret;
+	}
+	ctx->logic_unitsize = logic->unitsize;
+
+	/* Frames always hold whole samples. */
+	max = ctx->max_payload - sizeof(uint32_t);
+	max -= max % logic->unitsize;
+	data = logic->data;
+	len = logic->length - logic->length % logic->unitsize;
+	while (len) {
+		if (!ctx->logic->len)
+			put_u32(ctx->logic, logic->unitsize);
+		n = MIN(len, max - (ctx->logic->len - sizeof(uint32_t)));
+		g_byte_array_append(ctx->logic, data, n);
+		data += n;
+		len -= n;
+		if (ctx->logic->len - sizeof(uint32_t) >= max) {
+			if ((ret = flush_logic(ctx)) != SR_OK)
+				return ret;
+		}
+	}
+
+	return SR_OK;
+}
+
+static int send_header(const struct sr_output *o,
+	const struct sr_datafeed_header *header)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	GByteArray *p;
+	GSList *l;
+
+	ctx = o->priv;
+	p = ctx->payload;
+	g_byte_array_set_size(p, 0);
+	put_u32(p, header->feed_version);
+	put_u64(p, header->starttime.tv_sec);
+	put_u64(p, header->starttime.tv_usec);
+	put_u32(p, g_slist_length(o->sdi->channels));
+	for (l = o->sdi->channels; l; l = l->next) {
+		ch = l->data;
+		put_u32(p, ch->index);
+		put_u32(p, ch->type);
+		put_u32(p, ch->enabled);
+		put_string(p, ch->name);
+	}
+
+	return emit_frame(ctx, SRNET_HEADER, p->data, p->len);
+}
+
+static int send_meta(struct context *ctx, const struct sr_datafeed_meta *meta)
+{
+	const struct sr_config *src;
+	GVariant *data;
+	GByteArray *p;
+	GSList *l;
+
+	p = ctx->payload;
+	g_byte_array_set_size(p, 0);
+	put_u32(p, g_slist_length(meta->config));
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		data = g_variant_get_normal_form(src->data);
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+		{
+			GVariant *swapped = g_variant_byteswap(data);
+			g_variant_unref(data);
+			data = swapped;
+		}
+#endif
+		put_u32(p, src->key);
+		put_string(p, g_variant_get_type_string(data));
+		put_u32(p, g_variant_get_size(data));
+		g_byte_array_append(p, g_variant_get_data(data),
+			g_variant_get_size(data));
+		g_variant_unref(data);
+	}
+
+	return emit_frame(ctx, SRNET_META, p->data, p->len);
+}
+
+static int send_analog(struct context *ctx,
+	const struct sr_datafeed_analog *analog)
+{
+	struct sr_channel *ch;
+	GByteArray *p;
+	GSList *l;
+	float *fdata;
+	uint8_t *dst;
+	size_t num_channels, chunk, done, n, i;
+	int ret;
+
+	num_channels = g_slist_length(analog->meaning->channels);
+	if (!num_channels || !analog->num_samples)
+		return SR_OK;
+	fdata = g_try_malloc(sizeof(float) * analog->num_samples * num_channels);
+	if (!fdata)
+		return SR_ERR_MALLOC;
+	if ((ret = sr_analog_to_float(analog, fdata)) != SR_OK) {
+		g_free(fdata);
+		return ret;
+	}
+
+	/* Split into frames which stay below the payload limit. */
+	chunk = ctx->max_payload - ANALOG_HEADER_SIZE - 4 * num_channels;
+	chunk = MAX(chunk / (sizeof(float) * num_channels), 1);
+
+	p = ctx->payload;
+	for (done = 0; done < analog->num_samples && ret == SR_OK; done += n) {
+		n = MIN(chunk, analog->num_samples - done);
+		g_byte_array_set_size(p, 0);
+		put_u32(p, n);
+		put_u32(p, num_channels);
+		put_u32(p, analog->meaning->mq);
+		put_u32(p, analog->meaning->unit);
+		put_u64(p, analog->meaning->mqflags);
+		put_u32(p, analog->encoding->digits);
+		put_u32(p, analog->spec->spec_digits);
+		for (l = analog->meaning->channels; l; l = l->next) {
+			ch = l->data;
+			put_u32(p, ch->index);
+		}
+		i = p->len;
+		g_byte_array_set_size(p, i + sizeof(float) * n * num_channels);
+		dst = p->data + i;
+		for (i = 0; i < n * num_channels; i++)
+			write_fltle_inc(&dst, fdata[done * num_channels + i]);
+		ret = emit_frame(ctx, SRNET_ANALOG, p->data, p->len);
+	}
+	g_free(fdata);
+
+	return ret;
+}
+
+static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
+		GString **out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_frame *frame;
+	uint8_t pos[sizeof(uint64_t)];
+	int ret;
+
+	*out = NULL;
+	if (!o || !o->sdi || !(ctx = o->priv))
+		return SR_ERR_ARG;
+
+	/* Everything but more logic data ends the current batch. */
+	if (packet->type != SR_DF_LOGIC && (ret = flush_logic(ctx)) != SR_OK)
+		return ret;
+
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		ret = send_header(o, packet->payload);
+		break;
+	case SR_DF_META:
+		ret = send_meta(ctx, packet->payload);
+		break;
+	case SR_DF_LOGIC:
+		ret = add_logic(ctx, packet->payload);
+		break;
+	case SR_DF_ANALOG:
+		ret = send_analog(ctx, packet->payload);
+		break;
+	case SR_DF_TRIGGER:
+		ret = emit_frame(ctx, SRNET_TRIGGER, NULL, 0);
+		break;
+	case SR_DF_FRAME_BEGIN:
+		if ((frame = packet->payload)) {
+			WL64(pos, frame->sample_pos);
+			ret = emit_frame(ctx, SRNET_FRAME_BEGIN, pos, sizeof(pos));
+		} else {
+			ret = emit_frame(ctx, SRNET_FRAME_BEGIN, NULL, 0);
+		}
+		break;
+	case SR_DF_FRAME_END:
+		ret = emit_frame(ctx, SRNET_FRAME_END, NULL, 0);
+		break;
+	case SR_DF_END:
+		ret = emit_frame(ctx, SRNET_END, NULL, 0);
+		break;
+	default:
+		ret = SR_OK;
+		break;
+	}
+	if (ret != SR_OK || !ctx->tx->len || ctx->udp)
+		return ret;
+
+	if (ctx->socket >= 0)
+		ret = send_all(ctx->socket, ctx->tx->str, ctx->tx->len);
+	else
+		*out = g_string_new_len(ctx->tx->str, ctx->tx->len);
+	g_string_truncate(ctx->tx, 0);
+
+	return ret;
+}
+
+static struct sr_option options[] = {
+	{ "host", "Host", "Host to stream to, or empty to return the stream as output text", NULL, NULL },
+	{ "port", "Port", "TCP or UDP port on the host", NULL, NULL },
+	{ "transport", "Transport", "tcp, or udp (one datagram per frame, for multicast)", NULL, NULL },
+	{ "batch_size", "Batch size", "Largest frame payload in bytes", NULL, NULL },
+	{ "compress", "Compress", "LZ4 compress the frames", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	GSList *l;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string(""));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint32(DEFAULT_PORT));
+		options[2].def = g_variant_ref_sink(g_variant_new_string("tcp"));
+		l = NULL;
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("tcp")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("udp")));
+		options[2].values = l;
+		options[3].def = g_variant_ref_sink(g_variant_new_uint64(DEFAULT_BATCH_SIZE));
+		options[4].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+	}
+
+	return options;
+}
+
+static int cleanup(struct sr_output *o)
+{
+	struct context *ctx;
+
+	if (!o || !(ctx = o->priv))
+		return SR_OK;
+
+	if (ctx->socket >= 0)
+		close(ctx->socket);
+	g_byte_array_free(ctx->logic, TRUE);
+	g_byte_array_free(ctx->payload, TRUE);
+	g_string_free(ctx->tx, TRUE);
+	g_free(ctx->lz4_buf);
+	g_free(ctx);
+	o->priv = NULL;
+
+	return SR_OK;
+}
+
+SR_PRIV struct sr_output_module output_srnet = {
+	.id = "srnet",
+	.name = "srnet",
+	.desc = "Binary datafeed stream, to a file or a network host",
+	.exts = (const char*[]){"srnet", NULL},
+	.flags = 0,
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -24,16 +24,162 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <zip.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
 #define LOG_PREFIX "output/srzip"
 #define CHUNK_SIZE (4 * 1024 * 1024)
+/* Staging buffers beyond the memory budget, and their chunks. */
+#define CHUNK_SIZE_MIN (64 * 1024)
+
+/*
+ * A chunk which gets deflated by a worker thread. The compressed data
+ * gets added to the archive in the order the chunks were received.
+ */
+struct zip_job {
+	char *name;
+	uint8_t *data;
+	size_t size;
+	uint8_t *comp;
+	size_t comp_size;
+	uint32_t crc;
+	gboolean done;
+	int ret;
+	/* The copy of the data is charged to the memory budget. */
+	struct sr_context *ctx;
+};
+
+/*
+ * Summary levels of a capture file. Each record covers a block of
+ * samples: the channels which changed and the number of changes for
+ * logic data, the minimum and maximum for analog data. Blocks grow by
+ * SR_SESSIONFILE_SUMMARY_FACTOR from one level to the next.
+ */
+struct summary {
+	char *name;
+	size_t unitsize;
+	size_t record_size;
+	uint64_t block[SR_SESSIONFILE_SUMMARY_LEVELS];
+	GByteArray *records[SR_SESSIONFILE_SUMMARY_LEVELS];
+	zip_int64_t entries[SR_SESSIONFILE_SUMMARY_LEVELS];
+	size_t written[SR_SESSIONFILE_SUMMARY_LEVELS];
+	/* Records which are being accumulated, and their sample counts. */
+	uint8_t *acc[SR_SESSIONFILE_SUMMARY_LEVELS];
+	uint64_t acc_samples[SR_SESSIONFILE_SUMMARY_LEVELS];
+	uint8_t *last;
+	gboolean has_last;
+};
+
+/*
+ * Ring mode keeps the most recent chunks of each stream (the logic data,
+ * each analog channel) in a fixed number of slots of a file next to the
+ * archive, and overwrites the oldest one when a stream needs a new slot.
+ * A trigger or the end of the capture freezes the ring: the slots go to
+ * the archive in order, and the capture continues as usual from there.
+ */
+struct ring_slot {
+	uint64_t first;
+	uint64_t count;
+	size_t length;
+};
+
+struct ring_stream {
+	struct ring_slot *slots;
+	unsigned int next;
+	unsigned int used;
+};
+
+/* A frame: its first sample, sample count and host time. */
+struct frame_record {
+	uint64_t first;
+	uint64_t count;
+	int64_t host_us;
+};
+
+/* Sample data of a stream in the last frame, and in the current one. */
+struct frame_ref {
+	struct sr_spill *last;
+	struct sr_spill *cur;
+};
 
 struct out_context {
 	gboolean zip_created;
 	uint64_t samplerate;
 	char *filename;
+	/*
+	 * The archive stays open during the capture, libzip writes it
+	 * out when it gets closed. Chunk data is kept in a spool file
+	 * next to the archive until then.
+	 */
+	struct zip *archive;
+	GKeyFile *meta;
+	zip_int64_t meta_index;
+	gboolean meta_dirty;
+	/* Unit size in the metadata, 0 until logic data arrived. */
+	size_t meta_unitsize;
+	char *metabuf;
+	char *spool_name;
+	FILE *spool;
+	uint64_t spool_size;
+	unsigned int next_logic_chunk;
+	uint64_t next_logic_sample;
+	/* Chunk index: name, first sample and sample count per line. */
+	GString *index;
+	zip_int64_t index_entry;
+	gboolean index_dirty;
+	char *indexbuf;
+	/*
+	 * Frames of the capture, and whether the last one is still open.
+	 * The "frames" member lists them, one per line.
+	 */
+	GArray *frames;
+	gboolean in_frame;
+	zip_int64_t frames_entry;
+	gboolean frames_dirty;
+	char *framesbuf;
+	/*
+	 * Frames get stored as differences to the previous frame, with
+	 * a full frame at this interval. 0 to store all frames in full.
+	 * The references are per stream, like the ring's.
+	 */
+	uint32_t frame_delta;
+	struct frame_ref *frame_refs;
+	size_t frame_ref_count;
+	uint8_t *delta_buf;
+	/* Gaps reported by the device, "<sample>:<count>" separated by ';'. */
+	GString *gaps;
+	/* Summary levels, NULL if disabled. */
+	uint64_t summary_block;
+	GPtrArray *summaries;
+	/* Slots per stream in ring mode, 0 to record everything. */
+	unsigned int ring_slots;
+	struct ring_stream *ring;
+	size_t ring_streams;
+	char *ring_name;
+	FILE *ring_file;
+	gboolean ring_frozen;
+	/* Sample position of the frozen window in the capture. */
+	uint64_t ring_offset;
+	/* Close and reopen the archive at this interval, 0 if never. */
+	int64_t checkpoint_us;
+	int64_t last_checkpoint_us;
+	/* Workers which compress chunks, and the chunks in flight. */
+	GThreadPool *pool;
+	GQueue jobs;
+	GMutex jobs_mutex;
+	GCond jobs_cond;
+	size_t max_jobs;
+	/* Memory budget, and the staging buffers' share of it. */
+	struct sr_context *ctx;
+	size_t charged;
+	/* Compression of the sample data, prefilter of analog chunks. */
+	zip_int32_t comp_method;
+	zip_uint32_t comp_level;
+	int analog_filter;
+	uint8_t *filter_buf;
 	size_t first_analog_index;
 	size_t analog_ch_count;
 	gint *analog_index_map;
@@ -47,27 +193,805 @@ struct out_context {
 		size_t alloc_size;
 		float *samples;
 		size_t fill_size;
+		unsigned int next_chunk;
+		uint64_t next_sample;
 	} *analog_buff;
 };
 
-static int init(struct sr_output *o, GHashTable *options)
+#ifdef HAVE_ZLIB
+/* Deflate a chunk, in a worker thread. */
+static void zip_job_run(void *data, void *user_data)
 {
+	struct zip_job *job;
 	struct out_context *outc;
+	z_stream zs;
+	int ret;
 
-	(void)options;
+	job = data;
+	outc = user_data;
+
+	job->ret = SR_ERR;
+	memset(&zs, 0, sizeof(zs));
+	if (deflateInit2(&zs,
+			outc->comp_level ? (int)outc->comp_level : Z_DEFAULT_COMPRESSION,
+			Z_DEFLATED,
+			-MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK) {
+		job->comp = g_try_malloc(deflateBound(&zs, job->size));
+		zs.next_in = job->data;
+		zs.avail_in = job->size;
+		zs.next_out = job->comp;
+		zs.avail_out = job->comp ? deflateBound(&zs, job->size) : 0;
+		ret = job->comp ? deflate(&zs, Z_FINISH) : Z_MEM_ERROR;
+		if (ret == Z_STREAM_END) {
+			job->comp_size = zs.total_out;
+			job->crc = crc32(0, job->data, job->size);
+			job->ret = SR_OK;
+		}
+		deflateEnd(&zs);
+	}
+	g_free(job->data);
+	job->data = NULL;
+
+	g_mutex_lock(&outc->jobs_mutex);
+	job->done = TRUE;
+	g_cond_broadcast(&outc->jobs_cond);
+	g_mutex_unlock(&outc->jobs_mutex);
+}
+#endif
+
+static void zip_job_free(struct zip_job *job)
+{
+	sr_mem_release(job->ctx, job->size);
+	g_free(job->name);
+	g_free(job->data);
+	g_free(job->comp);
+	g_free(job);
+}
+
+static int parse_compression(const char *name, uint32_t level,
+	zip_int32_t *method)
+{
+	uint32_t max_level;
+
+	if (!strcmp(name, "deflate")) {
+		*method = ZIP_CM_DEFLATE;
+		max_level = 9;
+	} else if (!strcmp(name, "store")) {
+		*method = ZIP_CM_STORE;
+		max_level = 0;
+#ifdef ZIP_CM_ZSTD
+	} else if (!strcmp(name, "zstd")) {
+		*method = ZIP_CM_ZSTD;
+		max_level = 22;
+#endif
+	} else {
+		sr_err("Unknown compression method '%s'.", name);
+		return SR_ERR_ARG;
+	}
+	if (level > max_level) {
+		sr_err("Compression level %" PRIu32 " out of range for %s.",
+			level, name);
+		return SR_ERR_ARG;
+	}
+
+#if HAVE_ZIP_COMPRESSION_METHOD_SUPPORTED
+	if (!zip_compression_method_supported(*method, 1)) {
+		sr_err("Compression method '%s' not supported by libzip.", name);
+		return SR_ERR_NA;
+	}
+#endif
+#if !HAVE_ZIP_SET_FILE_COMPRESSION
+	if (*method != ZIP_CM_DEFLATE || level) {
+		sr_err("This libzip version cannot select the compression.");
+		return SR_ERR_NA;
+	}
+#endif
+
+	return SR_OK;
+}
+
+static int init(struct sr_output *o, GHashTable *options)
+{
+	struct out_context *outc;
+	const char *filter;
+	zip_int32_t method;
+	uint32_t threads, level;
+	int analog_filter, ret;
 
 	if (!o->filename || o->filename[0] == '\0') {
 		sr_info("srzip output module requires a file name, cannot save.");
 		return SR_ERR_ARG;
 	}
 
+	level = g_variant_get_uint32(g_hash_table_lookup(options, "level"));
+	ret = parse_compression(g_variant_get_string(
+		g_hash_table_lookup(options, "compression"), NULL), level, &method);
+	if (ret != SR_OK)
+		return ret;
+	filter = g_variant_get_string(
+		g_hash_table_lookup(options, "analog_filter"), NULL);
+	analog_filter = sr_sessionfile_filter_from_name(filter);
+	if (analog_filter < 0) {
+		sr_err("Unknown analog filter '%s'.", filter);
+		return SR_ERR_ARG;
+	}
+
 	outc = g_malloc0(sizeof(*outc));
+	outc->comp_method = method;
+	outc->comp_level = level;
+	outc->analog_filter = analog_filter;
 	outc->filename = g_strdup(o->filename);
+	outc->ctx = sr_dev_inst_context(o->sdi);
+	outc->spool_name = g_strdup_printf("%s.chunks", o->filename);
+	outc->next_logic_chunk = 1;
+	outc->index = g_string_new(NULL);
+	outc->gaps = g_string_new(NULL);
+	outc->index_entry = -1;
+	outc->frames = g_array_new(FALSE, FALSE, sizeof(struct frame_record));
+	outc->frames_entry = -1;
+	outc->summary_block = g_variant_get_uint64(
+		g_hash_table_lookup(options, "summary"));
+	if (outc->summary_block)
+		outc->summaries = g_ptr_array_new_with_free_func(summary_free);
+	outc->ring_slots = g_variant_get_uint32(
+		g_hash_table_lookup(options, "ring"));
+	if (outc->ring_slots)
+		outc->ring_name = g_strdup_printf("%s.ring", o->filename);
+	outc->checkpoint_us = G_USEC_PER_SEC * (int64_t)g_variant_get_uint64(
+		g_hash_table_lookup(options, "checkpoint"));
+	outc->frame_delta = g_variant_get_uint32(
+		g_hash_table_lookup(options, "frame_delta"));
+	if (outc->frame_delta && outc->ring_slots) {
+		/* The ring drops frames, their successors lack a reference. */
+		sr_warn("No frame deltas in ring mode, storing frames in full.");
+		outc->frame_delta = 0;
+	}
+	g_queue_init(&outc->jobs);
+	g_mutex_init(&outc->jobs_mutex);
+	g_cond_init(&outc->jobs_cond);
+	threads = g_variant_get_uint32(g_hash_table_lookup(options, "threads"));
+#ifdef HAVE_ZLIB
+	/* Other methods get applied by libzip, when the archive is written. */
+	if (threads && method == ZIP_CM_DEFLATE) {
+		outc->pool = g_thread_pool_new(zip_job_run, outc,
+			threads, FALSE, NULL);
+		outc->max_jobs = 2 * threads;
+	}
+#else
+	if (threads && method == ZIP_CM_DEFLATE)
+		sr_dbg("Built without zlib, compressing in a single thread.");
+#endif
 	o->priv = outc;
 
 	return SR_OK;
 }
 
+static int zip_jobs_write(const struct sr_output *o, size_t max_pending);
+
+/*
+ * Add or replace an archive member which libzip reads from memory.
+ * The data must stay valid until the archive gets written.
+ */
+static int archive_put(const struct sr_output *o, const char *name,
+	const void *data, size_t len, zip_int64_t *entry, gboolean store)
+{
+	struct out_context *outc;
+	struct zip_source *src;
+	gboolean err;
+
+	outc = o->priv;
+	src = zip_source_buffer(outc->archive, data, len, FALSE);
+	if (*entry < 0) {
+		*entry = src ? zip_add(outc->archive, name, src) : -1;
+		err = *entry < 0;
+	} else {
+		err = !src || zip_replace(outc->archive, *entry, src) < 0;
+	}
+	if (err) {
+		sr_err("Failed to save '%s': %s", name,
+			zip_strerror(outc->archive));
+		if (src)
+			zip_source_free(src);
+		return SR_ERR;
+	}
+#if HAVE_ZIP_SET_FILE_COMPRESSION
+	/* Stored members allow for seeking when they get read. */
+	if (store)
+		zip_set_file_compression(outc->archive, *entry, ZIP_CM_STORE, 0);
+#else
+	(void)store;
+#endif
+
+	return SR_OK;
+}
+
+static void summary_record_reset(const struct summary *sum, uint8_t *rec)
+{
+	float min, max;
+
+	if (sum->unitsize) {
+		memset(rec, 0, sum->record_size);
+		return;
+	}
+	min = G_MAXFLOAT;
+	max = -G_MAXFLOAT;
+	memcpy(rec, &min, sizeof(min));
+	memcpy(rec + sizeof(min), &max, sizeof(max));
+}
+
+static void summary_record_merge(const struct summary *sum,
+	uint8_t *dst, const uint8_t *src)
+{
+	float a, b;
+	size_t i;
+
+	if (sum->unitsize) {
+		for (i = 0; i < sum->unitsize; i++)
+			dst[i] |= src[i];
+		WL32(dst + sum->unitsize,
+			RL32(dst + sum->unitsize) + RL32(src + sum->unitsize));
+		return;
+	}
+	memcpy(&a, dst, sizeof(a));
+	memcpy(&b, src, sizeof(b));
+	a = MIN(a, b);
+	memcpy(dst, &a, sizeof(a));
+	memcpy(&a, dst + sizeof(a), sizeof(a));
+	memcpy(&b, src + sizeof(b), sizeof(b));
+	a = MAX(a, b);
+	memcpy(dst + sizeof(a), &a, sizeof(a));
+}
+
+static struct summary *summary_new(const char *name, size_t unitsize,
+	uint64_t block)
+{
+	struct summary *sum;
+	size_t i;
+
+	sum = g_malloc0(sizeof(*sum));
+	sum->name = g_strdup(name);
+	sum->unitsize = unitsize;
+	sum->record_size = unitsize ? unitsize + sizeof(uint32_t)
+		: 2 * sizeof(float);
+	sum->last = g_malloc0(MAX(unitsize, 1));
+	for (i = 0; i < SR_SESSIONFILE_SUMMARY_LEVELS; i++) {
+		sum->block[i] = block;
+		block *= SR_SESSIONFILE_SUMMARY_FACTOR;
+		sum->records[i] = g_byte_array_new();
+		sum->entries[i] = -1;
+		sum->acc[i] = g_malloc0(sum->record_size);
+		summary_record_reset(sum, sum->acc[i]);
+	}
+
+	return sum;
+}
+
+static void summary_free(void *data)
+{
+	struct summary *sum;
+	size_t i;
+
+	sum = data;
+	for (i = 0; i < SR_SESSIONFILE_SUMMARY_LEVELS; i++) {
+		g_byte_array_free(sum->records[i], TRUE);
+		g_free(sum->acc[i]);
+	}
+	g_free(sum->last);
+	g_free(sum->name);
+	g_free(sum);
+}
+
+/* Complete the record of a level, fold it into the next level. */
+static void summary_push(struct summary *sum, size_t level)
+{
+	g_byte_array_append(sum->records[level], sum->acc[level],
+		sum->record_size);
+	if (level + 1 < SR_SESSIONFILE_SUMMARY_LEVELS) {
+		summary_record_merge(sum, sum->acc[level + 1], sum->acc[level]);
+		sum->acc_samples[level + 1] += sum->acc_samples[level];
+		if (sum->acc_samples[level + 1] == sum->block[level + 1])
+			summary_push(sum, level + 1);
+	}
+	summary_record_reset(sum, sum->acc[level]);
+	sum->acc_samples[level] = 0;
+}
+
+/* Count the changes between samples, and which channels changed. */
+static void summary_feed_logic(struct summary *sum,
+	const uint8_t *data, size_t length)
+{
+	const uint8_t *sample;
+	uint8_t *acc, diff;
+	size_t i, b, unitsize;
+	gboolean changed;
+
+	unitsize = sum->unitsize;
+	for (i = 0; i + unitsize <= length; i += unitsize) {
+		sample = data + i;
+		acc = sum->acc[0];
+		if (sum->has_last) {
+			changed = FALSE;
+			for (b = 0; b < unitsize; b++) {
+				diff = sample[b] ^ sum->last[b];
+				acc[b] |= diff;
+				changed |= diff != 0;
+			}
+			if (changed)
+				WL32(acc + unitsize, RL32(acc + unitsize) + 1);
+		}
+		memcpy(sum->last, sample, unitsize);
+		sum->has_last = TRUE;
+		if (++sum->acc_samples[0] == sum->block[0])
+			summary_push(sum, 0);
+	}
+}
+
+static void summary_feed_analog(struct summary *sum,
+	const float *values, size_t count)
+{
+	float min, max;
+	size_t i;
+
+	memcpy(&min, sum->acc[0], sizeof(min));
+	memcpy(&max, sum->acc[0] + sizeof(min), sizeof(max));
+	for (i = 0; i < count; i++) {
+		min = MIN(min, values[i]);
+		max = MAX(max, values[i]);
+		if (++sum->acc_samples[0] < sum->block[0])
+			continue;
+		memcpy(sum->acc[0], &min, sizeof(min));
+		memcpy(sum->acc[0] + sizeof(min), &max, sizeof(max));
+		summary_push(sum, 0);
+		memcpy(&min, sum->acc[0], sizeof(min));
+		memcpy(&max, sum->acc[0] + sizeof(min), sizeof(max));
+	}
+	memcpy(sum->acc[0], &min, sizeof(min));
+	memcpy(sum->acc[0] + sizeof(min), &max, sizeof(max));
+}
+
+/* Complete the partial blocks at the end of the data. */
+static void summary_finish(struct summary *sum)
+{
+	size_t level;
+
+	for (level = 0; level < SR_SESSIONFILE_SUMMARY_LEVELS; level++) {
+		if (sum->acc_samples[level])
+			summary_push(sum, level);
+	}
+}
+
+static int summary_write(const struct sr_output *o, struct summary *sum)
+{
+	char *name;
+	size_t level;
+	int ret;
+
+	for (level = 0; level < SR_SESSIONFILE_SUMMARY_LEVELS; level++) {
+		if (sum->records[level]->len == sum->written[level])
+			continue;
+		name = g_strdup_printf("summary-%s-%zu", sum->name, level);
+		ret = archive_put(o, name, sum->records[level]->data,
+			sum->records[level]->len, &sum->entries[level], TRUE);
+		g_free(name);
+		if (ret != SR_OK)
+			return ret;
+		sum->written[level] = sum->records[level]->len;
+	}
+
+	return SR_OK;
+}
+
+/* Get the summary of a capture file, create it on first use. */
+static struct summary *summary_get(const struct sr_output *o,
+	const char *name, size_t unitsize)
+{
+	struct out_context *outc;
+	struct summary *sum;
+	guint i;
+
+	outc = o->priv;
+	for (i = 0; i < outc->summaries->len; i++) {
+		sum = g_ptr_array_index(outc->summaries, i);
+		if (!strcmp(sum->name, name))
+			return sum;
+	}
+	sum = summary_new(name, unitsize, outc->summary_block);
+	g_ptr_array_add(outc->summaries, sum);
+
+	return sum;
+}
+
+/* List the completed frames, "<first sample> <samples> <host time>". */
+static char *frames_format(const struct out_context *outc, size_t *len)
+{
+	const struct frame_record *frame;
+	GString *s;
+	guint i, num;
+
+	s = g_string_new(NULL);
+	num = outc->frames->len - (outc->in_frame ? 1 : 0);
+	for (i = 0; i < num; i++) {
+		frame = &g_array_index(outc->frames, struct frame_record, i);
+		g_string_append_printf(s, "%" PRIu64 " %" PRIu64 " %" PRId64 "\n",
+			frame->first, frame->count, frame->host_us);
+	}
+	*len = s->len;
+
+	return g_string_free(s, FALSE);
+}
+
+/* Write out the archive, including the metadata when it has changed. */
+static int archive_close(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct zip_source *metasrc;
+	gsize metalen;
+	size_t len;
+	guint i;
+	int ret;
+
+	outc = o->priv;
+	if (!outc->archive)
+		return SR_OK;
+
+	/* All chunks in flight go into the archive. */
+	ret = zip_jobs_write(o, 0);
+	if (outc->meta_dirty) {
+		g_free(outc->metabuf);
+		outc->metabuf = g_key_file_to_data(outc->meta, &metalen, NULL);
+		metasrc = zip_source_buffer(outc->archive,
+			outc->metabuf, metalen, FALSE);
+		if (zip_replace(outc->archive, outc->meta_index, metasrc) < 0) {
+			sr_err("Failed to replace metadata: %s",
+				zip_strerror(outc->archive));
+			zip_source_free(metasrc);
+			ret = SR_ERR;
+		}
+		outc->meta_dirty = FALSE;
+	}
+
+	if (ret == SR_OK && outc->index_dirty) {
+		g_free(outc->indexbuf);
+		outc->indexbuf = g_strndup(outc->index->str, outc->index->len);
+		ret = archive_put(o, "index", outc->indexbuf, outc->index->len,
+			&outc->index_entry, FALSE);
+		outc->index_dirty = FALSE;
+	}
+	/* Frames refer to positions in the ring, until it gets frozen. */
+	if (ret == SR_OK && outc->frames_dirty
+			&& (!outc->ring || outc->ring_frozen)) {
+		g_free(outc->framesbuf);
+		outc->framesbuf = frames_format(outc, &len);
+		ret = archive_put(o, "frames", outc->framesbuf, len,
+			&outc->frames_entry, FALSE);
+		outc->frames_dirty = FALSE;
+	}
+	for (i = 0; ret == SR_OK && outc->summaries && i < outc->summaries->len; i++)
+		ret = summary_write(o, g_ptr_array_index(outc->summaries, i));
+
+	if (outc->spool && fflush(outc->spool) != 0) {
+		sr_err("Failed to write '%s': %s", outc->spool_name,
+			g_strerror(errno));
+		ret = SR_ERR;
+	}
+
+	if (ret != SR_OK || zip_close(outc->archive) < 0) {
+		if (ret == SR_OK)
+			sr_err("Error saving session file: %s",
+				zip_strerror(outc->archive));
+		zip_discard(outc->archive);
+		ret = SR_ERR;
+	}
+	outc->archive = NULL;
+	g_free(outc->metabuf);
+	outc->metabuf = NULL;
+	g_free(outc->indexbuf);
+	outc->indexbuf = NULL;
+	g_free(outc->framesbuf);
+	outc->framesbuf = NULL;
+
+	/* The archive holds all chunks now, start over with the spool. */
+	if (outc->spool) {
+		fclose(outc->spool);
+		outc->spool = NULL;
+		g_unlink(outc->spool_name);
+	}
+	outc->spool_size = 0;
+	outc->last_checkpoint_us = g_get_monotonic_time();
+
+	return ret;
+}
+
+/* Make the archive valid on disk, if the checkpoint interval is over. */
+static int archive_checkpoint(const struct sr_output *o)
+{
+	struct out_context *outc;
+	int ret;
+
+	outc = o->priv;
+	if (!outc->checkpoint_us || g_get_monotonic_time()
+			- outc->last_checkpoint_us < outc->checkpoint_us)
+		return SR_OK;
+
+	if ((ret = archive_close(o)) != SR_OK)
+		return ret;
+	outc->archive = zip_open(outc->filename, 0, NULL);
+	if (!outc->archive) {
+		sr_err("Failed to reopen '%s'.", outc->filename);
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+static gboolean spool_seek(FILE *file, uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, offset, SEEK_SET) == 0;
+#endif
+}
+
+/* Append data to the spool file, get the offset it was written at. */
+static int spool_write(const struct sr_output *o, const char *name,
+	const void *buf, size_t length, uint64_t *offset)
+{
+	struct out_context *outc;
+
+	outc = o->priv;
+	if (!outc->spool) {
+		outc->spool = g_fopen(outc->spool_name, "w+b");
+		if (!outc->spool) {
+			sr_err("Failed to create '%s': %s", outc->spool_name,
+				g_strerror(errno));
+			return SR_ERR;
+		}
+	}
+	*offset = outc->spool_size;
+	if (fwrite(buf, 1, length, outc->spool) != length) {
+		sr_err("Failed to write chunk '%s': %s", name,
+			g_strerror(errno));
+		return SR_ERR;
+	}
+	outc->spool_size += length;
+
+	return SR_OK;
+}
+
+#ifdef HAVE_ZLIB
+/*
+ * Source of a chunk which already is deflated: the raw data of the
+ * archive entry. libzip copies it as is, since the stat reports the
+ * compression method, sizes and CRC.
+ */
+struct deflated_source {
+	char *spool_name;
+	uint64_t offset;
+	uint64_t size, comp_size;
+	uint32_t crc;
+	FILE *file;
+	uint64_t pos;
+};
+
+static zip_int64_t deflated_source_cb(void *userdata, void *data,
+	zip_uint64_t len, enum zip_source_cmd cmd)
+{
+	struct deflated_source *ds;
+	struct zip_stat *st;
+	int *err;
+	size_t n;
+
+	ds = userdata;
+	switch (cmd) {
+	case ZIP_SOURCE_OPEN:
+		ds->file = g_fopen(ds->spool_name, "rb");
+		if (!ds->file || !spool_seek(ds->file, ds->offset))
+			return -1;
+		ds->pos = 0;
+		return 0;
+	case ZIP_SOURCE_READ:
+		n = MIN(len, ds->comp_size - ds->pos);
+		if (n && fread(data, 1, n, ds->file) != n)
+			return -1;
+		ds->pos += n;
+		return n;
+	case ZIP_SOURCE_CLOSE:
+		if (ds->file)
+			fclose(ds->file);
+		ds->file = NULL;
+		return 0;
+	case ZIP_SOURCE_STAT:
+		if (len < sizeof(*st))
+			return -1;
+		st = data;
+		zip_stat_init(st);
+		st->size = ds->size;
+		st->comp_size = ds->comp_size;
+		st->comp_method = ZIP_CM_DEFLATE;
+		st->crc = ds->crc;
+		st->valid |= ZIP_STAT_SIZE | ZIP_STAT_COMP_SIZE
+			| ZIP_STAT_COMP_METHOD | ZIP_STAT_CRC;
+		return sizeof(*st);
+	case ZIP_SOURCE_ERROR:
+		if (len < 2 * sizeof(int))
+			return -1;
+		err = data;
+		err[0] = ZIP_ER_READ;
+		err[1] = errno;
+		return 2 * sizeof(int);
+	case ZIP_SOURCE_FREE:
+		if (ds->file)
+			fclose(ds->file);
+		g_free(ds->spool_name);
+		g_free(ds);
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+/* Add a deflated chunk to the archive. */
+static int zip_job_write(const struct sr_output *o, struct zip_job *job)
+{
+	struct out_context *outc;
+	struct deflated_source *ds;
+	struct zip_source *src;
+	uint64_t offset;
+	int ret;
+
+	outc = o->priv;
+	if (job->ret != SR_OK) {
+		sr_err("Failed to compress chunk '%s'.", job->name);
+		return job->ret;
+	}
+	ret = spool_write(o, job->name, job->comp, job->comp_size, &offset);
+	if (ret != SR_OK)
+		return ret;
+
+	ds = g_malloc0(sizeof(*ds));
+	ds->spool_name = g_strdup(outc->spool_name);
+	ds->offset = offset;
+	ds->size = job->size;
+	ds->comp_size = job->comp_size;
+	ds->crc = job->crc;
+	src = zip_source_function(outc->archive, deflated_source_cb, ds);
+	if (!src) {
+		g_free(ds->spool_name);
+		g_free(ds);
+	}
+	if (!src || zip_add(outc->archive, job->name, src) < 0) {
+		sr_err("Failed to add chunk '%s': %s", job->name,
+			zip_strerror(outc->archive));
+		if (src)
+			zip_source_free(src);
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+#endif
+
+/*
+ * Add compressed chunks to the archive, in order. Wait for the oldest
+ * ones until no more than @a max_pending chunks are in flight.
+ */
+static int zip_jobs_write(const struct sr_output *o, size_t max_pending)
+{
+	struct out_context *outc;
+	struct zip_job *job;
+	int ret;
+
+	outc = o->priv;
+	ret = SR_OK;
+	g_mutex_lock(&outc->jobs_mutex);
+	while ((job = g_queue_peek_head(&outc->jobs))) {
+		if (!job->done && outc->jobs.length <= max_pending)
+			break;
+		while (!job->done)
+			g_cond_wait(&outc->jobs_cond, &outc->jobs_mutex);
+		g_queue_pop_head(&outc->jobs);
+		g_mutex_unlock(&outc->jobs_mutex);
+#ifdef HAVE_ZLIB
+		if (ret == SR_OK)
+			ret = zip_job_write(o, job);
+#endif
+		zip_job_free(job);
+		g_mutex_lock(&outc->jobs_mutex);
+	}
+	g_mutex_unlock(&outc->jobs_mutex);
+
+	return ret;
+}
+
+/* Add a chunk of sample data to the archive, by way of the spool file. */
+static int archive_add_chunk(const struct sr_output *o,
+	const char *name, const void *buf, size_t length)
+{
+	struct out_context *outc;
+	struct zip_source *src;
+	struct zip_job *job;
+	zip_int64_t index;
+	uint64_t offset;
+	gboolean charged;
+	int ret;
+
+	outc = o->priv;
+	if (!outc->archive)
+		return SR_ERR;
+
+	/*
+	 * Have the workers deflate a copy of the chunk, keep the caller's
+	 * buffer. Without budget for the copy, wait for the chunks in
+	 * flight. Should that not do, the chunk takes the path through
+	 * the spool file, and libzip deflates it when the archive gets
+	 * written.
+	 */
+	charged = outc->pool && sr_mem_reserve(outc->ctx, length);
+	if (outc->pool && !charged) {
+		ret = zip_jobs_write(o, 0);
+		if (ret != SR_OK)
+			return ret;
+		charged = sr_mem_reserve(outc->ctx, length);
+	}
+	if (charged) {
+		job = g_malloc0(sizeof(*job));
+		job->name = g_strdup(name);
+		job->data = g_memdup(buf, length);
+		job->size = length;
+		job->ctx = outc->ctx;
+		g_mutex_lock(&outc->jobs_mutex);
+		g_queue_push_tail(&outc->jobs, job);
+		g_mutex_unlock(&outc->jobs_mutex);
+		g_thread_pool_push(outc->pool, job, NULL);
+
+		ret = zip_jobs_write(o, outc->max_jobs);
+		if (ret != SR_OK)
+			return ret;
+
+		return archive_checkpoint(o);
+	}
+
+	ret = spool_write(o, name, buf, length, &offset);
+	if (ret != SR_OK)
+		return ret;
+
+	src = zip_source_file(outc->archive, outc->spool_name, offset, length);
+	index = src ? zip_add(outc->archive, name, src) : -1;
+	if (index < 0) {
+		sr_err("Failed to add chunk '%s': %s", name,
+			zip_strerror(outc->archive));
+		if (src)
+			zip_source_free(src);
+		return SR_ERR;
+	}
+#if HAVE_ZIP_SET_FILE_COMPRESSION
+	if (zip_set_file_compression(outc->archive, index,
+			outc->comp_method, outc->comp_level) < 0) {
+		sr_err("Failed to set compression of '%s': %s", name,
+			zip_strerror(outc->archive));
+		return SR_ERR;
+	}
+#endif
+
+	return archive_checkpoint(o);
+}
+
+/*
+ * Allocate a staging buffer. Buffers take CHUNK_SIZE from the memory
+ * budget, smaller buffers (and thus chunks) are used beyond it.
+ */
+static void *stage_alloc(struct out_context *outc, size_t *size)
+{
+	*size = CHUNK_SIZE_MIN;
+	if (sr_mem_reserve(outc->ctx, CHUNK_SIZE)) {
+		outc->charged += CHUNK_SIZE;
+		*size = CHUNK_SIZE;
+	}
+
+	return g_try_malloc0(*size);
+}
+
 static int zip_create(const struct sr_output *o)
 {
 	struct out_context *outc;
@@ -80,11 +1004,12 @@ static int zip_create(const struct sr_output *o)
 	GKeyFile *meta;
 	GSList *l;
 	const char *devgroup;
-	char *s, *metabuf;
+	char *s;
 	gsize metalen;
 	guint logic_channels, enabled_logic_channels;
 	guint enabled_analog_channels;
 	guint index;
+	int ret;
 
 	outc = o->priv;
 
@@ -156,6 +1081,22 @@ static int zip_create(const struct sr_output *o)
 	g_free(s);
 
 	g_key_file_set_integer(meta, devgroup, "total analog", enabled_analog_channels);
+	if (outc->summary_block) {
+		g_key_file_set_uint64(meta, devgroup, "summary block",
+			outc->summary_block);
+		g_key_file_set_integer(meta, devgroup, "summary levels",
+			SR_SESSIONFILE_SUMMARY_LEVELS);
+	}
+	if (outc->gaps->len)
+		g_key_file_set_string(meta, devgroup, "gaps", outc->gaps->str);
+	if (outc->frame_delta)
+		g_key_file_set_uint64(meta, devgroup, "frame delta",
+			outc->frame_delta);
+	if (enabled_analog_channels && outc->analog_filter) {
+		g_key_file_set_string(meta, devgroup, "analog filter",
+			outc->analog_filter == SR_SESSIONFILE_FILTER_DELTA
+			? "delta" : "shuffle");
+	}
 
 	outc->analog_ch_count = enabled_analog_channels;
 	alloc_size = sizeof(gint) * outc->analog_ch_count + 1;
@@ -189,9 +1130,9 @@ static int zip_create(const struct sr_output *o)
 	/*
 	 * Allocate one samples buffer for all logic channels, and
 	 * several samples buffers for the analog channels. Allocate
-	 * buffers of CHUNK_SIZE size (in bytes), and determine the
-	 * sample counts from the respective channel counts and data
-	 * type widths.
+	 * buffers of CHUNK_SIZE size (in bytes) as the memory budget
+	 * allows, and determine the sample counts from the respective
+	 * channel counts and data type widths.
 	 *
 	 * These buffers are intended to reduce the number of ZIP
 	 * archive update calls, and decouple the srzip output module
@@ -203,11 +1144,10 @@ static int zip_create(const struct sr_output *o)
 	 * holding a local buffer won't harm when no data is seen later
 	 * during execution. This simplifies other locations.
 	 */
-	alloc_size = CHUNK_SIZE;
 	outc->logic_buff.unit_size = logic_channels;
 	outc->logic_buff.unit_size += 8 - 1;
 	outc->logic_buff.unit_size /= 8;
-	outc->logic_buff.samples = g_try_malloc0(alloc_size);
+	outc->logic_buff.samples = stage_alloc(outc, &alloc_size);
 	if (!outc->logic_buff.samples)
 		return SR_ERR_MALLOC;
 	if (outc->logic_buff.unit_size)
@@ -218,39 +1158,172 @@ static int zip_create(const struct sr_output *o)
 	alloc_size = sizeof(outc->analog_buff[0]) * outc->analog_ch_count + 1;
 	outc->analog_buff = g_malloc0(alloc_size);
 	for (index = 0; index < outc->analog_ch_count; index++) {
-		alloc_size = CHUNK_SIZE;
-		outc->analog_buff[index].samples = g_try_malloc0(alloc_size);
+		outc->analog_buff[index].samples = stage_alloc(outc,
+			&alloc_size);
 		if (!outc->analog_buff[index].samples)
 			return SR_ERR_MALLOC;
 		alloc_size /= sizeof(outc->analog_buff[0].samples[0]);
 		outc->analog_buff[index].alloc_size = alloc_size;
 		outc->analog_buff[index].fill_size = 0;
+		outc->analog_buff[index].next_chunk = 1;
 	}
 
-	metabuf = g_key_file_to_data(meta, &metalen, NULL);
-	g_key_file_free(meta);
+	/* The logic data comes first in the ring, the analog channels next. */
+	if (outc->ring_slots) {
+		outc->ring_streams = 1 + outc->analog_ch_count;
+		outc->ring = g_malloc0(sizeof(outc->ring[0]) * outc->ring_streams);
+		for (index = 0; index < outc->ring_streams; index++) {
+			outc->ring[index].slots = g_malloc0(
+				sizeof(outc->ring[0].slots[0]) * outc->ring_slots);
+		}
+	}
+	if (outc->frame_delta) {
+		outc->frame_ref_count = 1 + outc->analog_ch_count;
+		outc->frame_refs = g_malloc0(sizeof(outc->frame_refs[0])
+			* outc->frame_ref_count);
+	}
 
-	metasrc = zip_source_buffer(zipfile, metabuf, metalen, FALSE);
-	if (zip_add(zipfile, "metadata", metasrc) < 0) {
+	outc->meta = meta;
+	outc->metabuf = g_key_file_to_data(meta, &metalen, NULL);
+	metasrc = zip_source_buffer(zipfile, outc->metabuf, metalen, FALSE);
+	outc->meta_index = zip_add(zipfile, "metadata", metasrc);
+	if (outc->meta_index < 0) {
 		sr_err("Error saving metadata into zipfile: %s",
 			zip_strerror(zipfile));
 		zip_source_free(metasrc);
 		zip_discard(zipfile);
-		g_free(metabuf);
 		return SR_ERR;
 	}
 
-	if (zip_close(zipfile) < 0) {
-		sr_err("Error saving zipfile: %s", zip_strerror(zipfile));
-		zip_discard(zipfile);
-		g_free(metabuf);
+	/* Have an archive on disk right away, keep it open after that. */
+	outc->archive = zipfile;
+	if ((ret = archive_close(o)) != SR_OK)
+		return ret;
+	outc->archive = zip_open(outc->filename, 0, NULL);
+	if (!outc->archive) {
+		sr_err("Failed to reopen '%s'.", outc->filename);
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/* Offset of a slot in the ring file. Chunks never exceed CHUNK_SIZE. */
+static uint64_t ring_slot_offset(const struct out_context *outc,
+	size_t stream, unsigned int slot)
+{
+	return ((uint64_t)stream * outc->ring_slots + slot) * CHUNK_SIZE;
+}
+
+/* Put a chunk of a stream into the ring, in place of the oldest one. */
+static int ring_put(const struct sr_output *o, size_t stream,
+	const void *buf, size_t length, uint64_t *next_sample, uint64_t count)
+{
+	struct out_context *outc;
+	struct ring_stream *rs;
+	struct ring_slot *slot;
+	uint64_t offset;
+
+	outc = o->priv;
+	if (!outc->ring_file) {
+		outc->ring_file = g_fopen(outc->ring_name, "w+b");
+		if (!outc->ring_file) {
+			sr_err("Failed to create '%s': %s", outc->ring_name,
+				g_strerror(errno));
+			return SR_ERR;
+		}
+	}
+
+	rs = &outc->ring[stream];
+	offset = ring_slot_offset(outc, stream, rs->next);
+	if (!spool_seek(outc->ring_file, offset)
+			|| fwrite(buf, 1, length, outc->ring_file) != length) {
+		sr_err("Failed to write '%s': %s", outc->ring_name,
+			g_strerror(errno));
 		return SR_ERR;
 	}
-	g_free(metabuf);
+	slot = &rs->slots[rs->next];
+	slot->first = *next_sample;
+	slot->count = count;
+	slot->length = length;
+	rs->next = (rs->next + 1) % outc->ring_slots;
+	if (rs->used < outc->ring_slots)
+		rs->used++;
+	*next_sample += count;
 
 	return SR_OK;
 }
 
+/*
+ * Get the data to store for a chunk of a stream. Chunks of frames get
+ * stored as differences to the previous frame (except for keyframes),
+ * the data of the frame is kept as the next frame's reference. Chunks
+ * never straddle frame boundaries, and never exceed CHUNK_SIZE.
+ */
+static int frame_delta_apply(const struct sr_output *o, size_t stream,
+	const void *buf, size_t length, uint64_t first, size_t sample_size,
+	const void **data)
+{
+	struct out_context *outc;
+	const struct frame_record *frame;
+	struct frame_ref *ref;
+	uint64_t offset;
+	guint index;
+	int ret;
+
+	outc = o->priv;
+	*data = buf;
+	if (!outc->frame_refs || !outc->in_frame)
+		return SR_OK;
+	index = outc->frames->len - 1;
+	frame = &g_array_index(outc->frames, struct frame_record, index);
+	if (first - outc->ring_offset < frame->first)
+		return SR_OK;
+	offset = (first - outc->ring_offset - frame->first) * sample_size;
+	ref = &outc->frame_refs[stream];
+
+	/* Keyframes don't need a reference. */
+	if ((index + 1) % outc->frame_delta) {
+		if (!ref->cur && !(ref->cur = sr_spill_new(outc->ctx, 0)))
+			return SR_ERR_IO;
+		ret = sr_spill_write(ref->cur, offset, buf, length);
+		if (ret != SR_OK)
+			return ret;
+	}
+	if (!(index % outc->frame_delta))
+		return SR_OK;
+
+	if (!outc->delta_buf)
+		outc->delta_buf = g_try_malloc(CHUNK_SIZE);
+	if (!outc->delta_buf)
+		return SR_ERR_MALLOC;
+	if (ref->last) {
+		ret = sr_spill_read(ref->last, offset, outc->delta_buf, length);
+		if (ret != SR_OK)
+			return ret;
+	} else {
+		memset(outc->delta_buf, 0, length);
+	}
+	sr_sessionfile_xor(outc->delta_buf, buf, length);
+	*data = outc->delta_buf;
+
+	return SR_OK;
+}
+
+/* The current frame's data becomes the reference of the next frame. */
+static void frame_delta_next(struct out_context *outc)
+{
+	struct frame_ref *ref;
+	size_t i;
+
+	for (i = 0; i < outc->frame_ref_count; i++) {
+		ref = &outc->frame_refs[i];
+		sr_spill_free(ref->last);
+		ref->last = ref->cur;
+		ref->cur = NULL;
+	}
+}
+
 /**
  * Append a block of logic data to an srzip archive.
  *
@@ -265,123 +1338,52 @@ static int zip_append(const struct sr_output *o,
 	uint8_t *buf, size_t unitsize, size_t length)
 {
 	struct out_context *outc;
-	struct zip *archive;
-	struct zip_source *logicsrc;
-	int64_t i, num_files;
-	struct zip_stat zs;
-	struct zip_source *metasrc;
-	GKeyFile *kf;
-	GError *error;
-	uint64_t chunk_num;
-	const char *entry_name;
-	char *metabuf;
-	gsize metalen;
 	char *chunkname;
-	unsigned int next_chunk_num;
+	const void *data;
+	int ret;
 
 	if (!length)
 		return SR_OK;
 
 	outc = o->priv;
-	if (!(archive = zip_open(outc->filename, 0, NULL)))
-		return SR_ERR;
 
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
-		sr_err("Failed to open metadata: %s", zip_strerror(archive));
-		zip_discard(archive);
-		return SR_ERR;
-	}
-	kf = sr_sessionfile_read_metadata(archive, &zs);
-	if (!kf) {
-		zip_discard(archive);
-		return SR_ERR_DATA;
-	}
-	/*
-	 * If the file was only initialized but doesn't yet have any
-	 * data it in, it won't have a unitsize field in metadata yet.
-	 */
-	error = NULL;
-	metabuf = NULL;
-	if (!g_key_file_has_key(kf, "device 1", "unitsize", &error)) {
-		if (error && error->code != G_KEY_FILE_ERROR_KEY_NOT_FOUND) {
-			sr_err("Failed to check unitsize key: %s", error->message);
-			g_error_free(error);
-			g_key_file_free(kf);
-			zip_discard(archive);
-			return SR_ERR;
-		}
-		g_clear_error(&error);
-
-		/* Add unitsize field. */
-		g_key_file_set_integer(kf, "device 1", "unitsize", unitsize);
-		metabuf = g_key_file_to_data(kf, &metalen, NULL);
-		metasrc = zip_source_buffer(archive, metabuf, metalen, FALSE);
-
-		if (zip_replace(archive, zs.index, metasrc) < 0) {
-			sr_err("Failed to replace metadata: %s",
-				zip_strerror(archive));
-			g_key_file_free(kf);
-			zip_source_free(metasrc);
-			zip_discard(archive);
-			g_free(metabuf);
-			return SR_ERR;
-		}
-	}
-	g_key_file_free(kf);
-
-	next_chunk_num = 1;
-	num_files = zip_get_num_entries(archive, 0);
-	for (i = 0; i < num_files; i++) {
-		entry_name = zip_get_name(archive, i, 0);
-		if (!entry_name || strncmp(entry_name, "logic-1", 7) != 0)
-			continue;
-		if (entry_name[7] == '\0') {
-			/*
-			 * This file has no extra chunks, just a single
-			 * "logic-1". Rename it to "logic-1-1" and continue
-			 * with chunk 2.
-			 */
-			if (zip_rename(archive, i, "logic-1-1") < 0) {
-				sr_err("Failed to rename 'logic-1' to 'logic-1-1': %s",
-					zip_strerror(archive));
-				zip_discard(archive);
-				g_free(metabuf);
-				return SR_ERR;
-			}
-			next_chunk_num = 2;
-			break;
-		} else if (entry_name[7] == '-') {
-			chunk_num = g_ascii_strtoull(entry_name + 8, NULL, 10);
-			if (chunk_num < G_MAXINT && chunk_num >= next_chunk_num)
-				next_chunk_num = chunk_num + 1;
-		}
+	/* Logic data fixes the unit size in the metadata. */
+	if (!outc->meta_unitsize) {
+		g_key_file_set_integer(outc->meta, "device 1", "unitsize", unitsize);
+		outc->meta_unitsize = unitsize;
+		outc->meta_dirty = TRUE;
 	}
 
 	if (length % unitsize != 0) {
 		sr_warn("Chunk size %zu not a multiple of the"
 			" unit size %zu.", length, unitsize);
 	}
-	logicsrc = zip_source_buffer(archive, buf, length, FALSE);
-	chunkname = g_strdup_printf("logic-1-%u", next_chunk_num);
-	i = zip_add(archive, chunkname, logicsrc);
-	g_free(chunkname);
-	if (i < 0) {
-		sr_err("Failed to add chunk 'logic-1-%u': %s",
-			next_chunk_num, zip_strerror(archive));
-		zip_source_free(logicsrc);
-		zip_discard(archive);
-		g_free(metabuf);
-		return SR_ERR;
+
+	/* Until the ring gets frozen, chunks only go to its slots. */
+	if (outc->ring && !outc->ring_frozen) {
+		return ring_put(o, 0, buf, length,
+			&outc->next_logic_sample, length / unitsize);
 	}
-	if (zip_close(archive) < 0) {
-		sr_err("Error saving session file: %s", zip_strerror(archive));
-		zip_discard(archive);
-		g_free(metabuf);
-		return SR_ERR;
+	ret = frame_delta_apply(o, 0, buf, length, outc->next_logic_sample,
+		unitsize, &data);
+	if (ret != SR_OK)
+		return ret;
+	chunkname = g_strdup_printf("logic-1-%u", outc->next_logic_chunk++);
+	if (outc->summaries) {
+		summary_feed_logic(summary_get(o, "logic-1", unitsize),
+			buf, length);
 	}
-	g_free(metabuf);
 
-	return SR_OK;
+	/* Index the chunk first, checkpoints might follow the add. */
+	g_string_append_printf(outc->index, "%s %" PRIu64 " %zu\n",
+		chunkname, outc->next_logic_sample - outc->ring_offset,
+		length / unitsize);
+	outc->next_logic_sample += length / unitsize;
+	outc->index_dirty = TRUE;
+	ret = archive_add_chunk(o, chunkname, data, length);
+	g_free(chunkname);
+
+	return ret;
 }
 
 /**
@@ -450,81 +1452,111 @@ static int zip_append_queue(const struct sr_output *o,
 	return SR_OK;
 }
 
+/**
+ * Queue planar logic data for srzip archive writes.
+ *
+ * The planes get interleaved right into the local buffer, which saves
+ * the dense copy of the whole packet.
+ *
+ * @param[in] o Output module instance.
+ * @param[in] planar Logic data samples as bit planes.
+ *
+ * @returns SR_OK et al error codes.
+ */
+static int zip_append_planar_queue(const struct sr_output *o,
+	const struct sr_datafeed_logic_planar *planar)
+{
+	struct out_context *outc;
+	struct logic_buff *buff;
+	uint64_t pos, copy_size;
+	int ret;
+
+	outc = o->priv;
+	buff = &outc->logic_buff;
+	if (planar->num_samples && planar->unitsize != buff->unit_size) {
+		sr_warn("Unexpected unit size, discarding logic data.");
+		return SR_ERR_ARG;
+	}
+
+	pos = 0;
+	while (pos < planar->num_samples) {
+		if (buff->fill_size == buff->alloc_size) {
+			ret = zip_append(o, buff->samples, buff->unit_size,
+				buff->fill_size * buff->unit_size);
+			if (ret != SR_OK)
+				return ret;
+			buff->fill_size = 0;
+		}
+		copy_size = MIN(planar->num_samples - pos,
+			buff->alloc_size - buff->fill_size);
+		sr_logic_planar_decode_range(planar, pos, copy_size,
+			&buff->samples[buff->fill_size * buff->unit_size]);
+		buff->fill_size += copy_size;
+		pos += copy_size;
+	}
+
+	return SR_OK;
+}
+
 /**
  * Append analog data of a channel to an srzip archive.
  *
  * @param[in] o Output module instance.
+ * @param[in] idx Index of the channel's analog buffer.
  * @param[in] values Sample data as array of floating point values.
  * @param[in] count Number of samples (float items, not bytes).
- * @param[in] ch_nr 1-based channel number.
  *
  * @returns SR_OK et al error codes.
  */
 static int zip_append_analog(const struct sr_output *o,
-	const float *values, size_t count, size_t ch_nr)
+	size_t idx, const float *values, size_t count)
 {
 	struct out_context *outc;
-	struct zip *archive;
-	struct zip_source *analogsrc;
-	int64_t i, num_files;
-	size_t size;
-	struct zip_stat zs;
-	uint64_t chunk_num;
-	const char *entry_name;
-	char *basename;
-	gsize baselen;
 	char *chunkname;
-	unsigned int next_chunk_num;
+	const void *data;
+	int ret;
 
 	outc = o->priv;
+	if (outc->ring && !outc->ring_frozen) {
+		return ring_put(o, 1 + idx, values, sizeof(values[0]) * count,
+			&outc->analog_buff[idx].next_sample, count);
+	}
 
-	if (!(archive = zip_open(outc->filename, 0, NULL)))
-		return SR_ERR;
+	chunkname = g_strdup_printf("analog-1-%zu",
+		outc->first_analog_index + idx);
+	if (outc->summaries)
+		summary_feed_analog(summary_get(o, chunkname, 0), values, count);
+	g_free(chunkname);
 
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
-		sr_err("Failed to open metadata: %s", zip_strerror(archive));
-		zip_discard(archive);
-		return SR_ERR;
-	}
+	/* Frame deltas apply to the values, the filter comes after that. */
+	ret = frame_delta_apply(o, 1 + idx, values, sizeof(values[0]) * count,
+		outc->analog_buff[idx].next_sample, sizeof(values[0]), &data);
+	if (ret != SR_OK)
+		return ret;
 
-	basename = g_strdup_printf("analog-1-%zu", ch_nr);
-	baselen = strlen(basename);
-	next_chunk_num = 1;
-	num_files = zip_get_num_entries(archive, 0);
-	for (i = 0; i < num_files; i++) {
-		entry_name = zip_get_name(archive, i, 0);
-		if (!entry_name || strncmp(entry_name, basename, baselen) != 0) {
-			continue;
-		} else if (entry_name[baselen] == '-') {
-			chunk_num = g_ascii_strtoull(entry_name + baselen + 1, NULL, 10);
-			if (chunk_num < G_MAXINT && chunk_num >= next_chunk_num)
-				next_chunk_num = chunk_num + 1;
-		}
+	/* Chunks never exceed CHUNK_SIZE, the reader undoes them as a whole. */
+	if (outc->analog_filter) {
+		if (!outc->filter_buf)
+			outc->filter_buf = g_try_malloc(CHUNK_SIZE);
+		if (!outc->filter_buf)
+			return SR_ERR_MALLOC;
+		sr_sessionfile_filter_apply(outc->analog_filter,
+			data, outc->filter_buf, count);
+		data = outc->filter_buf;
 	}
 
-	size = sizeof(values[0]) * count;
-	analogsrc = zip_source_buffer(archive, values, size, FALSE);
-	chunkname = g_strdup_printf("%s-%u", basename, next_chunk_num);
-	i = zip_add(archive, chunkname, analogsrc);
-	if (i < 0) {
-		sr_err("Failed to add chunk '%s': %s", chunkname, zip_strerror(archive));
-		g_free(chunkname);
-		g_free(basename);
-		zip_source_free(analogsrc);
-		zip_discard(archive);
-		return SR_ERR;
-	}
+	chunkname = g_strdup_printf("analog-1-%zu-%u",
+		outc->first_analog_index + idx,
+		outc->analog_buff[idx].next_chunk++);
+	g_string_append_printf(outc->index, "%s %" PRIu64 " %zu\n",
+		chunkname, outc->analog_buff[idx].next_sample
+		- outc->ring_offset, count);
+	outc->analog_buff[idx].next_sample += count;
+	outc->index_dirty = TRUE;
+	ret = archive_add_chunk(o, chunkname, data, sizeof(values[0]) * count);
 	g_free(chunkname);
-	if (zip_close(archive) < 0) {
-		sr_err("Error saving session file: %s", zip_strerror(archive));
-		g_free(basename);
-		zip_discard(archive);
-		return SR_ERR;
-	}
-
-	g_free(basename);
 
-	return SR_OK;
+	return ret;
 }
 
 /**
@@ -541,7 +1573,7 @@ static int zip_append_analog_queue(const struct sr_output *o,
 {
 	struct out_context *outc;
 	const struct sr_channel *ch;
-	size_t idx, nr;
+	size_t idx;
 	struct analog_buff *buff;
 	float *values, *wrptr, *rdptr;
 	size_t send_size, remain, copy_size;
@@ -552,12 +1584,11 @@ static int zip_append_analog_queue(const struct sr_output *o,
 	/* Is this the DF_END flush call without samples submission? */
 	if (!analog && flush) {
 		for (idx = 0; idx < outc->analog_ch_count; idx++) {
-			nr = outc->first_analog_index + idx;
 			buff = &outc->analog_buff[idx];
 			if (!buff->fill_size)
 				continue;
 			ret = zip_append_analog(o,
-				buff->samples, buff->fill_size, nr);
+				idx, buff->samples, buff->fill_size);
 			if (ret != SR_OK)
 				return ret;
 			buff->fill_size = 0;
@@ -578,7 +1609,6 @@ static int zip_append_analog_queue(const struct sr_output *o,
 	}
 	if (idx == outc->analog_ch_count)
 		return SR_ERR_ARG;
-	nr = outc->first_analog_index + idx;
 	buff = &outc->analog_buff[idx];
 
 	/* Convert the analog data to an array of float values. */
@@ -610,7 +1640,7 @@ static int zip_append_analog_queue(const struct sr_output *o,
 		}
 		if (send_size && !remain) {
 			ret = zip_append_analog(o,
-				buff->samples, buff->fill_size, nr);
+				idx, buff->samples, buff->fill_size);
 			if (ret != SR_OK) {
 				g_free(values);
 				return ret;
@@ -623,7 +1653,7 @@ static int zip_append_analog_queue(const struct sr_output *o,
 
 	/* Flush to the ZIP archive if the caller wants us to. */
 	if (flush && buff->fill_size) {
-		ret = zip_append_analog(o, buff->samples, buff->fill_size, nr);
+		ret = zip_append_analog(o, idx, buff->samples, buff->fill_size);
 		if (ret != SR_OK)
 			return ret;
 		buff->fill_size = 0;
@@ -632,15 +1662,241 @@ static int zip_append_analog_queue(const struct sr_output *o,
 	return SR_OK;
 }
 
+/* Keep the gaps within the frozen window, relative to its start. */
+static void ring_gaps_shift(struct out_context *outc)
+{
+	GString *gaps;
+	char **items, *end;
+	uint64_t pos;
+	int i;
+
+	gaps = g_string_new(NULL);
+	items = g_strsplit(outc->gaps->str, ";", 0);
+	for (i = 0; items[i]; i++) {
+		pos = g_ascii_strtoull(items[i], &end, 10);
+		if (end == items[i] || *end != ':')
+			continue;
+		if (pos < outc->ring_offset || (pos && pos == outc->ring_offset))
+			continue;
+		g_string_append_printf(gaps, "%s%" PRIu64 "%s",
+			gaps->len ? ";" : "", pos - outc->ring_offset, end);
+	}
+	g_strfreev(items);
+	g_string_free(outc->gaps, TRUE);
+	outc->gaps = gaps;
+}
+
+/* Keep the frames within the frozen window, relative to its start. */
+static void ring_frames_shift(struct out_context *outc)
+{
+	struct frame_record *frame;
+	uint64_t start, end;
+	gboolean open;
+	guint i;
+
+	start = outc->ring_offset;
+	for (i = 0; i < outc->frames->len; ) {
+		frame = &g_array_index(outc->frames, struct frame_record, i);
+		open = outc->in_frame && i == outc->frames->len - 1;
+		end = frame->first + frame->count;
+		if (!open && (end < start
+				|| (end == start && frame->first < start))) {
+			g_array_remove_index(outc->frames, i);
+			continue;
+		}
+		if (frame->first < start) {
+			if (!open)
+				frame->count = end - start;
+			frame->first = start;
+		}
+		frame->first -= start;
+		i++;
+	}
+	outc->frames_dirty = TRUE;
+}
+
+/*
+ * Freeze the ring: add its chunks to the archive in the order of the
+ * capture, from the oldest sample which all streams still hold on.
+ */
+static int ring_freeze(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct ring_stream *rs;
+	const struct ring_slot *slot;
+	uint8_t *buf;
+	uint64_t start, skip, offset, *next_sample;
+	size_t i, sample_size, length;
+	unsigned int oldest, k, n;
+	int ret;
+
+	outc = o->priv;
+
+	/* Buffered samples go into the ring first. */
+	ret = zip_append_queue(o, NULL, 0, 0, TRUE);
+	if (ret == SR_OK)
+		ret = zip_append_analog_queue(o, NULL, TRUE);
+	if (ret != SR_OK)
+		return ret;
+
+	start = 0;
+	for (i = 0; i < outc->ring_streams; i++) {
+		rs = &outc->ring[i];
+		oldest = rs->used < outc->ring_slots ? 0 : rs->next;
+		if (rs->used)
+			start = MAX(start, rs->slots[oldest].first);
+	}
+	outc->ring_frozen = TRUE;
+	outc->ring_offset = start;
+
+	if (!(buf = g_try_malloc(CHUNK_SIZE)))
+		return SR_ERR_MALLOC;
+	for (i = 0; ret == SR_OK && i < outc->ring_streams; i++) {
+		rs = &outc->ring[i];
+		oldest = rs->used < outc->ring_slots ? 0 : rs->next;
+		sample_size = i ? sizeof(float) : outc->meta_unitsize;
+		next_sample = i ? &outc->analog_buff[i - 1].next_sample
+			: &outc->next_logic_sample;
+		for (k = 0; ret == SR_OK && k < rs->used; k++) {
+			n = (oldest + k) % outc->ring_slots;
+			slot = &rs->slots[n];
+			if (slot->first + slot->count <= start)
+				continue;
+			skip = start > slot->first ? start - slot->first : 0;
+			length = slot->length - skip * sample_size;
+			offset = ring_slot_offset(outc, i, n) + skip * sample_size;
+			if (!spool_seek(outc->ring_file, offset)
+					|| fread(buf, 1, length, outc->ring_file) != length) {
+				sr_err("Failed to read '%s': %s", outc->ring_name,
+					g_strerror(errno));
+				ret = SR_ERR;
+				break;
+			}
+			*next_sample = slot->first + skip;
+			if (i)
+				ret = zip_append_analog(o, i - 1, (float *)buf,
+					length / sizeof(float));
+			else
+				ret = zip_append(o, buf, sample_size, length);
+		}
+		/* Streams which ended before the window continue at its start. */
+		*next_sample = MAX(*next_sample, start);
+	}
+	g_free(buf);
+
+	/* Record where the window was in the capture, drop the ring. */
+	ring_gaps_shift(outc);
+	ring_frames_shift(outc);
+	if (outc->gaps->len)
+		g_key_file_set_string(outc->meta, "device 1", "gaps", outc->gaps->str);
+	g_key_file_set_uint64(outc->meta, "device 1", "ring offset", start);
+	outc->meta_dirty = TRUE;
+	if (outc->ring_file) {
+		fclose(outc->ring_file);
+		outc->ring_file = NULL;
+		g_unlink(outc->ring_name);
+	}
+	sr_info("Froze the ring at sample %" PRIu64 ".", start);
+
+	return ret;
+}
+
+/* Position of the next sample, in the logic data if there is any. */
+static uint64_t next_position(const struct out_context *outc)
+{
+	if (outc->meta_unitsize || !outc->analog_ch_count)
+		return outc->next_logic_sample - outc->ring_offset;
+
+	return outc->analog_buff[0].next_sample - outc->ring_offset;
+}
+
+/* Frames start and end with a chunk, so that they can be read alone. */
+static int frame_flush(const struct sr_output *o)
+{
+	struct out_context *outc;
+	int ret;
+
+	outc = o->priv;
+	if (!outc->zip_created)
+		return SR_OK;
+	if ((ret = zip_append_queue(o, NULL, 0, 0, TRUE)) != SR_OK)
+		return ret;
+
+	return zip_append_analog_queue(o, NULL, TRUE);
+}
+
+static int frame_begin(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct frame_record frame;
+	int ret;
+
+	outc = o->priv;
+	if ((ret = frame_flush(o)) != SR_OK)
+		return ret;
+
+	frame.first = next_position(outc);
+	frame.count = 0;
+	frame.host_us = 0;
+	g_array_append_val(outc->frames, frame);
+	outc->in_frame = TRUE;
+
+	return SR_OK;
+}
+
+static int frame_end(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct frame_record *frame;
+	int ret;
+
+	outc = o->priv;
+	if (!outc->in_frame)
+		return SR_OK;
+	if ((ret = frame_flush(o)) != SR_OK)
+		return ret;
+
+	frame = &g_array_index(outc->frames, struct frame_record,
+		outc->frames->len - 1);
+	frame->count = next_position(outc) - frame->first;
+	outc->in_frame = FALSE;
+	outc->frames_dirty = TRUE;
+	frame_delta_next(outc);
+
+	return SR_OK;
+}
+
+/* The first data of a frame gives its host time, since the epoch. */
+static void frame_stamp(struct out_context *outc,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_datafeed_timestamp ts;
+	struct frame_record *frame;
+
+	if (!outc->in_frame)
+		return;
+	frame = &g_array_index(outc->frames, struct frame_record,
+		outc->frames->len - 1);
+	if (frame->host_us)
+		return;
+
+	if (sr_packet_timestamp_get(packet, &ts) != SR_OK)
+		ts.host_us = g_get_monotonic_time();
+	frame->host_us = ts.host_us + g_get_real_time() - g_get_monotonic_time();
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
 		GString **out)
 {
 	struct out_context *outc;
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_planar *planar;
 	const struct sr_datafeed_analog *analog;
 	const struct sr_config *src;
 	GSList *l;
+	guint i;
+	uint64_t gap_pos, gap_count;
 	int ret;
 
 	*out = NULL;
@@ -652,9 +1908,21 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		meta = packet->payload;
 		for (l = meta->config; l; l = l->next) {
 			src = l->data;
-			if (src->key != SR_CONF_SAMPLERATE)
-				continue;
-			outc->samplerate = g_variant_get_uint64(src->data);
+			if (src->key == SR_CONF_SAMPLERATE) {
+				outc->samplerate = g_variant_get_uint64(src->data);
+			} else if (src->key == SR_CONF_SAMPLES_LOST) {
+				/* Keep track of where data is missing. */
+				g_variant_get(src->data, "(tt)", &gap_pos, &gap_count);
+				gap_pos -= MIN(gap_pos, outc->ring_offset);
+				g_string_append_printf(outc->gaps, "%s%" PRIu64
+					":%" PRIu64, outc->gaps->len ? ";" : "",
+					gap_pos, gap_count);
+				if (outc->meta && (!outc->ring || outc->ring_frozen)) {
+					g_key_file_set_string(outc->meta, "device 1",
+						"gaps", outc->gaps->str);
+					outc->meta_dirty = TRUE;
+				}
+			}
 		}
 		break;
 	case SR_DF_LOGIC:
@@ -663,24 +1931,55 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 				return ret;
 			outc->zip_created = TRUE;
 		}
+		frame_stamp(outc, packet);
 		logic = packet->payload;
 		ret = zip_append_queue(o, logic->data,
 			logic->unitsize, logic->length, FALSE);
 		if (ret != SR_OK)
 			return ret;
 		break;
+	case SR_DF_LOGIC_PLANAR:
+		if (!outc->zip_created) {
+			if ((ret = zip_create(o)) != SR_OK)
+				return ret;
+			outc->zip_created = TRUE;
+		}
+		frame_stamp(outc, packet);
+		planar = packet->payload;
+		ret = zip_append_planar_queue(o, planar);
+		if (ret != SR_OK)
+			return ret;
+		break;
 	case SR_DF_ANALOG:
 		if (!outc->zip_created) {
 			if ((ret = zip_create(o)) != SR_OK)
 				return ret;
 			outc->zip_created = TRUE;
 		}
+		frame_stamp(outc, packet);
 		analog = packet->payload;
 		ret = zip_append_analog_queue(o, analog, FALSE);
 		if (ret != SR_OK)
 			return ret;
 		break;
+	case SR_DF_FRAME_BEGIN:
+		if ((ret = frame_begin(o)) != SR_OK)
+			return ret;
+		break;
+	case SR_DF_FRAME_END:
+		if ((ret = frame_end(o)) != SR_OK)
+			return ret;
+		break;
+	case SR_DF_TRIGGER:
+		/* The trigger keeps the data before it, in ring mode. */
+		if (outc->ring && !outc->ring_frozen) {
+			if ((ret = ring_freeze(o)) != SR_OK)
+				return ret;
+		}
+		break;
 	case SR_DF_END:
+		if ((ret = frame_end(o)) != SR_OK)
+			return ret;
 		if (outc->zip_created) {
 			ret = zip_append_queue(o, NULL, 0, 0, TRUE);
 			if (ret != SR_OK)
@@ -688,6 +1987,15 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			ret = zip_append_analog_queue(o, NULL, TRUE);
 			if (ret != SR_OK)
 				return ret;
+			if (outc->ring && !outc->ring_frozen) {
+				if ((ret = ring_freeze(o)) != SR_OK)
+					return ret;
+			}
+			for (i = 0; outc->summaries && i < outc->summaries->len; i++)
+				summary_finish(g_ptr_array_index(outc->summaries, i));
+			ret = archive_close(o);
+			if (ret != SR_OK)
+				return ret;
 		}
 		break;
 	}
@@ -696,11 +2004,56 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 }
 
 static struct sr_option options[] = {
+	{ "checkpoint", "Checkpoint interval", "Time between updates of the file on disk during the capture, in seconds (0 = at the end only)", NULL, NULL },
+	{ "threads", "Compression threads", "Number of threads which compress the sample data (0 = compress when the file gets written)", NULL, NULL },
+	{ "compression", "Compression", "Compression method of the sample data", NULL, NULL },
+	{ "level", "Compression level", "Compression level (0 = default of the method)", NULL, NULL },
+	{ "analog_filter", "Analog filter", "Prefilter of analog data for better compression", NULL, NULL },
+	{ "summary", "Summary block size", "Samples per block of the finest summary level (0 = no summaries)", NULL, NULL },
+	{ "ring", "Ring slots", "Number of most recent chunks of each channel which are kept until a trigger or the end of the capture (0 = keep all data)", NULL, NULL },
+	{ "frame_delta", "Frame delta", "Store frames as differences to the previous frame, with a full frame at this interval (0 = store all frames in full)", NULL, NULL },
 	ALL_ZERO
 };
 
 static const struct sr_option *get_options(void)
 {
+	GSList *l;
+
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(0));
+	if (!options[1].def) {
+#if GLIB_CHECK_VERSION(2, 36, 0)
+		options[1].def = g_variant_ref_sink(g_variant_new_uint32(
+			g_get_num_processors()));
+#else
+		options[1].def = g_variant_ref_sink(g_variant_new_uint32(1));
+#endif
+	}
+	if (!options[2].def) {
+		options[2].def = g_variant_ref_sink(g_variant_new_string("deflate"));
+		l = g_slist_append(NULL, g_variant_ref_sink(g_variant_new_string("deflate")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("store")));
+#ifdef ZIP_CM_ZSTD
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("zstd")));
+#endif
+		options[2].values = l;
+	}
+	if (!options[3].def)
+		options[3].def = g_variant_ref_sink(g_variant_new_uint32(0));
+	if (!options[4].def) {
+		options[4].def = g_variant_ref_sink(g_variant_new_string("none"));
+		l = g_slist_append(NULL, g_variant_ref_sink(g_variant_new_string("none")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("shuffle")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("delta")));
+		options[4].values = l;
+	}
+	if (!options[5].def)
+		options[5].def = g_variant_ref_sink(g_variant_new_uint64(0));
+	if (!options[6].def)
+		options[6].def = g_variant_ref_sink(g_variant_new_uint32(0));
+	if (!options[7].def)
+		options[7].def = g_variant_ref_sink(g_variant_new_uint32(0));
+
 	return options;
 }
 
@@ -711,12 +2064,45 @@ static int cleanup(struct sr_output *o)
 
 	outc = o->priv;
 
+	/* Keep what was received when the capture did not end properly. */
+	archive_close(o);
+	if (outc->pool)
+		g_thread_pool_free(outc->pool, FALSE, TRUE);
+	g_queue_foreach(&outc->jobs, (GFunc)zip_job_free, NULL);
+	g_queue_clear(&outc->jobs);
+	g_mutex_clear(&outc->jobs_mutex);
+	g_cond_clear(&outc->jobs_cond);
+	if (outc->meta)
+		g_key_file_free(outc->meta);
+	g_free(outc->spool_name);
+	if (outc->ring_file) {
+		fclose(outc->ring_file);
+		g_unlink(outc->ring_name);
+	}
+	for (idx = 0; outc->ring && idx < outc->ring_streams; idx++)
+		g_free(outc->ring[idx].slots);
+	g_free(outc->ring);
+	g_free(outc->ring_name);
+	g_free(outc->filter_buf);
+	for (idx = 0; idx < outc->frame_ref_count; idx++) {
+		sr_spill_free(outc->frame_refs[idx].last);
+		sr_spill_free(outc->frame_refs[idx].cur);
+	}
+	g_free(outc->frame_refs);
+	g_free(outc->delta_buf);
+	g_string_free(outc->index, TRUE);
+	g_string_free(outc->gaps, TRUE);
+	g_array_free(outc->frames, TRUE);
+	if (outc->summaries)
+		g_ptr_array_free(outc->summaries, TRUE);
+
 	g_free(outc->analog_index_map);
 	g_free(outc->filename);
 	g_free(outc->logic_buff.samples);
 	for (idx = 0; idx < outc->analog_ch_count; idx++)
 		g_free(outc->analog_buff[idx].samples);
 	g_free(outc->analog_buff);
+	sr_mem_release(outc->ctx, outc->charged);
 
 	g_free(outc);
 	o->priv = NULL;
@@ -729,7 +2115,7 @@ SR_PRIV struct sr_output_module output_srzip = {
 	.name = "srzip",
 	.desc = "srzip session file format data",
 	.exts = (const char*[]){"sr", NULL},
-	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING,
+	.flags = SR_OUTPUT_INTERNAL_IO_HANDLING | SR_OUTPUT_LOGIC_PLANAR,
 	.options = get_options,
 	.init = init,
 	.receive = receive,
@@ -31,6 +31,7 @@
 
 #include <ctype.h>
 #include <glib.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -42,6 +43,11 @@
 static const int with_queue_stats = 0;
 static const int with_pool_stats = 0;
 
+/* Pending queue items are charged to the memory budget in blocks. */
+#define QUEUE_CHARGE_BLOCK	(1024 * 1024)
+/* Runs of items in files beyond which they get merged into one. */
+#define QUEUE_MAX_RUNS		8
+
 struct vcd_channel_desc {
 	size_t index;
 	GString *name;
@@ -57,6 +63,20 @@ struct vcd_channel_desc {
 struct vcd_queue_item {
 	uint64_t samplenum;	/**!< sample number, _not_ timestamp */
 	GString *values;	/**!< text of value changes */
+	size_t cost;		/**!< memory charged while pending */
+};
+
+/**
+ * Queue items which went to a file when the memory budget was
+ * exhausted. Records of sample number, text length and text, in the
+ * order of sample numbers.
+ */
+struct vcd_queue_run {
+	struct sr_spill *spill;
+	uint64_t write_pos, read_pos;
+	/* The run's first pending item. */
+	uint64_t samplenum;
+	GString *values;
 };
 
 struct context {
@@ -65,14 +85,36 @@ struct context {
 	size_t analog_count;
 	gboolean header_done;
 	uint64_t period;
+	/* Timestamp per sample number, as a reduced fraction. */
+	uint64_t ts_num, ts_den;
+	/* Length of recent output text, to size the next buffer. */
+	size_t out_size_hint;
 	struct vcd_channel_desc *channels;
 	uint64_t samplerate;
 	GSList *free_list, *used_list;
 	size_t alloced, freed, reused, pooled;
-	GList *vcd_queue_list;
-	GList *vcd_queue_last;
+	/* Pending queue items, a min-heap by sample number. */
+	GPtrArray *vcd_queue;
+	/* Pending queue items by sample number, and the current item. */
+	GHashTable *vcd_queue_index;
+	struct vcd_queue_item *vcd_queue_last;
+	/* Memory budget of pending items, and items beyond it. */
+	struct sr_context *sr_ctx;
+	size_t queue_bytes, queue_charged;
+	GSList *vcd_queue_runs;
+	GString *merge_values;
 	gboolean immediate_write;
 	uint8_t *last_logic;
+	size_t last_logic_size;
+	/* Loops for the unit size of the logic data. */
+	const struct sr_logic_kernels *kernels;
+	size_t kernels_unit_size;
+	/* Changed bits per 64 channels, and the channels by bit position. */
+	uint64_t *logic_diff;
+	struct vcd_channel_desc **bit_desc;
+	size_t bit_desc_count;
+	/* Changed samples of a 64 sample block, per channel of planar data. */
+	uint64_t *plane_diff;
 };
 
 /*
@@ -177,12 +219,24 @@ static GString *vcd_identifier(size_t idx)
  *   writer and the reader.
  */
 
-static void append_vcd_timestamp(GString *s, double ts, gboolean lf)
+static void append_u64(GString *s, uint64_t value)
+{
+	char buf[20], *p;
+
+	p = &buf[sizeof(buf)];
+	do {
+		*--p = '0' + value % 10;
+		value /= 10;
+	} while (value);
+	g_string_append_len(s, p, &buf[sizeof(buf)] - p);
+}
+
+static void append_vcd_timestamp(GString *s, uint64_t ts, gboolean lf)
 {
 
 	g_string_append_c(s, '\n');
 	g_string_append_c(s, '#');
-	g_string_append_printf(s, "%.0f", ts);
+	append_u64(s, ts);
 	g_string_append_c(s, lf ? '\n' : ' ');
 }
 
@@ -195,9 +249,23 @@ static void format_vcd_value_bit(GString *s, uint8_t bit_value, GString *id)
 
 static void format_vcd_value_real(GString *s, double real_value, GString *id)
 {
+	char buf[G_ASCII_DTOSTR_BUF_SIZE];
 
 	g_string_append_c(s, 'r');
-	g_string_append_printf(s, "%.16g", real_value);
+	if (real_value > -1e9 && real_value < 1e9
+			&& real_value == (int32_t)real_value
+			&& (real_value != 0 || !signbit(real_value))) {
+		/* Integral values are common, and print the same as "%.16g". */
+		if (real_value < 0) {
+			g_string_append_c(s, '-');
+			append_u64(s, -(int64_t)real_value);
+		} else {
+			append_u64(s, (uint64_t)real_value);
+		}
+	} else {
+		g_string_append(s, g_ascii_formatd(buf, sizeof(buf),
+			"%.16g", real_value));
+	}
 	g_string_append_c(s, ' ');
 	g_string_append(s, id->str);
 }
@@ -241,6 +309,9 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->enabled_count = num_enabled;
 	ctx->logic_count = num_logic;
 	ctx->analog_count = num_analog;
+	ctx->vcd_queue = g_ptr_array_new();
+	ctx->vcd_queue_index = g_hash_table_new(g_int64_hash, g_int64_equal);
+	ctx->sr_ctx = sr_dev_inst_context(o->sdi);
 	alloc_size = sizeof(ctx->channels[0]) * ctx->enabled_count;
 	ctx->channels = g_malloc0(alloc_size);
 
@@ -297,6 +368,25 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->last_logic = g_malloc0(alloc_size);
 	if (ctx->logic_count && !ctx->last_logic)
 		return SR_ERR_MALLOC;
+	ctx->last_logic_size = alloc_size;
+	ctx->logic_diff = g_malloc0(sizeof(ctx->logic_diff[0])
+		* ((alloc_size + 7) / 8 + 1));
+
+	/* Map bit positions in the samples to the channels. */
+	for (desc_idx = 0; desc_idx < ctx->enabled_count; desc_idx++) {
+		desc = &ctx->channels[desc_idx];
+		if (desc->type == SR_CHANNEL_LOGIC)
+			ctx->bit_desc_count = MAX(ctx->bit_desc_count, desc->index + 1);
+	}
+	ctx->bit_desc = g_malloc0(sizeof(ctx->bit_desc[0])
+		* (ctx->bit_desc_count + 1));
+	for (desc_idx = 0; desc_idx < ctx->enabled_count; desc_idx++) {
+		desc = &ctx->channels[desc_idx];
+		if (desc->type == SR_CHANNEL_LOGIC)
+			ctx->bit_desc[desc->index] = desc;
+	}
+	ctx->plane_diff = g_malloc0(sizeof(ctx->plane_diff[0])
+		* (ctx->bit_desc_count + 1));
 
 	return SR_OK;
 }
@@ -346,6 +436,7 @@ static GString *gen_header(const struct sr_output *o)
 	char *samplerate_s, *frequency_s, *timestamp;
 	struct vcd_channel_desc *desc;
 	char *type_text, *size_text;
+	uint64_t a, b, gcd;
 	int ret;
 
 	ctx = o->priv;
@@ -361,6 +452,17 @@ static GString *gen_header(const struct sr_output *o)
 		}
 	}
 	ctx->period = get_timescale_freq(ctx->samplerate);
+	ctx->ts_num = ctx->period;
+	ctx->ts_den = ctx->samplerate ? ctx->samplerate : 1;
+	a = ctx->ts_num;
+	b = ctx->ts_den;
+	while (b) {
+		gcd = a % b;
+		a = b;
+		b = gcd;
+	}
+	ctx->ts_num /= a;
+	ctx->ts_den /= a;
 	t = time(NULL);
 	timestamp = g_strdup(ctime(&t));
 	timestamp[strlen(timestamp) - 1] = '\0';
@@ -431,7 +533,8 @@ static GString *chk_header(const struct sr_output *o)
 		ctx->header_done = TRUE;
 		s = gen_header(o);
 	} else {
-		s = g_string_sized_new(512);
+		/* Expect about as much text as with the last packets. */
+		s = g_string_sized_new(MAX(ctx->out_size_hint, 512));
 	}
 
 	return s;
@@ -493,6 +596,9 @@ static void queue_free_item(struct context *ctx, struct vcd_queue_item *item)
 {
 	GSList *node;
 
+	ctx->queue_bytes -= MIN(item->cost, ctx->queue_bytes);
+	item->cost = 0;
+
 	/*
 	 * Put item back into the free list. We can assume to find a
 	 * used list node, it got allocated when the item was acquired.
@@ -555,203 +661,297 @@ static void queue_drain_pool(struct context *ctx)
 	g_slist_free(list);
 }
 
-static int cmp_snum(gconstpointer l, gconstpointer d)
+/*
+ * The queue of pending items is a binary min-heap which is ordered by
+ * sample number. Insertion and removal of the lowest sample number are
+ * logarithmic, regardless of how many channels at which rates feed it.
+ */
+static void queue_heap_push(struct context *ctx, struct vcd_queue_item *item)
 {
-	const struct vcd_queue_item *list_item;
-	const uint64_t *snum_ptr;
-
-	list_item = l;
-	snum_ptr = d;
-	if (list_item->samplenum > *snum_ptr)
-		return +1;
-	if (list_item->samplenum < *snum_ptr)
-		return -1;
-	return 0;
+	struct vcd_queue_item **heap;
+	size_t pos, parent;
+
+	g_ptr_array_add(ctx->vcd_queue, item);
+	heap = (struct vcd_queue_item **)ctx->vcd_queue->pdata;
+	pos = ctx->vcd_queue->len - 1;
+	while (pos) {
+		parent = (pos - 1) / 2;
+		if (heap[parent]->samplenum <= item->samplenum)
+			break;
+		heap[pos] = heap[parent];
+		pos = parent;
+	}
+	heap[pos] = item;
 }
 
-static int cmp_items(gconstpointer a, gconstpointer b)
+static struct vcd_queue_item *queue_heap_pop(struct context *ctx)
 {
-	const struct vcd_queue_item *item_a, *item_b;
-
-	item_a = a;
-	item_b = b;
-	if (item_a->samplenum > item_b->samplenum)
-		return +1;
-	if (item_a->samplenum < item_b->samplenum)
-		return -1;
-	return 0;
+	struct vcd_queue_item **heap, *top, *item;
+	size_t pos, child, len;
+
+	len = ctx->vcd_queue->len;
+	if (!len)
+		return NULL;
+	heap = (struct vcd_queue_item **)ctx->vcd_queue->pdata;
+	top = heap[0];
+	item = heap[--len];
+	g_ptr_array_set_size(ctx->vcd_queue, len);
+	if (!len)
+		return top;
+
+	/* Sift the former last item down from the top. */
+	pos = 0;
+	while ((child = 2 * pos + 1) < len) {
+		if (child + 1 < len &&
+				heap[child + 1]->samplenum < heap[child]->samplenum)
+			child++;
+		if (item->samplenum <= heap[child]->samplenum)
+			break;
+		heap[pos] = heap[child];
+		pos = child;
+	}
+	heap[pos] = item;
+
+	return top;
 }
 
-/*
- * Position the current pointer of the VCD value queue to a specific
- * sample number. Create a new queue item when needed. The logic assumes
- * a specific use pattern: Reception of striped sample data for channels
- * and processing in strict order of sample numbers within a channel.
- * Lower sample numbers near the start of the queue when channels change
- * between session feed packets, before another linear sequence follows.
- *
- * Naive use of convenience glib routines would severely lose performance.
- * That's why custom code is used, which is as complex as it needs to be,
- * yet shall execute faster than a simpler implementation. For trivial
- * cases (logic only, one analog channel only) this queue is bypassed.
- */
-static int queue_samplenum(struct context *ctx, uint64_t snum)
+/* Release the items of the free list, after the queue went to a file. */
+static void queue_trim_pool(struct context *ctx)
 {
-	struct vcd_queue_item *item, *add_item;
-	GList *walk_list, *after_snum, *before_snum, *add_list;
-	GList *last;
-	gboolean add_after_last, do_search;
+	GSList *list, *l;
+	struct vcd_queue_item *item;
 
-	/* Already at that position? */
-	item = ctx->vcd_queue_last ? ctx->vcd_queue_last->data : NULL;
-	if (item && item->samplenum == snum)
-		return SR_OK;
+	list = ctx->free_list;
+	ctx->free_list = NULL;
+	for (l = list; l; l = l->next) {
+		item = l->data;
+		ctx->freed++;
+		if (item->values)
+			g_string_free(item->values, TRUE);
+		g_free(item);
+	}
+	g_slist_free(list);
+}
 
-	/*
-	 * Search after the current position in the remaining queue. The
-	 * custom code uses the queue's being sorted by sample number.
-	 * Narrow down a later insert position as much as possible. This
-	 * avoids linear search in huge spaces later on.
-	 */
-	last = NULL;
-	add_after_last = FALSE;
-	after_snum = NULL;
-	before_snum = NULL;
-	walk_list = ctx->vcd_queue_last;
-	while (walk_list) {
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
+static void queue_run_free(struct vcd_queue_run *run)
+{
+	sr_spill_free(run->spill);
+	g_string_free(run->values, TRUE);
+	g_free(run);
+}
+
+/* Load the next item of a run. Returns FALSE when the run is done. */
+static gboolean queue_run_next(struct vcd_queue_run *run)
+{
+	uint64_t snum;
+	uint32_t len;
+
+	if (run->read_pos >= run->write_pos)
+		return FALSE;
+	if (sr_spill_read(run->spill, run->read_pos, &snum, sizeof(snum)) != SR_OK
+			|| sr_spill_read(run->spill, run->read_pos + sizeof(snum),
+				&len, sizeof(len)) != SR_OK)
+		return FALSE;
+	run->read_pos += sizeof(snum) + sizeof(len);
+	g_string_set_size(run->values, len);
+	if (sr_spill_read(run->spill, run->read_pos,
+			run->values->str, len) != SR_OK)
+		return FALSE;
+	run->read_pos += len;
+	run->samplenum = snum;
+
+	return TRUE;
+}
+
+/*
+ * Take the pending value changes with the lowest sample number, from
+ * the queue in memory and from the runs in files. The text of queue
+ * items is swapped into @a values, rather than copied. Returns FALSE
+ * when nothing is pending before @a upto_snum.
+ */
+static gboolean queue_take(struct context *ctx, uint64_t upto_snum,
+	uint64_t *snum, GString **values)
+{
+	struct vcd_queue_item *item;
+	struct vcd_queue_run *run;
+	GString *buff;
+	GSList *l, *next;
+	gboolean found;
+
+	found = FALSE;
+	item = ctx->vcd_queue->len ? g_ptr_array_index(ctx->vcd_queue, 0) : NULL;
+	if (item) {
+		*snum = item->samplenum;
+		found = TRUE;
+	}
+	for (l = ctx->vcd_queue_runs; l; l = l->next) {
+		run = l->data;
+		if (!found || run->samplenum < *snum)
+			*snum = run->samplenum;
+		found = TRUE;
+	}
+	if (!found || *snum >= upto_snum)
+		return FALSE;
+
+	g_string_truncate(*values, 0);
+	if (item && item->samplenum == *snum) {
+		queue_heap_pop(ctx);
+		g_hash_table_remove(ctx->vcd_queue_index, &item->samplenum);
+		if (ctx->vcd_queue_last == item)
+			ctx->vcd_queue_last = NULL;
+		if (item->values) {
+			buff = item->values;
+			item->values = *values;
+			*values = buff;
 		}
-		last = walk_list;
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-		if (item->samplenum > snum) {
-			after_snum = walk_list;
-			break;
+		queue_free_item(ctx, item);
+	}
+	for (l = ctx->vcd_queue_runs; l; l = next) {
+		next = l->next;
+		run = l->data;
+		if (run->samplenum != *snum)
+			continue;
+		if ((*values)->len && run->values->len)
+			g_string_append_c(*values, ' ');
+		g_string_append_len(*values, run->values->str, run->values->len);
+		if (!queue_run_next(run)) {
+			ctx->vcd_queue_runs = g_slist_delete_link(
+				ctx->vcd_queue_runs, l);
+			queue_run_free(run);
 		}
-		if (!walk_list->next)
-			add_after_last = TRUE;
-		walk_list = walk_list->next;
 	}
 
-	/*
-	 * No exact match at or beyond the current position. Run another
-	 * search from the start of the queue, again restrict the space
-	 * which is searched, and narrow down the insert position when
-	 * no match is found.
-	 *
-	 * If the searched sample number is larger than any we have seen
-	 * before, or was in the above covered range but was not found,
-	 * then we know that another queue item needs to get added, and
-	 * where to put it. In that case we need not iterate the earlier
-	 * list items.
-	 */
-	walk_list = ctx->vcd_queue_list;
-	do_search = TRUE;
-	if (add_after_last)
-		do_search = FALSE;
-	if (before_snum)
-		do_search = FALSE;
-	while (do_search && walk_list && walk_list != ctx->vcd_queue_last) {
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-		if (item->samplenum > snum) {
-			after_snum = walk_list;
-			break;
-		}
-		walk_list = walk_list->next;
+	return TRUE;
+}
+
+/*
+ * Move all pending items to a new run, in the order of their sample
+ * numbers. Later value changes for these sample numbers go to new
+ * items, queue_take() merges them. When there are too many runs, they
+ * get merged into the new one as well.
+ */
+static int queue_spill(struct context *ctx)
+{
+	struct vcd_queue_run *run;
+	GSList *runs;
+	GString *values;
+	uint64_t snum;
+	uint32_t len;
+	int ret;
+
+	run = g_malloc0(sizeof(*run));
+	run->spill = sr_spill_new(ctx->sr_ctx, 0);
+	run->values = g_string_sized_new(32);
+	if (!run->spill) {
+		queue_run_free(run);
+		return SR_ERR_IO;
 	}
 
-	/*
-	 * The complete existing queue was exhausted, no exact match was
-	 * found. A new queue item must get inserted. Identify a good
-	 * position where to start searching for the exact position to
-	 * link the new item to the list. Assume that the combination of
-	 * the glib routine's list traversal and the sample number check
-	 * in the callback is expensive, reduce the amount of work done.
-	 *
-	 * If we have seen an item with a larger sample number than the
-	 * wanted, check its immediate predecessor. If this has a smaller
-	 * sample number, then we found a perfect location to insert the
-	 * new item. If we know that the new item must be inserted after
-	 * the last traversed queue item, start there.
-	 */
-	if (!before_snum) do {
-		if (add_after_last)
-			break;
-		if (!after_snum)
-			break;
-		walk_list = after_snum->prev;
-		if (!walk_list)
-			break;
-		item = walk_list->data;
-		if (!item)
-			break;
-		if (item->samplenum == snum) {
-			ctx->vcd_queue_last = walk_list;
-			return SR_OK;
-		}
-		if (item->samplenum < snum)
-			before_snum = walk_list;
-	} while (0);
-	add_list = add_after_last ? last : before_snum;
-	if (!add_list) {
-		walk_list = ctx->vcd_queue_list;
-		while (walk_list) {
-			item = walk_list->data;
-			if (!item)
-				break;
-			if (item->samplenum == snum) {
-				ctx->vcd_queue_last = walk_list;
-				return SR_OK;
-			}
-			if (item->samplenum > snum) {
-				after_snum = walk_list;
-				break;
-			}
-			add_list = walk_list;
-			walk_list = walk_list->next;
-		}
+	/* Detach the runs from the queue, unless they get merged. */
+	runs = NULL;
+	if (g_slist_length(ctx->vcd_queue_runs) < QUEUE_MAX_RUNS) {
+		runs = ctx->vcd_queue_runs;
+		ctx->vcd_queue_runs = NULL;
+	}
+
+	ret = SR_OK;
+	values = g_string_sized_new(32);
+	while (queue_take(ctx, ~UINT64_C(0), &snum, &values)) {
+		len = values->len;
+		if (ret == SR_OK)
+			ret = sr_spill_write(run->spill, run->write_pos,
+				&snum, sizeof(snum));
+		if (ret == SR_OK)
+			ret = sr_spill_write(run->spill,
+				run->write_pos + sizeof(snum), &len, sizeof(len));
+		if (ret == SR_OK)
+			ret = sr_spill_write(run->spill, run->write_pos
+				+ sizeof(snum) + sizeof(len), values->str, len);
+		run->write_pos += sizeof(snum) + sizeof(len) + len;
+	}
+	g_string_free(values, TRUE);
+	g_slist_free_full(ctx->vcd_queue_runs, (GDestroyNotify)queue_run_free);
+	ctx->vcd_queue_runs = runs;
+	queue_trim_pool(ctx);
+	sr_mem_release(ctx->sr_ctx, ctx->queue_charged);
+	ctx->queue_charged = 0;
+
+	if (ret != SR_OK || !queue_run_next(run)) {
+		queue_run_free(run);
+		return ret;
 	}
-	if (add_list && (item = add_list->data) && item->samplenum == snum) {
-		ctx->vcd_queue_last = add_list;
+	ctx->vcd_queue_runs = g_slist_append(ctx->vcd_queue_runs, run);
+
+	return SR_OK;
+}
+
+/*
+ * Charge a new item to the memory budget. When the budget is exhausted,
+ * up to another block of items stays in memory. Then the pending items
+ * go to a file, and the queue starts over in memory.
+ */
+static void queue_charge_item(struct context *ctx, struct vcd_queue_item *item)
+{
+	item->cost = sizeof(*item) + sizeof(*item->values)
+		+ item->values->allocated_len;
+	ctx->queue_bytes += item->cost;
+	if (ctx->queue_bytes <= ctx->queue_charged)
+		return;
+	if (sr_mem_reserve(ctx->sr_ctx, QUEUE_CHARGE_BLOCK)) {
+		ctx->queue_charged += QUEUE_CHARGE_BLOCK;
+		return;
+	}
+	if (ctx->queue_bytes < ctx->queue_charged + QUEUE_CHARGE_BLOCK)
+		return;
+	if (with_queue_stats)
+		sr_dbg("%s(), spilling %u items", __func__, ctx->vcd_queue->len);
+	if (queue_spill(ctx) != SR_OK)
+		sr_warn("Failed to move queued values to a file.");
+}
+
+/* Return memory of written items to the budget, keep some at hand. */
+static void queue_uncharge(struct context *ctx)
+{
+	while (ctx->queue_charged >= ctx->queue_bytes + 2 * QUEUE_CHARGE_BLOCK) {
+		sr_mem_release(ctx->sr_ctx, QUEUE_CHARGE_BLOCK);
+		ctx->queue_charged -= QUEUE_CHARGE_BLOCK;
+	}
+}
+
+/*
+ * Position the current pointer of the VCD value queue to a specific
+ * sample number. Create a new queue item when needed. Consecutive
+ * calls typically refer to the same sample number, that one is cached.
+ * Other numbers get looked up in the index of pending items. For
+ * trivial cases (logic only, one analog channel only) this queue is
+ * bypassed.
+ */
+static int queue_samplenum(struct context *ctx, uint64_t snum)
+{
+	struct vcd_queue_item *item;
+
+	/* Already at that position? */
+	item = ctx->vcd_queue_last;
+	if (item && item->samplenum == snum)
+		return SR_OK;
+
+	item = g_hash_table_lookup(ctx->vcd_queue_index, &snum);
+	if (item) {
+		ctx->vcd_queue_last = item;
 		return SR_OK;
 	}
 
-	/*
-	 * Create a new queue item for the so far untracked sample
-	 * number. Immediately search for the inserted position (is
-	 * unfortunately not returned from the insert call), and
-	 * cache that position for subsequent lookups.
-	 */
+	/* Create a new queue item for the so far untracked number. */
 	if (with_queue_stats)
 		sr_dbg("%s(), queue nr %" PRIu64, __func__, snum);
-	add_item = queue_alloc_item(ctx, snum);
-	if (!add_item)
+	item = queue_alloc_item(ctx, snum);
+	if (!item)
 		return SR_ERR_MALLOC;
-	if (!add_list)
-		add_list = ctx->vcd_queue_list;
-	if (add_list && add_list->prev)
-		add_list = add_list->prev;
-	walk_list = g_list_insert_sorted(add_list, add_item, cmp_items);
-	if (!walk_list->prev)
-		ctx->vcd_queue_list = walk_list;
-	walk_list = g_list_find_custom(walk_list, &snum, cmp_snum);
-	item = walk_list ? walk_list->data : NULL;
-	if (item && item->samplenum == snum) {
-		ctx->vcd_queue_last = walk_list;
-	}
+	queue_charge_item(ctx, item);
+	queue_heap_push(ctx, item);
+	g_hash_table_insert(ctx->vcd_queue_index, &item->samplenum, item);
+	ctx->vcd_queue_last = item;
+
 	return SR_OK;
 }
 
@@ -766,7 +966,7 @@ static GString *queue_value_text_prep(struct context *ctx)
 	GString *buff;
 
 	/* Cope with not-yet-positioned write pointers. */
-	item = ctx->vcd_queue_last ? ctx->vcd_queue_last->data : NULL;
+	item = ctx->vcd_queue_last;
 	if (!item)
 		return NULL;
 
@@ -784,26 +984,32 @@ static GString *queue_value_text_prep(struct context *ctx)
 	return buff;
 }
 
-static double snum_to_ts(struct context *ctx, uint64_t snum)
+/*
+ * Timestamps are the sample number times the timescale period. Split
+ * the multiplication, to not overflow for large sample numbers, and
+ * round to the nearest timescale unit.
+ */
+static uint64_t snum_to_ts(struct context *ctx, uint64_t snum)
 {
-	double ts;
+	uint64_t q, r;
+
+	if (ctx->ts_den == 1)
+		return snum * ctx->ts_num;
 
-	ts = (double)snum;
-	ts /= ctx->samplerate;
-	ts *= ctx->period;
+	q = snum / ctx->ts_den;
+	r = snum % ctx->ts_den;
 
-	return ts;
+	return q * ctx->ts_num + (r * ctx->ts_num + ctx->ts_den / 2) / ctx->ts_den;
 }
 
 /*
- * Unqueue one item of the VCD values queue which corresponds to one
- * sample number. Append all of the text to the passed in GString.
+ * Unqueue the value changes which correspond to one sample number.
+ * Append all of the text to the passed in GString.
  */
 static int unqueue_item(struct context *ctx,
-	struct vcd_queue_item *item, GString *s)
+	uint64_t samplenum, GString *buff, GString *s)
 {
-	double ts;
-	GString *buff;
+	uint64_t ts;
 	gboolean is_empty;
 
 	/*
@@ -812,8 +1018,7 @@ static int unqueue_item(struct context *ctx,
 	 * timestamp but no value changes, assuming this is the last
 	 * entry which corresponds to SR_DF_END.
 	 */
-	ts = snum_to_ts(ctx, item->samplenum);
-	buff = item->values;
+	ts = snum_to_ts(ctx, samplenum);
 	is_empty = !buff || !buff->len || !buff->str || !*buff->str;
 	append_vcd_timestamp(s, ts, is_empty);
 	if (!is_empty)
@@ -933,9 +1138,7 @@ static uint64_t get_max_snum_flush(struct context *ctx)
  */
 static int write_completed_changes(struct context *ctx, GString *out)
 {
-	uint64_t upto_snum;
-	GList **listref, *node;
-	struct vcd_queue_item *item;
+	uint64_t upto_snum, snum;
 	int rc;
 	size_t dumped;
 
@@ -945,36 +1148,238 @@ static int write_completed_changes(struct context *ctx, GString *out)
 		sr_spew("%s(), check up to %" PRIu64, __func__, upto_snum);
 
 	/*
-	 * Forward and consume those items from the head of the list
-	 * which we completely have accumulated and are certain about.
+	 * Forward and consume those items from the top of the heap
+	 * (and the runs in files) which we completely have accumulated
+	 * and are certain about. Append their timestamps and values to
+	 * the caller's text.
 	 */
 	dumped = 0;
-	listref = &ctx->vcd_queue_list;
-	while (*listref) {
-		/* Find items before the targetted sample number. */
-		node = *listref;
-		item = node->data;
-		if (!item)
-			break;
-		if (item->samplenum >= upto_snum)
-			break;
-
-		/*
-		 * Unlink the item from the list. Void cached positions.
-		 * Append its timestamp and values to the caller's text.
-		 */
+	if (!ctx->merge_values)
+		ctx->merge_values = g_string_sized_new(32);
+	while (queue_take(ctx, upto_snum, &snum, &ctx->merge_values)) {
 		dumped++;
 		if (with_queue_stats)
-			sr_dbg("%s(), dump nr %" PRIu64,
-				__func__, item->samplenum);
-		if (ctx->vcd_queue_last == node)
-			ctx->vcd_queue_last = NULL;
-		*listref = g_list_remove_link(*listref, node);
-		rc = unqueue_item(ctx, item, out);
-		queue_free_item(ctx, item);
+			sr_dbg("%s(), dump nr %" PRIu64, __func__, snum);
+		rc = unqueue_item(ctx, snum, ctx->merge_values, out);
 		if (rc != SR_OK)
 			return rc;
 	}
+	queue_uncharge(ctx);
+
+	return SR_OK;
+}
+
+/* Load up to 8 bytes of a sample, bit k of the word is channel k. */
+static inline uint64_t load_word(const uint8_t *p, size_t len)
+{
+	uint64_t word;
+
+	if (len == sizeof(word))
+		return RL64(p);
+	word = 0;
+	while (len--)
+		word = (word << 8) | p[len];
+
+	return word;
+}
+
+static inline size_t lowest_bit(uint64_t word)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(word);
+#else
+	size_t bit;
+
+	for (bit = 0; !(word & 1); bit++)
+		word >>= 1;
+
+	return bit;
+#endif
+}
+
+/* Make room for the last sample and the change masks of a unit size. */
+static int logic_state_size(struct context *ctx, size_t unit_size)
+{
+	uint8_t *last;
+	uint64_t *diff;
+
+	if (unit_size <= ctx->last_logic_size)
+		return SR_OK;
+
+	last = g_try_realloc(ctx->last_logic, unit_size);
+	if (!last)
+		return SR_ERR_MALLOC;
+	memset(last + ctx->last_logic_size, 0,
+		unit_size - ctx->last_logic_size);
+	ctx->last_logic = last;
+	ctx->last_logic_size = unit_size;
+	diff = g_try_realloc(ctx->logic_diff,
+		sizeof(*diff) * ((unit_size + 7) / 8 + 1));
+	if (!diff)
+		return SR_ERR_MALLOC;
+	ctx->logic_diff = diff;
+
+	return SR_OK;
+}
+
+/*
+ * Track value changes of the logic channels for one sample. The text
+ * goes to the output directly, or into the queue when analog channels
+ * are involved.
+ */
+static void process_logic_sample(struct context *ctx, const uint8_t *sample,
+	size_t unit_size, uint64_t snum_curr, GString *out)
+{
+	struct vcd_channel_desc *desc;
+	size_t w, num_words, len, index;
+	uint64_t diff, force;
+	gboolean changed;
+	GString *s_val;
+	uint8_t curbit;
+	uint64_t ts;
+
+	/*
+	 * Find the changed channels, 64 at a time. The first sample
+	 * has all values dumped.
+	 */
+	num_words = (unit_size + 7) / 8;
+	force = snum_curr == 0 ? ~UINT64_C(0) : 0;
+	changed = FALSE;
+	for (w = 0; w < num_words; w++) {
+		len = MIN(sizeof(diff), unit_size - w * sizeof(diff));
+		diff = load_word(sample + w * sizeof(diff), len);
+		diff ^= load_word(ctx->last_logic + w * sizeof(diff), len);
+		ctx->logic_diff[w] = diff | force;
+		changed |= ctx->logic_diff[w] != 0;
+	}
+	if (!changed)
+		return;
+	memcpy(ctx->last_logic, sample, unit_size);
+
+	/*
+	 * Start or continue tracking that sample number.
+	 * Avoid string copies for logic-only setups.
+	 */
+	if (ctx->immediate_write) {
+		ts = snum_to_ts(ctx, snum_curr);
+		append_vcd_timestamp(out, ts, FALSE);
+	} else {
+		queue_samplenum(ctx, snum_curr);
+	}
+
+	/*
+	 * Only visit the changed channels. The data image is dense, bit
+	 * positions are the indices of the logic channels.
+	 */
+	for (w = 0; w < num_words; w++) {
+		diff = ctx->logic_diff[w];
+		while (diff) {
+			index = w * 64 + lowest_bit(diff);
+			diff &= diff - 1;
+			if (index >= ctx->bit_desc_count)
+				break;
+			desc = ctx->bit_desc[index];
+			if (!desc)
+				continue;
+			curbit = (sample[index / 8] >> (index % 8)) & 1;
+			desc->last.logic = curbit;
+
+			/*
+			 * Queue, or immediately emit the text for
+			 * the observed value change.
+			 */
+			if (ctx->immediate_write) {
+				g_string_append_c(out, ' ');
+				s_val = out;
+			} else {
+				s_val = queue_value_text_prep(ctx);
+				if (!s_val)
+					return;
+			}
+			format_vcd_value_bit(s_val, curbit, desc->name);
+		}
+	}
+}
+
+/*
+ * Track value changes of the logic channels in planar data. Only the
+ * planes of the enabled channels get read, 64 samples at a time, and
+ * only the samples with changes get visited.
+ */
+static int process_logic_planar(struct context *ctx,
+	const struct sr_datafeed_logic_planar *planar, uint64_t snum_first,
+	GString *out)
+{
+	struct vcd_channel_desc *desc;
+	const uint8_t *plane;
+	size_t index, plane_count, bit;
+	uint64_t block, num_blocks, word, prev, valid, any, snum;
+	GString *s_val;
+	uint8_t curbit;
+	uint64_t ts;
+
+	plane_count = MIN(ctx->bit_desc_count, (size_t)planar->unitsize * 8);
+	num_blocks = (planar->num_samples + 63) / 64;
+	for (block = 0; block < num_blocks; block++) {
+		valid = ~UINT64_C(0);
+		if (planar->num_samples - block * 64 < 64)
+			valid >>= 64 - (planar->num_samples - block * 64);
+
+		/* Samples differ from their predecessor where bits change. */
+		any = 0;
+		for (index = 0; index < plane_count; index++) {
+			ctx->plane_diff[index] = 0;
+			if (!ctx->bit_desc[index])
+				continue;
+			plane = (const uint8_t *)planar->data
+				+ index * planar->stride + block * 8;
+			word = RL64(plane);
+			if (block)
+				prev = RL64(plane - 8) >> 63;
+			else
+				prev = (ctx->last_logic[index / 8] >> (index % 8)) & 1;
+			ctx->plane_diff[index] = (word ^ ((word << 1) | prev)) & valid;
+			/* The first sample has all values dumped. */
+			if (snum_first + block * 64 == 0)
+				ctx->plane_diff[index] |= 1;
+			any |= ctx->plane_diff[index];
+		}
+
+		while (any) {
+			bit = lowest_bit(any);
+			any &= any - 1;
+			snum = snum_first + block * 64 + bit;
+			if (ctx->immediate_write) {
+				ts = snum_to_ts(ctx, snum);
+				append_vcd_timestamp(out, ts, FALSE);
+			} else {
+				queue_samplenum(ctx, snum);
+			}
+			for (index = 0; index < plane_count; index++) {
+				if (!((ctx->plane_diff[index] >> bit) & 1))
+					continue;
+				desc = ctx->bit_desc[index];
+				plane = (const uint8_t *)planar->data
+					+ index * planar->stride + block * 8;
+				curbit = (RL64(plane) >> bit) & 1;
+				desc->last.logic = curbit;
+				if (ctx->immediate_write) {
+					g_string_append_c(out, ' ');
+					s_val = out;
+				} else {
+					s_val = queue_value_text_prep(ctx);
+					if (!s_val)
+						return SR_ERR_MALLOC;
+				}
+				format_vcd_value_bit(s_val, curbit, desc->name);
+			}
+		}
+	}
+
+	/* Continue from the last sample with the next packet. */
+	if (planar->num_samples)
+		sr_logic_planar_decode_range(planar, planar->num_samples - 1,
+			1, ctx->last_logic);
 
 	return SR_OK;
 }
@@ -986,20 +1391,22 @@ static int receive(const struct sr_output *o,
 	struct context *ctx;
 	const struct sr_datafeed_meta *meta;
 	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_datafeed_logic_planar *planar;
 	const struct sr_datafeed_analog *analog;
 	const struct sr_config *src;
 	GSList *l;
 	struct vcd_channel_desc *desc;
-	uint64_t snum_curr;
-	size_t count, index, p, unit_size;
+	uint64_t snum_curr, run;
+	size_t count, index, unit_size;
 	gboolean changed;
 	GString *s_val;
-	uint8_t *sample, *last_logic, prevbit, curbit;
+	uint8_t *sample;
 	GSList *channels;
 	struct sr_channel *channel;
 	int rc;
 	float *floats, value;
-	double ts;
+	uint64_t ts;
 
 	*out = NULL;
 	if (!o || !o->priv)
@@ -1023,74 +1430,69 @@ static int receive(const struct sr_output *o,
 		sample = logic->data;
 		unit_size = logic->unitsize;
 		count = logic->length / unit_size;
+		rc = logic_state_size(ctx, unit_size);
+		if (rc != SR_OK)
+			return rc;
+		if (!ctx->kernels || ctx->kernels_unit_size != unit_size) {
+			ctx->kernels = sr_logic_kernels_get(unit_size);
+			ctx->kernels_unit_size = unit_size;
+		}
 		snum_curr = get_last_snum_logic(ctx);
 		upd_last_snum_logic(ctx, count);
 
-		last_logic = ctx->last_logic;
-		while (count--) {
-			/* Check whether any logic value has changed. */
-			changed = memcmp(last_logic, sample, unit_size) != 0;
-			changed |= snum_curr == 0;
-			if (changed)
-				memcpy(last_logic, sample, unit_size);
-
-			/*
-			 * Start or continue tracking that sample number.
-			 * Avoid string copies for logic-only setups.
-			 */
-			if (changed) {
-				if (ctx->immediate_write) {
-					ts = snum_to_ts(ctx, snum_curr);
-					append_vcd_timestamp(*out, ts, FALSE);
-				} else {
-					queue_samplenum(ctx, snum_curr);
-				}
+		while (count) {
+			/* Skip over samples without changes. */
+			if (snum_curr) {
+				run = ctx->kernels->unchanged(sample, unit_size,
+					count, ctx->last_logic);
+				snum_curr += run;
+				sample += run * unit_size;
+				count -= run;
+				if (!count)
+					break;
 			}
-
-			/* Iterate over individual logic channels. */
-			for (p = 0; changed && p < ctx->enabled_count; p++) {
-				/*
-				 * TODO Check whether the mapping from
-				 * data image positions to channel numbers
-				 * is required. Experiments suggest that
-				 * the data image "is dense", and packs
-				 * bits of enabled channels, and leaves no
-				 * room for positions of disabled channels.
-				 */
-				desc = &ctx->channels[p];
-				if (desc->type != SR_CHANNEL_LOGIC)
-					continue;
-				index = desc->index;
-				prevbit = desc->last.logic;
-
-				/* Skip over unchanged values. */
-				curbit = sample[index / 8];
-				curbit = (curbit & (1 << (index % 8))) ? 1 : 0;
-				if (snum_curr != 0 && prevbit == curbit)
-					continue;
-				desc->last.logic = curbit;
-
-				/*
-				 * Queue, or immediately emit the text for
-				 * the observed value change.
-				 */
-				if (ctx->immediate_write) {
-					g_string_append_c(*out, ' ');
-					s_val = *out;
-				} else {
-					s_val = queue_value_text_prep(ctx);
-					if (!s_val)
-						break;
-				}
-				format_vcd_value_bit(s_val, curbit, desc->name);
-			}
-
-			/* Advance to next set of logic samples. */
+			process_logic_sample(ctx, sample, unit_size,
+				snum_curr, *out);
 			snum_curr++;
 			sample += unit_size;
+			count--;
 		}
 		write_completed_changes(ctx, *out);
 		break;
+	case SR_DF_LOGIC_RLE:
+		*out = chk_header(o);
+
+		/* Values can only change at the start of a run. */
+		rle = packet->payload;
+		sample = rle->values;
+		unit_size = rle->unitsize;
+		rc = logic_state_size(ctx, unit_size);
+		if (rc != SR_OK)
+			return rc;
+		snum_curr = get_last_snum_logic(ctx);
+		upd_last_snum_logic(ctx, sr_logic_rle_num_samples(rle));
+		for (run = 0; run < rle->num_runs; run++) {
+			process_logic_sample(ctx, sample, unit_size,
+				snum_curr, *out);
+			snum_curr += rle->lengths[run];
+			sample += unit_size;
+		}
+		write_completed_changes(ctx, *out);
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		*out = chk_header(o);
+
+		planar = packet->payload;
+		rc = logic_state_size(ctx, planar->unitsize);
+		if (rc != SR_OK)
+			return rc;
+		snum_curr = get_last_snum_logic(ctx);
+		upd_last_snum_logic(ctx, planar->num_samples);
+		rc = process_logic_planar(ctx, planar, snum_curr, *out);
+		if (rc != SR_OK)
+			return rc;
+		write_completed_changes(ctx, *out);
+		break;
 	case SR_DF_ANALOG:
 		*out = chk_header(o);
 
@@ -1172,6 +1574,12 @@ static int receive(const struct sr_output *o,
 		break;
 	}
 
+	/* Follow the output rate, but let the hint decay after bursts. */
+	if (*out) {
+		ctx->out_size_hint -= ctx->out_size_hint / 4;
+		ctx->out_size_hint = MAX(ctx->out_size_hint, (*out)->len);
+	}
+
 	return SR_OK;
 }
 
@@ -1189,6 +1597,12 @@ static int cleanup(struct sr_output *o)
 		sr_info("STATS: alloc/reuse %zu/%zu, pool/free %zu/%zu",
 			ctx->alloced, ctx->reused, ctx->pooled, ctx->freed);
 	queue_drain_pool(ctx);
+	g_hash_table_destroy(ctx->vcd_queue_index);
+	g_ptr_array_free(ctx->vcd_queue, TRUE);
+	g_slist_free_full(ctx->vcd_queue_runs, (GDestroyNotify)queue_run_free);
+	if (ctx->merge_values)
+		g_string_free(ctx->merge_values, TRUE);
+	sr_mem_release(ctx->sr_ctx, ctx->queue_charged);
 	if (with_pool_stats)
 		sr_info("STATS: alloc/reuse %zu/%zu, pool/free %zu/%zu",
 			ctx->alloced, ctx->reused, ctx->pooled, ctx->freed);
@@ -1198,6 +1612,10 @@ static int cleanup(struct sr_output *o)
 		g_string_free(desc->name, TRUE);
 	}
 	g_free(ctx->channels);
+	g_free(ctx->last_logic);
+	g_free(ctx->logic_diff);
+	g_free(ctx->bit_desc);
+	g_free(ctx->plane_diff);
 	g_free(ctx);
 
 	return SR_OK;
@@ -1208,7 +1626,7 @@ struct sr_output_module output_vcd = {
 	.name = "VCD",
 	.desc = "Value Change Dump data",
 	.exts = (const char*[]){"vcd", NULL},
-	.flags = 0,
+	.flags = SR_OUTPUT_LOGIC_RLE | SR_OUTPUT_LOGIC_PLANAR,
 	.options = NULL,
 	.init = init,
 	.receive = receive,
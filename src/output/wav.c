@@ -18,7 +18,13 @@
  */
 
 #include <config.h>
+#include <errno.h>
 #include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -27,6 +33,17 @@
 /* Minimum/maximum number of samples per channel to put in a data chunk */
 #define MIN_DATA_CHUNK_SAMPLES 10
 
+/* Offsets of the size fields, and the size of the header. */
+#define RIFF_SIZE_OFFSET 4
+#define DATA_SIZE_OFFSET 42
+#define HEADER_SIZE 46
+
+enum sample_format {
+	FORMAT_FLOAT,
+	FORMAT_INT16,
+	FORMAT_INT24,
+};
+
 struct out_context {
 	double scale;
 	gboolean header_done;
@@ -35,10 +52,20 @@ struct out_context {
 	GSList *channels;
 	int chanbuf_size;
 	int *chanbuf_used;
-	uint8_t **chanbuf;
+	float **chanbuf;
 	float *fdata;
+	int *chan_idx;
+	enum sample_format format;
+	int sample_size;
+	/* Interleaved output data, reused across packets. */
+	uint8_t *outbuf;
+	size_t outbuf_size;
+	/* Caller's file descriptor for direct writes, or -1. */
+	int fd;
+	uint64_t data_bytes;
 };
 
+/* Grow the channel buffers, pending samples are kept. */
 static int realloc_chanbufs(const struct sr_output *o, int size)
 {
 	struct out_context *outc;
@@ -50,42 +77,148 @@ static int realloc_chanbufs(const struct sr_output *o, int size)
 			sr_err("Unable to allocate enough output buffer memory.");
 			return SR_ERR;
 		}
-		outc->chanbuf_used[i] = 0;
 	}
 	outc->chanbuf_size = size;
 
 	return SR_OK;
 }
 
+static int write_all(int fd, const uint8_t *buf, size_t len)
+{
+	ssize_t ret;
+
+	while (len) {
+		ret = write(fd, buf, len);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			sr_err("Cannot write WAV data: %s.", g_strerror(errno));
+			return SR_ERR_IO;
+		}
+		buf += ret;
+		len -= ret;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Hand out the output data, either as text for the caller or directly
+ * to the caller's file descriptor.
+ */
+static int emit(const struct sr_output *o, GString *out,
+	const uint8_t *buf, size_t len)
+{
+	struct out_context *outc;
+
+	outc = o->priv;
+	if (outc->fd < 0) {
+		g_string_append_len(out, (const char *)buf, len);
+		return SR_OK;
+	}
+
+	return write_all(outc->fd, buf, len);
+}
+
+/*
+ * Stores the float in little-endian BINARY32 IEEE-754 2008 format.
+ */
+static void float_to_le(uint8_t *buf, float value)
+{
+	uint8_t *old;
+
+	old = (uint8_t *)&value;
+#ifdef WORDS_BIGENDIAN
+	buf[0] = old[3];
+	buf[1] = old[2];
+	buf[2] = old[1];
+	buf[3] = old[0];
+#else
+	buf[0] = old[0];
+	buf[1] = old[1];
+	buf[2] = old[2];
+	buf[3] = old[3];
+#endif
+}
+
+/* Map a float in the -1.0 to +1.0 range to a PCM sample value. */
+static inline int32_t float_to_pcm(float value, float full_scale)
+{
+	value *= full_scale;
+	if (value >= full_scale)
+		return full_scale;
+	if (!(value > -full_scale))
+		return -full_scale;
+
+	return value < 0 ? value - 0.5f : value + 0.5f;
+}
+
+/*
+ * Convert one channel's samples, and store them in their slots of
+ * the interleaved output. The loops don't depend on previous samples,
+ * which lets the compiler vectorize them.
+ */
+static void convert_channel(struct out_context *outc, int ch,
+	uint8_t *dst, int num_samples)
+{
+	const float *src;
+	size_t stride;
+	int32_t v;
+	int i;
+
+	src = outc->chanbuf[ch];
+	stride = outc->sample_size * outc->num_channels;
+	dst += ch * outc->sample_size;
+	switch (outc->format) {
+	case FORMAT_FLOAT:
+		for (i = 0; i < num_samples; i++, dst += stride)
+			float_to_le(dst, src[i]);
+		break;
+	case FORMAT_INT16:
+		for (i = 0; i < num_samples; i++, dst += stride) {
+			v = float_to_pcm(src[i], INT16_MAX);
+			WL16(dst, v);
+		}
+		break;
+	case FORMAT_INT24:
+		for (i = 0; i < num_samples; i++, dst += stride) {
+			v = float_to_pcm(src[i], (1 << 23) - 1);
+			WL24(dst, v);
+		}
+		break;
+	}
+}
+
 static int flush_chanbufs(const struct sr_output *o, GString *out)
 {
 	struct out_context *outc;
-	int num_samples, i, j;
-	char *buf, *bufp;
+	int num_samples, i, ret;
+	size_t size;
 
 	outc = o->priv;
 
 	/* Any one of them will do. */
 	num_samples = outc->chanbuf_used[0];
-	if (!(buf = g_try_malloc(4 * num_samples * outc->num_channels))) {
-		sr_err("Unable to allocate enough interleaved output buffer memory.");
-		return SR_ERR;
-	}
-
-	bufp = buf;
-	for (i = 0; i < num_samples; i++) {
-		for (j = 0; j < outc->num_channels; j++) {
-			memcpy(bufp, outc->chanbuf[j] + i * 4, 4);
-			bufp += 4;
+	size = (size_t)outc->sample_size * num_samples * outc->num_channels;
+	if (size > outc->outbuf_size) {
+		g_free(outc->outbuf);
+		if (!(outc->outbuf = g_try_malloc(size))) {
+			outc->outbuf_size = 0;
+			sr_err("Unable to allocate enough interleaved output buffer memory.");
+			return SR_ERR;
 		}
+		outc->outbuf_size = size;
 	}
-	g_string_append_len(out, buf, 4 * num_samples * outc->num_channels);
-	g_free(buf);
+
+	for (i = 0; i < outc->num_channels; i++)
+		convert_channel(outc, i, outc->outbuf, num_samples);
+	ret = emit(o, out, outc->outbuf, size);
+	outc->data_bytes += size;
 
 	for (i = 0; i < outc->num_channels; i++)
 		outc->chanbuf_used[i] = 0;
 
-	return SR_OK;
+	return ret;
 }
 
 static int init(struct sr_output *o, GHashTable *options)
@@ -93,10 +226,28 @@ static int init(struct sr_output *o, GHashTable *options)
 	struct out_context *outc;
 	struct sr_channel *ch;
 	GSList *l;
+	const char *format;
 
 	outc = g_malloc0(sizeof(struct out_context));
 	o->priv = outc;
 	outc->scale = g_variant_get_double(g_hash_table_lookup(options, "scale"));
+	format = g_variant_get_string(g_hash_table_lookup(options, "format"), NULL);
+	if (!strcmp(format, "int16")) {
+		outc->format = FORMAT_INT16;
+		outc->sample_size = 2;
+	} else if (!strcmp(format, "int24")) {
+		outc->format = FORMAT_INT24;
+		outc->sample_size = 3;
+	} else if (!strcmp(format, "float")) {
+		outc->format = FORMAT_FLOAT;
+		outc->sample_size = 4;
+	} else {
+		sr_err("Unknown sample format '%s'.", format);
+		g_free(outc);
+		o->priv = NULL;
+		return SR_ERR_ARG;
+	}
+	outc->fd = g_variant_get_int32(g_hash_table_lookup(options, "fd"));
 
 	for (l = o->sdi->channels; l; l = l->next) {
 		ch = l->data;
@@ -110,6 +261,7 @@ static int init(struct sr_output *o, GHashTable *options)
 
 	outc->chanbuf = g_malloc0(sizeof(float *) * outc->num_channels);
 	outc->chanbuf_used = g_malloc0(sizeof(int) * outc->num_channels);
+	outc->chan_idx = g_malloc0(sizeof(int) * outc->num_channels);
 
 	/* Start off the interleaved buffer with 100 samples/channel. */
 	realloc_chanbufs(o, 100);
@@ -127,8 +279,8 @@ static void add_data_chunk(const struct sr_output *o, GString *gs)
 	/* Remaining chunk size */
 	WL32(tmp, 0x12);
 	g_string_append_len(gs, tmp, 4);
-	/* Format code 3 = IEEE float */
-	WL16(tmp, 0x0003);
+	/* Format code 3 = IEEE float, 1 = PCM */
+	WL16(tmp, outc->format == FORMAT_FLOAT ? 0x0003 : 0x0001);
 	g_string_append_len(gs, tmp, 2);
 	/* Number of channels */
 	WL16(tmp, outc->num_channels);
@@ -136,14 +288,14 @@ static void add_data_chunk(const struct sr_output *o, GString *gs)
 	/* Samplerate */
 	WL32(tmp, outc->samplerate);
 	g_string_append_len(gs, tmp, 4);
-	/* Byterate, using 32-bit floats. */
-	WL32(tmp, outc->samplerate * outc->num_channels * 4);
+	/* Byterate */
+	WL32(tmp, outc->samplerate * outc->num_channels * outc->sample_size);
 	g_string_append_len(gs, tmp, 4);
 	/* Blockalign */
-	WL16(tmp, outc->num_channels * 4);
+	WL16(tmp, outc->num_channels * outc->sample_size);
 	g_string_append_len(gs, tmp, 2);
 	/* Bits per sample */
-	WL16(tmp, 32);
+	WL16(tmp, outc->sample_size * 8);
 	g_string_append_len(gs, tmp, 2);
 	WL16(tmp, 0);
 	g_string_append_len(gs, tmp, 2);
@@ -182,24 +334,40 @@ static GString *gen_header(const struct sr_output *o)
 }
 
 /*
- * Stores the float in little-endian BINARY32 IEEE-754 2008 format.
+ * Put the final sizes into the header of directly written files. Pipes
+ * and other unseekable descriptors keep the maxed out fields.
  */
-static void float_to_le(uint8_t *buf, float value)
+static int patch_header(const struct sr_output *o)
 {
-	uint8_t *old;
+	struct out_context *outc;
+	uint8_t tmp[4];
+	off_t end;
+	int ret;
 
-	old = (uint8_t *)&value;
-#ifdef WORDS_BIGENDIAN
-	buf[0] = old[3];
-	buf[1] = old[2];
-	buf[2] = old[1];
-	buf[3] = old[0];
-#else
-	buf[0] = old[0];
-	buf[1] = old[1];
-	buf[2] = old[2];
-	buf[3] = old[3];
-#endif
+	outc = o->priv;
+	end = lseek(outc->fd, 0, SEEK_CUR);
+	if (end < 0)
+		return SR_OK;
+	if (outc->data_bytes + HEADER_SIZE - 8 > UINT32_MAX) {
+		sr_warn("WAV data exceeds 4GiB, keeping unknown sizes.");
+		return SR_OK;
+	}
+
+	ret = SR_OK;
+	WL32(tmp, outc->data_bytes + HEADER_SIZE - 8);
+	if (lseek(outc->fd, RIFF_SIZE_OFFSET, SEEK_SET) < 0
+			|| write_all(outc->fd, tmp, sizeof(tmp)) != SR_OK)
+		ret = SR_ERR_IO;
+	WL32(tmp, outc->data_bytes);
+	if (ret == SR_OK && (lseek(outc->fd, DATA_SIZE_OFFSET, SEEK_SET) < 0
+			|| write_all(outc->fd, tmp, sizeof(tmp)) != SR_OK))
+		ret = SR_ERR_IO;
+	if (lseek(outc->fd, end, SEEK_SET) < 0)
+		ret = SR_ERR_IO;
+	if (ret != SR_OK)
+		sr_err("Cannot update the WAV header sizes.");
+
+	return ret;
 }
 
 /*
@@ -243,10 +411,11 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	struct sr_channel *ch;
 	GSList *l;
 	const GSList *channels;
-	float f;
+	float scale, *dst;
+	const float *srcp;
 	int num_channels, num_samples, size, *chan_idx, idx, i, j, ret;
 	float *data;
-	uint8_t *buf;
+	GString *header;
 
 	*out = NULL;
 	if (!o || !o->sdi || !(outc = o->priv))
@@ -264,9 +433,18 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		break;
 	case SR_DF_ANALOG:
 		if (!outc->header_done) {
-			*out = gen_header(o);
+			header = gen_header(o);
 			outc->header_done = TRUE;
-		} else {
+			if (outc->fd >= 0) {
+				ret = write_all(outc->fd, (const uint8_t *)header->str,
+					header->len);
+				g_string_free(header, TRUE);
+				if (ret != SR_OK)
+					return ret;
+			} else {
+				*out = header;
+			}
+		} else if (outc->fd < 0) {
 			*out = g_string_sized_new(512);
 		}
 
@@ -290,29 +468,34 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			return SR_ERR;
 		}
 
-		if (num_samples > outc->chanbuf_size) {
-			if (realloc_chanbufs(o, analog->num_samples) != SR_OK)
-				return SR_ERR_MALLOC;
-		}
-
 		/* Index the channels in this packet, so we can interleave quicker. */
-		chan_idx = g_malloc(sizeof(int) * outc->num_channels);
+		chan_idx = outc->chan_idx;
 		for (i = 0; i < num_channels; i++) {
 			ch = g_slist_nth_data((GSList *) channels, i);
 			chan_idx[i] = g_slist_index(outc->channels, ch);
 		}
 
-		for (i = 0; i < num_samples; i++) {
-			for (j = 0; j < num_channels; j++) {
-				idx = chan_idx[j];
-				buf = outc->chanbuf[idx] + outc->chanbuf_used[idx]++ * 4;
-				f = data[i * num_channels + j];
-				if (outc->scale != 1.0)
-					f /= outc->scale;
-				float_to_le(buf, f);
+		/* De-interleave into the channel buffers, and apply the scale. */
+		scale = outc->scale;
+		for (j = 0; j < num_channels; j++) {
+			idx = chan_idx[j];
+			if (idx < 0)
+				continue;
+			if (outc->chanbuf_used[idx] + num_samples > outc->chanbuf_size) {
+				if (realloc_chanbufs(o, outc->chanbuf_used[idx] + num_samples) != SR_OK)
+					return SR_ERR_MALLOC;
+			}
+			dst = outc->chanbuf[idx] + outc->chanbuf_used[idx];
+			srcp = data + j;
+			if (scale != 1.0) {
+				for (i = 0; i < num_samples; i++)
+					dst[i] = srcp[i * num_channels] / scale;
+			} else {
+				for (i = 0; i < num_samples; i++)
+					dst[i] = srcp[i * num_channels];
 			}
+			outc->chanbuf_used[idx] += num_samples;
 		}
-		g_free(chan_idx);
 
 		size = check_chanbuf_size(o);
 		if (size > MIN_DATA_CHUNK_SAMPLES)
@@ -322,10 +505,13 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	case SR_DF_END:
 		size = check_chanbuf_size(o);
 		if (size > 0) {
-			*out = g_string_sized_new(4 * size * outc->num_channels);
+			if (outc->fd < 0)
+				*out = g_string_sized_new(outc->sample_size * size * outc->num_channels);
 			if (flush_chanbufs(o, *out) != SR_OK)
 				return SR_ERR;
 		}
+		if (outc->fd >= 0 && outc->header_done)
+			return patch_header(o);
 		break;
 	}
 
@@ -334,13 +520,24 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 
 static struct sr_option options[] = {
 	{ "scale", "Scale", "Scale values by factor", NULL, NULL },
+	{ "format", "Format", "Sample format (float, int16, int24)", NULL, NULL },
+	{ "fd", "File descriptor", "Write directly to an open file descriptor", NULL, NULL },
 	ALL_ZERO
 };
 
 static const struct sr_option *get_options(void)
 {
-	if (!options[0].def)
+	GSList *l = NULL;
+
+	if (!options[0].def) {
 		options[0].def = g_variant_ref_sink(g_variant_new_double(1.0));
+		options[1].def = g_variant_ref_sink(g_variant_new_string("float"));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("float")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("int16")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("int24")));
+		options[1].values = l;
+		options[2].def = g_variant_ref_sink(g_variant_new_int32(-1));
+	}
 
 	return options;
 }
@@ -351,13 +548,16 @@ static int cleanup(struct sr_output *o)
 	int i;
 
 	outc = o->priv;
+	if (!outc)
+		return SR_OK;
 	g_slist_free(outc->channels);
-	g_variant_unref(options[0].def);
 	for (i = 0; i < outc->num_channels; i++)
 		g_free(outc->chanbuf[i]);
 	g_free(outc->chanbuf_used);
 	g_free(outc->chanbuf);
+	g_free(outc->chan_idx);
 	g_free(outc->fdata);
+	g_free(outc->outbuf);
 	g_free(outc);
 	o->priv = NULL;
 
@@ -24,45 +24,69 @@
 
 #define LOG_PREFIX "output/wavedrom"
 
+/* A run of samples in which a channel keeps its state. */
+struct wave_run {
+	uint64_t length;
+	char state;
+};
+
 struct context {
 	uint32_t channel_count;
 	struct sr_channel **channels;
-	GString **channel_outputs; /* output strings */
+	/* Completed runs of each enabled channel, NULL for the others. */
+	GArray **channel_runs;
+	/* The run each channel is in. */
+	struct wave_run *current;
 };
 
+/* Append the samples of a run, only the first one shows the state. */
+static void append_run(GString *output, const struct wave_run *run)
+{
+	size_t pos;
+
+	g_string_append_c(output, run->state);
+	pos = output->len;
+	g_string_set_size(output, pos + run->length - 1);
+	memset(output->str + pos, '.', run->length - 1);
+}
+
 /* Converts accumulated output data to a JSON string. */
 static GString *wavedrom_render(const struct context *ctx)
 {
 	GString *output;
+	const GArray *runs;
+	const char *sep;
+	uint64_t size;
 	size_t ch, i;
-	char last_char, curr_char;
 
-	output = g_string_new("{ \"signal\": [");
+	/* The samples of all runs, plus some for names and syntax. */
+	size = 64;
 	for (ch = 0; ch < ctx->channel_count; ch++) {
-		if (!ctx->channel_outputs[ch])
+		if (!(runs = ctx->channel_runs[ch]))
+			continue;
+		size += 32 + strlen(ctx->channels[ch]->name);
+		for (i = 0; i < runs->len; i++)
+			size += g_array_index(runs, struct wave_run, i).length;
+		size += ctx->current[ch].length;
+	}
+
+	output = g_string_sized_new(size);
+	g_string_append(output, "{ \"signal\": [");
+	sep = "";
+	for (ch = 0; ch < ctx->channel_count; ch++) {
+		if (!(runs = ctx->channel_runs[ch]))
 			continue;
 
 		/* Channel strip. */
 		g_string_append_printf(output,
-			"{ \"name\": \"%s\", \"wave\": \"", ctx->channels[ch]->name);
-
-		last_char = 0;
-		for (i = 0; i < ctx->channel_outputs[ch]->len; i++) {
-			curr_char = ctx->channel_outputs[ch]->str[i];
-			/* Data point. */
-			if (curr_char == last_char) {
-				g_string_append_c(output, '.');
-			} else {
-				g_string_append_c(output, curr_char);
-				last_char = curr_char;
-			}
-		}
-		if (ch < ctx->channel_count - 1) {
-			g_string_append(output, "\" },");
-		} else {
-			/* Last channel, no comma. */
-			g_string_append(output, "\" }");
-		}
+			"%s{ \"name\": \"%s\", \"wave\": \"", sep,
+			ctx->channels[ch]->name);
+		for (i = 0; i < runs->len; i++)
+			append_run(output, &g_array_index(runs, struct wave_run, i));
+		if (ctx->current[ch].length)
+			append_run(output, &ctx->current[ch]);
+		g_string_append(output, "\" }");
+		sep = ",";
 	}
 	g_string_append(output, "], \"config\": { \"skin\": \"narrow\" }}");
 
@@ -73,47 +97,35 @@ static void process_logic(const struct context *ctx,
 	const struct sr_datafeed_logic *logic)
 {
 	size_t sample_count, ch, i;
-	uint8_t *sample, bit;
-	GString *accu;
+	const uint8_t *sample;
+	struct wave_run *run;
+	char state;
 
 	if (!ctx->channel_count)
 		return;
 
 	/*
-	 * Extract the logic bits for each channel and store them
-	 * as wavedrom letters (1/0) in each channel's text string.
-	 * This transforms the input which consists of sample sets
-	 * that span multiple channels into output stripes per logic
-	 * channel which consist of bits for that individual channel.
-	 *
-	 * TODO Reduce memory consumption during accumulation of
-	 * output data.
-	 *
-	 * Ideally we'd accumulate binary chunks, and defer conversion
-	 * to the text format. Analog data already won't get here, only
-	 * logic data does. When the per-channel transformation also
-	 * gets deferred until later, then the only overhead would be
-	 * for disabled logic channels. Which may be acceptable or even
-	 * negligable.
-	 *
-	 * An optional addition to the above mentioned accumulation of
-	 * binary data is RLE compression. Mark both the position in the
-	 * accumulated data as well as a repetition counter, instead of
-	 * repeatedly storing the same sample set. The efficiency of
-	 * this approach of course depends on the change rate of input
-	 * data. But the approach perfectly matches the WaveDrom syntax
-	 * for repeated bit patterns, and thus is easily handled in the
-	 * text rendering stage of the output module.
+	 * Extract the logic bits for each channel, and keep the runs of
+	 * samples in which the channels don't change. This transforms the
+	 * input which consists of sample sets that span multiple channels
+	 * into output stripes per logic channel, and only takes memory
+	 * for the channels' transitions. The runs match the WaveDrom
+	 * syntax for repeated states, which the rendering expands.
 	 */
 	sample_count = logic->length / logic->unitsize;
-	for (i = 0; i < sample_count; i++) {
-		sample = logic->data + i * logic->unitsize;
-		for (ch = 0; ch < ctx->channel_count; ch++) {
-			accu = ctx->channel_outputs[ch];
-			if (!accu)
-				continue;
-			bit = sample[ch / 8] & (1 << (ch % 8));
-			g_string_append_c(accu, bit ? '1' : '0');
+	for (ch = 0; ch < ctx->channel_count; ch++) {
+		if (!ctx->channel_runs[ch])
+			continue;
+		run = &ctx->current[ch];
+		for (i = 0; i < sample_count; i++) {
+			sample = (const uint8_t *)logic->data + i * logic->unitsize;
+			state = (sample[ch / 8] & (1 << (ch % 8))) ? '1' : '0';
+			if (run->length && run->state != state) {
+				g_array_append_val(ctx->channel_runs[ch], *run);
+				run->length = 0;
+			}
+			run->state = state;
+			run->length++;
 		}
 	}
 }
@@ -159,14 +171,17 @@ static int init(struct sr_output *o, GHashTable *options)
 	ctx->channel_count = g_slist_length(o->sdi->channels);
 	ctx->channels = g_malloc0(
 		sizeof(ctx->channels[0]) * ctx->channel_count);
-	ctx->channel_outputs = g_malloc0(
-		sizeof(ctx->channel_outputs[0]) * ctx->channel_count);
+	ctx->channel_runs = g_malloc0(
+		sizeof(ctx->channel_runs[0]) * ctx->channel_count);
+	ctx->current = g_malloc0(
+		sizeof(ctx->current[0]) * ctx->channel_count);
 
 	for (i = 0, l = o->sdi->channels; l; l = l->next, i++) {
 		channel = l->data;
 		if (channel->enabled && channel->type == SR_CHANNEL_LOGIC) {
 			ctx->channels[i] = channel;
-			ctx->channel_outputs[i] = g_string_new(NULL);
+			ctx->channel_runs[i] = g_array_new(FALSE, FALSE,
+				sizeof(struct wave_run));
 		}
 	}
 
@@ -176,7 +191,7 @@ static int init(struct sr_output *o, GHashTable *options)
 static int cleanup(struct sr_output *o)
 {
 	struct context *ctx;
-	GString *s;
+	size_t i;
 
 	if (!o)
 		return SR_ERR_ARG;
@@ -185,12 +200,12 @@ static int cleanup(struct sr_output *o)
 	o->priv = NULL;
 
 	if (ctx) {
-		while (--ctx->channel_count) {
-			s = ctx->channel_outputs[ctx->channel_count];
-			if (s)
-				g_string_free(s, TRUE);
+		for (i = 0; i < ctx->channel_count; i++) {
+			if (ctx->channel_runs[i])
+				g_array_free(ctx->channel_runs[i], TRUE);
 		}
-		g_free(ctx->channel_outputs);
+		g_free(ctx->channel_runs);
+		g_free(ctx->current);
 		g_free(ctx->channels);
 		g_free(ctx);
 	}
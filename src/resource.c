@@ -270,6 +270,8 @@ SR_API int sr_resource_set_hooks(struct sr_context *ctx,
 		sr_err("%s: inconsistent callback pointers.", __func__);
 		return SR_ERR_ARG;
 	}
+	/* Resources loaded through the previous hooks may differ. */
+	sr_resource_cache_clear(ctx);
 	return SR_OK;
 }
 
@@ -410,3 +412,194 @@ SR_PRIV void *sr_resource_load(struct sr_context *ctx,
 	*size = res_size;
 	return buf;
 }
+
+/*
+ * Map a resource file from the default locations read-only. Files get
+ * replaced rather than rewritten on updates, so the mapping stays valid.
+ *
+ * Returns SR_ERR_NA when the file cannot be mapped, the caller then
+ * loads the resource through the hooks.
+ */
+static int resource_map_default(int type, const char *name,
+		size_t max_size, GBytes **bytes)
+{
+	GSList *paths, *p;
+	GMappedFile *mapped;
+	GError *error;
+	char *filename;
+	size_t size;
+
+	/* Other types have no default location, see resource_open_default(). */
+	if (type != SR_RESOURCE_FIRMWARE)
+		return SR_ERR_NA;
+
+	mapped = NULL;
+	paths = sr_resourcepaths_get(type);
+	for (p = paths; p && !mapped; p = p->next) {
+		filename = g_build_filename(p->data, name, NULL);
+		error = NULL;
+		mapped = g_mapped_file_new(filename, FALSE, &error);
+		if (mapped) {
+			sr_info("Mapped '%s'.", filename);
+		} else {
+			sr_spew("Attempt to map '%s' failed: %s",
+				filename, error->message);
+			g_error_free(error);
+		}
+		g_free(filename);
+	}
+	g_slist_free_full(paths, g_free);
+	if (!mapped)
+		return SR_ERR_NA;
+
+	size = g_mapped_file_get_length(mapped);
+	if (size > max_size) {
+		sr_err("Size %zu of '%s' exceeds limit %zu.",
+			size, name, max_size);
+		g_mapped_file_unref(mapped);
+		return SR_ERR;
+	}
+	*bytes = g_mapped_file_get_bytes(mapped);
+	g_mapped_file_unref(mapped);
+
+	return SR_OK;
+}
+
+/**
+ * Load a resource into memory, and keep it for later loads.
+ *
+ * Firmware images get uploaded to devices each time they show up
+ * without firmware. The context keeps the loaded images, so that
+ * consecutive uploads don't go through the resource hooks again.
+ * Devices of the same type share one copy of an image. With the
+ * default hooks, the image is a read-only mapping of the file.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param type Resource type ID.
+ * @param name Name of the resource. Must not be NULL.
+ * @param max_size Size limit. Error out if the resource is larger than this.
+ *
+ * @return The resource data, or NULL on failure. Must be released by
+ *         the caller using g_bytes_unref().
+ *
+ * @private
+ */
+SR_PRIV GBytes *sr_resource_load_cached(struct sr_context *ctx,
+		int type, const char *name, size_t max_size)
+{
+	GBytes *bytes;
+	char *key;
+	void *buf;
+	size_t size;
+	int ret;
+
+	if (!ctx->resource_cache)
+		ctx->resource_cache = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free, (GDestroyNotify)g_bytes_unref);
+
+	key = g_strdup_printf("%d/%s", type, name);
+	bytes = g_hash_table_lookup(ctx->resource_cache, key);
+	if (bytes && g_bytes_get_size(bytes) <= max_size) {
+		g_free(key);
+		return g_bytes_ref(bytes);
+	}
+
+	ret = SR_ERR_NA;
+	if (ctx->resource_open_cb == &resource_open_default)
+		ret = resource_map_default(type, name, max_size, &bytes);
+	if (ret == SR_ERR_NA) {
+		buf = sr_resource_load(ctx, type, name, &size, max_size);
+		bytes = buf ? g_bytes_new_take(buf, size) : NULL;
+	} else if (ret != SR_OK) {
+		bytes = NULL;
+	}
+	if (!bytes) {
+		g_free(key);
+		return NULL;
+	}
+	g_hash_table_replace(ctx->resource_cache, key, g_bytes_ref(bytes));
+
+	return bytes;
+}
+
+/**
+ * Load a resource ahead of its use.
+ *
+ * The resource stays loaded until the context gets released, or the
+ * resource hooks change. When drivers open devices which need it, the
+ * drivers then don't have to wait for it being loaded.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ * @param type Resource type ID.
+ * @param name Name of the resource. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR The resource could not be loaded.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_resource_preload(struct sr_context *ctx, int type,
+		const char *name)
+{
+	GBytes *bytes;
+
+	if (!ctx || !name)
+		return SR_ERR_ARG;
+
+	bytes = sr_resource_load_cached(ctx, type, name, G_MAXSIZE);
+	if (!bytes)
+		return SR_ERR;
+	g_bytes_unref(bytes);
+
+	return SR_OK;
+}
+
+/**
+ * Preload the firmware files which the environment asks for.
+ *
+ * SIGROK_FIRMWARE_PRELOAD holds a comma separated list of file names.
+ * Files which fail to load only get a warning, drivers which need them
+ * report the error.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_resource_preload_env(struct sr_context *ctx)
+{
+	const char *env;
+	gchar **names;
+	size_t i;
+
+	env = g_getenv("SIGROK_FIRMWARE_PRELOAD");
+	if (!env)
+		return;
+
+	names = g_strsplit(env, ",", 0);
+	for (i = 0; names[i]; i++) {
+		g_strstrip(names[i]);
+		if (!*names[i])
+			continue;
+		if (sr_resource_preload(ctx, SR_RESOURCE_FIRMWARE,
+				names[i]) != SR_OK)
+			sr_warn("Failed to preload '%s'.", names[i]);
+	}
+	g_strfreev(names);
+}
+
+/**
+ * Drop the resources which sr_resource_load_cached() keeps.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_resource_cache_clear(struct sr_context *ctx)
+{
+	if (!ctx->resource_cache)
+		return;
+
+	g_hash_table_destroy(ctx->resource_cache);
+	ctx->resource_cache = NULL;
+}
@@ -73,11 +73,38 @@ enum scpi_transport_layer {
 	SCPI_TRANSPORT_USBTMC,
 	SCPI_TRANSPORT_VISA,
 	SCPI_TRANSPORT_VXI,
+	SCPI_TRANSPORT_HISLIP,
+};
+
+/** Flags of SCPI command table entries. */
+enum {
+	/** The query has no side effects, its responses can be cached. */
+	SCPI_CMD_CACHED = 1 << 0,
 };
 
 struct scpi_command {
 	int command;
 	const char *string;
+	int flags;
+};
+
+/** Item types of binary arrays, see sr_scpi_get_floatv_binary(). */
+enum scpi_binary_type {
+	SCPI_BINARY_INT8,
+	SCPI_BINARY_UINT8,
+	SCPI_BINARY_INT16,
+	SCPI_BINARY_UINT16,
+	SCPI_BINARY_INT32,
+	SCPI_BINARY_REAL32,
+	SCPI_BINARY_REAL64,
+};
+
+/** A binary array format which an instrument supports. */
+struct scpi_binary_format {
+	/** Selects the format, e.g. ":FORM REAL,32;:FORM:BORD NORM". */
+	const char *command;
+	enum scpi_binary_type type;
+	gboolean big_endian;
 };
 
 struct sr_scpi_hw_info {
@@ -87,6 +114,10 @@ struct sr_scpi_hw_info {
 	char *firmware_version;
 };
 
+/** Receives the data of a SCPI block as it arrives, see sr_scpi_read_block(). */
+typedef int (*sr_scpi_block_callback)(const uint8_t *data, size_t len,
+		void *cb_data);
+
 struct sr_scpi_dev_inst {
 	const char *name;
 	const char *prefix;
@@ -105,6 +136,8 @@ struct sr_scpi_dev_inst {
 	int (*read_data)(void *priv, char *buf, int maxlen);
 	int (*write_data)(void *priv, char *buf, int len);
 	int (*read_complete)(void *priv);
+	/* Wait for receive data, > 0 if available, 0 if time ran out. */
+	int (*wait_data)(void *priv, int timeout_ms);
 	int (*close)(struct sr_scpi_dev_inst *scpi);
 	void (*free)(void *priv);
 	unsigned int read_timeout_us;
@@ -114,8 +147,19 @@ struct sr_scpi_dev_inst {
 	GMutex scpi_mutex;
 	char *actual_channel_name;
 	gboolean no_opc_command;
+	/* Set when the device rejected a compound query, see sr_scpi_batch_run(). */
+	gboolean no_compound_queries;
+	/* Responses to cached queries, NULL unless enabled. */
+	GHashTable *response_cache;
+	/* The format which sr_scpi_get_floatv_binary() selected last. */
+	const struct scpi_binary_format *binary_format;
+	/* Monotonic time of the last read which returned data, in us. */
+	int64_t read_us;
 };
 
+/* Queries which get sent as compound messages, see sr_scpi_batch_new(). */
+struct sr_scpi_batch;
+
 SR_PRIV GSList *sr_scpi_scan(struct drv_context *drvc, GSList *options,
 		struct sr_dev_inst *(*probe_device)(struct sr_scpi_dev_inst *scpi));
 SR_PRIV struct sr_scpi_dev_inst *scpi_dev_inst_new(struct drv_context *drvc,
@@ -158,8 +202,30 @@ SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 			const char *command, GArray **scpi_response);
 SR_PRIV int sr_scpi_get_data(struct sr_scpi_dev_inst *scpi,
 			const char *command, GString **scpi_response);
+SR_PRIV int sr_scpi_read_block(struct sr_scpi_dev_inst *scpi,
+		const char *command, uint8_t **buf, size_t *size,
+		sr_scpi_block_callback cb, void *cb_data);
+SR_PRIV int sr_scpi_read_block_reuse(struct sr_scpi_dev_inst *scpi,
+		const char *command, uint8_t **buf, size_t *capacity,
+		size_t *size);
 SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 			const char *command, GByteArray **scpi_response);
+SR_PRIV int sr_scpi_get_floatv_binary(struct sr_scpi_dev_inst *scpi,
+		const struct scpi_binary_format *format, const char *command,
+		GArray **scpi_response);
+SR_PRIV struct sr_scpi_batch *sr_scpi_batch_new(struct sr_scpi_dev_inst *scpi);
+SR_PRIV void sr_scpi_batch_free(struct sr_scpi_batch *batch);
+SR_PRIV int sr_scpi_batch_add(struct sr_scpi_batch *batch,
+		const char *format, ...) G_GNUC_PRINTF(2, 3);
+SR_PRIV int sr_scpi_batch_send(struct sr_scpi_batch *batch);
+SR_PRIV int sr_scpi_batch_receive(struct sr_scpi_batch *batch);
+SR_PRIV int sr_scpi_batch_run(struct sr_scpi_batch *batch);
+SR_PRIV const char *sr_scpi_batch_get_string(struct sr_scpi_batch *batch,
+		int idx);
+SR_PRIV int sr_scpi_batch_get_bool(struct sr_scpi_batch *batch,
+		int idx, gboolean *value);
+SR_PRIV int sr_scpi_batch_get_float(struct sr_scpi_batch *batch,
+		int idx, float *value);
 SR_PRIV int sr_scpi_get_hw_id(struct sr_scpi_dev_inst *scpi,
 			struct sr_scpi_hw_info **scpi_response);
 SR_PRIV void sr_scpi_hw_info_free(struct sr_scpi_hw_info *hw_info);
@@ -167,6 +233,8 @@ SR_PRIV void sr_scpi_hw_info_free(struct sr_scpi_hw_info *hw_info);
 SR_PRIV const char *sr_scpi_unquote_string(char *s);
 
 SR_PRIV const char *sr_vendor_alias(const char *raw_vendor);
+SR_PRIV void sr_scpi_cache_enable(struct sr_scpi_dev_inst *scpi);
+SR_PRIV void sr_scpi_cache_flush(struct sr_scpi_dev_inst *scpi);
 SR_PRIV const char *sr_scpi_cmd_get(const struct scpi_command *cmdtable,
 		int command);
 SR_PRIV int sr_scpi_cmd(const struct sr_dev_inst *sdi,
@@ -19,6 +19,7 @@
  */
 
 #include <config.h>
+#include <errno.h>
 #include <glib.h>
 #include <string.h>
 #include <libsigrok/libsigrok.h>
@@ -29,6 +30,8 @@
 
 #define SCPI_READ_RETRIES 100
 #define SCPI_READ_RETRY_TIMEOUT_US (10 * 1000)
+/* Most characters which get skipped in front of a block's length spec. */
+#define SCPI_BLOCK_PREFIX_MAX 32
 
 static const char *scpi_vendors[][2] = {
 	{ "Agilent Technologies", "Agilent" },
@@ -80,6 +83,7 @@ static int parse_strict_bool(const char *str, gboolean *ret)
 SR_PRIV extern const struct sr_scpi_dev_inst scpi_serial_dev;
 SR_PRIV extern const struct sr_scpi_dev_inst scpi_tcp_raw_dev;
 SR_PRIV extern const struct sr_scpi_dev_inst scpi_tcp_rigol_dev;
+SR_PRIV extern const struct sr_scpi_dev_inst scpi_hislip_dev;
 SR_PRIV extern const struct sr_scpi_dev_inst scpi_usbtmc_libusb_dev;
 SR_PRIV extern const struct sr_scpi_dev_inst scpi_vxi_dev;
 SR_PRIV extern const struct sr_scpi_dev_inst scpi_visa_dev;
@@ -88,6 +92,7 @@ SR_PRIV extern const struct sr_scpi_dev_inst scpi_libgpib_dev;
 static const struct sr_scpi_dev_inst *scpi_devs[] = {
 	&scpi_tcp_raw_dev,
 	&scpi_tcp_rigol_dev,
+	&scpi_hislip_dev,
 #ifdef HAVE_LIBUSB_1_0
 	&scpi_usbtmc_libusb_dev,
 #endif
@@ -161,6 +166,7 @@ static int scpi_send_variadic(struct sr_scpi_dev_inst *scpi,
 		buf[len] = '\n';
 
 	/* Send command. */
+	sr_trace3(scpi_write, scpi, buf, len);
 	ret = scpi->send(scpi->priv, buf);
 
 	/* Free command buffer. */
@@ -203,6 +209,8 @@ static int scpi_send(struct sr_scpi_dev_inst *scpi, const char *format, ...)
  */
 static int scpi_write_data(struct sr_scpi_dev_inst *scpi, char *buf, int maxlen)
 {
+	sr_trace3(scpi_write, scpi, buf, maxlen);
+
 	return scpi->write_data(scpi->priv, buf, maxlen);
 }
 
@@ -217,7 +225,32 @@ static int scpi_write_data(struct sr_scpi_dev_inst *scpi, char *buf, int maxlen)
  */
 static int scpi_read_data(struct sr_scpi_dev_inst *scpi, char *buf, int maxlen)
 {
-	return scpi->read_data(scpi->priv, buf, maxlen);
+	int len;
+
+	len = scpi->read_data(scpi->priv, buf, maxlen);
+	sr_trace3(scpi_read, scpi, buf, len);
+	if (len > 0)
+		scpi->read_us = g_get_monotonic_time();
+
+	return len;
+}
+
+/*
+ * Wait for receive data until the absolute timeout, without mutex.
+ * Transports which cannot wait return 1, their reads get polled.
+ */
+static int scpi_wait_data(struct sr_scpi_dev_inst *scpi, gint64 abs_timeout_us)
+{
+	gint64 remain_us;
+
+	if (!scpi->wait_data)
+		return 1;
+
+	remain_us = abs_timeout_us - g_get_monotonic_time();
+	if (remain_us <= 0)
+		return 0;
+
+	return scpi->wait_data(scpi->priv, (remain_us + 999) / 1000);
 }
 
 /**
@@ -235,8 +268,19 @@ static int scpi_read_response(struct sr_scpi_dev_inst *scpi,
 {
 	int len, space;
 
+	len = scpi_wait_data(scpi, abs_timeout_us);
+	if (len < 0) {
+		sr_err("Failed to wait for SCPI response.");
+		return SR_ERR;
+	}
+	if (len == 0) {
+		sr_err("Timed out waiting for SCPI response.");
+		return SR_ERR_TIMEOUT;
+	}
+
 	space = response->allocated_len - response->len;
 	len = scpi->read_data(scpi->priv, &response->str[response->len], space);
+	sr_trace3(scpi_read, scpi, &response->str[response->len], len);
 
 	if (len < 0) {
 		sr_err("Incompletely read SCPI response.");
@@ -310,44 +354,64 @@ static int scpi_get_data(struct sr_scpi_dev_inst *scpi,
 	return SR_OK;
 }
 
+struct scpi_scan_args {
+	struct drv_context *drvc;
+	const char *serialcomm;
+	struct sr_dev_inst *(*probe_device)(struct sr_scpi_dev_inst *scpi);
+};
+
+/* Probe one of the resources which the transports found. */
+static void *scpi_scan_probe(const char *port, void *cb_data)
+{
+	struct scpi_scan_args *args;
+	struct sr_dev_inst *sdi;
+	const char *comm;
+	gchar **res;
+
+	args = cb_data;
+	res = g_strsplit(port, ":", 2);
+	if (!res[0]) {
+		g_strfreev(res);
+		return NULL;
+	}
+	comm = args->serialcomm ? : res[1];
+	sdi = sr_scpi_scan_resource(args->drvc, res[0], comm,
+		args->probe_device);
+	if (sdi)
+		sdi->connection_id = g_strdup(port);
+	g_strfreev(res);
+
+	return sdi;
+}
+
 SR_PRIV GSList *sr_scpi_scan(struct drv_context *drvc, GSList *options,
 		struct sr_dev_inst *(*probe_device)(struct sr_scpi_dev_inst *scpi))
 {
-	GSList *resources, *l, *devices;
+	GSList *resources, *devices;
 	struct sr_dev_inst *sdi;
-	const char *resource, *conn;
-	const char *serialcomm, *comm;
-	gchar **res;
+	struct scpi_scan_args args;
+	const char *resource;
+	const char *serialcomm;
 	unsigned i;
 
 	resource = NULL;
 	serialcomm = NULL;
 	(void)sr_serial_extract_options(options, &resource, &serialcomm);
 
-	devices = NULL;
+	/* Probe the resources of all the transports at the same time. */
+	resources = NULL;
 	for (i = 0; i < ARRAY_SIZE(scpi_devs); i++) {
 		if (resource && strcmp(resource, scpi_devs[i]->prefix) != 0)
 			continue;
 		if (!scpi_devs[i]->scan)
 			continue;
-		resources = scpi_devs[i]->scan(drvc);
-		for (l = resources; l; l = l->next) {
-			res = g_strsplit(l->data, ":", 2);
-			if (!res[0]) {
-				g_strfreev(res);
-				continue;
-			}
-			conn = res[0];
-			comm = serialcomm ? : res[1];
-			sdi = sr_scpi_scan_resource(drvc, conn, comm, probe_device);
-			if (sdi) {
-				devices = g_slist_append(devices, sdi);
-				sdi->connection_id = g_strdup(l->data);
-			}
-			g_strfreev(res);
-		}
-		g_slist_free_full(resources, g_free);
+		resources = g_slist_concat(resources, scpi_devs[i]->scan(drvc));
 	}
+	args.drvc = drvc;
+	args.serialcomm = serialcomm;
+	args.probe_device = probe_device;
+	devices = std_probe_ports(resources, scpi_scan_probe, &args);
+	g_slist_free_full(resources, g_free);
 
 	if (!devices && resource) {
 		sdi = sr_scpi_scan_resource(drvc, resource, serialcomm, probe_device);
@@ -605,6 +669,8 @@ SR_PRIV void sr_scpi_free(struct sr_scpi_dev_inst *scpi)
 	scpi->free(scpi->priv);
 	g_free(scpi->priv);
 	g_free(scpi->actual_channel_name);
+	if (scpi->response_cache)
+		g_hash_table_destroy(scpi->response_cache);
 	g_free(scpi);
 }
 
@@ -841,6 +907,36 @@ SR_PRIV int sr_scpi_get_opc(struct sr_scpi_dev_inst *scpi)
 	return SR_ERR;
 }
 
+/* The number of items in a comma separated list. */
+static size_t scpi_list_length(const char *s)
+{
+	size_t count;
+
+	if (!*s)
+		return 0;
+	for (count = 1; *s; s++)
+		if (*s == ',')
+			count++;
+
+	return count;
+}
+
+/*
+ * Advance past the separator after a list item. Returns FALSE when
+ * something else than whitespace follows the item.
+ */
+static gboolean scpi_list_next(char **p)
+{
+	while (g_ascii_isspace(**p))
+		(*p)++;
+	if (**p == ',') {
+		(*p)++;
+		return TRUE;
+	}
+
+	return **p == '\0';
+}
+
 /**
  * Send a SCPI command, read the reply, parse it as comma separated list of
  * floats and store the as an result in scpi_response.
@@ -860,9 +956,7 @@ SR_PRIV int sr_scpi_get_floatv(struct sr_scpi_dev_inst *scpi,
 {
 	int ret;
 	float tmp;
-	char *response;
-	gchar **ptr, **tokens;
-	size_t token_count;
+	char *response, *p, *end;
 	GArray *response_array;
 
 	*scpi_response = NULL;
@@ -872,23 +966,21 @@ SR_PRIV int sr_scpi_get_floatv(struct sr_scpi_dev_inst *scpi,
 	if (ret != SR_OK && !response)
 		return ret;
 
-	tokens = g_strsplit(response, ",", 0);
-	token_count = g_strv_length(tokens);
-
 	response_array = g_array_sized_new(TRUE, FALSE,
-		sizeof(float), token_count + 1);
-
-	ptr = tokens;
-	while (*ptr) {
-		ret = sr_atof_ascii(*ptr, &tmp);
-		if (ret != SR_OK) {
+		sizeof(float), scpi_list_length(response) + 1);
+
+	/* Convert the items in place, long lists don't get split. */
+	p = response;
+	while (*p) {
+		errno = 0;
+		tmp = g_ascii_strtod(p, &end);
+		if (end == p || errno || !scpi_list_next(&end)) {
 			ret = SR_ERR_DATA;
 			break;
 		}
 		response_array = g_array_append_val(response_array, tmp);
-		ptr++;
+		p = end;
 	}
-	g_strfreev(tokens);
 	g_free(response);
 
 	if (ret != SR_OK && response_array->len == 0) {
@@ -918,10 +1010,10 @@ SR_PRIV int sr_scpi_get_floatv(struct sr_scpi_dev_inst *scpi,
 SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 			       const char *command, GArray **scpi_response)
 {
-	int tmp, ret;
-	char *response;
-	gchar **ptr, **tokens;
-	size_t token_count;
+	int ret;
+	gint64 value;
+	uint8_t tmp;
+	char *response, *p, *end;
 	GArray *response_array;
 
 	*scpi_response = NULL;
@@ -931,23 +1023,21 @@ SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 	if (ret != SR_OK && !response)
 		return ret;
 
-	tokens = g_strsplit(response, ",", 0);
-	token_count = g_strv_length(tokens);
-
 	response_array = g_array_sized_new(TRUE, FALSE,
-		sizeof(uint8_t), token_count + 1);
+		sizeof(uint8_t), scpi_list_length(response) + 1);
 
-	ptr = tokens;
-	while (*ptr) {
-		ret = sr_atoi(*ptr, &tmp);
-		if (ret != SR_OK) {
+	p = response;
+	while (*p) {
+		errno = 0;
+		value = g_ascii_strtoll(p, &end, 10);
+		if (end == p || errno || !scpi_list_next(&end)) {
 			ret = SR_ERR_DATA;
 			break;
 		}
+		tmp = value;
 		response_array = g_array_append_val(response_array, tmp);
-		ptr++;
+		p = end;
 	}
-	g_strfreev(tokens);
 	g_free(response);
 
 	if (response_array->len == 0) {
@@ -960,32 +1050,77 @@ SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 	return ret;
 }
 
-/**
- * Send a SCPI command, read the reply, parse it as binary data with a
- * "definite length block" header and store the as an result in scpi_response.
- *
- * Callers must free the allocated memory (unless it's NULL) regardless of
- * the routine's return code. See @ref g_byte_array_free().
- *
- * @param[in] scpi Previously initialised SCPI device structure.
- * @param[in] command The SCPI command to send to the device (can be NULL).
- * @param[out] scpi_response Pointer where to store the parsed result.
- *
- * @return SR_OK upon successfully parsing all values, SR_ERR* upon a parsing
- *         error or upon no response.
+/*
+ * Consume the response message terminator after the data of a block, so
+ * that it does not get taken for the response to the next query.
  */
-SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
-			       const char *command, GByteArray **scpi_response)
+static void scpi_read_terminator(struct sr_scpi_dev_inst *scpi,
+		gint64 timeout)
+{
+	char buf[8];
+	int len;
+
+	while (!scpi->read_complete(scpi->priv)) {
+		len = scpi_wait_data(scpi, timeout);
+		if (len > 0)
+			len = scpi_read_data(scpi, buf, sizeof(buf));
+		if (len < 0)
+			return;
+		if (len > 0 && memchr(buf, '\n', len))
+			return;
+		if (len == 0 && g_get_monotonic_time() > timeout)
+			return;
+	}
+}
+
+/*
+ * Read exactly the requested number of bytes, for the block header.
+ * Reads no further than that, the payload goes elsewhere.
+ */
+static int scpi_read_exact(struct sr_scpi_dev_inst *scpi,
+		char *buf, int len, gint64 *timeout)
 {
 	int ret;
-	GString* response;
-	gsize oldlen;
-	char buf[10];
-	long llen;
-	long datalen;
-	gint64 timeout;
 
-	*scpi_response = NULL;
+	while (len > 0) {
+		ret = scpi_wait_data(scpi, *timeout);
+		if (ret == 0) {
+			sr_err("Timed out waiting for SCPI response.");
+			return SR_ERR_TIMEOUT;
+		}
+		if (ret > 0)
+			ret = scpi_read_data(scpi, buf, len);
+		if (ret < 0) {
+			sr_err("Incompletely read SCPI response.");
+			return SR_ERR;
+		}
+		if (ret > 0) {
+			buf += ret;
+			len -= ret;
+			*timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+		} else if (g_get_monotonic_time() > *timeout) {
+			sr_err("Timed out waiting for SCPI response.");
+			return SR_ERR_TIMEOUT;
+		}
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Read a block, see sr_scpi_read_block(). With a capacity, the buffer
+ * gets replaced by a larger one when the block does not fit.
+ */
+static int scpi_read_block(struct sr_scpi_dev_inst *scpi,
+		const char *command, uint8_t **buf, size_t *capacity,
+		size_t *size, sr_scpi_block_callback cb, void *cb_data)
+{
+	char header[10];
+	long llen, datalen;
+	uint8_t *data;
+	size_t got;
+	gint64 timeout;
+	int ret, len, skipped;
 
 	g_mutex_lock(&scpi->scpi_mutex);
 
@@ -1000,103 +1135,621 @@ SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 		return SR_ERR;
 	}
 
-	/*
-	 * Assume an initial maximum length, optionally gets adjusted below.
-	 * Prepare a NULL return value for when error paths will be taken.
-	 */
-	response = g_string_sized_new(1024);
-
-	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
-
-	/* Get (the first chunk of) the response. */
-	do {
-		ret = scpi_read_response(scpi, response, timeout);
-		if (ret < 0) {
-			g_mutex_unlock(&scpi->scpi_mutex);
-			g_string_free(response, TRUE);
-			return ret;
-		}
-	} while (response->len < 2);
-
 	/*
 	 * SCPI protocol data blocks are preceeded with a length spec.
 	 * The length spec consists of a '#' marker, one digit which
 	 * specifies the character count of the length spec, and the
 	 * respective number of characters which specify the data block's
-	 * length. Raw data bytes follow (thus one must no longer assume
-	 * that the received input stream would be an ASCIIZ string).
-	 *
-	 * Get the data block length, and strip off the length spec from
-	 * the input buffer, leaving just the data bytes.
+	 * length. Raw data bytes follow.
 	 */
-	if (response->str[0] != '#') {
+	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+	ret = scpi_read_exact(scpi, header, 1, &timeout);
+	for (skipped = 0; ret == SR_OK && header[0] != '#'; skipped++) {
+		if (header[0] == '\n' || skipped == SCPI_BLOCK_PREFIX_MAX) {
+			ret = SR_ERR_DATA;
+			break;
+		}
+		ret = scpi_read_exact(scpi, header, 1, &timeout);
+	}
+	if (ret == SR_OK)
+		ret = scpi_read_exact(scpi, &header[1], 1, &timeout);
+	if (ret != SR_OK) {
+		g_mutex_unlock(&scpi->scpi_mutex);
+		return ret;
+	}
+	header[0] = header[1];
+	header[1] = '\0';
+	ret = sr_atol(header, &llen);
+	if (ret != SR_OK || llen == 0) {
+		g_mutex_unlock(&scpi->scpi_mutex);
+		*size = 0;
+		return ret;
+	}
+
+	ret = scpi_read_exact(scpi, header, llen, &timeout);
+	if (ret != SR_OK) {
+		g_mutex_unlock(&scpi->scpi_mutex);
+		return ret;
+	}
+	header[llen] = '\0';
+	ret = sr_atol(header, &datalen);
+	if (ret != SR_OK || datalen <= 0) {
+		g_mutex_unlock(&scpi->scpi_mutex);
+		*size = 0;
+		return ret;
+	}
+
+	if (capacity && (size_t)datalen > *capacity) {
+		g_free(*buf);
+		*buf = g_try_malloc(datalen);
+		*capacity = *buf ? (size_t)datalen : 0;
+	} else if (!capacity && *buf && (size_t)datalen > *size) {
+		sr_err("SCPI block of %ld bytes exceeds the buffer.", datalen);
 		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
 		return SR_ERR_DATA;
 	}
-	buf[0] = response->str[1];
-	buf[1] = '\0';
-	ret = sr_atol(buf, &llen);
-	if ((ret != SR_OK) || (llen == 0)) {
+	data = (*buf || capacity) ? *buf : g_try_malloc(datalen);
+	if (!data) {
 		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
+		return SR_ERR_MALLOC;
+	}
+
+	got = 0;
+	ret = SR_OK;
+	while (got < (size_t)datalen) {
+		len = scpi_wait_data(scpi, timeout);
+		if (len > 0)
+			len = scpi_read_data(scpi, (char *)&data[got],
+				MIN((size_t)datalen - got, G_MAXINT));
+		if (len < 0) {
+			sr_err("Incompletely read SCPI response.");
+			ret = SR_ERR;
+			break;
+		}
+		if (len > 0) {
+			if (cb && (ret = cb(&data[got], len, cb_data)) != SR_OK)
+				break;
+			got += len;
+			timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+		} else if (g_get_monotonic_time() > timeout) {
+			/*
+			 * Keep the partial response instead of getting
+			 * stuck on timeouts.
+			 */
+			sr_err("Timed out waiting for SCPI response.");
+			break;
+		}
+	}
+	if (ret == SR_OK && got == (size_t)datalen)
+		scpi_read_terminator(scpi, timeout);
+
+	g_mutex_unlock(&scpi->scpi_mutex);
+
+	if (ret != SR_OK) {
+		if (!*buf && !capacity)
+			g_free(data);
 		return ret;
 	}
+	*buf = data;
+	*size = got;
 
-	while (response->len < (unsigned long)(2 + llen)) {
-		ret = scpi_read_response(scpi, response, timeout);
-		if (ret < 0) {
-			g_mutex_unlock(&scpi->scpi_mutex);
-			g_string_free(response, TRUE);
+	return SR_OK;
+}
+
+/**
+ * Send a SCPI command, and read a "definite length block" reply into
+ * a buffer of the announced size.
+ *
+ * The length spec gets parsed first. The data bytes then get read in
+ * place, with reads as large as the remaining data, without growing
+ * and copying the buffer.
+ *
+ * When the callback is not NULL, it gets called with each range of data
+ * as it arrives, so that callers can convert data before the block is
+ * complete. The SCPI mutex is held during the calls, the callback must
+ * not use the SCPI device. A return value other than SR_OK aborts the
+ * read.
+ *
+ * Text in front of the length spec, like the header of the query which
+ * some instruments repeat ("DAT2,#9..."), gets skipped.
+ *
+ * On timeouts while the data gets read, the data received so far is
+ * kept, as with sr_scpi_get_block().
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[in,out] buf The buffer for the data bytes. When NULL, a buffer
+ *                of the announced size gets allocated, which the caller
+ *                must g_free() then.
+ * @param[in,out] size In: The size of the buffer, when supplied by the
+ *                caller. Out: The number of data bytes which got read,
+ *                0 for empty and indefinite length blocks.
+ * @param[in] cb Callback for the data as it arrives (can be NULL).
+ * @param[in] cb_data Opaque data for the callback.
+ *
+ * @return SR_OK upon success, SR_ERR_DATA if the reply is not a block
+ *         or does not fit the supplied buffer, SR_ERR* upon other errors.
+ */
+SR_PRIV int sr_scpi_read_block(struct sr_scpi_dev_inst *scpi,
+		const char *command, uint8_t **buf, size_t *size,
+		sr_scpi_block_callback cb, void *cb_data)
+{
+	return scpi_read_block(scpi, command, buf, NULL, size, cb, cb_data);
+}
+
+/**
+ * Send a SCPI command, and read a "definite length block" reply into
+ * a buffer which gets reused across calls.
+ *
+ * This is sr_scpi_read_block() for repeated reads of blocks which can
+ * change in size, like waveforms of varying record lengths. The buffer
+ * only gets replaced when a block does not fit, its previous content is
+ * lost then.
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[in,out] buf The buffer for the data bytes, can point to NULL.
+ *                The caller must g_free() it when done.
+ * @param[in,out] capacity The allocated size of the buffer.
+ * @param[out] size The number of data bytes which got read.
+ *
+ * @return SR_OK upon success, SR_ERR* upon failure.
+ */
+SR_PRIV int sr_scpi_read_block_reuse(struct sr_scpi_dev_inst *scpi,
+		const char *command, uint8_t **buf, size_t *capacity,
+		size_t *size)
+{
+	return scpi_read_block(scpi, command, buf, capacity, size, NULL, NULL);
+}
+
+/**
+ * Send a SCPI command, read the reply, parse it as binary data with a
+ * "definite length block" header and store the as an result in scpi_response.
+ *
+ * Callers must free the allocated memory (unless it's NULL) regardless of
+ * the routine's return code. See @ref g_byte_array_free().
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[out] scpi_response Pointer where to store the parsed result.
+ *
+ * @return SR_OK upon successfully parsing all values, SR_ERR* upon a parsing
+ *         error or upon no response.
+ */
+SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
+			       const char *command, GByteArray **scpi_response)
+{
+	uint8_t *data;
+	size_t size;
+	int ret;
+
+	*scpi_response = NULL;
+
+	data = NULL;
+	ret = sr_scpi_read_block(scpi, command, &data, &size, NULL, NULL);
+	if (ret != SR_OK || !data)
+		return ret;
+
+	*scpi_response = g_byte_array_new_take(data, size);
+
+	return SR_OK;
+}
+
+/* Sizes of the binary array items, by enum scpi_binary_type. */
+static const size_t scpi_binary_sizes[] = {
+	[SCPI_BINARY_INT8] = 1,
+	[SCPI_BINARY_UINT8] = 1,
+	[SCPI_BINARY_INT16] = 2,
+	[SCPI_BINARY_UINT16] = 2,
+	[SCPI_BINARY_INT32] = 4,
+	[SCPI_BINARY_REAL32] = 4,
+	[SCPI_BINARY_REAL64] = 8,
+};
+
+/* Convert binary array items to floats, one loop per item type. */
+static void scpi_binary_to_float(const struct scpi_binary_format *format,
+		const uint8_t *p, size_t count, float *out)
+{
+	gboolean be;
+	size_t i;
+
+	be = format->big_endian;
+	switch (format->type) {
+	case SCPI_BINARY_INT8:
+		for (i = 0; i < count; i++)
+			out[i] = (int8_t)p[i];
+		break;
+	case SCPI_BINARY_UINT8:
+		for (i = 0; i < count; i++)
+			out[i] = p[i];
+		break;
+	case SCPI_BINARY_INT16:
+		for (i = 0; i < count; i++, p += 2)
+			out[i] = be ? RB16S(p) : RL16S(p);
+		break;
+	case SCPI_BINARY_UINT16:
+		for (i = 0; i < count; i++, p += 2)
+			out[i] = be ? RB16(p) : RL16(p);
+		break;
+	case SCPI_BINARY_INT32:
+		for (i = 0; i < count; i++, p += 4)
+			out[i] = be ? RB32S(p) : RL32S(p);
+		break;
+	case SCPI_BINARY_REAL32:
+		for (i = 0; i < count; i++, p += 4)
+			out[i] = be ? RBFL(p) : RLFL(p);
+		break;
+	case SCPI_BINARY_REAL64:
+		for (i = 0; i < count; i++, p += 8)
+			out[i] = be ? read_dblbe(p) : read_dblle(p);
+		break;
+	}
+}
+
+/**
+ * Send a SCPI command, read a binary array reply, and convert its items
+ * to floats.
+ *
+ * Instruments which support binary transfers get the array as a definite
+ * length block of the given format, which saves the formatting and the
+ * parsing of text, and much of the transfer size. The format's command
+ * gets sent before the first query, and again when another format was
+ * selected in between. Drivers which change the format by other means
+ * must reset the scpi->binary_format field. Without a format, the reply
+ * is parsed as comma separated list, see sr_scpi_get_floatv().
+ *
+ * Callers must free the allocated memory (unless it's NULL) regardless of
+ * the routine's return code. See @ref g_array_free().
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ * @param[in] format The binary format of the reply (can be NULL).
+ * @param[in] command The SCPI command to send to the device (can be NULL).
+ * @param[out] scpi_response Pointer where to store the converted result.
+ *
+ * @return SR_OK upon success, SR_ERR_DATA upon an invalid reply,
+ *         SR_ERR* upon other errors.
+ */
+SR_PRIV int sr_scpi_get_floatv_binary(struct sr_scpi_dev_inst *scpi,
+		const struct scpi_binary_format *format, const char *command,
+		GArray **scpi_response)
+{
+	uint8_t *data;
+	size_t size, item_size, count;
+	GArray *response_array;
+	int ret;
+
+	*scpi_response = NULL;
+
+	if (!format)
+		return sr_scpi_get_floatv(scpi, command, scpi_response);
+
+	if (format->command && scpi->binary_format != format) {
+		ret = sr_scpi_send(scpi, "%s", format->command);
+		if (ret != SR_OK)
 			return ret;
+		scpi->binary_format = format;
+	}
+
+	data = NULL;
+	size = 0;
+	ret = sr_scpi_read_block(scpi, command, &data, &size, NULL, NULL);
+	if (ret != SR_OK && !data)
+		return ret;
+
+	item_size = scpi_binary_sizes[format->type];
+	if (size % item_size)
+		sr_warn("Binary array of %zu bytes has a partial item.", size);
+	count = size / item_size;
+
+	response_array = g_array_sized_new(TRUE, FALSE, sizeof(float), count);
+	g_array_set_size(response_array, count);
+	scpi_binary_to_float(format, data, count,
+		&g_array_index(response_array, float, 0));
+	g_free(data);
+
+	*scpi_response = response_array;
+
+	return ret;
+}
+
+/** @cond PRIVATE */
+/* Most queries which get combined into one program message. */
+#define SCPI_BATCH_MAX_QUERIES 16
+/** @endcond */
+
+struct sr_scpi_batch {
+	struct sr_scpi_dev_inst *scpi;
+	GPtrArray *queries;
+	GPtrArray *responses;
+	/* Number of queries in the message which awaits its response. */
+	guint in_flight;
+};
+
+/**
+ * Create a batch of SCPI queries.
+ *
+ * The queries of a batch get sent as compound program messages, up to
+ * 16 queries separated by ';' in one message, and their responses get
+ * split in the same order. This saves the round trips of individual
+ * queries. Instruments which reject compound queries get the queries
+ * of the batch one at a time, see sr_scpi_batch_run().
+ *
+ * Queries should use absolute headers (starting with ':') or common
+ * commands (starting with '*'), and must have short responses without
+ * definite length blocks.
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ *
+ * @return The new batch, release it with sr_scpi_batch_free().
+ */
+SR_PRIV struct sr_scpi_batch *sr_scpi_batch_new(struct sr_scpi_dev_inst *scpi)
+{
+	struct sr_scpi_batch *batch;
+
+	batch = g_malloc0(sizeof(*batch));
+	batch->scpi = scpi;
+	batch->queries = g_ptr_array_new_with_free_func(g_free);
+	batch->responses = g_ptr_array_new_with_free_func(g_free);
+
+	return batch;
+}
+
+/**
+ * Free a batch of SCPI queries, and its responses.
+ *
+ * @param[in] batch The batch to free. Can be NULL.
+ */
+SR_PRIV void sr_scpi_batch_free(struct sr_scpi_batch *batch)
+{
+	if (!batch)
+		return;
+
+	g_ptr_array_free(batch->queries, TRUE);
+	g_ptr_array_free(batch->responses, TRUE);
+	g_free(batch);
+}
+
+/**
+ * Add a query to a batch.
+ *
+ * @param[in] batch The batch.
+ * @param[in] format Format string of the query, as for sr_scpi_send().
+ *
+ * @return The index of the query, to get its response with.
+ */
+SR_PRIV int sr_scpi_batch_add(struct sr_scpi_batch *batch,
+		const char *format, ...)
+{
+	va_list args;
+	char *query;
+	size_t len;
+
+	va_start(args, format);
+	len = sr_vsnprintf_ascii(NULL, 0, format, args);
+	va_end(args);
+	query = g_malloc0(len + 1);
+	va_start(args, format);
+	sr_vsprintf_ascii(query, format, args);
+	va_end(args);
+
+	/* Line termination gets added when the message is sent. */
+	g_strchomp(query);
+	g_ptr_array_add(batch->queries, query);
+
+	return batch->queries->len - 1;
+}
+
+/**
+ * Send the next program message of a batch.
+ *
+ * This is the asynchronous part of sr_scpi_batch_run(), the caller is
+ * free to do other work until it gets the responses with
+ * sr_scpi_batch_receive(). Other commands must not be sent to the
+ * device meanwhile.
+ *
+ * @param[in] batch The batch.
+ *
+ * @retval SR_OK A message was sent.
+ * @retval SR_ERR_NA All the queries of the batch were sent already.
+ * @retval SR_ERR_ARG The response to a previous message is outstanding.
+ * @retval SR_ERR Sending failed.
+ */
+SR_PRIV int sr_scpi_batch_send(struct sr_scpi_batch *batch)
+{
+	struct sr_scpi_dev_inst *scpi;
+	GString *msg;
+	guint first, count, i;
+	int ret;
+
+	if (batch->in_flight)
+		return SR_ERR_ARG;
+
+	scpi = batch->scpi;
+	first = batch->responses->len;
+	count = MIN(batch->queries->len - first,
+		scpi->no_compound_queries ? 1 : SCPI_BATCH_MAX_QUERIES);
+	if (!count)
+		return SR_ERR_NA;
+
+	msg = g_string_sized_new(256);
+	for (i = first; i < first + count; i++) {
+		if (i > first)
+			g_string_append_c(msg, ';');
+		g_string_append(msg, g_ptr_array_index(batch->queries, i));
+	}
+
+	g_mutex_lock(&scpi->scpi_mutex);
+	ret = scpi_send(scpi, "%s", msg->str);
+	g_mutex_unlock(&scpi->scpi_mutex);
+	g_string_free(msg, TRUE);
+	if (ret != SR_OK)
+		return SR_ERR;
+	batch->in_flight = count;
+
+	return SR_OK;
+}
+
+/*
+ * Split a compound response at the ';' separators, outside of quoted
+ * strings.
+ */
+static void batch_split(GPtrArray *out, const char *str)
+{
+	const char *start, *p;
+	char quote;
+
+	quote = '\0';
+	for (start = p = str; ; p++) {
+		if (quote) {
+			if (*p == quote)
+				quote = '\0';
+			else if (*p)
+				continue;
+		} else if (*p == '"' || *p == '\'') {
+			quote = *p;
+			continue;
+		}
+		if (*p == ';' || !*p) {
+			g_ptr_array_add(out, g_strndup(start, p - start));
+			start = p + 1;
 		}
+		if (!*p)
+			break;
 	}
+}
 
-	memcpy(buf, &response->str[2], llen);
-	buf[llen] = '\0';
-	ret = sr_atol(buf, &datalen);
-	if ((ret != SR_OK) || (datalen == 0)) {
-		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
+/**
+ * Receive the responses to the message of a batch which was sent last.
+ *
+ * @param[in] batch The batch.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG No message awaits its response.
+ * @retval SR_ERR_DATA The number of responses does not match.
+ * @retval SR_ERR Other errors.
+ */
+SR_PRIV int sr_scpi_batch_receive(struct sr_scpi_batch *batch)
+{
+	GPtrArray *parts;
+	char *response;
+	guint i, count;
+	int ret;
+
+	if (!batch->in_flight)
+		return SR_ERR_ARG;
+	count = batch->in_flight;
+	batch->in_flight = 0;
+
+	ret = sr_scpi_get_string(batch->scpi, NULL, &response);
+	if (ret != SR_OK)
 		return ret;
+
+	parts = g_ptr_array_new_with_free_func(g_free);
+	batch_split(parts, response);
+	g_free(response);
+	if (parts->len != count) {
+		sr_dbg("Got %u responses to %u batched queries.",
+			parts->len, count);
+		g_ptr_array_free(parts, TRUE);
+		return SR_ERR_DATA;
 	}
-	g_string_erase(response, 0, 2 + llen);
+	for (i = 0; i < parts->len; i++)
+		g_ptr_array_add(batch->responses,
+			g_strdup(g_strstrip(g_ptr_array_index(parts, i))));
+	g_ptr_array_free(parts, TRUE);
 
-	/*
-	 * Re-allocate the buffer size to the now known length
-	 * and keep reading more chunks of response data.
-	 */
-	oldlen = response->len;
-	g_string_set_size(response, datalen);
-	g_string_set_size(response, oldlen);
+	return SR_OK;
+}
 
-	if (oldlen < (unsigned long)(datalen)) {
-		do {
-			oldlen = response->len;
-			ret = scpi_read_response(scpi, response, timeout);
+/**
+ * Send all the queries of a batch, and receive their responses.
+ *
+ * When the responses to a compound message don't match its queries,
+ * the device is assumed to not support compound queries. The remaining
+ * queries of this and later batches get sent one at a time then.
+ *
+ * @param[in] batch The batch.
+ *
+ * @return SR_OK upon success, SR_ERR* upon failure.
+ */
+SR_PRIV int sr_scpi_batch_run(struct sr_scpi_batch *batch)
+{
+	int ret;
 
-			/* On timeout truncate the buffer and send the partial response
-			 * instead of getting stuck on timeouts...
-			 */
-			if (ret == SR_ERR_TIMEOUT) {
-				datalen = oldlen;
-				break;
-			}
-			if (ret < 0) {
-				g_mutex_unlock(&scpi->scpi_mutex);
-				g_string_free(response, TRUE);
-				return ret;
-			}
-			if (ret > 0)
-				timeout = g_get_monotonic_time() + scpi->read_timeout_us;
-		} while (response->len < (unsigned long)(datalen));
+	while ((ret = sr_scpi_batch_send(batch)) == SR_OK) {
+		ret = sr_scpi_batch_receive(batch);
+		if (ret == SR_ERR_DATA && !batch->scpi->no_compound_queries) {
+			sr_info("Compound queries failed, sending them "
+				"one at a time.");
+			batch->scpi->no_compound_queries = TRUE;
+			continue;
+		}
+		if (ret != SR_OK)
+			return ret;
 	}
 
-	g_mutex_unlock(&scpi->scpi_mutex);
+	return ret == SR_ERR_NA ? SR_OK : ret;
+}
+
+/**
+ * Get the response to a query of a batch.
+ *
+ * @param[in] batch The batch, after sr_scpi_batch_run().
+ * @param[in] idx The index of the query, from sr_scpi_batch_add().
+ *
+ * @return The response, owned by the batch. NULL if not received.
+ */
+SR_PRIV const char *sr_scpi_batch_get_string(struct sr_scpi_batch *batch,
+		int idx)
+{
+	if (idx < 0 || (guint)idx >= batch->responses->len)
+		return NULL;
+
+	return g_ptr_array_index(batch->responses, idx);
+}
+
+/**
+ * Get the response to a query of a batch, as a bool value.
+ *
+ * @param[in] batch The batch, after sr_scpi_batch_run().
+ * @param[in] idx The index of the query, from sr_scpi_batch_add().
+ * @param[out] value Pointer where to store the parsed result.
+ *
+ * @return SR_OK on success, SR_ERR* on failure.
+ */
+SR_PRIV int sr_scpi_batch_get_bool(struct sr_scpi_batch *batch,
+		int idx, gboolean *value)
+{
+	const char *response;
+
+	if (!(response = sr_scpi_batch_get_string(batch, idx)))
+		return SR_ERR;
+
+	if (parse_strict_bool(response, value) != SR_OK)
+		return SR_ERR_DATA;
+
+	return SR_OK;
+}
+
+/**
+ * Get the response to a query of a batch, as a float value.
+ *
+ * @param[in] batch The batch, after sr_scpi_batch_run().
+ * @param[in] idx The index of the query, from sr_scpi_batch_add().
+ * @param[out] value Pointer where to store the parsed result.
+ *
+ * @return SR_OK on success, SR_ERR* on failure.
+ */
+SR_PRIV int sr_scpi_batch_get_float(struct sr_scpi_batch *batch,
+		int idx, float *value)
+{
+	const char *response;
+
+	if (!(response = sr_scpi_batch_get_string(batch, idx)))
+		return SR_ERR;
 
-	/* Convert received data to byte array. */
-	*scpi_response = g_byte_array_new_take(
-		(guint8*)g_string_free(response, FALSE), datalen);
+	if (sr_atof_ascii(response, value) != SR_OK)
+		return SR_ERR_DATA;
 
 	return SR_OK;
 }
@@ -1250,24 +1903,117 @@ SR_PRIV const char *sr_vendor_alias(const char *raw_vendor)
 	return raw_vendor;
 }
 
-SR_PRIV const char *sr_scpi_cmd_get(const struct scpi_command *cmdtable,
-		int command)
+static const struct scpi_command *scpi_cmd_find(
+		const struct scpi_command *cmdtable, int command)
 {
 	unsigned int i;
-	const char *cmd;
 
 	if (!cmdtable)
 		return NULL;
 
-	cmd = NULL;
 	for (i = 0; cmdtable[i].string; i++) {
-		if (cmdtable[i].command == command) {
-			cmd = cmdtable[i].string;
-			break;
-		}
+		if (cmdtable[i].command == command)
+			return &cmdtable[i];
 	}
 
-	return cmd;
+	return NULL;
+}
+
+SR_PRIV const char *sr_scpi_cmd_get(const struct scpi_command *cmdtable,
+		int command)
+{
+	const struct scpi_command *entry;
+
+	entry = scpi_cmd_find(cmdtable, command);
+
+	return entry ? entry->string : NULL;
+}
+
+/**
+ * Enable the cache of query responses.
+ *
+ * The responses of queries which are marked SCPI_CMD_CACHED in the
+ * command table are kept then. Commands which
+ * sr_scpi_cmd() sends drop the responses of the same subsystem (the
+ * first node of the header). Drivers which enable the cache should
+ * flush it when the device state may have changed otherwise, e.g.
+ * after their acquisitions.
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ */
+SR_PRIV void sr_scpi_cache_enable(struct sr_scpi_dev_inst *scpi)
+{
+	if (scpi->response_cache)
+		return;
+
+	scpi->response_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+		g_free, g_free);
+}
+
+/**
+ * Drop all cached query responses.
+ *
+ * @param[in] scpi Previously initialised SCPI device structure.
+ */
+SR_PRIV void sr_scpi_cache_flush(struct sr_scpi_dev_inst *scpi)
+{
+	if (scpi->response_cache)
+		g_hash_table_remove_all(scpi->response_cache);
+}
+
+/*
+ * Get the subsystem of a command, the letters of its first header
+ * node. ":SOUR1:VOLT?" and "SOUR%s:VOLT %.6f" both are "SOUR".
+ */
+static char *scpi_cmd_subsystem(const char *cmd)
+{
+	const char *end;
+
+	while (*cmd == ':' || *cmd == '*')
+		cmd++;
+	for (end = cmd; g_ascii_isalpha(*end); end++)
+		;
+
+	return g_ascii_strup(cmd, end - cmd);
+}
+
+/* Cache keys start with the subsystem, for the invalidation. */
+static char *scpi_cache_key(const char *cmd, const char *channel_name,
+		const char *query)
+{
+	char *subsystem, *key;
+
+	subsystem = scpi_cmd_subsystem(cmd);
+	key = g_strdup_printf("%s\n%s\n%s", subsystem,
+		channel_name ? channel_name : "", query);
+	g_free(subsystem);
+
+	return key;
+}
+
+static gboolean cache_key_matches(gpointer key, gpointer value,
+		gpointer user_data)
+{
+	(void)value;
+
+	return g_str_has_prefix(key, user_data);
+}
+
+/* Drop the cached responses of the subsystem of a command. */
+static void scpi_cache_invalidate(struct sr_scpi_dev_inst *scpi,
+		const char *cmd)
+{
+	char *subsystem, *prefix;
+
+	if (!scpi->response_cache)
+		return;
+
+	subsystem = scpi_cmd_subsystem(cmd);
+	prefix = g_strconcat(subsystem, "\n", NULL);
+	g_hash_table_foreach_remove(scpi->response_cache,
+		cache_key_matches, prefix);
+	g_free(prefix);
+	g_free(subsystem);
 }
 
 SR_PRIV int sr_scpi_cmd(const struct sr_dev_inst *sdi,
@@ -1306,35 +2052,23 @@ SR_PRIV int sr_scpi_cmd(const struct sr_dev_inst *sdi,
 	ret = scpi_send_variadic(scpi, cmd, args);
 	va_end(args);
 
+	scpi_cache_invalidate(scpi, cmd);
+
 	g_mutex_unlock(&scpi->scpi_mutex);
 
 	return ret;
 }
 
-SR_PRIV int sr_scpi_cmd_resp(const struct sr_dev_inst *sdi,
+/* Select the channel, send a query and get its response, without mutex. */
+static int scpi_cmd_query(struct sr_scpi_dev_inst *scpi,
 		const struct scpi_command *cmdtable,
 		int channel_command, const char *channel_name,
-		GVariant **gvar, const GVariantType *gvtype, int command, ...)
+		const char *query, char **scpi_response)
 {
-	struct sr_scpi_dev_inst *scpi;
-	va_list args;
 	const char *channel_cmd;
-	const char *cmd;
 	GString *response;
-	char *s;
-	gboolean b;
-	double d;
 	int ret;
 
-	scpi = sdi->conn;
-
-	if (!(cmd = sr_scpi_cmd_get(cmdtable, command))) {
-		/* Device does not implement this command. */
-		return SR_ERR_NA;
-	}
-
-	g_mutex_lock(&scpi->scpi_mutex);
-
 	/* Select channel. */
 	channel_cmd = sr_scpi_cmd_get(cmdtable, channel_command);
 	if (channel_cmd && channel_name &&
@@ -1347,25 +2081,18 @@ SR_PRIV int sr_scpi_cmd_resp(const struct sr_dev_inst *sdi,
 			return ret;
 	}
 
-	va_start(args, command);
-	ret = scpi_send_variadic(scpi, cmd, args);
-	va_end(args);
-	if (ret != SR_OK) {
-		g_mutex_unlock(&scpi->scpi_mutex);
+	ret = scpi_send(scpi, "%s", query);
+	if (ret != SR_OK)
 		return ret;
-	}
 
 	response = g_string_sized_new(1024);
 	ret = scpi_get_data(scpi, NULL, &response);
 	if (ret != SR_OK) {
-		g_mutex_unlock(&scpi->scpi_mutex);
 		if (response)
 			g_string_free(response, TRUE);
 		return ret;
 	}
 
-	g_mutex_unlock(&scpi->scpi_mutex);
-
 	/* Get rid of trailing linefeed if present */
 	if (response->len >= 1 && response->str[response->len - 1] == '\n')
 		g_string_truncate(response, response->len - 1);
@@ -1374,9 +2101,68 @@ SR_PRIV int sr_scpi_cmd_resp(const struct sr_dev_inst *sdi,
 	if (response->len >= 1 && response->str[response->len - 1] == '\r')
 		g_string_truncate(response, response->len - 1);
 
-	s = g_string_free(response, FALSE);
+	*scpi_response = g_string_free(response, FALSE);
 
+	return SR_OK;
+}
+
+SR_PRIV int sr_scpi_cmd_resp(const struct sr_dev_inst *sdi,
+		const struct scpi_command *cmdtable,
+		int channel_command, const char *channel_name,
+		GVariant **gvar, const GVariantType *gvtype, int command, ...)
+{
+	struct sr_scpi_dev_inst *scpi;
+	va_list args;
+	const struct scpi_command *entry;
+	const char *cmd;
+	char *s, *query, *key;
+	gboolean b;
+	double d;
+	int ret, len;
+
+	scpi = sdi->conn;
+
+	if (!(entry = scpi_cmd_find(cmdtable, command))) {
+		/* Device does not implement this command. */
+		return SR_ERR_NA;
+	}
+	cmd = entry->string;
+
+	va_start(args, command);
+	len = sr_vsnprintf_ascii(NULL, 0, cmd, args);
+	va_end(args);
+	query = g_malloc0(len + 1);
+	va_start(args, command);
+	sr_vsprintf_ascii(query, cmd, args);
+	va_end(args);
+
+	g_mutex_lock(&scpi->scpi_mutex);
+
+	/* Use the cached response of queries without side effects. */
+	key = NULL;
+	s = NULL;
 	ret = SR_OK;
+	if (scpi->response_cache && (entry->flags & SCPI_CMD_CACHED)) {
+		key = scpi_cache_key(cmd, channel_name, query);
+		s = g_strdup(g_hash_table_lookup(scpi->response_cache, key));
+	}
+	if (!s) {
+		ret = scpi_cmd_query(scpi, cmdtable, channel_command,
+			channel_name, query, &s);
+		if (ret == SR_OK && key) {
+			g_hash_table_replace(scpi->response_cache, key,
+				g_strdup(s));
+			key = NULL;
+		}
+	}
+
+	g_mutex_unlock(&scpi->scpi_mutex);
+
+	g_free(key);
+	g_free(query);
+	if (ret != SR_OK)
+		return ret;
+
 	if (g_variant_type_equal(gvtype, G_VARIANT_TYPE_BOOLEAN)) {
 		if ((ret = parse_strict_bool(s, &b)) == SR_OK)
 			*gvar = g_variant_new_boolean(b);
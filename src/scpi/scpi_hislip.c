@@ -0,0 +1,629 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * HiSLIP (IVI-6.1, High-Speed LAN Instrument Protocol) transport.
+ *
+ * A session consists of two TCP connections to the same port. The
+ * synchronous channel carries the SCPI messages in Data and DataEnd
+ * messages, the asynchronous channel carries the session setup and
+ * the negotiation of the maximum message size. Every message has a
+ * 16 byte header: the "HS" prologue, message type, control code, a
+ * 32 bit message parameter and a 64 bit payload length, big endian.
+ */
+
+#include <config.h>
+#ifdef _WIN32
+#define _WIN32_WINNT 0x0501
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif
+#include <glib.h>
+#include <string.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#endif
+#include <errno.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "scpi.h"
+
+#define LOG_PREFIX "scpi_hislip"
+
+#define HISLIP_DEFAULT_PORT "4880"
+#define HISLIP_DEFAULT_SUB_ADDRESS "hislip0"
+#define HISLIP_TIMEOUT_MS 2000
+
+#define HISLIP_HEADER_SIZE 16
+#define HISLIP_PROTOCOL_VERSION 0x0100
+#define HISLIP_VENDOR_ID (('S' << 8) | 'R')
+#define HISLIP_INITIAL_MESSAGE_ID 0xffffff00
+
+/* Large messages let instruments send whole waveforms at once. */
+#define HISLIP_MAX_MESSAGE_SIZE ((uint64_t)1 << 30)
+
+enum hislip_message_type {
+	HISLIP_INITIALIZE = 0,
+	HISLIP_INITIALIZE_RESPONSE = 1,
+	HISLIP_FATAL_ERROR = 2,
+	HISLIP_ERROR = 3,
+	HISLIP_DATA = 6,
+	HISLIP_DATA_END = 7,
+	HISLIP_INTERRUPTED = 13,
+	HISLIP_ASYNC_INTERRUPTED = 14,
+	HISLIP_ASYNC_MAXIMUM_MESSAGE_SIZE = 15,
+	HISLIP_ASYNC_MAXIMUM_MESSAGE_SIZE_RESPONSE = 16,
+	HISLIP_ASYNC_INITIALIZE = 17,
+	HISLIP_ASYNC_INITIALIZE_RESPONSE = 18,
+	HISLIP_ASYNC_SERVICE_REQUEST = 20,
+};
+
+struct hislip_header {
+	uint8_t type;
+	uint8_t control;
+	uint32_t param;
+	uint64_t length;
+};
+
+struct scpi_hislip {
+	char *address;
+	char *sub_address;
+	char *port;
+	int sync_socket;
+	int async_socket;
+	gboolean overlapped;
+	uint16_t session_id;
+	uint64_t max_send_size;
+	uint32_t message_id;
+	uint32_t last_message_id;
+	gboolean rmt_delivered;
+	/* Receive state of the synchronous channel. */
+	uint8_t header_buf[HISLIP_HEADER_SIZE];
+	int header_bytes_read;
+	struct hislip_header header;
+	uint64_t payload_remaining;
+	gboolean discard;
+	gboolean read_complete;
+};
+
+static int scpi_hislip_dev_inst_new(void *priv, struct drv_context *drvc,
+		const char *resource, char **params, const char *serialcomm)
+{
+	struct scpi_hislip *hislip = priv;
+
+	(void)drvc;
+	(void)resource;
+	(void)serialcomm;
+
+	if (!params || !params[1]) {
+		sr_err("Invalid parameters.");
+		return SR_ERR;
+	}
+
+	hislip->address = g_strdup(params[1]);
+	hislip->sub_address = g_strdup(params[2] ?
+		params[2] : HISLIP_DEFAULT_SUB_ADDRESS);
+	hislip->port = g_strdup(params[2] && params[3] ?
+		params[3] : HISLIP_DEFAULT_PORT);
+	hislip->sync_socket = -1;
+	hislip->async_socket = -1;
+
+	return SR_OK;
+}
+
+static int hislip_connect(struct scpi_hislip *hislip)
+{
+	struct addrinfo hints;
+	struct addrinfo *results, *res;
+	int sock, err;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	err = getaddrinfo(hislip->address, hislip->port, &hints, &results);
+	if (err) {
+		sr_err("Address lookup failed: %s:%s: %s", hislip->address,
+			hislip->port, gai_strerror(err));
+		return -1;
+	}
+
+	sock = -1;
+	for (res = results; res; res = res->ai_next) {
+		if ((sock = socket(res->ai_family, res->ai_socktype,
+						res->ai_protocol)) < 0)
+			continue;
+		if (connect(sock, res->ai_addr, res->ai_addrlen) != 0) {
+			close(sock);
+			sock = -1;
+			continue;
+		}
+		break;
+	}
+
+	freeaddrinfo(results);
+
+	if (sock < 0)
+		sr_err("Failed to connect to %s:%s: %s", hislip->address,
+			hislip->port, g_strerror(errno));
+
+	return sock;
+}
+
+static int hislip_send_msg(int sock, enum hislip_message_type type,
+		uint8_t control, uint32_t param, const void *payload,
+		uint64_t length)
+{
+	uint8_t header[HISLIP_HEADER_SIZE];
+	const uint8_t *p;
+	size_t left;
+	int len;
+
+	header[0] = 'H';
+	header[1] = 'S';
+	header[2] = type;
+	header[3] = control;
+	WB32(&header[4], param);
+	write_u64be(&header[8], length);
+
+	len = send(sock, (const char *)header, sizeof(header), 0);
+	if (len != (int)sizeof(header)) {
+		sr_err("Send error: %s", g_strerror(errno));
+		return SR_ERR;
+	}
+
+	p = payload;
+	left = length;
+	while (left) {
+		len = send(sock, (const char *)p, left, 0);
+		if (len < 0) {
+			sr_err("Send error: %s", g_strerror(errno));
+			return SR_ERR;
+		}
+		p += len;
+		left -= len;
+	}
+
+	return SR_OK;
+}
+
+/* Receive exactly len bytes, used while no acquisition is running. */
+static int hislip_recv_all(int sock, void *buf, size_t len)
+{
+	struct timeval tv;
+	fd_set fds;
+	uint8_t *p;
+	int ret;
+
+	p = buf;
+	while (len) {
+		FD_ZERO(&fds);
+		FD_SET(sock, &fds);
+		tv.tv_sec = HISLIP_TIMEOUT_MS / 1000;
+		tv.tv_usec = (HISLIP_TIMEOUT_MS % 1000) * 1000;
+		ret = select(sock + 1, &fds, NULL, NULL, &tv);
+		if (ret < 0) {
+			sr_err("Wait error: %s", g_strerror(errno));
+			return SR_ERR;
+		}
+		if (ret == 0) {
+			sr_err("Timed out waiting for the device.");
+			return SR_ERR_TIMEOUT;
+		}
+		ret = recv(sock, (char *)p, len, 0);
+		if (ret < 0) {
+			sr_err("Receive error: %s", g_strerror(errno));
+			return SR_ERR;
+		}
+		if (ret == 0) {
+			sr_err("Connection closed by the device.");
+			return SR_ERR_IO;
+		}
+		p += ret;
+		len -= ret;
+	}
+
+	return SR_OK;
+}
+
+static int hislip_parse_header(const uint8_t *buf,
+		struct hislip_header *header)
+{
+	if (buf[0] != 'H' || buf[1] != 'S') {
+		sr_err("Invalid message prologue.");
+		return SR_ERR_DATA;
+	}
+
+	header->type = buf[2];
+	header->control = buf[3];
+	header->param = RB32(&buf[4]);
+	header->length = RB64(&buf[8]);
+
+	return SR_OK;
+}
+
+/* Log the text of (fatal) error messages, which name the reason. */
+static void hislip_log_error(const struct hislip_header *header,
+		const uint8_t *payload, size_t length)
+{
+	sr_err("Device reported %serror %u: %.*s",
+		header->type == HISLIP_FATAL_ERROR ? "fatal " : "",
+		header->control, (int)length, (const char *)payload);
+}
+
+/*
+ * Receive the next message of the given type on a channel. Service
+ * requests and interruption notifications which arrive in between
+ * get skipped. A payload up to maxlen bytes is returned in buf.
+ */
+static int hislip_expect(int sock, enum hislip_message_type type,
+		struct hislip_header *header, uint8_t *buf, size_t maxlen)
+{
+	uint8_t raw[HISLIP_HEADER_SIZE];
+	uint8_t *payload;
+	int ret;
+
+	while (1) {
+		if ((ret = hislip_recv_all(sock, raw, sizeof(raw))) != SR_OK)
+			return ret;
+		if ((ret = hislip_parse_header(raw, header)) != SR_OK)
+			return ret;
+		if (header->length > HISLIP_MAX_MESSAGE_SIZE) {
+			sr_err("Message too large: %" PRIu64 " bytes.",
+				header->length);
+			return SR_ERR_DATA;
+		}
+		payload = g_malloc(header->length + 1);
+		ret = hislip_recv_all(sock, payload, header->length);
+		if (ret == SR_OK && (header->type == HISLIP_ERROR ||
+				header->type == HISLIP_FATAL_ERROR)) {
+			hislip_log_error(header, payload, header->length);
+			ret = SR_ERR;
+		}
+		if (ret == SR_OK && header->type == type) {
+			if (buf)
+				memcpy(buf, payload, MIN(header->length, maxlen));
+			g_free(payload);
+			return SR_OK;
+		}
+		g_free(payload);
+		if (ret != SR_OK)
+			return ret;
+		sr_dbg("Skipping message of type %u.", header->type);
+	}
+}
+
+static int scpi_hislip_open(struct sr_scpi_dev_inst *scpi)
+{
+	struct scpi_hislip *hislip = scpi->priv;
+	struct hislip_header header;
+	uint8_t size[8];
+	int ret;
+
+	if ((hislip->sync_socket = hislip_connect(hislip)) < 0)
+		return SR_ERR;
+
+	ret = hislip_send_msg(hislip->sync_socket, HISLIP_INITIALIZE, 0,
+		(HISLIP_PROTOCOL_VERSION << 16) | HISLIP_VENDOR_ID,
+		hislip->sub_address, strlen(hislip->sub_address));
+	if (ret == SR_OK)
+		ret = hislip_expect(hislip->sync_socket,
+			HISLIP_INITIALIZE_RESPONSE, &header, NULL, 0);
+	if (ret != SR_OK)
+		goto err_close;
+
+	hislip->overlapped = header.control & 0x01;
+	hislip->session_id = header.param & 0xffff;
+	sr_dbg("Server protocol version %u.%u, session %u, %s mode.",
+		header.param >> 24, (header.param >> 16) & 0xff,
+		hislip->session_id,
+		hislip->overlapped ? "overlapped" : "synchronized");
+
+	if ((hislip->async_socket = hislip_connect(hislip)) < 0)
+		goto err_close;
+
+	ret = hislip_send_msg(hislip->async_socket, HISLIP_ASYNC_INITIALIZE,
+		0, hislip->session_id, NULL, 0);
+	if (ret == SR_OK)
+		ret = hislip_expect(hislip->async_socket,
+			HISLIP_ASYNC_INITIALIZE_RESPONSE, &header, NULL, 0);
+	if (ret != SR_OK)
+		goto err_close;
+
+	write_u64be(size, HISLIP_MAX_MESSAGE_SIZE);
+	ret = hislip_send_msg(hislip->async_socket,
+		HISLIP_ASYNC_MAXIMUM_MESSAGE_SIZE, 0, 0, size, sizeof(size));
+	if (ret == SR_OK)
+		ret = hislip_expect(hislip->async_socket,
+			HISLIP_ASYNC_MAXIMUM_MESSAGE_SIZE_RESPONSE, &header,
+			size, sizeof(size));
+	if (ret != SR_OK)
+		goto err_close;
+	hislip->max_send_size = header.length >= sizeof(size) ?
+		RB64(size) : 0;
+	/* Don't split commands into tiny messages for odd devices. */
+	if (hislip->max_send_size < 256)
+		hislip->max_send_size = 256;
+	sr_dbg("Device accepts messages of up to %" PRIu64 " bytes.",
+		hislip->max_send_size);
+
+	hislip->message_id = HISLIP_INITIAL_MESSAGE_ID;
+	hislip->last_message_id = hislip->message_id;
+	hislip->rmt_delivered = FALSE;
+	hislip->header_bytes_read = 0;
+	hislip->payload_remaining = 0;
+
+	return SR_OK;
+
+err_close:
+	if (hislip->async_socket >= 0)
+		close(hislip->async_socket);
+	close(hislip->sync_socket);
+	hislip->async_socket = -1;
+	hislip->sync_socket = -1;
+
+	return SR_ERR;
+}
+
+static int scpi_hislip_connection_id(struct sr_scpi_dev_inst *scpi,
+		char **connection_id)
+{
+	struct scpi_hislip *hislip = scpi->priv;
+
+	*connection_id = g_strdup_printf("%s/%s/%s/%s", scpi->prefix,
+		hislip->address, hislip->sub_address, hislip->port);
+
+	return SR_OK;
+}
+
+static int scpi_hislip_source_add(struct sr_session *session, void *priv,
+		int events, int timeout, sr_receive_data_callback cb, void *cb_data)
+{
+	struct scpi_hislip *hislip = priv;
+
+	return sr_session_source_add(session, hislip->sync_socket, events,
+			timeout, cb, cb_data);
+}
+
+static int scpi_hislip_source_remove(struct sr_session *session, void *priv)
+{
+	struct scpi_hislip *hislip = priv;
+
+	return sr_session_source_remove(session, hislip->sync_socket);
+}
+
+static int scpi_hislip_send(void *priv, const char *command)
+{
+	struct scpi_hislip *hislip = priv;
+	enum hislip_message_type type;
+	size_t len, offset, chunk;
+	int ret;
+
+	len = strlen(command);
+	offset = 0;
+	do {
+		chunk = MIN(len - offset, hislip->max_send_size);
+		type = offset + chunk == len ? HISLIP_DATA_END : HISLIP_DATA;
+		ret = hislip_send_msg(hislip->sync_socket, type,
+			hislip->rmt_delivered ? 0x01 : 0x00,
+			hislip->message_id, command + offset, chunk);
+		if (ret != SR_OK)
+			return ret;
+		hislip->rmt_delivered = FALSE;
+		hislip->last_message_id = hislip->message_id;
+		hislip->message_id += 2;
+		offset += chunk;
+	} while (offset < len);
+
+	sr_spew("Successfully sent SCPI command: '%s'.", command);
+
+	return SR_OK;
+}
+
+/*
+ * In overlapped mode the device may still send the responses to earlier
+ * queries, e.g. after a read timed out. Those carry older message IDs.
+ */
+static gboolean hislip_is_stale(struct scpi_hislip *hislip)
+{
+	if (hislip->header.type != HISLIP_DATA &&
+			hislip->header.type != HISLIP_DATA_END)
+		return TRUE;
+
+	return hislip->overlapped &&
+		hislip->header.param != hislip->last_message_id;
+}
+
+static int scpi_hislip_read_begin(void *priv)
+{
+	struct scpi_hislip *hislip = priv;
+
+	hislip->read_complete = FALSE;
+	/* Drop the rest of a message which a previous read left behind. */
+	if (hislip->header_bytes_read == HISLIP_HEADER_SIZE)
+		hislip->discard = hislip_is_stale(hislip);
+
+	return SR_OK;
+}
+
+static void hislip_message_done(struct scpi_hislip *hislip)
+{
+	if (hislip->header.type == HISLIP_DATA_END && !hislip->discard) {
+		hislip->read_complete = TRUE;
+		hislip->rmt_delivered = TRUE;
+	}
+	hislip->header_bytes_read = 0;
+}
+
+static int hislip_read_header(struct scpi_hislip *hislip)
+{
+	uint8_t *payload;
+	int len, ret;
+
+	len = recv(hislip->sync_socket,
+		(char *)hislip->header_buf + hislip->header_bytes_read,
+		HISLIP_HEADER_SIZE - hislip->header_bytes_read, 0);
+	if (len < 0) {
+		sr_err("Receive error: %s", g_strerror(errno));
+		return SR_ERR;
+	}
+	if (len == 0) {
+		sr_err("Connection closed by the device.");
+		return SR_ERR_IO;
+	}
+	hislip->header_bytes_read += len;
+	if (hislip->header_bytes_read < HISLIP_HEADER_SIZE)
+		return SR_OK;
+
+	ret = hislip_parse_header(hislip->header_buf, &hislip->header);
+	if (ret != SR_OK)
+		return ret;
+
+	if (hislip->header.type == HISLIP_ERROR ||
+			hislip->header.type == HISLIP_FATAL_ERROR) {
+		if (hislip->header.length > HISLIP_MAX_MESSAGE_SIZE)
+			return SR_ERR_DATA;
+		payload = g_malloc(hislip->header.length);
+		ret = hislip_recv_all(hislip->sync_socket, payload,
+			hislip->header.length);
+		if (ret == SR_OK)
+			hislip_log_error(&hislip->header, payload,
+				hislip->header.length);
+		g_free(payload);
+		hislip->header_bytes_read = 0;
+		return SR_ERR;
+	}
+
+	hislip->discard = hislip_is_stale(hislip);
+	if (hislip->discard)
+		sr_dbg("Discarding message of type %u, ID 0x%08x.",
+			hislip->header.type, hislip->header.param);
+	hislip->payload_remaining = hislip->header.length;
+	if (!hislip->payload_remaining)
+		hislip_message_done(hislip);
+
+	return SR_OK;
+}
+
+static int scpi_hislip_read_data(void *priv, char *buf, int maxlen)
+{
+	struct scpi_hislip *hislip = priv;
+	int len, ret;
+
+	if (hislip->read_complete)
+		return 0;
+
+	if (hislip->header_bytes_read < HISLIP_HEADER_SIZE) {
+		ret = hislip_read_header(hislip);
+		return ret == SR_OK ? 0 : ret;
+	}
+
+	/* Stale payload gets received into the caller's buffer, and dropped. */
+	len = recv(hislip->sync_socket, buf,
+		MIN((uint64_t)maxlen, hislip->payload_remaining), 0);
+	if (len < 0) {
+		sr_err("Receive error: %s", g_strerror(errno));
+		return SR_ERR;
+	}
+	if (len == 0) {
+		sr_err("Connection closed by the device.");
+		return SR_ERR_IO;
+	}
+
+	hislip->payload_remaining -= len;
+	if (!hislip->payload_remaining)
+		hislip_message_done(hislip);
+
+	return hislip->discard ? 0 : len;
+}
+
+static int scpi_hislip_wait_data(void *priv, int timeout_ms)
+{
+	struct scpi_hislip *hislip = priv;
+	struct timeval tv;
+	fd_set fds;
+	int ret;
+
+	FD_ZERO(&fds);
+	FD_SET(hislip->sync_socket, &fds);
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+	ret = select(hislip->sync_socket + 1, &fds, NULL, NULL, &tv);
+	if (ret < 0) {
+		sr_err("Wait error: %s", g_strerror(errno));
+		return SR_ERR;
+	}
+
+	return ret;
+}
+
+static int scpi_hislip_read_complete(void *priv)
+{
+	struct scpi_hislip *hislip = priv;
+
+	return hislip->read_complete;
+}
+
+static int scpi_hislip_close(struct sr_scpi_dev_inst *scpi)
+{
+	struct scpi_hislip *hislip = scpi->priv;
+	int ret;
+
+	ret = SR_OK;
+	if (hislip->async_socket >= 0 && close(hislip->async_socket) < 0)
+		ret = SR_ERR;
+	if (close(hislip->sync_socket) < 0)
+		ret = SR_ERR;
+	hislip->async_socket = -1;
+	hislip->sync_socket = -1;
+
+	return ret;
+}
+
+static void scpi_hislip_free(void *priv)
+{
+	struct scpi_hislip *hislip = priv;
+
+	g_free(hislip->address);
+	g_free(hislip->sub_address);
+	g_free(hislip->port);
+}
+
+SR_PRIV const struct sr_scpi_dev_inst scpi_hislip_dev = {
+	.name          = "HiSLIP",
+	.prefix        = "hislip",
+	.transport     = SCPI_TRANSPORT_HISLIP,
+	.priv_size     = sizeof(struct scpi_hislip),
+	.dev_inst_new  = scpi_hislip_dev_inst_new,
+	.open          = scpi_hislip_open,
+	.connection_id = scpi_hislip_connection_id,
+	.source_add    = scpi_hislip_source_add,
+	.source_remove = scpi_hislip_source_remove,
+	.send          = scpi_hislip_send,
+	.read_begin    = scpi_hislip_read_begin,
+	.read_data     = scpi_hislip_read_data,
+	.wait_data     = scpi_hislip_wait_data,
+	.read_complete = scpi_hislip_read_complete,
+	.close         = scpi_hislip_close,
+	.free          = scpi_hislip_free,
+};
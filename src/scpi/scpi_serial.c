@@ -203,6 +203,13 @@ static int scpi_serial_read_data(void *priv, char *buf, int maxlen)
 	return ret;
 }
 
+static int scpi_serial_wait_data(void *priv, int timeout_ms)
+{
+	struct scpi_serial *sscpi = priv;
+
+	return serial_wait_receive_data(sscpi->serial, timeout_ms);
+}
+
 static int scpi_serial_read_complete(void *priv)
 {
 	struct scpi_serial *sscpi = priv;
@@ -238,6 +245,7 @@ SR_PRIV const struct sr_scpi_dev_inst scpi_serial_dev = {
 	.send          = scpi_serial_send,
 	.read_begin    = scpi_serial_read_begin,
 	.read_data     = scpi_serial_read_data,
+	.wait_data     = scpi_serial_wait_data,
 	.read_complete = scpi_serial_read_complete,
 	.close         = scpi_serial_close,
 	.free          = scpi_serial_free,
@@ -27,6 +27,7 @@
 #include <string.h>
 #include <unistd.h>
 #ifndef _WIN32
+#include <sys/select.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -194,6 +195,26 @@ static int scpi_tcp_raw_read_data(void *priv, char *buf, int maxlen)
 	return len;
 }
 
+static int scpi_tcp_wait_data(void *priv, int timeout_ms)
+{
+	struct scpi_tcp *tcp = priv;
+	struct timeval tv;
+	fd_set fds;
+	int ret;
+
+	FD_ZERO(&fds);
+	FD_SET(tcp->socket, &fds);
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+	ret = select(tcp->socket + 1, &fds, NULL, NULL, &tv);
+	if (ret < 0) {
+		sr_err("Wait error: %s", g_strerror(errno));
+		return SR_ERR;
+	}
+
+	return ret;
+}
+
 static int scpi_tcp_raw_write_data(void *priv, char *buf, int len)
 {
 	struct scpi_tcp *tcp = priv;
@@ -284,6 +305,7 @@ SR_PRIV const struct sr_scpi_dev_inst scpi_tcp_raw_dev = {
 	.send          = scpi_tcp_send,
 	.read_begin    = scpi_tcp_read_begin,
 	.read_data     = scpi_tcp_raw_read_data,
+	.wait_data     = scpi_tcp_wait_data,
 	.write_data    = scpi_tcp_raw_write_data,
 	.read_complete = scpi_tcp_read_complete,
 	.close         = scpi_tcp_close,
@@ -303,6 +325,7 @@ SR_PRIV const struct sr_scpi_dev_inst scpi_tcp_rigol_dev = {
 	.send          = scpi_tcp_send,
 	.read_begin    = scpi_tcp_read_begin,
 	.read_data     = scpi_tcp_rigol_read_data,
+	.wait_data     = scpi_tcp_wait_data,
 	.read_complete = scpi_tcp_read_complete,
 	.close         = scpi_tcp_close,
 	.free          = scpi_tcp_free,
@@ -29,6 +29,10 @@
 #define MAX_TRANSFER_LENGTH 2048
 #define TRANSFER_TIMEOUT 1000
 
+/* Bulk IN transfers which are kept queued during large reads. */
+#define BULK_IN_CHUNK_SIZE (64 * 1024)
+#define BULK_IN_QUEUE_DEPTH 8
+
 struct scpi_usbtmc_libusb {
 	struct sr_context *ctx;
 	struct sr_usb_dev_inst *usb;
@@ -37,6 +41,7 @@ struct scpi_usbtmc_libusb {
 	uint8_t bulk_in_ep;
 	uint8_t bulk_out_ep;
 	uint8_t interrupt_ep;
+	int bulk_in_packet_size;
 	uint8_t usbtmc_int_cap;
 	uint8_t usbtmc_dev_cap;
 	uint8_t usb488_dev_cap;
@@ -130,7 +135,7 @@ static GSList *scpi_usbtmc_libusb_scan(struct drv_context *drvc)
 	int confidx, intfidx, ret, i;
 	char *res;
 
-	ret = libusb_get_device_list(drvc->sr_ctx->libusb_ctx, &devlist);
+	ret = usb_get_device_list(drvc->sr_ctx, &devlist);
 	if (ret < 0) {
 		sr_err("Failed to get device list: %s.",
 		       libusb_error_name(ret));
@@ -338,6 +343,7 @@ static int scpi_usbtmc_libusb_open(struct sr_scpi_dev_inst *scpi)
 				if (ep->bmAttributes == LIBUSB_TRANSFER_TYPE_BULK &&
 				    ep->bEndpointAddress & (LIBUSB_ENDPOINT_DIR_MASK)) {
 					uscpi->bulk_in_ep = ep->bEndpointAddress;
+					uscpi->bulk_in_packet_size = ep->wMaxPacketSize & 0x7ff;
 					sr_dbg("Bulk IN EP %d", uscpi->bulk_in_ep & 0x7f);
 				}
 				if (ep->bmAttributes == LIBUSB_TRANSFER_TYPE_INTERRUPT &&
@@ -591,6 +597,99 @@ static int scpi_usbtmc_bulkin_continue(struct scpi_usbtmc_libusb *uscpi,
 	return transferred;
 }
 
+static void LIBUSB_CALL bulkin_queued_cb(struct libusb_transfer *transfer)
+{
+	int *pending;
+
+	pending = transfer->user_data;
+	(*pending)--;
+}
+
+/*
+ * Receive the payload of a long message directly into the caller's
+ * buffer, with several transfers in flight so that the device never
+ * waits for the host. The size must not exceed the remaining length of
+ * the message, and must be a multiple of the packet size, so that the
+ * transfers cannot take bytes of the next message or overflow.
+ */
+static int scpi_usbtmc_bulkin_queued(struct scpi_usbtmc_libusb *uscpi,
+                                     uint8_t *data, int size)
+{
+	struct sr_usb_dev_inst *usb = uscpi->usb;
+	struct libusb_transfer *transfers[BULK_IN_QUEUE_DEPTH];
+	struct libusb_transfer *transfer;
+	struct timeval tv;
+	int count, offset, len, pending, total, i, ret;
+	gboolean stopped;
+
+	count = 0;
+	pending = 0;
+	ret = 0;
+	for (offset = 0; offset < size && count < BULK_IN_QUEUE_DEPTH;
+	     offset += len) {
+		len = MIN(size - offset, BULK_IN_CHUNK_SIZE);
+		transfer = libusb_alloc_transfer(0);
+		libusb_fill_bulk_transfer(transfer, usb->devhdl,
+		                          uscpi->bulk_in_ep, data + offset, len,
+		                          bulkin_queued_cb, &pending,
+		                          TRANSFER_TIMEOUT);
+		if ((ret = libusb_submit_transfer(transfer)) < 0) {
+			libusb_free_transfer(transfer);
+			break;
+		}
+		transfers[count++] = transfer;
+		pending++;
+	}
+
+	/* Stop the queue at the first short or failed transfer. */
+	stopped = FALSE;
+	while (pending > 0) {
+		tv.tv_sec = 0;
+		tv.tv_usec = 100 * 1000;
+		libusb_handle_events_timeout(uscpi->ctx->libusb_ctx, &tv);
+		if (stopped)
+			continue;
+		for (i = 0; i < count - pending; i++) {
+			transfer = transfers[i];
+			if (transfer->status != LIBUSB_TRANSFER_COMPLETED ||
+			    transfer->actual_length < transfer->length)
+				break;
+		}
+		if (i < count - pending) {
+			for (i = count - pending; i < count; i++)
+				libusb_cancel_transfer(transfers[i]);
+			stopped = TRUE;
+		}
+	}
+
+	/* Keep data which arrived after a short transfer, close the gap. */
+	total = 0;
+	for (i = 0; i < count; i++) {
+		transfer = transfers[i];
+		if (transfer->status != LIBUSB_TRANSFER_COMPLETED &&
+		    transfer->status != LIBUSB_TRANSFER_CANCELLED)
+			sr_err("USBTMC bulk in transfer failed, status %d.",
+			       transfer->status);
+		if (transfer->buffer != data + total)
+			memmove(data + total, transfer->buffer,
+			        transfer->actual_length);
+		total += transfer->actual_length;
+		libusb_free_transfer(transfer);
+	}
+
+	if (!count && ret < 0)
+		sr_err("USBTMC bulk in submit error: %s.",
+		       libusb_error_name(ret));
+	if (!total)
+		return SR_ERR;
+
+	uscpi->response_length = 0;
+	uscpi->response_bytes_read = 0;
+	uscpi->remaining_length -= total;
+
+	return total;
+}
+
 static int scpi_usbtmc_libusb_send(void *priv, const char *command)
 {
 	struct scpi_usbtmc_libusb *uscpi = priv;
@@ -627,6 +726,14 @@ static int scpi_usbtmc_libusb_read_data(void *priv, char *buf, int maxlen)
 	int read_length;
 
 	if (uscpi->response_bytes_read >= uscpi->response_length) {
+		read_length = MIN(uscpi->remaining_length, maxlen);
+		if (uscpi->bulk_in_packet_size > 0)
+			read_length -= read_length % uscpi->bulk_in_packet_size;
+		else
+			read_length = 0;
+		if (read_length > 0)
+			return scpi_usbtmc_bulkin_queued(uscpi,
+			                                 (uint8_t *)buf, read_length);
 		if (uscpi->remaining_length > 0) {
 			if (scpi_usbtmc_bulkin_continue(uscpi, uscpi->buffer,
 			                                sizeof(uscpi->buffer)) <= 0)
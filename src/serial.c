@@ -168,9 +168,14 @@ SR_PRIV int serial_close(struct sr_serial_dev_inst *serial)
 
 	rc = serial->lib_funcs->close(serial);
 	if (rc == SR_OK && serial->rcv_buffer) {
-		g_string_free(serial->rcv_buffer, TRUE);
+		ser_rx_ring_free(serial->rcv_buffer);
 		serial->rcv_buffer = NULL;
 	}
+	if (rc == SR_OK) {
+		g_free(serial->line_buf);
+		serial->line_buf = NULL;
+		serial->line_len = 0;
+	}
 
 	return rc;
 }
@@ -195,6 +200,7 @@ SR_PRIV int serial_flush(struct sr_serial_dev_inst *serial)
 	sr_spew("Flushing serial port %s.", serial->port);
 
 	sr_ser_discard_queued_data(serial);
+	serial->line_len = 0;
 
 	if (!serial->lib_funcs || !serial->lib_funcs->flush)
 		return SR_ERR_NA;
@@ -274,6 +280,149 @@ SR_PRIV int serial_set_read_chunk_cb(struct sr_serial_dev_inst *serial,
 	return SR_OK;
 }
 
+/**
+ * Create an RX data queue. Internal to the serial subsystem.
+ *
+ * @param[in] size The minimum capacity in bytes, gets rounded up to a
+ *                 power of two.
+ *
+ * @return The new queue, release it with ser_rx_ring_free().
+ *
+ * @private
+ */
+SR_PRIV struct ser_rx_ring *ser_rx_ring_new(size_t size)
+{
+	struct ser_rx_ring *ring;
+
+	ring = g_malloc0(sizeof(*ring));
+	ring->size = 1;
+	while (ring->size < size && ring->size < G_MAXINT / 2 + 1)
+		ring->size <<= 1;
+	ring->data = g_malloc(ring->size);
+
+	return ring;
+}
+
+/**
+ * Release an RX data queue. Internal to the serial subsystem.
+ *
+ * @param[in] ring The queue, can be NULL.
+ *
+ * @private
+ */
+SR_PRIV void ser_rx_ring_free(struct ser_rx_ring *ring)
+{
+	if (!ring)
+		return;
+
+	g_free(ring->data);
+	g_free(ring);
+}
+
+/**
+ * Get the number of bytes in an RX data queue. Internal to the serial
+ * subsystem.
+ *
+ * @param[in] ring The queue.
+ *
+ * @private
+ */
+SR_PRIV size_t ser_rx_ring_used(struct ser_rx_ring *ring)
+{
+	guint head, tail;
+
+	head = g_atomic_int_get(&ring->head);
+	tail = g_atomic_int_get(&ring->tail);
+
+	return (guint)(head - tail);
+}
+
+/**
+ * Get the contiguous free space of an RX data queue, for the producer.
+ * Internal to the serial subsystem.
+ *
+ * The free space can wrap around the end of the storage, then a second
+ * span becomes available after ser_rx_ring_commit().
+ *
+ * @param[in] ring The queue.
+ * @param[out] ptr Where to write data to.
+ *
+ * @return The number of bytes which can be written at ptr.
+ *
+ * @private
+ */
+SR_PRIV size_t ser_rx_ring_write_span(struct ser_rx_ring *ring, uint8_t **ptr)
+{
+	size_t pos, len;
+
+	pos = (guint)g_atomic_int_get(&ring->head) & (ring->size - 1);
+	len = ring->size - ser_rx_ring_used(ring);
+	*ptr = &ring->data[pos];
+
+	return MIN(len, ring->size - pos);
+}
+
+/**
+ * Make data available to the consumer of an RX data queue, after it
+ * was written to the span from ser_rx_ring_write_span(). Internal to
+ * the serial subsystem.
+ *
+ * @param[in] ring The queue.
+ * @param[in] len The number of bytes which got written.
+ *
+ * @private
+ */
+SR_PRIV void ser_rx_ring_commit(struct ser_rx_ring *ring, size_t len)
+{
+	guint head;
+
+	head = g_atomic_int_get(&ring->head);
+	g_atomic_int_set(&ring->head, (gint)(head + len));
+}
+
+/**
+ * Get the contiguous data of an RX data queue, for the consumer.
+ * Internal to the serial subsystem.
+ *
+ * The data can wrap around the end of the storage, then a second span
+ * becomes available after ser_rx_ring_consume().
+ *
+ * @param[in] ring The queue.
+ * @param[out] ptr Where to read data from.
+ *
+ * @return The number of bytes which can be read at ptr.
+ *
+ * @private
+ */
+SR_PRIV size_t ser_rx_ring_read_span(struct ser_rx_ring *ring,
+	const uint8_t **ptr)
+{
+	size_t pos, len;
+
+	pos = (guint)g_atomic_int_get(&ring->tail) & (ring->size - 1);
+	len = ser_rx_ring_used(ring);
+	*ptr = &ring->data[pos];
+
+	return MIN(len, ring->size - pos);
+}
+
+/**
+ * Release data of an RX data queue, after it was read from the span
+ * from ser_rx_ring_read_span(). Internal to the serial subsystem.
+ *
+ * @param[in] ring The queue.
+ * @param[in] len The number of bytes which got read.
+ *
+ * @private
+ */
+SR_PRIV void ser_rx_ring_consume(struct ser_rx_ring *ring, size_t len)
+{
+	guint tail;
+
+	tail = g_atomic_int_get(&ring->tail);
+	g_atomic_int_set(&ring->tail, (gint)(tail + len));
+}
+
 /**
  * Discard previously queued RX data. Internal to the serial subsystem,
  * coordination between common and transport specific support code.
@@ -287,7 +436,8 @@ SR_PRIV void sr_ser_discard_queued_data(struct sr_serial_dev_inst *serial)
 	if (!serial || !serial->rcv_buffer)
 		return;
 
-	g_string_truncate(serial->rcv_buffer, 0);
+	ser_rx_ring_consume(serial->rcv_buffer,
+		ser_rx_ring_used(serial->rcv_buffer));
 }
 
 /**
@@ -303,13 +453,15 @@ SR_PRIV size_t sr_ser_has_queued_data(struct sr_serial_dev_inst *serial)
 	if (!serial || !serial->rcv_buffer)
 		return 0;
 
-	return serial->rcv_buffer->len;
+	return ser_rx_ring_used(serial->rcv_buffer);
 }
 
 /**
  * Queue received data. Internal to the serial subsystem, coordination
  * between common and transport specific support code.
  *
+ * Data which does not fit the queue gets dropped.
+ *
  * @param[in] serial Previously opened serial port instance.
  * @param[in] data Pointer to data bytes to queue.
  * @param[in] len Number of data bytes to queue.
@@ -319,13 +471,31 @@ SR_PRIV size_t sr_ser_has_queued_data(struct sr_serial_dev_inst *serial)
 SR_PRIV void sr_ser_queue_rx_data(struct sr_serial_dev_inst *serial,
 	const uint8_t *data, size_t len)
 {
+	uint8_t *span;
+	size_t count;
+
 	if (!serial || !data || !len)
 		return;
 
-	if (serial->rx_chunk_cb_func)
+	if (serial->rx_chunk_cb_func) {
 		serial->rx_chunk_cb_func(serial, serial->rx_chunk_cb_data, data, len);
-	else if (serial->rcv_buffer)
-		g_string_append_len(serial->rcv_buffer, (const gchar *)data, len);
+		return;
+	}
+	if (!serial->rcv_buffer)
+		return;
+
+	while (len) {
+		count = ser_rx_ring_write_span(serial->rcv_buffer, &span);
+		if (!count) {
+			sr_warn("RX queue overflow, dropping %zu bytes.", len);
+			return;
+		}
+		count = MIN(count, len);
+		memcpy(span, data, count);
+		ser_rx_ring_commit(serial->rcv_buffer, count);
+		data += count;
+		len -= count;
+	}
 }
 
 /**
@@ -341,25 +511,24 @@ SR_PRIV void sr_ser_queue_rx_data(struct sr_serial_dev_inst *serial,
 SR_PRIV size_t sr_ser_unqueue_rx_data(struct sr_serial_dev_inst *serial,
 	uint8_t *data, size_t len)
 {
-	size_t qlen;
-	GString *buf;
+	const uint8_t *span;
+	size_t count, got;
 
-	if (!serial || !data || !len)
+	if (!serial || !data || !len || !serial->rcv_buffer)
 		return 0;
 
-	qlen = sr_ser_has_queued_data(serial);
-	if (!qlen)
-		return 0;
-
-	buf = serial->rcv_buffer;
-	if (len > buf->len)
-		len = buf->len;
-	if (len) {
-		memcpy(data, buf->str, len);
-		g_string_erase(buf, 0, len);
+	got = 0;
+	while (got < len) {
+		count = ser_rx_ring_read_span(serial->rcv_buffer, &span);
+		if (!count)
+			break;
+		count = MIN(count, len - got);
+		memcpy(&data[got], span, count);
+		ser_rx_ring_consume(serial->rcv_buffer, count);
+		got += count;
 	}
 
-	return len;
+	return got;
 }
 
 /**
@@ -385,11 +554,41 @@ SR_PRIV size_t serial_has_receive_data(struct sr_serial_dev_inst *serial)
 	if (serial->lib_funcs && serial->lib_funcs->get_rx_avail)
 		lib_count = serial->lib_funcs->get_rx_avail(serial);
 
-	buf_count = sr_ser_has_queued_data(serial);
+	buf_count = sr_ser_has_queued_data(serial) + serial->line_len;
 
 	return lib_count + buf_count;
 }
 
+/**
+ * Wait for receive data to become available.
+ *
+ * @param[in] serial Previously opened serial port instance.
+ * @param[in] timeout_ms The longest time to wait.
+ *
+ * @returns 1 when receive data is available, 0 when the time ran out,
+ * SR_ERR upon failure.
+ *
+ * Serial libraries without support for waiting sleep no longer than
+ * a millisecond, and return 0. Callers check for data then, as before.
+ *
+ * @private
+ */
+SR_PRIV int serial_wait_receive_data(struct sr_serial_dev_inst *serial,
+	unsigned int timeout_ms)
+{
+	if (!serial)
+		return SR_ERR;
+
+	if (sr_ser_has_queued_data(serial) || serial->line_len)
+		return 1;
+	if (serial->lib_funcs && serial->lib_funcs->wait_rx)
+		return serial->lib_funcs->wait_rx(serial, timeout_ms);
+
+	g_usleep(MIN(timeout_ms, 1) * 1000);
+
+	return 0;
+}
+
 static int _serial_write(struct sr_serial_dev_inst *serial,
 	const void *buf, size_t count,
 	int nonblocking, unsigned int timeout_ms)
@@ -450,16 +649,11 @@ SR_PRIV int serial_write_nonblocking(struct sr_serial_dev_inst *serial,
 	return _serial_write(serial, buf, count, 1, 0);
 }
 
-static int _serial_read(struct sr_serial_dev_inst *serial,
+static int serial_lib_read(struct sr_serial_dev_inst *serial,
 	void *buf, size_t count, int nonblocking, unsigned int timeout_ms)
 {
 	ssize_t ret;
 
-	if (!serial) {
-		sr_dbg("Invalid serial port.");
-		return SR_ERR;
-	}
-
 	if (!serial->lib_funcs || !serial->lib_funcs->read)
 		return SR_ERR_NA;
 	ret = serial->lib_funcs->read(serial, buf, count,
@@ -470,6 +664,45 @@ static int _serial_read(struct sr_serial_dev_inst *serial,
 	return ret;
 }
 
+/* Take data from the line buffer of serial_readline(). */
+static size_t serial_line_take(struct sr_serial_dev_inst *serial,
+	void *buf, size_t count)
+{
+	count = MIN(count, serial->line_len);
+	if (!count)
+		return 0;
+
+	memcpy(buf, serial->line_buf, count);
+	serial->line_len -= count;
+	memmove(serial->line_buf, &serial->line_buf[count], serial->line_len);
+
+	return count;
+}
+
+static int _serial_read(struct sr_serial_dev_inst *serial,
+	void *buf, size_t count, int nonblocking, unsigned int timeout_ms)
+{
+	size_t got;
+	int ret;
+
+	if (!serial) {
+		sr_dbg("Invalid serial port.");
+		return SR_ERR;
+	}
+
+	/* Data which serial_readline() received ahead comes first. */
+	got = serial_line_take(serial, buf, count);
+	if (got == count || (got && nonblocking))
+		return got;
+
+	ret = serial_lib_read(serial, (uint8_t *)buf + got, count - got,
+		nonblocking, timeout_ms);
+	if (ret < 0)
+		return got ? (int)got : ret;
+
+	return got + ret;
+}
+
 /**
  * Read a number of bytes from the specified serial port, block until finished.
  *
@@ -719,6 +952,11 @@ SR_PRIV int serial_set_paramstr(struct sr_serial_dev_inst *serial,
 			flow, rts, dtr);
 }
 
+/** @cond PRIVATE */
+/* Amount of data which serial_readline() reads ahead at most. */
+#define SERIAL_LINE_CHUNK_SIZE 256
+/** @endcond */
+
 /**
  * Read a line from the specified serial port.
  *
@@ -729,6 +967,9 @@ SR_PRIV int serial_set_paramstr(struct sr_serial_dev_inst *serial,
  *
  * Reading stops when CR or LF is found, which is stripped from the buffer.
  *
+ * Data gets read in chunks of what is available. Data past the line
+ * is kept for the next call, and for other reads from the port.
+ *
  * @retval SR_OK Success.
  * @retval SR_ERR Failure.
  *
@@ -738,7 +979,10 @@ SR_PRIV int serial_readline(struct sr_serial_dev_inst *serial,
 	char **buf, int *buflen, gint64 timeout_ms)
 {
 	gint64 start, remaining;
-	int maxlen, len;
+	int maxlen, len, ret;
+	uint8_t *cr, *lf, *end;
+	size_t count;
+	gboolean timed_out;
 
 	if (!serial) {
 		sr_dbg("Invalid serial port.");
@@ -750,33 +994,65 @@ SR_PRIV int serial_readline(struct sr_serial_dev_inst *serial,
 		return -1;
 	}
 
+	if (!serial->line_buf)
+		serial->line_buf = g_malloc(SERIAL_LINE_CHUNK_SIZE);
+
 	start = g_get_monotonic_time();
 	remaining = timeout_ms;
 
 	maxlen = *buflen;
-	*buflen = len = 0;
+	*buflen = 0;
+	timed_out = FALSE;
+	if (maxlen > 0)
+		**buf = '\0';
 	while (1) {
 		len = maxlen - *buflen - 1;
 		if (len < 1)
 			break;
-		len = serial_read_blocking(serial, *buf + *buflen, 1, remaining);
-		if (len > 0) {
-			*buflen += len;
-			*(*buf + *buflen) = '\0';
-			if (*buflen > 0 && (*(*buf + *buflen - 1) == '\r'
-					|| *(*buf + *buflen - 1) == '\n')) {
-				/* Strip CR/LF and terminate. */
-				*(*buf + --*buflen) = '\0';
-				break;
-			}
+
+		/* Take buffered data up to the first CR or LF. */
+		cr = memchr(serial->line_buf, '\r', serial->line_len);
+		lf = memchr(serial->line_buf, '\n', serial->line_len);
+		end = (cr && (!lf || cr < lf)) ? cr : lf;
+		count = end ? (size_t)(end - serial->line_buf) : serial->line_len;
+		if (count > (size_t)len) {
+			end = NULL;
+			count = len;
+		}
+		serial_line_take(serial, *buf + *buflen, count);
+		*buflen += count;
+		*(*buf + *buflen) = '\0';
+		if (end) {
+			/* Strip CR/LF. */
+			serial->line_len--;
+			memmove(serial->line_buf, &serial->line_buf[1],
+				serial->line_len);
+			break;
+		}
+		if (timed_out)
+			break;
+		if (count)
+			continue;
+
+		/* Wait for data, then take all that is available. */
+		ret = serial_lib_read(serial, serial->line_buf, 1, 0, remaining);
+		if (ret > 0) {
+			serial->line_len = ret;
+			ret = serial_lib_read(serial, &serial->line_buf[1],
+				SERIAL_LINE_CHUNK_SIZE - 1, 1, 0);
+			if (ret > 0)
+				serial->line_len += ret;
 		}
 		/* Reduce timeout by time elapsed. */
 		remaining = timeout_ms - ((g_get_monotonic_time() - start) / 1000);
-		if (remaining <= 0)
-			/* Timeout */
-			break;
-		if (len < 1)
+		if (remaining <= 0) {
+			/* Timeout, take what was received. */
+			if (!serial->line_len)
+				break;
+			timed_out = TRUE;
+		} else if (!serial->line_len) {
 			g_usleep(2000);
+		}
 	}
 	if (*buflen)
 		sr_dbg("Received %d: '%s'.", *buflen, *buf);
@@ -367,7 +367,7 @@ static int ser_bt_open(struct sr_serial_dev_inst *serial, int flags)
 
 	/* Make sure the receive buffer can accept input data. */
 	if (!serial->rcv_buffer)
-		serial->rcv_buffer = g_string_sized_new(SER_BT_CHUNK_SIZE);
+		serial->rcv_buffer = ser_rx_ring_new(SER_RX_RING_SIZE);
 	rc = sr_bt_config_cb_data(desc, ser_bt_data_cb, serial);
 	if (rc < 0)
 		return SR_ERR;
@@ -576,10 +576,13 @@ struct bt_source_args_t {
 	void *cb_data;
 	/* The serial device, to store RX data. */
 	struct sr_serial_dev_inst *serial;
+	/* The BT socket which the source polls, -1 for timer sources. */
+	int fd;
 };
 
 /*
- * Gets periodically invoked by the glib main loop. "Drives" (checks)
+ * Gets invoked by the glib main loop when the BT socket has data, and
+ * periodically (for timeouts). "Drives" (checks)
  * progress of BT communication, and invokes the application's callback
  * which processes RX data (when some has become available), as well as
  * handles application level timeouts.
@@ -649,7 +652,6 @@ static int bt_source_cb(int fd, int revents, void *cb_data)
 	return rc;
 }
 
-/* TODO Can we use the Bluetooth socket's file descriptor? Probably not portably. */
 #define WITH_MAXIMUM_TIMEOUT_VALUE	0
 static int ser_bt_setup_source_add(struct sr_session *session,
 		struct sr_serial_dev_inst *serial,
@@ -657,9 +659,7 @@ static int ser_bt_setup_source_add(struct sr_session *session,
 		sr_receive_data_callback cb, void *cb_data)
 {
 	struct bt_source_args_t *args;
-	int rc;
-
-	(void)events;
+	int fd, rc;
 
 	/* Optionally enforce a minimum poll period. */
 	if (WITH_MAXIMUM_TIMEOUT_VALUE && timeout > WITH_MAXIMUM_TIMEOUT_VALUE)
@@ -672,12 +672,18 @@ static int ser_bt_setup_source_add(struct sr_session *session,
 	args->serial = serial;
 
 	/*
-	 * Have a periodic timer installed. Register the allocated block
-	 * with the serial device, since the GSource's finalizer won't
-	 * free the memory, and we haven't bothered to create a custom
-	 * BT specific GSource.
+	 * Poll the BT socket, so that received data wakes up the main loop
+	 * instead of waiting for the next timer period. The timeout still
+	 * runs the callback periodically. Fall back to a timer alone when
+	 * there is no socket. Register the allocated block with the serial
+	 * device, since the GSource's finalizer won't free the memory, and
+	 * we haven't bothered to create a custom BT specific GSource.
 	 */
-	rc = sr_session_source_add(session, -1, events, timeout, bt_source_cb, args);
+	fd = sr_bt_get_fd(serial->bt_desc);
+	if (fd >= 0)
+		events = G_IO_IN | G_IO_ERR;
+	args->fd = fd;
+	rc = sr_session_source_add(session, fd, events, timeout, bt_source_cb, args);
 	if (rc != SR_OK) {
 		g_free(args);
 		return rc;
@@ -690,9 +696,16 @@ static int ser_bt_setup_source_add(struct sr_session *session,
 static int ser_bt_setup_source_remove(struct sr_session *session,
 		struct sr_serial_dev_inst *serial)
 {
-	(void)serial;
+	struct bt_source_args_t *args;
+	int fd;
 
-	(void)sr_session_source_remove(session, -1);
+	/* Remove the source with the key that ser_bt_setup_source_add() used. */
+	fd = -1;
+	if (serial->bt_source_args) {
+		args = serial->bt_source_args->data;
+		fd = args->fd;
+	}
+	(void)sr_session_source_remove(session, fd);
 	/* Release callback args here already? */
 
 	return SR_OK;
@@ -402,6 +402,109 @@ static void ser_hid_hidapi_close_dev(struct sr_serial_dev_inst *serial)
 	serial->hid_source_args = NULL;
 }
 
+/*
+ * Put received data into the RX queue. The RX thread is the queue's only
+ * producer then, the main thread only consumes. This bypasses the chunk
+ * callback, which must run in the main thread (see hidapi_source_cb()).
+ */
+static void hid_rx_queue(struct sr_serial_dev_inst *serial,
+	const uint8_t *data, size_t len)
+{
+	uint8_t *span;
+	size_t count;
+
+	while (len) {
+		count = ser_rx_ring_write_span(serial->rcv_buffer, &span);
+		if (!count) {
+			sr_warn("RX queue overflow, dropping %zu bytes.", len);
+			return;
+		}
+		count = MIN(count, len);
+		memcpy(span, data, count);
+		ser_rx_ring_commit(serial->rcv_buffer, count);
+		data += count;
+		len -= count;
+	}
+}
+
+/*
+ * Keep collecting the chip's reports while the port is open. Cheap
+ * HID cables have tiny FIFOs (if any), and hidapi only holds a few
+ * reports. Reading them from the main loop loses data when the loop
+ * is busy with other devices.
+ */
+static gpointer hid_rx_thread_func(gpointer data)
+{
+	struct sr_serial_dev_inst *serial;
+	uint8_t rx_buf[SER_HID_CHUNK_SIZE];
+	int rc;
+
+	serial = data;
+	while (g_atomic_int_get(&serial->hid_rx_running)) {
+		g_mutex_lock(&serial->hid_io_mutex);
+		rc = serial->hid_chip_funcs->read_bytes(serial,
+				rx_buf, sizeof(rx_buf), SER_HID_RX_POLL_MS);
+		g_mutex_unlock(&serial->hid_io_mutex);
+		if (rc < 0) {
+			sr_dbg("RX thread read error %d, stopping.", rc);
+			g_mutex_lock(&serial->hid_rx_mutex);
+			g_atomic_int_set(&serial->hid_rx_error, 1);
+			g_cond_broadcast(&serial->hid_rx_cond);
+			g_mutex_unlock(&serial->hid_rx_mutex);
+			break;
+		}
+		if (!rc)
+			continue;
+		ser_hid_mask_databits(serial, rx_buf, rc);
+		g_mutex_lock(&serial->hid_rx_mutex);
+		hid_rx_queue(serial, rx_buf, rc);
+		g_cond_broadcast(&serial->hid_rx_cond);
+		g_mutex_unlock(&serial->hid_rx_mutex);
+	}
+
+	return NULL;
+}
+
+static void ser_hid_rx_thread_start(struct sr_serial_dev_inst *serial)
+{
+	GError *error;
+
+	if (!serial->hid_chip_funcs || !serial->hid_chip_funcs->read_bytes)
+		return;
+
+	g_mutex_init(&serial->hid_io_mutex);
+	g_mutex_init(&serial->hid_rx_mutex);
+	g_cond_init(&serial->hid_rx_cond);
+	serial->hid_rx_error = 0;
+	serial->hid_rx_running = 1;
+
+	error = NULL;
+	serial->hid_rx_thread = g_thread_try_new("serial-hid-rx",
+			hid_rx_thread_func, serial, &error);
+	if (!serial->hid_rx_thread) {
+		/* Reads from the caller's thread still work. */
+		sr_dbg("Cannot start the RX thread: %s.", error->message);
+		g_error_free(error);
+		serial->hid_rx_running = 0;
+		g_mutex_clear(&serial->hid_io_mutex);
+		g_mutex_clear(&serial->hid_rx_mutex);
+		g_cond_clear(&serial->hid_rx_cond);
+	}
+}
+
+static void ser_hid_rx_thread_stop(struct sr_serial_dev_inst *serial)
+{
+	if (!serial->hid_rx_thread)
+		return;
+
+	g_atomic_int_set(&serial->hid_rx_running, 0);
+	g_thread_join(serial->hid_rx_thread);
+	serial->hid_rx_thread = NULL;
+	g_mutex_clear(&serial->hid_io_mutex);
+	g_mutex_clear(&serial->hid_rx_mutex);
+	g_cond_clear(&serial->hid_rx_cond);
+}
+
 struct hidapi_source_args_t {
 	/* Application callback. */
 	sr_receive_data_callback cb;
@@ -419,10 +522,26 @@ struct hidapi_source_args_t {
 static int hidapi_source_cb(int fd, int revents, void *cb_data)
 {
 	struct hidapi_source_args_t *args;
+	struct sr_serial_dev_inst *serial;
 	uint8_t rx_buf[SER_HID_CHUNK_SIZE];
+	size_t len;
 	int rc;
 
 	args = cb_data;
+	serial = args->serial;
+
+	/*
+	 * The RX thread has queued what the chip received. Pass it to the
+	 * chunk callback from here, in the main thread.
+	 */
+	if (serial->hid_rx_thread) {
+		while (serial->rx_chunk_cb_func && sr_ser_has_queued_data(serial)) {
+			len = sr_ser_unqueue_rx_data(serial, rx_buf, sizeof(rx_buf));
+			serial->rx_chunk_cb_func(serial, serial->rx_chunk_cb_data,
+				rx_buf, len);
+		}
+		goto check_queue;
+	}
 
 	/*
 	 * Drain receive data which the chip might have pending. This is
@@ -439,6 +558,7 @@ static int hidapi_source_cb(int fd, int revents, void *cb_data)
 		}
 	} while (rc > 0);
 
+check_queue:
 	/*
 	 * When RX data became available (now or earlier), pass this
 	 * condition to the application callback. Always periodically
@@ -1114,30 +1234,52 @@ static int ser_hid_open(struct sr_serial_dev_inst *serial, int flags)
 	}
 
 	if (!serial->rcv_buffer)
-		serial->rcv_buffer = g_string_sized_new(SER_HID_CHUNK_SIZE);
+		serial->rcv_buffer = ser_rx_ring_new(SER_RX_RING_SIZE);
+
+	ser_hid_rx_thread_start(serial);
 
 	return SR_OK;
 }
 
 static int ser_hid_close(struct sr_serial_dev_inst *serial)
 {
+	ser_hid_rx_thread_stop(serial);
 	ser_hid_hidapi_close_dev(serial);
 
 	return SR_OK;
 }
 
+/* Chip requests could read reports, keep the RX thread from taking them. */
+static void ser_hid_io_lock(struct sr_serial_dev_inst *serial)
+{
+	if (serial->hid_rx_thread)
+		g_mutex_lock(&serial->hid_io_mutex);
+}
+
+static void ser_hid_io_unlock(struct sr_serial_dev_inst *serial)
+{
+	if (serial->hid_rx_thread)
+		g_mutex_unlock(&serial->hid_io_mutex);
+}
+
 static int ser_hid_set_params(struct sr_serial_dev_inst *serial,
 	int baudrate, int bits, int parity, int stopbits,
 	int flowcontrol, int rts, int dtr)
 {
+	int rc;
+
 	if (ser_hid_setup_funcs(serial) != 0)
 		return SR_ERR_NA;
 	if (!serial->hid_chip_funcs || !serial->hid_chip_funcs->set_params)
 		return SR_ERR_NA;
 
-	return serial->hid_chip_funcs->set_params(serial,
+	ser_hid_io_lock(serial);
+	rc = serial->hid_chip_funcs->set_params(serial,
 		baudrate, bits, parity, stopbits,
 		flowcontrol, rts, dtr);
+	ser_hid_io_unlock(serial);
+
+	return rc;
 }
 
 static int ser_hid_setup_source_add(struct sr_session *session,
@@ -1167,18 +1309,30 @@ static GSList *ser_hid_find_usb(GSList *list, sr_ser_find_append_t append,
 
 static int ser_hid_flush(struct sr_serial_dev_inst *serial)
 {
+	int rc;
+
 	if (!serial->hid_chip_funcs || !serial->hid_chip_funcs->flush)
 		return SR_ERR_NA;
 
-	return serial->hid_chip_funcs->flush(serial);
+	ser_hid_io_lock(serial);
+	rc = serial->hid_chip_funcs->flush(serial);
+	ser_hid_io_unlock(serial);
+
+	return rc;
 }
 
 static int ser_hid_drain(struct sr_serial_dev_inst *serial)
 {
+	int rc;
+
 	if (!serial->hid_chip_funcs || !serial->hid_chip_funcs->drain)
 		return SR_ERR_NA;
 
-	return serial->hid_chip_funcs->drain(serial);
+	ser_hid_io_lock(serial);
+	rc = serial->hid_chip_funcs->drain(serial);
+	ser_hid_io_unlock(serial);
+
+	return rc;
 }
 
 static int ser_hid_write(struct sr_serial_dev_inst *serial,
@@ -1225,6 +1379,37 @@ static int ser_hid_write(struct sr_serial_dev_inst *serial,
 	return total;
 }
 
+/* Wait for the RX thread to queue the caller's data. */
+static int ser_hid_read_queued(struct sr_serial_dev_inst *serial,
+	void *buf, size_t count,
+	int nonblocking, unsigned int timeout_ms)
+{
+	gint64 deadline_us;
+	size_t got;
+
+	deadline_us = 0;
+	if (timeout_ms)
+		deadline_us = g_get_monotonic_time() + timeout_ms * 1000;
+
+	g_mutex_lock(&serial->hid_rx_mutex);
+	while (sr_ser_has_queued_data(serial) < count) {
+		if (nonblocking || g_atomic_int_get(&serial->hid_rx_error))
+			break;
+		if (!deadline_us)
+			g_cond_wait(&serial->hid_rx_cond, &serial->hid_rx_mutex);
+		else if (!g_cond_wait_until(&serial->hid_rx_cond,
+				&serial->hid_rx_mutex, deadline_us))
+			break;
+	}
+	g_mutex_unlock(&serial->hid_rx_mutex);
+
+	got = MIN(sr_ser_has_queued_data(serial), count);
+	if (!got && g_atomic_int_get(&serial->hid_rx_error))
+		return SR_ERR;
+
+	return sr_ser_unqueue_rx_data(serial, buf, got);
+}
+
 static int ser_hid_read(struct sr_serial_dev_inst *serial,
 	void *buf, size_t count,
 	int nonblocking, unsigned int timeout_ms)
@@ -1246,6 +1431,10 @@ static int ser_hid_read(struct sr_serial_dev_inst *serial,
 	if (sr_ser_has_queued_data(serial) >= count)
 		return sr_ser_unqueue_rx_data(serial, buf, count);
 
+	if (serial->hid_rx_thread)
+		return ser_hid_read_queued(serial, buf, count,
+			nonblocking, timeout_ms);
+
 	/*
 	 * When a timeout was specified, then determine the deadline
 	 * where to stop reception.
@@ -38,6 +38,12 @@
  */
 #define SER_HID_CHUNK_SIZE	64
 
+/*
+ * The timeout of the RX thread's reads, in milliseconds. Bounds how long
+ * chip requests wait for the thread, and how long closing the port takes.
+ */
+#define SER_HID_RX_POLL_MS	20
+
 /*
  * Routines to get/set reports/data, provided by serial_hid.c and used
  * in serial_hid_<chip>.c files.
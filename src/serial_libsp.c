@@ -517,6 +517,30 @@ static size_t sr_ser_libsp_get_rx_avail(struct sr_serial_dev_inst *serial)
 	return rc;
 }
 
+static int sr_ser_libsp_wait_rx(struct sr_serial_dev_inst *serial,
+	unsigned int timeout_ms)
+{
+	struct sp_event_set *event_set;
+	enum sp_return ret;
+
+	if (!serial->sp_data)
+		return SR_ERR;
+	if (sp_input_waiting(serial->sp_data) > 0)
+		return 1;
+
+	if (sp_new_event_set(&event_set) != SP_OK)
+		return SR_ERR;
+	ret = sp_add_port_events(event_set, serial->sp_data,
+		SP_EVENT_RX_READY | SP_EVENT_ERROR);
+	if (ret == SP_OK)
+		ret = sp_wait(event_set, timeout_ms ? timeout_ms : 1);
+	sp_free_event_set(event_set);
+	if (ret != SP_OK)
+		return SR_ERR;
+
+	return sp_input_waiting(serial->sp_data) > 0;
+}
+
 static struct ser_lib_functions serlib_sp = {
 	.open = sr_ser_libsp_open,
 	.close = sr_ser_libsp_close,
@@ -532,6 +556,7 @@ static struct ser_lib_functions serlib_sp = {
 	.find_usb = sr_ser_libsp_find_usb,
 	.get_frame_format = sr_ser_libsp_get_frame_format,
 	.get_rx_avail = sr_ser_libsp_get_rx_avail,
+	.wait_rx = sr_ser_libsp_wait_rx,
 };
 SR_PRIV struct ser_lib_functions *ser_lib_funcs_libsp = &serlib_sp;
 
@@ -25,6 +25,9 @@
 #include <unistd.h>
 #include <string.h>
 #include <glib.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
@@ -46,9 +49,62 @@
  * @{
  */
 
+/*
+ * A datafeed packet shared between the consumer queues of threaded
+ * dispatch. The item holds a reference to the packet, which gets
+ * dropped when the last consumer is done with it.
+ */
+struct datafeed_item {
+	gint refcount;
+	const struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet *packet;
+};
+
+/*
+ * Receive time, sample positions and clock estimate of a device's data
+ * packets. They get updated when the device sends a packet.
+ */
+struct sr_dev_packet_clock {
+	int64_t receive_us;
+	uint64_t logic_pos;
+	/* Samples sent per analog channel, by channel index. */
+	GArray *analog_pos;
+	/* Nominal samplerate from the device's meta packets, 0 if unknown. */
+	uint64_t samplerate;
+	/*
+	 * Least squares fit of the host times over the sample positions at
+	 * which the packets of one stream end (logic data, or the analog
+	 * data of one channel), relative to the first of them. Updated
+	 * with the session's stats mutex held.
+	 */
+	gboolean fit_started;
+	int fit_stream;
+	uint64_t fit_x0;
+	int64_t fit_y0;
+	double fit_n, fit_mean_x, fit_mean_y, fit_m2x, fit_cxy;
+	/* Aligned time at which the last data packet ended, 0 if none. */
+	int64_t aligned_end_us;
+};
+
 struct datafeed_callback {
 	sr_datafeed_callback cb;
 	void *cb_data;
+	/* Subscription: packet types (SR_DF_TYPE_MASK()) and channels. */
+	uint32_t type_mask;
+	GSList *channels;
+
+	/* Consumer thread and its queue, used for threaded dispatch only. */
+	struct sr_session *session;
+	GThread *thread;
+	GMutex mutex;
+	GCond cond;
+	struct datafeed_item **queue;
+	size_t queue_size, queue_head, queue_count;
+	gboolean quit;
+	uint64_t dropped;
+
+	/* Timing statistics, protected by the session's stats mutex. */
+	struct sr_session_stage_stats stats;
 };
 
 /** Custom GLib event source for generic descriptor I/O.
@@ -65,8 +121,207 @@ struct fd_source {
 	void *key;
 
 	GPollFD pollfd;
+	/* Multiplexer which polls the descriptor, NULL if GLib does. */
+	struct fd_mux *mux;
+};
+
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * Multiplexer for the descriptors of a session's fd sources.
+ *
+ * GLib polls every descriptor of every source in each iteration of the
+ * main loop, so with many devices the loop's cost grows with their
+ * number. When enabled, the fd sources which run in the session's main
+ * context register their descriptors with one epoll instance instead.
+ * GLib only polls that, and the multiplexer hands the events to the fd
+ * sources which are ready, which then get dispatched as usual.
+ *
+ * The multiplexer lives as long as it has fd sources. Registration and
+ * event delivery are protected by the session's main mutex.
+ */
+#define FD_MUX_MAX_EVENTS	64
+
+struct fd_mux {
+	GSource base;
+
+	struct sr_session *session;
+	GPollFD pollfd;
+	unsigned int num_fds;
 };
 
+static gboolean fd_mux_prepare(GSource *source, int *timeout)
+{
+	(void)source;
+
+	*timeout = -1;
+
+	return FALSE;
+}
+
+static gboolean fd_mux_check(GSource *source)
+{
+	return ((struct fd_mux *)source)->pollfd.revents != 0;
+}
+
+/*
+ * Pass the events on to the fd sources, which pick them up when the
+ * main loop prepares its next iteration.
+ */
+static gboolean fd_mux_dispatch(GSource *source,
+		GSourceFunc callback, void *user_data)
+{
+	struct fd_mux *mux;
+	struct fd_source *fsource;
+	struct epoll_event events[FD_MUX_MAX_EVENTS];
+	int i, num_events;
+
+	(void)callback;
+	(void)user_data;
+
+	mux = (struct fd_mux *)source;
+
+	g_mutex_lock(&mux->session->main_mutex);
+	num_events = epoll_wait(mux->pollfd.fd, events, G_N_ELEMENTS(events), 0);
+	if (num_events < 0 && errno != EINTR)
+		sr_err("Failed to wait for events: %s", g_strerror(errno));
+	for (i = 0; i < num_events; i++) {
+		fsource = events[i].data.ptr;
+		fsource->pollfd.revents |= events[i].events
+			& (EPOLLIN | EPOLLPRI | EPOLLOUT | EPOLLERR | EPOLLHUP);
+	}
+	g_mutex_unlock(&mux->session->main_mutex);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void fd_mux_finalize(GSource *source)
+{
+	close(((struct fd_mux *)source)->pollfd.fd);
+}
+
+static gboolean fd_mux_wanted(void)
+{
+	const char *env;
+
+	env = g_getenv("SIGROK_SESSION_EPOLL");
+
+	return env && *env && strcmp(env, "0") != 0;
+}
+
+/* Must be called with the session's main mutex held. */
+static struct fd_mux *fd_mux_get(struct sr_session *session)
+{
+	static GSourceFuncs fd_mux_funcs = {
+		.prepare  = &fd_mux_prepare,
+		.check    = &fd_mux_check,
+		.dispatch = &fd_mux_dispatch,
+		.finalize = &fd_mux_finalize
+	};
+	GSource *source;
+	struct fd_mux *mux;
+	int epfd;
+
+	if (session->fd_mux)
+		return session->fd_mux;
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0) {
+		sr_warn("Failed to create epoll instance: %s",
+			g_strerror(errno));
+		return NULL;
+	}
+	source = g_source_new(&fd_mux_funcs, sizeof(struct fd_mux));
+	g_source_set_name(source, "fd-mux");
+	mux = (struct fd_mux *)source;
+	mux->session = session;
+	mux->pollfd.fd = epfd;
+	mux->pollfd.events = G_IO_IN;
+	g_source_add_poll(source, &mux->pollfd);
+	g_source_attach(source, session->main_context);
+	session->fd_mux = mux;
+
+	return mux;
+}
+
+/*
+ * Have the session's multiplexer poll the descriptor of an fd source.
+ * Sources which run in device worker threads, descriptors which epoll
+ * does not support (like regular files) and descriptors which another
+ * source already registered are left to GLib.
+ */
+static gboolean fd_mux_join(struct fd_source *fsource)
+{
+	struct sr_session *session;
+	struct fd_mux *mux;
+	struct epoll_event ev;
+	gboolean joined;
+
+	session = fsource->session;
+	if (!session->fd_mux_wanted)
+		return FALSE;
+
+	joined = FALSE;
+	g_mutex_lock(&session->main_mutex);
+	if (session->main_context && !session->dev_threads
+			&& (mux = fd_mux_get(session))) {
+		memset(&ev, 0, sizeof(ev));
+		ev.events = fsource->pollfd.events
+			& (EPOLLIN | EPOLLPRI | EPOLLOUT);
+		ev.data.ptr = fsource;
+		if (epoll_ctl(mux->pollfd.fd, EPOLL_CTL_ADD,
+				fsource->pollfd.fd, &ev) == 0) {
+			fsource->mux = mux;
+			mux->num_fds++;
+			joined = TRUE;
+		} else if (!mux->num_fds) {
+			session->fd_mux = NULL;
+			g_source_destroy(&mux->base);
+			g_source_unref(&mux->base);
+		}
+	}
+	g_mutex_unlock(&session->main_mutex);
+
+	return joined;
+}
+
+static void fd_mux_leave(struct fd_source *fsource)
+{
+	struct sr_session *session;
+	struct fd_mux *mux;
+
+	session = fsource->session;
+	mux = fsource->mux;
+
+	g_mutex_lock(&session->main_mutex);
+	/* Fails harmlessly when the descriptor has been closed already. */
+	epoll_ctl(mux->pollfd.fd, EPOLL_CTL_DEL, fsource->pollfd.fd, NULL);
+	fsource->mux = NULL;
+	if (--mux->num_fds == 0) {
+		session->fd_mux = NULL;
+		g_source_destroy(&mux->base);
+		g_source_unref(&mux->base);
+	}
+	g_mutex_unlock(&session->main_mutex);
+}
+#else
+static gboolean fd_mux_wanted(void)
+{
+	return FALSE;
+}
+
+static gboolean fd_mux_join(struct fd_source *fsource)
+{
+	(void)fsource;
+
+	return FALSE;
+}
+
+static void fd_mux_leave(struct fd_source *fsource)
+{
+	(void)fsource;
+}
+#endif
+
 /** FD event source prepare() method.
  * This is called immediately before poll().
  */
@@ -89,6 +344,9 @@ static gboolean fd_source_prepare(GSource *source, int *timeout)
 	} else {
 		remaining_ms = -1;
 	}
+	/* The multiplexer has delivered events. */
+	if (fsource->mux && fsource->pollfd.revents)
+		remaining_ms = 0;
 	*timeout = remaining_ms;
 
 	return (remaining_ms == 0);
@@ -126,6 +384,8 @@ static gboolean fd_source_dispatch(GSource *source,
 		sr_err("Callback not set, cannot dispatch event.");
 		return G_SOURCE_REMOVE;
 	}
+	if (fsource->mux)
+		fsource->pollfd.revents = 0;
 	keep = (*SR_RECEIVE_DATA_CALLBACK(callback))
 			(fsource->pollfd.fd, revents, user_data);
 
@@ -146,6 +406,8 @@ static void fd_source_finalize(GSource *source)
 
 	sr_dbg("%s: key %p", __func__, fsource->key);
 
+	if (fsource->mux)
+		fd_mux_leave(fsource);
 	sr_session_source_destroyed(fsource->session, fsource->key, source);
 }
 
@@ -193,7 +455,7 @@ static GSource *fd_source_new(struct sr_session *session, void *key,
 	fsource->pollfd.events = events;
 	fsource->pollfd.revents = 0;
 
-	if (fd >= 0)
+	if (fd >= 0 && !fd_mux_join(fsource))
 		g_source_add_poll(source, &fsource->pollfd);
 
 	return source;
@@ -223,8 +485,13 @@ SR_API int sr_session_new(struct sr_context *ctx,
 	session = g_malloc0(sizeof(struct sr_session));
 
 	session->ctx = ctx;
+	session->df_overflow = SR_DF_OVERFLOW_BLOCK;
+	session->fd_mux_wanted = fd_mux_wanted();
 
 	g_mutex_init(&session->main_mutex);
+	g_mutex_init(&session->stats_mutex);
+	g_rec_mutex_init(&session->send_mutex);
+	session->dev_stats = g_hash_table_new_full(NULL, NULL, NULL, g_free);
 
 	/* To maintain API compatibility, we need a lookup table
 	 * which maps poll_object IDs to GSource* pointers.
@@ -259,9 +526,14 @@ SR_API int sr_session_destroy(struct sr_session *session)
 
 	sr_session_datafeed_callback_remove_all(session);
 
+	if (session->coalesce_bufs)
+		g_hash_table_unref(session->coalesce_bufs);
 	g_hash_table_unref(session->event_sources);
+	g_hash_table_unref(session->dev_stats);
 
 	g_mutex_clear(&session->main_mutex);
+	g_mutex_clear(&session->stats_mutex);
+	g_rec_mutex_clear(&session->send_mutex);
 
 	g_free(session);
 
@@ -299,6 +571,10 @@ SR_API int sr_session_dev_remove_all(struct sr_session *session)
 	g_slist_free(session->devs);
 	session->devs = NULL;
 
+	g_mutex_lock(&session->stats_mutex);
+	g_hash_table_remove_all(session->dev_stats);
+	g_mutex_unlock(&session->stats_mutex);
+
 	return SR_OK;
 }
 
@@ -353,6 +629,7 @@ SR_API int sr_session_dev_add(struct sr_session *session,
 
 	session->devs = g_slist_append(session->devs, sdi);
 	sdi->session = session;
+	sdi->armed = FALSE;
 
 	/* TODO: This is invalid if the session runs in a different thread.
 	 * The usage semantics and restrictions need to be documented.
@@ -441,9 +718,302 @@ SR_API int sr_session_dev_remove(struct sr_session *session,
 	session->devs = g_slist_remove(session->devs, sdi);
 	sdi->session = NULL;
 
+	g_mutex_lock(&session->stats_mutex);
+	g_hash_table_remove(session->dev_stats, sdi);
+	g_mutex_unlock(&session->stats_mutex);
+
 	return SR_OK;
 }
 
+/* Size of the sample data in a logic or analog packet, 0 for others. */
+static uint64_t packet_data_size(const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_datafeed_logic_planar *planar;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		return logic->length;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		return (uint64_t)analog->num_samples * analog->encoding->unitsize;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		return rle->num_runs * (rle->unitsize + sizeof(rle->lengths[0]));
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet->payload;
+		return planar->stride * planar->unitsize * 8;
+	default:
+		return 0;
+	}
+}
+
+/* Get the latency histogram bin for a time span in us. */
+static unsigned int latency_bin(int64_t elapsed)
+{
+	unsigned int bin;
+
+	for (bin = 0; bin < SR_STATS_LATENCY_BINS - 1; bin++) {
+		if (!(elapsed >> bin))
+			break;
+	}
+
+	return bin;
+}
+
+/* Account a run of a datafeed stage which took @a elapsed us. */
+static void stage_stats_account(struct sr_session *session,
+		struct sr_session_stage_stats *stage,
+		const struct sr_datafeed_packet *packet, int64_t elapsed)
+{
+	unsigned int bin;
+
+	if (elapsed < 0)
+		elapsed = 0;
+	bin = latency_bin(elapsed);
+
+	g_mutex_lock(&session->stats_mutex);
+	stage->calls++;
+	stage->bytes += packet_data_size(packet);
+	stage->total_us += elapsed;
+	if ((uint64_t)elapsed > stage->max_us)
+		stage->max_us = elapsed;
+	stage->latency_hist[bin]++;
+	g_mutex_unlock(&session->stats_mutex);
+}
+
+static void stats_update(struct sr_session_stats *stats, unsigned int type,
+		uint64_t bytes, int64_t now)
+{
+	uint64_t gap;
+
+	if (stats->last_packet_us) {
+		gap = now - stats->last_packet_us;
+		if (gap > stats->max_gap_us)
+			stats->max_gap_us = gap;
+	} else {
+		stats->first_packet_us = now;
+	}
+	stats->last_packet_us = now;
+
+	if (type < SR_STATS_PACKET_TYPES) {
+		stats->packets[type]++;
+		stats->bytes[type] += bytes;
+	}
+
+	if (type == SR_DF_FRAME_BEGIN - SR_DF_HEADER) {
+		gap = now - stats->last_frame_us;
+		if (stats->frames && (!stats->min_frame_gap_us
+				|| gap < stats->min_frame_gap_us))
+			stats->min_frame_gap_us = gap;
+		stats->frames++;
+		stats->last_frame_us = now;
+	}
+}
+
+/* Look up the statistics of a device. Call with the stats mutex held. */
+static struct sr_session_stats *dev_stats_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi)
+{
+	struct sr_session_stats *dev_stats;
+
+	dev_stats = g_hash_table_lookup(session->dev_stats, sdi);
+	if (!dev_stats) {
+		dev_stats = g_malloc0(sizeof(*dev_stats));
+		g_hash_table_insert(session->dev_stats, (void *)sdi, dev_stats);
+	}
+
+	return dev_stats;
+}
+
+/* Account a packet which a device sent to the session. */
+static void session_stats_account(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	struct sr_session *session;
+	unsigned int type;
+	uint64_t bytes;
+	int64_t now;
+
+	session = sdi->session;
+	if (!g_atomic_int_get(&session->stats_enabled))
+		return;
+
+	type = packet->type - SR_DF_HEADER;
+	bytes = packet_data_size(packet);
+	now = g_get_monotonic_time();
+
+	g_mutex_lock(&session->stats_mutex);
+	stats_update(&session->stats, type, bytes, now);
+	stats_update(dev_stats_get(session, sdi), type, bytes, now);
+	g_mutex_unlock(&session->stats_mutex);
+}
+
+/* Account a packet which threaded dispatch dropped. */
+static void session_stats_dropped(struct sr_session *session,
+		const struct sr_dev_inst *sdi)
+{
+	g_mutex_lock(&session->stats_mutex);
+	session->stats.dropped_packets++;
+	dev_stats_get(session, sdi)->dropped_packets++;
+	g_mutex_unlock(&session->stats_mutex);
+}
+
+static void session_stats_reset(struct sr_session *session)
+{
+	struct sr_transform *t;
+	struct datafeed_callback *cb_struct;
+	GSList *l;
+
+	g_mutex_lock(&session->stats_mutex);
+	memset(&session->stats, 0, sizeof(session->stats));
+	g_hash_table_remove_all(session->dev_stats);
+	for (l = session->transforms; l; l = l->next) {
+		t = l->data;
+		memset(&t->stats, 0, sizeof(t->stats));
+	}
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		memset(&cb_struct->stats, 0, sizeof(cb_struct->stats));
+	}
+	g_mutex_unlock(&session->stats_mutex);
+}
+
+/* Invoke a datafeed callback, and account the time spent in it. */
+static void datafeed_callback_run(struct sr_session *session,
+		struct datafeed_callback *cb_struct,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	int64_t start;
+
+	sr_trace3(callback_entry, sdi, cb_struct, packet->type);
+	if (!g_atomic_int_get(&session->stats_enabled)) {
+		cb_struct->cb(sdi, packet, cb_struct->cb_data);
+	} else {
+		start = g_get_monotonic_time();
+		cb_struct->cb(sdi, packet, cb_struct->cb_data);
+		stage_stats_account(session, &cb_struct->stats, packet,
+			g_get_monotonic_time() - start);
+	}
+	sr_trace3(callback_return, sdi, cb_struct, packet->type);
+}
+
+static void datafeed_item_unref(struct datafeed_item *item)
+{
+	if (!g_atomic_int_dec_and_test(&item->refcount))
+		return;
+
+	sr_packet_unref(item->packet);
+	g_free(item);
+}
+
+/* Consumer thread of one datafeed callback in threaded dispatch mode. */
+static gpointer datafeed_thread(gpointer data)
+{
+	struct datafeed_callback *cb_struct;
+	struct datafeed_item *item;
+
+	cb_struct = data;
+	sr_thread_policy_apply(cb_struct->session->ctx, SR_THREAD_CONSUMER);
+
+	g_mutex_lock(&cb_struct->mutex);
+	while (TRUE) {
+		while (!cb_struct->queue_count && !cb_struct->quit)
+			g_cond_wait(&cb_struct->cond, &cb_struct->mutex);
+		/* Only terminate after the queue got drained. */
+		if (!cb_struct->queue_count)
+			break;
+		item = cb_struct->queue[cb_struct->queue_head];
+		cb_struct->queue_head++;
+		cb_struct->queue_head %= cb_struct->queue_size;
+		cb_struct->queue_count--;
+		g_cond_signal(&cb_struct->cond);
+		g_mutex_unlock(&cb_struct->mutex);
+
+		datafeed_callback_run(cb_struct->session, cb_struct,
+			item->sdi, item->packet);
+		datafeed_item_unref(item);
+
+		g_mutex_lock(&cb_struct->mutex);
+	}
+	g_mutex_unlock(&cb_struct->mutex);
+
+	return NULL;
+}
+
+static void datafeed_thread_start(struct sr_session *session,
+		struct datafeed_callback *cb_struct)
+{
+	if (cb_struct->thread || !session->df_queue_depth)
+		return;
+
+	cb_struct->session = session;
+	cb_struct->queue_size = session->df_queue_depth;
+	cb_struct->queue = g_malloc0(cb_struct->queue_size
+			* sizeof(cb_struct->queue[0]));
+	cb_struct->queue_head = 0;
+	cb_struct->queue_count = 0;
+	cb_struct->quit = FALSE;
+	cb_struct->dropped = 0;
+	cb_struct->thread = g_thread_new("sr-datafeed",
+			datafeed_thread, cb_struct);
+}
+
+static void datafeed_thread_stop(struct datafeed_callback *cb_struct)
+{
+	if (!cb_struct->thread)
+		return;
+
+	g_mutex_lock(&cb_struct->mutex);
+	cb_struct->quit = TRUE;
+	g_cond_broadcast(&cb_struct->cond);
+	g_mutex_unlock(&cb_struct->mutex);
+
+	g_thread_join(cb_struct->thread);
+	cb_struct->thread = NULL;
+
+	if (cb_struct->dropped)
+		sr_warn("Datafeed queue overflow, dropped %" PRIu64
+			" packets.", cb_struct->dropped);
+
+	g_free(cb_struct->queue);
+	cb_struct->queue = NULL;
+}
+
+static void datafeed_threads_start(struct sr_session *session)
+{
+	GSList *l;
+
+	session->df_failed = FALSE;
+	for (l = session->datafeed_callbacks; l; l = l->next)
+		datafeed_thread_start(session, l->data);
+}
+
+static void datafeed_threads_stop(struct sr_session *session)
+{
+	GSList *l;
+
+	for (l = session->datafeed_callbacks; l; l = l->next)
+		datafeed_thread_stop(l->data);
+}
+
+static void datafeed_callback_free(void *p)
+{
+	struct datafeed_callback *cb_struct;
+
+	cb_struct = p;
+
+	datafeed_thread_stop(cb_struct);
+	g_slist_free(cb_struct->channels);
+	g_mutex_clear(&cb_struct->mutex);
+	g_cond_clear(&cb_struct->cond);
+	g_free(cb_struct);
+}
+
 /**
  * Remove all datafeed callbacks in a session.
  *
@@ -461,7 +1031,7 @@ SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session)
 		return SR_ERR_ARG;
 	}
 
-	g_slist_free_full(session->datafeed_callbacks, g_free);
+	g_slist_free_full(session->datafeed_callbacks, datafeed_callback_free);
 	session->datafeed_callbacks = NULL;
 
 	return SR_OK;
@@ -482,6 +1052,39 @@ SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session)
  */
 SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 		sr_datafeed_callback cb, void *cb_data)
+{
+	return sr_session_datafeed_subscribe(session, cb, cb_data,
+			SR_DF_TYPE_MASK_ALL, NULL);
+}
+
+/**
+ * Add a datafeed callback with a subscription filter to a session.
+ *
+ * The callback only gets invoked for packets whose type is in
+ * @a type_mask. If @a channels is not NULL, logic and analog packets
+ * are additionally only delivered when they carry data of at least one
+ * of the listed channels. Non-matching packets are skipped before any
+ * other per-callback work is done.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param cb Function to call when a chunk of data is received.
+ *           Must not be NULL.
+ * @param cb_data Opaque pointer passed in by the caller.
+ * @param type_mask Bitwise OR of SR_DF_TYPE_MASK() values for the packet
+ *                  types to deliver, or SR_DF_TYPE_MASK_ALL.
+ * @param channels List of struct sr_channel pointers to filter logic and
+ *                 analog packets by, or NULL to not filter by channel.
+ *                 The list is copied, the channels are not.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_BUG No session exists.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_subscribe(struct sr_session *session,
+		sr_datafeed_callback cb, void *cb_data, uint32_t type_mask,
+		GSList *channels)
 {
 	struct datafeed_callback *cb_struct;
 
@@ -495,180 +1098,1349 @@ SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 		return SR_ERR_ARG;
 	}
 
+	if (!type_mask) {
+		sr_err("%s: type_mask was empty", __func__);
+		return SR_ERR_ARG;
+	}
+
 	cb_struct = g_malloc0(sizeof(struct datafeed_callback));
 	cb_struct->cb = cb;
 	cb_struct->cb_data = cb_data;
+	cb_struct->type_mask = type_mask;
+	cb_struct->channels = g_slist_copy(channels);
+	g_mutex_init(&cb_struct->mutex);
+	g_cond_init(&cb_struct->cond);
 
 	session->datafeed_callbacks =
 	    g_slist_append(session->datafeed_callbacks, cb_struct);
 
+	if (session->running)
+		datafeed_thread_start(session, cb_struct);
+
 	return SR_OK;
 }
 
 /**
- * Get the trigger assigned to this session.
+ * Configure threaded dispatch of datafeed packets.
  *
- * @param session The session to use.
+ * By default, datafeed callbacks are invoked synchronously from within
+ * the driver's sr_session_send() call, so that a slow callback stalls
+ * the acquisition. With threaded dispatch enabled, every datafeed
+ * callback gets a consumer thread of its own while the session runs,
+ * fed by a bounded queue of packets. The callbacks then execute in
+ * their consumer thread, and must not assume to run in the session's
+ * main context.
  *
- * @retval NULL Invalid (NULL) session was passed to the function.
- * @retval other The trigger assigned to this session (can be NULL).
+ * The @a overflow policy determines what happens to logic and analog
+ * packets when a callback's queue is full. Other packet types always
+ * wait for room in the queue, so that consumers see a consistent
+ * sequence of headers, frames and the end of the data feed.
  *
- * @since 0.4.0
+ * @param session The session to use. Must not be NULL.
+ * @param queue_depth Number of packets each callback's queue can hold,
+ *                    or 0 to dispatch synchronously (default).
+ * @param overflow Overflow policy (enum sr_datafeed_overflow).
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Session is running.
+ *
+ * @since 0.6.0
  */
-SR_API struct sr_trigger *sr_session_trigger_get(struct sr_session *session)
+SR_API int sr_session_datafeed_dispatch_set(struct sr_session *session,
+		size_t queue_depth, int overflow)
 {
-	if (!session)
-		return NULL;
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
 
-	return session->trigger;
+	switch (overflow) {
+	case SR_DF_OVERFLOW_BLOCK:
+	case SR_DF_OVERFLOW_DROP_NEWEST:
+	case SR_DF_OVERFLOW_FAIL_SESSION:
+		break;
+	default:
+		sr_err("%s: invalid overflow policy %d", __func__, overflow);
+		return SR_ERR_ARG;
+	}
+
+	if (session->running) {
+		sr_err("Cannot change datafeed dispatch while session is running.");
+		return SR_ERR;
+	}
+
+	session->df_queue_depth = queue_depth;
+	session->df_overflow = overflow;
+
+	return SR_OK;
 }
 
 /**
- * Set the trigger of this session.
+ * Configure coalescing of analog packets.
+ *
+ * Devices like multimeters and power supplies send one analog packet per
+ * reading, so that the per-packet cost of transforms and callbacks adds
+ * up in sessions with many of them. With coalescing enabled, consecutive
+ * single-channel analog packets with identical encoding and meaning are
+ * merged per channel, and delivered as one multi-sample packet.
+ *
+ * Collected samples are delivered when @a max_samples were gathered,
+ * when the oldest one has been held for @a max_latency_ms, or when the
+ * device sends any other packet, so that the order of packets relative
+ * to frames, triggers and the end of the data feed is kept.
  *
  * @param session The session to use. Must not be NULL.
- * @param trig The trigger to assign to this session. Can be NULL.
+ * @param max_samples Number of samples per coalesced packet, or 0 to
+ *                    disable coalescing (default).
+ * @param max_latency_ms Maximum time in ms to hold back samples, or 0
+ *                       to only flush by sample count.
  *
  * @retval SR_OK Success.
  * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Session is running.
  *
- * @since 0.4.0
+ * @since 0.6.0
  */
-SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger *trig)
+SR_API int sr_session_coalesce_set(struct sr_session *session,
+		uint32_t max_samples, unsigned int max_latency_ms)
 {
-	if (!session)
-		return SR_ERR_ARG;
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (session->running) {
+		sr_err("Cannot change coalescing while session is running.");
+		return SR_ERR;
+	}
+
+	session->coalesce_max_samples = max_samples;
+	session->coalesce_latency_us = 1000 * (int64_t)max_latency_ms;
+
+	return SR_OK;
+}
+
+/**
+ * Configure the merging of the devices' data in time order.
+ *
+ * The logic and analog packets which the devices of a session send
+ * carry the estimated host time of their first sample, on a common
+ * timebase (see sr_packet_timestamp_get()). With merging enabled, the
+ * session holds the packets back and passes them to the callbacks in
+ * the order of these times, across all devices.
+ *
+ * A packet is delivered as soon as every device of the session sent
+ * data up to its time, or when it has been held for @a max_latency_ms.
+ * Other packets, like triggers, frames and the end of the data feed,
+ * deliver all held back packets before them.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param max_latency_ms Maximum time in ms to hold back packets, or 0
+ *                       to disable merging (default).
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_align_set(struct sr_session *session,
+		unsigned int max_latency_ms)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (session->running) {
+		sr_err("Cannot change alignment while session is running.");
+		return SR_ERR;
+	}
+
+	session->align_latency_us = 1000 * (int64_t)max_latency_ms;
+
+	return SR_OK;
+}
+
+/**
+ * Configure whether each device runs in a thread of its own.
+ *
+ * By default, the event sources of all devices in a session run in the
+ * session's main context, so that a device which blocks in its event
+ * handler (e.g. while fetching a waveform from a scope) delays all the
+ * other devices. With device threads enabled, every device starts its
+ * acquisition and runs its event sources in a thread and main context
+ * of its own.
+ *
+ * The packets of all devices are still passed through the transforms
+ * and datafeed callbacks one at a time, and the packets of each device
+ * keep their order. Callbacks do run in the thread of the device which
+ * sent the packet though, unless threaded dispatch is enabled as well
+ * (see sr_session_datafeed_dispatch_set()).
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param enable TRUE to run each device in a thread of its own, FALSE
+ *               to run all devices in the main context (default).
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Session is running.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_device_threads_set(struct sr_session *session,
+		gboolean enable)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	if (session->running) {
+		sr_err("Cannot change device threads while session is running.");
+		return SR_ERR;
+	}
+
+	session->dev_threads = enable;
+
+	return SR_OK;
+}
+
+/**
+ * Enable the accounting of packets and of datafeed stages.
+ *
+ * Counting the packets which devices send, and timing the transforms
+ * and datafeed callbacks, costs a lock and clock reads per packet. So
+ * it is off by default. The counters of events like overruns, gaps and
+ * latency probes are always kept.
+ *
+ * This can be called while the session runs.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param enable TRUE to account packets and stages, FALSE to stop.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_stats_enable_set(struct sr_session *session,
+		gboolean enable)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	g_atomic_int_set(&session->stats_enabled, enable ? 1 : 0);
+
+	return SR_OK;
+}
+
+/**
+ * Get the datafeed throughput counters of a session.
+ *
+ * The counters cover all packets which devices sent since the session
+ * was last started, before they pass coalescing and the transforms.
+ * They can be read while the session runs. Packets only get counted
+ * while sr_session_stats_enable_set() enabled it.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device to get the counters of, or NULL for the
+ *            counters of the whole session.
+ * @param stats Pointer to store the counters at. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_stats_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, struct sr_session_stats *stats)
+{
+	struct sr_session_stats *dev_stats;
+
+	if (!session || !stats)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&session->stats_mutex);
+	if (!sdi) {
+		*stats = session->stats;
+	} else if ((dev_stats = g_hash_table_lookup(session->dev_stats, sdi))) {
+		*stats = *dev_stats;
+	} else {
+		memset(stats, 0, sizeof(*stats));
+	}
+	g_mutex_unlock(&session->stats_mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Get the timing statistics of the stages of a session's datafeed.
+ *
+ * The list holds one entry per transform module in the order they run,
+ * followed by one entry per datafeed callback in the order they were
+ * added. Callbacks which run in a consumer thread (see
+ * sr_session_datafeed_dispatch_set()) are timed in that thread. Stages
+ * only get timed while sr_session_stats_enable_set() enabled it.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param stages Pointer to store a newly allocated list of struct
+ *               sr_session_stage_stats copies at. Must not be NULL.
+ *               Free it with g_slist_free_full(stages, g_free).
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_stage_stats_get(struct sr_session *session,
+		GSList **stages)
+{
+	struct sr_session_stage_stats *stage;
+	struct sr_transform *t;
+	struct datafeed_callback *cb_struct;
+	GSList *l, *list;
+	unsigned int idx;
+
+	if (!session || !stages)
+		return SR_ERR_ARG;
+
+	list = NULL;
+	g_mutex_lock(&session->stats_mutex);
+	for (l = session->transforms; l; l = l->next) {
+		t = l->data;
+		stage = g_malloc(sizeof(*stage));
+		*stage = t->stats;
+		g_strlcpy(stage->name, t->module->id, sizeof(stage->name));
+		list = g_slist_append(list, stage);
+	}
+	idx = 0;
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		stage = g_malloc(sizeof(*stage));
+		*stage = cb_struct->stats;
+		g_snprintf(stage->name, sizeof(stage->name), "callback %u", idx++);
+		list = g_slist_append(list, stage);
+	}
+	g_mutex_unlock(&session->stats_mutex);
+
+	*stages = list;
+
+	return SR_OK;
+}
+
+/* Account the latency of a probe. Call with the stats mutex held. */
+static void probe_stats_account(struct sr_session_stats *stats,
+		int64_t latency)
+{
+	stats->probes++;
+	stats->probe_total_us += latency;
+	if ((uint64_t)latency > stats->probe_max_us)
+		stats->probe_max_us = latency;
+	stats->probe_hist[latency_bin(latency)]++;
+}
+
+/**
+ * Account a latency probe which reached a datafeed consumer.
+ *
+ * Devices which support SR_CONF_LATENCY_PROBE_MSEC send SR_DF_META
+ * packets with an SR_CONF_LATENCY_PROBE timestamp. Consumers pass the
+ * packets they receive here, at the end of their processing. The time
+ * since the probe was generated gets accounted in the statistics of
+ * the session and of the device, see sr_session_stats_get().
+ *
+ * This can be called from any thread.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device which sent the packet, or NULL.
+ * @param packet The received packet. Must not be NULL.
+ *
+ * @retval SR_OK The packet is a probe, its latency got accounted.
+ * @retval SR_ERR_NA The packet is not a probe.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_latency_probe(struct sr_session *session,
+		const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet)
+{
+	const struct sr_datafeed_meta *meta;
+	const struct sr_config *src;
+	struct sr_session_stats *dev_stats;
+	GSList *l;
+	int64_t latency;
+
+	if (!session || !packet)
+		return SR_ERR_ARG;
+	if (packet->type != SR_DF_META)
+		return SR_ERR_NA;
+
+	meta = packet->payload;
+	src = NULL;
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_LATENCY_PROBE)
+			break;
+	}
+	if (!l)
+		return SR_ERR_NA;
+
+	latency = g_get_monotonic_time()
+		- (int64_t)g_variant_get_uint64(src->data);
+	if (latency < 0)
+		latency = 0;
+
+	g_mutex_lock(&session->stats_mutex);
+	probe_stats_account(&session->stats, latency);
+	if (sdi && (dev_stats = g_hash_table_lookup(session->dev_stats, sdi)))
+		probe_stats_account(dev_stats, latency);
+	g_mutex_unlock(&session->stats_mutex);
+
+	return SR_OK;
+}
+
+/**
+ * Report the fill level of a consumer's queue to the session.
+ *
+ * Datafeed callbacks which hand packets over to a queue of their own
+ * can report its fill level, so that drivers which are able to adapt
+ * their data rate get throttled before the consumer falls behind. The
+ * fill levels of the queues of threaded dispatch are taken into
+ * account automatically.
+ *
+ * This can be called from any thread. The level is reset to 0 when the
+ * session starts.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param fill_percent The fill level of the consumer's queue, 0 to 100.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_backpressure_set(struct sr_session *session,
+		unsigned int fill_percent)
+{
+	if (!session)
+		return SR_ERR_ARG;
+
+	g_atomic_int_set(&session->backpressure, MIN(fill_percent, 100));
+
+	return SR_OK;
+}
+
+/**
+ * Get the backpressure of a session's consumers.
+ *
+ * Drivers which can adapt their data rate (e.g. replay of stored data
+ * or generated data) should throttle while this is at or above
+ * SR_BACKPRESSURE_HIGH.
+ *
+ * @param session The session to use. Must not be NULL.
+ *
+ * @return The fill level of the fullest consumer queue, in percent.
+ *
+ * @private
+ */
+SR_PRIV unsigned int sr_session_backpressure_get(struct sr_session *session)
+{
+	struct datafeed_callback *cb_struct;
+	unsigned int level, fill;
+	GSList *l;
+
+	level = g_atomic_int_get(&session->backpressure);
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (!cb_struct->thread)
+			continue;
+		g_mutex_lock(&cb_struct->mutex);
+		fill = 100 * cb_struct->queue_count / cb_struct->queue_size;
+		g_mutex_unlock(&cb_struct->mutex);
+		level = MAX(level, fill);
+	}
+
+	return level;
+}
+
+/**
+ * Report a consumer overrun.
+ *
+ * Drivers call this when the device lost data because the session's
+ * consumers did not keep up, e.g. when its buffers overflowed while
+ * the backpressure was high.
+ *
+ * @param sdi The device which lost data. Must not be NULL.
+ * @param sample_pos The sample position at which data was lost.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_overrun(const struct sr_dev_inst *sdi,
+		uint64_t sample_pos)
+{
+	struct sr_session *session;
+	struct sr_session_stats *dev_stats;
+
+	sr_err("Consumer overrun, %s device lost data at sample %" PRIu64 ".",
+		sdi->driver ? sdi->driver->name : "unknown", sample_pos);
+
+	if (!(session = sdi->session))
+		return;
+
+	g_mutex_lock(&session->stats_mutex);
+	session->stats.overruns++;
+	session->stats.overrun_sample = sample_pos;
+	dev_stats = dev_stats_get(session, sdi);
+	dev_stats->overruns++;
+	dev_stats->overrun_sample = sample_pos;
+	g_mutex_unlock(&session->stats_mutex);
+}
+
+/**
+ * Report a gap in the sample data.
+ *
+ * Drivers call this when they know that samples are missing from the
+ * datafeed, e.g. after a FIFO overflow of the device, and keep the
+ * acquisition running. The gap gets accounted in the statistics, and
+ * consumers receive an SR_DF_META packet with SR_CONF_SAMPLES_LOST.
+ *
+ * @param sdi The device which lost samples. Must not be NULL.
+ * @param sample_pos Number of samples which were sent before the gap.
+ * @param count Number of lost samples, 0 if unknown.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_samples_lost(const struct sr_dev_inst *sdi,
+		uint64_t sample_pos, uint64_t count)
+{
+	struct sr_session *session;
+	struct sr_session_stats *dev_stats;
+
+	if (!sdi)
+		return SR_ERR_ARG;
+
+	if (count)
+		sr_warn("%s device lost %" PRIu64 " samples at sample %" PRIu64 ".",
+			sdi->driver ? sdi->driver->name : "unknown",
+			count, sample_pos);
+	else
+		sr_warn("%s device lost samples at sample %" PRIu64 ".",
+			sdi->driver ? sdi->driver->name : "unknown", sample_pos);
+
+	if ((session = sdi->session)) {
+		g_mutex_lock(&session->stats_mutex);
+		session->stats.gaps++;
+		session->stats.samples_lost += count;
+		session->stats.gap_sample = sample_pos;
+		dev_stats = dev_stats_get(session, sdi);
+		dev_stats->gaps++;
+		dev_stats->samples_lost += count;
+		dev_stats->gap_sample = sample_pos;
+		g_mutex_unlock(&session->stats_mutex);
+	}
+
+	return sr_session_send_meta(sdi, SR_CONF_SAMPLES_LOST,
+		g_variant_new("(tt)", sample_pos, count));
+}
+
+/* Account readback progress. Call with the stats mutex held. */
+static void download_stats_account(struct sr_session_stats *stats,
+		uint64_t done, uint64_t size, int64_t now)
+{
+	if (!done) {
+		stats->downloads++;
+		stats->download_done = 0;
+		stats->download_size = size;
+	} else if (done > stats->download_done) {
+		stats->download_bytes += done - stats->download_done;
+		stats->download_us += now - stats->download_last_us;
+		stats->download_done = done;
+	}
+	stats->download_last_us = now;
+}
+
+/**
+ * Report the progress of a sample memory readback.
+ *
+ * Drivers of devices which capture into their own memory and read it
+ * back afterwards call this with @a done set to 0 when the readback
+ * starts, and then whenever data was received. The session accounts
+ * the progress and the throughput of readbacks in its statistics.
+ *
+ * @param sdi The device reading back its memory. Must not be NULL.
+ * @param done The number of bytes received so far.
+ * @param size The total number of bytes of the readback.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_download_progress(const struct sr_dev_inst *sdi,
+		uint64_t done, uint64_t size)
+{
+	struct sr_session *session;
+	int64_t now;
+
+	if (!(session = sdi->session))
+		return;
+
+	now = g_get_monotonic_time();
+
+	g_mutex_lock(&session->stats_mutex);
+	download_stats_account(&session->stats, done, size, now);
+	download_stats_account(dev_stats_get(session, sdi), done, size, now);
+	g_mutex_unlock(&session->stats_mutex);
+}
+
+/**
+ * Get the trigger assigned to this session.
+ *
+ * @param session The session to use.
+ *
+ * @retval NULL Invalid (NULL) session was passed to the function.
+ * @retval other The trigger assigned to this session (can be NULL).
+ *
+ * @since 0.4.0
+ */
+SR_API struct sr_trigger *sr_session_trigger_get(struct sr_session *session)
+{
+	if (!session)
+		return NULL;
+
+	return session->trigger;
+}
+
+/**
+ * Set the trigger of this session.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param trig The trigger to assign to this session. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger *trig)
+{
+	GSList *l;
+
+	if (!session)
+		return SR_ERR_ARG;
+
+	session->trigger = trig;
+	for (l = session->devs; l; l = l->next)
+		sr_dev_rearm_invalidate(l->data);
+
+	return SR_OK;
+}
+
+static int verify_trigger(struct sr_trigger *trigger)
+{
+	struct sr_trigger_stage *stage;
+	struct sr_trigger_match *match;
+	GSList *l, *m;
+
+	if (!trigger->stages) {
+		sr_err("No trigger stages defined.");
+		return SR_ERR;
+	}
+
+	sr_spew("Checking trigger:");
+	for (l = trigger->stages; l; l = l->next) {
+		stage = l->data;
+		if (!stage->matches) {
+			sr_err("Stage %d has no matches defined.", stage->stage);
+			return SR_ERR;
+		}
+		for (m = stage->matches; m; m = m->next) {
+			match = m->data;
+			if (!match->channel) {
+				sr_err("Stage %d match has no channel.", stage->stage);
+				return SR_ERR;
+			}
+			if (!match->match) {
+				sr_err("Stage %d match is not defined.", stage->stage);
+				return SR_ERR;
+			}
+			sr_spew("Stage %d match on channel %s, match %d", stage->stage,
+					match->channel->name, match->match);
+		}
+	}
+
+	return SR_OK;
+}
+
+/** Set up the main context the session will be executing in.
+ *
+ * Must be called just before the session starts, by the thread which
+ * will execute the session main loop. Once acquired, the main context
+ * pointer is immutable for the duration of the session run.
+ */
+static int set_main_context(struct sr_session *session)
+{
+	GMainContext *main_context;
+
+	g_mutex_lock(&session->main_mutex);
+
+	/* May happen if sr_session_start() is called a second time
+	 * while the session is still running.
+	 */
+	if (session->main_context) {
+		sr_err("Main context already set.");
+
+		g_mutex_unlock(&session->main_mutex);
+		return SR_ERR;
+	}
+	main_context = g_main_context_ref_thread_default();
+	/*
+	 * Try to use an existing main context if possible, but only if we
+	 * can make it owned by the current thread. Otherwise, create our
+	 * own main context so that event source callbacks can execute in
+	 * the session thread.
+	 */
+	if (g_main_context_acquire(main_context)) {
+		g_main_context_release(main_context);
+
+		sr_dbg("Using thread-default main context.");
+	} else {
+		g_main_context_unref(main_context);
+
+		sr_dbg("Creating our own main context.");
+		main_context = g_main_context_new();
+	}
+	session->main_context = main_context;
+
+	g_mutex_unlock(&session->main_mutex);
+
+	return SR_OK;
+}
+
+/** Unset the main context used for the current session run.
+ *
+ * Must be called right after stopping the session. Note that if the
+ * session is stopped asynchronously, the main loop may still be running
+ * after the main context has been unset. This is OK as long as no new
+ * event sources are created -- the main loop holds its own reference
+ * to the main context.
+ */
+static int unset_main_context(struct sr_session *session)
+{
+	int ret;
+
+	g_mutex_lock(&session->main_mutex);
+
+	if (session->main_context) {
+		g_main_context_unref(session->main_context);
+		session->main_context = NULL;
+		ret = SR_OK;
+	} else {
+		/* May happen if the set/unset calls are not matched.
+		 */
+		sr_err("No main context to unset.");
+		ret = SR_ERR;
+	}
+	g_mutex_unlock(&session->main_mutex);
+
+	return ret;
+}
+
+static unsigned int session_source_attach(struct sr_session *session,
+		GSource *source)
+{
+	unsigned int id = 0;
+
+	g_mutex_lock(&session->main_mutex);
+
+	if (session->main_context)
+		id = g_source_attach(source, session->main_context);
+	else
+		sr_err("Cannot add event source without main context.");
+
+	g_mutex_unlock(&session->main_mutex);
+
+	return id;
+}
+
+/*
+ * Per-device worker thread. It starts the acquisition of its device
+ * with its own main context as the thread-default context, so that
+ * the device's event sources get attached to it, and then runs that
+ * context until the session ends.
+ */
+struct dev_worker {
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GMainContext *context;
+	GMainLoop *loop;
+	GThread *thread;
+	GMutex mutex;
+	GCond cond;
+	/* Whether to re-arm the device, see sr_session_rearm(). */
+	gboolean rearm;
+	gboolean started;
+	int start_ret;
+};
+
+static gpointer dev_worker_thread(gpointer data)
+{
+	struct dev_worker *worker;
+	int ret;
+
+	worker = data;
+	sr_thread_policy_apply(worker->session->ctx, SR_THREAD_IO);
+
+	g_main_context_push_thread_default(worker->context);
+
+	if (worker->rearm)
+		ret = sr_dev_acquisition_rearm(worker->sdi);
+	else
+		ret = sr_dev_acquisition_start(worker->sdi);
+
+	g_mutex_lock(&worker->mutex);
+	worker->start_ret = ret;
+	worker->started = TRUE;
+	g_cond_signal(&worker->cond);
+	g_mutex_unlock(&worker->mutex);
+
+	/* Run even after a failed start, until dev_workers_stop() quits. */
+	g_main_loop_run(worker->loop);
+
+	g_main_context_pop_thread_default(worker->context);
+
+	return NULL;
+}
+
+/* Start a device's worker, and wait for its acquisition to start. */
+static int dev_worker_start(struct sr_session *session,
+		struct sr_dev_inst *sdi, gboolean rearm)
+{
+	struct dev_worker *worker;
+
+	worker = g_malloc0(sizeof(*worker));
+	worker->session = session;
+	worker->sdi = sdi;
+	worker->rearm = rearm;
+	worker->context = g_main_context_new();
+	worker->loop = g_main_loop_new(worker->context, FALSE);
+	g_mutex_init(&worker->mutex);
+	g_cond_init(&worker->cond);
+
+	g_mutex_lock(&session->main_mutex);
+	session->dev_workers = g_slist_append(session->dev_workers, worker);
+	g_mutex_unlock(&session->main_mutex);
+
+	worker->thread = g_thread_new("sr-device", dev_worker_thread, worker);
+
+	g_mutex_lock(&worker->mutex);
+	while (!worker->started)
+		g_cond_wait(&worker->cond, &worker->mutex);
+	g_mutex_unlock(&worker->mutex);
+
+	return worker->start_ret;
+}
+
+static gboolean dev_worker_acquisition_stop(void *data)
+{
+	struct dev_worker *worker;
+
+	worker = data;
+	sr_dev_acquisition_stop(worker->sdi);
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean dev_worker_quit(void *data)
+{
+	struct dev_worker *worker;
+
+	worker = data;
+	g_main_loop_quit(worker->loop);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Stop a device's acquisition, in its worker thread if it has one. */
+static void session_dev_acquisition_stop(struct sr_session *session,
+		struct sr_dev_inst *sdi)
+{
+	struct dev_worker *worker;
+	GSList *l;
+
+	worker = NULL;
+	g_mutex_lock(&session->main_mutex);
+	for (l = session->dev_workers; l; l = l->next) {
+		if (((struct dev_worker *)l->data)->sdi == sdi) {
+			worker = l->data;
+			g_main_context_invoke(worker->context,
+				&dev_worker_acquisition_stop, worker);
+			break;
+		}
+	}
+	g_mutex_unlock(&session->main_mutex);
+
+	if (!worker)
+		sr_dev_acquisition_stop(sdi);
+}
 
-	session->trigger = trig;
+/* Terminate and join all device workers. */
+static void dev_workers_stop(struct sr_session *session)
+{
+	struct dev_worker *worker;
+	GSList *l, *workers;
 
-	return SR_OK;
+	g_mutex_lock(&session->main_mutex);
+	workers = session->dev_workers;
+	session->dev_workers = NULL;
+	g_mutex_unlock(&session->main_mutex);
+
+	for (l = workers; l; l = l->next) {
+		worker = l->data;
+		g_main_context_invoke(worker->context, &dev_worker_quit, worker);
+		g_thread_join(worker->thread);
+		g_main_loop_unref(worker->loop);
+		g_main_context_unref(worker->context);
+		g_mutex_clear(&worker->mutex);
+		g_cond_clear(&worker->cond);
+		g_free(worker);
+	}
+	g_slist_free(workers);
 }
 
-static int verify_trigger(struct sr_trigger *trigger)
+/*
+ * Attach a device's event source. Sources which get added from within
+ * a device worker thread go to the worker's context, all others to the
+ * session's main context.
+ */
+static unsigned int dev_source_attach(struct sr_session *session,
+		GSource *source)
 {
-	struct sr_trigger_stage *stage;
-	struct sr_trigger_match *match;
-	GSList *l, *m;
+	struct dev_worker *worker;
+	GMainContext *context;
+	GSList *l;
+	unsigned int id = 0;
 
-	if (!trigger->stages) {
-		sr_err("No trigger stages defined.");
-		return SR_ERR;
-	}
+	g_mutex_lock(&session->main_mutex);
 
-	sr_spew("Checking trigger:");
-	for (l = trigger->stages; l; l = l->next) {
-		stage = l->data;
-		if (!stage->matches) {
-			sr_err("Stage %d has no matches defined.", stage->stage);
-			return SR_ERR;
-		}
-		for (m = stage->matches; m; m = m->next) {
-			match = m->data;
-			if (!match->channel) {
-				sr_err("Stage %d match has no channel.", stage->stage);
-				return SR_ERR;
-			}
-			if (!match->match) {
-				sr_err("Stage %d match is not defined.", stage->stage);
-				return SR_ERR;
-			}
-			sr_spew("Stage %d match on channel %s, match %d", stage->stage,
-					match->channel->name, match->match);
+	context = session->main_context;
+	for (l = session->dev_workers; l; l = l->next) {
+		worker = l->data;
+		if (worker->context == g_main_context_get_thread_default()) {
+			context = worker->context;
+			break;
 		}
 	}
+	if (context)
+		id = g_source_attach(source, context);
+	else
+		sr_err("Cannot add event source without main context.");
 
-	return SR_OK;
+	g_mutex_unlock(&session->main_mutex);
+
+	return id;
 }
 
-/** Set up the main context the session will be executing in.
+static void session_send_lock(struct sr_session *session)
+{
+	if (session->dev_threads)
+		g_rec_mutex_lock(&session->send_mutex);
+}
+
+static void session_send_unlock(struct sr_session *session)
+{
+	if (session->dev_threads)
+		g_rec_mutex_unlock(&session->send_mutex);
+}
+
+static int session_send_packet(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		const struct sr_datafeed_timestamp *ts);
+static int session_dispatch(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, int expanded_from,
+		const struct sr_datafeed_timestamp *ts);
+static int session_dispatch_expanded(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		const struct sr_datafeed_timestamp *ts);
+static int session_deliver(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		const struct sr_datafeed_timestamp *ts);
+
+/*
+ * Analog packet coalescing.
  *
- * Must be called just before the session starts, by the thread which
- * will execute the session main loop. Once acquired, the main context
- * pointer is immutable for the duration of the session run.
+ * Consecutive single-channel analog packets with identical encoding and
+ * meaning are collected per channel, and sent as one multi-sample packet
+ * when enough samples were gathered, when the oldest sample exceeds the
+ * latency deadline, or when the device sends a packet of another kind.
  */
-static int set_main_context(struct sr_session *session)
+struct coalesce_buf {
+	const struct sr_dev_inst *sdi;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	GByteArray *data;
+	uint32_t num_samples;
+	int64_t first_us;
+	/* Timestamp of the first packet which was collected. */
+	struct sr_datafeed_timestamp ts;
+};
+
+static void coalesce_buf_free(void *p)
 {
-	GMainContext *main_context;
+	struct coalesce_buf *cbuf;
 
-	g_mutex_lock(&session->main_mutex);
+	cbuf = p;
 
-	/* May happen if sr_session_start() is called a second time
-	 * while the session is still running.
-	 */
-	if (session->main_context) {
-		sr_err("Main context already set.");
+	g_slist_free(cbuf->meaning.channels);
+	g_byte_array_free(cbuf->data, TRUE);
+	g_free(cbuf);
+}
 
-		g_mutex_unlock(&session->main_mutex);
-		return SR_ERR;
+static gboolean coalesce_buf_matches(const struct coalesce_buf *cbuf,
+		const struct sr_datafeed_analog *analog)
+{
+	const struct sr_analog_encoding *enc;
+
+	enc = analog->encoding;
+
+	return cbuf->encoding.unitsize == enc->unitsize
+		&& cbuf->encoding.is_signed == enc->is_signed
+		&& cbuf->encoding.is_float == enc->is_float
+		&& cbuf->encoding.is_bigendian == enc->is_bigendian
+		&& cbuf->encoding.digits == enc->digits
+		&& cbuf->encoding.is_digits_decimal == enc->is_digits_decimal
+		&& sr_rational_eq(&cbuf->encoding.scale, &enc->scale) == 1
+		&& sr_rational_eq(&cbuf->encoding.offset, &enc->offset) == 1
+		&& cbuf->meaning.mq == analog->meaning->mq
+		&& cbuf->meaning.unit == analog->meaning->unit
+		&& cbuf->meaning.mqflags == analog->meaning->mqflags
+		&& cbuf->spec.spec_digits == analog->spec->spec_digits;
+}
+
+static int coalesce_buf_flush(struct coalesce_buf *cbuf)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	int ret;
+
+	if (!cbuf->num_samples)
+		return SR_OK;
+
+	analog.data = cbuf->data->data;
+	analog.num_samples = cbuf->num_samples;
+	analog.encoding = &cbuf->encoding;
+	analog.meaning = &cbuf->meaning;
+	analog.spec = &cbuf->spec;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+
+	ret = session_send_packet(cbuf->sdi, &packet, &cbuf->ts);
+
+	g_byte_array_set_size(cbuf->data, 0);
+	cbuf->num_samples = 0;
+
+	return ret;
+}
+
+/*
+ * Flush the buffers of one device, or of all devices when @a sdi is NULL.
+ * When @a due_us is non-zero, only buffers which started before that
+ * point in time are flushed.
+ */
+static int coalesce_flush(struct sr_session *session,
+		const struct sr_dev_inst *sdi, int64_t due_us)
+{
+	GHashTableIter iter;
+	struct coalesce_buf *cbuf;
+	void *value;
+	int ret;
+
+	if (!session->coalesce_bufs)
+		return SR_OK;
+
+	ret = SR_OK;
+	g_hash_table_iter_init(&iter, session->coalesce_bufs);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		cbuf = value;
+		if (sdi && cbuf->sdi != sdi)
+			continue;
+		if (due_us && cbuf->first_us > due_us)
+			continue;
+		if (coalesce_buf_flush(cbuf) != SR_OK)
+			ret = SR_ERR;
 	}
-	main_context = g_main_context_ref_thread_default();
-	/*
-	 * Try to use an existing main context if possible, but only if we
-	 * can make it owned by the current thread. Otherwise, create our
-	 * own main context so that event source callbacks can execute in
-	 * the session thread.
-	 */
-	if (g_main_context_acquire(main_context)) {
-		g_main_context_release(main_context);
 
-		sr_dbg("Using thread-default main context.");
-	} else {
-		g_main_context_unref(main_context);
+	return ret;
+}
 
-		sr_dbg("Creating our own main context.");
-		main_context = g_main_context_new();
+static gboolean coalesce_timeout(void *data)
+{
+	struct sr_session *session;
+
+	session = data;
+	session_send_lock(session);
+	coalesce_flush(session, NULL,
+		g_get_monotonic_time() - session->coalesce_latency_us);
+	session_send_unlock(session);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void coalesce_start(struct sr_session *session)
+{
+	GSource *source;
+
+	if (session->coalesce_max_samples <= 1)
+		return;
+
+	if (!session->coalesce_bufs)
+		session->coalesce_bufs = g_hash_table_new_full(NULL, NULL,
+				NULL, coalesce_buf_free);
+
+	if (!session->coalesce_latency_us)
+		return;
+	source = g_timeout_source_new(session->coalesce_latency_us / 1000);
+	g_source_set_callback(source, &coalesce_timeout, session, NULL);
+	if (session_source_attach(session, source) != 0)
+		session->coalesce_timer = source;
+	else
+		g_source_unref(source);
+}
+
+static void coalesce_stop(struct sr_session *session)
+{
+	if (session->coalesce_timer) {
+		g_source_destroy(session->coalesce_timer);
+		g_source_unref(session->coalesce_timer);
+		session->coalesce_timer = NULL;
 	}
-	session->main_context = main_context;
+	session_send_lock(session);
+	coalesce_flush(session, NULL, 0);
+	session_send_unlock(session);
+}
 
-	g_mutex_unlock(&session->main_mutex);
+static int coalesce_packet(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		const struct sr_datafeed_timestamp *ts, gboolean *consumed)
+{
+	struct sr_session *session;
+	const struct sr_datafeed_analog *analog;
+	struct coalesce_buf *cbuf;
+	struct sr_channel *ch;
+	int64_t now_us;
+	int ret;
 
-	return SR_OK;
+	session = sdi->session;
+	*consumed = FALSE;
+
+	if (!session->coalesce_bufs || !session->running)
+		return SR_OK;
+
+	analog =(packet->type == SR_DF_ANALOG) ? packet->payload : NULL;
+	if (!analog || g_slist_length(analog->meaning->channels) != 1) {
+		/* Keep the device's packet order intact. */
+		return coalesce_flush(session, sdi, 0);
+	}
+
+	ch = analog->meaning->channels->data;
+	cbuf = g_hash_table_lookup(session->coalesce_bufs, ch);
+	if (!cbuf) {
+		cbuf = g_malloc0(sizeof(*cbuf));
+		cbuf->sdi = sdi;
+		cbuf->meaning.channels = g_slist_append(NULL, ch);
+		cbuf->data = g_byte_array_new();
+		g_hash_table_insert(session->coalesce_bufs, ch, cbuf);
+	}
+
+	ret = SR_OK;
+	if (cbuf->num_samples && !coalesce_buf_matches(cbuf, analog))
+		ret = coalesce_buf_flush(cbuf);
+
+	now_us = g_get_monotonic_time();
+	if (!cbuf->num_samples) {
+		cbuf->encoding = *analog->encoding;
+		cbuf->meaning.mq = analog->meaning->mq;
+		cbuf->meaning.unit = analog->meaning->unit;
+		cbuf->meaning.mqflags = analog->meaning->mqflags;
+		cbuf->spec = *analog->spec;
+		cbuf->first_us = now_us;
+		if (ts)
+			cbuf->ts = *ts;
+	}
+	g_byte_array_append(cbuf->data, analog->data,
+		analog->num_samples * analog->encoding->unitsize);
+	cbuf->num_samples += analog->num_samples;
+	*consumed = TRUE;
+
+	if (cbuf->num_samples >= session->coalesce_max_samples
+			|| (session->coalesce_latency_us
+			&& now_us - cbuf->first_us >= session->coalesce_latency_us)) {
+		if (coalesce_buf_flush(cbuf) != SR_OK)
+			ret = SR_ERR;
+	}
+
+	return ret;
 }
 
-/** Unset the main context used for the current session run.
+/*
+ * Merging of the devices' data in time order.
  *
- * Must be called right after stopping the session. Note that if the
- * session is stopped asynchronously, the main loop may still be running
- * after the main context has been unset. This is OK as long as no new
- * event sources are created -- the main loop holds its own reference
- * to the main context.
+ * Data packets are held in a queue which is sorted by their aligned
+ * time. The horizon is the earliest time up to which all devices sent
+ * data, packets before it can't be overtaken by later ones anymore.
  */
-static int unset_main_context(struct sr_session *session)
+struct align_item {
+	const struct sr_dev_inst *sdi;
+	struct sr_datafeed_packet *packet;
+	struct sr_datafeed_timestamp ts;
+	int64_t queued_us;
+};
+
+static void align_item_free(struct align_item *item)
+{
+	sr_packet_unref(item->packet);
+	g_free(item);
+}
+
+static int64_t align_horizon(struct sr_session *session)
+{
+	const struct sr_dev_inst *sdi;
+	int64_t horizon_us, end_us;
+	GSList *l;
+
+	horizon_us = G_MAXINT64;
+	for (l = session->devs; l; l = l->next) {
+		sdi = l->data;
+		end_us = sdi->packet_clock ? sdi->packet_clock->aligned_end_us : 0;
+		horizon_us = MIN(horizon_us, end_us);
+	}
+
+	return horizon_us;
+}
+
+/*
+ * Deliver the held back packets up to the last one which is before the
+ * horizon, or was queued before @a due_us. Either of them can be 0.
+ */
+static int align_release(struct sr_session *session, int64_t horizon_us,
+		int64_t due_us)
 {
+	struct align_item *item;
+	GList *l, *last;
 	int ret;
 
-	g_mutex_lock(&session->main_mutex);
+	last = NULL;
+	for (l = session->align_queue.head; l; l = l->next) {
+		item = l->data;
+		if (item->ts.aligned_us <= horizon_us || item->queued_us <= due_us)
+			last = l;
+	}
+	if (!last)
+		return SR_OK;
 
-	if (session->main_context) {
-		g_main_context_unref(session->main_context);
-		session->main_context = NULL;
-		ret = SR_OK;
-	} else {
-		/* May happen if the set/unset calls are not matched.
-		 */
-		sr_err("No main context to unset.");
-		ret = SR_ERR;
+	ret = SR_OK;
+	while ((l = session->align_queue.head)) {
+		item = g_queue_pop_head(&session->align_queue);
+		if (session_deliver(item->sdi, item->packet, &item->ts) != SR_OK)
+			ret = SR_ERR;
+		align_item_free(item);
+		if (l == last)
+			break;
 	}
-	g_mutex_unlock(&session->main_mutex);
 
 	return ret;
 }
 
-static unsigned int session_source_attach(struct sr_session *session,
-		GSource *source)
+static int align_flush(struct sr_session *session)
 {
-	unsigned int id = 0;
+	return align_release(session, G_MAXINT64, 0);
+}
 
-	g_mutex_lock(&session->main_mutex);
+static gboolean align_timeout(void *data)
+{
+	struct sr_session *session;
 
-	if (session->main_context)
-		id = g_source_attach(source, session->main_context);
+	session = data;
+	session_send_lock(session);
+	align_release(session, 0,
+		g_get_monotonic_time() - session->align_latency_us);
+	session_send_unlock(session);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void align_start(struct sr_session *session)
+{
+	GSource *source;
+
+	if (!session->align_latency_us)
+		return;
+
+	source = g_timeout_source_new(MAX(session->align_latency_us / 2000, 1));
+	g_source_set_callback(source, &align_timeout, session, NULL);
+	if (session_source_attach(session, source) != 0)
+		session->align_timer = source;
 	else
-		sr_err("Cannot add event source without main context.");
+		g_source_unref(source);
+}
 
-	g_mutex_unlock(&session->main_mutex);
+static void align_stop(struct sr_session *session)
+{
+	if (session->align_timer) {
+		g_source_destroy(session->align_timer);
+		g_source_unref(session->align_timer);
+		session->align_timer = NULL;
+	}
+	session_send_lock(session);
+	align_flush(session);
+	session_send_unlock(session);
+}
 
-	return id;
+static int align_packet(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		const struct sr_datafeed_timestamp *ts)
+{
+	struct sr_session *session;
+	struct align_item *item;
+	GList *l;
+	int ret;
+
+	session = sdi->session;
+
+	if (!ts) {
+		/* Keep the order relative to frames, triggers and the end. */
+		ret = align_flush(session);
+		if (session_deliver(sdi, packet, ts) != SR_OK)
+			ret = SR_ERR;
+		return ret;
+	}
+
+	item = g_malloc0(sizeof(*item));
+	if (sr_packet_ref(packet, &item->packet) != SR_OK) {
+		g_free(item);
+		return SR_ERR_MALLOC;
+	}
+	item->sdi = sdi;
+	item->ts = *ts;
+	item->queued_us = g_get_monotonic_time();
+
+	/* Most packets are the latest ones, search from the tail. */
+	for (l = session->align_queue.tail; l; l = l->prev) {
+		if (((struct align_item *)l->data)->ts.aligned_us <= ts->aligned_us)
+			break;
+	}
+	if (l)
+		g_queue_insert_after(&session->align_queue, l, item);
+	else
+		g_queue_push_head(&session->align_queue, item);
+
+	return align_release(session, align_horizon(session),
+		item->queued_us - session->align_latency_us);
 }
 
 /* Idle handler; invoked when the number of registered event sources
@@ -677,6 +2449,7 @@ static unsigned int session_source_attach(struct sr_session *session,
 static gboolean delayed_stop_check(void *data)
 {
 	struct sr_session *session;
+	unsigned int num_sources;
 
 	session = data;
 	session->stop_check_id = 0;
@@ -686,12 +2459,21 @@ static gboolean delayed_stop_check(void *data)
 		return G_SOURCE_REMOVE;
 
 	/* New event sources may have been installed in the meantime. */
-	if (g_hash_table_size(session->event_sources) != 0)
+	g_mutex_lock(&session->main_mutex);
+	num_sources = g_hash_table_size(session->event_sources);
+	g_mutex_unlock(&session->main_mutex);
+	if (num_sources != 0)
 		return G_SOURCE_REMOVE;
 
 	session->running = FALSE;
+	dev_workers_stop(session);
+	coalesce_stop(session);
+	align_stop(session);
 	unset_main_context(session);
 
+	/* Let the consumers drain their queues, including SR_DF_END. */
+	datafeed_threads_stop(session);
+
 	sr_info("Stopped.");
 
 	/* This indicates a bug in user code, since it is not valid to
@@ -729,32 +2511,12 @@ static int stop_check_later(struct sr_session *session)
 	return (source_id != 0) ? SR_OK : SR_ERR;
 }
 
-/**
- * Start a session.
- *
- * When this function returns with a status code indicating success, the
- * session is running. Use sr_session_stopped_callback_set() to receive
- * notification upon completion, or call sr_session_run() to block until
- * the session stops.
- *
- * Session events will be processed in the context of the current thread.
- * If a thread-default GLib main context has been set, and is not owned by
- * any other thread, it will be used. Otherwise, libsigrok will create its
- * own main context for the current thread.
- *
- * @param session The session to use. Must not be NULL.
- *
- * @retval SR_OK Success.
- * @retval SR_ERR_ARG Invalid session passed.
- * @retval SR_ERR Other error.
- *
- * @since 0.4.0
- */
-SR_API int sr_session_start(struct sr_session *session)
+static int session_start(struct sr_session *session, gboolean rearm)
 {
 	struct sr_dev_inst *sdi;
-	struct sr_channel *ch;
-	GSList *l, *c, *lend;
+	GSList *l, *lend;
+	size_t enabled_count;
+	unsigned int num_sources;
 	int ret;
 
 	if (!session) {
@@ -779,20 +2541,21 @@ SR_API int sr_session_start(struct sr_session *session)
 			return ret;
 	}
 
-	/* Check enabled channels and commit settings of all devices. */
+	/*
+	 * Check enabled channels and commit settings of all devices.
+	 * Re-armed devices already have their settings applied.
+	 */
 	for (l = session->devs; l; l = l->next) {
 		sdi = l->data;
-		for (c = sdi->channels; c; c = c->next) {
-			ch = c->data;
-			if (ch->enabled)
-				break;
-		}
-		if (!c) {
+		sr_dev_channel_array(sdi, SR_CHANNELS_ENABLED, &enabled_count);
+		if (!enabled_count) {
 			sr_err("%s device %s has no enabled channels.",
 				sdi->driver->name, sdi->connection_id);
 			return SR_ERR;
 		}
 
+		if (rearm && sdi->armed)
+			continue;
 		ret = sr_config_commit(sdi);
 		if (ret != SR_OK) {
 			sr_err("Failed to commit %s device %s settings "
@@ -806,10 +2569,16 @@ SR_API int sr_session_start(struct sr_session *session)
 	if (ret != SR_OK)
 		return ret;
 
-	sr_info("Starting.");
+	sr_info(rearm ? "Re-arming." : "Starting.");
 
 	session->running = TRUE;
 
+	session_stats_reset(session);
+	g_atomic_int_set(&session->backpressure, 0);
+	datafeed_threads_start(session);
+	coalesce_start(session);
+	align_start(session);
+
 	/* Have all devices start acquisition. */
 	for (l = session->devs; l; l = l->next) {
 		if (!(sdi = l->data)) {
@@ -817,7 +2586,12 @@ SR_API int sr_session_start(struct sr_session *session)
 			ret = SR_ERR;
 			break;
 		}
-		ret = sr_dev_acquisition_start(sdi);
+		if (session->dev_threads)
+			ret = dev_worker_start(session, sdi, rearm);
+		else if (rearm)
+			ret = sr_dev_acquisition_rearm(sdi);
+		else
+			ret = sr_dev_acquisition_start(sdi);
 		if (ret != SR_OK) {
 			sr_err("Could not start %s device %s acquisition.",
 				sdi->driver->name, sdi->connection_id);
@@ -831,22 +2605,85 @@ SR_API int sr_session_start(struct sr_session *session)
 		lend = l->next;
 		for (l = session->devs; l != lend; l = l->next) {
 			sdi = l->data;
-			sr_dev_acquisition_stop(sdi);
+			session_dev_acquisition_stop(session, sdi);
 		}
 		/* TODO: Handle delayed stops. Need to iterate the event
 		 * sources... */
 		session->running = FALSE;
+		dev_workers_stop(session);
+		coalesce_stop(session);
+		align_stop(session);
+		datafeed_threads_stop(session);
 
 		unset_main_context(session);
 		return ret;
 	}
 
-	if (g_hash_table_size(session->event_sources) == 0)
+	g_mutex_lock(&session->main_mutex);
+	num_sources = g_hash_table_size(session->event_sources);
+	g_mutex_unlock(&session->main_mutex);
+	if (num_sources == 0)
 		stop_check_later(session);
 
 	return SR_OK;
 }
 
+/**
+ * Start a session.
+ *
+ * When this function returns with a status code indicating success, the
+ * session is running. Use sr_session_stopped_callback_set() to receive
+ * notification upon completion, or call sr_session_run() to block until
+ * the session stops.
+ *
+ * Session events will be processed in the context of the current thread.
+ * If a thread-default GLib main context has been set, and is not owned by
+ * any other thread, it will be used. Otherwise, libsigrok will create its
+ * own main context for the current thread. With device threads enabled
+ * (see sr_session_device_threads_set()), the devices' event sources run
+ * in threads of their own instead.
+ *
+ * @param session The session to use. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR Other error.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_session_start(struct sr_session *session)
+{
+	return session_start(session, FALSE);
+}
+
+/**
+ * Start a session again, reusing the devices' setup of the previous run.
+ *
+ * This suits loops which run the same acquisition many times. Drivers
+ * which support it keep their transfers, buffers, compiled triggers and
+ * device configuration across runs, re-arming takes a fraction of the
+ * time of sr_session_start() then.
+ *
+ * Devices whose configuration, channels or trigger changed since their
+ * previous acquisition started, and devices whose drivers lack support,
+ * start from scratch as with sr_session_start(). The same applies to
+ * the first run. Changing a trigger in place is not tracked beyond
+ * sr_trigger_match_add(), pass it to sr_session_trigger_set() again
+ * after other changes.
+ *
+ * @param session The session to use. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid session passed.
+ * @retval SR_ERR Other error.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_rearm(struct sr_session *session)
+{
+	return session_start(session, TRUE);
+}
+
 /**
  * Block until the running session stops.
  *
@@ -914,7 +2751,7 @@ static gboolean session_stop_sync(void *user_data)
 
 	for (node = session->devs; node; node = node->next) {
 		sdi = node->data;
-		sr_dev_acquisition_stop(sdi);
+		session_dev_acquisition_stop(session, sdi);
 	}
 
 	return G_SOURCE_REMOVE;
@@ -1035,6 +2872,9 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 {
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_datafeed_logic_planar *planar;
+	const struct sr_datafeed_frame *frame;
 
 	/* Please use the same order as in libsigrok.h. */
 	switch (packet->type) {
@@ -1056,7 +2896,12 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 		       "unitsize = %d).", logic->length, logic->unitsize);
 		break;
 	case SR_DF_FRAME_BEGIN:
-		sr_dbg("bus: Received SR_DF_FRAME_BEGIN packet.");
+		frame = packet->payload;
+		if (frame)
+			sr_dbg("bus: Received SR_DF_FRAME_BEGIN packet "
+			       "(sample %" PRIu64 ").", frame->sample_pos);
+		else
+			sr_dbg("bus: Received SR_DF_FRAME_BEGIN packet.");
 		break;
 	case SR_DF_FRAME_END:
 		sr_dbg("bus: Received SR_DF_FRAME_END packet.");
@@ -1066,12 +2911,47 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 		sr_dbg("bus: Received SR_DF_ANALOG packet (%d samples).",
 		       analog->num_samples);
 		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		sr_dbg("bus: Received SR_DF_LOGIC_RLE packet (%" PRIu64 " runs, "
+		       "unitsize = %d).", rle->num_runs, rle->unitsize);
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet->payload;
+		sr_dbg("bus: Received SR_DF_LOGIC_PLANAR packet (%" PRIu64
+		       " samples, unitsize = %d).", planar->num_samples,
+		       planar->unitsize);
+		break;
 	default:
 		sr_dbg("bus: Received unknown packet type: %d.", packet->type);
 		break;
 	}
 }
 
+/* Send an SR_DF_META packet with a single value, owned by the caller. */
+static int send_meta_value(const struct sr_dev_inst *sdi,
+		uint32_t key, GVariant *var)
+{
+	struct sr_config cfg;
+	GSList config;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+
+	cfg.key = key;
+	cfg.data = var;
+	config.data = &cfg;
+	config.next = NULL;
+
+	meta.config = &config;
+
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+
+	sr_config_publish(sdi, NULL, key, var);
+
+	return sr_session_send(sdi, &packet);
+}
+
 /**
  * Helper to send a meta datafeed package (SR_DF_META) to the session bus.
  *
@@ -1084,26 +2964,591 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
  *
  * @private
  */
-SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
-		uint32_t key, GVariant *var)
+SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
+		uint32_t key, GVariant *var)
+{
+	int ret;
+
+	g_variant_ref_sink(var);
+	ret = send_meta_value(sdi, key, var);
+	g_variant_unref(var);
+
+	return ret;
+}
+
+/* Number of keys whose last value is kept per device. */
+#define META_CACHE_SIZE 8
+
+/*
+ * The values which a device sent last in SR_DF_META packets. Drivers
+ * which poll their device tend to report the same few values over
+ * and over, those get sent without allocating a new GVariant.
+ */
+struct sr_dev_meta_cache {
+	uint32_t keys[META_CACHE_SIZE];
+	GVariant *values[META_CACHE_SIZE];
+	unsigned int count;
+};
+
+static GVariant **meta_cache_slot(const struct sr_dev_inst *sdi, uint32_t key)
+{
+	struct sr_dev_meta_cache *cache;
+	unsigned int i;
+
+	if (!(cache = sdi->meta_cache)) {
+		cache = g_malloc0(sizeof(*cache));
+		((struct sr_dev_inst *)sdi)->meta_cache = cache;
+	}
+
+	for (i = 0; i < MIN(cache->count, META_CACHE_SIZE); i++) {
+		if (cache->keys[i] == key)
+			return &cache->values[i];
+	}
+
+	/* Take a free slot, or the one filled longest ago. */
+	i = cache->count++ % META_CACHE_SIZE;
+	cache->keys[i] = key;
+	if (cache->values[i]) {
+		g_variant_unref(cache->values[i]);
+		cache->values[i] = NULL;
+	}
+
+	return &cache->values[i];
+}
+
+/* Send and keep a new value in a slot which didn't match. */
+static int send_meta_slot(const struct sr_dev_inst *sdi, uint32_t key,
+		GVariant **slot, GVariant *var)
+{
+	if (var) {
+		if (*slot)
+			g_variant_unref(*slot);
+		*slot = g_variant_ref_sink(var);
+	}
+
+	return send_meta_value(sdi, key, *slot);
+}
+
+/**
+ * Send a boolean meta value to the session bus.
+ *
+ * Other than sr_session_send_meta(), this doesn't allocate when the
+ * same value was sent for the key before.
+ *
+ * @param sdi The device instance to send the package from. Must not be NULL.
+ * @param key The config key to send to the session bus.
+ * @param value The value to send to the session bus.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_meta_boolean(const struct sr_dev_inst *sdi,
+		uint32_t key, gboolean value)
+{
+	GVariant **slot;
+
+	slot = meta_cache_slot(sdi, key);
+	if (*slot && g_variant_is_of_type(*slot, G_VARIANT_TYPE_BOOLEAN) &&
+			!g_variant_get_boolean(*slot) == !value)
+		return send_meta_slot(sdi, key, slot, NULL);
+
+	return send_meta_slot(sdi, key, slot, g_variant_new_boolean(value));
+}
+
+/**
+ * Send an unsigned integer meta value to the session bus.
+ *
+ * @copydetails sr_session_send_meta_boolean()
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_meta_uint64(const struct sr_dev_inst *sdi,
+		uint32_t key, uint64_t value)
+{
+	GVariant **slot;
+
+	slot = meta_cache_slot(sdi, key);
+	if (*slot && g_variant_is_of_type(*slot, G_VARIANT_TYPE_UINT64) &&
+			g_variant_get_uint64(*slot) == value)
+		return send_meta_slot(sdi, key, slot, NULL);
+
+	return send_meta_slot(sdi, key, slot, g_variant_new_uint64(value));
+}
+
+/**
+ * Send a floating point meta value to the session bus.
+ *
+ * @copydetails sr_session_send_meta_boolean()
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_meta_double(const struct sr_dev_inst *sdi,
+		uint32_t key, double value)
+{
+	GVariant **slot;
+
+	slot = meta_cache_slot(sdi, key);
+	if (*slot && g_variant_is_of_type(*slot, G_VARIANT_TYPE_DOUBLE) &&
+			g_variant_get_double(*slot) == value)
+		return send_meta_slot(sdi, key, slot, NULL);
+
+	return send_meta_slot(sdi, key, slot, g_variant_new_double(value));
+}
+
+/**
+ * Send a string meta value to the session bus.
+ *
+ * @copydetails sr_session_send_meta_boolean()
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_meta_string(const struct sr_dev_inst *sdi,
+		uint32_t key, const char *value)
+{
+	GVariant **slot;
+
+	slot = meta_cache_slot(sdi, key);
+	if (*slot && g_variant_is_of_type(*slot, G_VARIANT_TYPE_STRING) &&
+			!g_strcmp0(g_variant_get_string(*slot, NULL), value))
+		return send_meta_slot(sdi, key, slot, NULL);
+
+	return send_meta_slot(sdi, key, slot, g_variant_new_string(value));
+}
+
+/**
+ * Free the meta values a device sent last.
+ *
+ * @param sdi The device instance. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_meta_cache_free(struct sr_dev_inst *sdi)
+{
+	struct sr_dev_meta_cache *cache;
+	unsigned int i;
+
+	if (!(cache = sdi->meta_cache))
+		return;
+
+	for (i = 0; i < META_CACHE_SIZE; i++) {
+		if (cache->values[i])
+			g_variant_unref(cache->values[i]);
+	}
+	g_free(cache);
+	sdi->meta_cache = NULL;
+}
+
+/* The packet which this thread dispatches, and its timestamp. */
+struct packet_stamp {
+	const struct sr_datafeed_packet *packet;
+	const struct sr_datafeed_timestamp *ts;
+};
+
+static GPrivate current_stamp;
+
+static struct sr_dev_packet_clock *packet_clock_get(const struct sr_dev_inst *sdi)
+{
+	struct sr_dev_packet_clock *clock;
+
+	if (!(clock = sdi->packet_clock)) {
+		clock = g_malloc0(sizeof(*clock));
+		clock->analog_pos = g_array_new(FALSE, TRUE, sizeof(uint64_t));
+		((struct sr_dev_inst *)sdi)->packet_clock = clock;
+	}
+
+	return clock;
+}
+
+/* Microseconds per sample of a device, 0 if unknown. */
+static double packet_clock_slope(const struct sr_dev_packet_clock *clock)
+{
+	if (clock->fit_n >= 2 && clock->fit_m2x > 0)
+		return clock->fit_cxy / clock->fit_m2x;
+	if (clock->samplerate)
+		return 1e6 / clock->samplerate;
+
+	return 0;
+}
+
+/*
+ * Account a data packet which ends at sample position @a pos + @a count
+ * and was received at @a host_us in the fit of the device's clock, and
+ * return the aligned time of the packet's first sample.
+ *
+ * The host times include the transfer latency of the device, they are
+ * the times at which the samples were received rather than sampled.
+ * The fit evens out their jitter, and the alignment of the devices is
+ * off by the difference of their average latencies.
+ */
+static int64_t packet_clock_align(struct sr_dev_packet_clock *clock,
+		int stream, uint64_t pos, uint64_t count, int64_t host_us)
+{
+	double x, y, dx, slope;
+	int64_t aligned_us;
+
+	if (!clock->fit_started) {
+		clock->fit_started = TRUE;
+		clock->fit_stream = stream;
+		clock->fit_x0 = pos + count;
+		clock->fit_y0 = host_us;
+		clock->fit_n = 0;
+		clock->fit_mean_x = clock->fit_mean_y = 0;
+		clock->fit_m2x = clock->fit_cxy = 0;
+	}
+
+	if (stream != clock->fit_stream) {
+		/* Not the stream which the fit tracks, no better guess. */
+		slope = 1e6 / MAX(clock->samplerate, 1);
+		return clock->samplerate ? host_us - (int64_t)(slope * count)
+			: host_us;
+	}
+
+	/* Welford's update of the means and the (co)variance. */
+	x = (double)(pos + count - clock->fit_x0);
+	y = (double)(host_us - clock->fit_y0);
+	clock->fit_n++;
+	dx = x - clock->fit_mean_x;
+	clock->fit_mean_x += dx / clock->fit_n;
+	clock->fit_mean_y += (y - clock->fit_mean_y) / clock->fit_n;
+	clock->fit_m2x += dx * (x - clock->fit_mean_x);
+	clock->fit_cxy += dx * (y - clock->fit_mean_y);
+
+	slope = packet_clock_slope(clock);
+	if (clock->fit_n >= 2 && clock->fit_m2x > 0) {
+		aligned_us = clock->fit_y0 + (int64_t)(clock->fit_mean_y
+			+ slope * ((double)pos - clock->fit_x0 - clock->fit_mean_x));
+	} else {
+		aligned_us = host_us - (int64_t)(slope * count);
+	}
+	clock->aligned_end_us = aligned_us + (int64_t)(slope * count);
+
+	return aligned_us;
+}
+
+/*
+ * Advance the sample positions of a device by a packet it sends, and
+ * fill in the packet's timestamp. Returns FALSE for packets other than
+ * logic and analog data, those have no timestamp.
+ */
+static gboolean packet_clock_stamp(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_timestamp *ts)
+{
+	struct sr_dev_packet_clock *clock;
+	const struct sr_datafeed_meta *meta;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_channel *ch;
+	const struct sr_config *src;
+	uint64_t *pos, num_samples;
+	GSList *l;
+	int stream;
+
+	clock = packet_clock_get(sdi);
+
+	stream = -1;
+	switch (packet->type) {
+	case SR_DF_HEADER:
+		/* A new acquisition starts over. */
+		g_mutex_lock(&sdi->session->stats_mutex);
+		clock->receive_us = 0;
+		clock->logic_pos = 0;
+		g_array_set_size(clock->analog_pos, 0);
+		clock->fit_started = FALSE;
+		clock->fit_n = 0;
+		clock->aligned_end_us = 0;
+		g_mutex_unlock(&sdi->session->stats_mutex);
+		return FALSE;
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key == SR_CONF_SAMPLERATE)
+				clock->samplerate = g_variant_get_uint64(src->data);
+		}
+		return FALSE;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		ts->sample_pos = clock->logic_pos;
+		num_samples = logic->unitsize ? logic->length / logic->unitsize : 0;
+		clock->logic_pos += num_samples;
+		break;
+	case SR_DF_LOGIC_RLE:
+		ts->sample_pos = clock->logic_pos;
+		num_samples = sr_logic_rle_num_samples(packet->payload);
+		clock->logic_pos += num_samples;
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		ts->sample_pos = clock->logic_pos;
+		num_samples = ((const struct sr_datafeed_logic_planar *)
+			packet->payload)->num_samples;
+		clock->logic_pos += num_samples;
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		ts->sample_pos = 0;
+		num_samples = analog->num_samples;
+		for (l = analog->meaning->channels; l; l = l->next) {
+			ch = l->data;
+			if ((guint)ch->index >= clock->analog_pos->len)
+				g_array_set_size(clock->analog_pos, ch->index + 1);
+			pos = &g_array_index(clock->analog_pos, uint64_t, ch->index);
+			if (l == analog->meaning->channels) {
+				ts->sample_pos = *pos;
+				stream = ch->index;
+			}
+			*pos += num_samples;
+		}
+		break;
+	default:
+		return FALSE;
+	}
+
+	ts->host_us = clock->receive_us;
+	if (!ts->host_us)
+		ts->host_us = g_get_monotonic_time();
+
+	g_mutex_lock(&sdi->session->stats_mutex);
+	ts->aligned_us = packet_clock_align(clock, stream,
+		ts->sample_pos, num_samples, ts->host_us);
+	g_mutex_unlock(&sdi->session->stats_mutex);
+
+	return TRUE;
+}
+
+/**
+ * Set the time at which a device's data was received.
+ *
+ * Drivers call this when data arrives, e.g. in the completion of a USB
+ * transfer, from the thread which sends the device's packets. The data
+ * packets which the device sends from then on carry this time in their
+ * timestamp, see sr_packet_timestamp_get(). Without it, the packets
+ * carry the time at which they were sent.
+ *
+ * @param sdi The device instance. Must not be NULL.
+ * @param host_us The monotonic time at which the data was received, in us.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_receive_time_set(const struct sr_dev_inst *sdi,
+		int64_t host_us)
+{
+	packet_clock_get(sdi)->receive_us = host_us;
+}
+
+/**
+ * Free the packet timing of a device.
+ *
+ * @param sdi The device instance. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_packet_clock_free(struct sr_dev_inst *sdi)
+{
+	struct sr_dev_packet_clock *clock;
+
+	if (!(clock = sdi->packet_clock))
+		return;
+
+	g_array_free(clock->analog_pos, TRUE);
+	g_free(clock);
+	sdi->packet_clock = NULL;
+}
+
+/**
+ * Get the clock estimate of a device in a session.
+ *
+ * The session fits the host times at which the data of each device was
+ * received over the positions of its samples. The offset and the drift
+ * between two devices follow from their estimates. These include the
+ * transfer latency of the devices, the difference of their average
+ * latencies remains as an error of the alignment.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param sdi The device. Must not be NULL.
+ * @param clock Pointer to store the estimate at. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The device didn't send enough data yet.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_clock_get(struct sr_session *session,
+		const struct sr_dev_inst *sdi, struct sr_session_clock *clock)
+{
+	const struct sr_dev_packet_clock *pc;
+	double slope;
+	int ret;
+
+	if (!session || !sdi || !clock)
+		return SR_ERR_ARG;
+
+	memset(clock, 0, sizeof(*clock));
+	ret = SR_ERR_NA;
+	g_mutex_lock(&session->stats_mutex);
+	pc = sdi->packet_clock;
+	if (pc && pc->fit_n >= 2 && pc->fit_m2x > 0) {
+		slope = packet_clock_slope(pc);
+		clock->samplerate = 1e6 / slope;
+		if (pc->samplerate)
+			clock->drift_ppm = 1e6 * (clock->samplerate
+				/ pc->samplerate - 1);
+		clock->offset_us = pc->fit_y0 + (int64_t)(pc->fit_mean_y
+			- slope * ((double)pc->fit_x0 + pc->fit_mean_x));
+		clock->packets = pc->fit_n;
+		ret = SR_OK;
+	}
+	g_mutex_unlock(&session->stats_mutex);
+
+	return ret;
+}
+
+/*
+ * Check whether a packet matches the subscription of a datafeed callback.
+ * Data packets pass the channel filter when they carry at least one of
+ * the subscribed channels. Other packets are only subject to the type
+ * mask.
+ *
+ * An expanded packet is the dense SR_DF_LOGIC form of an SR_DF_LOGIC_RLE
+ * or SR_DF_LOGIC_PLANAR packet, @a expanded_from is the type of that
+ * packet (0 for packets which are not expanded). Only callbacks which
+ * did not get the original packet itself want it.
+ */
+static gboolean datafeed_callback_wants(const struct datafeed_callback *cb_struct,
+		const struct sr_dev_inst *sdi, const struct sr_datafeed_packet *packet,
+		int expanded_from)
+{
+	const struct sr_datafeed_analog *analog;
+	const struct sr_channel *ch;
+	GSList *l;
+
+	if (!(cb_struct->type_mask & SR_DF_TYPE_MASK(packet->type)))
+		return FALSE;
+	if (expanded_from
+			&& (cb_struct->type_mask & SR_DF_TYPE_MASK(expanded_from)))
+		return FALSE;
+	if (!cb_struct->channels)
+		return TRUE;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+	case SR_DF_LOGIC_RLE:
+	case SR_DF_LOGIC_PLANAR:
+		for (l = cb_struct->channels; l; l = l->next) {
+			ch = l->data;
+			if (ch->sdi == sdi && ch->type == SR_CHANNEL_LOGIC)
+				return TRUE;
+		}
+		return FALSE;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		for (l = analog->meaning->channels; l; l = l->next) {
+			if (g_slist_find(cb_struct->channels, l->data))
+				return TRUE;
+		}
+		return FALSE;
+	default:
+		return TRUE;
+	}
+}
+
+/*
+ * Put an item into the queue of a datafeed callback's consumer thread.
+ * Returns SR_ERR when the item could not be queued and the session's
+ * overflow policy asks for the session to fail.
+ */
+static int datafeed_enqueue(struct datafeed_callback *cb_struct,
+		struct datafeed_item *item)
 {
-	struct sr_config *cfg;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_meta meta;
-	int ret;
-
-	cfg = sr_config_new(key, var);
+	struct sr_session *session;
+	gboolean is_data;
+	size_t pos;
+
+	session = cb_struct->session;
+	is_data = item->packet->type == SR_DF_LOGIC
+		|| item->packet->type == SR_DF_LOGIC_RLE
+		|| item->packet->type == SR_DF_LOGIC_PLANAR
+		|| item->packet->type == SR_DF_ANALOG;
+
+	g_mutex_lock(&cb_struct->mutex);
+	while (cb_struct->queue_count == cb_struct->queue_size
+			&& !cb_struct->quit) {
+		if (is_data && (session->df_failed
+				|| session->df_overflow != SR_DF_OVERFLOW_BLOCK)) {
+			cb_struct->dropped++;
+			g_mutex_unlock(&cb_struct->mutex);
+			session_stats_dropped(session, item->sdi);
+			if (session->df_overflow == SR_DF_OVERFLOW_FAIL_SESSION)
+				return SR_ERR;
+			return SR_OK;
+		}
+		g_cond_wait(&cb_struct->cond, &cb_struct->mutex);
+	}
+	if (!cb_struct->quit) {
+		pos = cb_struct->queue_head + cb_struct->queue_count;
+		pos %= cb_struct->queue_size;
+		g_atomic_int_inc(&item->refcount);
+		cb_struct->queue[pos] = item;
+		cb_struct->queue_count++;
+		g_cond_signal(&cb_struct->cond);
+	}
+	g_mutex_unlock(&cb_struct->mutex);
 
-	memset(&meta, 0, sizeof(meta));
+	return SR_OK;
+}
 
-	packet.type = SR_DF_META;
-	packet.payload = &meta;
+static int datafeed_dispatch_threaded(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, int expanded_from)
+{
+	struct sr_session *session;
+	struct datafeed_callback *cb_struct;
+	struct datafeed_item *item;
+	GSource *source;
+	GSList *l;
+	int ret, cb_ret;
 
-	meta.config = g_slist_append(NULL, cfg);
+	session = sdi->session;
 
-	ret = sr_session_send(sdi, &packet);
-	g_slist_free(meta.config);
-	sr_config_free(cfg);
+	ret = SR_OK;
+	item = NULL;
+	for (l = session->datafeed_callbacks; l; l = l->next) {
+		cb_struct = l->data;
+		if (!datafeed_callback_wants(cb_struct, sdi, packet,
+					expanded_from))
+			continue;
+		if (!cb_struct->thread) {
+			datafeed_callback_run(session, cb_struct, sdi, packet);
+			continue;
+		}
+		/* Only reference the packet when a consumer wants it. */
+		if (!item) {
+			item = g_malloc0(sizeof(*item));
+			item->refcount = 1;
+			item->sdi = sdi;
+			if (sr_packet_ref(packet, &item->packet) != SR_OK) {
+				g_free(item);
+				return SR_ERR;
+			}
+		}
+		cb_ret = datafeed_enqueue(cb_struct, item);
+		if (cb_ret != SR_OK)
+			ret = cb_ret;
+	}
+	if (item)
+		datafeed_item_unref(item);
+
+	if (ret != SR_OK && !session->df_failed) {
+		sr_err("Datafeed queue overflow, stopping session.");
+		session->df_failed = TRUE;
+		/* Don't re-enter the driver from within its send call. */
+		source = g_idle_source_new();
+		g_source_set_callback(source, &session_stop_sync, session, NULL);
+		session_source_attach(session, source);
+		g_source_unref(source);
+	}
 
 	return ret;
 }
@@ -1124,10 +3569,8 @@ SR_PRIV int sr_session_send_meta(const struct sr_dev_inst *sdi,
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet)
 {
-	GSList *l;
-	struct datafeed_callback *cb_struct;
-	struct sr_datafeed_packet *packet_in, *packet_out;
-	struct sr_transform *t;
+	struct sr_datafeed_timestamp ts, *pts;
+	gboolean consumed;
 	int ret;
 
 	if (!sdi) {
@@ -1145,16 +3588,65 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		return SR_ERR_BUG;
 	}
 
+	sr_trace3(send_entry, sdi, packet->type, packet_data_size(packet));
+	session_stats_account(sdi, packet);
+
+	session_send_lock(sdi->session);
+	pts = packet_clock_stamp(sdi, packet, &ts) ? &ts : NULL;
+	consumed = FALSE;
+	if (sdi->session->coalesce_max_samples > 1)
+		ret = coalesce_packet(sdi, packet, pts, &consumed);
+	if (!consumed)
+		ret = session_send_packet(sdi, packet, pts);
+	session_send_unlock(sdi->session);
+	sr_trace3(send_return, sdi, packet->type, ret);
+
+	return ret;
+}
+
+/* Run a packet through the transforms, and pass it to the callbacks. */
+static int session_send_packet(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		const struct sr_datafeed_timestamp *ts)
+{
+	GSList *l;
+	struct sr_datafeed_packet *packet_in, *packet_out;
+	struct sr_transform *t;
+	gboolean timed;
+	int64_t start, now;
+	int ret;
+
 	/*
 	 * Pass the packet to the first transform module. If that returns
 	 * another packet (instead of NULL), pass that packet to the next
-	 * transform module in the list, and so on.
+	 * transform module in the list, and so on. When the stages get
+	 * timed, the end of one transform's run is the start of the next.
 	 */
 	packet_in = (struct sr_datafeed_packet *)packet;
+	timed = sdi->session->transforms
+		&& g_atomic_int_get(&sdi->session->stats_enabled);
+	now = timed ? g_get_monotonic_time() : 0;
 	for (l = sdi->session->transforms; l; l = l->next) {
 		t = l->data;
 		sr_spew("Running transform module '%s'.", t->module->id);
+		start = now;
+		/* Don't let in-place transforms modify shared sample data. */
+		if ((t->module->flags & SR_TRANSFORM_INPLACE)
+				&& sr_packet_is_shared(packet_in)) {
+			ret = sr_transform_packet_cow(t, packet_in, &packet_in);
+			if (ret != SR_OK) {
+				sr_err("Cannot copy packet for transform module.");
+				return ret;
+			}
+		}
+		sr_trace3(transform_entry, sdi, t->module->id, packet_in->type);
 		ret = t->module->receive(t, packet_in, &packet_out);
+		if (timed) {
+			now = g_get_monotonic_time();
+			stage_stats_account(sdi->session, &t->stats,
+				packet_in, now - start);
+		}
+		sr_trace3(transform_return, sdi, t->module->id, ret);
 		if (ret < 0) {
 			sr_err("Error while running transform module: %d.", ret);
 			return SR_ERR;
@@ -1178,16 +3670,125 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 
 	/*
 	 * If the last transform did output a packet, pass it to all datafeed
-	 * callbacks.
+	 * callbacks, in time order with the other devices' data if wanted.
 	 */
+	if (sdi->session->align_latency_us && sdi->session->running)
+		return align_packet(sdi, packet, ts);
+
+	return session_deliver(sdi, packet, ts);
+}
+
+static int session_deliver(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		const struct sr_datafeed_timestamp *ts)
+{
+	int ret;
+
+	ret = session_dispatch(sdi, packet, 0, ts);
+	if (ret == SR_OK && (packet->type == SR_DF_LOGIC_RLE
+			|| packet->type == SR_DF_LOGIC_PLANAR))
+		ret = session_dispatch_expanded(sdi, packet, ts);
+
+	return ret;
+}
+
+static int session_dispatch(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, int expanded_from,
+		const struct sr_datafeed_timestamp *ts)
+{
+	GSList *l;
+	struct datafeed_callback *cb_struct;
+	struct packet_stamp stamp, *prev;
+	int ret;
+
+	/* Dump the packet once, not for every callback it's passed to. */
+	if (sr_log_loglevel_get() >= SR_LOG_DBG && sdi->session->datafeed_callbacks)
+		datafeed_dump(packet);
+
+	/* Callbacks and queued references see the packet's timestamp. */
+	prev = g_private_get(&current_stamp);
+	stamp.packet = packet;
+	stamp.ts = ts;
+	g_private_set(&current_stamp, &stamp);
+
+	ret = SR_OK;
+	if (sdi->session->df_queue_depth && sdi->session->running) {
+		ret = datafeed_dispatch_threaded(sdi, packet, expanded_from);
+	} else {
+		for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
+			cb_struct = l->data;
+			if (!datafeed_callback_wants(cb_struct, sdi, packet,
+					expanded_from))
+				continue;
+			datafeed_callback_run(sdi->session, cb_struct, sdi, packet);
+		}
+	}
+
+	g_private_set(&current_stamp, prev);
+
+	return ret;
+}
+
+/*
+ * Pass an SR_DF_LOGIC_RLE or SR_DF_LOGIC_PLANAR packet in its dense
+ * SR_DF_LOGIC form to the callbacks which haven't subscribed to the
+ * packet's type. The packet is only decoded when at least one such
+ * callback exists.
+ */
+static int session_dispatch_expanded(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet,
+		const struct sr_datafeed_timestamp *ts)
+{
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_datafeed_logic_planar *planar;
+	struct sr_datafeed_packet logic_packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_packet dense;
+	GSList *l;
+	uint64_t num_samples;
+	int ret;
+
+	logic_packet.type = SR_DF_LOGIC;
+	logic_packet.payload = NULL;
 	for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
-		if (sr_log_loglevel_get() >= SR_LOG_DBG)
-			datafeed_dump(packet);
-		cb_struct = l->data;
-		cb_struct->cb(sdi, packet, cb_struct->cb_data);
+		if (datafeed_callback_wants(l->data, sdi, &logic_packet,
+				packet->type))
+			break;
 	}
+	if (!l)
+		return SR_OK;
 
-	return SR_OK;
+	rle = NULL;
+	planar = NULL;
+	if (packet->type == SR_DF_LOGIC_RLE) {
+		rle = packet->payload;
+		num_samples = sr_logic_rle_num_samples(rle);
+		logic.unitsize = rle->unitsize;
+	} else {
+		planar = packet->payload;
+		num_samples = planar->num_samples;
+		logic.unitsize = planar->unitsize;
+	}
+	if (!num_samples)
+		return SR_OK;
+	logic.length = num_samples * logic.unitsize;
+	logic.data = g_try_malloc(logic.length);
+	if (!logic.data) {
+		sr_err("Cannot expand packet of %" PRIu64 " samples.",
+			num_samples);
+		return SR_ERR_MALLOC;
+	}
+	if (rle)
+		sr_logic_rle_decode(rle, logic.data);
+	else
+		sr_logic_planar_decode(planar, logic.data);
+
+	dense.type = SR_DF_LOGIC;
+	dense.payload = &logic;
+	ret = session_dispatch(sdi, &dense, packet->type, ts);
+	g_free(logic.data);
+
+	return ret;
 }
 
 /**
@@ -1213,13 +3814,16 @@ SR_PRIV int sr_session_source_add_internal(struct sr_session *session,
 	 * already installed source. (Well it would, if we did not have
 	 * another sanity check there.)
 	 */
+	g_mutex_lock(&session->main_mutex);
 	if (g_hash_table_contains(session->event_sources, key)) {
+		g_mutex_unlock(&session->main_mutex);
 		sr_err("Event source with key %p already exists.", key);
 		return SR_ERR_BUG;
 	}
 	g_hash_table_insert(session->event_sources, key, source);
+	g_mutex_unlock(&session->main_mutex);
 
-	if (session_source_attach(session, source) == 0)
+	if (dev_source_attach(session, source) == 0)
 		return SR_ERR;
 
 	return SR_OK;
@@ -1357,7 +3961,9 @@ SR_PRIV int sr_session_source_remove_internal(struct sr_session *session,
 {
 	GSource *source;
 
+	g_mutex_lock(&session->main_mutex);
 	source = g_hash_table_lookup(session->event_sources, key);
+	g_mutex_unlock(&session->main_mutex);
 	/*
 	 * Trying to remove an already removed event source is problematic
 	 * since the poll_object handle may have been reused in the meantime.
@@ -1435,49 +4041,363 @@ SR_PRIV int sr_session_source_remove_channel(struct sr_session *session,
 	return sr_session_source_remove_internal(session, channel);
 }
 
-/** Unregister an event source that has been destroyed.
+/** Unregister an event source that has been destroyed.
+ *
+ * This is intended to be called from a source's finalize() method.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param key The key used to identify @a source.
+ * @param source The source object that was destroyed.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_BUG Event source for @a key does not match @a source.
+ * @retval SR_ERR Other error.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_source_destroyed(struct sr_session *session,
+		void *key, GSource *source)
+{
+	GSource *registered_source;
+	unsigned int num_sources;
+
+	g_mutex_lock(&session->main_mutex);
+	registered_source = g_hash_table_lookup(session->event_sources, key);
+	/*
+	 * Trying to remove an already removed event source is problematic
+	 * since the poll_object handle may have been reused in the meantime.
+	 */
+	if (!registered_source) {
+		g_mutex_unlock(&session->main_mutex);
+		sr_err("No event source for key %p found.", key);
+		return SR_ERR_BUG;
+	}
+	if (registered_source != source) {
+		g_mutex_unlock(&session->main_mutex);
+		sr_err("Event source for key %p does not match"
+			" destroyed source.", key);
+		return SR_ERR_BUG;
+	}
+	g_hash_table_remove(session->event_sources, key);
+	num_sources = g_hash_table_size(session->event_sources);
+	g_mutex_unlock(&session->main_mutex);
+
+	if (num_sources > 0)
+		return SR_OK;
+
+	/* If no event sources are left, consider the acquisition finished.
+	 * This is pretty crude, as it requires all event sources to be
+	 * registered via the libsigrok API.
+	 */
+	return stop_check_later(session);
+}
+
+/*
+ * Periodic polls of drivers.
+ *
+ * Every poll is an event source of its own, but the polls of a session
+ * share their wakeups: each poll may run up to its slack behind its
+ * schedule, and the session's main loop only wakes up when the first
+ * poll runs out of slack. All polls which are due by then get
+ * dispatched in the same iteration. Polls which run in device worker
+ * threads wake up on their own.
+ */
+struct poll_source {
+	GSource base;
+
+	struct sr_session *session;
+	const struct sr_dev_inst *sdi;
+	int64_t interval_us;
+	int64_t slack_us;
+	int64_t due_us;
+	/* Whether the poll shares the wakeups of the session's main loop. */
+	gboolean shared;
+};
+
+/* Update the session's wakeup time. Call with the main mutex held. */
+static void poll_wake_update(struct sr_session *session)
+{
+	struct poll_source *psource;
+	int64_t wake_us;
+	GSList *l;
+
+	wake_us = INT64_MAX;
+	for (l = session->polls; l; l = l->next) {
+		psource = l->data;
+		if (psource->shared)
+			wake_us = MIN(wake_us, psource->due_us + psource->slack_us);
+	}
+	session->poll_wake_us = wake_us;
+}
+
+static void poll_stats_account(struct sr_session_stats *stats,
+		uint64_t late_us)
+{
+	stats->polls++;
+	stats->poll_late_total_us += late_us;
+	stats->poll_late_max_us = MAX(stats->poll_late_max_us, late_us);
+}
+
+static gboolean poll_source_prepare(GSource *source, int *timeout)
+{
+	struct poll_source *psource;
+	int64_t now_us, wake_us;
+
+	psource = (struct poll_source *)source;
+	now_us = g_source_get_time(source);
+
+	if (psource->shared) {
+		g_mutex_lock(&psource->session->main_mutex);
+		wake_us = psource->session->poll_wake_us;
+		g_mutex_unlock(&psource->session->main_mutex);
+	} else {
+		wake_us = psource->due_us + psource->slack_us;
+	}
+	if (wake_us > now_us) {
+		*timeout = MIN((wake_us - now_us + 999) / 1000, G_MAXINT);
+		return FALSE;
+	}
+	*timeout = 0;
+
+	return psource->due_us <= now_us;
+}
+
+/*
+ * Polls which are due but still have slack run when the main loop
+ * wakes up for other reasons.
+ */
+static gboolean poll_source_check(GSource *source)
+{
+	struct poll_source *psource;
+
+	psource = (struct poll_source *)source;
+
+	return psource->due_us <= g_source_get_time(source);
+}
+
+static gboolean poll_source_dispatch(GSource *source,
+		GSourceFunc callback, void *user_data)
+{
+	struct poll_source *psource;
+	struct sr_session *session;
+	int64_t now_us;
+	uint64_t late_us;
+	gboolean keep;
+
+	psource = (struct poll_source *)source;
+	session = psource->session;
+
+	if (!callback) {
+		sr_err("Callback not set, cannot dispatch poll.");
+		return G_SOURCE_REMOVE;
+	}
+
+	now_us = g_source_get_time(source);
+	late_us = MAX(0, now_us - psource->due_us);
+	g_mutex_lock(&session->stats_mutex);
+	poll_stats_account(&session->stats, late_us);
+	poll_stats_account(dev_stats_get(session, psource->sdi), late_us);
+	g_mutex_unlock(&session->stats_mutex);
+
+	keep = (*SR_RECEIVE_DATA_CALLBACK(callback))(-1, 0, user_data);
+
+	/* Keep the phase, but skip the polls which were missed. */
+	g_mutex_lock(&session->main_mutex);
+	psource->due_us += psource->interval_us;
+	if (psource->due_us <= now_us)
+		psource->due_us = now_us + psource->interval_us;
+	if (psource->shared)
+		poll_wake_update(session);
+	g_mutex_unlock(&session->main_mutex);
+
+	return keep;
+}
+
+static void poll_source_finalize(GSource *source)
+{
+	struct poll_source *psource;
+	struct sr_session *session;
+
+	psource = (struct poll_source *)source;
+	session = psource->session;
+
+	sr_dbg("%s: key %p", __func__, (void *)psource->sdi);
+
+	g_mutex_lock(&session->main_mutex);
+	session->polls = g_slist_remove(session->polls, psource);
+	poll_wake_update(session);
+	g_mutex_unlock(&session->main_mutex);
+
+	sr_session_source_destroyed(session, (void *)psource->sdi, source);
+}
+
+/**
+ * Poll a device periodically.
+ *
+ * Unlike timer sources added with sr_session_source_add(), the polls
+ * of a session share their wakeups. The callback gets invoked every
+ * @a interval_ms, but may run up to @a slack_ms late, so that it can
+ * run along with the polls of other devices. Polls which the main loop
+ * could not keep up with are skipped. The lateness of the polls is
+ * part of the device's statistics, see sr_session_stats_get().
+ *
+ * The poll is identified by its device, a device can have one poll.
+ * It ends when the callback returns FALSE, or with
+ * sr_session_poll_remove().
+ *
+ * @param sdi The device to poll. Must not be NULL, and be part of a session.
+ * @param interval_ms The poll interval in ms. Must be positive.
+ * @param slack_ms The time in ms by which polls may be late.
+ * @param cb Callback function to add. Must not be NULL. It gets invoked
+ *           with a file descriptor of -1 and no events.
+ * @param cb_data Data for the callback function. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_BUG The device already has a poll.
+ * @retval SR_ERR Other error.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_poll_add(const struct sr_dev_inst *sdi,
+		int interval_ms, int slack_ms, sr_receive_data_callback cb,
+		void *cb_data)
+{
+	static GSourceFuncs poll_source_funcs = {
+		.prepare  = &poll_source_prepare,
+		.check    = &poll_source_check,
+		.dispatch = &poll_source_dispatch,
+		.finalize = &poll_source_finalize
+	};
+	struct sr_session *session;
+	struct poll_source *psource;
+	GSource *source;
+	int ret;
+
+	if (!sdi || !(session = sdi->session) || interval_ms <= 0
+			|| slack_ms < 0 || !cb)
+		return SR_ERR_ARG;
+
+	source = g_source_new(&poll_source_funcs, sizeof(struct poll_source));
+	g_source_set_name(source, "poll");
+	g_source_set_callback(source, G_SOURCE_FUNC(cb), cb_data, NULL);
+	psource = (struct poll_source *)source;
+	psource->session = session;
+	psource->sdi = sdi;
+	psource->interval_us = 1000 * (int64_t)interval_ms;
+	psource->slack_us = 1000 * (int64_t)slack_ms;
+	psource->due_us = g_get_monotonic_time() + psource->interval_us;
+
+	g_mutex_lock(&session->main_mutex);
+	session->polls = g_slist_prepend(session->polls, psource);
+	g_mutex_unlock(&session->main_mutex);
+
+	ret = sr_session_source_add_internal(session, (void *)sdi, source);
+
+	g_mutex_lock(&session->main_mutex);
+	psource->shared = g_source_get_context(source) == session->main_context;
+	poll_wake_update(session);
+	g_mutex_unlock(&session->main_mutex);
+	g_source_unref(source);
+
+	return ret;
+}
+
+/**
+ * Stop polling a device.
+ *
+ * @param sdi The device. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_BUG The device has no poll.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_poll_remove(const struct sr_dev_inst *sdi)
+{
+	if (!sdi || !sdi->session)
+		return SR_ERR_ARG;
+
+	return sr_session_source_remove_internal(sdi->session, (void *)sdi);
+}
+
+/*
+ * Refcounted packets.
  *
- * This is intended to be called from a source's finalize() method.
+ * Packets created by the core (copies and wrapped driver buffers) are
+ * registered here, so that sr_packet_ref() can share them instead of
+ * copying the payload again. The sample data of a wrapped packet is
+ * owned by its creator until the last reference drops, at which point
+ * the release callback is invoked.
+ */
+struct packet_ref {
+	int refcount;
+	/* The sample data is the creator's, see sr_packet_wrap(). */
+	gboolean wrapped;
+	GDestroyNotify release;
+	void *release_data;
+	/* Copies and references keep the timestamp of the sent packet. */
+	gboolean has_ts;
+	struct sr_datafeed_timestamp ts;
+};
+
+static GHashTable *packet_refs;
+G_LOCK_DEFINE_STATIC(packet_refs);
+
+/* The timestamp of the packet which this thread dispatches, if any. */
+static const struct sr_datafeed_timestamp *packet_stamp_get(
+		const struct sr_datafeed_packet *packet)
+{
+	const struct packet_stamp *stamp;
+
+	stamp = g_private_get(&current_stamp);
+	if (!stamp || stamp->packet != packet)
+		return NULL;
+
+	return stamp->ts;
+}
+
+static void packet_ref_register(struct sr_datafeed_packet *packet,
+		gboolean wrapped, GDestroyNotify release, void *release_data)
+{
+	struct packet_ref *ref;
+
+	ref = g_malloc0(sizeof(*ref));
+	ref->refcount = 1;
+	ref->wrapped = wrapped;
+	ref->release = release;
+	ref->release_data = release_data;
+
+	G_LOCK(packet_refs);
+	if (!packet_refs)
+		packet_refs = g_hash_table_new(NULL, NULL);
+	g_hash_table_insert(packet_refs, packet, ref);
+	G_UNLOCK(packet_refs);
+}
+
+/**
+ * Check whether a packet has references other than the caller's.
  *
- * @param session The session to use. Must not be NULL.
- * @param key The key used to identify @a source.
- * @param source The source object that was destroyed.
+ * @param packet The packet to check. Must not be NULL.
  *
- * @retval SR_OK Success.
- * @retval SR_ERR_BUG Event source for @a key does not match @a source.
- * @retval SR_ERR Other error.
+ * @return TRUE if the packet is refcounted and has several references,
+ *         FALSE if it is not refcounted or only has a single reference.
  *
  * @private
  */
-SR_PRIV int sr_session_source_destroyed(struct sr_session *session,
-		void *key, GSource *source)
+SR_PRIV gboolean sr_packet_is_shared(const struct sr_datafeed_packet *packet)
 {
-	GSource *registered_source;
-
-	registered_source = g_hash_table_lookup(session->event_sources, key);
-	/*
-	 * Trying to remove an already removed event source is problematic
-	 * since the poll_object handle may have been reused in the meantime.
-	 */
-	if (!registered_source) {
-		sr_err("No event source for key %p found.", key);
-		return SR_ERR_BUG;
-	}
-	if (registered_source != source) {
-		sr_err("Event source for key %p does not match"
-			" destroyed source.", key);
-		return SR_ERR_BUG;
-	}
-	g_hash_table_remove(session->event_sources, key);
+	struct packet_ref *ref;
+	gboolean shared;
 
-	if (g_hash_table_size(session->event_sources) > 0)
-		return SR_OK;
+	shared = FALSE;
+	G_LOCK(packet_refs);
+	if (packet_refs && (ref = g_hash_table_lookup(packet_refs, packet)))
+		shared = ref->refcount > 1;
+	G_UNLOCK(packet_refs);
 
-	/* If no event sources are left, consider the acquisition finished.
-	 * This is pretty crude, as it requires all event sources to be
-	 * registered via the libsigrok API.
-	 */
-	return stop_check_later(session);
+	return shared;
 }
 
 static void copy_src(struct sr_config *src, struct sr_datafeed_meta *meta_copy)
@@ -1487,16 +4407,93 @@ static void copy_src(struct sr_config *src, struct sr_datafeed_meta *meta_copy)
 	                                   g_memdup(src, sizeof(struct sr_config)));
 }
 
-SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
-		struct sr_datafeed_packet **copy)
+static void packet_free_payload(struct sr_datafeed_packet *packet,
+		gboolean free_data)
+{
+	const struct sr_datafeed_meta *meta;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_datafeed_logic_planar *planar;
+	const struct sr_datafeed_analog *analog;
+	struct sr_config *src;
+	GSList *l;
+
+	switch (packet->type) {
+	case SR_DF_TRIGGER:
+	case SR_DF_END:
+	case SR_DF_FRAME_END:
+		/* No payload. */
+		break;
+	case SR_DF_HEADER:
+	case SR_DF_FRAME_BEGIN:
+		/* Payload is a simple struct, if any. */
+		g_free((void *)packet->payload);
+		break;
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			g_variant_unref(src->data);
+			g_free(src);
+		}
+		g_slist_free(meta->config);
+		g_free((void *)packet->payload);
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		if (free_data)
+			g_free(logic->data);
+		g_free((void *)packet->payload);
+		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		if (free_data) {
+			g_free(rle->values);
+			g_free(rle->lengths);
+		}
+		g_free((void *)packet->payload);
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet->payload;
+		if (free_data)
+			g_free(planar->data);
+		g_free((void *)packet->payload);
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		if (free_data)
+			g_free(analog->data);
+		g_free(analog->encoding);
+		g_slist_free(analog->meaning->channels);
+		g_free(analog->meaning);
+		g_free(analog->spec);
+		g_free((void *)packet->payload);
+		break;
+	default:
+		sr_err("Unknown packet type %d", packet->type);
+	}
+}
+
+/*
+ * Duplicate a packet and its payload. The sample data of logic and
+ * analog packets is only copied when @a copy_data is set, otherwise
+ * the duplicate references the caller's buffer.
+ */
+static int packet_dup(const struct sr_datafeed_packet *packet,
+		gboolean copy_data, struct sr_datafeed_packet **copy)
 {
 	const struct sr_datafeed_meta *meta;
 	struct sr_datafeed_meta *meta_copy;
 	const struct sr_datafeed_logic *logic;
 	struct sr_datafeed_logic *logic_copy;
+	const struct sr_datafeed_logic_rle *rle;
+	struct sr_datafeed_logic_rle *rle_copy;
+	const struct sr_datafeed_logic_planar *planar;
+	struct sr_datafeed_logic_planar *planar_copy;
 	const struct sr_datafeed_analog *analog;
 	struct sr_datafeed_analog *analog_copy;
 	uint8_t *payload;
+	size_t size;
 
 	*copy = g_malloc0(sizeof(struct sr_datafeed_packet));
 	(*copy)->type = packet->type;
@@ -1504,8 +4501,15 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	switch (packet->type) {
 	case SR_DF_TRIGGER:
 	case SR_DF_END:
+	case SR_DF_FRAME_END:
 		/* No payload. */
 		break;
+	case SR_DF_FRAME_BEGIN:
+		/* Optional payload, a simple struct. */
+		if (packet->payload)
+			(*copy)->payload = g_memdup(packet->payload,
+				sizeof(struct sr_datafeed_frame));
+		break;
 	case SR_DF_HEADER:
 		payload = g_malloc(sizeof(struct sr_datafeed_header));
 		memcpy(payload, packet->payload, sizeof(struct sr_datafeed_header));
@@ -1514,31 +4518,83 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 	case SR_DF_META:
 		meta = packet->payload;
 		meta_copy = g_malloc0(sizeof(struct sr_datafeed_meta));
-		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy->config);
+		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy);
 		(*copy)->payload = meta_copy;
 		break;
 	case SR_DF_LOGIC:
 		logic = packet->payload;
 		logic_copy = g_malloc(sizeof(*logic_copy));
-		if (!logic_copy)
-			return SR_ERR;
 		logic_copy->length = logic->length;
 		logic_copy->unitsize = logic->unitsize;
-		logic_copy->data = g_malloc(logic->length * logic->unitsize);
-		if (!logic_copy->data) {
-			g_free(logic_copy);
-			return SR_ERR;
+		logic_copy->data = logic->data;
+		if (copy_data) {
+			/* The logic length is in bytes, not in samples. */
+			logic_copy->data = g_try_malloc(logic->length);
+			if (logic->length && !logic_copy->data) {
+				g_free(logic_copy);
+				g_free(*copy);
+				*copy = NULL;
+				return SR_ERR_MALLOC;
+			}
+			memcpy(logic_copy->data, logic->data, logic->length);
 		}
-		memcpy(logic_copy->data, logic->data, logic->length * logic->unitsize);
 		(*copy)->payload = logic_copy;
 		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		rle_copy = g_malloc(sizeof(*rle_copy));
+		*rle_copy = *rle;
+		if (copy_data) {
+			rle_copy->values = g_try_malloc(rle->num_runs * rle->unitsize);
+			rle_copy->lengths = g_try_malloc(rle->num_runs
+				* sizeof(rle->lengths[0]));
+			if (rle->num_runs && (!rle_copy->values || !rle_copy->lengths)) {
+				g_free(rle_copy->values);
+				g_free(rle_copy->lengths);
+				g_free(rle_copy);
+				g_free(*copy);
+				*copy = NULL;
+				return SR_ERR_MALLOC;
+			}
+			memcpy(rle_copy->values, rle->values,
+				rle->num_runs * rle->unitsize);
+			memcpy(rle_copy->lengths, rle->lengths,
+				rle->num_runs * sizeof(rle->lengths[0]));
+		}
+		(*copy)->payload = rle_copy;
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet->payload;
+		planar_copy = g_malloc(sizeof(*planar_copy));
+		*planar_copy = *planar;
+		if (copy_data) {
+			size = planar->stride * planar->unitsize * 8;
+			planar_copy->data = g_try_malloc(size);
+			if (size && !planar_copy->data) {
+				g_free(planar_copy);
+				g_free(*copy);
+				*copy = NULL;
+				return SR_ERR_MALLOC;
+			}
+			memcpy(planar_copy->data, planar->data, size);
+		}
+		(*copy)->payload = planar_copy;
+		break;
 	case SR_DF_ANALOG:
 		analog = packet->payload;
 		analog_copy = g_malloc(sizeof(*analog_copy));
-		analog_copy->data = g_malloc(
-				analog->encoding->unitsize * analog->num_samples);
-		memcpy(analog_copy->data, analog->data,
-				analog->encoding->unitsize * analog->num_samples);
+		analog_copy->data = analog->data;
+		if (copy_data) {
+			size = analog->encoding->unitsize * analog->num_samples;
+			analog_copy->data = g_try_malloc(size);
+			if (size && !analog_copy->data) {
+				g_free(analog_copy);
+				g_free(*copy);
+				*copy = NULL;
+				return SR_ERR_MALLOC;
+			}
+			memcpy(analog_copy->data, analog->data, size);
+		}
 		analog_copy->num_samples = analog->num_samples;
 		analog_copy->encoding = g_memdup(analog->encoding,
 				sizeof(struct sr_analog_encoding));
@@ -1552,57 +4608,250 @@ SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		break;
 	default:
 		sr_err("Unknown packet type %d", packet->type);
+		g_free(*copy);
+		*copy = NULL;
 		return SR_ERR;
 	}
 
 	return SR_OK;
 }
 
-SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
+/**
+ * Create a copy of a datafeed packet.
+ *
+ * The copy is refcounted, and starts with a single reference which the
+ * caller owns. Release it with sr_packet_free() or sr_packet_unref().
+ *
+ * @param packet The packet to copy. Must not be NULL.
+ * @param copy Pointer to store the copy at. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_MALLOC Not enough memory to copy the sample data.
+ * @retval SR_ERR Unknown packet type.
+ *
+ * @since 0.4.0
+ */
+SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_packet **copy)
 {
-	const struct sr_datafeed_meta *meta;
-	const struct sr_datafeed_logic *logic;
-	const struct sr_datafeed_analog *analog;
-	struct sr_config *src;
-	GSList *l;
+	struct sr_datafeed_timestamp ts;
+	struct packet_ref *pref;
+	gboolean has_ts;
+	int ret;
 
-	switch (packet->type) {
-	case SR_DF_TRIGGER:
-	case SR_DF_END:
-		/* No payload. */
-		break;
-	case SR_DF_HEADER:
-		/* Payload is a simple struct. */
-		g_free((void *)packet->payload);
-		break;
-	case SR_DF_META:
-		meta = packet->payload;
-		for (l = meta->config; l; l = l->next) {
-			src = l->data;
-			g_variant_unref(src->data);
-			g_free(src);
+	ret = packet_dup(packet, TRUE, copy);
+	if (ret != SR_OK)
+		return ret;
+	has_ts = sr_packet_timestamp_get(packet, &ts) == SR_OK;
+	packet_ref_register(*copy, FALSE, NULL, NULL);
+
+	if (has_ts) {
+		G_LOCK(packet_refs);
+		pref = g_hash_table_lookup(packet_refs, *copy);
+		pref->has_ts = TRUE;
+		pref->ts = ts;
+		G_UNLOCK(packet_refs);
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Get a reference to a datafeed packet.
+ *
+ * When @a packet was created by the library (e.g. by a driver which
+ * handed over its sample buffer, or by sr_packet_copy()), the packet's
+ * reference count is incremented and the very same packet is returned,
+ * so that it can outlive the datafeed callback without any copying.
+ * Otherwise, a refcounted copy of the packet is created.
+ *
+ * @param packet The packet to reference. Must not be NULL.
+ * @param ref Pointer to store the referenced packet at. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_MALLOC Not enough memory to copy the sample data.
+ * @retval SR_ERR Unknown packet type.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_packet_ref(const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_packet **ref)
+{
+	const struct sr_datafeed_timestamp *ts;
+	struct packet_ref *pref;
+
+	if (!packet || !ref)
+		return SR_ERR_ARG;
+
+	ts = packet_stamp_get(packet);
+	G_LOCK(packet_refs);
+	pref = packet_refs ? g_hash_table_lookup(packet_refs, packet) : NULL;
+	if (pref) {
+		pref->refcount++;
+		if (ts && !pref->has_ts) {
+			pref->has_ts = TRUE;
+			pref->ts = *ts;
 		}
-		g_slist_free(meta->config);
-		g_free((void *)packet->payload);
-		break;
-	case SR_DF_LOGIC:
-		logic = packet->payload;
-		g_free(logic->data);
-		g_free((void *)packet->payload);
-		break;
-	case SR_DF_ANALOG:
-		analog = packet->payload;
-		g_free(analog->data);
-		g_free(analog->encoding);
-		g_slist_free(analog->meaning->channels);
-		g_free(analog->meaning);
-		g_free(analog->spec);
-		g_free((void *)packet->payload);
-		break;
-	default:
-		sr_err("Unknown packet type %d", packet->type);
 	}
+	G_UNLOCK(packet_refs);
+
+	if (!pref)
+		return sr_packet_copy(packet, ref);
+
+	*ref = (struct sr_datafeed_packet *)packet;
+
+	return SR_OK;
+}
+
+/**
+ * Drop a reference to a datafeed packet.
+ *
+ * The packet is freed when the last reference is dropped. If the
+ * packet's sample data was handed over by its creator, the creator's
+ * release callback is invoked then.
+ *
+ * @param packet The packet to unreference. Must have been obtained
+ *               from sr_packet_copy() or sr_packet_ref().
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_packet_unref(struct sr_datafeed_packet *packet)
+{
+	struct packet_ref *pref;
+
+	if (!packet)
+		return;
+
+	G_LOCK(packet_refs);
+	pref = packet_refs ? g_hash_table_lookup(packet_refs, packet) : NULL;
+	if (pref && --pref->refcount > 0) {
+		G_UNLOCK(packet_refs);
+		return;
+	}
+	if (pref)
+		g_hash_table_remove(packet_refs, packet);
+	G_UNLOCK(packet_refs);
+
+	if (pref && pref->wrapped) {
+		packet_free_payload(packet, FALSE);
+		if (pref->release)
+			pref->release(pref->release_data);
+	} else {
+		packet_free_payload(packet, TRUE);
+	}
+	g_free(pref);
 	g_free(packet);
 }
 
+/**
+ * Get the host timestamp of a datafeed packet.
+ *
+ * Logic and analog packets which a device sends carry the time at which
+ * the driver received their data, and their position in the device's
+ * sample stream. The timestamp is available for the packet which gets
+ * passed to a datafeed callback, during the callback, and for copies
+ * and references of it, see sr_packet_copy() and sr_packet_ref().
+ *
+ * @param packet The packet. Must not be NULL.
+ * @param ts Pointer to store the timestamp at. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The packet carries no timestamp.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_packet_timestamp_get(const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_timestamp *ts)
+{
+	const struct sr_datafeed_timestamp *stamp;
+	struct packet_ref *pref;
+	int ret;
+
+	if (!packet || !ts)
+		return SR_ERR_ARG;
+
+	if ((stamp = packet_stamp_get(packet))) {
+		*ts = *stamp;
+		return SR_OK;
+	}
+
+	ret = SR_ERR_NA;
+	G_LOCK(packet_refs);
+	pref = packet_refs ? g_hash_table_lookup(packet_refs, packet) : NULL;
+	if (pref && pref->has_ts) {
+		*ts = pref->ts;
+		ret = SR_OK;
+	}
+	G_UNLOCK(packet_refs);
+
+	return ret;
+}
+
+/**
+ * Free a copy of a datafeed packet.
+ *
+ * This drops the reference which was obtained by sr_packet_copy(),
+ * and is equivalent to sr_packet_unref().
+ *
+ * @param packet The packet to free.
+ *
+ * @since 0.4.0
+ */
+SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
+{
+	sr_packet_unref(packet);
+}
+
+/**
+ * Wrap a driver owned sample buffer in a refcounted packet.
+ *
+ * The logic or analog @a packet is duplicated without copying its
+ * sample data. The caller hands over the buffer which the packet's
+ * data pointer refers to, and must not modify or free it until
+ * @a release gets invoked with @a release_data, which happens when
+ * the last reference to the packet is dropped. Without @a release,
+ * the caller keeps ownership of the buffer, and must keep it valid
+ * for as long as references to the packet exist.
+ *
+ * Typical use is to create the packet, pass it to sr_session_send(),
+ * and drop the creator's reference with sr_packet_unref() right after.
+ * Consumers which retain the packet by means of sr_packet_ref() then
+ * keep the buffer alive without any copying.
+ *
+ * @param packet The logic or analog packet to wrap. Must not be NULL.
+ * @param release Callback to release the sample buffer. Can be NULL,
+ *                the buffer is never freed by the library then.
+ * @param release_data Data to pass to the release callback.
+ * @param wrapped Pointer to store the new packet at. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_packet_wrap(const struct sr_datafeed_packet *packet,
+		GDestroyNotify release, void *release_data,
+		struct sr_datafeed_packet **wrapped)
+{
+	int ret;
+
+	if (!packet || !wrapped)
+		return SR_ERR_ARG;
+	if (packet->type != SR_DF_LOGIC && packet->type != SR_DF_LOGIC_RLE
+			&& packet->type != SR_DF_LOGIC_PLANAR
+			&& packet->type != SR_DF_ANALOG) {
+		sr_err("Cannot wrap packet type %d.", packet->type);
+		return SR_ERR_ARG;
+	}
+
+	ret = packet_dup(packet, FALSE, wrapped);
+	if (ret != SR_OK)
+		return ret;
+	packet_ref_register(*wrapped, TRUE, release, release_data);
+
+	return SR_OK;
+}
+
 /** @} */
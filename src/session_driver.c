@@ -23,6 +23,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <string.h>
 #include <zip.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -32,6 +33,14 @@
 /* size of payloads sent across the session bus */
 /** @cond PRIVATE */
 #define CHUNKSIZE (4 * 1024 * 1024)
+/* Time to yield to the consumers while they report backpressure. */
+#define BACKPRESSURE_WAIT_US 1000
+/* Number of chunks to decompress ahead of the consumers, by default. */
+#define DEFAULT_READ_AHEAD 2
+/* Longest time the main loop waits for the read-ahead thread. */
+#define READ_AHEAD_WAIT_US 10000
+/* Bytes of the session file to read ahead of the decompressor. */
+#define DEFAULT_PREFETCH (16 * 1024 * 1024)
 /** @endcond */
 
 SR_PRIV struct sr_dev_driver session_driver_info;
@@ -49,7 +58,72 @@ struct session_vdev {
 	int cur_analog_channel;
 	GArray *analog_channels;
 	int cur_chunk;
+	int analog_filter;
 	gboolean finished;
+	/* Size of the data read at a time, and of the current member. */
+	uint64_t chunk_size;
+	uint64_t capfile_size;
+	/* Recycles the chunk buffers during the replay. */
+	struct sr_buffer_pool *pool;
+	/* Chunks which got decompressed ahead of the main loop. */
+	uint64_t read_ahead;
+	GThread *ahead_thread;
+	GQueue ahead;
+	GMutex ahead_mutex;
+	GCond ahead_cond;
+	gboolean ahead_stop;
+	/* Bytes of the archive file which get read ahead of libzip. */
+	uint64_t prefetch;
+	/* Capture files of the interleaved replay, NULL if sequential. */
+	gboolean interleaved;
+	GArray *streams;
+	guint cur_stream;
+	/*
+	 * Metadata of the file. Its frames get marked in the interleaved
+	 * replay, by the position of the current round over the streams.
+	 */
+	struct sr_session_file_meta *meta;
+	uint64_t start_frame;
+	guint cur_frame;
+	gboolean in_frame;
+	uint64_t round_pos;
+	/* Keyframe interval of files with frame deltas, 0 otherwise. */
+	uint32_t frame_delta;
+	struct sr_context *ctx;
+};
+
+/* A capture file of the interleaved replay. */
+struct replay_stream {
+	char *base;
+	size_t sample_size;
+	int analog_channel;
+	int cur_chunk;
+	struct zip_file *zf;
+	/* Bytes to drop before the first frame to replay. */
+	uint64_t skip;
+	gboolean filtered;
+	/* Decoded data of a filtered chunk. */
+	uint8_t *pending;
+	size_t pending_len, pending_pos;
+	gboolean done;
+	/* Byte position in the capture file, and the frame it is in. */
+	uint64_t pos;
+	guint frame;
+	/* Decoded data of the previous and the current frame (deltas). */
+	struct sr_spill *last, *cur;
+	uint8_t *ref;
+	size_t ref_size;
+};
+
+/* A block of sample data, as read from the session file. */
+struct replay_item {
+	void *buf;
+	void *samples;
+	size_t len;
+	/* Analog channel number plus one, 0 for logic data. */
+	int analog_channel;
+	/* SR_DF_FRAME_BEGIN or SR_DF_FRAME_END instead of data, or 0. */
+	uint16_t marker;
 };
 
 static const uint32_t devopts[] = {
@@ -59,24 +133,433 @@ static const uint32_t devopts[] = {
 	SR_CONF_NUM_ANALOG_CHANNELS | SR_CONF_SET,
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_SESSIONFILE | SR_CONF_SET,
+	SR_CONF_CAPTURE_ANALOG_FILTER | SR_CONF_SET,
+	SR_CONF_REPLAY_CHUNK_SIZE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_REPLAY_READ_AHEAD | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_REPLAY_INTERLEAVED | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_REPLAY_PREFETCH | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_REPLAY_FRAME | SR_CONF_GET | SR_CONF_SET,
 };
 
-static gboolean stream_session_data(struct sr_dev_inst *sdi)
+static gboolean open_capfile(struct session_vdev *vdev, const char *name,
+	const struct zip_stat *zs)
+{
+	vdev->capfile_size = zs->size;
+	vdev->capfile = zip_fopen(vdev->archive, name, 0);
+	if (!vdev->capfile) {
+		/* Compression methods which this libzip lacks end up here. */
+		sr_err("Failed to open '%s' in '%s': %s", name,
+			vdev->sessionfile, zip_strerror(vdev->archive));
+		return FALSE;
+	}
+	sr_dbg("Opened %s.", name);
+
+	return TRUE;
+}
+
+/*
+ * Read from a capture file across its chunks. Filtered analog chunks
+ * get decoded as a whole, and served from the stream's buffer.
+ * Returns the number of bytes read, less than requested at the end.
+ */
+static size_t stream_read_data(struct session_vdev *vdev,
+	struct replay_stream *st, uint8_t *buf, size_t len)
+{
+	struct zip_stat zs;
+	char name[128];
+	uint8_t *raw;
+	size_t done, n;
+	zip_int64_t ret;
+
+	done = 0;
+	while (done < len && !st->done) {
+		if (st->filtered && st->pending_pos < st->pending_len) {
+			n = MIN(len - done, st->pending_len - st->pending_pos);
+			memcpy(buf + done, st->pending + st->pending_pos, n);
+			st->pending_pos += n;
+			done += n;
+			continue;
+		}
+
+		if (!st->zf) {
+			/* Unchunked capture files only exist for logic data. */
+			if (st->cur_chunk == 0 && zip_stat(vdev->archive,
+					st->base, 0, &zs) == 0) {
+				g_strlcpy(name, st->base, sizeof(name));
+			} else {
+				if (st->cur_chunk == 0)
+					st->cur_chunk = 1;
+				g_snprintf(name, sizeof(name), "%s-%d",
+					st->base, st->cur_chunk);
+				if (zip_stat(vdev->archive, name, 0, &zs) < 0) {
+					st->done = TRUE;
+					break;
+				}
+			}
+			st->cur_chunk++;
+			if (!(st->zf = zip_fopen(vdev->archive, name, 0))) {
+				sr_err("Failed to open '%s' in '%s': %s", name,
+					vdev->sessionfile, zip_strerror(vdev->archive));
+				st->done = TRUE;
+				break;
+			}
+			if (st->filtered) {
+				/* Decode the whole chunk now. */
+				raw = g_try_malloc(MAX(zs.size, 1));
+				g_free(st->pending);
+				st->pending = g_try_malloc(MAX(zs.size, 1));
+				ret = raw && st->pending
+					? zip_fread(st->zf, raw, zs.size) : -1;
+				zip_fclose(st->zf);
+				st->zf = NULL;
+				if (ret < 0) {
+					g_free(raw);
+					st->done = TRUE;
+					break;
+				}
+				sr_sessionfile_filter_revert(vdev->analog_filter,
+					raw, (float *)st->pending, ret / sizeof(float));
+				g_free(raw);
+				st->pending_len = ret;
+				st->pending_pos = 0;
+				continue;
+			}
+		}
+
+		ret = zip_fread(st->zf, buf + done, len - done);
+		if (ret <= 0) {
+			zip_fclose(st->zf);
+			st->zf = NULL;
+			continue;
+		}
+		done += ret;
+	}
+
+	return done;
+}
+
+/*
+ * Undo the frame deltas of data which got read from a capture file.
+ * Frames other than keyframes hold the difference to the previous
+ * frame, whose decoded data the stream keeps while it reads the next.
+ */
+static int stream_undelta(struct session_vdev *vdev,
+	struct replay_stream *st, uint8_t *buf, size_t len)
+{
+	const struct sr_sessionfile_frame *frame;
+	GArray *frames;
+	uint64_t first, end;
+	size_t done, n;
+	uint8_t *ref;
+	int ret;
+
+	if (!vdev->frame_delta)
+		return SR_OK;
+
+	frames = vdev->meta->frames;
+	done = 0;
+	while (done < len && st->frame < frames->len) {
+		frame = &g_array_index(frames, struct sr_sessionfile_frame,
+			st->frame);
+		first = frame->first * st->sample_size;
+		end = (frame->first + frame->count) * st->sample_size;
+		if (st->pos >= end) {
+			sr_spill_free(st->last);
+			st->last = st->cur;
+			st->cur = NULL;
+			st->frame++;
+			continue;
+		}
+		if (st->pos < first) {
+			n = MIN(len - done, first - st->pos);
+			st->pos += n;
+			done += n;
+			continue;
+		}
+
+		n = MIN(len - done, end - st->pos);
+		if (st->frame % vdev->frame_delta) {
+			if (n > st->ref_size) {
+				if (!(ref = g_try_realloc(st->ref, n)))
+					return SR_ERR_MALLOC;
+				st->ref = ref;
+				st->ref_size = n;
+			}
+			if (st->last) {
+				ret = sr_spill_read(st->last, st->pos - first,
+					st->ref, n);
+				if (ret != SR_OK)
+					return ret;
+			} else {
+				memset(st->ref, 0, n);
+			}
+			sr_sessionfile_xor(buf + done, st->ref, n);
+		}
+		if ((st->frame + 1) % vdev->frame_delta) {
+			if (!st->cur && !(st->cur = sr_spill_new(vdev->ctx, 0)))
+				return SR_ERR_IO;
+			ret = sr_spill_write(st->cur, st->pos - first,
+				buf + done, n);
+			if (ret != SR_OK)
+				return ret;
+		}
+		st->pos += n;
+		done += n;
+	}
+	st->pos += len - done;
+
+	return SR_OK;
+}
+
+/* Read from a capture file, after the data before the replay's start. */
+static size_t stream_read(struct session_vdev *vdev,
+	struct replay_stream *st, uint8_t *buf, size_t len)
+{
+	size_t n;
+
+	/* Dropped data still is the reference of the frames which follow. */
+	while (st->skip && !st->done) {
+		n = stream_read_data(vdev, st, buf, MIN(len, st->skip));
+		if (stream_undelta(vdev, st, buf, n) != SR_OK)
+			break;
+		st->skip -= n;
+	}
+
+	n = stream_read_data(vdev, st, buf, len);
+	if (stream_undelta(vdev, st, buf, n) != SR_OK) {
+		sr_err("Failed to decode the frames of '%s'.", st->base);
+		st->done = TRUE;
+		return 0;
+	}
+
+	return n;
+}
+
+/* Mark the start or the end of a frame, between the rounds. */
+static gboolean frame_marker(struct session_vdev *vdev,
+	struct replay_item *item)
+{
+	const struct sr_sessionfile_frame *frame;
+	GArray *frames;
+
+	frames = vdev->meta ? vdev->meta->frames : NULL;
+	if (!frames)
+		return FALSE;
+
+	if (vdev->in_frame) {
+		frame = &g_array_index(frames, struct sr_sessionfile_frame,
+			vdev->cur_frame);
+		if (vdev->round_pos < frame->first + frame->count)
+			return FALSE;
+		vdev->in_frame = FALSE;
+		vdev->cur_frame++;
+		item->marker = SR_DF_FRAME_END;
+		return TRUE;
+	}
+	if (vdev->cur_frame >= frames->len)
+		return FALSE;
+	frame = &g_array_index(frames, struct sr_sessionfile_frame,
+		vdev->cur_frame);
+	if (vdev->round_pos < frame->first)
+		return FALSE;
+	vdev->in_frame = TRUE;
+	item->marker = SR_DF_FRAME_BEGIN;
+
+	return TRUE;
+}
+
+/* Number of samples per stream in a round, up to the next frame marker. */
+static uint64_t round_samples(const struct session_vdev *vdev,
+	size_t sample_size)
+{
+	const struct sr_sessionfile_frame *frame;
+	GArray *frames;
+	uint64_t samples, end;
+
+	samples = MAX(vdev->chunk_size / sample_size, 1);
+	frames = vdev->meta ? vdev->meta->frames : NULL;
+	if (!frames || vdev->cur_frame >= frames->len)
+		return samples;
+
+	frame = &g_array_index(frames, struct sr_sessionfile_frame,
+		vdev->cur_frame);
+	end = frame->first + (vdev->in_frame ? frame->count : 0);
+	if (end > vdev->round_pos)
+		samples = MIN(samples, end - vdev->round_pos);
+
+	return samples;
+}
+
+/*
+ * Read the next block of the interleaved replay: the same number of
+ * samples of the logic data and of each analog channel in turn, so
+ * that the consumers receive the channels in time order.
+ */
+static int read_interleaved(struct session_vdev *vdev,
+	struct replay_item *item)
+{
+	struct replay_stream *st;
+	size_t size, sample_size;
+	uint64_t samples;
+	guint i;
+
+	memset(item, 0, sizeof(*item));
+
+	/* Blocks of all streams hold the same number of samples. */
+	sample_size = 1;
+	for (i = 0; i < vdev->streams->len; i++) {
+		st = &g_array_index(vdev->streams, struct replay_stream, i);
+		sample_size = MAX(sample_size, st->sample_size);
+	}
+	for (i = 0; i < vdev->streams->len; i++) {
+		if (vdev->cur_stream == 0 && frame_marker(vdev, item))
+			return 1;
+		st = &g_array_index(vdev->streams, struct replay_stream,
+			vdev->cur_stream);
+		samples = round_samples(vdev, sample_size);
+		vdev->cur_stream = (vdev->cur_stream + 1) % vdev->streams->len;
+		if (vdev->cur_stream == 0)
+			vdev->round_pos += samples;
+		if (st->done)
+			continue;
+
+		size = samples * st->sample_size;
+		item->buf = sr_buffer_pool_alloc(vdev->pool, size);
+		if (!item->buf) {
+			sr_err("Failed to allocate chunk buffer.");
+			return -1;
+		}
+		size = stream_read(vdev, st, item->buf, size);
+		if (!size) {
+			sr_buffer_pool_release(item->buf);
+			item->buf = NULL;
+			continue;
+		}
+		item->len = size;
+		item->analog_channel = st->analog_channel;
+		return 1;
+	}
+
+	/* The data ended within a frame. */
+	if (vdev->in_frame) {
+		vdev->in_frame = FALSE;
+		item->marker = SR_DF_FRAME_END;
+		return 1;
+	}
+
+	return -1;
+}
+
+static void streams_free(struct session_vdev *vdev)
+{
+	struct replay_stream *st;
+	guint i;
+
+	if (!vdev->streams)
+		return;
+
+	for (i = 0; i < vdev->streams->len; i++) {
+		st = &g_array_index(vdev->streams, struct replay_stream, i);
+		if (st->zf)
+			zip_fclose(st->zf);
+		g_free(st->base);
+		g_free(st->pending);
+		sr_spill_free(st->last);
+		sr_spill_free(st->cur);
+		g_free(st->ref);
+	}
+	g_array_free(vdev->streams, TRUE);
+	vdev->streams = NULL;
+}
+
+/* Set up the capture files of the interleaved replay. */
+static void streams_init(struct session_vdev *vdev)
+{
+	struct replay_stream st;
+	int i;
+
+	streams_free(vdev);
+	vdev->streams = g_array_new(FALSE, TRUE, sizeof(struct replay_stream));
+	vdev->cur_stream = 0;
+
+	if (vdev->capturefile && vdev->unitsize) {
+		memset(&st, 0, sizeof(st));
+		st.base = g_strdup(vdev->capturefile);
+		st.sample_size = vdev->unitsize;
+		g_array_append_val(vdev->streams, st);
+	}
+	for (i = 0; i < vdev->num_analog_channels; i++) {
+		memset(&st, 0, sizeof(st));
+		st.base = g_strdup_printf("analog-1-%d",
+			vdev->num_logic_channels + i + 1);
+		st.sample_size = sizeof(float);
+		st.analog_channel = i + 1;
+		st.filtered = vdev->analog_filter != SR_SESSIONFILE_FILTER_NONE;
+		g_array_append_val(vdev->streams, st);
+	}
+}
+
+/*
+ * Start the interleaved replay at a frame. Files which the srzip output
+ * wrote have an index of their chunks, the streams start with the chunk
+ * which holds the frame's first sample then. With frame deltas they
+ * start at the keyframe before, the frames up to the replay's start
+ * get decoded and dropped.
+ */
+static void streams_seek(struct session_vdev *vdev, guint frame)
+{
+	const struct sr_sessionfile_chunk *c;
+	struct replay_stream *st;
+	GArray *chunks;
+	const char *sep;
+	uint64_t from, pos;
+	guint key, i, j;
+
+	key = frame;
+	if (vdev->frame_delta)
+		key -= frame % vdev->frame_delta;
+	from = g_array_index(vdev->meta->frames,
+		struct sr_sessionfile_frame, key).first;
+	pos = g_array_index(vdev->meta->frames,
+		struct sr_sessionfile_frame, frame).first;
+	for (i = 0; i < vdev->streams->len; i++) {
+		st = &g_array_index(vdev->streams, struct replay_stream, i);
+		st->skip = pos * st->sample_size;
+		chunks = g_hash_table_lookup(vdev->meta->captures, st->base);
+		for (j = 0; chunks && j < chunks->len; j++) {
+			c = &g_array_index(chunks, struct sr_sessionfile_chunk, j);
+			if (from < c->first || from >= c->first + c->count)
+				continue;
+			if (!(sep = strrchr(c->name, '-')))
+				break;
+			st->cur_chunk = atoi(sep + 1);
+			st->skip = (pos - c->first) * st->sample_size;
+			st->pos = c->first * st->sample_size;
+			st->frame = key;
+			break;
+		}
+	}
+	vdev->round_pos = pos;
+}
+
+/*
+ * Read the next block of sample data. Walks the logic capture file and
+ * then the analog ones, chunk by chunk.
+ *
+ * Returns 1 when the item holds data, 0 when there was no data but
+ * more might follow, -1 when all data was read or on errors.
+ */
+static int read_next(struct session_vdev *vdev, struct replay_item *item)
 {
-	struct session_vdev *vdev;
-	struct sr_datafeed_packet packet;
-	struct sr_datafeed_logic logic;
-	struct sr_datafeed_analog analog;
-	struct sr_analog_encoding encoding;
-	struct sr_analog_meaning meaning;
-	struct sr_analog_spec spec;
 	struct zip_stat zs;
-	int ret, got_data;
 	char capturefile[128];
-	void *buf;
+	size_t size;
+	int ret;
 
-	got_data = FALSE;
-	vdev = sdi->priv;
+	if (vdev->streams)
+		return read_interleaved(vdev, item);
+
+	memset(item, 0, sizeof(*item));
 
 	if (!vdev->capfile) {
 		/* No capture file opened yet, or finished with the last
@@ -86,23 +569,19 @@ static gboolean stream_session_data(struct sr_dev_inst *sdi)
 			if (zip_stat(vdev->archive, vdev->capturefile, 0, &zs) != -1) {
 				/* No chunks, just a single capture file. */
 				vdev->cur_chunk = 0;
-				if (!(vdev->capfile = zip_fopen(vdev->archive,
-						vdev->capturefile, 0)))
-					return FALSE;
-				sr_dbg("Opened %s.", vdev->capturefile);
+				if (!open_capfile(vdev, vdev->capturefile, &zs))
+					return -1;
 			} else {
 				/* Try as first chunk filename. */
 				snprintf(capturefile, sizeof(capturefile) - 1, "%s-1", vdev->capturefile);
 				if (zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
 					vdev->cur_chunk = 1;
-					if (!(vdev->capfile = zip_fopen(vdev->archive,
-							capturefile, 0)))
-						return FALSE;
-					sr_dbg("Opened %s.", capturefile);
+					if (!open_capfile(vdev, capturefile, &zs))
+						return -1;
 				} else {
 					sr_err("No capture file '%s' in " "session file '%s'.",
 							vdev->capturefile, vdev->sessionfile);
-					return FALSE;
+					return -1;
 				}
 			}
 		} else {
@@ -111,22 +590,21 @@ static gboolean stream_session_data(struct sr_dev_inst *sdi)
 			snprintf(capturefile, sizeof(capturefile) - 1, "%s-%d", vdev->capturefile,
 					vdev->cur_chunk);
 			if (zip_stat(vdev->archive, capturefile, 0, &zs) != -1) {
-				if (!(vdev->capfile = zip_fopen(vdev->archive,
-						capturefile, 0)))
-					return FALSE;
-				sr_dbg("Opened %s.", capturefile);
+				if (!open_capfile(vdev, capturefile, &zs))
+					return -1;
 			} else if (vdev->cur_analog_channel < vdev->num_analog_channels) {
+				g_free(vdev->capturefile);
 				vdev->capturefile = g_strdup_printf("analog-1-%d",
 						vdev->num_logic_channels + vdev->cur_analog_channel + 1);
 				vdev->cur_analog_channel++;
 				vdev->cur_chunk = 0;
-				return TRUE;
+				return 0;
 			} else {
 				/* We got all the chunks, finish up. */
 				g_free(vdev->capturefile);
 
 				/* If the file has logic channels, the initial value for
-				 * capturefile is set by stream_session_data() - however only
+				 * capturefile is set by read_next() - however only
 				 * once. In order to not mess this mechanism up, we simulate
 				 * this here if needed. For purely analog files, capturefile
 				 * is not set.
@@ -135,75 +613,230 @@ static gboolean stream_session_data(struct sr_dev_inst *sdi)
 					vdev->capturefile = g_strdup("logic-1");
 				else
 					vdev->capturefile = NULL;
-				return FALSE;
+				return -1;
 			}
 		}
 	}
 
-	buf = g_malloc(CHUNKSIZE);
-
-	/* unitsize is not defined for purely analog session files. */
-	if (vdev->unitsize)
-		ret = zip_fread(vdev->capfile, buf,
-				CHUNKSIZE / vdev->unitsize * vdev->unitsize);
-	else
-		ret = zip_fread(vdev->capfile, buf, CHUNKSIZE);
-
-	if (ret > 0) {
-		if (vdev->cur_analog_channel != 0) {
-			got_data = TRUE;
-			packet.type = SR_DF_ANALOG;
-			packet.payload = &analog;
-			/* TODO: Use proper 'digits' value for this device (and its modes). */
-			sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
-			analog.meaning->channels = g_slist_prepend(NULL,
-					g_array_index(vdev->analog_channels,
-						struct sr_channel *, vdev->cur_analog_channel - 1));
-			analog.num_samples = ret / sizeof(float);
-			analog.meaning->mq = SR_MQ_VOLTAGE;
-			analog.meaning->unit = SR_UNIT_VOLT;
-			analog.meaning->mqflags = SR_MQFLAG_DC;
-			analog.data = (float *) buf;
-		} else if (vdev->unitsize) {
-			got_data = TRUE;
-			if (ret % vdev->unitsize != 0)
-				sr_warn("Read size %d not a multiple of the"
-					" unit size %d.", ret, vdev->unitsize);
-			packet.type = SR_DF_LOGIC;
-			packet.payload = &logic;
-			logic.length = ret;
-			logic.unitsize = vdev->unitsize;
-			logic.data = buf;
-		} else {
-			/*
-			 * Neither analog data, nor logic which has
-			 * unitsize, must be an unexpected API use.
-			 */
-			sr_warn("Neither analog nor logic data. Ignoring.");
-		}
-		if (got_data) {
-			vdev->bytes_read += ret;
-			sr_session_send(sdi, &packet);
-		}
-	} else {
+	/*
+	 * The writer filters analog chunks as a whole, they get read
+	 * in one go then. unitsize is not defined for purely analog
+	 * session files.
+	 */
+	size = vdev->chunk_size;
+	if (vdev->cur_analog_channel != 0 && vdev->analog_filter)
+		size = MAX(size, vdev->capfile_size);
+	else if (vdev->cur_analog_channel == 0 && vdev->unitsize)
+		size = MAX(size / vdev->unitsize, 1) * vdev->unitsize;
+
+	item->buf = sr_buffer_pool_alloc(vdev->pool, MAX(size, 1));
+	if (!item->buf) {
+		sr_err("Failed to allocate chunk buffer.");
+		return -1;
+	}
+
+	ret = zip_fread(vdev->capfile, item->buf, size);
+	if (ret <= 0) {
 		/* done with this capture file */
+		sr_buffer_pool_release(item->buf);
+		item->buf = NULL;
 		zip_fclose(vdev->capfile);
 		vdev->capfile = NULL;
-		if (vdev->cur_chunk != 0) {
-			/* There might be more chunks, so don't fall through
-			 * to the SR_DF_END here. */
-			got_data = TRUE;
+		/* There might be more chunks, so don't signal the end here. */
+		return vdev->cur_chunk != 0 ? 0 : -1;
+	}
+
+	if (vdev->cur_analog_channel != 0 && vdev->analog_filter) {
+		item->samples = sr_buffer_pool_alloc(vdev->pool, ret);
+		if (!item->samples) {
+			sr_err("Failed to allocate chunk buffer.");
+			sr_buffer_pool_release(item->buf);
+			return -1;
+		}
+		sr_sessionfile_filter_revert(vdev->analog_filter,
+			item->buf, item->samples, ret / sizeof(float));
+		sr_buffer_pool_release(item->buf);
+		item->buf = item->samples;
+	}
+	item->len = ret;
+	item->analog_channel = vdev->cur_analog_channel;
+
+	return 1;
+}
+
+/* Send a block of sample data, hand its buffer over to the packet. */
+static void send_item(struct sr_dev_inst *sdi, struct replay_item *item)
+{
+	struct session_vdev *vdev;
+	struct sr_datafeed_packet packet, *wrapped;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	gboolean got_data;
+
+	vdev = sdi->priv;
+	got_data = FALSE;
+
+	if (item->marker == SR_DF_FRAME_BEGIN) {
+		std_session_send_df_frame_begin(sdi);
+		return;
+	} else if (item->marker == SR_DF_FRAME_END) {
+		std_session_send_df_frame_end(sdi);
+		return;
+	}
+
+	if (item->analog_channel != 0) {
+		got_data = TRUE;
+		packet.type = SR_DF_ANALOG;
+		packet.payload = &analog;
+		/* TODO: Use proper 'digits' value for this device (and its modes). */
+		sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
+		analog.meaning->channels = g_slist_prepend(NULL,
+				g_array_index(vdev->analog_channels,
+					struct sr_channel *, item->analog_channel - 1));
+		analog.num_samples = item->len / sizeof(float);
+		analog.meaning->mq = SR_MQ_VOLTAGE;
+		analog.meaning->unit = SR_UNIT_VOLT;
+		analog.meaning->mqflags = SR_MQFLAG_DC;
+		analog.data = (float *)item->buf;
+	} else if (vdev->unitsize) {
+		got_data = TRUE;
+		if (item->len % vdev->unitsize != 0)
+			sr_warn("Read size %zu not a multiple of the"
+				" unit size %d.", item->len, vdev->unitsize);
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &logic;
+		logic.length = item->len;
+		logic.unitsize = vdev->unitsize;
+		logic.data = item->buf;
+	} else {
+		/*
+		 * Neither analog data, nor logic which has
+		 * unitsize, must be an unexpected API use.
+		 */
+		sr_warn("Neither analog nor logic data. Ignoring.");
+	}
+
+	if (got_data) {
+		vdev->bytes_read += item->len;
+		/*
+		 * Hand the chunk buffer over to the packet, so that
+		 * consumers can retain it without another copy.
+		 */
+		if (sr_packet_wrap(&packet, sr_buffer_pool_release,
+				item->buf, &wrapped) == SR_OK) {
+			item->buf = NULL;
+			sr_session_send(sdi, wrapped);
+			sr_packet_unref(wrapped);
+		} else {
+			sr_session_send(sdi, &packet);
+		}
+		if (item->analog_channel != 0)
+			g_slist_free(analog.meaning->channels);
+	}
+	sr_buffer_pool_release(item->buf);
+	item->buf = NULL;
+}
+
+/* Decompress chunks ahead of the main loop, up to the read-ahead depth. */
+static gpointer read_ahead_thread(gpointer data)
+{
+	struct session_vdev *vdev;
+	struct replay_item *item;
+	int ret;
+
+	vdev = data;
+	do {
+		item = g_malloc(sizeof(*item));
+		ret = read_next(vdev, item);
+		if (ret == 0) {
+			g_free(item);
+			continue;
+		}
+		if (ret < 0) {
+			item->buf = NULL;
+			item->marker = 0;
+		}
+
+		g_mutex_lock(&vdev->ahead_mutex);
+		while (!vdev->ahead_stop
+				&& vdev->ahead.length >= vdev->read_ahead)
+			g_cond_wait(&vdev->ahead_cond, &vdev->ahead_mutex);
+		if (vdev->ahead_stop) {
+			sr_buffer_pool_release(item->buf);
+			g_free(item);
+			ret = -1;
+		} else {
+			/* An item without data marks the end. */
+			g_queue_push_tail(&vdev->ahead, item);
+			g_cond_broadcast(&vdev->ahead_cond);
 		}
+		g_mutex_unlock(&vdev->ahead_mutex);
+	} while (ret >= 0);
+
+	return NULL;
+}
+
+static void read_ahead_stop(struct session_vdev *vdev)
+{
+	struct replay_item *item;
+
+	if (!vdev->ahead_thread)
+		return;
+
+	g_mutex_lock(&vdev->ahead_mutex);
+	vdev->ahead_stop = TRUE;
+	g_cond_broadcast(&vdev->ahead_cond);
+	g_mutex_unlock(&vdev->ahead_mutex);
+	g_thread_join(vdev->ahead_thread);
+	vdev->ahead_thread = NULL;
+
+	while ((item = g_queue_pop_head(&vdev->ahead))) {
+		sr_buffer_pool_release(item->buf);
+		g_free(item);
 	}
-	g_free(buf);
+}
+
+/*
+ * Get the next block of sample data, from the read-ahead thread when
+ * there is one. Same return values as read_next().
+ */
+static int next_item(struct session_vdev *vdev, struct replay_item *item)
+{
+	struct replay_item *ahead;
+	gint64 end_time;
 
-	return got_data;
+	if (!vdev->ahead_thread)
+		return read_next(vdev, item);
+
+	/* Don't block the main loop for long, come back later instead. */
+	end_time = g_get_monotonic_time() + READ_AHEAD_WAIT_US;
+	g_mutex_lock(&vdev->ahead_mutex);
+	while (!(ahead = g_queue_pop_head(&vdev->ahead))) {
+		if (!g_cond_wait_until(&vdev->ahead_cond,
+				&vdev->ahead_mutex, end_time))
+			break;
+	}
+	if (ahead)
+		g_cond_broadcast(&vdev->ahead_cond);
+	g_mutex_unlock(&vdev->ahead_mutex);
+
+	if (!ahead)
+		return 0;
+	*item = *ahead;
+	g_free(ahead);
+
+	return item->buf || item->marker ? 1 : -1;
 }
 
 static int receive_data(int fd, int revents, void *cb_data)
 {
 	struct sr_dev_inst *sdi;
 	struct session_vdev *vdev;
+	struct replay_item item;
+	int ret;
 
 	(void)fd;
 	(void)revents;
@@ -211,11 +844,25 @@ static int receive_data(int fd, int revents, void *cb_data)
 	sdi = cb_data;
 	vdev = sdi->priv;
 
-	if (!vdev->finished && !stream_session_data(sdi))
-		vdev->finished = TRUE;
+	/* Let the consumers catch up, rather than having them drop data. */
+	if (!vdev->finished && sr_session_backpressure_get(sdi->session)
+			>= SR_BACKPRESSURE_HIGH) {
+		g_usleep(BACKPRESSURE_WAIT_US);
+		return G_SOURCE_CONTINUE;
+	}
+
+	if (!vdev->finished) {
+		ret = next_item(vdev, &item);
+		if (ret > 0)
+			send_item(sdi, &item);
+		else if (ret < 0)
+			vdev->finished = TRUE;
+	}
 	if (!vdev->finished)
 		return G_SOURCE_CONTINUE;
 
+	read_ahead_stop(vdev);
+	streams_free(vdev);
 	if (vdev->capfile) {
 		zip_fclose(vdev->capfile);
 		vdev->capfile = NULL;
@@ -224,6 +871,10 @@ static int receive_data(int fd, int revents, void *cb_data)
 		zip_discard(vdev->archive);
 		vdev->archive = NULL;
 	}
+	sr_buffer_pool_free(vdev->pool);
+	vdev->pool = NULL;
+	sr_session_file_meta_unref(vdev->meta);
+	vdev->meta = NULL;
 
 	std_session_send_df_end(sdi);
 
@@ -241,6 +892,12 @@ static int dev_open(struct sr_dev_inst *sdi)
 	di = sdi->driver;
 	drvc = di->context;
 	vdev = g_malloc0(sizeof(struct session_vdev));
+	vdev->chunk_size = CHUNKSIZE;
+	vdev->read_ahead = DEFAULT_READ_AHEAD;
+	vdev->prefetch = DEFAULT_PREFETCH;
+	g_queue_init(&vdev->ahead);
+	g_mutex_init(&vdev->ahead_mutex);
+	g_cond_init(&vdev->ahead_cond);
 	sdi->priv = vdev;
 	drvc->instances = g_slist_append(drvc->instances, sdi);
 
@@ -249,7 +906,15 @@ static int dev_open(struct sr_dev_inst *sdi)
 
 static int dev_close(struct sr_dev_inst *sdi)
 {
-	const struct session_vdev *const vdev = sdi->priv;
+	struct session_vdev *vdev;
+
+	vdev = sdi->priv;
+	read_ahead_stop(vdev);
+	streams_free(vdev);
+	sr_buffer_pool_free(vdev->pool);
+	sr_session_file_meta_unref(vdev->meta);
+	g_mutex_clear(&vdev->ahead_mutex);
+	g_cond_clear(&vdev->ahead_cond);
 	g_free(vdev->sessionfile);
 	g_free(vdev->capturefile);
 
@@ -278,6 +943,21 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_UNITSIZE:
 		*data = g_variant_new_uint64(vdev->unitsize);
 		break;
+	case SR_CONF_REPLAY_CHUNK_SIZE:
+		*data = g_variant_new_uint64(vdev->chunk_size);
+		break;
+	case SR_CONF_REPLAY_READ_AHEAD:
+		*data = g_variant_new_uint64(vdev->read_ahead);
+		break;
+	case SR_CONF_REPLAY_INTERLEAVED:
+		*data = g_variant_new_boolean(vdev->interleaved);
+		break;
+	case SR_CONF_REPLAY_PREFETCH:
+		*data = g_variant_new_uint64(vdev->prefetch);
+		break;
+	case SR_CONF_REPLAY_FRAME:
+		*data = g_variant_new_uint64(vdev->start_frame);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -289,6 +969,7 @@ static int config_set(uint32_t key, GVariant *data,
 	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg)
 {
 	struct session_vdev *vdev;
+	int ret;
 
 	(void)cg;
 
@@ -318,6 +999,30 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_NUM_ANALOG_CHANNELS:
 		vdev->num_analog_channels = g_variant_get_int32(data);
 		break;
+	case SR_CONF_CAPTURE_ANALOG_FILTER:
+		ret = sr_sessionfile_filter_from_name(
+			g_variant_get_string(data, NULL));
+		if (ret < 0)
+			return SR_ERR_ARG;
+		vdev->analog_filter = ret;
+		break;
+	case SR_CONF_REPLAY_CHUNK_SIZE:
+		if (!g_variant_get_uint64(data))
+			return SR_ERR_ARG;
+		vdev->chunk_size = g_variant_get_uint64(data);
+		break;
+	case SR_CONF_REPLAY_READ_AHEAD:
+		vdev->read_ahead = g_variant_get_uint64(data);
+		break;
+	case SR_CONF_REPLAY_INTERLEAVED:
+		vdev->interleaved = g_variant_get_boolean(data);
+		break;
+	case SR_CONF_REPLAY_PREFETCH:
+		vdev->prefetch = g_variant_get_uint64(data);
+		break;
+	case SR_CONF_REPLAY_FRAME:
+		vdev->start_frame = g_variant_get_uint64(data);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -334,6 +1039,7 @@ static int config_list(uint32_t key, GVariant **data,
 static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 {
 	struct session_vdev *vdev;
+	GArray *frames;
 	int ret;
 	GSList *l;
 	struct sr_channel *ch;
@@ -354,12 +1060,58 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	sr_info("Opening archive %s file %s", vdev->sessionfile,
 		vdev->capturefile);
 
-	if (!(vdev->archive = zip_open(vdev->sessionfile, 0, &ret))) {
+	/*
+	 * The interleaved replay jumps between the archive members, which
+	 * defeats the sequential prefetch.
+	 */
+	vdev->archive = sr_sessionfile_open(vdev->sessionfile,
+		vdev->interleaved ? 0 : vdev->prefetch, &ret);
+	if (!vdev->archive) {
 		sr_err("Failed to open session file '%s': "
 		       "zip error %d.", vdev->sessionfile, ret);
 		return SR_ERR;
 	}
 
+	/* Files with frames get replayed in time order, frame by frame. */
+	sr_session_file_meta_unref(vdev->meta);
+	if (sr_sessionfile_meta_read(vdev->archive, &vdev->meta) != SR_OK)
+		vdev->meta = NULL;
+	frames = vdev->meta ? vdev->meta->frames : NULL;
+	if (vdev->start_frame && (!frames || vdev->start_frame >= frames->len)) {
+		sr_err("No frame %" PRIu64 " in session file '%s'.",
+			vdev->start_frame, vdev->sessionfile);
+		zip_discard(vdev->archive);
+		vdev->archive = NULL;
+		return SR_ERR_ARG;
+	}
+	vdev->cur_frame = 0;
+	vdev->in_frame = FALSE;
+	vdev->round_pos = 0;
+	vdev->frame_delta = 0;
+	if (frames && vdev->meta->devices->len) {
+		vdev->frame_delta = g_array_index(vdev->meta->devices,
+			struct sr_sessionfile_device, 0).frame_delta;
+	}
+	vdev->ctx = sr_dev_inst_context(sdi);
+	if (vdev->interleaved || (frames && frames->len))
+		streams_init(vdev);
+	if (vdev->start_frame) {
+		vdev->cur_frame = vdev->start_frame;
+		streams_seek(vdev, vdev->start_frame);
+	}
+
+	/* Enough buffers for the chunks ahead and the ones being sent. */
+	sr_buffer_pool_free(vdev->pool);
+	vdev->pool = sr_buffer_pool_new(
+		(vdev->read_ahead + 2) * vdev->chunk_size, FALSE);
+	vdev->ahead_stop = FALSE;
+	if (vdev->read_ahead) {
+		vdev->ahead_thread = g_thread_try_new("session-read-ahead",
+			read_ahead_thread, vdev, NULL);
+		if (!vdev->ahead_thread)
+			sr_warn("Failed to start read-ahead, reading inline.");
+	}
+
 	std_session_send_df_header(sdi);
 
 	/* freewheeling source */
@@ -18,6 +18,7 @@
  */
 
 #include <config.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <zip.h>
@@ -58,6 +59,437 @@ SR_PRIV void sr_zip_discard(struct zip *archive)
 }
 #endif
 
+#if HAVE_ZIP_SOURCE_FUNCTION_CREATE && HAVE_ZIP_OPEN_FROM_SOURCE
+/** @cond PRIVATE */
+/* Size of the blocks which the prefetch thread reads at a time. */
+#define PREFETCH_BLOCK_SIZE (1024 * 1024)
+/** @endcond */
+
+/* A block of the file, as read by the prefetch thread. */
+struct prefetch_block {
+	uint64_t offset;
+	size_t len;
+	uint8_t data[];
+};
+
+/*
+ * A ZIP source which reads the archive file in a thread, ahead of the
+ * position where libzip reads. Reads of archive members are sequential,
+ * so that most reads get served from memory. Seeks outside of the
+ * prefetched data restart the prefetch from there.
+ */
+struct prefetch_source {
+	char *filename;
+	uint64_t size;
+	guint window;
+	zip_error_t error;
+	GThread *thread;
+	GMutex mutex;
+	GCond cond;
+	/* Prefetched blocks, contiguous from the read position on. */
+	GQueue blocks;
+	uint64_t pos;
+	uint64_t fetch_pos;
+	guint generation;
+	gboolean read_error;
+	gboolean stop;
+};
+
+static gboolean prefetch_seek_file(FILE *file, uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, offset, SEEK_SET) == 0;
+#endif
+}
+
+static void prefetch_blocks_clear(struct prefetch_source *ps)
+{
+	struct prefetch_block *block;
+
+	while ((block = g_queue_pop_head(&ps->blocks)))
+		g_free(block);
+}
+
+static gpointer prefetch_thread(gpointer data)
+{
+	struct prefetch_source *ps;
+	struct prefetch_block *block;
+	FILE *file;
+	uint64_t offset, file_pos;
+	guint generation;
+	size_t len;
+	gboolean ok;
+
+	ps = data;
+	file = g_fopen(ps->filename, "rb");
+	file_pos = 0;
+
+	g_mutex_lock(&ps->mutex);
+	if (!file)
+		ps->read_error = TRUE;
+	while (file) {
+		while (!ps->stop && !ps->read_error
+				&& (ps->blocks.length >= ps->window
+				|| ps->fetch_pos >= ps->size))
+			g_cond_wait(&ps->cond, &ps->mutex);
+		if (ps->stop || ps->read_error)
+			break;
+		offset = ps->fetch_pos;
+		generation = ps->generation;
+		g_mutex_unlock(&ps->mutex);
+
+		/* Do the I/O with the lock released. */
+		len = MIN(PREFETCH_BLOCK_SIZE, ps->size - offset);
+		block = g_malloc(sizeof(*block) + len);
+		block->offset = offset;
+		block->len = len;
+		ok = file_pos == offset || prefetch_seek_file(file, offset);
+		ok = ok && fread(block->data, 1, len, file) == len;
+		file_pos = ok ? offset + len : ~UINT64_C(0);
+
+		g_mutex_lock(&ps->mutex);
+		if (!ok)
+			ps->read_error = TRUE;
+		if (ok && generation == ps->generation) {
+			g_queue_push_tail(&ps->blocks, block);
+			ps->fetch_pos += len;
+		} else {
+			g_free(block);
+		}
+		g_cond_broadcast(&ps->cond);
+	}
+	g_cond_broadcast(&ps->cond);
+	g_mutex_unlock(&ps->mutex);
+
+	if (file)
+		fclose(file);
+
+	return NULL;
+}
+
+static void prefetch_stop(struct prefetch_source *ps)
+{
+	if (!ps->thread)
+		return;
+
+	g_mutex_lock(&ps->mutex);
+	ps->stop = TRUE;
+	g_cond_broadcast(&ps->cond);
+	g_mutex_unlock(&ps->mutex);
+	g_thread_join(ps->thread);
+	ps->thread = NULL;
+	prefetch_blocks_clear(ps);
+}
+
+/* Serve reads from the prefetched blocks, wait for them if needed. */
+static zip_int64_t prefetch_read(struct prefetch_source *ps,
+	uint8_t *data, uint64_t len)
+{
+	struct prefetch_block *block;
+	uint64_t done, skip, chunk;
+
+	done = 0;
+	len = MIN(len, ps->size - ps->pos);
+	g_mutex_lock(&ps->mutex);
+	while (done < len) {
+		block = g_queue_peek_head(&ps->blocks);
+		if (!block) {
+			if (ps->read_error)
+				break;
+			g_cond_wait(&ps->cond, &ps->mutex);
+			continue;
+		}
+		skip = ps->pos - block->offset;
+		chunk = MIN(len - done, block->len - skip);
+		memcpy(&data[done], &block->data[skip], chunk);
+		done += chunk;
+		ps->pos += chunk;
+		if (ps->pos == block->offset + block->len) {
+			g_free(g_queue_pop_head(&ps->blocks));
+			g_cond_broadcast(&ps->cond);
+		}
+	}
+	g_mutex_unlock(&ps->mutex);
+
+	if (done < len) {
+		zip_error_set(&ps->error, ZIP_ER_READ, EIO);
+		return -1;
+	}
+
+	return done;
+}
+
+/* Keep prefetched data when the new position is within it. */
+static void prefetch_seek(struct prefetch_source *ps, uint64_t offset)
+{
+	struct prefetch_block *block;
+
+	g_mutex_lock(&ps->mutex);
+	if (offset < ps->pos || offset >= ps->fetch_pos) {
+		prefetch_blocks_clear(ps);
+		ps->fetch_pos = offset;
+		ps->generation++;
+		ps->read_error = FALSE;
+	}
+	while ((block = g_queue_peek_head(&ps->blocks))
+			&& block->offset + block->len <= offset)
+		g_free(g_queue_pop_head(&ps->blocks));
+	ps->pos = offset;
+	g_cond_broadcast(&ps->cond);
+	g_mutex_unlock(&ps->mutex);
+}
+
+static zip_int64_t prefetch_source_cb(void *userdata, void *data,
+	zip_uint64_t len, zip_source_cmd_t cmd)
+{
+	struct prefetch_source *ps;
+	zip_stat_t *st;
+	zip_int64_t offset;
+
+	ps = userdata;
+	switch (cmd) {
+	case ZIP_SOURCE_OPEN:
+		ps->stop = FALSE;
+		ps->read_error = FALSE;
+		ps->pos = ps->fetch_pos = 0;
+		ps->thread = g_thread_try_new("session-prefetch",
+			prefetch_thread, ps, NULL);
+		if (!ps->thread) {
+			zip_error_set(&ps->error, ZIP_ER_OPEN, 0);
+			return -1;
+		}
+		return 0;
+	case ZIP_SOURCE_READ:
+		return prefetch_read(ps, data, len);
+	case ZIP_SOURCE_CLOSE:
+		prefetch_stop(ps);
+		return 0;
+	case ZIP_SOURCE_SEEK:
+		offset = zip_source_seek_compute_offset(ps->pos, ps->size,
+			data, len, &ps->error);
+		if (offset < 0)
+			return -1;
+		prefetch_seek(ps, offset);
+		return 0;
+	case ZIP_SOURCE_TELL:
+		return ps->pos;
+	case ZIP_SOURCE_STAT:
+		if (len < sizeof(*st))
+			return -1;
+		st = data;
+		zip_stat_init(st);
+		st->size = ps->size;
+		st->valid |= ZIP_STAT_SIZE;
+		return sizeof(*st);
+	case ZIP_SOURCE_ERROR:
+		return zip_error_to_data(&ps->error, data, len);
+	case ZIP_SOURCE_FREE:
+		prefetch_stop(ps);
+		zip_error_fini(&ps->error);
+		g_mutex_clear(&ps->mutex);
+		g_cond_clear(&ps->cond);
+		g_free(ps->filename);
+		g_free(ps);
+		return 0;
+	case ZIP_SOURCE_SUPPORTS:
+		return zip_source_make_command_bitmap(ZIP_SOURCE_OPEN,
+			ZIP_SOURCE_READ, ZIP_SOURCE_CLOSE, ZIP_SOURCE_SEEK,
+			ZIP_SOURCE_TELL, ZIP_SOURCE_STAT, ZIP_SOURCE_ERROR,
+			ZIP_SOURCE_FREE, ZIP_SOURCE_SUPPORTS, -1);
+	default:
+		zip_error_set(&ps->error, ZIP_ER_OPNOTSUPP, 0);
+		return -1;
+	}
+}
+#endif
+
+/**
+ * Open a session archive for reading, with optional prefetching.
+ *
+ * With a non-zero @a prefetch size, a thread reads the file ahead of
+ * the decompressor, so that replays from slow (network) storage don't
+ * wait for every single read. This needs libzip 1.0 or later, older
+ * versions read synchronously.
+ *
+ * @param[in] filename The name of the session file.
+ * @param[in] prefetch Number of bytes to read ahead, 0 disables.
+ * @param[out] zep The libzip error code when opening fails. Can be NULL.
+ *
+ * @return The archive, or NULL when it cannot be opened.
+ *
+ * @private
+ */
+SR_PRIV struct zip *sr_sessionfile_open(const char *filename,
+		uint64_t prefetch, int *zep)
+{
+#if HAVE_ZIP_SOURCE_FUNCTION_CREATE && HAVE_ZIP_OPEN_FROM_SOURCE
+	struct prefetch_source *ps;
+	struct zip *archive;
+	zip_source_t *src;
+	zip_error_t error;
+	GStatBuf st;
+
+	if (!prefetch || g_stat(filename, &st) < 0)
+		return zip_open(filename, 0, zep);
+
+	ps = g_malloc0(sizeof(*ps));
+	ps->filename = g_strdup(filename);
+	ps->size = st.st_size;
+	ps->window = MAX(prefetch / PREFETCH_BLOCK_SIZE, 1);
+	zip_error_init(&ps->error);
+	g_mutex_init(&ps->mutex);
+	g_cond_init(&ps->cond);
+	g_queue_init(&ps->blocks);
+
+	zip_error_init(&error);
+	src = zip_source_function_create(prefetch_source_cb, ps, &error);
+	if (!src) {
+		prefetch_source_cb(ps, NULL, 0, ZIP_SOURCE_FREE);
+		if (zep)
+			*zep = zip_error_code_zip(&error);
+		zip_error_fini(&error);
+		return NULL;
+	}
+	archive = zip_open_from_source(src, ZIP_RDONLY, &error);
+	if (!archive) {
+		zip_source_free(src);
+		if (zep)
+			*zep = zip_error_code_zip(&error);
+	}
+	zip_error_fini(&error);
+
+	return archive;
+#else
+	(void)prefetch;
+
+	return zip_open(filename, 0, zep);
+#endif
+}
+
+/** @private */
+SR_PRIV int sr_sessionfile_filter_from_name(const char *name)
+{
+	if (!name || !strcmp(name, "none"))
+		return SR_SESSIONFILE_FILTER_NONE;
+	if (!strcmp(name, "shuffle"))
+		return SR_SESSIONFILE_FILTER_SHUFFLE;
+	if (!strcmp(name, "delta"))
+		return SR_SESSIONFILE_FILTER_DELTA;
+
+	return -1;
+}
+
+/**
+ * Prefilter analog samples for better compression.
+ *
+ * The shuffle filter groups the bytes by their position in the float
+ * values, so that the slowly changing sign and exponent bytes end up
+ * next to each other. The delta filter additionally stores differences
+ * of subsequent bytes.
+ *
+ * @param[in] filter The filter to apply.
+ * @param[in] in The samples.
+ * @param[out] out Buffer for the filtered data, of @a count floats.
+ * @param[in] count The number of samples.
+ *
+ * @private
+ */
+SR_PRIV void sr_sessionfile_filter_apply(int filter, const float *in,
+		uint8_t *out, size_t count)
+{
+	const uint8_t *bytes;
+	uint8_t prev, cur;
+	size_t i, b, size;
+
+	bytes = (const uint8_t *)in;
+	size = count * sizeof(float);
+	if (filter == SR_SESSIONFILE_FILTER_NONE) {
+		memcpy(out, bytes, size);
+		return;
+	}
+
+	for (b = 0; b < sizeof(float); b++) {
+		for (i = 0; i < count; i++)
+			out[b * count + i] = bytes[i * sizeof(float) + b];
+	}
+
+	if (filter == SR_SESSIONFILE_FILTER_DELTA) {
+		prev = 0;
+		for (i = 0; i < size; i++) {
+			cur = out[i];
+			out[i] = cur - prev;
+			prev = cur;
+		}
+	}
+}
+
+/**
+ * Undo the prefilter of analog samples.
+ *
+ * @param[in] filter The filter which was applied.
+ * @param[in,out] in The filtered data. Gets modified.
+ * @param[out] out Buffer for the samples, of @a count floats.
+ * @param[in] count The number of samples.
+ *
+ * @see sr_sessionfile_filter_apply()
+ *
+ * @private
+ */
+SR_PRIV void sr_sessionfile_filter_revert(int filter, uint8_t *in,
+		float *out, size_t count)
+{
+	uint8_t *bytes;
+	size_t i, b, size;
+
+	bytes = (uint8_t *)out;
+	size = count * sizeof(float);
+	if (filter == SR_SESSIONFILE_FILTER_NONE) {
+		memcpy(bytes, in, size);
+		return;
+	}
+
+	if (filter == SR_SESSIONFILE_FILTER_DELTA) {
+		for (i = 1; i < size; i++)
+			in[i] += in[i - 1];
+	}
+
+	for (b = 0; b < sizeof(float); b++) {
+		for (i = 0; i < count; i++)
+			bytes[i * sizeof(float) + b] = in[b * count + i];
+	}
+}
+
+/**
+ * XOR bytes of a frame with the bytes of the previous frame.
+ *
+ * Frames which get stored as differences have each byte of their
+ * sample data combined with the byte at the same offset in the
+ * previous frame, the same operation restores them. Near-identical
+ * frames then leave mostly zeros, which compress well.
+ *
+ * @param[in,out] buf The bytes of the frame.
+ * @param[in] ref The bytes of the previous frame.
+ * @param[in] len The number of bytes.
+ *
+ * @private
+ */
+SR_PRIV void sr_sessionfile_xor(uint8_t *buf, const uint8_t *ref, size_t len)
+{
+	uint64_t w, r;
+	size_t i;
+
+	for (i = 0; i + sizeof(w) <= len; i += sizeof(w)) {
+		memcpy(&w, buf + i, sizeof(w));
+		memcpy(&r, ref + i, sizeof(r));
+		w ^= r;
+		memcpy(buf + i, &w, sizeof(w));
+	}
+	for (; i < len; i++)
+		buf[i] ^= ref[i];
+}
+
 /**
  * Read metadata entries from a session archive.
  *
@@ -111,33 +543,18 @@ SR_PRIV GKeyFile *sr_sessionfile_read_metadata(struct zip *archive,
 	return keyfile;
 }
 
-/** @private */
-SR_PRIV int sr_sessionfile_check(const char *filename)
+/* Check the version of an open archive, and that it has metadata. */
+static int archive_check(struct zip *archive)
 {
-	struct zip *archive;
 	struct zip_file *zf;
 	struct zip_stat zs;
 	uint64_t version;
 	int ret;
 	char s[11];
 
-	if (!filename)
-		return SR_ERR_ARG;
-
-	if (!g_file_test(filename, G_FILE_TEST_IS_REGULAR)) {
-		sr_err("Not a regular file: %s.", filename);
-		return SR_ERR;
-	}
-
-	if (!(archive = zip_open(filename, 0, NULL)))
-		/* No logging: this can be used just to check if it's
-		 * a sigrok session file or not. */
-		return SR_ERR;
-
 	/* check "version" */
 	if (!(zf = zip_fopen(archive, "version", 0))) {
 		sr_dbg("Not a sigrok session file: no version found.");
-		zip_discard(archive);
 		return SR_ERR;
 	}
 	ret = zip_fread(zf, s, sizeof(s) - 1);
@@ -145,7 +562,6 @@ SR_PRIV int sr_sessionfile_check(const char *filename)
 		sr_err("Failed to read version file: %s",
 			zip_file_strerror(zf));
 		zip_fclose(zf);
-		zip_discard(archive);
 		return SR_ERR;
 	}
 	zip_fclose(zf);
@@ -154,7 +570,6 @@ SR_PRIV int sr_sessionfile_check(const char *filename)
 	if (version == 0 || version > 2) {
 		sr_dbg("Cannot handle sigrok session file version %" PRIu64 ".",
 			version);
-		zip_discard(archive);
 		return SR_ERR;
 	}
 	sr_spew("Detected sigrok session file version %" PRIu64 ".", version);
@@ -162,14 +577,658 @@ SR_PRIV int sr_sessionfile_check(const char *filename)
 	/* read "metadata" */
 	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
 		sr_dbg("Not a valid sigrok session file.");
-		zip_discard(archive);
 		return SR_ERR;
 	}
+
+	return SR_OK;
+}
+
+static struct zip *archive_open_checked(const char *filename, int *ret)
+{
+	struct zip *archive;
+
+	*ret = SR_ERR_ARG;
+	if (!filename)
+		return NULL;
+
+	*ret = SR_ERR;
+	if (!g_file_test(filename, G_FILE_TEST_IS_REGULAR)) {
+		sr_err("Not a regular file: %s.", filename);
+		return NULL;
+	}
+
+	if (!(archive = zip_open(filename, 0, NULL)))
+		/* No logging: this can be used just to check if it's
+		 * a sigrok session file or not. */
+		return NULL;
+
+	if ((*ret = archive_check(archive)) != SR_OK) {
+		zip_discard(archive);
+		return NULL;
+	}
+
+	return archive;
+}
+
+/** @private */
+SR_PRIV int sr_sessionfile_check(const char *filename)
+{
+	struct zip *archive;
+	int ret;
+
+	if ((archive = archive_open_checked(filename, &ret)))
+		zip_discard(archive);
+
+	return ret;
+}
+
+/** @private */
+SR_PRIV void sr_sessionfile_chunks_free(void *data)
+{
+	GArray *chunks;
+	guint i;
+
+	chunks = data;
+	for (i = 0; i < chunks->len; i++)
+		g_free(g_array_index(chunks, struct sr_sessionfile_chunk, i).name);
+	g_array_free(chunks, TRUE);
+}
+
+/*
+ * Load the chunk index which the srzip output writes. Each line holds
+ * a chunk name, the number of its first sample and its sample count.
+ */
+static int index_load(struct zip *archive, GHashTable *captures)
+{
+	struct zip_stat zs;
+	struct zip_file *zf;
+	struct sr_sessionfile_chunk c;
+	GArray *chunks;
+	char *buf, **lines, **fields, *sep;
+	zip_int64_t len;
+	guint i;
+
+	if (zip_stat(archive, "index", 0, &zs) < 0)
+		return SR_ERR_NA;
+	if (zs.size > G_MAXINT || !(buf = g_try_malloc(zs.size + 1)))
+		return SR_ERR_MALLOC;
+	if (!(zf = zip_fopen_index(archive, zs.index, 0))) {
+		g_free(buf);
+		return SR_ERR_DATA;
+	}
+	len = zip_fread(zf, buf, zs.size);
+	zip_fclose(zf);
+	if (len < 0) {
+		g_free(buf);
+		return SR_ERR_DATA;
+	}
+	buf[len] = '\0';
+
+	lines = g_strsplit(buf, "\n", 0);
+	g_free(buf);
+	for (i = 0; lines[i]; i++) {
+		fields = g_strsplit(lines[i], " ", 3);
+		if (g_strv_length(fields) == 3 && (sep = strrchr(fields[0], '-'))) {
+			c.name = g_strdup(fields[0]);
+			c.first = g_ascii_strtoull(fields[1], NULL, 10);
+			c.count = g_ascii_strtoull(fields[2], NULL, 10);
+			*sep = '\0';
+			chunks = g_hash_table_lookup(captures, fields[0]);
+			if (!chunks) {
+				chunks = g_array_new(FALSE, FALSE, sizeof(c));
+				g_hash_table_insert(captures,
+					g_strdup(fields[0]), chunks);
+			}
+			g_array_append_val(chunks, c);
+		}
+		g_strfreev(fields);
+	}
+	g_strfreev(lines);
+
+	return SR_OK;
+}
+
+/*
+ * Load the frame list which the srzip output writes. Each line holds
+ * the first sample of a frame, its sample count and its host time.
+ */
+static int frames_load(struct zip *archive, GArray **frames)
+{
+	struct zip_stat zs;
+	struct zip_file *zf;
+	struct sr_sessionfile_frame frame;
+	char *buf, **lines, **fields;
+	zip_int64_t len;
+	guint i;
+
+	*frames = NULL;
+	if (zip_stat(archive, "frames", 0, &zs) < 0)
+		return SR_ERR_NA;
+	if (zs.size > G_MAXINT || !(buf = g_try_malloc(zs.size + 1)))
+		return SR_ERR_MALLOC;
+	if (!(zf = zip_fopen_index(archive, zs.index, 0))) {
+		g_free(buf);
+		return SR_ERR_DATA;
+	}
+	len = zip_fread(zf, buf, zs.size);
+	zip_fclose(zf);
+	if (len < 0) {
+		g_free(buf);
+		return SR_ERR_DATA;
+	}
+	buf[len] = '\0';
+
+	*frames = g_array_new(FALSE, FALSE, sizeof(frame));
+	lines = g_strsplit(buf, "\n", 0);
+	g_free(buf);
+	for (i = 0; lines[i]; i++) {
+		fields = g_strsplit(lines[i], " ", 3);
+		if (g_strv_length(fields) == 3) {
+			frame.first = g_ascii_strtoull(fields[0], NULL, 10);
+			frame.count = g_ascii_strtoull(fields[1], NULL, 10);
+			frame.host_us = g_ascii_strtoll(fields[2], NULL, 10);
+			g_array_append_val(*frames, frame);
+		}
+		g_strfreev(fields);
+	}
+	g_strfreev(lines);
+
+	return SR_OK;
+}
+
+static void device_clear(void *data)
+{
+	struct sr_sessionfile_device *dev;
+	int i;
+
+	dev = data;
+	for (i = 0; dev->names && i < dev->total_logic + dev->total_analog; i++)
+		g_free(dev->names[i]);
+	g_free(dev->names);
+	g_free(dev->capturefile);
+	g_free(dev->analog_filter);
+	if (dev->gaps)
+		g_array_free(dev->gaps, TRUE);
+}
+
+/* Parse the "<sample>:<count>" list of gaps which srzip records. */
+static int gaps_parse(const char *str, GArray **gaps)
+{
+	char **items, *start, *end;
+	uint64_t gap[2];
+	int i, ret;
+
+	*gaps = g_array_new(FALSE, FALSE, sizeof(gap));
+	items = g_strsplit(str, ";", 0);
+	ret = SR_OK;
+	for (i = 0; items[i] && ret == SR_OK; i++) {
+		start = items[i];
+		gap[0] = g_ascii_strtoull(start, &end, 10);
+		if (end == start || *end != ':') {
+			ret = SR_ERR_DATA;
+			break;
+		}
+		start = end + 1;
+		gap[1] = g_ascii_strtoull(start, &end, 10);
+		if (end == start || *end)
+			ret = SR_ERR_DATA;
+		else
+			g_array_append_vals(*gaps, gap, 1);
+	}
+	g_strfreev(items);
+
+	return ret;
+}
+
+/* Get the channel number of a "probeN" or "analogN" key, 0 if none. */
+static uint64_t key_channel(const char *key)
+{
+	size_t len;
+
+	if (g_str_has_prefix(key, "probe"))
+		len = strlen("probe");
+	else if (g_str_has_prefix(key, "analog"))
+		len = strlen("analog");
+	else
+		return 0;
+	if (!g_ascii_isdigit(key[len]))
+		return 0;
+
+	return g_ascii_strtoull(key + len, NULL, 10);
+}
+
+/*
+ * Parse a device section of the metadata. Returns SR_ERR_NA for
+ * sections without sample data.
+ */
+static int device_parse(GKeyFile *kf, const char *section,
+		struct sr_sessionfile_device *dev)
+{
+	GError *error;
+	char **keys, *val;
+	uint64_t num;
+	int ret, i;
+
+	memset(dev, 0, sizeof(*dev));
+	keys = g_key_file_get_keys(kf, section, NULL, NULL);
+	if (!keys)
+		return SR_ERR_NA;
+
+	error = NULL;
+	ret = SR_OK;
+	for (i = 0; keys[i] && ret == SR_OK; i++) {
+		if (!strcmp(keys[i], "capturefile")) {
+			dev->capturefile = g_key_file_get_string(kf, section,
+				keys[i], NULL);
+		} else if (!strcmp(keys[i], "samplerate")) {
+			val = g_key_file_get_string(kf, section, keys[i], NULL);
+			if (!val || sr_parse_sizestring(val,
+					&dev->samplerate) != SR_OK)
+				ret = SR_ERR_DATA;
+			g_free(val);
+		} else if (!strcmp(keys[i], "unitsize")) {
+			dev->unitsize = g_key_file_get_integer(kf, section,
+				keys[i], &error);
+		} else if (!strcmp(keys[i], "total probes")) {
+			dev->total_logic = g_key_file_get_integer(kf, section,
+				keys[i], &error);
+			if (dev->total_logic < 0)
+				ret = SR_ERR_DATA;
+		} else if (!strcmp(keys[i], "total analog")) {
+			dev->total_analog = g_key_file_get_integer(kf, section,
+				keys[i], &error);
+			if (dev->total_analog < 0)
+				ret = SR_ERR_DATA;
+		} else if (!strcmp(keys[i], "analog filter")) {
+			dev->analog_filter = g_key_file_get_string(kf, section,
+				keys[i], NULL);
+			if (sr_sessionfile_filter_from_name(dev->analog_filter) < 0) {
+				sr_err("Unknown analog filter '%s'.",
+					dev->analog_filter);
+				ret = SR_ERR_DATA;
+			}
+		} else if (!strcmp(keys[i], "summary block")) {
+			dev->summary_block = g_key_file_get_uint64(kf, section,
+				keys[i], NULL);
+		} else if (!strcmp(keys[i], "summary levels")) {
+			dev->summary_levels = g_key_file_get_integer(kf,
+				section, keys[i], NULL);
+		} else if (!strcmp(keys[i], "frame delta")) {
+			dev->frame_delta = g_key_file_get_uint64(kf, section,
+				keys[i], &error);
+		} else if (!strcmp(keys[i], "gaps") && !dev->gaps) {
+			val = g_key_file_get_string(kf, section, keys[i], NULL);
+			if (!val || gaps_parse(val, &dev->gaps) != SR_OK)
+				ret = SR_ERR_DATA;
+			g_free(val);
+		}
+		if (error) {
+			sr_err("Failed to parse metadata: %s", error->message);
+			g_clear_error(&error);
+			ret = SR_ERR_DATA;
+		}
+	}
+	if (ret == SR_OK && !dev->capturefile && dev->total_analog <= 0)
+		ret = SR_ERR_NA;
+
+	/* Channel names, as sr_session_save() writes them. */
+	if (ret == SR_OK)
+		dev->names = g_malloc0_n(dev->total_logic + dev->total_analog + 1,
+			sizeof(char *));
+	for (i = 0; ret == SR_OK && keys[i]; i++) {
+		if (!(num = key_channel(keys[i])))
+			continue;
+		if (num > (uint64_t)(dev->total_logic + dev->total_analog)) {
+			ret = SR_ERR_DATA;
+			break;
+		}
+		g_free(dev->names[num - 1]);
+		dev->names[num - 1] = g_key_file_get_string(kf, section,
+			keys[i], NULL);
+	}
+	g_strfreev(keys);
+
+	if (ret != SR_OK)
+		device_clear(dev);
+
+	return ret;
+}
+
+/**
+ * Parse the metadata of an open session archive, its chunk index and
+ * its frame list.
+ *
+ * @param[in] archive An open ZIP archive.
+ * @param[out] meta The parsed metadata, with one reference.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_DATA Malformed session file.
+ *
+ * @private
+ */
+SR_PRIV int sr_sessionfile_meta_read(struct zip *archive,
+		struct sr_session_file_meta **meta)
+{
+	struct sr_session_file_meta *m;
+	struct sr_sessionfile_device dev;
+	struct zip_stat zs;
+	GKeyFile *kf;
+	char **sections;
+	int ret, i;
+
+	*meta = NULL;
+	if (zip_stat(archive, "metadata", 0, &zs) < 0
+			|| !(kf = sr_sessionfile_read_metadata(archive, &zs)))
+		return SR_ERR_DATA;
+
+	m = g_malloc0(sizeof(*m));
+	m->ref_count = 1;
+	m->devices = g_array_new(FALSE, FALSE, sizeof(dev));
+	m->captures = g_hash_table_new_full(g_str_hash, g_str_equal,
+		g_free, sr_sessionfile_chunks_free);
+
+	ret = SR_OK;
+	sections = g_key_file_get_groups(kf, NULL);
+	for (i = 0; sections[i] && ret == SR_OK; i++) {
+		if (!g_str_has_prefix(sections[i], "device "))
+			continue;
+		ret = device_parse(kf, sections[i], &dev);
+		if (ret == SR_OK)
+			g_array_append_val(m->devices, dev);
+		else if (ret == SR_ERR_NA)
+			ret = SR_OK;
+	}
+	g_strfreev(sections);
+	g_key_file_free(kf);
+
+	if (ret == SR_OK) {
+		ret = index_load(archive, m->captures);
+		if (ret == SR_ERR_NA)
+			ret = SR_OK;
+	}
+	if (ret == SR_OK) {
+		ret = frames_load(archive, &m->frames);
+		if (ret == SR_ERR_NA)
+			ret = SR_OK;
+	}
+	if (ret != SR_OK) {
+		sr_session_file_meta_unref(m);
+		return SR_ERR_DATA;
+	}
+	*meta = m;
+
+	return SR_OK;
+}
+
+/**
+ * Get the metadata of a session file.
+ *
+ * The metadata gets parsed once, the context keeps it for later calls.
+ * It gets parsed again when the size or the modification time of the
+ * file changed. Tools which list many session files don't need to open
+ * each archive again then.
+ *
+ * @param[in] ctx The libsigrok context. Must not be NULL.
+ * @param[in] filename The name of the session file. Must not be NULL.
+ * @param[out] meta Pointer to store a new reference to the metadata at.
+ *             Must not be NULL. Release it with
+ *             sr_session_file_meta_unref().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Not a session file.
+ * @retval SR_ERR_DATA Malformed session file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_meta_get(struct sr_context *ctx,
+		const char *filename, struct sr_session_file_meta **meta)
+{
+	struct sr_session_file_meta *m;
+	struct zip *archive;
+	GStatBuf st;
+	int ret;
+
+	if (!ctx || !filename || !meta)
+		return SR_ERR_ARG;
+	*meta = NULL;
+
+	if (g_stat(filename, &st) < 0)
+		memset(&st, 0, sizeof(st));
+	if (ctx->sessionfile_cache) {
+		m = g_hash_table_lookup(ctx->sessionfile_cache, filename);
+		if (m && m->size == st.st_size && m->mtime == (gint64)st.st_mtime) {
+			g_atomic_int_inc(&m->ref_count);
+			*meta = m;
+			return SR_OK;
+		}
+	}
+
+	if (!(archive = archive_open_checked(filename, &ret)))
+		return ret;
+	ret = sr_sessionfile_meta_read(archive, &m);
 	zip_discard(archive);
+	if (ret != SR_OK)
+		return ret;
+	m->size = st.st_size;
+	m->mtime = st.st_mtime;
+
+	if (!ctx->sessionfile_cache)
+		ctx->sessionfile_cache = g_hash_table_new_full(g_str_hash,
+			g_str_equal, g_free,
+			(GDestroyNotify)sr_session_file_meta_unref);
+	g_atomic_int_inc(&m->ref_count);
+	g_hash_table_replace(ctx->sessionfile_cache, g_strdup(filename), m);
+	*meta = m;
 
 	return SR_OK;
 }
 
+/**
+ * Release a reference to session file metadata.
+ *
+ * @param[in] meta The metadata from sr_session_file_meta_get(). Can be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_session_file_meta_unref(struct sr_session_file_meta *meta)
+{
+	guint i;
+
+	if (!meta || !g_atomic_int_dec_and_test(&meta->ref_count))
+		return;
+
+	for (i = 0; i < meta->devices->len; i++)
+		device_clear(&g_array_index(meta->devices,
+			struct sr_sessionfile_device, i));
+	g_array_free(meta->devices, TRUE);
+	g_hash_table_destroy(meta->captures);
+	if (meta->frames)
+		g_array_free(meta->frames, TRUE);
+	g_free(meta);
+}
+
+/**
+ * Get the properties of the data in a session file, from its metadata.
+ *
+ * These are the properties of the first device in the file.
+ *
+ * @param[in] meta The metadata. Must not be NULL.
+ * @param[out] samplerate The samplerate, 0 if unknown. Can be NULL.
+ * @param[out] unitsize The logic unit size, 0 if the file has no logic
+ *             data. Can be NULL.
+ * @param[out] num_logic The number of logic channels. Can be NULL.
+ * @param[out] num_analog The number of analog channels. Can be NULL.
+ * @param[out] num_samples The number of logic samples, from the chunk
+ *             index. 0 if the file has no index. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The file holds no sample data.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_meta_info(const struct sr_session_file_meta *meta,
+		uint64_t *samplerate, unsigned int *unitsize,
+		unsigned int *num_logic, unsigned int *num_analog,
+		uint64_t *num_samples)
+{
+	const struct sr_sessionfile_device *dev;
+	const struct sr_sessionfile_chunk *last;
+	GArray *chunks;
+
+	if (!meta)
+		return SR_ERR_ARG;
+	if (!meta->devices->len)
+		return SR_ERR_NA;
+	dev = &g_array_index(meta->devices, struct sr_sessionfile_device, 0);
+
+	if (samplerate)
+		*samplerate = dev->samplerate;
+	if (unitsize)
+		*unitsize = dev->capturefile ? MAX(dev->unitsize, 0) : 0;
+	if (num_logic)
+		*num_logic = dev->total_logic;
+	if (num_analog)
+		*num_analog = dev->total_analog;
+	if (num_samples) {
+		*num_samples = 0;
+		chunks = g_hash_table_lookup(meta->captures, "logic-1");
+		if (chunks && chunks->len) {
+			last = &g_array_index(chunks, struct sr_sessionfile_chunk,
+				chunks->len - 1);
+			*num_samples = last->first + last->count;
+		}
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Get the name of a channel in a session file, from its metadata.
+ *
+ * @param[in] meta The metadata. Must not be NULL.
+ * @param[in] index The index of the channel. Logic channels come first,
+ *            analog channels follow them.
+ *
+ * @return The name of the channel, which stays valid as long as the
+ *         metadata. NULL if the channel is unnamed or doesn't exist.
+ *
+ * @since 0.6.0
+ */
+SR_API const char *sr_session_file_meta_channel_name(
+		const struct sr_session_file_meta *meta, unsigned int index)
+{
+	const struct sr_sessionfile_device *dev;
+
+	if (!meta || !meta->devices->len)
+		return NULL;
+	dev = &g_array_index(meta->devices, struct sr_sessionfile_device, 0);
+	if (index >= (unsigned int)(dev->total_logic + dev->total_analog))
+		return NULL;
+
+	return dev->names[index];
+}
+
+/**
+ * Get a gap in the sample data of a session file, from its metadata.
+ *
+ * Devices which lost samples during the capture report the gaps, see
+ * SR_CONF_SAMPLES_LOST. The srzip output records them.
+ *
+ * @param[in] meta The metadata. Must not be NULL.
+ * @param[in] index The index of the gap, in the order of the capture.
+ * @param[out] sample The number of samples before the gap. Can be NULL.
+ * @param[out] count The number of lost samples, 0 if unknown. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The file has no gap with this index.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_meta_gap(const struct sr_session_file_meta *meta,
+		unsigned int index, uint64_t *sample, uint64_t *count)
+{
+	const struct sr_sessionfile_device *dev;
+	const uint64_t *gap;
+
+	if (!meta)
+		return SR_ERR_ARG;
+	if (!meta->devices->len)
+		return SR_ERR_NA;
+	dev = &g_array_index(meta->devices, struct sr_sessionfile_device, 0);
+	if (!dev->gaps || index >= dev->gaps->len)
+		return SR_ERR_NA;
+
+	gap = &g_array_index(dev->gaps, uint64_t, 2 * index);
+	if (sample)
+		*sample = gap[0];
+	if (count)
+		*count = gap[1];
+
+	return SR_OK;
+}
+
+/**
+ * Get a frame of a session file, from its metadata.
+ *
+ * The srzip output keeps the frames of captures which devices send in
+ * frames, like the acquisitions of an oscilloscope's segmented memory.
+ * The samples of a frame can be read with sr_session_file_read_logic()
+ * and sr_session_file_read_analog().
+ *
+ * @param[in] meta The metadata. Must not be NULL.
+ * @param[in] index The index of the frame, in the order of the capture.
+ * @param[out] sample The frame's first sample. Can be NULL.
+ * @param[out] count The number of samples in the frame. Can be NULL.
+ * @param[out] host_us The host time at which the frame's data arrived,
+ *             in microseconds since the epoch. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The file has no frame with this index.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_meta_frame(const struct sr_session_file_meta *meta,
+		unsigned int index, uint64_t *sample, uint64_t *count,
+		int64_t *host_us)
+{
+	const struct sr_sessionfile_frame *frame;
+
+	if (!meta)
+		return SR_ERR_ARG;
+	if (!meta->frames || index >= meta->frames->len)
+		return SR_ERR_NA;
+
+	frame = &g_array_index(meta->frames, struct sr_sessionfile_frame, index);
+	if (sample)
+		*sample = frame->first;
+	if (count)
+		*count = frame->count;
+	if (host_us)
+		*host_us = frame->host_us;
+
+	return SR_OK;
+}
+
+/**
+ * Drop the session file metadata which sr_session_file_meta_get() keeps.
+ *
+ * @param ctx libsigrok context. Must not be NULL.
+ *
+ * @private
+ */
+SR_PRIV void sr_sessionfile_cache_clear(struct sr_context *ctx)
+{
+	if (!ctx->sessionfile_cache)
+		return;
+
+	g_hash_table_destroy(ctx->sessionfile_cache);
+	ctx->sessionfile_cache = NULL;
+}
+
 /** @private */
 SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename, struct sr_session **session)
 {
@@ -192,6 +1251,46 @@ SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename, struct
 	return sdi;
 }
 
+/* Set up a virtual device for a device section of the metadata. */
+static void load_device(const char *filename, struct sr_session **session,
+		const struct sr_sessionfile_device *dev)
+{
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ch;
+	char channelname[SR_MAX_CHANNELNAME_LEN + 1];
+	int k;
+
+	sdi = sr_session_prepare_sdi(filename, session);
+	if (dev->capturefile)
+		sr_config_set(sdi, NULL, SR_CONF_CAPTUREFILE,
+				g_variant_new_string(dev->capturefile));
+	if (dev->capturefile && dev->unitsize > 0)
+		sr_config_set(sdi, NULL, SR_CONF_CAPTURE_UNITSIZE,
+				g_variant_new_uint64(dev->unitsize));
+	if (dev->samplerate)
+		sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+				g_variant_new_uint64(dev->samplerate));
+	if (dev->analog_filter)
+		sr_config_set(sdi, NULL, SR_CONF_CAPTURE_ANALOG_FILTER,
+				g_variant_new_string(dev->analog_filter));
+
+	sr_config_set(sdi, NULL, SR_CONF_NUM_LOGIC_CHANNELS,
+			g_variant_new_int32(dev->total_logic));
+	sr_config_set(sdi, NULL, SR_CONF_NUM_ANALOG_CHANNELS,
+			g_variant_new_int32(dev->total_analog));
+	for (k = 0; k < dev->total_logic + dev->total_analog; k++) {
+		g_snprintf(channelname, sizeof(channelname), "%d", k);
+		ch = sr_channel_new(sdi, k, k < dev->total_logic ?
+				SR_CHANNEL_LOGIC : SR_CHANNEL_ANALOG,
+				FALSE, channelname);
+		if (dev->names[k]) {
+			/* sr_session_save() */
+			sr_dev_channel_name_set(ch, dev->names[k]);
+			sr_dev_channel_enable(ch, TRUE);
+		}
+	}
+}
+
 /**
  * Load the session from the specified filename.
  *
@@ -207,190 +1306,24 @@ SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename, struct
 SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 		struct sr_session **session)
 {
-	GKeyFile *kf;
-	GError *error;
-	struct zip *archive;
-	struct zip_stat zs;
-	struct sr_dev_inst *sdi;
-	struct sr_channel *ch;
-	int ret, i, j;
-	uint64_t tmp_u64;
-	int total_channels, total_analog, k;
-	GSList *l;
-	int unitsize;
-	char **sections, **keys, *val;
-	char channelname[SR_MAX_CHANNELNAME_LEN + 1];
-	gboolean file_has_logic;
+	struct sr_session_file_meta *meta;
+	guint i;
+	int ret;
 
-	if ((ret = sr_sessionfile_check(filename)) != SR_OK)
+	if ((ret = sr_session_file_meta_get(ctx, filename, &meta)) != SR_OK)
 		return ret;
 
-	if (!(archive = zip_open(filename, 0, NULL)))
-		return SR_ERR;
-
-	if (zip_stat(archive, "metadata", 0, &zs) < 0) {
-		zip_discard(archive);
-		return SR_ERR;
-	}
-	kf = sr_sessionfile_read_metadata(archive, &zs);
-	zip_discard(archive);
-	if (!kf)
-		return SR_ERR_DATA;
-
 	if ((ret = sr_session_new(ctx, session)) != SR_OK) {
-		g_key_file_free(kf);
+		sr_session_file_meta_unref(meta);
 		return ret;
 	}
 
-	total_channels = 0;
-
-	error = NULL;
-	ret = SR_OK;
-	file_has_logic = FALSE;
-	sections = g_key_file_get_groups(kf, NULL);
-	for (i = 0; sections[i] && ret == SR_OK; i++) {
-		if (!strcmp(sections[i], "global"))
-			/* nothing really interesting in here yet */
-			continue;
-		if (!strncmp(sections[i], "device ", 7)) {
-			/* device section */
-			sdi = NULL;
-			keys = g_key_file_get_keys(kf, sections[i], NULL, NULL);
-
-			/* File contains analog data if there are analog channels. */
-			total_analog = g_key_file_get_integer(kf, sections[i],
-					"total analog",	&error);
-			if (total_analog > 0 && !error)
-				sdi = sr_session_prepare_sdi(filename, session);
-			g_clear_error(&error);
-
-			/* File contains logic data if a capturefile is set. */
-			val = g_key_file_get_string(kf, sections[i],
-				"capturefile", &error);
-			if (val && !error) {
-				if (!sdi)
-					sdi = sr_session_prepare_sdi(filename, session);
-				sr_config_set(sdi, NULL, SR_CONF_CAPTUREFILE,
-						g_variant_new_string(val));
-				g_free(val);
-				file_has_logic = TRUE;
-			}
-			g_clear_error(&error);
-
-			for (j = 0; keys[j]; j++) {
-				if (!strcmp(keys[j], "samplerate")) {
-					val = g_key_file_get_string(kf, sections[i],
-							keys[j], &error);
-					if (!sdi || !val || sr_parse_sizestring(val,
-								&tmp_u64) != SR_OK) {
-						g_free(val);
-						ret = SR_ERR_DATA;
-						break;
-					}
-					g_free(val);
-					sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
-							g_variant_new_uint64(tmp_u64));
-				} else if (!strcmp(keys[j], "unitsize") && file_has_logic) {
-					unitsize = g_key_file_get_integer(kf, sections[i],
-							keys[j], &error);
-					if (!sdi || unitsize <= 0 || error) {
-						ret = SR_ERR_DATA;
-						break;
-					}
-					sr_config_set(sdi, NULL, SR_CONF_CAPTURE_UNITSIZE,
-							g_variant_new_uint64(unitsize));
-				} else if (!strcmp(keys[j], "total probes")) {
-					total_channels = g_key_file_get_integer(kf,
-							sections[i], keys[j], &error);
-					if (!sdi || total_channels < 0 || error) {
-						ret = SR_ERR_DATA;
-						break;
-					}
-					sr_config_set(sdi, NULL, SR_CONF_NUM_LOGIC_CHANNELS,
-							g_variant_new_int32(total_channels));
-					for (k = 0; k < total_channels; k++) {
-						g_snprintf(channelname, sizeof(channelname),
-								"%d", k);
-						sr_channel_new(sdi, k, SR_CHANNEL_LOGIC,
-								FALSE, channelname);
-					}
-				} else if (!strcmp(keys[j], "total analog")) {
-					total_analog = g_key_file_get_integer(kf,
-							sections[i], keys[j], &error);
-					if (!sdi || total_analog < 0 || error) {
-						ret = SR_ERR_DATA;
-						break;
-					}
-					sr_config_set(sdi, NULL, SR_CONF_NUM_ANALOG_CHANNELS,
-							g_variant_new_int32(total_analog));
-					for (k = total_channels; k < (total_channels + total_analog); k++) {
-						g_snprintf(channelname, sizeof(channelname),
-								"%d", k);
-						sr_channel_new(sdi, k, SR_CHANNEL_ANALOG,
-								FALSE, channelname);
-					}
-				} else if (!strncmp(keys[j], "probe", 5)) {
-					tmp_u64 = g_ascii_strtoull(keys[j] + 5, NULL, 10);
-					if (!sdi || tmp_u64 == 0 || tmp_u64 > G_MAXINT) {
-						ret = SR_ERR_DATA;
-						break;
-					}
-					ch = g_slist_nth_data(sdi->channels, tmp_u64 - 1);
-					if (!ch) {
-						ret = SR_ERR_DATA;
-						break;
-					}
-					val = g_key_file_get_string(kf, sections[i],
-							keys[j], &error);
-					if (!val) {
-						ret = SR_ERR_DATA;
-						break;
-					}
-					/* sr_session_save() */
-					sr_dev_channel_name_set(ch, val);
-					g_free(val);
-					sr_dev_channel_enable(ch, TRUE);
-				} else if (!strncmp(keys[j], "analog", 6)) {
-					tmp_u64 = g_ascii_strtoull(keys[j]+6, NULL, 10);
-					if (!sdi || tmp_u64 == 0 || tmp_u64 > G_MAXINT) {
-						ret = SR_ERR_DATA;
-						break;
-					}
-					ch = NULL;
-					for (l = sdi->channels; l; l = l->next) {
-						ch = l->data;
-						if ((guint64)ch->index == tmp_u64 - 1)
-							break;
-						else
-							ch = NULL;
-					}
-					if (!ch) {
-						ret = SR_ERR_DATA;
-						break;
-					}
-					val = g_key_file_get_string(kf, sections[i],
-							keys[j], &error);
-					if (!val) {
-						ret = SR_ERR_DATA;
-						break;
-					}
-					/* sr_session_save() */
-					sr_dev_channel_name_set(ch, val);
-					g_free(val);
-					sr_dev_channel_enable(ch, TRUE);
-				}
-			}
-			g_strfreev(keys);
-		}
-	}
-	g_strfreev(sections);
-	g_key_file_free(kf);
+	for (i = 0; i < meta->devices->len; i++)
+		load_device(filename, session, &g_array_index(meta->devices,
+			struct sr_sessionfile_device, i));
+	sr_session_file_meta_unref(meta);
 
-	if (error) {
-		sr_err("Failed to parse metadata: %s", error->message);
-		g_error_free(error);
-	}
-	return ret;
+	return SR_OK;
 }
 
 /** @} */
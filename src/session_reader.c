@@ -0,0 +1,696 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <zip.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "session-reader"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Random access to the sample data of session files.
+ */
+
+/**
+ * @addtogroup grp_session
+ *
+ * @{
+ */
+
+/** @cond PRIVATE */
+struct sr_session_file {
+	struct zip *archive;
+	char *filename;
+	uint64_t samplerate;
+	unsigned int unitsize;
+	int analog_filter;
+	/* Samples per block of the finest summary level, 0 if none. */
+	uint64_t summary_block;
+	int summary_levels;
+	/* Chunk arrays of the capture files, by base name. */
+	GHashTable *captures;
+	/* Frames of the capture, and their keyframe interval (deltas). */
+	GArray *frames;
+	uint32_t frame_delta;
+	/* Scratch buffer for data which gets skipped or filtered. */
+	uint8_t *scratch;
+	size_t scratch_size;
+	/* Data of previous frames, which the deltas refer to. */
+	uint8_t *ref;
+	size_t ref_size;
+};
+/** @endcond */
+
+static GArray *captures_get(struct sr_session_file *f, const char *base)
+{
+	GArray *chunks;
+
+	chunks = g_hash_table_lookup(f->captures, base);
+	if (!chunks) {
+		chunks = g_array_new(FALSE, FALSE,
+			sizeof(struct sr_sessionfile_chunk));
+		g_hash_table_insert(f->captures, g_strdup(base), chunks);
+	}
+
+	return chunks;
+}
+
+/*
+ * Build the chunk list of a capture file from the archive directory,
+ * for files without an index. This only needs the member sizes.
+ */
+static GArray *index_scan(struct sr_session_file *f, const char *base,
+		size_t sample_size)
+{
+	struct zip_stat zs;
+	struct sr_sessionfile_chunk c;
+	GArray *chunks;
+	uint64_t first;
+	int i;
+
+	chunks = captures_get(f, base);
+	first = 0;
+	if (zip_stat(f->archive, base, 0, &zs) == 0) {
+		/* Old files have a single, unchunked member. */
+		c.name = g_strdup(base);
+		c.first = 0;
+		c.count = zs.size / sample_size;
+		g_array_append_val(chunks, c);
+		return chunks;
+	}
+	for (i = 1; ; i++) {
+		c.name = g_strdup_printf("%s-%d", base, i);
+		if (zip_stat(f->archive, c.name, 0, &zs) < 0) {
+			g_free(c.name);
+			break;
+		}
+		c.first = first;
+		c.count = zs.size / sample_size;
+		first += c.count;
+		g_array_append_val(chunks, c);
+	}
+	sr_dbg("Scanned %u chunks of '%s'.", chunks->len, base);
+
+	return chunks;
+}
+
+static GArray *chunks_get(struct sr_session_file *f, const char *base,
+		size_t sample_size)
+{
+	GArray *chunks;
+
+	chunks = g_hash_table_lookup(f->captures, base);
+	if (chunks && chunks->len)
+		return chunks;
+
+	return index_scan(f, base, sample_size);
+}
+
+/* Find the chunk which holds a sample, by bisection. */
+static const struct sr_sessionfile_chunk *chunk_find(GArray *chunks,
+		uint64_t sample)
+{
+	const struct sr_sessionfile_chunk *c;
+	guint lo, hi, mid;
+
+	lo = 0;
+	hi = chunks->len;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		c = &g_array_index(chunks, struct sr_sessionfile_chunk, mid);
+		if (sample < c->first)
+			hi = mid;
+		else if (sample >= c->first + c->count)
+			lo = mid + 1;
+		else
+			return c;
+	}
+
+	return NULL;
+}
+
+static uint8_t *buffer_get(uint8_t **buf, size_t *buf_size, size_t size)
+{
+	if (size > *buf_size) {
+		g_free(*buf);
+		*buf = g_try_malloc(size);
+		*buf_size = *buf ? size : 0;
+	}
+
+	return *buf;
+}
+
+static uint8_t *scratch_get(struct sr_session_file *f, size_t size)
+{
+	return buffer_get(&f->scratch, &f->scratch_size, size);
+}
+
+/* Read bytes of an archive member, starting at an offset. */
+static int chunk_read(struct sr_session_file *f, const char *name,
+		uint64_t offset, void *buf, uint64_t len)
+{
+	struct zip_file *zf;
+	uint8_t *skip;
+	zip_int64_t ret;
+	uint64_t n;
+
+	if (!(zf = zip_fopen(f->archive, name, 0))) {
+		sr_err("Failed to open '%s': %s", name, zip_strerror(f->archive));
+		return SR_ERR_DATA;
+	}
+
+	/* Compressed members cannot seek, read up to the offset then. */
+#if HAVE_ZIP_FSEEK
+	if (offset && zip_fseek(zf, offset, SEEK_SET) == 0)
+		offset = 0;
+#endif
+	while (offset) {
+		n = MIN(offset, 64 * 1024);
+		if (!(skip = scratch_get(f, n))) {
+			zip_fclose(zf);
+			return SR_ERR_MALLOC;
+		}
+		if (zip_fread(zf, skip, n) != (zip_int64_t)n) {
+			zip_fclose(zf);
+			return SR_ERR_DATA;
+		}
+		offset -= n;
+	}
+
+	ret = zip_fread(zf, buf, len);
+	zip_fclose(zf);
+	if (ret != (zip_int64_t)len) {
+		sr_err("Short read of '%s'.", name);
+		return SR_ERR_DATA;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Read a range of samples of a capture file, as they are stored. Filtered
+ * (analog) chunks get decoded as a whole.
+ */
+static int samples_read_raw(struct sr_session_file *f, GArray *chunks,
+		size_t sample_size, gboolean filtered, uint64_t start,
+		uint64_t count, void *buf, uint64_t *samples_read)
+{
+	const struct sr_sessionfile_chunk *c;
+	uint8_t *out, *raw;
+	float *values;
+	uint64_t n;
+	int ret;
+
+	*samples_read = 0;
+	out = buf;
+	while (count && (c = chunk_find(chunks, start))) {
+		n = MIN(count, c->first + c->count - start);
+		if (!filtered) {
+			ret = chunk_read(f, c->name,
+				(start - c->first) * sample_size,
+				out, n * sample_size);
+		} else {
+			/* Filters span whole chunks, undo them first. */
+			raw = g_try_malloc(c->count * sizeof(float));
+			values = g_try_malloc(c->count * sizeof(float));
+			ret = raw && values ? SR_OK : SR_ERR_MALLOC;
+			if (ret == SR_OK)
+				ret = chunk_read(f, c->name, 0,
+					raw, c->count * sizeof(float));
+			if (ret == SR_OK) {
+				sr_sessionfile_filter_revert(f->analog_filter,
+					raw, values, c->count);
+				memcpy(out, values + (start - c->first),
+					n * sizeof(float));
+			}
+			g_free(raw);
+			g_free(values);
+		}
+		if (ret != SR_OK)
+			return ret;
+		out += n * sample_size;
+		start += n;
+		count -= n;
+		*samples_read += n;
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Undo the frame deltas in a range of samples. Frames other than the
+ * keyframes hold the difference to the previous frame, as far as that
+ * one reaches. Each sample then is the XOR of the stored samples at the
+ * same offset in the frames back to the keyframe.
+ */
+static int frames_undelta(struct sr_session_file *f, GArray *chunks,
+		size_t sample_size, gboolean filtered, uint64_t start,
+		uint64_t count, uint8_t *buf)
+{
+	const struct sr_sessionfile_frame *frame, *prev;
+	uint64_t end, offset, n, got;
+	uint8_t *out, *ref;
+	guint i, j;
+	int ret;
+
+	if (!f->frame_delta || !f->frames)
+		return SR_OK;
+
+	end = start + count;
+	for (i = 0; i < f->frames->len; i++) {
+		frame = &g_array_index(f->frames, struct sr_sessionfile_frame, i);
+		if (frame->first >= end)
+			break;
+		if (!(i % f->frame_delta) || frame->first + frame->count <= start)
+			continue;
+
+		/* The part of the range which lies in the frame. */
+		offset = MAX(start, frame->first) - frame->first;
+		n = MIN(end, frame->first + frame->count) - frame->first - offset;
+		out = buf + (frame->first + offset - start) * sample_size;
+		for (j = i; j-- > 0; ) {
+			prev = &g_array_index(f->frames,
+				struct sr_sessionfile_frame, j);
+			if (offset >= prev->count)
+				break;
+			n = MIN(n, prev->count - offset);
+			if (!(ref = buffer_get(&f->ref, &f->ref_size,
+					n * sample_size)))
+				return SR_ERR_MALLOC;
+			ret = samples_read_raw(f, chunks, sample_size, filtered,
+				prev->first + offset, n, ref, &got);
+			if (ret != SR_OK)
+				return ret;
+			sr_sessionfile_xor(out, ref, got * sample_size);
+			if (!(j % f->frame_delta))
+				break;
+		}
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Open a session file for random access to its sample data.
+ *
+ * Files which the srzip output wrote hold an index of their chunks.
+ * For other files, the chunks get looked up once, when their data is
+ * first read.
+ *
+ * @param[in] filename The name of the session file. Must not be NULL.
+ * @param[out] file Pointer to store the new handle at. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Not a session file.
+ * @retval SR_ERR_DATA Malformed session file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_open(const char *filename,
+		struct sr_session_file **file)
+{
+	struct sr_session_file *f;
+	struct sr_session_file_meta *meta;
+	const struct sr_sessionfile_device *dev;
+	int ret;
+
+	if (!filename || !file)
+		return SR_ERR_ARG;
+	*file = NULL;
+
+	if ((ret = sr_sessionfile_check(filename)) != SR_OK)
+		return ret;
+
+	f = g_malloc0(sizeof(*f));
+	f->filename = g_strdup(filename);
+	if (!(f->archive = zip_open(filename, 0, NULL))
+			|| sr_sessionfile_meta_read(f->archive, &meta) != SR_OK) {
+		sr_session_file_close(f);
+		return SR_ERR_DATA;
+	}
+	f->captures = g_hash_table_ref(meta->captures);
+
+	if (meta->devices->len) {
+		dev = &g_array_index(meta->devices,
+			struct sr_sessionfile_device, 0);
+		f->samplerate = dev->samplerate;
+		f->unitsize = MAX(dev->unitsize, 0);
+		f->summary_block = dev->summary_block;
+		f->summary_levels = MIN(dev->summary_levels,
+			SR_SESSIONFILE_SUMMARY_LEVELS);
+		f->analog_filter = sr_sessionfile_filter_from_name(
+			dev->analog_filter);
+		f->frame_delta = dev->frame_delta;
+	}
+	if (meta->frames)
+		f->frames = g_array_ref(meta->frames);
+	if (f->summary_levels <= 0)
+		f->summary_block = 0;
+	sr_session_file_meta_unref(meta);
+
+	*file = f;
+
+	return SR_OK;
+}
+
+/**
+ * Close a session file which was opened for random access.
+ *
+ * @param[in] file The handle from sr_session_file_open(). Can be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_session_file_close(struct sr_session_file *file)
+{
+	if (!file)
+		return;
+
+	if (file->archive)
+		zip_discard(file->archive);
+	if (file->captures)
+		g_hash_table_unref(file->captures);
+	if (file->frames)
+		g_array_unref(file->frames);
+	g_free(file->scratch);
+	g_free(file->ref);
+	g_free(file->filename);
+	g_free(file);
+}
+
+/**
+ * Get the properties of the logic data in a session file.
+ *
+ * @param[in] file The session file. Must not be NULL.
+ * @param[out] samplerate The samplerate, 0 if unknown. Can be NULL.
+ * @param[out] unitsize The logic unit size, 0 if the file has no logic
+ *             data. Can be NULL.
+ * @param[out] num_samples The number of logic samples. Can be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_logic_info(struct sr_session_file *file,
+		uint64_t *samplerate, unsigned int *unitsize,
+		uint64_t *num_samples)
+{
+	GArray *chunks;
+	const struct sr_sessionfile_chunk *last;
+
+	if (!file)
+		return SR_ERR_ARG;
+
+	if (samplerate)
+		*samplerate = file->samplerate;
+	if (unitsize)
+		*unitsize = file->unitsize;
+	if (num_samples) {
+		*num_samples = 0;
+		if (file->unitsize) {
+			chunks = chunks_get(file, "logic-1", file->unitsize);
+			if (chunks->len) {
+				last = &g_array_index(chunks,
+					struct sr_sessionfile_chunk,
+					chunks->len - 1);
+				*num_samples = last->first + last->count;
+			}
+		}
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Read a range of logic samples from a session file.
+ *
+ * Only the chunks which hold the range get read. In files with frame
+ * deltas, these include the chunks of the frames back to the keyframe.
+ *
+ * @param[in] file The session file. Must not be NULL.
+ * @param[in] start The number of the first sample to read.
+ * @param[in] count The number of samples to read.
+ * @param[out] buf Buffer for count * unitsize bytes. Must not be NULL.
+ * @param[out] samples_read The number of samples read, less than
+ *             @a count at the end of the data. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The file has no logic data.
+ * @retval SR_ERR_DATA Malformed session file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_read_logic(struct sr_session_file *file,
+		uint64_t start, uint64_t count, void *buf,
+		uint64_t *samples_read)
+{
+	GArray *chunks;
+	int ret;
+
+	if (!file || !buf || !samples_read)
+		return SR_ERR_ARG;
+	*samples_read = 0;
+	if (!file->unitsize)
+		return SR_ERR_NA;
+
+	chunks = chunks_get(file, "logic-1", file->unitsize);
+	ret = samples_read_raw(file, chunks, file->unitsize, FALSE,
+		start, count, buf, samples_read);
+	if (ret == SR_OK) {
+		ret = frames_undelta(file, chunks, file->unitsize, FALSE,
+			start, *samples_read, buf);
+	}
+
+	return ret;
+}
+
+/**
+ * Read a range of samples of an analog channel from a session file.
+ *
+ * @param[in] file The session file. Must not be NULL.
+ * @param[in] channel The number of the channel in the file, as in the
+ *            "analogN" metadata keys.
+ * @param[in] start The number of the first sample to read.
+ * @param[in] count The number of samples to read.
+ * @param[out] buf Buffer for @a count values. Must not be NULL.
+ * @param[out] samples_read The number of samples read, less than
+ *             @a count at the end of the data. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_DATA Malformed session file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_read_analog(struct sr_session_file *file,
+		unsigned int channel, uint64_t start, uint64_t count,
+		float *buf, uint64_t *samples_read)
+{
+	GArray *chunks;
+	char base[32];
+	gboolean filtered;
+	int ret;
+
+	if (!file || !buf || !samples_read)
+		return SR_ERR_ARG;
+	*samples_read = 0;
+
+	g_snprintf(base, sizeof(base), "analog-1-%u", channel);
+	chunks = chunks_get(file, base, sizeof(float));
+	filtered = file->analog_filter != SR_SESSIONFILE_FILTER_NONE;
+	ret = samples_read_raw(file, chunks, sizeof(float), filtered,
+		start, count, buf, samples_read);
+	if (ret == SR_OK) {
+		ret = frames_undelta(file, chunks, sizeof(float), filtered,
+			start, *samples_read, buf);
+	}
+
+	return ret;
+}
+
+/*
+ * Read the summary records of a capture file which cover a sample range,
+ * from the coarsest level whose blocks hold at most the requested number
+ * of samples.
+ */
+static int summary_read(struct sr_session_file *f, const char *base,
+		size_t record_size, uint64_t start, uint64_t count,
+		uint64_t *block_size, uint64_t *num_blocks, uint8_t **records)
+{
+	struct zip_stat zs;
+	char name[64];
+	uint64_t block, first, last, total;
+	int level;
+
+	*records = NULL;
+	if (!f->summary_block)
+		return SR_ERR_NA;
+	if (!count || !*num_blocks || !*block_size)
+		return SR_ERR_ARG;
+
+	level = 0;
+	block = f->summary_block;
+	while (level + 1 < f->summary_levels
+			&& block * SR_SESSIONFILE_SUMMARY_FACTOR <= *block_size) {
+		block *= SR_SESSIONFILE_SUMMARY_FACTOR;
+		level++;
+	}
+
+	g_snprintf(name, sizeof(name), "summary-%s-%d", base, level);
+	if (zip_stat(f->archive, name, 0, &zs) < 0)
+		return SR_ERR_NA;
+	total = zs.size / record_size;
+
+	first = start / block;
+	last = MIN((start + count - 1) / block + 1, total);
+	last = MIN(last, first + *num_blocks);
+	*block_size = block;
+	*num_blocks = 0;
+	if (first >= last)
+		return SR_OK;
+
+	*records = g_try_malloc((last - first) * record_size);
+	if (!*records)
+		return SR_ERR_MALLOC;
+	*num_blocks = last - first;
+
+	return chunk_read(f, name, first * record_size, *records,
+		*num_blocks * record_size);
+}
+
+/**
+ * Read a summary of logic samples from a session file.
+ *
+ * The srzip output writes summaries when its 'summary' option is set.
+ * Each summary block tells which channels changed within the block,
+ * and the number of sample to sample changes. The first block starts
+ * at or before @a start, at a multiple of the block size.
+ *
+ * @param[in] file The session file. Must not be NULL.
+ * @param[in] start The number of the first sample of the range.
+ * @param[in] count The number of samples in the range.
+ * @param[in,out] block_size In: The desired number of samples per block.
+ *                Out: The block size of the summary level which got used,
+ *                the coarsest one which does not exceed the request.
+ * @param[out] changed Buffer for unitsize bytes per block, the bits of
+ *             the channels which changed. Must not be NULL.
+ * @param[out] transitions Buffer for the number of changes per block.
+ *             Must not be NULL.
+ * @param[in,out] num_blocks In: The number of blocks the buffers hold.
+ *                Out: The number of blocks read.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The file holds no summaries.
+ * @retval SR_ERR_DATA Malformed session file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_read_logic_summary(struct sr_session_file *file,
+		uint64_t start, uint64_t count, uint64_t *block_size,
+		uint8_t *changed, uint32_t *transitions, uint64_t *num_blocks)
+{
+	uint8_t *records, *rec;
+	uint64_t i;
+	int ret;
+
+	if (!file || !block_size || !changed || !transitions || !num_blocks)
+		return SR_ERR_ARG;
+	if (!file->unitsize)
+		return SR_ERR_NA;
+
+	ret = summary_read(file, "logic-1", file->unitsize + sizeof(uint32_t),
+		start, count, block_size, num_blocks, &records);
+	if (ret == SR_OK) {
+		for (i = 0; i < *num_blocks; i++) {
+			rec = records + i * (file->unitsize + sizeof(uint32_t));
+			memcpy(changed + i * file->unitsize, rec, file->unitsize);
+			transitions[i] = RL32(rec + file->unitsize);
+		}
+	}
+	g_free(records);
+
+	return ret;
+}
+
+/**
+ * Read a summary of analog samples from a session file.
+ *
+ * Each summary block holds the minimum and maximum of the samples in it.
+ * The selection of the blocks is as for
+ * sr_session_file_read_logic_summary().
+ *
+ * @param[in] file The session file. Must not be NULL.
+ * @param[in] channel The number of the channel in the file, as in the
+ *            "analogN" metadata keys.
+ * @param[in] start The number of the first sample of the range.
+ * @param[in] count The number of samples in the range.
+ * @param[in,out] block_size In: The desired number of samples per block.
+ *                Out: The block size of the summary level which got used.
+ * @param[out] min Buffer for the minimum per block. Must not be NULL.
+ * @param[out] max Buffer for the maximum per block. Must not be NULL.
+ * @param[in,out] num_blocks In: The number of blocks the buffers hold.
+ *                Out: The number of blocks read.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR_NA The file holds no summaries.
+ * @retval SR_ERR_DATA Malformed session file.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_read_analog_summary(struct sr_session_file *file,
+		unsigned int channel, uint64_t start, uint64_t count,
+		uint64_t *block_size, float *min, float *max,
+		uint64_t *num_blocks)
+{
+	char base[32];
+	uint8_t *records;
+	uint64_t i;
+	int ret;
+
+	if (!file || !block_size || !min || !max || !num_blocks)
+		return SR_ERR_ARG;
+
+	g_snprintf(base, sizeof(base), "analog-1-%u", channel);
+	ret = summary_read(file, base, 2 * sizeof(float),
+		start, count, block_size, num_blocks, &records);
+	if (ret == SR_OK) {
+		for (i = 0; i < *num_blocks; i++) {
+			memcpy(&min[i], records + i * 2 * sizeof(float),
+				sizeof(float));
+			memcpy(&max[i], records + (i * 2 + 1) * sizeof(float),
+				sizeof(float));
+		}
+	}
+	g_free(records);
+
+	return ret;
+}
+
+/** @} */
@@ -18,6 +18,7 @@
  */
 
 #include <config.h>
+#include <math.h>
 #include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -26,6 +27,9 @@
 #define LOG_PREFIX "soft-trigger"
 /** @endcond */
 
+/* Pre-trigger data in files is sent in pieces of this size. */
+#define PRE_TRIGGER_BOUNCE_SIZE	(64 * 1024)
+
 SR_PRIV int logic_channel_unitsize(GSList *channels)
 {
 	int number = 0;
@@ -41,6 +45,102 @@ SR_PRIV int logic_channel_unitsize(GSList *channels)
 	return (number + 7) / 8;
 }
 
+/*
+ * A trigger stage, compiled into masks over the sample data. Each mask
+ * has num_words 64-bit words, bit n of the sample is bit n % 64 of
+ * word n / 64. A sample matches the stage when the channels in 'level'
+ * have the values in 'value', and the channels in 'rising', 'falling'
+ * and 'edge' changed accordingly since the previous sample.
+ */
+struct soft_trigger_stage {
+	gboolean has_matches;
+	gboolean has_edges;
+	gboolean impossible;
+	uint64_t *level;
+	uint64_t *value;
+	uint64_t *rising;
+	uint64_t *falling;
+	uint64_t *edge;
+};
+
+static void stage_compile(struct soft_trigger_logic *stl,
+		const struct sr_trigger_stage *stage,
+		struct soft_trigger_stage *cs, uint64_t *masks)
+{
+	const struct sr_trigger_match *match;
+	uint64_t bit;
+	size_t word;
+	GSList *l;
+
+	cs->level = masks;
+	cs->value = masks + stl->num_words;
+	cs->rising = masks + 2 * stl->num_words;
+	cs->falling = masks + 3 * stl->num_words;
+	cs->edge = masks + 4 * stl->num_words;
+	cs->has_matches = stage->matches != NULL;
+
+	for (l = stage->matches; l; l = l->next) {
+		match = l->data;
+		if (!match->channel->enabled)
+			/* Ignore disabled channels with a trigger. */
+			continue;
+		if (match->channel->index >= stl->unitsize * 8) {
+			sr_warn("Trigger channel %s is not in the sample data.",
+				match->channel->name);
+			continue;
+		}
+		word = match->channel->index / 64;
+		bit = UINT64_C(1) << (match->channel->index % 64);
+		switch (match->match) {
+		case SR_TRIGGER_ZERO:
+		case SR_TRIGGER_ONE:
+			/* Conflicting levels on a channel never match. */
+			if ((cs->level[word] & bit) && ((cs->value[word] & bit)
+					!= (match->match == SR_TRIGGER_ONE ? bit : 0)))
+				cs->impossible = TRUE;
+			cs->level[word] |= bit;
+			if (match->match == SR_TRIGGER_ONE)
+				cs->value[word] |= bit;
+			break;
+		case SR_TRIGGER_RISING:
+			cs->rising[word] |= bit;
+			cs->has_edges = TRUE;
+			break;
+		case SR_TRIGGER_FALLING:
+			cs->falling[word] |= bit;
+			cs->has_edges = TRUE;
+			break;
+		case SR_TRIGGER_EDGE:
+			cs->edge[word] |= bit;
+			cs->has_edges = TRUE;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void trigger_compile(struct soft_trigger_logic *stl)
+{
+	uint64_t *masks;
+	GSList *l;
+	int i;
+
+	stl->num_words = (stl->unitsize + 7) / 8;
+	stl->num_stages = g_slist_length(stl->trigger->stages);
+	stl->stages = g_malloc0(stl->num_stages * sizeof(stl->stages[0]));
+	masks = g_malloc0(stl->num_stages * 5 * stl->num_words * sizeof(*masks));
+
+	for (l = stl->trigger->stages, i = 0; l; l = l->next, i++) {
+		stage_compile(stl, l->data, &stl->stages[i],
+			masks + i * 5 * stl->num_words);
+		stl->has_edges |= stl->stages[i].has_edges;
+	}
+
+	stl->fast_scan = stl->num_stages == 1 && stl->stages[0].has_matches
+		&& (stl->unitsize == 1 || stl->unitsize == 2);
+}
+
 SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
 		int pre_trigger_samples)
@@ -52,34 +152,53 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 	stl->trigger = trigger;
 	stl->unitsize = logic_channel_unitsize(sdi->channels);
 	stl->prev_sample = g_malloc0(stl->unitsize);
-	stl->pre_trigger_size = stl->unitsize * pre_trigger_samples;
-	stl->pre_trigger_buffer = g_try_malloc(stl->pre_trigger_size);
-	if (pre_trigger_samples > 0 && !stl->pre_trigger_buffer) {
-		/*
-		 * Error out if g_try_malloc() failed (or was invoked as
-		 * g_try_malloc(0)) *and* more than 0 pretrigger samples
-		 * were requested.
-		 */
-		soft_trigger_logic_free(stl);
-		return NULL;
-	}
-	stl->pre_trigger_head = stl->pre_trigger_buffer;
-
-	if (stl->pre_trigger_size > 0 && !stl->pre_trigger_buffer) {
+	trigger_compile(stl);
+	stl->pre_trigger_size = stl->unitsize * MAX(pre_trigger_samples, 0);
+	/* Large pre-trigger sizes go to a file beyond the memory budget. */
+	stl->pre_trigger_buffer = sr_spill_new(sr_dev_inst_context(sdi),
+		stl->pre_trigger_size);
+	if (!stl->pre_trigger_buffer) {
 		soft_trigger_logic_free(stl);
 		return NULL;
 	}
+	stl->pre_trigger_head = 0;
 
 	return stl;
 }
 
 SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *stl)
 {
-	g_free(stl->pre_trigger_buffer);
+	if (stl->stages)
+		g_free(stl->stages[0].level);
+	g_free(stl->stages);
+	sr_spill_free(stl->pre_trigger_buffer);
 	g_free(stl->prev_sample);
 	g_free(stl);
 }
 
+/*
+ * Re-arm the trigger for the next frame. The pre-trigger buffer is left
+ * empty by the previous trigger, and the previous sample is kept for
+ * edge matches, so this is cheap enough to run for every frame.
+ */
+SR_PRIV void soft_trigger_logic_rearm(struct soft_trigger_logic *stl)
+{
+	stl->cur_stage = 0;
+}
+
+/*
+ * Reset the trigger for another acquisition, as if it was new. This
+ * keeps the compiled stages and the pre-trigger buffer's allocation.
+ */
+SR_PRIV void soft_trigger_logic_reset(struct soft_trigger_logic *stl)
+{
+	stl->cur_stage = 0;
+	stl->count = 0;
+	memset(stl->prev_sample, 0, stl->unitsize);
+	stl->pre_trigger_head = 0;
+	stl->pre_trigger_fill = 0;
+}
+
 static void pre_trigger_append(struct soft_trigger_logic *stl,
 		uint8_t *buf, int len)
 {
@@ -95,23 +214,65 @@ static void pre_trigger_append(struct soft_trigger_logic *stl,
 
 	/* Actually copy data to the pre-trigger circular buffer. */
 	while (len > 0) {
-		size_t size = MIN(stl->pre_trigger_buffer + stl->pre_trigger_size
-		                  - stl->pre_trigger_head, len);
-		memcpy(stl->pre_trigger_head, buf, size);
+		int size = MIN(stl->pre_trigger_size - stl->pre_trigger_head, len);
+		sr_spill_write(stl->pre_trigger_buffer, stl->pre_trigger_head,
+			buf, size);
 		stl->pre_trigger_head += size;
-		if (stl->pre_trigger_head >= stl->pre_trigger_buffer
-		                             + stl->pre_trigger_size)
-			stl->pre_trigger_head = stl->pre_trigger_buffer;
+		if (stl->pre_trigger_head >= stl->pre_trigger_size)
+			stl->pre_trigger_head = 0;
 		buf += size;
 		len -= size;
 	}
 }
 
+/*
+ * Send a region of a pre-trigger buffer. Buffers in memory are sent
+ * from there, buffers in a file by way of a bounce buffer, in pieces
+ * of whole samples.
+ */
+static void pre_trigger_send_region(struct soft_trigger_logic *stl,
+		struct sr_datafeed_packet *packet, int offset, int len)
+{
+	struct sr_datafeed_logic *logic;
+	uint8_t *buf;
+	int size;
+
+	logic = (struct sr_datafeed_logic *)packet->payload;
+	if ((buf = sr_spill_data(stl->pre_trigger_buffer))) {
+		logic->length = len;
+		logic->data = buf + offset;
+		sr_session_send(stl->sdi, packet);
+		return;
+	}
+
+	size = MAX(PRE_TRIGGER_BOUNCE_SIZE / stl->unitsize, 1) * stl->unitsize;
+	buf = g_malloc(MIN(size, len));
+	while (len > 0) {
+		size = MIN(size, len);
+		if (sr_spill_read(stl->pre_trigger_buffer, offset,
+				buf, size) != SR_OK)
+			break;
+		logic->length = size;
+		logic->data = buf;
+		sr_session_send(stl->sdi, packet);
+		offset += size;
+		len -= size;
+	}
+	g_free(buf);
+}
+
+/*
+ * Send the pre-trigger data. The samples before the trigger position in
+ * the current buffer (@a buf, @a len bytes) get sent from there directly.
+ * The circular buffer provides the older samples, in up to two packets
+ * of its contiguous regions.
+ */
 static void pre_trigger_send(struct soft_trigger_logic *stl,
-		int *pre_trigger_samples)
+		uint8_t *buf, int len, int *pre_trigger_samples)
 {
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
+	int ring_len, size, start;
 
 	packet.type = SR_DF_LOGIC;
 	packet.payload = &logic;
@@ -120,54 +281,142 @@ static void pre_trigger_send(struct soft_trigger_logic *stl,
 	if (pre_trigger_samples)
 		*pre_trigger_samples = 0;
 
-	/* If pre-trigger buffer not full, rewind head to the first valid sample. */
-	if (stl->pre_trigger_fill < stl->pre_trigger_size)
-		stl->pre_trigger_head = stl->pre_trigger_buffer;
+	/* Avoid sending more than the pre-trigger size. */
+	if (len > stl->pre_trigger_size) {
+		buf += len - stl->pre_trigger_size;
+		len = stl->pre_trigger_size;
+	}
+
+	/* The newest ring_len bytes of the circular buffer end at head. */
+	ring_len = MIN(stl->pre_trigger_fill, stl->pre_trigger_size - len);
+	start = stl->pre_trigger_head - ring_len;
+	if (start < 0)
+		start += stl->pre_trigger_size;
 
 	/* Send logic packets for the pre-trigger circular buffer content. */
-	while (stl->pre_trigger_fill > 0) {
-		size_t size = MIN(stl->pre_trigger_buffer + stl->pre_trigger_size
-		                  - stl->pre_trigger_head, stl->pre_trigger_fill);
-		logic.length = size;
-		logic.data = stl->pre_trigger_head;
-		sr_session_send(stl->sdi, &packet);
-		stl->pre_trigger_head = stl->pre_trigger_buffer;
-		stl->pre_trigger_fill -= size;
+	while (ring_len > 0) {
+		size = MIN(stl->pre_trigger_size - start, ring_len);
+		pre_trigger_send_region(stl, &packet, start, size);
+		start = 0;
+		ring_len -= size;
 		if (pre_trigger_samples)
 			*pre_trigger_samples += size / stl->unitsize;
 	}
+
+	if (len > 0) {
+		logic.length = len;
+		logic.data = buf;
+		sr_session_send(stl->sdi, &packet);
+		if (pre_trigger_samples)
+			*pre_trigger_samples += len / stl->unitsize;
+	}
+
+	stl->pre_trigger_head = 0;
+	stl->pre_trigger_fill = 0;
+}
+
+/* Load word @a word of a sample, missing bytes read as zero. */
+static inline uint64_t sample_word(const struct soft_trigger_logic *stl,
+		const uint8_t *sample, size_t word)
+{
+	uint64_t w;
+	size_t i, n;
+
+	n = MIN((size_t)stl->unitsize - word * 8, 8);
+	w = 0;
+	for (i = 0; i < n; i++)
+		w |= (uint64_t)sample[word * 8 + i] << (8 * i);
+
+	return w;
 }
 
-static gboolean logic_check_match(struct soft_trigger_logic *stl,
-		uint8_t *sample, struct sr_trigger_match *match)
+static gboolean stage_check_match(const struct soft_trigger_logic *stl,
+		const struct soft_trigger_stage *cs, const uint8_t *sample)
 {
-	int bit, prev_bit;
-	gboolean result;
+	uint64_t cur, prev, rose, fell;
+	size_t word;
+
+	if (cs->impossible)
+		return FALSE;
+	/* First sample, don't have enough for an edge match yet. */
+	if (cs->has_edges && stl->count == 1)
+		return FALSE;
 
-	stl->count++;
-	result = FALSE;
-	bit = *(sample + match->channel->index / 8)
-			& (1 << (match->channel->index % 8));
-	if (match->match == SR_TRIGGER_ZERO)
-		result = bit == 0;
-	else if (match->match == SR_TRIGGER_ONE)
-		result = bit != 0;
-	else {
-		/* Edge matches. */
-		if (stl->count == 1)
-			/* First sample, don't have enough for an edge match yet. */
+	for (word = 0; word < stl->num_words; word++) {
+		cur = sample_word(stl, sample, word);
+		if ((cur ^ cs->value[word]) & cs->level[word])
+			return FALSE;
+		if (!cs->has_edges)
+			continue;
+		prev = sample_word(stl, stl->prev_sample, word);
+		rose = ~prev & cur;
+		fell = prev & ~cur;
+		if ((rose & cs->rising[word]) != cs->rising[word])
+			return FALSE;
+		if ((fell & cs->falling[word]) != cs->falling[word])
+			return FALSE;
+		if (((rose | fell) & cs->edge[word]) != cs->edge[word])
 			return FALSE;
-		prev_bit = *(stl->prev_sample + match->channel->index / 8)
-				& (1 << (match->channel->index % 8));
-		if (match->match == SR_TRIGGER_RISING)
-			result = prev_bit == 0 && bit != 0;
-		else if (match->match == SR_TRIGGER_FALLING)
-			result = prev_bit != 0 && bit == 0;
-		else if (match->match == SR_TRIGGER_EDGE)
-			result = prev_bit != bit;
 	}
 
-	return result;
+	return TRUE;
+}
+
+/*
+ * Find the first sample at or after byte offset @a i which can match a
+ * single-stage trigger. Works on 64-bit words holding 8 or 4 samples of
+ * unitsize 1 or 2 (SWAR): lanes where the level channels have the wanted
+ * values, and (with edge matches) where at least one edge channel
+ * changed since the previous sample, are candidates. Only those need
+ * the exact check. Returns the offset of the first candidate, or the
+ * offset where fewer than a word of samples remain.
+ */
+static int scan_candidate(const struct soft_trigger_logic *stl,
+		const struct soft_trigger_stage *cs, const uint8_t *buf,
+		int i, int len)
+{
+	uint64_t lanes, high, low, value, mask, change;
+	uint64_t cur, prev, l, c, hits, prev_sample;
+	unsigned int bits, lane;
+
+	bits = 8 * stl->unitsize;
+	lanes = (bits == 8) ? UINT64_C(0x0101010101010101)
+		: UINT64_C(0x0001000100010001);
+	high = lanes << (bits - 1);
+	low = ~high;
+	mask = cs->level[0] * lanes;
+	value = (cs->value[0] & cs->level[0]) * lanes;
+	change = (cs->rising[0] | cs->falling[0] | cs->edge[0]) * lanes;
+
+	for (; i + 8 <= len; i += 8) {
+		cur = RL64(buf + i);
+
+		/* Lanes which are zero after masking match the levels. */
+		l = (cur ^ value) & mask;
+		hits = ~(((l & low) + low) | l) & high;
+
+		/* Lanes which changed on edge channels may match the edges. */
+		if (cs->has_edges) {
+			if (i > 0)
+				prev_sample = (bits == 8) ? R8(buf + i - 1)
+					: RL16(buf + i - 2);
+			else
+				prev_sample = (bits == 8) ? R8(stl->prev_sample)
+					: RL16(stl->prev_sample);
+			prev = (cur << bits) | prev_sample;
+			c = (cur ^ prev) & change;
+			hits &= (((c & low) + low) | c) & high;
+		}
+
+		if (!hits)
+			continue;
+		lane = 0;
+		while (!(hits & (UINT64_C(1) << (lane * bits + bits - 1))))
+			lane++;
+		return i + lane * stl->unitsize;
+	}
+
+	return i;
 }
 
 /* Returns the offset (in samples) within buf of where the trigger
@@ -175,42 +424,48 @@ static gboolean logic_check_match(struct soft_trigger_logic *stl,
 SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *stl,
 		uint8_t *buf, int len, int *pre_trigger_samples)
 {
-	struct sr_trigger_stage *stage;
-	struct sr_trigger_match *match;
-	GSList *l, *l_stage;
+	const struct soft_trigger_stage *cs;
 	int offset;
-	int i;
+	int i, skip;
 	gboolean match_found;
 
+	if (!stl->num_stages)
+		return SR_ERR_ARG;
+
 	offset = -1;
 	for (i = 0; i < len; i += stl->unitsize) {
-		l_stage = g_slist_nth(stl->trigger->stages, stl->cur_stage);
-		stage = l_stage->data;
-		if (!stage->matches)
+		cs = &stl->stages[stl->cur_stage];
+		if (!cs->has_matches)
 			/* No matches supplied, client error. */
 			return SR_ERR_ARG;
 
-		match_found = TRUE;
-		for (l = stage->matches; l; l = l->next) {
-			match = l->data;
-			if (!match->channel->enabled)
-				/* Ignore disabled channels with a trigger. */
-				continue;
-			if (!logic_check_match(stl, buf + i, match)) {
-				match_found = FALSE;
-				break;
+		/* Skip over samples which cannot match. */
+		if (stl->fast_scan && (stl->count || !stl->has_edges)) {
+			skip = scan_candidate(stl, cs, buf, i, len);
+			if (skip > i) {
+				stl->count += (skip - i) / stl->unitsize;
+				i = skip;
+				if (stl->has_edges)
+					memcpy(stl->prev_sample,
+						buf + i - stl->unitsize,
+						stl->unitsize);
+				if (i >= len)
+					break;
 			}
 		}
-		memcpy(stl->prev_sample, buf + i, stl->unitsize);
+
+		stl->count++;
+		match_found = stage_check_match(stl, cs, buf + i);
+		if (stl->has_edges)
+			memcpy(stl->prev_sample, buf + i, stl->unitsize);
 		if (match_found) {
 			/* Matched on the current stage. */
-			if (l_stage->next) {
+			if (stl->cur_stage + 1 < stl->num_stages) {
 				/* Advance to next stage. */
 				stl->cur_stage++;
 			} else {
 				/* Matched on last stage, send pre-trigger data. */
-				pre_trigger_append(stl, buf, i);
-				pre_trigger_send(stl, pre_trigger_samples);
+				pre_trigger_send(stl, buf, i, pre_trigger_samples);
 
 				/* Fire trigger. */
 				offset = i / stl->unitsize;
@@ -241,3 +496,714 @@ SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *stl,
 
 	return offset;
 }
+
+/* Decode @a count samples of run-length encoded data from @a first on. */
+static void rle_decode_range(const struct sr_datafeed_logic_rle *rle,
+		uint64_t first, uint64_t count, uint8_t *buf)
+{
+	const uint8_t *value;
+	uint64_t run, pos, n, i;
+
+	pos = 0;
+	for (run = 0; run < rle->num_runs && count; run++) {
+		if (pos + rle->lengths[run] <= first) {
+			pos += rle->lengths[run];
+			continue;
+		}
+		value = (const uint8_t *)rle->values + run * rle->unitsize;
+		n = MIN(pos + rle->lengths[run] - MAX(pos, first), count);
+		for (i = 0; i < n; i++) {
+			memcpy(buf, value, rle->unitsize);
+			buf += rle->unitsize;
+		}
+		count -= n;
+		pos += rle->lengths[run];
+	}
+}
+
+/* Have the pre-trigger data end with the samples before @a end. */
+static void rle_pre_trigger(struct soft_trigger_logic *stl,
+		const struct sr_datafeed_logic_rle *rle, uint64_t end,
+		gboolean send, int *pre_trigger_samples)
+{
+	uint64_t count;
+	uint8_t *buf;
+
+	count = MIN(end, (uint64_t)stl->pre_trigger_size / stl->unitsize);
+	buf = g_malloc(MAX(count, 1) * stl->unitsize);
+	rle_decode_range(rle, end - count, count, buf);
+	if (send)
+		pre_trigger_send(stl, buf, count * stl->unitsize,
+			pre_trigger_samples);
+	else
+		pre_trigger_append(stl, buf, count * stl->unitsize);
+	g_free(buf);
+}
+
+/*
+ * Check run-length encoded logic data for the trigger, see
+ * soft_trigger_logic_check(). The values have the unitsize of the
+ * trigger.
+ *
+ * Single stage triggers are checked a run at a time. All samples of a
+ * run have the same value, and only the first sample of a run can have
+ * changed from its predecessor. So the first sample of the run matches
+ * if any does: for level matches the whole run matches, and edges only
+ * occur at run boundaries. This costs in proportion to the number of
+ * runs rather than samples. Only the samples which end up in the
+ * pre-trigger buffer get decoded.
+ *
+ * Multi stage triggers can match within the samples of a run, the data
+ * gets decoded and checked sample by sample for them.
+ *
+ * Returns the offset (in samples) of where the trigger occurred, or -1
+ * if not triggered.
+ */
+SR_PRIV int64_t soft_trigger_logic_check_rle(struct soft_trigger_logic *stl,
+		const struct sr_datafeed_logic_rle *rle, int *pre_trigger_samples)
+{
+	const struct soft_trigger_stage *cs;
+	const uint8_t *value;
+	uint64_t run, pos, num_samples;
+	uint8_t *buf;
+	gboolean match_found;
+	int offset;
+
+	if (stl->num_stages != 1) {
+		num_samples = sr_logic_rle_num_samples(rle);
+		buf = g_malloc(MAX(num_samples, 1) * stl->unitsize);
+		sr_logic_rle_decode(rle, buf);
+		offset = soft_trigger_logic_check(stl, buf,
+			num_samples * stl->unitsize, pre_trigger_samples);
+		g_free(buf);
+		return offset;
+	}
+
+	cs = &stl->stages[0];
+	if (!cs->has_matches)
+		/* No matches supplied, client error. */
+		return SR_ERR_ARG;
+
+	pos = 0;
+	for (run = 0; run < rle->num_runs; run++) {
+		if (!rle->lengths[run])
+			continue;
+		value = (const uint8_t *)rle->values + run * stl->unitsize;
+		/* Only the ==1 and != 0 cases matter, don't let it wrap. */
+		stl->count = MIN(stl->count + 1, 2);
+		match_found = stage_check_match(stl, cs, value);
+		memcpy(stl->prev_sample, value, stl->unitsize);
+		if (match_found) {
+			rle_pre_trigger(stl, rle, pos, TRUE,
+				pre_trigger_samples);
+			std_session_send_df_trigger(stl->sdi);
+			return pos;
+		}
+		if (rle->lengths[run] > 1)
+			stl->count = 2;
+		pos += rle->lengths[run];
+	}
+
+	rle_pre_trigger(stl, rle, pos, FALSE, NULL);
+
+	return -1;
+}
+
+/*
+ * Analog soft triggers. Only the first stage of the trigger is used, and
+ * only the matches on its first analog channel:
+ *
+ *  - SR_TRIGGER_RISING and SR_TRIGGER_FALLING fire when the signal crosses
+ *    the match value. The signal has to be beyond the value by at least
+ *    the hysteresis before another crossing counts. With both matches,
+ *    either crossing fires. SR_TRIGGER_EDGE is short for both at the
+ *    same value.
+ *  - SR_TRIGGER_OVER and SR_TRIGGER_UNDER require the signal to be above
+ *    or below the match value. With both, the signal has to be within the
+ *    window, or outside of it when the OVER value exceeds the UNDER value.
+ *
+ * When levels and crossings are combined, a crossing only fires when the
+ * levels match at the same sample.
+ */
+
+/* Samples are scanned in blocks of this size, see analog_trigger_scan(). */
+#define ANALOG_SCAN_BLOCK	64
+
+/** Whether the trigger's first stage has matches on analog channels. */
+SR_PRIV gboolean soft_trigger_analog_wanted(const struct sr_trigger *trigger)
+{
+	const struct sr_trigger_stage *stage;
+	const struct sr_trigger_match *match;
+	GSList *l;
+
+	if (!trigger || !trigger->stages)
+		return FALSE;
+
+	stage = trigger->stages->data;
+	for (l = stage->matches; l; l = l->next) {
+		match = l->data;
+		if (match->channel->type == SR_CHANNEL_ANALOG
+				&& match->channel->enabled)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * Create an analog soft trigger. With @a frames set, a frame begin gets
+ * sent ahead of the pre-trigger samples whenever the trigger fires, for
+ * drivers which send one frame per trigger.
+ */
+SR_PRIV struct soft_trigger_analog *soft_trigger_analog_new(
+		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		int pre_trigger_samples, float hysteresis, gboolean frames)
+{
+	struct soft_trigger_analog *sta;
+	struct sr_trigger_stage *stage;
+	struct sr_trigger_match *match;
+	gboolean has_over, has_under;
+	float over, under;
+	GSList *l;
+
+	if (!trigger || !trigger->stages) {
+		sr_err("No trigger stages given.");
+		return NULL;
+	}
+	if (trigger->stages->next)
+		sr_warn("Only the first analog trigger stage is used.");
+
+	sta = g_malloc0(sizeof(struct soft_trigger_analog));
+	sta->sdi = sdi;
+	sta->hysteresis = MAX(hysteresis, 0);
+	sta->frames = frames;
+	sta->pre_trigger_samples = MAX(pre_trigger_samples, 0);
+
+	has_over = has_under = FALSE;
+	over = under = 0;
+	stage = trigger->stages->data;
+	for (l = stage->matches; l; l = l->next) {
+		match = l->data;
+		if (match->channel->type != SR_CHANNEL_ANALOG
+				|| !match->channel->enabled)
+			continue;
+		if (!sta->channel)
+			sta->channel = match->channel;
+		if (match->channel != sta->channel) {
+			sr_warn("Ignoring trigger on channel %s, only one "
+				"analog channel is supported.",
+				match->channel->name);
+			continue;
+		}
+		switch (match->match) {
+		case SR_TRIGGER_RISING:
+			sta->has_rising = TRUE;
+			sta->rising = match->value;
+			break;
+		case SR_TRIGGER_FALLING:
+			sta->has_falling = TRUE;
+			sta->falling = match->value;
+			break;
+		case SR_TRIGGER_EDGE:
+			sta->has_rising = sta->has_falling = TRUE;
+			sta->rising = sta->falling = match->value;
+			break;
+		case SR_TRIGGER_OVER:
+			has_over = TRUE;
+			over = match->value;
+			break;
+		case SR_TRIGGER_UNDER:
+			has_under = TRUE;
+			under = match->value;
+			break;
+		default:
+			sr_warn("Unsupported analog trigger match %d.",
+				match->match);
+			break;
+		}
+	}
+	if (!sta->channel) {
+		sr_err("No analog trigger matches given.");
+		g_free(sta);
+		return NULL;
+	}
+
+	/* Levels match within (over, under), or outside of it. */
+	sta->has_level = has_over || has_under;
+	sta->level_over = has_over ? over : -INFINITY;
+	sta->level_under = has_under ? under : INFINITY;
+	sta->level_outside = has_over && has_under && over > under;
+
+	return sta;
+}
+
+static void analog_buffers_free(struct soft_trigger_analog *sta)
+{
+	int i;
+
+	for (i = 0; sta->pre_trigger_buffers && i < sta->num_buffers; i++)
+		sr_spill_free(sta->pre_trigger_buffers[i]);
+	g_free(sta->pre_trigger_buffers);
+	g_free(sta->unitsizes);
+	sta->pre_trigger_buffers = NULL;
+	sta->unitsizes = NULL;
+	sta->num_buffers = 0;
+}
+
+SR_PRIV void soft_trigger_analog_free(struct soft_trigger_analog *sta)
+{
+	if (!sta)
+		return;
+
+	analog_buffers_free(sta);
+	g_free(sta->values);
+	g_free(sta);
+}
+
+/*
+ * Re-arm the trigger for the next frame. A crossing needs the signal
+ * beyond the hysteresis again before it counts.
+ */
+SR_PRIV void soft_trigger_analog_rearm(struct soft_trigger_analog *sta)
+{
+	sta->armed_rising = FALSE;
+	sta->armed_falling = FALSE;
+	sta->pre_trigger_head = 0;
+	sta->pre_trigger_fill = 0;
+}
+
+/*
+ * Reset the trigger for another acquisition, as if it was new. The
+ * pre-trigger buffers get set up again by the next check, as the set
+ * of channels may have changed.
+ */
+SR_PRIV void soft_trigger_analog_reset(struct soft_trigger_analog *sta)
+{
+	soft_trigger_analog_rearm(sta);
+	analog_buffers_free(sta);
+}
+
+static inline gboolean analog_level_match(const struct soft_trigger_analog *sta,
+		float value)
+{
+	if (!sta->has_level)
+		return TRUE;
+	if (sta->level_outside)
+		return value > sta->level_over || value < sta->level_under;
+
+	return value > sta->level_over && value < sta->level_under;
+}
+
+/*
+ * Whether any level match is within a block. There is no early exit,
+ * so that the compiler can vectorize the loops.
+ */
+static gboolean block_level_any(const struct soft_trigger_analog *sta,
+		const float *data, int len)
+{
+	float over, under;
+	int i, hit;
+
+	over = sta->level_over;
+	under = sta->level_under;
+	hit = 0;
+	if (sta->level_outside) {
+		for (i = 0; i < len; i++)
+			hit |= (data[i] > over) | (data[i] < under);
+	} else {
+		for (i = 0; i < len; i++)
+			hit |= (data[i] > over) & (data[i] < under);
+	}
+
+	return hit;
+}
+
+/* Whether any sample of a block is below @a low or above @a high. */
+static gboolean block_exceeds(const float *data, int len,
+		float low, float high)
+{
+	int i, hit;
+
+	hit = 0;
+	for (i = 0; i < len; i++)
+		hit |= (data[i] < low) | (data[i] > high);
+
+	return hit;
+}
+
+/*
+ * Whether a block can change the crossing state at all: with neither
+ * of the edges arming nor firing in it, the block can be skipped. The
+ * bounds are the tightest over both edges, so this errs on the side of
+ * scanning a block sample by sample.
+ */
+static gboolean block_has_crossing(const struct soft_trigger_analog *sta,
+		const float *data, int len)
+{
+	float low, high;
+
+	low = -INFINITY;
+	high = INFINITY;
+	if (sta->has_rising) {
+		if (sta->armed_rising)
+			high = nextafterf(sta->rising, -INFINITY);
+		else
+			low = sta->rising - sta->hysteresis;
+	}
+	if (sta->has_falling) {
+		if (sta->armed_falling)
+			low = MAX(low, nextafterf(sta->falling, INFINITY));
+		else
+			high = MIN(high, sta->falling + sta->hysteresis);
+	}
+
+	return block_exceeds(data, len, low, high);
+}
+
+/* Run the crossing state machine over a block, returns the firing sample. */
+static int block_crossing_scan(struct soft_trigger_analog *sta,
+		const float *data, int len)
+{
+	gboolean crossed;
+	float value;
+	int i;
+
+	for (i = 0; i < len; i++) {
+		value = data[i];
+		crossed = FALSE;
+		if (sta->has_rising) {
+			if (value < sta->rising - sta->hysteresis)
+				sta->armed_rising = TRUE;
+			else if (sta->armed_rising && value >= sta->rising)
+				crossed = TRUE;
+		}
+		if (sta->has_falling) {
+			if (value > sta->falling + sta->hysteresis)
+				sta->armed_falling = TRUE;
+			else if (sta->armed_falling && value <= sta->falling)
+				crossed = TRUE;
+		}
+		if (!crossed || !analog_level_match(sta, value))
+			continue;
+		sta->armed_rising = FALSE;
+		sta->armed_falling = FALSE;
+		return i;
+	}
+
+	return -1;
+}
+
+/*
+ * Returns the position of the first sample which fires, or -1. Blocks
+ * get checked with branch free loops first, only blocks which contain
+ * a match or a change of the crossing state are scanned sample by
+ * sample.
+ */
+static int analog_trigger_scan(struct soft_trigger_analog *sta,
+		const float *data, int num_samples)
+{
+	int pos, len, i;
+
+	for (pos = 0; pos < num_samples; pos += len) {
+		len = MIN(num_samples - pos, ANALOG_SCAN_BLOCK);
+		if (!sta->has_rising && !sta->has_falling) {
+			if (!block_level_any(sta, data + pos, len))
+				continue;
+			for (i = 0; !analog_level_match(sta, data[pos + i]); i++)
+				;
+			return pos + i;
+		}
+		if (!block_has_crossing(sta, data + pos, len))
+			continue;
+		if ((i = block_crossing_scan(sta, data + pos, len)) >= 0)
+			return pos + i;
+	}
+
+	return -1;
+}
+
+/* Sample data of a pre-trigger buffer's packet, logic data comes first. */
+static const uint8_t *analog_buffer_data(const struct soft_trigger_analog *sta,
+		const struct sr_datafeed_logic *logic,
+		const struct sr_datafeed_analog *analog, int idx)
+{
+	if (sta->has_logic && idx == 0)
+		return logic->data;
+
+	return analog[idx - sta->has_logic].data;
+}
+
+/* Set up the pre-trigger buffers, or check that the packets still fit. */
+static int analog_buffers_setup(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_logic *logic,
+		const struct sr_datafeed_analog *analog, int num_channels)
+{
+	int i, num_buffers, unitsize;
+
+	num_buffers = num_channels + (logic ? 1 : 0);
+	if (sta->pre_trigger_buffers) {
+		if (num_buffers != sta->num_buffers
+				|| (logic != NULL) != sta->has_logic) {
+			sr_err("Number of analog trigger channels changed.");
+			return SR_ERR_ARG;
+		}
+		for (i = 0; i < num_buffers; i++) {
+			if (sta->has_logic && i == 0)
+				unitsize = logic->unitsize;
+			else
+				unitsize = analog[i - sta->has_logic].encoding->unitsize;
+			if (unitsize != sta->unitsizes[i]) {
+				sr_err("Analog trigger sample size changed.");
+				return SR_ERR_ARG;
+			}
+		}
+		return SR_OK;
+	}
+
+	sta->has_logic = logic != NULL;
+	sta->num_buffers = num_buffers;
+	sta->unitsizes = g_malloc0(num_buffers * sizeof(sta->unitsizes[0]));
+	sta->pre_trigger_buffers = g_malloc0(num_buffers
+		* sizeof(sta->pre_trigger_buffers[0]));
+	for (i = 0; i < num_buffers; i++) {
+		if (sta->has_logic && i == 0)
+			sta->unitsizes[i] = logic->unitsize;
+		else
+			sta->unitsizes[i] = analog[i - sta->has_logic].encoding->unitsize;
+		sta->pre_trigger_buffers[i] = sr_spill_new(
+			sr_dev_inst_context(sta->sdi),
+			(size_t)sta->pre_trigger_samples * sta->unitsizes[i]);
+		if (!sta->pre_trigger_buffers[i]) {
+			analog_buffers_free(sta);
+			return SR_ERR_MALLOC;
+		}
+	}
+
+	return SR_OK;
+}
+
+static void analog_pre_trigger_append(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_logic *logic,
+		const struct sr_datafeed_analog *analog, int num_samples)
+{
+	const uint8_t *data;
+	int i, unitsize, skip, pos, n, len, size;
+
+	if (!sta->pre_trigger_samples)
+		return;
+
+	/* Only the last pre_trigger_samples samples are of interest. */
+	skip = MAX(num_samples - sta->pre_trigger_samples, 0);
+	len = num_samples - skip;
+	for (i = 0; i < sta->num_buffers; i++) {
+		unitsize = sta->unitsizes[i];
+		data = analog_buffer_data(sta, logic, analog, i) + skip * unitsize;
+		pos = sta->pre_trigger_head;
+		n = len;
+		while (n > 0) {
+			size = MIN(sta->pre_trigger_samples - pos, n);
+			sr_spill_write(sta->pre_trigger_buffers[i],
+				(size_t)pos * unitsize, data, size * unitsize);
+			pos = (pos + size) % sta->pre_trigger_samples;
+			data += size * unitsize;
+			n -= size;
+		}
+	}
+	sta->pre_trigger_head = (sta->pre_trigger_head + len)
+		% sta->pre_trigger_samples;
+	sta->pre_trigger_fill = MIN(sta->pre_trigger_fill + len,
+		sta->pre_trigger_samples);
+}
+
+/* Send samples in the format of a pre-trigger buffer's packet. */
+static void analog_buffer_send(const struct soft_trigger_analog *sta,
+		const struct sr_datafeed_logic *logic,
+		const struct sr_datafeed_analog *analog, int idx,
+		const void *data, int num_samples)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic l;
+	struct sr_datafeed_analog a;
+
+	if (num_samples <= 0)
+		return;
+
+	if (sta->has_logic && idx == 0) {
+		l = *logic;
+		l.data = (void *)data;
+		l.length = (uint64_t)num_samples * l.unitsize;
+		packet.type = SR_DF_LOGIC;
+		packet.payload = &l;
+	} else {
+		a = analog[idx - sta->has_logic];
+		a.data = (void *)data;
+		a.num_samples = num_samples;
+		packet.type = SR_DF_ANALOG;
+		packet.payload = &a;
+	}
+	sr_session_send(sta->sdi, &packet);
+}
+
+/* Send a region of a pre-trigger buffer, see pre_trigger_send_region(). */
+static void analog_send_region(const struct soft_trigger_analog *sta,
+		const struct sr_datafeed_logic *logic,
+		const struct sr_datafeed_analog *analog, int idx,
+		int offset, int num_samples)
+{
+	struct sr_spill *sp;
+	uint8_t *buf;
+	int unitsize, size;
+
+	sp = sta->pre_trigger_buffers[idx];
+	unitsize = sta->unitsizes[idx];
+	if ((buf = sr_spill_data(sp))) {
+		analog_buffer_send(sta, logic, analog, idx,
+			buf + (size_t)offset * unitsize, num_samples);
+		return;
+	}
+	if (num_samples <= 0)
+		return;
+
+	size = MAX(PRE_TRIGGER_BOUNCE_SIZE / unitsize, 1);
+	buf = g_malloc((size_t)MIN(size, num_samples) * unitsize);
+	while (num_samples > 0) {
+		size = MIN(size, num_samples);
+		if (sr_spill_read(sp, (size_t)offset * unitsize,
+				buf, (size_t)size * unitsize) != SR_OK)
+			break;
+		analog_buffer_send(sta, logic, analog, idx, buf, size);
+		offset += size;
+		num_samples -= size;
+	}
+	g_free(buf);
+}
+
+/*
+ * Send the pre-trigger samples of all channels: the circular buffer's
+ * content in up to two packets, then the samples of the current packets
+ * before the trigger position.
+ */
+static void analog_pre_trigger_send(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_logic *logic,
+		const struct sr_datafeed_analog *analog, int offset,
+		int *pre_trigger_samples)
+{
+	const uint8_t *data;
+	int i, ring_len, start, skip, first;
+
+	skip = MAX(offset - sta->pre_trigger_samples, 0);
+	ring_len = MIN(sta->pre_trigger_fill,
+		sta->pre_trigger_samples - (offset - skip));
+	start = sta->pre_trigger_head - ring_len;
+	if (start < 0)
+		start += sta->pre_trigger_samples;
+	first = MIN(sta->pre_trigger_samples - start, ring_len);
+
+	for (i = 0; i < sta->num_buffers; i++) {
+		if (ring_len > 0) {
+			analog_send_region(sta, logic, analog, i, start, first);
+			analog_send_region(sta, logic, analog, i, 0,
+				ring_len - first);
+		}
+		data = analog_buffer_data(sta, logic, analog, i);
+		analog_buffer_send(sta, logic, analog, i,
+			data + (size_t)skip * sta->unitsizes[i], offset - skip);
+	}
+
+	if (pre_trigger_samples)
+		*pre_trigger_samples = ring_len + offset - skip;
+	sta->pre_trigger_head = 0;
+	sta->pre_trigger_fill = 0;
+}
+
+/* The trigger channel's samples as float, converted when necessary. */
+static const float *analog_trigger_values(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_analog *analog)
+{
+	const struct sr_analog_encoding *enc;
+	size_t size;
+
+	enc = analog->encoding;
+	if (enc->is_float && enc->unitsize == sizeof(float)
+			&& enc->is_bigendian == (G_BYTE_ORDER == G_BIG_ENDIAN)
+			&& enc->scale.p == enc->scale.q && enc->offset.p == 0)
+		return analog->data;
+
+	size = MAX(analog->num_samples, 1) * sizeof(float);
+	if (size > sta->values_size) {
+		g_free(sta->values);
+		sta->values = g_malloc(size);
+		sta->values_size = size;
+	}
+	if (sr_analog_to_float(analog, sta->values) != SR_OK)
+		return NULL;
+
+	return sta->values;
+}
+
+/*
+ * Check a set of packets for the trigger condition. The packets are the
+ * ones the driver is about to send: optionally a logic packet, and one
+ * analog packet per enabled analog channel, in the same order on every
+ * call and with the same number of samples each. Analog data can be in
+ * any encoding, the trigger values apply to the converted samples.
+ *
+ * Returns the offset (in samples) within the packets of where the trigger
+ * occurred, -1 if not triggered, or another negative SR_ERR code. When
+ * triggered, the frame begin (if enabled), the pre-trigger samples and
+ * the trigger have been sent, and the driver continues with the samples
+ * from that offset on.
+ */
+SR_PRIV int soft_trigger_analog_check(struct soft_trigger_analog *sta,
+		const struct sr_datafeed_logic *logic,
+		const struct sr_datafeed_analog *analog, int num_channels,
+		int *pre_trigger_samples)
+{
+	const struct sr_channel *ch;
+	const float *values;
+	int i, trigger_ch, num_samples, offset, ret;
+
+	if (!sta || !analog || num_channels <= 0 || (logic && !logic->unitsize))
+		return SR_ERR_ARG;
+
+	trigger_ch = -1;
+	num_samples = analog[0].num_samples;
+	for (i = 0; i < num_channels; i++) {
+		if ((int)analog[i].num_samples != num_samples) {
+			sr_err("Analog trigger packets differ in length.");
+			return SR_ERR_ARG;
+		}
+		if (!analog[i].meaning->channels)
+			continue;
+		ch = analog[i].meaning->channels->data;
+		if (ch == sta->channel)
+			trigger_ch = i;
+	}
+	if (trigger_ch < 0) {
+		sr_err("Analog trigger channel not among the packets.");
+		return SR_ERR_ARG;
+	}
+	if (logic && logic->length != (uint64_t)num_samples * logic->unitsize) {
+		sr_err("Analog trigger logic packet differs in length.");
+		return SR_ERR_ARG;
+	}
+
+	if ((ret = analog_buffers_setup(sta, logic, analog, num_channels)) != SR_OK)
+		return ret;
+
+	if (!(values = analog_trigger_values(sta, &analog[trigger_ch])))
+		return SR_ERR_DATA;
+
+	offset = analog_trigger_scan(sta, values, num_samples);
+	if (offset < 0) {
+		analog_pre_trigger_append(sta, logic, analog, num_samples);
+		return -1;
+	}
+
+	if (sta->frames)
+		std_session_send_df_frame_begin(sta->sdi);
+	analog_pre_trigger_send(sta, logic, analog, offset, pre_trigger_samples);
+	std_session_send_df_trigger(sta->sdi);
+
+	return offset;
+}
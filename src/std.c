@@ -268,6 +268,43 @@ SR_PRIV int std_session_send_df_frame_begin(const struct sr_dev_inst *sdi)
 	return send_df_without_payload(sdi, SR_DF_FRAME_BEGIN);
 }
 
+/**
+ * Standard API helper for sending an SR_DF_FRAME_BEGIN packet with the
+ * frame's position in the sample stream.
+ *
+ * @param[in] sdi The device instance to use. Must not be NULL.
+ * @param[in] sample_pos Position of the frame's first sample.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval other Other error.
+ */
+SR_PRIV int std_session_send_df_frame_begin_pos(const struct sr_dev_inst *sdi,
+		uint64_t sample_pos)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_frame frame;
+	int ret;
+
+	if (!sdi) {
+		sr_err("%s: Invalid argument.", __func__);
+		return SR_ERR_ARG;
+	}
+
+	frame.sample_pos = sample_pos;
+	packet.type = SR_DF_FRAME_BEGIN;
+	packet.payload = &frame;
+
+	if ((ret = sr_session_send(sdi, &packet)) < 0) {
+		sr_err("%s: Failed to send packet of type %d: %d.",
+			(sdi->driver) ? sdi->driver->name : "unknown",
+			packet.type, ret);
+		return ret;
+	}
+
+	return SR_OK;
+}
+
 /**
  * Standard API helper for sending an SR_DF_FRAME_END packet.
  *
@@ -549,6 +586,123 @@ SR_PRIV GSList *std_scan_complete(struct sr_dev_driver *di, GSList *devices)
 	return devices;
 }
 
+/* Most ports which std_probe_ports() probes at the same time. */
+#define STD_PROBE_THREADS 8
+
+/*
+ * Locks of the ports which got probed, by port name. They live as long
+ * as the process does, so that scans of several drivers in different
+ * threads don't probe a port at the same time.
+ */
+static GMutex port_locks_mutex;
+static GHashTable *port_locks;
+
+static GMutex *port_lock_get(const char *port)
+{
+	GMutex *lock;
+	char *name;
+
+	name = g_strndup(port, strcspn(port, ":"));
+	g_mutex_lock(&port_locks_mutex);
+	if (!port_locks)
+		port_locks = g_hash_table_new(g_str_hash, g_str_equal);
+	lock = g_hash_table_lookup(port_locks, name);
+	if (!lock) {
+		lock = g_malloc0(sizeof(*lock));
+		g_mutex_init(lock);
+		g_hash_table_insert(port_locks, name, lock);
+		name = NULL;
+	}
+	g_mutex_unlock(&port_locks_mutex);
+	g_free(name);
+
+	return lock;
+}
+
+struct probe_job {
+	const char *port;
+	std_probe_port_callback probe;
+	void *cb_data;
+	void *result;
+};
+
+static void probe_job_run(gpointer data, gpointer user_data)
+{
+	struct probe_job *job;
+	GMutex *lock;
+
+	(void)user_data;
+
+	job = data;
+	lock = port_lock_get(job->port);
+	g_mutex_lock(lock);
+	job->result = job->probe(job->port, job->cb_data);
+	g_mutex_unlock(lock);
+}
+
+/**
+ * Probe several ports at the same time.
+ *
+ * Drivers which look for their devices on a list of ports can use this
+ * in their scan() callback, so that the time of the scan is bounded by
+ * the slowest probe instead of the sum of all the probes' timeouts.
+ * Up to 8 ports get probed in parallel, each in a thread of its own.
+ *
+ * Each port is locked while it gets probed, also against the probes of
+ * other drivers which scan in other threads. The lock is by the port's
+ * name, any ':' suffix (like the serialcomm of SCPI resources) is not
+ * part of it.
+ *
+ * The probe callback must only use the port which it got passed.
+ *
+ * @param[in] ports List of port names (char *).
+ * @param[in] probe The callback which probes one port. Returns the found
+ *                  device (or other data), NULL when there is none.
+ * @param[in] cb_data Opaque data for the callback.
+ *
+ * @return The non-NULL results of the callback, in the order of the
+ *         ports.
+ */
+SR_PRIV GSList *std_probe_ports(GSList *ports, std_probe_port_callback probe,
+	void *cb_data)
+{
+	struct probe_job *jobs;
+	GThreadPool *pool;
+	GSList *l, *results;
+	guint count, i;
+
+	count = g_slist_length(ports);
+	if (!count)
+		return NULL;
+
+	jobs = g_malloc0_n(count, sizeof(*jobs));
+	for (l = ports, i = 0; l; l = l->next, i++) {
+		jobs[i].port = l->data;
+		jobs[i].probe = probe;
+		jobs[i].cb_data = cb_data;
+	}
+
+	pool = NULL;
+	if (count > 1)
+		pool = g_thread_pool_new(probe_job_run, NULL,
+			MIN(count, STD_PROBE_THREADS), FALSE, NULL);
+	for (i = 0; i < count; i++) {
+		if (!pool || !g_thread_pool_push(pool, &jobs[i], NULL))
+			probe_job_run(&jobs[i], NULL);
+	}
+	if (pool)
+		g_thread_pool_free(pool, FALSE, TRUE);
+
+	results = NULL;
+	for (i = 0; i < count; i++) {
+		if (jobs[i].result)
+			results = g_slist_append(results, jobs[i].result);
+	}
+	g_free(jobs);
+
+	return results;
+}
+
 SR_PRIV int std_opts_config_list(uint32_t key, GVariant **data,
 	const struct sr_dev_inst *sdi, const struct sr_channel_group *cg,
 	const uint32_t scanopts[], size_t scansize, const uint32_t drvopts[],
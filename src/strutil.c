@@ -294,6 +294,97 @@ SR_PRIV int sr_atof(const char *str, float *ret)
 	return SR_OK;
 }
 
+/*
+ * Fast path for the conversion of plain decimal text: an optional sign,
+ * digits with an optional period, and an optional exponent. Only takes
+ * the fast path when the decimal mantissa does not exceed 2^53 and the
+ * power of ten is exactly representable. The result then is correctly
+ * rounded, like strtod() would provide. Returns FALSE for all other
+ * text, which g_ascii_strtod() then needs to convert.
+ */
+static gboolean atod_ascii_fast(const char *str, double *ret)
+{
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+		1e21, 1e22,
+	};
+	const char *p;
+	gboolean neg, exp_neg, have_digits;
+	uint64_t mant;
+	int digits, exp, exp_val;
+	double value;
+
+	p = str;
+	neg = *p == '-';
+	if (*p == '-' || *p == '+')
+		p++;
+
+	/* Accumulate up to 19 significant digits, track the period. */
+	mant = 0;
+	digits = 0;
+	exp = 0;
+	have_digits = FALSE;
+	while (g_ascii_isdigit(*p)) {
+		if (digits >= 19)
+			return FALSE;
+		mant = mant * 10 + (*p++ - '0');
+		if (mant)
+			digits++;
+		have_digits = TRUE;
+	}
+	if (*p == '.') {
+		p++;
+		while (g_ascii_isdigit(*p)) {
+			if (digits >= 19)
+				return FALSE;
+			mant = mant * 10 + (*p++ - '0');
+			if (mant)
+				digits++;
+			exp--;
+			have_digits = TRUE;
+		}
+	}
+	if (!have_digits)
+		return FALSE;
+
+	if (*p == 'e' || *p == 'E') {
+		p++;
+		exp_neg = *p == '-';
+		if (*p == '-' || *p == '+')
+			p++;
+		if (!g_ascii_isdigit(*p))
+			return FALSE;
+		exp_val = 0;
+		while (g_ascii_isdigit(*p)) {
+			if (exp_val < 10000)
+				exp_val = exp_val * 10 + (*p - '0');
+			p++;
+		}
+		exp += exp_neg ? -exp_val : exp_val;
+	}
+	if (*p)
+		return FALSE;
+
+	if (!mant) {
+		*ret = neg ? -0.0 : 0.0;
+		return TRUE;
+	}
+	if (mant > (UINT64_C(1) << 53))
+		return FALSE;
+	if (exp < -22 || exp > 22)
+		return FALSE;
+
+	value = (double)mant;
+	if (exp < 0)
+		value /= pow10[-exp];
+	else
+		value *= pow10[exp];
+	*ret = neg ? -value : value;
+
+	return TRUE;
+}
+
 /**
  * Convert a string representation of a numeric value to a double. The
  * conversion is strict and will fail if the complete string does not represent
@@ -314,6 +405,8 @@ SR_PRIV int sr_atod_ascii(const char *str, double *ret)
 	char *endptr = NULL;
 
 	errno = 0;
+	if (atod_ascii_fast(str, ret))
+		return SR_OK;
 	tmp = g_ascii_strtod(str, &endptr);
 
 	if (!endptr || *endptr || errno) {
@@ -417,6 +510,10 @@ SR_PRIV int sr_atof_ascii(const char *str, float *ret)
 	char *endptr = NULL;
 
 	errno = 0;
+	if (atod_ascii_fast(str, &tmp)) {
+		*ret = (float) tmp;
+		return SR_OK;
+	}
 	tmp = g_ascii_strtod(str, &endptr);
 
 	if (!endptr || *endptr || errno) {
@@ -439,6 +536,62 @@ SR_PRIV int sr_atof_ascii(const char *str, float *ret)
 	return SR_OK;
 }
 
+/** @cond PRIVATE */
+#if defined(__APPLE__) || (defined(__FreeBSD__) && __FreeBSD_version >= 901000) \
+	|| (defined(__linux__) && !defined(__ANDROID__))
+#define WITH_C_LOCALE_CACHE 1
+#endif
+/** @endcond */
+
+#ifdef WITH_C_LOCALE_CACHE
+/*
+ * Get the "C" numeric locale. It gets created once and then is kept for
+ * the lifetime of the process, creating it for every call was expensive.
+ * Returns (locale_t)0 when it can't be created.
+ */
+static locale_t c_numeric_locale(void)
+{
+	static gsize once;
+	static locale_t locale;
+
+	if (g_once_init_enter(&once)) {
+		locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+		g_once_init_leave(&once, 1);
+	}
+
+	return locale;
+}
+#endif
+
+/*
+ * Check whether a format string has conversions which depend on the
+ * numeric locale: floating point ones (its decimal point), and those
+ * with the ' flag (its thousands separator). Formats without them need
+ * no locale switching.
+ */
+static gboolean format_uses_locale(const char *format)
+{
+	const char *p;
+
+	for (p = format; (p = strchr(p, '%')); ) {
+		p++;
+		if (*p == '%') {
+			p++;
+			continue;
+		}
+		/* Skip flags, width, precision and length modifiers. */
+		while (*p && strchr("-+ #0123456789.*'hlLqjzt$I", *p)) {
+			if (*p == '\'')
+				return TRUE;
+			p++;
+		}
+		if (*p && strchr("eEfFgGaA", *p))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 /**
  * Compose a string with a format string in the buffer pointed to by buf.
  *
@@ -505,6 +658,10 @@ SR_API int sr_sprintf_ascii(char *buf, const char *format, ...)
  */
 SR_API int sr_vsprintf_ascii(char *buf, const char *format, va_list args)
 {
+	/* Skip the locale handling when the output doesn't depend on it. */
+	if (!format_uses_locale(format))
+		return vsprintf(buf, format, args);
+
 #if defined(_WIN32)
 	int ret;
 
@@ -536,9 +693,10 @@ SR_API int sr_vsprintf_ascii(char *buf, const char *format, va_list args)
 	int ret;
 	locale_t locale;
 
-	locale = newlocale(LC_NUMERIC_MASK, "C", NULL);
+	locale = c_numeric_locale();
+	if (!locale)
+		return vsprintf(buf, format, args);
 	ret = vsprintf_l(buf, locale, format, args);
-	freelocale(locale);
 
 	return ret;
 #elif defined(__FreeBSD__) && __FreeBSD_version >= 901000
@@ -550,9 +708,10 @@ SR_API int sr_vsprintf_ascii(char *buf, const char *format, va_list args)
 	int ret;
 	locale_t locale;
 
-	locale = newlocale(LC_NUMERIC_MASK, "C", NULL);
+	locale = c_numeric_locale();
+	if (!locale)
+		return vsprintf(buf, format, args);
 	ret = vsprintf_l(buf, locale, format, args);
-	freelocale(locale);
 
 	return ret;
 #elif defined(__ANDROID__)
@@ -568,17 +727,18 @@ SR_API int sr_vsprintf_ascii(char *buf, const char *format, va_list args)
 	return ret;
 #elif defined(__linux__)
 	int ret;
-	locale_t old_locale, temp_locale;
+	locale_t old_locale, c_locale;
 
 	/* Switch to C locale for proper float/double conversion. */
-	temp_locale = newlocale(LC_NUMERIC, "C", NULL);
-	old_locale = uselocale(temp_locale);
+	c_locale = c_numeric_locale();
+	if (!c_locale)
+		return vsprintf(buf, format, args);
+	old_locale = uselocale(c_locale);
 
 	ret = vsprintf(buf, format, args);
 
 	/* Switch back to original locale. */
 	uselocale(old_locale);
-	freelocale(temp_locale);
 
 	return ret;
 #elif defined(__unix__) || defined(__unix)
@@ -678,6 +838,10 @@ SR_API int sr_snprintf_ascii(char *buf, size_t buf_size,
 SR_API int sr_vsnprintf_ascii(char *buf, size_t buf_size,
 	const char *format, va_list args)
 {
+	/* Skip the locale handling when the output doesn't depend on it. */
+	if (!format_uses_locale(format))
+		return vsnprintf(buf, buf_size, format, args);
+
 #if defined(_WIN32)
 	int ret;
 
@@ -709,9 +873,10 @@ SR_API int sr_vsnprintf_ascii(char *buf, size_t buf_size,
 	int ret;
 	locale_t locale;
 
-	locale = newlocale(LC_NUMERIC_MASK, "C", NULL);
+	locale = c_numeric_locale();
+	if (!locale)
+		return vsnprintf(buf, buf_size, format, args);
 	ret = vsnprintf_l(buf, buf_size, locale, format, args);
-	freelocale(locale);
 
 	return ret;
 #elif defined(__FreeBSD__) && __FreeBSD_version >= 901000
@@ -723,9 +888,10 @@ SR_API int sr_vsnprintf_ascii(char *buf, size_t buf_size,
 	int ret;
 	locale_t locale;
 
-	locale = newlocale(LC_NUMERIC_MASK, "C", NULL);
+	locale = c_numeric_locale();
+	if (!locale)
+		return vsnprintf(buf, buf_size, format, args);
 	ret = vsnprintf_l(buf, buf_size, locale, format, args);
-	freelocale(locale);
 
 	return ret;
 #elif defined(__ANDROID__)
@@ -741,17 +907,18 @@ SR_API int sr_vsnprintf_ascii(char *buf, size_t buf_size,
 	return ret;
 #elif defined(__linux__)
 	int ret;
-	locale_t old_locale, temp_locale;
+	locale_t old_locale, c_locale;
 
 	/* Switch to C locale for proper float/double conversion. */
-	temp_locale = newlocale(LC_NUMERIC, "C", NULL);
-	old_locale = uselocale(temp_locale);
+	c_locale = c_numeric_locale();
+	if (!c_locale)
+		return vsnprintf(buf, buf_size, format, args);
+	old_locale = uselocale(c_locale);
 
 	ret = vsnprintf(buf, buf_size, format, args);
 
 	/* Switch back to original locale. */
 	uselocale(old_locale);
-	freelocale(temp_locale);
 
 	return ret;
 #elif defined(__unix__) || defined(__unix)
@@ -0,0 +1,298 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Needed for CPU_SET() and sched_setaffinity(). */
+#define _GNU_SOURCE
+
+#include <config.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#ifdef HAVE_SCHED_H
+#include <sched.h>
+#endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "thread"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Placement and scheduling of libsigrok's threads.
+ */
+
+/**
+ * @defgroup grp_thread Threads
+ *
+ * Placement and scheduling of libsigrok's threads.
+ *
+ * libsigrok runs threads of two roles, see enum sr_thread_role. For
+ * each role applications can pin the threads to a set of CPUs, and
+ * have them run with a realtime scheduling policy. On machines with
+ * several NUMA nodes, I/O threads can also fault in the pages of new
+ * sample buffers themselves, so that the buffers are local to the CPUs
+ * the threads are pinned to.
+ *
+ * The settings apply to threads which get started after the calls.
+ * Platforms which lack the respective system calls only log a warning.
+ *
+ * @{
+ */
+
+/* Highest CPU number plus one which CPU lists can refer to. */
+#define SR_THREAD_MAX_CPUS	4096
+
+/* Whether the calling thread faults in new sample buffers. */
+static GPrivate first_touch_key;
+
+static struct sr_thread_policy *policy_get(struct sr_context *ctx,
+		enum sr_thread_role role)
+{
+	if (!ctx || (unsigned int)role >= G_N_ELEMENTS(ctx->thread_policy))
+		return NULL;
+
+	return &ctx->thread_policy[role];
+}
+
+/* Parse a CPU list like "0-3,8", into a list of CPU numbers. */
+static GArray *cpus_parse(const char *cpus)
+{
+	GArray *list;
+	gchar **ranges, *end;
+	unsigned long first, last;
+	guint cpu;
+	size_t i;
+
+	list = g_array_new(FALSE, FALSE, sizeof(guint));
+	ranges = g_strsplit(cpus, ",", 0);
+	for (i = 0; ranges[i]; i++) {
+		errno = 0;
+		first = strtoul(g_strstrip(ranges[i]), &end, 10);
+		last = first;
+		if (end != ranges[i] && *end == '-')
+			last = strtoul(end + 1, &end, 10);
+		if (errno || end == ranges[i] || *end || last < first
+				|| last >= SR_THREAD_MAX_CPUS) {
+			sr_err("Invalid CPU list '%s'.", cpus);
+			g_array_free(list, TRUE);
+			list = NULL;
+			break;
+		}
+		for (cpu = first; cpu <= last; cpu++)
+			g_array_append_val(list, cpu);
+	}
+	g_strfreev(ranges);
+
+	return list;
+}
+
+/**
+ * Pin the threads of a role to a set of CPUs.
+ *
+ * @param ctx The context. Must not be NULL.
+ * @param role The role of the threads.
+ * @param cpus List of CPU numbers and ranges, like "0-3,8". NULL or
+ *             empty to not pin the threads.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_thread_affinity_set(struct sr_context *ctx,
+		enum sr_thread_role role, const char *cpus)
+{
+	struct sr_thread_policy *policy;
+	GArray *list;
+
+	if (!(policy = policy_get(ctx, role)))
+		return SR_ERR_ARG;
+
+	list = NULL;
+	if (cpus && *cpus && !(list = cpus_parse(cpus)))
+		return SR_ERR_ARG;
+
+	if (policy->cpus)
+		g_array_free(policy->cpus, TRUE);
+	policy->cpus = list;
+
+	return SR_OK;
+}
+
+/**
+ * Set the scheduling policy of the threads of a role.
+ *
+ * Realtime policies usually need privileges (like CAP_SYS_NICE or an
+ * RLIMIT_RTPRIO limit on Linux). Threads which are not permitted keep
+ * the default policy, and a warning gets logged.
+ *
+ * @param ctx The context. Must not be NULL.
+ * @param role The role of the threads.
+ * @param sched The scheduling policy.
+ * @param priority The realtime priority, clamped to the range which the
+ *                 system supports. Ignored for SR_THREAD_SCHED_DEFAULT.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_thread_priority_set(struct sr_context *ctx,
+		enum sr_thread_role role, enum sr_thread_sched sched, int priority)
+{
+	struct sr_thread_policy *policy;
+
+	if (!(policy = policy_get(ctx, role)))
+		return SR_ERR_ARG;
+	if (sched != SR_THREAD_SCHED_DEFAULT && sched != SR_THREAD_SCHED_FIFO
+			&& sched != SR_THREAD_SCHED_RR)
+		return SR_ERR_ARG;
+
+	policy->sched = sched;
+	policy->priority = priority;
+
+	return SR_OK;
+}
+
+/**
+ * Have I/O threads fault in the pages of the sample buffers they allocate.
+ *
+ * This way the buffers end up on the NUMA node of the CPUs which the
+ * threads are pinned to (see sr_thread_affinity_set()), instead of the
+ * node of the thread which happens to write them first.
+ *
+ * @param ctx The context. Must not be NULL.
+ * @param enable TRUE to fault in buffers on I/O threads.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_thread_numa_local_set(struct sr_context *ctx, gboolean enable)
+{
+	if (!ctx)
+		return SR_ERR_ARG;
+
+	ctx->thread_numa_local = enable;
+
+	return SR_OK;
+}
+
+static void affinity_apply(const struct sr_thread_policy *policy)
+{
+#if defined(HAVE_SCHED_SETAFFINITY) && defined(CPU_SET)
+	cpu_set_t set;
+	guint i;
+
+	CPU_ZERO(&set);
+	for (i = 0; i < policy->cpus->len; i++) {
+		if (g_array_index(policy->cpus, guint, i) < CPU_SETSIZE)
+			CPU_SET(g_array_index(policy->cpus, guint, i), &set);
+	}
+	if (sched_setaffinity(0, sizeof(set), &set) < 0)
+		sr_warn("Failed to set CPU affinity: %s", g_strerror(errno));
+#else
+	(void)policy;
+	sr_warn("CPU affinity is not supported on this platform.");
+#endif
+}
+
+static void sched_apply(const struct sr_thread_policy *policy)
+{
+#if defined(HAVE_PTHREAD_SETSCHEDPARAM) && defined(SCHED_FIFO)
+	struct sched_param param;
+	int sched, ret;
+
+	sched = policy->sched == SR_THREAD_SCHED_RR ? SCHED_RR : SCHED_FIFO;
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = CLAMP(policy->priority,
+		sched_get_priority_min(sched), sched_get_priority_max(sched));
+	ret = pthread_setschedparam(pthread_self(), sched, &param);
+	if (ret == EPERM)
+		sr_warn("Not permitted to use realtime scheduling.");
+	else if (ret)
+		sr_warn("Failed to set scheduling policy: %s",
+			g_strerror(ret));
+#else
+	(void)policy;
+	sr_warn("Realtime scheduling is not supported on this platform.");
+#endif
+}
+
+/**
+ * Apply the settings of a role to the calling thread.
+ *
+ * Threads call this first thing after they got started.
+ *
+ * @param ctx The context. Can be NULL, then nothing happens.
+ * @param role The role of the calling thread.
+ *
+ * @private
+ */
+SR_PRIV void sr_thread_policy_apply(struct sr_context *ctx,
+		enum sr_thread_role role)
+{
+	struct sr_thread_policy *policy;
+
+	if (!(policy = policy_get(ctx, role)))
+		return;
+
+	if (policy->cpus)
+		affinity_apply(policy);
+	if (policy->sched != SR_THREAD_SCHED_DEFAULT)
+		sched_apply(policy);
+	if (role == SR_THREAD_IO && ctx->thread_numa_local)
+		g_private_set(&first_touch_key, GINT_TO_POINTER(1));
+}
+
+/**
+ * Check whether the calling thread faults in new sample buffers.
+ *
+ * @private
+ */
+SR_PRIV gboolean sr_thread_first_touch(void)
+{
+	return g_private_get(&first_touch_key) != NULL;
+}
+
+/**
+ * Release the thread settings of a context.
+ *
+ * @private
+ */
+SR_PRIV void sr_thread_policy_clear(struct sr_context *ctx)
+{
+	size_t i;
+
+	for (i = 0; i < G_N_ELEMENTS(ctx->thread_policy); i++) {
+		if (ctx->thread_policy[i].cpus)
+			g_array_free(ctx->thread_policy[i].cpus, TRUE);
+		ctx->thread_policy[i].cpus = NULL;
+	}
+}
+
+/** @} */
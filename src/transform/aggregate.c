@@ -0,0 +1,278 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Aggregate the readings of analog channels over intervals of time.
+ *
+ * This suits long term logging of devices like multimeters and power
+ * supplies, which deliver readings at their own pace and without a
+ * samplerate. The intervals are aligned to the host's clock, so that
+ * for example one minute intervals start at the full minute.
+ *
+ * For every interval in which a channel had readings, the channel gets
+ * one packet holding the minimum, the maximum and the mean value as
+ * consecutive float samples, with SR_MQFLAG_MIN, SR_MQFLAG_MAX and
+ * SR_MQFLAG_AVG set. The packet is sent along with the first reading
+ * of the channel after the interval. A change of the quantity or the
+ * unit (like turning the DMM's knob) ends the interval early. The
+ * interval which is in progress at the end of a frame or of the stream
+ * is dropped.
+ *
+ * Logic data and analog packets covering multiple channels are passed
+ * through unchanged.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/aggregate"
+
+struct bucket {
+	int64_t interval;
+	float min, max;
+	double sum;
+	uint64_t count;
+	/* Meaning of the readings, all of them have the same. */
+	enum sr_mq mq;
+	enum sr_unit unit;
+	enum sr_mqflag mqflags;
+	int digits, spec_digits;
+	GSList *channels;
+};
+
+struct context {
+	int64_t interval_us;
+
+	/* Buckets of analog channels, keyed by struct sr_channel pointer. */
+	GHashTable *buckets;
+	float *values;
+	size_t values_size;
+	float out_values[3];
+
+	/* Output packet and payloads. */
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+};
+
+static void *buf_reserve(void *buf, size_t *size, size_t needed)
+{
+	if (needed <= *size)
+		return buf;
+
+	g_free(buf);
+	*size = needed;
+
+	return g_malloc(needed);
+}
+
+static void bucket_free(void *data)
+{
+	struct bucket *bucket;
+
+	bucket = data;
+	g_slist_free(bucket->channels);
+	g_free(bucket);
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	uint64_t interval_ms;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	interval_ms = g_variant_get_uint64(g_hash_table_lookup(options, "interval"));
+	if (interval_ms < 1 || interval_ms > G_MAXINT64 / 1000) {
+		sr_err("Invalid aggregation interval.");
+		return SR_ERR_ARG;
+	}
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+	ctx->interval_us = interval_ms * 1000;
+	ctx->buckets = g_hash_table_new_full(NULL, NULL, NULL, bucket_free);
+
+	return SR_OK;
+}
+
+/* Does a reading belong to the interval the bucket collects? */
+static gboolean bucket_matches(const struct bucket *bucket,
+		const struct sr_datafeed_analog *analog, int64_t interval)
+{
+	return bucket->interval == interval
+		&& bucket->mq == analog->meaning->mq
+		&& bucket->unit == analog->meaning->unit
+		&& bucket->mqflags == analog->meaning->mqflags;
+}
+
+/* Make the aggregate of a completed interval the output packet. */
+static struct sr_datafeed_packet *bucket_send(struct context *ctx,
+		const struct bucket *bucket)
+{
+	ctx->out_values[0] = bucket->min;
+	ctx->out_values[1] = bucket->max;
+	ctx->out_values[2] = bucket->sum / bucket->count;
+
+	sr_analog_init(&ctx->analog, &ctx->encoding, &ctx->meaning, &ctx->spec,
+		bucket->digits);
+	ctx->meaning.mq = bucket->mq;
+	ctx->meaning.unit = bucket->unit;
+	ctx->meaning.mqflags = bucket->mqflags
+		| SR_MQFLAG_MIN | SR_MQFLAG_MAX | SR_MQFLAG_AVG;
+	ctx->meaning.channels = bucket->channels;
+	ctx->spec.spec_digits = bucket->spec_digits;
+	ctx->analog.num_samples = G_N_ELEMENTS(ctx->out_values);
+	ctx->analog.data = ctx->out_values;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &ctx->analog;
+
+	return &ctx->packet;
+}
+
+static struct sr_datafeed_packet *process_analog(struct context *ctx,
+		struct sr_datafeed_packet *packet_in)
+{
+	const struct sr_datafeed_analog *analog;
+	struct sr_datafeed_packet *packet_out;
+	struct bucket *bucket;
+	struct sr_channel *ch;
+	int64_t interval;
+	uint32_t i;
+
+	analog = packet_in->payload;
+	if (g_slist_length(analog->meaning->channels) != 1) {
+		sr_spew("Only single channel analog packets are aggregated.");
+		return packet_in;
+	}
+	ch = analog->meaning->channels->data;
+	if (!analog->num_samples)
+		return NULL;
+
+	bucket = g_hash_table_lookup(ctx->buckets, ch);
+	if (!bucket) {
+		bucket = g_malloc0(sizeof(*bucket));
+		bucket->channels = g_slist_append(NULL, ch);
+		g_hash_table_insert(ctx->buckets, ch, bucket);
+	}
+
+	ctx->values = buf_reserve(ctx->values, &ctx->values_size,
+		analog->num_samples * sizeof(float));
+	if (sr_analog_to_float(analog, ctx->values) != SR_OK)
+		return NULL;
+
+	/* The reading opens a new interval, send the previous one. */
+	interval = g_get_real_time() / ctx->interval_us;
+	packet_out = NULL;
+	if (bucket->count && !bucket_matches(bucket, analog, interval)) {
+		packet_out = bucket_send(ctx, bucket);
+		bucket->count = 0;
+	}
+	if (!bucket->count) {
+		bucket->interval = interval;
+		bucket->mq = analog->meaning->mq;
+		bucket->unit = analog->meaning->unit;
+		bucket->mqflags = analog->meaning->mqflags;
+		bucket->digits = analog->encoding->digits;
+		bucket->spec_digits = analog->spec
+			? analog->spec->spec_digits : bucket->digits;
+		bucket->min = bucket->max = ctx->values[0];
+		bucket->sum = 0;
+	}
+	for (i = 0; i < analog->num_samples; i++) {
+		bucket->min = MIN(bucket->min, ctx->values[i]);
+		bucket->max = MAX(bucket->max, ctx->values[i]);
+		bucket->sum += ctx->values[i];
+	}
+	bucket->count += analog->num_samples;
+
+	return packet_out;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
+	case SR_DF_END:
+		g_hash_table_remove_all(ctx->buckets);
+		*packet_out = packet_in;
+		break;
+	case SR_DF_ANALOG:
+		*packet_out = process_analog(ctx, packet_in);
+		break;
+	default:
+		*packet_out = packet_in;
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_hash_table_destroy(ctx->buckets);
+	g_free(ctx->values);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "interval", "Interval", "Length of the aggregation intervals, in milliseconds", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(1000));
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_aggregate = {
+	.id = "aggregate",
+	.name = "Aggregate",
+	.desc = "Aggregate analog readings into min/max/mean per interval",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -0,0 +1,392 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Decimate the data feed into envelopes of fixed size buckets.
+ *
+ * For every bucket of 'factor' input samples, analog channels get the
+ * minimum and the maximum value (and optionally the mean) as consecutive
+ * float samples, with SR_MQFLAG_MIN and SR_MQFLAG_MAX (and SR_MQFLAG_AVG)
+ * set. Consumers which are not aware of the envelope still get a usable
+ * display, as the min/max pairs trace the signal's envelope.
+ *
+ * Logic data gets two samples per bucket: the bitwise AND and the
+ * bitwise OR of all samples in the bucket. A channel which differs
+ * between the two had at least one transition within the bucket. With
+ * the mean enabled, the last sample of the bucket follows as a third
+ * one, so that logic and analog data keep the same timebase.
+ *
+ * Meta packets announcing the samplerate get the rate of the output
+ * samples instead, i.e. the bucket rate times the number of samples per
+ * bucket, along with SR_CONF_AVG_SAMPLES set to the decimation factor.
+ * Buckets which are incomplete at the end of a frame or of the stream
+ * are dropped.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/envelope"
+
+struct analog_bucket {
+	float min, max;
+	double sum;
+	uint64_t count;
+};
+
+struct context {
+	uint64_t factor;
+	gboolean mean;
+	/* Output samples per bucket, for logic and analog data alike. */
+	unsigned int per_bucket;
+
+	/* Buckets of analog channels, keyed by struct sr_channel pointer. */
+	GHashTable *analog_buckets;
+	float *values;
+	size_t values_size;
+	float *out_values;
+	size_t out_values_size;
+
+	/* Bucket of the logic channels: AND and OR of all samples. */
+	uint8_t *logic_and, *logic_or;
+	uint16_t logic_unitsize;
+	uint64_t logic_count;
+	uint8_t *out_logic;
+	size_t out_logic_size;
+
+	/* Output packet and payloads. */
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_datafeed_meta meta;
+	GSList *meta_own;
+};
+
+static void *buf_reserve(void *buf, size_t *size, size_t needed)
+{
+	if (needed <= *size)
+		return buf;
+
+	g_free(buf);
+	*size = needed;
+
+	return g_malloc(needed);
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+
+	ctx->factor = g_variant_get_uint64(g_hash_table_lookup(options, "factor"));
+	ctx->mean = g_variant_get_boolean(g_hash_table_lookup(options, "mean"));
+	if (ctx->factor < 1) {
+		sr_err("Invalid decimation factor.");
+		g_free(ctx);
+		t->priv = NULL;
+		return SR_ERR_ARG;
+	}
+
+	ctx->per_bucket = ctx->mean ? 3 : 2;
+	ctx->analog_buckets = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+
+	return SR_OK;
+}
+
+static void buckets_reset(struct context *ctx)
+{
+	g_hash_table_remove_all(ctx->analog_buckets);
+	ctx->logic_count = 0;
+}
+
+static void meta_own_free(struct context *ctx)
+{
+	g_slist_free_full(ctx->meta_own, (GDestroyNotify)sr_config_free);
+	ctx->meta_own = NULL;
+	g_slist_free(ctx->meta.config);
+	ctx->meta.config = NULL;
+}
+
+/* Announce the output sample rate and the decimation factor instead. */
+static struct sr_datafeed_packet *process_meta(struct context *ctx,
+		struct sr_datafeed_packet *packet_in)
+{
+	const struct sr_datafeed_meta *meta;
+	struct sr_config *src, *own;
+	gboolean found;
+	GSList *l;
+
+	meta = packet_in->payload;
+	found = FALSE;
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_SAMPLERATE)
+			found = TRUE;
+	}
+	if (!found)
+		return packet_in;
+
+	meta_own_free(ctx);
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_AVG_SAMPLES)
+			continue;
+		if (src->key == SR_CONF_SAMPLERATE) {
+			own = sr_config_new(SR_CONF_SAMPLERATE, g_variant_new_uint64(
+				g_variant_get_uint64(src->data) * ctx->per_bucket
+				/ ctx->factor));
+			ctx->meta_own = g_slist_append(ctx->meta_own, own);
+			src = own;
+		}
+		ctx->meta.config = g_slist_append(ctx->meta.config, src);
+	}
+	own = sr_config_new(SR_CONF_AVG_SAMPLES, g_variant_new_uint64(ctx->factor));
+	ctx->meta_own = g_slist_append(ctx->meta_own, own);
+	ctx->meta.config = g_slist_append(ctx->meta.config, own);
+
+	ctx->packet.type = SR_DF_META;
+	ctx->packet.payload = &ctx->meta;
+
+	return &ctx->packet;
+}
+
+static struct sr_datafeed_packet *process_logic(struct context *ctx,
+		struct sr_datafeed_packet *packet_in)
+{
+	const struct sr_datafeed_logic *logic;
+	const uint8_t *sample, *end;
+	uint8_t *out;
+	size_t unitsize, num_out;
+	uint16_t i;
+
+	logic = packet_in->payload;
+	unitsize = logic->unitsize;
+	if (!unitsize)
+		return NULL;
+
+	if (unitsize != ctx->logic_unitsize) {
+		g_free(ctx->logic_and);
+		g_free(ctx->logic_or);
+		ctx->logic_and = g_malloc(unitsize);
+		ctx->logic_or = g_malloc(unitsize);
+		ctx->logic_unitsize = unitsize;
+		ctx->logic_count = 0;
+	}
+
+	/* Output samples of all completed buckets, at most. */
+	num_out = (ctx->logic_count + logic->length / unitsize)
+		/ ctx->factor;
+	ctx->out_logic = buf_reserve(ctx->out_logic, &ctx->out_logic_size,
+		MAX(1, ctx->per_bucket * num_out * unitsize));
+	out = ctx->out_logic;
+
+	sample = logic->data;
+	end = sample + logic->length - logic->length % unitsize;
+	for (; sample < end; sample += unitsize) {
+		if (!ctx->logic_count) {
+			memcpy(ctx->logic_and, sample, unitsize);
+			memcpy(ctx->logic_or, sample, unitsize);
+		} else {
+			for (i = 0; i < unitsize; i++) {
+				ctx->logic_and[i] &= sample[i];
+				ctx->logic_or[i] |= sample[i];
+			}
+		}
+		if (++ctx->logic_count < ctx->factor)
+			continue;
+		memcpy(out, ctx->logic_and, unitsize);
+		memcpy(out + unitsize, ctx->logic_or, unitsize);
+		if (ctx->mean)
+			memcpy(out + 2 * unitsize, sample, unitsize);
+		out += ctx->per_bucket * unitsize;
+		ctx->logic_count = 0;
+	}
+
+	if (out == ctx->out_logic)
+		return NULL;
+
+	ctx->logic.length = out - ctx->out_logic;
+	ctx->logic.unitsize = unitsize;
+	ctx->logic.data = ctx->out_logic;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->logic;
+
+	return &ctx->packet;
+}
+
+static struct sr_datafeed_packet *process_analog(struct context *ctx,
+		struct sr_datafeed_packet *packet_in)
+{
+	const struct sr_datafeed_analog *analog;
+	struct analog_bucket *bucket;
+	struct sr_channel *ch;
+	size_t num_out;
+	float *out;
+	uint32_t i;
+
+	analog = packet_in->payload;
+	if (g_slist_length(analog->meaning->channels) != 1) {
+		sr_spew("Only single channel analog packets are decimated.");
+		return packet_in;
+	}
+	ch = analog->meaning->channels->data;
+
+	bucket = g_hash_table_lookup(ctx->analog_buckets, ch);
+	if (!bucket) {
+		bucket = g_malloc0(sizeof(*bucket));
+		g_hash_table_insert(ctx->analog_buckets, ch, bucket);
+	}
+
+	ctx->values = buf_reserve(ctx->values, &ctx->values_size,
+		MAX(1, analog->num_samples) * sizeof(float));
+	if (sr_analog_to_float(analog, ctx->values) != SR_OK)
+		return NULL;
+
+	num_out = (bucket->count + analog->num_samples) / ctx->factor;
+	ctx->out_values = buf_reserve(ctx->out_values, &ctx->out_values_size,
+		MAX(1, ctx->per_bucket * num_out) * sizeof(float));
+	out = ctx->out_values;
+
+	for (i = 0; i < analog->num_samples; i++) {
+		if (!bucket->count) {
+			bucket->min = bucket->max = ctx->values[i];
+			bucket->sum = 0;
+		} else {
+			bucket->min = MIN(bucket->min, ctx->values[i]);
+			bucket->max = MAX(bucket->max, ctx->values[i]);
+		}
+		bucket->sum += ctx->values[i];
+		if (++bucket->count < ctx->factor)
+			continue;
+		*out++ = bucket->min;
+		*out++ = bucket->max;
+		if (ctx->mean)
+			*out++ = bucket->sum / bucket->count;
+		bucket->count = 0;
+	}
+
+	if (out == ctx->out_values)
+		return NULL;
+
+	sr_analog_init(&ctx->analog, &ctx->encoding, &ctx->meaning, &ctx->spec,
+		analog->encoding->digits);
+	ctx->meaning = *analog->meaning;
+	ctx->meaning.mqflags |= SR_MQFLAG_MIN | SR_MQFLAG_MAX;
+	if (ctx->mean)
+		ctx->meaning.mqflags |= SR_MQFLAG_AVG;
+	if (analog->spec)
+		ctx->spec = *analog->spec;
+	ctx->analog.num_samples = out - ctx->out_values;
+	ctx->analog.data = ctx->out_values;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &ctx->analog;
+
+	return &ctx->packet;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
+	case SR_DF_END:
+		buckets_reset(ctx);
+		*packet_out = packet_in;
+		break;
+	case SR_DF_META:
+		*packet_out = process_meta(ctx, packet_in);
+		break;
+	case SR_DF_LOGIC:
+		*packet_out = process_logic(ctx, packet_in);
+		break;
+	case SR_DF_ANALOG:
+		*packet_out = process_analog(ctx, packet_in);
+		break;
+	default:
+		*packet_out = packet_in;
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	meta_own_free(ctx);
+	g_hash_table_destroy(ctx->analog_buckets);
+	g_free(ctx->values);
+	g_free(ctx->out_values);
+	g_free(ctx->logic_and);
+	g_free(ctx->logic_or);
+	g_free(ctx->out_logic);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "factor", "Factor", "Number of samples per envelope bucket", NULL, NULL },
+	{ "mean", "Mean", "Add the mean value of analog buckets", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(1000));
+		options[1].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_envelope = {
+	.id = "envelope",
+	.name = "Envelope",
+	.desc = "Decimate samples into min/max envelopes",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -24,15 +24,34 @@
 
 #define LOG_PREFIX "transform/invert"
 
+/*
+ * Invert all bits of a buffer. Works a machine word at a time, which
+ * compilers turn into vector instructions where available.
+ */
+static void invert_bytes(uint8_t *buf, size_t len)
+{
+	uint64_t w;
+	size_t i;
+
+	for (i = 0; i + sizeof(w) <= len; i += sizeof(w)) {
+		memcpy(&w, buf + i, sizeof(w));
+		w = ~w;
+		memcpy(buf + i, &w, sizeof(w));
+	}
+	for (; i < len; i++)
+		buf[i] = ~buf[i];
+}
+
 static int receive(const struct sr_transform *t,
 		struct sr_datafeed_packet *packet_in,
 		struct sr_datafeed_packet **packet_out)
 {
 	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_planar *planar;
+	const struct sr_datafeed_logic_rle *rle;
 	const struct sr_datafeed_analog *analog;
-	uint8_t *b;
 	int64_t p;
-	uint64_t i, j, q;
+	uint64_t q;
 
 	if (!t || !t->sdi || !packet_in || !packet_out)
 		return SR_ERR_ARG;
@@ -40,13 +59,20 @@ static int receive(const struct sr_transform *t,
 	switch (packet_in->type) {
 	case SR_DF_LOGIC:
 		logic = packet_in->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			for (j = 0; j < logic->unitsize; j++) {
-				/* For now invert every bit in every byte. */
-				b = (uint8_t *)logic->data + i + logic->unitsize - 1 - j;
-				*b = ~(*b);
-			}
-		}
+		if (!logic->unitsize)
+			break;
+		/* For now invert every bit of every complete sample. */
+		invert_bytes(logic->data,
+			logic->length - logic->length % logic->unitsize);
+		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet_in->payload;
+		invert_bytes(rle->values, rle->num_runs * rle->unitsize);
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet_in->payload;
+		invert_bytes(planar->data,
+			planar->stride * planar->unitsize * 8);
 		break;
 	case SR_DF_ANALOG:
 		analog = packet_in->payload;
@@ -72,6 +98,7 @@ SR_PRIV struct sr_transform_module transform_invert = {
 	.id = "invert",
 	.name = "Invert",
 	.desc = "Invert values",
+	.flags = SR_TRANSFORM_INPLACE,
 	.options = NULL,
 	.init = NULL,
 	.receive = receive,
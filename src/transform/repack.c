@@ -0,0 +1,488 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Extract a subset of the logic channels, and repack them into the
+ * narrowest unitsize.
+ *
+ * The 'channels' option takes a comma separated list of channel names.
+ * It defaults to all enabled logic channels of the device. Bit n of an
+ * output sample holds the n-th selected channel, in the order of the
+ * channel indices. Up to 64 channels can be selected, the output unitsize
+ * is the number of selected channels divided by 8, rounded up.
+ *
+ * With the 'pack' option set and at most four selected channels, several
+ * samples share a byte. Each sample takes 1, 2 or 4 bits (for 1, 2 or
+ * 3-4 channels), and the earliest sample of a byte takes the least
+ * significant bits. Output packets have a unitsize of 1 and always hold
+ * complete bytes. Samples which don't fill a byte are carried over to
+ * the next logic packet, and are dropped at the end of a frame or of
+ * the stream. Consumers need to know about this layout, like the
+ * receiving end of a network export.
+ *
+ * sr_transform_channels_get() describes the output: the selected logic
+ * channels, with their bit positions in the output samples (in each
+ * packed sample in pack mode) as their indices. The device's channel
+ * list is left alone.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/repack"
+
+#define MAX_CHANNELS 64
+
+struct context {
+	/* Selected channel indices, in ascending order. */
+	int indices[MAX_CHANNELS];
+	size_t num_channels;
+	uint16_t out_unitsize;
+	gboolean pack;
+	unsigned int pack_bits;
+
+	/*
+	 * Gather tables for the input unitsize seen last. For every input
+	 * byte which holds selected channels, map the byte's value to its
+	 * contribution to the output sample.
+	 */
+	uint16_t in_unitsize;
+	size_t num_bytes;
+	size_t byte_pos[MAX_CHANNELS];
+	uint64_t (*tables)[256];
+
+	/* Samples of an incomplete output byte in pack mode. */
+	uint8_t carry;
+	unsigned int carry_count;
+
+	/* The logic channels of the output, in the order of their bits. */
+	GSList *channels;
+
+	uint8_t *buf;
+	size_t buf_size;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_rle rle;
+};
+
+static int cmp_index(gconstpointer a, gconstpointer b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+static int select_channels(struct context *ctx, const struct sr_dev_inst *sdi,
+		const char *names)
+{
+	struct sr_channel *ch, *const *channels;
+	char **tokens;
+	GSList *l;
+	size_t count, i;
+
+	if (!names || !*names) {
+		channels = sr_dev_channel_array(sdi,
+			SR_CHANNELS_ENABLED_LOGIC, &count);
+		if (count > MAX_CHANNELS) {
+			sr_err("Cannot select more than %d channels.",
+				MAX_CHANNELS);
+			return SR_ERR_ARG;
+		}
+		for (i = 0; i < count; i++)
+			ctx->indices[ctx->num_channels++] = channels[i]->index;
+	} else {
+		tokens = g_strsplit(names, ",", 0);
+		for (i = 0; tokens[i]; i++) {
+			g_strstrip(tokens[i]);
+			for (l = sdi->channels; l; l = l->next) {
+				ch = l->data;
+				if (ch->type == SR_CHANNEL_LOGIC
+						&& !strcmp(ch->name, tokens[i]))
+					break;
+			}
+			if (!l) {
+				sr_err("Unknown logic channel '%s'.", tokens[i]);
+				g_strfreev(tokens);
+				return SR_ERR_ARG;
+			}
+			if (ctx->num_channels == MAX_CHANNELS) {
+				sr_err("Cannot select more than %d channels.",
+					MAX_CHANNELS);
+				g_strfreev(tokens);
+				return SR_ERR_ARG;
+			}
+			ctx->indices[ctx->num_channels++] = ch->index;
+		}
+		g_strfreev(tokens);
+	}
+	if (!ctx->num_channels) {
+		sr_err("No logic channels selected.");
+		return SR_ERR_ARG;
+	}
+	qsort(ctx->indices, ctx->num_channels, sizeof(ctx->indices[0]),
+		cmp_index);
+
+	return SR_OK;
+}
+
+/* Describe the output samples by copies of the selected channels. */
+static void channels_build(struct context *ctx, const struct sr_dev_inst *sdi)
+{
+	struct sr_channel *ch, *copy, *slots[MAX_CHANNELS];
+	GSList *l;
+	size_t i;
+
+	memset(slots, 0, sizeof(slots));
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC)
+			continue;
+		for (i = 0; i < ctx->num_channels; i++) {
+			if (ctx->indices[i] == ch->index)
+				break;
+		}
+		if (i == ctx->num_channels || slots[i])
+			continue;
+		copy = g_malloc0(sizeof(*copy));
+		copy->sdi = (struct sr_dev_inst *)sdi;
+		copy->index = i;
+		copy->type = SR_CHANNEL_LOGIC;
+		copy->enabled = TRUE;
+		copy->name = g_strdup(ch->name);
+		slots[i] = copy;
+	}
+	for (i = ctx->num_channels; i-- > 0; ) {
+		if (slots[i])
+			ctx->channels = g_slist_prepend(ctx->channels, slots[i]);
+	}
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	int ret;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+
+	ret = select_channels(ctx, t->sdi, g_variant_get_string(
+		g_hash_table_lookup(options, "channels"), NULL));
+	if (ret != SR_OK) {
+		g_free(ctx);
+		t->priv = NULL;
+		return ret;
+	}
+	ctx->out_unitsize = (ctx->num_channels + 7) / 8;
+	ctx->pack = g_variant_get_boolean(g_hash_table_lookup(options, "pack"));
+	if (ctx->pack && ctx->num_channels > 4) {
+		sr_warn("Only up to 4 channels can be packed, not packing.");
+		ctx->pack = FALSE;
+	}
+	if (ctx->pack)
+		ctx->pack_bits = (ctx->num_channels <= 2) ? ctx->num_channels : 4;
+	channels_build(ctx, t->sdi);
+
+	return SR_OK;
+}
+
+/* (Re)build the gather tables for another input unitsize. */
+static void tables_build(struct context *ctx, uint16_t unitsize)
+{
+	size_t i, pos, k;
+	unsigned int value;
+
+	ctx->in_unitsize = unitsize;
+	ctx->num_bytes = 0;
+	g_free(ctx->tables);
+	ctx->tables = g_malloc0(ctx->num_channels * sizeof(ctx->tables[0]));
+
+	for (i = 0; i < ctx->num_channels; i++) {
+		pos = ctx->indices[i] / 8;
+		/* Channels beyond the sample read as low. */
+		if (pos >= unitsize)
+			continue;
+		for (k = 0; k < ctx->num_bytes; k++) {
+			if (ctx->byte_pos[k] == pos)
+				break;
+		}
+		if (k == ctx->num_bytes)
+			ctx->byte_pos[ctx->num_bytes++] = pos;
+		for (value = 0; value < 256; value++) {
+			if (value & (1 << (ctx->indices[i] % 8)))
+				ctx->tables[k][value] |= UINT64_C(1) << i;
+		}
+	}
+}
+
+/* Gather the selected channels of one sample into the low bits. */
+static inline uint64_t gather(const struct context *ctx, const uint8_t *sample)
+{
+	uint64_t value;
+	size_t k;
+
+	value = 0;
+	for (k = 0; k < ctx->num_bytes; k++)
+		value |= ctx->tables[k][sample[ctx->byte_pos[k]]];
+
+	return value;
+}
+
+static uint8_t *buf_reserve(struct context *ctx, size_t size)
+{
+	if (size <= ctx->buf_size && ctx->buf)
+		return ctx->buf;
+
+	g_free(ctx->buf);
+	ctx->buf = g_try_malloc(MAX(size, 1));
+	ctx->buf_size = ctx->buf ? size : 0;
+
+	return ctx->buf;
+}
+
+/* Append one output sample in pack mode. */
+static inline uint8_t *pack_sample(struct context *ctx, uint64_t value,
+		uint8_t *out)
+{
+	ctx->carry |= value << (ctx->carry_count * ctx->pack_bits);
+	if (++ctx->carry_count == 8 / ctx->pack_bits) {
+		*out++ = ctx->carry;
+		ctx->carry = 0;
+		ctx->carry_count = 0;
+	}
+
+	return out;
+}
+
+static int process_logic(struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_logic *logic;
+	const uint8_t *sample;
+	uint64_t value;
+	uint8_t *out;
+	size_t count, size, i;
+	unsigned int j;
+
+	logic = packet_in->payload;
+	*packet_out = NULL;
+	if (!logic->unitsize)
+		return SR_OK;
+	if (logic->unitsize != ctx->in_unitsize)
+		tables_build(ctx, logic->unitsize);
+
+	count = logic->length / logic->unitsize;
+	if (ctx->pack)
+		size = (ctx->carry_count + count) / (8 / ctx->pack_bits);
+	else
+		size = count * ctx->out_unitsize;
+	if (!(out = buf_reserve(ctx, size)))
+		return SR_ERR_MALLOC;
+
+	sample = logic->data;
+	for (i = 0; i < count; i++) {
+		value = gather(ctx, sample);
+		if (ctx->pack) {
+			out = pack_sample(ctx, value, out);
+		} else {
+			for (j = 0; j < ctx->out_unitsize; j++)
+				*out++ = value >> (8 * j);
+		}
+		sample += logic->unitsize;
+	}
+	/* Wait for more samples to complete a byte. */
+	if (!size)
+		return SR_OK;
+
+	ctx->logic.length = size;
+	ctx->logic.unitsize = ctx->pack ? 1 : ctx->out_unitsize;
+	ctx->logic.data = ctx->buf;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->logic;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+/*
+ * Run-length encoded data keeps its runs, only the values get repacked.
+ * In pack mode the runs get expanded, as samples share bytes.
+ */
+static int process_logic_rle(struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_logic_rle *rle;
+	const uint8_t *value_in;
+	uint64_t value, i, n;
+	uint8_t *out;
+	size_t size, lengths_size;
+	unsigned int j;
+
+	rle = packet_in->payload;
+	*packet_out = NULL;
+	if (!rle->unitsize)
+		return SR_OK;
+	if (rle->unitsize != ctx->in_unitsize)
+		tables_build(ctx, rle->unitsize);
+
+	if (ctx->pack) {
+		size = (ctx->carry_count + sr_logic_rle_num_samples(rle))
+			/ (8 / ctx->pack_bits);
+		if (!(out = buf_reserve(ctx, size)))
+			return SR_ERR_MALLOC;
+		value_in = rle->values;
+		for (i = 0; i < rle->num_runs; i++) {
+			value = gather(ctx, value_in);
+			for (n = 0; n < rle->lengths[i]; n++)
+				out = pack_sample(ctx, value, out);
+			value_in += rle->unitsize;
+		}
+		if (!size)
+			return SR_OK;
+		ctx->logic.length = size;
+		ctx->logic.unitsize = 1;
+		ctx->logic.data = ctx->buf;
+		ctx->packet.type = SR_DF_LOGIC;
+		ctx->packet.payload = &ctx->logic;
+		*packet_out = &ctx->packet;
+		return SR_OK;
+	}
+
+	/* Lengths first, to keep them aligned. */
+	lengths_size = rle->num_runs * sizeof(rle->lengths[0]);
+	size = lengths_size + rle->num_runs * ctx->out_unitsize;
+	if (!buf_reserve(ctx, size))
+		return SR_ERR_MALLOC;
+	memcpy(ctx->buf, rle->lengths, lengths_size);
+	out = ctx->buf + lengths_size;
+	value_in = rle->values;
+	for (i = 0; i < rle->num_runs; i++) {
+		value = gather(ctx, value_in);
+		for (j = 0; j < ctx->out_unitsize; j++)
+			*out++ = value >> (8 * j);
+		value_in += rle->unitsize;
+	}
+
+	/* Neighbouring runs may now be equal, which is harmless. */
+	ctx->rle.num_runs = rle->num_runs;
+	ctx->rle.unitsize = ctx->out_unitsize;
+	ctx->rle.lengths = (uint64_t *)ctx->buf;
+	ctx->rle.values = ctx->buf + lengths_size;
+	ctx->packet.type = SR_DF_LOGIC_RLE;
+	ctx->packet.payload = &ctx->rle;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static void carry_drop(struct context *ctx)
+{
+	if (ctx->carry_count)
+		sr_dbg("Dropping %u samples of an incomplete byte.",
+			ctx->carry_count);
+	ctx->carry = 0;
+	ctx->carry_count = 0;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
+		carry_drop(ctx);
+		*packet_out = packet_in;
+		break;
+	case SR_DF_LOGIC:
+		return process_logic(ctx, packet_in, packet_out);
+	case SR_DF_LOGIC_RLE:
+		return process_logic_rle(ctx, packet_in, packet_out);
+	default:
+		*packet_out = packet_in;
+		break;
+	}
+
+	return SR_OK;
+}
+
+static GSList *get_channels(const struct sr_transform *t)
+{
+	struct context *ctx;
+
+	ctx = t->priv;
+
+	return ctx->channels;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_slist_free_full(ctx->channels, sr_channel_free_cb);
+	g_free(ctx->tables);
+	g_free(ctx->buf);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "channels", "Channels", "Comma separated logic channel names", NULL, NULL },
+	{ "pack", "Pack", "Pack several samples of few channels per byte", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_string(""));
+		options[1].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_repack = {
+	.id = "repack",
+	.name = "Repack",
+	.desc = "Repack a subset of the logic channels",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.channels = get_channels,
+	.cleanup = cleanup,
+};
@@ -0,0 +1,569 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Convert the data feed to another samplerate.
+ *
+ * The output's sample n is at position n * in_rate / out_rate of the
+ * input, which gets tracked exactly as an integer and a phase. Analog
+ * channels get one of:
+ *
+ *  - "fir": A polyphase FIR filter (windowed sinc), which also is the
+ *    anti-aliasing filter when the rate goes down. The filter has the
+ *    given number of taps per phase, times the decimation ratio when
+ *    the rate goes down. Positions between the phases get the phase
+ *    before them. The delay is half the number of taps, in input samples.
+ *  - "linear": Linear interpolation between neighbouring samples, with
+ *    a delay of one input sample.
+ *  - "zoh": The last input sample (zero-order hold), without delay.
+ *
+ * Logic data always gets the last input sample. Each input packet
+ * gets converted right away, only the filter's history is kept.
+ *
+ * Meta packets announcing the samplerate get the output rate instead.
+ * Until the input's samplerate is known, packets pass unchanged.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/resample"
+
+/* Most filter phases, positions in between get rounded. */
+#define MAX_PHASES 256
+/* Most taps per phase, when decimating by large ratios. */
+#define MAX_TAPS 4096
+
+enum {
+	MODE_FIR,
+	MODE_LINEAR,
+	MODE_ZOH,
+};
+
+/* Position of the next output sample in the input of a stream. */
+struct stream_pos {
+	/* Input sample, relative to the start of the next packet. */
+	int64_t index;
+	/* Fraction of an input sample, in units of 1 / up. */
+	uint64_t phase;
+};
+
+struct analog_stream {
+	struct stream_pos pos;
+	/* The last input samples, which the next packet's outputs need. */
+	float *history;
+};
+
+struct context {
+	uint64_t out_rate;
+	int mode;
+	unsigned int taps;
+
+	/* Conversion ratio in lowest terms, 0 while the rate is unknown. */
+	uint64_t up, down;
+	/* Filter coefficients, reversed, one row of taps per phase. */
+	float *coef;
+	unsigned int phases;
+	unsigned int filter_taps;
+
+	GHashTable *analog_streams;
+	float *values;
+	size_t values_size;
+	float *work;
+	size_t work_size;
+	float *out_values;
+	size_t out_values_size;
+
+	struct stream_pos logic_pos;
+	uint16_t logic_unitsize;
+	uint8_t *out_logic;
+	size_t out_logic_size;
+
+	/* Output packet and payloads. */
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_datafeed_meta meta;
+	GSList *meta_own;
+};
+
+static void *buf_reserve(void *buf, size_t *size, size_t needed)
+{
+	if (needed <= *size)
+		return buf;
+
+	g_free(buf);
+	*size = needed;
+
+	return g_malloc(needed);
+}
+
+static void analog_stream_free(void *data)
+{
+	struct analog_stream *st;
+
+	st = data;
+	g_free(st->history);
+	g_free(st);
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	const char *mode;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+
+	ctx->out_rate = g_variant_get_uint64(g_hash_table_lookup(options, "rate"));
+	ctx->taps = g_variant_get_uint32(g_hash_table_lookup(options, "taps"));
+	mode = g_variant_get_string(g_hash_table_lookup(options, "mode"), NULL);
+	if (!strcmp(mode, "fir"))
+		ctx->mode = MODE_FIR;
+	else if (!strcmp(mode, "linear"))
+		ctx->mode = MODE_LINEAR;
+	else if (!strcmp(mode, "zoh"))
+		ctx->mode = MODE_ZOH;
+	else
+		ctx->mode = -1;
+	if (!ctx->out_rate || ctx->mode < 0
+			|| (ctx->mode == MODE_FIR && (ctx->taps < 2 || ctx->taps > 1024))) {
+		sr_err("Invalid resampling parameters.");
+		g_free(ctx);
+		t->priv = NULL;
+		return SR_ERR_ARG;
+	}
+
+	ctx->analog_streams = g_hash_table_new_full(NULL, NULL, NULL,
+		analog_stream_free);
+
+	return SR_OK;
+}
+
+/*
+ * Design the polyphase filter: a windowed sinc at the rate of the
+ * phases, which cuts off at half the lower one of the two rates. The
+ * taps of each phase are normalized to a gain of 1.
+ */
+static void filter_design(struct context *ctx)
+{
+	unsigned int p, j, n, len, taps;
+	double cutoff, x, w, sum, *h;
+	float *row;
+
+	/* Decimation needs a longer filter, for the same cutoff slope. */
+	taps = ctx->taps;
+	if (ctx->down > ctx->up)
+		taps = MIN(MAX_TAPS, (uint64_t)taps
+			* ((ctx->down + ctx->up - 1) / ctx->up));
+	ctx->filter_taps = taps;
+	ctx->phases = MIN(ctx->up, MAX_PHASES);
+	len = ctx->phases * taps;
+	cutoff = 0.5 * MIN(1.0, (double)ctx->up / ctx->down) / ctx->phases;
+
+	h = g_malloc(len * sizeof(*h));
+	for (n = 0; n < len; n++) {
+		x = n - (len - 1) / 2.0;
+		h[n] = x == 0 ? 2 * cutoff : sin(2 * G_PI * cutoff * x) / (G_PI * x);
+		/* Blackman window. */
+		w = 0.42 - 0.5 * cos(2 * G_PI * n / (len - 1))
+			+ 0.08 * cos(4 * G_PI * n / (len - 1));
+		h[n] *= w;
+	}
+
+	g_free(ctx->coef);
+	ctx->coef = g_malloc(len * sizeof(*ctx->coef));
+	for (p = 0; p < ctx->phases; p++) {
+		row = &ctx->coef[p * taps];
+		sum = 0;
+		for (j = 0; j < taps; j++)
+			sum += h[j * ctx->phases + p];
+		/* Reversed, so that the taps run along the input. */
+		for (j = 0; j < taps; j++)
+			row[taps - 1 - j] = sum ? h[j * ctx->phases + p] / sum : 0;
+	}
+	g_free(h);
+}
+
+static void streams_reset(struct context *ctx)
+{
+	g_hash_table_remove_all(ctx->analog_streams);
+	memset(&ctx->logic_pos, 0, sizeof(ctx->logic_pos));
+	ctx->logic_unitsize = 0;
+}
+
+static void rate_set(struct context *ctx, uint64_t in_rate)
+{
+	uint64_t a, b, r;
+
+	streams_reset(ctx);
+	ctx->up = ctx->down = 0;
+	if (!in_rate)
+		return;
+
+	a = in_rate;
+	b = ctx->out_rate;
+	while (b) {
+		r = a % b;
+		a = b;
+		b = r;
+	}
+	ctx->up = ctx->out_rate / a;
+	ctx->down = in_rate / a;
+	if (ctx->mode == MODE_FIR)
+		filter_design(ctx);
+	sr_dbg("Resampling from %" PRIu64 " to %" PRIu64 " Hz (%" PRIu64
+		"/%" PRIu64 ").", in_rate, ctx->out_rate, ctx->up, ctx->down);
+}
+
+/* Number of outputs before the input sample @a limit. */
+static size_t outputs_count(const struct context *ctx,
+		const struct stream_pos *pos, int64_t limit)
+{
+	if (pos->index >= limit)
+		return 0;
+
+	/* Outputs at index + (phase + i * down) / up < limit. */
+	return ((uint64_t)(limit - pos->index) * ctx->up - pos->phase
+		+ ctx->down - 1) / ctx->down;
+}
+
+static void pos_advance(const struct context *ctx, struct stream_pos *pos)
+{
+	pos->phase += ctx->down;
+	pos->index += pos->phase / ctx->up;
+	pos->phase %= ctx->up;
+}
+
+static void meta_own_free(struct context *ctx)
+{
+	g_slist_free_full(ctx->meta_own, (GDestroyNotify)sr_config_free);
+	ctx->meta_own = NULL;
+	g_slist_free(ctx->meta.config);
+	ctx->meta.config = NULL;
+}
+
+/* Take the input's samplerate, announce the output rate instead. */
+static struct sr_datafeed_packet *process_meta(struct context *ctx,
+		struct sr_datafeed_packet *packet_in)
+{
+	const struct sr_datafeed_meta *meta;
+	struct sr_config *src, *own;
+	gboolean found;
+	GSList *l;
+
+	meta = packet_in->payload;
+	found = FALSE;
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_SAMPLERATE) {
+			rate_set(ctx, g_variant_get_uint64(src->data));
+			found = TRUE;
+		}
+	}
+	if (!found)
+		return packet_in;
+
+	meta_own_free(ctx);
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_SAMPLERATE) {
+			own = sr_config_new(SR_CONF_SAMPLERATE,
+				g_variant_new_uint64(ctx->out_rate));
+			ctx->meta_own = g_slist_append(ctx->meta_own, own);
+			src = own;
+		}
+		ctx->meta.config = g_slist_append(ctx->meta.config, src);
+	}
+	ctx->packet.type = SR_DF_META;
+	ctx->packet.payload = &ctx->meta;
+
+	return &ctx->packet;
+}
+
+static struct sr_datafeed_packet *process_logic(struct context *ctx,
+		struct sr_datafeed_packet *packet_in)
+{
+	const struct sr_datafeed_logic *logic;
+	struct stream_pos *pos;
+	const uint8_t *in;
+	uint8_t *out;
+	size_t unitsize, num_in, num_out, i;
+
+	logic = packet_in->payload;
+	unitsize = logic->unitsize;
+	if (!unitsize)
+		return NULL;
+	if (unitsize != ctx->logic_unitsize) {
+		ctx->logic_unitsize = unitsize;
+		memset(&ctx->logic_pos, 0, sizeof(ctx->logic_pos));
+	}
+
+	pos = &ctx->logic_pos;
+	num_in = logic->length / unitsize;
+	num_out = outputs_count(ctx, pos, num_in);
+	ctx->out_logic = buf_reserve(ctx->out_logic, &ctx->out_logic_size,
+		MAX(1, num_out * unitsize));
+	in = logic->data;
+	out = ctx->out_logic;
+	for (i = 0; i < num_out; i++) {
+		memcpy(out, in + pos->index * unitsize, unitsize);
+		out += unitsize;
+		pos_advance(ctx, pos);
+	}
+	pos->index -= num_in;
+
+	if (!num_out)
+		return NULL;
+
+	ctx->logic.length = num_out * unitsize;
+	ctx->logic.unitsize = unitsize;
+	ctx->logic.data = ctx->out_logic;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->logic;
+
+	return &ctx->packet;
+}
+
+/*
+ * Convert the samples of an analog channel. The work buffer holds the
+ * stream's history followed by the packet's samples, outputs need the
+ * taps up to their position.
+ */
+static size_t convert_analog(struct context *ctx, struct analog_stream *st,
+		const float *values, size_t num_in)
+{
+	struct stream_pos *pos;
+	const float *x, *c;
+	float *out, acc, frac;
+	size_t hist, num_out, i;
+	unsigned int phase, taps, j;
+
+	if (!num_in)
+		return 0;
+
+	taps = ctx->filter_taps;
+	switch (ctx->mode) {
+	case MODE_FIR:
+		hist = taps - 1;
+		break;
+	case MODE_LINEAR:
+		hist = 1;
+		break;
+	default:
+		hist = 0;
+		break;
+	}
+	/* Streams start as if their first sample had been there before. */
+	if (!st->history && hist) {
+		st->history = g_malloc(hist * sizeof(float));
+		for (i = 0; i < hist; i++)
+			st->history[i] = values[0];
+	}
+
+	ctx->work = buf_reserve(ctx->work, &ctx->work_size,
+		(hist + num_in) * sizeof(float));
+	memcpy(ctx->work, st->history, hist * sizeof(float));
+	memcpy(ctx->work + hist, values, num_in * sizeof(float));
+
+	pos = &st->pos;
+	num_out = outputs_count(ctx, pos, num_in);
+	ctx->out_values = buf_reserve(ctx->out_values, &ctx->out_values_size,
+		MAX(1, num_out) * sizeof(float));
+	out = ctx->out_values;
+
+	for (i = 0; i < num_out; i++) {
+		/* The input sample at the position, in the work buffer. */
+		x = ctx->work + hist + pos->index;
+		switch (ctx->mode) {
+		case MODE_FIR:
+			phase = pos->phase * ctx->phases / ctx->up;
+			c = &ctx->coef[phase * taps];
+			x -= taps - 1;
+			acc = 0;
+			for (j = 0; j < taps; j++)
+				acc += c[j] * x[j];
+			*out++ = acc;
+			break;
+		case MODE_LINEAR:
+			frac = (float)pos->phase / ctx->up;
+			*out++ = x[-1] + frac * (x[0] - x[-1]);
+			break;
+		default:
+			*out++ = x[0];
+			break;
+		}
+		pos_advance(ctx, pos);
+	}
+	pos->index -= num_in;
+	if (st->history)
+		memcpy(st->history, ctx->work + num_in, hist * sizeof(float));
+
+	return num_out;
+}
+
+static struct sr_datafeed_packet *process_analog(struct context *ctx,
+		struct sr_datafeed_packet *packet_in)
+{
+	const struct sr_datafeed_analog *analog;
+	struct analog_stream *st;
+	struct sr_channel *ch;
+	size_t num_out;
+
+	analog = packet_in->payload;
+	if (g_slist_length(analog->meaning->channels) != 1) {
+		sr_spew("Only single channel analog packets are resampled.");
+		return packet_in;
+	}
+	ch = analog->meaning->channels->data;
+
+	st = g_hash_table_lookup(ctx->analog_streams, ch);
+	if (!st) {
+		st = g_malloc0(sizeof(*st));
+		g_hash_table_insert(ctx->analog_streams, ch, st);
+	}
+
+	ctx->values = buf_reserve(ctx->values, &ctx->values_size,
+		MAX(1, analog->num_samples) * sizeof(float));
+	if (sr_analog_to_float(analog, ctx->values) != SR_OK)
+		return NULL;
+	num_out = convert_analog(ctx, st, ctx->values, analog->num_samples);
+	if (!num_out)
+		return NULL;
+
+	sr_analog_init(&ctx->analog, &ctx->encoding, &ctx->meaning, &ctx->spec,
+		analog->encoding->digits);
+	ctx->meaning = *analog->meaning;
+	if (analog->spec)
+		ctx->spec = *analog->spec;
+	ctx->analog.num_samples = num_out;
+	ctx->analog.data = ctx->out_values;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &ctx->analog;
+
+	return &ctx->packet;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+	GVariant *gvar;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	*packet_out = packet_in;
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		/* Devices which have a samplerate might not announce it. */
+		if (sr_config_get(t->sdi->driver, t->sdi, NULL,
+				SR_CONF_SAMPLERATE, &gvar) == SR_OK) {
+			rate_set(ctx, g_variant_get_uint64(gvar));
+			g_variant_unref(gvar);
+		} else {
+			streams_reset(ctx);
+		}
+		break;
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_END:
+		streams_reset(ctx);
+		break;
+	case SR_DF_META:
+		*packet_out = process_meta(ctx, packet_in);
+		break;
+	case SR_DF_LOGIC:
+		if (ctx->up)
+			*packet_out = process_logic(ctx, packet_in);
+		break;
+	case SR_DF_ANALOG:
+		if (ctx->up)
+			*packet_out = process_analog(ctx, packet_in);
+		break;
+	default:
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	meta_own_free(ctx);
+	g_hash_table_destroy(ctx->analog_streams);
+	g_free(ctx->coef);
+	g_free(ctx->values);
+	g_free(ctx->work);
+	g_free(ctx->out_values);
+	g_free(ctx->out_logic);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "rate", "Samplerate", "Samplerate of the output, in Hz", NULL, NULL },
+	{ "mode", "Mode", "Conversion of analog data", NULL, NULL },
+	{ "taps", "Filter taps", "Number of taps per filter phase, in the fir mode", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	GSList *l;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(SR_KHZ(1)));
+		options[1].def = g_variant_ref_sink(g_variant_new_string("fir"));
+		l = g_slist_append(NULL, g_variant_ref_sink(g_variant_new_string("fir")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("linear")));
+		l = g_slist_append(l, g_variant_ref_sink(g_variant_new_string("zoh")));
+		options[1].values = l;
+		options[2].def = g_variant_ref_sink(g_variant_new_uint32(16));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_resample = {
+	.id = "resample",
+	.name = "Resample",
+	.desc = "Convert samples to another samplerate",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
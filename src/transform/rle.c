@@ -0,0 +1,167 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Convert logic data between its dense and its run-length encoded form.
+ *
+ * By default SR_DF_LOGIC packets get run-length encoded into
+ * SR_DF_LOGIC_RLE packets. With the 'decode' option set, SR_DF_LOGIC_RLE
+ * packets get expanded into SR_DF_LOGIC packets instead, for transforms
+ * later in the chain which only handle dense logic data.
+ */
+
+#include <config.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/rle"
+
+struct context {
+	gboolean decode;
+
+	/* Encoded data of the last output packet. */
+	struct sr_datafeed_logic_rle *rle;
+	/* Decoded data, reused across packets. */
+	uint8_t *buf;
+	size_t buf_size;
+
+	/* Output packet and payload. */
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+};
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+
+	ctx->decode = g_variant_get_boolean(g_hash_table_lookup(options, "decode"));
+
+	return SR_OK;
+}
+
+static int encode(struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	int ret;
+
+	sr_logic_rle_free(ctx->rle);
+	ctx->rle = NULL;
+	ret = sr_logic_rle_encode(packet_in->payload, &ctx->rle);
+	if (ret != SR_OK)
+		return ret;
+
+	ctx->packet.type = SR_DF_LOGIC_RLE;
+	ctx->packet.payload = ctx->rle;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int decode(struct context *ctx,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	const struct sr_datafeed_logic_rle *rle;
+	size_t size;
+
+	rle = packet_in->payload;
+	size = sr_logic_rle_num_samples(rle) * rle->unitsize;
+	if (size > ctx->buf_size || !ctx->buf) {
+		g_free(ctx->buf);
+		ctx->buf = g_try_malloc(MAX(size, 1));
+		ctx->buf_size = ctx->buf ? size : 0;
+		if (!ctx->buf)
+			return SR_ERR_MALLOC;
+	}
+	sr_logic_rle_decode(rle, ctx->buf);
+
+	ctx->logic.length = size;
+	ctx->logic.unitsize = rle->unitsize;
+	ctx->logic.data = ctx->buf;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->logic;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	if (packet_in->type == SR_DF_LOGIC && !ctx->decode)
+		return encode(ctx, packet_in, packet_out);
+	if (packet_in->type == SR_DF_LOGIC_RLE && ctx->decode)
+		return decode(ctx, packet_in, packet_out);
+
+	*packet_out = packet_in;
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	sr_logic_rle_free(ctx->rle);
+	g_free(ctx->buf);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "decode", "Decode", "Expand run-length encoded logic data", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_rle = {
+	.id = "rle",
+	.name = "RLE",
+	.desc = "Run-length encode or decode logic data",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -106,6 +106,7 @@ SR_PRIV struct sr_transform_module transform_scale = {
 	.id = "scale",
 	.name = "Scale",
 	.desc = "Scale analog values by a specified factor",
+	.flags = SR_TRANSFORM_INPLACE,
 	.options = get_options,
 	.init = init,
 	.receive = receive,
@@ -45,12 +45,22 @@
 extern SR_PRIV struct sr_transform_module transform_nop;
 extern SR_PRIV struct sr_transform_module transform_scale;
 extern SR_PRIV struct sr_transform_module transform_invert;
+extern SR_PRIV struct sr_transform_module transform_envelope;
+extern SR_PRIV struct sr_transform_module transform_rle;
+extern SR_PRIV struct sr_transform_module transform_repack;
+extern SR_PRIV struct sr_transform_module transform_aggregate;
+extern SR_PRIV struct sr_transform_module transform_resample;
 /** @endcond */
 
 static const struct sr_transform_module *transform_module_list[] = {
 	&transform_nop,
 	&transform_scale,
 	&transform_invert,
+	&transform_envelope,
+	&transform_rle,
+	&transform_repack,
+	&transform_aggregate,
+	&transform_resample,
 	NULL,
 };
 
@@ -208,7 +218,7 @@ SR_API const struct sr_transform *sr_transform_new(const struct sr_transform_mod
 	gpointer key, value;
 	int i;
 
-	t = g_malloc(sizeof(struct sr_transform));
+	t = g_malloc0(sizeof(struct sr_transform));
 	t->module = tmod;
 	t->sdi = sdi;
 
@@ -259,7 +269,8 @@ SR_API const struct sr_transform *sr_transform_new(const struct sr_transform_mod
 		g_hash_table_destroy(new_opts);
 
 	/* Add the transform to the session's list of transforms. */
-	sdi->session->transforms = g_slist_append(sdi->session->transforms, t);
+	if (t)
+		sdi->session->transforms = g_slist_append(sdi->session->transforms, t);
 
 	return t;
 }
@@ -279,9 +290,150 @@ SR_API int sr_transform_free(const struct sr_transform *t)
 	ret = SR_OK;
 	if (t->module->cleanup)
 		ret = t->module->cleanup((struct sr_transform *)t);
+	g_free(t->out_buf);
 	g_free((gpointer)t);
 
 	return ret;
 }
 
+/**
+ * Get the logic channels of a transform's output.
+ *
+ * Transforms which rearrange the logic data, like repack, describe the
+ * layout of their output samples this way. The n-th channel of the list
+ * is bit n of the output samples, and has n as its index. The channels
+ * are not part of the device's channel list, they belong to the
+ * transform and stay valid until it gets freed.
+ *
+ * @param t The transform instance.
+ *
+ * @return The list of channels, or NULL when the transform keeps the
+ *         layout of the device's logic data.
+ *
+ * @since 0.6.0
+ */
+SR_API GSList *sr_transform_channels_get(const struct sr_transform *t)
+{
+	if (!t || !t->module->channels)
+		return NULL;
+
+	return t->module->channels(t);
+}
+
+/**
+ * Get the output buffer of a transform.
+ *
+ * The buffer is kept across packets, so that transform modules which
+ * produce new sample data don't need to allocate memory per packet.
+ * Its content is undefined, and it remains valid until the next call.
+ *
+ * @param t The transform instance. Must not be NULL.
+ * @param size The number of bytes needed.
+ *
+ * @return The buffer, or NULL if it could not be allocated.
+ *
+ * @private
+ */
+SR_PRIV void *sr_transform_buf_get(struct sr_transform *t, size_t size)
+{
+	if (size > t->out_size || !t->out_buf) {
+		g_free(t->out_buf);
+		t->out_buf = g_try_malloc(MAX(size, 1));
+		t->out_size = t->out_buf ? size : 0;
+	}
+
+	return t->out_buf;
+}
+
+/**
+ * Copy a packet to the output packet of a transform.
+ *
+ * The sample data goes to the transform's output buffer, so that the
+ * copy can be modified in place without affecting other owners of the
+ * packet. Packets without sample data are passed through as they are.
+ *
+ * @param t The transform instance. Must not be NULL.
+ * @param packet The packet to copy. Must not be NULL.
+ * @param copy Pointer to store the copy at. Must not be NULL. The copy
+ *             remains valid until the next call.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_MALLOC Not enough memory for the sample data.
+ *
+ * @private
+ */
+SR_PRIV int sr_transform_packet_cow(struct sr_transform *t,
+		const struct sr_datafeed_packet *packet,
+		struct sr_datafeed_packet **copy)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_logic_rle *rle;
+	const struct sr_datafeed_logic_planar *planar;
+	const struct sr_datafeed_analog *analog;
+	size_t size;
+	void *buf;
+
+	switch (packet->type) {
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		if (!(buf = sr_transform_buf_get(t, logic->length)))
+			return SR_ERR_MALLOC;
+		memcpy(buf, logic->data, logic->length);
+		t->out_logic = *logic;
+		t->out_logic.data = buf;
+		t->out_packet.payload = &t->out_logic;
+		break;
+	case SR_DF_LOGIC_RLE:
+		rle = packet->payload;
+		/* Lengths first, to keep them aligned. */
+		size = rle->num_runs * sizeof(rle->lengths[0]);
+		buf = sr_transform_buf_get(t, size + rle->num_runs * rle->unitsize);
+		if (!buf)
+			return SR_ERR_MALLOC;
+		memcpy(buf, rle->lengths, size);
+		memcpy((uint8_t *)buf + size, rle->values,
+			rle->num_runs * rle->unitsize);
+		t->out_rle = *rle;
+		t->out_rle.lengths = buf;
+		t->out_rle.values = (uint8_t *)buf + size;
+		t->out_packet.payload = &t->out_rle;
+		break;
+	case SR_DF_LOGIC_PLANAR:
+		planar = packet->payload;
+		size = planar->stride * planar->unitsize * 8;
+		if (!(buf = sr_transform_buf_get(t, size)))
+			return SR_ERR_MALLOC;
+		memcpy(buf, planar->data, size);
+		t->out_planar = *planar;
+		t->out_planar.data = buf;
+		t->out_packet.payload = &t->out_planar;
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		size = (size_t)analog->num_samples * analog->encoding->unitsize;
+		if (!(buf = sr_transform_buf_get(t, size)))
+			return SR_ERR_MALLOC;
+		memcpy(buf, analog->data, size);
+		t->out_analog = *analog;
+		t->out_analog.data = buf;
+		t->out_encoding = *analog->encoding;
+		t->out_analog.encoding = &t->out_encoding;
+		t->out_meaning = *analog->meaning;
+		t->out_analog.meaning = &t->out_meaning;
+		if (analog->spec) {
+			t->out_spec = *analog->spec;
+			t->out_analog.spec = &t->out_spec;
+		}
+		t->out_packet.payload = &t->out_analog;
+		break;
+	default:
+		*copy = (struct sr_datafeed_packet *)packet;
+		return SR_OK;
+	}
+	t->out_packet.type = packet->type;
+	*copy = &t->out_packet;
+
+	return SR_OK;
+}
+
 /** @} */
@@ -174,6 +174,7 @@ SR_API int sr_trigger_match_add(struct sr_trigger_stage *stage,
 	match->match = trigger_match;
 	match->value = value;
 	stage->matches = g_slist_append(stage->matches, match);
+	sr_dev_rearm_invalidate(ch->sdi);
 
 	return SR_OK;
 }
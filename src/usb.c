@@ -21,6 +21,7 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <memory.h>
 #include <glib.h>
 #include <libusb.h>
@@ -445,6 +446,285 @@ SR_PRIV void sr_usb_close(struct sr_usb_dev_inst *usb)
 	sr_dbg("Closed USB device %d.%d.", usb->bus, usb->address);
 }
 
+/*
+ * Optional dedicated thread for libusb event handling. The thread takes
+ * completed transfers off the kernel as soon as they are reported, instead
+ * of whenever the session's main loop gets to polling. Drivers opt in with
+ * usb_source_add_deferred(). Their completion callbacks start with
+ * usb_transfer_defer(), which on the event thread only queues the transfer.
+ * A source in the session's main loop then runs the callbacks, so that
+ * driver state and the session only ever get touched from the main loop.
+ */
+struct usb_event_thread {
+	struct sr_context *ctx;
+	libusb_context *usb_ctx;
+	GThread *thread;
+	gint running;
+	/* Completed transfers, for the main loop to run the callbacks. */
+	GAsyncQueue *queue;
+	GMainContext *main_context;
+};
+
+struct usb_deferred_transfer {
+	struct libusb_transfer *transfer;
+	libusb_transfer_cb_fn cb;
+};
+
+/* Set in the event thread, so that callbacks can tell where they run. */
+static GPrivate usb_event_thread_self;
+
+/** Event source which runs deferred completion callbacks.
+ */
+struct usb_deferred_source {
+	GSource base;
+
+	int64_t timeout_us;
+	int64_t due_us;
+
+	struct sr_session *session;
+	struct libusb_context *usb_ctx;
+	GAsyncQueue *queue;
+};
+
+static gpointer usb_event_thread_run(gpointer data)
+{
+	struct usb_event_thread *et;
+	struct timeval tv;
+
+	et = data;
+	g_private_set(&usb_event_thread_self, et);
+	sr_thread_policy_apply(et->ctx, SR_THREAD_IO);
+	while (g_atomic_int_get(&et->running)) {
+		tv.tv_sec = 0;
+		tv.tv_usec = 100 * 1000;
+		libusb_handle_events_timeout_completed(et->usb_ctx, &tv,
+			&et->running);
+	}
+
+	return NULL;
+}
+
+/**
+ * Hand a completed transfer over to the session's main loop.
+ *
+ * Drivers which use usb_source_add_deferred() call this first in their
+ * transfer completion callbacks, and return right away when it returns
+ * TRUE. The callback then runs again from the main loop, with the same
+ * transfer.
+ *
+ * @param transfer The completed transfer.
+ * @param cb The completion callback to run from the main loop.
+ *
+ * @retval TRUE The transfer got queued, the callback must return.
+ * @retval FALSE The callback runs in the main loop already.
+ *
+ * @private
+ */
+SR_PRIV gboolean usb_transfer_defer(struct libusb_transfer *transfer,
+		libusb_transfer_cb_fn cb)
+{
+	struct usb_event_thread *et;
+	struct usb_deferred_transfer *item;
+
+	et = g_private_get(&usb_event_thread_self);
+	if (!et)
+		return FALSE;
+
+	item = g_malloc(sizeof(*item));
+	item->transfer = transfer;
+	item->cb = cb;
+	g_async_queue_push(et->queue, item);
+	g_main_context_wakeup(et->main_context);
+
+	return TRUE;
+}
+
+/* Run the callbacks of queued transfers, in order of completion. */
+static void usb_deferred_run(GAsyncQueue *queue)
+{
+	struct usb_deferred_transfer *item;
+
+	while ((item = g_async_queue_try_pop(queue))) {
+		item->cb(item->transfer);
+		g_free(item);
+	}
+}
+
+static gboolean usb_deferred_source_prepare(GSource *source, int *timeout)
+{
+	struct usb_deferred_source *dsource;
+	int64_t now_us;
+	int remaining_ms;
+
+	dsource = (struct usb_deferred_source *)source;
+
+	if (g_async_queue_length(dsource->queue) > 0) {
+		*timeout = 0;
+		return TRUE;
+	}
+	now_us = g_source_get_time(source);
+	if (dsource->due_us == 0)
+		dsource->due_us = now_us + dsource->timeout_us;
+	if (dsource->due_us != INT64_MAX)
+		remaining_ms = (MAX(0, dsource->due_us - now_us) + 999) / 1000;
+	else
+		remaining_ms = -1;
+
+	*timeout = remaining_ms;
+
+	return (remaining_ms == 0);
+}
+
+static gboolean usb_deferred_source_check(GSource *source)
+{
+	struct usb_deferred_source *dsource;
+
+	dsource = (struct usb_deferred_source *)source;
+
+	return (g_async_queue_length(dsource->queue) > 0
+		|| (dsource->due_us != INT64_MAX
+			&& dsource->due_us <= g_source_get_time(source)));
+}
+
+static gboolean usb_deferred_source_dispatch(GSource *source,
+		GSourceFunc callback, void *user_data)
+{
+	struct usb_deferred_source *dsource;
+	gboolean keep;
+
+	dsource = (struct usb_deferred_source *)source;
+
+	usb_deferred_run(dsource->queue);
+	if (g_source_is_destroyed(source))
+		return G_SOURCE_REMOVE;
+
+	/* The driver's callback only runs for its timeout handling. */
+	if (dsource->due_us == INT64_MAX
+			|| dsource->due_us > g_source_get_time(source))
+		return G_SOURCE_CONTINUE;
+
+	if (!callback) {
+		sr_err("Callback not set, cannot dispatch event.");
+		return G_SOURCE_REMOVE;
+	}
+	keep = (*SR_RECEIVE_DATA_CALLBACK(callback))(-1, 0, user_data);
+
+	if (G_LIKELY(keep) && G_LIKELY(!g_source_is_destroyed(source))) {
+		if (dsource->timeout_us >= 0)
+			dsource->due_us = g_source_get_time(source)
+					+ dsource->timeout_us;
+		else
+			dsource->due_us = INT64_MAX;
+	}
+	return keep;
+}
+
+static void usb_deferred_source_finalize(GSource *source)
+{
+	struct usb_deferred_source *dsource;
+
+	dsource = (struct usb_deferred_source *)source;
+
+	g_async_queue_unref(dsource->queue);
+	dsource->queue = NULL;
+
+	sr_session_source_destroyed(dsource->session,
+			dsource->usb_ctx, source);
+}
+
+static GSource *usb_deferred_source_new(struct sr_session *session,
+		struct libusb_context *usb_ctx, GAsyncQueue *queue, int timeout_ms)
+{
+	static GSourceFuncs usb_deferred_source_funcs = {
+		.prepare  = &usb_deferred_source_prepare,
+		.check    = &usb_deferred_source_check,
+		.dispatch = &usb_deferred_source_dispatch,
+		.finalize = &usb_deferred_source_finalize
+	};
+	GSource *source;
+	struct usb_deferred_source *dsource;
+
+	source = g_source_new(&usb_deferred_source_funcs,
+		sizeof(struct usb_deferred_source));
+	dsource = (struct usb_deferred_source *)source;
+
+	g_source_set_name(source, "usb-deferred");
+
+	if (timeout_ms >= 0) {
+		dsource->timeout_us = 1000 * (int64_t)timeout_ms;
+		dsource->due_us = 0;
+	} else {
+		dsource->timeout_us = -1;
+		dsource->due_us = INT64_MAX;
+	}
+	dsource->session = session;
+	dsource->usb_ctx = usb_ctx;
+	dsource->queue = g_async_queue_ref(queue);
+
+	return source;
+}
+
+static gboolean usb_event_thread_wanted(void)
+{
+	const char *env;
+
+	env = g_getenv("SIGROK_USB_EVENT_THREAD");
+
+	return env && *env && strcmp(env, "0") != 0;
+}
+
+static int usb_event_thread_start(struct sr_context *ctx,
+		GAsyncQueue *queue, GMainContext *main_context)
+{
+	struct usb_event_thread *et;
+
+	et = g_malloc0(sizeof(*et));
+	et->ctx = ctx;
+	et->usb_ctx = ctx->libusb_ctx;
+	et->queue = g_async_queue_ref(queue);
+	et->main_context = g_main_context_ref(main_context);
+	g_atomic_int_set(&et->running, 1);
+	et->thread = g_thread_try_new("sr-usb-events",
+		usb_event_thread_run, et, NULL);
+	if (!et->thread) {
+		sr_err("Failed to start USB event thread.");
+		g_async_queue_unref(et->queue);
+		g_main_context_unref(et->main_context);
+		g_free(et);
+		return SR_ERR;
+	}
+	ctx->usb_event_thread = et;
+	sr_dbg("Started USB event thread.");
+
+	return SR_OK;
+}
+
+static void usb_event_thread_stop(struct sr_context *ctx)
+{
+	struct usb_event_thread *et;
+
+	et = ctx->usb_event_thread;
+	if (!et)
+		return;
+	ctx->usb_event_thread = NULL;
+
+	g_atomic_int_set(&et->running, 0);
+#if (LIBUSB_API_VERSION >= 0x01000105)
+	libusb_interrupt_event_handler(et->usb_ctx);
+#endif
+	g_thread_join(et->thread);
+
+	/*
+	 * Stopping runs in the main loop. Callbacks which the thread
+	 * still queued get their transfers back to the driver right away.
+	 */
+	usb_deferred_run(et->queue);
+	g_async_queue_unref(et->queue);
+	g_main_context_unref(et->main_context);
+	g_free(et);
+	sr_dbg("Stopped USB event thread.");
+}
+
 SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
 		int timeout, sr_receive_data_callback cb, void *cb_data)
 {
@@ -463,12 +743,225 @@ SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
 	return ret;
 }
 
+/**
+ * Add an event source for libusb I/O, with optional event thread.
+ *
+ * Works like usb_source_add(), for drivers whose transfer completion
+ * callbacks start with usb_transfer_defer(). With SIGROK_USB_EVENT_THREAD
+ * set in the environment, a thread handles libusb events, and the main
+ * loop runs the completion callbacks which the thread queued, as well as
+ * the driver's callback for its timeout handling.
+ *
+ * @private
+ */
+SR_PRIV int usb_source_add_deferred(struct sr_session *session,
+		struct sr_context *ctx, int timeout,
+		sr_receive_data_callback cb, void *cb_data)
+{
+	GSource *source;
+	GAsyncQueue *queue;
+	int ret;
+
+	if (!usb_event_thread_wanted() || ctx->usb_event_thread)
+		return usb_source_add(session, ctx, timeout, cb, cb_data);
+
+	queue = g_async_queue_new();
+	source = usb_deferred_source_new(session, ctx->libusb_ctx,
+		queue, timeout);
+	g_source_set_callback(source, G_SOURCE_FUNC(cb), cb_data, NULL);
+
+	ret = sr_session_source_add_internal(session, ctx->libusb_ctx, source);
+	if (ret == SR_OK) {
+		/* The thread wakes up the context the source runs in. */
+		ret = usb_event_thread_start(ctx, queue,
+			g_source_get_context(source));
+		if (ret != SR_OK)
+			sr_session_source_remove_internal(session,
+				ctx->libusb_ctx);
+	}
+	g_source_unref(source);
+	g_async_queue_unref(queue);
+
+	return ret;
+}
+
 SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx)
 {
+	usb_event_thread_stop(ctx);
+
 	return sr_session_source_remove_internal(session, ctx->libusb_ctx);
 }
 
-SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len)
+/*
+ * Cache of USB device properties which take device I/O to determine,
+ * like descriptor strings. Entries are keyed by the libusb device, which
+ * refers to one enumeration of a physical device. Devices which
+ * re-enumerate (e.g. after firmware upload) get a new entry. Entries
+ * get dropped when their device is missing from a device list, and right
+ * away through hotplug notification where libusb supports it. Repeated
+ * scans then don't open devices again to read their strings.
+ */
+struct usb_dev_cache {
+	GMutex mutex;
+	GHashTable *entries;
+	gboolean has_hotplug;
+#ifdef LIBUSB_HOTPLUG_MATCH_ANY
+	libusb_hotplug_callback_handle hotplug;
+#endif
+};
+
+struct usb_dev_cache_entry {
+	libusb_device *dev;
+	gboolean has_strings;
+	struct usb_dev_strings strings;
+	char *port_path;
+	/* The FPGA bitstream which got uploaded to the device. */
+	char *fpga_bitstream;
+};
+
+static void usb_cache_entry_free(void *data)
+{
+	struct usb_dev_cache_entry *entry;
+
+	entry = data;
+	libusb_unref_device(entry->dev);
+	g_free(entry->port_path);
+	g_free(entry->fpga_bitstream);
+	g_free(entry);
+}
+
+/* Get a device's entry, create it when needed. Call with the lock held. */
+static struct usb_dev_cache_entry *usb_cache_entry(struct usb_dev_cache *cache,
+		libusb_device *dev)
+{
+	struct usb_dev_cache_entry *entry;
+
+	entry = g_hash_table_lookup(cache->entries, dev);
+	if (!entry) {
+		entry = g_malloc0(sizeof(*entry));
+		entry->dev = libusb_ref_device(dev);
+		g_hash_table_insert(cache->entries, dev, entry);
+	}
+
+	return entry;
+}
+
+static gboolean usb_cache_entry_gone(void *key, void *value, void *user_data)
+{
+	(void)value;
+
+	return !g_hash_table_contains(user_data, key);
+}
+
+#ifdef LIBUSB_HOTPLUG_MATCH_ANY
+static int LIBUSB_CALL usb_cache_hotplug(libusb_context *usb_ctx,
+		libusb_device *dev, libusb_hotplug_event event, void *user_data)
+{
+	struct usb_dev_cache *cache;
+
+	(void)usb_ctx;
+
+	cache = user_data;
+	if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT) {
+		g_mutex_lock(&cache->mutex);
+		g_hash_table_remove(cache->entries, dev);
+		g_mutex_unlock(&cache->mutex);
+	}
+
+	return 0;
+}
+#endif
+
+/**
+ * Setup the USB device cache of a libsigrok context.
+ *
+ * @param ctx The libsigrok context, with an initialized libusb context.
+ */
+SR_PRIV void usb_cache_init(struct sr_context *ctx)
+{
+	struct usb_dev_cache *cache;
+
+	cache = g_malloc0(sizeof(*cache));
+	g_mutex_init(&cache->mutex);
+	cache->entries = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, usb_cache_entry_free);
+
+#ifdef LIBUSB_HOTPLUG_MATCH_ANY
+	if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+		cache->has_hotplug = libusb_hotplug_register_callback(
+			ctx->libusb_ctx, LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT, 0,
+			LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+			LIBUSB_HOTPLUG_MATCH_ANY, usb_cache_hotplug, cache,
+			&cache->hotplug) == LIBUSB_SUCCESS;
+	}
+#endif
+	sr_dbg("USB device cache %s hotplug notification.",
+		cache->has_hotplug ? "with" : "without");
+
+	ctx->usb_cache = cache;
+}
+
+/**
+ * Release the USB device cache of a libsigrok context.
+ *
+ * @param ctx The libsigrok context. Call before the libusb context
+ *            gets released.
+ */
+SR_PRIV void usb_cache_cleanup(struct sr_context *ctx)
+{
+	struct usb_dev_cache *cache;
+
+	cache = ctx->usb_cache;
+	if (!cache)
+		return;
+	ctx->usb_cache = NULL;
+
+#ifdef LIBUSB_HOTPLUG_MATCH_ANY
+	if (cache->has_hotplug)
+		libusb_hotplug_deregister_callback(ctx->libusb_ctx,
+			cache->hotplug);
+#endif
+	g_hash_table_destroy(cache->entries);
+	g_mutex_clear(&cache->mutex);
+	g_free(cache);
+}
+
+/**
+ * Get the list of USB devices which currently are connected.
+ *
+ * Like libusb_get_device_list(), the list gets released with
+ * libusb_free_device_list(). Drops cached properties of devices which
+ * no longer are connected.
+ *
+ * @param ctx The libsigrok context.
+ * @param list Pointer to store the NULL terminated list at.
+ *
+ * @return The number of devices, or a negative libusb error code.
+ */
+SR_PRIV ssize_t usb_get_device_list(struct sr_context *ctx,
+		libusb_device ***list)
+{
+	struct usb_dev_cache *cache;
+	GHashTable *present;
+	ssize_t count, i;
+
+	count = libusb_get_device_list(ctx->libusb_ctx, list);
+	cache = ctx->usb_cache;
+	if (count < 0 || !cache)
+		return count;
+
+	present = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (i = 0; i < count; i++)
+		g_hash_table_add(present, (*list)[i]);
+	g_mutex_lock(&cache->mutex);
+	g_hash_table_foreach_remove(cache->entries, usb_cache_entry_gone, present);
+	g_mutex_unlock(&cache->mutex);
+	g_hash_table_unref(present);
+
+	return count;
+}
+
+static int usb_read_port_path(libusb_device *dev, char *path, int path_len)
 {
 	uint8_t port_numbers[8];
 	int i, n, len;
@@ -507,6 +1000,142 @@ SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len)
 	return SR_OK;
 }
 
+/**
+ * Get the port path of a USB device, like "usb/1-2.3".
+ *
+ * @param ctx The libsigrok context, for its device cache. Can be NULL.
+ * @param dev The USB device.
+ * @param path Buffer to store the path at.
+ * @param path_len The size of the buffer.
+ */
+SR_PRIV int usb_get_port_path(struct sr_context *ctx, libusb_device *dev,
+		char *path, int path_len)
+{
+	struct usb_dev_cache *cache;
+	struct usb_dev_cache_entry *entry;
+	gboolean found;
+	int ret;
+
+	cache = ctx ? ctx->usb_cache : NULL;
+	if (cache) {
+		g_mutex_lock(&cache->mutex);
+		entry = usb_cache_entry(cache, dev);
+		found = entry->port_path != NULL;
+		if (found)
+			g_strlcpy(path, entry->port_path, path_len);
+		g_mutex_unlock(&cache->mutex);
+		if (found)
+			return SR_OK;
+	}
+
+	ret = usb_read_port_path(dev, path, path_len);
+	if (ret != SR_OK || !cache)
+		return ret;
+
+	g_mutex_lock(&cache->mutex);
+	entry = usb_cache_entry(cache, dev);
+	g_free(entry->port_path);
+	entry->port_path = g_strdup(path);
+	g_mutex_unlock(&cache->mutex);
+
+	return SR_OK;
+}
+
+static int usb_read_string(libusb_device_handle *hdl, uint8_t idx,
+		char *buf, size_t size)
+{
+	int ret;
+
+	buf[0] = '\0';
+	if (!idx)
+		return SR_OK;
+
+	ret = libusb_get_string_descriptor_ascii(hdl, idx,
+		(unsigned char *)buf, size);
+	if (ret < 0) {
+		sr_dbg("Failed to get string descriptor %u: %s.", idx,
+			libusb_error_name(ret));
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+static int usb_read_strings(libusb_device *dev, struct usb_dev_strings *strings)
+{
+	struct libusb_device_descriptor des;
+	struct libusb_device_handle *hdl;
+	int ret;
+
+	libusb_get_device_descriptor(dev, &des);
+
+	if ((ret = libusb_open(dev, &hdl)) != 0) {
+		sr_dbg("Failed to open device with VID:PID %04x:%04x: %s.",
+			des.idVendor, des.idProduct, libusb_error_name(ret));
+		return SR_ERR;
+	}
+
+	ret = usb_read_string(hdl, des.iManufacturer,
+		strings->manufacturer, sizeof(strings->manufacturer));
+	if (ret == SR_OK)
+		ret = usb_read_string(hdl, des.iProduct,
+			strings->product, sizeof(strings->product));
+	if (ret == SR_OK)
+		ret = usb_read_string(hdl, des.iSerialNumber,
+			strings->serial_num, sizeof(strings->serial_num));
+	libusb_close(hdl);
+
+	return ret;
+}
+
+/**
+ * Get the manufacturer, product and serial number strings of a USB device.
+ *
+ * The strings get read from the device once per enumeration, and are
+ * taken from the context's device cache afterwards. Strings which the
+ * device does not provide are empty.
+ *
+ * @param ctx The libsigrok context, for its device cache. Can be NULL.
+ * @param dev The USB device.
+ * @param strings Pointer to store the strings at.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR The device could not be opened, or a string not read.
+ */
+SR_PRIV int usb_get_strings(struct sr_context *ctx, libusb_device *dev,
+		struct usb_dev_strings *strings)
+{
+	struct usb_dev_cache *cache;
+	struct usb_dev_cache_entry *entry;
+	gboolean found;
+	int ret;
+
+	cache = ctx ? ctx->usb_cache : NULL;
+	if (cache) {
+		g_mutex_lock(&cache->mutex);
+		entry = usb_cache_entry(cache, dev);
+		found = entry->has_strings;
+		if (found)
+			*strings = entry->strings;
+		g_mutex_unlock(&cache->mutex);
+		if (found)
+			return SR_OK;
+	}
+
+	/* Don't hold the lock during device I/O. */
+	ret = usb_read_strings(dev, strings);
+	if (ret != SR_OK || !cache)
+		return ret;
+
+	g_mutex_lock(&cache->mutex);
+	entry = usb_cache_entry(cache, dev);
+	entry->strings = *strings;
+	entry->has_strings = TRUE;
+	g_mutex_unlock(&cache->mutex);
+
+	return SR_OK;
+}
+
 /**
  * Check the USB configuration to determine if this device has a given
  * manufacturer and product string.
@@ -514,39 +1143,492 @@ SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len)
  * @return TRUE if the device's configuration profile strings
  *         configuration, FALSE otherwise.
  */
-SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
-		const char *manufacturer, const char *product)
+SR_PRIV gboolean usb_match_manuf_prod(struct sr_context *ctx,
+		libusb_device *dev, const char *manufacturer, const char *product)
 {
-	struct libusb_device_descriptor des;
-	struct libusb_device_handle *hdl;
-	gboolean ret;
-	unsigned char strdesc[64];
+	struct usb_dev_strings strings;
 
-	hdl = NULL;
-	ret = FALSE;
-	while (!ret) {
-		/* Assume the FW has not been loaded, unless proven wrong. */
-		libusb_get_device_descriptor(dev, &des);
+	/* Assume the FW has not been loaded, unless proven wrong. */
+	if (usb_get_strings(ctx, dev, &strings) != SR_OK)
+		return FALSE;
+	if (strcmp(strings.manufacturer, manufacturer))
+		return FALSE;
+	if (strcmp(strings.product, product))
+		return FALSE;
 
-		if (libusb_open(dev, &hdl) != 0)
-			break;
+	return TRUE;
+}
 
-		if (libusb_get_string_descriptor_ascii(hdl,
-				des.iManufacturer, strdesc, sizeof(strdesc)) < 0)
-			break;
-		if (strcmp((const char *)strdesc, manufacturer))
-			break;
+/**
+ * Check whether an FPGA bitstream got uploaded to a device already.
+ *
+ * FPGAs keep their configuration while the device is powered, but
+ * devices which get unplugged or re-enumerate start over. The entries
+ * of the device cache have this lifetime, so drivers can skip the
+ * upload when a device's entry holds the bitstream they are about to
+ * upload. Drivers which have a way to check the FPGA's state should do
+ * so in addition.
+ *
+ * @param ctx The libsigrok context, for its device cache. Can be NULL.
+ * @param dev The USB device.
+ * @param name The name of the bitstream resource.
+ *
+ * @return TRUE if the bitstream was uploaded, see usb_fpga_loaded_set().
+ */
+SR_PRIV gboolean usb_fpga_loaded(struct sr_context *ctx, libusb_device *dev,
+		const char *name)
+{
+	struct usb_dev_cache *cache;
+	gboolean loaded;
 
-		if (libusb_get_string_descriptor_ascii(hdl,
-				des.iProduct, strdesc, sizeof(strdesc)) < 0)
-			break;
-		if (strcmp((const char *)strdesc, product))
-			break;
+	cache = ctx ? ctx->usb_cache : NULL;
+	if (!cache)
+		return FALSE;
+
+	g_mutex_lock(&cache->mutex);
+	loaded = !g_strcmp0(usb_cache_entry(cache, dev)->fpga_bitstream, name);
+	g_mutex_unlock(&cache->mutex);
+
+	return loaded;
+}
+
+/**
+ * Remember which FPGA bitstream got uploaded to a device.
+ *
+ * @param ctx The libsigrok context, for its device cache. Can be NULL.
+ * @param dev The USB device.
+ * @param name The name of the bitstream resource. NULL when an upload
+ *             starts, or when the FPGA lost its configuration.
+ */
+SR_PRIV void usb_fpga_loaded_set(struct sr_context *ctx, libusb_device *dev,
+		const char *name)
+{
+	struct usb_dev_cache *cache;
+	struct usb_dev_cache_entry *entry;
+
+	cache = ctx ? ctx->usb_cache : NULL;
+	if (!cache)
+		return;
+
+	g_mutex_lock(&cache->mutex);
+	entry = usb_cache_entry(cache, dev);
+	g_free(entry->fpga_bitstream);
+	entry->fpga_bitstream = g_strdup(name);
+	g_mutex_unlock(&cache->mutex);
+}
+
+/** @cond PRIVATE */
+/* Number of transfers which usb_bulk_upload() keeps in flight. */
+#define USB_UPLOAD_TRANSFERS	4
+/** @endcond */
+
+struct usb_upload {
+	const uint8_t *data;
+	size_t length;
+	size_t chunk_size;
+	size_t offset;
+	unsigned int active;
+	int status;
+};
 
-		ret = TRUE;
+static void usb_upload_submit(struct usb_upload *up,
+		struct libusb_transfer *transfer)
+{
+	size_t len;
+	int ret;
+
+	if (up->status != SR_OK || up->offset >= up->length)
+		return;
+
+	len = MIN(up->chunk_size, up->length - up->offset);
+	/* Transfers to the device only read their buffer. */
+	transfer->buffer = (unsigned char *)up->data + up->offset;
+	transfer->length = len;
+	if ((ret = libusb_submit_transfer(transfer)) != 0) {
+		sr_err("Failed to submit upload transfer: %s.",
+			libusb_error_name(ret));
+		up->status = SR_ERR;
+		return;
 	}
-	if (hdl)
-		libusb_close(hdl);
+	up->offset += len;
+	up->active++;
+}
 
-	return ret;
+static void LIBUSB_CALL usb_upload_cb(struct libusb_transfer *transfer)
+{
+	struct usb_upload *up;
+
+	up = transfer->user_data;
+	up->active--;
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		if (up->status == SR_OK)
+			sr_err("Upload transfer failed: %s.",
+				libusb_error_name(transfer->status));
+		up->status = SR_ERR;
+	} else if (transfer->actual_length != transfer->length) {
+		if (up->status == SR_OK)
+			sr_err("Short upload transfer (%d of %d bytes).",
+				transfer->actual_length, transfer->length);
+		up->status = SR_ERR;
+	}
+
+	usb_upload_submit(up, transfer);
+}
+
+/**
+ * Upload data to a bulk OUT endpoint, like an FPGA bitstream.
+ *
+ * The data gets split into chunks, with several asynchronous transfers
+ * in flight. The device then need not wait for the host between chunks,
+ * as it does with a loop of libusb_bulk_transfer() calls.
+ *
+ * @param ctx The libsigrok context.
+ * @param usb The USB device, opened.
+ * @param endpoint The endpoint address.
+ * @param data The data.
+ * @param length The number of bytes to upload.
+ * @param chunk_size The number of bytes per transfer. Devices which
+ *                   take commands of a fixed size need a multiple of it.
+ * @param timeout The timeout of each transfer, in ms.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR The upload failed.
+ */
+SR_PRIV int usb_bulk_upload(struct sr_context *ctx,
+		struct sr_usb_dev_inst *usb, unsigned char endpoint,
+		const uint8_t *data, size_t length, size_t chunk_size,
+		unsigned int timeout)
+{
+	struct libusb_transfer *transfers[USB_UPLOAD_TRANSFERS];
+	struct usb_upload up;
+	struct timeval tv;
+	unsigned int i;
+	int ret;
+
+	if (!chunk_size || chunk_size > G_MAXINT)
+		return SR_ERR_ARG;
+
+	memset(&up, 0, sizeof(up));
+	up.data = data;
+	up.length = length;
+	up.chunk_size = chunk_size;
+	up.status = SR_OK;
+
+	for (i = 0; i < USB_UPLOAD_TRANSFERS; i++) {
+		transfers[i] = libusb_alloc_transfer(0);
+		libusb_fill_bulk_transfer(transfers[i], usb->devhdl, endpoint,
+			NULL, 0, usb_upload_cb, &up, timeout);
+		usb_upload_submit(&up, transfers[i]);
+	}
+
+	/* Transfers time out, so this terminates. */
+	while (up.active) {
+		tv.tv_sec = 0;
+		tv.tv_usec = 100 * 1000;
+		ret = libusb_handle_events_timeout_completed(ctx->libusb_ctx,
+			&tv, NULL);
+		if (ret != 0 && ret != LIBUSB_ERROR_INTERRUPTED
+				&& up.status == SR_OK) {
+			sr_err("Failed to handle upload events: %s.",
+				libusb_error_name(ret));
+			up.status = SR_ERR;
+			for (i = 0; i < USB_UPLOAD_TRANSFERS; i++)
+				libusb_cancel_transfer(transfers[i]);
+		}
+	}
+
+	for (i = 0; i < USB_UPLOAD_TRANSFERS; i++)
+		libusb_free_transfer(transfers[i]);
+
+	if (up.status == SR_OK)
+		sr_spew("Uploaded %zu bytes.", length);
+
+	return up.status;
+}
+
+/*
+ * Streaming transfer sizing, shared by drivers which stream sample data
+ * through a set of bulk transfers.
+ *
+ * Transfers get allocated for the largest allowed transfer duration.
+ * The length of resubmitted transfers follows the time which the driver
+ * spends on processing completed transfers: Large transfers for busy
+ * hosts, to reduce per-transfer overhead. Small transfers for idle
+ * hosts, to reduce latency. Acquisitions which came close to an overrun
+ * increase the total buffering for the next acquisition.
+ */
+
+/** Round up to a multiple of the block size. */
+static size_t usb_stream_round(const struct usb_stream *st, uint64_t ms)
+{
+	size_t size;
+
+	size = ms * st->bytes_per_ms;
+	size = (size + st->block_size - 1) / st->block_size;
+
+	return MAX(size, 1) * st->block_size;
+}
+
+/**
+ * Setup initial streaming parameters.
+ *
+ * @param st The stream parameters.
+ * @param transfer_ms The default time span of one transfer, in ms.
+ * @param buffer_ms The default time span of all transfers, in ms.
+ * @param max_transfers The maximum number of simultaneous transfers.
+ */
+SR_PRIV void usb_stream_init(struct usb_stream *st, uint64_t transfer_ms,
+		uint64_t buffer_ms, unsigned int max_transfers)
+{
+	memset(st, 0, sizeof(*st));
+	st->transfer_ms_min = MAX(transfer_ms / 8, 1);
+	st->transfer_ms_max = transfer_ms;
+	st->buffer_ms_min = buffer_ms;
+	st->buffer_ms_max = buffer_ms * 4;
+	st->max_transfers = max_transfers;
+	st->transfer_ms = transfer_ms;
+	st->buffer_ms = buffer_ms;
+}
+
+/**
+ * Get the bounds of the streaming parameters.
+ *
+ * For the drivers' config_get() callbacks.
+ *
+ * @retval SR_ERR_NA @p key is not a streaming parameter.
+ */
+SR_PRIV int usb_stream_config_get(const struct usb_stream *st, uint32_t key,
+		GVariant **data)
+{
+	switch (key) {
+	case SR_CONF_USB_TRANSFER_MSEC:
+		*data = std_gvar_tuple_u64(st->transfer_ms_min,
+			st->transfer_ms_max);
+		break;
+	case SR_CONF_USB_BUFFER_MSEC:
+		*data = std_gvar_tuple_u64(st->buffer_ms_min,
+			st->buffer_ms_max);
+		break;
+	default:
+		return SR_ERR_NA;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Set the bounds of the streaming parameters.
+ *
+ * For the drivers' config_set() callbacks.
+ *
+ * @retval SR_ERR_NA @p key is not a streaming parameter.
+ * @retval SR_ERR_ARG Invalid bounds.
+ */
+SR_PRIV int usb_stream_config_set(struct usb_stream *st, uint32_t key,
+		GVariant *data)
+{
+	uint64_t low, high;
+
+	g_variant_get(data, "(tt)", &low, &high);
+	if (!low || low > high)
+		return SR_ERR_ARG;
+
+	switch (key) {
+	case SR_CONF_USB_TRANSFER_MSEC:
+		st->transfer_ms_min = low;
+		st->transfer_ms_max = high;
+		st->transfer_ms = CLAMP(st->transfer_ms, low, high);
+		break;
+	case SR_CONF_USB_BUFFER_MSEC:
+		st->buffer_ms_min = low;
+		st->buffer_ms_max = high;
+		st->buffer_ms = CLAMP(st->buffer_ms, low, high);
+		break;
+	default:
+		return SR_ERR_NA;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Determine the transfer sizes for an acquisition.
+ *
+ * Afterwards st->alloc_size is the size to allocate transfer buffers
+ * with, st->length the length to submit them with, and
+ * st->num_transfers the number of transfers.
+ *
+ * @param st The stream parameters.
+ * @param bytes_per_ms The device's data rate.
+ * @param block_size Transfer lengths are multiples of this, usually
+ *                   the endpoint's packet size.
+ */
+SR_PRIV void usb_stream_start(struct usb_stream *st, size_t bytes_per_ms,
+		size_t block_size)
+{
+	uint64_t n;
+
+	st->bytes_per_ms = MAX(bytes_per_ms, 1);
+	st->block_size = MAX(block_size, 1);
+	st->alloc_size = usb_stream_round(st, st->transfer_ms_max);
+	st->length = usb_stream_round(st, st->transfer_ms);
+
+	n = st->buffer_ms * st->bytes_per_ms;
+	n = (n + st->length - 1) / st->length;
+	st->num_transfers = CLAMP(n, 1, st->max_transfers);
+
+	st->duty_permille = 0;
+	st->last_us = 0;
+	st->late = FALSE;
+
+	sr_dbg("Streaming %u transfers of %zu bytes (%" PRIu64 " ms each).",
+		st->num_transfers, st->length, st->transfer_ms);
+}
+
+/**
+ * Get the transfer timeout for the current parameters, in ms.
+ */
+SR_PRIV unsigned int usb_stream_timeout(const struct usb_stream *st)
+{
+	unsigned int timeout;
+
+	timeout = st->alloc_size * st->num_transfers / st->bytes_per_ms;
+
+	return timeout + timeout / 4; /* Leave a headroom of 25% percent. */
+}
+
+/**
+ * Account for a processed transfer, and get the length to resubmit it with.
+ *
+ * @param st The stream parameters.
+ * @param start_us The monotonic time when processing of the transfer
+ *                 started.
+ *
+ * @return The transfer length for the resubmission.
+ */
+SR_PRIV size_t usb_stream_completed(struct usb_stream *st, int64_t start_us)
+{
+	int64_t now_us, period_us, duty;
+	uint64_t transfer_ms;
+
+	now_us = g_get_monotonic_time();
+	period_us = 1000 * (int64_t)st->length / st->bytes_per_ms;
+	if (!period_us)
+		return st->length;
+
+	/* Completions far apart mean the buffered data nearly ran out. */
+	if (st->last_us && (start_us - st->last_us) * 4 >
+			period_us * st->num_transfers * 3)
+		st->late = TRUE;
+	st->last_us = start_us;
+
+	duty = 1000 * (now_us - start_us) / period_us;
+	st->duty_permille = (7 * st->duty_permille + duty) / 8;
+
+	transfer_ms = st->transfer_ms;
+	if (st->duty_permille > 500)
+		transfer_ms = MIN(transfer_ms * 2, st->transfer_ms_max);
+	else if (st->duty_permille < 100)
+		transfer_ms = MAX(transfer_ms / 2, st->transfer_ms_min);
+	if (transfer_ms != st->transfer_ms) {
+		st->transfer_ms = transfer_ms;
+		st->length = MIN(usb_stream_round(st, transfer_ms),
+			st->alloc_size);
+		/* Let the average settle on the new length. */
+		st->duty_permille = 300;
+	}
+
+	return st->length;
+}
+
+/**
+ * Learn from an ended acquisition for the next one.
+ */
+SR_PRIV void usb_stream_stop(struct usb_stream *st)
+{
+	if (st->late && st->buffer_ms < st->buffer_ms_max) {
+		st->buffer_ms = MIN(st->buffer_ms * 2, st->buffer_ms_max);
+		sr_info("Transfers completed late, buffering %" PRIu64
+			" ms from now on.", st->buffer_ms);
+	}
+}
+
+/*
+ * Transfer buffers in device memory. With it, usbfs on Linux maps the
+ * buffer into the kernel and the device's data lands in it without
+ * copying from kernel to user space. Other platforms and exhausted
+ * device memory fall back to regular pooled memory.
+ *
+ * A header in front of the buffer tracks the allocation type. That's
+ * fine for device memory too, since usbfs looks up the memory mapping
+ * which contains the transfer buffer.
+ */
+#define USB_BUF_HDR_SIZE	64
+
+struct usb_buf_hdr {
+	libusb_device_handle *devhdl;
+	size_t alloc_size;
+	gboolean is_dev_mem;
+};
+
+/**
+ * Allocate a bulk transfer buffer, in device memory if possible.
+ *
+ * Free it with usb_transfer_buf_free() before the device gets closed.
+ *
+ * @param devhdl The device which transfers into the buffer.
+ * @param size The buffer size.
+ *
+ * @return The buffer, or NULL on allocation failure.
+ */
+SR_PRIV uint8_t *usb_transfer_buf_alloc(libusb_device_handle *devhdl,
+		size_t size)
+{
+	struct usb_buf_hdr *hdr;
+	size_t alloc_size;
+
+	alloc_size = USB_BUF_HDR_SIZE + size;
+	hdr = NULL;
+#if (LIBUSB_API_VERSION >= 0x01000105)
+	hdr = (struct usb_buf_hdr *)libusb_dev_mem_alloc(devhdl, alloc_size);
+	if (hdr) {
+		hdr->is_dev_mem = TRUE;
+	} else {
+		sr_spew("No device memory for %zu bytes, using heap.",
+			alloc_size);
+	}
+#endif
+	if (!hdr) {
+		hdr = sr_buffer_pool_alloc(NULL, alloc_size);
+		if (!hdr)
+			return NULL;
+		hdr->is_dev_mem = FALSE;
+	}
+	hdr->devhdl = devhdl;
+	hdr->alloc_size = alloc_size;
+
+	return (uint8_t *)hdr + USB_BUF_HDR_SIZE;
+}
+
+/**
+ * Free a buffer from usb_transfer_buf_alloc().
+ *
+ * @param buf The buffer. Can be NULL.
+ */
+SR_PRIV void usb_transfer_buf_free(uint8_t *buf)
+{
+	struct usb_buf_hdr *hdr;
+
+	if (!buf)
+		return;
+
+	hdr = (struct usb_buf_hdr *)(buf - USB_BUF_HDR_SIZE);
+#if (LIBUSB_API_VERSION >= 0x01000105)
+	if (hdr->is_dev_mem) {
+		libusb_dev_mem_free(hdr->devhdl, (unsigned char *)hdr,
+			hdr->alloc_size);
+		return;
+	}
+#endif
+	sr_buffer_pool_release(hdr);
 }
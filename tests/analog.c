@@ -428,6 +428,72 @@ START_TEST(test_analog_to_float_conv)
 }
 END_TEST
 
+START_TEST(test_analog_convert)
+{
+	int ret;
+	unsigned int i;
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_analog_raw raw;
+	const uint8_t codes[] = { 0x00, 0x7f, 0x80, 0xff, };
+	int16_t i16[ARRAY_SIZE(codes)];
+	int32_t i32[ARRAY_SIZE(codes)];
+	double d[ARRAY_SIZE(codes)];
+
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	analog.num_samples = ARRAY_SIZE(codes);
+	analog.data = (void *)codes;
+	encoding.unitsize = sizeof(codes[0]);
+	encoding.is_float = FALSE;
+	encoding.is_signed = FALSE;
+	encoding.scale.p = 1;
+	encoding.scale.q = 4;
+	encoding.offset.p = -1;
+	meaning.channels = g_slist_append(NULL, &ch);
+
+	ret = sr_analog_get_raw(&analog, &raw);
+	fail_unless(ret == SR_OK, "sr_analog_get_raw() failed: %d.", ret);
+	fail_unless(raw.data == codes);
+	fail_unless(raw.count == ARRAY_SIZE(codes));
+	fail_unless(raw.unitsize == 1 && !raw.is_signed && !raw.is_float);
+	fail_unless(raw.scale == 0.25 && raw.offset == -1.0);
+
+	ret = sr_analog_convert(&analog, SR_ANALOG_TYPE_INT16, i16);
+	fail_unless(ret == SR_OK, "int16 conversion failed: %d.", ret);
+	ret = sr_analog_convert(&analog, SR_ANALOG_TYPE_INT32, i32);
+	fail_unless(ret == SR_OK, "int32 conversion failed: %d.", ret);
+	ret = sr_analog_convert(&analog, SR_ANALOG_TYPE_DOUBLE, d);
+	fail_unless(ret == SR_OK, "double conversion failed: %d.", ret);
+	for (i = 0; i < ARRAY_SIZE(codes); i++) {
+		fail_unless(i16[i] == codes[i], "%d != %d", i16[i], codes[i]);
+		fail_unless(i32[i] == codes[i], "%d != %d", i32[i], codes[i]);
+		fail_unless(d[i] == codes[i] * 0.25 - 1.0, "%f", d[i]);
+	}
+
+	/* Unsigned 16-bit codes don't fit into int16, float never does. */
+	encoding.unitsize = sizeof(uint16_t);
+	analog.num_samples = ARRAY_SIZE(codes) / 2;
+	ret = sr_analog_convert(&analog, SR_ANALOG_TYPE_INT16, i16);
+	fail_unless(ret == SR_ERR);
+	ret = sr_analog_convert(&analog, SR_ANALOG_TYPE_INT32, i32);
+	fail_unless(ret == SR_OK);
+	encoding.is_float = TRUE;
+	encoding.unitsize = sizeof(float);
+	analog.num_samples = 1;
+	ret = sr_analog_convert(&analog, SR_ANALOG_TYPE_INT32, i32);
+	fail_unless(ret == SR_ERR);
+	ret = sr_analog_convert(NULL, SR_ANALOG_TYPE_DOUBLE, d);
+	fail_unless(ret == SR_ERR_ARG);
+	ret = sr_analog_convert(&analog, SR_ANALOG_TYPE_DOUBLE, NULL);
+	fail_unless(ret == SR_ERR_ARG);
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
 START_TEST(test_analog_si_prefix)
 {
 	struct {
@@ -694,6 +760,7 @@ Suite *suite_analog(void)
 	tcase_add_test(tc, test_analog_to_float);
 	tcase_add_test(tc, test_analog_to_float_null);
 	tcase_add_test(tc, test_analog_to_float_conv);
+	tcase_add_test(tc, test_analog_convert);
 	suite_add_tcase(s, tc);
 
 	tc = tcase_create("analog_si_unit");
@@ -0,0 +1,1113 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmarks of the data path, run with "make bench".
+ *
+ * Usage: bench [-t seconds] [-r payload-file] [name-filter...]
+ *
+ * Every benchmark runs for at least the given time (0.2s by default).
+ * The results are printed as CSV, one line per benchmark:
+ *
+ *   name, iterations, samples per iteration, ns per sample, samples
+ *   per second, MB per second, bytes allocated per iteration,
+ *   allocations per iteration, peak heap growth in bytes
+ *
+ * MB per second counts the file data parsed by input modules, and the
+ * text or file data produced by output modules, it is 0 elsewhere.
+ * Allocations are only counted with glibc, elsewhere they read -1.
+ *
+ * The driver benchmarks replay USB transfer payloads into the drivers'
+ * conversion routines. They use random data, or the raw bulk transfer
+ * data of a capture which is given with -r.
+ * The harness is linked statically, so that it can reach internals
+ * like the software trigger.
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "bench.h"
+
+#define BENCH_SAMPLES		(64 * 1024)
+#define NUM_LOGIC_CHANNELS	8
+#define NUM_ANALOG_CHANNELS	2
+
+/* Keep modules which accumulate their input from growing without bound. */
+#define MAX_OUTPUT_SAMPLES	(16 * 1024 * 1024)
+
+/* Input files get fed in chunks of this size, like sigrok-cli does. */
+#define INPUT_CHUNK_SIZE	(64 * 1024)
+#define INPUT_SAMPLES		(256 * 1024)
+#define CHRONOVU_LA8_SAMPLES	(8 * 1024 * 1024)
+
+#define DEMO_SAMPLES		(1024 * 1024)
+#define DEMO_SAMPLERATE		SR_MHZ(1)
+/* Demo devices of the topology benchmark, and their channels. */
+#define TOPOLOGY_DEVICES	8
+#define TOPOLOGY_LOGIC		256
+#define TOPOLOGY_ANALOG		64
+#define TOPOLOGY_SAMPLES	(64 * 1024)
+
+#ifdef __GLIBC__
+#include <malloc.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+static uint64_t alloc_bytes, alloc_count;
+static int64_t alloc_live, alloc_peak;
+
+static void *alloc_account(void *ptr, size_t size)
+{
+	int64_t live, peak;
+
+	__atomic_add_fetch(&alloc_bytes, size, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+	if (!ptr)
+		return NULL;
+
+	/* The peak is only approximate with several threads. */
+	live = __atomic_add_fetch(&alloc_live, malloc_usable_size(ptr),
+		__ATOMIC_RELAXED);
+	peak = __atomic_load_n(&alloc_peak, __ATOMIC_RELAXED);
+	if (live > peak)
+		__atomic_store_n(&alloc_peak, live, __ATOMIC_RELAXED);
+
+	return ptr;
+}
+
+static void alloc_release(void *ptr)
+{
+	if (ptr)
+		__atomic_sub_fetch(&alloc_live, malloc_usable_size(ptr),
+			__ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+	return alloc_account(__libc_malloc(size), size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	return alloc_account(__libc_calloc(nmemb, size), nmemb * size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	alloc_release(ptr);
+	return alloc_account(__libc_realloc(ptr, size), size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+	if (!(*memptr = alloc_account(__libc_memalign(alignment, size), size)))
+		return size ? ENOMEM : 0;
+
+	return 0;
+}
+
+void free(void *ptr)
+{
+	alloc_release(ptr);
+	__libc_free(ptr);
+}
+
+#define ALLOC_COUNTING 1
+#else
+static uint64_t alloc_bytes, alloc_count;
+static int64_t alloc_live, alloc_peak;
+#define ALLOC_COUNTING 0
+#endif
+
+static int64_t min_time_us = 200 * 1000;
+static char **filters;
+static int num_filters;
+static uint8_t *replay_data;
+static size_t replay_len;
+
+uint64_t bench_bytes;
+
+static uint8_t logic_data[BENCH_SAMPLES];
+static float analog_data[BENCH_SAMPLES];
+static uint8_t raw_data[BENCH_SAMPLES * sizeof(double)];
+
+gboolean bench_wanted(const char *name)
+{
+	int i;
+
+	if (!num_filters)
+		return TRUE;
+	for (i = 0; i < num_filters; i++) {
+		if (strstr(name, filters[i]))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * Run a benchmark with doubling iteration counts, until one run takes
+ * at least min_time_us or would exceed max_samples, and report that run.
+ * Benchmarks which move file data add its size to bench_bytes.
+ */
+void bench_run(const char *name, uint64_t samples,
+		uint64_t max_samples, bench_fn fn, void *data)
+{
+	uint64_t iterations, i, bytes, count;
+	int64_t start, elapsed, live;
+	double ns_per_sample, mb_per_s;
+
+	if (!bench_wanted(name))
+		return;
+
+	/* Warm up caches, and state some modules set up lazily. */
+	fn(data);
+
+	iterations = 1;
+	for (;;) {
+		__atomic_store_n(&alloc_bytes, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&alloc_count, 0, __ATOMIC_RELAXED);
+		live = __atomic_load_n(&alloc_live, __ATOMIC_RELAXED);
+		__atomic_store_n(&alloc_peak, live, __ATOMIC_RELAXED);
+		bench_bytes = 0;
+		start = g_get_monotonic_time();
+		for (i = 0; i < iterations; i++)
+			fn(data);
+		elapsed = g_get_monotonic_time() - start;
+		bytes = __atomic_load_n(&alloc_bytes, __ATOMIC_RELAXED);
+		count = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+		if (elapsed >= min_time_us)
+			break;
+		if (max_samples && 2 * iterations * samples > max_samples)
+			break;
+		iterations *= 2;
+	}
+
+	ns_per_sample = 1000.0 * MAX(elapsed, 1) / (iterations * samples);
+	mb_per_s = (double)bench_bytes / MAX(elapsed, 1);
+	if (ALLOC_COUNTING)
+		printf("%s,%" PRIu64 ",%" PRIu64 ",%.3f,%.0f,%.3f,%.1f,%.2f,"
+			"%" PRIi64 "\n", name, iterations, samples,
+			ns_per_sample, 1e9 / ns_per_sample, mb_per_s,
+			(double)bytes / iterations, (double)count / iterations,
+			__atomic_load_n(&alloc_peak, __ATOMIC_RELAXED) - live);
+	else
+		printf("%s,%" PRIu64 ",%" PRIu64 ",%.3f,%.0f,%.3f,-1,-1,-1\n",
+			name, iterations, samples, ns_per_sample,
+			1e9 / ns_per_sample, mb_per_s);
+	fflush(stdout);
+}
+
+/* A virtual device in the session, with D0.. and A0.. channels. */
+struct sr_dev_inst *bench_dev_new(struct sr_session *session,
+		const char *model, int num_logic, int num_analog)
+{
+	struct sr_dev_inst *sdi;
+	char name[16];
+	int i;
+
+	sdi = sr_dev_inst_user_new("sigrok", model, NULL);
+	for (i = 0; i < num_logic; i++) {
+		g_snprintf(name, sizeof(name), "D%d", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+	for (i = 0; i < num_analog; i++) {
+		g_snprintf(name, sizeof(name), "A%d", i);
+		sr_dev_inst_channel_add(sdi, num_logic + i,
+			SR_CHANNEL_ANALOG, name);
+	}
+	sr_session_dev_add(session, sdi);
+
+	return sdi;
+}
+
+/* The payload of the driver benchmarks: the replayed capture, or noise. */
+const uint8_t *bench_payload(size_t *len)
+{
+	if (replay_data) {
+		*len = replay_len;
+		return replay_data;
+	}
+
+	*len = sizeof(raw_data);
+
+	return raw_data;
+}
+
+static void fill_data(void)
+{
+	uint32_t x;
+	size_t i;
+
+	/* A xorshift generator is good enough for synthetic samples. */
+	x = 0x12345678;
+	for (i = 0; i < sizeof(raw_data); i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		raw_data[i] = x;
+		if (i < BENCH_SAMPLES)
+			logic_data[i] = x >> 8;
+	}
+
+	for (i = 0; i < BENCH_SAMPLES; i++)
+		analog_data[i] = sinf(i * 0.01f) + (raw_data[i] & 0x0f) * 0.01f;
+}
+
+/* Analog data of the native float format, and a packet carrying it. */
+struct analog_packet {
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+};
+
+static void analog_packet_init(struct analog_packet *p, GSList *channels)
+{
+	sr_analog_init(&p->analog, &p->encoding, &p->meaning, &p->spec, 3);
+	p->analog.data = analog_data;
+	p->analog.num_samples = BENCH_SAMPLES;
+	p->meaning.mq = SR_MQ_VOLTAGE;
+	p->meaning.unit = SR_UNIT_VOLT;
+	p->meaning.channels = channels;
+	p->packet.type = SR_DF_ANALOG;
+	p->packet.payload = &p->analog;
+}
+
+/*--- sr_analog_to_float() ---------------------------------------------------*/
+
+struct to_float {
+	struct analog_packet p;
+	float *out;
+};
+
+static const struct {
+	const char *name;
+	uint8_t unitsize;
+	gboolean is_signed, is_float, swapped;
+} encodings[] = {
+	{ "u8", 1, FALSE, FALSE, FALSE },
+	{ "s16", 2, TRUE, FALSE, FALSE },
+	{ "s16-swapped", 2, TRUE, FALSE, TRUE },
+	{ "u32", 4, FALSE, FALSE, FALSE },
+	{ "s32-swapped", 4, TRUE, FALSE, TRUE },
+	{ "float", 4, TRUE, TRUE, FALSE },
+	{ "float-swapped", 4, TRUE, TRUE, TRUE },
+	{ "double", 8, TRUE, TRUE, FALSE },
+};
+
+static void run_to_float(void *data)
+{
+	struct to_float *b = data;
+
+	sr_analog_to_float(&b->p.analog, b->out);
+}
+
+static void bench_analog_to_float(void)
+{
+	struct to_float b;
+	uint8_t *buf, tmp;
+	double d;
+	float f;
+	size_t i, j, k, n;
+	char name[64];
+
+	b.out = g_malloc(BENCH_SAMPLES * sizeof(float));
+	buf = g_malloc(BENCH_SAMPLES * sizeof(double));
+
+	for (i = 0; i < G_N_ELEMENTS(encodings); i++) {
+		n = encodings[i].unitsize;
+		/* Random codes for integers, real values for floats. */
+		for (j = 0; j < BENCH_SAMPLES; j++) {
+			if (encodings[i].is_float && n == sizeof(float)) {
+				f = analog_data[j];
+				memcpy(&buf[j * n], &f, n);
+			} else if (encodings[i].is_float) {
+				d = analog_data[j];
+				memcpy(&buf[j * n], &d, n);
+			} else {
+				memcpy(&buf[j * n], &raw_data[j * n], n);
+			}
+			if (!encodings[i].swapped)
+				continue;
+			for (k = 0; k < n / 2; k++) {
+				tmp = buf[j * n + k];
+				buf[j * n + k] = buf[j * n + n - 1 - k];
+				buf[j * n + n - 1 - k] = tmp;
+			}
+		}
+
+		analog_packet_init(&b.p, NULL);
+		b.p.analog.data = buf;
+		b.p.encoding.unitsize = n;
+		b.p.encoding.is_signed = encodings[i].is_signed;
+		b.p.encoding.is_float = encodings[i].is_float;
+#ifdef WORDS_BIGENDIAN
+		b.p.encoding.is_bigendian = !encodings[i].swapped;
+#else
+		b.p.encoding.is_bigendian = encodings[i].swapped;
+#endif
+		if (!encodings[i].is_float) {
+			b.p.encoding.scale.p = 1;
+			b.p.encoding.scale.q = 1000;
+		}
+
+		g_snprintf(name, sizeof(name), "analog_to_float.%s",
+			encodings[i].name);
+		bench_run(name, BENCH_SAMPLES, 0, run_to_float, &b);
+	}
+
+	g_free(buf);
+	g_free(b.out);
+}
+
+/*--- sr_a2l_threshold() -----------------------------------------------------*/
+
+struct a2l {
+	struct analog_packet p;
+	uint8_t *out;
+};
+
+static void run_a2l_threshold(void *data)
+{
+	struct a2l *b = data;
+
+	sr_a2l_threshold(&b->p.analog, 0.5, b->out, BENCH_SAMPLES);
+}
+
+static void bench_a2l(void)
+{
+	struct a2l b;
+
+	analog_packet_init(&b.p, NULL);
+	b.out = g_malloc(BENCH_SAMPLES);
+	bench_run("a2l_threshold", BENCH_SAMPLES, 0, run_a2l_threshold, &b);
+	g_free(b.out);
+}
+
+/*--- soft_trigger_logic_check() ---------------------------------------------*/
+
+struct trigger {
+	struct soft_trigger_logic *stl;
+	uint8_t *buf;
+};
+
+static void run_soft_trigger(void *data)
+{
+	struct trigger *b = data;
+	int pre_trigger_samples;
+
+	if (soft_trigger_logic_check(b->stl, b->buf, BENCH_SAMPLES,
+			&pre_trigger_samples) >= 0)
+		soft_trigger_logic_rearm(b->stl);
+}
+
+static void bench_soft_trigger(struct sr_dev_inst *sdi)
+{
+	struct trigger b;
+	struct sr_trigger *trig;
+	struct sr_trigger_stage *stage;
+	struct sr_channel *ch6, *ch7;
+	size_t i;
+
+	ch6 = g_slist_nth_data(sdi->channels, 6);
+	ch7 = g_slist_nth_data(sdi->channels, 7);
+
+	/* Channels 6 and 7 are never set, so the triggers never match. */
+	b.buf = g_malloc(BENCH_SAMPLES);
+	for (i = 0; i < BENCH_SAMPLES; i++)
+		b.buf[i] = logic_data[i] & 0x3f;
+
+	trig = sr_trigger_new(NULL);
+	stage = sr_trigger_stage_add(trig);
+	sr_trigger_match_add(stage, ch6, SR_TRIGGER_ONE, 0);
+	sr_trigger_match_add(stage, ch7, SR_TRIGGER_ONE, 0);
+	b.stl = soft_trigger_logic_new(sdi, trig, 0);
+	bench_run("soft_trigger.level", BENCH_SAMPLES, 0, run_soft_trigger, &b);
+	soft_trigger_logic_free(b.stl);
+	sr_trigger_free(trig);
+
+	trig = sr_trigger_new(NULL);
+	stage = sr_trigger_stage_add(trig);
+	sr_trigger_match_add(stage, ch7, SR_TRIGGER_RISING, 0);
+	b.stl = soft_trigger_logic_new(sdi, trig, 0);
+	bench_run("soft_trigger.edge", BENCH_SAMPLES, 0, run_soft_trigger, &b);
+	soft_trigger_logic_free(b.stl);
+	sr_trigger_free(trig);
+
+	g_free(b.buf);
+}
+
+/*--- Feed queues -------------------------------------------------------------*/
+
+static void run_feed_queue_logic(void *data)
+{
+	struct feed_queue_logic *q = data;
+
+	feed_queue_logic_submit_many(q, logic_data, BENCH_SAMPLES);
+}
+
+static void run_feed_queue_logic_single(void *data)
+{
+	struct feed_queue_logic *q = data;
+	size_t i;
+
+	for (i = 0; i < BENCH_SAMPLES; i++)
+		feed_queue_logic_submit(q, &logic_data[i], 1);
+}
+
+static void run_feed_queue_analog(void *data)
+{
+	struct feed_queue_analog *q = data;
+	size_t i;
+
+	for (i = 0; i < BENCH_SAMPLES; i++)
+		feed_queue_analog_submit(q, analog_data[i], 1);
+}
+
+static void bench_feed_queue(struct sr_dev_inst *sdi, struct sr_channel *ach)
+{
+	struct feed_queue_logic *lq;
+	struct feed_queue_analog *aq;
+
+	lq = feed_queue_logic_alloc(sdi, 4096, 1);
+	bench_run("feed_queue.logic", BENCH_SAMPLES, 0,
+		run_feed_queue_logic, lq);
+	bench_run("feed_queue.logic_single", BENCH_SAMPLES, 0,
+		run_feed_queue_logic_single, lq);
+	feed_queue_logic_free(lq);
+
+	aq = feed_queue_analog_alloc(sdi, 4096, 3, ach);
+	bench_run("feed_queue.analog_single", BENCH_SAMPLES, 0,
+		run_feed_queue_analog, aq);
+	feed_queue_analog_free(aq);
+}
+
+/*--- Transforms --------------------------------------------------------------*/
+
+struct send {
+	const struct sr_dev_inst *sdi;
+	const struct sr_datafeed_packet *packet;
+};
+
+static void run_session_send(void *data)
+{
+	struct send *b = data;
+
+	sr_session_send(b->sdi, b->packet);
+}
+
+static void bench_transforms(struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *logic_packet,
+		const struct sr_datafeed_packet *analog_packet)
+{
+	const struct sr_transform_module **tmods;
+	const struct sr_transform *t;
+	struct send b;
+	char name[64];
+	int i;
+
+	b.sdi = sdi;
+
+	/* The cost of the session itself, with no transform. */
+	b.packet = logic_packet;
+	bench_run("transform.none.logic", BENCH_SAMPLES, 0,
+		run_session_send, &b);
+
+	tmods = sr_transform_list();
+	for (i = 0; tmods[i]; i++) {
+		if (!(t = sr_transform_new(tmods[i], NULL, sdi)))
+			continue;
+
+		g_snprintf(name, sizeof(name), "transform.%s.logic",
+			tmods[i]->id);
+		b.packet = logic_packet;
+		bench_run(name, BENCH_SAMPLES, 0, run_session_send, &b);
+
+		g_snprintf(name, sizeof(name), "transform.%s.analog",
+			tmods[i]->id);
+		b.packet = analog_packet;
+		bench_run(name, BENCH_SAMPLES, 0, run_session_send, &b);
+
+		sdi->session->transforms = g_slist_remove(
+			sdi->session->transforms, t);
+		sr_transform_free(t);
+	}
+}
+
+/*--- Outputs -----------------------------------------------------------------*/
+
+struct output {
+	const struct sr_output *o;
+	const struct sr_datafeed_packet *packet;
+};
+
+static void run_output(void *data)
+{
+	struct output *b = data;
+	GString *out;
+
+	out = NULL;
+	sr_output_send(b->o, b->packet, &out);
+	if (out) {
+		bench_bytes += out->len;
+		g_string_free(out, TRUE);
+	}
+}
+
+static void bench_outputs(struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *logic_packet,
+		const struct sr_datafeed_packet *analog_packet)
+{
+	const struct sr_output_module **omods;
+	struct sr_datafeed_packet header_packet, end_packet;
+	struct sr_datafeed_header header;
+	struct output b;
+	char name[64];
+	int i, j;
+
+	header.feed_version = 1;
+	gettimeofday(&header.starttime, NULL);
+	header_packet.type = SR_DF_HEADER;
+	header_packet.payload = &header;
+	end_packet.type = SR_DF_END;
+	end_packet.payload = NULL;
+
+	omods = sr_output_list();
+	for (i = 0; omods[i]; i++) {
+		for (j = 0; j < 2; j++) {
+			/* Modules which need a file can't be used here. */
+			if (!(b.o = sr_output_new(omods[i], NULL, sdi, NULL)))
+				break;
+
+			b.packet = &header_packet;
+			run_output(&b);
+
+			g_snprintf(name, sizeof(name), "output.%s.%s",
+				sr_output_id_get(omods[i]),
+				j ? "analog" : "logic");
+			b.packet = j ? analog_packet : logic_packet;
+			bench_run(name, BENCH_SAMPLES, MAX_OUTPUT_SAMPLES,
+				run_output, &b);
+
+			b.packet = &end_packet;
+			run_output(&b);
+			sr_output_free(b.o);
+		}
+	}
+}
+
+/*--- Input modules -----------------------------------------------------------*/
+
+struct input {
+	struct sr_session *session;
+	const struct sr_input_module *imod;
+	GHashTable *options;
+	GPtrArray *chunks;
+	uint64_t size;
+};
+
+static void gen_binary(GString *file, GHashTable *options, uint64_t *samples)
+{
+	(void)options;
+
+	g_string_append_len(file, (const char *)raw_data, INPUT_SAMPLES);
+	*samples = INPUT_SAMPLES;
+}
+
+static void gen_chronovu_la8(GString *file, GHashTable *options,
+		uint64_t *samples)
+{
+	size_t i;
+
+	(void)options;
+
+	/* Always 8MiB of samples, followed by a 5 byte trailer. */
+	for (i = 0; i < CHRONOVU_LA8_SAMPLES; i += sizeof(raw_data))
+		g_string_append_len(file, (const char *)raw_data,
+			sizeof(raw_data));
+	g_string_append_len(file, "\x01\x00\x00\x00\x00", 5);
+	*samples = CHRONOVU_LA8_SAMPLES;
+}
+
+static void gen_csv(GString *file, GHashTable *options, uint64_t *samples)
+{
+	size_t i;
+	int j;
+
+	g_hash_table_insert(options, g_strdup("column_formats"),
+		g_variant_ref_sink(g_variant_new_string("8l")));
+	g_hash_table_insert(options, g_strdup("samplerate"),
+		g_variant_ref_sink(g_variant_new_uint64(DEMO_SAMPLERATE)));
+
+	g_string_append(file, "D0,D1,D2,D3,D4,D5,D6,D7\n");
+	for (i = 0; i < INPUT_SAMPLES; i++) {
+		for (j = 0; j < 8; j++) {
+			g_string_append_c(file, logic_data[i % BENCH_SAMPLES]
+				& (1 << j) ? '1' : '0');
+			g_string_append_c(file, j < 7 ? ',' : '\n');
+		}
+	}
+	*samples = INPUT_SAMPLES;
+}
+
+static void gen_vcd(GString *file, GHashTable *options, uint64_t *samples)
+{
+	uint8_t prev, cur;
+	size_t i;
+	int j;
+
+	(void)options;
+
+	g_string_append(file, "$timescale 1 us $end\n$scope module bench $end\n");
+	for (j = 0; j < 8; j++)
+		g_string_append_printf(file, "$var wire 1 %c D%d $end\n",
+			'!' + j, j);
+	g_string_append(file, "$upscope $end\n$enddefinitions $end\n");
+
+	prev = ~logic_data[0];
+	for (i = 0; i < INPUT_SAMPLES; i++) {
+		cur = logic_data[i % BENCH_SAMPLES];
+		g_string_append_printf(file, "#%zu\n", i);
+		for (j = 0; j < 8; j++) {
+			if ((cur ^ prev) & (1 << j))
+				g_string_append_printf(file, "%c%c\n",
+					cur & (1 << j) ? '1' : '0', '!' + j);
+		}
+		prev = cur;
+	}
+	g_string_append_printf(file, "#%d\n", INPUT_SAMPLES);
+	*samples = INPUT_SAMPLES;
+}
+
+static void append_le16(GString *file, uint16_t value)
+{
+	uint8_t buf[sizeof(value)];
+
+	WL16(buf, value);
+	g_string_append_len(file, (const char *)buf, sizeof(buf));
+}
+
+static void append_le32(GString *file, uint32_t value)
+{
+	uint8_t buf[sizeof(value)];
+
+	WL32(buf, value);
+	g_string_append_len(file, (const char *)buf, sizeof(buf));
+}
+
+static void gen_wav(GString *file, GHashTable *options, uint64_t *samples)
+{
+	size_t i;
+
+	(void)options;
+
+	/* Stereo 16bit PCM. */
+	g_string_append(file, "RIFF");
+	append_le32(file, 36 + INPUT_SAMPLES * 4);
+	g_string_append(file, "WAVEfmt ");
+	append_le32(file, 16);
+	append_le16(file, 1);
+	append_le16(file, 2);
+	append_le32(file, 48000);
+	append_le32(file, 48000 * 4);
+	append_le16(file, 4);
+	append_le16(file, 16);
+	g_string_append(file, "data");
+	append_le32(file, INPUT_SAMPLES * 4);
+	for (i = 0; i < 2 * INPUT_SAMPLES; i++)
+		append_le16(file,
+			(int16_t)(analog_data[i % BENCH_SAMPLES] * 16384));
+	*samples = 2 * INPUT_SAMPLES;
+}
+
+static void gen_raw_analog(GString *file, GHashTable *options,
+		uint64_t *samples)
+{
+	size_t i;
+
+	g_hash_table_insert(options, g_strdup("format"),
+		g_variant_ref_sink(g_variant_new_string("S16_LE (-1..1)")));
+	g_hash_table_insert(options, g_strdup("samplerate"),
+		g_variant_ref_sink(g_variant_new_uint64(DEMO_SAMPLERATE)));
+
+	for (i = 0; i < INPUT_SAMPLES; i++)
+		append_le16(file,
+			(int16_t)(analog_data[i % BENCH_SAMPLES] * 16384));
+	*samples = INPUT_SAMPLES;
+}
+
+static void gen_saleae(GString *file, GHashTable *options, uint64_t *samples)
+{
+	g_hash_table_insert(options, g_strdup("format"),
+		g_variant_ref_sink(g_variant_new_string("logic1-digital")));
+	g_hash_table_insert(options, g_strdup("samplerate"),
+		g_variant_ref_sink(g_variant_new_uint64(DEMO_SAMPLERATE)));
+
+	/* Logic 1 binary export, one byte for every sample. */
+	g_string_append_len(file, (const char *)raw_data, INPUT_SAMPLES);
+	*samples = INPUT_SAMPLES;
+}
+
+/*
+ * Modules whose files are easily generated. The others read vendor
+ * file formats (logicport, trace32_ad) or don't parse files at all.
+ */
+static const struct {
+	const char *id;
+	void (*gen)(GString *file, GHashTable *options, uint64_t *samples);
+} input_files[] = {
+	{ "binary", gen_binary },
+	{ "chronovu-la8", gen_chronovu_la8 },
+	{ "csv", gen_csv },
+	{ "vcd", gen_vcd },
+	{ "wav", gen_wav },
+	{ "raw_analog", gen_raw_analog },
+	{ "saleae", gen_saleae },
+};
+
+static void run_input(void *data)
+{
+	struct input *b = data;
+	const struct sr_input *in;
+	struct sr_dev_inst *sdi;
+	unsigned int i;
+
+	if (!(in = sr_input_new(b->imod, b->options)))
+		return;
+
+	/* Add the device to the session as soon as it's known. */
+	sdi = NULL;
+	for (i = 0; i < b->chunks->len; i++) {
+		if (sr_input_send(in, g_ptr_array_index(b->chunks, i)) != SR_OK)
+			break;
+		if (!sdi && (sdi = sr_input_dev_inst_get(in)))
+			sr_session_dev_add(b->session, sdi);
+	}
+	sr_input_end(in);
+
+	if (sdi)
+		sr_session_dev_remove(b->session, sdi);
+	sr_input_free(in);
+	bench_bytes += b->size;
+}
+
+static void free_chunk(gpointer data)
+{
+	g_string_free(data, TRUE);
+}
+
+static void bench_inputs(struct sr_session *session)
+{
+	struct input b;
+	GString *file;
+	uint64_t samples;
+	size_t i, pos, len;
+	char name[64];
+
+	b.session = session;
+	for (i = 0; i < G_N_ELEMENTS(input_files); i++) {
+		g_snprintf(name, sizeof(name), "input.%s", input_files[i].id);
+		if (!bench_wanted(name))
+			continue;
+		if (!(b.imod = sr_input_find((char *)input_files[i].id)))
+			continue;
+
+		b.options = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, (GDestroyNotify)g_variant_unref);
+		file = g_string_new(NULL);
+		input_files[i].gen(file, b.options, &samples);
+
+		b.size = file->len;
+		b.chunks = g_ptr_array_new_with_free_func(free_chunk);
+		for (pos = 0; pos < file->len; pos += len) {
+			len = MIN(INPUT_CHUNK_SIZE, file->len - pos);
+			g_ptr_array_add(b.chunks,
+				g_string_new_len(file->str + pos, len));
+		}
+		g_string_free(file, TRUE);
+
+		bench_run(name, samples, 0, run_input, &b);
+
+		g_ptr_array_free(b.chunks, TRUE);
+		g_hash_table_destroy(b.options);
+	}
+}
+
+/*--- Demo device to output modules -------------------------------------------*/
+
+struct demo {
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	const struct sr_output_module *omod;
+	const struct sr_output *o;
+};
+
+static void demo_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct demo *b = cb_data;
+	GString *out;
+
+	(void)sdi;
+
+	if (!b->o)
+		return;
+
+	out = NULL;
+	sr_output_send(b->o, packet, &out);
+	if (out) {
+		bench_bytes += out->len;
+		g_string_free(out, TRUE);
+	}
+}
+
+static void run_demo(void *data)
+{
+	struct demo *b = data;
+
+	b->o = NULL;
+	if (b->omod)
+		b->o = sr_output_new(b->omod, NULL, b->sdi, NULL);
+
+	if (sr_session_start(b->session) == SR_OK)
+		sr_session_run(b->session);
+
+	if (b->o)
+		sr_output_free(b->o);
+	b->o = NULL;
+}
+
+static void bench_demo(struct sr_context *ctx)
+{
+	struct sr_dev_driver **drivers, *driver;
+	const struct sr_output_module **omods;
+	const struct sr_output *o;
+	struct demo b;
+	GSList *devices;
+	char name[64];
+	int i;
+
+	driver = NULL;
+	drivers = sr_driver_list(ctx);
+	for (i = 0; drivers && drivers[i]; i++) {
+		if (!strcmp(drivers[i]->name, "demo"))
+			driver = drivers[i];
+	}
+	if (!driver || sr_driver_init(ctx, driver) != SR_OK)
+		return;
+	if (!(devices = sr_driver_scan(driver, NULL)))
+		return;
+
+	b.sdi = devices->data;
+	g_slist_free(devices);
+	if (sr_dev_open(b.sdi) != SR_OK)
+		return;
+	sr_config_set(b.sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(DEMO_SAMPLERATE));
+	sr_config_set(b.sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(DEMO_SAMPLES));
+	sr_config_set(b.sdi, NULL, SR_CONF_UNTHROTTLED,
+		g_variant_new_boolean(TRUE));
+
+	sr_session_new(ctx, &b.session);
+	sr_session_dev_add(b.session, b.sdi);
+	sr_session_datafeed_callback_add(b.session, demo_datafeed, &b);
+
+	/* The cost of generating the data, with no output. */
+	b.omod = NULL;
+	bench_run("demo.none", DEMO_SAMPLES, 0, run_demo, &b);
+
+	omods = sr_output_list();
+	for (i = 0; omods[i]; i++) {
+		g_snprintf(name, sizeof(name), "demo.output.%s",
+			sr_output_id_get(omods[i]));
+		if (!bench_wanted(name))
+			continue;
+		/* Modules which need a file can't be used here. */
+		if (!(o = sr_output_new(omods[i], NULL, b.sdi, NULL)))
+			continue;
+		sr_output_free(o);
+
+		b.omod = omods[i];
+		bench_run(name, DEMO_SAMPLES, 0, run_demo, &b);
+	}
+
+	sr_session_destroy(b.session);
+	sr_dev_close(b.sdi);
+}
+
+static void run_session(void *data)
+{
+	struct sr_session *session = data;
+
+	if (sr_session_start(session) == SR_OK)
+		sr_session_run(session);
+}
+
+/* Many demo devices with wide logic buses and many analog channels. */
+static void bench_demo_topology(struct sr_context *ctx)
+{
+	struct sr_dev_driver *driver;
+	struct sr_session *session;
+	struct sr_config cfg[3];
+	GSList *options, *devices, *l;
+	int i;
+
+	if (!bench_wanted("demo.topology"))
+		return;
+	if (!(driver = sr_driver_get(ctx, "demo"))
+			|| sr_driver_init(ctx, driver) != SR_OK)
+		return;
+
+	cfg[0].key = SR_CONF_NUM_DEVICES;
+	cfg[0].data = g_variant_new_uint64(TOPOLOGY_DEVICES);
+	cfg[1].key = SR_CONF_NUM_LOGIC_CHANNELS;
+	cfg[1].data = g_variant_new_int32(TOPOLOGY_LOGIC);
+	cfg[2].key = SR_CONF_NUM_ANALOG_CHANNELS;
+	cfg[2].data = g_variant_new_int32(TOPOLOGY_ANALOG);
+	options = NULL;
+	for (i = 0; i < 3; i++) {
+		g_variant_ref_sink(cfg[i].data);
+		options = g_slist_append(options, &cfg[i]);
+	}
+	devices = sr_driver_scan(driver, options);
+	g_slist_free(options);
+	for (i = 0; i < 3; i++)
+		g_variant_unref(cfg[i].data);
+	if (!devices)
+		return;
+
+	sr_session_new(ctx, &session);
+	for (l = devices; l; l = l->next) {
+		if (sr_dev_open(l->data) != SR_OK)
+			continue;
+		sr_config_set(l->data, NULL, SR_CONF_SAMPLERATE,
+			g_variant_new_uint64(DEMO_SAMPLERATE));
+		sr_config_set(l->data, NULL, SR_CONF_LIMIT_SAMPLES,
+			g_variant_new_uint64(TOPOLOGY_SAMPLES));
+		sr_config_set(l->data, NULL, SR_CONF_UNTHROTTLED,
+			g_variant_new_boolean(TRUE));
+		sr_session_dev_add(session, l->data);
+	}
+
+	bench_run("demo.topology", TOPOLOGY_DEVICES * TOPOLOGY_SAMPLES, 0,
+		run_session, session);
+
+	sr_session_destroy(session);
+	sr_dev_close_many(devices, NULL);
+	g_slist_free(devices);
+}
+
+int main(int argc, char **argv)
+{
+	struct sr_context *ctx;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ach;
+	struct sr_datafeed_packet logic_packet;
+	struct sr_datafeed_logic logic;
+	struct analog_packet analog;
+	GSList *analog_channels;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+			min_time_us = g_ascii_strtod(argv[++i], NULL) * 1e6;
+		} else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+			if (!g_file_get_contents(argv[++i],
+					(gchar **)&replay_data, &replay_len,
+					NULL)) {
+				fprintf(stderr, "Cannot read %s.\n", argv[i]);
+				return 1;
+			}
+		} else {
+			filters = &argv[i];
+			num_filters = argc - i;
+			break;
+		}
+	}
+
+	if (sr_init(&ctx) != SR_OK)
+		return 1;
+	sr_log_loglevel_set(SR_LOG_ERR);
+
+	sr_session_new(ctx, &session);
+	sdi = bench_dev_new(session, "bench", NUM_LOGIC_CHANNELS,
+		NUM_ANALOG_CHANNELS);
+	ach = g_slist_nth_data(sdi->channels, NUM_LOGIC_CHANNELS);
+
+	fill_data();
+
+	logic.length = BENCH_SAMPLES;
+	logic.unitsize = 1;
+	logic.data = logic_data;
+	logic_packet.type = SR_DF_LOGIC;
+	logic_packet.payload = &logic;
+
+	analog_channels = g_slist_append(NULL, ach);
+	analog_packet_init(&analog, analog_channels);
+
+	printf("name,iterations,samples,ns_per_sample,samples_per_s,"
+		"mb_per_s,alloc_bytes,allocs,peak_bytes\n");
+
+	bench_analog_to_float();
+	bench_a2l();
+	bench_soft_trigger(sdi);
+	bench_feed_queue(sdi, ach);
+	bench_transforms(sdi, &logic_packet, &analog.packet);
+	bench_outputs(sdi, &logic_packet, &analog.packet);
+	bench_inputs(session);
+	bench_demo(ctx);
+	bench_demo_topology(ctx);
+#ifdef HAVE_HW_DREAMSOURCELAB_DSLOGIC
+	bench_dslogic(session);
+#endif
+#ifdef HAVE_HW_FX2LAFW
+	bench_fx2lafw(session);
+#endif
+#ifdef HAVE_HW_SALEAE_LOGIC16
+	bench_saleae_logic16(session);
+#endif
+#ifdef HAVE_HW_SALEAE_LOGIC_PRO
+	bench_saleae_logic_pro(session);
+#endif
+
+	g_slist_free(analog_channels);
+	sr_session_destroy(session);
+	sr_dev_inst_free(sdi);
+	sr_exit(ctx);
+	g_free(replay_data);
+
+	return 0;
+}
@@ -0,0 +1,44 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBSIGROK_TESTS_BENCH_H
+#define LIBSIGROK_TESTS_BENCH_H
+
+#include <stdint.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+
+typedef void (*bench_fn)(void *data);
+
+extern uint64_t bench_bytes;
+
+gboolean bench_wanted(const char *name);
+void bench_run(const char *name, uint64_t samples,
+		uint64_t max_samples, bench_fn fn, void *data);
+struct sr_dev_inst *bench_dev_new(struct sr_session *session,
+		const char *model, int num_logic, int num_analog);
+const uint8_t *bench_payload(size_t *len);
+
+/* Replay of USB transfer payloads into drivers' conversion routines. */
+void bench_dslogic(struct sr_session *session);
+void bench_fx2lafw(struct sr_session *session);
+void bench_saleae_logic16(struct sr_session *session);
+void bench_saleae_logic_pro(struct sr_session *session);
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "hardware/dreamsourcelab-dslogic/protocol.h"
+#include "bench.h"
+
+struct deinterleave {
+	const uint8_t *src;
+	size_t length;
+	uint16_t *dst;
+	size_t channel_count;
+	uint16_t channel_mask;
+};
+
+static void run_deinterleave(void *data)
+{
+	struct deinterleave *b = data;
+
+	dslogic_deinterleave_buffer(b->src, b->length, b->dst,
+		b->channel_count, b->channel_mask);
+}
+
+void bench_dslogic(struct sr_session *session)
+{
+	/* All channels, the low byte, and a sparse set of channels. */
+	static const struct {
+		size_t count;
+		uint16_t mask;
+	} channels[] = {
+		{ 16, 0xffff },
+		{ 8, 0x00ff },
+		{ 6, 0x0a53 },
+	};
+	struct deinterleave b;
+	size_t len, i, block, samples;
+	char name[64];
+
+	(void)session;
+
+	b.src = bench_payload(&len);
+	for (i = 0; i < G_N_ELEMENTS(channels); i++) {
+		b.channel_count = channels[i].count;
+		b.channel_mask = channels[i].mask;
+
+		/* 64 samples of every enabled channel per block. */
+		block = b.channel_count * sizeof(uint64_t);
+		b.length = len / block * block;
+		samples = 64 * (b.length / block);
+		if (!samples)
+			continue;
+
+		b.dst = g_malloc(samples * sizeof(uint16_t));
+		g_snprintf(name, sizeof(name),
+			"driver.dslogic.deinterleave.%04x", b.channel_mask);
+		bench_run(name, samples, 0, run_deinterleave, &b);
+		g_free(b.dst);
+	}
+}
@@ -0,0 +1,73 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "hardware/fx2lafw/protocol.h"
+#include "bench.h"
+
+/* Replay the payload in transfers of this size. */
+#define TRANSFER_SIZE	(16 * 1024)
+
+struct mso {
+	struct sr_dev_inst *sdi;
+	uint8_t *data;
+	size_t length;
+};
+
+static void run_mso_send_data(void *data)
+{
+	struct mso *b = data;
+	size_t pos, len;
+
+	for (pos = 0; pos < b->length; pos += len) {
+		len = MIN(TRANSFER_SIZE, b->length - pos);
+		fx2lafw_mso_send_data_proc(b->sdi, b->data + pos, len, 2);
+	}
+}
+
+void bench_fx2lafw(struct sr_session *session)
+{
+	struct dev_context *devc;
+	const uint8_t *payload;
+	struct mso b;
+	size_t len;
+
+	/* Interleaved bytes of 8 logic channels and one analog channel. */
+	payload = bench_payload(&len);
+	b.length = len / 2 * 2;
+	if (!b.length)
+		return;
+	b.data = (uint8_t *)payload;
+
+	b.sdi = bench_dev_new(session, "fx2lafw", 8, 1);
+	b.sdi->priv = devc = g_malloc0(sizeof(*devc));
+	devc->enabled_analog_channels = g_slist_append(NULL,
+		g_slist_nth_data(b.sdi->channels, 8));
+	devc->logic_buffer = g_malloc(TRANSFER_SIZE / 2);
+	devc->analog_buffer = g_malloc(TRANSFER_SIZE / 2);
+
+	bench_run("driver.fx2lafw.mso_send_data", b.length / 2, 0,
+		run_mso_send_data, &b);
+
+	g_free(devc->analog_buffer);
+	g_free(devc->logic_buffer);
+	g_slist_free(devc->enabled_analog_channels);
+	g_free(devc);
+	sr_dev_inst_free(b.sdi);
+}
@@ -0,0 +1,83 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "hardware/saleae-logic16/protocol.h"
+#include "bench.h"
+
+/* Replay the payload in transfers of this size. */
+#define TRANSFER_SIZE	(16 * 1024)
+
+struct convert {
+	struct dev_context *devc;
+	const uint8_t *data;
+	size_t length;
+	uint8_t *dest;
+	size_t destcnt;
+};
+
+static void run_convert(void *data)
+{
+	struct convert *b = data;
+	size_t pos, len;
+
+	for (pos = 0; pos < b->length; pos += len) {
+		len = MIN(TRANSFER_SIZE, b->length - pos);
+		logic16_convert_sample_data(b->devc, b->dest, b->destcnt,
+			b->data + pos, len);
+	}
+}
+
+void bench_saleae_logic16(struct sr_session *session)
+{
+	static const int channel_counts[] = { 16, 8, 3 };
+	struct sr_dev_inst *sdi;
+	struct convert b;
+	GSList *l;
+	size_t i;
+	int n;
+	char name[64];
+
+	b.data = bench_payload(&b.length);
+	b.length &= ~1;
+
+	/* Every word in the transfer holds 16 samples of one channel. */
+	b.destcnt = (TRANSFER_SIZE / 2 + 16) * 16 * sizeof(uint16_t);
+	b.dest = g_malloc(b.destcnt);
+
+	for (i = 0; i < G_N_ELEMENTS(channel_counts); i++) {
+		sdi = bench_dev_new(session, "logic16", 16, 0);
+		n = 0;
+		for (l = sdi->channels; l; l = l->next)
+			sr_dev_channel_enable(l->data,
+				n++ < channel_counts[i]);
+		sdi->priv = b.devc = g_malloc0(sizeof(*b.devc));
+		logic16_configure_channels(sdi);
+
+		g_snprintf(name, sizeof(name),
+			"driver.saleae-logic16.convert.%dch", channel_counts[i]);
+		bench_run(name, b.length / 2 / channel_counts[i] * 16, 0,
+			run_convert, &b);
+
+		g_free(b.devc);
+		sr_dev_inst_free(sdi);
+	}
+
+	g_free(b.dest);
+}
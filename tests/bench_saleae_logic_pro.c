@@ -0,0 +1,83 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include "hardware/saleae-logic-pro/protocol.h"
+#include "bench.h"
+
+/* The driver always converts transfers of this size. */
+#define TRANSFER_SIZE	(16 * 1024)
+
+struct convert {
+	struct sr_dev_inst *sdi;
+	const uint8_t *data;
+	size_t length;
+};
+
+static void run_convert(void *data)
+{
+	struct convert *b = data;
+	size_t pos;
+
+	for (pos = 0; pos + TRANSFER_SIZE <= b->length; pos += TRANSFER_SIZE)
+		saleae_logic_pro_convert_data(b->sdi,
+			(const uint32_t *)(b->data + pos), TRANSFER_SIZE / 4);
+}
+
+void bench_saleae_logic_pro(struct sr_session *session)
+{
+	static const unsigned int channel_counts[] = { 16, 8, 4 };
+	struct dev_context *devc;
+	struct convert b;
+	unsigned int i, k;
+	char name[64];
+
+	b.data = bench_payload(&b.length);
+	b.length = b.length / TRANSFER_SIZE * TRANSFER_SIZE;
+	if (!b.length)
+		return;
+
+	b.sdi = bench_dev_new(session, "logic-pro", 16, 0);
+	b.sdi->priv = devc = g_malloc0(sizeof(*devc));
+	devc->conv_buffer = g_malloc(CONV_BUFFER_SIZE);
+
+	for (i = 0; i < G_N_ELEMENTS(channel_counts); i++) {
+		/* Like configure_channels() with the first channels enabled. */
+		devc->dig_channel_cnt = channel_counts[i];
+		devc->dig_channel_mask = 0;
+		for (k = 0; k < channel_counts[i]; k++) {
+			devc->dig_channel_masks[k] = 1 << k;
+			devc->dig_channel_mask |= 1 << k;
+		}
+		devc->batch_index = 0;
+		memset(devc->conv_lo, 0, sizeof(devc->conv_lo));
+		memset(devc->conv_hi, 0, sizeof(devc->conv_hi));
+
+		/* One word per channel for every 32 samples. */
+		g_snprintf(name, sizeof(name),
+			"driver.saleae-logic-pro.convert.%uch", channel_counts[i]);
+		bench_run(name, b.length / 4 / channel_counts[i] * 32, 0,
+			run_convert, &b);
+	}
+
+	g_free(devc->conv_buffer);
+	g_free(devc);
+	sr_dev_inst_free(b.sdi);
+}
@@ -231,6 +231,179 @@ START_TEST(test_endian_write_inc)
 }
 END_TEST
 
+START_TEST(test_logic_rle_roundtrip)
+{
+	static const uint8_t samples[] = {
+		0x01, 0x00, 0x01, 0x00, 0x01, 0x00, 0x02, 0x80,
+		0x02, 0x80, 0x01, 0x00,
+	};
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_rle *rle;
+	uint8_t buff[sizeof(samples)];
+	int ret;
+
+	logic.length = sizeof(samples);
+	logic.unitsize = 2;
+	logic.data = (void *)samples;
+	ret = sr_logic_rle_encode(&logic, &rle);
+	fail_unless(ret == SR_OK);
+	fail_unless(rle->unitsize == 2);
+	fail_unless(rle->num_runs == 3);
+	fail_unless(rle->lengths[0] == 3);
+	fail_unless(rle->lengths[1] == 2);
+	fail_unless(rle->lengths[2] == 1);
+	fail_unless(sr_logic_rle_num_samples(rle) == 6);
+
+	memset(buff, 0, sizeof(buff));
+	ret = sr_logic_rle_decode(rle, buff);
+	fail_unless(ret == SR_OK);
+	fail_unless(memcmp(buff, samples, sizeof(samples)) == 0);
+	sr_logic_rle_free(rle);
+}
+END_TEST
+
+START_TEST(test_logic_rle_empty)
+{
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_rle *rle;
+	int ret;
+
+	logic.length = 0;
+	logic.unitsize = 1;
+	logic.data = NULL;
+	ret = sr_logic_rle_encode(&logic, &rle);
+	fail_unless(ret == SR_OK);
+	fail_unless(rle->num_runs == 0);
+	fail_unless(sr_logic_rle_num_samples(rle) == 0);
+	sr_logic_rle_free(rle);
+
+	logic.unitsize = 0;
+	ret = sr_logic_rle_encode(&logic, &rle);
+	fail_unless(ret == SR_ERR_ARG);
+}
+END_TEST
+
+START_TEST(test_logic_planar_roundtrip)
+{
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_planar *planar;
+	uint8_t samples[3 * 75], buff[sizeof(samples)];
+	const uint8_t *plane;
+	unsigned int i, ch;
+	int ret;
+
+	for (i = 0; i < sizeof(samples); i++)
+		samples[i] = i * 37 + (i >> 3);
+	logic.length = sizeof(samples);
+	logic.unitsize = 3;
+	logic.data = samples;
+	ret = sr_logic_planar_encode(&logic, &planar);
+	fail_unless(ret == SR_OK);
+	fail_unless(planar->unitsize == 3);
+	fail_unless(planar->num_samples == 75);
+	fail_unless(planar->stride % 8 == 0);
+	fail_unless(planar->stride >= (75 + 7) / 8);
+
+	for (ch = 0; ch < 3 * 8; ch++) {
+		plane = sr_logic_planar_plane(planar, ch);
+		fail_unless(plane != NULL);
+		for (i = 0; i < 75; i++)
+			fail_unless(((plane[i / 8] >> (i % 8)) & 1)
+				== ((samples[i * 3 + ch / 8] >> (ch % 8)) & 1),
+				"Wrong bit of channel %u, sample %u.", ch, i);
+	}
+	fail_unless(sr_logic_planar_plane(planar, 3 * 8) == NULL);
+
+	memset(buff, 0, sizeof(buff));
+	ret = sr_logic_planar_decode(planar, buff);
+	fail_unless(ret == SR_OK);
+	fail_unless(memcmp(buff, samples, sizeof(samples)) == 0);
+	sr_logic_planar_free(planar);
+}
+END_TEST
+
+START_TEST(test_logic_planar_empty)
+{
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_logic_planar *planar;
+	uint8_t buff[1];
+	int ret;
+
+	logic.length = 0;
+	logic.unitsize = 1;
+	logic.data = NULL;
+	ret = sr_logic_planar_encode(&logic, &planar);
+	fail_unless(ret == SR_OK);
+	fail_unless(planar->num_samples == 0);
+	fail_unless(sr_logic_planar_decode(planar, buff) == SR_OK);
+	fail_unless(sr_logic_planar_decode(planar, NULL) == SR_ERR_ARG);
+	sr_logic_planar_free(planar);
+
+	logic.unitsize = 0;
+	ret = sr_logic_planar_encode(&logic, &planar);
+	fail_unless(ret == SR_ERR_ARG);
+	fail_unless(sr_logic_planar_plane(NULL, 0) == NULL);
+}
+END_TEST
+
+START_TEST(test_a2l_multi)
+{
+	static const float in0[] = { 0.0, 2.0, 1.0, 0.4, 3.0, };
+	static const float in1[] = { 3.0, 1.0, 0.2, 1.0, 2.5, };
+	static const float lo[] = { 0.5, 0.5, };
+	static const float hi[] = { 1.5, 1.5, };
+	static const uint8_t want_thr[] = { 0x02, 0x01, 0x00, 0x00, 0x03, };
+	static const uint8_t want_st[] = { 0x02, 0x03, 0x01, 0x00, 0x03, };
+	const struct sr_datafeed_analog *analogs[2];
+	struct sr_datafeed_analog analog[2];
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_datafeed_logic logic;
+	struct sr_channel ch;
+	uint8_t out[ARRAY_SIZE(in0)], state[2];
+	int ret;
+
+	memset(&encoding, 0, sizeof(encoding));
+	encoding.unitsize = sizeof(float);
+	encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	encoding.is_bigendian = TRUE;
+#endif
+	encoding.scale.p = encoding.scale.q = 1;
+	encoding.offset.q = 1;
+	memset(&meaning, 0, sizeof(meaning));
+	meaning.channels = g_slist_append(NULL, &ch);
+	memset(analog, 0, sizeof(analog));
+	analog[0].data = (void *)in0;
+	analog[1].data = (void *)in1;
+	analog[0].num_samples = analog[1].num_samples = ARRAY_SIZE(in0);
+	analog[0].encoding = analog[1].encoding = &encoding;
+	analog[0].meaning = analog[1].meaning = &meaning;
+	analogs[0] = &analog[0];
+	analogs[1] = &analog[1];
+
+	logic.unitsize = 1;
+	logic.data = out;
+	ret = sr_a2l_threshold_multi(analogs, 2, hi, &logic);
+	fail_unless(ret == SR_OK);
+	fail_unless(logic.length == sizeof(out));
+	fail_unless(memcmp(out, want_thr, sizeof(out)) == 0);
+
+	state[0] = state[1] = 0;
+	ret = sr_a2l_schmitt_trigger_multi(analogs, 2, lo, hi, state, &logic);
+	fail_unless(ret == SR_OK);
+	fail_unless(memcmp(out, want_st, sizeof(out)) == 0);
+	fail_unless(state[0] == 1 && state[1] == 1);
+
+	/* Two channels don't fit into zero bits. */
+	logic.unitsize = 0;
+	ret = sr_a2l_threshold_multi(analogs, 2, hi, &logic);
+	fail_unless(ret == SR_ERR_ARG);
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
 Suite *suite_conv(void)
 {
 	Suite *s;
@@ -246,5 +419,19 @@ Suite *suite_conv(void)
 	tcase_add_test(tc, test_endian_write_inc);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("logic_rle");
+	tcase_add_test(tc, test_logic_rle_roundtrip);
+	tcase_add_test(tc, test_logic_rle_empty);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("logic_planar");
+	tcase_add_test(tc, test_logic_planar_roundtrip);
+	tcase_add_test(tc, test_logic_planar_empty);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("a2l");
+	tcase_add_test(tc, test_a2l_multi);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
@@ -0,0 +1,166 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <check.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+#define DATA_SIZE (100 * 1000)
+
+static char *write_file(uint8_t *data, size_t len)
+{
+	char *filename;
+	size_t i;
+	int fd;
+
+	for (i = 0; i < len; i++)
+		data[i] = i * 7;
+	fd = g_file_open_tmp(NULL, &filename, NULL);
+	fail_unless(fd >= 0, "Failed to create temporary file.");
+	fail_unless(write(fd, data, len) == (ssize_t)len);
+	close(fd);
+
+	return filename;
+}
+
+static void progress_cb(const struct sr_convert_progress *progress,
+		void *cb_data)
+{
+	struct sr_convert_progress *last;
+
+	last = cb_data;
+	fail_unless(!last->done, "Progress reported after the end.");
+	fail_unless(progress->bytes_read <= progress->bytes_total);
+	*last = *progress;
+}
+
+/* Convert a file through a transform, into two outputs. */
+START_TEST(test_convert_binary)
+{
+	const struct sr_input *in;
+	struct sr_convert *conv;
+	struct sr_convert_progress progress, last;
+	struct sr_output_sink *sink1, *sink2;
+	uint8_t *data;
+	const uint8_t *buf;
+	char *filename;
+	size_t i, len;
+	int ret;
+
+	data = g_malloc(DATA_SIZE);
+	filename = write_file(data, DATA_SIZE);
+
+	in = sr_input_new(sr_input_find("binary"), NULL);
+	fail_unless(in != NULL, "Failed to create input instance.");
+	sink1 = sr_output_sink_new_buffer();
+	sink2 = sr_output_sink_new_buffer();
+
+	fail_unless(sr_convert_new(srtest_ctx, in, &conv) == SR_OK);
+	fail_unless(sr_convert_transform_add(conv,
+		sr_transform_find("invert"), NULL) == SR_OK);
+	fail_unless(sr_convert_output_add(conv, sr_output_find("binary"),
+		NULL, NULL, sink1) == SR_OK);
+	fail_unless(sr_convert_output_add(conv, sr_output_find("binary"),
+		NULL, NULL, sink2) == SR_OK);
+	fail_unless(sr_convert_queue_depth_set(conv, 2) == SR_OK);
+	memset(&last, 0, sizeof(last));
+	fail_unless(sr_convert_progress_callback_set(conv,
+		progress_cb, &last) == SR_OK);
+
+	ret = sr_convert_run(conv, filename);
+	fail_unless(ret == SR_OK, "sr_convert_run() error: %d", ret);
+	fail_unless(last.done, "No final progress report.");
+	fail_unless(sr_convert_progress_get(conv, &progress) == SR_OK);
+	fail_unless(progress.done);
+	fail_unless(progress.bytes_read == DATA_SIZE);
+	fail_unless(progress.bytes_total == DATA_SIZE);
+	fail_unless(progress.samples == DATA_SIZE,
+		"Wrong sample count %" PRIu64 ".", progress.samples);
+	fail_unless(progress.packets > 0);
+
+	buf = sr_output_sink_buffer_get(sink1, &len);
+	fail_unless(len == DATA_SIZE, "Wrong output length %zu.", len);
+	for (i = 0; i < len; i++)
+		fail_unless(buf[i] == (uint8_t)~data[i]);
+	buf = sr_output_sink_buffer_get(sink2, &len);
+	fail_unless(len == DATA_SIZE, "Wrong output length %zu.", len);
+	for (i = 0; i < len; i++)
+		fail_unless(buf[i] == (uint8_t)~data[i]);
+
+	sr_convert_free(conv);
+	sr_output_sink_free(sink1);
+	sr_output_sink_free(sink2);
+	sr_input_free(in);
+	g_unlink(filename);
+	g_free(filename);
+	g_free(data);
+}
+END_TEST
+
+/* Check the errors of conversions which cannot run. */
+START_TEST(test_convert_errors)
+{
+	const struct sr_input *in;
+	struct sr_convert *conv;
+	struct sr_output_sink *sink;
+
+	in = sr_input_new(sr_input_find("binary"), NULL);
+	fail_unless(in != NULL, "Failed to create input instance.");
+	sink = sr_output_sink_new_buffer();
+
+	fail_unless(sr_convert_new(NULL, in, &conv) == SR_ERR_ARG);
+	fail_unless(sr_convert_new(srtest_ctx, NULL, &conv) == SR_ERR_ARG);
+	fail_unless(sr_convert_new(srtest_ctx, in, &conv) == SR_OK);
+	fail_unless(sr_convert_wait(conv) == SR_ERR_ARG);
+	fail_unless(sr_convert_start(conv, "nonexistent") == SR_ERR_ARG,
+		"Started a conversion without outputs.");
+
+	fail_unless(sr_convert_output_add(conv, sr_output_find("binary"),
+		NULL, NULL, sink) == SR_OK);
+	fail_unless(sr_convert_start(conv, "/nonexistent/file") == SR_OK);
+	fail_unless(sr_convert_start(conv, "/nonexistent/file") == SR_ERR);
+	fail_unless(sr_convert_output_add(conv, sr_output_find("binary"),
+		NULL, NULL, sink) == SR_ERR);
+	fail_unless(sr_convert_wait(conv) == SR_ERR_IO);
+	sr_convert_free(conv);
+
+	sr_output_sink_free(sink);
+	sr_input_free(in);
+}
+END_TEST
+
+Suite *suite_convert(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("convert");
+
+	tc = tcase_create("basic");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_convert_binary);
+	tcase_add_test(tc, test_convert_errors);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
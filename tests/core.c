@@ -20,6 +20,7 @@
 #include <config.h>
 #include <stdlib.h>
 #include <check.h>
+#include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
 
@@ -162,6 +163,162 @@ START_TEST(test_exit_null)
 }
 END_TEST
 
+/* Check whether the asynchronous logging mode can be used and stopped. */
+START_TEST(test_log_async)
+{
+	int ret;
+	struct sr_context *sr_ctx;
+
+	ret = sr_log_async_set(TRUE);
+	fail_unless(ret == SR_OK, "sr_log_async_set(TRUE) failed: %d.", ret);
+	ret = sr_log_async_set(TRUE);
+	fail_unless(ret == SR_OK, "sr_log_async_set(TRUE) 2 failed: %d.", ret);
+
+	ret = sr_init(&sr_ctx);
+	fail_unless(ret == SR_OK, "sr_init() failed: %d.", ret);
+	ret = sr_exit(sr_ctx);
+	fail_unless(ret == SR_OK, "sr_exit() failed: %d.", ret);
+
+	ret = sr_log_async_set(FALSE);
+	fail_unless(ret == SR_OK, "sr_log_async_set(FALSE) failed: %d.", ret);
+	ret = sr_log_async_set(FALSE);
+	fail_unless(ret == SR_OK, "sr_log_async_set(FALSE) 2 failed: %d.", ret);
+}
+END_TEST
+
+/* Check whether module loglevels can be set, read back and dropped. */
+START_TEST(test_log_module_level)
+{
+	int ret;
+
+	ret = sr_log_loglevel_set(SR_LOG_WARN);
+	fail_unless(ret == SR_OK, "sr_log_loglevel_set() failed: %d.", ret);
+
+	ret = sr_log_loglevel_set_module("session", SR_LOG_SPEW);
+	fail_unless(ret == SR_OK, "Setting the module loglevel failed: %d.", ret);
+	ret = sr_log_loglevel_get_module("session");
+	fail_unless(ret == SR_LOG_SPEW, "Wrong module loglevel: %d.", ret);
+	ret = sr_log_loglevel_get_module("hwdriver");
+	fail_unless(ret == SR_LOG_WARN, "Wrong global loglevel: %d.", ret);
+
+	ret = sr_log_loglevel_set_module("session", -1);
+	fail_unless(ret == SR_OK, "Dropping the module loglevel failed: %d.", ret);
+	ret = sr_log_loglevel_get_module("session");
+	fail_unless(ret == SR_LOG_WARN, "Module loglevel not dropped: %d.", ret);
+
+	ret = sr_log_loglevel_set_module(NULL, SR_LOG_DBG);
+	fail_unless(ret == SR_ERR_ARG, "NULL module accepted.");
+	ret = sr_log_loglevel_set_module("session", SR_LOG_SPEW + 1);
+	fail_unless(ret == SR_ERR_ARG, "Invalid loglevel accepted.");
+	ret = sr_log_ratelimit_set(-1);
+	fail_unless(ret == SR_ERR_ARG, "Invalid rate limit accepted.");
+}
+END_TEST
+
+/* Check whether the memory budget can be set and read back. */
+START_TEST(test_memory_budget)
+{
+	int ret;
+	uint64_t bytes, used;
+	struct sr_context *sr_ctx;
+
+	ret = sr_init(&sr_ctx);
+	fail_unless(ret == SR_OK, "sr_init() failed: %d.", ret);
+
+	ret = sr_memory_budget_get(sr_ctx, &bytes, &used);
+	fail_unless(ret == SR_OK, "sr_memory_budget_get() failed: %d.", ret);
+	fail_unless(bytes == 0, "Budget not unlimited by default.");
+	fail_unless(used == 0, "Unexpected memory use: %" PRIu64 ".", used);
+
+	ret = sr_memory_budget_set(sr_ctx, 1024 * 1024);
+	fail_unless(ret == SR_OK, "sr_memory_budget_set() failed: %d.", ret);
+	ret = sr_memory_budget_get(sr_ctx, &bytes, NULL);
+	fail_unless(ret == SR_OK, "sr_memory_budget_get() 2 failed: %d.", ret);
+	fail_unless(bytes == 1024 * 1024, "Wrong budget: %" PRIu64 ".", bytes);
+
+	ret = sr_memory_budget_set(NULL, 0);
+	fail_unless(ret == SR_ERR_ARG, "NULL context accepted.");
+	ret = sr_memory_budget_get(NULL, &bytes, &used);
+	fail_unless(ret == SR_ERR_ARG, "NULL context accepted.");
+
+	ret = sr_exit(sr_ctx);
+	fail_unless(ret == SR_OK, "sr_exit() failed: %d.", ret);
+}
+END_TEST
+
+/* Check whether thread placement settings are validated. */
+START_TEST(test_thread_policy)
+{
+	int ret;
+	struct sr_context *sr_ctx;
+
+	ret = sr_init(&sr_ctx);
+	fail_unless(ret == SR_OK, "sr_init() failed: %d.", ret);
+
+	ret = sr_thread_affinity_set(sr_ctx, SR_THREAD_IO, "0-1, 3");
+	fail_unless(ret == SR_OK, "Valid CPU list rejected: %d.", ret);
+	ret = sr_thread_affinity_set(sr_ctx, SR_THREAD_CONSUMER, "2");
+	fail_unless(ret == SR_OK, "Single CPU rejected: %d.", ret);
+	ret = sr_thread_affinity_set(sr_ctx, SR_THREAD_IO, "3-1");
+	fail_unless(ret == SR_ERR_ARG, "Reversed range accepted.");
+	ret = sr_thread_affinity_set(sr_ctx, SR_THREAD_IO, "0,x");
+	fail_unless(ret == SR_ERR_ARG, "Bogus CPU accepted.");
+	ret = sr_thread_affinity_set(sr_ctx, SR_THREAD_IO, NULL);
+	fail_unless(ret == SR_OK, "Dropping the CPU list failed: %d.", ret);
+
+	ret = sr_thread_priority_set(sr_ctx, SR_THREAD_IO,
+		SR_THREAD_SCHED_FIFO, 10);
+	fail_unless(ret == SR_OK, "sr_thread_priority_set() failed: %d.", ret);
+	ret = sr_thread_priority_set(sr_ctx, SR_THREAD_IO, 42, 10);
+	fail_unless(ret == SR_ERR_ARG, "Bogus policy accepted.");
+	ret = sr_thread_priority_set(sr_ctx, 42, SR_THREAD_SCHED_RR, 10);
+	fail_unless(ret == SR_ERR_ARG, "Bogus role accepted.");
+	ret = sr_thread_numa_local_set(NULL, TRUE);
+	fail_unless(ret == SR_ERR_ARG, "NULL context accepted.");
+
+	ret = sr_exit(sr_ctx);
+	fail_unless(ret == SR_OK, "sr_exit() failed: %d.", ret);
+}
+END_TEST
+
+/* Check whether firmware files can be preloaded, and only existing ones. */
+START_TEST(test_resource_preload)
+{
+	int ret;
+	struct sr_context *sr_ctx;
+	gchar *dir, *filename;
+
+	dir = g_dir_make_tmp("sigrok-test-XXXXXX", NULL);
+	fail_unless(dir != NULL, "Failed to create a directory.");
+	filename = g_build_filename(dir, "test.bitstream", NULL);
+	fail_unless(g_file_set_contents(filename, "\x01\x02\x03", 3, NULL),
+		"Failed to write '%s'.", filename);
+	g_setenv("SIGROK_FIRMWARE_DIR", dir, TRUE);
+
+	ret = sr_init(&sr_ctx);
+	fail_unless(ret == SR_OK, "sr_init() failed: %d.", ret);
+
+	ret = sr_resource_preload(sr_ctx, SR_RESOURCE_FIRMWARE, "test.bitstream");
+	fail_unless(ret == SR_OK, "sr_resource_preload() failed: %d.", ret);
+	/* The cached copy stays valid without the file. */
+	g_remove(filename);
+	ret = sr_resource_preload(sr_ctx, SR_RESOURCE_FIRMWARE, "test.bitstream");
+	fail_unless(ret == SR_OK, "Cached resource not found: %d.", ret);
+	ret = sr_resource_preload(sr_ctx, SR_RESOURCE_FIRMWARE, "missing.bitstream");
+	fail_unless(ret == SR_ERR, "Missing resource loaded: %d.", ret);
+	ret = sr_resource_preload(sr_ctx, SR_RESOURCE_FIRMWARE, NULL);
+	fail_unless(ret == SR_ERR_ARG, "NULL name accepted.");
+
+	ret = sr_exit(sr_ctx);
+	fail_unless(ret == SR_OK, "sr_exit() failed: %d.", ret);
+
+	g_unsetenv("SIGROK_FIRMWARE_DIR");
+	g_rmdir(dir);
+	g_free(filename);
+	g_free(dir);
+}
+END_TEST
+
 Suite *suite_core(void)
 {
 	Suite *s;
@@ -179,5 +336,13 @@ Suite *suite_core(void)
 	tcase_add_test(tc, test_exit_null);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("log");
+	tcase_add_test(tc, test_log_async);
+	tcase_add_test(tc, test_log_module_level);
+	tcase_add_test(tc, test_memory_budget);
+	tcase_add_test(tc, test_thread_policy);
+	tcase_add_test(tc, test_resource_preload);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
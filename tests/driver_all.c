@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -40,6 +41,389 @@ START_TEST(test_driver_init_all)
 }
 END_TEST
 
+/* Check whether restricting the driver list works. */
+START_TEST(test_driver_list_select)
+{
+	struct sr_dev_driver **drivers;
+	const char *names[] = { "no-such-driver", NULL };
+	int ret;
+
+	ret = sr_driver_list_select(srtest_ctx, names);
+	fail_unless(ret == SR_OK, "Failed to select drivers: %d.", ret);
+	drivers = sr_driver_list(srtest_ctx);
+	fail_unless(drivers && !drivers[0], "Unknown driver in the list.");
+	fail_unless(!sr_driver_get(srtest_ctx, names[0]), "Unknown driver found.");
+
+	ret = sr_driver_list_select(srtest_ctx, NULL);
+	fail_unless(ret == SR_OK, "Failed to select all drivers: %d.", ret);
+	drivers = sr_driver_list(srtest_ctx);
+	fail_unless(drivers && drivers[0], "No drivers found.");
+}
+END_TEST
+
+static void scan_count_cb(struct sr_dev_driver *driver, GSList *devices,
+		void *cb_data)
+{
+	(void)driver;
+
+	g_slist_free(devices);
+	(*(int *)cb_data)++;
+}
+
+/* Check whether sr_driver_scan_all() rejects invalid arguments. */
+START_TEST(test_driver_scan_all_args)
+{
+	struct sr_dev_driver **drivers;
+	int ret, count;
+
+	count = 0;
+	drivers = sr_driver_list(srtest_ctx);
+	ret = sr_driver_scan_all(NULL, NULL, scan_count_cb, &count);
+	fail_unless(ret == SR_ERR_ARG, "NULL drivers accepted.");
+	ret = sr_driver_scan_all(drivers, NULL, NULL, NULL);
+	fail_unless(ret == SR_ERR_ARG, "NULL callback accepted.");
+	fail_unless(count == 0, "Callback run for invalid arguments.");
+}
+END_TEST
+
+static uint64_t get_uint64(const struct sr_dev_inst *sdi, uint32_t key)
+{
+	GVariant *gvar;
+	uint64_t value;
+
+	fail_unless(sr_config_get(sr_dev_inst_driver_get(sdi), sdi, NULL,
+		key, &gvar) == SR_OK);
+	value = g_variant_get_uint64(gvar);
+	g_variant_unref(gvar);
+
+	return value;
+}
+
+/*
+ * Check whether a configuration transaction applies all of its changes,
+ * or none of them when one is invalid.
+ */
+START_TEST(test_config_transaction)
+{
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	struct sr_config_transaction *txn;
+	GSList *devlist;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devlist = sr_driver_scan(driver, NULL);
+	fail_unless(devlist != NULL, "No demo device found.");
+	sdi = devlist->data;
+	g_slist_free(devlist);
+	fail_unless(sr_dev_open(sdi) == SR_OK);
+
+	fail_unless(sr_config_transaction_new(NULL) == NULL);
+	txn = sr_config_transaction_new(sdi);
+	fail_unless(txn != NULL);
+
+	fail_unless(sr_config_transaction_set(txn, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_KHZ(10))) == SR_OK);
+	fail_unless(sr_config_transaction_set(txn, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_KHZ(20))) == SR_OK);
+	fail_unless(sr_config_transaction_set(txn, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(1234)) == SR_OK);
+	fail_unless(sr_config_transaction_commit(txn) == SR_OK);
+	fail_unless(get_uint64(sdi, SR_CONF_SAMPLERATE) == SR_KHZ(20));
+	fail_unless(get_uint64(sdi, SR_CONF_LIMIT_SAMPLES) == 1234);
+
+	/* A zero samplerate is rejected, the limit must not change either. */
+	fail_unless(sr_config_transaction_set(txn, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(99)) == SR_OK);
+	fail_unless(sr_config_transaction_set(txn, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(0)) == SR_OK);
+	fail_unless(sr_config_transaction_commit(txn) == SR_ERR_ARG);
+	fail_unless(get_uint64(sdi, SR_CONF_LIMIT_SAMPLES) == 1234);
+
+	/* Wrong value types are rejected as well. */
+	fail_unless(sr_config_transaction_set(txn, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_boolean(TRUE)) == SR_OK);
+	fail_unless(sr_config_transaction_commit(txn) == SR_ERR_ARG);
+
+	/* An empty transaction only commits. */
+	fail_unless(sr_config_transaction_commit(txn) == SR_OK);
+
+	sr_config_transaction_free(txn);
+	sr_dev_close(sdi);
+}
+END_TEST
+
+/* Check whether devices open and close together, with a result each. */
+START_TEST(test_dev_open_many)
+{
+	struct sr_dev_driver *driver;
+	GSList *devlist, *l;
+	int *results;
+	guint i, count;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devlist = sr_driver_scan(driver, NULL);
+	fail_unless(devlist != NULL, "No demo device found.");
+	count = g_slist_length(devlist);
+	results = g_malloc0_n(count + 1, sizeof(*results));
+
+	fail_unless(sr_dev_open_many(devlist, results) == SR_OK);
+	for (l = devlist, i = 0; l; l = l->next, i++) {
+		fail_unless(results[i] == SR_OK);
+		fail_unless(sr_dev_open(l->data) == SR_ERR,
+			"Device was not opened.");
+	}
+
+	/* Open devices can't be opened again, the others don't matter. */
+	devlist = g_slist_append(devlist, NULL);
+	fail_unless(sr_dev_open_many(devlist, results) == SR_ERR);
+	fail_unless(results[count] == SR_ERR_ARG);
+	devlist = g_slist_remove(devlist, NULL);
+
+	fail_unless(sr_dev_close_many(devlist, NULL) == SR_OK);
+	fail_unless(sr_dev_close_many(devlist, results) == SR_ERR_DEV_CLOSED);
+
+	/* NULL arguments, must not segfault. */
+	fail_unless(sr_dev_open_many(NULL, results) == SR_ERR_ARG);
+	fail_unless(sr_dev_close_many(NULL, results) == SR_ERR_ARG);
+
+	g_free(results);
+	g_slist_free(devlist);
+}
+END_TEST
+
+struct notify_count {
+	unsigned int calls;
+	uint64_t samplerate;
+};
+
+static void count_notify(const struct sr_dev_inst *sdi,
+		const struct sr_channel_group *cg, uint32_t key, GVariant *data,
+		void *cb_data)
+{
+	struct notify_count *count;
+
+	(void)sdi;
+	(void)cg;
+
+	count = cb_data;
+	fail_unless(key == SR_CONF_SAMPLERATE);
+	count->calls++;
+	count->samplerate = g_variant_get_uint64(data);
+}
+
+/*
+ * Check whether configuration changes get notified once per change,
+ * and whether the last value is kept.
+ */
+START_TEST(test_config_subscribe)
+{
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	struct notify_count count;
+	GSList *devlist;
+	GVariant *gvar;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devlist = sr_driver_scan(driver, NULL);
+	fail_unless(devlist != NULL, "No demo device found.");
+	sdi = devlist->data;
+	g_slist_free(devlist);
+	fail_unless(sr_dev_open(sdi) == SR_OK);
+
+	memset(&count, 0, sizeof(count));
+	fail_unless(sr_config_subscribe(sdi, SR_CONF_SAMPLERATE,
+		count_notify, &count) == SR_OK);
+
+	fail_unless(sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_KHZ(30))) == SR_OK);
+	fail_unless(count.calls == 1);
+	fail_unless(count.samplerate == SR_KHZ(30));
+
+	/* Neither the same value again nor other keys get notified. */
+	fail_unless(sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_KHZ(30))) == SR_OK);
+	fail_unless(get_uint64(sdi, SR_CONF_SAMPLERATE) == SR_KHZ(30));
+	fail_unless(sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(1000)) == SR_OK);
+	fail_unless(count.calls == 1);
+
+	fail_unless(sr_config_get_cached(sdi, NULL, SR_CONF_SAMPLERATE,
+		&gvar) == SR_OK);
+	fail_unless(g_variant_get_uint64(gvar) == SR_KHZ(30));
+	g_variant_unref(gvar);
+	fail_unless(sr_config_get_cached(sdi, NULL, SR_CONF_CONN,
+		&gvar) == SR_ERR_NA);
+
+	fail_unless(sr_config_unsubscribe(sdi, count_notify, &count) == SR_OK);
+	fail_unless(sr_config_unsubscribe(sdi, count_notify, &count) == SR_ERR_ARG);
+	fail_unless(sr_config_set(sdi, NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_KHZ(40))) == SR_OK);
+	fail_unless(count.calls == 1);
+
+	/* NULL arguments, must not segfault. */
+	fail_unless(sr_config_subscribe(NULL, 0, count_notify, NULL) == SR_ERR_ARG);
+	fail_unless(sr_config_subscribe(sdi, 0, NULL, NULL) == SR_ERR_ARG);
+	fail_unless(sr_config_get_cached(sdi, NULL, SR_CONF_SAMPLERATE,
+		NULL) == SR_ERR_ARG);
+
+	sr_dev_close(sdi);
+}
+END_TEST
+
+/*
+ * Check whether lists of values are cached, until the configuration
+ * changes.
+ */
+START_TEST(test_config_list_cached)
+{
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	GSList *devlist;
+	GVariant *first, *again;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devlist = sr_driver_scan(driver, NULL);
+	fail_unless(devlist != NULL, "No demo device found.");
+	sdi = devlist->data;
+	g_slist_free(devlist);
+	fail_unless(sr_dev_open(sdi) == SR_OK);
+
+	fail_unless(sr_config_list(driver, sdi, NULL, SR_CONF_SAMPLERATE,
+		&first) == SR_OK);
+	fail_unless(sr_config_list(driver, sdi, NULL, SR_CONF_SAMPLERATE,
+		&again) == SR_OK);
+	fail_unless(again == first);
+	g_variant_unref(again);
+
+	/* A change drops the list, the new one has the same content. */
+	fail_unless(sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(1234)) == SR_OK);
+	fail_unless(sr_config_list(driver, sdi, NULL, SR_CONF_SAMPLERATE,
+		&again) == SR_OK);
+	fail_unless(again != first);
+	fail_unless(g_variant_equal(again, first));
+	g_variant_unref(again);
+	g_variant_unref(first);
+
+	sr_dev_close(sdi);
+}
+END_TEST
+
+#define TOPOLOGY_DEVICES	3
+#define TOPOLOGY_LOGIC		96
+#define TOPOLOGY_ANALOG		200
+#define TOPOLOGY_SAMPLES	1000
+
+struct topology_count {
+	struct sr_dev_inst *sdi[TOPOLOGY_DEVICES];
+	uint64_t logic[TOPOLOGY_DEVICES];
+	uint64_t analog[TOPOLOGY_DEVICES];
+};
+
+static void count_topology(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct topology_count *count;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	int i;
+
+	count = cb_data;
+	for (i = 0; i < TOPOLOGY_DEVICES; i++) {
+		if (count->sdi[i] == sdi)
+			break;
+	}
+	fail_unless(i < TOPOLOGY_DEVICES, "Packet of an unknown device.");
+
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		fail_unless(logic->unitsize == (TOPOLOGY_LOGIC + 7) / 8);
+		count->logic[i] += logic->length / logic->unitsize;
+	} else if (packet->type == SR_DF_ANALOG) {
+		analog = packet->payload;
+		fail_unless(g_slist_length(analog->meaning->channels) == 1);
+		count->analog[i] += analog->num_samples;
+	}
+}
+
+/*
+ * Check whether one scan of the demo driver creates several devices
+ * with many channels, whose samplerates can differ, and which run in
+ * one session.
+ */
+START_TEST(test_demo_topology)
+{
+	struct sr_dev_driver *driver;
+	struct sr_session *sess;
+	struct sr_config cfg[4];
+	struct topology_count count;
+	GSList *options, *devlist, *l;
+	int i;
+
+	cfg[0].key = SR_CONF_NUM_DEVICES;
+	cfg[0].data = g_variant_new_uint64(TOPOLOGY_DEVICES);
+	cfg[1].key = SR_CONF_NUM_LOGIC_CHANNELS;
+	cfg[1].data = g_variant_new_int32(TOPOLOGY_LOGIC);
+	cfg[2].key = SR_CONF_NUM_ANALOG_CHANNELS;
+	cfg[2].data = g_variant_new_int32(TOPOLOGY_ANALOG);
+	cfg[3].key = SR_CONF_SAMPLERATE;
+	cfg[3].data = g_variant_new_uint64(SR_KHZ(50));
+	options = NULL;
+	for (i = 0; i < 4; i++) {
+		g_variant_ref_sink(cfg[i].data);
+		options = g_slist_append(options, &cfg[i]);
+	}
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devlist = sr_driver_scan(driver, options);
+	g_slist_free(options);
+	for (i = 0; i < 4; i++)
+		g_variant_unref(cfg[i].data);
+	fail_unless(g_slist_length(devlist) == TOPOLOGY_DEVICES,
+		"Wrong number of demo devices.");
+
+	memset(&count, 0, sizeof(count));
+	sr_session_new(srtest_ctx, &sess);
+	for (l = devlist, i = 0; l; l = l->next, i++) {
+		count.sdi[i] = l->data;
+		fail_unless(g_slist_length(sr_dev_inst_channels_get(l->data))
+			== TOPOLOGY_LOGIC + TOPOLOGY_ANALOG);
+		fail_unless(get_uint64(l->data, SR_CONF_SAMPLERATE) == SR_KHZ(50));
+		fail_unless(sr_dev_open(l->data) == SR_OK);
+		sr_config_set(l->data, NULL, SR_CONF_LIMIT_SAMPLES,
+			g_variant_new_uint64(TOPOLOGY_SAMPLES));
+		sr_config_set(l->data, NULL, SR_CONF_UNTHROTTLED,
+			g_variant_new_boolean(TRUE));
+		sr_session_dev_add(sess, l->data);
+	}
+	sr_config_set(count.sdi[1], NULL, SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(SR_MHZ(1)));
+	fail_unless(get_uint64(count.sdi[0], SR_CONF_SAMPLERATE) == SR_KHZ(50));
+	fail_unless(get_uint64(count.sdi[1], SR_CONF_SAMPLERATE) == SR_MHZ(1));
+
+	sr_session_datafeed_callback_add(sess, count_topology, &count);
+	fail_unless(sr_session_start(sess) == SR_OK);
+	fail_unless(sr_session_run(sess) == SR_OK);
+	for (i = 0; i < TOPOLOGY_DEVICES; i++) {
+		fail_unless(count.logic[i] == TOPOLOGY_SAMPLES,
+			"Device %d sent %" PRIu64 " logic samples.",
+			i, count.logic[i]);
+		fail_unless(count.analog[i] == TOPOLOGY_SAMPLES * TOPOLOGY_ANALOG,
+			"Device %d sent %" PRIu64 " analog samples.",
+			i, count.analog[i]);
+	}
+
+	sr_session_destroy(sess);
+	fail_unless(sr_dev_close_many(devlist, NULL) == SR_OK);
+	g_slist_free(devlist);
+}
+END_TEST
+
 /*
  * Check whether setting a samplerate works.
  *
@@ -70,6 +454,13 @@ Suite *suite_driver_all(void)
 	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
 	tcase_add_test(tc, test_driver_available);
 	tcase_add_test(tc, test_driver_init_all);
+	tcase_add_test(tc, test_driver_scan_all_args);
+	tcase_add_test(tc, test_driver_list_select);
+	tcase_add_test(tc, test_config_transaction);
+	tcase_add_test(tc, test_config_subscribe);
+	tcase_add_test(tc, test_config_list_cached);
+	tcase_add_test(tc, test_dev_open_many);
+	tcase_add_test(tc, test_demo_topology);
 	// TODO: Currently broken.
 	// tcase_add_test(tc, test_config_get_set_samplerate);
 	suite_add_tcase(s, tc);
@@ -19,9 +19,11 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
+#include "libsigrok-internal.h"
 
 /* Check whether at least one input module is available. */
 START_TEST(test_input_available)
@@ -33,6 +35,297 @@ START_TEST(test_input_available)
 }
 END_TEST
 
+static const char vcd_header[] = "$timescale 1 ns $end\n";
+
+/* Check that format detection finds a text format module. */
+START_TEST(test_input_scan_text)
+{
+	const struct sr_input *in;
+	GString *buf;
+	int ret;
+
+	buf = g_string_new(vcd_header);
+	ret = sr_input_scan_buffer(buf, &in);
+	fail_unless(ret == SR_OK, "No module found for VCD input.");
+	fail_unless(in != NULL, "No input instance created.");
+	fail_unless(strcmp(sr_input_id_get(sr_input_module_get(in)), "vcd") == 0,
+		"Unexpected module for VCD input.");
+	sr_input_free(in);
+	g_string_free(buf, TRUE);
+}
+END_TEST
+
+/* Check that format detection skips text format modules for binary data. */
+START_TEST(test_input_scan_binary)
+{
+	const struct sr_input *in;
+	GString *buf;
+	int ret;
+
+	buf = g_string_new(vcd_header);
+	g_string_append_c(buf, '\0');
+	ret = sr_input_scan_buffer(buf, &in);
+	fail_unless(ret == SR_ERR, "Text module matched binary input.");
+	fail_unless(in == NULL, "Unexpected input instance.");
+	g_string_free(buf, TRUE);
+}
+END_TEST
+
+/* What the session saw of a stream which the srnet input module read. */
+struct srnet_seen {
+	int num_meta;
+	uint64_t samplerate;
+	uint64_t logic_bytes;
+	uint64_t analog_samples;
+	gboolean got_end;
+};
+
+static void srnet_datafeed(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_meta *meta;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_config *src;
+	struct srnet_seen *seen;
+	GSList *l;
+
+	(void)sdi;
+
+	seen = cb_data;
+	switch (packet->type) {
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key == SR_CONF_SAMPLERATE)
+				seen->samplerate = g_variant_get_uint64(src->data);
+		}
+		seen->num_meta++;
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		seen->logic_bytes += logic->length;
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		seen->analog_samples += analog->num_samples;
+		break;
+	case SR_DF_END:
+		seen->got_end = TRUE;
+		break;
+	default:
+		break;
+	}
+}
+
+static void srnet_output_append(const struct sr_output *o,
+		const struct sr_datafeed_packet *packet, GString *stream)
+{
+	GString *out;
+
+	fail_unless(sr_output_send(o, packet, &out) == SR_OK);
+	if (out) {
+		g_string_append_len(stream, out->str, out->len);
+		g_string_free(out, TRUE);
+	}
+}
+
+/* Append a raw frame to an srnet stream. */
+static void srnet_frame_append(GString *stream, int type,
+		const uint8_t *payload, size_t len)
+{
+	uint8_t hdr[SRNET_FRAME_HEADER_SIZE];
+
+	memset(hdr, 0, sizeof(hdr));
+	W8(&hdr[0], type);
+	WL32(&hdr[4], len);
+	WL32(&hdr[8], len);
+	g_string_append_len(stream, (const char *)hdr, sizeof(hdr));
+	g_string_append_len(stream, (const char *)payload, len);
+}
+
+/*
+ * Write a header, a samplerate and some logic data with the srnet
+ * output module, and read the stream back with the srnet input module.
+ * Raw frames get inserted after the samplerate. The output module holds
+ * the logic data until the end, so they precede it.
+ */
+static int srnet_roundtrip(struct sr_dev_inst *sdi, GVariant *samplerate,
+		const GString *frames, struct srnet_seen *seen)
+{
+	const struct sr_output *o;
+	struct sr_input *in;
+	struct sr_session *session;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_header header;
+	struct sr_datafeed_meta meta;
+	struct sr_datafeed_logic logic;
+	uint8_t data[1000];
+	GString *stream;
+	int ret;
+
+	o = sr_output_new(sr_output_find("srnet"), NULL, sdi, NULL);
+	fail_unless(o != NULL, "Failed to create srnet output.");
+	stream = g_string_new(NULL);
+
+	header.feed_version = 1;
+	header.starttime.tv_sec = 0;
+	header.starttime.tv_usec = 0;
+	packet.type = SR_DF_HEADER;
+	packet.payload = &header;
+	srnet_output_append(o, &packet, stream);
+
+	meta.config = g_slist_append(NULL,
+		sr_config_new(SR_CONF_SAMPLERATE, samplerate));
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+	srnet_output_append(o, &packet, stream);
+	g_slist_free_full(meta.config, (GDestroyNotify)sr_config_free);
+
+	memset(data, 0x55, sizeof(data));
+	logic.length = sizeof(data);
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	srnet_output_append(o, &packet, stream);
+	if (frames)
+		g_string_append_len(stream, frames->str, frames->len);
+
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	srnet_output_append(o, &packet, stream);
+	sr_output_free(o);
+
+	memset(seen, 0, sizeof(*seen));
+	in = sr_input_new(sr_input_find("srnet"), NULL);
+	fail_unless(in != NULL, "Failed to create srnet input.");
+	fail_unless(sr_input_send(in, stream) == SR_OK);
+	fail_unless(sr_input_dev_inst_get(in) != NULL);
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, srnet_datafeed, seen);
+	sr_session_dev_add(session, sr_input_dev_inst_get(in));
+	ret = sr_input_end(in);
+	sr_input_free(in);
+	sr_session_destroy(session);
+	g_string_free(stream, TRUE);
+
+	return ret;
+}
+
+/*
+ * Check that srnet streams read back what was written, and that meta
+ * items with the wrong value type for their key get rejected.
+ */
+START_TEST(test_input_srnet_roundtrip)
+{
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	struct srnet_seen seen;
+	GSList *devlist;
+	int ret;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devlist = sr_driver_scan(driver, NULL);
+	fail_unless(devlist != NULL, "No demo device found.");
+	sdi = devlist->data;
+	g_slist_free(devlist);
+
+	ret = srnet_roundtrip(sdi, g_variant_new_uint64(SR_MHZ(1)), NULL, &seen);
+	fail_unless(ret == SR_OK, "Reading the stream failed: %d.", ret);
+	fail_unless(seen.num_meta == 1);
+	fail_unless(seen.samplerate == SR_MHZ(1));
+	fail_unless(seen.logic_bytes == 1000);
+	fail_unless(seen.got_end);
+
+	ret = srnet_roundtrip(sdi, g_variant_new_string("fast"), NULL, &seen);
+	fail_unless(ret == SR_ERR_DATA, "Wrong type not rejected: %d.", ret);
+	fail_unless(seen.num_meta == 0);
+	fail_unless(seen.logic_bytes == 0);
+}
+END_TEST
+
+/* Append an analog frame of one channel, with num_samples zeroes. */
+static void srnet_analog_append(GString *frames, uint32_t num_samples,
+		int channel, size_t data_samples)
+{
+	uint8_t payload[36 + 4 * 4];
+
+	memset(payload, 0, sizeof(payload));
+	WL32(&payload[0], num_samples);
+	WL32(&payload[4], 1);
+	WL32(&payload[8], SR_MQ_VOLTAGE);
+	WL32(&payload[12], SR_UNIT_VOLT);
+	WL32(&payload[32], channel);
+	srnet_frame_append(frames, SRNET_ANALOG, payload, 36 + 4 * data_samples);
+}
+
+/* Check that frames which don't match their channels get rejected. */
+START_TEST(test_input_srnet_invalid_frames)
+{
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ch;
+	struct srnet_seen seen;
+	GSList *devlist, *l;
+	GString *frames;
+	uint8_t logic[4 + 3];
+	int logic_index, analog_index, ret;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devlist = sr_driver_scan(driver, NULL);
+	fail_unless(devlist != NULL, "No demo device found.");
+	sdi = devlist->data;
+	g_slist_free(devlist);
+
+	logic_index = analog_index = -1;
+	for (l = sdi->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_LOGIC && logic_index < 0)
+			logic_index = ch->index;
+		if (ch->type == SR_CHANNEL_ANALOG && analog_index < 0)
+			analog_index = ch->index;
+	}
+	fail_unless(logic_index >= 0 && analog_index >= 0);
+
+	/* A valid analog frame, the frames below are made the same way. */
+	frames = g_string_new(NULL);
+	srnet_analog_append(frames, 4, analog_index, 4);
+	ret = srnet_roundtrip(sdi, g_variant_new_uint64(SR_MHZ(1)), frames, &seen);
+	fail_unless(ret == SR_OK, "Reading the stream failed: %d.", ret);
+	fail_unless(seen.analog_samples == 4);
+	fail_unless(seen.got_end);
+
+	/* Analog samples of a logic channel. */
+	g_string_truncate(frames, 0);
+	srnet_analog_append(frames, 4, logic_index, 4);
+	ret = srnet_roundtrip(sdi, g_variant_new_uint64(SR_MHZ(1)), frames, &seen);
+	fail_unless(ret == SR_ERR_DATA, "Logic channel not rejected: %d.", ret);
+	fail_unless(seen.analog_samples == 0);
+
+	/* More samples than a frame can carry, the buffer would not fit. */
+	g_string_truncate(frames, 0);
+	srnet_analog_append(frames, 0xC0000000, analog_index, 4);
+	ret = srnet_roundtrip(sdi, g_variant_new_uint64(SR_MHZ(1)), frames, &seen);
+	fail_unless(ret == SR_ERR_DATA, "Sample count not rejected: %d.", ret);
+	fail_unless(seen.analog_samples == 0);
+
+	/* Logic data which isn't a multiple of the unit size. */
+	g_string_truncate(frames, 0);
+	memset(logic, 0, sizeof(logic));
+	WL32(&logic[0], 2);
+	srnet_frame_append(frames, SRNET_LOGIC, logic, sizeof(logic));
+	ret = srnet_roundtrip(sdi, g_variant_new_uint64(SR_MHZ(1)), frames, &seen);
+	fail_unless(ret == SR_ERR_DATA, "Partial sample not rejected: %d.", ret);
+	fail_unless(seen.logic_bytes == 0);
+
+	g_string_free(frames, TRUE);
+}
+END_TEST
+
 Suite *suite_input_all(void)
 {
 	Suite *s;
@@ -44,5 +337,17 @@ Suite *suite_input_all(void)
 	tcase_add_test(tc, test_input_available);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("scan");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_input_scan_text);
+	tcase_add_test(tc, test_input_scan_binary);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("srnet");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_input_srnet_roundtrip);
+	tcase_add_test(tc, test_input_srnet_invalid_frames);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
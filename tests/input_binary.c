@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <check.h>
+#include <unistd.h>
 #include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -29,6 +30,7 @@ enum {
 	CHECK_ALL_LOW,
 	CHECK_ALL_HIGH,
 	CHECK_HELLO_WORLD,
+	CHECK_RANGE,
 };
 
 static uint64_t df_packet_counter = 0, sample_counter = 0;
@@ -37,6 +39,7 @@ static GArray *logic_channellist = NULL;
 static int check_to_perform;
 static uint64_t expected_samples;
 static uint64_t *expected_samplerate;
+static uint64_t range_start;
 
 static void check_all_low(const struct sr_datafeed_logic *logic)
 {
@@ -76,6 +79,19 @@ static void check_hello_world(const struct sr_datafeed_logic *logic)
 	}
 }
 
+static void check_range(const struct sr_datafeed_logic *logic)
+{
+	uint64_t i;
+	uint8_t *data;
+	const char *h = "Hello world";
+
+	data = logic->data;
+	for (i = 0; i < logic->length; i++) {
+		if (data[i] != h[range_start + sample_counter + i])
+			fail("Logic data was not the range of 'Hello world'.");
+	}
+}
+
 static void datafeed_in(const struct sr_dev_inst *sdi,
 	const struct sr_datafeed_packet *packet, void *cb_data)
 {
@@ -158,6 +174,8 @@ static void datafeed_in(const struct sr_dev_inst *sdi,
 			check_all_high(logic);
 		else if (check_to_perform == CHECK_HELLO_WORLD)
 			check_hello_world(logic);
+		else if (check_to_perform == CHECK_RANGE)
+			check_range(logic);
 
 		sample_counter += logic->length / logic->unitsize;
 
@@ -308,6 +326,52 @@ START_TEST(test_input_binary_hello_world)
 }
 END_TEST
 
+START_TEST(test_input_binary_range)
+{
+	const struct sr_input_module *imod;
+	const struct sr_input *in;
+	struct sr_session *session;
+	gboolean done;
+	char *filename;
+	int fd, ret;
+
+	fd = g_file_open_tmp(NULL, &filename, NULL);
+	fail_unless(fd >= 0, "Failed to create temporary file.");
+	fail_unless(write(fd, "Hello world", 11) == 11);
+	close(fd);
+
+	df_packet_counter = sample_counter = 0;
+	have_seen_df_end = FALSE;
+	check_to_perform = CHECK_RANGE;
+	expected_samplerate = NULL;
+	range_start = 6;
+	expected_samples = 5;
+
+	imod = sr_input_find("binary");
+	fail_unless(imod != NULL, "Failed to find input module.");
+	in = sr_input_new(imod, NULL);
+	fail_unless(in != NULL, "Failed to create input instance.");
+
+	/* The first call makes the device ready, the next sends the range. */
+	ret = sr_input_send_file_range(in, filename, range_start, 100, &done);
+	fail_unless(ret == SR_OK, "sr_input_send_file_range() error: %d", ret);
+	fail_unless(!done, "Range sent before the device was ready.");
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, datafeed_in, NULL);
+	sr_session_dev_add(session, sr_input_dev_inst_get(in));
+	ret = sr_input_send_file_range(in, filename, range_start, 100, &done);
+	fail_unless(ret == SR_OK, "sr_input_send_file_range() error: %d", ret);
+	fail_unless(done, "Range was not sent.");
+	sr_input_end(in);
+	fail_unless(have_seen_df_end, "No SR_DF_END seen.");
+
+	sr_input_free(in);
+	sr_session_destroy(session);
+	g_unlink(filename);
+	g_free(filename);
+}
+END_TEST
+
 Suite *suite_input_binary(void)
 {
 	Suite *s;
@@ -321,6 +385,7 @@ Suite *suite_input_binary(void)
 	tcase_add_test(tc, test_input_binary_all_high);
 	tcase_add_loop_test(tc, test_input_binary_all_high_loop, 1, 10);
 	tcase_add_test(tc, test_input_binary_hello_world);
+	tcase_add_test(tc, test_input_binary_range);
 	suite_add_tcase(s, tc);
 
 	return s;
@@ -0,0 +1,448 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * Copyright (C) 2026 libsigrok contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Tests of the Modbus batches of holding register reads, against a fake
+ * transport which serves a register file and records the requests. The
+ * RTU transport gets tested with slaves which share a pseudo terminal as
+ * their bus. These are internals, so this suite is linked statically into
+ * its own test program.
+ */
+
+/* Needed for posix_openpt() and friends. */
+#define _XOPEN_SOURCE 700
+
+#include <config.h>
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#if defined(HAVE_SERIAL_COMM) && !defined(_WIN32)
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define FAKE_REGISTERS		256
+#define FAKE_MAX_REQUESTS	16
+
+struct fake_modbus {
+	uint8_t reply[2 + 2 * 125];
+	int reply_len, reply_pos;
+	int num_requests;
+	int req_address[FAKE_MAX_REQUESTS];
+	int req_count[FAKE_MAX_REQUESTS];
+};
+
+/* Register n of the fake device holds the value 0x1000 + n. */
+static int fake_send(void *priv, const uint8_t *buffer, int buffer_size)
+{
+	struct fake_modbus *fake;
+	int address, count, i;
+
+	fake = priv;
+	fail_unless(buffer_size == 5);
+	fail_unless(R8(buffer) == 0x03);
+	address = RB16(buffer + 1);
+	count = RB16(buffer + 3);
+	fail_unless(count >= 1 && count <= 125);
+	fail_unless(address + count <= FAKE_REGISTERS);
+	fail_unless(fake->num_requests < FAKE_MAX_REQUESTS);
+
+	fake->req_address[fake->num_requests] = address;
+	fake->req_count[fake->num_requests] = count;
+	fake->num_requests++;
+
+	W8(fake->reply, 0x03);
+	W8(fake->reply + 1, 2 * count);
+	for (i = 0; i < count; i++)
+		WB16(fake->reply + 2 + 2 * i, 0x1000 + address + i);
+	fake->reply_len = 2 + 2 * count;
+	fake->reply_pos = 0;
+
+	return SR_OK;
+}
+
+static int fake_read_begin(void *priv, uint8_t *function_code)
+{
+	struct fake_modbus *fake;
+
+	fake = priv;
+	fail_unless(fake->reply_len > 0);
+	*function_code = fake->reply[0];
+	fake->reply_pos = 1;
+
+	return SR_OK;
+}
+
+static int fake_read_data(void *priv, uint8_t *buf, int maxlen)
+{
+	struct fake_modbus *fake;
+	int len;
+
+	fake = priv;
+	len = MIN(maxlen, fake->reply_len - fake->reply_pos);
+	memcpy(buf, fake->reply + fake->reply_pos, len);
+	fake->reply_pos += len;
+
+	return len;
+}
+
+static int fake_read_end(void *priv)
+{
+	struct fake_modbus *fake;
+
+	fake = priv;
+	fail_unless(fake->reply_pos == fake->reply_len);
+	fake->reply_len = 0;
+
+	return SR_OK;
+}
+
+static struct fake_modbus fake;
+static struct sr_modbus_dev_inst modbus;
+
+static void setup(void)
+{
+	memset(&fake, 0, sizeof(fake));
+	memset(&modbus, 0, sizeof(modbus));
+	modbus.send = fake_send;
+	modbus.read_begin = fake_read_begin;
+	modbus.read_data = fake_read_data;
+	modbus.read_end = fake_read_end;
+	modbus.read_timeout_ms = 1000;
+	modbus.priv = &fake;
+}
+
+static void check_registers(const uint16_t *registers, int address, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		fail_unless(RB16(&registers[i]) == 0x1000 + address + i,
+			"Register %d reads 0x%04x.", address + i,
+			RB16(&registers[i]));
+}
+
+/* Adjacent, overlapping and close ranges share a request. */
+START_TEST(test_batch_coalesce)
+{
+	struct sr_modbus_batch *batch;
+	uint16_t a[2], b[3], c[1], d[4], e[2];
+
+	batch = sr_modbus_batch_new(&modbus, 5);
+	/* Added out of order, the batch sorts them. */
+	fail_unless(sr_modbus_batch_add(batch, 100, 4, d) == SR_OK);
+	fail_unless(sr_modbus_batch_add(batch, 12, 3, b) == SR_OK);
+	fail_unless(sr_modbus_batch_add(batch, 10, 2, a) == SR_OK);
+	fail_unless(sr_modbus_batch_add(batch, 101, 2, e) == SR_OK);
+	fail_unless(sr_modbus_batch_add(batch, 20, 1, c) == SR_OK);
+	fail_unless(sr_modbus_batch_run(batch) == SR_OK);
+
+	fail_unless(fake.num_requests == 2);
+	fail_unless(fake.req_address[0] == 10 && fake.req_count[0] == 11);
+	fail_unless(fake.req_address[1] == 100 && fake.req_count[1] == 4);
+	check_registers(a, 10, 2);
+	check_registers(b, 12, 3);
+	check_registers(c, 20, 1);
+	check_registers(d, 100, 4);
+	check_registers(e, 101, 2);
+
+	sr_modbus_batch_free(batch);
+}
+END_TEST
+
+/* Without a gap, separated ranges take requests of their own. */
+START_TEST(test_batch_no_gap)
+{
+	struct sr_modbus_batch *batch;
+	uint16_t a[1], b[1], c[1];
+
+	batch = sr_modbus_batch_new(&modbus, 0);
+	sr_modbus_batch_add(batch, 0, 1, a);
+	sr_modbus_batch_add(batch, 1, 1, b);
+	sr_modbus_batch_add(batch, 3, 1, c);
+	fail_unless(sr_modbus_batch_run(batch) == SR_OK);
+
+	fail_unless(fake.num_requests == 2);
+	fail_unless(fake.req_address[0] == 0 && fake.req_count[0] == 2);
+	fail_unless(fake.req_address[1] == 3 && fake.req_count[1] == 1);
+	check_registers(a, 0, 1);
+	check_registers(b, 1, 1);
+	check_registers(c, 3, 1);
+
+	sr_modbus_batch_free(batch);
+}
+END_TEST
+
+/* A request never exceeds the 125 registers of one read. */
+START_TEST(test_batch_max_span)
+{
+	struct sr_modbus_batch *batch;
+	uint16_t a[100], b[50];
+
+	batch = sr_modbus_batch_new(&modbus, 0);
+	sr_modbus_batch_add(batch, 0, 100, a);
+	sr_modbus_batch_add(batch, 100, 50, b);
+	fail_unless(sr_modbus_batch_run(batch) == SR_OK);
+
+	fail_unless(fake.num_requests == 2);
+	fail_unless(fake.req_address[0] == 0 && fake.req_count[0] == 100);
+	fail_unless(fake.req_address[1] == 100 && fake.req_count[1] == 50);
+	check_registers(a, 0, 100);
+	check_registers(b, 100, 50);
+
+	/* Invalid ranges get rejected. */
+	fail_unless(sr_modbus_batch_add(batch, 0, 1, a) == SR_ERR_ARG);
+	sr_modbus_batch_free(batch);
+	batch = sr_modbus_batch_new(&modbus, 0);
+	fail_unless(sr_modbus_batch_add(batch, 0, 126, a) == SR_ERR_ARG);
+	fail_unless(sr_modbus_batch_add(batch, 0xFFFF, 2, a) == SR_ERR_ARG);
+	fail_unless(sr_modbus_batch_add(batch, 0, 1, NULL) == SR_ERR_ARG);
+	sr_modbus_batch_free(batch);
+}
+END_TEST
+
+/* Polling sends the same requests again, and splits send and receive. */
+START_TEST(test_batch_rewind)
+{
+	struct sr_modbus_batch *batch;
+	uint16_t a[2], b[2];
+
+	batch = sr_modbus_batch_new(&modbus, 0);
+	sr_modbus_batch_add(batch, 40, 2, a);
+	sr_modbus_batch_add(batch, 42, 2, b);
+	fail_unless(sr_modbus_batch_run(batch) == SR_OK);
+	fail_unless(fake.num_requests == 1);
+
+	memset(a, 0, sizeof(a));
+	memset(b, 0, sizeof(b));
+	fail_unless(sr_modbus_batch_rewind(batch) == SR_OK);
+	fail_unless(sr_modbus_batch_send(batch) == SR_OK);
+	fail_unless(sr_modbus_batch_rewind(batch) == SR_ERR_ARG);
+	fail_unless(sr_modbus_batch_send(batch) == SR_ERR_ARG);
+	fail_unless(sr_modbus_batch_receive(batch) == SR_OK);
+	fail_unless(sr_modbus_batch_send(batch) == SR_ERR_NA);
+	fail_unless(sr_modbus_batch_receive(batch) == SR_ERR_ARG);
+
+	fail_unless(fake.num_requests == 2);
+	fail_unless(fake.req_address[1] == 40 && fake.req_count[1] == 4);
+	check_registers(a, 40, 2);
+	check_registers(b, 42, 2);
+
+	sr_modbus_batch_free(batch);
+}
+END_TEST
+
+#if defined(HAVE_SERIAL_COMM) && !defined(_WIN32)
+#define RTU_SLAVES 2
+
+static int pty_master = -1;
+static struct sr_modbus_dev_inst *rtu[RTU_SLAVES];
+
+static void setup_rtu(void)
+{
+	const char *pty_name;
+	int i;
+
+	pty_master = posix_openpt(O_RDWR | O_NOCTTY);
+	fail_unless(pty_master >= 0);
+	fail_unless(grantpt(pty_master) == 0);
+	fail_unless(unlockpt(pty_master) == 0);
+	pty_name = ptsname(pty_master);
+	fail_unless(pty_name != NULL);
+
+	/* Slaves 1 and 2 on one bus. */
+	for (i = 0; i < RTU_SLAVES; i++) {
+		rtu[i] = modbus_dev_inst_new(pty_name, "9600/8n1", i + 1);
+		fail_unless(rtu[i] != NULL);
+		fail_unless(sr_modbus_open(rtu[i]) == SR_OK);
+	}
+}
+
+static void teardown_rtu(void)
+{
+	int i;
+
+	for (i = 0; i < RTU_SLAVES; i++) {
+		sr_modbus_close(rtu[i]);
+		sr_modbus_free(rtu[i]);
+		rtu[i] = NULL;
+	}
+	close(pty_master);
+	pty_master = -1;
+}
+
+/* Receive a frame which the transport put on the bus, if any. */
+static int bus_receive(uint8_t *frame, int frame_size, int timeout_ms)
+{
+	struct pollfd pfd;
+	int len, ret;
+
+	len = 0;
+	while (len < frame_size) {
+		pfd.fd = pty_master;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, timeout_ms) != 1)
+			break;
+		ret = read(pty_master, frame + len, frame_size - len);
+		if (ret <= 0)
+			break;
+		len += ret;
+	}
+
+	return len;
+}
+
+/* Check for the read request of one register of a slave. */
+static void bus_check_request(int slave_addr, int address)
+{
+	uint8_t frame[8];
+	uint16_t crc;
+
+	fail_unless(bus_receive(frame, sizeof(frame), 1000) == sizeof(frame),
+		"No request to slave %d on the bus.", slave_addr);
+	fail_unless(R8(frame) == slave_addr);
+	fail_unless(R8(frame + 1) == 0x03);
+	fail_unless(RB16(frame + 2) == address);
+	fail_unless(RB16(frame + 4) == 1);
+	crc = sr_crc16(SR_CRC16_DEFAULT_INIT, frame, 6);
+	fail_unless(memcmp(frame + 6, &crc, sizeof(crc)) == 0);
+}
+
+/* Answer a read of one register, for the slave's reply. */
+static void bus_reply(int slave_addr, uint16_t value)
+{
+	uint8_t frame[7];
+	uint16_t crc;
+
+	W8(frame, slave_addr);
+	W8(frame + 1, 0x03);
+	W8(frame + 2, 2);
+	WB16(frame + 3, value);
+	crc = sr_crc16(SR_CRC16_DEFAULT_INIT, frame, 5);
+	memcpy(frame + 5, &crc, sizeof(crc));
+	fail_unless(write(pty_master, frame, sizeof(frame)) == sizeof(frame));
+}
+
+/*
+ * Two slaves which get polled asynchronously on one bus. The request of
+ * the second slave gets queued without waiting while the first one awaits
+ * its reply, and goes out as soon as that reply got received.
+ */
+START_TEST(test_rtu_shared_bus)
+{
+	uint8_t frame[8];
+	uint16_t value;
+	gint64 start;
+
+	fail_unless(sr_modbus_read_holding_registers(rtu[0], 10, 1, NULL) == SR_OK);
+	bus_check_request(1, 10);
+
+	start = g_get_monotonic_time();
+	fail_unless(sr_modbus_read_holding_registers(rtu[1], 20, 1, NULL) == SR_OK);
+	fail_unless(g_get_monotonic_time() - start < 100 * 1000,
+		"Sending waited for the bus.");
+	fail_unless(bus_receive(frame, sizeof(frame), 0) == 0);
+	/* The reply to the queued request is not there yet. */
+	fail_unless(sr_modbus_read_holding_registers(rtu[1], -1, 1, &value)
+		== SR_ERR_NA);
+
+	bus_reply(1, 0x1234);
+	fail_unless(sr_modbus_read_holding_registers(rtu[0], -1, 1, &value) == SR_OK);
+	fail_unless(RB16(&value) == 0x1234);
+
+	/* Releasing the bus sent the queued request. */
+	bus_check_request(2, 20);
+	bus_reply(2, 0x5678);
+	fail_unless(sr_modbus_read_holding_registers(rtu[1], -1, 1, &value) == SR_OK);
+	fail_unless(RB16(&value) == 0x5678);
+}
+END_TEST
+
+/* A slave's batch waits for the bus, without losing its place. */
+START_TEST(test_rtu_shared_bus_batch)
+{
+	struct sr_modbus_batch *batch;
+	uint16_t value, a[1];
+
+	batch = sr_modbus_batch_new(rtu[1], 0);
+	sr_modbus_batch_add(batch, 30, 1, a);
+
+	fail_unless(sr_modbus_read_holding_registers(rtu[0], 10, 1, NULL) == SR_OK);
+	bus_check_request(1, 10);
+
+	fail_unless(sr_modbus_batch_send(batch) == SR_OK);
+	fail_unless(sr_modbus_batch_receive(batch) == SR_ERR_NA);
+	fail_unless(sr_modbus_batch_receive(batch) == SR_ERR_NA);
+
+	bus_reply(1, 0x1234);
+	fail_unless(sr_modbus_read_holding_registers(rtu[0], -1, 1, &value) == SR_OK);
+
+	bus_check_request(2, 30);
+	bus_reply(2, 0x4321);
+	fail_unless(sr_modbus_batch_receive(batch) == SR_OK);
+	fail_unless(RB16(&a[0]) == 0x4321);
+	fail_unless(sr_modbus_batch_send(batch) == SR_ERR_NA);
+
+	sr_modbus_batch_free(batch);
+}
+END_TEST
+#endif
+
+static Suite *suite_modbus(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("modbus");
+
+	tc = tcase_create("batch");
+	tcase_add_checked_fixture(tc, setup, NULL);
+	tcase_add_test(tc, test_batch_coalesce);
+	tcase_add_test(tc, test_batch_no_gap);
+	tcase_add_test(tc, test_batch_max_span);
+	tcase_add_test(tc, test_batch_rewind);
+	suite_add_tcase(s, tc);
+
+#if defined(HAVE_SERIAL_COMM) && !defined(_WIN32)
+	tc = tcase_create("rtu");
+	tcase_add_checked_fixture(tc, setup_rtu, teardown_rtu);
+	tcase_add_test(tc, test_rtu_shared_bus);
+	tcase_add_test(tc, test_rtu_shared_bus_batch);
+	suite_add_tcase(s, tc);
+#endif
+
+	return s;
+}
+
+int main(void)
+{
+	int ret;
+	SRunner *srunner;
+
+	srunner = srunner_create(suite_modbus());
+	srunner_run_all(srunner, CK_VERBOSE);
+	ret = srunner_ntests_failed(srunner);
+	srunner_free(srunner);
+
+	return (ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -19,6 +19,8 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -96,6 +98,222 @@ START_TEST(test_output_options)
 }
 END_TEST
 
+/* Create a device instance with two logic channels. */
+static struct sr_dev_inst *test_device(void)
+{
+	struct sr_dev_inst *sdi;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	fail_unless(sdi != NULL, "sr_dev_inst_user_new() failed.");
+	fail_unless(sr_dev_inst_channel_add(sdi, 0, SR_CHANNEL_LOGIC, "D0") == SR_OK);
+	fail_unless(sr_dev_inst_channel_add(sdi, 1, SR_CHANNEL_LOGIC, "D1") == SR_OK);
+
+	return sdi;
+}
+
+static int test_sink_cb(const uint8_t *data, size_t len, void *cb_data)
+{
+	g_string_append_len(cb_data, (const char *)data, len);
+
+	return SR_OK;
+}
+
+/* Check whether memory and callback sinks receive the output. */
+START_TEST(test_output_sink)
+{
+	const struct sr_output *o;
+	struct sr_output_sink *sink;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint8_t data[] = { 0x01, 0x02, 0x03, 0x00 };
+	const uint8_t *buf;
+	GString *collected;
+	size_t len;
+
+	o = sr_output_new(sr_output_find("binary"), NULL, test_device(), NULL);
+	fail_unless(o != NULL, "Failed to create binary output.");
+	logic.length = sizeof(data);
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	sink = sr_output_sink_new_buffer();
+	fail_unless(sink != NULL);
+	fail_unless(sr_output_send_sink(o, &packet, sink) == SR_OK);
+	fail_unless(sr_output_send_sink(o, &packet, sink) == SR_OK);
+	buf = sr_output_sink_buffer_get(sink, &len);
+	fail_unless(len == 2 * sizeof(data), "Wrong buffer length %zu.", len);
+	fail_unless(!memcmp(buf, data, sizeof(data)));
+	fail_unless(!memcmp(buf + sizeof(data), data, sizeof(data)));
+	sr_output_sink_buffer_clear(sink);
+	buf = sr_output_sink_buffer_get(sink, &len);
+	fail_unless(len == 0);
+	fail_unless(sr_output_sink_free(sink) == SR_OK);
+
+	collected = g_string_new(NULL);
+	sink = sr_output_sink_new_callback(test_sink_cb, collected);
+	fail_unless(sink != NULL);
+	fail_unless(sr_output_send_sink(o, &packet, sink) == SR_OK);
+	fail_unless(sr_output_sink_flush(sink) == SR_OK);
+	fail_unless(collected->len == sizeof(data));
+	fail_unless(!memcmp(collected->str, data, sizeof(data)));
+	fail_unless(sr_output_sink_free(sink) == SR_OK);
+	g_string_free(collected, TRUE);
+
+	/* Sink based modules keep working with the GString API. */
+	fail_unless(sr_output_send(o, &packet, &collected) == SR_OK);
+	fail_unless(collected != NULL && collected->len == sizeof(data));
+	g_string_free(collected, TRUE);
+
+	sr_output_free(o);
+}
+END_TEST
+
+/* Check whether wavedrom output renders the runs of each channel. */
+START_TEST(test_output_wavedrom)
+{
+	const struct sr_output *o;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint8_t data[] = { 0x01, 0x02, 0x03, 0x00 };
+	GString *out;
+
+	o = sr_output_new(sr_output_find("wavedrom"), NULL, test_device(), NULL);
+	fail_unless(o != NULL, "Failed to create wavedrom output.");
+	logic.length = sizeof(data);
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	fail_unless(out == NULL);
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	fail_unless(out != NULL);
+	fail_unless(!strcmp(out->str, "{ \"signal\": ["
+		"{ \"name\": \"D0\", \"wave\": \"10101010\" },"
+		"{ \"name\": \"D1\", \"wave\": \"01.0.1.0\" }], "
+		"\"config\": { \"skin\": \"narrow\" }}"),
+		"Unexpected output '%s'.", out->str);
+	g_string_free(out, TRUE);
+
+	sr_output_free(o);
+}
+END_TEST
+
+/* Check whether asynchronous outputs process all queued packets. */
+START_TEST(test_output_async)
+{
+	const struct sr_output *o;
+	struct sr_output_sink *sink;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint8_t data[64];
+	const uint8_t *buf;
+	GString *out;
+	size_t i, len;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i;
+	sink = sr_output_sink_new_buffer();
+	o = sr_output_new_async(sr_output_find("binary"), NULL, test_device(),
+		NULL, sink, 4);
+	fail_unless(o != NULL, "Failed to create async binary output.");
+
+	logic.length = sizeof(data);
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	for (i = 0; i < 100; i++) {
+		fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+		fail_unless(out == NULL);
+	}
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	fail_unless(sr_output_free(o) == SR_OK);
+
+	buf = sr_output_sink_buffer_get(sink, &len);
+	fail_unless(len == 100 * sizeof(data), "Wrong output length %zu.", len);
+	for (i = 0; i < len; i++)
+		fail_unless(buf[i] == i % sizeof(data));
+	sr_output_sink_free(sink);
+}
+END_TEST
+
+/* Check whether a shared memory ring reader receives the packets. */
+START_TEST(test_output_shmring)
+{
+	const struct sr_output_module *omod;
+	const struct sr_output *o;
+	const struct sr_datafeed_packet *rpacket;
+	const struct sr_datafeed_logic *rlogic;
+	struct sr_shm_reader *reader;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	GHashTable *options;
+	GString *out;
+	uint8_t data[256];
+	char *name;
+	size_t i, count;
+
+	/* Not every platform has POSIX shared memory. */
+	if (!(omod = sr_output_find("shmring")))
+		return;
+
+	name = g_strdup_printf("/srtest-%d", (int)getpid());
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "name",
+		g_variant_ref_sink(g_variant_new_string(name)));
+	/* A small ring, for wrapping around the end. */
+	g_hash_table_insert(options, "size",
+		g_variant_ref_sink(g_variant_new_uint64(64 * 1024)));
+	o = sr_output_new(omod, options, test_device(), NULL);
+	g_hash_table_destroy(options);
+	fail_unless(o != NULL, "Failed to create shmring output.");
+	fail_unless(sr_shm_reader_open(name, &reader) == SR_OK);
+	fail_unless(sr_shm_reader_read(reader, &rpacket) == SR_ERR_NA);
+	fail_unless(sr_dev_inst_channels_get(
+		sr_shm_reader_dev_inst_get(reader)) != NULL);
+
+	logic.length = sizeof(data);
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	for (count = 0; count < 1000; count++) {
+		for (i = 0; i < sizeof(data); i++)
+			data[i] = count + i;
+		fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+		fail_unless(out == NULL);
+		fail_unless(sr_shm_reader_read(reader, &rpacket) == SR_OK);
+		fail_unless(rpacket->type == SR_DF_LOGIC);
+		rlogic = rpacket->payload;
+		fail_unless(rlogic->length == sizeof(data));
+		for (i = 0; i < sizeof(data); i++)
+			fail_unless(((const uint8_t *)rlogic->data)[i]
+				== (uint8_t)(count + i));
+	}
+	fail_unless(sr_shm_reader_read(reader, &rpacket) == SR_ERR_NA);
+
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	fail_unless(sr_output_free(o) == SR_OK);
+	fail_unless(sr_shm_reader_read(reader, &rpacket) == SR_OK);
+	fail_unless(rpacket->type == SR_DF_END);
+	fail_unless(sr_shm_reader_closed(reader));
+	sr_shm_reader_close(reader);
+	g_free(name);
+}
+END_TEST
+
 Suite *suite_output_all(void)
 {
 	Suite *s;
@@ -110,6 +328,10 @@ Suite *suite_output_all(void)
 	tcase_add_test(tc, test_output_desc);
 	tcase_add_test(tc, test_output_find);
 	tcase_add_test(tc, test_output_options);
+	tcase_add_test(tc, test_output_sink);
+	tcase_add_test(tc, test_output_wavedrom);
+	tcase_add_test(tc, test_output_async);
+	tcase_add_test(tc, test_output_shmring);
 	suite_add_tcase(s, tc);
 
 	return s;
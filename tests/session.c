@@ -19,7 +19,9 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
+#include <glib/gstdio.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
 
@@ -185,6 +187,846 @@ START_TEST(test_session_trigger_get_null)
 }
 END_TEST
 
+/*
+ * Check whether threaded datafeed dispatch can be configured, and
+ * whether bogus parameters are rejected.
+ */
+START_TEST(test_session_datafeed_dispatch_set)
+{
+	int ret;
+	struct sr_session *sess;
+
+	sr_session_new(srtest_ctx, &sess);
+
+	ret = sr_session_datafeed_dispatch_set(sess, 16, SR_DF_OVERFLOW_BLOCK);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_datafeed_dispatch_set(sess, 16, SR_DF_OVERFLOW_DROP_NEWEST);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_datafeed_dispatch_set(sess, 0, SR_DF_OVERFLOW_BLOCK);
+	fail_unless(ret == SR_OK);
+
+	/* Invalid overflow policy. */
+	ret = sr_session_datafeed_dispatch_set(sess, 16, 0);
+	fail_unless(ret == SR_ERR_ARG);
+
+	/* NULL session, must not segfault. */
+	ret = sr_session_datafeed_dispatch_set(NULL, 16, SR_DF_OVERFLOW_BLOCK);
+	fail_unless(ret == SR_ERR_ARG);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+static void dummy_datafeed_cb(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	(void)sdi;
+	(void)packet;
+	(void)cb_data;
+}
+
+/* Check the statistics of a session which never ran. */
+START_TEST(test_session_stats_get)
+{
+	int ret;
+	struct sr_session *sess;
+	struct sr_session_stats stats;
+	struct sr_session_stage_stats *stage;
+	GSList *stages;
+
+	sr_session_new(srtest_ctx, &sess);
+	sr_session_datafeed_callback_add(sess, dummy_datafeed_cb, NULL);
+
+	memset(&stats, 0xff, sizeof(stats));
+	ret = sr_session_stats_get(sess, NULL, &stats);
+	fail_unless(ret == SR_OK);
+	fail_unless(stats.packets[SR_DF_LOGIC - SR_DF_HEADER] == 0);
+	fail_unless(stats.max_gap_us == 0);
+	fail_unless(stats.frames == 0);
+	fail_unless(stats.min_frame_gap_us == 0);
+	fail_unless(stats.polls == 0);
+	fail_unless(stats.poll_late_max_us == 0);
+
+	ret = sr_session_stage_stats_get(sess, &stages);
+	fail_unless(ret == SR_OK);
+	fail_unless(g_slist_length(stages) == 1);
+	stage = stages->data;
+	fail_unless(!strcmp(stage->name, "callback 0"));
+	fail_unless(stage->calls == 0);
+	g_slist_free_full(stages, g_free);
+
+	/* NULL arguments, must not segfault. */
+	fail_unless(sr_session_stats_get(NULL, NULL, &stats) == SR_ERR_ARG);
+	fail_unless(sr_session_stats_get(sess, NULL, NULL) == SR_ERR_ARG);
+	fail_unless(sr_session_stage_stats_get(sess, NULL) == SR_ERR_ARG);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/* Check that latency probes get accounted, and other packets don't. */
+START_TEST(test_session_latency_probe)
+{
+	struct sr_session *sess;
+	struct sr_session_stats stats;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+	struct sr_config cfg;
+	int ret;
+
+	sr_session_new(srtest_ctx, &sess);
+
+	cfg.key = SR_CONF_LATENCY_PROBE;
+	cfg.data = g_variant_ref_sink(g_variant_new_uint64(
+		g_get_monotonic_time()));
+	meta.config = g_slist_append(NULL, &cfg);
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+
+	ret = sr_session_latency_probe(sess, NULL, &packet);
+	fail_unless(ret == SR_OK);
+	sr_session_stats_get(sess, NULL, &stats);
+	fail_unless(stats.probes == 1);
+	fail_unless(stats.probe_max_us <= stats.probe_total_us);
+
+	cfg.key = SR_CONF_SAMPLERATE;
+	ret = sr_session_latency_probe(sess, NULL, &packet);
+	fail_unless(ret == SR_ERR_NA);
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	ret = sr_session_latency_probe(sess, NULL, &packet);
+	fail_unless(ret == SR_ERR_NA);
+	sr_session_stats_get(sess, NULL, &stats);
+	fail_unless(stats.probes == 1);
+
+	/* NULL arguments, must not segfault. */
+	fail_unless(sr_session_latency_probe(NULL, NULL, &packet) == SR_ERR_ARG);
+	fail_unless(sr_session_latency_probe(sess, NULL, NULL) == SR_ERR_ARG);
+
+	g_slist_free(meta.config);
+	g_variant_unref(cfg.data);
+	sr_session_destroy(sess);
+}
+END_TEST
+
+START_TEST(test_session_device_threads_set)
+{
+	struct sr_session *sess;
+
+	sr_session_new(srtest_ctx, &sess);
+
+	fail_unless(sr_session_device_threads_set(sess, TRUE) == SR_OK);
+	fail_unless(sr_session_device_threads_set(sess, FALSE) == SR_OK);
+
+	/* NULL session, must not segfault. */
+	fail_unless(sr_session_device_threads_set(NULL, TRUE) == SR_ERR_ARG);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/* Check the alignment settings, and the clock of a device without data. */
+START_TEST(test_session_align)
+{
+	struct sr_session *sess;
+	struct sr_session_clock clock;
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	GSList *devlist;
+
+	sr_session_new(srtest_ctx, &sess);
+
+	fail_unless(sr_session_align_set(sess, 100) == SR_OK);
+	fail_unless(sr_session_align_set(sess, 0) == SR_OK);
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devlist = sr_driver_scan(driver, NULL);
+	fail_unless(devlist != NULL, "No demo device found.");
+	sdi = devlist->data;
+	g_slist_free(devlist);
+	fail_unless(sr_session_clock_get(sess, sdi, &clock) == SR_ERR_NA);
+
+	/* NULL arguments, must not segfault. */
+	fail_unless(sr_session_align_set(NULL, 100) == SR_ERR_ARG);
+	fail_unless(sr_session_clock_get(NULL, sdi, &clock) == SR_ERR_ARG);
+	fail_unless(sr_session_clock_get(sess, NULL, &clock) == SR_ERR_ARG);
+	fail_unless(sr_session_clock_get(sess, sdi, NULL) == SR_ERR_ARG);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+static void count_logic(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	uint64_t *samples;
+
+	(void)sdi;
+
+	samples = cb_data;
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	logic = packet->payload;
+	*samples += logic->length / logic->unitsize;
+}
+
+/*
+ * Check whether sessions can be re-armed, and that changes of the
+ * configuration apply to re-armed runs.
+ */
+START_TEST(test_session_rearm)
+{
+	struct sr_session *sess;
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	GSList *devlist;
+	uint64_t samples;
+	int i;
+
+	sr_session_new(srtest_ctx, &sess);
+	fail_unless(sr_session_rearm(sess) == SR_ERR_ARG);
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devlist = sr_driver_scan(driver, NULL);
+	fail_unless(devlist != NULL, "No demo device found.");
+	sdi = devlist->data;
+	g_slist_free(devlist);
+	fail_unless(sr_dev_open(sdi) == SR_OK);
+	sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(1000));
+	sr_config_set(sdi, NULL, SR_CONF_UNTHROTTLED,
+		g_variant_new_boolean(TRUE));
+	sr_session_dev_add(sess, sdi);
+	sr_session_datafeed_callback_add(sess, count_logic, &samples);
+
+	for (i = 0; i < 3; i++) {
+		samples = 0;
+		fail_unless(sr_session_rearm(sess) == SR_OK);
+		fail_unless(sr_session_run(sess) == SR_OK);
+		fail_unless(samples == 1000, "Run %d got %" PRIu64 " samples.",
+			i, samples);
+	}
+
+	sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(2000));
+	samples = 0;
+	fail_unless(sr_session_rearm(sess) == SR_OK);
+	fail_unless(sr_session_run(sess) == SR_OK);
+	fail_unless(samples == 2000);
+
+	/* NULL session, must not segfault. */
+	fail_unless(sr_session_rearm(NULL) == SR_ERR_ARG);
+
+	sr_session_destroy(sess);
+	sr_dev_close(sdi);
+}
+END_TEST
+
+/* Check that packets and stages only get accounted when enabled. */
+START_TEST(test_session_stats_enable_set)
+{
+	struct sr_session *sess;
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	struct sr_session_stats stats;
+	struct sr_session_stage_stats *stage;
+	GSList *devlist, *stages;
+	uint64_t samples;
+
+	sr_session_new(srtest_ctx, &sess);
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devlist = sr_driver_scan(driver, NULL);
+	fail_unless(devlist != NULL, "No demo device found.");
+	sdi = devlist->data;
+	g_slist_free(devlist);
+	fail_unless(sr_dev_open(sdi) == SR_OK);
+	sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(1000));
+	sr_config_set(sdi, NULL, SR_CONF_UNTHROTTLED,
+		g_variant_new_boolean(TRUE));
+	sr_session_dev_add(sess, sdi);
+	sr_session_datafeed_callback_add(sess, count_logic, &samples);
+
+	/* Off by default. */
+	samples = 0;
+	fail_unless(sr_session_rearm(sess) == SR_OK);
+	fail_unless(sr_session_run(sess) == SR_OK);
+	fail_unless(samples == 1000);
+	sr_session_stats_get(sess, NULL, &stats);
+	fail_unless(stats.packets[SR_DF_LOGIC - SR_DF_HEADER] == 0);
+	sr_session_stage_stats_get(sess, &stages);
+	stage = stages->data;
+	fail_unless(stage->calls == 0);
+	g_slist_free_full(stages, g_free);
+
+	fail_unless(sr_session_stats_enable_set(sess, TRUE) == SR_OK);
+	samples = 0;
+	fail_unless(sr_session_rearm(sess) == SR_OK);
+	fail_unless(sr_session_run(sess) == SR_OK);
+	fail_unless(samples == 1000);
+	sr_session_stats_get(sess, NULL, &stats);
+	fail_unless(stats.packets[SR_DF_LOGIC - SR_DF_HEADER] > 0);
+	fail_unless(stats.bytes[SR_DF_LOGIC - SR_DF_HEADER] >= 1000);
+	sr_session_stats_get(sess, sdi, &stats);
+	fail_unless(stats.packets[SR_DF_LOGIC - SR_DF_HEADER] > 0);
+	sr_session_stage_stats_get(sess, &stages);
+	stage = stages->data;
+	fail_unless(stage->calls > 0);
+	g_slist_free_full(stages, g_free);
+
+	/* NULL session, must not segfault. */
+	fail_unless(sr_session_stats_enable_set(NULL, TRUE) == SR_ERR_ARG);
+
+	sr_session_destroy(sess);
+	sr_dev_close(sdi);
+}
+END_TEST
+
+START_TEST(test_session_backpressure_set)
+{
+	struct sr_session *sess;
+
+	sr_session_new(srtest_ctx, &sess);
+
+	fail_unless(sr_session_backpressure_set(sess, 50) == SR_OK);
+	fail_unless(sr_session_backpressure_set(sess, 1000) == SR_OK);
+
+	/* NULL session, must not segfault. */
+	fail_unless(sr_session_backpressure_set(NULL, 50) == SR_ERR_ARG);
+
+	sr_session_destroy(sess);
+}
+END_TEST
+
+/*
+ * Check whether copied packets are refcounted, and whether referencing
+ * them shares the packet instead of copying it again.
+ */
+START_TEST(test_packet_copy_ref)
+{
+	int ret;
+	uint8_t data[] = { 0x01, 0x02, 0x03, 0x04 };
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_packet packet, *copy, *ref;
+	const struct sr_datafeed_logic *logic_copy;
+
+	logic.length = sizeof(data);
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	ret = sr_packet_copy(&packet, &copy);
+	fail_unless(ret == SR_OK);
+	logic_copy = copy->payload;
+	fail_unless(logic_copy->length == logic.length);
+	fail_unless(logic_copy->data != logic.data);
+	fail_unless(!memcmp(logic_copy->data, data, sizeof(data)));
+
+	ret = sr_packet_ref(copy, &ref);
+	fail_unless(ret == SR_OK);
+	fail_unless(ref == copy);
+
+	sr_packet_unref(ref);
+	sr_packet_free(copy);
+}
+END_TEST
+
+/* Check that packets which weren't sent by a device carry no timestamp. */
+START_TEST(test_packet_timestamp)
+{
+	uint8_t data[] = { 0x01, 0x02, 0x03, 0x04 };
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_packet packet, *copy;
+	struct sr_datafeed_timestamp ts;
+
+	logic.length = sizeof(data);
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+
+	fail_unless(sr_packet_timestamp_get(&packet, &ts) == SR_ERR_NA);
+	fail_unless(sr_packet_copy(&packet, &copy) == SR_OK);
+	fail_unless(sr_packet_timestamp_get(copy, &ts) == SR_ERR_NA);
+	sr_packet_free(copy);
+
+	/* NULL arguments, must not segfault. */
+	fail_unless(sr_packet_timestamp_get(NULL, &ts) == SR_ERR_ARG);
+	fail_unless(sr_packet_timestamp_get(&packet, NULL) == SR_ERR_ARG);
+}
+END_TEST
+
+static uint8_t test_sample(uint64_t pos)
+{
+	return (pos ^ (pos >> 8) ^ (pos >> 16)) & 0xff;
+}
+
+/*
+ * Write 5 MiB of logic samples, more than one chunk, to a session file.
+ * The device reports a gap of 1000 samples after the first MiB.
+ */
+static void write_test_file(const char *filename, GHashTable *options)
+{
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	const struct sr_output *o;
+	struct sr_datafeed_packet packet, gap_packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_meta meta;
+	struct sr_config cfg;
+	GSList *devlist;
+	GString *out;
+	uint8_t *data;
+	uint64_t i, pos;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devlist = sr_driver_scan(driver, NULL);
+	fail_unless(devlist != NULL, "No demo device found.");
+	sdi = devlist->data;
+	g_slist_free(devlist);
+
+	o = sr_output_new(sr_output_find("srzip"), options, sdi, filename);
+	fail_unless(o != NULL, "Failed to create srzip output.");
+
+	data = g_malloc(1024 * 1024);
+	logic.unitsize = 1;
+	logic.data = data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	for (pos = 0; pos < 5 * 1024 * 1024; pos += logic.length) {
+		logic.length = 1024 * 1024;
+		for (i = 0; i < logic.length; i++)
+			data[i] = test_sample(pos + i);
+		fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+		fail_unless(out == NULL);
+		if (pos)
+			continue;
+		cfg.key = SR_CONF_SAMPLES_LOST;
+		cfg.data = g_variant_ref_sink(g_variant_new("(tt)",
+			(uint64_t)logic.length, (uint64_t)1000));
+		meta.config = g_slist_append(NULL, &cfg);
+		gap_packet.type = SR_DF_META;
+		gap_packet.payload = &meta;
+		fail_unless(sr_output_send(o, &gap_packet, &out) == SR_OK);
+		fail_unless(out == NULL);
+		g_slist_free(meta.config);
+		g_variant_unref(cfg.data);
+	}
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	fail_unless(out == NULL);
+	sr_output_free(o);
+	g_free(data);
+}
+
+/*
+ * Check whether sample ranges of a session file which the srzip output
+ * wrote can be read back, also across chunk boundaries.
+ */
+START_TEST(test_session_file_read_logic)
+{
+	struct sr_session_file *file;
+	char *filename;
+	uint8_t buf[1000];
+	uint32_t transitions;
+	uint64_t i, pos, num_samples, samples_read;
+	unsigned int unitsize;
+	int ret;
+
+	filename = g_build_filename(g_get_tmp_dir(), "srtest-read.sr", NULL);
+	write_test_file(filename, NULL);
+
+	ret = sr_session_file_open(filename, &file);
+	fail_unless(ret == SR_OK, "sr_session_file_open() failed: %d.", ret);
+	ret = sr_session_file_logic_info(file, NULL, &unitsize, &num_samples);
+	fail_unless(ret == SR_OK);
+	fail_unless(unitsize == 1);
+	fail_unless(num_samples == 5 * 1024 * 1024);
+
+	pos = 4 * 1024 * 1024 - 500;
+	ret = sr_session_file_read_logic(file, pos, sizeof(buf), buf,
+		&samples_read);
+	fail_unless(ret == SR_OK);
+	fail_unless(samples_read == sizeof(buf));
+	for (i = 0; i < sizeof(buf); i++)
+		fail_unless(buf[i] == test_sample(pos + i),
+			"Wrong sample %" PRIu64 ".", pos + i);
+
+	/* Reads stop at the end of the data. */
+	ret = sr_session_file_read_logic(file, num_samples - 10, sizeof(buf),
+		buf, &samples_read);
+	fail_unless(ret == SR_OK);
+	fail_unless(samples_read == 10);
+
+	/* No summaries were written. */
+	pos = 1024;
+	samples_read = 1;
+	ret = sr_session_file_read_logic_summary(file, 0, 1024, &pos,
+		buf, &transitions, &samples_read);
+	fail_unless(ret == SR_ERR_NA);
+
+	sr_session_file_close(file);
+	g_unlink(filename);
+	g_free(filename);
+}
+END_TEST
+
+/*
+ * Check whether the logic summary levels match the samples, and
+ * whether the coarsest level fitting the request gets used.
+ */
+START_TEST(test_session_file_logic_summary)
+{
+	struct sr_session_file *file;
+	GHashTable *options;
+	char *filename;
+	uint8_t changed[8], expect;
+	uint32_t transitions[8], count;
+	uint64_t i, j, block, num_blocks;
+	int ret;
+
+	filename = g_build_filename(g_get_tmp_dir(), "srtest-summary.sr", NULL);
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "summary",
+		g_variant_ref_sink(g_variant_new_uint64(1024)));
+	write_test_file(filename, options);
+	g_hash_table_destroy(options);
+
+	ret = sr_session_file_open(filename, &file);
+	fail_unless(ret == SR_OK, "sr_session_file_open() failed: %d.", ret);
+
+	/* 20000 samples per block get the 16384 samples level. */
+	block = 20000;
+	num_blocks = G_N_ELEMENTS(changed);
+	ret = sr_session_file_read_logic_summary(file, 16384 + 5, 3 * 16384,
+		&block, changed, transitions, &num_blocks);
+	fail_unless(ret == SR_OK, "Summary read failed: %d.", ret);
+	fail_unless(block == 16384);
+	fail_unless(num_blocks == 4);
+
+	for (i = 0; i < num_blocks; i++) {
+		expect = 0;
+		count = 0;
+		for (j = (i + 1) * block; j < (i + 2) * block; j++) {
+			if (j == 0 || test_sample(j) == test_sample(j - 1))
+				continue;
+			expect |= test_sample(j) ^ test_sample(j - 1);
+			count++;
+		}
+		fail_unless(changed[i] == expect, "Wrong changes in block %"
+			PRIu64 ".", i);
+		fail_unless(transitions[i] == count, "Wrong transitions in "
+			"block %" PRIu64 ".", i);
+	}
+
+	sr_session_file_close(file);
+	g_unlink(filename);
+	g_free(filename);
+}
+END_TEST
+
+/*
+ * Check whether the metadata of a session file gets parsed once, and
+ * loading the file uses it.
+ */
+START_TEST(test_session_file_meta)
+{
+	struct sr_session_file_meta *meta, *again;
+	struct sr_session *session;
+	char *filename;
+	uint64_t num_samples, gap_sample, gap_count;
+	unsigned int unitsize, num_logic;
+	int ret;
+
+	filename = g_build_filename(g_get_tmp_dir(), "srtest-meta.sr", NULL);
+	write_test_file(filename, NULL);
+
+	ret = sr_session_file_meta_get(srtest_ctx, filename, &meta);
+	fail_unless(ret == SR_OK, "sr_session_file_meta_get() failed: %d.", ret);
+	ret = sr_session_file_meta_info(meta, NULL, &unitsize, &num_logic,
+		NULL, &num_samples);
+	fail_unless(ret == SR_OK);
+	fail_unless(unitsize == 1);
+	fail_unless(num_logic > 0);
+	fail_unless(num_samples == 5 * 1024 * 1024);
+	fail_unless(sr_session_file_meta_channel_name(meta, 0) != NULL);
+	fail_unless(sr_session_file_meta_channel_name(meta, 1000) == NULL);
+
+	/* The gap the device reported got recorded. */
+	ret = sr_session_file_meta_gap(meta, 0, &gap_sample, &gap_count);
+	fail_unless(ret == SR_OK);
+	fail_unless(gap_sample == 1024 * 1024);
+	fail_unless(gap_count == 1000);
+	fail_unless(sr_session_file_meta_gap(meta, 1, NULL, NULL) == SR_ERR_NA);
+	fail_unless(sr_session_file_meta_gap(NULL, 0, NULL, NULL) == SR_ERR_ARG);
+
+	/* The unchanged file is not parsed again. */
+	ret = sr_session_file_meta_get(srtest_ctx, filename, &again);
+	fail_unless(ret == SR_OK);
+	fail_unless(again == meta);
+	sr_session_file_meta_unref(again);
+	sr_session_file_meta_unref(meta);
+
+	ret = sr_session_load(srtest_ctx, filename, &session);
+	fail_unless(ret == SR_OK, "sr_session_load() failed: %d.", ret);
+	sr_session_destroy(session);
+
+	fail_unless(sr_session_file_meta_get(srtest_ctx, "/nonexistent.sr",
+		&meta) != SR_OK);
+	fail_unless(sr_session_file_meta_get(NULL, filename, &meta)
+		== SR_ERR_ARG);
+
+	g_unlink(filename);
+	g_free(filename);
+}
+END_TEST
+
+/*
+ * Check whether ring mode keeps the most recent chunk only, and places
+ * its samples at the start of the file.
+ */
+START_TEST(test_session_file_ring)
+{
+	struct sr_session_file_meta *meta;
+	struct sr_session_file *file;
+	GHashTable *options;
+	char *filename, *ringname;
+	uint8_t buf[1000];
+	uint64_t i, base, num_samples, samples_read;
+	int ret;
+
+	filename = g_build_filename(g_get_tmp_dir(), "srtest-ring.sr", NULL);
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "ring",
+		g_variant_ref_sink(g_variant_new_uint32(1)));
+	write_test_file(filename, options);
+	g_hash_table_destroy(options);
+
+	/* The first chunk holds 4 MiB of samples, and the gap. */
+	base = 4 * 1024 * 1024;
+	ret = sr_session_file_open(filename, &file);
+	fail_unless(ret == SR_OK, "sr_session_file_open() failed: %d.", ret);
+	ret = sr_session_file_logic_info(file, NULL, NULL, &num_samples);
+	fail_unless(ret == SR_OK);
+	fail_unless(num_samples == 1024 * 1024);
+	ret = sr_session_file_read_logic(file, 0, sizeof(buf), buf,
+		&samples_read);
+	fail_unless(ret == SR_OK);
+	fail_unless(samples_read == sizeof(buf));
+	for (i = 0; i < sizeof(buf); i++)
+		fail_unless(buf[i] == test_sample(base + i),
+			"Wrong sample %" PRIu64 ".", i);
+	sr_session_file_close(file);
+
+	ret = sr_session_file_meta_get(srtest_ctx, filename, &meta);
+	fail_unless(ret == SR_OK);
+	fail_unless(sr_session_file_meta_gap(meta, 0, NULL, NULL) == SR_ERR_NA);
+	sr_session_file_meta_unref(meta);
+
+	/* The ring's slots got removed. */
+	ringname = g_strdup_printf("%s.ring", filename);
+	fail_unless(!g_file_test(ringname, G_FILE_TEST_EXISTS));
+	g_free(ringname);
+	g_unlink(filename);
+	g_free(filename);
+}
+END_TEST
+
+/* Check whether the srzip output keeps the frames of a capture. */
+START_TEST(test_session_file_frames)
+{
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	struct sr_session_file_meta *meta;
+	struct sr_session_file *file;
+	const struct sr_output *o;
+	struct sr_datafeed_packet packet, data_packet;
+	struct sr_datafeed_logic logic;
+	GSList *devlist;
+	GString *out;
+	char *filename;
+	uint8_t data[1000], buf[10];
+	uint64_t i, first, count, samples_read;
+	int64_t host_us;
+	int ret, frame;
+
+	filename = g_build_filename(g_get_tmp_dir(), "srtest-frames.sr", NULL);
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devlist = sr_driver_scan(driver, NULL);
+	fail_unless(devlist != NULL, "No demo device found.");
+	sdi = devlist->data;
+	g_slist_free(devlist);
+
+	/* Three frames of 1000 samples, each one filled with its number. */
+	o = sr_output_new(sr_output_find("srzip"), NULL, sdi, filename);
+	fail_unless(o != NULL, "Failed to create srzip output.");
+	logic.unitsize = 1;
+	logic.length = sizeof(data);
+	logic.data = data;
+	data_packet.type = SR_DF_LOGIC;
+	data_packet.payload = &logic;
+	packet.payload = NULL;
+	for (frame = 0; frame < 3; frame++) {
+		memset(data, frame, sizeof(data));
+		packet.type = SR_DF_FRAME_BEGIN;
+		fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+		fail_unless(sr_output_send(o, &data_packet, &out) == SR_OK);
+		packet.type = SR_DF_FRAME_END;
+		fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	}
+	packet.type = SR_DF_END;
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	sr_output_free(o);
+
+	ret = sr_session_file_meta_get(srtest_ctx, filename, &meta);
+	fail_unless(ret == SR_OK);
+	for (frame = 0; frame < 3; frame++) {
+		ret = sr_session_file_meta_frame(meta, frame, &first, &count,
+			&host_us);
+		fail_unless(ret == SR_OK);
+		fail_unless(first == 1000 * (uint64_t)frame);
+		fail_unless(count == 1000);
+		fail_unless(host_us > 0);
+	}
+	fail_unless(sr_session_file_meta_frame(meta, 3, NULL, NULL, NULL)
+		== SR_ERR_NA);
+	fail_unless(sr_session_file_meta_frame(NULL, 0, NULL, NULL, NULL)
+		== SR_ERR_ARG);
+
+	/* The frame's samples are where the list says. */
+	sr_session_file_meta_frame(meta, 2, &first, NULL, NULL);
+	sr_session_file_meta_unref(meta);
+	ret = sr_session_file_open(filename, &file);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_file_read_logic(file, first, sizeof(buf), buf,
+		&samples_read);
+	fail_unless(ret == SR_OK);
+	fail_unless(samples_read == sizeof(buf));
+	for (i = 0; i < sizeof(buf); i++)
+		fail_unless(buf[i] == 2);
+	sr_session_file_close(file);
+
+	g_unlink(filename);
+	g_free(filename);
+}
+END_TEST
+
+static uint8_t frame_sample(int frame, uint64_t i)
+{
+	return (i * 3 + (i % 5 ? 0 : frame)) & 0xff;
+}
+
+/*
+ * Check whether frames which the srzip output stored as differences to
+ * the previous frame read back in full, also frames which are longer
+ * or shorter than the previous one.
+ */
+START_TEST(test_session_file_frame_delta)
+{
+	static const uint64_t lengths[] = { 1000, 1200, 900, 1000, 700 };
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	struct sr_session_file *file;
+	const struct sr_output *o;
+	struct sr_datafeed_packet packet, data_packet;
+	struct sr_datafeed_logic logic;
+	GHashTable *options;
+	GSList *devlist;
+	GString *out;
+	char *filename;
+	uint8_t data[1200], buf[4800];
+	uint64_t i, pos, total, samples_read;
+	int ret, frame;
+
+	filename = g_build_filename(g_get_tmp_dir(), "srtest-delta.sr", NULL);
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devlist = sr_driver_scan(driver, NULL);
+	fail_unless(devlist != NULL, "No demo device found.");
+	sdi = devlist->data;
+	g_slist_free(devlist);
+
+	/* Frames 0 and 3 are keyframes. */
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "frame_delta",
+		g_variant_ref_sink(g_variant_new_uint32(3)));
+	o = sr_output_new(sr_output_find("srzip"), options, sdi, filename);
+	g_hash_table_destroy(options);
+	fail_unless(o != NULL, "Failed to create srzip output.");
+	logic.unitsize = 1;
+	logic.data = data;
+	data_packet.type = SR_DF_LOGIC;
+	data_packet.payload = &logic;
+	packet.payload = NULL;
+	total = 0;
+	for (frame = 0; frame < (int)G_N_ELEMENTS(lengths); frame++) {
+		logic.length = lengths[frame];
+		for (i = 0; i < logic.length; i++)
+			data[i] = frame_sample(frame, i);
+		packet.type = SR_DF_FRAME_BEGIN;
+		fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+		fail_unless(sr_output_send(o, &data_packet, &out) == SR_OK);
+		packet.type = SR_DF_FRAME_END;
+		fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+		total += logic.length;
+	}
+	packet.type = SR_DF_END;
+	fail_unless(sr_output_send(o, &packet, &out) == SR_OK);
+	sr_output_free(o);
+
+	ret = sr_session_file_open(filename, &file);
+	fail_unless(ret == SR_OK);
+	ret = sr_session_file_read_logic(file, 0, total, buf, &samples_read);
+	fail_unless(ret == SR_OK);
+	fail_unless(samples_read == total);
+	pos = 0;
+	for (frame = 0; frame < (int)G_N_ELEMENTS(lengths); frame++) {
+		for (i = 0; i < lengths[frame]; i++)
+			fail_unless(buf[pos + i] == frame_sample(frame, i),
+				"Wrong sample %" PRIu64 " of frame %d.", i, frame);
+		pos += lengths[frame];
+	}
+
+	/* A range from within frame 1 into frame 2. */
+	pos = lengths[0] + 1100;
+	ret = sr_session_file_read_logic(file, pos, 200, buf, &samples_read);
+	fail_unless(ret == SR_OK);
+	fail_unless(samples_read == 200);
+	for (i = 0; i < 100; i++)
+		fail_unless(buf[i] == frame_sample(1, 1100 + i));
+	for (i = 100; i < 200; i++)
+		fail_unless(buf[i] == frame_sample(2, i - 100));
+	sr_session_file_close(file);
+
+	g_unlink(filename);
+	g_free(filename);
+}
+END_TEST
+
+/* Check whether bogus session file arguments are rejected. */
+START_TEST(test_session_file_open_bogus)
+{
+	struct sr_session_file *file;
+
+	fail_unless(sr_session_file_open(NULL, &file) == SR_ERR_ARG);
+	fail_unless(sr_session_file_open("/nonexistent.sr", NULL) == SR_ERR_ARG);
+	fail_unless(sr_session_file_open("/nonexistent.sr", &file) != SR_OK);
+	sr_session_file_close(NULL);
+}
+END_TEST
+
 Suite *suite_session(void)
 {
 	Suite *s;
@@ -209,5 +1051,26 @@ Suite *suite_session(void)
 	tcase_add_test(tc, test_session_trigger_get_null);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("datafeed");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_datafeed_dispatch_set);
+	tcase_add_test(tc, test_packet_copy_ref);
+	tcase_add_test(tc, test_packet_timestamp);
+	tcase_add_test(tc, test_session_stats_get);
+	tcase_add_test(tc, test_session_stats_enable_set);
+	tcase_add_test(tc, test_session_latency_probe);
+	tcase_add_test(tc, test_session_backpressure_set);
+	tcase_add_test(tc, test_session_align);
+	tcase_add_test(tc, test_session_rearm);
+	tcase_add_test(tc, test_session_device_threads_set);
+	tcase_add_test(tc, test_session_file_read_logic);
+	tcase_add_test(tc, test_session_file_logic_summary);
+	tcase_add_test(tc, test_session_file_meta);
+	tcase_add_test(tc, test_session_file_ring);
+	tcase_add_test(tc, test_session_file_frames);
+	tcase_add_test(tc, test_session_file_frame_delta);
+	tcase_add_test(tc, test_session_file_open_bogus);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
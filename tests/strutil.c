@@ -188,6 +188,18 @@ START_TEST(test_locale)
 	test_sr_vsprintf_ascii("0.12345", "%.5f", (double)0.12345);
 	test_sr_vsprintf_ascii("0.123456", "%.6f", (double)0.123456);
 
+	/* Formats with and without floats, and with escaped percent signs. */
+	test_sr_vsnprintf_ascii("CH1:SCAL 12", "CH%d:SCAL %u", 1, 12);
+	test_sr_vsnprintf_ascii("50% 0.5", "%d%% %.1f", 50, (double)0.5);
+	test_sr_vsnprintf_ascii("%f", "%%f");
+	test_sr_vsprintf_ascii("x 1.50e+00", "%s %.2e", "x", (double)1.5);
+	test_sr_vsprintf_ascii("-00042", "%06ld", -42L);
+#ifndef _WIN32
+	/* The ' flag groups digits with the locale's thousands separator. */
+	test_sr_vsnprintf_ascii("1234567", "%'d", 1234567);
+	test_sr_vsprintf_ascii("1234567", "%'d", 1234567);
+#endif
+
 #if 0
 	/*
 	 * These tests can be used to tell on which platforms the printf()
@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -96,6 +97,61 @@ START_TEST(test_transform_options)
 }
 END_TEST
 
+/*
+ * Check that the repack transform describes its output channels, and
+ * leaves the device's channel list alone.
+ */
+START_TEST(test_transform_repack_channels)
+{
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	struct sr_session *session;
+	const struct sr_transform *t;
+	struct sr_channel *ch;
+	GSList *devlist, *dev_channels, *channels;
+	GHashTable *options;
+	guint num_dev_channels;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	devlist = sr_driver_scan(driver, NULL);
+	fail_unless(devlist != NULL, "No demo device found.");
+	sdi = devlist->data;
+	g_slist_free(devlist);
+	sr_session_new(srtest_ctx, &session);
+	sr_session_dev_add(session, sdi);
+	dev_channels = sr_dev_inst_channels_get(sdi);
+	num_dev_channels = g_slist_length(dev_channels);
+
+	t = sr_transform_new(sr_transform_find("nop"), NULL, sdi);
+	fail_unless(t != NULL);
+	fail_unless(sr_transform_channels_get(t) == NULL);
+	sr_transform_free(t);
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "channels",
+		g_variant_ref_sink(g_variant_new_string("D5,D2")));
+	t = sr_transform_new(sr_transform_find("repack"), options, sdi);
+	g_hash_table_destroy(options);
+	fail_unless(t != NULL, "Failed to create repack transform.");
+
+	/* The channels come in the order of their bits. */
+	channels = sr_transform_channels_get(t);
+	fail_unless(g_slist_length(channels) == 2);
+	ch = channels->data;
+	fail_unless(!strcmp(ch->name, "D2") && ch->index == 0);
+	ch = channels->next->data;
+	fail_unless(!strcmp(ch->name, "D5") && ch->index == 1);
+
+	fail_unless(sr_dev_inst_channels_get(sdi) == dev_channels);
+	fail_unless(g_slist_length(dev_channels) == num_dev_channels);
+
+	sr_transform_free(t);
+	sr_session_destroy(session);
+}
+END_TEST
+
 Suite *suite_transform_all(void)
 {
 	Suite *s;
@@ -112,5 +168,10 @@ Suite *suite_transform_all(void)
 	tcase_add_test(tc, test_transform_options);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("repack");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_transform_repack_channels);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
@@ -20,6 +20,7 @@
 #include <config.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -249,6 +250,186 @@ START_TEST(test_trigger_match_add_bogus)
 }
 END_TEST
 
+/* Samples of an analog trigger run on the demo driver, see below. */
+struct analog_run {
+	float values[200];
+	int num_values;
+	int trigger_pos;
+};
+
+static void collect_analog(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_analog *analog;
+	struct analog_run *run;
+	int len;
+
+	(void)sdi;
+
+	run = cb_data;
+	if (packet->type == SR_DF_TRIGGER) {
+		run->trigger_pos = run->num_values;
+		return;
+	}
+	if (packet->type != SR_DF_ANALOG)
+		return;
+	analog = packet->payload;
+	len = analog->num_samples;
+	fail_unless(run->num_values + len <= (int)G_N_ELEMENTS(run->values));
+	fail_unless(sr_analog_to_float(analog,
+		run->values + run->num_values) == SR_OK);
+	run->num_values += len;
+}
+
+/* Get a demo device with a single analog channel and no logic ones. */
+static struct sr_dev_inst *analog_demo_new(void)
+{
+	struct sr_dev_driver *driver;
+	struct sr_dev_inst *sdi;
+	struct sr_config *src;
+	GSList *devlist, *options;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+	options = NULL;
+	src = sr_config_new(SR_CONF_NUM_LOGIC_CHANNELS, g_variant_new_int32(0));
+	options = g_slist_append(options, src);
+	src = sr_config_new(SR_CONF_NUM_ANALOG_CHANNELS, g_variant_new_int32(1));
+	options = g_slist_append(options, src);
+	devlist = sr_driver_scan(driver, options);
+	g_slist_free_full(options, (GDestroyNotify)sr_config_free);
+	fail_unless(devlist != NULL, "No demo device found.");
+	sdi = devlist->data;
+	g_slist_free(devlist);
+	fail_unless(sr_dev_open(sdi) == SR_OK);
+
+	sr_config_set(sdi, NULL, SR_CONF_LIMIT_SAMPLES,
+		g_variant_new_uint64(100));
+	sr_config_set(sdi, NULL, SR_CONF_CAPTURE_RATIO,
+		g_variant_new_uint64(20));
+	sr_config_set(sdi, NULL, SR_CONF_UNTHROTTLED,
+		g_variant_new_boolean(TRUE));
+
+	return sdi;
+}
+
+/*
+ * Have the demo device generate a pattern, and collect its 100 samples
+ * around the analog trigger.
+ */
+static void run_analog_trigger(struct sr_dev_inst *sdi, const char *pattern,
+		int match, float value, double hysteresis, struct analog_run *run)
+{
+	struct sr_session *sess;
+	struct sr_channel_group *cg;
+	struct sr_channel *ch;
+	struct sr_trigger *trig;
+	struct sr_trigger_stage *stage;
+	int ret;
+
+	/* The "A0" group, after the "Analog" one. */
+	cg = g_slist_nth_data(sr_dev_inst_channel_groups_get(sdi), 1);
+	ch = sr_dev_inst_channels_get(sdi)->data;
+	ret = sr_config_set(sdi, cg, SR_CONF_PATTERN_MODE,
+		g_variant_new_string(pattern));
+	fail_unless(ret == SR_OK);
+	ret = sr_config_set(sdi, NULL, SR_CONF_TRIGGER_HYSTERESIS,
+		g_variant_new_double(hysteresis));
+	fail_unless(ret == SR_OK);
+
+	trig = sr_trigger_new(NULL);
+	stage = sr_trigger_stage_add(trig);
+	fail_unless(sr_trigger_match_add(stage, ch, match, value) == SR_OK);
+
+	memset(run, 0, sizeof(*run));
+	run->trigger_pos = -1;
+	sr_session_new(srtest_ctx, &sess);
+	sr_session_dev_add(sess, sdi);
+	sr_session_trigger_set(sess, trig);
+	sr_session_datafeed_callback_add(sess, collect_analog, run);
+	fail_unless(sr_session_start(sess) == SR_OK);
+	fail_unless(sr_session_run(sess) == SR_OK);
+	sr_session_destroy(sess);
+	sr_trigger_free(trig);
+
+	fail_unless(run->num_values == 100, "Got %d samples.",
+		run->num_values);
+}
+
+/*
+ * Check level triggers. The square pattern is -10 for five samples,
+ * then +10 for five samples.
+ */
+START_TEST(test_trigger_analog_level)
+{
+	struct sr_dev_inst *sdi;
+	struct analog_run run;
+	int i;
+
+	sdi = analog_demo_new();
+	run_analog_trigger(sdi, "square", SR_TRIGGER_OVER, 5, 0, &run);
+	fail_unless(run.trigger_pos == 5, "Triggered at %d.", run.trigger_pos);
+	for (i = 0; i < run.trigger_pos; i++)
+		fail_unless(run.values[i] < 0);
+	fail_unless(run.values[run.trigger_pos] > 5);
+
+	run_analog_trigger(sdi, "square", SR_TRIGGER_UNDER, -5, 0, &run);
+	fail_unless(run.trigger_pos == 0, "Triggered at %d.", run.trigger_pos);
+	fail_unless(run.values[0] < -5);
+
+	sr_dev_close(sdi);
+}
+END_TEST
+
+/*
+ * Check edge triggers. The sawtooth pattern rises from 0 to 9, falls
+ * to -10 and rises back to 0 within 20 samples. The first sample can't
+ * be a crossing, there is none before it.
+ */
+START_TEST(test_trigger_analog_edge)
+{
+	struct sr_dev_inst *sdi;
+	struct analog_run run;
+
+	sdi = analog_demo_new();
+	run_analog_trigger(sdi, "sawtooth", SR_TRIGGER_RISING, 0, 0, &run);
+	fail_unless(run.trigger_pos == 20, "Triggered at %d.", run.trigger_pos);
+	fail_unless(run.values[19] < 0);
+	fail_unless(run.values[20] >= 0);
+
+	run_analog_trigger(sdi, "sawtooth", SR_TRIGGER_FALLING, 0, 0, &run);
+	fail_unless(run.trigger_pos == 10, "Triggered at %d.", run.trigger_pos);
+	fail_unless(run.values[9] > 0);
+	fail_unless(run.values[10] <= 0);
+
+	sr_dev_close(sdi);
+}
+END_TEST
+
+/*
+ * Check that the hysteresis keeps small excursions from arming the
+ * trigger. A rising edge at 4.5 crosses at sample 5 already. With a
+ * hysteresis of 7 the signal must fall below -2.5 first, which it does
+ * at sample 10, so the trigger fires at sample 25.
+ */
+START_TEST(test_trigger_analog_hysteresis)
+{
+	struct sr_dev_inst *sdi;
+	struct analog_run run;
+
+	sdi = analog_demo_new();
+	run_analog_trigger(sdi, "sawtooth", SR_TRIGGER_RISING, 4.5, 0, &run);
+	fail_unless(run.trigger_pos == 5, "Triggered at %d.", run.trigger_pos);
+	fail_unless(run.values[run.trigger_pos] == 5);
+
+	run_analog_trigger(sdi, "sawtooth", SR_TRIGGER_RISING, 4.5, 7, &run);
+	fail_unless(run.trigger_pos == 20, "Triggered at %d.", run.trigger_pos);
+	fail_unless(run.values[run.trigger_pos] == 5);
+
+	sr_dev_close(sdi);
+}
+END_TEST
+
 Suite *suite_trigger(void)
 {
 	Suite *s;
@@ -276,5 +457,12 @@ Suite *suite_trigger(void)
 	tcase_add_test(tc, test_trigger_match_add_bogus);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("analog");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_trigger_analog_level);
+	tcase_add_test(tc, test_trigger_analog_edge);
+	tcase_add_test(tc, test_trigger_analog_hysteresis);
+	suite_add_tcase(s, tc);
+
 	return s;
 }